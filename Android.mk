@@ -88,6 +88,7 @@ include $(art_path)/compiler/Android.mk
 include $(art_path)/dex2oat/Android.mk
 include $(art_path)/disassembler/Android.mk
 include $(art_path)/oatdump/Android.mk
+include $(art_path)/patchoat/Android.mk
 include $(art_path)/dalvikvm/Android.mk
 include $(art_path)/tools/Android.mk
 include $(art_build_path)/Android.oat.mk
@@ -124,6 +125,7 @@ endef
 $(eval $(call call-art-multi-target-var,declare-art-target-test-dependencies-var,ART_TARGET_TEST_DEPENDENCIES))
 
 include $(art_build_path)/Android.libarttest.mk
+include $(art_build_path)/Android.libartbenchmark.mk
 
 # "mm test-art" to build and run all tests on host and device
 .PHONY: test-art
@@ -167,7 +169,7 @@ test-art-host-interpreter: test-art-host-oat-interpreter test-art-host-run-test-
 	@echo test-art-host-interpreter PASSED
 
 .PHONY: test-art-host-dependencies
-test-art-host-dependencies: $(ART_HOST_TEST_DEPENDENCIES) $(HOST_OUT_SHARED_LIBRARIES)/libarttest$(ART_HOST_SHLIB_EXTENSION) $(HOST_CORE_DEX_LOCATIONS)
+test-art-host-dependencies: $(ART_HOST_TEST_DEPENDENCIES) $(HOST_OUT_SHARED_LIBRARIES)/libarttest$(ART_HOST_SHLIB_EXTENSION) $(HOST_OUT_SHARED_LIBRARIES)/libartbenchmark$(ART_HOST_SHLIB_EXTENSION) $(HOST_CORE_DEX_LOCATIONS)
 
 .PHONY: test-art-host-gtest
 test-art-host-gtest: $(ART_HOST_GTEST_TARGETS)
@@ -190,6 +192,16 @@ test-art-host-oat-interpreter: $(ART_TEST_HOST_OAT_INTERPRETER_TARGETS)
 test-art-host-oat: test-art-host-oat-default test-art-host-oat-interpreter
 	@echo test-art-host-oat PASSED
 
+# "mm test-art-host-benchmarks" times test/Benchmarks with the non-debug runtime and writes the
+# results to $(HOST_OUT)/art-benchmarks.txt. With ART_BENCHMARK_BASELINE set to the results of
+# another build, the measurements which regressed are reported and fail the target.
+.PHONY: test-art-host-benchmarks
+test-art-host-benchmarks: $(HOST_OUT_JAVA_LIBRARIES)/$(ART_HOST_ARCH)/oat-test-dex-Benchmarks.odex test-art-host-dependencies
+	ANDROID_HOST_OUT=$(HOST_OUT) art/test/run-benchmarks --host \
+	  --lib-path $(HOST_OUT_SHARED_LIBRARIES) --output $(HOST_OUT)/art-benchmarks.txt \
+	  $(if $(ART_BENCHMARK_BASELINE),--baseline $(ART_BENCHMARK_BASELINE)) \
+	  $(addprefix --runtime-option ,$(DALVIKVM_FLAGS))
+
 define declare-test-art-host-run-test
 .PHONY: test-art-host-run-test-default-$(1)
 test-art-host-run-test-default-$(1): test-art-host-dependencies $(DX) $(HOST_OUT_EXECUTABLES)/jasmin
@@ -237,7 +249,7 @@ $(eval $(call call-art-multi-target-rule,declare-test-art-target,test-art-target
 
 define declare-test-art-target-dependencies
 .PHONY: test-art-target-dependencies$(1)
-test-art-target-dependencies$(1): $(ART_TARGET_TEST_DEPENDENCIES$(1)) $(ART_TARGET_LIBARTTEST_$(1))
+test-art-target-dependencies$(1): $(ART_TARGET_TEST_DEPENDENCIES$(1)) $(ART_TARGET_LIBARTTEST_$(1)) $(ART_TARGET_LIBARTBENCHMARK_$(1))
 endef
 $(eval $(call call-art-multi-target-rule,declare-test-art-target-dependencies,test-art-target-dependencies))
 
@@ -248,6 +260,15 @@ test-art-target-sync: test-art-target-dependencies$(ART_PHONY_TEST_TARGET_SUFFIX
 	adb sync
 	adb shell mkdir -p $(ART_TEST_DIR)
 
+# "mm test-art-target-benchmarks" is test-art-host-benchmarks run on the device, the results
+# are written to $(PRODUCT_OUT)/art-benchmarks.txt.
+.PHONY: test-art-target-benchmarks
+test-art-target-benchmarks: test-art-target-sync
+	art/test/run-benchmarks \
+	  --lib-path $(ART_TEST_DIR)/$(TARGET_ARCH) --output $(PRODUCT_OUT)/art-benchmarks.txt \
+	  $(if $(ART_BENCHMARK_BASELINE),--baseline $(ART_BENCHMARK_BASELINE)) \
+	  $(addprefix --runtime-option ,$(DALVIKVM_FLAGS))
+
 
 define declare-test-art-target-gtest
 .PHONY: test-art-target-gtest$(1)
@@ -107,7 +107,20 @@ DALVIKVM_FLAGS += -Xcompiler-option --compiler-backend=Optimizing
 endif
 
 #
-# Used to change the default GC. Valid values are CMS, SS, GSS. The default is CMS.
+# Used to shift the 32-bit heap references of the 64-bit runtime, at most by 3 with the 8 byte
+# object alignment. The heap may then be anywhere below 4GB << ART_HEAP_REFERENCE_SHIFT.
+#
+ART_HEAP_REFERENCE_SHIFT ?= 0
+
+#
+# Used to change the size of the interface method table. Larger tables have fewer interface methods
+# sharing a slot, which dispatch through the conflict trampoline, but grow the classes implementing
+# interfaces. The compiled code embeds the size, the image and the apps have to be built with it.
+#
+ART_IMT_SIZE ?= 64
+
+#
+# Used to change the default GC. Valid values are CMS, SS, GSS, GENCMS. The default is CMS.
 #
 ART_DEFAULT_GC_TYPE ?= CMS
 ART_DEFAULT_GC_TYPE_CFLAGS := -DART_DEFAULT_GC_TYPE_IS_$(ART_DEFAULT_GC_TYPE)
@@ -222,6 +235,14 @@ ifeq ($(ART_SEA_IR_MODE),true)
   art_cflags += -DART_SEA_IR_MODE=1
 endif
 
+ifneq ($(ART_HEAP_REFERENCE_SHIFT),0)
+  art_cflags += -DART_HEAP_REFERENCE_SHIFT=$(ART_HEAP_REFERENCE_SHIFT)
+endif
+
+ifneq ($(ART_IMT_SIZE),64)
+  art_cflags += -DART_IMT_SIZE=$(ART_IMT_SIZE)
+endif
+
 art_non_debug_cflags := \
 	-O3
 
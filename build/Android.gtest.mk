@@ -22,24 +22,32 @@ RUNTIME_GTEST_COMMON_SRC_FILES := \
 	runtime/barrier_test.cc \
 	runtime/base/bit_field_test.cc \
 	runtime/base/bit_vector_test.cc \
+	runtime/base/concurrent_histogram_test.cc \
 	runtime/base/hex_dump_test.cc \
 	runtime/base/histogram_test.cc \
 	runtime/base/mutex_test.cc \
 	runtime/base/timing_logger_test.cc \
+	runtime/base/work_stealing_deque_test.cc \
 	runtime/base/unix_file/fd_file_test.cc \
 	runtime/base/unix_file/mapped_file_test.cc \
 	runtime/base/unix_file/null_file_test.cc \
 	runtime/base/unix_file/random_access_file_utils_test.cc \
 	runtime/base/unix_file/string_file_test.cc \
+	runtime/catch_handler_cache_test.cc \
 	runtime/class_linker_test.cc \
+	runtime/class_table_test.cc \
 	runtime/dex_file_test.cc \
 	runtime/dex_instruction_visitor_test.cc \
 	runtime/dex_method_iterator_test.cc \
 	runtime/entrypoints/math_entrypoints_test.cc \
 	runtime/entrypoints_order_test.cc \
 	runtime/exception_test.cc \
+	runtime/gc/accounting/card_table_test.cc \
 	runtime/gc/accounting/space_bitmap_test.cc \
+	runtime/gc/allocation_sampler_test.cc \
+	runtime/gc/collector/concurrent_copying_test.cc \
 	runtime/gc/heap_test.cc \
+	runtime/gc/space/bump_pointer_space_test.cc \
 	runtime/gc/space/dlmalloc_space_base_test.cc \
 	runtime/gc/space/dlmalloc_space_static_test.cc \
 	runtime/gc/space/dlmalloc_space_random_test.cc \
@@ -53,14 +61,23 @@ RUNTIME_GTEST_COMMON_SRC_FILES := \
 	runtime/indirect_reference_table_test.cc \
 	runtime/instruction_set_test.cc \
 	runtime/intern_table_test.cc \
+	runtime/interpreter/interpreter_cache_test.cc \
+	runtime/jdwp/object_registry_test.cc \
+	runtime/jit/jit_code_cache_test.cc \
+	runtime/jni_call_cache_test.cc \
 	runtime/leb128_test.cc \
 	runtime/mem_map_test.cc \
 	runtime/mirror/dex_cache_test.cc \
 	runtime/mirror/object_test.cc \
+	runtime/monitor_pool_test.cc \
+	runtime/monitor_test.cc \
 	runtime/parsed_options_test.cc \
+	runtime/perf_map_test.cc \
+	runtime/profiler_test.cc \
 	runtime/reference_table_test.cc \
 	runtime/thread_pool_test.cc \
 	runtime/transaction_test.cc \
+	runtime/utf_test.cc \
 	runtime/utils_test.cc \
 	runtime/verifier/method_verifier_test.cc \
 	runtime/verifier/reg_type_test.cc \
@@ -72,14 +89,19 @@ COMPILER_GTEST_COMMON_SRC_FILES := \
 	runtime/reflection_test.cc \
 	compiler/dex/local_value_numbering_test.cc \
 	compiler/dex/mir_optimization_test.cc \
+	compiler/dex/verification_cache_test.cc \
 	compiler/driver/compiler_driver_test.cc \
 	compiler/elf_writer_test.cc \
+	compiler/gc_map_builder_test.cc \
 	compiler/image_test.cc \
 	compiler/jni/jni_compiler_test.cc \
 	compiler/oat_test.cc \
+	compiler/optimizing/bounds_check_elimination_test.cc \
 	compiler/optimizing/codegen_test.cc \
 	compiler/optimizing/dominator_test.cc \
 	compiler/optimizing/find_loops_test.cc \
+	compiler/optimizing/gvn_test.cc \
+	compiler/optimizing/licm_test.cc \
 	compiler/optimizing/linearize_test.cc \
 	compiler/optimizing/liveness_test.cc \
 	compiler/optimizing/live_interval_test.cc \
@@ -88,6 +110,7 @@ COMPILER_GTEST_COMMON_SRC_FILES := \
 	compiler/optimizing/pretty_printer_test.cc \
 	compiler/optimizing/register_allocator_test.cc \
 	compiler/optimizing/ssa_test.cc \
+	compiler/optimizing/stack_map_test.cc \
 	compiler/output_stream_test.cc \
 	compiler/utils/arena_allocator_test.cc \
 	compiler/utils/dedupe_set_test.cc \
@@ -18,6 +18,9 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace art {
 
 BufferedOutputStream::BufferedOutputStream(OutputStream* out)
@@ -25,8 +28,8 @@ BufferedOutputStream::BufferedOutputStream(OutputStream* out)
 
 bool BufferedOutputStream::WriteFully(const void* buffer, size_t byte_count) {
   if (byte_count > kBufferSize) {
-    Flush();
-    return out_->WriteFully(buffer, byte_count);
+    struct iovec iov = { const_cast<void*>(buffer), byte_count };
+    return WriteVectored(&iov, 1);
   }
   if (used_ + byte_count > kBufferSize) {
     bool success = Flush();
@@ -40,6 +43,18 @@ bool BufferedOutputStream::WriteFully(const void* buffer, size_t byte_count) {
   return true;
 }
 
+bool BufferedOutputStream::WriteVectored(const struct iovec* iov, int iov_count) {
+  if (used_ == 0) {
+    return out_->WriteVectored(iov, iov_count);
+  }
+  std::vector<struct iovec> with_buffer(iov_count + 1);
+  with_buffer[0].iov_base = &buffer_[0];
+  with_buffer[0].iov_len = used_;
+  std::copy(iov, iov + iov_count, with_buffer.begin() + 1);
+  used_ = 0;
+  return out_->WriteVectored(&with_buffer[0], with_buffer.size());
+}
+
 bool BufferedOutputStream::Flush() {
   bool success = true;
   if (used_ > 0) {
@@ -56,4 +71,8 @@ off_t BufferedOutputStream::Seek(off_t offset, Whence whence) {
   return out_->Seek(offset, whence);
 }
 
+bool BufferedOutputStream::Preallocate(off_t size) {
+  return out_->Preallocate(size);
+}
+
 }  // namespace art
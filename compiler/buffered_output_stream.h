@@ -28,18 +28,25 @@ class BufferedOutputStream : public OutputStream {
   explicit BufferedOutputStream(OutputStream* out);
 
   virtual ~BufferedOutputStream() {
+    Flush();
     delete out_;
   }
 
+  // Writes larger than the buffer go straight to the underlying stream, together with the
+  // buffered data in a single vectored write.
   virtual bool WriteFully(const void* buffer, size_t byte_count);
 
+  virtual bool WriteVectored(const struct iovec* iov, int iov_count);
+
   virtual off_t Seek(off_t offset, Whence whence);
 
+  virtual bool Preallocate(off_t size);
+
+  virtual bool Flush();
+
  private:
   static const size_t kBufferSize = 8 * KB;
 
-  bool Flush();
-
   OutputStream* const out_;
 
   uint8_t buffer_[kBufferSize];
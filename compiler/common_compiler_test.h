@@ -183,7 +183,8 @@ class CommonCompilerTest : public CommonRuntimeTest {
         OatQuickMethodHeader method_header(mapping_table_offset, vmap_table_offset,
                                            compiled_method->GetFrameSizeInBytes(),
                                            compiled_method->GetCoreSpillMask(),
-                                           compiled_method->GetFpSpillMask(), code_size);
+                                           compiled_method->GetFpSpillMask(), code_size,
+                                           compiled_method->HasStackMaps());
 
         header_code_and_maps_chunks_.push_back(std::vector<uint8_t>());
         std::vector<uint8_t>* chunk = &header_code_and_maps_chunks_.back();
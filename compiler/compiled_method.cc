@@ -152,10 +152,27 @@ CompiledMethod::CompiledMethod(CompilerDriver* driver,
       core_spill_mask_(core_spill_mask), fp_spill_mask_(fp_spill_mask),
   mapping_table_(driver->DeduplicateMappingTable(mapping_table)),
   vmap_table_(driver->DeduplicateVMapTable(vmap_table)),
+  has_stack_maps_(false),
   gc_map_(driver->DeduplicateGCMap(native_gc_map)),
   cfi_info_(driver->DeduplicateCFIInfo(cfi_info)) {
 }
 
+CompiledMethod::CompiledMethod(CompilerDriver* driver,
+                               InstructionSet instruction_set,
+                               const std::vector<uint8_t>& quick_code,
+                               const size_t frame_size_in_bytes,
+                               const uint32_t core_spill_mask,
+                               const uint32_t fp_spill_mask,
+                               const std::vector<uint8_t>& stack_maps)
+    : CompiledCode(driver, instruction_set, quick_code), frame_size_in_bytes_(frame_size_in_bytes),
+      core_spill_mask_(core_spill_mask), fp_spill_mask_(fp_spill_mask),
+      mapping_table_(driver->DeduplicateMappingTable(std::vector<uint8_t>())),
+      vmap_table_(driver->DeduplicateVMapTable(stack_maps)),
+      has_stack_maps_(true),
+      gc_map_(driver->DeduplicateGCMap(std::vector<uint8_t>())),
+      cfi_info_(nullptr) {
+}
+
 CompiledMethod::CompiledMethod(CompilerDriver* driver,
                                InstructionSet instruction_set,
                                const std::vector<uint8_t>& code,
@@ -167,6 +184,7 @@ CompiledMethod::CompiledMethod(CompilerDriver* driver,
       core_spill_mask_(core_spill_mask), fp_spill_mask_(fp_spill_mask),
       mapping_table_(driver->DeduplicateMappingTable(std::vector<uint8_t>())),
       vmap_table_(driver->DeduplicateVMapTable(std::vector<uint8_t>())),
+      has_stack_maps_(false),
       gc_map_(driver->DeduplicateGCMap(std::vector<uint8_t>())),
       cfi_info_(nullptr) {
 }
@@ -177,7 +195,7 @@ CompiledMethod::CompiledMethod(CompilerDriver* driver, InstructionSet instructio
                                const std::string& symbol)
     : CompiledCode(driver, instruction_set, code, symbol),
       frame_size_in_bytes_(kStackAlignment), core_spill_mask_(0),
-      fp_spill_mask_(0), gc_map_(driver->DeduplicateGCMap(gc_map)) {
+      fp_spill_mask_(0), has_stack_maps_(false), gc_map_(driver->DeduplicateGCMap(gc_map)) {
   mapping_table_ = driver->DeduplicateMappingTable(std::vector<uint8_t>());
   vmap_table_ = driver->DeduplicateVMapTable(std::vector<uint8_t>());
 }
@@ -186,7 +204,7 @@ CompiledMethod::CompiledMethod(CompilerDriver* driver, InstructionSet instructio
                                const std::string& code, const std::string& symbol)
     : CompiledCode(driver, instruction_set, code, symbol),
       frame_size_in_bytes_(kStackAlignment), core_spill_mask_(0),
-      fp_spill_mask_(0) {
+      fp_spill_mask_(0), has_stack_maps_(false) {
   mapping_table_ = driver->DeduplicateMappingTable(std::vector<uint8_t>());
   vmap_table_ = driver->DeduplicateVMapTable(std::vector<uint8_t>());
   gc_map_ = driver->DeduplicateGCMap(std::vector<uint8_t>());
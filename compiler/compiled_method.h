@@ -113,6 +113,16 @@ class CompiledMethod : public CompiledCode {
                  const std::vector<uint8_t>& native_gc_map,
                  const std::vector<uint8_t>* cfi_info);
 
+  // Constructs a CompiledMethod for the optimizing compiler, whose stack maps replace the mapping
+  // table, the vmap table and the GC map.
+  CompiledMethod(CompilerDriver* driver,
+                 InstructionSet instruction_set,
+                 const std::vector<uint8_t>& quick_code,
+                 const size_t frame_size_in_bytes,
+                 const uint32_t core_spill_mask,
+                 const uint32_t fp_spill_mask,
+                 const std::vector<uint8_t>& stack_maps);
+
   // Constructs a CompiledMethod for the QuickJniCompiler.
   CompiledMethod(CompilerDriver* driver,
                  InstructionSet instruction_set,
@@ -158,6 +168,11 @@ class CompiledMethod : public CompiledCode {
     return *gc_map_;
   }
 
+  // Whether the vmap table holds the stack maps of optimized code.
+  bool HasStackMaps() const {
+    return has_stack_maps_;
+  }
+
   const std::vector<uint8_t>* GetCFIInfo() const {
     return cfi_info_;
   }
@@ -173,7 +188,10 @@ class CompiledMethod : public CompiledCode {
   // native PC offset. Size prefixed.
   std::vector<uint8_t>* mapping_table_;
   // For quick code, a uleb128 encoded map from GPR/FPR register to dex register. Size prefixed.
+  // For optimized code, the stack maps.
   std::vector<uint8_t>* vmap_table_;
+  // Whether the code is optimized code, with stack maps and without mapping table and GC map.
+  const bool has_stack_maps_;
   // For quick code, a map keyed by native PC indices to bitmaps describing what dalvik registers
   // are live. For portable code, the key is a dalvik PC.
   std::vector<uint8_t>* gc_map_;
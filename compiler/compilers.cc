@@ -17,6 +17,8 @@
 #include "compilers.h"
 #include "dex/mir_graph.h"
 #include "dex/quick/mir_to_lir.h"
+#include "dex_instruction.h"
+#include "driver/compiler_options.h"
 #include "elf_writer_quick.h"
 #include "mirror/art_method-inl.h"
 
@@ -39,6 +41,7 @@ extern "C" art::CompiledMethod* ArtQuickJniCompileMethod(art::CompilerDriver* dr
 
 // Hack for CFI CIE initialization
 extern std::vector<uint8_t>* X86CFIInitialization();
+extern std::vector<uint8_t>* ArmCFIInitialization();
 
 void QuickCompiler::Init() const {
   ArtInitQuickCompilerContext(GetCompilerDriver());
@@ -128,6 +131,9 @@ Backend* QuickCompiler::GetCodeGenerator(CompilationUnit* cu, void* compilation_
 
 std::vector<uint8_t>* QuickCompiler::GetCallFrameInformationInitialization(
     const CompilerDriver& driver) const {
+  if (driver.GetInstructionSet() == kArm || driver.GetInstructionSet() == kThumb2) {
+    return ArmCFIInitialization();
+  }
   if (driver.GetInstructionSet() == kX86) {
     return X86CFIInitialization();
   }
@@ -137,6 +143,20 @@ std::vector<uint8_t>* QuickCompiler::GetCallFrameInformationInitialization(
   return nullptr;
 }
 
+// Whether the method has a loop, that is a branch to itself or to a lower dex pc.
+static bool HasBackwardBranch(const DexFile::CodeItem* code_item) {
+  const uint16_t* insns = code_item->insns_;
+  const uint16_t* end = insns + code_item->insns_size_in_code_units_;
+  while (insns < end) {
+    const Instruction* inst = Instruction::At(insns);
+    if (inst->IsBranch() && inst->GetTargetOffset() <= 0) {
+      return true;
+    }
+    insns += inst->SizeInCodeUnits();
+  }
+  return false;
+}
+
 CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
                                             uint32_t access_flags,
                                             InvokeType invoke_type,
@@ -144,14 +164,31 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
                                             uint32_t method_idx,
                                             jobject class_loader,
                                             const DexFile& dex_file) const {
-  CompiledMethod* method = TryCompile(code_item, access_flags, invoke_type, class_def_idx,
-                                      method_idx, class_loader, dex_file);
-  if (method != nullptr) {
-    return method;
+  CompilerDriver* driver = GetCompilerDriver();
+  // With the speed-profile filter only the hot methods get here. The optimizing compiler pays
+  // off on their loops, Quick is as good on straight-line code and compiles it faster.
+  bool try_optimizing =
+      driver->GetCompilerOptions().GetCompilerFilter() != CompilerOptions::kSpeedProfile ||
+      HasBackwardBranch(code_item);
+  if (try_optimizing) {
+    CompiledMethod* method = TryCompile(code_item, access_flags, invoke_type, class_def_idx,
+                                        method_idx, class_loader, dex_file);
+    if (method != nullptr) {
+      driver->RecordCompilationDecision(dex_file, method_idx, "optimizing");
+      return method;
+    }
   }
 
-  return QuickCompiler::Compile(code_item, access_flags, invoke_type, class_def_idx, method_idx,
-                                class_loader, dex_file);
+  CompiledMethod* method = QuickCompiler::Compile(code_item, access_flags, invoke_type,
+                                                  class_def_idx, method_idx, class_loader,
+                                                  dex_file);
+  if (method != nullptr) {
+    // Without a loop the optimizing compiler was not tried, otherwise it bailed out on
+    // instructions or an instruction set it does not support yet.
+    driver->RecordCompilationDecision(dex_file, method_idx,
+                                      try_optimizing ? "quick-unsupported" : "quick-no-loop");
+  }
+  return method;
 }
 
 }  // namespace art
@@ -197,6 +197,54 @@ class ClassInitCheckElimination : public PassME {
   }
 };
 
+/**
+ * @class LocalMonitorElimination
+ * @brief Removes the locking of objects that don't escape the method.
+ */
+class LocalMonitorElimination : public PassME {
+ public:
+  LocalMonitorElimination() : PassME("LocalMonitorElimination", kNoNodes) {
+  }
+
+  bool Gate(const PassDataHolder* data) const {
+    DCHECK(data != nullptr);
+    CompilationUnit* cUnit = down_cast<const PassMEDataHolder*>(data)->c_unit;
+    DCHECK(cUnit != nullptr);
+    return cUnit->mir_graph->EliminateLocalMonitorsGate();
+  }
+
+  void Start(const PassDataHolder* data) const {
+    DCHECK(data != nullptr);
+    CompilationUnit* cUnit = down_cast<const PassMEDataHolder*>(data)->c_unit;
+    DCHECK(cUnit != nullptr);
+    cUnit->mir_graph->EliminateLocalMonitors();
+  }
+};
+
+/**
+ * @class LoopRangeCheckElimination
+ * @brief Removes the range checks of array accesses indexed by a counted loop variable.
+ */
+class LoopRangeCheckElimination : public PassME {
+ public:
+  LoopRangeCheckElimination() : PassME("LoopRangeCheckElimination", kNoNodes) {
+  }
+
+  bool Gate(const PassDataHolder* data) const {
+    DCHECK(data != nullptr);
+    CompilationUnit* cUnit = down_cast<const PassMEDataHolder*>(data)->c_unit;
+    DCHECK(cUnit != nullptr);
+    return cUnit->mir_graph->EliminateLoopRangeChecksGate();
+  }
+
+  void Start(const PassDataHolder* data) const {
+    DCHECK(data != nullptr);
+    CompilationUnit* cUnit = down_cast<const PassMEDataHolder*>(data)->c_unit;
+    DCHECK(cUnit != nullptr);
+    cUnit->mir_graph->EliminateLoopRangeChecks();
+  }
+};
+
 /**
  * @class NullCheckEliminationAndTypeInference
  * @brief Null check elimination and type inference.
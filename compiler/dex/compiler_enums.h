@@ -129,6 +129,13 @@ enum ExtendedMIROpcode {
   kMirOpCheckPart2,
   kMirOpSelect,
 
+  // @brief Guard of a virtual call inlined for the only implementation known at compile time.
+  // vA: receiver register.
+  // vB: method index of the invoke, resolved through the dex cache of the current method.
+  // Branches to the taken block with the regular invoke when the vtable entry of the
+  // receiver's class at the invoke's vtable index isn't the resolved method.
+  kMirOpCheckVirtualTarget,
+
   // Vector opcodes:
   // TypeSize is an encoded field giving the element type and the vector size.
   // It is encoded as OpSize << 16 | (number of bits in vector)
@@ -45,6 +45,10 @@ struct CompilationUnit {
   void NewTimingSplit(const char* label);
   void EndTiming();
 
+  // Turns the optional optimizations off for the rest of the compilation once the arenas exceed
+  // the budget of the compiler options. Called between passes, which read disable_opt.
+  void CheckArenaBudget();
+
   /*
    * Fields needed/generated by common frontend and generally used throughout
    * the compiler.
@@ -89,6 +93,7 @@ struct CompilationUnit {
   std::unique_ptr<Backend> cg;           // Target-specific codegen.
   TimingLogger timings;
   bool print_pass;                 // Do we want to print a pass or not?
+  bool over_arena_budget;          // Whether CheckArenaBudget() turned the optimizations off.
 };
 
 }  // namespace art
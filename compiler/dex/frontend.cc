@@ -53,6 +53,30 @@ static uint32_t kCompilerOptimizerDisableFlags = 0 |  // Disable specific optimi
   // (1 << kPromoteCompilerTemps) |
   // (1 << kSuppressExceptionEdges) |
   // (1 << kSuppressMethodInlining) |
+  // (1 << kPeephole) |
+  // (1 << kLocalMonitorElimination) |
+  // (1 << kLoopRangeCheckElimination) |
+  0;
+
+// The optimizations turned off for the methods whose arenas exceed the budget. They only save
+// code size and time at runtime, the code is correct without them.
+static constexpr uint32_t kArenaBudgetDisableFlags = 0 |
+  (1 << kLoadStoreElimination) |
+  (1 << kLoadHoisting) |
+  (1 << kSuppressLoads) |
+  (1 << kNullCheckElimination) |
+  (1 << kClassInitCheckElimination) |
+  (1 << kPromoteRegs) |
+  (1 << kTrackLiveTemps) |
+  (1 << kSafeOptimizations) |
+  (1 << kBBOpt) |
+  (1 << kMatch) |
+  (1 << kPromoteCompilerTemps) |
+  (1 << kBranchFusing) |
+  (1 << kSuppressMethodInlining) |
+  (1 << kPeephole) |
+  (1 << kLocalMonitorElimination) |
+  (1 << kLoopRangeCheckElimination) |
   0;
 
 static uint32_t kCompilerDebugFlags = 0 |     // Enable debug/testing modes
@@ -76,6 +100,7 @@ static uint32_t kCompilerDebugFlags = 0 |     // Enable debug/testing modes
   // (1 << kDebugShowFilterStats) |
   // (1 << kDebugTimings) |
   // (1 << kDebugCodegenDump) |
+  // (1 << kDebugShowSlowPathSize) |
   0;
 
 CompilationUnit::CompilationUnit(ArenaPool* pool)
@@ -106,7 +131,8 @@ CompilationUnit::CompilationUnit(ArenaPool* pool)
     mir_graph(nullptr),
     cg(nullptr),
     timings("QuickCompiler", true, false),
-    print_pass(false) {
+    print_pass(false),
+    over_arena_budget(false) {
 }
 
 CompilationUnit::~CompilationUnit() {
@@ -124,6 +150,20 @@ void CompilationUnit::NewTimingSplit(const char* label) {
   }
 }
 
+void CompilationUnit::CheckArenaBudget() {
+  size_t budget = compiler_driver->GetCompilerOptions().GetArenaBudget();
+  if (budget == 0u || over_arena_budget) {
+    return;
+  }
+  size_t bytes_in_arenas = arena.BytesInArenas() + arena_stack.BytesInArenas();
+  if (bytes_in_arenas > budget) {
+    over_arena_budget = true;
+    disable_opt |= kArenaBudgetDisableFlags;
+    VLOG(compiler) << "Arena budget exceeded with " << bytes_in_arenas << " bytes, compiling "
+                   << PrettyMethod(method_idx, *dex_file) << " without optimizations";
+  }
+}
+
 void CompilationUnit::EndTiming() {
   if (compiler_driver->GetDumpPasses()) {
     timings.EndSplit();
@@ -888,7 +928,8 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
   if (cu.instruction_set == kArm64 || cu.instruction_set == kX86_64) {
     // TODO(Arm64): enable optimizations once backend is mature enough.
     // TODO(X86_64): enable optimizations once backend is mature enough.
-    cu.disable_opt = ~(uint32_t)0;
+    // The peepholes only rewrite short sequences of the target's own instructions.
+    cu.disable_opt = ~(uint32_t)(1 << kPeephole);
     cu.enable_debug |= (1 << kDebugCodegenDump);
   }
 
@@ -930,6 +971,9 @@ static CompiledMethod* CompileMethod(CompilerDriver& driver,
     return NULL;
   }
 
+  // Huge graphs may already be over the arena budget, then they skip the optimizations.
+  cu.CheckArenaBudget();
+
   /* Create the pass driver and launch it */
   PassDriverMEOpts pass_driver(&cu);
   pass_driver.Launch();
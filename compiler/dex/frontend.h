@@ -54,6 +54,9 @@ enum opt_control_vector {
   kBranchFusing,
   kSuppressExceptionEdges,
   kSuppressMethodInlining,
+  kPeephole,
+  kLocalMonitorElimination,
+  kLoopRangeCheckElimination,
 };
 
 // Force code generation paths for testing.
@@ -77,7 +80,8 @@ enum debugControlVector {
   kDebugShowSummaryMemoryUsage,
   kDebugShowFilterStats,
   kDebugTimings,
-  kDebugCodegenDump
+  kDebugCodegenDump,
+  kDebugShowSlowPathSize,
 };
 
 class LLVMInfo {
@@ -841,6 +841,9 @@ const uint32_t MIRGraph::analysis_attributes_[kMirOpLast] = {
 
   // 113 MIR_SELECT
   AN_NONE,
+
+  // 114 MIR_CHECK_VIRTUAL_TARGET
+  AN_BRANCH,
 };
 
 struct MethodStats {
@@ -1015,7 +1018,12 @@ bool MIRGraph::SkipCompilation() {
     return true;
   }
 
-  if (!compiler_options.IsCompilationEnabled() || compiler_filter == CompilerOptions::kProfiled) {
+  if (!compiler_options.IsCompilationEnabled()) {
+    return true;
+  }
+
+  // Without a profile the profiled filters compile nothing.
+  if (compiler_options.IsProfileGuided() && !cu_->compiler_driver->ProfilePresent()) {
     return true;
   }
 
@@ -1031,6 +1039,9 @@ bool MIRGraph::SkipCompilation() {
       small_cutoff = compiler_options.GetTinyMethodThreshold();
       default_cutoff = compiler_options.GetSmallMethodThreshold();
       break;
+    case CompilerOptions::kProfiled:
+    case CompilerOptions::kSpeedProfile:
+      // Only the hot methods of the profile get here, compile them for speed.
     case CompilerOptions::kSpeed:
       small_cutoff = compiler_options.GetHugeMethodThreshold();
       default_cutoff = compiler_options.GetHugeMethodThreshold();
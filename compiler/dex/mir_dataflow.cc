@@ -840,6 +840,9 @@ const uint64_t MIRGraph::oat_data_flow_attributes_[kMirOpLast] = {
 
   // 113 MIR_SELECT
   DF_DA | DF_UB,
+
+  // 114 MIR_CHECK_VIRTUAL_TARGET
+  DF_UA | DF_NULL_CHK_0 | DF_REF_A,
 };
 
 /* Return the base virtual register for a SSA name */
@@ -1246,11 +1249,21 @@ void MIRGraph::CountUses(struct BasicBlock* bb) {
   }
   // Each level of nesting adds *100 to count, up to 3 levels deep.
   uint32_t depth = std::min(3U, static_cast<uint32_t>(bb->nesting_depth));
-  uint32_t weight = std::max(1U, depth * 100);
+  uint32_t block_weight = std::max(1U, depth * 100);
+  bool after_call = false;
   for (MIR* mir = bb->first_mir_insn; (mir != NULL); mir = mir->next) {
     if (mir->ssa_rep == NULL) {
       continue;
     }
+    // A use after a call of the block reads a value live across the call. Unless it is
+    // promoted to a callee-save register, the value was flushed for the call and is reloaded,
+    // so count the use twice.
+    uint32_t weight = after_call ? 2 * block_weight : block_weight;
+    if (static_cast<int>(mir->dalvikInsn.opcode) < kMirOpFirst &&
+        (mir->optimization_flags & MIR_INLINED) == 0 &&
+        (Instruction::FlagsOf(mir->dalvikInsn.opcode) & Instruction::kInvoke) != 0) {
+      after_call = true;
+    }
     for (int i = 0; i < mir->ssa_rep->num_uses; i++) {
       int s_reg = mir->ssa_rep->uses[i];
       raw_use_counts_.Increment(s_reg);
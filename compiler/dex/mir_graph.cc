@@ -47,6 +47,7 @@ const char* MIRGraph::extended_mir_op_names_[kMirOpLast - kMirOpFirst] = {
   "Check1",
   "Check2",
   "Select",
+  "CheckVirtualTarget",
   "ConstVector",
   "MoveVector",
   "PackedMultiply",
@@ -814,7 +815,7 @@ void MIRGraph::DumpCFG(const char* dir_prefix, bool all_blocks, const char *suff
                 bb->first_mir_insn ? " | " : " ");
         for (mir = bb->first_mir_insn; mir; mir = mir->next) {
             int opcode = mir->dalvikInsn.opcode;
-            if (opcode > kMirOpSelect && opcode < kMirOpLast) {
+            if (opcode >= kMirOpConstVector && opcode < kMirOpLast) {
               if (opcode == kMirOpConstVector) {
                 fprintf(file, "    {%04x %s %d %d %d %d %d %d\\l}%s\\\n", mir->offset,
                         extended_mir_op_names_[kMirOpConstVector - kMirOpFirst],
@@ -386,6 +386,7 @@ struct BasicBlock {
   bool terminated_by_return:1;  // Block ends with a Dalvik return opcode.
   bool dominates_return:1;      // Is a member of return extended basic block.
   bool use_lvn:1;               // Run local value numbering on this block.
+  bool cold:1;                  // Only entered on the way to a throw, laid out at the method end.
   MIR* first_mir_insn;
   MIR* last_mir_insn;
   BasicBlockDataFlow* data_flow_info;
@@ -893,6 +894,22 @@ class MIRGraph {
     return IsBackedge(branch_bb, branch_bb->taken) || IsBackedge(branch_bb, branch_bb->fall_through);
   }
 
+  // Whether bb is the target of a branch from a later block in the dex code, the head of a loop.
+  // Blocks split at the same offset don't count, they only jump forwards.
+  bool IsLoopHead(BasicBlock* bb) {
+    GrowableArray<BasicBlockId>::Iterator iter(bb->predecessors);
+    while (true) {
+      BasicBlock* pred_bb = GetBasicBlock(iter.Next());
+      if (pred_bb == nullptr) {
+        return false;
+      }
+      if ((pred_bb->block_type == kDalvikByteCode) &&
+          ((pred_bb == bb) || (pred_bb->start_offset > bb->start_offset))) {
+        return true;
+      }
+    }
+  }
+
   void CountBranch(DexOffset target_offset) {
     if (target_offset <= current_offset_) {
       backward_branches_++;
@@ -929,6 +946,10 @@ class MIRGraph {
   bool EliminateClassInitChecksGate();
   bool EliminateClassInitChecks(BasicBlock* bb);
   void EliminateClassInitChecksEnd();
+  bool EliminateLocalMonitorsGate();
+  void EliminateLocalMonitors();
+  bool EliminateLoopRangeChecksGate();
+  void EliminateLoopRangeChecks();
   /*
    * Type inference handling helpers.  Because Dalvik's bytecode is not fully typed,
    * we have to do some work to figure out the sreg type.  For some operations it is
@@ -1093,6 +1114,9 @@ class MIRGraph {
   void SetConstantWide(int ssa_reg, int64_t value);
   int GetSSAUseCount(int s_reg);
   bool BasicBlockOpt(BasicBlock* bb);
+  // Whether the loop closed by the back edge from latch to head is a counted loop whose
+  // iterations run few enough instructions in all to leave out its suspend check.
+  bool IsSuspendCheckFreeLoop(BasicBlock* latch, BasicBlock* head);
   bool BuildExtendedBBList(struct BasicBlock* bb);
   bool FillDefBlockMatrix(BasicBlock* bb);
   void InitializeDominationInfo(BasicBlock* bb);
@@ -1103,6 +1127,18 @@ class MIRGraph {
   bool ComputeDominanceFrontier(BasicBlock* bb);
 
   void CountChecks(BasicBlock* bb);
+  // Whether bb is only entered on the way to an explicit throw.
+  bool LeadsToThrow(BasicBlock* bb);
+  // Swaps the taken and fall-through successors of bb, inverting its if-cc.
+  void InvertConditionalBranch(BasicBlock* bb);
+  // Static guess of whether the taken successor of the conditional branch ending bb is more
+  // likely than its fall-through.
+  bool IsTakenBranchLikely(BasicBlock* bb);
+  // Inlines a virtual call to a method without overrides behind a kMirOpCheckVirtualTarget,
+  // splitting bb to keep the regular invoke for other targets.
+  bool InlineGuardedVirtualCall(BasicBlock* bb, MIR* invoke);
+  // Logs the target of a virtual call dispatching mostly to one method in the call site profile.
+  void ReportProfiledCallSite(MIR* mir);
   void AnalyzeBlock(BasicBlock* bb, struct MethodStats* stats);
   bool ComputeSkipCompilation(struct MethodStats* stats, bool skip_default);
 
@@ -1164,6 +1200,9 @@ class MIRGraph {
   static const uint64_t oat_data_flow_attributes_[kMirOpLast];
 
   friend class ClassInitCheckEliminationTest;
+  friend class ConstantPropagationTest;
+  friend class LocalMonitorEliminationTest;
+  friend class LoopRangeCheckEliminationTest;
   friend class LocalValueNumberingTest;
 };
 
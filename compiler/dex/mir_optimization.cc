@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
 #include "compiler_internals.h"
 #include "local_value_numbering.h"
 #include "dataflow_iterator-inl.h"
@@ -35,10 +39,115 @@ void MIRGraph::SetConstant(int32_t ssa_reg, int value) {
 
 void MIRGraph::SetConstantWide(int ssa_reg, int64_t value) {
   is_constant_v_->SetBit(ssa_reg);
+  is_constant_v_->SetBit(ssa_reg + 1);
   constant_values_[ssa_reg] = Low32Bits(value);
   constant_values_[ssa_reg + 1] = High32Bits(value);
 }
 
+// Evaluates a 32-bit integer operation on constant operands the way the VM would, returns false
+// for opcodes that aren't folded or would throw.
+static bool FoldIntOperation(Instruction::Code opcode, int32_t a, int32_t b, int32_t* result) {
+  const uint32_t ua = static_cast<uint32_t>(a);
+  const uint32_t ub = static_cast<uint32_t>(b);
+  switch (opcode) {
+    case Instruction::NEG_INT:
+      *result = static_cast<int32_t>(0u - ua);
+      break;
+    case Instruction::NOT_INT:
+      *result = ~a;
+      break;
+    case Instruction::INT_TO_BYTE:
+      *result = static_cast<int8_t>(a);
+      break;
+    case Instruction::INT_TO_CHAR:
+      *result = static_cast<uint16_t>(a);
+      break;
+    case Instruction::INT_TO_SHORT:
+      *result = static_cast<int16_t>(a);
+      break;
+    case Instruction::ADD_INT:
+    case Instruction::ADD_INT_2ADDR:
+    case Instruction::ADD_INT_LIT16:
+    case Instruction::ADD_INT_LIT8:
+      *result = static_cast<int32_t>(ua + ub);
+      break;
+    case Instruction::SUB_INT:
+    case Instruction::SUB_INT_2ADDR:
+      *result = static_cast<int32_t>(ua - ub);
+      break;
+    case Instruction::RSUB_INT:
+    case Instruction::RSUB_INT_LIT8:
+      *result = static_cast<int32_t>(ub - ua);
+      break;
+    case Instruction::MUL_INT:
+    case Instruction::MUL_INT_2ADDR:
+    case Instruction::MUL_INT_LIT16:
+    case Instruction::MUL_INT_LIT8:
+      *result = static_cast<int32_t>(ua * ub);
+      break;
+    case Instruction::DIV_INT:
+    case Instruction::DIV_INT_2ADDR:
+    case Instruction::DIV_INT_LIT16:
+    case Instruction::DIV_INT_LIT8:
+      if (b == 0) {
+        return false;
+      }
+      // Division of INT_MIN by -1 overflows to INT_MIN.
+      *result = (b == -1) ? static_cast<int32_t>(0u - ua) : a / b;
+      break;
+    case Instruction::REM_INT:
+    case Instruction::REM_INT_2ADDR:
+    case Instruction::REM_INT_LIT16:
+    case Instruction::REM_INT_LIT8:
+      if (b == 0) {
+        return false;
+      }
+      *result = (b == -1) ? 0 : a % b;
+      break;
+    case Instruction::AND_INT:
+    case Instruction::AND_INT_2ADDR:
+    case Instruction::AND_INT_LIT16:
+    case Instruction::AND_INT_LIT8:
+      *result = a & b;
+      break;
+    case Instruction::OR_INT:
+    case Instruction::OR_INT_2ADDR:
+    case Instruction::OR_INT_LIT16:
+    case Instruction::OR_INT_LIT8:
+      *result = a | b;
+      break;
+    case Instruction::XOR_INT:
+    case Instruction::XOR_INT_2ADDR:
+    case Instruction::XOR_INT_LIT16:
+    case Instruction::XOR_INT_LIT8:
+      *result = a ^ b;
+      break;
+    case Instruction::SHL_INT:
+    case Instruction::SHL_INT_2ADDR:
+    case Instruction::SHL_INT_LIT8:
+      *result = static_cast<int32_t>(ua << (ub & 0x1f));
+      break;
+    case Instruction::SHR_INT:
+    case Instruction::SHR_INT_2ADDR:
+    case Instruction::SHR_INT_LIT8:
+      *result = a >> (ub & 0x1f);
+      break;
+    case Instruction::USHR_INT:
+    case Instruction::USHR_INT_2ADDR:
+    case Instruction::USHR_INT_LIT8:
+      *result = static_cast<int32_t>(ua >> (ub & 0x1f));
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+/*
+ * Propagate constants through the SSA graph. Blocks are visited in pre-order DFS so that defs
+ * are normally seen before their uses. Phi operands coming in over back edges haven't been
+ * visited yet and are conservatively treated as non-constant.
+ */
 void MIRGraph::DoConstantPropagation(BasicBlock* bb) {
   MIR* mir;
 
@@ -54,6 +163,24 @@ void MIRGraph::DoConstantPropagation(BasicBlock* bb) {
 
     if (!(df_attributes & DF_HAS_DEFS)) continue;
 
+    if (static_cast<int>(d_insn->opcode) == kMirOpPhi) {
+      // A phi is constant if all of its operands are the same constant. Wide values have a phi
+      // per half, RemapRegLocations() drops pairs where only one half is constant.
+      int num_uses = mir->ssa_rep->num_uses;
+      int i;
+      for (i = 0; i < num_uses; i++) {
+        int use = mir->ssa_rep->uses[i];
+        if (!is_constant_v_->IsBitSet(use) ||
+            constant_values_[use] != constant_values_[mir->ssa_rep->uses[0]]) {
+          break;
+        }
+      }
+      if (num_uses != 0 && i == num_uses) {
+        SetConstant(mir->ssa_rep->defs[0], constant_values_[mir->ssa_rep->uses[0]]);
+      }
+      continue;
+    }
+
     /* Handle instructions that set up constants directly */
     if (df_attributes & DF_SETS_CONST) {
       if (df_attributes & DF_DA) {
@@ -95,9 +222,25 @@ void MIRGraph::DoConstantPropagation(BasicBlock* bb) {
           SetConstant(mir->ssa_rep->defs[1], constant_values_[mir->ssa_rep->uses[1]]);
         }
       }
+    } else if (mir->ssa_rep->num_defs == 1 && !(df_attributes & (DF_A_WIDE | DF_FP_A)) &&
+               mir->ssa_rep->num_uses != 0 && mir->ssa_rep->num_uses <= 2) {
+      /* Fold integer arithmetic on constant operands */
+      int i;
+      for (i = 0; i < mir->ssa_rep->num_uses; i++) {
+        if (!is_constant_v_->IsBitSet(mir->ssa_rep->uses[i])) break;
+      }
+      if (i == mir->ssa_rep->num_uses) {
+        int32_t a = constant_values_[mir->ssa_rep->uses[0]];
+        // The second operand is either the other register or the literal of a *_LIT8/*_LIT16.
+        int32_t b = (mir->ssa_rep->num_uses == 2) ? constant_values_[mir->ssa_rep->uses[1]]
+                                                   : static_cast<int32_t>(d_insn->vC);
+        int32_t result;
+        if (FoldIntOperation(d_insn->opcode, a, b, &result)) {
+          SetConstant(mir->ssa_rep->defs[0], result);
+        }
+      }
     }
   }
-  /* TODO: implement code to handle arithmetic operations */
 }
 
 /* Advance to next strictly dominated MIR node in an extended basic block */
@@ -224,6 +367,36 @@ COMPILE_ASSERT(ConditionCodeForIfCcZ(Instruction::IF_GEZ) == kCondGe, check_if_g
 COMPILE_ASSERT(ConditionCodeForIfCcZ(Instruction::IF_GTZ) == kCondGt, check_if_gtz_ccode);
 COMPILE_ASSERT(ConditionCodeForIfCcZ(Instruction::IF_LEZ) == kCondLe, check_if_lez_ccode);
 
+COMPILE_ASSERT(arraysize(kIfCcZConditionCodes) == Instruction::IF_LE - Instruction::IF_EQ + 1,
+               if_cc_ccodes_size1);
+
+static ConditionCode ConditionCodeForIfCc(Instruction::Code opcode) {
+  return IsInstructionIfCcZ(opcode) ? ConditionCodeForIfCcZ(opcode)
+                                    : kIfCcZConditionCodes[opcode - Instruction::IF_EQ];
+}
+
+static ConditionCode NegateConditionCode(ConditionCode ccode) {
+  switch (ccode) {
+    case kCondEq: return kCondNe;
+    case kCondNe: return kCondEq;
+    case kCondLt: return kCondGe;
+    case kCondGe: return kCondLt;
+    case kCondGt: return kCondLe;
+    case kCondLe: return kCondGt;
+    default: LOG(FATAL) << "Unexpected ccode " << ccode; return ccode;
+  }
+}
+
+static ConditionCode SwapConditionCodeOperands(ConditionCode ccode) {
+  switch (ccode) {
+    case kCondLt: return kCondGt;
+    case kCondGt: return kCondLt;
+    case kCondLe: return kCondGe;
+    case kCondGe: return kCondLe;
+    default: return ccode;
+  }
+}
+
 int MIRGraph::GetSSAUseCount(int s_reg) {
   return raw_use_counts_.Get(s_reg);
 }
@@ -313,6 +486,136 @@ CompilerTemp* MIRGraph::GetNewCompilerTemp(CompilerTempType ct_type, bool wide)
   return compiler_temp;
 }
 
+// The most dex instructions a loop without suspend checks may run.
+static constexpr int64_t kSuspendCheckFreeLoopBudget = 4096;
+
+bool MIRGraph::IsSuspendCheckFreeLoop(BasicBlock* latch, BasicBlock* head) {
+  // Only loops entered from a single block and closed by this back edge alone.
+  if ((Predecessors(head) != 2) || (latch->dominators == nullptr) ||
+      !latch->dominators->IsBitSet(head->id)) {
+    return false;
+  }
+  // Collect the natural loop of the back edge, walking up from the latch to the head.
+  ArenaBitVector* in_loop = new (arena_) ArenaBitVector(arena_, GetNumBlocks(), false);
+  std::vector<BasicBlock*> loop_blocks;
+  in_loop->SetBit(head->id);
+  loop_blocks.push_back(head);
+  if (latch != head) {
+    in_loop->SetBit(latch->id);
+    loop_blocks.push_back(latch);
+  }
+  for (size_t i = 1; i < loop_blocks.size(); ++i) {
+    GrowableArray<BasicBlockId>::Iterator iter(loop_blocks[i]->predecessors);
+    for (BasicBlock* pred_bb = GetBasicBlock(iter.Next()); pred_bb != nullptr;
+         pred_bb = GetBasicBlock(iter.Next())) {
+      if (!in_loop->IsBitSet(pred_bb->id)) {
+        in_loop->SetBit(pred_bb->id);
+        loop_blocks.push_back(pred_bb);
+      }
+    }
+  }
+  // Without calls and inner loops, an iteration takes a time bounded by its instructions.
+  size_t num_insns = 0;
+  for (BasicBlock* bb : loop_blocks) {
+    if ((bb->block_type != kDalvikByteCode) || (bb->dominators == nullptr) ||
+        !bb->dominators->IsBitSet(head->id) || ((bb != head) && IsLoopHead(bb))) {
+      return false;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != nullptr; mir = mir->next) {
+      int opcode = mir->dalvikInsn.opcode;
+      if ((opcode < kMirOpFirst) &&
+          ((Instruction::FlagsOf(static_cast<Instruction::Code>(opcode)) &
+            Instruction::kInvoke) != 0)) {
+        return false;
+      }
+      ++num_insns;
+    }
+  }
+  auto find_def = [&loop_blocks](int s_reg) -> MIR* {
+    for (BasicBlock* bb : loop_blocks) {
+      for (MIR* mir = bb->first_mir_insn; mir != nullptr; mir = mir->next) {
+        if ((mir->ssa_rep != nullptr) && (mir->ssa_rep->num_defs != 0) &&
+            (mir->ssa_rep->defs[0] == s_reg)) {
+          return mir;
+        }
+      }
+    }
+    return nullptr;
+  };
+  // The exit test of a counted loop runs in every iteration, so it is in the head or the latch.
+  for (BasicBlock* test_bb : { head, latch }) {
+    if (!test_bb->conditional_branch ||
+        (in_loop->IsBitSet(test_bb->taken) == in_loop->IsBitSet(test_bb->fall_through))) {
+      continue;
+    }
+    // The loop goes on while "uses[iv_index] ccode limit".
+    MIR* test = test_bb->last_mir_insn;
+    Instruction::Code opcode = test->dalvikInsn.opcode;
+    ConditionCode ccode = ConditionCodeForIfCc(opcode);
+    if (!in_loop->IsBitSet(test_bb->taken)) {
+      ccode = NegateConditionCode(ccode);
+    }
+    int iv_index = 0;
+    int64_t limit = 0;
+    if (IsInstructionIfCcZ(opcode)) {
+      limit = 0;
+    } else if (IsConst(test->ssa_rep->uses[1])) {
+      limit = ConstantValue(test->ssa_rep->uses[1]);
+    } else if (IsConst(test->ssa_rep->uses[0])) {
+      limit = ConstantValue(test->ssa_rep->uses[0]);
+      iv_index = 1;
+      ccode = SwapConditionCodeOperands(ccode);
+    } else {
+      continue;
+    }
+    // The induction variable is a phi of the head, tested either before or after its increment.
+    auto find_head_phi = [head](int s_reg) -> MIR* {
+      for (MIR* mir = head->first_mir_insn; mir != nullptr; mir = mir->next) {
+        if ((static_cast<int>(mir->dalvikInsn.opcode) == kMirOpPhi) &&
+            (mir->ssa_rep->defs[0] == s_reg)) {
+          return mir;
+        }
+      }
+      return nullptr;
+    };
+    MIR* phi = find_head_phi(test->ssa_rep->uses[iv_index]);
+    MIR* iv_def = phi;
+    if (phi == nullptr) {
+      iv_def = find_def(test->ssa_rep->uses[iv_index]);
+      if ((iv_def != nullptr) && (iv_def->ssa_rep->num_uses != 0)) {
+        phi = find_head_phi(iv_def->ssa_rep->uses[0]);
+      }
+    }
+    if ((phi == nullptr) || (phi->ssa_rep->num_uses != 2)) {
+      continue;
+    }
+    int back_index = in_loop->IsBitSet(phi->meta.phi_incoming[0]) ? 0 : 1;
+    MIR* increment = find_def(phi->ssa_rep->uses[back_index]);
+    int init_s_reg = phi->ssa_rep->uses[1 - back_index];
+    if ((increment == nullptr) || in_loop->IsBitSet(phi->meta.phi_incoming[1 - back_index]) ||
+        ((increment->dalvikInsn.opcode != Instruction::ADD_INT_LIT8) &&
+         (increment->dalvikInsn.opcode != Instruction::ADD_INT_LIT16)) ||
+        (increment->ssa_rep->uses[0] != phi->ssa_rep->defs[0]) ||
+        ((iv_def != phi) && (iv_def != increment)) || !IsConst(init_s_reg)) {
+      continue;
+    }
+    int64_t stride = static_cast<int32_t>(increment->dalvikInsn.vC);
+    int64_t first = ConstantValue(init_s_reg) + ((iv_def == increment) ? stride : 0);
+    // The variable must move towards the limit and stay clear of overflow.
+    bool upwards = (stride > 0) && ((ccode == kCondLt) || (ccode == kCondLe));
+    bool downwards = (stride < 0) && ((ccode == kCondGt) || (ccode == kCondGe));
+    int64_t low = std::min(first, limit) - std::abs(stride);
+    int64_t high = std::max(first, limit) + std::abs(stride);
+    if ((!upwards && !downwards) || (low < std::numeric_limits<int32_t>::min()) ||
+        (high > std::numeric_limits<int32_t>::max())) {
+      continue;
+    }
+    int64_t trip_count = std::abs(limit - first) / std::abs(stride) + 2;
+    return trip_count * static_cast<int64_t>(num_insns) <= kSuspendCheckFreeLoopBudget;
+  }
+  return false;
+}
+
 /* Do some MIR-level extended basic block optimizations */
 bool MIRGraph::BasicBlockOpt(BasicBlock* bb) {
   if (bb->block_type == kDead) {
@@ -407,6 +710,15 @@ bool MIRGraph::BasicBlockOpt(BasicBlock* bb) {
               LOG(INFO) << "Suppressed suspend check on branch to return at 0x" << std::hex
                         << mir->offset;
             }
+          } else if (IsBackwardsBranch(bb) &&
+                     IsSuspendCheckFreeLoop(bb, GetBasicBlock(IsBackedge(bb, bb->taken) ?
+                                                              bb->taken : bb->fall_through))) {
+            // A short counted loop ends soon, the checks after it keep the latency bounded.
+            mir->optimization_flags |= MIR_IGNORE_SUSPEND_CHECK;
+            if (cu_->verbose) {
+              LOG(INFO) << "Suppressed suspend check on counted loop at 0x" << std::hex
+                        << mir->offset;
+            }
           }
           break;
         default:
@@ -585,9 +897,80 @@ void MIRGraph::CountChecks(struct BasicBlock* bb) {
   }
 }
 
+void MIRGraph::InvertConditionalBranch(BasicBlock* bb) {
+  DCHECK(bb->conditional_branch);
+  Instruction::Code opcode = bb->last_mir_insn->dalvikInsn.opcode;
+  switch (opcode) {
+    case Instruction::IF_EQ: opcode = Instruction::IF_NE; break;
+    case Instruction::IF_NE: opcode = Instruction::IF_EQ; break;
+    case Instruction::IF_LT: opcode = Instruction::IF_GE; break;
+    case Instruction::IF_GE: opcode = Instruction::IF_LT; break;
+    case Instruction::IF_GT: opcode = Instruction::IF_LE; break;
+    case Instruction::IF_LE: opcode = Instruction::IF_GT; break;
+    case Instruction::IF_EQZ: opcode = Instruction::IF_NEZ; break;
+    case Instruction::IF_NEZ: opcode = Instruction::IF_EQZ; break;
+    case Instruction::IF_LTZ: opcode = Instruction::IF_GEZ; break;
+    case Instruction::IF_GEZ: opcode = Instruction::IF_LTZ; break;
+    case Instruction::IF_GTZ: opcode = Instruction::IF_LEZ; break;
+    case Instruction::IF_LEZ: opcode = Instruction::IF_GTZ; break;
+    default: LOG(FATAL) << "Unexpected opcode " << opcode;
+  }
+  bb->last_mir_insn->dalvikInsn.opcode = opcode;
+  BasicBlockId t_bb = bb->taken;
+  bb->taken = bb->fall_through;
+  bb->fall_through = t_bb;
+}
+
+bool MIRGraph::LeadsToThrow(BasicBlock* bb) {
+  // The reverse of the walk in LayoutBlocks(), a cycle would need a block with two predecessors.
+  while ((bb != nullptr) && (bb->block_type == kDalvikByteCode) && (Predecessors(bb) == 1) &&
+         !bb->conditional_branch) {
+    if (bb->explicit_throw) {
+      return true;
+    }
+    bb = GetBasicBlock((bb->fall_through != NullBasicBlockId) ? bb->fall_through : bb->taken);
+  }
+  return false;
+}
+
+bool MIRGraph::IsTakenBranchLikely(BasicBlock* bb) {
+  // Loop branch heuristic: a backward branch closes a loop and is usually taken. Keeping it
+  // as the taken branch leaves the loop body laid out straight from the head to the back edge.
+  if (IsBackedge(bb, bb->taken)) {
+    return false;
+  }
+  // Opcode and pointer heuristics: values are rarely negative and references rarely null,
+  // so branches taken on x >= 0, x > 0 and x != 0 are usually taken.
+  switch (bb->last_mir_insn->dalvikInsn.opcode) {
+    case Instruction::IF_NEZ:
+    case Instruction::IF_GEZ:
+    case Instruction::IF_GTZ:
+      return true;
+    case Instruction::IF_EQZ:
+    case Instruction::IF_LTZ:
+    case Instruction::IF_LEZ:
+      return false;
+    default:
+      break;
+  }
+  // Return heuristic: an early return is less likely than going on with the method.
+  BasicBlock* fall_through = GetBasicBlock(bb->fall_through);
+  BasicBlock* taken = GetBasicBlock(bb->taken);
+  return (fall_through != nullptr) && fall_through->terminated_by_return &&
+      (taken != nullptr) && !taken->terminated_by_return;
+}
+
 /* Try to make common case the fallthrough path */
 bool MIRGraph::LayoutBlocks(BasicBlock* bb) {
-  // TODO: For now, just looking for direct throws.  Consider generalizing for profile feedback
+  // TODO: The common case is guessed with static heuristics, consider profile feedback.
+  if (bb->conditional_branch) {
+    // Paths to a throw are left to the walk from the throwing block below.
+    if ((bb->taken != bb->fall_through) && !LeadsToThrow(GetBasicBlock(bb->taken)) &&
+        !LeadsToThrow(GetBasicBlock(bb->fall_through)) && IsTakenBranchLikely(bb)) {
+      InvertConditionalBranch(bb);
+    }
+    return false;
+  }
   if (!bb->explicit_throw) {
     return false;
   }
@@ -597,34 +980,15 @@ bool MIRGraph::LayoutBlocks(BasicBlock* bb) {
     if ((walker->block_type == kEntryBlock) || (Predecessors(walker) != 1)) {
       break;
     }
+    // Everything up to the branch is only run to throw, move it out of the hot code.
+    walker->cold = true;
     BasicBlock* prev = GetBasicBlock(walker->predecessors->Get(0));
     if (prev->conditional_branch) {
       if (GetBasicBlock(prev->fall_through) == walker) {
-        // Already done - return
-        break;
+        // Got one.  Flip it and exit
+        InvertConditionalBranch(prev);
       }
       DCHECK_EQ(walker, GetBasicBlock(prev->taken));
-      // Got one.  Flip it and exit
-      Instruction::Code opcode = prev->last_mir_insn->dalvikInsn.opcode;
-      switch (opcode) {
-        case Instruction::IF_EQ: opcode = Instruction::IF_NE; break;
-        case Instruction::IF_NE: opcode = Instruction::IF_EQ; break;
-        case Instruction::IF_LT: opcode = Instruction::IF_GE; break;
-        case Instruction::IF_GE: opcode = Instruction::IF_LT; break;
-        case Instruction::IF_GT: opcode = Instruction::IF_LE; break;
-        case Instruction::IF_LE: opcode = Instruction::IF_GT; break;
-        case Instruction::IF_EQZ: opcode = Instruction::IF_NEZ; break;
-        case Instruction::IF_NEZ: opcode = Instruction::IF_EQZ; break;
-        case Instruction::IF_LTZ: opcode = Instruction::IF_GEZ; break;
-        case Instruction::IF_GEZ: opcode = Instruction::IF_LTZ; break;
-        case Instruction::IF_GTZ: opcode = Instruction::IF_LEZ; break;
-        case Instruction::IF_LEZ: opcode = Instruction::IF_GTZ; break;
-        default: LOG(FATAL) << "Unexpected opcode " << opcode;
-      }
-      prev->last_mir_insn->dalvikInsn.opcode = opcode;
-      BasicBlockId t_bb = prev->taken;
-      prev->taken = prev->fall_through;
-      prev->fall_through = t_bb;
       break;
     }
     walker = prev;
@@ -1129,6 +1493,266 @@ void MIRGraph::EliminateClassInitChecksEnd() {
   temp_scoped_alloc_.reset();
 }
 
+// Returns whether a use of an allocation by the MIR leaves the allocation local to the method.
+static bool IsLocalUse(const DexFile* dex_file, MIR* mir, int use_index) {
+  const Instruction::Code opcode = mir->dalvikInsn.opcode;
+  switch (opcode) {
+    case Instruction::MONITOR_ENTER:
+    case Instruction::MONITOR_EXIT:
+    case Instruction::MOVE_OBJECT:
+    case Instruction::MOVE_OBJECT_FROM16:
+    case Instruction::MOVE_OBJECT_16:
+    case Instruction::CHECK_CAST:
+    case Instruction::INSTANCE_OF:
+      return true;
+    case Instruction::IGET:
+    case Instruction::IGET_WIDE:
+    case Instruction::IGET_OBJECT:
+    case Instruction::IGET_BOOLEAN:
+    case Instruction::IGET_BYTE:
+    case Instruction::IGET_CHAR:
+    case Instruction::IGET_SHORT:
+      return true;
+    case Instruction::IPUT:
+    case Instruction::IPUT_WIDE:
+    case Instruction::IPUT_OBJECT:
+    case Instruction::IPUT_BOOLEAN:
+    case Instruction::IPUT_BYTE:
+    case Instruction::IPUT_CHAR:
+    case Instruction::IPUT_SHORT:
+      // The object is the last use, storing the allocation itself publishes it.
+      return use_index == mir->ssa_rep->num_uses - 1;
+    case Instruction::INVOKE_DIRECT:
+    case Instruction::INVOKE_DIRECT_RANGE: {
+      if (use_index != 0) {
+        return false;
+      }
+      // The inlined bodies are in the MIRs that follow, as is the constructor of Object.
+      if ((mir->optimization_flags & MIR_INLINED) != 0) {
+        return true;
+      }
+      const DexFile::MethodId& method_id = dex_file->GetMethodId(mir->dalvikInsn.vB);
+      return strcmp(dex_file->GetMethodName(method_id), "<init>") == 0 &&
+          strcmp(dex_file->GetMethodDeclaringClassDescriptor(method_id),
+                 "Ljava/lang/Object;") == 0;
+    }
+    default:
+      return false;
+  }
+}
+
+bool MIRGraph::EliminateLocalMonitorsGate() {
+  // With the exception edges suppressed the monitor instructions are split around a check.
+  return (cu_->disable_opt & (1 << kLocalMonitorElimination)) == 0 &&
+      (cu_->disable_opt & (1 << kSuppressExceptionEdges)) == 0;
+}
+
+/*
+ * Removes the monitor-enter and monitor-exit of objects allocated in the method that no other
+ * thread can see: the allocation is only copied, locked, used as the object of field accesses,
+ * type checked or passed to the constructor of Object or to an inlined method. Such a lock is
+ * never contended and the JMM allows eliding it.
+ */
+void MIRGraph::EliminateLocalMonitors() {
+  ScopedArenaAllocator allocator(&cu_->arena_stack);
+  const int num_ssa_regs = GetNumSSARegs();
+  // The allocation that each SSA register holds, or -1.
+  ScopedArenaVector<int32_t> allocation_of(num_ssa_regs, -1, allocator.Adapter());
+  int32_t num_allocations = 0;
+  bool has_monitors = false;
+  AllNodesIterator iter(this);
+  for (BasicBlock* bb = iter.Next(); bb != nullptr; bb = iter.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != nullptr; mir = mir->next) {
+      const Instruction::Code opcode = mir->dalvikInsn.opcode;
+      if (opcode == Instruction::NEW_INSTANCE && mir->ssa_rep != nullptr) {
+        allocation_of[mir->ssa_rep->defs[0]] = num_allocations;
+        ++num_allocations;
+      } else if (opcode == Instruction::MONITOR_ENTER) {
+        has_monitors = true;
+      }
+    }
+  }
+  if (num_allocations == 0 || !has_monitors) {
+    return;
+  }
+
+  // Follow the copies, which may come in any block order.
+  bool change;
+  do {
+    change = false;
+    AllNodesIterator copy_iter(this);
+    for (BasicBlock* bb = copy_iter.Next(); bb != nullptr; bb = copy_iter.Next()) {
+      for (MIR* mir = bb->first_mir_insn; mir != nullptr; mir = mir->next) {
+        const Instruction::Code opcode = mir->dalvikInsn.opcode;
+        if ((opcode == Instruction::MOVE_OBJECT || opcode == Instruction::MOVE_OBJECT_FROM16 ||
+             opcode == Instruction::MOVE_OBJECT_16) && mir->ssa_rep != nullptr) {
+          int32_t allocation = allocation_of[mir->ssa_rep->uses[0]];
+          if (allocation != -1 && allocation_of[mir->ssa_rep->defs[0]] != allocation) {
+            allocation_of[mir->ssa_rep->defs[0]] = allocation;
+            change = true;
+          }
+        }
+      }
+    }
+  } while (change);
+
+  ScopedArenaVector<bool> escapes(num_allocations, false, allocator.Adapter());
+  AllNodesIterator use_iter(this);
+  for (BasicBlock* bb = use_iter.Next(); bb != nullptr; bb = use_iter.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != nullptr; mir = mir->next) {
+      if (mir->ssa_rep == nullptr) {
+        continue;
+      }
+      for (int i = 0; i != mir->ssa_rep->num_uses; ++i) {
+        int32_t allocation = allocation_of[mir->ssa_rep->uses[i]];
+        if (allocation != -1 && !IsLocalUse(cu_->dex_file, mir, i)) {
+          escapes[allocation] = true;
+        }
+      }
+    }
+  }
+
+  AllNodesIterator monitor_iter(this);
+  for (BasicBlock* bb = monitor_iter.Next(); bb != nullptr; bb = monitor_iter.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != nullptr; mir = mir->next) {
+      const Instruction::Code opcode = mir->dalvikInsn.opcode;
+      if ((opcode == Instruction::MONITOR_ENTER || opcode == Instruction::MONITOR_EXIT) &&
+          mir->ssa_rep != nullptr) {
+        int32_t allocation = allocation_of[mir->ssa_rep->uses[0]];
+        if (allocation != -1 && !escapes[allocation]) {
+          // The allocation is never null, the monitor-enter has nothing left to check.
+          mir->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpNop);
+        }
+      }
+    }
+  }
+}
+
+// Whether every path to bb goes through dominator.
+static bool IsDominatedBy(BasicBlock* bb, BasicBlock* dominator) {
+  return (bb->dominators != nullptr) && bb->dominators->IsBitSet(dominator->id);
+}
+
+bool MIRGraph::EliminateLoopRangeChecksGate() {
+  return (cu_->disable_opt & (1 << kLoopRangeCheckElimination)) == 0;
+}
+
+/*
+ * Removes the range checks of the array accesses indexed by the induction variable of a loop
+ *
+ *   for (int i = c; i < array.length; i++), with c >= 0 a constant,
+ *
+ * whose head tests the variable, a phi, against the array-length of the accessed array. Every
+ * path to a block dominated by the successor which the test only enters while "i < length" went
+ * through the test of the last value of the phi, so the accesses there are within the bounds.
+ */
+void MIRGraph::EliminateLoopRangeChecks() {
+  ScopedArenaAllocator allocator(&cu_->arena_stack);
+  const int num_ssa_regs = GetNumSSARegs();
+  // The array whose length each SSA register holds, or -1, and the definition of each register
+  // with its block.
+  ScopedArenaVector<int32_t> array_of_length(num_ssa_regs, -1, allocator.Adapter());
+  ScopedArenaVector<MIR*> def_of(num_ssa_regs, nullptr, allocator.Adapter());
+  ScopedArenaVector<BasicBlock*> def_block_of(num_ssa_regs, nullptr, allocator.Adapter());
+  bool has_array_accesses = false;
+  AllNodesIterator iter(this);
+  for (BasicBlock* bb = iter.Next(); bb != nullptr; bb = iter.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != nullptr; mir = mir->next) {
+      if (mir->ssa_rep == nullptr) {
+        continue;
+      }
+      if (mir->ssa_rep->num_defs != 0) {
+        def_of[mir->ssa_rep->defs[0]] = mir;
+        def_block_of[mir->ssa_rep->defs[0]] = bb;
+      }
+      const int opcode = mir->dalvikInsn.opcode;
+      if (opcode == Instruction::ARRAY_LENGTH) {
+        array_of_length[mir->ssa_rep->defs[0]] = mir->ssa_rep->uses[0];
+      } else if (Instruction::AGET <= opcode && opcode <= Instruction::APUT_SHORT) {
+        has_array_accesses = true;
+      }
+    }
+  }
+  if (!has_array_accesses) {
+    return;
+  }
+
+  AllNodesIterator head_iter(this);
+  for (BasicBlock* head = head_iter.Next(); head != nullptr; head = head_iter.Next()) {
+    MIR* test = head->last_mir_insn;
+    if ((head->block_type != kDalvikByteCode) || !head->conditional_branch ||
+        (test == nullptr) || (test->ssa_rep == nullptr) ||
+        (test->dalvikInsn.opcode < Instruction::IF_EQ) ||
+        (test->dalvikInsn.opcode > Instruction::IF_LE)) {
+      continue;
+    }
+    // The test jumps to taken if "uses[0] ccode uses[1]", normalize it to "phi ccode length".
+    ConditionCode ccode = ConditionCodeForIfCc(test->dalvikInsn.opcode);
+    int phi_s_reg = test->ssa_rep->uses[0];
+    int length_s_reg = test->ssa_rep->uses[1];
+    if (array_of_length[length_s_reg] == -1) {
+      std::swap(phi_s_reg, length_s_reg);
+      ccode = SwapConditionCodeOperands(ccode);
+    }
+    const int32_t array_s_reg = array_of_length[length_s_reg];
+    MIR* phi = def_of[phi_s_reg];
+    if ((array_s_reg == -1) || (phi == nullptr) ||
+        (static_cast<int>(phi->dalvikInsn.opcode) != kMirOpPhi) ||
+        (def_block_of[phi_s_reg] != head)) {
+      continue;
+    }
+    // The successor entered only while "phi < length".
+    BasicBlock* body = nullptr;
+    if (ccode == kCondLt) {
+      body = GetBasicBlock(head->taken);
+    } else if (ccode == kCondGe) {
+      body = GetBasicBlock(head->fall_through);
+    }
+    if ((body == nullptr) || (Predecessors(body) != 1) || (body->dominators == nullptr)) {
+      continue;
+    }
+    // The phi is never negative: its inputs are non negative constants, or the phi plus one
+    // where "phi < length" holds, which can't overflow.
+    bool non_negative = true;
+    for (int i = 0; i != phi->ssa_rep->num_uses; ++i) {
+      const int input = phi->ssa_rep->uses[i];
+      if (IsConst(input)) {
+        non_negative &= (ConstantValue(input) >= 0);
+        continue;
+      }
+      MIR* increment = def_of[input];
+      non_negative &= (increment != nullptr) &&
+          ((increment->dalvikInsn.opcode == Instruction::ADD_INT_LIT8) ||
+           (increment->dalvikInsn.opcode == Instruction::ADD_INT_LIT16)) &&
+          (static_cast<int32_t>(increment->dalvikInsn.vC) == 1) &&
+          (increment->ssa_rep->uses[0] == phi_s_reg) &&
+          IsDominatedBy(def_block_of[input], body);
+    }
+    if (!non_negative) {
+      continue;
+    }
+    AllNodesIterator access_iter(this);
+    for (BasicBlock* bb = access_iter.Next(); bb != nullptr; bb = access_iter.Next()) {
+      if (!IsDominatedBy(bb, body)) {
+        continue;
+      }
+      for (MIR* mir = bb->first_mir_insn; mir != nullptr; mir = mir->next) {
+        const int opcode = mir->dalvikInsn.opcode;
+        if ((opcode < Instruction::AGET) || (opcode > Instruction::APUT_SHORT) ||
+            (mir->ssa_rep == nullptr)) {
+          continue;
+        }
+        int array_idx = (opcode == Instruction::APUT_WIDE) ? 2 :
+            ((opcode >= Instruction::APUT) ? 1 : 0);
+        if ((mir->ssa_rep->uses[array_idx] == array_s_reg) &&
+            (mir->ssa_rep->uses[array_idx + 1] == phi_s_reg)) {
+          mir->optimization_flags |= MIR_IGNORE_RANGE_CHECK;
+        }
+      }
+    }
+  }
+}
+
 void MIRGraph::ComputeInlineIFieldLoweringInfo(uint16_t field_idx, MIR* invoke, MIR* iget_or_iput) {
   uint32_t method_index = invoke->meta.method_lowering_info;
   if (temp_bit_vector_->IsBitSet(method_index)) {
@@ -1191,6 +1815,9 @@ void MIRGraph::InlineCalls(BasicBlock* bb) {
     if (!(Instruction::FlagsOf(mir->dalvikInsn.opcode) & Instruction::kInvoke)) {
       continue;
     }
+    if ((mir->optimization_flags & (MIR_INLINED | MIR_INLINED_PRED)) != 0) {
+      continue;
+    }
     const MirMethodLoweringInfo& method_info = GetMethodLoweringInfo(mir);
     if (!method_info.FastPath()) {
       continue;
@@ -1198,6 +1825,13 @@ void MIRGraph::InlineCalls(BasicBlock* bb) {
     InvokeType sharp_type = method_info.GetSharpType();
     if ((sharp_type != kDirect) &&
         (sharp_type != kStatic || method_info.NeedsClassInitialization())) {
+      if (sharp_type == kVirtual && InlineGuardedVirtualCall(bb, mir)) {
+        // The rest of the block moved to a new block, which is visited later.
+        return;
+      }
+      if (cu_->verbose && (sharp_type == kVirtual || sharp_type == kInterface)) {
+        ReportProfiledCallSite(mir);
+      }
       continue;
     }
     DCHECK(cu_->compiler_driver->GetMethodInlinerMap() != nullptr);
@@ -1214,6 +1848,164 @@ void MIRGraph::InlineCalls(BasicBlock* bb) {
   }
 }
 
+bool MIRGraph::InlineGuardedVirtualCall(BasicBlock* bb, MIR* invoke) {
+  // Only the 32-bit backends generate the guard.
+  if (cu_->instruction_set != kThumb2 && cu_->instruction_set != kX86 &&
+      cu_->instruction_set != kMips) {
+    return false;
+  }
+  Instruction::Code opcode = invoke->dalvikInsn.opcode;
+  if ((opcode != Instruction::INVOKE_VIRTUAL && opcode != Instruction::INVOKE_VIRTUAL_RANGE) ||
+      bb->successor_block_list_type != kNotUsed) {
+    return false;
+  }
+  const MirMethodLoweringInfo& method_info = GetMethodLoweringInfo(invoke);
+  MethodReference resolved(method_info.DeclaringDexFile(), method_info.DeclaringMethodIndex());
+  // The inlined field accesses are resolved in the dex file of the caller.
+  if (resolved.dex_file != cu_->dex_file ||
+      cu_->compiler_driver->MayBeOverridden(resolved)) {
+    return false;
+  }
+  DexFileMethodInliner* inliner =
+      cu_->compiler_driver->GetMethodInlinerMap()->GetMethodInliner(resolved.dex_file);
+  if (!inliner->IsSpecial(resolved.dex_method_index)) {
+    return false;
+  }
+  MIR* move_result = FindMoveResult(bb, invoke);
+  if (move_result != nullptr && move_result != invoke->next) {
+    return false;
+  }
+
+  // No loaded class overrides the resolved method but classes loaded at run time may, so
+  // the inlined body runs behind a guard on the dispatched method:
+  //   bb: ... kMirOpCheckVirtualTarget -> taken: slow_bb, fall_through: fast_bb
+  //   fast_bb: inlined body -> join_bb
+  //   slow_bb: invoke, move-result -> join_bb
+  //   join_bb: rest of bb
+  BasicBlock* fast_bb = CreateNewBB(kDalvikByteCode);
+  fast_bb->start_offset = invoke->offset;
+  fast_bb->nesting_depth = bb->nesting_depth;
+  fast_bb->use_lvn = bb->use_lvn;
+  MIR* fast_invoke = invoke->Copy(this);
+  // The guard does the null check.
+  fast_invoke->optimization_flags |= MIR_IGNORE_NULL_CHECK;
+  fast_bb->AppendMIR(fast_invoke);
+  if (move_result != nullptr) {
+    fast_bb->AppendMIR(move_result->Copy(this));
+  }
+  if (!inliner->GenInline(this, fast_bb, fast_invoke, resolved.dex_method_index)) {
+    fast_bb->Hide(cu_);
+    return false;
+  }
+
+  MIR* last_moved = (move_result != nullptr) ? move_result : invoke;
+  MIR* rest = last_moved->next;
+  MIR* rest_last = bb->last_mir_insn;
+  MIR* prev = nullptr;
+  for (MIR* mir = bb->first_mir_insn; mir != invoke; mir = mir->next) {
+    prev = mir;
+  }
+  if (prev == nullptr) {
+    bb->first_mir_insn = nullptr;
+    bb->last_mir_insn = nullptr;
+  } else {
+    prev->next = nullptr;
+    bb->last_mir_insn = prev;
+  }
+  last_moved->next = nullptr;
+
+  BasicBlock* slow_bb = CreateNewBB(kDalvikByteCode);
+  slow_bb->start_offset = invoke->offset;
+  slow_bb->nesting_depth = bb->nesting_depth;
+  slow_bb->use_lvn = bb->use_lvn;
+  // Don't guard the regular invoke again when visiting its block.
+  invoke->optimization_flags |= MIR_INLINED_PRED;
+  slow_bb->AppendMIRList(invoke, last_moved);
+  dex_pc_to_block_map_.Put(invoke->offset, slow_bb->id);
+
+  BasicBlock* join_bb;
+  if (rest != nullptr) {
+    join_bb = CreateNewBB(kDalvikByteCode);
+    join_bb->start_offset = rest->offset;
+    join_bb->nesting_depth = bb->nesting_depth;
+    join_bb->use_lvn = bb->use_lvn;
+    join_bb->AppendMIRList(rest, rest_last);
+    for (MIR* mir = rest; mir != nullptr; mir = mir->next) {
+      if (!IsPseudoMirOp(mir->dalvikInsn.opcode)) {
+        dex_pc_to_block_map_.Put(mir->offset, join_bb->id);
+      }
+    }
+    // The end of bb moves to the join block, with the successors.
+    join_bb->explicit_throw = bb->explicit_throw;
+    join_bb->conditional_branch = bb->conditional_branch;
+    join_bb->terminated_by_return = bb->terminated_by_return;
+    bb->explicit_throw = false;
+    bb->conditional_branch = false;
+    bb->terminated_by_return = false;
+    join_bb->taken = bb->taken;
+    join_bb->fall_through = bb->fall_through;
+    BasicBlock* bb_taken = GetBasicBlock(join_bb->taken);
+    if (bb_taken != nullptr) {
+      bb_taken->predecessors->Delete(bb->id);
+      bb_taken->predecessors->Insert(join_bb->id);
+    }
+    BasicBlock* bb_fall_through = GetBasicBlock(join_bb->fall_through);
+    if (bb_fall_through != nullptr) {
+      bb_fall_through->predecessors->Delete(bb->id);
+      bb_fall_through->predecessors->Insert(join_bb->id);
+    }
+  } else {
+    // The invoke ended the block, there is nothing to move.
+    DCHECK_EQ(bb->taken, NullBasicBlockId);
+    join_bb = GetBasicBlock(bb->fall_through);
+    DCHECK(join_bb != nullptr);
+    join_bb->predecessors->Delete(bb->id);
+  }
+  fast_bb->fall_through = join_bb->id;
+  join_bb->predecessors->Insert(fast_bb->id);
+  slow_bb->fall_through = join_bb->id;
+  join_bb->predecessors->Insert(slow_bb->id);
+
+  MIR* guard = NewMIR();
+  guard->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpCheckVirtualTarget);
+  guard->dalvikInsn.vA = (opcode == Instruction::INVOKE_VIRTUAL_RANGE) ? invoke->dalvikInsn.vC
+                                                                      : invoke->dalvikInsn.arg[0];
+  guard->dalvikInsn.vB = invoke->dalvikInsn.vB;
+  guard->offset = invoke->offset;
+  guard->meta.method_lowering_info = invoke->meta.method_lowering_info;
+  bb->AppendMIR(guard);
+  bb->taken = slow_bb->id;
+  bb->fall_through = fast_bb->id;
+  slow_bb->predecessors->Insert(bb->id);
+  fast_bb->predecessors->Insert(bb->id);
+
+  if (cu_->verbose) {
+    LOG(INFO) << "In \"" << PrettyMethod(cu_->method_idx, *cu_->dex_file)
+        << "\" @0x" << std::hex << invoke->offset << " inlined guarded virtual call to \""
+        << PrettyMethod(resolved.dex_method_index, *resolved.dex_file) << "\"";
+  }
+  return true;
+}
+
+void MIRGraph::ReportProfiledCallSite(MIR* mir) {
+  // The guarded inlining only covers the methods no loaded class overrides. Report the
+  // dominant targets of the other call sites.
+  static constexpr uint32_t kMinCallSiteSamples = 16;
+  static constexpr double kMinDominantTargetPercent = 90.0;
+  const CallSiteProfile& profile = cu_->compiler_driver->GetCallSiteProfile();
+  if (profile.NumCallSites() == 0) {
+    return;
+  }
+  const CallSiteProfile::Target* target =
+      profile.GetDominantTarget(PrettyMethod(cu_->method_idx, *cu_->dex_file), mir->offset,
+                                kMinCallSiteSamples, kMinDominantTargetPercent);
+  if (target != nullptr) {
+    LOG(INFO) << "In \"" << PrettyMethod(cu_->method_idx, *cu_->dex_file)
+        << "\" @0x" << std::hex << mir->offset << " profiled call dispatches to \""
+        << target->callee_ << "\" in " << std::dec << target->count_ << " samples";
+  }
+}
+
 void MIRGraph::InlineCallsEnd() {
   DCHECK(temp_insn_data_ != nullptr);
   temp_insn_data_ = nullptr;
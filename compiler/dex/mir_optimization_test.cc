@@ -402,4 +402,367 @@ TEST_F(ClassInitCheckEliminationTest, Catch) {
   }
 }
 
+class LocalMonitorEliminationTest : public testing::Test {
+ protected:
+  struct MIRDef {
+    Instruction::Code opcode;
+    uint16_t optimization_flags;
+    size_t num_uses;
+    int32_t uses[2];
+    size_t num_defs;
+    int32_t defs[1];
+  };
+
+#define DEF_NEW_INSTANCE(sreg) \
+    { Instruction::NEW_INSTANCE, 0u, 0u, { }, 1u, { sreg } }
+#define DEF_UNIQUE_REF(opcode, sreg) \
+    { opcode, 0u, 1u, { sreg }, 0u, { } }
+#define DEF_MOVE_OBJECT(dest, src) \
+    { Instruction::MOVE_OBJECT, 0u, 1u, { src }, 1u, { dest } }
+#define DEF_IGET(dest, obj) \
+    { Instruction::IGET, 0u, 1u, { obj }, 1u, { dest } }
+#define DEF_IPUT_OBJECT(value, obj) \
+    { Instruction::IPUT_OBJECT, 0u, 2u, { value, obj }, 0u, { } }
+#define DEF_INLINED_INVOKE_DIRECT(sreg) \
+    { Instruction::INVOKE_DIRECT, MIR_INLINED, 1u, { sreg }, 0u, { } }
+
+  // Puts the MIRs in a single block between the entry and the exit.
+  template <size_t count>
+  void PrepareMIRs(const MIRDef (&defs)[count], int num_ssa_regs) {
+    static const BBType kTypes[] = { kNullBlock, kEntryBlock, kExitBlock, kDalvikByteCode };
+    for (size_t i = 0u; i != arraysize(kTypes); ++i) {
+      BasicBlock* bb = cu_.mir_graph->NewMemBB(kTypes[i], i);
+      bb->predecessors = new (&cu_.arena) GrowableArray<BasicBlockId>(
+          &cu_.arena, 1u, kGrowableArrayPredecessors);
+      cu_.mir_graph->block_list_.Insert(bb);
+    }
+    cu_.mir_graph->num_blocks_ = arraysize(kTypes);
+    cu_.mir_graph->entry_block_ = cu_.mir_graph->block_list_.Get(1);
+    cu_.mir_graph->exit_block_ = cu_.mir_graph->block_list_.Get(2);
+    BasicBlock* bb = cu_.mir_graph->block_list_.Get(3);
+    mirs_ = reinterpret_cast<MIR*>(cu_.arena.Alloc(sizeof(MIR) * count, kArenaAllocMIR));
+    for (size_t i = 0u; i != count; ++i) {
+      const MIRDef* def = &defs[i];
+      MIR* mir = &mirs_[i];
+      mir->dalvikInsn.opcode = def->opcode;
+      mir->optimization_flags = def->optimization_flags;
+      mir->ssa_rep = static_cast<SSARepresentation*>(
+          cu_.arena.Alloc(sizeof(SSARepresentation), kArenaAllocDFInfo));
+      mir->ssa_rep->num_uses = def->num_uses;
+      mir->ssa_rep->uses = const_cast<int32_t*>(def->uses);
+      mir->ssa_rep->num_defs = def->num_defs;
+      mir->ssa_rep->defs = const_cast<int32_t*>(def->defs);
+      bb->AppendMIR(mir);
+    }
+    cu_.mir_graph->SetNumSSARegs(num_ssa_regs);
+  }
+
+  bool IsNop(size_t index) const {
+    return mirs_[index].dalvikInsn.opcode == static_cast<Instruction::Code>(kMirOpNop);
+  }
+
+  LocalMonitorEliminationTest()
+      : pool_(),
+        cu_(&pool_),
+        mirs_(nullptr) {
+    cu_.mir_graph.reset(new MIRGraph(&cu_, &cu_.arena));
+  }
+
+  ArenaPool pool_;
+  CompilationUnit cu_;
+  MIR* mirs_;
+};
+
+TEST_F(LocalMonitorEliminationTest, LocalAllocations) {
+  static const MIRDef mirs[] = {
+      // Locked, read and initialized by an inlined constructor.
+      DEF_NEW_INSTANCE(0),
+      DEF_INLINED_INVOKE_DIRECT(0),
+      DEF_UNIQUE_REF(Instruction::MONITOR_ENTER, 0),
+      DEF_IGET(1, 0),
+      DEF_UNIQUE_REF(Instruction::MONITOR_EXIT, 0),
+      // Locked through a copy, the monitor-exit comes before the copy in the block order.
+      DEF_NEW_INSTANCE(2),
+      DEF_UNIQUE_REF(Instruction::MONITOR_EXIT, 3),
+      DEF_MOVE_OBJECT(3, 2),
+      DEF_UNIQUE_REF(Instruction::MONITOR_ENTER, 3),
+      // The object of a store, which doesn't publish it.
+      DEF_NEW_INSTANCE(4),
+      DEF_IPUT_OBJECT(1, 4),
+      DEF_UNIQUE_REF(Instruction::MONITOR_ENTER, 4),
+      DEF_UNIQUE_REF(Instruction::MONITOR_EXIT, 4),
+  };
+  PrepareMIRs(mirs, 5);
+  ASSERT_TRUE(cu_.mir_graph->EliminateLocalMonitorsGate());
+  cu_.mir_graph->EliminateLocalMonitors();
+  static const size_t kEliminated[] = { 2u, 4u, 6u, 8u, 11u, 12u };
+  for (size_t index : kEliminated) {
+    EXPECT_TRUE(IsNop(index)) << index;
+  }
+  EXPECT_FALSE(IsNop(1u));
+  EXPECT_FALSE(IsNop(3u));
+}
+
+TEST_F(LocalMonitorEliminationTest, EscapingAllocations) {
+  static const MIRDef mirs[] = {
+      // Passed to a call through a copy.
+      DEF_NEW_INSTANCE(0),
+      DEF_MOVE_OBJECT(1, 0),
+      DEF_UNIQUE_REF(Instruction::MONITOR_ENTER, 0),
+      DEF_UNIQUE_REF(Instruction::INVOKE_STATIC, 1),
+      DEF_UNIQUE_REF(Instruction::MONITOR_EXIT, 0),
+      // Stored in another object.
+      DEF_NEW_INSTANCE(2),
+      DEF_IPUT_OBJECT(2, 5),
+      DEF_UNIQUE_REF(Instruction::MONITOR_ENTER, 2),
+      DEF_UNIQUE_REF(Instruction::MONITOR_EXIT, 2),
+      // Returned.
+      DEF_NEW_INSTANCE(3),
+      DEF_UNIQUE_REF(Instruction::MONITOR_ENTER, 3),
+      DEF_UNIQUE_REF(Instruction::MONITOR_EXIT, 3),
+      DEF_UNIQUE_REF(Instruction::RETURN_OBJECT, 3),
+      // Not allocated in the method.
+      DEF_UNIQUE_REF(Instruction::MONITOR_ENTER, 4),
+      DEF_UNIQUE_REF(Instruction::MONITOR_EXIT, 4),
+  };
+  PrepareMIRs(mirs, 6);
+  ASSERT_TRUE(cu_.mir_graph->EliminateLocalMonitorsGate());
+  cu_.mir_graph->EliminateLocalMonitors();
+  for (size_t i = 0u; i != arraysize(mirs); ++i) {
+    EXPECT_FALSE(IsNop(i)) << i;
+  }
+}
+
+class LoopRangeCheckEliminationTest : public ClassInitCheckEliminationTest {
+ protected:
+  struct SsaMIRDef {
+    int opcode;
+    BasicBlockId bbid;
+    int32_t vC;
+    size_t num_uses;
+    int32_t uses[3];
+    size_t num_defs;
+    int32_t defs[1];
+  };
+
+#define DEF_SSA_MIR(opcode, bb, uses, defs) \
+    { Instruction::opcode, bb, 0, uses, defs }
+#define DEF_SSA_MIR_LIT(opcode, bb, lit, uses, defs) \
+    { Instruction::opcode, bb, lit, uses, defs }
+#define DEF_SSA_PHI2(bb, src1, src2, dest) \
+    { kMirOpPhi, bb, 0, DEF_USES2(src1, src2), DEF_DEFS1(dest) }
+#define DEF_USES0() \
+    0u, { }
+#define DEF_USES1(u1) \
+    1u, { u1 }
+#define DEF_USES2(u1, u2) \
+    2u, { u1, u2 }
+#define DEF_USES3(u1, u2, u3) \
+    3u, { u1, u2, u3 }
+#define DEF_DEFS0() \
+    0u, { }
+#define DEF_DEFS1(d1) \
+    1u, { d1 }
+
+  // Builds "for (int i = init; i < a.length; i += stride)" with accesses in its body and after it.
+  void PrepareLoop(int32_t init, int32_t stride) {
+    static const BBDef bbs[] = {
+        DEF_BB(kNullBlock, DEF_SUCC0(), DEF_PRED0()),
+        DEF_BB(kEntryBlock, DEF_SUCC1(3), DEF_PRED0()),
+        DEF_BB(kExitBlock, DEF_SUCC0(), DEF_PRED1(6)),
+        DEF_BB(kDalvikByteCode, DEF_SUCC1(4), DEF_PRED1(1)),
+        DEF_BB(kDalvikByteCode, DEF_SUCC2(5, 6), DEF_PRED2(3, 5)),  // Head, "taken" exits.
+        DEF_BB(kDalvikByteCode, DEF_SUCC1(4), DEF_PRED1(4)),
+        DEF_BB(kDalvikByteCode, DEF_SUCC1(2), DEF_PRED1(4)),
+    };
+    // s0 is the array a, s6 another array, s1 the start value, s2 the induction variable.
+    const SsaMIRDef mirs[] = {
+        DEF_SSA_MIR(CONST, 3, DEF_USES0(), DEF_DEFS1(1)),
+        DEF_SSA_PHI2(4, 1, 5, 2),
+        DEF_SSA_MIR(ARRAY_LENGTH, 4, DEF_USES1(0), DEF_DEFS1(3)),
+        DEF_SSA_MIR(IF_GE, 4, DEF_USES2(2, 3), DEF_DEFS0()),
+        DEF_SSA_MIR(AGET, 5, DEF_USES2(0, 2), DEF_DEFS1(4)),
+        DEF_SSA_MIR(AGET, 5, DEF_USES2(6, 2), DEF_DEFS1(7)),
+        DEF_SSA_MIR(APUT, 5, DEF_USES3(4, 0, 2), DEF_DEFS0()),
+        DEF_SSA_MIR_LIT(ADD_INT_LIT8, 5, stride, DEF_USES1(2), DEF_DEFS1(5)),
+        DEF_SSA_MIR(APUT, 5, DEF_USES3(7, 0, 5), DEF_DEFS0()),
+        DEF_SSA_MIR(AGET, 6, DEF_USES2(0, 2), DEF_DEFS1(8)),
+    };
+    PrepareBasicBlocks(bbs);
+    cu_.mir_graph->GetBasicBlock(4)->conditional_branch = true;
+    mir_count_ = arraysize(mirs);
+    mirs_ = reinterpret_cast<MIR*>(cu_.arena.Alloc(sizeof(MIR) * mir_count_, kArenaAllocMIR));
+    for (size_t i = 0u; i != mir_count_; ++i) {
+      const SsaMIRDef* def = &mirs[i];
+      MIR* mir = &mirs_[i];
+      mir->dalvikInsn.opcode = static_cast<Instruction::Code>(def->opcode);
+      mir->dalvikInsn.vC = static_cast<uint32_t>(def->vC);
+      mir->optimization_flags = 0u;
+      mir->ssa_rep = static_cast<SSARepresentation*>(
+          cu_.arena.Alloc(sizeof(SSARepresentation), kArenaAllocDFInfo));
+      mir->ssa_rep->num_uses = def->num_uses;
+      mir->ssa_rep->uses = static_cast<int32_t*>(
+          cu_.arena.Alloc(sizeof(int32_t) * 3u, kArenaAllocDFInfo));
+      std::copy(def->uses, def->uses + def->num_uses, mir->ssa_rep->uses);
+      mir->ssa_rep->num_defs = def->num_defs;
+      mir->ssa_rep->defs = static_cast<int32_t*>(
+          cu_.arena.Alloc(sizeof(int32_t), kArenaAllocDFInfo));
+      std::copy(def->defs, def->defs + def->num_defs, mir->ssa_rep->defs);
+      cu_.mir_graph->GetBasicBlock(def->bbid)->AppendMIR(mir);
+    }
+    cu_.mir_graph->SetNumSSARegs(9);
+    cu_.mir_graph->InitializeConstantPropagation();
+    cu_.mir_graph->SetConstant(1, init);
+    cu_.mir_graph->ComputeDFSOrders();
+    cu_.mir_graph->ComputeDominators();
+  }
+
+  void PerformLoopRangeCheckElimination() {
+    ASSERT_TRUE(cu_.mir_graph->EliminateLoopRangeChecksGate());
+    cu_.mir_graph->EliminateLoopRangeChecks();
+  }
+
+  bool IsRangeChecked(size_t index) const {
+    return (mirs_[index].optimization_flags & MIR_IGNORE_RANGE_CHECK) == 0;
+  }
+};
+
+TEST_F(LoopRangeCheckEliminationTest, CountedLoop) {
+  PrepareLoop(0, 1);
+  PerformLoopRangeCheckElimination();
+  // a[i] in the body.
+  EXPECT_FALSE(IsRangeChecked(4u));
+  EXPECT_FALSE(IsRangeChecked(6u));
+  // Another array, a[i + 1] and a[i] after the loop.
+  EXPECT_TRUE(IsRangeChecked(5u));
+  EXPECT_TRUE(IsRangeChecked(8u));
+  EXPECT_TRUE(IsRangeChecked(9u));
+}
+
+TEST_F(LoopRangeCheckEliminationTest, NegativeStart) {
+  PrepareLoop(-1, 1);
+  PerformLoopRangeCheckElimination();
+  for (size_t i = 0u; i != mir_count_; ++i) {
+    EXPECT_TRUE(IsRangeChecked(i)) << i;
+  }
+}
+
+TEST_F(LoopRangeCheckEliminationTest, Stride) {
+  // i += 2 may overflow to a negative index.
+  PrepareLoop(0, 2);
+  PerformLoopRangeCheckElimination();
+  for (size_t i = 0u; i != mir_count_; ++i) {
+    EXPECT_TRUE(IsRangeChecked(i)) << i;
+  }
+}
+
+class ConstantPropagationTest : public testing::Test {
+ protected:
+  struct MIRDef {
+    int opcode;
+    int32_t vB;
+    int32_t vC;
+    size_t num_uses;
+    int32_t uses[2];
+    size_t num_defs;
+    int32_t defs[2];
+  };
+
+#define DEF_CONST(dest, value) \
+    { Instruction::CONST, value, 0, 0u, { }, 1u, { dest } }
+#define DEF_CONST_WIDE(dest, value) \
+    { Instruction::CONST_WIDE_32, value, 0, 0u, { }, 2u, { dest, dest + 1 } }
+#define DEF_BINOP(opcode, dest, src1, src2) \
+    { Instruction::opcode, 0, 0, 2u, { src1, src2 }, 1u, { dest } }
+#define DEF_BINOP_LIT(opcode, dest, src, lit) \
+    { Instruction::opcode, 0, lit, 1u, { src }, 1u, { dest } }
+#define DEF_PHI2(dest, src1, src2) \
+    { kMirOpPhi, 0, 0, 2u, { src1, src2 }, 1u, { dest } }
+
+  // Puts the MIRs in a single block and runs constant propagation over it.
+  template <size_t count>
+  void PerformConstantPropagation(const MIRDef (&defs)[count], int num_ssa_regs) {
+    BasicBlock* bb = cu_.mir_graph->NewMemBB(kDalvikByteCode, 0);
+    mirs_ = reinterpret_cast<MIR*>(cu_.arena.Alloc(sizeof(MIR) * count, kArenaAllocMIR));
+    for (size_t i = 0u; i != count; ++i) {
+      const MIRDef* def = &defs[i];
+      MIR* mir = &mirs_[i];
+      mir->dalvikInsn.opcode = static_cast<Instruction::Code>(def->opcode);
+      mir->dalvikInsn.vB = static_cast<uint32_t>(def->vB);
+      mir->dalvikInsn.vC = static_cast<uint32_t>(def->vC);
+      mir->ssa_rep = static_cast<SSARepresentation*>(
+          cu_.arena.Alloc(sizeof(SSARepresentation), kArenaAllocDFInfo));
+      mir->ssa_rep->num_uses = def->num_uses;
+      mir->ssa_rep->uses = const_cast<int32_t*>(def->uses);
+      mir->ssa_rep->num_defs = def->num_defs;
+      mir->ssa_rep->defs = const_cast<int32_t*>(def->defs);
+      bb->AppendMIR(mir);
+    }
+    cu_.mir_graph->SetNumSSARegs(num_ssa_regs);
+    cu_.mir_graph->InitializeConstantPropagation();
+    cu_.mir_graph->DoConstantPropagation(bb);
+  }
+
+  void ExpectConstant(int32_t s_reg, int32_t value) {
+    ASSERT_TRUE(cu_.mir_graph->IsConst(s_reg)) << s_reg;
+    EXPECT_EQ(value, cu_.mir_graph->ConstantValue(s_reg)) << s_reg;
+  }
+
+  ConstantPropagationTest()
+      : pool_(),
+        cu_(&pool_),
+        mirs_(nullptr) {
+    cu_.mir_graph.reset(new MIRGraph(&cu_, &cu_.arena));
+  }
+
+  ArenaPool pool_;
+  CompilationUnit cu_;
+  MIR* mirs_;
+};
+
+TEST_F(ConstantPropagationTest, Arithmetic) {
+  static const MIRDef mirs[] = {
+      DEF_CONST(0, 6),
+      DEF_CONST(1, -4),
+      DEF_BINOP(ADD_INT, 2, 0, 1),
+      DEF_BINOP(MUL_INT_2ADDR, 3, 2, 0),
+      DEF_BINOP_LIT(RSUB_INT_LIT8, 4, 3, 2),
+      DEF_BINOP_LIT(SHL_INT_LIT8, 5, 1, 33),
+      DEF_BINOP(USHR_INT, 6, 1, 0),
+      DEF_BINOP(DIV_INT, 7, 0, 1),
+      // Not folded: a division by zero throws and 8 isn't constant.
+      DEF_CONST(9, 0),
+      DEF_BINOP(DIV_INT, 10, 0, 9),
+      DEF_BINOP(ADD_INT, 11, 0, 8),
+  };
+  PerformConstantPropagation(mirs, 12);
+  ExpectConstant(2, 2);
+  ExpectConstant(3, 12);
+  ExpectConstant(4, -10);
+  ExpectConstant(5, -8);
+  ExpectConstant(6, static_cast<int32_t>(0xfffffffcu >> 6));
+  ExpectConstant(7, -1);
+  EXPECT_FALSE(cu_.mir_graph->IsConst(10));
+  EXPECT_FALSE(cu_.mir_graph->IsConst(11));
+}
+
+TEST_F(ConstantPropagationTest, Phis) {
+  static const MIRDef mirs[] = {
+      DEF_CONST(0, 1),
+      DEF_CONST(1, 1),
+      DEF_CONST(2, 2),
+      DEF_PHI2(3, 0, 1),
+      DEF_PHI2(4, 0, 2),
+      // Operand 6 isn't known yet, as for a loop back edge.
+      DEF_PHI2(5, 0, 6),
+      DEF_CONST_WIDE(7, 5),
+  };
+  PerformConstantPropagation(mirs, 10);
+  ExpectConstant(3, 1);
+  EXPECT_FALSE(cu_.mir_graph->IsConst(4));
+  EXPECT_FALSE(cu_.mir_graph->IsConst(5));
+  ExpectConstant(7, 5);
+  ExpectConstant(8, 0);
+}
+
 }  // namespace art
@@ -17,6 +17,8 @@
 #ifndef ART_COMPILER_DEX_PASS_DRIVER_ME_H_
 #define ART_COMPILER_DEX_PASS_DRIVER_ME_H_
 
+#include <memory>
+
 #include "bb_optimizations.h"
 #include "dataflow_iterator.h"
 #include "dataflow_iterator-inl.h"
@@ -98,8 +100,16 @@ class PassDriverME: public PassDriver<PassDriverType> {
         c_unit->print_pass = true;
       }
 
+      // With --dump-passes, the pass gets its own split nested in the one of the phase running
+      // it, the post-optimization passes run from within the optimizations.
+      std::unique_ptr<TimingLogger::ScopedSplit> pass_split;
+      if (c_unit->compiler_driver->GetDumpPasses()) {
+        pass_split.reset(new TimingLogger::ScopedSplit(pass->GetName(), &c_unit->timings));
+      }
+
       // Applying the pass: first start, doWork, and end calls.
       this->ApplyPass(&pass_me_data_holder_, pass);
+      pass_split.reset();
 
       bool should_dump = ((c_unit->enable_debug & (1 << kDebugDumpCFG)) != 0);
 
@@ -39,6 +39,8 @@ const Pass* const PassDriver<PassDriverMEOpts>::g_passes[] = {
   GetPassInstance<CodeLayout>(),
   GetPassInstance<NullCheckEliminationAndTypeInference>(),
   GetPassInstance<ClassInitCheckElimination>(),
+  GetPassInstance<LocalMonitorElimination>(),
+  GetPassInstance<LoopRangeCheckElimination>(),
   GetPassInstance<BBCombine>(),
   GetPassInstance<BBOptimizations>(),
 };
@@ -83,6 +85,10 @@ void PassDriverMEOpts::ApplyPass(PassDataHolder* data, const Pass* pass) {
     CompilationUnit* c_unit = pass_me_data_holder->c_unit;
     c_unit->mir_graph.get()->CalculateBasicBlockInformation();
   }
+
+  // The passes left and the code generator see the optimizations disabled if this one used up
+  // the arena budget.
+  pass_me_data_holder->c_unit->CheckArenaBudget();
 }
 
 }  // namespace art
@@ -240,7 +240,7 @@ class PerformInitRegLocations : public PassME {
  */
 class ConstantPropagation : public PassME {
  public:
-  ConstantPropagation() : PassME("ConstantPropagation") {
+  ConstantPropagation() : PassME("ConstantPropagation", kPreOrderDFSTraversal) {
   }
 
   bool Worker(const PassDataHolder* data) const {
@@ -537,6 +537,8 @@ enum ArmOpcode {
   kThumb2LdrdPcRel8,  // ldrd rt, rt2, pc +-/1024.
   kThumb2LdrdI8,     // ldrd rt, rt2, [rn +-/1024].
   kThumb2StrdI8,     // strd rt, rt2, [rn +-/1024].
+  kThumb2ClzRR,      // clz [111110101011] rm[19..16] [1111] rd[11..8] [1000] rm[3..0].
+  kThumb2RbitRR,     // rbit [111110101001] rm[19..16] [1111] rd[11..8] [1010] rm[3..0].
   kArmLast,
 };
 
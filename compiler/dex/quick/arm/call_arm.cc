@@ -19,7 +19,10 @@
 #include "arm_lir.h"
 #include "codegen_arm.h"
 #include "dex/quick/mir_to_lir-inl.h"
+#include "driver/compiler_options.h"
 #include "entrypoints/quick/quick_entrypoints.h"
+#include "gc/space/bump_pointer_space.h"
+#include "mirror/class.h"
 
 namespace art {
 
@@ -311,6 +314,53 @@ void ArmMir2Lir::GenMonitorExit(int opt_flags, RegLocation rl_src) {
   }
 }
 
+/*
+ * Allocate from the TLAB of the thread inline. The TLABs are zeroed, so the class is the only field
+ * to set. Threads without a TLAB have a null pos and end and, like full TLABs, call the entrypoint.
+ */
+bool ArmMir2Lir::GenInlinedNewInstance(uintptr_t direct_type_ptr) {
+  if (!cu_->compiler_driver->GetCompilerOptions().GetInlineTlabAllocation() ||
+      kUseBakerOrBrooksReadBarrier) {
+    return false;
+  }
+  class AllocObjectSlowPath : public LIRSlowPath {
+   public:
+    AllocObjectSlowPath(Mir2Lir* m2l, LIR* branch, LIR* cont)
+        : LIRSlowPath(m2l, m2l->GetCurrentDexPc(), branch, cont) {
+    }
+    void Compile() OVERRIDE {
+      GenerateTargetLabel();
+      m2l_->CallRuntimeHelperRegMethod(QUICK_ENTRYPOINT_OFFSET(4, pAllocObjectInitialized), rs_r0,
+                                       true);
+      m2l_->OpUnconditionalBranch(cont_);
+    }
+  };
+
+  LockCallTemps();  // Using fixed registers.
+  if (direct_type_ptr != 0) {
+    LoadConstant(rs_r0, static_cast<int>(direct_type_ptr));
+  }
+  // r0 = class, r1 = object, r2 = TLAB end, r3 = object end.
+  const size_t alignment = gc::space::BumpPointerSpace::kAlignment;
+  Load32Disp(rs_r0, mirror::Class::ObjectSizeOffset().Int32Value(), rs_r3);
+  Load32Disp(rs_rARM_SELF, Thread::ThreadLocalPosOffset<4>().Int32Value(), rs_r1);
+  Load32Disp(rs_rARM_SELF, Thread::ThreadLocalEndOffset<4>().Int32Value(), rs_r2);
+  OpRegImm(kOpAdd, rs_r3, alignment - 1);
+  OpRegImm(kOpAnd, rs_r3, ~(alignment - 1));
+  OpRegReg(kOpAdd, rs_r3, rs_r1);
+  LIR* full_branch = OpCmpBranch(kCondHi, rs_r3, rs_r2, nullptr);
+  Store32Disp(rs_rARM_SELF, Thread::ThreadLocalPosOffset<4>().Int32Value(), rs_r3);
+  Load32Disp(rs_rARM_SELF, Thread::ThreadLocalObjectsOffset<4>().Int32Value(), rs_r2);
+  OpRegImm(kOpAdd, rs_r2, 1);
+  Store32Disp(rs_rARM_SELF, Thread::ThreadLocalObjectsOffset<4>().Int32Value(), rs_r2);
+  StoreRefDisp(rs_r1, mirror::Object::ClassOffset().Int32Value(), rs_r0);
+  OpRegCopy(rs_r0, rs_r1);
+  LIR* cont = NewLIR0(kPseudoTargetLabel);
+  AddSlowPath(new (arena_) AllocObjectSlowPath(this, full_branch, cont));
+  FreeCallTemps();
+  return true;
+}
+
 void ArmMir2Lir::GenMoveException(RegLocation rl_dest) {
   int ex_offset = Thread::ExceptionOffset<4>().Int32Value();
   RegLocation rl_result = EvalLoc(rl_dest, kRefReg, true);
@@ -386,7 +436,8 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
     }
   }
   /* Spill core callee saves */
-  NewLIR1(kThumb2Push, core_spill_mask_);
+  cfi_core_spill_mask_ = core_spill_mask_;
+  cfi_core_spill_ = NewLIR1(kThumb2Push, core_spill_mask_);
   /* Need to spill any FP regs? */
   if (num_fp_spills_) {
     /*
@@ -394,7 +445,7 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
      * they are pushed as a contiguous block.  When promoting from
      * the fp set, we must allocate all singles from s16..highest-promoted
      */
-    NewLIR1(kThumb2VPushCS, num_fp_spills_);
+    cfi_fp_spill_ = NewLIR1(kThumb2VPushCS, num_fp_spills_);
   }
 
   const int spill_size = spill_count * 4;
@@ -434,7 +485,8 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
         LIR* branch = OpCmpBranch(kCondUlt, rs_rARM_LR, rs_r12, nullptr);
         // Need to restore LR since we used it as a temp.
         AddSlowPath(new(arena_)StackOverflowSlowPath(this, branch, true, spill_size));
-        OpRegCopy(rs_rARM_SP, rs_rARM_LR);     // Establish stack
+        cfi_stack_decrement_ = OpRegCopyNoInsert(rs_rARM_SP, rs_rARM_LR);  // Establish stack
+        AppendLIR(cfi_stack_decrement_);
       } else {
         /*
          * If the frame is small enough we are guaranteed to have enough space that remains to
@@ -444,7 +496,8 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
         DCHECK(!GetRegInfo(rs_rARM_LR)->IsTemp());
         MarkTemp(rs_rARM_LR);
         FreeTemp(rs_rARM_LR);
-        OpRegRegImm(kOpSub, rs_rARM_SP, rs_rARM_SP, frame_size_without_spills);
+        cfi_stack_decrement_ =
+            OpRegRegImm(kOpSub, rs_rARM_SP, rs_rARM_SP, frame_size_without_spills);
         Clobber(rs_rARM_LR);
         UnmarkTemp(rs_rARM_LR);
         LIR* branch = OpCmpBranch(kCondUlt, rs_rARM_SP, rs_r12, nullptr);
@@ -453,10 +506,10 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
     } else {
       // Implicit stack overflow check has already been done.  Just make room on the
       // stack for the frame now.
-      OpRegImm(kOpSub, rs_rARM_SP, frame_size_without_spills);
+      cfi_stack_decrement_ = OpRegImm(kOpSub, rs_rARM_SP, frame_size_without_spills);
     }
   } else {
-    OpRegImm(kOpSub, rs_rARM_SP, frame_size_without_spills);
+    cfi_stack_decrement_ = OpRegImm(kOpSub, rs_rARM_SP, frame_size_without_spills);
   }
 
   FlushIns(ArgLocs, rl_method);
@@ -478,20 +531,21 @@ void ArmMir2Lir::GenExitSequence() {
   LockTemp(rs_r1);
 
   NewLIR0(kPseudoMethodExit);
-  OpRegImm(kOpAdd, rs_rARM_SP, frame_size_ - (spill_count * 4));
+  cfi_stack_increment_ = OpRegImm(kOpAdd, rs_rARM_SP, frame_size_ - (spill_count * 4));
   /* Need to restore any FP callee saves? */
   if (num_fp_spills_) {
-    NewLIR1(kThumb2VPopCS, num_fp_spills_);
+    cfi_fp_unspill_ = NewLIR1(kThumb2VPopCS, num_fp_spills_);
   }
   if (core_spill_mask_ & (1 << rs_rARM_LR.GetRegNum())) {
     /* Unspill rARM_LR to rARM_PC */
     core_spill_mask_ &= ~(1 << rs_rARM_LR.GetRegNum());
     core_spill_mask_ |= (1 << rs_rARM_PC.GetRegNum());
   }
-  NewLIR1(kThumb2Pop, core_spill_mask_);
+  cfi_core_unspill_ = NewLIR1(kThumb2Pop, core_spill_mask_);
+  cfi_return_ = cfi_core_unspill_;
   if (!(core_spill_mask_ & (1 << rs_rARM_PC.GetRegNum()))) {
     /* We didn't pop to rARM_PC, so must do a bv rARM_LR */
-    NewLIR1(kThumbBx, rs_rARM_LR.GetReg());
+    cfi_return_ = NewLIR1(kThumbBx, rs_rARM_LR.GetReg());
   }
 }
 
@@ -119,6 +119,9 @@ class ArmMir2Lir FINAL : public Mir2Lir {
     bool GenInlinedCas(CallInfo* info, bool is_long, bool is_object);
     bool GenInlinedMinMaxInt(CallInfo* info, bool is_min);
     bool GenInlinedSqrt(CallInfo* info);
+    bool GenInlinedNumberOfLeadingZeros(CallInfo* info, bool is_long);
+    bool GenInlinedNumberOfTrailingZeros(CallInfo* info, bool is_long);
+    bool GenInlinedRotate(CallInfo* info, bool is_left);
     bool GenInlinedPeek(CallInfo* info, OpSize size);
     bool GenInlinedPoke(CallInfo* info, OpSize size);
     void GenNotLong(RegLocation rl_dest, RegLocation rl_src);
@@ -145,6 +148,7 @@ class ArmMir2Lir FINAL : public Mir2Lir {
     bool GenMemBarrier(MemBarrierKind barrier_kind);
     void GenMonitorEnter(int opt_flags, RegLocation rl_src);
     void GenMonitorExit(int opt_flags, RegLocation rl_src);
+    bool GenInlinedNewInstance(uintptr_t direct_type_ptr);
     void GenMoveException(RegLocation rl_dest);
     void GenMultiplyByTwoBitMultiplier(RegLocation rl_src, RegLocation rl_result, int lit,
                                        int first_bit, int second_bit);
@@ -200,6 +204,18 @@ class ArmMir2Lir FINAL : public Mir2Lir {
     bool InexpensiveConstantLong(int64_t value);
     bool InexpensiveConstantDouble(int64_t value);
 
+    /*
+     * @brief Generate the debug_frame CIE information.
+     * @returns pointer to vector containing CIE information
+     */
+    static std::vector<uint8_t>* ReturnCommonCallFrameInformation();
+
+    /*
+     * @brief Generate the debug_frame FDE information.
+     * @returns pointer to vector containing FDE information
+     */
+    std::vector<uint8_t>* ReturnCallFrameInformation() OVERRIDE;
+
   private:
     void GenFusedLongCmpImmBranch(BasicBlock* bb, RegLocation rl_src1, int64_t val,
                                   ConditionCode ccode);
@@ -217,6 +233,17 @@ class ArmMir2Lir FINAL : public Mir2Lir {
     bool GetEasyMultiplyOp(int lit, EasyMultiplyOp* op);
     bool GetEasyMultiplyTwoOps(int lit, EasyMultiplyOp* ops);
     void GenEasyMultiplyTwoOps(RegStorage r_dest, RegStorage r_src, EasyMultiplyOp* ops);
+
+    // The prologue and epilogue instructions which change the frame, for the debug_frame CFI.
+    // The epilogue turns the spill of LR into a pop of PC, the mask of the spill is kept.
+    uint32_t cfi_core_spill_mask_;
+    LIR* cfi_core_spill_;
+    LIR* cfi_fp_spill_;
+    LIR* cfi_stack_decrement_;
+    LIR* cfi_stack_increment_;
+    LIR* cfi_fp_unspill_;
+    LIR* cfi_core_unspill_;
+    LIR* cfi_return_;
 };
 
 }  // namespace art
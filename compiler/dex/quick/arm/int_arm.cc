@@ -704,6 +704,91 @@ bool ArmMir2Lir::GenInlinedMinMaxInt(CallInfo* info, bool is_min) {
   return true;
 }
 
+bool ArmMir2Lir::GenInlinedNumberOfLeadingZeros(CallInfo* info, bool is_long) {
+  RegLocation rl_dest = InlineTarget(info);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  if (!is_long) {
+    RegLocation rl_src = LoadValue(info->args[0], kCoreReg);
+    NewLIR3(kThumb2ClzRR, rl_result.reg.GetReg(), rl_src.reg.GetReg(), rl_src.reg.GetReg());
+  } else {
+    // nlz(x) = (hi != 0) ? clz(hi) : 32 + clz(lo).
+    RegLocation rl_src = LoadValueWide(info->args[0], kCoreReg);
+    RegStorage t_reg = AllocTemp();
+    NewLIR3(kThumb2ClzRR, t_reg.GetReg(), rl_src.reg.GetLowReg(), rl_src.reg.GetLowReg());
+    OpRegImm(kOpAdd, t_reg, 32);
+    // CLZ doesn't set the flags, and the result may be the high word.
+    OpRegImm(kOpCmp, rl_src.reg.GetHigh(), 0);
+    NewLIR3(kThumb2ClzRR, rl_result.reg.GetReg(), rl_src.reg.GetHighReg(),
+            rl_src.reg.GetHighReg());
+    LIR* it = OpIT(kCondEq, "");
+    OpRegReg(kOpMov, rl_result.reg, t_reg);
+    OpEndIT(it);
+    FreeTemp(t_reg);
+  }
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
+bool ArmMir2Lir::GenInlinedNumberOfTrailingZeros(CallInfo* info, bool is_long) {
+  RegLocation rl_dest = InlineTarget(info);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  // ntz(x) = clz(rbit(x)).
+  if (!is_long) {
+    RegLocation rl_src = LoadValue(info->args[0], kCoreReg);
+    NewLIR3(kThumb2RbitRR, rl_result.reg.GetReg(), rl_src.reg.GetReg(), rl_src.reg.GetReg());
+    NewLIR3(kThumb2ClzRR, rl_result.reg.GetReg(), rl_result.reg.GetReg(),
+            rl_result.reg.GetReg());
+  } else {
+    // ntz(x) = (lo != 0) ? ntz(lo) : 32 + ntz(hi).
+    RegLocation rl_src = LoadValueWide(info->args[0], kCoreReg);
+    RegStorage t_reg = AllocTemp();
+    NewLIR3(kThumb2RbitRR, t_reg.GetReg(), rl_src.reg.GetHighReg(), rl_src.reg.GetHighReg());
+    NewLIR3(kThumb2ClzRR, t_reg.GetReg(), t_reg.GetReg(), t_reg.GetReg());
+    OpRegImm(kOpAdd, t_reg, 32);
+    RegStorage t_reg2 = AllocTemp();
+    NewLIR3(kThumb2RbitRR, t_reg2.GetReg(), rl_src.reg.GetLowReg(), rl_src.reg.GetLowReg());
+    OpRegImm(kOpCmp, rl_src.reg.GetLow(), 0);
+    NewLIR3(kThumb2ClzRR, rl_result.reg.GetReg(), t_reg2.GetReg(), t_reg2.GetReg());
+    LIR* it = OpIT(kCondEq, "");
+    OpRegReg(kOpMov, rl_result.reg, t_reg);
+    OpEndIT(it);
+    FreeTemp(t_reg2);
+    FreeTemp(t_reg);
+  }
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
+bool ArmMir2Lir::GenInlinedRotate(CallInfo* info, bool is_left) {
+  RegLocation rl_src = LoadValue(info->args[0], kCoreReg);
+  RegLocation rl_shift = info->args[1];
+  RegLocation rl_dest = InlineTarget(info);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  if (rl_shift.is_const) {
+    // Only the low 5 bits of the distance count, a left rotation is a right one by -distance.
+    int32_t shift = mir_graph_->ConstantValue(rl_shift);
+    shift = (is_left ? -shift : shift) & 31;
+    if (shift == 0) {
+      OpRegCopy(rl_result.reg, rl_src.reg);
+    } else {
+      OpRegRegImm(kOpRor, rl_result.reg, rl_src.reg, shift);
+    }
+  } else {
+    // ROR by register uses the low byte of the distance modulo 32, like Java.
+    rl_shift = LoadValue(rl_shift, kCoreReg);
+    if (is_left) {
+      RegStorage t_reg = AllocTemp();
+      OpRegReg(kOpNeg, t_reg, rl_shift.reg);
+      OpRegRegReg(kOpRor, rl_result.reg, rl_src.reg, t_reg);
+      FreeTemp(t_reg);
+    } else {
+      OpRegRegReg(kOpRor, rl_result.reg, rl_src.reg, rl_shift.reg);
+    }
+  }
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
 bool ArmMir2Lir::GenInlinedPeek(CallInfo* info, OpSize size) {
   RegLocation rl_src_address = info->args[0];  // long address
   rl_src_address = NarrowRegLoc(rl_src_address);  // ignore high half in info->args[1]
@@ -1170,6 +1255,11 @@ void ArmMir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
   int len_offset = mirror::Array::LengthOffset().Int32Value();
   int data_offset;
   RegLocation rl_result;
+  const bool read_barrier = kUseBakerReadBarrier && size == kReference;
+  if (read_barrier) {
+    // The read barrier may call the runtime so everything to home locations.
+    FlushAllRegs();
+  }
   bool constant_index = rl_index.is_const;
   rl_array = LoadValue(rl_array, kRefReg);
   if (!constant_index) {
@@ -1200,6 +1290,10 @@ void ArmMir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
   } else {
     ForceImplicitNullCheck(rl_array.reg, opt_flags);
   }
+  RegStorage r_rb_state;
+  if (read_barrier) {
+    r_rb_state = GenReadBarrierLoadState(rl_array.reg, opt_flags);
+  }
   if (rl_dest.wide || rl_dest.fp || constant_index) {
     RegStorage reg_ptr;
     if (constant_index) {
@@ -1222,6 +1316,9 @@ void ArmMir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
     }
     LoadBaseDisp(reg_ptr, data_offset, rl_result.reg, size);
     MarkPossibleNullPointerException(opt_flags);
+    if (read_barrier) {
+      GenReadBarrierMark(r_rb_state, rl_result.reg);
+    }
     if (!constant_index) {
       FreeTemp(reg_ptr);
     }
@@ -1244,6 +1341,9 @@ void ArmMir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
     LoadBaseIndexed(reg_ptr, rl_index.reg, rl_result.reg, scale, size);
     MarkPossibleNullPointerException(opt_flags);
     FreeTemp(reg_ptr);
+    if (read_barrier) {
+      GenReadBarrierMark(r_rb_state, rl_result.reg);
+    }
     StoreValue(rl_dest, rl_result);
   }
 }
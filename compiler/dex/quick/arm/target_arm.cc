@@ -22,6 +22,7 @@
 
 #include "dex/compiler_internals.h"
 #include "dex/quick/mir_to_lir-inl.h"
+#include "utils/dwarf_cfi.h"
 
 namespace art {
 
@@ -535,7 +536,9 @@ RegisterClass ArmMir2Lir::RegClassForFieldLoadStore(OpSize size, bool is_volatil
 }
 
 ArmMir2Lir::ArmMir2Lir(CompilationUnit* cu, MIRGraph* mir_graph, ArenaAllocator* arena)
-    : Mir2Lir(cu, mir_graph, arena) {
+    : Mir2Lir(cu, mir_graph, arena), cfi_core_spill_mask_(0), cfi_core_spill_(nullptr),
+      cfi_fp_spill_(nullptr), cfi_stack_decrement_(nullptr), cfi_stack_increment_(nullptr),
+      cfi_fp_unspill_(nullptr), cfi_core_unspill_(nullptr), cfi_return_(nullptr) {
   // Sanity check - make sure encoding map lines up.
   for (int i = 0; i < kArmLast; i++) {
     if (ArmMir2Lir::EncodingMap[i].opcode != i) {
@@ -793,4 +796,140 @@ RegStorage ArmMir2Lir::AllocPreservedDouble(int s_reg) {
   return res;
 }
 
+std::vector<uint8_t>* ArmCFIInitialization() {
+  return ArmMir2Lir::ReturnCommonCallFrameInformation();
+}
+
+std::vector<uint8_t>* ArmMir2Lir::ReturnCommonCallFrameInformation() {
+  std::vector<uint8_t>* cfi_info = new std::vector<uint8_t>;
+
+  // Length of the CIE (except for this field), set once the CIE is complete.
+  PushWord(cfi_info, 0);
+
+  // CIE id.
+  PushWord(cfi_info, 0xFFFFFFFFU);
+
+  // Version: 3.
+  cfi_info->push_back(0x03);
+
+  // Augmentation: empty string.
+  cfi_info->push_back(0x0);
+
+  // Code alignment: 2, the size of the smallest Thumb2 instruction.
+  cfi_info->push_back(0x02);
+
+  // Data alignment: -4.
+  cfi_info->push_back(0x7C);
+
+  // Return address register (LR).
+  cfi_info->push_back(0x0E);
+
+  // The return PC is in LR and nothing is on the stack: DW_CFA_def_cfa R13 0.
+  cfi_info->push_back(0x0C);
+  cfi_info->push_back(0x0D);
+  cfi_info->push_back(0x00);
+
+  WriteCFILength(cfi_info);
+  return cfi_info;
+}
+
+/*
+ * The offsets of the LIRs are only kept up to date for the ones with fixups, so the offset
+ * just past an instruction is found by adding up the sizes of the instructions before it.
+ */
+static uint32_t OffsetAfter(LIR* first_lir_insn, LIR* target) {
+  uint32_t offset = 0;
+  for (LIR* lir = first_lir_insn; lir != nullptr; lir = NEXT_LIR(lir)) {
+    if (!lir->flags.is_nop) {
+      offset += lir->flags.size;
+    }
+    if (lir == target) {
+      return offset;
+    }
+  }
+  LOG(FATAL) << "Frame instruction not in the LIR list";
+  return 0;
+}
+
+std::vector<uint8_t>* ArmMir2Lir::ReturnCallFrameInformation() {
+  std::vector<uint8_t>* cfi_info = new std::vector<uint8_t>;
+
+  // Generate the FDE for the method.
+  DCHECK_NE(data_offset_, 0U);
+  WriteFDEHeader(cfi_info, data_offset_);
+
+  // The instructions in the FDE, the special methods without a frame have none.
+  if (cfi_core_spill_ != nullptr) {
+    // The core registers pushed, the lowest one at the lowest address.
+    uint32_t pc = OffsetAfter(first_lir_insn_, cfi_core_spill_);
+    DW_CFA_advance_loc(cfi_info, pc / 2);
+    const int num_core_spills = POPCOUNT(cfi_core_spill_mask_);
+    int cfa_offset = num_core_spills * 4;
+    DW_CFA_def_cfa_offset(cfi_info, cfa_offset);
+    int spilled = 0;
+    for (int reg = 0; reg < 16; reg++) {
+      if ((cfi_core_spill_mask_ & (1 << reg)) != 0) {
+        DW_CFA_offset(cfi_info, reg, num_core_spills - spilled);
+        spilled++;
+      }
+    }
+
+    // The FP callee saves are pushed as a block starting at s16, sN is DWARF register 64 + N.
+    if (cfi_fp_spill_ != nullptr) {
+      uint32_t new_pc = OffsetAfter(first_lir_insn_, cfi_fp_spill_);
+      DW_CFA_advance_loc(cfi_info, (new_pc - pc) / 2);
+      pc = new_pc;
+      cfa_offset += num_fp_spills_ * 4;
+      DW_CFA_def_cfa_offset(cfi_info, cfa_offset);
+      for (int i = 0; i < num_fp_spills_; i++) {
+        DW_CFA_offset(cfi_info, 64 + 16 + i, cfa_offset / 4 - i);
+      }
+    }
+
+    // The frame proper.
+    if (cfi_stack_decrement_ != nullptr) {
+      uint32_t new_pc = OffsetAfter(first_lir_insn_, cfi_stack_decrement_);
+      DW_CFA_advance_loc(cfi_info, (new_pc - pc) / 2);
+      pc = new_pc;
+      DW_CFA_def_cfa_offset(cfi_info, frame_size_);
+    }
+
+    // The epilogue undoes it in reverse.
+    if (cfi_stack_increment_ != nullptr) {
+      uint32_t new_pc = OffsetAfter(first_lir_insn_, cfi_stack_increment_);
+      DW_CFA_advance_loc(cfi_info, (new_pc - pc) / 2);
+      pc = new_pc;
+
+      // The slow paths after the epilogue have the whole frame: DW_CFA_remember_state.
+      DW_CFA_remember_state(cfi_info);
+      DW_CFA_def_cfa_offset(cfi_info, cfa_offset);
+      if (cfi_fp_unspill_ != nullptr) {
+        new_pc = OffsetAfter(first_lir_insn_, cfi_fp_unspill_);
+        DW_CFA_advance_loc(cfi_info, (new_pc - pc) / 2);
+        pc = new_pc;
+        DW_CFA_def_cfa_offset(cfi_info, num_core_spills * 4);
+      }
+      // A pop of PC returns, otherwise the return follows the pop.
+      if (cfi_core_unspill_ != cfi_return_) {
+        new_pc = OffsetAfter(first_lir_insn_, cfi_core_unspill_);
+        DW_CFA_advance_loc(cfi_info, (new_pc - pc) / 2);
+        pc = new_pc;
+        DW_CFA_def_cfa_offset(cfi_info, 0);
+      }
+
+      // Everything after the return is the same as before the epilogue.
+      LIR* post_ret_insn = NEXT_LIR(cfi_return_);
+      if (post_ret_insn != nullptr) {
+        new_pc = OffsetAfter(first_lir_insn_, cfi_return_);
+        DW_CFA_advance_loc(cfi_info, (new_pc - pc) / 2);
+        DW_CFA_restore_state(cfi_info);
+      }
+    }
+  }
+
+  // Padding to a multiple of 4 and the length of the FDE inside the generated bytes.
+  WriteCFILength(cfi_info);
+  return cfi_info;
+}
+
 }  // namespace art
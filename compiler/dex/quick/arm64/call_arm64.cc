@@ -331,19 +331,24 @@ void Arm64Mir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method)
   NewLIR0(kPseudoMethodEntry);
 
   if (!skip_overflow_check) {
-    LoadWordDisp(rs_rA64_SELF, Thread::StackEndOffset<8>().Int32Value(), rs_x12);
-    OpRegImm64(kOpSub, rs_rA64_SP, frame_size_);
     if (Runtime::Current()->ExplicitStackOverflowChecks()) {
+      LoadWordDisp(rs_rA64_SELF, Thread::StackEndOffset<8>().Int32Value(), rs_x12);
+      OpRegImm64(kOpSub, rs_rA64_SP, frame_size_);
       /* Load stack limit */
       // TODO(Arm64): fix the line below:
       // GenRegRegCheck(kCondUlt, rA64_SP, r12, kThrowStackOverflow);
     } else {
       // Implicit stack overflow check.
-      // Generate a load from [sp, #-framesize].  If this is in the stack
+      // Generate a load from [sp, #-overflowsize].  If this is in the stack
       // redzone we will get a segmentation fault.
-      // TODO(Arm64): does the following really work or do we need a reg != rA64_ZR?
-      Load32Disp(rs_rA64_SP, 0, rs_wzr);
+      //
+      // This is done before the frame is built and the callee saves are
+      // spilled, so that the signal handler finds sp and lr still pointing to
+      // the previous frame.  This uses x12, which holds no argument on entry.
+      OpRegRegImm(kOpSub, rs_x12, rs_rA64_SP, Thread::kStackOverflowReservedBytes);
+      Load32Disp(rs_x12, 0, rs_w12);
       MarkPossibleStackOverflowException();
+      OpRegImm64(kOpSub, rs_rA64_SP, frame_size_);
     }
   } else if (frame_size_ > 0) {
     OpRegImm64(kOpSub, rs_rA64_SP, frame_size_);
@@ -87,6 +87,7 @@ class Arm64Mir2Lir : public Mir2Lir {
     uint64_t GetTargetInstFlags(int opcode);
     int GetInsnSize(LIR* lir);
     bool IsUnconditionalBranch(LIR* lir);
+    void ApplyPeephole(LIR* lir, LIR* tail_lir) OVERRIDE;
 
     // Check support for volatile load/store of a given size.
     bool SupportsVolatileLoadStore(OpSize size) OVERRIDE;
@@ -121,6 +122,9 @@ class Arm64Mir2Lir : public Mir2Lir {
     bool GenInlinedCas(CallInfo* info, bool is_long, bool is_object);
     bool GenInlinedMinMaxInt(CallInfo* info, bool is_min);
     bool GenInlinedSqrt(CallInfo* info);
+    bool GenInlinedNumberOfLeadingZeros(CallInfo* info, bool is_long);
+    bool GenInlinedNumberOfTrailingZeros(CallInfo* info, bool is_long);
+    bool GenInlinedRotate(CallInfo* info, bool is_left);
     bool GenInlinedPeek(CallInfo* info, OpSize size);
     bool GenInlinedPoke(CallInfo* info, OpSize size);
     void GenIntToLong(RegLocation rl_dest, RegLocation rl_src);
@@ -228,6 +232,7 @@ class Arm64Mir2Lir : public Mir2Lir {
     void ReplaceFixup(LIR* prev_lir, LIR* orig_lir, LIR* new_lir);
     void InsertFixupBefore(LIR* prev_lir, LIR* orig_lir, LIR* new_lir);
     void AssignDataOffsets();
+    bool MergeIntoPair(LIR* first_lir, LIR* second_lir);
     RegLocation GenDivRem(RegLocation rl_dest, RegLocation rl_src1, RegLocation rl_src2,
                           bool is_div, bool check_zero);
     RegLocation GenDivRemLit(RegLocation rl_dest, RegLocation rl_src1, int lit, bool is_div);
@@ -381,6 +381,70 @@ bool Arm64Mir2Lir::GenInlinedMinMaxInt(CallInfo* info, bool is_min) {
   return true;
 }
 
+bool Arm64Mir2Lir::GenInlinedNumberOfLeadingZeros(CallInfo* info, bool is_long) {
+  RegLocation rl_src = is_long ? LoadValueWide(info->args[0], kCoreReg)
+                               : LoadValue(info->args[0], kCoreReg);
+  RegLocation rl_dest = InlineTarget(info);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  if (is_long) {
+    // The count of a long is at most 64, write it to the x view of the int result.
+    NewLIR2(WIDE(kA64Clz2rr), RegStorage::Solo64(rl_result.reg.GetRegNum()).GetReg(),
+            rl_src.reg.GetReg());
+  } else {
+    NewLIR2(kA64Clz2rr, rl_result.reg.GetReg(), rl_src.reg.GetReg());
+  }
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
+bool Arm64Mir2Lir::GenInlinedNumberOfTrailingZeros(CallInfo* info, bool is_long) {
+  RegLocation rl_src = is_long ? LoadValueWide(info->args[0], kCoreReg)
+                               : LoadValue(info->args[0], kCoreReg);
+  RegLocation rl_dest = InlineTarget(info);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  // ntz(x) = clz(rbit(x)).
+  if (is_long) {
+    RegStorage r_result = RegStorage::Solo64(rl_result.reg.GetRegNum());
+    NewLIR2(WIDE(kA64Rbit2rr), r_result.GetReg(), rl_src.reg.GetReg());
+    NewLIR2(WIDE(kA64Clz2rr), r_result.GetReg(), r_result.GetReg());
+  } else {
+    NewLIR2(kA64Rbit2rr, rl_result.reg.GetReg(), rl_src.reg.GetReg());
+    NewLIR2(kA64Clz2rr, rl_result.reg.GetReg(), rl_result.reg.GetReg());
+  }
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
+bool Arm64Mir2Lir::GenInlinedRotate(CallInfo* info, bool is_left) {
+  RegLocation rl_src = LoadValue(info->args[0], kCoreReg);
+  RegLocation rl_shift = info->args[1];
+  RegLocation rl_dest = InlineTarget(info);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  if (rl_shift.is_const) {
+    // Only the low 5 bits of the distance count, a left rotation is a right one by -distance.
+    int32_t shift = mir_graph_->ConstantValue(rl_shift);
+    shift = (is_left ? -shift : shift) & 31;
+    if (shift == 0) {
+      OpRegCopy(rl_result.reg, rl_src.reg);
+    } else {
+      OpRegRegImm(kOpRor, rl_result.reg, rl_src.reg, shift);
+    }
+  } else {
+    // RORV of a w register uses the distance modulo 32, like Java.
+    rl_shift = LoadValue(rl_shift, kCoreReg);
+    if (is_left) {
+      RegStorage t_reg = AllocTemp();
+      OpRegReg(kOpNeg, t_reg, rl_shift.reg);
+      OpRegRegReg(kOpRor, rl_result.reg, rl_src.reg, t_reg);
+      FreeTemp(t_reg);
+    } else {
+      OpRegRegReg(kOpRor, rl_result.reg, rl_src.reg, rl_shift.reg);
+    }
+  }
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
 bool Arm64Mir2Lir::GenInlinedPeek(CallInfo* info, OpSize size) {
   // TODO(Arm64): implement this.
   UNIMPLEMENTED(WARNING);
@@ -444,71 +508,29 @@ void Arm64Mir2Lir::OpTlsCmp(ThreadOffset<8> offset, int val) {
 }
 
 bool Arm64Mir2Lir::GenInlinedCas(CallInfo* info, bool is_long, bool is_object) {
-  // TODO(Arm64): implement this.
-  UNIMPLEMENTED(WARNING);
-
-  DCHECK_EQ(cu_->instruction_set, kThumb2);
+  DCHECK_EQ(cu_->instruction_set, kArm64);
+  ArmOpcode wide = is_long ? WIDE(0) : UNWIDE(0);
   // Unused - RegLocation rl_src_unsafe = info->args[0];
   RegLocation rl_src_obj = info->args[1];  // Object - known non-null
-  RegLocation rl_src_offset = info->args[2];  // long low
-  rl_src_offset = NarrowRegLoc(rl_src_offset);  // ignore high half in info->args[3]
+  RegLocation rl_src_offset = info->args[2];  // long
   RegLocation rl_src_expected = info->args[4];  // int, long or Object
   // If is_long, high half is in info->args[5]
   RegLocation rl_src_new_value = info->args[is_long ? 6 : 5];  // int, long or Object
   // If is_long, high half is in info->args[7]
   RegLocation rl_dest = InlineTarget(info);  // boolean place for result
 
-  // We have only 5 temporary registers available and actually only 4 if the InlineTarget
-  // above locked one of the temps. For a straightforward CAS64 we need 7 registers:
-  // r_ptr (1), new_value (2), expected(2) and ldrexd result (2). If neither expected nor
-  // new_value is in a non-temp core register we shall reload them in the ldrex/strex loop
-  // into the same temps, reducing the number of required temps down to 5. We shall work
-  // around the potentially locked temp by using LR for r_ptr, unconditionally.
-  // TODO: Pass information about the need for more temps to the stack frame generation
-  // code so that we can rely on being able to allocate enough temps.
-  DCHECK(!GetRegInfo(rs_rA64_LR)->IsTemp());
-  MarkTemp(rs_rA64_LR);
-  FreeTemp(rs_rA64_LR);
-  LockTemp(rs_rA64_LR);
-  bool load_early = true;
-  if (is_long) {
-    RegStorage expected_reg = rl_src_expected.reg.IsPair() ? rl_src_expected.reg.GetLow() :
-        rl_src_expected.reg;
-    RegStorage new_val_reg = rl_src_new_value.reg.IsPair() ? rl_src_new_value.reg.GetLow() :
-        rl_src_new_value.reg;
-    bool expected_is_core_reg = rl_src_expected.location == kLocPhysReg && !expected_reg.IsFloat();
-    bool new_value_is_core_reg = rl_src_new_value.location == kLocPhysReg && !new_val_reg.IsFloat();
-    bool expected_is_good_reg = expected_is_core_reg && !IsTemp(expected_reg);
-    bool new_value_is_good_reg = new_value_is_core_reg && !IsTemp(new_val_reg);
-
-    if (!expected_is_good_reg && !new_value_is_good_reg) {
-      // None of expected/new_value is non-temp reg, need to load both late
-      load_early = false;
-      // Make sure they are not in the temp regs and the load will not be skipped.
-      if (expected_is_core_reg) {
-        FlushRegWide(rl_src_expected.reg);
-        ClobberSReg(rl_src_expected.s_reg_low);
-        ClobberSReg(GetSRegHi(rl_src_expected.s_reg_low));
-        rl_src_expected.location = kLocDalvikFrame;
-      }
-      if (new_value_is_core_reg) {
-        FlushRegWide(rl_src_new_value.reg);
-        ClobberSReg(rl_src_new_value.s_reg_low);
-        ClobberSReg(GetSRegHi(rl_src_new_value.s_reg_low));
-        rl_src_new_value.location = kLocDalvikFrame;
-      }
-    }
-  }
-
   // Release store semantics, get the barrier out of the way.  TODO: revisit
   GenMemBarrier(kStoreLoad);
 
   RegLocation rl_object = LoadValue(rl_src_obj, kRefReg);
   RegLocation rl_new_value;
-  if (!is_long) {
-    rl_new_value = LoadValue(rl_src_new_value);
-  } else if (load_early) {
+  RegLocation rl_expected;
+  if (is_long) {
     rl_new_value = LoadValueWide(rl_src_new_value, kCoreReg);
+    rl_expected = LoadValueWide(rl_src_expected, kCoreReg);
+  } else {
+    rl_new_value = LoadValue(rl_src_new_value, is_object ? kRefReg : kCoreReg);
+    rl_expected = LoadValue(rl_src_expected, is_object ? kRefReg : kCoreReg);
   }
 
   if (is_object && !mir_graph_->IsConstantNullRef(rl_new_value)) {
@@ -516,88 +538,45 @@ bool Arm64Mir2Lir::GenInlinedCas(CallInfo* info, bool is_long, bool is_object) {
     MarkGCCard(rl_new_value.reg, rl_object.reg);
   }
 
-  RegLocation rl_offset = LoadValue(rl_src_offset, kCoreReg);
-
-  RegStorage r_ptr = rs_rA64_LR;
+  RegLocation rl_offset = LoadValueWide(rl_src_offset, kCoreReg);
+  RegStorage r_ptr = AllocTempWide();
   OpRegRegReg(kOpAdd, r_ptr, rl_object.reg, rl_offset.reg);
 
-  // Free now unneeded rl_object and rl_offset to give more temps.
-  ClobberSReg(rl_object.s_reg_low);
-  FreeTemp(rl_object.reg);
-  ClobberSReg(rl_offset.s_reg_low);
-  FreeTemp(rl_offset.reg);
-
-  RegLocation rl_expected;
-  if (!is_long) {
-    rl_expected = LoadValue(rl_src_expected);
-  } else if (load_early) {
-    rl_expected = LoadValueWide(rl_src_expected, kCoreReg);
-  } else {
-    // NOTE: partially defined rl_expected & rl_new_value - but we just want the regs.
-    int low_reg = AllocTemp().GetReg();
-    int high_reg = AllocTemp().GetReg();
-    rl_new_value.reg = RegStorage(RegStorage::k64BitPair, low_reg, high_reg);
-    rl_expected = rl_new_value;
-  }
-
-  // do {
-  //   tmp = [r_ptr] - expected;
-  // } while (tmp == 0 && failure([r_ptr] <- r_new_value));
-  // result = tmp != 0;
-
-  RegStorage r_tmp = AllocTemp();
-  LIR* target = NewLIR0(kPseudoTargetLabel);
-
-  if (is_long) {
-    RegStorage r_tmp_high = AllocTemp();
-    if (!load_early) {
-      LoadValueDirectWide(rl_src_expected, rl_expected.reg);
-    }
-    NewLIR3(kA64Ldxr2rX, r_tmp.GetReg(), r_tmp_high.GetReg(), r_ptr.GetReg());
-    OpRegReg(kOpSub, r_tmp, rl_expected.reg.GetLow());
-    OpRegReg(kOpSub, r_tmp_high, rl_expected.reg.GetHigh());
-    if (!load_early) {
-      LoadValueDirectWide(rl_src_new_value, rl_new_value.reg);
-    }
-
-    LIR* branch1 = OpCmpImmBranch(kCondNe, r_tmp, 0, NULL);
-    LIR* branch2 = OpCmpImmBranch(kCondNe, r_tmp_high, 0, NULL);
-    NewLIR4(WIDE(kA64Stxr3wrX) /* eq */, r_tmp.GetReg(), rl_new_value.reg.GetReg(),
-            rl_new_value.reg.GetHighReg(), r_ptr.GetReg());
-    LIR* target2 = NewLIR0(kPseudoTargetLabel);
-    branch1->target = target2;
-    branch2->target = target2;
-    FreeTemp(r_tmp_high);  // Now unneeded
-
-  } else {
-    NewLIR3(kA64Ldxr2rX, r_tmp.GetReg(), r_ptr.GetReg(), 0);
-    OpRegReg(kOpSub, r_tmp, rl_expected.reg);
-    DCHECK(last_lir_insn_->u.m.def_mask & ENCODE_CCODE);
-    // OpIT(kCondEq, "T");
-    NewLIR4(kA64Stxr3wrX /* eq */, r_tmp.GetReg(), rl_new_value.reg.GetReg(), r_ptr.GetReg(), 0);
-  }
-
-  // Still one conditional left from OpIT(kCondEq, "T") from either branch
-  OpRegImm(kOpCmp /* eq */, r_tmp, 1);
-  OpCondBranch(kCondEq, target);
-
-  if (!load_early) {
-    FreeTemp(rl_expected.reg);  // Now unneeded.
-  }
-
-  // result := (tmp1 != 0) ? 0 : 1;
+  // References live in 64-bit registers but are 32 bits in the heap, use the views of the width
+  // of the field.
+  RegStorage r_expected = is_long ? rl_expected.reg
+                                  : RegStorage::Solo32(rl_expected.reg.GetRegNum());
+  RegStorage r_new_value = is_long ? rl_new_value.reg
+                                   : RegStorage::Solo32(rl_new_value.reg.GetRegNum());
+
+  // loop:
+  //   tmp = [r_ptr] (exclusive);
+  //   if (tmp != expected) goto done;
+  //   status = ([r_ptr] <- new_value) (exclusive);
+  //   if (status != 0) goto loop;
+  // done:
+  //   result = (tmp == expected);
+  // The flags of the last compare survive the store and the cbnz.
+  RegStorage r_tmp = is_long ? AllocTempWide() : AllocTemp();
+  RegStorage r_status = AllocTemp();
+  LIR* loop = NewLIR0(kPseudoTargetLabel);
+  NewLIR2(kA64Ldxr2rX | wide, r_tmp.GetReg(), r_ptr.GetReg());
+  NewLIR3(kA64Cmp3rro | wide, r_tmp.GetReg(), r_expected.GetReg(), ENCODE_NO_SHIFT);
+  LIR* not_equal = OpCondBranch(kCondNe, NULL);
+  NewLIR3(kA64Stxr3wrX | wide, r_status.GetReg(), r_new_value.GetReg(), r_ptr.GetReg());
+  OpCmpImmBranch(kCondNe, r_status, 0, loop);
+  LIR* done = NewLIR0(kPseudoTargetLabel);
+  not_equal->target = done;
+  // Acquire semantics for the accesses that follow, the dmb leaves the flags alone.
+  GenMemBarrier(kLoadLoad);
+  FreeTemp(r_status);
+  FreeTemp(r_tmp);
+  FreeTemp(r_ptr);
+
+  // result := (eq) ? 1 : 0, which is csinc wd, wzr, wzr, ne.
   RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
-  OpRegRegImm(kOpRsub, rl_result.reg, r_tmp, 1);
-  DCHECK(last_lir_insn_->u.m.def_mask & ENCODE_CCODE);
-  // OpIT(kCondUlt, "");
-  LoadConstant(rl_result.reg, 0); /* cc */
-  FreeTemp(r_tmp);  // Now unneeded.
-
+  NewLIR4(kA64Csinc4rrrc, rl_result.reg.GetReg(), rwzr, rwzr, kArmCondNe);
   StoreValue(rl_dest, rl_result);
-
-  // Now, restore lr to its non-temp status.
-  Clobber(rs_rA64_LR);
-  UnmarkTemp(rs_rA64_LR);
   return true;
 }
 
@@ -770,6 +749,11 @@ void Arm64Mir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
   int len_offset = mirror::Array::LengthOffset().Int32Value();
   int data_offset;
   RegLocation rl_result;
+  const bool read_barrier = kUseBakerReadBarrier && size == kReference;
+  if (read_barrier) {
+    // The read barrier may call the runtime so everything to home locations.
+    FlushAllRegs();
+  }
   bool constant_index = rl_index.is_const;
   rl_array = LoadValue(rl_array, kRefReg);
   if (!constant_index) {
@@ -800,6 +784,10 @@ void Arm64Mir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
   } else {
     ForceImplicitNullCheck(rl_array.reg, opt_flags);
   }
+  RegStorage r_rb_state;
+  if (read_barrier) {
+    r_rb_state = GenReadBarrierLoadState(rl_array.reg, opt_flags);
+  }
   if (rl_dest.wide || rl_dest.fp || constant_index) {
     RegStorage reg_ptr;
     if (constant_index) {
@@ -822,6 +810,9 @@ void Arm64Mir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
     }
     LoadBaseDisp(reg_ptr, data_offset, rl_result.reg, size);
     MarkPossibleNullPointerException(opt_flags);
+    if (read_barrier) {
+      GenReadBarrierMark(r_rb_state, rl_result.reg);
+    }
     if (!constant_index) {
       FreeTemp(reg_ptr);
     }
@@ -844,6 +835,9 @@ void Arm64Mir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
     LoadBaseIndexed(reg_ptr, rl_index.reg, rl_result.reg, scale, size);
     MarkPossibleNullPointerException(opt_flags);
     FreeTemp(reg_ptr);
+    if (read_barrier) {
+      GenReadBarrierMark(r_rb_state, rl_result.reg);
+    }
     StoreValue(rl_dest, rl_result);
   }
 }
@@ -1041,4 +1041,87 @@ LIR* Arm64Mir2Lir::LoadBaseIndexedDisp(RegStorage r_base, RegStorage r_index, in
   return NULL;
 }
 
+/*
+ * ldr a, [base, #off]; ldr b, [base, #off + 1] => ldp a, b, [base, #off]
+ * str a, [base, #off]; str b, [base, #off + 1] => stp a, b, [base, #off]
+ * The offsets are scaled by the access size for both forms.
+ */
+bool Arm64Mir2Lir::MergeIntoPair(LIR* first_lir, LIR* second_lir) {
+  ArmOpcode opcode = static_cast<ArmOpcode>(first_lir->opcode);
+  ArmOpcode pair_opcode;
+  bool is_load = true;
+  switch (UNWIDE(opcode)) {
+    case kA64Ldr3rXD:
+      pair_opcode = kA64Ldp4rrXD;
+      break;
+    case kA64Ldr3fXD:
+      pair_opcode = kA64Ldp4ffXD;
+      break;
+    case kA64Str3rXD:
+      pair_opcode = kA64Stp4rrXD;
+      is_load = false;
+      break;
+    case kA64Str3fXD:
+      pair_opcode = kA64Stp4ffXD;
+      is_load = false;
+      break;
+    default:
+      return false;
+  }
+  const int base = first_lir->operands[1];
+  if (second_lir->opcode != opcode || second_lir->operands[1] != base) {
+    return false;
+  }
+  const int first_reg = first_lir->operands[0];
+  const int second_reg = second_lir->operands[0];
+  if (is_load && (first_reg == second_reg || first_reg == base)) {
+    // The pair can't load twice into a register, nor change the base of the second load.
+    return false;
+  }
+  const int first_offset = first_lir->operands[2];
+  const int second_offset = second_lir->operands[2];
+  LIR* pair_lir;
+  if (second_offset == first_offset + 1 && first_offset <= 63) {
+    pair_lir = RawLIR(second_lir->dalvik_offset, IS_WIDE(opcode) ? WIDE(pair_opcode) : pair_opcode,
+                      first_reg, second_reg, base, first_offset);
+  } else if (first_offset == second_offset + 1 && second_offset <= 63) {
+    pair_lir = RawLIR(second_lir->dalvik_offset, IS_WIDE(opcode) ? WIDE(pair_opcode) : pair_opcode,
+                      second_reg, first_reg, base, second_offset);
+  } else {
+    return false;
+  }
+  // Right after the second access, where a safepoint of an implicit null check may follow.
+  InsertLIRAfter(second_lir, pair_lir);
+  NopLIR(first_lir);
+  NopLIR(second_lir);
+  return true;
+}
+
+void Arm64Mir2Lir::ApplyPeephole(LIR* lir, LIR* tail_lir) {
+  LIR* next_lir = NextPeepholeLIR(lir, tail_lir);
+  if (next_lir == nullptr || next_lir->opcode != lir->opcode) {
+    return;
+  }
+  switch (UNWIDE(lir->opcode)) {
+    case kA64Ldr3rXD:
+    case kA64Ldr3fXD:
+    case kA64Str3rXD:
+    case kA64Str3fXD:
+      MergeIntoPair(lir, next_lir);
+      break;
+    case kA64Mov2rr:
+    case kA64Fmov2ff:
+      // mov a, b; mov b, a => mov a, b
+      // The 32 bit core move clears the high half of b, which may be needed.
+      if ((IS_WIDE(lir->opcode) || UNWIDE(lir->opcode) == kA64Fmov2ff) &&
+          next_lir->operands[0] == lir->operands[1] &&
+          next_lir->operands[1] == lir->operands[0]) {
+        NopLIR(next_lir);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
 }  // namespace art
@@ -287,6 +287,22 @@ void Mir2Lir::UpdateLIROffsets() {
   }
 }
 
+void Mir2Lir::DumpSlowPathSize() {
+  size_t hot_size = 0;
+  size_t slow_path_size = 0;
+  size_t* size = &hot_size;
+  for (LIR* lir = first_lir_insn_; lir != nullptr; lir = lir->next) {
+    if (!lir->flags.is_nop && !IsPseudoLirOp(lir->opcode)) {
+      *size += GetInsnSize(lir);
+    }
+    if (lir == first_slow_path_lir_) {
+      size = &slow_path_size;
+    }
+  }
+  LOG(INFO) << PrettyMethod(cu_->method_idx, *cu_->dex_file) << ": " << hot_size
+            << " bytes of code in the blocks, " << slow_path_size << " bytes in slow paths";
+}
+
 /* Dump instructions and constant pool contents */
 void Mir2Lir::CodegenDump() {
   LOG(INFO) << "Dumping LIR insns for "
@@ -734,6 +750,7 @@ void Mir2Lir::CreateNativeGcMap() {
         ": " << PrettyMethod(cu_->method_idx, *cu_->dex_file);
     native_gc_map_builder.AddEntry(native_offset, references);
   }
+  native_gc_map_builder.Build();
 }
 
 /* Determine the offset of each literal field */
@@ -972,7 +989,8 @@ Mir2Lir::Mir2Lir(CompilationUnit* cu, MIRGraph* mir_graph, ArenaAllocator* arena
       fp_spill_mask_(0),
       first_lir_insn_(NULL),
       last_lir_insn_(NULL),
-      slow_paths_(arena, 32, kGrowableArraySlowPaths) {
+      slow_paths_(arena, 32, kGrowableArraySlowPaths),
+      first_slow_path_lir_(nullptr) {
   // Reserve pointer id 0 for NULL.
   size_t null_idx = WrapPointer(NULL);
   DCHECK_EQ(null_idx, 0U);
@@ -1006,6 +1024,9 @@ void Mir2Lir::Materialize() {
     if ((cu_->enable_debug & (1 << kDebugCodegenDump)) != 0) {
       CodegenDump();
     }
+    if ((cu_->enable_debug & (1 << kDebugShowSlowPathSize)) != 0) {
+      DumpSlowPathSize();
+    }
   }
 }
 
@@ -81,6 +81,7 @@ const char* const DexFileMethodInliner::kClassCacheNames[] = {
     "Ljava/lang/Short;",       // kClassCacheJavaLangShort
     "Ljava/lang/Math;",        // kClassCacheJavaLangMath
     "Ljava/lang/StrictMath;",  // kClassCacheJavaLangStrictMath
+    "Ljava/lang/System;",      // kClassCacheJavaLangSystem
     "Ljava/lang/Thread;",      // kClassCacheJavaLangThread
     "Llibcore/io/Memory;",     // kClassCacheLibcoreIoMemory
     "Lsun/misc/Unsafe;",       // kClassCacheSunMiscUnsafe
@@ -88,6 +89,10 @@ const char* const DexFileMethodInliner::kClassCacheNames[] = {
 
 const char* const DexFileMethodInliner::kNameCacheNames[] = {
     "reverseBytes",          // kNameCacheReverseBytes
+    "numberOfLeadingZeros",  // kNameCacheNumberOfLeadingZeros
+    "numberOfTrailingZeros",  // kNameCacheNumberOfTrailingZeros
+    "rotateLeft",            // kNameCacheRotateLeft
+    "rotateRight",           // kNameCacheRotateRight
     "doubleToRawLongBits",   // kNameCacheDoubleToRawLongBits
     "longBitsToDouble",      // kNameCacheLongBitsToDouble
     "floatToRawIntBits",     // kNameCacheFloatToRawIntBits
@@ -101,7 +106,11 @@ const char* const DexFileMethodInliner::kNameCacheNames[] = {
     "isEmpty",               // kNameCacheIsEmpty
     "indexOf",               // kNameCacheIndexOf
     "length",                // kNameCacheLength
+    "equals",                // kNameCacheEquals
+    "hashCode",              // kNameCacheHashCode
+    "identityHashCode",      // kNameCacheIdentityHashCode
     "currentThread",         // kNameCacheCurrentThread
+    "arraycopy",             // kNameCacheArrayCopy
     "peekByte",              // kNameCachePeekByte
     "peekIntNative",         // kNameCachePeekIntNative
     "peekLongNative",        // kNameCachePeekLongNative
@@ -155,12 +164,19 @@ const DexFileMethodInliner::ProtoDef DexFileMethodInliner::kProtoCacheDefs[] = {
     { kClassCacheChar, 1, { kClassCacheInt } },
     // kProtoCacheString_I
     { kClassCacheInt, 1, { kClassCacheJavaLangString } },
+    // kProtoCacheObject_Z
+    { kClassCacheBoolean, 1, { kClassCacheJavaLangObject } },
+    // kProtoCacheObject_I
+    { kClassCacheInt, 1, { kClassCacheJavaLangObject } },
     // kProtoCache_Z
     { kClassCacheBoolean, 0, { } },
     // kProtoCache_I
     { kClassCacheInt, 0, { } },
     // kProtoCache_Thread
     { kClassCacheJavaLangThread, 0, { } },
+    // kProtoCacheObjectIObjectII_V
+    { kClassCacheVoid, 5, { kClassCacheJavaLangObject, kClassCacheInt,
+        kClassCacheJavaLangObject, kClassCacheInt, kClassCacheInt } },
     // kProtoCacheJ_B
     { kClassCacheByte, 1, { kClassCacheLong } },
     // kProtoCacheJ_I
@@ -211,6 +227,12 @@ const DexFileMethodInliner::IntrinsicDef DexFileMethodInliner::kIntrinsicMethods
     INTRINSIC(JavaLangInteger, ReverseBytes, I_I, kIntrinsicReverseBytes, k32),
     INTRINSIC(JavaLangLong, ReverseBytes, J_J, kIntrinsicReverseBytes, k64),
     INTRINSIC(JavaLangShort, ReverseBytes, S_S, kIntrinsicReverseBytes, kSignedHalf),
+    INTRINSIC(JavaLangInteger, NumberOfLeadingZeros, I_I, kIntrinsicNumberOfLeadingZeros, k32),
+    INTRINSIC(JavaLangLong, NumberOfLeadingZeros, J_I, kIntrinsicNumberOfLeadingZeros, k64),
+    INTRINSIC(JavaLangInteger, NumberOfTrailingZeros, I_I, kIntrinsicNumberOfTrailingZeros, k32),
+    INTRINSIC(JavaLangLong, NumberOfTrailingZeros, J_I, kIntrinsicNumberOfTrailingZeros, k64),
+    INTRINSIC(JavaLangInteger, RotateLeft, II_I, kIntrinsicRotate, kIntrinsicFlagLeft),
+    INTRINSIC(JavaLangInteger, RotateRight, II_I, kIntrinsicRotate, kIntrinsicFlagRight),
 
     INTRINSIC(JavaLangMath,       Abs, I_I, kIntrinsicAbsInt, 0),
     INTRINSIC(JavaLangStrictMath, Abs, I_I, kIntrinsicAbsInt, 0),
@@ -233,9 +255,16 @@ const DexFileMethodInliner::IntrinsicDef DexFileMethodInliner::kIntrinsicMethods
     INTRINSIC(JavaLangString, IndexOf, II_I, kIntrinsicIndexOf, kIntrinsicFlagNone),
     INTRINSIC(JavaLangString, IndexOf, I_I, kIntrinsicIndexOf, kIntrinsicFlagBase0),
     INTRINSIC(JavaLangString, Length, _I, kIntrinsicIsEmptyOrLength, kIntrinsicFlagLength),
+    INTRINSIC(JavaLangString, Equals, Object_Z, kIntrinsicStringEquals, 0),
+    INTRINSIC(JavaLangString, HashCode, _I, kIntrinsicStringHashCode, 0),
 
     INTRINSIC(JavaLangThread, CurrentThread, _Thread, kIntrinsicCurrentThread, 0),
 
+    INTRINSIC(JavaLangObject, HashCode, _I, kIntrinsicIdentityHashCode, 0),
+    INTRINSIC(JavaLangSystem, IdentityHashCode, Object_I, kIntrinsicIdentityHashCode, 0),
+
+    INTRINSIC(JavaLangSystem, ArrayCopy, ObjectIObjectII_V, kIntrinsicSystemArrayCopy, 0),
+
     INTRINSIC(LibcoreIoMemory, PeekByte, J_B, kIntrinsicPeek, kSignedByte),
     INTRINSIC(LibcoreIoMemory, PeekIntNative, J_I, kIntrinsicPeek, k32),
     INTRINSIC(LibcoreIoMemory, PeekLongNative, J_J, kIntrinsicPeek, k64),
@@ -315,6 +344,12 @@ bool DexFileMethodInliner::GenIntrinsic(Mir2Lir* backend, CallInfo* info) {
       return backend->GenInlinedFloatCvt(info);
     case kIntrinsicReverseBytes:
       return backend->GenInlinedReverseBytes(info, static_cast<OpSize>(intrinsic.d.data));
+    case kIntrinsicNumberOfLeadingZeros:
+      return backend->GenInlinedNumberOfLeadingZeros(info, intrinsic.d.data == k64);
+    case kIntrinsicNumberOfTrailingZeros:
+      return backend->GenInlinedNumberOfTrailingZeros(info, intrinsic.d.data == k64);
+    case kIntrinsicRotate:
+      return backend->GenInlinedRotate(info, intrinsic.d.data & kIntrinsicFlagLeft);
     case kIntrinsicAbsInt:
       return backend->GenInlinedAbsInt(info);
     case kIntrinsicAbsLong:
@@ -334,10 +369,18 @@ bool DexFileMethodInliner::GenIntrinsic(Mir2Lir* backend, CallInfo* info) {
     case kIntrinsicIsEmptyOrLength:
       return backend->GenInlinedStringIsEmptyOrLength(
           info, intrinsic.d.data & kIntrinsicFlagIsEmpty);
+    case kIntrinsicStringEquals:
+      return backend->GenInlinedStringEquals(info);
+    case kIntrinsicStringHashCode:
+      return backend->GenInlinedStringHashCode(info);
+    case kIntrinsicIdentityHashCode:
+      return backend->GenInlinedIdentityHashCode(info);
     case kIntrinsicIndexOf:
       return backend->GenInlinedIndexOf(info, intrinsic.d.data & kIntrinsicFlagBase0);
     case kIntrinsicCurrentThread:
       return backend->GenInlinedCurrentThread(info);
+    case kIntrinsicSystemArrayCopy:
+      return backend->GenInlinedArrayCopy(info);
     case kIntrinsicPeek:
       return backend->GenInlinedPeek(info, static_cast<OpSize>(intrinsic.d.data));
     case kIntrinsicPoke:
@@ -403,6 +446,10 @@ bool DexFileMethodInliner::GenInline(MIRGraph* mir_graph, BasicBlock* bb, MIR* i
       move_result = mir_graph->FindMoveResult(bb, invoke);
       result = GenInlineReturnArg(mir_graph, bb, invoke, move_result, method);
       break;
+    case kInlineOpBinaryOp:
+      move_result = mir_graph->FindMoveResult(bb, invoke);
+      result = GenInlineBinaryOp(mir_graph, bb, invoke, move_result, method);
+      break;
     case kInlineOpIGet:
       move_result = mir_graph->FindMoveResult(bb, invoke);
       result = GenInlineIGet(mir_graph, bb, invoke, move_result, method, method_idx);
@@ -619,6 +666,30 @@ bool DexFileMethodInliner::GenInlineReturnArg(MIRGraph* mir_graph, BasicBlock* b
   return true;
 }
 
+bool DexFileMethodInliner::GenInlineBinaryOp(MIRGraph* mir_graph, BasicBlock* bb, MIR* invoke,
+                                             MIR* move_result, const InlineMethod& method) {
+  if (move_result == nullptr) {
+    // Result is unused and the op doesn't throw.
+    return true;
+  }
+  DCHECK(move_result->dalvikInsn.opcode == Instruction::MOVE_RESULT);
+
+  // Insert the op, with the arguments of the invoke as its operands.
+  const InlineBinaryOpData& data = method.d.binary_op_data;
+  Instruction::Code opcode = static_cast<Instruction::Code>(data.opcode);
+  MIR* insn = AllocReplacementMIR(mir_graph, invoke, move_result);
+  insn->dalvikInsn.opcode = opcode;
+  insn->dalvikInsn.vA = move_result->dalvikInsn.vA;
+  insn->dalvikInsn.vB = GetInvokeReg(invoke, data.src1_arg);
+  if (Instruction::FormatOf(opcode) == Instruction::k23x) {
+    insn->dalvikInsn.vC = GetInvokeReg(invoke, data.src2_arg);
+  } else {
+    insn->dalvikInsn.vC = data.literal;
+  }
+  bb->InsertMIRAfter(move_result, insn);
+  return true;
+}
+
 bool DexFileMethodInliner::GenInlineIGet(MIRGraph* mir_graph, BasicBlock* bb, MIR* invoke,
                                          MIR* move_result, const InlineMethod& method,
                                          uint32_t method_idx) {
@@ -115,6 +115,7 @@ class DexFileMethodInliner {
       kClassCacheJavaLangShort,
       kClassCacheJavaLangMath,
       kClassCacheJavaLangStrictMath,
+      kClassCacheJavaLangSystem,
       kClassCacheJavaLangThread,
       kClassCacheLibcoreIoMemory,
       kClassCacheSunMiscUnsafe,
@@ -129,6 +130,10 @@ class DexFileMethodInliner {
     enum NameCacheIndex : uint8_t {  // unit8_t to save space, make larger if needed
       kNameCacheFirst = 0,
       kNameCacheReverseBytes = kNameCacheFirst,
+      kNameCacheNumberOfLeadingZeros,
+      kNameCacheNumberOfTrailingZeros,
+      kNameCacheRotateLeft,
+      kNameCacheRotateRight,
       kNameCacheDoubleToRawLongBits,
       kNameCacheLongBitsToDouble,
       kNameCacheFloatToRawIntBits,
@@ -142,7 +147,11 @@ class DexFileMethodInliner {
       kNameCacheIsEmpty,
       kNameCacheIndexOf,
       kNameCacheLength,
+      kNameCacheEquals,
+      kNameCacheHashCode,
+      kNameCacheIdentityHashCode,
       kNameCacheCurrentThread,
+      kNameCacheArrayCopy,
       kNameCachePeekByte,
       kNameCachePeekIntNative,
       kNameCachePeekLongNative,
@@ -191,9 +200,12 @@ class DexFileMethodInliner {
       kProtoCacheII_I,
       kProtoCacheI_C,
       kProtoCacheString_I,
+      kProtoCacheObject_Z,
+      kProtoCacheObject_I,
       kProtoCache_Z,
       kProtoCache_I,
       kProtoCache_Thread,
+      kProtoCacheObjectIObjectII_V,
       kProtoCacheJ_B,
       kProtoCacheJ_I,
       kProtoCacheJ_S,
@@ -299,6 +311,8 @@ class DexFileMethodInliner {
                                MIR* move_result, const InlineMethod& method);
     static bool GenInlineReturnArg(MIRGraph* mir_graph, BasicBlock* bb, MIR* invoke,
                                    MIR* move_result, const InlineMethod& method);
+    static bool GenInlineBinaryOp(MIRGraph* mir_graph, BasicBlock* bb, MIR* invoke,
+                                  MIR* move_result, const InlineMethod& method);
     static bool GenInlineIGet(MIRGraph* mir_graph, BasicBlock* bb, MIR* invoke,
                               MIR* move_result, const InlineMethod& method, uint32_t method_idx);
     static bool GenInlineIPut(MIRGraph* mir_graph, BasicBlock* bb, MIR* invoke,
@@ -21,6 +21,7 @@
 #include "mirror/array.h"
 #include "mirror/object_array-inl.h"
 #include "mirror/object-inl.h"
+#include "read_barrier.h"
 #include "verifier/method_verifier.h"
 #include <functional>
 
@@ -659,8 +660,13 @@ void Mir2Lir::GenSget(MIR* mir, RegLocation rl_dest,
   if (!SLOW_FIELD_PATH && field_info.FastGet() &&
       (!field_info.IsVolatile() || SupportsVolatileLoadStore(load_size))) {
     DCHECK_GE(field_info.FieldOffset().Int32Value(), 0);
+    const bool read_barrier = kUseBakerReadBarrier && is_object;
     RegStorage r_base;
     if (field_info.IsReferrersClass()) {
+      if (read_barrier) {
+        // The read barrier may call the runtime so everything to home locations.
+        FlushAllRegs();
+      }
       // Fast path, static storage base is this method's class
       RegLocation rl_method  = LoadCurrMethod();
       r_base = AllocTempRef();
@@ -705,6 +711,10 @@ void Mir2Lir::GenSget(MIR* mir, RegLocation rl_dest,
       FreeTemp(r_method);
     }
     // r_base now holds static storage base
+    RegStorage r_rb_state;
+    if (read_barrier) {
+      r_rb_state = GenReadBarrierLoadState(r_base, MIR_IGNORE_NULL_CHECK);
+    }
     RegisterClass reg_class = RegClassForFieldLoadStore(load_size, field_info.IsVolatile());
     RegLocation rl_result = EvalLoc(rl_dest, reg_class, true);
 
@@ -719,6 +729,9 @@ void Mir2Lir::GenSget(MIR* mir, RegLocation rl_dest,
       LoadBaseDisp(r_base, field_offset, rl_result.reg, load_size);
     }
     FreeTemp(r_base);
+    if (read_barrier) {
+      GenReadBarrierMark(r_rb_state, rl_result.reg);
+    }
 
     if (is_long_or_double) {
       StoreValueWide(rl_dest, rl_result);
@@ -745,6 +758,8 @@ void Mir2Lir::GenSget(MIR* mir, RegLocation rl_dest,
 // Generate code for all slow paths.
 void Mir2Lir::HandleSlowPaths() {
   int n = slow_paths_.Size();
+  // Everything after this is out of the hot code, see ReportSlowPathSize().
+  first_slow_path_lir_ = (n != 0) ? last_lir_insn_ : nullptr;
   for (int i = 0; i < n; ++i) {
     LIRSlowPath* slowpath = slow_paths_.Get(i);
     slowpath->Compile();
@@ -773,8 +788,17 @@ void Mir2Lir::GenIGet(MIR* mir, int opt_flags, OpSize size,
       (!field_info.IsVolatile() || SupportsVolatileLoadStore(load_size))) {
     RegisterClass reg_class = RegClassForFieldLoadStore(load_size, field_info.IsVolatile());
     DCHECK_GE(field_info.FieldOffset().Int32Value(), 0);
+    const bool read_barrier = kUseBakerReadBarrier && is_object;
+    if (read_barrier) {
+      // The read barrier may call the runtime so everything to home locations.
+      FlushAllRegs();
+    }
     rl_obj = LoadValue(rl_obj, kRefReg);
     GenNullCheck(rl_obj.reg, opt_flags);
+    RegStorage r_rb_state;
+    if (read_barrier) {
+      r_rb_state = GenReadBarrierLoadState(rl_obj.reg, opt_flags);
+    }
     RegLocation rl_result = EvalLoc(rl_dest, reg_class, true);
     int field_offset = field_info.FieldOffset().Int32Value();
     if (field_info.IsVolatile()) {
@@ -788,6 +812,9 @@ void Mir2Lir::GenIGet(MIR* mir, int opt_flags, OpSize size,
       LoadBaseDisp(rl_obj.reg, field_offset, rl_result.reg, load_size);
       MarkPossibleNullPointerException(opt_flags);
     }
+    if (read_barrier) {
+      GenReadBarrierMark(r_rb_state, rl_result.reg);
+    }
     if (is_long_or_double) {
       StoreValueWide(rl_dest, rl_result);
     } else {
@@ -809,6 +836,49 @@ void Mir2Lir::GenIGet(MIR* mir, int opt_flags, OpSize size,
   }
 }
 
+class ReadBarrierMarkSlowPath : public Mir2Lir::LIRSlowPath {
+ public:
+  ReadBarrierMarkSlowPath(Mir2Lir* m2l, LIR* branch, LIR* cont, RegStorage r_ref) :
+    LIRSlowPath(m2l, m2l->GetCurrentDexPc(), branch, cont), r_ref_(r_ref) {
+  }
+
+  void Compile() {
+    GenerateTargetLabel();
+    // Marking neither suspends nor throws, no safepoint is needed.
+    if (Is64BitInstructionSet(cu_->instruction_set)) {
+      m2l_->CallRuntimeHelperReg(QUICK_ENTRYPOINT_OFFSET(8, pReadBarrierMark), r_ref_, false);
+    } else {
+      m2l_->CallRuntimeHelperReg(QUICK_ENTRYPOINT_OFFSET(4, pReadBarrierMark), r_ref_, false);
+    }
+    m2l_->OpRegCopy(r_ref_, m2l_->TargetReg(kRet0));
+    m2l_->OpUnconditionalBranch(cont_);
+  }
+
+ private:
+  const RegStorage r_ref_;
+};
+
+RegStorage Mir2Lir::GenReadBarrierLoadState(RegStorage r_holder, int opt_flags) {
+  DCHECK(kUseBakerReadBarrier);
+  RegStorage r_state = AllocTemp();
+  Load32Disp(r_holder, mirror::Object::ReadBarrierPointerOffset().Int32Value(), r_state);
+  MarkPossibleNullPointerException(opt_flags);
+  // The collector forwards the references of a gray object before turning it white, so the state
+  // must be loaded before the reference.
+  GenMemBarrier(kLoadLoad);
+  return r_state;
+}
+
+void Mir2Lir::GenReadBarrierMark(RegStorage r_state, RegStorage r_ref) {
+  DCHECK(kUseBakerReadBarrier);
+  LIR* branch = OpCmpImmBranch(kCondEq, r_state, ReadBarrier::kGrayState, nullptr);
+  FreeTemp(r_state);
+  LIR* cont = NewLIR0(kPseudoTargetLabel);
+  AddSlowPath(new (arena_) ReadBarrierMarkSlowPath(this, branch, cont, r_ref));
+  // The slow path clobbers the caller save registers, only r_ref is valid after it.
+  ClobberAllTemps();
+}
+
 template <size_t pointer_size>
 static void GenIputCall(Mir2Lir* mir_to_lir, bool is_long_or_double, bool is_object,
                         const MirIFieldLoweringInfo* field_info, RegLocation rl_obj,
@@ -1028,6 +1098,11 @@ void Mir2Lir::GenConstString(uint32_t string_idx, RegLocation rl_dest) {
   }
 }
 
+bool Mir2Lir::GenInlinedNewInstance(uintptr_t direct_type_ptr) {
+  // The target always calls the entrypoint.
+  return false;
+}
+
 template <size_t pointer_size>
 static void GenNewInstanceImpl(Mir2Lir* mir_to_lir, CompilationUnit* cu, uint32_t type_idx,
                                RegLocation rl_dest) {
@@ -1055,7 +1130,9 @@ static void GenNewInstanceImpl(Mir2Lir* mir_to_lir, CompilationUnit* cu, uint32_
           mir_to_lir->CallRuntimeHelperRegMethod(func_offset, mir_to_lir->TargetReg(kArg0), true);
         } else {
           func_offset = QUICK_ENTRYPOINT_OFFSET(pointer_size, pAllocObjectInitialized);
-          mir_to_lir->CallRuntimeHelperRegMethod(func_offset, mir_to_lir->TargetReg(kArg0), true);
+          if (!mir_to_lir->GenInlinedNewInstance(0)) {
+            mir_to_lir->CallRuntimeHelperRegMethod(func_offset, mir_to_lir->TargetReg(kArg0), true);
+          }
         }
       } else {
         // Use the direct pointer.
@@ -1064,7 +1141,9 @@ static void GenNewInstanceImpl(Mir2Lir* mir_to_lir, CompilationUnit* cu, uint32_
           mir_to_lir->CallRuntimeHelperImmMethod(func_offset, direct_type_ptr, true);
         } else {
           func_offset = QUICK_ENTRYPOINT_OFFSET(pointer_size, pAllocObjectInitialized);
-          mir_to_lir->CallRuntimeHelperImmMethod(func_offset, direct_type_ptr, true);
+          if (!mir_to_lir->GenInlinedNewInstance(direct_type_ptr)) {
+            mir_to_lir->CallRuntimeHelperImmMethod(func_offset, direct_type_ptr, true);
+          }
         }
       }
     } else {
@@ -1103,6 +1182,41 @@ void Mir2Lir::GenThrow(RegLocation rl_src) {
   }
 }
 
+void Mir2Lir::AddInitializeTypeSlowPath(LIR* branch, LIR* cont, uint32_t type_idx,
+                                        RegStorage class_reg) {
+  // Slow path to initialize the type.  Executed if the type is NULL.
+  class SlowPath : public LIRSlowPath {
+   public:
+    SlowPath(Mir2Lir* m2l, LIR* fromfast, LIR* cont, const int type_idx,
+             const RegStorage class_reg) :
+               LIRSlowPath(m2l, m2l->GetCurrentDexPc(), fromfast, cont), type_idx_(type_idx),
+               class_reg_(class_reg) {
+    }
+
+    void Compile() {
+      GenerateTargetLabel();
+
+      // Call out to helper, which will return resolved type in kArg0
+      // InitializeTypeFromCode(idx, method)
+      if (Is64BitInstructionSet(m2l_->cu_->instruction_set)) {
+        m2l_->CallRuntimeHelperImmReg(QUICK_ENTRYPOINT_OFFSET(8, pInitializeType), type_idx_,
+                                      m2l_->TargetReg(kArg1), true);
+      } else {
+        m2l_->CallRuntimeHelperImmReg(QUICK_ENTRYPOINT_OFFSET(4, pInitializeType), type_idx_,
+                                      m2l_->TargetReg(kArg1), true);
+      }
+      m2l_->OpRegCopy(class_reg_, m2l_->TargetReg(kRet0));  // Align usage with fast path
+      m2l_->OpUnconditionalBranch(cont_);
+    }
+
+   public:
+    const int type_idx_;
+    const RegStorage class_reg_;
+  };
+
+  AddSlowPath(new (arena_) SlowPath(this, branch, cont, type_idx, class_reg));
+}
+
 // For final classes there are no sub-classes to check and so we can answer the instance-of
 // question with simple comparisons.
 void Mir2Lir::GenInstanceofFinal(bool use_declaring_class, uint32_t type_idx, RegLocation rl_dest,
@@ -1159,6 +1273,53 @@ void Mir2Lir::GenInstanceofFinal(bool use_declaring_class, uint32_t type_idx, Re
   StoreValue(rl_dest, rl_result);
 }
 
+// For classes which are neither interfaces nor arrays the instances are the objects with the class
+// in their superclass chain, which is walked inline.
+void Mir2Lir::GenInstanceofSubclass(bool use_declaring_class, uint32_t type_idx,
+                                    RegLocation rl_dest, RegLocation rl_src) {
+  RegLocation object = LoadValue(rl_src, kRefReg);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  RegStorage result_reg = rl_result.reg;
+  if (result_reg == object.reg) {
+    result_reg = AllocTypedTemp(false, kCoreReg);
+  }
+  LoadConstant(result_reg, 0);     // assume false
+  LIR* null_branchover = OpCmpImmBranch(kCondEq, object.reg, 0, NULL);
+
+  RegStorage check_class = AllocTypedTemp(false, kRefReg);
+  RegStorage object_class = AllocTypedTemp(false, kRefReg);
+
+  LoadCurrMethodDirect(check_class);
+  if (use_declaring_class) {
+    LoadRefDisp(check_class, mirror::ArtMethod::DeclaringClassOffset().Int32Value(), check_class);
+    LoadRefDisp(object.reg,  mirror::Object::ClassOffset().Int32Value(), object_class);
+  } else {
+    LoadRefDisp(check_class, mirror::ArtMethod::DexCacheResolvedTypesOffset().Int32Value(),
+                check_class);
+    LoadRefDisp(object.reg,  mirror::Object::ClassOffset().Int32Value(), object_class);
+    int32_t offset_of_type = ClassArray::OffsetOfElement(type_idx).Int32Value();
+    LoadRefDisp(check_class, offset_of_type, check_class);
+  }
+
+  LIR* loop = NewLIR0(kPseudoTargetLabel);
+  LIR* found_branch = OpCmpBranch(kCondEq, check_class, object_class, NULL);
+  LoadRefDisp(object_class, mirror::Class::SuperClassOffset().Int32Value(), object_class);
+  OpCmpImmBranch(kCondNe, object_class, 0, loop);
+  LIR* not_found_branch = OpUnconditionalBranch(NULL);
+  found_branch->target = NewLIR0(kPseudoTargetLabel);
+  LoadConstant(result_reg, 1);
+  LIR* target = NewLIR0(kPseudoTargetLabel);
+  null_branchover->target = target;
+  not_found_branch->target = target;
+  FreeTemp(object_class);
+  FreeTemp(check_class);
+  if (IsTemp(result_reg)) {
+    OpRegCopy(rl_result.reg, result_reg);
+    FreeTemp(result_reg);
+  }
+  StoreValue(rl_dest, rl_result);
+}
+
 void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_known_final,
                                          bool type_known_abstract, bool use_declaring_class,
                                          bool can_assume_type_is_in_dex_cache,
@@ -1183,35 +1344,24 @@ void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_know
                            type_idx, true);
     }
     OpRegCopy(class_reg, TargetReg(kRet0));  // Align usage with fast path
-    LoadValueDirectFixed(rl_src, TargetReg(kArg0));  // kArg0 <= ref
   } else if (use_declaring_class) {
-    LoadValueDirectFixed(rl_src, TargetReg(kArg0));  // kArg0 <= ref
     LoadRefDisp(TargetReg(kArg1), mirror::ArtMethod::DeclaringClassOffset().Int32Value(),
                  class_reg);
   } else {
     // Load dex cache entry into class_reg (kArg2)
-    LoadValueDirectFixed(rl_src, TargetReg(kArg0));  // kArg0 <= ref
     LoadRefDisp(TargetReg(kArg1), mirror::ArtMethod::DexCacheResolvedTypesOffset().Int32Value(),
                 class_reg);
     int32_t offset_of_type = ClassArray::OffsetOfElement(type_idx).Int32Value();
     LoadRefDisp(class_reg, offset_of_type, class_reg);
     if (!can_assume_type_is_in_dex_cache) {
-      // Need to test presence of type in dex cache at runtime
-      LIR* hop_branch = OpCmpImmBranch(kCondNe, class_reg, 0, NULL);
-      // Not resolved
-      // Call out to helper, which will return resolved type in kRet0
-      if (Is64BitInstructionSet(cu_->instruction_set)) {
-        CallRuntimeHelperImm(QUICK_ENTRYPOINT_OFFSET(8, pInitializeType), type_idx, true);
-      } else {
-        CallRuntimeHelperImm(QUICK_ENTRYPOINT_OFFSET(4, pInitializeType), type_idx, true);
-      }
-      OpRegCopy(TargetReg(kArg2), TargetReg(kRet0));  // Align usage with fast path
-      LoadValueDirectFixed(rl_src, TargetReg(kArg0));  /* reload Ref */
-      // Rejoin code paths
-      LIR* hop_target = NewLIR0(kPseudoTargetLabel);
-      hop_branch->target = hop_target;
+      // Need to test presence of type in dex cache at runtime, resolve it out of line if not.
+      LIR* hop_branch = OpCmpImmBranch(kCondEq, class_reg, 0, NULL);
+      LIR* cont = NewLIR0(kPseudoTargetLabel);
+      AddInitializeTypeSlowPath(hop_branch, cont, type_idx, class_reg);
     }
   }
+  // At this point, class_reg (kArg2) has class
+  LoadValueDirectFixed(rl_src, TargetReg(kArg0));  // kArg0 <= ref
   /* kArg0 is ref, kArg2 is class. If ref==null, use directly as bool result */
   RegLocation rl_result = GetReturn(kRefReg);
   if (cu_->instruction_set == kMips) {
@@ -1282,18 +1432,18 @@ void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_know
 }
 
 void Mir2Lir::GenInstanceof(uint32_t type_idx, RegLocation rl_dest, RegLocation rl_src) {
-  bool type_known_final, type_known_abstract, use_declaring_class;
-  bool needs_access_check = !cu_->compiler_driver->CanAccessTypeWithoutChecks(cu_->method_idx,
-                                                                              *cu_->dex_file,
-                                                                              type_idx,
-                                                                              &type_known_final,
-                                                                              &type_known_abstract,
-                                                                              &use_declaring_class);
+  bool type_known_final, type_known_abstract, use_declaring_class, type_known_subclass_test;
+  bool needs_access_check = !cu_->compiler_driver->CanAccessTypeWithoutChecks(
+      cu_->method_idx, *cu_->dex_file, type_idx, &type_known_final, &type_known_abstract,
+      &use_declaring_class, &type_known_subclass_test);
   bool can_assume_type_is_in_dex_cache = !needs_access_check &&
       cu_->compiler_driver->CanAssumeTypeIsPresentInDexCache(*cu_->dex_file, type_idx);
 
   if ((use_declaring_class || can_assume_type_is_in_dex_cache) && type_known_final) {
     GenInstanceofFinal(use_declaring_class, type_idx, rl_dest, rl_src);
+  } else if ((use_declaring_class || can_assume_type_is_in_dex_cache) &&
+             type_known_subclass_test) {
+    GenInstanceofSubclass(use_declaring_class, type_idx, rl_dest, rl_src);
   } else {
     GenInstanceofCallingHelper(needs_access_check, type_known_final, type_known_abstract,
                                use_declaring_class, can_assume_type_is_in_dex_cache,
@@ -1302,13 +1452,10 @@ void Mir2Lir::GenInstanceof(uint32_t type_idx, RegLocation rl_dest, RegLocation
 }
 
 void Mir2Lir::GenCheckCast(uint32_t insn_idx, uint32_t type_idx, RegLocation rl_src) {
-  bool type_known_final, type_known_abstract, use_declaring_class;
-  bool needs_access_check = !cu_->compiler_driver->CanAccessTypeWithoutChecks(cu_->method_idx,
-                                                                              *cu_->dex_file,
-                                                                              type_idx,
-                                                                              &type_known_final,
-                                                                              &type_known_abstract,
-                                                                              &use_declaring_class);
+  bool type_known_final, type_known_abstract, use_declaring_class, type_known_subclass_test;
+  bool needs_access_check = !cu_->compiler_driver->CanAccessTypeWithoutChecks(
+      cu_->method_idx, *cu_->dex_file, type_idx, &type_known_final, &type_known_abstract,
+      &use_declaring_class, &type_known_subclass_test);
   // Note: currently type_known_final is unused, as optimizing will only improve the performance
   // of the exception throw path.
   DexCompilationUnit* cu = mir_graph_->GetCurrentDexCompilationUnit();
@@ -1346,38 +1493,7 @@ void Mir2Lir::GenCheckCast(uint32_t insn_idx, uint32_t type_idx, RegLocation rl_
       // Need to test presence of type in dex cache at runtime
       LIR* hop_branch = OpCmpImmBranch(kCondEq, class_reg, 0, NULL);
       LIR* cont = NewLIR0(kPseudoTargetLabel);
-
-      // Slow path to initialize the type.  Executed if the type is NULL.
-      class SlowPath : public LIRSlowPath {
-       public:
-        SlowPath(Mir2Lir* m2l, LIR* fromfast, LIR* cont, const int type_idx,
-                 const RegStorage class_reg) :
-                   LIRSlowPath(m2l, m2l->GetCurrentDexPc(), fromfast, cont), type_idx_(type_idx),
-                   class_reg_(class_reg) {
-        }
-
-        void Compile() {
-          GenerateTargetLabel();
-
-          // Call out to helper, which will return resolved type in kArg0
-          // InitializeTypeFromCode(idx, method)
-          if (Is64BitInstructionSet(m2l_->cu_->instruction_set)) {
-            m2l_->CallRuntimeHelperImmReg(QUICK_ENTRYPOINT_OFFSET(8, pInitializeType), type_idx_,
-                                          m2l_->TargetReg(kArg1), true);
-          } else {
-            m2l_->CallRuntimeHelperImmReg(QUICK_ENTRYPOINT_OFFSET(4, pInitializeType), type_idx_,
-                                                      m2l_->TargetReg(kArg1), true);
-          }
-          m2l_->OpRegCopy(class_reg_, m2l_->TargetReg(kRet0));  // Align usage with fast path
-          m2l_->OpUnconditionalBranch(cont_);
-        }
-
-       public:
-        const int type_idx_;
-        const RegStorage class_reg_;
-      };
-
-      AddSlowPath(new (arena_) SlowPath(this, hop_branch, cont, type_idx, class_reg));
+      AddInitializeTypeSlowPath(hop_branch, cont, type_idx, class_reg);
     }
   }
   // At this point, class_reg (kArg2) has class
@@ -1413,7 +1529,24 @@ void Mir2Lir::GenCheckCast(uint32_t insn_idx, uint32_t type_idx, RegLocation rl_
     const bool load_;
   };
 
-  if (type_known_abstract) {
+  if (type_known_subclass_test && !type_known_final) {
+    // Walk the superclass chain inline, only a failing cast calls the helper to throw.
+    LIR* branch1 = OpCmpImmBranch(kCondEq, TargetReg(kArg0), 0, NULL);
+    LoadRefDisp(TargetReg(kArg0), mirror::Object::ClassOffset().Int32Value(), TargetReg(kArg1));
+    LIR* loop = NewLIR0(kPseudoTargetLabel);
+    LIR* found_branch = OpCmpBranch(kCondEq, TargetReg(kArg1), class_reg, NULL);
+    LoadRefDisp(TargetReg(kArg1), mirror::Class::SuperClassOffset().Int32Value(),
+                TargetReg(kArg1));
+    OpCmpImmBranch(kCondNe, TargetReg(kArg1), 0, loop);
+    LIR* branch2 = OpUnconditionalBranch(NULL);
+    LIR* cont = NewLIR0(kPseudoTargetLabel);
+
+    // The walk ended at null, the slow path reloads the class of the object.
+    AddSlowPath(new (arena_) SlowPath(this, branch2, cont, true));
+
+    branch1->target = cont;
+    found_branch->target = cont;
+  } else if (type_known_abstract) {
     // Easier case, run slow path if target is non-null (slow path will load from target)
     LIR* branch = OpCmpImmBranch(kCondNe, TargetReg(kArg0), 0, NULL);
     LIR* cont = NewLIR0(kPseudoTargetLabel);
@@ -21,6 +21,7 @@
 #include "dex_file-inl.h"
 #include "entrypoints/quick/quick_entrypoints.h"
 #include "invoke_type.h"
+#include "lock_word.h"
 #include "mirror/array.h"
 #include "mirror/object_array-inl.h"
 #include "mirror/string.h"
@@ -1529,6 +1530,282 @@ bool Mir2Lir::GenInlinedStringCompareTo(CallInfo* info) {
   return true;
 }
 
+/* Fast String.equals(Ljava/lang/Object;)Z. */
+bool Mir2Lir::GenInlinedStringEquals(CallInfo* info) {
+  ClobberCallerSave();
+  LockCallTemps();  // Using fixed registers
+  RegStorage reg_this = TargetReg(kArg0);
+  RegStorage reg_cmp = TargetReg(kArg1);
+  RegStorage reg_count = TargetReg(kArg2);
+  RegStorage reg_tmp = TargetReg(kArg3);
+  RegStorage reg_result = TargetReg(kRet0);
+
+  LoadValueDirectFixed(info->args[0], reg_this);
+  LoadValueDirectFixed(info->args[1], reg_cmp);
+  GenExplicitNullCheck(reg_this, info->opt_flags);
+  info->opt_flags |= MIR_IGNORE_NULL_CHECK;  // Record that we've null checked.
+  LIR* true_branches[2];
+  LIR* false_branches[4];
+  true_branches[0] = OpCmpBranch(kCondEq, reg_this, reg_cmp, nullptr);
+  false_branches[0] = OpCmpImmBranch(kCondEq, reg_cmp, 0, nullptr);
+  // String is final, an object of another class isn't a String.
+  int32_t class_offset = mirror::Object::ClassOffset().Int32Value();
+  LoadRefDisp(reg_this, class_offset, reg_count);
+  LoadRefDisp(reg_cmp, class_offset, reg_tmp);
+  false_branches[1] = OpCmpBranch(kCondNe, reg_count, reg_tmp, nullptr);
+  int32_t count_offset = mirror::String::CountOffset().Int32Value();
+  Load32Disp(reg_this, count_offset, reg_count);
+  Load32Disp(reg_cmp, count_offset, reg_tmp);
+  false_branches[2] = OpCmpBranch(kCondNe, reg_count, reg_tmp, nullptr);
+  true_branches[1] = OpCmpImmBranch(kCondEq, reg_count, 0, nullptr);
+
+  // The address of the first char of each string, value + data offset + 2 * offset. The heap is
+  // in the low 4GB, so the 32-bit arithmetic also gives the pointers on 64-bit targets.
+  int32_t value_offset = mirror::String::ValueOffset().Int32Value();
+  int32_t offset_offset = mirror::String::OffsetOffset().Int32Value();
+  int32_t data_offset = mirror::Array::DataOffset(sizeof(uint16_t)).Int32Value();
+  for (RegStorage reg_str : { reg_this, reg_cmp }) {
+    Load32Disp(reg_str, offset_offset, reg_tmp);
+    LoadRefDisp(reg_str, value_offset, reg_str);
+    OpRegRegImm(kOpLsl, reg_tmp, reg_tmp, 1);
+    OpRegReg(kOpAdd, reg_str, reg_tmp);
+    OpRegImm(kOpAdd, reg_str, data_offset);
+  }
+  // NOTE: not a safepoint
+  if (cu_->instruction_set != kX86 && cu_->instruction_set != kX86_64) {
+    if (Is64BitInstructionSet(cu_->instruction_set)) {
+      OpReg(kOpBlx, LoadHelper(QUICK_ENTRYPOINT_OFFSET(8, pMemcmp16)));
+    } else {
+      OpReg(kOpBlx, LoadHelper(QUICK_ENTRYPOINT_OFFSET(4, pMemcmp16)));
+    }
+  } else {
+    if (Is64BitInstructionSet(cu_->instruction_set)) {
+      OpThreadMem(kOpBlx, QUICK_ENTRYPOINT_OFFSET(8, pMemcmp16));
+    } else {
+      OpThreadMem(kOpBlx, QUICK_ENTRYPOINT_OFFSET(4, pMemcmp16));
+    }
+  }
+  false_branches[3] = OpCmpImmBranch(kCondNe, reg_result, 0, nullptr);
+
+  LIR* true_target = NewLIR0(kPseudoTargetLabel);
+  LoadConstant(reg_result, 1);
+  LIR* done_branch = OpUnconditionalBranch(nullptr);
+  LIR* false_target = NewLIR0(kPseudoTargetLabel);
+  LoadConstant(reg_result, 0);
+  done_branch->target = NewLIR0(kPseudoTargetLabel);
+  for (LIR* branch : true_branches) {
+    branch->target = true_target;
+  }
+  for (LIR* branch : false_branches) {
+    branch->target = false_target;
+  }
+  RegLocation rl_return = GetReturn(kCoreReg);
+  RegLocation rl_dest = InlineTarget(info);
+  StoreValue(rl_dest, rl_return);
+  return true;
+}
+
+/* Fast String.hashCode()I, for a hash code that the Java method has already computed. */
+bool Mir2Lir::GenInlinedStringHashCode(CallInfo* info) {
+  ClobberCallerSave();
+  LockCallTemps();  // Using fixed registers
+  RegStorage reg_this = TargetReg(kArg0);
+  RegStorage reg_result = TargetReg(kRet0);
+
+  LoadValueDirectFixed(info->args[0], reg_this);
+  GenNullCheck(reg_this, info->opt_flags);
+  Load32Disp(reg_this, mirror::String::HashCodeOffset().Int32Value(), reg_result);
+  MarkPossibleNullPointerException(info->opt_flags);
+  // 0 means not computed yet, the slow path computes and caches it.
+  LIR* not_computed_branch = OpCmpImmBranch(kCondEq, reg_result, 0, nullptr);
+  LIR* resume_tgt = NewLIR0(kPseudoTargetLabel);
+  info->opt_flags |= MIR_IGNORE_NULL_CHECK;  // Record that we've null checked.
+  AddIntrinsicSlowPath(info, not_computed_branch, resume_tgt);
+  RegLocation rl_return = GetReturn(kCoreReg);
+  RegLocation rl_dest = InlineTarget(info);
+  StoreValue(rl_dest, rl_return);
+  return true;
+}
+
+/*
+ * Fast System.identityHashCode(Ljava/lang/Object;)I and Object.hashCode()I, for an object whose
+ * lock word holds the hash code. The runtime handles the other lock states and null.
+ */
+bool Mir2Lir::GenInlinedIdentityHashCode(CallInfo* info) {
+  if (cu_->instruction_set == kX86_64) {
+    // TODO - add x86-64 implementation
+    return false;
+  }
+  bool is_static = (info->type == kStatic);
+  if (!is_static && info->type != kDirect && info->type != kSuper) {
+    // A virtual call of Object.hashCode() may reach an override.
+    return false;
+  }
+  ClobberCallerSave();
+  LockCallTemps();  // Using fixed registers
+  RegStorage reg_obj = TargetReg(kArg0);
+  RegStorage reg_state = TargetReg(kArg1);
+  RegStorage reg_result = TargetReg(kRet0);
+
+  LoadValueDirectFixed(info->args[0], reg_obj);
+  LIR* null_branch = nullptr;
+  if (is_static) {
+    // identityHashCode(null) is 0.
+    LoadConstant(reg_result, 0);
+    null_branch = OpCmpImmBranch(kCondEq, reg_obj, 0, nullptr);
+  } else {
+    GenNullCheck(reg_obj, info->opt_flags);
+  }
+  Load32Disp(reg_obj, mirror::Object::MonitorOffset().Int32Value(), reg_result);
+  if (!is_static) {
+    MarkPossibleNullPointerException(info->opt_flags);
+    info->opt_flags |= MIR_IGNORE_NULL_CHECK;  // Record that we've null checked.
+  }
+  OpRegRegImm(kOpLsr, reg_state, reg_result, LockWord::kStateShift);
+  LIR* not_hashed_branch = OpCmpImmBranch(kCondNe, reg_state, LockWord::kStateHash, nullptr);
+  // Clear the state bits.
+  OpRegRegImm(kOpLsl, reg_result, reg_result, LockWord::kStateSize);
+  OpRegRegImm(kOpLsr, reg_result, reg_result, LockWord::kStateSize);
+  LIR* resume_tgt = NewLIR0(kPseudoTargetLabel);
+  if (null_branch != nullptr) {
+    null_branch->target = resume_tgt;
+  }
+  AddIntrinsicSlowPath(info, not_hashed_branch, resume_tgt);
+  RegLocation rl_return = GetReturn(kCoreReg);
+  RegLocation rl_dest = InlineTarget(info);
+  StoreValue(rl_dest, rl_return);
+  return true;
+}
+
+/*
+ * Fast System.arraycopy(Ljava/lang/Object;ILjava/lang/Object;II)V. Copies between two distinct
+ * arrays of the same class with memcpy, the native method handles the other cases and throws.
+ */
+bool Mir2Lir::GenInlinedArrayCopy(CallInfo* info) {
+  if (Is64BitInstructionSet(cu_->instruction_set)) {
+    // TODO - pass 64-bit pointers to memcpy.
+    return false;
+  }
+  RegLocation rl_src = info->args[0];
+  RegLocation rl_src_pos = info->args[1];
+  RegLocation rl_dst = info->args[2];
+  RegLocation rl_dst_pos = info->args[3];
+  RegLocation rl_length = info->args[4];
+  if (rl_length.is_const && mir_graph_->ConstantValue(rl_length) < 0) {
+    return false;  // Always throws.
+  }
+
+  ClobberCallerSave();
+  LockCallTemps();  // Using fixed registers
+  RegStorage reg_dst = TargetReg(kArg0);
+  RegStorage reg_src = TargetReg(kArg1);
+  RegStorage reg_tmp = TargetReg(kArg2);  // Becomes the byte count.
+  RegStorage reg_size = TargetReg(kArg3);
+  static constexpr size_t kMaxSlowPathBranches = 10;
+  LIR* slow_path_branches[kMaxSlowPathBranches];
+  size_t num_slow_path_branches = 0;
+
+  LoadValueDirectFixed(rl_src, reg_src);
+  LoadValueDirectFixed(rl_dst, reg_dst);
+  slow_path_branches[num_slow_path_branches++] = OpCmpImmBranch(kCondEq, reg_src, 0, nullptr);
+  slow_path_branches[num_slow_path_branches++] = OpCmpImmBranch(kCondEq, reg_dst, 0, nullptr);
+  // Copies within an array may overlap, they need memmove.
+  slow_path_branches[num_slow_path_branches++] = OpCmpBranch(kCondEq, reg_src, reg_dst, nullptr);
+
+  // Arrays of the same class need neither a conversion nor a store check.
+  int32_t class_offset = mirror::Object::ClassOffset().Int32Value();
+  int32_t component_type_offset = mirror::Class::ComponentTypeOffset().Int32Value();
+  LoadRefDisp(reg_src, class_offset, reg_tmp);
+  LoadRefDisp(reg_dst, class_offset, reg_size);
+  slow_path_branches[num_slow_path_branches++] = OpCmpBranch(kCondNe, reg_tmp, reg_size, nullptr);
+  LoadRefDisp(reg_tmp, component_type_offset, reg_tmp);
+  slow_path_branches[num_slow_path_branches++] = OpCmpImmBranch(kCondEq, reg_tmp, 0, nullptr);
+
+  // Bounds checks. Positions and length are non-negative, so their sums don't overflow
+  // an unsigned compare.
+  int32_t length_offset = mirror::Array::LengthOffset().Int32Value();
+  LoadValueDirectFixed(rl_src_pos, reg_tmp);
+  slow_path_branches[num_slow_path_branches++] = OpCmpImmBranch(kCondLt, reg_tmp, 0, nullptr);
+  LoadValueDirectFixed(rl_length, reg_size);
+  if (!rl_length.is_const) {
+    slow_path_branches[num_slow_path_branches++] = OpCmpImmBranch(kCondLt, reg_size, 0, nullptr);
+  }
+  OpRegReg(kOpAdd, reg_tmp, reg_size);
+  Load32Disp(reg_src, length_offset, reg_size);
+  slow_path_branches[num_slow_path_branches++] = OpCmpBranch(kCondHi, reg_tmp, reg_size, nullptr);
+  LoadValueDirectFixed(rl_dst_pos, reg_tmp);
+  slow_path_branches[num_slow_path_branches++] = OpCmpImmBranch(kCondLt, reg_tmp, 0, nullptr);
+  LoadValueDirectFixed(rl_length, reg_size);
+  OpRegReg(kOpAdd, reg_tmp, reg_size);
+  Load32Disp(reg_dst, length_offset, reg_size);
+  slow_path_branches[num_slow_path_branches++] = OpCmpBranch(kCondHi, reg_tmp, reg_size, nullptr);
+  DCHECK_LE(num_slow_path_branches, kMaxSlowPathBranches);
+
+  // The component size, from the primitive type of the component.
+  LoadRefDisp(reg_src, class_offset, reg_tmp);
+  LoadRefDisp(reg_tmp, component_type_offset, reg_tmp);
+  Load32Disp(reg_tmp, mirror::Class::PrimitiveTypeOffset().Int32Value(), reg_tmp);
+  static constexpr Primitive::Type kComponentTypes[] = {
+      Primitive::kPrimByte, Primitive::kPrimBoolean,
+      Primitive::kPrimChar, Primitive::kPrimShort,
+      Primitive::kPrimNot, Primitive::kPrimInt, Primitive::kPrimFloat,
+  };
+  LIR* size_branches[arraysize(kComponentTypes)];
+  for (size_t i = 0; i != arraysize(kComponentTypes); ++i) {
+    size_t component_size = Primitive::ComponentSize(kComponentTypes[i]);
+    if (i == 0 || component_size != Primitive::ComponentSize(kComponentTypes[i - 1])) {
+      LoadConstant(reg_size, component_size);
+    }
+    size_branches[i] = OpCmpImmBranch(kCondEq, reg_tmp, kComponentTypes[i], nullptr);
+  }
+  // Long or double, their data is 64-bit aligned.
+  LoadConstant(reg_size, 8);
+  int32_t data_offset = mirror::Array::DataOffset(4).Int32Value();
+  int32_t wide_data_offset = mirror::Array::DataOffset(8).Int32Value();
+  OpRegImm(kOpAdd, reg_src, wide_data_offset - data_offset);
+  OpRegImm(kOpAdd, reg_dst, wide_data_offset - data_offset);
+  LIR* size_known = NewLIR0(kPseudoTargetLabel);
+  for (LIR* branch : size_branches) {
+    branch->target = size_known;
+  }
+  OpRegImm(kOpAdd, reg_src, data_offset);
+  OpRegImm(kOpAdd, reg_dst, data_offset);
+  LoadValueDirectFixed(rl_src_pos, reg_tmp);
+  OpRegReg(kOpMul, reg_tmp, reg_size);
+  OpRegReg(kOpAdd, reg_src, reg_tmp);
+  LoadValueDirectFixed(rl_dst_pos, reg_tmp);
+  OpRegReg(kOpMul, reg_tmp, reg_size);
+  OpRegReg(kOpAdd, reg_dst, reg_tmp);
+  LoadValueDirectFixed(rl_length, reg_tmp);
+  OpRegReg(kOpMul, reg_tmp, reg_size);
+
+  // NOTE: not a safepoint
+  if (cu_->instruction_set != kX86) {
+    OpReg(kOpBlx, LoadHelper(QUICK_ENTRYPOINT_OFFSET(4, pMemcpy)));
+  } else {
+    OpThreadMem(kOpBlx, QUICK_ENTRYPOINT_OFFSET(4, pMemcpy));
+  }
+  FreeCallTemps();
+  // A single card covers the copied references, like the write barrier of the native method.
+  // The card of a primitive array gets marked as well, it's cheaper than checking the type again.
+  RegLocation rl_card_dst = LoadValue(rl_dst, kRefReg);
+  MarkGCCard(rl_card_dst.reg, rl_card_dst.reg);
+  FreeTemp(rl_card_dst.reg);
+  // The slow path doesn't leave the destination in the register.
+  ClobberAllTemps();
+
+  LIR* done_branch = OpUnconditionalBranch(nullptr);
+  LIR* slow_path_target = NewLIR0(kPseudoTargetLabel);
+  for (size_t i = 0; i != num_slow_path_branches; ++i) {
+    slow_path_branches[i]->target = slow_path_target;
+  }
+  LIR* slow_path_branch = OpUnconditionalBranch(nullptr);
+  LIR* resume_tgt = NewLIR0(kPseudoTargetLabel);
+  done_branch->target = resume_tgt;
+  AddIntrinsicSlowPath(info, slow_path_branch, resume_tgt);
+  return true;
+}
+
 bool Mir2Lir::GenInlinedCurrentThread(CallInfo* info) {
   RegLocation rl_dest = InlineTarget(info);
   RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
@@ -1675,6 +1952,30 @@ void Mir2Lir::GenInvoke(CallInfo* info) {
   GenInvokeNoInline(info);
 }
 
+void Mir2Lir::GenCheckVirtualTarget(BasicBlock* bb, MIR* mir) {
+  const MirMethodLoweringInfo& method_info = mir_graph_->GetMethodLoweringInfo(mir);
+  DCHECK(method_info.FastPath());
+  RegLocation rl_obj = LoadValue(mir_graph_->GetSrc(mir, 0), kRefReg);
+  GenNullCheck(rl_obj.reg, mir->optimization_flags);
+  // The method the receiver's class dispatches to.
+  RegStorage reg_actual = AllocTempRef();
+  LoadRefDisp(rl_obj.reg, mirror::Object::ClassOffset().Int32Value(), reg_actual);
+  MarkPossibleNullPointerException(mir->optimization_flags);
+  LoadRefDisp(reg_actual, mirror::Class::VTableOffset().Int32Value(), reg_actual);
+  LoadRefDisp(reg_actual, ObjArray::OffsetOfElement(method_info.VTableIndex()).Int32Value(),
+              reg_actual);
+  // The method the invoke resolves to, whose body was inlined.
+  RegStorage reg_expected = AllocTempRef();
+  LoadCurrMethodDirect(reg_expected);
+  LoadRefDisp(reg_expected, mirror::ArtMethod::DexCacheResolvedMethodsOffset().Int32Value(),
+              reg_expected);
+  LoadRefDisp(reg_expected, ObjArray::OffsetOfElement(mir->dalvikInsn.vB).Int32Value(),
+              reg_expected);
+  OpCmpBranch(kCondNe, reg_actual, reg_expected, &block_label_list_[bb->taken]);
+  FreeTemp(reg_actual);
+  FreeTemp(reg_expected);
+}
+
 template <size_t pointer_size>
 static LIR* GenInvokeNoInlineCall(Mir2Lir* mir_to_lir, InvokeType type) {
   ThreadOffset<pointer_size> trampoline(-1);
@@ -465,6 +465,43 @@ void Mir2Lir::ApplyLoadHoisting(LIR* head_lir, LIR* tail_lir) {
   }
 }
 
+/*
+ * Return the instruction that executes right after lir in the superblock, skipping
+ * the nops.  Labels, safepoints and other pseudo ops end the patterns, nullptr is
+ * returned for them as well as past tail_lir.
+ */
+LIR* Mir2Lir::NextPeepholeLIR(LIR* lir, LIR* tail_lir) {
+  while (lir != tail_lir) {
+    lir = lir->next;
+    if (IsPseudoLirOp(lir->opcode)) {
+      return nullptr;
+    }
+    if (!lir->flags.is_nop) {
+      return lir;
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * Walk the superblock top-down and let the target rewrite short sequences of
+ * instructions, such as redundant moves or pairs of loads and stores.
+ */
+void Mir2Lir::ApplyPeepholeOptimizations(LIR* head_lir, LIR* tail_lir) {
+  for (LIR* this_lir = head_lir; ; this_lir = this_lir->next) {
+    if (!this_lir->flags.is_nop && !IsPseudoLirOp(this_lir->opcode)) {
+      ApplyPeephole(this_lir, tail_lir);
+    }
+    if (this_lir == tail_lir) {
+      break;
+    }
+  }
+}
+
+void Mir2Lir::ApplyPeephole(LIR* lir, LIR* tail_lir) {
+  // No patterns unless the target has some.
+}
+
 void Mir2Lir::ApplyLocalOptimizations(LIR* head_lir, LIR* tail_lir) {
   if (!(cu_->disable_opt & (1 << kLoadStoreElimination))) {
     ApplyLoadStoreElimination(head_lir, tail_lir);
@@ -472,6 +509,9 @@ void Mir2Lir::ApplyLocalOptimizations(LIR* head_lir, LIR* tail_lir) {
   if (!(cu_->disable_opt & (1 << kLoadHoisting))) {
     ApplyLoadHoisting(head_lir, tail_lir);
   }
+  if (!(cu_->disable_opt & (1 << kPeephole))) {
+    ApplyPeepholeOptimizations(head_lir, tail_lir);
+  }
 }
 
 }  // namespace art
@@ -283,6 +283,21 @@ bool MipsMir2Lir::GenInlinedSqrt(CallInfo* info) {
   return false;
 }
 
+bool MipsMir2Lir::GenInlinedNumberOfLeadingZeros(CallInfo* info, bool is_long) {
+  DCHECK_NE(cu_->instruction_set, kThumb2);
+  return false;
+}
+
+bool MipsMir2Lir::GenInlinedNumberOfTrailingZeros(CallInfo* info, bool is_long) {
+  DCHECK_NE(cu_->instruction_set, kThumb2);
+  return false;
+}
+
+bool MipsMir2Lir::GenInlinedRotate(CallInfo* info, bool is_left) {
+  DCHECK_NE(cu_->instruction_set, kThumb2);
+  return false;
+}
+
 bool MipsMir2Lir::GenInlinedPeek(CallInfo* info, OpSize size) {
   if (size != kSignedByte) {
     // MIPS supports only aligned access. Defer unaligned access to JNI implementation.
@@ -485,6 +500,11 @@ void MipsMir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
   int len_offset = mirror::Array::LengthOffset().Int32Value();
   int data_offset;
   RegLocation rl_result;
+  const bool read_barrier = kUseBakerReadBarrier && size == kReference;
+  if (read_barrier) {
+    // The read barrier may call the runtime so everything to home locations.
+    FlushAllRegs();
+  }
   rl_array = LoadValue(rl_array, kCoreReg);
   rl_index = LoadValue(rl_index, kCoreReg);
 
@@ -505,6 +525,10 @@ void MipsMir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
     /* Get len */
     Load32Disp(rl_array.reg, len_offset, reg_len);
   }
+  RegStorage r_rb_state;
+  if (read_barrier) {
+    r_rb_state = GenReadBarrierLoadState(rl_array.reg, opt_flags);
+  }
   /* reg_ptr -> array data */
   OpRegRegImm(kOpAdd, reg_ptr, rl_array.reg, data_offset);
   FreeTemp(rl_array.reg);
@@ -538,6 +562,9 @@ void MipsMir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
     LoadBaseIndexed(reg_ptr, rl_index.reg, rl_result.reg, scale, size);
 
     FreeTemp(reg_ptr);
+    if (read_barrier) {
+      GenReadBarrierMark(r_rb_state, rl_result.reg);
+    }
     StoreValue(rl_dest, rl_result);
   }
 }
@@ -999,6 +999,9 @@ void Mir2Lir::HandleExtendedMethodMIR(BasicBlock* bb, MIR* mir) {
     case kMirOpSelect:
       GenSelect(bb, mir);
       break;
+    case kMirOpCheckVirtualTarget:
+      GenCheckVirtualTarget(bb, mir);
+      break;
     case kMirOpPhi:
     case kMirOpNop:
     case kMirOpNullCheck:
@@ -1032,6 +1035,12 @@ bool Mir2Lir::MethodBlockCodeGen(BasicBlock* bb) {
 
   block_label_list_[block_id].operands[0] = bb->start_offset;
 
+  // Start loops on a word boundary, the first 32-bit Thumb2 instruction is fetched at once.
+  if ((cu_->instruction_set == kThumb2) && (bb->block_type == kDalvikByteCode) &&
+      mir_graph_->IsLoopHead(bb)) {
+    NewLIR0(kPseudoPseudoAlign4);
+  }
+
   // Insert the block label.
   block_label_list_[block_id].opcode = kPseudoNormalBlockLabel;
   block_label_list_[block_id].flags.fixup = kFixupLabel;
@@ -1153,20 +1162,35 @@ void Mir2Lir::MethodMIR2LIR() {
       static_cast<LIR*>(arena_->Alloc(sizeof(LIR) * mir_graph_->GetNumBlocks(),
                                       kArenaAllocLIR));
 
+  // Lay the blocks out in DFS pre-order, which follows the fall-through chains, but keep the
+  // cold blocks found by MIRGraph::LayoutBlocks() for the end so the hot code is dense.
+  GrowableArray<BasicBlock*> layout(arena_, mir_graph_->GetNumBlocks(), kGrowableArrayMisc);
+  GrowableArray<BasicBlock*> cold_blocks(arena_, 4, kGrowableArrayMisc);
   PreOrderDfsIterator iter(mir_graph_);
-  BasicBlock* curr_bb = iter.Next();
-  BasicBlock* next_bb = iter.Next();
-  while (curr_bb != NULL) {
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    if (bb->block_type == kDead) {
+      continue;
+    }
+    if (bb->cold && (bb->block_type == kDalvikByteCode)) {
+      cold_blocks.Insert(bb);
+    } else {
+      layout.Insert(bb);
+    }
+  }
+  GrowableArray<BasicBlock*>::Iterator cold_iter(&cold_blocks);
+  for (BasicBlock* bb = cold_iter.Next(); bb != NULL; bb = cold_iter.Next()) {
+    layout.Insert(bb);
+  }
+
+  for (size_t i = 0; i < layout.Size(); ++i) {
+    BasicBlock* curr_bb = layout.Get(i);
+    BasicBlock* next_bb = (i + 1 < layout.Size()) ? layout.Get(i + 1) : NULL;
     MethodBlockCodeGen(curr_bb);
     // If the fall_through block is no longer laid out consecutively, drop in a branch.
     BasicBlock* curr_bb_fall_through = mir_graph_->GetBasicBlock(curr_bb->fall_through);
     if ((curr_bb_fall_through != NULL) && (curr_bb_fall_through != next_bb)) {
       OpUnconditionalBranch(&block_label_list_[curr_bb->fall_through]);
     }
-    curr_bb = next_bb;
-    do {
-      next_bb = iter.Next();
-    } while ((next_bb != NULL) && (next_bb->block_type == kDead));
   }
   HandleSlowPaths();
 }
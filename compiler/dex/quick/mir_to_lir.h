@@ -632,6 +632,8 @@ class Mir2Lir : public Backend {
     void DumpLIRInsn(LIR* arg, unsigned char* base_addr);
     void DumpPromotionMap();
     void CodegenDump();
+    // Logs how much of the code of the method went to the slow paths at its end.
+    void DumpSlowPathSize();
     LIR* RawLIR(DexOffset dalvik_offset, int opcode, int op0 = 0, int op1 = 0,
                 int op2 = 0, int op3 = 0, int op4 = 0, LIR* target = NULL);
     LIR* NewLIR0(int opcode);
@@ -681,7 +683,18 @@ class Mir2Lir : public Backend {
     void ConvertMemOpIntoMove(LIR* orig_lir, RegStorage dest, RegStorage src);
     void ApplyLoadStoreElimination(LIR* head_lir, LIR* tail_lir);
     void ApplyLoadHoisting(LIR* head_lir, LIR* tail_lir);
+    void ApplyPeepholeOptimizations(LIR* head_lir, LIR* tail_lir);
+    LIR* NextPeepholeLIR(LIR* lir, LIR* tail_lir);
     virtual void ApplyLocalOptimizations(LIR* head_lir, LIR* tail_lir);
+    /**
+     * @brief Target-specific peephole on one instruction of a superblock.
+     * @param lir The instruction to match the target patterns against, never a nop or pseudo op.
+     * @param tail_lir The last instruction of the superblock.
+     * @details Called in order for the instructions of the superblock once the loads and
+     * stores are scheduled.  The patterns may rewrite lir and the instructions that
+     * NextPeepholeLIR() finds after it, and nop any of them.
+     */
+    virtual void ApplyPeephole(LIR* lir, LIR* tail_lir);
 
     // Shared by all targets - implemented in ralloc_util.cc
     int GetSRegHi(int lowSreg);
@@ -782,6 +795,8 @@ class Mir2Lir : public Backend {
                           RegLocation rl_src, RegLocation rl_dest, int lit);
     bool HandleEasyMultiply(RegLocation rl_src, RegLocation rl_dest, int lit);
     virtual void HandleSlowPaths();
+    void AddInitializeTypeSlowPath(LIR* branch, LIR* cont, uint32_t type_idx,
+                                   RegStorage class_reg);
     void GenBarrier();
     void GenDivZeroException();
     // c_code holds condition code that's generated from testing divisor against 0.
@@ -815,6 +830,16 @@ class Mir2Lir : public Backend {
                  RegLocation rl_dest, RegLocation rl_obj, bool is_long_or_double, bool is_object);
     void GenIPut(MIR* mir, int opt_flags, OpSize size,
                  RegLocation rl_src, RegLocation rl_obj, bool is_long_or_double, bool is_object);
+    /*
+     * @brief Baker read barrier for a reference loaded from r_holder, with kUseBakerReadBarrier.
+     * GenReadBarrierLoadState() reads the state of the holder and must be called before the
+     * reference is loaded. GenReadBarrierMark() then marks the reference in r_ref out of line if
+     * the holder was gray. The mark call clobbers the temps, so the registers must have been
+     * flushed before the operands were loaded.
+     * @return the temp holding the state, to be passed to GenReadBarrierMark().
+     */
+    RegStorage GenReadBarrierLoadState(RegStorage r_holder, int opt_flags);
+    void GenReadBarrierMark(RegStorage r_state, RegStorage r_ref);
     void GenArrayObjPut(int opt_flags, RegLocation rl_array, RegLocation rl_index,
                         RegLocation rl_src);
 
@@ -909,6 +934,7 @@ class Mir2Lir : public Backend {
                                                             bool safepoint_pc);
     void GenInvoke(CallInfo* info);
     void GenInvokeNoInline(CallInfo* info);
+    void GenCheckVirtualTarget(BasicBlock* bb, MIR* mir);
     virtual void FlushIns(RegLocation* ArgLocs, RegLocation rl_method);
     int GenDalvikArgsNoRange(CallInfo* info, int call_state, LIR** pcrLabel,
                              NextCallInsn next_call_insn,
@@ -952,6 +978,10 @@ class Mir2Lir : public Backend {
     bool GenInlinedDoubleCvt(CallInfo* info);
     virtual bool GenInlinedIndexOf(CallInfo* info, bool zero_based);
     bool GenInlinedStringCompareTo(CallInfo* info);
+    bool GenInlinedStringEquals(CallInfo* info);
+    bool GenInlinedStringHashCode(CallInfo* info);
+    bool GenInlinedIdentityHashCode(CallInfo* info);
+    bool GenInlinedArrayCopy(CallInfo* info);
     bool GenInlinedCurrentThread(CallInfo* info);
     bool GenInlinedUnsafeGet(CallInfo* info, bool is_long, bool is_volatile);
     bool GenInlinedUnsafePut(CallInfo* info, bool is_long, bool is_object,
@@ -1097,6 +1127,15 @@ class Mir2Lir : public Backend {
     virtual LIR* OpCmpMemImmBranch(ConditionCode cond, RegStorage temp_reg, RegStorage base_reg,
                                    int offset, int check_value, LIR* target);
 
+    /*
+     * @brief Allocate an object of an initialized class from the thread-local allocation buffer,
+     * calling the pAllocObjectInitialized entrypoint only when the buffer is full.
+     * @param direct_type_ptr The Class* of the object, or 0 if it's already in kArg0.
+     * @returns true if the allocation was generated, the object is then in kRet0. false if the
+     * target doesn't allocate inline and the caller has to call the entrypoint.
+     */
+    virtual bool GenInlinedNewInstance(uintptr_t direct_type_ptr);
+
     // Required for target - codegen helpers.
     virtual bool SmallLiteralDivRem(Instruction::Code dalvik_opcode, bool is_div,
                                     RegLocation rl_src, RegLocation rl_dest, int lit) = 0;
@@ -1197,6 +1236,9 @@ class Mir2Lir : public Backend {
     virtual bool GenInlinedMinMaxInt(CallInfo* info, bool is_min) = 0;
 
     virtual bool GenInlinedSqrt(CallInfo* info) = 0;
+    virtual bool GenInlinedNumberOfLeadingZeros(CallInfo* info, bool is_long) = 0;
+    virtual bool GenInlinedNumberOfTrailingZeros(CallInfo* info, bool is_long) = 0;
+    virtual bool GenInlinedRotate(CallInfo* info, bool is_left) = 0;
     virtual bool GenInlinedPeek(CallInfo* info, OpSize size) = 0;
     virtual bool GenInlinedPoke(CallInfo* info, OpSize size) = 0;
     virtual void GenNotLong(RegLocation rl_dest, RegLocation rl_src) = 0;
@@ -1416,6 +1458,8 @@ class Mir2Lir : public Backend {
 
     virtual void GenInstanceofFinal(bool use_declaring_class, uint32_t type_idx,
                                     RegLocation rl_dest, RegLocation rl_src);
+    void GenInstanceofSubclass(bool use_declaring_class, uint32_t type_idx,
+                               RegLocation rl_dest, RegLocation rl_src);
 
     void AddSlowPath(LIRSlowPath* slowpath);
 
@@ -1576,6 +1620,8 @@ class Mir2Lir : public Backend {
     LIR* last_lir_insn_;
 
     GrowableArray<LIRSlowPath*> slow_paths_;
+    // The last LIR before the slow paths, null without slow paths.
+    LIR* first_slow_path_lir_;
 };  // Class Mir2Lir
 
 }  // namespace art
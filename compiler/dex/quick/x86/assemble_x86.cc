@@ -287,6 +287,7 @@ ENCODING_MAP(Cmp, IS_LOAD, 0, 0,
 
   { kX86Test32RR, kRegReg,             IS_BINARY_OP   | REG_USE01 | SETS_CCODES, { 0,    0, 0x85, 0, 0, 0, 0, 0}, "Test32RR", "!0r,!1r" },
   { kX86Test64RR, kRegReg,             IS_BINARY_OP   | REG_USE01 | SETS_CCODES, { REX_W, 0, 0x85, 0, 0, 0, 0, 0}, "Test64RR", "!0r,!1r" },
+  { kX86Test32RM, kRegMem,   IS_LOAD | IS_TERTIARY_OP | REG_USE01 | SETS_CCODES, { 0,    0, 0x85, 0, 0, 0, 0, 0}, "Test32RM", "!0r,[!1r+!2d]" },
 
 #define UNARY_ENCODING_MAP(opname, modrm, is_store, sets_ccodes, \
                            reg, reg_kind, reg_flags, \
@@ -442,6 +443,10 @@ ENCODING_MAP(Cmp, IS_LOAD, 0, 0,
 
   EXT_0F_ENCODING_MAP(Imul16,  0x66, 0xAF, REG_USE0 | REG_DEF0 | SETS_CCODES),
   EXT_0F_ENCODING_MAP(Imul32,  0x00, 0xAF, REG_USE0 | REG_DEF0 | SETS_CCODES),
+  EXT_0F_ENCODING_MAP(Bsf32,   0x00, 0xBC, REG_DEF0 | SETS_CCODES),
+  EXT_0F_ENCODING_MAP(Bsr32,   0x00, 0xBD, REG_DEF0 | SETS_CCODES),
+  { kX86Bsf64RR, kRegReg, IS_BINARY_OP | REG_DEF0_USE1 | SETS_CCODES, { REX_W, 0, 0x0F, 0xBC, 0, 0, 0, 0 }, "Bsf64RR", "!0r,!1r" },
+  { kX86Bsr64RR, kRegReg, IS_BINARY_OP | REG_DEF0_USE1 | SETS_CCODES, { REX_W, 0, 0x0F, 0xBD, 0, 0, 0, 0 }, "Bsr64RR", "!0r,!1r" },
 
   { kX86CmpxchgRR, kRegRegStore, IS_BINARY_OP | REG_DEF0 | REG_USE01 | REG_DEFA_USEA | SETS_CCODES, { 0, 0, 0x0F, 0xB1, 0, 0, 0, 0 }, "Cmpxchg", "!0r,!1r" },
   { kX86CmpxchgMR, kMemReg,   IS_STORE | IS_TERTIARY_OP | REG_USE02 | REG_DEFA_USEA | SETS_CCODES, { 0, 0, 0x0F, 0xB1, 0, 0, 0, 0 }, "Cmpxchg", "[!0r+!1d],!2r" },
@@ -1421,146 +1426,202 @@ void X86Mir2Lir::EmitUnimplemented(const X86EncodingMap* entry, LIR* lir) {
 }
 
 /*
- * Assemble the LIR into binary instruction format.  Note that we may
- * discover that pc-relative displacements may not fit the selected
- * instruction.  In those cases we will try to substitute a new code
- * sequence or request that the trace be shortened and retried.
+ * Link the LIR nodes that may need a pc-relative fixup into the fixup chain, in
+ * ascending offset order.  Labels are included so that branch targets follow the
+ * offset adjustments made while walking the chain.
  */
-AssemblerStatus X86Mir2Lir::AssembleInstructions(CodeOffset start_addr) {
-  LIR *lir;
-  AssemblerStatus res = kSuccess;  // Assume success
-
-  const bool kVerbosePcFixup = false;
-  for (lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
-    if (IsPseudoLirOp(lir->opcode)) {
+void X86Mir2Lir::LinkFixupInsns() {
+  LIR* last_fixup = NULL;
+  first_fixup_ = NULL;
+  for (LIR* lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
+    if (lir->flags.fixup == kFixupNone) {
       continue;
     }
+    DCHECK_NE(lir->opcode, kPseudoPseudoAlign4);
+    // The use/def masks share storage with the chain and are not needed past this point.
+    lir->flags.use_def_invalid = true;
+    lir->u.a.pcrel_next = NULL;
+    if (first_fixup_ == NULL) {
+      first_fixup_ = lir;
+    } else {
+      last_fixup->u.a.pcrel_next = lir;
+    }
+    last_fixup = lir;
+  }
+}
 
-    if (lir->flags.is_nop) {
+/*
+ * Walk the fixup chain and check that the pc-relative displacements fit the
+ * selected instructions, growing short branches and literal loads that don't.
+ * Only the nodes on the chain are visited: when an instruction changes size,
+ * the offsets of the nodes that follow are moved by *offset_adjustment as they
+ * are reached, and the offsets of everything else are left stale until the
+ * chain has converged.  Returns kRetryAll if any instruction changed size.
+ */
+AssemblerStatus X86Mir2Lir::FixupInsns(int generation, int32_t* offset_adjustment) {
+  AssemblerStatus res = kSuccess;  // Assume success
+  int32_t adjustment = 0;
+
+  const bool kVerbosePcFixup = false;
+  LIR* prev_lir = NULL;
+  LIR* lir = first_fixup_;
+  while (lir != NULL) {
+    lir->offset += adjustment;
+    // During pass, allows us to tell whether a node has been updated with adjustment yet.
+    lir->flags.generation = generation;
+    if (IsPseudoLirOp(lir->opcode) || lir->flags.is_nop) {
+      prev_lir = lir;
+      lir = lir->u.a.pcrel_next;
       continue;
     }
-
-    if (lir->flags.fixup != kFixupNone) {
-      switch (lir->opcode) {
-        case kX86Jcc8: {
-          LIR *target_lir = lir->target;
-          DCHECK(target_lir != NULL);
-          int delta = 0;
-          CodeOffset pc;
-          if (IS_SIMM8(lir->operands[0])) {
-            pc = lir->offset + 2 /* opcode + rel8 */;
-          } else {
-            pc = lir->offset + 6 /* 2 byte opcode + rel32 */;
-          }
-          CodeOffset target = target_lir->offset;
-          delta = target - pc;
-          if (IS_SIMM8(delta) != IS_SIMM8(lir->operands[0])) {
-            if (kVerbosePcFixup) {
-              LOG(INFO) << "Retry for JCC growth at " << lir->offset
-                  << " delta: " << delta << " old delta: " << lir->operands[0];
-            }
-            lir->opcode = kX86Jcc32;
-            SetupResourceMasks(lir);
-            res = kRetryAll;
-          }
-          if (kVerbosePcFixup) {
-            LOG(INFO) << "Source:";
-            DumpLIRInsn(lir, 0);
-            LOG(INFO) << "Target:";
-            DumpLIRInsn(target_lir, 0);
-            LOG(INFO) << "Delta " << delta;
-          }
-          lir->operands[0] = delta;
-          break;
+    int old_size = lir->flags.size;
+    switch (lir->opcode) {
+      case kX86Jcc8: {
+        LIR *target_lir = lir->target;
+        DCHECK(target_lir != NULL);
+        int delta = 0;
+        CodeOffset pc;
+        if (IS_SIMM8(lir->operands[0])) {
+          pc = lir->offset + 2 /* opcode + rel8 */;
+        } else {
+          pc = lir->offset + 6 /* 2 byte opcode + rel32 */;
         }
-        case kX86Jcc32: {
-          LIR *target_lir = lir->target;
-          DCHECK(target_lir != NULL);
-          CodeOffset pc = lir->offset + 6 /* 2 byte opcode + rel32 */;
-          CodeOffset target = target_lir->offset;
-          int delta = target - pc;
+        CodeOffset target = target_lir->offset +
+            ((target_lir->flags.generation == generation) ? 0 : adjustment);
+        delta = target - pc;
+        if (IS_SIMM8(delta) != IS_SIMM8(lir->operands[0])) {
           if (kVerbosePcFixup) {
-            LOG(INFO) << "Source:";
-            DumpLIRInsn(lir, 0);
-            LOG(INFO) << "Target:";
-            DumpLIRInsn(target_lir, 0);
-            LOG(INFO) << "Delta " << delta;
+            LOG(INFO) << "Retry for JCC growth at " << lir->offset
+                << " delta: " << delta << " old delta: " << lir->operands[0];
           }
-          lir->operands[0] = delta;
-          break;
+          lir->opcode = kX86Jcc32;
+          lir->flags.size = GetInsnSize(lir);
+          res = kRetryAll;
         }
-        case kX86Jecxz8: {
-          LIR *target_lir = lir->target;
-          DCHECK(target_lir != NULL);
-          CodeOffset pc;
-          pc = lir->offset + 2;  // opcode + rel8
-          CodeOffset target = target_lir->offset;
-          int delta = target - pc;
-          lir->operands[0] = delta;
-          DCHECK(IS_SIMM8(delta));
-          break;
+        if (kVerbosePcFixup) {
+          LOG(INFO) << "Source:";
+          DumpLIRInsn(lir, 0);
+          LOG(INFO) << "Target:";
+          DumpLIRInsn(target_lir, 0);
+          LOG(INFO) << "Delta " << delta;
         }
-        case kX86Jmp8: {
-          LIR *target_lir = lir->target;
-          DCHECK(target_lir != NULL);
-          int delta = 0;
-          CodeOffset pc;
-          if (IS_SIMM8(lir->operands[0])) {
-            pc = lir->offset + 2 /* opcode + rel8 */;
+        lir->operands[0] = delta;
+        break;
+      }
+      case kX86Jcc32: {
+        LIR *target_lir = lir->target;
+        DCHECK(target_lir != NULL);
+        CodeOffset pc = lir->offset + 6 /* 2 byte opcode + rel32 */;
+        CodeOffset target = target_lir->offset +
+            ((target_lir->flags.generation == generation) ? 0 : adjustment);
+        int delta = target - pc;
+        if (kVerbosePcFixup) {
+          LOG(INFO) << "Source:";
+          DumpLIRInsn(lir, 0);
+          LOG(INFO) << "Target:";
+          DumpLIRInsn(target_lir, 0);
+          LOG(INFO) << "Delta " << delta;
+        }
+        lir->operands[0] = delta;
+        break;
+      }
+      case kX86Jecxz8: {
+        LIR *target_lir = lir->target;
+        DCHECK(target_lir != NULL);
+        CodeOffset pc;
+        pc = lir->offset + 2;  // opcode + rel8
+        CodeOffset target = target_lir->offset +
+            ((target_lir->flags.generation == generation) ? 0 : adjustment);
+        int delta = target - pc;
+        lir->operands[0] = delta;
+        DCHECK(IS_SIMM8(delta));
+        break;
+      }
+      case kX86Jmp8: {
+        LIR *target_lir = lir->target;
+        DCHECK(target_lir != NULL);
+        int delta = 0;
+        CodeOffset pc;
+        if (IS_SIMM8(lir->operands[0])) {
+          pc = lir->offset + 2 /* opcode + rel8 */;
+        } else {
+          pc = lir->offset + 5 /* opcode + rel32 */;
+        }
+        CodeOffset target = target_lir->offset +
+            ((target_lir->flags.generation == generation) ? 0 : adjustment);
+        delta = target - pc;
+        if (!(cu_->disable_opt & (1 << kSafeOptimizations)) && delta == 0) {
+          // Useless branch
+          NopLIR(lir);
+          if (kVerbosePcFixup) {
+            LOG(INFO) << "Retry for useless branch at " << lir->offset;
+          }
+          // Drop it from the fixup chain as well.
+          LIR* next_lir = lir->u.a.pcrel_next;
+          if (prev_lir == NULL) {
+            first_fixup_ = next_lir;
           } else {
-            pc = lir->offset + 5 /* opcode + rel32 */;
+            prev_lir->u.a.pcrel_next = next_lir;
           }
-          CodeOffset target = target_lir->offset;
-          delta = target - pc;
-          if (!(cu_->disable_opt & (1 << kSafeOptimizations)) && delta == 0) {
-            // Useless branch
-            NopLIR(lir);
-            if (kVerbosePcFixup) {
-              LOG(INFO) << "Retry for useless branch at " << lir->offset;
-            }
-            res = kRetryAll;
-          } else if (IS_SIMM8(delta) != IS_SIMM8(lir->operands[0])) {
-            if (kVerbosePcFixup) {
-              LOG(INFO) << "Retry for JMP growth at " << lir->offset;
-            }
-            lir->opcode = kX86Jmp32;
-            SetupResourceMasks(lir);
-            res = kRetryAll;
+          adjustment -= old_size;
+          res = kRetryAll;
+          lir = next_lir;
+          continue;
+        } else if (IS_SIMM8(delta) != IS_SIMM8(lir->operands[0])) {
+          if (kVerbosePcFixup) {
+            LOG(INFO) << "Retry for JMP growth at " << lir->offset;
           }
-          lir->operands[0] = delta;
-          break;
+          lir->opcode = kX86Jmp32;
+          lir->flags.size = GetInsnSize(lir);
+          res = kRetryAll;
         }
-        case kX86Jmp32: {
+        lir->operands[0] = delta;
+        break;
+      }
+      case kX86Jmp32: {
+        LIR *target_lir = lir->target;
+        DCHECK(target_lir != NULL);
+        CodeOffset pc = lir->offset + 5 /* opcode + rel32 */;
+        CodeOffset target = target_lir->offset +
+            ((target_lir->flags.generation == generation) ? 0 : adjustment);
+        int delta = target - pc;
+        lir->operands[0] = delta;
+        break;
+      }
+      default:
+        if (lir->flags.fixup == kFixupLoad) {
+          // Literals live past the end of the code, so they move with the adjustment so far.
           LIR *target_lir = lir->target;
           DCHECK(target_lir != NULL);
-          CodeOffset pc = lir->offset + 5 /* opcode + rel32 */;
-          CodeOffset target = target_lir->offset;
-          int delta = target - pc;
-          lir->operands[0] = delta;
-          break;
-        }
-        default:
-          if (lir->flags.fixup == kFixupLoad) {
-            LIR *target_lir = lir->target;
-            DCHECK(target_lir != NULL);
-            CodeOffset target = target_lir->offset;
-            lir->operands[2] = target;
-            int newSize = GetInsnSize(lir);
-            if (newSize != lir->flags.size) {
-              lir->flags.size = newSize;
-              res = kRetryAll;
-            }
+          CodeOffset target = target_lir->offset + adjustment;
+          lir->operands[2] = target;
+          int newSize = GetInsnSize(lir);
+          if (newSize != lir->flags.size) {
+            lir->flags.size = newSize;
+            res = kRetryAll;
           }
-          break;
-      }
+        }
+        break;
     }
+    adjustment += lir->flags.size - old_size;
+    prev_lir = lir;
+    lir = lir->u.a.pcrel_next;
+  }
+  *offset_adjustment = adjustment;
+  return res;
+}
 
-    /*
-     * If one of the pc-relative instructions expanded we'll have
-     * to make another pass.  Don't bother to fully assemble the
-     * instruction.
-     */
-    if (res != kSuccess) {
+/*
+ * Encode the LIR into binary instruction format.  All pc-relative
+ * displacements must already have been resolved by FixupInsns().
+ */
+void X86Mir2Lir::EncodeLIRs() {
+  for (LIR* lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
+    if (IsPseudoLirOp(lir->opcode)) {
+      continue;
+    }
+
+    if (lir->flags.is_nop) {
       continue;
     }
     CHECK_EQ(static_cast<size_t>(lir->offset), code_buffer_.size());
@@ -1719,7 +1780,6 @@ AssemblerStatus X86Mir2Lir::AssembleInstructions(CodeOffset start_addr) {
              code_buffer_.size() - starting_cbuf_size)
         << "Instruction size mismatch for entry: " << X86Mir2Lir::EncodingMap[lir->opcode].name;
   }
-  return res;
 }
 
 // LIR offset assignment.
@@ -1748,13 +1808,11 @@ int X86Mir2Lir::AssignInsnOffsets() {
 }
 
 /*
- * Walk the compilation unit and assign offsets to instructions
- * and literals and compute the total size of the compiled unit.
+ * Assign offsets to the literals and tables that follow the code, which
+ * ends at the given offset, and compute the total size of the compiled unit.
  * TODO: consolidate w/ Arm assembly mechanism.
  */
-void X86Mir2Lir::AssignOffsets() {
-  int offset = AssignInsnOffsets();
-
+void X86Mir2Lir::AssignDataOffsets(CodeOffset offset) {
   if (const_vectors_ != nullptr) {
     /* assign offsets to vector literals */
 
@@ -1805,16 +1863,26 @@ void X86Mir2Lir::AssembleLIR() {
     setup_method_address_[1]->flags.is_nop = true;
   }
 
-  AssignOffsets();
+  CodeOffset code_size = AssignInsnOffsets();
+  AssignDataOffsets(code_size);
+  LinkFixupInsns();
   int assembler_retries = 0;
   /*
-   * Assemble here.  Note that we generate code with optimistic assumptions
-   * and if found now to work, we'll have to redo the sequence and retry.
+   * Fix up the pc-relative instructions.  Note that we generate code with optimistic
+   * assumptions, and growing an instruction may push other displacements out of range,
+   * so keep walking the fixup chain until no instruction changes size.  Nothing is
+   * encoded until the layout has converged.
+   *
+   * Note: generation must be 1 on first pass (to distinguish from initialized state of 0 for
+   * non-visited nodes).  Start at zero here, and bit will be flipped to 1 on entry to the loop.
    */
-
+  int generation = 0;
   while (true) {
-    AssemblerStatus res = AssembleInstructions(0);
+    generation ^= 1;
+    int32_t offset_adjustment;
+    AssemblerStatus res = FixupInsns(generation, &offset_adjustment);
     if (res == kSuccess) {
+      DCHECK_EQ(offset_adjustment, 0);
       break;
     } else {
       assembler_retries++;
@@ -1822,12 +1890,19 @@ void X86Mir2Lir::AssembleLIR() {
         CodegenDump();
         LOG(FATAL) << "Assembler error - too many retries";
       }
-      // Redo offsets and try again
-      AssignOffsets();
-      code_buffer_.clear();
+      // Only the literals need to move along with the code; the chain is already up to date.
+      code_size += offset_adjustment;
+      AssignDataOffsets(code_size);
     }
   }
 
+  // The offsets of instructions off the fixup chain are stale, redo them once.
+  CodeOffset insn_size = AssignInsnOffsets();
+  DCHECK_EQ(insn_size, code_size);
+  code_buffer_.reserve(total_size_);
+  EncodeLIRs();
+  DCHECK_EQ(static_cast<CodeOffset>(code_buffer_.size()), code_size);
+
   // Install literals
   InstallLiteralPools();
 
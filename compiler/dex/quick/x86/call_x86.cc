@@ -209,21 +209,37 @@ void X86Mir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
   LockTemp(rs_rX86_ARG1);
   LockTemp(rs_rX86_ARG2);
 
-  /* Build frame, return address already on stack */
-  stack_decrement_ = OpRegImm(kOpSub, rs_rX86_SP, frame_size_ - GetInstructionSetPointerSize(cu_->instruction_set));
-
   /*
    * We can safely skip the stack overflow check if we're
    * a leaf *and* our frame size < fudge factor.
    */
   const bool skip_overflow_check = (mir_graph_->MethodIsLeaf() &&
       (static_cast<size_t>(frame_size_) < Thread::kStackOverflowReservedBytes));
+  // Only the x86_64 runtime handles the faults of implicit checks.
+  const bool implicit_overflow_check = Is64BitInstructionSet(cu_->instruction_set) &&
+      !Runtime::Current()->ExplicitStackOverflowChecks();
+  if (!skip_overflow_check && implicit_overflow_check) {
+    // Implicit stack overflow check.
+    // Generate a test from [rsp, #-overflowsize].  If this is in the stack
+    // redzone we will get a segmentation fault.
+    //
+    // This is done before the frame is built, so that the signal handler finds
+    // the return address into the previous frame at rsp.  Test doesn't write
+    // any register and eax may hold the hidden argument of an interface call.
+    NewLIR3(kX86Test32RM, rs_rAX.GetReg(), rs_rX86_SP.GetReg(),
+            -static_cast<int>(Thread::kStackOverflowReservedBytes));
+    MarkPossibleStackOverflowException();
+  }
+
+  /* Build frame, return address already on stack */
+  stack_decrement_ = OpRegImm(kOpSub, rs_rX86_SP, frame_size_ - GetInstructionSetPointerSize(cu_->instruction_set));
+
   NewLIR0(kPseudoMethodEntry);
   /* Spill core callee saves */
   SpillCoreRegs();
   /* NOTE: promotion of FP regs currently unsupported, thus no FP spill */
   DCHECK_EQ(num_fp_spills_, 0);
-  if (!skip_overflow_check) {
+  if (!skip_overflow_check && !implicit_overflow_check) {
     class StackOverflowSlowPath : public LIRSlowPath {
      public:
       StackOverflowSlowPath(Mir2Lir* m2l, LIR* branch, size_t sp_displace)
@@ -75,8 +75,10 @@ class X86Mir2Lir : public Mir2Lir {
     // Required for target - miscellaneous.
     void AssembleLIR();
     int AssignInsnOffsets();
-    void AssignOffsets();
-    AssemblerStatus AssembleInstructions(CodeOffset start_addr);
+    void AssignDataOffsets(CodeOffset offset);
+    void LinkFixupInsns();
+    AssemblerStatus FixupInsns(int generation, int32_t* offset_adjustment);
+    void EncodeLIRs();
     void DumpResourceMask(LIR* lir, uint64_t mask, const char* prefix);
     void SetupTargetResourceMasks(LIR* lir, uint64_t flags);
     const char* GetTargetInstFmt(int opcode);
@@ -86,6 +88,7 @@ class X86Mir2Lir : public Mir2Lir {
     uint64_t GetTargetInstFlags(int opcode);
     int GetInsnSize(LIR* lir);
     bool IsUnconditionalBranch(LIR* lir);
+    void ApplyPeephole(LIR* lir, LIR* tail_lir) OVERRIDE;
 
     // Check support for volatile load/store of a given size.
     bool SupportsVolatileLoadStore(OpSize size) OVERRIDE;
@@ -117,6 +120,9 @@ class X86Mir2Lir : public Mir2Lir {
     bool GenInlinedCas(CallInfo* info, bool is_long, bool is_object);
     bool GenInlinedMinMaxInt(CallInfo* info, bool is_min);
     bool GenInlinedSqrt(CallInfo* info);
+    bool GenInlinedNumberOfLeadingZeros(CallInfo* info, bool is_long);
+    bool GenInlinedNumberOfTrailingZeros(CallInfo* info, bool is_long);
+    bool GenInlinedRotate(CallInfo* info, bool is_left);
     bool GenInlinedPeek(CallInfo* info, OpSize size);
     bool GenInlinedPoke(CallInfo* info, OpSize size);
     void GenNotLong(RegLocation rl_dest, RegLocation rl_src);
@@ -747,6 +753,21 @@ class X86Mir2Lir : public Mir2Lir {
 
     bool Gen64Bit() const  { return gen64bit_; }
 
+    /*
+     * @brief Check that nothing reads the condition codes set by an instruction.
+     * @param lir The instruction setting the condition codes.
+     * @param tail_lir The last instruction of the superblock.
+     * @returns true if an instruction of the superblock sets them again before any use.
+     */
+    bool CCodesDeadAfter(LIR* lir, LIR* tail_lir);
+
+    /*
+     * @brief Peephole patterns of ApplyPeephole().
+     * @returns true if the instructions were rewritten.
+     */
+    bool FoldMoveIntoLea(LIR* mov_lir, LIR* next_lir, LIR* tail_lir);
+    bool FoldLeaIntoLoad(LIR* lea_lir, LIR* next_lir);
+
     // Information derived from analysis of MIR
 
     // The compiler temporary for the code address of the method.
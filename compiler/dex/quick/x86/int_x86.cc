@@ -689,6 +689,110 @@ bool X86Mir2Lir::GenInlinedMinMaxInt(CallInfo* info, bool is_min) {
   return true;
 }
 
+bool X86Mir2Lir::GenInlinedNumberOfLeadingZeros(CallInfo* info, bool is_long) {
+  RegLocation rl_src = is_long ? LoadValueWide(info->args[0], kCoreReg)
+                               : LoadValue(info->args[0], kCoreReg);
+  RegLocation rl_dest = InlineTarget(info);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  // BSR leaves its destination undefined for 0 but sets ZF, -1 is then taken as the index of the
+  // highest set bit.
+  RegStorage t_reg = AllocTemp();
+  LoadConstant(t_reg, -1);
+  if (!is_long || !rl_src.reg.IsPair()) {
+    NewLIR2(is_long ? kX86Bsr64RR : kX86Bsr32RR, rl_result.reg.GetReg(), rl_src.reg.GetReg());
+    OpCondRegReg(kOpCmov, kCondEq, rl_result.reg, t_reg);
+    // nlz(x) = 31 - index, or 63 - index for a long.
+    OpReg(kOpNeg, rl_result.reg);
+    OpRegImm(kOpAdd, rl_result.reg, is_long ? 63 : 31);
+  } else {
+    // The high word is read after the result is first written.
+    RegStorage r_result = rl_result.reg;
+    bool result_is_src = r_result.GetReg() == rl_src.reg.GetLowReg() ||
+        r_result.GetReg() == rl_src.reg.GetHighReg();
+    if (result_is_src) {
+      r_result = AllocTemp();
+    }
+    NewLIR2(kX86Bsr32RR, r_result.GetReg(), rl_src.reg.GetLowReg());
+    OpCondRegReg(kOpCmov, kCondEq, r_result, t_reg);
+    // The index in the high word counts from 32, and wins unless the high word is 0.
+    NewLIR2(kX86Bsr32RR, t_reg.GetReg(), rl_src.reg.GetHighReg());
+    OpRegImm(kOpAdd, t_reg, 32);
+    OpRegImm(kOpCmp, rl_src.reg.GetHigh(), 0);
+    OpCondRegReg(kOpCmov, kCondNe, r_result, t_reg);
+    OpReg(kOpNeg, r_result);
+    OpRegImm(kOpAdd, r_result, 63);
+    if (result_is_src) {
+      OpRegCopy(rl_result.reg, r_result);
+      FreeTemp(r_result);
+    }
+  }
+  FreeTemp(t_reg);
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
+bool X86Mir2Lir::GenInlinedNumberOfTrailingZeros(CallInfo* info, bool is_long) {
+  RegLocation rl_src = is_long ? LoadValueWide(info->args[0], kCoreReg)
+                               : LoadValue(info->args[0], kCoreReg);
+  RegLocation rl_dest = InlineTarget(info);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  // BSF leaves its destination undefined for 0 but sets ZF, the count is then the width.
+  RegStorage t_reg = AllocTemp();
+  if (!is_long || !rl_src.reg.IsPair()) {
+    LoadConstant(t_reg, is_long ? 64 : 32);
+    NewLIR2(is_long ? kX86Bsf64RR : kX86Bsf32RR, rl_result.reg.GetReg(), rl_src.reg.GetReg());
+    OpCondRegReg(kOpCmov, kCondEq, rl_result.reg, t_reg);
+  } else {
+    // The low word is read after the result is first written.
+    RegStorage r_result = rl_result.reg;
+    bool result_is_src = r_result.GetReg() == rl_src.reg.GetLowReg() ||
+        r_result.GetReg() == rl_src.reg.GetHighReg();
+    if (result_is_src) {
+      r_result = AllocTemp();
+    }
+    // ntz(x) = (lo != 0) ? ntz(lo) : 32 + ntz(hi).
+    LoadConstant(t_reg, 32);
+    NewLIR2(kX86Bsf32RR, r_result.GetReg(), rl_src.reg.GetHighReg());
+    OpCondRegReg(kOpCmov, kCondEq, r_result, t_reg);
+    OpRegImm(kOpAdd, r_result, 32);
+    NewLIR2(kX86Bsf32RR, t_reg.GetReg(), rl_src.reg.GetLowReg());
+    OpCondRegReg(kOpCmov, kCondNe, r_result, t_reg);
+    if (result_is_src) {
+      OpRegCopy(rl_result.reg, r_result);
+      FreeTemp(r_result);
+    }
+  }
+  FreeTemp(t_reg);
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
+bool X86Mir2Lir::GenInlinedRotate(CallInfo* info, bool is_left) {
+  RegLocation rl_shift = info->args[1];
+  RegLocation rl_dest = InlineTarget(info);
+  if (rl_shift.is_const) {
+    RegLocation rl_src = LoadValue(info->args[0], kCoreReg);
+    RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+    int32_t shift = mir_graph_->ConstantValue(rl_shift) & 31;
+    OpRegCopy(rl_result.reg, rl_src.reg);
+    if (shift != 0) {
+      NewLIR2(is_left ? kX86Rol32RI : kX86Ror32RI, rl_result.reg.GetReg(), shift);
+    }
+    StoreValue(rl_dest, rl_result);
+  } else {
+    // ROL and ROR take the distance in CL and use it modulo 32, like Java.
+    RegStorage t_reg = TargetReg(kCount);  // rCX
+    LoadValueDirectFixed(rl_shift, t_reg);
+    RegLocation rl_src = LoadValue(info->args[0], kCoreReg);
+    RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+    OpRegCopy(rl_result.reg, rl_src.reg);
+    NewLIR2(is_left ? kX86Rol32RC : kX86Ror32RC, rl_result.reg.GetReg(), t_reg.GetReg());
+    FreeTemp(t_reg);
+    StoreValue(rl_dest, rl_result);
+  }
+  return true;
+}
+
 bool X86Mir2Lir::GenInlinedPeek(CallInfo* info, OpSize size) {
   RegLocation rl_src_address = info->args[0];  // long address
   rl_src_address = NarrowRegLoc(rl_src_address);  // ignore high half in info->args[1]
@@ -1446,6 +1550,11 @@ void X86Mir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
   RegisterClass reg_class = RegClassBySize(size);
   int len_offset = mirror::Array::LengthOffset().Int32Value();
   RegLocation rl_result;
+  const bool read_barrier = kUseBakerReadBarrier && size == kReference;
+  if (read_barrier) {
+    // The read barrier may call the runtime so everything to home locations.
+    FlushAllRegs();
+  }
   rl_array = LoadValue(rl_array, kRefReg);
 
   int data_offset;
@@ -1477,8 +1586,15 @@ void X86Mir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
       GenArrayBoundsCheck(rl_index.reg, rl_array.reg, len_offset);
     }
   }
+  RegStorage r_rb_state;
+  if (read_barrier) {
+    r_rb_state = GenReadBarrierLoadState(rl_array.reg, opt_flags);
+  }
   rl_result = EvalLoc(rl_dest, reg_class, true);
   LoadBaseIndexedDisp(rl_array.reg, rl_index.reg, scale, data_offset, rl_result.reg, size);
+  if (read_barrier) {
+    GenReadBarrierMark(r_rb_state, rl_result.reg);
+  }
   if ((size == k64) || (size == kDouble)) {
     StoreValueWide(rl_dest, rl_result);
   } else {
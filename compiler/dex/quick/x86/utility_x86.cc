@@ -987,4 +987,139 @@ RegLocation X86Mir2Lir::UpdateLocWideTyped(RegLocation loc, int reg_class) {
   return loc;
 }
 
+bool X86Mir2Lir::CCodesDeadAfter(LIR* lir, LIR* tail_lir) {
+  for (LIR* next_lir = NextPeepholeLIR(lir, tail_lir); next_lir != nullptr;
+       next_lir = NextPeepholeLIR(next_lir, tail_lir)) {
+    uint64_t flags = GetTargetInstFlags(next_lir->opcode);
+    if ((flags & (USES_CCODES | IS_BRANCH)) != 0) {
+      return false;
+    }
+    if ((flags & SETS_CCODES) != 0) {
+      return true;
+    }
+  }
+  // The condition codes may be used past the end of the pattern.
+  return false;
+}
+
+/*
+ * mov a, b; add a, imm => lea a, [b + imm]
+ * mov a, b; add a, c   => lea a, [b + c]
+ * Lea doesn't set the condition codes, so those of the add must be dead.
+ */
+bool X86Mir2Lir::FoldMoveIntoLea(LIR* mov_lir, LIR* next_lir, LIR* tail_lir) {
+  const bool is_64bit = mov_lir->opcode == kX86Mov64RR;
+  const int dest = mov_lir->operands[0];
+  const int src = mov_lir->operands[1];
+  if (next_lir->operands[0] != dest) {
+    return false;
+  }
+  int opcode = next_lir->opcode;
+  int index = -1;
+  int64_t disp = 0;
+  if (opcode == (is_64bit ? kX86Add64RI : kX86Add32RI) ||
+      opcode == (is_64bit ? kX86Add64RI8 : kX86Add32RI8)) {
+    disp = next_lir->operands[1];
+  } else if (opcode == (is_64bit ? kX86Sub64RI : kX86Sub32RI) ||
+             opcode == (is_64bit ? kX86Sub64RI8 : kX86Sub32RI8)) {
+    disp = -static_cast<int64_t>(next_lir->operands[1]);
+  } else if (!is_64bit && opcode == kX86Add32RR) {
+    // Adding the register to itself adds the copied value twice.
+    index = (next_lir->operands[1] == dest) ? src : next_lir->operands[1];
+    if (RegStorage::RegNum(index) == rs_rX86_SP.GetRegNum()) {
+      // Not encodable as an index.
+      return false;
+    }
+  } else {
+    return false;
+  }
+  if (!IS_SIMM32(disp) || !CCodesDeadAfter(next_lir, tail_lir)) {
+    return false;
+  }
+  LIR* lea_lir;
+  if (index >= 0) {
+    lea_lir = RawLIR(next_lir->dalvik_offset, kX86Lea32RA, dest, src, index, 0, 0);
+  } else {
+    lea_lir = RawLIR(next_lir->dalvik_offset, is_64bit ? kX86Lea64RM : kX86Lea32RM, dest, src,
+                     static_cast<int>(disp));
+  }
+  InsertLIRAfter(next_lir, lea_lir);
+  NopLIR(mov_lir);
+  NopLIR(next_lir);
+  return true;
+}
+
+/*
+ * lea a, [b + disp1]; mov a, [a + disp2] => mov a, [b + disp1 + disp2]
+ * The load overwrites the address, so nothing else can read it.
+ */
+bool X86Mir2Lir::FoldLeaIntoLoad(LIR* lea_lir, LIR* next_lir) {
+  // On x86-64 a 32 bit lea would truncate the address.
+  const int lea_opcode = Gen64Bit() ? kX86Lea64RM : kX86Lea32RM;
+  const int opcode = next_lir->opcode;
+  if (lea_lir->opcode != lea_opcode || (opcode != kX86Mov32RM && opcode != kX86Mov64RM)) {
+    return false;
+  }
+  const int addr = lea_lir->operands[0];
+  if (next_lir->operands[0] != addr || next_lir->operands[1] != addr) {
+    return false;
+  }
+  int64_t disp = static_cast<int64_t>(lea_lir->operands[2]) + next_lir->operands[2];
+  if (!IS_SIMM32(disp)) {
+    return false;
+  }
+  LIR* load_lir = RawLIR(next_lir->dalvik_offset, opcode, addr, lea_lir->operands[1],
+                         static_cast<int>(disp));
+  // Right after the load, where a safepoint of an implicit null check may follow.
+  InsertLIRAfter(next_lir, load_lir);
+  NopLIR(lea_lir);
+  NopLIR(next_lir);
+  return true;
+}
+
+void X86Mir2Lir::ApplyPeephole(LIR* lir, LIR* tail_lir) {
+  LIR* next_lir = NextPeepholeLIR(lir, tail_lir);
+  if (next_lir == nullptr) {
+    return;
+  }
+  switch (lir->opcode) {
+    case kX86Mov32RR:
+    case kX86Mov64RR:
+      // mov a, b; mov b, a => mov a, b
+      // On x86-64 the 32 bit move clears the high half of b, which may be needed.
+      if (next_lir->opcode == lir->opcode && (lir->opcode == kX86Mov64RR || !Gen64Bit()) &&
+          next_lir->operands[0] == lir->operands[1] &&
+          next_lir->operands[1] == lir->operands[0]) {
+        NopLIR(next_lir);
+      } else {
+        FoldMoveIntoLea(lir, next_lir, tail_lir);
+      }
+      break;
+    case kX86Lea32RM:
+    case kX86Lea64RM:
+      FoldLeaIntoLoad(lir, next_lir);
+      break;
+    // and a, b; test a, a => and a, b
+    // The logical operations set the condition codes exactly like the test of their result.
+    case kX86And32RR: case kX86And32RI: case kX86And32RI8: case kX86And32RM: case kX86And32RA:
+    case kX86Or32RR: case kX86Or32RI: case kX86Or32RI8: case kX86Or32RM: case kX86Or32RA:
+    case kX86Xor32RR: case kX86Xor32RI: case kX86Xor32RI8: case kX86Xor32RM: case kX86Xor32RA:
+      if (next_lir->opcode == kX86Test32RR && next_lir->operands[0] == lir->operands[0] &&
+          next_lir->operands[1] == lir->operands[0]) {
+        NopLIR(next_lir);
+      }
+      break;
+    case kX86And64RR: case kX86And64RI: case kX86And64RI8: case kX86And64RM: case kX86And64RA:
+    case kX86Or64RR: case kX86Or64RI: case kX86Or64RI8: case kX86Or64RM: case kX86Or64RA:
+    case kX86Xor64RR: case kX86Xor64RI: case kX86Xor64RI8: case kX86Xor64RM: case kX86Xor64RA:
+      if (next_lir->opcode == kX86Test64RR && next_lir->operands[0] == lir->operands[0] &&
+          next_lir->operands[1] == lir->operands[0]) {
+        NopLIR(next_lir);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
 }  // namespace art
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "verification_cache.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "class_linker.h"
+#include "dex_file-inl.h"
+#include "leb128.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "os.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "utils.h"
+#include "verification_results.h"
+#include "verifier/verifier_deps.h"
+
+namespace art {
+
+const uint8_t VerificationCache::kMagic[] = { 'v', 'r', 'c', '\n' };
+
+VerificationCache::VerificationCache(const std::vector<const DexFile*>& dex_files)
+    : verifier_deps_(new verifier::VerifierDeps(dex_files)) {
+}
+
+VerificationCache::~VerificationCache() {
+}
+
+VerificationCache* VerificationCache::Open(const std::string& filename,
+                                           const std::vector<const DexFile*>& dex_files,
+                                           std::string* error_msg) {
+  std::string contents;
+  if (!ReadFileToString(filename, &contents)) {
+    *error_msg = StringPrintf("Failed to read verification cache '%s'", filename.c_str());
+    return nullptr;
+  }
+  std::unique_ptr<VerificationCache> cache(new VerificationCache(dex_files));
+  if (!cache->Decode(dex_files, reinterpret_cast<const uint8_t*>(contents.data()),
+                     contents.size(), error_msg)) {
+    *error_msg = StringPrintf("Not using verification cache '%s': %s", filename.c_str(),
+                              error_msg->c_str());
+    return nullptr;
+  }
+  return cache.release();
+}
+
+bool VerificationCache::Write(const std::string& filename,
+                              const std::vector<const DexFile*>& dex_files, jobject class_loader,
+                              VerificationResults* results, std::string* error_msg) {
+  std::vector<uint8_t> data;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    Encode(dex_files, soa.Decode<mirror::ClassLoader*>(class_loader), results, &data);
+  }
+  // Written aside and renamed, so that the compiler never reads a partial file.
+  std::string temp_name = filename + ".tmp";
+  std::unique_ptr<File> file(OS::CreateEmptyFile(temp_name.c_str()));
+  if (file.get() == nullptr) {
+    *error_msg = StringPrintf("Failed to create '%s'", temp_name.c_str());
+    return false;
+  }
+  if (!file->WriteFully(data.data(), data.size()) || file->Close() != 0 ||
+      rename(temp_name.c_str(), filename.c_str()) != 0) {
+    *error_msg = StringPrintf("Failed to write '%s'", filename.c_str());
+    unlink(temp_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+const std::vector<VerificationCache::MethodResults>* VerificationCache::GetVerifiedClass(
+    ClassReference ref) const {
+  auto it = verified_classes_.find(ref);
+  return (it != verified_classes_.end()) ? &it->second : nullptr;
+}
+
+static void EncodeUnsigned(std::vector<uint8_t>* data, uint32_t value) {
+  uint8_t buffer[5];
+  data->insert(data->end(), buffer, EncodeUnsignedLeb128(buffer, value));
+}
+
+void VerificationCache::Encode(const std::vector<const DexFile*>& dex_files,
+                               mirror::ClassLoader* class_loader, VerificationResults* results,
+                               std::vector<uint8_t>* data) {
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  data->assign(kMagic, kMagic + sizeof(kMagic));
+  EncodeUnsigned(data, kVersion);
+  EncodeUnsigned(data, dex_files.size());
+  for (const DexFile* dex_file : dex_files) {
+    EncodeUnsigned(data, dex_file->GetLocationChecksum());
+    EncodeUnsigned(data, dex_file->NumClassDefs());
+  }
+  std::vector<uint8_t> deps;
+  results->GetVerifierDeps()->Encode(&deps);
+  EncodeUnsigned(data, deps.size());
+  data->insert(data->end(), deps.begin(), deps.end());
+  for (const DexFile* dex_file : dex_files) {
+    // The classes verified without failures, soft failures are verified again at runtime.
+    std::vector<uint32_t> verified_classes;
+    for (size_t i = 0; i != dex_file->NumClassDefs(); ++i) {
+      const DexFile::ClassDef& class_def = dex_file->GetClassDef(i);
+      mirror::Class* klass =
+          class_linker->LookupClass(dex_file->GetClassDescriptor(class_def), class_loader);
+      if (klass != nullptr && klass->IsVerified() && &klass->GetDexFile() == dex_file &&
+          klass->GetDexClassDefIndex() == i) {
+        verified_classes.push_back(i);
+      }
+    }
+    EncodeUnsigned(data, verified_classes.size());
+    for (uint32_t class_def_idx : verified_classes) {
+      std::vector<std::pair<uint32_t, const VerifiedMethod*>> methods;
+      const byte* class_data = dex_file->GetClassData(dex_file->GetClassDef(class_def_idx));
+      if (class_data != nullptr) {
+        ClassDataItemIterator it(*dex_file, class_data);
+        while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+          it.Next();
+        }
+        for (; it.HasNextDirectMethod() || it.HasNextVirtualMethod(); it.Next()) {
+          const VerifiedMethod* verified_method =
+              results->GetVerifiedMethod(MethodReference(dex_file, it.GetMemberIndex()));
+          if (verified_method != nullptr) {
+            methods.push_back(std::make_pair(it.GetMemberIndex(), verified_method));
+          }
+        }
+      }
+      EncodeUnsigned(data, class_def_idx);
+      EncodeUnsigned(data, methods.size());
+      for (const auto& method : methods) {
+        const std::vector<uint8_t>& dex_gc_map = method.second->GetDexGcMap();
+        const VerifiedMethod::SafeCastSet& safe_cast_set = method.second->GetSafeCastSet();
+        EncodeUnsigned(data, method.first);
+        EncodeUnsigned(data, dex_gc_map.size());
+        data->insert(data->end(), dex_gc_map.begin(), dex_gc_map.end());
+        // The dex pcs are sorted, store their differences.
+        EncodeUnsigned(data, safe_cast_set.size());
+        uint32_t previous_dex_pc = 0u;
+        for (uint32_t dex_pc : safe_cast_set) {
+          EncodeUnsigned(data, dex_pc - previous_dex_pc);
+          previous_dex_pc = dex_pc;
+        }
+      }
+    }
+  }
+}
+
+bool VerificationCache::Decode(const std::vector<const DexFile*>& dex_files, const uint8_t* data,
+                               size_t size, std::string* error_msg) {
+  const uint8_t* end = data + size;
+  if (size < sizeof(kMagic) || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+    *error_msg = "bad magic";
+    return false;
+  }
+  data += sizeof(kMagic);
+  uint32_t version;
+  uint32_t num_dex_files;
+  if (!DecodeUnsignedLeb128Checked(&data, end, &version) || version != kVersion ||
+      !DecodeUnsignedLeb128Checked(&data, end, &num_dex_files)) {
+    *error_msg = "bad version";
+    return false;
+  }
+  if (num_dex_files != dex_files.size()) {
+    *error_msg = StringPrintf("written for %u dex files, not %zu", num_dex_files,
+                              dex_files.size());
+    return false;
+  }
+  for (const DexFile* dex_file : dex_files) {
+    uint32_t checksum;
+    uint32_t num_class_defs;
+    if (!DecodeUnsignedLeb128Checked(&data, end, &checksum) ||
+        !DecodeUnsignedLeb128Checked(&data, end, &num_class_defs)) {
+      *error_msg = "truncated header";
+      return false;
+    }
+    if (checksum != dex_file->GetLocationChecksum() ||
+        num_class_defs != dex_file->NumClassDefs()) {
+      *error_msg = StringPrintf("written for another version of '%s'",
+                                dex_file->GetLocation().c_str());
+      return false;
+    }
+  }
+  uint32_t deps_size;
+  if (!DecodeUnsignedLeb128Checked(&data, end, &deps_size) ||
+      deps_size > static_cast<size_t>(end - data) || !verifier_deps_->Decode(data, deps_size)) {
+    *error_msg = "bad dependencies";
+    return false;
+  }
+  data += deps_size;
+  for (const DexFile* dex_file : dex_files) {
+    uint32_t num_classes;
+    if (!DecodeUnsignedLeb128Checked(&data, end, &num_classes)) {
+      *error_msg = "truncated classes";
+      return false;
+    }
+    for (uint32_t i = 0; i != num_classes; ++i) {
+      uint32_t class_def_idx;
+      uint32_t num_methods;
+      if (!DecodeUnsignedLeb128Checked(&data, end, &class_def_idx) ||
+          class_def_idx >= dex_file->NumClassDefs() ||
+          !DecodeUnsignedLeb128Checked(&data, end, &num_methods)) {
+        *error_msg = "bad class";
+        return false;
+      }
+      std::vector<MethodResults>& methods =
+          verified_classes_[ClassReference(dex_file, class_def_idx)];
+      methods.resize(num_methods);
+      for (MethodResults& method : methods) {
+        uint32_t gc_map_size;
+        if (!DecodeUnsignedLeb128Checked(&data, end, &method.method_idx_) ||
+            method.method_idx_ >= dex_file->NumMethodIds() ||
+            !DecodeUnsignedLeb128Checked(&data, end, &gc_map_size) ||
+            gc_map_size > static_cast<size_t>(end - data)) {
+          *error_msg = "bad method";
+          return false;
+        }
+        method.dex_gc_map_.assign(data, data + gc_map_size);
+        data += gc_map_size;
+        uint32_t num_safe_casts;
+        if (!DecodeUnsignedLeb128Checked(&data, end, &num_safe_casts) ||
+            num_safe_casts > static_cast<size_t>(end - data)) {
+          *error_msg = "bad safe casts";
+          return false;
+        }
+        uint32_t dex_pc = 0u;
+        for (uint32_t j = 0; j != num_safe_casts; ++j) {
+          uint32_t delta;
+          if (!DecodeUnsignedLeb128Checked(&data, end, &delta)) {
+            *error_msg = "bad safe casts";
+            return false;
+          }
+          dex_pc += delta;
+          method.safe_cast_set_.push_back(dex_pc);
+        }
+      }
+    }
+  }
+  if (data != end) {
+    *error_msg = "trailing data";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace art
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_COMPILER_DEX_VERIFICATION_CACHE_H_
+#define ART_COMPILER_DEX_VERIFICATION_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "class_reference.h"
+#include "jni.h"
+#include "verified_method.h"
+
+namespace art {
+
+namespace mirror {
+class ClassLoader;
+}  // namespace mirror
+
+namespace verifier {
+class VerifierDeps;
+}  // namespace verifier
+
+class DexFile;
+class VerificationResults;
+
+// The verification results of a compilation, kept in a file so that a later compilation of the
+// same dex files doesn't have to verify them again: the classes which were verified, the
+// verified methods the compiler needs for them, and the dependencies of the verification on the
+// classes outside of the dex files. The results are used while the dependencies hold, typically
+// when only the boot class path changed in ways the app doesn't see.
+//
+// Only the classes verified without failures are kept, the others are verified again.
+class VerificationCache {
+ public:
+  struct MethodResults {
+    uint32_t method_idx_;
+    std::vector<uint8_t> dex_gc_map_;
+    VerifiedMethod::SafeCastSet safe_cast_set_;
+  };
+
+  ~VerificationCache();
+
+  // Reads the cache file, returns null if there's none, it is malformed, or it was written for
+  // other dex files.
+  static VerificationCache* Open(const std::string& filename,
+                                 const std::vector<const DexFile*>& dex_files,
+                                 std::string* error_msg);
+
+  // Writes the results of the verification of dex_files, which was done in the class loader, and
+  // the dependencies recorded by results.
+  static bool Write(const std::string& filename, const std::vector<const DexFile*>& dex_files,
+                    jobject class_loader, VerificationResults* results, std::string* error_msg)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  const verifier::VerifierDeps& GetVerifierDeps() const {
+    return *verifier_deps_;
+  }
+
+  // The results of the methods of the class, null if the class wasn't verified.
+  const std::vector<MethodResults>* GetVerifiedClass(ClassReference ref) const;
+
+  size_t NumClasses() const {
+    return verified_classes_.size();
+  }
+
+ private:
+  explicit VerificationCache(const std::vector<const DexFile*>& dex_files);
+
+  static void Encode(const std::vector<const DexFile*>& dex_files,
+                     mirror::ClassLoader* class_loader, VerificationResults* results,
+                     std::vector<uint8_t>* data)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  bool Decode(const std::vector<const DexFile*>& dex_files, const uint8_t* data, size_t size,
+              std::string* error_msg);
+
+  static constexpr uint32_t kVersion = 1;
+  static const uint8_t kMagic[4];
+
+  std::unique_ptr<verifier::VerifierDeps> verifier_deps_;
+  std::map<ClassReference, std::vector<MethodResults>> verified_classes_;
+
+  DISALLOW_COPY_AND_ASSIGN(VerificationCache);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DEX_VERIFICATION_CACHE_H_
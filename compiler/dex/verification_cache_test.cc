@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "verification_cache.h"
+
+#include <memory>
+
+#include "common_compiler_test.h"
+#include "handle_scope-inl.h"
+#include "mirror/class_loader.h"
+#include "verification_results.h"
+#include "verified_method.h"
+#include "verifier/verifier_deps.h"
+
+namespace art {
+
+class VerificationCacheTest : public CommonCompilerTest {
+ protected:
+  void CompileAll(jobject class_loader) LOCKS_EXCLUDED(Locks::mutator_lock_) {
+    TimingLogger timings("VerificationCacheTest::CompileAll", false, false);
+    timings.StartSplit("CompileAll");
+    compiler_driver_->CompileAll(class_loader,
+                                 Runtime::Current()->GetCompileTimeClassPath(class_loader),
+                                 &timings);
+    timings.EndSplit();
+  }
+};
+
+TEST_F(VerificationCacheTest, WriteAndOpen) {
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("Interfaces");
+  }
+  const std::vector<const DexFile*>& dex_files =
+      Runtime::Current()->GetCompileTimeClassPath(class_loader);
+  verification_results_->UseVerificationCache(dex_files, nullptr);
+  CompileAll(class_loader);
+  // The constructors call the one of java.lang.Object at least.
+  EXPECT_NE(0U, verification_results_->GetVerifierDeps()->NumDependencies());
+
+  ScratchFile file;
+  std::string error_msg;
+  ASSERT_TRUE(VerificationCache::Write(file.GetFilename(), dex_files, class_loader,
+                                       verification_results_.get(), &error_msg)) << error_msg;
+  std::unique_ptr<VerificationCache> cache(
+      VerificationCache::Open(file.GetFilename(), dex_files, &error_msg));
+  ASSERT_TRUE(cache.get() != nullptr) << error_msg;
+  EXPECT_EQ(verification_results_->GetVerifierDeps()->NumDependencies(),
+            cache->GetVerifierDeps().NumDependencies());
+
+  // All the classes verify, with the same verified methods as the compilation.
+  const DexFile* dex_file = dex_files[0];
+  EXPECT_EQ(dex_file->NumClassDefs(), cache->NumClasses());
+  for (size_t i = 0; i != dex_file->NumClassDefs(); ++i) {
+    const std::vector<VerificationCache::MethodResults>* methods =
+        cache->GetVerifiedClass(ClassReference(dex_file, i));
+    ASSERT_TRUE(methods != nullptr);
+    for (const VerificationCache::MethodResults& method : *methods) {
+      const VerifiedMethod* verified_method =
+          verification_results_->GetVerifiedMethod(MethodReference(dex_file, method.method_idx_));
+      ASSERT_TRUE(verified_method != nullptr);
+      EXPECT_TRUE(verified_method->GetDexGcMap() == method.dex_gc_map_);
+      EXPECT_TRUE(verified_method->GetSafeCastSet() == method.safe_cast_set_);
+    }
+  }
+
+  // The classes the verification depended on are unchanged.
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::ClassLoader> loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader*>(class_loader)));
+  EXPECT_TRUE(cache->GetVerifierDeps().Validate(loader, soa.Self()));
+}
+
+TEST_F(VerificationCacheTest, OtherDexFiles) {
+  jobject class_loader;
+  std::vector<const DexFile*> other_dex_files;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("Interfaces");
+    other_dex_files.push_back(OpenTestDexFile("Nested"));
+  }
+  const std::vector<const DexFile*>& dex_files =
+      Runtime::Current()->GetCompileTimeClassPath(class_loader);
+  verification_results_->UseVerificationCache(dex_files, nullptr);
+  CompileAll(class_loader);
+
+  ScratchFile file;
+  std::string error_msg;
+  ASSERT_TRUE(VerificationCache::Write(file.GetFilename(), dex_files, class_loader,
+                                       verification_results_.get(), &error_msg)) << error_msg;
+  std::unique_ptr<VerificationCache> cache(
+      VerificationCache::Open(file.GetFilename(), other_dex_files, &error_msg));
+  EXPECT_TRUE(cache.get() == nullptr);
+  cache.reset(VerificationCache::Open(file.GetFilename() + ".missing", dex_files, &error_msg));
+  EXPECT_TRUE(cache.get() == nullptr);
+}
+
+}  // namespace art
@@ -23,9 +23,11 @@
 #include "driver/compiler_options.h"
 #include "thread.h"
 #include "thread-inl.h"
+#include "verification_cache.h"
 #include "verified_method.h"
 #include "verifier/method_verifier.h"
 #include "verifier/method_verifier-inl.h"
+#include "verifier/verifier_deps.h"
 
 namespace art {
 
@@ -59,7 +61,12 @@ bool VerificationResults::ProcessVerifiedMethod(verifier::MethodVerifier* method
     DCHECK(method_verifier->HasFailures());
     return false;
   }
+  AddVerifiedMethod(ref, verified_method);
+  return true;
+}
 
+void VerificationResults::AddVerifiedMethod(MethodReference ref,
+                                            const VerifiedMethod* verified_method) {
   WriterMutexLock mu(Thread::Current(), verified_methods_lock_);
   auto it = verified_methods_.find(ref);
   if (it != verified_methods_.end()) {
@@ -74,7 +81,6 @@ bool VerificationResults::ProcessVerifiedMethod(verifier::MethodVerifier* method
   }
   verified_methods_.Put(ref, verified_method);
   DCHECK(verified_methods_.find(ref) != verified_methods_.end());
-  return true;
 }
 
 const VerifiedMethod* VerificationResults::GetVerifiedMethod(MethodReference ref) {
@@ -96,6 +102,44 @@ bool VerificationResults::IsClassRejected(ClassReference ref) {
   return (rejected_classes_.find(ref) != rejected_classes_.end());
 }
 
+void VerificationResults::UseVerificationCache(const std::vector<const DexFile*>& dex_files,
+                                               VerificationCache* cache) {
+  verifier_deps_.reset(new verifier::VerifierDeps(dex_files));
+  verification_cache_.reset(cache);
+}
+
+void VerificationResults::ValidateVerificationCache(Handle<mirror::ClassLoader> class_loader,
+                                                    Thread* self) {
+  if (verification_cache_.get() == nullptr) {
+    return;
+  }
+  if (!verification_cache_->GetVerifierDeps().Validate(class_loader, self)) {
+    LOG(INFO) << "Verifying all classes, the classes the verification cache depends on changed";
+    verification_cache_.reset();
+    return;
+  }
+  // The restored classes still depend on the cached dependencies, keep them for the next cache.
+  verifier_deps_->MergeFrom(verification_cache_->GetVerifierDeps());
+  VLOG(compiler) << "Using the verification results of " << verification_cache_->NumClasses()
+                 << " classes from the verification cache";
+}
+
+bool VerificationResults::RestoreVerifiedClass(ClassReference ref) {
+  if (verification_cache_.get() == nullptr) {
+    return false;
+  }
+  const std::vector<VerificationCache::MethodResults>* methods =
+      verification_cache_->GetVerifiedClass(ref);
+  if (methods == nullptr) {
+    return false;
+  }
+  for (const VerificationCache::MethodResults& method : *methods) {
+    AddVerifiedMethod(MethodReference(ref.first, method.method_idx_),
+                      VerifiedMethod::Create(method.dex_gc_map_, method.safe_cast_set_));
+  }
+  return true;
+}
+
 bool VerificationResults::IsCandidateForCompilation(MethodReference& method_ref,
                                                     const uint32_t access_flags) {
 #ifdef ART_SEA_IR_MODE
@@ -18,22 +18,32 @@
 #define ART_COMPILER_DEX_VERIFICATION_RESULTS_H_
 
 #include <stdint.h>
+#include <memory>
 #include <set>
 #include <vector>
 
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "class_reference.h"
+#include "handle.h"
 #include "method_reference.h"
 #include "safe_map.h"
 
 namespace art {
 
+namespace mirror {
+class ClassLoader;
+}  // namespace mirror
+
 namespace verifier {
 class MethodVerifier;
+class VerifierDeps;
 }  // namespace verifier
 
 class CompilerOptions;
+class DexFile;
+class Thread;
+class VerificationCache;
 class VerifiedMethod;
 
 // Used by CompilerCallbacks to track verification information from the Runtime.
@@ -55,7 +65,30 @@ class VerificationResults {
     bool IsCandidateForCompilation(MethodReference& method_ref,
                                    const uint32_t access_flags);
 
+    // Records the dependencies of the verification of dex_files on the classes outside of them,
+    // and uses the results kept in cache, if not null, for the classes it holds. Takes ownership
+    // of the cache.
+    void UseVerificationCache(const std::vector<const DexFile*>& dex_files,
+                              VerificationCache* cache);
+
+    // Drops the cached results unless their dependencies hold for the classes found through
+    // class_loader. Called before the verification.
+    void ValidateVerificationCache(Handle<mirror::ClassLoader> class_loader, Thread* self)
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+    // Adds the cached verified methods of the class. Returns false, and adds nothing, if the
+    // class isn't verified in the cache.
+    bool RestoreVerifiedClass(ClassReference ref) LOCKS_EXCLUDED(verified_methods_lock_);
+
+    // The recorded dependencies, null unless a verification cache is used.
+    verifier::VerifierDeps* GetVerifierDeps() const {
+      return verifier_deps_.get();
+    }
+
   private:
+    void AddVerifiedMethod(MethodReference ref, const VerifiedMethod* verified_method)
+        LOCKS_EXCLUDED(verified_methods_lock_);
+
     // Verified methods.
     typedef SafeMap<MethodReference, const VerifiedMethod*,
         MethodReferenceComparator> VerifiedMethodMap;
@@ -65,6 +98,9 @@ class VerificationResults {
     // Rejected classes.
     ReaderWriterMutex rejected_classes_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
     std::set<ClassReference> rejected_classes_ GUARDED_BY(rejected_classes_lock_);
+
+    std::unique_ptr<verifier::VerifierDeps> verifier_deps_;
+    std::unique_ptr<VerificationCache> verification_cache_;
 };
 
 }  // namespace art
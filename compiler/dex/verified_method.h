@@ -41,6 +41,10 @@ class VerifiedMethod {
 
   static const VerifiedMethod* Create(verifier::MethodVerifier* method_verifier, bool compile)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Re-creates the verified method of an earlier compilation of the method. It has no
+  // devirtualization map, whose targets outside of the dex file may have changed since.
+  static const VerifiedMethod* Create(const std::vector<uint8_t>& dex_gc_map,
+                                      const SafeCastSet& safe_cast_set);
   ~VerifiedMethod() = default;
 
   const std::vector<uint8_t>& GetDexGcMap() const {
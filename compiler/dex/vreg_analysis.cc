@@ -486,6 +486,15 @@ void MIRGraph::InitRegLocations() {
  */
 void MIRGraph::RemapRegLocations() {
   for (int i = 0; i < GetNumSSARegs(); i++) {
+    // Constant propagation doesn't know the sizes of phis, a wide value is only constant if both
+    // halves are.
+    if (reg_location_[i].wide && (i + 1 < GetNumSSARegs()) &&
+        reg_location_[i].is_const != reg_location_[i + 1].is_const) {
+      reg_location_[i].is_const = false;
+      reg_location_[i + 1].is_const = false;
+      is_constant_v_->ClearBit(i);
+      is_constant_v_->ClearBit(i + 1);
+    }
     if (reg_location_[i].location != kLocCompilerTemp) {
       int orig_sreg = reg_location_[i].s_reg_low;
       reg_location_[i].orig_sreg = orig_sreg;
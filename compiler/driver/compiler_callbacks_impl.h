@@ -19,6 +19,10 @@
 
 #include "compiler_callbacks.h"
 #include "dex/quick/dex_file_to_method_inliner_map.h"
+#include "dex/verification_results.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
 #include "verifier/method_verifier-inl.h"
 
 namespace art {
@@ -41,6 +45,13 @@ class CompilerCallbacksImpl FINAL : public CompilerCallbacks {
       verification_results_->AddRejectedClass(ref);
     }
 
+    verifier::VerifierDeps* GetVerifierDeps() const OVERRIDE {
+      return verification_results_->GetVerifierDeps();
+    }
+
+    bool RestoreVerifiedClass(mirror::Class* klass)
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) OVERRIDE;
+
   private:
     VerificationResults* const verification_results_;
     DexFileToMethodInlinerMap* const method_inliner_map_;
@@ -56,6 +67,35 @@ inline bool CompilerCallbacksImpl::MethodVerified(verifier::MethodVerifier* veri
   return result;
 }
 
+inline bool CompilerCallbacksImpl::RestoreVerifiedClass(mirror::Class* klass) {
+  const DexFile& dex_file = klass->GetDexFile();
+  if (!verification_results_->RestoreVerifiedClass(
+          ClassReference(&dex_file, klass->GetDexClassDefIndex()))) {
+    return false;
+  }
+  // The inliner analyses the methods as they are verified, analyse the restored ones. The
+  // analysis only needs the code and the resolved fields, not the results of the verifier.
+  StackHandleScope<2> hs(Thread::Current());
+  Handle<mirror::DexCache> dex_cache(hs.NewHandle(klass->GetDexCache()));
+  Handle<mirror::ClassLoader> class_loader(hs.NewHandle(klass->GetClassLoader()));
+  DexFileMethodInliner* inliner = method_inliner_map_->GetMethodInliner(&dex_file);
+  size_t num_methods = klass->NumDirectMethods() + klass->NumVirtualMethods();
+  for (size_t i = 0; i != num_methods; ++i) {
+    mirror::ArtMethod* method = (i < klass->NumDirectMethods())
+        ? klass->GetDirectMethod(i)
+        : klass->GetVirtualMethod(i - klass->NumDirectMethods());
+    MethodHelper mh(method);
+    const DexFile::CodeItem* code_item = mh.GetCodeItem();
+    if (code_item != nullptr) {
+      verifier::MethodVerifier verifier(&dex_file, &dex_cache, &class_loader, klass->GetClassDef(),
+                                        code_item, method->GetDexMethodIndex(), method,
+                                        method->GetAccessFlags(), true, true, false);
+      inliner->AnalyseMethodCode(&verifier);
+    }
+  }
+  return true;
+}
+
 }  // namespace art
 
 #endif  // ART_COMPILER_DRIVER_COMPILER_CALLBACKS_IMPL_H_
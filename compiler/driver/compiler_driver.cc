@@ -19,6 +19,7 @@
 #define ATRACE_TAG ATRACE_TAG_DALVIK
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <vector>
 #include <unistd.h>
 
@@ -33,6 +34,7 @@
 #include "dex/verified_method.h"
 #include "dex/quick/dex_file_method_inliner.h"
 #include "driver/compiler_options.h"
+#include "driver/previous_oat_file.h"
 #include "jni_internal.h"
 #include "object_utils.h"
 #include "runtime.h"
@@ -333,7 +335,8 @@ CompilerDriver::CompilerDriver(const CompilerOptions* compiler_options,
                                bool image, DescriptorSet* image_classes, size_t thread_count,
                                bool dump_stats, bool dump_passes, CumulativeLogger* timer,
                                std::string profile_file)
-    : profile_ok_(false), compiler_options_(compiler_options),
+    : profile_ok_(false), overridden_methods_computed_(false),
+      compiler_options_(compiler_options),
       verification_results_(verification_results),
       method_inliner_map_(method_inliner_map),
       compiler_(Compiler::Create(this, compiler_kind)),
@@ -341,7 +344,10 @@ CompilerDriver::CompilerDriver(const CompilerOptions* compiler_options,
       instruction_set_features_(instruction_set_features),
       freezing_constructor_lock_("freezing constructor lock"),
       compiled_classes_lock_("compiled classes lock"),
+      class_init_failures_lock_("class initialization failures lock"),
       compiled_methods_lock_("compiled method lock"),
+      record_compilation_decisions_(false),
+      compilation_decisions_lock_("compilation decisions lock"),
       image_(image),
       image_classes_(image_classes),
       thread_count_(thread_count),
@@ -349,9 +355,11 @@ CompilerDriver::CompilerDriver(const CompilerOptions* compiler_options,
       stats_(new AOTCompilationStats),
       dump_stats_(dump_stats),
       dump_passes_(dump_passes),
+      count_arena_allocations_(dump_stats),
       timings_logger_(timer),
       compiler_library_(NULL),
       compiler_context_(NULL),
+      tls_lock_("compiler tls lock"),
       compiler_enable_auto_elf_loading_(NULL),
       compiler_get_method_code_addr_(NULL),
       support_boot_image_fixup_(instruction_set != kMips),
@@ -370,13 +378,19 @@ CompilerDriver::CompilerDriver(const CompilerOptions* compiler_options,
   // Read the profile file if one is provided.
   if (profile_file != "") {
     profile_ok_ = ProfileHelper::LoadProfileMap(profile_map_, profile_file);
+    // The call sites are optional, older runtimes only write the method profile.
+    if (profile_ok_ &&
+        !call_site_profile_.ReadFromFile(CallSiteProfile::GetFileName(profile_file))) {
+      VLOG(compiler) << "No call site profile for " << profile_file;
+    }
   }
 
   dex_to_dex_compiler_ = reinterpret_cast<DexToDexCompilerFn>(ArtCompileDEX);
 
   compiler_->Init();
 
-  CHECK(!Runtime::Current()->IsStarted());
+  // Only the JIT compiles once the runtime is started.
+  CHECK(!Runtime::Current()->IsStarted() || Runtime::Current()->UseJit());
   if (image_) {
     CHECK(image_classes_.get() != nullptr);
   } else {
@@ -434,6 +448,10 @@ CompilerDriver::~CompilerDriver() {
     MutexLock mu(self, compiled_methods_lock_);
     STLDeleteElements(&classes_to_patch_);
   }
+  {
+    MutexLock mu(self, tls_lock_);
+    STLDeleteElements(&tls_);
+  }
   CHECK_PTHREAD_CALL(pthread_key_delete, (tls_key_), "delete tls key");
   compiler_->UnInit();
 }
@@ -442,12 +460,55 @@ CompilerTls* CompilerDriver::GetTls() {
   // Lazily create thread-local storage
   CompilerTls* res = static_cast<CompilerTls*>(pthread_getspecific(tls_key_));
   if (res == NULL) {
-    res = new CompilerTls();
+    res = new CompilerTls(count_arena_allocations_);
     CHECK_PTHREAD_CALL(pthread_setspecific, (tls_key_, res), "compiler tls");
+    MutexLock mu(Thread::Current(), tls_lock_);
+    tls_.push_back(res);
   }
   return res;
 }
 
+void CompilerDriver::ReclaimArenaMemory() {
+  MutexLock mu(Thread::Current(), tls_lock_);
+  for (CompilerTls* tls : tls_) {
+    tls->GetArenaPool()->ReclaimMemory();
+  }
+}
+
+ArenaPoolStats CompilerDriver::GetArenaStats() const {
+  ArenaPoolStats stats;
+  MutexLock mu(Thread::Current(), tls_lock_);
+  for (CompilerTls* tls : tls_) {
+    stats.Merge(tls->GetArenaPool()->GetStats());
+  }
+  return stats;
+}
+
+void CompilerDriver::DumpArenaStats(std::ostream& os) const {
+  os << "Compiler arena stats:\n";
+  GetArenaStats().Dump(os);
+}
+
+void CompilerDriver::RecordCompilationDecision(const DexFile& dex_file, uint32_t method_idx,
+                                               const char* decision) {
+  if (!record_compilation_decisions_) {
+    return;
+  }
+  MethodReference ref(&dex_file, method_idx);
+  MutexLock mu(Thread::Current(), compilation_decisions_lock_);
+  if (compilation_decisions_.find(ref) == compilation_decisions_.end()) {
+    compilation_decisions_.Put(ref, decision);
+  }
+}
+
+void CompilerDriver::DumpCompilationDecisions(std::ostream& os) const {
+  MutexLock mu(Thread::Current(), compilation_decisions_lock_);
+  for (const auto& entry : compilation_decisions_) {
+    os << PrettyMethod(entry.first.dex_method_index, *entry.first.dex_file) << " "
+       << entry.second << "\n";
+  }
+}
+
 #define CREATE_TRAMPOLINE(type, abi, offset) \
     if (Is64BitInstructionSet(instruction_set_)) { \
       return CreateTrampoline64(instruction_set_, abi, \
@@ -505,9 +566,92 @@ void CompilerDriver::CompileAll(jobject class_loader,
   std::unique_ptr<ThreadPool> thread_pool(new ThreadPool("Compiler driver thread pool", thread_count_ - 1));
   PreCompile(class_loader, dex_files, thread_pool.get(), timings);
   Compile(class_loader, dex_files, thread_pool.get(), timings);
+  // The compiler threads are idle until the next compilation, if any.
+  ReclaimArenaMemory();
   if (dump_stats_) {
+    if (previous_oat_file_.get() != nullptr) {
+      LOG(INFO) << "Reused " << previous_oat_file_->NumReusedMethods()
+                << " compiled methods from " << previous_oat_file_->GetLocation();
+    }
     stats_->Dump();
+    std::ostringstream os;
+    DumpArenaStats(os);
+    LOG(INFO) << os.str();
+    DumpDedupeStats();
+  }
+}
+
+void CompilerDriver::SetPreviousOatFile(PreviousOatFile* previous_oat_file) {
+  // Image code is patched with the addresses of the image being written, app code only refers
+  // to the boot image directly, which is the same for both oat files.
+  CHECK(!image_);
+  CHECK(!compiler_->IsPortable());
+  previous_oat_file_.reset(previous_oat_file);
+}
+
+void CompilerDriver::ReleaseCompiledMethods() {
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, compiled_methods_lock_);
+    STLDeleteValues(&compiled_methods_);
   }
+  // The methods were the only users of the deduplicated arrays.
+  dedupe_code_.Clear(self);
+  dedupe_mapping_table_.Clear(self);
+  dedupe_vmap_table_.Clear(self);
+  dedupe_gc_map_.Clear(self);
+  dedupe_cfi_info_.Clear(self);
+}
+
+void CompilerDriver::DumpDedupeStats() const {
+  Thread* self = Thread::Current();
+  LOG(INFO) << dedupe_code_.DumpStats(self);
+  LOG(INFO) << dedupe_mapping_table_.DumpStats(self);
+  LOG(INFO) << dedupe_vmap_table_.DumpStats(self);
+  LOG(INFO) << dedupe_gc_map_.DumpStats(self);
+  LOG(INFO) << dedupe_cfi_info_.DumpStats(self);
+}
+
+void CompilerDriver::RecordClassInitializationFailure(const char* descriptor,
+                                                      const std::string& cause) {
+  MutexLock mu(Thread::Current(), class_init_failures_lock_);
+  auto it = class_init_failures_.find(cause);
+  if (it == class_init_failures_.end()) {
+    class_init_failures_.Put(cause, std::vector<std::string>());
+    it = class_init_failures_.find(cause);
+  }
+  it->second.push_back(descriptor);
+}
+
+void CompilerDriver::DumpClassInitializationFailures() const {
+  MutexLock mu(Thread::Current(), class_init_failures_lock_);
+  if (class_init_failures_.empty()) {
+    return;
+  }
+  std::vector<std::pair<size_t, const std::string*>> causes;
+  size_t num_classes = 0;
+  for (const auto& entry : class_init_failures_) {
+    causes.push_back(std::make_pair(entry.second.size(), &entry.first));
+    num_classes += entry.second.size();
+  }
+  // Most frequent first, the order of the causes breaks the ties.
+  std::sort(causes.begin(), causes.end(),
+            [](const std::pair<size_t, const std::string*>& lhs,
+               const std::pair<size_t, const std::string*>& rhs) {
+              return lhs.first != rhs.first ? lhs.first > rhs.first : *lhs.second < *rhs.second;
+            });
+  std::ostringstream os;
+  os << "Initialization of " << num_classes << " image classes aborted, "
+     << causes.size() << " causes:\n";
+  for (const auto& cause : causes) {
+    const std::vector<std::string>& classes = class_init_failures_.Get(*cause.second);
+    os << "  " << cause.first << " " << *cause.second << " (" << classes.front();
+    if (classes.size() > 1) {
+      os << ", ...";
+    }
+    os << ")\n";
+  }
+  LOG(INFO) << os.str();
 }
 
 static DexToDexCompilationLevel GetDexToDexCompilationlevel(
@@ -590,6 +734,15 @@ void CompilerDriver::CompileOne(mirror::ArtMethod* method, TimingLogger* timings
   self->TransitionFromSuspendedToRunnable();
 }
 
+void CompilerDriver::CompileJitMethod(const DexFile::CodeItem* code_item, uint32_t access_flags,
+                                      InvokeType invoke_type, uint16_t class_def_idx,
+                                      uint32_t method_idx, jobject class_loader,
+                                      const DexFile& dex_file) {
+  DCHECK(Runtime::Current()->UseJit());
+  CompileMethod(code_item, access_flags, invoke_type, class_def_idx, method_idx, class_loader,
+                dex_file, kDontDexToDexCompile);
+}
+
 void CompilerDriver::Resolve(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                              ThreadPool* thread_pool, TimingLogger* timings) {
   for (size_t i = 0; i != dex_files.size(); ++i) {
@@ -615,6 +768,8 @@ void CompilerDriver::PreCompile(jobject class_loader, const std::vector<const De
   InitializeClasses(class_loader, dex_files, thread_pool, timings);
 
   UpdateImageClasses(timings);
+
+  ComputeOverriddenMethods(timings);
 }
 
 bool CompilerDriver::IsImageClass(const char* descriptor) const {
@@ -808,6 +963,46 @@ void CompilerDriver::UpdateImageClasses(TimingLogger* timings) {
   }
 }
 
+static bool RecordOverriddenMethodsClassVisitor(mirror::Class* klass, void* arg)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  std::set<MethodReference, MethodReferenceComparator>* overridden_methods =
+      reinterpret_cast<std::set<MethodReference, MethodReferenceComparator>*>(arg);
+  mirror::Class* super_class = klass->GetSuperClass();
+  if (klass->IsInterface() || super_class == nullptr) {
+    return true;
+  }
+  mirror::ObjectArray<mirror::ArtMethod>* vtable = klass->GetVTable();
+  mirror::ObjectArray<mirror::ArtMethod>* super_vtable = super_class->GetVTable();
+  if (vtable == nullptr || super_vtable == nullptr) {
+    return true;  // Erroneous class.
+  }
+  DCHECK_GE(vtable->GetLength(), super_vtable->GetLength());
+  for (int32_t i = 0; i < super_vtable->GetLength(); ++i) {
+    mirror::ArtMethod* super_method = super_vtable->Get(i);
+    if (vtable->Get(i) != super_method) {
+      MethodHelper mh(super_method);
+      overridden_methods->insert(MethodReference(&mh.GetDexFile(),
+                                                 super_method->GetDexMethodIndex()));
+    }
+  }
+  return true;
+}
+
+void CompilerDriver::ComputeOverriddenMethods(TimingLogger* timings) {
+  timings->NewSplit("ComputeOverriddenMethods");
+  // All the classes of the compiled dex files and the boot class path are loaded by now.
+  ScopedObjectAccess soa(Thread::Current());
+  Runtime::Current()->GetClassLinker()->VisitClasses(RecordOverriddenMethodsClassVisitor,
+                                                     &overridden_methods_);
+  overridden_methods_computed_ = true;
+  VLOG(compiler) << "Overridden methods: " << overridden_methods_.size();
+}
+
+bool CompilerDriver::MayBeOverridden(const MethodReference& ref) const {
+  return !overridden_methods_computed_ ||
+      overridden_methods_.find(ref) != overridden_methods_.end();
+}
+
 bool CompilerDriver::CanAssumeTypeIsPresentInDexCache(const DexFile& dex_file, uint32_t type_idx) {
   if (IsImage() &&
       IsImageClass(dex_file.StringDataByIdx(dex_file.GetTypeId(type_idx).descriptor_idx_))) {
@@ -850,7 +1045,8 @@ bool CompilerDriver::CanAssumeStringIsPresentInDexCache(const DexFile& dex_file,
 bool CompilerDriver::CanAccessTypeWithoutChecks(uint32_t referrer_idx, const DexFile& dex_file,
                                                 uint32_t type_idx,
                                                 bool* type_known_final, bool* type_known_abstract,
-                                                bool* equals_referrers_class) {
+                                                bool* equals_referrers_class,
+                                                bool* type_known_subclass_test) {
   if (type_known_final != NULL) {
     *type_known_final = false;
   }
@@ -860,6 +1056,9 @@ bool CompilerDriver::CanAccessTypeWithoutChecks(uint32_t referrer_idx, const Dex
   if (equals_referrers_class != NULL) {
     *equals_referrers_class = false;
   }
+  if (type_known_subclass_test != NULL) {
+    *type_known_subclass_test = false;
+  }
   ScopedObjectAccess soa(Thread::Current());
   mirror::DexCache* dex_cache = Runtime::Current()->GetClassLinker()->FindDexCache(dex_file);
   // Get type from dex cache assuming it was populated by the verifier
@@ -888,6 +1087,9 @@ bool CompilerDriver::CanAccessTypeWithoutChecks(uint32_t referrer_idx, const Dex
     if (type_known_abstract != NULL) {
       *type_known_abstract = resolved_class->IsAbstract() && !resolved_class->IsArrayClass();
     }
+    if (type_known_subclass_test != NULL) {
+      *type_known_subclass_test = !resolved_class->IsInterface() && !resolved_class->IsArrayClass();
+    }
   } else {
     stats_->TypeNeedsAccessCheck();
   }
@@ -1323,6 +1525,16 @@ void CompilerDriver::AddClassPatch(const DexFile* dex_file,
                                                        literal_offset));
 }
 
+// A part of the methods of a class to compile. The methods are numbered in class data order,
+// direct methods first, including the duplicate encoded methods that CompileClass skips.
+struct CompileClassChunk {
+  uint32_t class_def_index;
+  uint32_t method_begin;
+  uint32_t method_end;
+  // Estimated cost of compiling the chunk, see EstimateMethodCompilationCost.
+  uint64_t cost;
+};
+
 class ParallelCompilationManager {
  public:
   typedef void Callback(const ParallelCompilationManager* manager, size_t index);
@@ -1337,7 +1549,8 @@ class ParallelCompilationManager {
       class_loader_(class_loader),
       compiler_(compiler),
       dex_file_(dex_file),
-      thread_pool_(thread_pool) {}
+      thread_pool_(thread_pool),
+      compile_chunks_(nullptr) {}
 
   ClassLinker* GetClassLinker() const {
     CHECK(class_linker_ != NULL);
@@ -1358,6 +1571,17 @@ class ParallelCompilationManager {
     return dex_file_;
   }
 
+  // The chunks handed out by index to CompilerDriver::CompileClass.
+  void SetCompileClassChunks(const std::vector<CompileClassChunk>* compile_chunks) {
+    compile_chunks_ = compile_chunks;
+  }
+
+  const CompileClassChunk& GetCompileClassChunk(size_t index) const {
+    DCHECK(compile_chunks_ != nullptr);
+    DCHECK_LT(index, compile_chunks_->size());
+    return (*compile_chunks_)[index];
+  }
+
   void ForAll(size_t begin, size_t end, Callback callback, size_t work_units) {
     Thread* self = Thread::Current();
     self->AssertNoPendingException();
@@ -1416,6 +1640,7 @@ class ParallelCompilationManager {
   CompilerDriver* const compiler_;
   const DexFile* const dex_file_;
   ThreadPool* const thread_pool_;
+  const std::vector<CompileClassChunk>* compile_chunks_;
 
   DISALLOW_COPY_AND_ASSIGN(ParallelCompilationManager);
 };
@@ -1594,6 +1819,66 @@ static void ResolveType(const ParallelCompilationManager* manager, size_t type_i
   }
 }
 
+// Resolves a field referenced by the dex file, which may be declared in another dex file, so that
+// the image holds it in the dex cache.
+static void ResolveFieldId(const ParallelCompilationManager* manager, size_t field_idx)
+    LOCKS_EXCLUDED(Locks::mutator_lock_) {
+  ScopedObjectAccess soa(Thread::Current());
+  ClassLinker* class_linker = manager->GetClassLinker();
+  const DexFile& dex_file = *manager->GetDexFile();
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::DexCache> dex_cache(hs.NewHandle(class_linker->FindDexCache(dex_file)));
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader*>(manager->GetClassLoader())));
+  // The JLS lookup doesn't need to know whether the field is static.
+  if (class_linker->ResolveFieldJLS(dex_file, field_idx, dex_cache, class_loader) == nullptr) {
+    CHECK(soa.Self()->IsExceptionPending());
+    soa.Self()->ClearException();
+  }
+}
+
+// As ResolveFieldId, for a method. Without the invoke instruction the kind of the method is
+// unknown, the declaring class tells interface methods apart and the others are looked up as
+// virtual then as direct methods.
+static void ResolveMethodId(const ParallelCompilationManager* manager, size_t method_idx)
+    LOCKS_EXCLUDED(Locks::mutator_lock_) {
+  ScopedObjectAccess soa(Thread::Current());
+  ClassLinker* class_linker = manager->GetClassLinker();
+  const DexFile& dex_file = *manager->GetDexFile();
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::DexCache> dex_cache(hs.NewHandle(class_linker->FindDexCache(dex_file)));
+  mirror::ArtMethod* resolved = dex_cache->GetResolvedMethod(method_idx);
+  if (resolved != nullptr && !resolved->IsRuntimeMethod()) {
+    return;
+  }
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader*>(manager->GetClassLoader())));
+  const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  mirror::Class* klass = class_linker->ResolveType(dex_file, method_id.class_idx_, dex_cache,
+                                                   class_loader);
+  if (klass == nullptr) {
+    CHECK(soa.Self()->IsExceptionPending());
+    soa.Self()->ClearException();
+    return;
+  }
+  static const InvokeType kInterfaceTypes[] = { kInterface };
+  static const InvokeType kClassTypes[] = { kVirtual, kDirect };
+  const InvokeType* types = klass->IsInterface() ? kInterfaceTypes : kClassTypes;
+  const size_t num_types = klass->IsInterface() ? arraysize(kInterfaceTypes)
+                                                : arraysize(kClassTypes);
+  for (size_t i = 0; i != num_types; ++i) {
+    mirror::ArtMethod* method = class_linker->ResolveMethod(dex_file, method_idx, dex_cache,
+                                                            class_loader,
+                                                            NullHandle<mirror::ArtMethod>(),
+                                                            types[i]);
+    if (method != nullptr) {
+      return;
+    }
+    CHECK(soa.Self()->IsExceptionPending());
+    soa.Self()->ClearException();
+  }
+}
+
 void CompilerDriver::ResolveDexFile(jobject class_loader, const DexFile& dex_file,
                                     ThreadPool* thread_pool, TimingLogger* timings) {
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
@@ -1611,10 +1896,28 @@ void CompilerDriver::ResolveDexFile(jobject class_loader, const DexFile& dex_fil
 
   timings->NewSplit("Resolve MethodsAndFields");
   context.ForAll(0, dex_file.NumClassDefs(), ResolveClassFieldsAndMethods, thread_count_);
+
+  if (IsImage()) {
+    // The class definitions give the fields and methods the dex file declares, the ones it only
+    // references, mostly in the other boot dex files, are resolved too so that processes find
+    // them in the image dex caches rather than resolving them again. Entries of classes that
+    // aren't image classes are pruned by the image writer.
+    timings->NewSplit("Resolve Referenced MethodsAndFields");
+    context.ForAll(0, dex_file.NumFieldIds(), ResolveFieldId, thread_count_);
+    context.ForAll(0, dex_file.NumMethodIds(), ResolveMethodId, thread_count_);
+  }
 }
 
 void CompilerDriver::Verify(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                             ThreadPool* thread_pool, TimingLogger* timings) {
+  if (verification_results_->GetVerifierDeps() != nullptr) {
+    timings->NewSplit("Validate verification cache");
+    ScopedObjectAccess soa(Thread::Current());
+    StackHandleScope<1> hs(soa.Self());
+    Handle<mirror::ClassLoader> loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader*>(class_loader)));
+    verification_results_->ValidateVerificationCache(loader, soa.Self());
+  }
   for (size_t i = 0; i != dex_files.size(); ++i) {
     const DexFile* dex_file = dex_files[i];
     CHECK(dex_file != NULL);
@@ -1744,6 +2047,10 @@ static void InitializeClass(const ParallelCompilationManager* manager, size_t cl
               mirror::Throwable* exception = soa.Self()->GetException(&throw_location);
               VLOG(compiler) << "Initialization of " << descriptor << " aborted because of "
                   << exception->Dump();
+              mirror::String* message = exception->GetDetailMessage();
+              manager->GetCompiler()->RecordClassInitializationFailure(
+                  descriptor, PrettyTypeOf(exception) +
+                      (message != nullptr ? ": " + message->ToModifiedUtf8() : ""));
               soa.Self()->ClearException();
               transaction.Abort();
               CHECK_EQ(old_status, klass->GetStatus()) << "Previous class status not restored";
@@ -1789,6 +2096,9 @@ void CompilerDriver::InitializeClasses(jobject class_loader,
     CHECK(dex_file != NULL);
     InitializeClasses(class_loader, *dex_file, thread_pool, timings);
   }
+  if (IsImage() && (dump_stats_ || VLOG_IS_ON(compiler))) {
+    DumpClassInitializationFailures();
+  }
 }
 
 void CompilerDriver::Compile(jobject class_loader, const std::vector<const DexFile*>& dex_files,
@@ -1800,8 +2110,10 @@ void CompilerDriver::Compile(jobject class_loader, const std::vector<const DexFi
   }
 }
 
-void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, size_t class_def_index) {
+void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, size_t chunk_index) {
   ATRACE_CALL();
+  const CompileClassChunk& chunk = manager->GetCompileClassChunk(chunk_index);
+  const size_t class_def_index = chunk.class_def_index;
   jobject jclass_loader = manager->GetClassLoader();
   const DexFile& dex_file = *manager->GetDexFile();
   const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
@@ -1839,10 +2151,13 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
     it.Next();
   }
   CompilerDriver* driver = manager->GetCompiler();
+  uint32_t method_number = 0;
   // Compile direct methods
   int64_t previous_direct_method_idx = -1;
   while (it.HasNextDirectMethod()) {
     uint32_t method_idx = it.GetMemberIndex();
+    const bool in_chunk = method_number >= chunk.method_begin && method_number < chunk.method_end;
+    ++method_number;
     if (method_idx == previous_direct_method_idx) {
       // smali can create dex files with two encoded_methods sharing the same method_idx
       // http://code.google.com/p/smali/issues/detail?id=119
@@ -1850,15 +2165,19 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
       continue;
     }
     previous_direct_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    if (in_chunk) {
+      driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
+                            it.GetMethodInvokeType(class_def), class_def_index,
+                            method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    }
     it.Next();
   }
   // Compile virtual methods
   int64_t previous_virtual_method_idx = -1;
   while (it.HasNextVirtualMethod()) {
     uint32_t method_idx = it.GetMemberIndex();
+    const bool in_chunk = method_number >= chunk.method_begin && method_number < chunk.method_end;
+    ++method_number;
     if (method_idx == previous_virtual_method_idx) {
       // smali can create dex files with two encoded_methods sharing the same method_idx
       // http://code.google.com/p/smali/issues/detail?id=119
@@ -1866,20 +2185,105 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
       continue;
     }
     previous_virtual_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    if (in_chunk) {
+      driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
+                            it.GetMethodInvokeType(class_def), class_def_index,
+                            method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    }
     it.Next();
   }
   DCHECK(!it.HasNext());
 }
 
+// Rough estimate of the cost of compiling a method: the size of its code plus a fixed overhead,
+// which also accounts for the methods without code such as the JNI stubs.
+static uint64_t EstimateMethodCompilationCost(const ClassDataItemIterator& it) {
+  static constexpr uint64_t kMethodCompilationOverhead = 16;
+  const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+  return kMethodCompilationOverhead +
+      (code_item != nullptr ? code_item->insns_size_in_code_units_ : 0U);
+}
+
+// Positions the iterator on the first method of the class.
+static void SkipFields(ClassDataItemIterator* it) {
+  while (it->HasNextStaticField() || it->HasNextInstanceField()) {
+    it->Next();
+  }
+}
+
+// Splits the classes of the dex file into chunks to compile. Each class is a single chunk unless
+// it is much more expensive than the average work per thread, in which case its methods are split
+// so that several threads can compile them. The chunks are then sorted by decreasing cost so that
+// the most expensive ones don't end up being compiled last while the other threads idle.
+static void ComputeCompileClassChunks(const DexFile& dex_file, size_t thread_count,
+                                      std::vector<CompileClassChunk>* chunks) {
+  // The number of chunks per thread the largest classes are split into, the more chunks the better
+  // the balance but the more often the class setup in CompileClass is repeated.
+  static constexpr size_t kMaxChunksPerThread = 4;
+  const size_t num_class_defs = dex_file.NumClassDefs();
+  std::vector<uint64_t> class_costs(num_class_defs, 0U);
+  uint64_t total_cost = 0;
+  for (size_t i = 0; i < num_class_defs; ++i) {
+    const byte* class_data = dex_file.GetClassData(dex_file.GetClassDef(i));
+    if (class_data == nullptr) {
+      continue;
+    }
+    ClassDataItemIterator it(dex_file, class_data);
+    SkipFields(&it);
+    for (; it.HasNext(); it.Next()) {
+      class_costs[i] += EstimateMethodCompilationCost(it);
+    }
+    total_cost += class_costs[i];
+  }
+  chunks->clear();
+  chunks->reserve(num_class_defs);
+  if (thread_count <= 1) {
+    // Nothing to balance, keep the class def order.
+    for (size_t i = 0; i < num_class_defs; ++i) {
+      CompileClassChunk chunk = { static_cast<uint32_t>(i), 0U, UINT32_MAX, class_costs[i] };
+      chunks->push_back(chunk);
+    }
+    return;
+  }
+  const uint64_t max_chunk_cost =
+      std::max<uint64_t>(total_cost / (thread_count * kMaxChunksPerThread), 1U);
+  for (size_t i = 0; i < num_class_defs; ++i) {
+    if (class_costs[i] <= max_chunk_cost) {
+      CompileClassChunk chunk = { static_cast<uint32_t>(i), 0U, UINT32_MAX, class_costs[i] };
+      chunks->push_back(chunk);
+      continue;
+    }
+    ClassDataItemIterator it(dex_file, dex_file.GetClassData(dex_file.GetClassDef(i)));
+    SkipFields(&it);
+    CompileClassChunk chunk = { static_cast<uint32_t>(i), 0U, 0U, 0U };
+    for (; it.HasNext(); it.Next()) {
+      chunk.cost += EstimateMethodCompilationCost(it);
+      ++chunk.method_end;
+      if (chunk.cost >= max_chunk_cost) {
+        chunks->push_back(chunk);
+        chunk.method_begin = chunk.method_end;
+        chunk.cost = 0U;
+      }
+    }
+    if (chunk.method_end != chunk.method_begin) {
+      chunks->push_back(chunk);
+    }
+  }
+  std::stable_sort(chunks->begin(), chunks->end(),
+                   [](const CompileClassChunk& lhs, const CompileClassChunk& rhs) {
+                     return lhs.cost > rhs.cost;
+                   });
+}
+
 void CompilerDriver::CompileDexFile(jobject class_loader, const DexFile& dex_file,
                                     ThreadPool* thread_pool, TimingLogger* timings) {
   timings->NewSplit("Compile Dex File");
+  std::vector<CompileClassChunk> chunks;
+  ComputeCompileClassChunks(dex_file, thread_count_, &chunks);
   ParallelCompilationManager context(Runtime::Current()->GetClassLinker(), class_loader, this,
                                      &dex_file, thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), CompilerDriver::CompileClass, thread_count_);
+  context.SetCompileClassChunks(&chunks);
+  context.ForAll(0, chunks.size(), CompilerDriver::CompileClass, thread_count_);
 }
 
 void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t access_flags,
@@ -1899,14 +2303,33 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
       compiled_method = compiler_->JniCompile(access_flags, method_idx, dex_file);
       CHECK(compiled_method != NULL);
     }
+    RecordCompilationDecision(dex_file, method_idx,
+                              compiled_method != nullptr ? "jni-stub" : "generic-jni");
   } else if ((access_flags & kAccAbstract) != 0) {
   } else {
     MethodReference method_ref(&dex_file, method_idx);
     bool compile = verification_results_->IsCandidateForCompilation(method_ref, access_flags);
-    if (compile) {
+    if (compile && profile_ok_ && compiler_options_->IsProfileGuided()) {
+      ProfileTier tier = GetProfileTier(PrettyMethod(method_idx, dex_file));
+      compile = (tier == kProfileHot);
+      if (tier == kProfileCold) {
+        dex_to_dex_compilation_level = kDontDexToDexCompile;
+      }
+    }
+    if (compile && previous_oat_file_.get() != nullptr) {
+      compiled_method = previous_oat_file_->GetCompiledMethod(this, dex_file, class_def_idx,
+                                                              method_idx);
+      if (compiled_method != nullptr) {
+        RecordCompilationDecision(dex_file, method_idx, "previous-oat");
+      }
+    }
+    if (compile && compiled_method == nullptr) {
       // NOTE: if compiler declines to compile this method, it will return NULL.
       compiled_method = compiler_->Compile(code_item, access_flags, invoke_type, class_def_idx,
                                            method_idx, class_loader, dex_file);
+      if (compiled_method != nullptr) {
+        RecordCompilationDecision(dex_file, method_idx, "compiled");
+      }
     }
     if (compiled_method == nullptr && dex_to_dex_compilation_level != kDontDexToDexCompile) {
       // TODO: add a command-line option to disable DEX-to-DEX compilation ?
@@ -1915,6 +2338,11 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
                               method_idx, class_loader, dex_file,
                               dex_to_dex_compilation_level);
     }
+    if (compiled_method == nullptr) {
+      RecordCompilationDecision(dex_file, method_idx,
+                                dex_to_dex_compilation_level != kDontDexToDexCompile
+                                    ? "quickened" : "interpreted");
+    }
   }
   uint64_t duration_ns = NanoTime() - start_ns;
   if (duration_ns > MsToNs(compiler_->GetMaximumCompilationTimeBeforeWarning())) {
@@ -2045,10 +2473,43 @@ void CompilerDriver::InstructionSetToLLVMTarget(InstructionSet instruction_set,
     }
   }
 
+// Compare against the start of the topK percentage bucket just in case the threshold
+// falls inside a bucket.
+static bool IsInTopKPercent(const ProfileData& data, double topKPercentThreshold) {
+  return data.GetTopKUsedPercentage() - data.GetUsedPercent() <= topKPercentThreshold;
+}
+
+CompilerDriver::ProfileTier CompilerDriver::GetProfileTier(const std::string& method_name) const {
+  DCHECK(profile_ok_);
+  ProfileMap::const_iterator i = profile_map_.find(method_name);
+  if (i == profile_map_.end()) {
+    return kProfileCold;
+  }
+  const ProfileData& data = i->second;
+  if (IsInTopKPercent(data, compiler_options_->GetProfileHotPercent())) {
+    return kProfileHot;
+  }
+  if (IsInTopKPercent(data, compiler_options_->GetProfileWarmPercent())) {
+    return kProfileWarm;
+  }
+  return kProfileCold;
+}
+
+bool CompilerDriver::IsHotMethod(const std::string& method_name) const {
+  if (hot_methods_.get() != nullptr) {
+    return hot_methods_->find(method_name) != hot_methods_->end();
+  }
+  return profile_ok_ && GetProfileTier(method_name) != kProfileCold;
+}
+
 bool CompilerDriver::SkipCompilation(const std::string& method_name) {
   if (!profile_ok_) {
     return false;
   }
+  // The profiled filters have their own thresholds, CompileMethod already picked the hot methods.
+  if (compiler_options_->IsProfileGuided()) {
+    return GetProfileTier(method_name) != kProfileHot;
+  }
   // Methods that comprise topKPercentThreshold % of the total samples will be compiled.
   double topKPercentThreshold = 90.0;
 #ifdef HAVE_ANDROID_OS
@@ -2070,9 +2531,7 @@ bool CompilerDriver::SkipCompilation(const std::string& method_name) {
   }
   const ProfileData& data = i->second;
 
-  // Compare against the start of the topK percentage bucket just in case the threshold
-  // falls inside a bucket.
-  bool compile = data.GetTopKUsedPercentage() - data.GetUsedPercent() <= topKPercentThreshold;
+  bool compile = IsInTopKPercent(data, topKPercentThreshold);
   if (compile) {
     LOG(INFO) << "compiling method " << method_name << " because its usage is part of top "
         << data.GetTopKUsedPercentage() << "% with a percent of " << data.GetUsedPercent() << "%";
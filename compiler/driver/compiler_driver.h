@@ -51,6 +51,7 @@ class DexFileToMethodInlinerMap;
 struct InlineIGetIPutData;
 class OatWriter;
 class ParallelCompilationManager;
+class PreviousOatFile;
 class ScopedObjectAccess;
 template<class T> class Handle;
 class TimingLogger;
@@ -77,15 +78,25 @@ enum DexToDexCompilationLevel {
 // Thread-local storage compiler worker threads
 class CompilerTls {
   public:
-    CompilerTls() : llvm_info_(NULL) {}
+    // The arenas of the thread are mapped, so that their memory can be given back
+    // to the system between compilation phases without unmapping them.
+    explicit CompilerTls(bool count_arena_allocations)
+        : llvm_info_(NULL), arena_pool_(false) {
+      arena_pool_.SetCountAllocations(count_arena_allocations);
+    }
     ~CompilerTls() {}
 
     void* GetLLVMInfo() { return llvm_info_; }
 
     void SetLLVMInfo(void* llvm_info) { llvm_info_ = llvm_info; }
 
+    // Arenas freed by the methods compiled by this thread are reused for the next
+    // ones without contending with the other compiler threads.
+    ArenaPool* GetArenaPool() { return &arena_pool_; }
+
   private:
     void* llvm_info_;
+    ArenaPool arena_pool_;
 };
 
 class CompilerDriver {
@@ -118,6 +129,13 @@ class CompilerDriver {
   void CompileOne(mirror::ArtMethod* method, TimingLogger* timings)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Compile a single method at runtime for the JIT. The class of the method is already verified
+  // and the verified method must have been added to the verification results.
+  void CompileJitMethod(const DexFile::CodeItem* code_item, uint32_t access_flags,
+                        InvokeType invoke_type, uint16_t class_def_idx, uint32_t method_idx,
+                        jobject class_loader, const DexFile& dex_file)
+      LOCKS_EXCLUDED(Locks::mutator_lock_, compiled_methods_lock_);
+
   VerificationResults* GetVerificationResults() const {
     return verification_results_;
   }
@@ -146,6 +164,16 @@ class CompilerDriver {
     return profile_ok_;
   }
 
+  // The targets sampled at the virtual call sites, empty without a call site profile.
+  const CallSiteProfile& GetCallSiteProfile() const {
+    return call_site_profile_;
+  }
+
+  // Is the method overridden by one of the classes loaded at compile time? Only an answer for
+  // the classes seen before compilation, other class loaders may still override the method at
+  // run time. Always true when the classes weren't analyzed, as in the JIT.
+  bool MayBeOverridden(const MethodReference& ref) const;
+
   // Are we compiling and creating an image file?
   bool IsImage() const {
     return image_;
@@ -196,11 +224,14 @@ class CompilerDriver {
   bool CanAssumeStringIsPresentInDexCache(const DexFile& dex_file, uint32_t string_idx)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
-  // Are runtime access checks necessary in the compiled code?
+  // Are runtime access checks necessary in the compiled code? type_known_subclass_test is set for
+  // classes which are neither interfaces nor arrays, whose instances are exactly the objects with
+  // the class in their superclass chain.
   bool CanAccessTypeWithoutChecks(uint32_t referrer_idx, const DexFile& dex_file,
                                   uint32_t type_idx, bool* type_known_final = NULL,
                                   bool* type_known_abstract = NULL,
-                                  bool* equals_referrers_class = NULL)
+                                  bool* equals_referrers_class = NULL,
+                                  bool* type_known_subclass_test = NULL)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   // Are runtime access and instantiable checks necessary in the code?
@@ -359,10 +390,76 @@ class CompilerDriver {
     support_boot_image_fixup_ = support_boot_image_fixup;
   }
 
+  // Reuses the compiled methods of the unchanged classes of `previous_oat_file`, takes ownership.
+  void SetPreviousOatFile(PreviousOatFile* previous_oat_file);
+
+  // Names of the methods whose code is laid out first in the oat file, as printed by
+  // PrettyMethod, takes ownership.
+  void SetHotMethods(std::set<std::string>* hot_methods) {
+    hot_methods_.reset(hot_methods);
+  }
+
+  // Whether the methods are split in hot and cold code, by the hot methods or by the profile.
+  bool HasHotMethods() const {
+    return hot_methods_.get() != nullptr || profile_ok_;
+  }
+
+  // Whether the code of the method goes to the hot part of the oat file: it is one of the hot
+  // methods or, without them, it has enough samples in the profile to not be cold.
+  bool IsHotMethod(const std::string& method_name) const;
+
+  // Arena pool of the current compiler thread.
   ArenaPool* GetArenaPool() {
-    return &arena_pool_;
+    return GetTls()->GetArenaPool();
+  }
+
+  // Gives the memory of the free arenas of the compiler threads back to the system.
+  void ReclaimArenaMemory() LOCKS_EXCLUDED(tls_lock_);
+
+  // Counts the arena allocations of the compiler threads by kind, which dump_stats_ also does.
+  // Must be set before the compilation.
+  void SetCountArenaAllocations(bool count_arena_allocations) {
+    count_arena_allocations_ = count_arena_allocations;
+  }
+
+  // Arena usage of the compiler threads, by kind only if the allocations were counted.
+  ArenaPoolStats GetArenaStats() const LOCKS_EXCLUDED(tls_lock_);
+
+  // Dumps the arena usage of the compiler threads.
+  void DumpArenaStats(std::ostream& os) const LOCKS_EXCLUDED(tls_lock_);
+
+  // Keeps why each method got the code it has, for DumpCompilationDecisions. Must be set before
+  // the compilation.
+  void SetRecordCompilationDecisions(bool record_compilation_decisions) {
+    record_compilation_decisions_ = record_compilation_decisions;
   }
 
+  // Records how the method was compiled, `decision` must outlive the driver. The first decision
+  // recorded for a method is kept, so backends that choose between several code generators
+  // record theirs before CompileMethod records the generic one.
+  void RecordCompilationDecision(const DexFile& dex_file, uint32_t method_idx,
+                                 const char* decision)
+      LOCKS_EXCLUDED(compilation_decisions_lock_);
+
+  // Dumps one line per method with its PrettyMethod name and the decision recorded for it.
+  void DumpCompilationDecisions(std::ostream& os) const
+      LOCKS_EXCLUDED(compilation_decisions_lock_);
+
+  // Frees the compiled methods with their code and tables once the oat file is written, which
+  // leaves more memory to the image writer. GetCompiledMethod returns nullptr afterwards.
+  void ReleaseCompiledMethods() LOCKS_EXCLUDED(compiled_methods_lock_);
+
+  // Dumps how many code arrays and tables were deduplicated, by kind.
+  void DumpDedupeStats() const;
+
+  // Records that the transactional initialization of an image class was aborted, with the type
+  // and message of the exception that aborted it.
+  void RecordClassInitializationFailure(const char* descriptor, const std::string& cause)
+      LOCKS_EXCLUDED(class_init_failures_lock_);
+
+  // Dumps the causes of the aborted image class initializations, the most frequent first.
+  void DumpClassInitializationFailures() const LOCKS_EXCLUDED(class_init_failures_lock_);
+
   bool WriteElf(const std::string& android_root,
                 bool is_host,
                 const std::vector<const DexFile*>& dex_files,
@@ -597,10 +694,23 @@ class CompilerDriver {
 
   ProfileMap profile_map_;
   bool profile_ok_;
+  CallSiteProfile call_site_profile_;
+
+  // The methods overridden in the loaded classes, read-only once computed before compilation.
+  std::set<MethodReference, MethodReferenceComparator> overridden_methods_;
+  bool overridden_methods_computed_;
 
   // Should the compiler run on this method given profile information?
   bool SkipCompilation(const std::string& method_name);
 
+  // How the profiled filter compiles a method, from its share of the profile samples.
+  enum ProfileTier {
+    kProfileCold,  // Not in the warm percentage of the samples, stays interpreted.
+    kProfileWarm,  // Only quickened by the DEX-to-DEX compiler.
+    kProfileHot,   // Compiled with the full optimizations.
+  };
+  ProfileTier GetProfileTier(const std::string& method_name) const;
+
  private:
   // These flags are internal to CompilerDriver for collecting INVOKE resolution statistics.
   // The only external contract is that unresolved method has flags 0 and resolved non-0.
@@ -663,6 +773,8 @@ class CompilerDriver {
       LOCKS_EXCLUDED(Locks::mutator_lock_, compiled_classes_lock_);
 
   void UpdateImageClasses(TimingLogger* timings) LOCKS_EXCLUDED(Locks::mutator_lock_);
+  // Records the methods that a subclass overrides, for the class hierarchy analysis.
+  void ComputeOverriddenMethods(TimingLogger* timings) LOCKS_EXCLUDED(Locks::mutator_lock_);
   static void FindClinitImageClassesCallback(mirror::Object* object, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -677,7 +789,9 @@ class CompilerDriver {
                      DexToDexCompilationLevel dex_to_dex_compilation_level)
       LOCKS_EXCLUDED(compiled_methods_lock_);
 
-  static void CompileClass(const ParallelCompilationManager* context, size_t class_def_index)
+  // Compiles the methods of one of the chunks computed by CompileDexFile, a whole class or a part
+  // of a large class.
+  static void CompileClass(const ParallelCompilationManager* context, size_t chunk_index)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   std::vector<const CallPatchInformation*> code_to_patch_;
@@ -702,11 +816,23 @@ class CompilerDriver {
   mutable Mutex compiled_classes_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   ClassTable compiled_classes_ GUARDED_BY(compiled_classes_lock_);
 
+  // The image classes whose initialization was aborted, by cause. Classes left uninitialized are
+  // initialized again at every start of the runtime, the causes tell which ones to fix first.
+  mutable Mutex class_init_failures_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  SafeMap<std::string, std::vector<std::string>> class_init_failures_
+      GUARDED_BY(class_init_failures_lock_);
+
   typedef SafeMap<const MethodReference, CompiledMethod*, MethodReferenceComparator> MethodTable;
   // All method references that this compiler has compiled.
   mutable Mutex compiled_methods_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   MethodTable compiled_methods_ GUARDED_BY(compiled_methods_lock_);
 
+  // How each method was compiled, only recorded with SetRecordCompilationDecisions.
+  bool record_compilation_decisions_;
+  mutable Mutex compilation_decisions_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  SafeMap<const MethodReference, const char*, MethodReferenceComparator> compilation_decisions_
+      GUARDED_BY(compilation_decisions_lock_);
+
   const bool image_;
 
   // If image_ is true, specifies the classes that will be included in
@@ -722,6 +848,7 @@ class CompilerDriver {
 
   bool dump_stats_;
   const bool dump_passes_;
+  bool count_arena_allocations_;
 
   CumulativeLogger* const timings_logger_;
 
@@ -742,8 +869,9 @@ class CompilerDriver {
 
   pthread_key_t tls_key_;
 
-  // Arena pool used by the compiler.
-  ArenaPool arena_pool_;
+  // The thread-local storage of all the threads which compiled with this driver.
+  mutable Mutex tls_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::vector<CompilerTls*> tls_ GUARDED_BY(tls_lock_);
 
   typedef void (*CompilerEnableAutoElfLoadingFn)(CompilerDriver& driver);
   CompilerEnableAutoElfLoadingFn compiler_enable_auto_elf_loading_;
@@ -754,6 +882,12 @@ class CompilerDriver {
 
   bool support_boot_image_fixup_;
 
+  // The methods to lay out first in the oat file, if any.
+  std::unique_ptr<std::set<std::string>> hot_methods_;
+
+  // The oat file whose compiled methods are reused, if any.
+  std::unique_ptr<PreviousOatFile> previous_oat_file_;
+
   // Call Frame Information, which might be generated to help stack tracebacks.
   std::unique_ptr<std::vector<uint8_t>> cfi_info_;
 
@@ -763,7 +897,9 @@ class CompilerDriver {
     size_t operator()(const std::vector<uint8_t>& array) const {
       // For small arrays compute a hash using every byte.
       static const size_t kSmallArrayThreshold = 16;
-      size_t hash = 0x811c9dc5;
+      // Code and tables often differ only by their size, the hash of large arrays only
+      // looks at some of their bytes.
+      size_t hash = 0x811c9dc5 ^ array.size();
       if (array.size() <= kSmallArrayThreshold) {
         for (uint8_t b : array) {
           hash = (hash * 16777619) ^ b;
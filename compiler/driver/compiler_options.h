@@ -24,7 +24,8 @@ class CompilerOptions {
   enum CompilerFilter {
     kVerifyNone,          // Skip verification and compile nothing except JNI stubs.
     kInterpretOnly,       // Compile nothing except JNI stubs.
-    kProfiled,            // Compile based on profile.
+    kProfiled,            // Compile the hot methods of the profile, quicken the warm ones.
+    kSpeedProfile,        // Like kProfiled, with the optimizing compiler for the hot loops.
     kSpace,               // Maximize space savings.
     kBalanced,            // Try to get the best performance return on compilation investment.
     kSpeed,               // Maximize runtime performance.
@@ -42,6 +43,10 @@ class CompilerOptions {
   static const size_t kDefaultSmallMethodThreshold = 60;
   static const size_t kDefaultTinyMethodThreshold = 20;
   static const size_t kDefaultNumDexMethodsThreshold = 900;
+  // With the profiled filter, the methods that make up this percentage of the profile samples are
+  // compiled, the ones up to the warm percentage are quickened and the others are interpreted.
+  static constexpr double kDefaultProfileHotPercent = 90.0;
+  static constexpr double kDefaultProfileWarmPercent = 99.0;
 
   CompilerOptions() :
     compiler_filter_(kDefaultCompilerFilter),
@@ -50,7 +55,11 @@ class CompilerOptions {
     small_method_threshold_(kDefaultSmallMethodThreshold),
     tiny_method_threshold_(kDefaultTinyMethodThreshold),
     num_dex_methods_threshold_(kDefaultNumDexMethodsThreshold),
-    generate_gdb_information_(false)
+    profile_hot_percent_(kDefaultProfileHotPercent),
+    profile_warm_percent_(kDefaultProfileWarmPercent),
+    generate_gdb_information_(false),
+    inline_tlab_allocation_(false),
+    arena_budget_(0u)
 #ifdef ART_SEA_IR_MODE
     , sea_ir_mode_(false)
 #endif
@@ -62,6 +71,8 @@ class CompilerOptions {
                   size_t small_method_threshold,
                   size_t tiny_method_threshold,
                   size_t num_dex_methods_threshold,
+                  double profile_hot_percent,
+                  double profile_warm_percent,
                   bool generate_gdb_information
 #ifdef ART_SEA_IR_MODE
                   , bool sea_ir_mode
@@ -73,7 +84,11 @@ class CompilerOptions {
     small_method_threshold_(small_method_threshold),
     tiny_method_threshold_(tiny_method_threshold),
     num_dex_methods_threshold_(num_dex_methods_threshold),
-    generate_gdb_information_(generate_gdb_information)
+    profile_hot_percent_(profile_hot_percent),
+    profile_warm_percent_(profile_warm_percent),
+    generate_gdb_information_(generate_gdb_information),
+    inline_tlab_allocation_(false),
+    arena_budget_(0u)
 #ifdef ART_SEA_IR_MODE
     , sea_ir_mode_(sea_ir_mode)
 #endif
@@ -92,6 +107,12 @@ class CompilerOptions {
             (compiler_filter_ != CompilerOptions::kInterpretOnly));
   }
 
+  // Whether the profile picks the methods to compile, quicken or interpret.
+  bool IsProfileGuided() const {
+    return ((compiler_filter_ == CompilerOptions::kProfiled) ||
+            (compiler_filter_ == CompilerOptions::kSpeedProfile));
+  }
+
   bool IsVerificationEnabled() const {
     return (compiler_filter_ != CompilerOptions::kVerifyNone);
   }
@@ -132,6 +153,14 @@ class CompilerOptions {
     return num_dex_methods_threshold_;
   }
 
+  double GetProfileHotPercent() const {
+    return profile_hot_percent_;
+  }
+
+  double GetProfileWarmPercent() const {
+    return profile_warm_percent_;
+  }
+
 #ifdef ART_SEA_IR_MODE
   bool GetSeaIrMode();
 #endif
@@ -140,6 +169,26 @@ class CompilerOptions {
     return generate_gdb_information_;
   }
 
+  // Whether new-instance bumps the thread-local allocation buffer inline, which only pays off when
+  // the runtime allocates from TLABs.
+  bool GetInlineTlabAllocation() const {
+    return inline_tlab_allocation_;
+  }
+
+  void SetInlineTlabAllocation(bool inline_tlab_allocation) {
+    inline_tlab_allocation_ = inline_tlab_allocation;
+  }
+
+  // Bytes of arenas a compilation thread may use for one method before the optional
+  // optimizations are turned off for the rest of it, 0 for no budget.
+  size_t GetArenaBudget() const {
+    return arena_budget_;
+  }
+
+  void SetArenaBudget(size_t arena_budget) {
+    arena_budget_ = arena_budget;
+  }
+
  private:
   CompilerFilter compiler_filter_;
   size_t huge_method_threshold_;
@@ -147,7 +196,11 @@ class CompilerOptions {
   size_t small_method_threshold_;
   size_t tiny_method_threshold_;
   size_t num_dex_methods_threshold_;
+  double profile_hot_percent_;
+  double profile_warm_percent_;
   bool generate_gdb_information_;
+  bool inline_tlab_allocation_;
+  size_t arena_budget_;
 
 #ifdef ART_SEA_IR_MODE
   bool sea_ir_mode_;
@@ -0,0 +1,522 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "previous_oat_file.h"
+
+#include <algorithm>
+#include <set>
+
+#include "base/stl_util.h"
+#include "base/stringprintf.h"
+#include "compiled_method.h"
+#include "dex_instruction-inl.h"
+#include "driver/compiler_driver.h"
+#include "gc_map.h"
+#include "leb128.h"
+#include "mirror/art_method.h"
+#include "oat_file-inl.h"
+#include "stack_map.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+// Records the class of a type descriptor as a dependency, the element class for arrays. The
+// primitive types have no class in the dex files.
+static void AddDependency(const char* descriptor, std::vector<std::string>* dependencies) {
+  while (*descriptor == '[') {
+    ++descriptor;
+  }
+  if (*descriptor == 'L') {
+    dependencies->push_back(descriptor);
+  }
+}
+
+static bool IsSameString(const DexFile& new_dex_file, const DexFile& old_dex_file, uint32_t idx) {
+  return idx < old_dex_file.NumStringIds() &&
+      strcmp(new_dex_file.StringDataByIdx(idx), old_dex_file.StringDataByIdx(idx)) == 0;
+}
+
+static bool IsSameType(const DexFile& new_dex_file, const DexFile& old_dex_file, uint32_t idx,
+                       std::vector<std::string>* dependencies) {
+  if (idx >= old_dex_file.NumTypeIds()) {
+    return false;
+  }
+  const char* descriptor = new_dex_file.StringByTypeIdx(idx);
+  if (strcmp(descriptor, old_dex_file.StringByTypeIdx(idx)) != 0) {
+    return false;
+  }
+  AddDependency(descriptor, dependencies);
+  return true;
+}
+
+static bool IsSameField(const DexFile& new_dex_file, const DexFile& old_dex_file, uint32_t idx,
+                        std::vector<std::string>* dependencies) {
+  if (idx >= old_dex_file.NumFieldIds()) {
+    return false;
+  }
+  const DexFile::FieldId& new_field_id = new_dex_file.GetFieldId(idx);
+  const DexFile::FieldId& old_field_id = old_dex_file.GetFieldId(idx);
+  const char* descriptor = new_dex_file.GetFieldDeclaringClassDescriptor(new_field_id);
+  if (strcmp(descriptor, old_dex_file.GetFieldDeclaringClassDescriptor(old_field_id)) != 0 ||
+      strcmp(new_dex_file.GetFieldName(new_field_id),
+             old_dex_file.GetFieldName(old_field_id)) != 0 ||
+      strcmp(new_dex_file.GetFieldTypeDescriptor(new_field_id),
+             old_dex_file.GetFieldTypeDescriptor(old_field_id)) != 0) {
+    return false;
+  }
+  AddDependency(descriptor, dependencies);
+  return true;
+}
+
+static bool IsSameMethod(const DexFile& new_dex_file, const DexFile& old_dex_file, uint32_t idx,
+                         std::vector<std::string>* dependencies) {
+  if (idx >= old_dex_file.NumMethodIds()) {
+    return false;
+  }
+  const DexFile::MethodId& new_method_id = new_dex_file.GetMethodId(idx);
+  const DexFile::MethodId& old_method_id = old_dex_file.GetMethodId(idx);
+  const char* descriptor = new_dex_file.GetMethodDeclaringClassDescriptor(new_method_id);
+  if (strcmp(descriptor, old_dex_file.GetMethodDeclaringClassDescriptor(old_method_id)) != 0 ||
+      strcmp(new_dex_file.GetMethodName(new_method_id),
+             old_dex_file.GetMethodName(old_method_id)) != 0 ||
+      !(new_dex_file.GetMethodSignature(new_method_id) ==
+        old_dex_file.GetMethodSignature(old_method_id))) {
+    return false;
+  }
+  AddDependency(descriptor, dependencies);
+  return true;
+}
+
+// Returns the size of an encoded mapping table, see MappingTable.
+static size_t MappingTableSize(const uint8_t* table) {
+  const uint8_t* data = table;
+  uint32_t total_size = DecodeUnsignedLeb128(&data);
+  DecodeUnsignedLeb128(&data);  // The number of pc to dex entries.
+  for (uint32_t i = 0; i < total_size; ++i) {
+    DecodeUnsignedLeb128(&data);  // The native pc offset.
+    DecodeSignedLeb128(&data);    // The dex pc.
+  }
+  return data - table;
+}
+
+// Returns the size of an encoded vmap table, see VmapTable.
+static size_t VmapTableSize(const uint8_t* table) {
+  const uint8_t* data = table;
+  uint32_t size = DecodeUnsignedLeb128(&data);
+  for (uint32_t i = 0; i < size; ++i) {
+    DecodeUnsignedLeb128(&data);
+  }
+  return data - table;
+}
+
+static std::vector<uint8_t> CopyTable(const uint8_t* table, size_t size) {
+  return (table == nullptr) ? std::vector<uint8_t>() : std::vector<uint8_t>(table, table + size);
+}
+
+PreviousOatFile* PreviousOatFile::Open(const std::string& filename,
+                                       InstructionSet instruction_set,
+                                       const InstructionSetFeatures& instruction_set_features,
+                                       uint32_t image_file_location_oat_checksum,
+                                       uintptr_t image_file_location_oat_data_begin,
+                                       const std::vector<const DexFile*>& dex_files,
+                                       std::string* error_msg) {
+  std::unique_ptr<OatFile> oat_file(OatFile::Open(filename, filename, nullptr, false, error_msg));
+  if (oat_file.get() == nullptr) {
+    return nullptr;
+  }
+  const OatHeader& header = oat_file->GetOatHeader();
+  if (header.GetInstructionSet() != instruction_set ||
+      !(header.GetInstructionSetFeatures() == instruction_set_features)) {
+    *error_msg = StringPrintf("Previous oat file '%s' was compiled for another instruction set",
+                              filename.c_str());
+    return nullptr;
+  }
+  if (header.GetImageFileLocationOatChecksum() != image_file_location_oat_checksum ||
+      header.GetImageFileLocationOatDataBegin() != image_file_location_oat_data_begin) {
+    *error_msg = StringPrintf("Previous oat file '%s' was compiled against another boot image",
+                              filename.c_str());
+    return nullptr;
+  }
+  std::vector<const OatFile::OatDexFile*> old_oat_dex_files;
+  std::vector<const DexFile*> old_dex_files;
+  for (const DexFile* dex_file : dex_files) {
+    const OatFile::OatDexFile* oat_dex_file =
+        oat_file->GetOatDexFile(dex_file->GetLocation().c_str(), nullptr, false);
+    if (oat_dex_file == nullptr) {
+      // New dex file, its classes are all changed.
+      continue;
+    }
+    const DexFile* old_dex_file = oat_dex_file->OpenDexFile(error_msg);
+    if (old_dex_file == nullptr) {
+      STLDeleteElements(&old_dex_files);
+      return nullptr;
+    }
+    old_oat_dex_files.push_back(oat_dex_file);
+    old_dex_files.push_back(old_dex_file);
+  }
+  return new PreviousOatFile(oat_file.release(), dex_files, old_oat_dex_files, old_dex_files);
+}
+
+PreviousOatFile::PreviousOatFile(const OatFile* oat_file,
+                                 const std::vector<const DexFile*>& dex_files,
+                                 const std::vector<const OatFile::OatDexFile*>& old_oat_dex_files,
+                                 const std::vector<const DexFile*>& old_dex_files)
+    : oat_file_(oat_file),
+      dex_files_(dex_files),
+      old_oat_dex_files_(old_oat_dex_files),
+      old_dex_files_(old_dex_files),
+      lock_("previous oat file lock"),
+      num_reused_methods_(0) {
+}
+
+PreviousOatFile::~PreviousOatFile() {
+  STLDeleteElements(&old_dex_files_);
+}
+
+const std::string& PreviousOatFile::GetLocation() const {
+  return oat_file_->GetLocation();
+}
+
+size_t PreviousOatFile::NumReusedMethods() {
+  MutexLock mu(Thread::Current(), lock_);
+  return num_reused_methods_;
+}
+
+bool PreviousOatFile::FindClassDef(const std::vector<const DexFile*>& dex_files,
+                                   const char* descriptor, ClassDefLocation* location) {
+  // The first definition on the class path is the one that gets loaded.
+  for (const DexFile* dex_file : dex_files) {
+    const DexFile::ClassDef* class_def = dex_file->FindClassDef(descriptor);
+    if (class_def != nullptr) {
+      location->dex_file = dex_file;
+      location->class_def = class_def;
+      return true;
+    }
+  }
+  return false;
+}
+
+CompiledMethod* PreviousOatFile::GetCompiledMethod(CompilerDriver* driver,
+                                                   const DexFile& dex_file,
+                                                   uint16_t class_def_idx, uint32_t method_idx) {
+  const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_idx);
+  const char* descriptor = dex_file.GetClassDescriptor(class_def);
+  ClassDefLocation new_class;
+  if (!FindClassDef(dex_files_, descriptor, &new_class) || new_class.class_def != &class_def) {
+    // A duplicate definition, which is never loaded.
+    return nullptr;
+  }
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    if (!IsUnchanged(descriptor)) {
+      return nullptr;
+    }
+  }
+  ClassDefLocation old_class;
+  CHECK(FindClassDef(old_dex_files_, descriptor, &old_class)) << descriptor;
+  // The classes have the same methods in the same order, which is the order of the oat methods.
+  uint32_t oat_method_index = 0;
+  ClassDataItemIterator it(dex_file, dex_file.GetClassData(class_def));
+  while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+    it.Next();
+  }
+  while (it.HasNext() && it.GetMemberIndex() != method_idx) {
+    ++oat_method_index;
+    it.Next();
+  }
+  CHECK(it.HasNext()) << PrettyMethod(method_idx, dex_file);
+  size_t old_dex_file_index = std::find(old_dex_files_.begin(), old_dex_files_.end(),
+                                        old_class.dex_file) - old_dex_files_.begin();
+  const OatFile::OatDexFile* oat_dex_file = old_oat_dex_files_[old_dex_file_index];
+  const OatFile::OatClass oat_class =
+      oat_dex_file->GetOatClass(old_class.dex_file->GetIndexForClassDef(*old_class.class_def));
+  const OatFile::OatMethod oat_method = oat_class.GetOatMethod(oat_method_index);
+  const void* entry_point = oat_method.GetQuickCode();
+  if (entry_point == nullptr) {
+    // Not compiled, or compiled by the portable backend.
+    return nullptr;
+  }
+  const uint8_t* code =
+      reinterpret_cast<const uint8_t*>(mirror::ArtMethod::EntryPointToCodePointer(entry_point));
+  std::vector<uint8_t> quick_code(code, code + oat_method.GetQuickCodeSize());
+  if (oat_method.HasStackMaps()) {
+    // The optimizing backend keeps its stack maps in place of the vmap table, and uses arm
+    // rather than thumb2.
+    const uint8_t* stack_maps = oat_method.GetVmapTable();
+    std::vector<uint8_t> stack_maps_copy =
+        CopyTable(stack_maps, CodeInfo(stack_maps).GetSizeInBytes());
+    InstructionSet instruction_set =
+        (driver->GetInstructionSet() == kThumb2) ? kArm : driver->GetInstructionSet();
+    CompiledMethod* compiled_method =
+        new CompiledMethod(driver, instruction_set, quick_code, oat_method.GetFrameSizeInBytes(),
+                           oat_method.GetCoreSpillMask(), oat_method.GetFpSpillMask(),
+                           stack_maps_copy);
+    MutexLock mu(Thread::Current(), lock_);
+    ++num_reused_methods_;
+    return compiled_method;
+  }
+  const uint8_t* mapping_table = oat_method.GetMappingTable();
+  const uint8_t* vmap_table = oat_method.GetVmapTable();
+  const uint8_t* gc_map = oat_method.GetNativeGcMap();
+  std::vector<uint8_t> mapping_table_copy =
+      CopyTable(mapping_table, mapping_table == nullptr ? 0u : MappingTableSize(mapping_table));
+  std::vector<uint8_t> vmap_table_copy =
+      CopyTable(vmap_table, vmap_table == nullptr ? 0u : VmapTableSize(vmap_table));
+  std::vector<uint8_t> gc_map_copy =
+      CopyTable(gc_map, gc_map == nullptr ? 0u : NativePcOffsetToReferenceMap(gc_map).SizeInBytes());
+  // The Quick backend generates thumb2 for arm.
+  InstructionSet instruction_set =
+      (driver->GetInstructionSet() == kArm) ? kThumb2 : driver->GetInstructionSet();
+  CompiledMethod* compiled_method =
+      new CompiledMethod(driver, instruction_set, quick_code, oat_method.GetFrameSizeInBytes(),
+                         oat_method.GetCoreSpillMask(), oat_method.GetFpSpillMask(),
+                         mapping_table_copy, vmap_table_copy, gc_map_copy, nullptr);
+  MutexLock mu(Thread::Current(), lock_);
+  ++num_reused_methods_;
+  return compiled_method;
+}
+
+bool PreviousOatFile::IsUnchanged(const std::string& descriptor) {
+  // Walk the dependencies depth first, stopping at the first changed class or at the classes
+  // already known to be unchanged with their dependencies.
+  std::vector<ClassInfo*> visited;
+  std::vector<std::string> worklist(1, descriptor);
+  std::set<std::string> seen(worklist.begin(), worklist.end());
+  bool unchanged = true;
+  while (!worklist.empty()) {
+    std::string current = worklist.back();
+    worklist.pop_back();
+    ClassInfo* info = GetSameClassInfo(current);
+    if (info->state == kClassChanged) {
+      unchanged = false;
+      break;
+    }
+    if (info->state == kClassUnchanged) {
+      continue;
+    }
+    visited.push_back(info);
+    for (const std::string& dependency : info->dependencies) {
+      if (seen.insert(dependency).second) {
+        worklist.push_back(dependency);
+      }
+    }
+  }
+  if (unchanged) {
+    // All the classes reachable from the visited ones are the same.
+    for (ClassInfo* info : visited) {
+      info->state = kClassUnchanged;
+      info->dependencies.clear();
+    }
+  } else {
+    // The other visited classes may still be unchanged, only this one is known to have changed.
+    ClassInfo* info = &classes_[descriptor];
+    info->state = kClassChanged;
+    info->dependencies.clear();
+  }
+  return unchanged;
+}
+
+PreviousOatFile::ClassInfo* PreviousOatFile::GetSameClassInfo(const std::string& descriptor) {
+  // The map doesn't move its elements, the info stays valid while others are added.
+  ClassInfo* info = &classes_[descriptor];
+  if (info->state != kClassUnknown) {
+    return info;
+  }
+  ClassDefLocation new_class;
+  ClassDefLocation old_class;
+  bool in_new_dex_files = FindClassDef(dex_files_, descriptor.c_str(), &new_class);
+  bool in_old_dex_files = FindClassDef(old_dex_files_, descriptor.c_str(), &old_class);
+  if (!in_new_dex_files && !in_old_dex_files) {
+    // A class of the boot class path, or a class that doesn't exist in either version.
+    info->state = kClassUnchanged;
+  } else if (in_new_dex_files != in_old_dex_files) {
+    info->state = kClassChanged;
+  } else if (IsSameClass(new_class, old_class, &info->dependencies)) {
+    info->state = kClassSame;
+  } else {
+    info->state = kClassChanged;
+    info->dependencies.clear();
+  }
+  return info;
+}
+
+bool PreviousOatFile::IsSameClass(const ClassDefLocation& new_class,
+                                  const ClassDefLocation& old_class,
+                                  std::vector<std::string>* dependencies) {
+  const DexFile& new_dex_file = *new_class.dex_file;
+  const DexFile& old_dex_file = *old_class.dex_file;
+  const DexFile::ClassDef& new_class_def = *new_class.class_def;
+  const DexFile::ClassDef& old_class_def = *old_class.class_def;
+  if (new_class_def.access_flags_ != old_class_def.access_flags_) {
+    return false;
+  }
+  // The superclass and the interfaces determine the vtable and the imtable used by the code.
+  bool has_superclass = new_class_def.superclass_idx_ != DexFile::kDexNoIndex16;
+  if (has_superclass != (old_class_def.superclass_idx_ != DexFile::kDexNoIndex16)) {
+    return false;
+  }
+  if (has_superclass) {
+    const char* superclass = new_dex_file.StringByTypeIdx(new_class_def.superclass_idx_);
+    if (strcmp(superclass, old_dex_file.StringByTypeIdx(old_class_def.superclass_idx_)) != 0) {
+      return false;
+    }
+    AddDependency(superclass, dependencies);
+  }
+  const DexFile::TypeList* new_interfaces = new_dex_file.GetInterfacesList(new_class_def);
+  const DexFile::TypeList* old_interfaces = old_dex_file.GetInterfacesList(old_class_def);
+  uint32_t num_interfaces = (new_interfaces == nullptr) ? 0u : new_interfaces->Size();
+  if (num_interfaces != ((old_interfaces == nullptr) ? 0u : old_interfaces->Size())) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_interfaces; ++i) {
+    const char* interface =
+        new_dex_file.StringByTypeIdx(new_interfaces->GetTypeItem(i).type_idx_);
+    if (strcmp(interface,
+               old_dex_file.StringByTypeIdx(old_interfaces->GetTypeItem(i).type_idx_)) != 0) {
+      return false;
+    }
+    AddDependency(interface, dependencies);
+  }
+  const byte* new_class_data = new_dex_file.GetClassData(new_class_def);
+  const byte* old_class_data = old_dex_file.GetClassData(old_class_def);
+  if (new_class_data == nullptr || old_class_data == nullptr) {
+    return new_class_data == old_class_data;
+  }
+  // The fields determine the layout of the objects and of the statics.
+  ClassDataItemIterator new_it(new_dex_file, new_class_data);
+  ClassDataItemIterator old_it(old_dex_file, old_class_data);
+  if (new_it.NumStaticFields() != old_it.NumStaticFields() ||
+      new_it.NumInstanceFields() != old_it.NumInstanceFields() ||
+      new_it.NumDirectMethods() != old_it.NumDirectMethods() ||
+      new_it.NumVirtualMethods() != old_it.NumVirtualMethods()) {
+    return false;
+  }
+  for (; new_it.HasNext(); new_it.Next(), old_it.Next()) {
+    if (new_it.GetMemberAccessFlags() != old_it.GetMemberAccessFlags()) {
+      return false;
+    }
+    if (new_it.HasNextStaticField() || new_it.HasNextInstanceField()) {
+      const DexFile::FieldId& new_field_id = new_dex_file.GetFieldId(new_it.GetMemberIndex());
+      const DexFile::FieldId& old_field_id = old_dex_file.GetFieldId(old_it.GetMemberIndex());
+      if (strcmp(new_dex_file.GetFieldName(new_field_id),
+                 old_dex_file.GetFieldName(old_field_id)) != 0 ||
+          strcmp(new_dex_file.GetFieldTypeDescriptor(new_field_id),
+                 old_dex_file.GetFieldTypeDescriptor(old_field_id)) != 0) {
+        return false;
+      }
+    } else {
+      const DexFile::MethodId& new_method_id = new_dex_file.GetMethodId(new_it.GetMemberIndex());
+      const DexFile::MethodId& old_method_id = old_dex_file.GetMethodId(old_it.GetMemberIndex());
+      if (strcmp(new_dex_file.GetMethodName(new_method_id),
+                 old_dex_file.GetMethodName(old_method_id)) != 0 ||
+          !(new_dex_file.GetMethodSignature(new_method_id) ==
+            old_dex_file.GetMethodSignature(old_method_id)) ||
+          !IsSameCode(new_dex_file, new_it.GetMethodCodeItem(),
+                      old_dex_file, old_it.GetMethodCodeItem(), dependencies)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool PreviousOatFile::IsSameCode(const DexFile& new_dex_file,
+                                 const DexFile::CodeItem* new_code_item,
+                                 const DexFile& old_dex_file,
+                                 const DexFile::CodeItem* old_code_item,
+                                 std::vector<std::string>* dependencies) {
+  if (new_code_item == nullptr || old_code_item == nullptr) {
+    return new_code_item == old_code_item;
+  }
+  if (new_code_item->registers_size_ != old_code_item->registers_size_ ||
+      new_code_item->ins_size_ != old_code_item->ins_size_ ||
+      new_code_item->outs_size_ != old_code_item->outs_size_ ||
+      new_code_item->tries_size_ != old_code_item->tries_size_ ||
+      new_code_item->insns_size_in_code_units_ != old_code_item->insns_size_in_code_units_) {
+    return false;
+  }
+  const uint32_t insns_size = new_code_item->insns_size_in_code_units_;
+  if (memcmp(new_code_item->insns_, old_code_item->insns_, insns_size * sizeof(uint16_t)) != 0) {
+    return false;
+  }
+  // The instructions are the same, so are their indices, which must refer to the same entities.
+  for (uint32_t dex_pc = 0; dex_pc < insns_size;) {
+    const Instruction* inst = Instruction::At(&new_code_item->insns_[dex_pc]);
+    bool same = true;
+    switch (inst->GetVerifyTypeArgumentB()) {
+      case Instruction::kVerifyRegBField:
+        same = IsSameField(new_dex_file, old_dex_file, inst->VRegB(), dependencies);
+        break;
+      case Instruction::kVerifyRegBMethod:
+        same = IsSameMethod(new_dex_file, old_dex_file, inst->VRegB(), dependencies);
+        break;
+      case Instruction::kVerifyRegBNewInstance:
+      case Instruction::kVerifyRegBType:
+        same = IsSameType(new_dex_file, old_dex_file, inst->VRegB(), dependencies);
+        break;
+      case Instruction::kVerifyRegBString:
+        same = IsSameString(new_dex_file, old_dex_file, inst->VRegB());
+        break;
+      default:
+        break;
+    }
+    switch (inst->GetVerifyTypeArgumentC()) {
+      case Instruction::kVerifyRegCField:
+        same = same && IsSameField(new_dex_file, old_dex_file, inst->VRegC(), dependencies);
+        break;
+      case Instruction::kVerifyRegCNewArray:
+      case Instruction::kVerifyRegCType:
+        same = same && IsSameType(new_dex_file, old_dex_file, inst->VRegC(), dependencies);
+        break;
+      default:
+        break;
+    }
+    if (!same) {
+      return false;
+    }
+    dex_pc += inst->SizeInCodeUnits();
+  }
+  // The try items and the handlers, whose catch types must be the same classes.
+  for (uint32_t i = 0; i < new_code_item->tries_size_; ++i) {
+    const DexFile::TryItem* new_try_item = DexFile::GetTryItems(*new_code_item, i);
+    const DexFile::TryItem* old_try_item = DexFile::GetTryItems(*old_code_item, i);
+    if (new_try_item->start_addr_ != old_try_item->start_addr_ ||
+        new_try_item->insn_count_ != old_try_item->insn_count_) {
+      return false;
+    }
+    CatchHandlerIterator new_handlers(*new_code_item, *new_try_item);
+    CatchHandlerIterator old_handlers(*old_code_item, *old_try_item);
+    for (; new_handlers.HasNext() && old_handlers.HasNext();
+         new_handlers.Next(), old_handlers.Next()) {
+      uint16_t type_idx = new_handlers.GetHandlerTypeIndex();
+      if (type_idx != old_handlers.GetHandlerTypeIndex() ||
+          new_handlers.GetHandlerAddress() != old_handlers.GetHandlerAddress()) {
+        return false;
+      }
+      if (type_idx != DexFile::kDexNoIndex16 &&
+          !IsSameType(new_dex_file, old_dex_file, type_idx, dependencies)) {
+        return false;
+      }
+    }
+    if (new_handlers.HasNext() || old_handlers.HasNext()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace art
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_COMPILER_DRIVER_PREVIOUS_OAT_FILE_H_
+#define ART_COMPILER_DRIVER_PREVIOUS_OAT_FILE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "dex_file.h"
+#include "instruction_set.h"
+#include "oat_file.h"
+
+namespace art {
+
+class CompiledMethod;
+class CompilerDriver;
+
+// An oat file previously compiled from an older version of the dex files being compiled. The
+// methods of a class are copied from it instead of being compiled again when the class did not
+// change, and neither did the classes of the dex files it depends on, directly or not.
+//
+// A class is unchanged when its definition, its members and its code are the same, and when the
+// strings, types, fields and methods referenced by its code have the same dex file indices, which
+// the compiled code uses for the dex cache. The classes of the boot class path are the same when
+// the boot image is, which is checked from the oat header.
+class PreviousOatFile {
+ public:
+  // Returns nullptr and sets `error_msg` if the oat file cannot be opened, or wasn't compiled from
+  // the same boot image for the same instruction set.
+  static PreviousOatFile* Open(const std::string& filename, InstructionSet instruction_set,
+                               const InstructionSetFeatures& instruction_set_features,
+                               uint32_t image_file_location_oat_checksum,
+                               uintptr_t image_file_location_oat_data_begin,
+                               const std::vector<const DexFile*>& dex_files,
+                               std::string* error_msg);
+
+  ~PreviousOatFile();
+
+  // Returns a copy of the method compiled in the previous oat file, or nullptr if its class
+  // changed or it wasn't compiled.
+  CompiledMethod* GetCompiledMethod(CompilerDriver* driver, const DexFile& dex_file,
+                                    uint16_t class_def_idx, uint32_t method_idx)
+      LOCKS_EXCLUDED(lock_);
+
+  const std::string& GetLocation() const;
+
+  size_t NumReusedMethods() LOCKS_EXCLUDED(lock_);
+
+ private:
+  // A class definition of the new or of the old dex files.
+  struct ClassDefLocation {
+    const DexFile* dex_file;
+    const DexFile::ClassDef* class_def;
+  };
+
+  enum ClassState {
+    kClassUnknown,     // Not compared yet.
+    kClassChanged,     // The class or one of its dependencies changed.
+    kClassSame,        // The class is the same, its dependencies were not compared yet.
+    kClassUnchanged,   // The class and all its dependencies are the same.
+  };
+
+  struct ClassInfo {
+    ClassInfo() : state(kClassUnknown) { }
+
+    ClassState state;
+    // Descriptors of the classes of the dex files the compiled code of the class depends on.
+    std::vector<std::string> dependencies;
+  };
+
+  PreviousOatFile(const OatFile* oat_file, const std::vector<const DexFile*>& dex_files,
+                  const std::vector<const OatFile::OatDexFile*>& old_oat_dex_files,
+                  const std::vector<const DexFile*>& old_dex_files);
+
+  bool IsUnchanged(const std::string& descriptor) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  ClassInfo* GetSameClassInfo(const std::string& descriptor) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  bool IsSameClass(const ClassDefLocation& new_class, const ClassDefLocation& old_class,
+                   std::vector<std::string>* dependencies);
+  bool IsSameCode(const DexFile& new_dex_file, const DexFile::CodeItem* new_code_item,
+                  const DexFile& old_dex_file, const DexFile::CodeItem* old_code_item,
+                  std::vector<std::string>* dependencies);
+
+  static bool FindClassDef(const std::vector<const DexFile*>& dex_files, const char* descriptor,
+                           ClassDefLocation* location);
+
+  const std::unique_ptr<const OatFile> oat_file_;
+  const std::vector<const DexFile*> dex_files_;
+  // The dex files of the previous oat file with the locations of `dex_files_`, in the same order.
+  const std::vector<const OatFile::OatDexFile*> old_oat_dex_files_;
+  // The dex files opened from `old_oat_dex_files_`, owned.
+  std::vector<const DexFile*> old_dex_files_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::map<std::string, ClassInfo> classes_ GUARDED_BY(lock_);
+  size_t num_reused_methods_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(PreviousOatFile);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DRIVER_PREVIOUS_OAT_FILE_H_
@@ -679,6 +679,12 @@ bool ElfWriterQuick::Write(OatWriter* oat_writer,
 
   // phase 3: writing file
 
+  // The sections are written out of order with seeks, reserve the space of the whole file first.
+  // This only avoids fragmentation, the file can still be written if it fails.
+  if (!FileOutputStream(elf_file_).Preallocate(shdr_offset + sizeof(section_headers))) {
+    PLOG(WARNING) << "Failed to preallocate " << elf_file_->GetPath();
+  }
+
   // Elf32_Ehdr
   if (!elf_file_->WriteFully(&elf_header, sizeof(elf_header))) {
     PLOG(ERROR) << "Failed to write ELF header for " << elf_file_->GetPath();
@@ -16,9 +16,15 @@
 
 #include "file_output_stream.h"
 
+#include <fcntl.h>
+#include <limits.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "base/unix_file/fd_file.h"
 
 namespace art {
@@ -29,8 +35,44 @@ bool FileOutputStream::WriteFully(const void* buffer, size_t byte_count) {
   return file_->WriteFully(buffer, byte_count);
 }
 
+bool FileOutputStream::WriteVectored(const struct iovec* iov, int iov_count) {
+  // writev() may write less than asked, the copy tracks what is left of each buffer.
+  std::vector<struct iovec> remaining(iov, iov + iov_count);
+  size_t first = 0;
+  while (first != remaining.size()) {
+    int count = std::min<size_t>(remaining.size() - first, IOV_MAX);
+    ssize_t bytes_written = TEMP_FAILURE_RETRY(writev(file_->Fd(), &remaining[first], count));
+    if (bytes_written == -1) {
+      return false;
+    }
+    size_t left = bytes_written;
+    while (first != remaining.size() && left >= remaining[first].iov_len) {
+      left -= remaining[first].iov_len;
+      ++first;
+    }
+    if (left != 0) {
+      remaining[first].iov_base = reinterpret_cast<uint8_t*>(remaining[first].iov_base) + left;
+      remaining[first].iov_len -= left;
+    }
+  }
+  return true;
+}
+
 off_t FileOutputStream::Seek(off_t offset, Whence whence) {
   return lseek(file_->Fd(), offset, static_cast<int>(whence));
 }
 
+bool FileOutputStream::Preallocate(off_t size) {
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+  // Keep the size, the file ends where the last write does even if the estimate was too large.
+  if (TEMP_FAILURE_RETRY(fallocate(file_->Fd(), FALLOC_FL_KEEP_SIZE, 0, size)) != 0) {
+    // Not all file systems support it, the writes allocate the space then.
+    return errno == EOPNOTSUPP || errno == ENOSYS;
+  }
+#else
+  UNUSED(size);
+#endif
+  return true;
+}
+
 }  // namespace art
@@ -31,8 +31,12 @@ class FileOutputStream : public OutputStream {
 
   virtual bool WriteFully(const void* buffer, size_t byte_count);
 
+  virtual bool WriteVectored(const struct iovec* iov, int iov_count);
+
   virtual off_t Seek(off_t offset, Whence whence);
 
+  virtual bool Preallocate(off_t size);
+
  private:
   File* const file_;
 
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "gc_map.h"
+#include "safe_map.h"
 #include "utils.h"
 
 namespace art {
@@ -29,31 +30,86 @@ class GcMapBuilder {
   GcMapBuilder(std::vector<uint8_t>* table, size_t entries, uint32_t max_native_offset,
                size_t references_width)
       : entries_(entries), references_width_(entries != 0u ? references_width : 0u),
-        native_offset_width_(entries != 0 && max_native_offset != 0
+        native_offset_width_(max_native_offset != 0
                              ? sizeof(max_native_offset) - CLZ(max_native_offset) / 8u
-                             : 0u),
-        in_use_(entries), table_(table) {
-    // Resize table and set up header.
-    table->resize((EntryWidth() * entries) + sizeof(uint32_t));
-    CHECK_LT(native_offset_width_, 1U << 3);
-    (*table)[0] = native_offset_width_ & 7;
+                             : 1u),
+        entry_width_(0u), header_size_(0u), table_(table) {
     CHECK_LT(references_width_, 1U << 13);
-    (*table)[0] |= (references_width_ << 3) & 0xFF;
-    (*table)[1] = (references_width_ >> 5) & 0xFF;
     CHECK_LT(entries, 1U << 16);
-    (*table)[2] = entries & 0xFF;
-    (*table)[3] = (entries >> 8) & 0xFF;
+    offsets_.reserve(entries);
+    references_.reserve(entries);
   }
 
+  // Entries are kept until Build() since the encoding depends on all the bitmaps.
   void AddEntry(uint32_t native_offset, const uint8_t* references) {
-    size_t table_index = TableIndex(native_offset);
-    while (in_use_[table_index]) {
-      table_index = (table_index + 1) % entries_;
+    DCHECK_LT(offsets_.size(), entries_);
+    offsets_.push_back(native_offset);
+    references_.push_back(references);
+  }
+
+  // Writes the table, with a dictionary of the distinct bitmaps if that is smaller than keeping
+  // the bitmaps in the entries. Methods usually have few distinct bitmaps for many safepoints.
+  void Build() {
+    CHECK_EQ(offsets_.size(), entries_);
+    // Index of the first entry with each distinct bitmap, in the order they are found.
+    std::vector<size_t> dictionary;
+    std::vector<size_t> bitmap_index(entries_);
+    SafeMap<std::vector<uint8_t>, size_t> bitmaps;
+    for (size_t i = 0; i != entries_; ++i) {
+      std::vector<uint8_t> bitmap(references_[i], references_[i] + references_width_);
+      auto it = bitmaps.find(bitmap);
+      if (it != bitmaps.end()) {
+        bitmap_index[i] = it->second;
+      } else {
+        bitmap_index[i] = dictionary.size();
+        bitmaps.Put(bitmap, dictionary.size());
+        dictionary.push_back(i);
+      }
+    }
+    size_t index_width = NativePcOffsetToReferenceMap::DictionaryIndexWidth(dictionary.size());
+    size_t inline_size = NativePcOffsetToReferenceMap::HeaderSize(false) +
+        entries_ * (native_offset_width_ + references_width_);
+    size_t dictionary_size = NativePcOffsetToReferenceMap::HeaderSize(true) +
+        entries_ * (native_offset_width_ + index_width) + dictionary.size() * references_width_;
+    const bool use_dictionary = dictionary_size < inline_size;
+    entry_width_ = native_offset_width_ + (use_dictionary ? index_width : references_width_);
+    header_size_ = NativePcOffsetToReferenceMap::HeaderSize(use_dictionary);
+
+    table_->clear();
+    table_->resize(use_dictionary ? dictionary_size : inline_size);
+    (*table_)[0] = (native_offset_width_ - 1u) | ((references_width_ << 3) & 0xFF);
+    if (use_dictionary) {
+      (*table_)[0] |= NativePcOffsetToReferenceMap::kDictionaryFlag;
+      (*table_)[4] = dictionary.size() & 0xFF;
+      (*table_)[5] = (dictionary.size() >> 8) & 0xFF;
+    }
+    (*table_)[1] = (references_width_ >> 5) & 0xFF;
+    (*table_)[2] = entries_ & 0xFF;
+    (*table_)[3] = (entries_ >> 8) & 0xFF;
+
+    std::vector<bool> in_use(entries_);
+    for (size_t i = 0; i != entries_; ++i) {
+      size_t table_index = TableIndex(offsets_[i]);
+      while (in_use[table_index]) {
+        table_index = (table_index + 1) % entries_;
+      }
+      in_use[table_index] = true;
+      SetCodeOffset(table_index, offsets_[i]);
+      DCHECK_EQ(offsets_[i], GetCodeOffset(table_index));
+      if (use_dictionary) {
+        SetBitmapIndex(table_index, bitmap_index[i], index_width);
+      } else {
+        SetReferences(table_index, references_[i]);
+      }
+    }
+    if (use_dictionary) {
+      size_t dictionary_offset = header_size_ + entries_ * entry_width_;
+      for (size_t first_entry : dictionary) {
+        memcpy(&(*table_)[dictionary_offset], references_[first_entry], references_width_);
+        dictionary_offset += references_width_;
+      }
+      DCHECK_EQ(dictionary_offset, table_->size());
     }
-    in_use_[table_index] = true;
-    SetCodeOffset(table_index, native_offset);
-    DCHECK_EQ(native_offset, GetCodeOffset(table_index));
-    SetReferences(table_index, references);
   }
 
  private:
@@ -61,9 +117,13 @@ class GcMapBuilder {
     return NativePcOffsetToReferenceMap::Hash(native_offset) % entries_;
   }
 
+  size_t EntryOffset(size_t table_index) const {
+    return table_index * entry_width_ + header_size_;
+  }
+
   uint32_t GetCodeOffset(size_t table_index) {
     uint32_t native_offset = 0;
-    size_t table_offset = (table_index * EntryWidth()) + sizeof(uint32_t);
+    size_t table_offset = EntryOffset(table_index);
     for (size_t i = 0; i < native_offset_width_; i++) {
       native_offset |= (*table_)[table_offset + i] << (i * 8);
     }
@@ -71,19 +131,22 @@ class GcMapBuilder {
   }
 
   void SetCodeOffset(size_t table_index, uint32_t native_offset) {
-    size_t table_offset = (table_index * EntryWidth()) + sizeof(uint32_t);
+    size_t table_offset = EntryOffset(table_index);
     for (size_t i = 0; i < native_offset_width_; i++) {
       (*table_)[table_offset + i] = (native_offset >> (i * 8)) & 0xFF;
     }
   }
 
   void SetReferences(size_t table_index, const uint8_t* references) {
-    size_t table_offset = (table_index * EntryWidth()) + sizeof(uint32_t);
+    size_t table_offset = EntryOffset(table_index);
     memcpy(&(*table_)[table_offset + native_offset_width_], references, references_width_);
   }
 
-  size_t EntryWidth() const {
-    return native_offset_width_ + references_width_;
+  void SetBitmapIndex(size_t table_index, size_t bitmap_index, size_t index_width) {
+    size_t table_offset = EntryOffset(table_index) + native_offset_width_;
+    for (size_t i = 0; i < index_width; i++) {
+      (*table_)[table_offset + i] = (bitmap_index >> (i * 8)) & 0xFF;
+    }
   }
 
   // Number of entries in the table.
@@ -92,8 +155,12 @@ class GcMapBuilder {
   const size_t references_width_;
   // Number of bytes used to encode a native offset.
   const size_t native_offset_width_;
-  // Entries that are in use.
-  std::vector<bool> in_use_;
+  // The layout chosen by Build().
+  size_t entry_width_;
+  size_t header_size_;
+  // The entries added so far, the bitmaps belong to the caller until Build().
+  std::vector<uint32_t> offsets_;
+  std::vector<const uint8_t*> references_;
   // The table we're building.
   std::vector<uint8_t>* const table_;
 };
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "gc_map_builder.h"
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+static void CheckMap(const std::vector<uint8_t>& table, const std::vector<uint32_t>& offsets,
+                     const std::vector<std::vector<uint8_t>>& bitmaps, size_t reg_width) {
+  NativePcOffsetToReferenceMap map(&table[0]);
+  ASSERT_EQ(offsets.size(), map.NumEntries());
+  EXPECT_EQ(table.size(), map.SizeInBytes());
+  EXPECT_EQ(reg_width, map.RegWidth());
+  for (size_t i = 0; i != offsets.size(); ++i) {
+    ASSERT_TRUE(map.HasEntry(offsets[i]));
+    const uint8_t* bitmap = map.FindBitMap(offsets[i]);
+    EXPECT_EQ(0, memcmp(bitmap, &bitmaps[i][0], reg_width)) << offsets[i];
+  }
+}
+
+TEST(GcMapBuilder, Inline) {
+  // All the bitmaps differ, the dictionary would only add to their size.
+  std::vector<uint32_t> offsets = { 4u, 10u, 0x1234u };
+  std::vector<std::vector<uint8_t>> bitmaps = { { 1u, 0u }, { 2u, 0u }, { 3u, 0x80u } };
+  std::vector<uint8_t> table;
+  GcMapBuilder builder(&table, offsets.size(), 0x1234u, 2u);
+  for (size_t i = 0; i != offsets.size(); ++i) {
+    builder.AddEntry(offsets[i], &bitmaps[i][0]);
+  }
+  builder.Build();
+  NativePcOffsetToReferenceMap map(&table[0]);
+  EXPECT_FALSE(map.HasDictionary());
+  EXPECT_EQ(4u + 3u * (2u + 2u), table.size());
+  CheckMap(table, offsets, bitmaps, 2u);
+}
+
+TEST(GcMapBuilder, Dictionary) {
+  // Many safepoints share a few wide bitmaps.
+  const size_t kEntries = 300;
+  const size_t kRegWidth = 8;
+  std::vector<uint32_t> offsets;
+  std::vector<std::vector<uint8_t>> bitmaps;
+  for (size_t i = 0; i != kEntries; ++i) {
+    offsets.push_back(0x100u + i * 6u);
+    bitmaps.push_back(std::vector<uint8_t>(kRegWidth, static_cast<uint8_t>(1u << (i % 3))));
+  }
+  std::vector<uint8_t> table;
+  GcMapBuilder builder(&table, kEntries, offsets.back(), kRegWidth);
+  for (size_t i = 0; i != kEntries; ++i) {
+    builder.AddEntry(offsets[i], &bitmaps[i][0]);
+  }
+  builder.Build();
+  NativePcOffsetToReferenceMap map(&table[0]);
+  EXPECT_TRUE(map.HasDictionary());
+  EXPECT_EQ(3u, map.NumDictionaryEntries());
+  EXPECT_EQ(6u + kEntries * (2u + 1u) + 3u * kRegWidth, table.size());
+  CheckMap(table, offsets, bitmaps, kRegWidth);
+}
+
+TEST(GcMapBuilder, WideDictionary) {
+  // More distinct bitmaps than a byte indexes, still much smaller than inline bitmaps.
+  const size_t kEntries = 2000;
+  const size_t kRegWidth = 16;
+  std::vector<uint32_t> offsets;
+  std::vector<std::vector<uint8_t>> bitmaps;
+  for (size_t i = 0; i != kEntries; ++i) {
+    offsets.push_back(i * 4u);
+    std::vector<uint8_t> bitmap(kRegWidth, 0u);
+    bitmap[0] = (i % 300) & 0xFF;
+    bitmap[1] = (i % 300) >> 8;
+    bitmaps.push_back(bitmap);
+  }
+  std::vector<uint8_t> table;
+  GcMapBuilder builder(&table, kEntries, offsets.back(), kRegWidth);
+  for (size_t i = 0; i != kEntries; ++i) {
+    builder.AddEntry(offsets[i], &bitmaps[i][0]);
+  }
+  builder.Build();
+  NativePcOffsetToReferenceMap map(&table[0]);
+  EXPECT_TRUE(map.HasDictionary());
+  EXPECT_EQ(300u, map.NumDictionaryEntries());
+  CheckMap(table, offsets, bitmaps, kRegWidth);
+}
+
+TEST(GcMapBuilder, Empty) {
+  std::vector<uint8_t> table;
+  GcMapBuilder builder(&table, 0u, 0u, 4u);
+  builder.Build();
+  NativePcOffsetToReferenceMap map(&table[0]);
+  EXPECT_EQ(0u, map.NumEntries());
+  EXPECT_EQ(0u, map.RegWidth());
+  EXPECT_EQ(table.size(), map.SizeInBytes());
+}
+
+}  // namespace art
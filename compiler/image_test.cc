@@ -109,6 +109,13 @@ TEST_F(ImageTest, WriteRead) {
     ASSERT_TRUE(image_header.IsValid());
     ASSERT_GE(image_header.GetImageBitmapOffset(), sizeof(image_header));
     ASSERT_NE(0U, image_header.GetImageBitmapSize());
+    ASSERT_GE(image_header.GetRelocationsOffset(),
+              image_header.GetImageBitmapOffset() + image_header.GetImageBitmapSize());
+    ASSERT_GE(image_header.GetRelocationsSize(), image_header.GetRelocationBitmapSize());
+    ASSERT_EQ(static_cast<int64_t>(image_header.GetRelocationsOffset() +
+                                   image_header.GetRelocationsSize()),
+              file->GetLength());
+    EXPECT_EQ(0, image_header.GetPatchDelta());
 
     gc::Heap* heap = Runtime::Current()->GetHeap();
     ASSERT_TRUE(!heap->GetContinuousSpaces().empty());
@@ -191,8 +198,10 @@ TEST_F(ImageTest, ImageHeaderIsValid) {
     uint32_t image_size_ = 16 * KB;
     uint32_t image_bitmap_offset = 0;
     uint32_t image_bitmap_size = 0;
+    uint32_t relocations_offset = 0;
     uint32_t image_roots = ART_BASE_ADDRESS + (1 * KB);
     uint32_t oat_checksum = 0;
+    uint32_t boot_oat_checksum = 0;
     uint32_t oat_file_begin = ART_BASE_ADDRESS + (4 * KB);  // page aligned
     uint32_t oat_data_begin = ART_BASE_ADDRESS + (8 * KB);  // page aligned
     uint32_t oat_data_end = ART_BASE_ADDRESS + (9 * KB);
@@ -201,13 +210,16 @@ TEST_F(ImageTest, ImageHeaderIsValid) {
                              image_size_,
                              image_bitmap_offset,
                              image_bitmap_size,
+                             relocations_offset,
                              image_roots,
                              oat_checksum,
+                             boot_oat_checksum,
                              oat_file_begin,
                              oat_data_begin,
                              oat_data_end,
                              oat_file_end);
     ASSERT_TRUE(image_header.IsValid());
+    ASSERT_FALSE(image_header.IsAppImage());
 
     char* magic = const_cast<char*>(image_header.GetMagic());
     strcpy(magic, "");  // bad magic
@@ -216,4 +228,47 @@ TEST_F(ImageTest, ImageHeaderIsValid) {
     ASSERT_FALSE(image_header.IsValid());
 }
 
+TEST_F(ImageTest, ImageHeaderRelocate) {
+    uint32_t image_begin = ART_BASE_ADDRESS;
+    uint32_t oat_file_begin = ART_BASE_ADDRESS + (4 * KB);
+    uint32_t oat_data_begin = ART_BASE_ADDRESS + (8 * KB);
+    ImageHeader image_header(image_begin, 4 * KB, 4 * KB, 4 * KB, 8 * KB,
+                             ART_BASE_ADDRESS + (1 * KB), 0, 0, oat_file_begin, oat_data_begin,
+                             ART_BASE_ADDRESS + (9 * KB), ART_BASE_ADDRESS + (10 * KB));
+    EXPECT_EQ(0, image_header.GetPatchDelta());
+    // There are no oat relocations without a relocation section.
+    EXPECT_EQ(0U, image_header.GetRelocationsSize());
+
+    const int32_t delta = -static_cast<int32_t>(2 * kPageSize);
+    image_header.Relocate(delta);
+    image_header.Relocate(3 * kPageSize);
+    const int32_t total_delta = delta + 3 * kPageSize;
+    EXPECT_EQ(total_delta, image_header.GetPatchDelta());
+    EXPECT_EQ(reinterpret_cast<byte*>(image_begin + total_delta), image_header.GetImageBegin());
+    EXPECT_EQ(reinterpret_cast<byte*>(oat_file_begin + total_delta),
+              image_header.GetOatFileBegin());
+    EXPECT_EQ(reinterpret_cast<byte*>(oat_data_begin + total_delta),
+              image_header.GetOatDataBegin());
+    // The offsets in the file don't move.
+    EXPECT_EQ(4 * KB, image_header.GetImageBitmapOffset());
+    EXPECT_EQ(8 * KB, image_header.GetRelocationsOffset());
+}
+
+TEST_F(ImageTest, AppImageHeader) {
+    ImageHeader image_header(ART_BASE_ADDRESS, 4 * KB, 4 * KB, 4 * KB, 8 * KB,
+                             ART_BASE_ADDRESS + (1 * KB), 0x1234, 0x5678,
+                             ART_BASE_ADDRESS + (4 * KB), ART_BASE_ADDRESS + (8 * KB),
+                             ART_BASE_ADDRESS + (9 * KB), ART_BASE_ADDRESS + (10 * KB));
+    EXPECT_TRUE(image_header.IsAppImage());
+    EXPECT_EQ(0x5678U, image_header.GetBootOatChecksum());
+
+    EXPECT_EQ("/data/dalvik-cache/arm/data@app@Foo.apk@classes.art",
+              ImageHeader::GetAppImageLocationFromOatLocation(
+                  "/data/dalvik-cache/arm/data@app@Foo.apk@classes.dex"));
+    EXPECT_EQ("/data/app/Foo.art", ImageHeader::GetAppImageLocationFromOatLocation(
+                  "/data/app/Foo.odex"));
+    EXPECT_EQ("/data/app.d/Foo.art", ImageHeader::GetAppImageLocationFromOatLocation(
+                  "/data/app.d/Foo"));
+}
+
 }  // namespace art
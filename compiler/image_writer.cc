@@ -18,6 +18,7 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -53,6 +54,7 @@
 #include "runtime.h"
 #include "scoped_thread_state_change.h"
 #include "handle_scope-inl.h"
+#include "thread_pool.h"
 #include "utils.h"
 
 using ::art::mirror::ArtField;
@@ -91,36 +93,58 @@ bool ImageWriter::Write(const std::string& image_filename,
   }
   CHECK_EQ(class_linker->RegisterOatFile(oat_file_), oat_file_);
 
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  const OatHeader* stubs_oat_header = &oat_file_->GetOatHeader();
+  if (IsAppImage()) {
+    // Only the boot oat file has the stubs.
+    boot_image_space_ = heap->GetImageSpace();
+    CHECK(boot_image_space_ != nullptr);
+    boot_oat_data_begin_ = boot_image_space_->GetImageHeader().GetOatDataBegin();
+    stubs_oat_header = reinterpret_cast<const OatHeader*>(boot_oat_data_begin_);
+  }
+
   interpreter_to_interpreter_bridge_offset_ =
-      oat_file_->GetOatHeader().GetInterpreterToInterpreterBridgeOffset();
+      stubs_oat_header->GetInterpreterToInterpreterBridgeOffset();
   interpreter_to_compiled_code_bridge_offset_ =
-      oat_file_->GetOatHeader().GetInterpreterToCompiledCodeBridgeOffset();
+      stubs_oat_header->GetInterpreterToCompiledCodeBridgeOffset();
 
-  jni_dlsym_lookup_offset_ = oat_file_->GetOatHeader().GetJniDlsymLookupOffset();
+  jni_dlsym_lookup_offset_ = stubs_oat_header->GetJniDlsymLookupOffset();
 
   portable_imt_conflict_trampoline_offset_ =
-      oat_file_->GetOatHeader().GetPortableImtConflictTrampolineOffset();
+      stubs_oat_header->GetPortableImtConflictTrampolineOffset();
   portable_resolution_trampoline_offset_ =
-      oat_file_->GetOatHeader().GetPortableResolutionTrampolineOffset();
+      stubs_oat_header->GetPortableResolutionTrampolineOffset();
   portable_to_interpreter_bridge_offset_ =
-      oat_file_->GetOatHeader().GetPortableToInterpreterBridgeOffset();
+      stubs_oat_header->GetPortableToInterpreterBridgeOffset();
 
   quick_generic_jni_trampoline_offset_ =
-      oat_file_->GetOatHeader().GetQuickGenericJniTrampolineOffset();
+      stubs_oat_header->GetQuickGenericJniTrampolineOffset();
   quick_imt_conflict_trampoline_offset_ =
-      oat_file_->GetOatHeader().GetQuickImtConflictTrampolineOffset();
+      stubs_oat_header->GetQuickImtConflictTrampolineOffset();
   quick_resolution_trampoline_offset_ =
-      oat_file_->GetOatHeader().GetQuickResolutionTrampolineOffset();
+      stubs_oat_header->GetQuickResolutionTrampolineOffset();
   quick_to_interpreter_bridge_offset_ =
-      oat_file_->GetOatHeader().GetQuickToInterpreterBridgeOffset();
+      stubs_oat_header->GetQuickToInterpreterBridgeOffset();
   {
-    Thread::Current()->TransitionFromSuspendedToRunnable();
-    PruneNonImageClasses();  // Remove junk
+    Thread* self = Thread::Current();
+    self->TransitionFromSuspendedToRunnable();
+    if (IsAppImage()) {
+      class_loader_ = down_cast<mirror::ClassLoader*>(self->DecodeJObject(app_class_loader_));
+      for (const DexFile* dex_file : app_dex_files_) {
+        app_dex_caches_.push_back(class_linker->FindDexCache(*dex_file));
+      }
+      PruneAppDexCaches();
+    } else {
+      PruneNonImageClasses();  // Remove junk
+    }
     ComputeLazyFieldsForImageClasses();  // Add useful information
-    ComputeEagerResolvedStrings();
-    Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+    // The strings of an app image are interned again when it is loaded.
+    if (!IsAppImage()) {
+      ComputeEagerResolvedStrings();
+      ProcessStrings();  // The unshared arrays are dropped by the collection below.
+    }
+    self->TransitionFromRunnableToSuspended(kNative);
   }
-  gc::Heap* heap = Runtime::Current()->GetHeap();
   heap->CollectGarbage(false);  // Remove garbage.
 
   if (!AllocMemory()) {
@@ -132,17 +156,32 @@ bool ImageWriter::Write(const std::string& image_filename,
     CheckNonImageClassesRemoved();
   }
 
+  // The workers attach to the runtime, create them while suspended.
+  std::unique_ptr<ThreadPool> thread_pool;
+  if (compiler_driver_.GetThreadCount() > 1) {
+    thread_pool.reset(new ThreadPool("Image writer thread pool",
+                                     compiler_driver_.GetThreadCount() - 1));
+  }
+
   Thread::Current()->TransitionFromSuspendedToRunnable();
   size_t oat_loaded_size = 0;
   size_t oat_data_offset = 0;
   ElfWriter::GetOatElfInformation(oat_file.get(), oat_loaded_size, oat_data_offset);
   CalculateNewObjectOffsets(oat_loaded_size, oat_data_offset);
-  CopyAndFixupObjects();
+  CopyAndFixupObjects(thread_pool.get());
   PatchOatCodeAndMethods();
   Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+  thread_pool.reset();
 
-  std::unique_ptr<File> image_file(OS::CreateEmptyFile(image_filename.c_str()));
   ImageHeader* image_header = reinterpret_cast<ImageHeader*>(image_->Begin());
+  if (IsAppImage() && image_header->GetOatFileEnd() > boot_image_space_->Begin()) {
+    LOG(ERROR) << "App image " << image_filename << " and its oat file end at "
+               << reinterpret_cast<const void*>(image_header->GetOatFileEnd())
+               << ", after the start of the boot image at "
+               << reinterpret_cast<const void*>(boot_image_space_->Begin());
+    return false;
+  }
+  std::unique_ptr<File> image_file(OS::CreateEmptyFile(image_filename.c_str()));
   if (image_file.get() == NULL) {
     LOG(ERROR) << "Failed to open image file " << image_filename;
     return false;
@@ -152,6 +191,12 @@ bool ImageWriter::Write(const std::string& image_filename,
     return EXIT_FAILURE;
   }
 
+  // The relocation section lists the absolute addresses in the image and oat file, so that they
+  // can be moved without recompiling.
+  const size_t relocation_bitmap_size = image_header->GetRelocationBitmapSize();
+  image_header->relocations_size_ = relocation_bitmap_size +
+      oat_relocations_.size() * sizeof(uint32_t);
+
   // Write out the image.
   CHECK_EQ(image_end_, image_header->GetImageSize());
   if (!image_file->WriteFully(image_->Begin(), image_end_)) {
@@ -168,6 +213,18 @@ bool ImageWriter::Write(const std::string& image_filename,
     return false;
   }
 
+  // Write out the relocations after the image bitmap.
+  CHECK_ALIGNED(image_header->GetRelocationsOffset(), kPageSize);
+  const size_t oat_relocations_size = oat_relocations_.size() * sizeof(uint32_t);
+  if (!image_file->Write(reinterpret_cast<char*>(relocation_bitmap_->Begin()),
+                         relocation_bitmap_size, image_header->GetRelocationsOffset()) ||
+      (oat_relocations_size != 0 &&
+       !image_file->Write(reinterpret_cast<char*>(oat_relocations_.data()), oat_relocations_size,
+                          image_header->GetRelocationsOffset() + relocation_bitmap_size))) {
+    PLOG(ERROR) << "Failed to write image file " << image_filename;
+    return false;
+  }
+
   return true;
 }
 
@@ -190,6 +247,12 @@ void ImageWriter::SetImageOffset(mirror::Object* object, size_t offset) {
       LOG(FATAL) << "Thin locked object " << obj << " found during object copy";
       break;
     }
+    case LockWord::kBiasLocked: {
+      // A bias that isn't held is dropped with the rest of the lock word.
+      CHECK_EQ(lw.ThinLockCount(), 0U) << "Biased locked object " << obj
+          << " found during object copy";
+      break;
+    }
     case LockWord::kUnlocked:
       // No hash, don't need to save it.
       break;
@@ -242,6 +305,12 @@ bool ImageWriter::AllocMemory() {
     LOG(ERROR) << "Failed to allocate memory for image bitmap";
     return false;
   }
+  relocation_bitmap_.reset(gc::accounting::RelocationBitmap::Create("image relocation bitmap",
+                                                                   image_->Begin(), length));
+  if (relocation_bitmap_.get() == nullptr) {
+    LOG(ERROR) << "Failed to allocate memory for image relocation bitmap";
+    return false;
+  }
   return true;
 }
 
@@ -286,10 +355,135 @@ void ImageWriter::ComputeEagerResolvedStrings() SHARED_LOCKS_REQUIRED(Locks::mut
   Runtime::Current()->GetHeap()->VisitObjects(ComputeEagerResolvedStringsCallback, this);
 }
 
+void ImageWriter::CollectStringsCallback(Object* obj, void* arg) {
+  if (obj->GetClass()->IsStringClass()) {
+    reinterpret_cast<std::vector<mirror::String*>*>(arg)->push_back(obj->AsString());
+  }
+}
+
+// Lexicographic order on the UTF-16 data, so that each string sorts directly before the
+// strings it is a prefix of.
+static bool LessStringContents(mirror::String* lhs, mirror::String* rhs)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const uint16_t* lhs_data = lhs->GetCharArray()->GetData() + lhs->GetOffset();
+  const uint16_t* rhs_data = rhs->GetCharArray()->GetData() + rhs->GetOffset();
+  return std::lexicographical_compare(lhs_data, lhs_data + lhs->GetLength(),
+                                      rhs_data, rhs_data + rhs->GetLength());
+}
+
+void ImageWriter::ProcessStrings() {
+  Thread* self = Thread::Current();
+  std::vector<mirror::String*> strings;
+  {
+    ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    Runtime::Current()->GetHeap()->VisitObjects(CollectStringsCallback, &strings);
+  }
+  // The raw string pointers must not move while we sort and rewrite them.
+  const char* old = self->StartAssertNoThreadSuspension("ImageWriter::ProcessStrings");
+  std::sort(strings.begin(), strings.end(), LessStringContents);
+  // Walking backwards, a string that is a prefix of the current target can use the target's
+  // array. Otherwise it becomes the new target, and anything sorting before it that is a prefix
+  // of the old target is also a prefix of it.
+  size_t shared_strings = 0;
+  size_t shared_chars = 0;
+  mirror::String* target = nullptr;
+  for (auto it = strings.rbegin(); it != strings.rend(); ++it) {
+    mirror::String* string = *it;
+    int32_t length = string->GetLength();
+    if (target != nullptr && length <= target->GetLength()) {
+      const uint16_t* data = string->GetCharArray()->GetData() + string->GetOffset();
+      const uint16_t* target_data = target->GetCharArray()->GetData() + target->GetOffset();
+      if (std::equal(data, data + length, target_data)) {
+        if (string->GetCharArray() != target->GetCharArray()) {
+          ++shared_strings;
+          shared_chars += length;
+          string->ShareCharArray(target->GetCharArray(), target->GetOffset());
+        }
+        continue;
+      }
+    }
+    target = string;
+  }
+  self->EndAssertNoThreadSuspension(old);
+  VLOG(compiler) << shared_strings << " of " << strings.size() << " image strings share the "
+                 << "char array of another, " << PrettySize(shared_chars * sizeof(uint16_t));
+}
+
 bool ImageWriter::IsImageClass(Class* klass) {
+  if (IsAppImage()) {
+    return IsAppImageClass(klass);
+  }
   return compiler_driver_.IsImageClass(klass->GetDescriptor().c_str());
 }
 
+bool ImageWriter::IsAppImageClass(Class* klass) {
+  auto it = app_image_classes_.find(klass);
+  if (it != app_image_classes_.end()) {
+    return it->second;
+  }
+  // The class hierarchy has no cycles, the recursion ends.
+  bool result = ComputeIsAppImageClass(klass);
+  app_image_classes_.Put(klass, result);
+  return result;
+}
+
+bool ImageWriter::ComputeIsAppImageClass(Class* klass) {
+  if (klass->GetClassLoader() != class_loader_ || !klass->IsResolved() || klass->IsErroneous() ||
+      klass->IsProxyClass()) {
+    return false;
+  }
+  if (klass->IsArrayClass()) {
+    return IsReferenceableFromAppImage(klass->GetComponentType());
+  }
+  if (std::find(app_dex_caches_.begin(), app_dex_caches_.end(), klass->GetDexCache()) ==
+      app_dex_caches_.end()) {
+    return false;
+  }
+  Class* super_class = klass->GetSuperClass();
+  if (super_class != nullptr && !IsReferenceableFromAppImage(super_class)) {
+    return false;
+  }
+  // The interface table of a resolved class holds all its interfaces.
+  mirror::IfTable* iftable = klass->GetIfTable();
+  for (int32_t i = 0; i < klass->GetIfTableCount(); ++i) {
+    if (!IsReferenceableFromAppImage(iftable->GetInterface(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ImageWriter::IsReferenceableFromAppImage(Class* klass) {
+  return boot_image_space_->Contains(klass) || IsAppImageClass(klass);
+}
+
+bool ImageWriter::IsInitializedInImage(Class* klass) {
+  return !IsAppImage() && klass->IsInitialized();
+}
+
+uint32_t ImageWriter::GetQuickOatCodeOffset(ArtMethod* method) {
+  if (!IsAppImage()) {
+    return method->GetQuickOatCodeOffset();
+  }
+  return kUsePortableCompiler ? 0u
+      : Runtime::Current()->GetClassLinker()->GetOatMethodFor(method).GetCodeOffset();
+}
+
+uint32_t ImageWriter::GetPortableOatCodeOffset(ArtMethod* method) {
+  if (!IsAppImage()) {
+    return method->GetPortableOatCodeOffset();
+  }
+  return !kUsePortableCompiler ? 0u
+      : Runtime::Current()->GetClassLinker()->GetOatMethodFor(method).GetCodeOffset();
+}
+
+uint32_t ImageWriter::GetOatNativeGcMapOffset(ArtMethod* method) {
+  if (!IsAppImage()) {
+    return method->GetOatNativeGcMapOffset();
+  }
+  return Runtime::Current()->GetClassLinker()->GetOatMethodFor(method).GetNativeGcMapOffset();
+}
+
 struct NonImageClasses {
   ImageWriter* image_writer;
   std::set<std::string>* non_image_classes;
@@ -338,6 +532,43 @@ void ImageWriter::PruneNonImageClasses() {
   }
 }
 
+void ImageWriter::PruneAppDexCaches() {
+  Runtime* runtime = Runtime::Current();
+  runtime->GetClassLinker()->VisitClasses(AppImageClassesVisitor, this);
+
+  // Clear references to classes which aren't written, the app resolves them again.
+  ArtMethod* resolution_method = runtime->GetResolutionMethod();
+  for (DexCache* dex_cache : app_dex_caches_) {
+    for (size_t i = 0; i < dex_cache->NumResolvedTypes(); i++) {
+      Class* klass = dex_cache->GetResolvedType(i);
+      if (klass != NULL && !IsReferenceableFromAppImage(klass)) {
+        dex_cache->SetResolvedType(i, NULL);
+      }
+    }
+    for (size_t i = 0; i < dex_cache->NumResolvedMethods(); i++) {
+      ArtMethod* method = dex_cache->GetResolvedMethod(i);
+      if (method != NULL && method != resolution_method &&
+          !IsReferenceableFromAppImage(method->GetDeclaringClass())) {
+        dex_cache->SetResolvedMethod(i, resolution_method);
+      }
+    }
+    for (size_t i = 0; i < dex_cache->NumResolvedFields(); i++) {
+      ArtField* field = dex_cache->GetResolvedField(i);
+      if (field != NULL && !IsReferenceableFromAppImage(field->GetDeclaringClass())) {
+        dex_cache->SetResolvedField(i, NULL);
+      }
+    }
+  }
+}
+
+bool ImageWriter::AppImageClassesVisitor(Class* klass, void* arg) {
+  ImageWriter* image_writer = reinterpret_cast<ImageWriter*>(arg);
+  if (image_writer->IsAppImageClass(klass)) {
+    image_writer->app_image_class_list_.push_back(klass);
+  }
+  return true;
+}
+
 bool ImageWriter::NonImageClassesVisitor(Class* klass, void* arg) {
   NonImageClasses* context = reinterpret_cast<NonImageClasses*>(arg);
   if (!context->image_writer->IsImageClass(klass)) {
@@ -377,8 +608,9 @@ void ImageWriter::DumpImageClasses() {
 
 void ImageWriter::CalculateObjectOffsets(Object* obj) {
   DCHECK(obj != NULL);
-  // if it is a string, we want to intern it if its not interned.
-  if (obj->GetClass()->IsStringClass()) {
+  // if it is a string, we want to intern it if its not interned. The strings of an app image are
+  // interned when it is loaded.
+  if (obj->GetClass()->IsStringClass() && !IsAppImage()) {
     // we must be an interned string that was forward referenced and already assigned
     if (IsImageOffsetAssigned(obj)) {
       DCHECK_EQ(obj, obj->AsString()->Intern());
@@ -437,6 +669,47 @@ ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
   return image_roots.Get();
 }
 
+ObjectArray<Object>* ImageWriter::CreateAppImageRoots() const {
+  Runtime* runtime = Runtime::Current();
+  ClassLinker* class_linker = runtime->GetClassLinker();
+  Thread* self = Thread::Current();
+  StackHandleScope<4> hs(self);
+  Handle<Class> object_array_class(hs.NewHandle(
+      class_linker->FindSystemClass(self, "[Ljava/lang/Object;")));
+
+  Handle<ObjectArray<Object>> dex_caches(
+      hs.NewHandle(ObjectArray<Object>::Alloc(self, object_array_class.Get(),
+                                              app_dex_caches_.size())));
+  for (size_t i = 0; i < app_dex_caches_.size(); ++i) {
+    dex_caches->Set<false>(i, app_dex_caches_[i]);
+  }
+  Handle<ObjectArray<Object>> classes(
+      hs.NewHandle(ObjectArray<Object>::Alloc(self, object_array_class.Get(),
+                                              app_image_class_list_.size())));
+  for (size_t i = 0; i < app_image_class_list_.size(); ++i) {
+    classes->Set<false>(i, app_image_class_list_[i]);
+  }
+
+  // The runtime methods are the ones of the boot image.
+  Handle<ObjectArray<Object>> image_roots(hs.NewHandle(
+      ObjectArray<Object>::Alloc(self, object_array_class.Get(), ImageHeader::kImageRootsMax)));
+  image_roots->Set<false>(ImageHeader::kResolutionMethod, runtime->GetResolutionMethod());
+  image_roots->Set<false>(ImageHeader::kImtConflictMethod, runtime->GetImtConflictMethod());
+  image_roots->Set<false>(ImageHeader::kDefaultImt, runtime->GetDefaultImt());
+  image_roots->Set<false>(ImageHeader::kCalleeSaveMethod,
+                          runtime->GetCalleeSaveMethod(Runtime::kSaveAll));
+  image_roots->Set<false>(ImageHeader::kRefsOnlySaveMethod,
+                          runtime->GetCalleeSaveMethod(Runtime::kRefsOnly));
+  image_roots->Set<false>(ImageHeader::kRefsAndArgsSaveMethod,
+                          runtime->GetCalleeSaveMethod(Runtime::kRefsAndArgs));
+  image_roots->Set<false>(ImageHeader::kDexCaches, dex_caches.Get());
+  image_roots->Set<false>(ImageHeader::kClassRoots, classes.Get());
+  for (int i = 0; i < ImageHeader::kImageRootsMax; i++) {
+    CHECK(image_roots->Get(i) != NULL);
+  }
+  return image_roots.Get();
+}
+
 // Walk instance fields of the given Class. Separate function to allow recursion on the super
 // class.
 void ImageWriter::WalkInstanceFields(mirror::Object* obj, mirror::Class* klass) {
@@ -461,6 +734,10 @@ void ImageWriter::WalkInstanceFields(mirror::Object* obj, mirror::Class* klass)
 
 // For an unvisited object, visit it then all its children found via fields.
 void ImageWriter::WalkFieldsInOrder(mirror::Object* obj) {
+  if (IsAppImage() && (boot_image_space_->Contains(obj) || obj == class_loader_)) {
+    // Not written to the app image, see GetImageAddress.
+    return;
+  }
   if (!IsImageOffsetAssigned(obj)) {
     // Walk instance fields of all objects
     StackHandleScope<2> hs(Thread::Current());
@@ -469,8 +746,11 @@ void ImageWriter::WalkFieldsInOrder(mirror::Object* obj) {
     // visit the object itself.
     CalculateObjectOffsets(h_obj.Get());
     WalkInstanceFields(h_obj.Get(), klass.Get());
-    // Walk static fields of a Class.
-    if (h_obj->IsClass()) {
+    // Walk static fields of a Class. The static fields of the classes of an app image are set by
+    // their initialization in the app.
+    if (h_obj->IsClass() && IsAppImage()) {
+      CHECK(IsAppImageClass(h_obj->AsClass())) << PrettyClass(h_obj->AsClass());
+    } else if (h_obj->IsClass()) {
       size_t num_static_fields = klass->NumReferenceStaticFields();
       for (size_t i = 0; i < num_static_fields; ++i) {
         mirror::ArtField* field = klass->GetStaticField(i);
@@ -504,7 +784,8 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
   CHECK_NE(0U, oat_loaded_size);
   Thread* self = Thread::Current();
   StackHandleScope<1> hs(self);
-  Handle<ObjectArray<Object>> image_roots(hs.NewHandle(CreateImageRoots()));
+  Handle<ObjectArray<Object>> image_roots(
+      hs.NewHandle(IsAppImage() ? CreateAppImageRoots() : CreateImageRoots()));
 
   gc::Heap* heap = Runtime::Current()->GetHeap();
   DCHECK_EQ(0U, image_end_);
@@ -519,7 +800,12 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
     const char* old = self->StartAssertNoThreadSuspension("ImageWriter");
     DCHECK_LT(image_end_, image_->Size());
     // Clear any pre-existing monitors which may have been in the monitor words.
-    heap->VisitObjects(WalkFieldsCallback, this);
+    if (IsAppImage()) {
+      // Only the objects of the app classes are written, not the rest of the compiler's heap.
+      WalkFieldsInOrder(image_roots.Get());
+    } else {
+      heap->VisitObjects(WalkFieldsCallback, this);
+    }
     self->EndAssertNoThreadSuspension(old);
   }
 
@@ -537,8 +823,10 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
                            static_cast<uint32_t>(image_end_),
                            RoundUp(image_end_, kPageSize),
                            RoundUp(bitmap_bytes, kPageSize),
+                           RoundUp(image_end_, kPageSize) + RoundUp(bitmap_bytes, kPageSize),
                            PointerToLowMemUInt32(GetImageAddress(image_roots.Get())),
                            oat_file_->GetOatHeader().GetChecksum(),
+                           IsAppImage() ? boot_image_space_->GetImageHeader().GetOatChecksum() : 0u,
                            PointerToLowMemUInt32(oat_file_begin),
                            PointerToLowMemUInt32(oat_data_begin_),
                            PointerToLowMemUInt32(oat_data_end),
@@ -548,7 +836,55 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
   // Note that image_end_ is left at end of used space
 }
 
-void ImageWriter::CopyAndFixupObjects()
+// Copies and fixes up a chunk of the objects of the heap.
+class CopyAndFixupObjectsTask : public Task {
+ public:
+  CopyAndFixupObjectsTask(ImageWriter* image_writer, Object* const* begin, Object* const* end)
+      : image_writer_(image_writer), begin_(begin), end_(end) {
+  }
+
+  // The thread that created the task holds the mutator lock and the heap bitmap lock for the
+  // duration of the copy. The objects are only read and each task writes its own copies.
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    for (Object* const* it = begin_; it != end_; ++it) {
+      ImageWriter::CopyAndFixupObjectsCallback(*it, image_writer_);
+    }
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  ImageWriter* const image_writer_;
+  Object* const* const begin_;
+  Object* const* const end_;
+};
+
+void ImageWriter::CollectObjectsCallback(Object* obj, void* arg) {
+  reinterpret_cast<std::vector<Object*>*>(arg)->push_back(obj);
+}
+
+// Collects the objects of the heap which are written to an app image.
+class CollectAppImageObjectsVisitor {
+ public:
+  CollectAppImageObjectsVisitor(ImageWriter* image_writer, std::vector<Object*>* objects)
+      : image_writer_(image_writer), objects_(objects) {
+  }
+
+  static void Callback(Object* obj, void* arg) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    CollectAppImageObjectsVisitor* visitor = reinterpret_cast<CollectAppImageObjectsVisitor*>(arg);
+    if (visitor->image_writer_->IsImageOffsetAssigned(obj)) {
+      visitor->objects_->push_back(obj);
+    }
+  }
+
+ private:
+  ImageWriter* const image_writer_;
+  std::vector<Object*>* const objects_;
+};
+
+void ImageWriter::CopyAndFixupObjects(ThreadPool* thread_pool)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   Thread* self = Thread::Current();
   const char* old_cause = self->StartAssertNoThreadSuspension("ImageWriter");
@@ -557,7 +893,29 @@ void ImageWriter::CopyAndFixupObjects()
   heap->DisableObjectValidation();
   // TODO: Image spaces only?
   WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
-  heap->VisitObjects(CopyAndFixupObjectsCallback, this);
+  if (IsAppImage()) {
+    std::vector<Object*> objects;
+    CollectAppImageObjectsVisitor visitor(this, &objects);
+    heap->VisitObjects(CollectAppImageObjectsVisitor::Callback, &visitor);
+    for (Object* obj : objects) {
+      CopyAndFixupObjectsCallback(obj, this);
+    }
+  } else if (thread_pool == nullptr) {
+    heap->VisitObjects(CopyAndFixupObjectsCallback, this);
+  } else {
+    std::vector<Object*> objects;
+    heap->VisitObjects(CollectObjectsCallback, &objects);
+    // Enough chunks per thread to balance the objects of different sizes.
+    static constexpr size_t kObjectsPerTask = 1024;
+    for (size_t i = 0; i < objects.size(); i += kObjectsPerTask) {
+      size_t end = std::min(i + kObjectsPerTask, objects.size());
+      thread_pool->AddTask(self, new CopyAndFixupObjectsTask(this, objects.data() + i,
+                                                             objects.data() + end));
+    }
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+  }
   // Fix up the object previously had hash codes.
   for (const std::pair<mirror::Object*, uint32_t>& hash_pair : saved_hashes_) {
     hash_pair.first->SetLockWord(LockWord::FromHashCode(hash_pair.second), false);
@@ -589,21 +947,32 @@ class FixupVisitor {
   FixupVisitor(ImageWriter* image_writer, Object* copy) : image_writer_(image_writer), copy_(copy) {
   }
 
-  void operator()(Object* obj, MemberOffset offset, bool /*is_static*/) const
+  void operator()(Object* obj, MemberOffset offset, bool is_static) const
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_) {
+    if (is_static && image_writer_->IsAppImage()) {
+      // Cleared with the other static fields, see ImageWriter::FixupClass.
+      return;
+    }
     Object* ref = obj->GetFieldObject<Object, kVerifyNone>(offset);
     // Use SetFieldObjectWithoutWriteBarrier to avoid card marking since we are writing to the
     // image.
     copy_->SetFieldObjectWithoutWriteBarrier<false, true, kVerifyNone>(
         offset, image_writer_->GetImageAddress(ref));
+    if (ref != nullptr) {
+      image_writer_->MarkRelocation(copy_, offset);
+    }
   }
 
   // java.lang.ref.Reference visitor.
   void operator()(mirror::Class* /*klass*/, mirror::Reference* ref) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_) {
+    mirror::Object* referent = ref->GetReferent();
     copy_->SetFieldObjectWithoutWriteBarrier<false, true, kVerifyNone>(
-        mirror::Reference::ReferentOffset(), image_writer_->GetImageAddress(ref->GetReferent()));
+        mirror::Reference::ReferentOffset(), image_writer_->GetImageAddress(referent));
+    if (referent != nullptr) {
+      image_writer_->MarkRelocation(copy_, mirror::Reference::ReferentOffset());
+    }
   }
 
  private:
@@ -618,83 +987,135 @@ void ImageWriter::FixupObject(Object* orig, Object* copy) {
     orig->AssertReadBarrierPointer();
     if (kUseBrooksReadBarrier) {
       // Note the address 'copy' isn't the same as the image address of 'orig'.
+      // TODO: Record the Brooks pointer in the relocations.
       copy->SetReadBarrierPointer(GetImageAddress(orig));
       DCHECK_EQ(copy->GetReadBarrierPointer(), GetImageAddress(orig));
     }
   }
   FixupVisitor visitor(this, copy);
   orig->VisitReferences<true /*visit class*/>(visitor, visitor);
+  if (IsAppImage() && orig->IsClass<kVerifyNone>()) {
+    FixupClass(orig->AsClass<kVerifyNone>(), down_cast<Class*>(copy));
+  }
   if (orig->IsArtMethod<kVerifyNone>()) {
     FixupMethod(orig->AsArtMethod<kVerifyNone>(), down_cast<ArtMethod*>(copy));
   }
 }
 
+void ImageWriter::FixupClass(Class* orig, Class* copy) {
+  // The app initializes its classes again, as the values of their static fields may depend on
+  // the device. The methods of initialized classes are linked to the code they had in the image.
+  if (orig->GetStatus() >= Class::kStatusInitializing) {
+    copy->SetField32<false, false, kVerifyNone>(Class::StatusOffset(), Class::kStatusVerified);
+  }
+  for (size_t i = 0; i < orig->NumStaticFields(); ++i) {
+    ArtField* field = orig->GetStaticField(i);
+    size_t size = Primitive::ComponentSize(FieldHelper(field).GetTypeAsPrimitiveType());
+    memset(reinterpret_cast<byte*>(copy) + field->GetOffset().Uint32Value(), 0, size);
+  }
+}
+
+void ImageWriter::MarkRelocation(Object* copy, MemberOffset offset) {
+  if (IsAppImage()) {
+    // App images aren't relocated, they are only used at the address they were written for.
+    return;
+  }
+  // The tasks of CopyAndFixupObjects share the bitmap words at the boundaries of their objects.
+  relocation_bitmap_->AtomicTestAndSet(reinterpret_cast<Object*>(
+      reinterpret_cast<byte*>(copy) + offset.Uint32Value()));
+}
+
 void ImageWriter::FixupMethod(ArtMethod* orig, ArtMethod* copy) {
+  FixupMethodEntryPoints(orig, copy);
+  // All the native pointers of the method point into the oat file, which moves with the image.
+  const MemberOffset pointer_offsets[] = {
+      ArtMethod::EntryPointFromPortableCompiledCodeOffset(),
+      ArtMethod::EntryPointFromQuickCompiledCodeOffset(),
+      ArtMethod::EntryPointFromInterpreterOffset(),
+      ArtMethod::NativeMethodOffset(),
+      ArtMethod::NativeGcMapOffset(),
+  };
+  for (MemberOffset offset : pointer_offsets) {
+    if (copy->GetField64<kVerifyNone>(offset) != 0) {
+      MarkRelocation(copy, offset);
+    }
+  }
+}
+
+void ImageWriter::FixupMethodEntryPoints(ArtMethod* orig, ArtMethod* copy) {
   // OatWriter replaces the code_ with an offset value. Here we re-adjust to a pointer relative to
   // oat_begin_
 
   // The resolution method has a special trampoline to call.
   if (UNLIKELY(orig == Runtime::Current()->GetResolutionMethod())) {
-    copy->SetEntryPointFromPortableCompiledCode<kVerifyNone>(GetOatAddress(portable_resolution_trampoline_offset_));
-    copy->SetEntryPointFromQuickCompiledCode<kVerifyNone>(GetOatAddress(quick_resolution_trampoline_offset_));
+    copy->SetEntryPointFromPortableCompiledCode<kVerifyNone>(
+        GetTrampolineAddress(portable_resolution_trampoline_offset_));
+    copy->SetEntryPointFromQuickCompiledCode<kVerifyNone>(
+        GetTrampolineAddress(quick_resolution_trampoline_offset_));
   } else if (UNLIKELY(orig == Runtime::Current()->GetImtConflictMethod())) {
-    copy->SetEntryPointFromPortableCompiledCode<kVerifyNone>(GetOatAddress(portable_imt_conflict_trampoline_offset_));
-    copy->SetEntryPointFromQuickCompiledCode<kVerifyNone>(GetOatAddress(quick_imt_conflict_trampoline_offset_));
+    copy->SetEntryPointFromPortableCompiledCode<kVerifyNone>(
+        GetTrampolineAddress(portable_imt_conflict_trampoline_offset_));
+    copy->SetEntryPointFromQuickCompiledCode<kVerifyNone>(
+        GetTrampolineAddress(quick_imt_conflict_trampoline_offset_));
   } else {
     // We assume all methods have code. If they don't currently then we set them to the use the
     // resolution trampoline. Abstract methods never have code and so we need to make sure their
     // use results in an AbstractMethodError. We use the interpreter to achieve this.
     if (UNLIKELY(orig->IsAbstract())) {
-      copy->SetEntryPointFromPortableCompiledCode<kVerifyNone>(GetOatAddress(portable_to_interpreter_bridge_offset_));
-      copy->SetEntryPointFromQuickCompiledCode<kVerifyNone>(GetOatAddress(quick_to_interpreter_bridge_offset_));
+      copy->SetEntryPointFromPortableCompiledCode<kVerifyNone>(
+          GetTrampolineAddress(portable_to_interpreter_bridge_offset_));
+      copy->SetEntryPointFromQuickCompiledCode<kVerifyNone>(
+          GetTrampolineAddress(quick_to_interpreter_bridge_offset_));
       copy->SetEntryPointFromInterpreter<kVerifyNone>(reinterpret_cast<EntryPointFromInterpreter*>
-          (const_cast<byte*>(GetOatAddress(interpreter_to_interpreter_bridge_offset_))));
+          (const_cast<byte*>(GetTrampolineAddress(interpreter_to_interpreter_bridge_offset_))));
     } else {
       // Use original code if it exists. Otherwise, set the code pointer to the resolution
       // trampoline.
 
       // Quick entrypoint:
-      const byte* quick_code = GetOatAddress(orig->GetQuickOatCodeOffset());
+      const byte* quick_code = GetOatAddress(GetQuickOatCodeOffset(orig));
       bool quick_is_interpreted = false;
       if (quick_code != nullptr &&
-          (!orig->IsStatic() || orig->IsConstructor() || orig->GetDeclaringClass()->IsInitialized())) {
+          (!orig->IsStatic() || orig->IsConstructor() ||
+           IsInitializedInImage(orig->GetDeclaringClass()))) {
         // We have code for a non-static or initialized method, just use the code.
       } else if (quick_code == nullptr && orig->IsNative() &&
-          (!orig->IsStatic() || orig->GetDeclaringClass()->IsInitialized())) {
+          (!orig->IsStatic() || IsInitializedInImage(orig->GetDeclaringClass()))) {
         // Non-static or initialized native method missing compiled code, use generic JNI version.
-        quick_code = GetOatAddress(quick_generic_jni_trampoline_offset_);
+        quick_code = GetTrampolineAddress(quick_generic_jni_trampoline_offset_);
       } else if (quick_code == nullptr && !orig->IsNative()) {
         // We don't have code at all for a non-native method, use the interpreter.
-        quick_code = GetOatAddress(quick_to_interpreter_bridge_offset_);
+        quick_code = GetTrampolineAddress(quick_to_interpreter_bridge_offset_);
         quick_is_interpreted = true;
       } else {
-        CHECK(!orig->GetDeclaringClass()->IsInitialized());
+        CHECK(!IsInitializedInImage(orig->GetDeclaringClass()));
         // We have code for a static method, but need to go through the resolution stub for class
         // initialization.
-        quick_code = GetOatAddress(quick_resolution_trampoline_offset_);
+        quick_code = GetTrampolineAddress(quick_resolution_trampoline_offset_);
       }
       copy->SetEntryPointFromQuickCompiledCode<kVerifyNone>(quick_code);
 
       // Portable entrypoint:
-      const byte* portable_code = GetOatAddress(orig->GetPortableOatCodeOffset());
+      const byte* portable_code = GetOatAddress(GetPortableOatCodeOffset(orig));
       bool portable_is_interpreted = false;
       if (portable_code != nullptr &&
-          (!orig->IsStatic() || orig->IsConstructor() || orig->GetDeclaringClass()->IsInitialized())) {
+          (!orig->IsStatic() || orig->IsConstructor() ||
+           IsInitializedInImage(orig->GetDeclaringClass()))) {
         // We have code for a non-static or initialized method, just use the code.
       } else if (portable_code == nullptr && orig->IsNative() &&
-          (!orig->IsStatic() || orig->GetDeclaringClass()->IsInitialized())) {
+          (!orig->IsStatic() || IsInitializedInImage(orig->GetDeclaringClass()))) {
         // Non-static or initialized native method missing compiled code, use generic JNI version.
         // TODO: generic JNI support for LLVM.
-        portable_code = GetOatAddress(portable_resolution_trampoline_offset_);
+        portable_code = GetTrampolineAddress(portable_resolution_trampoline_offset_);
       } else if (portable_code == nullptr && !orig->IsNative()) {
         // We don't have code at all for a non-native method, use the interpreter.
-        portable_code = GetOatAddress(portable_to_interpreter_bridge_offset_);
+        portable_code = GetTrampolineAddress(portable_to_interpreter_bridge_offset_);
         portable_is_interpreted = true;
       } else {
-        CHECK(!orig->GetDeclaringClass()->IsInitialized());
+        CHECK(!IsInitializedInImage(orig->GetDeclaringClass()));
         // We have code for a static method, but need to go through the resolution stub for class
         // initialization.
-        portable_code = GetOatAddress(portable_resolution_trampoline_offset_);
+        portable_code = GetTrampolineAddress(portable_resolution_trampoline_offset_);
       }
       copy->SetEntryPointFromPortableCompiledCode<kVerifyNone>(portable_code);
 
@@ -702,10 +1123,10 @@ void ImageWriter::FixupMethod(ArtMethod* orig, ArtMethod* copy) {
       if (orig->IsNative()) {
         // The native method's pointer is set to a stub to lookup via dlsym.
         // Note this is not the code_ pointer, that is handled above.
-        copy->SetNativeMethod<kVerifyNone>(GetOatAddress(jni_dlsym_lookup_offset_));
+        copy->SetNativeMethod<kVerifyNone>(GetTrampolineAddress(jni_dlsym_lookup_offset_));
       } else {
         // Normal (non-abstract non-native) methods have various tables to relocate.
-        uint32_t native_gc_map_offset = orig->GetOatNativeGcMapOffset();
+        uint32_t native_gc_map_offset = GetOatNativeGcMapOffset(orig);
         const byte* native_gc_map = GetOatAddress(native_gc_map_offset);
         copy->SetNativeGcMap<kVerifyNone>(reinterpret_cast<const uint8_t*>(native_gc_map));
       }
@@ -717,7 +1138,7 @@ void ImageWriter::FixupMethod(ArtMethod* orig, ArtMethod* copy) {
           : interpreter_to_compiled_code_bridge_offset_;
       copy->SetEntryPointFromInterpreter<kVerifyNone>(
           reinterpret_cast<EntryPointFromInterpreter*>(
-              const_cast<byte*>(GetOatAddress(interpreter_code))));
+              const_cast<byte*>(GetTrampolineAddress(interpreter_code))));
     }
   }
 }
@@ -864,6 +1285,11 @@ void ImageWriter::SetPatchLocation(const CompilerDriver::PatchInformation* patch
   }
   *patch_location = value;
   oat_header.UpdateChecksum(patch_location, sizeof(value));
+  // Addresses relative to the patch location don't change when the oat file moves.
+  if (!patch->IsCall() || !patch->AsCall()->IsRelative()) {
+    oat_relocations_.push_back(reinterpret_cast<uint8_t*>(patch_location) -
+                               reinterpret_cast<uint8_t*>(&oat_header));
+  }
 }
 
 }  // namespace art
@@ -23,27 +23,48 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "driver/compiler_driver.h"
 #include "mem_map.h"
 #include "oat_file.h"
+#include "mirror/class_loader.h"
 #include "mirror/dex_cache.h"
 #include "os.h"
 #include "safe_map.h"
+#include "gc/space/image_space.h"
 #include "gc/space/space.h"
 
 namespace art {
 
+class ThreadPool;
+
 // Write a Space built during compilation for use during execution.
 class ImageWriter {
  public:
   explicit ImageWriter(const CompilerDriver& compiler_driver)
       : compiler_driver_(compiler_driver), oat_file_(NULL), image_end_(0), image_begin_(NULL),
-        oat_data_begin_(NULL), interpreter_to_interpreter_bridge_offset_(0),
+        oat_data_begin_(NULL), app_class_loader_(nullptr), class_loader_(nullptr),
+        boot_image_space_(nullptr), boot_oat_data_begin_(nullptr),
+        interpreter_to_interpreter_bridge_offset_(0),
         interpreter_to_compiled_code_bridge_offset_(0), portable_imt_conflict_trampoline_offset_(0),
         portable_resolution_trampoline_offset_(0), quick_generic_jni_trampoline_offset_(0),
         quick_imt_conflict_trampoline_offset_(0), quick_resolution_trampoline_offset_(0) {}
 
+  // Writes an app image of the classes of dex_files defined by class_loader, which references
+  // the boot image of the runtime by address and is only used at image_begin.
+  ImageWriter(const CompilerDriver& compiler_driver, jobject class_loader,
+              const std::vector<const DexFile*>& dex_files)
+      : compiler_driver_(compiler_driver), oat_file_(NULL), image_end_(0), image_begin_(NULL),
+        oat_data_begin_(NULL), app_class_loader_(class_loader), app_dex_files_(dex_files),
+        class_loader_(nullptr), boot_image_space_(nullptr), boot_oat_data_begin_(nullptr),
+        interpreter_to_interpreter_bridge_offset_(0),
+        interpreter_to_compiled_code_bridge_offset_(0), portable_imt_conflict_trampoline_offset_(0),
+        portable_resolution_trampoline_offset_(0), quick_generic_jni_trampoline_offset_(0),
+        quick_imt_conflict_trampoline_offset_(0), quick_resolution_trampoline_offset_(0) {
+    CHECK(class_loader != nullptr);
+  }
+
   ~ImageWriter() {}
 
   bool Write(const std::string& image_filename,
@@ -59,6 +80,10 @@ class ImageWriter {
  private:
   bool AllocMemory();
 
+  bool IsAppImage() const {
+    return app_class_loader_ != nullptr;
+  }
+
   // Mark the objects defined in this space in the given live bitmap.
   void RecordImageAllocations() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -75,6 +100,16 @@ class ImageWriter {
     if (object == NULL) {
       return NULL;
     }
+    if (IsAppImage()) {
+      // The boot image is at the same address when the app image is used. The class loader is
+      // set again when the classes are defined.
+      if (boot_image_space_->Contains(object)) {
+        return object;
+      }
+      if (object == class_loader_) {
+        return NULL;
+      }
+    }
     return reinterpret_cast<mirror::Object*>(image_begin_ + GetImageOffset(object));
   }
 
@@ -98,9 +133,34 @@ class ImageWriter {
     return oat_data_begin_ + offset;
   }
 
+  // The stubs of an app image are the ones of the boot oat file.
+  const byte* GetTrampolineAddress(uint32_t offset) const {
+    return IsAppImage() ? boot_oat_data_begin_ + offset : GetOatAddress(offset);
+  }
+
+  // Offsets in the oat file of the code and GC map of a method, OatWriter stores them in the
+  // methods of a boot image.
+  uint32_t GetQuickOatCodeOffset(mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  uint32_t GetPortableOatCodeOffset(mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  uint32_t GetOatNativeGcMapOffset(mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Whether the class is initialized when the image is loaded. The classes of an app image are
+  // initialized again by the app.
+  bool IsInitializedInImage(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Returns true if the class was in the original requested image classes list.
   bool IsImageClass(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Returns true if the class can be written to the app image: a resolved class of the app dex
+  // files whose super classes and interfaces are in the boot image or the app image.
+  bool IsAppImageClass(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  bool ComputeIsAppImageClass(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  bool IsReferenceableFromAppImage(mirror::Class* klass)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Debug aid that list of requested image classes.
   void DumpImageClasses();
 
@@ -115,11 +175,22 @@ class ImageWriter {
   static void ComputeEagerResolvedStringsCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Lets equal strings, and strings that are a prefix of another, share one char array so that
+  // the duplicates drop out of the image.
+  void ProcessStrings() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static void CollectStringsCallback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Remove unwanted classes from various roots.
   void PruneNonImageClasses() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static bool NonImageClassesVisitor(mirror::Class* c, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Clears the entries of the app dex caches the app image can't hold.
+  void PruneAppDexCaches() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static bool AppImageClassesVisitor(mirror::Class* c, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Verify unwanted classes removed.
   void CheckNonImageClassesRemoved();
   static void CheckNonImageClassesRemovedCallback(mirror::Object* obj, void* arg)
@@ -130,6 +201,8 @@ class ImageWriter {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   mirror::ObjectArray<mirror::Object>* CreateImageRoots() const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  mirror::ObjectArray<mirror::Object>* CreateAppImageRoots() const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void CalculateObjectOffsets(mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -140,15 +213,27 @@ class ImageWriter {
   static void WalkFieldsCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  // Creates the contiguous image in memory and adjusts pointers.
-  void CopyAndFixupObjects();
+  // Creates the contiguous image in memory and adjusts pointers. The objects are split in chunks
+  // copied by the threads of `thread_pool` and the calling thread, each object is copied to the
+  // offset assigned to it so the image doesn't depend on the order of the copies.
+  void CopyAndFixupObjects(ThreadPool* thread_pool);
+  static void CollectObjectsCallback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static void CopyAndFixupObjectsCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void FixupClass(mirror::Class* orig, mirror::Class* copy)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void FixupMethod(mirror::ArtMethod* orig, mirror::ArtMethod* copy)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void FixupMethodEntryPoints(mirror::ArtMethod* orig, mirror::ArtMethod* copy)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void FixupObject(mirror::Object* orig, mirror::Object* copy)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Records that the 32-bit word at offset in the copy of an object, or the low word of a 64-bit
+  // pointer field there, holds an absolute address to adjust when the image is relocated.
+  void MarkRelocation(mirror::Object* copy, MemberOffset offset);
+
   // Patches references in OatFile to expect runtime addresses.
   void PatchOatCodeAndMethods()
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -178,6 +263,26 @@ class ImageWriter {
   // Image bitmap which lets us know where the objects inside of the image reside.
   std::unique_ptr<gc::accounting::ContinuousSpaceBitmap> image_bitmap_;
 
+  // Words of the image holding absolute addresses, written to the relocation section.
+  std::unique_ptr<gc::accounting::RelocationBitmap> relocation_bitmap_;
+
+  // Offsets from the oat header of the absolute addresses patched into the oat code.
+  std::vector<uint32_t> oat_relocations_;
+
+  // The class loader and dex files of an app image, app_class_loader_ is null for a boot image.
+  jobject app_class_loader_;
+  std::vector<const DexFile*> app_dex_files_;
+  mirror::ClassLoader* class_loader_;
+  std::vector<mirror::DexCache*> app_dex_caches_;
+  gc::space::ImageSpace* boot_image_space_;
+  const byte* boot_oat_data_begin_;
+
+  // Memoized results of IsAppImageClass.
+  SafeMap<mirror::Class*, bool> app_image_classes_;
+
+  // Classes written to the app image.
+  std::vector<mirror::Class*> app_image_class_list_;
+
   // Offset from oat_data_begin_ to the stubs.
   uint32_t interpreter_to_interpreter_bridge_offset_;
   uint32_t interpreter_to_compiled_code_bridge_offset_;
@@ -190,6 +295,8 @@ class ImageWriter {
   uint32_t quick_resolution_trampoline_offset_;
   uint32_t quick_to_interpreter_bridge_offset_;
 
+  friend class CollectAppImageObjectsVisitor;
+  friend class CopyAndFixupObjectsTask;
   friend class FixupVisitor;
   DISALLOW_COPY_AND_ASSIGN(ImageWriter);
 };
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jit_compiler.h"
+
+#include <algorithm>
+
+#include "gc/heap.h"
+#include "handle_scope-inl.h"
+#include "jit/jit.h"
+#include "jit/jit_code_cache.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/dex_cache.h"
+#include "oat.h"
+#include "object_utils.h"
+#include "perf_map.h"
+#include "scoped_thread_state_change.h"
+#include "ScopedLocalRef.h"
+#include "verifier/method_verifier.h"
+
+namespace art {
+namespace jit {
+
+JitCompiler* JitCompiler::Create() {
+  return new JitCompiler();
+}
+
+extern "C" void* jit_load() {
+  VLOG(compiler) << "JIT compiler loaded";
+  return JitCompiler::Create();
+}
+
+extern "C" void jit_unload(void* handle) {
+  DCHECK(handle != nullptr);
+  delete reinterpret_cast<JitCompiler*>(handle);
+}
+
+extern "C" bool jit_compile_method(void* handle, mirror::ArtMethod* method, Thread* self)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  DCHECK(handle != nullptr);
+  return reinterpret_cast<JitCompiler*>(handle)->CompileMethod(self, method);
+}
+
+JitCompiler::JitCompiler()
+    // The runtime reports arm, the Quick backend generates thumb2 for it like dex2oat does.
+    : instruction_set_(kRuntimeISA == kArm ? kThumb2 : kRuntimeISA),
+      compiler_options_(new CompilerOptions),
+      verification_results_(new VerificationResults(compiler_options_.get())),
+      method_inliner_map_(new DexFileToMethodInlinerMap),
+      cumulative_logger_(new CumulativeLogger("JIT compilation times")) {
+  // The code only runs in this runtime, allocate inline if it allocates from TLABs.
+  compiler_options_->SetInlineTlabAllocation(Runtime::Current()->GetHeap()->UsesTlab());
+  // The features found at runtime, rather than the ones the runtime was built for.
+  InstructionSetFeatures instruction_set_features =
+      InstructionSetFeatures::GuessInstructionSetFeatures();
+  compiler_driver_.reset(new CompilerDriver(compiler_options_.get(), verification_results_.get(),
+                                            method_inliner_map_.get(), Compiler::kQuick,
+                                            instruction_set_, instruction_set_features,
+                                            false, nullptr, 1, false, false,
+                                            cumulative_logger_.get()));
+  // There is no oat file to patch, the direct calls use the runtime addresses.
+  compiler_driver_->SetSupportBootImageFixup(false);
+}
+
+JitCompiler::~JitCompiler() {
+}
+
+bool JitCompiler::VerifyMethod(Thread* self, mirror::ArtMethod* method) {
+  StackHandleScope<2> hs(self);
+  mirror::Class* klass = method->GetDeclaringClass();
+  Handle<mirror::DexCache> dex_cache(hs.NewHandle(klass->GetDexCache()));
+  Handle<mirror::ClassLoader> class_loader(hs.NewHandle(klass->GetClassLoader()));
+  MethodHelper mh(method);
+  verifier::MethodVerifier verifier(&mh.GetDexFile(), &dex_cache, &class_loader,
+                                    &mh.GetClassDef(), mh.GetCodeItem(),
+                                    method->GetDexMethodIndex(), method,
+                                    method->GetAccessFlags(), true, true, false);
+  // Methods with soft failures keep running from the interpreter with their access checks.
+  if (!verifier.Verify() || verifier.HasFailures()) {
+    VLOG(compiler) << "JIT not compiling " << PrettyMethod(method) << ", verification failed";
+    return false;
+  }
+  return verification_results_->ProcessVerifiedMethod(&verifier);
+}
+
+bool JitCompiler::CompileMethod(Thread* self, mirror::ArtMethod* method) {
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ArtMethod> h_method(hs.NewHandle(method));
+  MethodHelper mh(method);
+  const DexFile* dex_file = &mh.GetDexFile();
+  const uint16_t class_def_idx = mh.GetClassDefIndex();
+  const DexFile::CodeItem* code_item = mh.GetCodeItem();
+  const uint32_t method_idx = method->GetDexMethodIndex();
+  const uint32_t access_flags = method->GetAccessFlags();
+  const InvokeType invoke_type = method->GetInvokeType();
+  const MethodReference ref(dex_file, method_idx);
+  if (code_item == nullptr || !VerifyMethod(self, method)) {
+    return false;
+  }
+  // The verifier may have loaded classes and suspended.
+  method = h_method.Get();
+  jobject jclass_loader;
+  {
+    ScopedObjectAccessUnchecked soa(self);
+    ScopedLocalRef<jobject>
+        local_class_loader(soa.Env(),
+                           soa.AddLocalReference<jobject>(
+                               method->GetDeclaringClass()->GetClassLoader()));
+    jclass_loader = soa.Env()->NewGlobalRef(local_class_loader.get());
+  }
+  // The backend uses the class loader through JNI and may suspend.
+  self->TransitionFromRunnableToSuspended(kNative);
+  compiler_driver_->CompileJitMethod(code_item, access_flags, invoke_type, class_def_idx,
+                                     method_idx, jclass_loader, *dex_file);
+  self->TransitionFromSuspendedToRunnable();
+  self->GetJniEnv()->DeleteGlobalRef(jclass_loader);
+  const CompiledMethod* compiled_method = compiler_driver_->GetCompiledMethod(ref);
+  if (compiled_method == nullptr) {
+    VLOG(compiler) << "JIT not compiling " << PrettyMethod(h_method.Get())
+                   << ", rejected by the backend";
+    return false;
+  }
+  return AddToCodeCache(self, h_method.Get(), compiled_method);
+}
+
+bool JitCompiler::AddToCodeCache(Thread* self, mirror::ArtMethod* method,
+                                 const CompiledMethod* compiled_method) {
+  const std::vector<uint8_t>* quick_code = compiled_method->GetQuickCode();
+  if (quick_code == nullptr) {
+    return false;
+  }
+  JitCodeCache* code_cache = Runtime::Current()->GetJit()->GetCodeCache();
+  const std::vector<uint8_t>& gc_map = compiled_method->GetGcMap();
+  const std::vector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
+  const std::vector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
+  const uint32_t code_size = quick_code->size();
+  // Same layout as in the oat file, the tables are found backwards from the code.
+  const uint32_t vmap_table_offset = vmap_table.empty() ? 0u
+      : sizeof(OatQuickMethodHeader) + vmap_table.size();
+  const uint32_t mapping_table_offset = mapping_table.empty() ? 0u
+      : sizeof(OatQuickMethodHeader) + vmap_table.size() + mapping_table.size();
+  OatQuickMethodHeader method_header(mapping_table_offset, vmap_table_offset,
+                                     compiled_method->GetFrameSizeInBytes(),
+                                     compiled_method->GetCoreSpillMask(),
+                                     compiled_method->GetFpSpillMask(), code_size,
+                                     compiled_method->HasStackMaps());
+  const size_t data_size =
+      gc_map.size() + mapping_table.size() + vmap_table.size() + sizeof(method_header);
+  const size_t code_offset = compiled_method->AlignCode(data_size);
+  uint8_t* chunk = code_cache->ReserveChunk(self, code_offset + code_size,
+                                            GetInstructionSetAlignment(instruction_set_));
+  if (chunk == nullptr) {
+    VLOG(compiler) << "JIT code cache full, not compiling " << PrettyMethod(method);
+    return false;
+  }
+  uint8_t* code = chunk + code_offset;
+  uint8_t* header = code - sizeof(method_header);
+  uint8_t* vmap = header - vmap_table.size();
+  uint8_t* mapping = vmap - mapping_table.size();
+  uint8_t* native_gc_map = mapping - gc_map.size();
+  std::copy(quick_code->begin(), quick_code->end(), code);
+  memcpy(header, &method_header, sizeof(method_header));
+  std::copy(vmap_table.begin(), vmap_table.end(), vmap);
+  std::copy(mapping_table.begin(), mapping_table.end(), mapping);
+  std::copy(gc_map.begin(), gc_map.end(), native_gc_map);
+  __builtin___clear_cache(reinterpret_cast<char*>(chunk),
+                          reinterpret_cast<char*>(code + code_size));
+  // The GC needs the map as soon as frames of the code exist, set it before the entry point.
+  method->SetNativeGcMap(gc_map.empty() ? nullptr : native_gc_map);
+  MethodHelper mh(method);
+  MethodReference ref(&mh.GetDexFile(), method->GetDexMethodIndex());
+  code_cache->SaveCompiledCode(self, ref, CompiledMethod::CodePointer(code, instruction_set_));
+  PerfMap* perf_map = Runtime::Current()->GetPerfMap();
+  if (perf_map != nullptr) {
+    perf_map->AddMethod(method, code, code_size);
+  }
+  return true;
+}
+
+}  // namespace jit
+}  // namespace art
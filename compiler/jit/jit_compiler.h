@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_JIT_JIT_COMPILER_H_
+#define ART_COMPILER_JIT_JIT_COMPILER_H_
+
+#include <memory>
+
+#include "base/mutex.h"
+#include "base/timing_logger.h"
+#include "compiled_method.h"
+#include "dex/quick/dex_file_to_method_inliner_map.h"
+#include "dex/verification_results.h"
+#include "driver/compiler_driver.h"
+#include "driver/compiler_options.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+}  // namespace mirror
+
+namespace jit {
+
+// The compiler side of the runtime's Jit, created through the jit_load entry point of
+// libart-compiler. Compiles methods with the Quick backend and copies their code into the
+// JitCodeCache of the runtime.
+class JitCompiler {
+ public:
+  static JitCompiler* Create();
+
+  ~JitCompiler();
+
+  // Compiles the method into the code cache, the caller installs its entry point. Returns false
+  // if the method couldn't be compiled or the cache is full.
+  bool CompileMethod(Thread* self, mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  JitCompiler();
+
+  // Runs the verifier on the method to record the verified method needed by the backend, the
+  // runtime doesn't keep it since it has no compiler callbacks.
+  bool VerifyMethod(Thread* self, mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  bool AddToCodeCache(Thread* self, mirror::ArtMethod* method,
+                      const CompiledMethod* compiled_method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  const InstructionSet instruction_set_;
+  std::unique_ptr<CompilerOptions> compiler_options_;
+  std::unique_ptr<VerificationResults> verification_results_;
+  std::unique_ptr<DexFileToMethodInlinerMap> method_inliner_map_;
+  std::unique_ptr<CumulativeLogger> cumulative_logger_;
+  std::unique_ptr<CompilerDriver> compiler_driver_;
+
+  DISALLOW_COPY_AND_ASSIGN(JitCompiler);
+};
+
+}  // namespace jit
+}  // namespace art
+
+#endif  // ART_COMPILER_JIT_JIT_COMPILER_H_
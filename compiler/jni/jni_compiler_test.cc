@@ -403,6 +403,31 @@ TEST_F(JniCompilerTest, CompileAndRunStaticIntIntMethod) {
   EXPECT_EQ(1, gJava_MyClassNatives_fooSII_calls);
 }
 
+int gJava_MyClassNatives_fooSIIFast_calls = 0;
+jint Java_MyClassNatives_fooSIIFast(JNIEnv* env, jclass klass, jint x, jint y) {
+  // The fast native stub doesn't leave the runnable state.
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(klass != nullptr);
+  gJava_MyClassNatives_fooSIIFast_calls++;
+  EXPECT_EQ(1U, Thread::Current()->NumStackReferences());
+  return x + y;
+}
+
+TEST_F(JniCompilerTest, CompileAndRunStaticFastNativeIntIntMethod) {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "fooSIIFast", "(II)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_fooSIIFast));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_fooSIIFast_calls);
+  jint result = env_->CallStaticIntMethod(jklass_, jmethod_, 20, 30);
+  EXPECT_EQ(50, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_fooSIIFast_calls);
+  result = env_->CallStaticIntMethod(jklass_, jmethod_, -7, 3);
+  EXPECT_EQ(-4, result);
+  EXPECT_EQ(2, gJava_MyClassNatives_fooSIIFast_calls);
+}
+
 int gJava_MyClassNatives_fooSDD_calls = 0;
 jdouble Java_MyClassNatives_fooSDD(JNIEnv* env, jclass klass, jdouble x, jdouble y) {
   // 1 = klass
@@ -34,6 +34,7 @@
 
 #include <llvm/LinkAllPasses.h>
 #include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/Threading.h>
 
@@ -110,11 +111,17 @@ namespace llvm {
 
 
 CompilerLLVM::CompilerLLVM(CompilerDriver* driver, InstructionSet insn_set)
-    : compiler_driver_(driver), insn_set_(insn_set),
+    : compiler_driver_(driver), insn_set_(insn_set), target_(NULL),
       next_cunit_id_lock_("compilation unit id lock"), next_cunit_id_(1) {
 
   // Initialize LLVM libraries
   pthread_once(&llvm_initialized, InitializeLLVM);
+
+  CompilerDriver::InstructionSetToLLVMTarget(insn_set_, &target_triple_, &target_cpu_,
+                                             &target_attr_);
+  std::string errmsg;
+  target_ = ::llvm::TargetRegistry::lookupTarget(target_triple_, errmsg);
+  CHECK(target_ != NULL) << errmsg;
 }
 
 
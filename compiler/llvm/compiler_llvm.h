@@ -45,6 +45,7 @@ namespace llvm {
   class Module;
   class PointerType;
   class StructType;
+  class Target;
   class Type;
 }  // namespace llvm
 
@@ -69,6 +70,23 @@ class CompilerLLVM {
     return insn_set_;
   }
 
+  // The target of the instruction set, looked up once for all the compilation units.
+  const ::llvm::Target* GetTarget() const {
+    return target_;
+  }
+
+  const std::string& GetTargetTriple() const {
+    return target_triple_;
+  }
+
+  const std::string& GetTargetCpu() const {
+    return target_cpu_;
+  }
+
+  const std::string& GetTargetAttr() const {
+    return target_attr_;
+  }
+
   void SetBitcodeFileName(const std::string& filename) {
     bitcode_filename_ = filename;
   }
@@ -87,6 +105,11 @@ class CompilerLLVM {
 
   const InstructionSet insn_set_;
 
+  std::string target_triple_;
+  std::string target_cpu_;
+  std::string target_attr_;
+  const ::llvm::Target* target_;
+
   Mutex next_cunit_id_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   size_t next_cunit_id_ GUARDED_BY(next_cunit_id_lock_);
 
@@ -92,8 +92,6 @@ namespace llvm {
 CreateGBCExpanderPass(const IntrinsicHelper& intrinsic_helper, IRBuilder& irb,
                       CompilerDriver* compiler, const DexCompilationUnit* dex_compilation_unit);
 
-::llvm::Module* makeLLVMModuleContents(::llvm::Module* module);
-
 
 LlvmCompilationUnit::LlvmCompilationUnit(const CompilerLLVM* compiler_llvm, size_t cunit_id)
     : compiler_llvm_(compiler_llvm), cunit_id_(cunit_id) {
@@ -101,16 +99,12 @@ LlvmCompilationUnit::LlvmCompilationUnit(const CompilerLLVM* compiler_llvm, size
   dex_compilation_unit_ = NULL;
   llvm_info_.reset(new LLVMInfo());
   context_.reset(llvm_info_->GetLLVMContext());
+  // LLVMInfo already declared the runtime functions and the intrinsics in the module, declaring
+  // them again would only add renamed copies for the optimizer to strip.
   module_ = llvm_info_->GetLLVMModule();
 
-  // Include the runtime function declaration
-  makeLLVMModuleContents(module_);
-
-
-  intrinsic_helper_.reset(new IntrinsicHelper(*context_, *module_));
-
   // Create IRBuilder
-  irb_.reset(new IRBuilder(*context_, *module_, *intrinsic_helper_));
+  irb_.reset(new IRBuilder(*context_, *module_, *llvm_info_->GetIntrinsicHelper()));
 
   // We always need a switch case, so just use a normal function.
   switch (GetInstructionSet()) {
@@ -196,17 +190,7 @@ bool LlvmCompilationUnit::MaterializeToString(std::string& str_buffer) {
 
 bool LlvmCompilationUnit::MaterializeToRawOStream(::llvm::raw_ostream& out_stream) {
   // Lookup the LLVM target
-  std::string target_triple;
-  std::string target_cpu;
-  std::string target_attr;
-  CompilerDriver::InstructionSetToLLVMTarget(GetInstructionSet(), &target_triple, &target_cpu,
-                                             &target_attr);
-
-  std::string errmsg;
-  const ::llvm::Target* target =
-    ::llvm::TargetRegistry::lookupTarget(target_triple, errmsg);
-
-  CHECK(target != NULL) << errmsg;
+  const ::llvm::Target* target = compiler_llvm_->GetTarget();
 
   // Target options
   ::llvm::TargetOptions target_options;
@@ -217,7 +201,8 @@ bool LlvmCompilationUnit::MaterializeToRawOStream(::llvm::raw_ostream& out_strea
 
   // Create the ::llvm::TargetMachine
   ::llvm::OwningPtr< ::llvm::TargetMachine> target_machine(
-    target->createTargetMachine(target_triple, target_cpu, target_attr, target_options,
+    target->createTargetMachine(compiler_llvm_->GetTargetTriple(), compiler_llvm_->GetTargetCpu(),
+                                compiler_llvm_->GetTargetAttr(), target_options,
                                 ::llvm::Reloc::Static, ::llvm::CodeModel::Small,
                                 ::llvm::CodeGenOpt::Aggressive));
 
@@ -144,6 +144,21 @@ TEST_F(OatTest, WriteRead) {
                                                                     &dex_file_checksum);
   ASSERT_TRUE(oat_dex_file != nullptr);
   CHECK_EQ(dex_file->GetLocationChecksum(), oat_dex_file->GetDexFileLocationChecksum());
+
+  // The class def index must round trip through the oat file.
+  std::vector<uint32_t> class_def_index;
+  dex_file->CreateClassDefIndex(&class_def_index);
+  ASSERT_FALSE(class_def_index.empty());
+  ASSERT_EQ(class_def_index.size(), oat_dex_file->GetClassDefIndexSize());
+  EXPECT_EQ(0, memcmp(&class_def_index[0], oat_dex_file->GetClassDefIndex(),
+                      class_def_index.size() * sizeof(class_def_index[0])));
+  std::unique_ptr<const DexFile> oat_dex(oat_dex_file->OpenDexFile(&error_msg));
+  ASSERT_TRUE(oat_dex.get() != nullptr) << error_msg;
+  for (size_t i = 0; i < oat_dex->NumClassDefs(); i++) {
+    const DexFile::ClassDef& class_def = oat_dex->GetClassDef(i);
+    EXPECT_EQ(&class_def, oat_dex->FindClassDef(oat_dex->GetClassDescriptor(class_def)));
+  }
+
   for (size_t i = 0; i < dex_file->NumClassDefs(); i++) {
     const DexFile::ClassDef& class_def = dex_file->GetClassDef(i);
     const byte* class_data = dex_file->GetClassData(class_def);
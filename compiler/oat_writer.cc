@@ -32,6 +32,7 @@
 #include "os.h"
 #include "output_stream.h"
 #include "safe_map.h"
+#include "thread_pool.h"
 #include "scoped_thread_state_change.h"
 #include "handle_scope-inl.h"
 #include "verifier/method_verifier.h"
@@ -85,6 +86,7 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     size_oat_dex_file_location_checksum_(0),
     size_oat_dex_file_offset_(0),
     size_oat_dex_file_methods_offsets_(0),
+    size_oat_dex_file_class_def_index_(0),
     size_oat_class_type_(0),
     size_oat_class_status_(0),
     size_oat_class_method_bitmaps_(0),
@@ -242,7 +244,8 @@ class OatWriter::OatDexMethodVisitor : public DexMethodVisitor {
   OatDexMethodVisitor(OatWriter* writer, size_t offset)
     : DexMethodVisitor(writer, offset),
       oat_class_index_(0u),
-      method_offsets_index_(0u) {
+      method_offsets_index_(0u),
+      hot_(false) {
   }
 
   bool StartClass(const DexFile* dex_file, size_t class_def_index) {
@@ -257,9 +260,23 @@ class OatWriter::OatDexMethodVisitor : public DexMethodVisitor {
     return DexMethodVisitor::EndClass();
   }
 
+  // Restarts from the first class to visit the code of the hot or of the cold methods. The code
+  // visitors skip the methods of the other group, which is visited by the other pass.
+  void StartCodeGroup(bool hot) {
+    oat_class_index_ = 0u;
+    hot_ = hot;
+  }
+
  protected:
+  bool IsInCodeGroup(const OatClass* oat_class) const {
+    DCHECK_LT(method_offsets_index_, oat_class->method_is_hot_.size());
+    return oat_class->method_is_hot_[method_offsets_index_] == hot_;
+  }
+
   size_t oat_class_index_;
   size_t method_offsets_index_;
+  // Without hot methods, all the code is in the cold group.
+  bool hot_;
 };
 
 class OatWriter::InitOatClassesMethodVisitor : public DexMethodVisitor {
@@ -274,6 +291,7 @@ class OatWriter::InitOatClassesMethodVisitor : public DexMethodVisitor {
   bool StartClass(const DexFile* dex_file, size_t class_def_index) {
     DexMethodVisitor::StartClass(dex_file, class_def_index);
     compiled_methods_.clear();
+    method_is_hot_.clear();
     num_non_null_compiled_methods_ = 0u;
     return true;
   }
@@ -289,6 +307,9 @@ class OatWriter::InitOatClassesMethodVisitor : public DexMethodVisitor {
     compiled_methods_.push_back(compiled_method);
     if (compiled_method != nullptr) {
         ++num_non_null_compiled_methods_;
+        const CompilerDriver* driver = writer_->compiler_driver_;
+        method_is_hot_.push_back(driver->HasHotMethods() &&
+                                 driver->IsHotMethod(PrettyMethod(method_idx, *dex_file_)));
     }
     return true;
   }
@@ -307,6 +328,7 @@ class OatWriter::InitOatClassesMethodVisitor : public DexMethodVisitor {
 
     OatClass* oat_class = new OatClass(offset_, compiled_methods_,
                                        num_non_null_compiled_methods_, status);
+    oat_class->method_is_hot_.swap(method_is_hot_);
     writer_->oat_classes_.push_back(oat_class);
     offset_ += oat_class->SizeOf();
     return DexMethodVisitor::EndClass();
@@ -314,6 +336,7 @@ class OatWriter::InitOatClassesMethodVisitor : public DexMethodVisitor {
 
  private:
   std::vector<CompiledMethod*> compiled_methods_;
+  std::vector<bool> method_is_hot_;
   size_t num_non_null_compiled_methods_;
 };
 
@@ -328,7 +351,9 @@ class OatWriter::InitCodeMethodVisitor : public OatDexMethodVisitor {
     OatClass* oat_class = writer_->oat_classes_[oat_class_index_];
     CompiledMethod* compiled_method = oat_class->GetCompiledMethod(class_def_method_index);
 
-    if (compiled_method != nullptr) {
+    if (compiled_method != nullptr && !IsInCodeGroup(oat_class)) {
+      ++method_offsets_index_;
+    } else if (compiled_method != nullptr) {
       // Derived from CompiledMethod.
       uint32_t quick_code_offset = 0;
 
@@ -359,13 +384,15 @@ class OatWriter::InitCodeMethodVisitor : public OatDexMethodVisitor {
             int cur_offset = cfi_info->size();
             cfi_info->insert(cfi_info->end(), fde->begin(), fde->end());
 
-            // Set the 'initial_location' field to address the start of the method.
+            // Set the 'initial_location' field to address the start of the method, the address
+            // of the first instruction rather than the Thumb entry point.
             uint32_t new_value = quick_code_offset - writer_->oat_header_->GetExecutableOffset();
+            uint32_t location = new_value - thumb_offset;
             uint32_t offset_to_update = cur_offset + 2*sizeof(uint32_t);
-            (*cfi_info)[offset_to_update+0] = new_value;
-            (*cfi_info)[offset_to_update+1] = new_value >> 8;
-            (*cfi_info)[offset_to_update+2] = new_value >> 16;
-            (*cfi_info)[offset_to_update+3] = new_value >> 24;
+            (*cfi_info)[offset_to_update+0] = location;
+            (*cfi_info)[offset_to_update+1] = location >> 8;
+            (*cfi_info)[offset_to_update+2] = location >> 16;
+            (*cfi_info)[offset_to_update+3] = location >> 24;
             std::string name = PrettyMethod(it.GetMemberIndex(), *dex_file_, false);
             writer_->method_info_.push_back(DebugInfo(name, new_value, new_value + code_size));
           }
@@ -400,19 +427,20 @@ class OatWriter::InitCodeMethodVisitor : public OatDexMethodVisitor {
         uint32_t fp_spill_mask = compiled_method->GetFpSpillMask();
         *method_header = OatQuickMethodHeader(mapping_table_offset, vmap_table_offset,
                                               frame_size_in_bytes, core_spill_mask, fp_spill_mask,
-                                              code_size);
+                                              code_size, compiled_method->HasStackMaps());
 
         // Update checksum if this wasn't a duplicate.
         if (code_iter == dedupe_map_.end()) {
-          writer_->oat_header_->UpdateChecksum(method_header, sizeof(*method_header));
+          writer_->DeferChecksum(method_header, sizeof(*method_header));
           offset_ += sizeof(*method_header);  // Method header is prepended before code.
-          writer_->oat_header_->UpdateChecksum(&(*quick_code)[0], code_size);
+          writer_->DeferChecksum(&(*quick_code)[0], code_size);
           offset_ += code_size;
         }
       }
 
       if (kIsDebugBuild) {
         // We expect GC maps except when the class hasn't been verified or the method is native.
+        // The stack maps of optimized methods hold their references.
         const CompilerDriver* compiler_driver = writer_->compiler_driver_;
         ClassReference class_ref(dex_file_, class_def_index_);
         CompiledClass* compiled_class = compiler_driver->GetCompiledClass(class_ref);
@@ -427,7 +455,8 @@ class OatWriter::InitCodeMethodVisitor : public OatDexMethodVisitor {
         const std::vector<uint8_t>& gc_map = compiled_method->GetGcMap();
         size_t gc_map_size = gc_map.size() * sizeof(gc_map[0]);
         bool is_native = (it.GetMemberAccessFlags() & kAccNative) != 0;
-        CHECK(gc_map_size != 0 || is_native || status < mirror::Class::kStatusVerified)
+        CHECK(gc_map_size != 0 || is_native || compiled_method->HasStackMaps() ||
+              status < mirror::Class::kStatusVerified)
             << &gc_map << " " << gc_map_size << " " << (is_native ? "true" : "false") << " "
             << (status < mirror::Class::kStatusVerified) << " " << status << " "
             << PrettyMethod(it.GetMemberIndex(), *dex_file_);
@@ -474,7 +503,7 @@ class OatWriter::InitMapMethodVisitor : public OatDexMethodVisitor {
           DataAccess::SetOffset(oat_class, method_offsets_index_, offset_);
           dedupe_map_.Put(map, offset_);
           offset_ += map_size;
-          writer_->oat_header_->UpdateChecksum(&(*map)[0], map_size);
+          writer_->DeferChecksum(&(*map)[0], map_size);
         }
       }
       ++method_offsets_index_;
@@ -539,7 +568,9 @@ class OatWriter::WriteCodeMethodVisitor : public OatDexMethodVisitor {
     OatClass* oat_class = writer_->oat_classes_[oat_class_index_];
     const CompiledMethod* compiled_method = oat_class->GetCompiledMethod(class_def_method_index);
 
-    if (compiled_method != NULL) {  // ie. not an abstract method
+    if (compiled_method != NULL && !IsInCodeGroup(oat_class)) {
+      ++method_offsets_index_;
+    } else if (compiled_method != NULL) {  // ie. not an abstract method
       size_t file_offset = file_offset_;
       OutputStream* out = out_;
 
@@ -776,6 +807,7 @@ size_t OatWriter::InitOatMaps(size_t offset) {
 
   #undef VISIT
 
+  UpdateDeferredChecksum();
   return offset;
 }
 
@@ -831,7 +863,20 @@ size_t OatWriter::InitOatCodeDexFiles(size_t offset) {
       offset = visitor.GetOffset();                   \
     } while (false)
 
-  VISIT(InitCodeMethodVisitor);
+  {
+    InitCodeMethodVisitor visitor(this, offset);
+    if (compiler_driver_->HasHotMethods()) {
+      // The hot code first, it is faulted in at startup.
+      visitor.StartCodeGroup(true);
+      bool success = VisitDexMethods(&visitor);
+      DCHECK(success);
+      visitor.StartCodeGroup(false);
+    }
+    bool success = VisitDexMethods(&visitor);
+    DCHECK(success);
+    offset = visitor.GetOffset();
+  }
+  UpdateDeferredChecksum();
   if (compiler_driver_->IsImage()) {
     VISIT(InitImageMethodVisitor);
   }
@@ -841,6 +886,110 @@ size_t OatWriter::InitOatCodeDexFiles(size_t offset) {
   return offset;
 }
 
+void OatWriter::DeferChecksum(const void* data, size_t length) {
+  deferred_checksum_.push_back(std::make_pair(reinterpret_cast<const uint8_t*>(data), length));
+}
+
+// Checksums a range of the bytes of the concatenated deferred data.
+class ChecksumTask : public Task {
+ public:
+  ChecksumTask(const std::vector<std::pair<const uint8_t*, size_t>>& data, size_t first_data,
+               size_t first_byte, size_t length)
+      : data_(data), first_data_(first_data), first_byte_(first_byte), length_(length),
+        checksum_(adler32(0L, Z_NULL, 0)) {
+  }
+
+  void Run(Thread* self) {
+    size_t left = length_;
+    size_t skip = first_byte_;
+    for (size_t i = first_data_; left != 0u; ++i) {
+      DCHECK_LT(i, data_.size());
+      size_t length = std::min(data_[i].second - skip, left);
+      checksum_ = adler32(checksum_, data_[i].first + skip, length);
+      left -= length;
+      skip = 0u;
+    }
+  }
+
+  uint32_t GetChecksum() const {
+    return checksum_;
+  }
+
+  size_t GetLength() const {
+    return length_;
+  }
+
+ private:
+  const std::vector<std::pair<const uint8_t*, size_t>>& data_;
+  const size_t first_data_;
+  const size_t first_byte_;
+  const size_t length_;
+  uint32_t checksum_;
+};
+
+void OatWriter::UpdateDeferredChecksum() {
+  // Below this, starting the threads costs more than the checksum.
+  static constexpr size_t kMinParallelChecksumBytes = 4 * MB;
+  // Tasks per thread, the ranges take unequal times when their data is not in the cache.
+  static constexpr size_t kChecksumTasksPerThread = 4;
+  size_t total_length = 0u;
+  for (const auto& data : deferred_checksum_) {
+    total_length += data.second;
+  }
+  size_t thread_count = compiler_driver_->GetThreadCount();
+  if (thread_count <= 1u || total_length < kMinParallelChecksumBytes) {
+    for (const auto& data : deferred_checksum_) {
+      oat_header_->UpdateChecksum(data.first, data.second);
+    }
+    deferred_checksum_.clear();
+    return;
+  }
+
+  // Split the data in ranges of equal size, regardless of where the maps and the code start.
+  size_t task_count = thread_count * kChecksumTasksPerThread;
+  size_t task_length = RoundUp(total_length, task_count) / task_count;
+  std::vector<std::unique_ptr<ChecksumTask>> tasks;
+  size_t data_index = 0u;
+  size_t data_byte = 0u;
+  for (size_t start = 0u; start != total_length; ) {
+    size_t length = std::min(task_length, total_length - start);
+    tasks.emplace_back(new ChecksumTask(deferred_checksum_, data_index, data_byte, length));
+    start += length;
+    // Find where the next range starts.
+    size_t left = length;
+    while (left != 0u && left >= deferred_checksum_[data_index].second - data_byte) {
+      left -= deferred_checksum_[data_index].second - data_byte;
+      ++data_index;
+      data_byte = 0u;
+    }
+    data_byte += left;
+  }
+
+  Thread* self = Thread::Current();
+  // The data is not in the heap, do not hold off the GC while waiting for the workers.
+  const bool runnable = self->GetState() == kRunnable;
+  if (runnable) {
+    self->TransitionFromRunnableToSuspended(kNative);
+  }
+  {
+    // The calling thread works too.
+    ThreadPool thread_pool("Oat checksum thread pool", thread_count - 1u);
+    for (const auto& task : tasks) {
+      thread_pool.AddTask(self, task.get());
+    }
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, true, false);
+    thread_pool.StopWorkers(self);
+  }
+  if (runnable) {
+    self->TransitionFromSuspendedToRunnable();
+  }
+  for (const auto& task : tasks) {
+    oat_header_->CombineChecksum(task->GetChecksum(), task->GetLength());
+  }
+  deferred_checksum_.clear();
+}
+
 bool OatWriter::Write(OutputStream* out) {
   const size_t file_offset = out->Seek(0, kSeekCurrent);
 
@@ -913,6 +1062,7 @@ bool OatWriter::Write(OutputStream* out) {
     DO_STAT(size_oat_dex_file_location_checksum_);
     DO_STAT(size_oat_dex_file_offset_);
     DO_STAT(size_oat_dex_file_methods_offsets_);
+    DO_STAT(size_oat_dex_file_class_def_index_);
     DO_STAT(size_oat_class_type_);
     DO_STAT(size_oat_class_status_);
     DO_STAT(size_oat_class_method_bitmaps_);
@@ -1037,20 +1187,19 @@ size_t OatWriter::WriteCode(OutputStream* out, const size_t file_offset, size_t
 size_t OatWriter::WriteCodeDexFiles(OutputStream* out,
                                     const size_t file_offset,
                                     size_t relative_offset) {
-  #define VISIT(VisitorType)                                              \
-    do {                                                                  \
-      VisitorType visitor(this, out, file_offset, relative_offset);       \
-      if (UNLIKELY(!VisitDexMethods(&visitor))) {                         \
-        return 0;                                                         \
-      }                                                                   \
-      relative_offset = visitor.GetOffset();                              \
-    } while (false)
-
-  VISIT(WriteCodeMethodVisitor);
-
-  #undef VISIT
-
-  return relative_offset;
+  // Same order as in InitOatCodeDexFiles.
+  WriteCodeMethodVisitor visitor(this, out, file_offset, relative_offset);
+  if (compiler_driver_->HasHotMethods()) {
+    visitor.StartCodeGroup(true);
+    if (UNLIKELY(!VisitDexMethods(&visitor))) {
+      return 0;
+    }
+    visitor.StartCodeGroup(false);
+  }
+  if (UNLIKELY(!VisitDexMethods(&visitor))) {
+    return 0;
+  }
+  return visitor.GetOffset();
 }
 
 OatWriter::OatDexFile::OatDexFile(size_t offset, const DexFile& dex_file) {
@@ -1061,6 +1210,8 @@ OatWriter::OatDexFile::OatDexFile(size_t offset, const DexFile& dex_file) {
   dex_file_location_checksum_ = dex_file.GetLocationChecksum();
   dex_file_offset_ = 0;
   methods_offsets_.resize(dex_file.NumClassDefs());
+  dex_file.CreateClassDefIndex(&class_def_index_);
+  class_def_index_size_ = class_def_index_.size();
 }
 
 size_t OatWriter::OatDexFile::SizeOf() const {
@@ -1068,7 +1219,9 @@ size_t OatWriter::OatDexFile::SizeOf() const {
           + dex_file_location_size_
           + sizeof(dex_file_location_checksum_)
           + sizeof(dex_file_offset_)
-          + (sizeof(methods_offsets_[0]) * methods_offsets_.size());
+          + (sizeof(methods_offsets_[0]) * methods_offsets_.size())
+          + sizeof(class_def_index_size_)
+          + (sizeof(uint32_t) * class_def_index_.size());
 }
 
 void OatWriter::OatDexFile::UpdateChecksum(OatHeader* oat_header) const {
@@ -1078,6 +1231,11 @@ void OatWriter::OatDexFile::UpdateChecksum(OatHeader* oat_header) const {
   oat_header->UpdateChecksum(&dex_file_offset_, sizeof(dex_file_offset_));
   oat_header->UpdateChecksum(&methods_offsets_[0],
                             sizeof(methods_offsets_[0]) * methods_offsets_.size());
+  oat_header->UpdateChecksum(&class_def_index_size_, sizeof(class_def_index_size_));
+  if (!class_def_index_.empty()) {
+    oat_header->UpdateChecksum(&class_def_index_[0],
+                              sizeof(class_def_index_[0]) * class_def_index_.size());
+  }
 }
 
 bool OatWriter::OatDexFile::Write(OatWriter* oat_writer,
@@ -1111,6 +1269,19 @@ bool OatWriter::OatDexFile::Write(OatWriter* oat_writer,
   }
   oat_writer->size_oat_dex_file_methods_offsets_ +=
       sizeof(methods_offsets_[0]) * methods_offsets_.size();
+  if (!out->WriteFully(&class_def_index_size_, sizeof(class_def_index_size_))) {
+    PLOG(ERROR) << "Failed to write class def index size to " << out->GetLocation();
+    return false;
+  }
+  oat_writer->size_oat_dex_file_class_def_index_ += sizeof(class_def_index_size_);
+  if (!class_def_index_.empty() &&
+      !out->WriteFully(&class_def_index_[0],
+                       sizeof(class_def_index_[0]) * class_def_index_.size())) {
+    PLOG(ERROR) << "Failed to write class def index to " << out->GetLocation();
+    return false;
+  }
+  oat_writer->size_oat_dex_file_class_def_index_ +=
+      sizeof(class_def_index_[0]) * class_def_index_.size();
   return true;
 }
 
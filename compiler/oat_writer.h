@@ -67,6 +67,7 @@ class OutputStream;
 // padding           if necessary so that the following code will be page aligned
 //
 // OatMethodHeader   fixed size header for a CompiledMethod including the size of the MethodCode.
+//                   The code of the hot methods comes first, if the driver has hot methods.
 // MethodCode        one variable sized blob with the code of a CompiledMethod.
 // OatMethodHeader   (OatMethodHeader, MethodCode) pairs are deduplicated.
 // MethodCode
@@ -146,6 +147,11 @@ class OatWriter {
   size_t InitOatCodeDexFiles(size_t offset)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // The maps and the code are most of the checksummed data. Their layout records them and
+  // UpdateDeferredChecksum() checksums them on the compiler threads, in the recorded order.
+  void DeferChecksum(const void* data, size_t length);
+  void UpdateDeferredChecksum();
+
   bool WriteTables(OutputStream* out, const size_t file_offset);
   size_t WriteMaps(OutputStream* out, const size_t file_offset, size_t relative_offset);
   size_t WriteCode(OutputStream* out, const size_t file_offset, size_t relative_offset);
@@ -168,6 +174,9 @@ class OatWriter {
     uint32_t dex_file_location_checksum_;
     uint32_t dex_file_offset_;
     std::vector<uint32_t> methods_offsets_;
+    // Class def lookup table, see DexFile::CreateClassDefIndex.
+    uint32_t class_def_index_size_;
+    std::vector<uint32_t> class_def_index_;
 
    private:
     DISALLOW_COPY_AND_ASSIGN(OatDexFile);
@@ -232,6 +241,10 @@ class OatWriter {
     std::vector<OatMethodOffsets> method_offsets_;
     std::vector<OatQuickMethodHeader> method_headers_;
 
+    // Whether the code of each CompiledMethod present in the OatClass is laid out with the hot
+    // code, indexed like method_offsets_. See CompilerDriver::IsHotMethod.
+    std::vector<bool> method_is_hot_;
+
    private:
     DISALLOW_COPY_AND_ASSIGN(OatClass);
   };
@@ -253,6 +266,7 @@ class OatWriter {
 
   // data to write
   OatHeader* oat_header_;
+  std::vector<std::pair<const uint8_t*, size_t>> deferred_checksum_;
   std::vector<OatDexFile*> oat_dex_files_;
   std::vector<OatClass*> oat_classes_;
   std::unique_ptr<const std::vector<uint8_t>> interpreter_to_interpreter_bridge_;
@@ -294,6 +308,7 @@ class OatWriter {
   uint32_t size_oat_dex_file_location_checksum_;
   uint32_t size_oat_dex_file_offset_;
   uint32_t size_oat_dex_file_methods_offsets_;
+  uint32_t size_oat_dex_file_class_def_index_;
   uint32_t size_oat_class_type_;
   uint32_t size_oat_class_status_;
   uint32_t size_oat_class_method_bitmaps_;
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bounds_check_elimination.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace art {
+
+static IfCondition NegateCondition(IfCondition condition) {
+  switch (condition) {
+    case kCondEQ: return kCondNE;
+    case kCondNE: return kCondEQ;
+    case kCondLT: return kCondGE;
+    case kCondLE: return kCondGT;
+    case kCondGT: return kCondLE;
+    case kCondGE: return kCondLT;
+  }
+  LOG(FATAL) << "Unreachable";
+  return condition;
+}
+
+// Returns the condition to use when swapping the operands of `condition`.
+static IfCondition MirrorCondition(IfCondition condition) {
+  switch (condition) {
+    case kCondEQ: return kCondEQ;
+    case kCondNE: return kCondNE;
+    case kCondLT: return kCondGT;
+    case kCondLE: return kCondGE;
+    case kCondGT: return kCondLT;
+    case kCondGE: return kCondLE;
+  }
+  LOG(FATAL) << "Unreachable";
+  return condition;
+}
+
+static bool IsIntConstant(HInstruction* instruction, int32_t value) {
+  HIntConstant* constant = instruction->AsIntConstant();
+  return constant != nullptr && constant->GetValue() == value;
+}
+
+// If `instruction` adds a constant to `input`, stores the constant in `increment`.
+static bool IsAddOfConstant(HInstruction* instruction, HInstruction* input, int32_t* increment) {
+  if (instruction->GetType() != Primitive::kPrimInt) {
+    return false;
+  }
+  if (instruction->AsAdd() != nullptr) {
+    HInstruction* left = instruction->InputAt(0);
+    HInstruction* right = instruction->InputAt(1);
+    if (left == input && right->AsIntConstant() != nullptr) {
+      *increment = right->AsIntConstant()->GetValue();
+      return true;
+    }
+    if (right == input && left->AsIntConstant() != nullptr) {
+      *increment = left->AsIntConstant()->GetValue();
+      return true;
+    }
+  } else if (instruction->AsSub() != nullptr) {
+    HIntConstant* constant = instruction->InputAt(1)->AsIntConstant();
+    if (instruction->InputAt(0) == input
+        && constant != nullptr
+        && constant->GetValue() != std::numeric_limits<int32_t>::min()) {
+      *increment = -constant->GetValue();
+      return true;
+    }
+  }
+  return false;
+}
+
+// If `instruction` computes `array.length - 1`, returns the array. Returns null otherwise.
+static HInstruction* GetArrayOfLastIndex(HInstruction* instruction) {
+  if (instruction->AsAdd() == nullptr && instruction->AsSub() == nullptr) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < 2; ++i) {
+    HInstruction* length = instruction->InputAt(i);
+    int32_t offset = 0;
+    if (length->AsArrayLength() != nullptr
+        && IsAddOfConstant(instruction, length, &offset)
+        && offset == -1) {
+      return length->InputAt(0);
+    }
+  }
+  return nullptr;
+}
+
+HInstruction* BoundsCheckElimination::FindArrayBounding(HBasicBlock* header,
+                                                        HBasicBlock** body,
+                                                        HPhi** phi) const {
+  HIf* if_instruction = header->GetLastInstruction()->AsIf();
+  if (if_instruction == nullptr) {
+    return nullptr;
+  }
+  HInstruction* input = if_instruction->InputAt(0);
+  bool negated = false;
+  if (input->AsNot() != nullptr) {
+    negated = true;
+    input = input->InputAt(0);
+  }
+  HCondition* condition = input->AsCondition();
+  if (condition == nullptr) {
+    return nullptr;
+  }
+
+  // Find the condition under which the loop is not exited.
+  IfCondition stay_condition = negated ? NegateCondition(condition->GetCondition())
+                                       : condition->GetCondition();
+  HLoopInformation* info = header->GetLoopInformation();
+  HBasicBlock* true_successor = if_instruction->IfTrueSuccessor();
+  HBasicBlock* false_successor = if_instruction->IfFalseSuccessor();
+  if (info->Contains(*true_successor) && !info->Contains(*false_successor)) {
+    *body = true_successor;
+  } else if (info->Contains(*false_successor) && !info->Contains(*true_successor)) {
+    *body = false_successor;
+    stay_condition = NegateCondition(stay_condition);
+  } else {
+    return nullptr;
+  }
+  if ((*body)->GetPredecessors().Size() != 1) {
+    return nullptr;
+  }
+
+  // Put the induction variable on the left of the condition.
+  HInstruction* left = condition->InputAt(0);
+  HInstruction* right = condition->InputAt(1);
+  if (left->AsPhi() == nullptr || left->GetBlock() != header) {
+    std::swap(left, right);
+    stay_condition = MirrorCondition(stay_condition);
+  }
+  if (left->AsPhi() == nullptr || left->GetBlock() != header || left->InputCount() != 2) {
+    return nullptr;
+  }
+  *phi = left->AsPhi();
+
+  size_t pre_header_index = header->GetPredecessorIndexOf(info->GetPreHeader());
+  HInstruction* initial = left->InputAt(pre_header_index);
+  HInstruction* update = left->InputAt(1 - pre_header_index);
+  int32_t increment = 0;
+  if (!IsAddOfConstant(update, left, &increment)) {
+    return nullptr;
+  }
+
+  if (increment == 1 && stay_condition == kCondLT && right->AsArrayLength() != nullptr) {
+    // The variable increases by one from a non negative value while it is below the length,
+    // so it does not overflow.
+    HIntConstant* constant = initial->AsIntConstant();
+    if (constant != nullptr && constant->GetValue() >= 0) {
+      return right->InputAt(0);
+    }
+  } else if (increment == -1
+             && ((stay_condition == kCondGE && IsIntConstant(right, 0))
+                 || (stay_condition == kCondGT && IsIntConstant(right, -1)))) {
+    // The variable decreases by one from the last index of the array while it is
+    // non negative.
+    return GetArrayOfLastIndex(initial);
+  }
+  return nullptr;
+}
+
+void BoundsCheckElimination::RemoveBoundsChecks(HBasicBlock* body,
+                                                HInstruction* index,
+                                                HInstruction* array) {
+  for (HReversePostOrderIterator it(*graph_); !it.Done(); it.Advance()) {
+    HBasicBlock* block = it.Current();
+    if (!body->Dominates(block)) {
+      continue;
+    }
+    for (HInstructionIterator inst_it(block->GetInstructions()); !inst_it.Done(); inst_it.Advance()) {
+      HBoundsCheck* check = inst_it.Current()->AsBoundsCheck();
+      if (check != nullptr && check->InputAt(0) == index && check->InputAt(1) == array) {
+        block->RemoveInstruction(check);
+      }
+    }
+  }
+}
+
+void BoundsCheckElimination::Run() {
+  for (HReversePostOrderIterator it(*graph_); !it.Done(); it.Advance()) {
+    HBasicBlock* header = it.Current();
+    if (!header->IsLoopHeader()) {
+      continue;
+    }
+    HBasicBlock* body = nullptr;
+    HPhi* phi = nullptr;
+    HInstruction* array = FindArrayBounding(header, &body, &phi);
+    if (array != nullptr) {
+      // The value of the phi is only updated in the header, so the blocks dominated by
+      // the body see the value that has been checked against the bounds.
+      RemoveBoundsChecks(body, phi, array);
+    }
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_OPTIMIZING_BOUNDS_CHECK_ELIMINATION_H_
+#define ART_COMPILER_OPTIMIZING_BOUNDS_CHECK_ELIMINATION_H_
+
+#include "nodes.h"
+
+namespace art {
+
+/**
+ * Optimization phase that removes the bounds checks of array accesses indexed
+ * by the induction variable of a counted loop. The supported loops are:
+ *
+ *   for (int i = c; i < array.length; i++), with c >= 0 a constant.
+ *   for (int i = array.length - 1; i >= 0; i--)
+ *
+ * The loop test must be done in the loop header, and the induction variable be
+ * a phi of the header. Requires the loop information of the graph to be populated.
+ */
+class BoundsCheckElimination : public ValueObject {
+ public:
+  explicit BoundsCheckElimination(HGraph* graph) : graph_(graph) {}
+
+  void Run();
+
+ private:
+  // Returns the array whose length bounds the induction variable `phi` in the blocks
+  // dominated by `body`, or null.
+  HInstruction* FindArrayBounding(HBasicBlock* header, HBasicBlock** body, HPhi** phi) const;
+
+  // Removes the bounds checks of `index` into `array` in the blocks dominated by `body`.
+  void RemoveBoundsChecks(HBasicBlock* body, HInstruction* index, HInstruction* array);
+
+  HGraph* const graph_;
+
+  DISALLOW_COPY_AND_ASSIGN(BoundsCheckElimination);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_OPTIMIZING_BOUNDS_CHECK_ELIMINATION_H_
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bounds_check_elimination.h"
+#include "nodes.h"
+#include "optimizing_unit_test.h"
+#include "utils/arena_allocator.h"
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+/**
+ * Fixture class for the bounds check elimination tests. Builds the graph:
+ *
+ *   entry -> pre_header -> header <-> body
+ *                            |
+ *                          exit
+ *
+ * where the header tests an induction variable `phi_` and the body accesses an
+ * array with it.
+ */
+class BoundsCheckEliminationTest : public testing::Test {
+ public:
+  BoundsCheckEliminationTest() : pool_(), allocator_(&pool_) {
+    graph_ = new (&allocator_) HGraph(&allocator_);
+    entry_ = NewBlock();
+    pre_header_ = NewBlock();
+    header_ = NewBlock();
+    body_ = NewBlock();
+    exit_ = NewBlock();
+    graph_->SetEntryBlock(entry_);
+    graph_->SetExitBlock(exit_);
+
+    entry_->AddSuccessor(pre_header_);
+    pre_header_->AddSuccessor(header_);
+    header_->AddSuccessor(exit_);
+    header_->AddSuccessor(body_);
+    body_->AddSuccessor(header_);
+
+    array_ = new (&allocator_) HParameterValue(0, Primitive::kPrimNot);
+    entry_->AddInstruction(array_);
+    other_array_ = new (&allocator_) HParameterValue(1, Primitive::kPrimNot);
+    entry_->AddInstruction(other_array_);
+    constant_0_ = NewConstant(0);
+    constant_1_ = NewConstant(1);
+    constant_minus_1_ = NewConstant(-1);
+    exit_->AddInstruction(new (&allocator_) HExit());
+  }
+
+  ~BoundsCheckEliminationTest() { }
+
+  HBasicBlock* NewBlock() {
+    HBasicBlock* block = new (&allocator_) HBasicBlock(graph_);
+    graph_->AddBlock(block);
+    return block;
+  }
+
+  HIntConstant* NewConstant(int32_t value) {
+    HIntConstant* constant = new (&allocator_) HIntConstant(value);
+    entry_->AddInstruction(constant);
+    return constant;
+  }
+
+  // Starts building `for (phi = initial; ...; phi += increment)`. The initial value
+  // is computed in the pre header if it is not already in the graph.
+  void BuildLoop(HInstruction* initial, HInstruction* increment) {
+    entry_->AddInstruction(new (&allocator_) HGoto());
+    if (initial->GetBlock() == nullptr) {
+      pre_header_->AddInstruction(initial);
+    }
+    pre_header_->AddInstruction(new (&allocator_) HGoto());
+
+    phi_ = new (&allocator_) HPhi(&allocator_, 0, 0, Primitive::kPrimInt);
+    header_->AddPhi(phi_);
+    phi_->AddInput(initial);
+    update_ = new (&allocator_) HAdd(Primitive::kPrimInt, phi_, increment);
+  }
+
+  // Adds the loop test, exiting when `exit_condition` is true, and the bounds check
+  // of `index` into `array` in the body.
+  HInstruction* FinishLoop(HInstruction* exit_condition, HInstruction* array, HInstruction* index) {
+    if (exit_condition->GetBlock() == nullptr) {
+      header_->AddInstruction(exit_condition);
+    }
+    header_->AddInstruction(new (&allocator_) HIf(exit_condition));
+
+    HInstruction* bounds_check = new (&allocator_) HBoundsCheck(index, array, 0);
+    body_->AddInstruction(bounds_check);
+    body_->AddInstruction(update_);
+    phi_->AddInput(update_);
+    body_->AddInstruction(new (&allocator_) HGoto());
+    return bounds_check;
+  }
+
+  void RunBoundsCheckElimination() {
+    graph_->BuildDominatorTree();
+    ASSERT_TRUE(graph_->FindNaturalLoops());
+    BoundsCheckElimination(graph_).Run();
+  }
+
+  ArenaPool pool_;
+  ArenaAllocator allocator_;
+  HGraph* graph_;
+
+  HBasicBlock* entry_;
+  HBasicBlock* pre_header_;
+  HBasicBlock* header_;
+  HBasicBlock* body_;
+  HBasicBlock* exit_;
+
+  HInstruction* array_;
+  HInstruction* other_array_;
+  HIntConstant* constant_0_;
+  HIntConstant* constant_1_;
+  HIntConstant* constant_minus_1_;
+  HPhi* phi_;
+  HInstruction* update_;
+};
+
+// for (int i = 0; i < array.length; i++) array[i]
+TEST_F(BoundsCheckEliminationTest, IncreasingLoop) {
+  BuildLoop(constant_0_, constant_1_);
+  HInstruction* length = new (&allocator_) HArrayLength(array_);
+  header_->AddInstruction(length);
+  HInstruction* bounds_check =
+      FinishLoop(new (&allocator_) HGreaterThanOrEqual(phi_, length), array_, phi_);
+
+  RunBoundsCheckElimination();
+  ASSERT_TRUE(bounds_check->GetBlock() == nullptr);
+}
+
+// for (int i = array.length - 1; i >= 0; i--) array[i]
+TEST_F(BoundsCheckEliminationTest, DecreasingLoop) {
+  HInstruction* length = new (&allocator_) HArrayLength(array_);
+  pre_header_->AddInstruction(length);
+  BuildLoop(new (&allocator_) HAdd(Primitive::kPrimInt, length, constant_minus_1_),
+            constant_minus_1_);
+  HInstruction* bounds_check =
+      FinishLoop(new (&allocator_) HLessThan(phi_, constant_0_), array_, phi_);
+
+  RunBoundsCheckElimination();
+  ASSERT_TRUE(bounds_check->GetBlock() == nullptr);
+}
+
+// for (int i = 0; i < array.length; i++) other_array[i]
+TEST_F(BoundsCheckEliminationTest, OtherArray) {
+  BuildLoop(constant_0_, constant_1_);
+  HInstruction* length = new (&allocator_) HArrayLength(array_);
+  header_->AddInstruction(length);
+  HInstruction* bounds_check =
+      FinishLoop(new (&allocator_) HGreaterThanOrEqual(phi_, length), other_array_, phi_);
+
+  RunBoundsCheckElimination();
+  ASSERT_EQ(bounds_check->GetBlock(), body_);
+}
+
+// for (int i = -1; i < array.length; i++) array[i]
+TEST_F(BoundsCheckEliminationTest, NegativeStart) {
+  BuildLoop(constant_minus_1_, constant_1_);
+  HInstruction* length = new (&allocator_) HArrayLength(array_);
+  header_->AddInstruction(length);
+  HInstruction* bounds_check =
+      FinishLoop(new (&allocator_) HGreaterThanOrEqual(phi_, length), array_, phi_);
+
+  RunBoundsCheckElimination();
+  ASSERT_EQ(bounds_check->GetBlock(), body_);
+}
+
+// for (int i = 0; i < array.length; i += 2) array[i], which can overflow.
+TEST_F(BoundsCheckEliminationTest, IncrementOfTwo) {
+  BuildLoop(constant_0_, NewConstant(2));
+  HInstruction* length = new (&allocator_) HArrayLength(array_);
+  header_->AddInstruction(length);
+  HInstruction* bounds_check =
+      FinishLoop(new (&allocator_) HGreaterThanOrEqual(phi_, length), array_, phi_);
+
+  RunBoundsCheckElimination();
+  ASSERT_EQ(bounds_check->GetBlock(), body_);
+}
+
+// for (int i = 0; i <= array.length; i++) array[i]
+TEST_F(BoundsCheckEliminationTest, LessThanOrEqual) {
+  BuildLoop(constant_0_, constant_1_);
+  HInstruction* length = new (&allocator_) HArrayLength(array_);
+  header_->AddInstruction(length);
+  HInstruction* bounds_check =
+      FinishLoop(new (&allocator_) HGreaterThan(phi_, length), array_, phi_);
+
+  RunBoundsCheckElimination();
+  ASSERT_EQ(bounds_check->GetBlock(), body_);
+}
+
+// for (int i = 0; i < array.length; i++) array[i + 1]
+TEST_F(BoundsCheckEliminationTest, OtherIndex) {
+  BuildLoop(constant_0_, constant_1_);
+  HInstruction* index = new (&allocator_) HAdd(Primitive::kPrimInt, phi_, constant_1_);
+  body_->AddInstruction(index);
+  HInstruction* length = new (&allocator_) HArrayLength(array_);
+  header_->AddInstruction(length);
+  HInstruction* bounds_check =
+      FinishLoop(new (&allocator_) HGreaterThanOrEqual(phi_, length), array_, index);
+
+  RunBoundsCheckElimination();
+  ASSERT_EQ(bounds_check->GetBlock(), body_);
+}
+
+}  // namespace art
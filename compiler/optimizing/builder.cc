@@ -15,11 +15,14 @@
  * limitations under the License.
  */
 
+#include "builder.h"
+
+#include "class_linker.h"
 #include "dex_file.h"
 #include "dex_file-inl.h"
 #include "dex_instruction.h"
 #include "dex_instruction-inl.h"
-#include "builder.h"
+#include "driver/compiler_driver-inl.h"
 #include "nodes.h"
 #include "primitive.h"
 
@@ -92,6 +95,26 @@ static bool CanHandleCodeItem(const DexFile::CodeItem& code_item) {
   return true;
 }
 
+static InvokeType GetInvokeType(Instruction::Code opcode) {
+  switch (opcode) {
+    case Instruction::INVOKE_STATIC:
+    case Instruction::INVOKE_STATIC_RANGE:
+      return kStatic;
+    case Instruction::INVOKE_DIRECT:
+    case Instruction::INVOKE_DIRECT_RANGE:
+      return kDirect;
+    case Instruction::INVOKE_VIRTUAL:
+    case Instruction::INVOKE_VIRTUAL_RANGE:
+      return kVirtual;
+    case Instruction::INVOKE_INTERFACE:
+    case Instruction::INVOKE_INTERFACE_RANGE:
+      return kInterface;
+    default:
+      LOG(FATAL) << "Unexpected invoke opcode " << opcode;
+      return kStatic;
+  }
+}
+
 template<typename T>
 void HGraphBuilder::If_22t(const Instruction& instruction, int32_t dex_offset, bool is_not) {
   HInstruction* first = LoadLocal(instruction.VRegA(), Primitive::kPrimInt);
@@ -110,6 +133,23 @@ void HGraphBuilder::If_22t(const Instruction& instruction, int32_t dex_offset, b
   current_block_ = nullptr;
 }
 
+template<typename T>
+void HGraphBuilder::If_21t(const Instruction& instruction, int32_t dex_offset, bool is_not) {
+  HInstruction* value = LoadLocal(instruction.VRegA(), Primitive::kPrimInt);
+  current_block_->AddInstruction(new (arena_) T(value, GetIntConstant0()));
+  if (is_not) {
+    current_block_->AddInstruction(new (arena_) HNot(current_block_->GetLastInstruction()));
+  }
+  current_block_->AddInstruction(new (arena_) HIf(current_block_->GetLastInstruction()));
+  HBasicBlock* target = FindBlockStartingAt(instruction.GetTargetOffset() + dex_offset);
+  DCHECK(target != nullptr);
+  current_block_->AddSuccessor(target);
+  target = FindBlockStartingAt(dex_offset + instruction.SizeInCodeUnits());
+  DCHECK(target != nullptr);
+  current_block_->AddSuccessor(target);
+  current_block_ = nullptr;
+}
+
 HGraph* HGraphBuilder::BuildGraph(const DexFile::CodeItem& code_item) {
   if (!CanHandleCodeItem(code_item)) {
     return nullptr;
@@ -248,6 +288,52 @@ void HGraphBuilder::Binop_22b(const Instruction& instruction, bool reverse) {
   UpdateLocal(instruction.VRegA(), current_block_->GetLastInstruction());
 }
 
+template<typename T>
+void HGraphBuilder::Binop_32x(const Instruction& instruction,
+                              Primitive::Type type,
+                              uint32_t dex_offset) {
+  HInstruction* first = LoadLocal(instruction.VRegB(), type);
+  HInstruction* second = LoadLocal(instruction.VRegC(), type);
+  current_block_->AddInstruction(new (arena_) T(type, first, second, dex_offset));
+  UpdateLocal(instruction.VRegA(), current_block_->GetLastInstruction());
+}
+
+template<typename T>
+void HGraphBuilder::Binop_12x(const Instruction& instruction,
+                              Primitive::Type type,
+                              uint32_t dex_offset) {
+  HInstruction* first = LoadLocal(instruction.VRegA(), type);
+  HInstruction* second = LoadLocal(instruction.VRegB(), type);
+  current_block_->AddInstruction(new (arena_) T(type, first, second, dex_offset));
+  UpdateLocal(instruction.VRegA(), current_block_->GetLastInstruction());
+}
+
+template<typename T>
+void HGraphBuilder::Binop_22s(const Instruction& instruction,
+                              bool reverse,
+                              uint32_t dex_offset) {
+  HInstruction* first = LoadLocal(instruction.VRegB(), Primitive::kPrimInt);
+  HInstruction* second = GetIntConstant(instruction.VRegC_22s());
+  if (reverse) {
+    std::swap(first, second);
+  }
+  current_block_->AddInstruction(new (arena_) T(Primitive::kPrimInt, first, second, dex_offset));
+  UpdateLocal(instruction.VRegA(), current_block_->GetLastInstruction());
+}
+
+template<typename T>
+void HGraphBuilder::Binop_22b(const Instruction& instruction,
+                              bool reverse,
+                              uint32_t dex_offset) {
+  HInstruction* first = LoadLocal(instruction.VRegB(), Primitive::kPrimInt);
+  HInstruction* second = GetIntConstant(instruction.VRegC_22b());
+  if (reverse) {
+    std::swap(first, second);
+  }
+  current_block_->AddInstruction(new (arena_) T(Primitive::kPrimInt, first, second, dex_offset));
+  UpdateLocal(instruction.VRegA(), current_block_->GetLastInstruction());
+}
+
 void HGraphBuilder::BuildReturn(const Instruction& instruction, Primitive::Type type) {
   if (type == Primitive::kPrimVoid) {
     current_block_->AddInstruction(new (arena_) HReturnVoid());
@@ -270,14 +356,44 @@ bool HGraphBuilder::BuildInvoke(const Instruction& instruction,
   const DexFile::ProtoId& proto_id = dex_file_->GetProtoId(method_id.proto_idx_);
   const char* descriptor = dex_file_->StringDataByIdx(proto_id.shorty_idx_);
   Primitive::Type return_type = Primitive::GetType(descriptor[0]);
-  bool is_instance_call =
-      instruction.Opcode() != Instruction::INVOKE_STATIC
-      && instruction.Opcode() != Instruction::INVOKE_STATIC_RANGE;
+  InvokeType invoke_type = GetInvokeType(instruction.Opcode());
+  bool is_instance_call = invoke_type != kStatic;
   const size_t number_of_arguments = strlen(descriptor) - (is_instance_call ? 0 : 1);
 
-  // Treat invoke-direct like static calls for now.
-  HInvoke* invoke = new (arena_) HInvokeStatic(
-      arena_, number_of_arguments, return_type, dex_offset, method_idx);
+  HInvoke* invoke = nullptr;
+  if (invoke_type == kVirtual || invoke_type == kInterface) {
+    // compiler_driver_ is null only when unit testing.
+    if (compiler_driver_ == nullptr) {
+      return false;
+    }
+    MethodReference target_method(dex_file_, method_idx);
+    InvokeType optimized_invoke_type = invoke_type;
+    int vtable_index;
+    uintptr_t direct_code;
+    uintptr_t direct_method;
+    if (!compiler_driver_->ComputeInvokeInfo(dex_compilation_unit_, dex_offset, true, false,
+                                             &optimized_invoke_type, &target_method,
+                                             &vtable_index, &direct_code, &direct_method)
+        || optimized_invoke_type != invoke_type
+        || vtable_index < 0) {
+      return false;
+    }
+    // The dispatch loads the class of the receiver.
+    HInstruction* receiver = LoadLocal(is_range ? register_index : args[0], Primitive::kPrimNot);
+    current_block_->AddInstruction(new (arena_) HNullCheck(receiver, dex_offset));
+    if (invoke_type == kVirtual) {
+      invoke = new (arena_) HInvokeVirtual(
+          arena_, number_of_arguments, return_type, dex_offset, vtable_index);
+    } else {
+      invoke = new (arena_) HInvokeInterface(
+          arena_, number_of_arguments, return_type, dex_offset, method_idx,
+          vtable_index % ClassLinker::kImtSize);
+    }
+  } else {
+    // Treat invoke-direct like static calls for now.
+    invoke = new (arena_) HInvokeStatic(
+        arena_, number_of_arguments, return_type, dex_offset, method_idx);
+  }
 
   size_t start_index = 0;
   if (is_instance_call) {
@@ -320,6 +436,106 @@ bool HGraphBuilder::BuildInvoke(const Instruction& instruction,
   return true;
 }
 
+bool HGraphBuilder::BuildInstanceFieldAccess(const Instruction& instruction,
+                                             uint32_t dex_offset,
+                                             bool is_put,
+                                             Primitive::Type field_type) {
+  uint32_t source_or_dest_reg = instruction.VRegA_22c();
+  uint32_t obj_reg = instruction.VRegB_22c();
+  uint16_t field_index = instruction.VRegC_22c();
+
+  // compiler_driver_ is null only when unit testing.
+  if (compiler_driver_ == nullptr) {
+    return false;
+  }
+  MemberOffset field_offset(0u);
+  bool is_volatile;
+  if (!compiler_driver_->ComputeInstanceFieldInfo(
+          field_index, dex_compilation_unit_, is_put, &field_offset, &is_volatile)) {
+    return false;
+  }
+  // TODO: Support volatile fields, they need memory barriers.
+  if (is_volatile) {
+    return false;
+  }
+
+  HInstruction* object = LoadLocal(obj_reg, Primitive::kPrimNot);
+  current_block_->AddInstruction(new (arena_) HNullCheck(object, dex_offset));
+  object = LoadLocal(obj_reg, Primitive::kPrimNot);
+  if (is_put) {
+    HInstruction* value = LoadLocal(source_or_dest_reg, field_type);
+    current_block_->AddInstruction(
+        new (arena_) HInstanceFieldSet(object, value, field_offset, field_type));
+  } else {
+    current_block_->AddInstruction(
+        new (arena_) HInstanceFieldGet(object, field_offset, field_type));
+    UpdateLocal(source_or_dest_reg, current_block_->GetLastInstruction());
+  }
+  return true;
+}
+
+bool HGraphBuilder::BuildStaticFieldAccess(const Instruction& instruction,
+                                           bool is_put,
+                                           Primitive::Type field_type) {
+  uint32_t source_or_dest_reg = instruction.VRegA_21c();
+  uint16_t field_index = instruction.VRegB_21c();
+
+  // compiler_driver_ is null only when unit testing.
+  if (compiler_driver_ == nullptr) {
+    return false;
+  }
+  MemberOffset field_offset(0u);
+  uint32_t storage_index;
+  bool is_referrers_class;
+  bool is_volatile;
+  bool is_initialized;
+  if (!compiler_driver_->ComputeStaticFieldInfo(
+          field_index, dex_compilation_unit_, is_put, &field_offset, &storage_index,
+          &is_referrers_class, &is_volatile, &is_initialized)) {
+    return false;
+  }
+  // TODO: Support fields of other classes, they need a class initialization check, and
+  // volatile fields, they need memory barriers.
+  if (!is_referrers_class || is_volatile) {
+    return false;
+  }
+
+  if (is_put) {
+    HInstruction* value = LoadLocal(source_or_dest_reg, field_type);
+    current_block_->AddInstruction(new (arena_) HStaticFieldSet(value, field_offset, field_type));
+  } else {
+    current_block_->AddInstruction(new (arena_) HStaticFieldGet(field_offset, field_type));
+    UpdateLocal(source_or_dest_reg, current_block_->GetLastInstruction());
+  }
+  return true;
+}
+
+void HGraphBuilder::BuildArrayAccess(const Instruction& instruction,
+                                     uint32_t dex_offset,
+                                     bool is_put,
+                                     Primitive::Type anticipated_type) {
+  uint8_t source_or_dest_reg = instruction.VRegA_23x();
+  uint8_t array_reg = instruction.VRegB_23x();
+  uint8_t index_reg = instruction.VRegC_23x();
+
+  HInstruction* array = LoadLocal(array_reg, Primitive::kPrimNot);
+  current_block_->AddInstruction(new (arena_) HNullCheck(array, dex_offset));
+  HInstruction* index = LoadLocal(index_reg, Primitive::kPrimInt);
+  array = LoadLocal(array_reg, Primitive::kPrimNot);
+  current_block_->AddInstruction(new (arena_) HBoundsCheck(index, array, dex_offset));
+
+  array = LoadLocal(array_reg, Primitive::kPrimNot);
+  index = LoadLocal(index_reg, Primitive::kPrimInt);
+  if (is_put) {
+    HInstruction* value = LoadLocal(source_or_dest_reg, anticipated_type);
+    current_block_->AddInstruction(
+        new (arena_) HArraySet(array, index, value, anticipated_type, dex_offset));
+  } else {
+    current_block_->AddInstruction(new (arena_) HArrayGet(array, index, anticipated_type));
+    UpdateLocal(source_or_dest_reg, current_block_->GetLastInstruction());
+  }
+}
+
 bool HGraphBuilder::AnalyzeDexInstruction(const Instruction& instruction, int32_t dex_offset) {
   if (current_block_ == nullptr) {
     return true;  // Dead code
@@ -382,6 +598,56 @@ bool HGraphBuilder::AnalyzeDexInstruction(const Instruction& instruction, int32_
       break;
     }
 
+    case Instruction::IF_LT: {
+      If_22t<HLessThan>(instruction, dex_offset, false);
+      break;
+    }
+
+    case Instruction::IF_LE: {
+      If_22t<HLessThanOrEqual>(instruction, dex_offset, false);
+      break;
+    }
+
+    case Instruction::IF_GT: {
+      If_22t<HGreaterThan>(instruction, dex_offset, false);
+      break;
+    }
+
+    case Instruction::IF_GE: {
+      If_22t<HGreaterThanOrEqual>(instruction, dex_offset, false);
+      break;
+    }
+
+    case Instruction::IF_EQZ: {
+      If_21t<HEqual>(instruction, dex_offset, false);
+      break;
+    }
+
+    case Instruction::IF_NEZ: {
+      If_21t<HEqual>(instruction, dex_offset, true);
+      break;
+    }
+
+    case Instruction::IF_LTZ: {
+      If_21t<HLessThan>(instruction, dex_offset, false);
+      break;
+    }
+
+    case Instruction::IF_LEZ: {
+      If_21t<HLessThanOrEqual>(instruction, dex_offset, false);
+      break;
+    }
+
+    case Instruction::IF_GTZ: {
+      If_21t<HGreaterThan>(instruction, dex_offset, false);
+      break;
+    }
+
+    case Instruction::IF_GEZ: {
+      If_21t<HGreaterThanOrEqual>(instruction, dex_offset, false);
+      break;
+    }
+
     case Instruction::GOTO:
     case Instruction::GOTO_16:
     case Instruction::GOTO_32: {
@@ -409,7 +675,9 @@ bool HGraphBuilder::AnalyzeDexInstruction(const Instruction& instruction, int32_
     }
 
     case Instruction::INVOKE_STATIC:
-    case Instruction::INVOKE_DIRECT: {
+    case Instruction::INVOKE_DIRECT:
+    case Instruction::INVOKE_VIRTUAL:
+    case Instruction::INVOKE_INTERFACE: {
       uint32_t method_idx = instruction.VRegB_35c();
       uint32_t number_of_vreg_arguments = instruction.VRegA_35c();
       uint32_t args[5];
@@ -421,7 +689,9 @@ bool HGraphBuilder::AnalyzeDexInstruction(const Instruction& instruction, int32_
     }
 
     case Instruction::INVOKE_STATIC_RANGE:
-    case Instruction::INVOKE_DIRECT_RANGE: {
+    case Instruction::INVOKE_DIRECT_RANGE:
+    case Instruction::INVOKE_VIRTUAL_RANGE:
+    case Instruction::INVOKE_INTERFACE_RANGE: {
       uint32_t method_idx = instruction.VRegB_3rc();
       uint32_t number_of_vreg_arguments = instruction.VRegA_3rc();
       uint32_t register_index = instruction.VRegC();
@@ -492,6 +762,281 @@ bool HGraphBuilder::AnalyzeDexInstruction(const Instruction& instruction, int32_
       break;
     }
 
+    case Instruction::MUL_INT: {
+      Binop_32x<HMul>(instruction, Primitive::kPrimInt);
+      break;
+    }
+
+    case Instruction::MUL_INT_2ADDR: {
+      Binop_12x<HMul>(instruction, Primitive::kPrimInt);
+      break;
+    }
+
+    case Instruction::MUL_INT_LIT16: {
+      Binop_22s<HMul>(instruction, false);
+      break;
+    }
+
+    case Instruction::MUL_INT_LIT8: {
+      Binop_22b<HMul>(instruction, false);
+      break;
+    }
+
+    case Instruction::DIV_INT: {
+      Binop_32x<HDiv>(instruction, Primitive::kPrimInt, dex_offset);
+      break;
+    }
+
+    case Instruction::DIV_INT_2ADDR: {
+      Binop_12x<HDiv>(instruction, Primitive::kPrimInt, dex_offset);
+      break;
+    }
+
+    case Instruction::DIV_INT_LIT16: {
+      Binop_22s<HDiv>(instruction, false, dex_offset);
+      break;
+    }
+
+    case Instruction::DIV_INT_LIT8: {
+      Binop_22b<HDiv>(instruction, false, dex_offset);
+      break;
+    }
+
+    case Instruction::REM_INT: {
+      Binop_32x<HRem>(instruction, Primitive::kPrimInt, dex_offset);
+      break;
+    }
+
+    case Instruction::REM_INT_2ADDR: {
+      Binop_12x<HRem>(instruction, Primitive::kPrimInt, dex_offset);
+      break;
+    }
+
+    case Instruction::REM_INT_LIT16: {
+      Binop_22s<HRem>(instruction, false, dex_offset);
+      break;
+    }
+
+    case Instruction::REM_INT_LIT8: {
+      Binop_22b<HRem>(instruction, false, dex_offset);
+      break;
+    }
+
+    case Instruction::SHL_INT: {
+      Binop_32x<HShl>(instruction, Primitive::kPrimInt);
+      break;
+    }
+
+    case Instruction::SHR_INT: {
+      Binop_32x<HShr>(instruction, Primitive::kPrimInt);
+      break;
+    }
+
+    case Instruction::USHR_INT: {
+      Binop_32x<HUShr>(instruction, Primitive::kPrimInt);
+      break;
+    }
+
+    case Instruction::SHL_INT_2ADDR: {
+      Binop_12x<HShl>(instruction, Primitive::kPrimInt);
+      break;
+    }
+
+    case Instruction::SHR_INT_2ADDR: {
+      Binop_12x<HShr>(instruction, Primitive::kPrimInt);
+      break;
+    }
+
+    case Instruction::USHR_INT_2ADDR: {
+      Binop_12x<HUShr>(instruction, Primitive::kPrimInt);
+      break;
+    }
+
+    case Instruction::SHL_INT_LIT8: {
+      Binop_22b<HShl>(instruction, false);
+      break;
+    }
+
+    case Instruction::SHR_INT_LIT8: {
+      Binop_22b<HShr>(instruction, false);
+      break;
+    }
+
+    case Instruction::USHR_INT_LIT8: {
+      Binop_22b<HUShr>(instruction, false);
+      break;
+    }
+
+    case Instruction::CMP_LONG: {
+      HInstruction* first = LoadLocal(instruction.VRegB(), Primitive::kPrimLong);
+      HInstruction* second = LoadLocal(instruction.VRegC(), Primitive::kPrimLong);
+      current_block_->AddInstruction(new (arena_) HCompare(Primitive::kPrimLong, first, second));
+      UpdateLocal(instruction.VRegA(), current_block_->GetLastInstruction());
+      break;
+    }
+
+    case Instruction::IGET:
+    case Instruction::IPUT: {
+      if (!BuildInstanceFieldAccess(instruction, dex_offset,
+                                    instruction.Opcode() == Instruction::IPUT,
+                                    Primitive::kPrimInt)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::IGET_WIDE:
+    case Instruction::IPUT_WIDE: {
+      if (!BuildInstanceFieldAccess(instruction, dex_offset,
+                                    instruction.Opcode() == Instruction::IPUT_WIDE,
+                                    Primitive::kPrimLong)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::IGET_OBJECT:
+    case Instruction::IPUT_OBJECT: {
+      if (!BuildInstanceFieldAccess(instruction, dex_offset,
+                                    instruction.Opcode() == Instruction::IPUT_OBJECT,
+                                    Primitive::kPrimNot)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::IGET_BOOLEAN:
+    case Instruction::IPUT_BOOLEAN: {
+      if (!BuildInstanceFieldAccess(instruction, dex_offset,
+                                    instruction.Opcode() == Instruction::IPUT_BOOLEAN,
+                                    Primitive::kPrimBoolean)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::IGET_BYTE:
+    case Instruction::IPUT_BYTE: {
+      if (!BuildInstanceFieldAccess(instruction, dex_offset,
+                                    instruction.Opcode() == Instruction::IPUT_BYTE,
+                                    Primitive::kPrimByte)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::IGET_CHAR:
+    case Instruction::IPUT_CHAR: {
+      if (!BuildInstanceFieldAccess(instruction, dex_offset,
+                                    instruction.Opcode() == Instruction::IPUT_CHAR,
+                                    Primitive::kPrimChar)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::IGET_SHORT:
+    case Instruction::IPUT_SHORT: {
+      if (!BuildInstanceFieldAccess(instruction, dex_offset,
+                                    instruction.Opcode() == Instruction::IPUT_SHORT,
+                                    Primitive::kPrimShort)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::SGET:
+    case Instruction::SPUT: {
+      if (!BuildStaticFieldAccess(instruction, instruction.Opcode() == Instruction::SPUT,
+                                  Primitive::kPrimInt)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::SGET_WIDE:
+    case Instruction::SPUT_WIDE: {
+      if (!BuildStaticFieldAccess(instruction, instruction.Opcode() == Instruction::SPUT_WIDE,
+                                  Primitive::kPrimLong)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::SGET_OBJECT:
+    case Instruction::SPUT_OBJECT: {
+      if (!BuildStaticFieldAccess(instruction, instruction.Opcode() == Instruction::SPUT_OBJECT,
+                                  Primitive::kPrimNot)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::SGET_BOOLEAN:
+    case Instruction::SPUT_BOOLEAN: {
+      if (!BuildStaticFieldAccess(instruction, instruction.Opcode() == Instruction::SPUT_BOOLEAN,
+                                  Primitive::kPrimBoolean)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::SGET_BYTE:
+    case Instruction::SPUT_BYTE: {
+      if (!BuildStaticFieldAccess(instruction, instruction.Opcode() == Instruction::SPUT_BYTE,
+                                  Primitive::kPrimByte)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::SGET_CHAR:
+    case Instruction::SPUT_CHAR: {
+      if (!BuildStaticFieldAccess(instruction, instruction.Opcode() == Instruction::SPUT_CHAR,
+                                  Primitive::kPrimChar)) {
+        return false;
+      }
+      break;
+    }
+
+    case Instruction::SGET_SHORT:
+    case Instruction::SPUT_SHORT: {
+      if (!BuildStaticFieldAccess(instruction, instruction.Opcode() == Instruction::SPUT_SHORT,
+                                  Primitive::kPrimShort)) {
+        return false;
+      }
+      break;
+    }
+
+#define ARRAY_XX(kind, anticipated_type)                                          \
+    case Instruction::AGET##kind: {                                               \
+      BuildArrayAccess(instruction, dex_offset, false, anticipated_type);         \
+      break;                                                                      \
+    }                                                                             \
+    case Instruction::APUT##kind: {                                               \
+      BuildArrayAccess(instruction, dex_offset, true, anticipated_type);          \
+      break;                                                                      \
+    }
+
+    ARRAY_XX(, Primitive::kPrimInt);
+    ARRAY_XX(_WIDE, Primitive::kPrimLong);
+    ARRAY_XX(_OBJECT, Primitive::kPrimNot);
+    ARRAY_XX(_BOOLEAN, Primitive::kPrimBoolean);
+    ARRAY_XX(_BYTE, Primitive::kPrimByte);
+    ARRAY_XX(_CHAR, Primitive::kPrimChar);
+    ARRAY_XX(_SHORT, Primitive::kPrimShort);
+
+#undef ARRAY_XX
+
+    case Instruction::ARRAY_LENGTH: {
+      HInstruction* array = LoadLocal(instruction.VRegB_12x(), Primitive::kPrimNot);
+      current_block_->AddInstruction(new (arena_) HNullCheck(array, dex_offset));
+      array = LoadLocal(instruction.VRegB_12x(), Primitive::kPrimNot);
+      current_block_->AddInstruction(new (arena_) HArrayLength(array));
+      UpdateLocal(instruction.VRegA_12x(), current_block_->GetLastInstruction());
+      break;
+    }
+
     case Instruction::NEW_INSTANCE: {
       current_block_->AddInstruction(
           new (arena_) HNewInstance(dex_offset, instruction.VRegB_21c()));
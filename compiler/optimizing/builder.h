@@ -26,6 +26,7 @@
 namespace art {
 
 class ArenaAllocator;
+class CompilerDriver;
 class Instruction;
 class HBasicBlock;
 class HGraph;
@@ -38,7 +39,8 @@ class HGraphBuilder : public ValueObject {
  public:
   HGraphBuilder(ArenaAllocator* arena,
                 DexCompilationUnit* dex_compilation_unit = nullptr,
-                const DexFile* dex_file = nullptr)
+                const DexFile* dex_file = nullptr,
+                CompilerDriver* driver = nullptr)
       : arena_(arena),
         branch_targets_(arena, 0),
         locals_(arena, 0),
@@ -49,7 +51,8 @@ class HGraphBuilder : public ValueObject {
         constant0_(nullptr),
         constant1_(nullptr),
         dex_file_(dex_file),
-        dex_compilation_unit_(dex_compilation_unit) { }
+        dex_compilation_unit_(dex_compilation_unit),
+        compiler_driver_(driver) { }
 
   HGraph* BuildGraph(const DexFile::CodeItem& code);
 
@@ -90,10 +93,40 @@ class HGraphBuilder : public ValueObject {
   template<typename T>
   void Binop_22s(const Instruction& instruction, bool reverse);
 
+  // Variants for the binary operations that can throw, and need their dex pc.
+  template<typename T>
+  void Binop_32x(const Instruction& instruction, Primitive::Type type, uint32_t dex_offset);
+
+  template<typename T>
+  void Binop_12x(const Instruction& instruction, Primitive::Type type, uint32_t dex_offset);
+
+  template<typename T>
+  void Binop_22b(const Instruction& instruction, bool reverse, uint32_t dex_offset);
+
+  template<typename T>
+  void Binop_22s(const Instruction& instruction, bool reverse, uint32_t dex_offset);
+
   template<typename T> void If_22t(const Instruction& instruction, int32_t dex_offset, bool is_not);
+  template<typename T> void If_21t(const Instruction& instruction, int32_t dex_offset, bool is_not);
 
   void BuildReturn(const Instruction& instruction, Primitive::Type type);
 
+  // Builds an instance field access node and returns whether the instruction is supported.
+  bool BuildInstanceFieldAccess(const Instruction& instruction,
+                                uint32_t dex_offset,
+                                bool is_put,
+                                Primitive::Type field_type);
+
+  // Builds a static field access node and returns whether the instruction is supported.
+  bool BuildStaticFieldAccess(const Instruction& instruction,
+                              bool is_put,
+                              Primitive::Type field_type);
+
+  void BuildArrayAccess(const Instruction& instruction,
+                        uint32_t dex_offset,
+                        bool is_put,
+                        Primitive::Type anticipated_type);
+
   // Builds an invocation node and returns whether the instruction is supported.
   bool BuildInvoke(const Instruction& instruction,
                    uint32_t dex_offset,
@@ -122,6 +155,7 @@ class HGraphBuilder : public ValueObject {
 
   const DexFile* const dex_file_;
   DexCompilationUnit* const dex_compilation_unit_;
+  CompilerDriver* const compiler_driver_;
 
   DISALLOW_COPY_AND_ASSIGN(HGraphBuilder);
 };
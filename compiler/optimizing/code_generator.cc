@@ -20,12 +20,10 @@
 #include "code_generator_x86.h"
 #include "dex/verified_method.h"
 #include "driver/dex_compilation_unit.h"
-#include "gc_map_builder.h"
-#include "leb128.h"
-#include "mapping_table.h"
+#include "stack_map_stream.h"
+#include "utils/arena_bit_vector.h"
 #include "utils/assembler.h"
 #include "verifier/dex_gc_map.h"
-#include "vmap_table.h"
 
 namespace art {
 
@@ -37,6 +35,9 @@ void CodeGenerator::Compile(CodeAllocator* allocator) {
   for (size_t i = 0, e = blocks.Size(); i < e; ++i) {
     CompileBlock(blocks.Get(i));
   }
+  for (size_t i = 0, e = slow_paths_.Size(); i < e; ++i) {
+    slow_paths_.Get(i)->EmitNativeCode(this);
+  }
   size_t code_size = GetAssembler()->CodeSize();
   uint8_t* buffer = allocator->Allocate(code_size);
   MemoryRegion code(buffer, code_size);
@@ -197,100 +198,38 @@ CodeGenerator* CodeGenerator::Create(ArenaAllocator* allocator,
   }
 }
 
-void CodeGenerator::BuildNativeGCMap(
+void CodeGenerator::BuildStackMaps(
     std::vector<uint8_t>* data, const DexCompilationUnit& dex_compilation_unit) const {
   const std::vector<uint8_t>& gc_map_raw =
       dex_compilation_unit.GetVerifiedMethod()->GetDexGcMap();
   verifier::DexPcToReferenceMap dex_gc_map(&(gc_map_raw)[0]);
+  const uint16_t number_of_dex_registers = GetGraph()->GetNumberOfVRegs();
+  // The verifier only keeps the registers up to the last one holding a reference.
+  const size_t number_of_reference_registers =
+      std::min<size_t>(dex_gc_map.RegWidth() * kBitsPerByte, number_of_dex_registers);
 
-  uint32_t max_native_offset = 0;
-  for (size_t i = 0; i < pc_infos_.Size(); i++) {
-    uint32_t native_offset = pc_infos_.Get(i).native_pc;
-    if (native_offset > max_native_offset) {
-      max_native_offset = native_offset;
-    }
-  }
-
-  GcMapBuilder builder(data, pc_infos_.Size(), max_native_offset, dex_gc_map.RegWidth());
+  StackMapStream stream(GetGraph()->GetArena());
+  ArenaBitVector stack_mask(GetGraph()->GetArena(), 0, true);
   for (size_t i = 0; i < pc_infos_.Size(); i++) {
     struct PcInfo pc_info = pc_infos_.Get(i);
-    uint32_t native_offset = pc_info.native_pc;
-    uint32_t dex_pc = pc_info.dex_pc;
-    const uint8_t* references = dex_gc_map.FindBitMap(dex_pc, false);
-    CHECK(references != NULL) << "Missing ref for dex pc 0x" << std::hex << dex_pc;
-    builder.AddEntry(native_offset, references);
-  }
-}
-
-void CodeGenerator::BuildMappingTable(std::vector<uint8_t>* data) const {
-  uint32_t pc2dex_data_size = 0u;
-  uint32_t pc2dex_entries = pc_infos_.Size();
-  uint32_t pc2dex_offset = 0u;
-  int32_t pc2dex_dalvik_offset = 0;
-  uint32_t dex2pc_data_size = 0u;
-  uint32_t dex2pc_entries = 0u;
-
-  // We currently only have pc2dex entries.
-  for (size_t i = 0; i < pc2dex_entries; i++) {
-    struct PcInfo pc_info = pc_infos_.Get(i);
-    pc2dex_data_size += UnsignedLeb128Size(pc_info.native_pc - pc2dex_offset);
-    pc2dex_data_size += SignedLeb128Size(pc_info.dex_pc - pc2dex_dalvik_offset);
-    pc2dex_offset = pc_info.native_pc;
-    pc2dex_dalvik_offset = pc_info.dex_pc;
-  }
-
-  uint32_t total_entries = pc2dex_entries + dex2pc_entries;
-  uint32_t hdr_data_size = UnsignedLeb128Size(total_entries) + UnsignedLeb128Size(pc2dex_entries);
-  uint32_t data_size = hdr_data_size + pc2dex_data_size + dex2pc_data_size;
-  data->resize(data_size);
-
-  uint8_t* data_ptr = &(*data)[0];
-  uint8_t* write_pos = data_ptr;
-  write_pos = EncodeUnsignedLeb128(write_pos, total_entries);
-  write_pos = EncodeUnsignedLeb128(write_pos, pc2dex_entries);
-  DCHECK_EQ(static_cast<size_t>(write_pos - data_ptr), hdr_data_size);
-  uint8_t* write_pos2 = write_pos + pc2dex_data_size;
-
-  pc2dex_offset = 0u;
-  pc2dex_dalvik_offset = 0u;
-  for (size_t i = 0; i < pc2dex_entries; i++) {
-    struct PcInfo pc_info = pc_infos_.Get(i);
-    DCHECK(pc2dex_offset <= pc_info.native_pc);
-    write_pos = EncodeUnsignedLeb128(write_pos, pc_info.native_pc - pc2dex_offset);
-    write_pos = EncodeSignedLeb128(write_pos, pc_info.dex_pc - pc2dex_dalvik_offset);
-    pc2dex_offset = pc_info.native_pc;
-    pc2dex_dalvik_offset = pc_info.dex_pc;
-  }
-  DCHECK_EQ(static_cast<size_t>(write_pos - data_ptr), hdr_data_size + pc2dex_data_size);
-  DCHECK_EQ(static_cast<size_t>(write_pos2 - data_ptr), data_size);
-
-  if (kIsDebugBuild) {
-    // Verify the encoded table holds the expected data.
-    MappingTable table(data_ptr);
-    CHECK_EQ(table.TotalSize(), total_entries);
-    CHECK_EQ(table.PcToDexSize(), pc2dex_entries);
-    auto it = table.PcToDexBegin();
-    auto it2 = table.DexToPcBegin();
-    for (size_t i = 0; i < pc2dex_entries; i++) {
-      struct PcInfo pc_info = pc_infos_.Get(i);
-      CHECK_EQ(pc_info.native_pc, it.NativePcOffset());
-      CHECK_EQ(pc_info.dex_pc, it.DexPc());
-      ++it;
+    const uint8_t* references = dex_gc_map.FindBitMap(pc_info.dex_pc, false);
+    CHECK(references != NULL) << "Missing ref for dex pc 0x" << std::hex << pc_info.dex_pc;
+    stack_mask.ClearAllBits();
+    for (size_t reg = 0; reg < number_of_reference_registers; ++reg) {
+      if ((references[reg / kBitsPerByte] & (1 << (reg % kBitsPerByte))) != 0) {
+        int32_t offset = GetStackSlotOfDexRegister(reg);
+        DCHECK_EQ(offset % StackMap::kStackSlotSize, 0U);
+        stack_mask.SetBit(offset / StackMap::kStackSlotSize);
+      }
+    }
+    // No register holds a reference across a safepoint, the callee-saves aren't allocated.
+    stream.AddStackMapEntry(pc_info.dex_pc, pc_info.native_pc, 0, &stack_mask,
+                            number_of_dex_registers);
+    for (uint16_t reg = 0; reg < number_of_dex_registers; ++reg) {
+      stream.AddDexRegisterEntry(DexRegisterMap::kInStack, GetStackSlotOfDexRegister(reg));
     }
-    CHECK(it == table.PcToDexEnd());
-    CHECK(it2 == table.DexToPcEnd());
   }
-}
-
-void CodeGenerator::BuildVMapTable(std::vector<uint8_t>* data) const {
-  Leb128EncodingVector vmap_encoder;
-  // We currently don't use callee-saved registers.
-  size_t size = 0 + 1 /* marker */ + 0;
-  vmap_encoder.Reserve(size + 1u);  // All values are likely to be one byte in ULEB128 (<128).
-  vmap_encoder.PushBackUnsigned(size);
-  vmap_encoder.PushBackUnsigned(VmapTable::kAdjustedFpMarker);
-
-  *data = vmap_encoder.GetData();
+  stream.FillIn(data);
 }
 
 }  // namespace art
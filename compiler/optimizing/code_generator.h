@@ -29,6 +29,7 @@ namespace art {
 
 static size_t constexpr kVRegSize = 4;
 
+class CodeGenerator;
 class DexCompilationUnit;
 
 class CodeAllocator {
@@ -47,6 +48,28 @@ struct PcInfo {
   uintptr_t native_pc;
 };
 
+/**
+ * Out of line code of an instruction, emitted after the code of all blocks. The
+ * instruction jumps to the entry label; slow paths that return jump back to the
+ * exit label.
+ */
+class SlowPathCode : public ArenaObject {
+ public:
+  SlowPathCode() : entry_label_(), exit_label_() {}
+  virtual ~SlowPathCode() {}
+
+  Label* GetEntryLabel() { return &entry_label_; }
+  Label* GetExitLabel() { return &exit_label_; }
+
+  virtual void EmitNativeCode(CodeGenerator* codegen) = 0;
+
+ private:
+  Label entry_label_;
+  Label exit_label_;
+
+  DISALLOW_COPY_AND_ASSIGN(SlowPathCode);
+};
+
 class CodeGenerator : public ArenaObject {
  public:
   // Compiles the graph to executable instructions. Returns whether the compilation
@@ -81,6 +104,10 @@ class CodeGenerator : public ArenaObject {
   virtual void DumpCoreRegister(std::ostream& stream, int reg) const = 0;
   virtual void DumpFloatingPointRegister(std::ostream& stream, int reg) const = 0;
 
+  void AddSlowPath(SlowPathCode* slow_path) {
+    slow_paths_.Add(slow_path);
+  }
+
   void RecordPcInfo(uint32_t dex_pc) {
     struct PcInfo pc_info;
     pc_info.dex_pc = dex_pc;
@@ -88,9 +115,12 @@ class CodeGenerator : public ArenaObject {
     pc_infos_.Add(pc_info);
   }
 
-  void BuildMappingTable(std::vector<uint8_t>* vector) const;
-  void BuildVMapTable(std::vector<uint8_t>* vector) const;
-  void BuildNativeGCMap(
+  // The offset from the stack pointer of the slot of a dex register.
+  virtual int32_t GetStackSlotOfDexRegister(uint16_t reg_number) const = 0;
+
+  // Encodes the pc infos as stack maps, which replace the mapping table, the vmap table and the
+  // GC map. The dex registers are all in their stack slots.
+  void BuildStackMaps(
       std::vector<uint8_t>* vector, const DexCompilationUnit& dex_compilation_unit) const;
 
  protected:
@@ -99,6 +129,7 @@ class CodeGenerator : public ArenaObject {
         graph_(graph),
         block_labels_(graph->GetArena(), 0),
         pc_infos_(graph->GetArena(), 32),
+        slow_paths_(graph->GetArena(), 8),
         blocked_registers_(graph->GetArena()->AllocArray<bool>(number_of_registers)) {
     block_labels_.SetSize(graph->GetBlocks().Size());
   }
@@ -130,6 +161,7 @@ class CodeGenerator : public ArenaObject {
   // Labels for each block that will be compiled.
   GrowableArray<Label> block_labels_;
   GrowableArray<PcInfo> pc_infos_;
+  GrowableArray<SlowPathCode*> slow_paths_;
 
   // Temporary data structure used when doing register allocation.
   bool* const blocked_registers_;
@@ -20,11 +20,12 @@
 #include "utils/arm/managed_register_arm.h"
 
 #include "entrypoints/quick/quick_entrypoints.h"
+#include "gc/accounting/card_table.h"
 #include "mirror/array.h"
 #include "mirror/art_method.h"
+#include "mirror/class.h"
 #include "thread.h"
 
-#define __ reinterpret_cast<ArmAssembler*>(GetAssembler())->
 
 namespace art {
 
@@ -37,6 +38,57 @@ namespace arm {
 static constexpr int kNumberOfPushedRegistersAtEntry = 1;
 static constexpr int kCurrentMethodStackOffset = 0;
 
+#define __ reinterpret_cast<ArmAssembler*>(codegen->GetAssembler())->
+
+// Calls a runtime entry point that throws, the slow path does not return.
+class ThrowSlowPathARM : public SlowPathCode {
+ public:
+  ThrowSlowPathARM(ThreadOffset<kArmWordSize> entry_point, uint32_t dex_pc)
+      : entry_point_(entry_point), dex_pc_(dex_pc) {}
+
+  virtual void EmitNativeCode(CodeGenerator* codegen) OVERRIDE {
+    __ Bind(GetEntryLabel());
+    __ ldr(LR, Address(TR, entry_point_.Int32Value()));
+    __ blx(LR);
+    codegen->RecordPcInfo(dex_pc_);
+  }
+
+ private:
+  const ThreadOffset<kArmWordSize> entry_point_;
+  const uint32_t dex_pc_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThrowSlowPathARM);
+};
+
+#undef __
+#define __ reinterpret_cast<ArmAssembler*>(GetAssembler())->
+
+inline Condition ARMCondition(IfCondition cond) {
+  switch (cond) {
+    case kCondEQ: return EQ;
+    case kCondNE: return NE;
+    case kCondLT: return LT;
+    case kCondLE: return LE;
+    case kCondGT: return GT;
+    case kCondGE: return GE;
+  }
+  LOG(FATAL) << "Unknown if condition " << cond;
+  return EQ;
+}
+
+inline Condition ARMOppositeCondition(IfCondition cond) {
+  switch (cond) {
+    case kCondEQ: return NE;
+    case kCondNE: return EQ;
+    case kCondLT: return GE;
+    case kCondLE: return GT;
+    case kCondGT: return LE;
+    case kCondGE: return LT;
+  }
+  LOG(FATAL) << "Unknown if condition " << cond;
+  return EQ;
+}
+
 void CodeGeneratorARM::DumpCoreRegister(std::ostream& stream, int reg) const {
   stream << ArmManagedRegister::FromCoreRegister(Register(reg));
 }
@@ -54,10 +106,24 @@ static bool* GetBlockedRegisterPairs(bool* blocked_registers) {
   return blocked_registers + kNumberOfAllocIds;
 }
 
+// Blocks the register pairs that share a register with an allocated register, so
+// that the inputs of an instruction don't overlap when some of them are longs.
+static void UpdateBlockedPairRegisters(bool* blocked_registers) {
+  bool* blocked_register_pairs = GetBlockedRegisterPairs(blocked_registers);
+  for (int i = 0; i < kNumberOfRegisterPairs; i++) {
+    ArmManagedRegister pair = ArmManagedRegister::FromRegisterPair(static_cast<RegisterPair>(i));
+    if (blocked_registers[pair.AsRegisterPairLow()]
+        || blocked_registers[pair.AsRegisterPairHigh()]) {
+      blocked_register_pairs[i] = true;
+    }
+  }
+}
+
 ManagedRegister CodeGeneratorARM::AllocateFreeRegister(Primitive::Type type,
                                                        bool* blocked_registers) const {
   switch (type) {
     case Primitive::kPrimLong: {
+      UpdateBlockedPairRegisters(blocked_registers);
       size_t reg = AllocateFreeRegisterInternal(
           GetBlockedRegisterPairs(blocked_registers), kNumberOfRegisterPairs);
       ArmManagedRegister pair =
@@ -153,8 +219,7 @@ void CodeGeneratorARM::Bind(Label* label) {
   __ Bind(label);
 }
 
-int32_t CodeGeneratorARM::GetStackSlot(HLocal* local) const {
-  uint16_t reg_number = local->GetRegNumber();
+int32_t CodeGeneratorARM::GetStackSlotOfDexRegister(uint16_t reg_number) const {
   uint16_t number_of_vregs = GetGraph()->GetNumberOfVRegs();
   uint16_t number_of_in_vregs = GetGraph()->GetNumberOfInVRegs();
   if (reg_number >= number_of_vregs - number_of_in_vregs) {
@@ -426,20 +491,97 @@ void InstructionCodeGeneratorARM::VisitIf(HIf* if_instr) {
   }
 }
 
-void LocationsBuilderARM::VisitEqual(HEqual* equal) {
-  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(equal);
+void LocationsBuilderARM::HandleCondition(HCondition* condition) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(condition);
   locations->SetInAt(0, Location::RequiresRegister());
   locations->SetInAt(1, Location::RequiresRegister());
   locations->SetOut(Location::RequiresRegister());
-  equal->SetLocations(locations);
+  condition->SetLocations(locations);
 }
 
-void InstructionCodeGeneratorARM::VisitEqual(HEqual* equal) {
-  LocationSummary* locations = equal->GetLocations();
-  __ teq(locations->InAt(0).AsArm().AsCoreRegister(),
+void InstructionCodeGeneratorARM::GenerateCondition(HCondition* condition) {
+  LocationSummary* locations = condition->GetLocations();
+  Register out = locations->Out().AsArm().AsCoreRegister();
+  __ cmp(locations->InAt(0).AsArm().AsCoreRegister(),
          ShifterOperand(locations->InAt(1).AsArm().AsCoreRegister()));
-  __ mov(locations->Out().AsArm().AsCoreRegister(), ShifterOperand(1), EQ);
-  __ mov(locations->Out().AsArm().AsCoreRegister(), ShifterOperand(0), NE);
+  __ mov(out, ShifterOperand(1), ARMCondition(condition->GetCondition()));
+  __ mov(out, ShifterOperand(0), ARMOppositeCondition(condition->GetCondition()));
+}
+
+void LocationsBuilderARM::VisitEqual(HEqual* equal) {
+  HandleCondition(equal);
+}
+
+void InstructionCodeGeneratorARM::VisitEqual(HEqual* equal) {
+  GenerateCondition(equal);
+}
+
+void LocationsBuilderARM::VisitLessThan(HLessThan* less_than) {
+  HandleCondition(less_than);
+}
+
+void InstructionCodeGeneratorARM::VisitLessThan(HLessThan* less_than) {
+  GenerateCondition(less_than);
+}
+
+void LocationsBuilderARM::VisitLessThanOrEqual(HLessThanOrEqual* less_than_or_equal) {
+  HandleCondition(less_than_or_equal);
+}
+
+void InstructionCodeGeneratorARM::VisitLessThanOrEqual(HLessThanOrEqual* less_than_or_equal) {
+  GenerateCondition(less_than_or_equal);
+}
+
+void LocationsBuilderARM::VisitGreaterThan(HGreaterThan* greater_than) {
+  HandleCondition(greater_than);
+}
+
+void InstructionCodeGeneratorARM::VisitGreaterThan(HGreaterThan* greater_than) {
+  GenerateCondition(greater_than);
+}
+
+void LocationsBuilderARM::VisitGreaterThanOrEqual(HGreaterThanOrEqual* greater_than_or_equal) {
+  HandleCondition(greater_than_or_equal);
+}
+
+void InstructionCodeGeneratorARM::VisitGreaterThanOrEqual(
+    HGreaterThanOrEqual* greater_than_or_equal) {
+  GenerateCondition(greater_than_or_equal);
+}
+
+void LocationsBuilderARM::VisitCompare(HCompare* compare) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(compare);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetInAt(1, Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  compare->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitCompare(HCompare* compare) {
+  Label less, greater, done;
+  LocationSummary* locations = compare->GetLocations();
+  ArmManagedRegister left = locations->InAt(0).AsArm();
+  ArmManagedRegister right = locations->InAt(1).AsArm();
+  Register out = locations->Out().AsArm().AsCoreRegister();
+  // The output may be one of the registers of the inputs, it is only written once
+  // both words have been compared.
+  __ cmp(left.AsRegisterPairHigh(), ShifterOperand(right.AsRegisterPairHigh()));
+  __ b(&less, LT);  // Signed compare.
+  __ b(&greater, GT);  // Signed compare.
+  __ cmp(left.AsRegisterPairLow(), ShifterOperand(right.AsRegisterPairLow()));
+  // mov does not change the flags.
+  __ mov(out, ShifterOperand(0));
+  __ b(&done, EQ);
+  __ b(&less, CC);  // Unsigned compare.
+
+  __ Bind(&greater);
+  __ LoadImmediate(out, 1);
+  __ b(&done);
+
+  __ Bind(&less);
+  __ LoadImmediate(out, -1);
+
+  __ Bind(&done);
 }
 
 void LocationsBuilderARM::VisitLocal(HLocal* local) {
@@ -555,8 +697,13 @@ void InstructionCodeGeneratorARM::VisitReturn(HReturn* ret) {
 }
 
 void LocationsBuilderARM::VisitInvokeStatic(HInvokeStatic* invoke) {
+  HandleInvoke(invoke);
+}
+
+void LocationsBuilderARM::HandleInvoke(HInvoke* invoke) {
   LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(invoke);
-  locations->AddTemp(Location::RequiresRegister());
+  // The called method is passed in R0.
+  locations->AddTemp(ArmCoreLocation(R0));
 
   InvokeDexCallingConventionVisitor calling_convention_visitor;
   for (size_t i = 0; i < invoke->InputCount(); i++) {
@@ -621,6 +768,60 @@ void InstructionCodeGeneratorARM::VisitInvokeStatic(HInvokeStatic* invoke) {
   codegen_->RecordPcInfo(invoke->GetDexPc());
 }
 
+void LocationsBuilderARM::VisitInvokeVirtual(HInvokeVirtual* invoke) {
+  HandleInvoke(invoke);
+}
+
+void InstructionCodeGeneratorARM::VisitInvokeVirtual(HInvokeVirtual* invoke) {
+  Register temp = invoke->GetLocations()->GetTemp(0).AsArm().AsCoreRegister();
+  Register receiver = invoke->GetLocations()->InAt(0).AsArm().AsCoreRegister();
+  uint32_t method_offset = mirror::Array::DataOffset(sizeof(mirror::Object*)).Uint32Value() +
+      invoke->GetVTableIndex() * kArmWordSize;
+
+  // temp = receiver->klass_;
+  __ LoadFromOffset(kLoadWord, temp, receiver, mirror::Object::ClassOffset().Int32Value());
+  // temp = temp->vtable_;
+  __ LoadFromOffset(kLoadWord, temp, temp, mirror::Class::VTableOffset().Int32Value());
+  // temp = temp[vtable_index];
+  __ LoadFromOffset(kLoadWord, temp, temp, method_offset);
+  // LR = temp[offset_of_quick_compiled_code]
+  __ LoadFromOffset(kLoadWord, LR, temp,
+                    mirror::ArtMethod::EntryPointFromQuickCompiledCodeOffset().Int32Value());
+  // LR()
+  __ blx(LR);
+
+  codegen_->RecordPcInfo(invoke->GetDexPc());
+}
+
+void LocationsBuilderARM::VisitInvokeInterface(HInvokeInterface* invoke) {
+  HandleInvoke(invoke);
+  // The IMT conflict trampoline finds the target with the dex method index in R12.
+  invoke->GetLocations()->AddTemp(ArmCoreLocation(R12));
+}
+
+void InstructionCodeGeneratorARM::VisitInvokeInterface(HInvokeInterface* invoke) {
+  Register temp = invoke->GetLocations()->GetTemp(0).AsArm().AsCoreRegister();
+  Register receiver = invoke->GetLocations()->InAt(0).AsArm().AsCoreRegister();
+  uint32_t method_offset = mirror::Array::DataOffset(sizeof(mirror::Object*)).Uint32Value() +
+      invoke->GetImtIndex() * kArmWordSize;
+
+  // temp = receiver->klass_;
+  __ LoadFromOffset(kLoadWord, temp, receiver, mirror::Object::ClassOffset().Int32Value());
+  // temp = temp->imtable_;
+  __ LoadFromOffset(kLoadWord, temp, temp, mirror::Class::ImTableOffset().Int32Value());
+  // temp = temp[imt_index];
+  __ LoadFromOffset(kLoadWord, temp, temp, method_offset);
+  // LR = temp[offset_of_quick_compiled_code]
+  __ LoadFromOffset(kLoadWord, LR, temp,
+                    mirror::ArtMethod::EntryPointFromQuickCompiledCodeOffset().Int32Value());
+  // Set the hidden argument last, the loads above may use R12 as a scratch register.
+  __ LoadImmediate(R12, invoke->GetDexMethodIndex());
+  // LR()
+  __ blx(LR);
+
+  codegen_->RecordPcInfo(invoke->GetDexPc());
+}
+
 void LocationsBuilderARM::VisitAdd(HAdd* add) {
   LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(add);
   switch (add->GetResultType()) {
@@ -729,7 +930,7 @@ void InstructionCodeGeneratorARM::VisitSub(HSub* sub) {
   }
 }
 
-static constexpr Register kRuntimeParameterCoreRegisters[] = { R0, R1 };
+static constexpr Register kRuntimeParameterCoreRegisters[] = { R0, R1, R2, R3 };
 static constexpr size_t kRuntimeParameterCoreRegistersLength =
     arraysize(kRuntimeParameterCoreRegisters);
 
@@ -809,5 +1010,418 @@ void InstructionCodeGeneratorARM::VisitParallelMove(HParallelMove* instruction)
   LOG(FATAL) << "Unimplemented";
 }
 
+void LocationsBuilderARM::VisitMul(HMul* mul) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(mul);
+  switch (mul->GetResultType()) {
+    case Primitive::kPrimInt: {
+      locations->SetInAt(0, Location::RequiresRegister());
+      locations->SetInAt(1, Location::RequiresRegister());
+      locations->SetOut(Location::RequiresRegister());
+      break;
+    }
+
+    case Primitive::kPrimBoolean:
+    case Primitive::kPrimByte:
+    case Primitive::kPrimChar:
+    case Primitive::kPrimShort:
+      LOG(FATAL) << "Unexpected mul type " << mul->GetResultType();
+      break;
+
+    default:
+      LOG(FATAL) << "Unimplemented mul type " << mul->GetResultType();
+  }
+  mul->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitMul(HMul* mul) {
+  LocationSummary* locations = mul->GetLocations();
+  switch (mul->GetResultType()) {
+    case Primitive::kPrimInt:
+      __ mul(locations->Out().AsArm().AsCoreRegister(),
+             locations->InAt(0).AsArm().AsCoreRegister(),
+             locations->InAt(1).AsArm().AsCoreRegister());
+      break;
+
+    case Primitive::kPrimBoolean:
+    case Primitive::kPrimByte:
+    case Primitive::kPrimChar:
+    case Primitive::kPrimShort:
+      LOG(FATAL) << "Unexpected mul type " << mul->GetResultType();
+      break;
+
+    default:
+      LOG(FATAL) << "Unimplemented mul type " << mul->GetResultType();
+  }
+}
+
+void LocationsBuilderARM::HandleDivRem(HBinaryOperation* instruction) {
+  if (instruction->GetResultType() != Primitive::kPrimInt) {
+    LOG(FATAL) << "Unimplemented div/rem type " << instruction->GetResultType();
+  }
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  // pIdivmod returns the quotient in R0 and the remainder in R1.
+  InvokeRuntimeCallingConvention calling_convention;
+  locations->SetInAt(0, ArmCoreLocation(calling_convention.GetRegisterAt(0)));
+  locations->SetInAt(1, ArmCoreLocation(calling_convention.GetRegisterAt(1)));
+  locations->SetOut(ArmCoreLocation(instruction->AsDiv() != nullptr ? R0 : R1));
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::GenerateDivRem(HBinaryOperation* instruction,
+                                                 uint32_t dex_pc) {
+  Register divisor = instruction->GetLocations()->InAt(1).AsArm().AsCoreRegister();
+  SlowPathCode* slow_path = new (GetGraph()->GetArena()) ThrowSlowPathARM(
+      QUICK_ENTRYPOINT_OFFSET(kArmWordSize, pThrowDivZero), dex_pc);
+  codegen_->AddSlowPath(slow_path);
+  __ cmp(divisor, ShifterOperand(0));
+  __ b(slow_path->GetEntryLabel(), EQ);
+
+  int32_t offset = QUICK_ENTRYPOINT_OFFSET(kArmWordSize, pIdivmod).Int32Value();
+  __ ldr(LR, Address(TR, offset));
+  __ blx(LR);
+}
+
+void LocationsBuilderARM::VisitDiv(HDiv* div) {
+  HandleDivRem(div);
+}
+
+void InstructionCodeGeneratorARM::VisitDiv(HDiv* div) {
+  GenerateDivRem(div, div->GetDexPc());
+}
+
+void LocationsBuilderARM::VisitRem(HRem* rem) {
+  HandleDivRem(rem);
+}
+
+void InstructionCodeGeneratorARM::VisitRem(HRem* rem) {
+  GenerateDivRem(rem, rem->GetDexPc());
+}
+
+void LocationsBuilderARM::HandleShift(HBinaryOperation* instruction) {
+  if (instruction->GetResultType() != Primitive::kPrimInt) {
+    LOG(FATAL) << "Unimplemented shift type " << instruction->GetResultType();
+  }
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetInAt(1, Location::RequiresRegister());
+  // Holds the masked shift count.
+  locations->AddTemp(Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::GenerateShift(HBinaryOperation* instruction, Shift shift) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register count = locations->GetTemp(0).AsArm().AsCoreRegister();
+  // ARM uses the low byte of the count register, Java only its low five bits.
+  __ and_(count, locations->InAt(1).AsArm().AsCoreRegister(), ShifterOperand(31));
+  __ mov(locations->Out().AsArm().AsCoreRegister(),
+         ShifterOperand(locations->InAt(0).AsArm().AsCoreRegister(), shift, count));
+}
+
+void LocationsBuilderARM::VisitShl(HShl* shl) {
+  HandleShift(shl);
+}
+
+void InstructionCodeGeneratorARM::VisitShl(HShl* shl) {
+  GenerateShift(shl, LSL);
+}
+
+void LocationsBuilderARM::VisitShr(HShr* shr) {
+  HandleShift(shr);
+}
+
+void InstructionCodeGeneratorARM::VisitShr(HShr* shr) {
+  GenerateShift(shr, ASR);
+}
+
+void LocationsBuilderARM::VisitUShr(HUShr* ushr) {
+  HandleShift(ushr);
+}
+
+void InstructionCodeGeneratorARM::VisitUShr(HUShr* ushr) {
+  GenerateShift(ushr, LSR);
+}
+
+void LocationsBuilderARM::VisitNullCheck(HNullCheck* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitNullCheck(HNullCheck* instruction) {
+  SlowPathCode* slow_path = new (GetGraph()->GetArena()) ThrowSlowPathARM(
+      QUICK_ENTRYPOINT_OFFSET(kArmWordSize, pThrowNullPointer), instruction->GetDexPc());
+  codegen_->AddSlowPath(slow_path);
+  __ cmp(instruction->GetLocations()->InAt(0).AsArm().AsCoreRegister(), ShifterOperand(0));
+  __ b(slow_path->GetEntryLabel(), EQ);
+}
+
+void LocationsBuilderARM::VisitBoundsCheck(HBoundsCheck* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  // The index and the length are the arguments of pThrowArrayBounds.
+  InvokeRuntimeCallingConvention calling_convention;
+  locations->SetInAt(0, ArmCoreLocation(calling_convention.GetRegisterAt(0)));
+  locations->SetInAt(1, Location::RequiresRegister());
+  locations->AddTemp(ArmCoreLocation(calling_convention.GetRegisterAt(1)));
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitBoundsCheck(HBoundsCheck* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register index = locations->InAt(0).AsArm().AsCoreRegister();
+  Register array = locations->InAt(1).AsArm().AsCoreRegister();
+  Register length = locations->GetTemp(0).AsArm().AsCoreRegister();
+  SlowPathCode* slow_path = new (GetGraph()->GetArena()) ThrowSlowPathARM(
+      QUICK_ENTRYPOINT_OFFSET(kArmWordSize, pThrowArrayBounds), instruction->GetDexPc());
+  codegen_->AddSlowPath(slow_path);
+
+  __ LoadFromOffset(kLoadWord, length, array, mirror::Array::LengthOffset().Int32Value());
+  __ cmp(index, ShifterOperand(length));
+  // The unsigned compare also catches negative indices.
+  __ b(slow_path->GetEntryLabel(), CS);
+}
+
+void LocationsBuilderARM::VisitArrayLength(HArrayLength* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitArrayLength(HArrayLength* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  __ LoadFromOffset(kLoadWord, locations->Out().AsArm().AsCoreRegister(),
+                    locations->InAt(0).AsArm().AsCoreRegister(),
+                    mirror::Array::LengthOffset().Int32Value());
+}
+
+void CodeGeneratorARM::MarkGCCard(Register temp, Register card, Register object, Register value) {
+  Label is_null;
+  __ cmp(value, ShifterOperand(0));
+  __ b(&is_null, EQ);
+  __ LoadFromOffset(kLoadWord, card, TR, Thread::CardTableOffset<kArmWordSize>().Int32Value());
+  __ Lsr(temp, object, gc::accounting::CardTable::kCardShift);
+  __ add(temp, card, ShifterOperand(temp));
+  // The biased card table base has its low byte equal to the dirty card value.
+  __ strb(card, Address(temp, 0));
+  __ Bind(&is_null);
+}
+
+void InstructionCodeGeneratorARM::GenerateLoad(Primitive::Type type, Location out,
+                                               Register base, int32_t offset) {
+  switch (type) {
+    case Primitive::kPrimBoolean:
+      __ LoadFromOffset(kLoadUnsignedByte, out.AsArm().AsCoreRegister(), base, offset);
+      break;
+
+    case Primitive::kPrimByte:
+      __ LoadFromOffset(kLoadSignedByte, out.AsArm().AsCoreRegister(), base, offset);
+      break;
+
+    case Primitive::kPrimChar:
+      __ LoadFromOffset(kLoadUnsignedHalfword, out.AsArm().AsCoreRegister(), base, offset);
+      break;
+
+    case Primitive::kPrimShort:
+      __ LoadFromOffset(kLoadSignedHalfword, out.AsArm().AsCoreRegister(), base, offset);
+      break;
+
+    case Primitive::kPrimInt:
+    case Primitive::kPrimNot:
+      __ LoadFromOffset(kLoadWord, out.AsArm().AsCoreRegister(), base, offset);
+      break;
+
+    case Primitive::kPrimLong:
+      // ldrd loads both words before writing the registers.
+      __ LoadFromOffset(kLoadWordPair, out.AsArm().AsRegisterPairLow(), base, offset);
+      break;
+
+    case Primitive::kPrimFloat:
+    case Primitive::kPrimDouble:
+      LOG(FATAL) << "Unimplemented register type " << type;
+
+    case Primitive::kPrimVoid:
+      LOG(FATAL) << "Unreachable type " << type;
+  }
+}
+
+void InstructionCodeGeneratorARM::GenerateStore(Primitive::Type type, Location value,
+                                                Register base, int32_t offset) {
+  switch (type) {
+    case Primitive::kPrimBoolean:
+    case Primitive::kPrimByte:
+      __ StoreToOffset(kStoreByte, value.AsArm().AsCoreRegister(), base, offset);
+      break;
+
+    case Primitive::kPrimChar:
+    case Primitive::kPrimShort:
+      __ StoreToOffset(kStoreHalfword, value.AsArm().AsCoreRegister(), base, offset);
+      break;
+
+    case Primitive::kPrimInt:
+    case Primitive::kPrimNot:
+      __ StoreToOffset(kStoreWord, value.AsArm().AsCoreRegister(), base, offset);
+      break;
+
+    case Primitive::kPrimLong:
+      __ StoreToOffset(kStoreWordPair, value.AsArm().AsRegisterPairLow(), base, offset);
+      break;
+
+    case Primitive::kPrimFloat:
+    case Primitive::kPrimDouble:
+      LOG(FATAL) << "Unimplemented register type " << type;
+
+    case Primitive::kPrimVoid:
+      LOG(FATAL) << "Unreachable type " << type;
+  }
+}
+
+void LocationsBuilderARM::VisitInstanceFieldGet(HInstanceFieldGet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitInstanceFieldGet(HInstanceFieldGet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  GenerateLoad(instruction->GetType(), locations->Out(),
+               locations->InAt(0).AsArm().AsCoreRegister(),
+               instruction->GetFieldOffset().Int32Value());
+}
+
+void LocationsBuilderARM::VisitInstanceFieldSet(HInstanceFieldSet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetInAt(1, Location::RequiresRegister());
+  if (instruction->GetFieldType() == Primitive::kPrimNot) {
+    // Temporary registers for the write barrier.
+    locations->AddTemp(Location::RequiresRegister());
+    locations->AddTemp(Location::RequiresRegister());
+  }
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitInstanceFieldSet(HInstanceFieldSet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register obj = locations->InAt(0).AsArm().AsCoreRegister();
+  Primitive::Type field_type = instruction->GetFieldType();
+  GenerateStore(field_type, locations->InAt(1), obj, instruction->GetFieldOffset().Int32Value());
+  if (field_type == Primitive::kPrimNot) {
+    codegen_->MarkGCCard(locations->GetTemp(0).AsArm().AsCoreRegister(),
+                         locations->GetTemp(1).AsArm().AsCoreRegister(),
+                         obj,
+                         locations->InAt(1).AsArm().AsCoreRegister());
+  }
+}
+
+void LocationsBuilderARM::VisitStaticFieldGet(HStaticFieldGet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  // Holds the declaring class of the current method.
+  locations->AddTemp(Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitStaticFieldGet(HStaticFieldGet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register klass = locations->GetTemp(0).AsArm().AsCoreRegister();
+  LoadCurrentMethod(klass);
+  __ LoadFromOffset(kLoadWord, klass, klass,
+                    mirror::ArtMethod::DeclaringClassOffset().Int32Value());
+  GenerateLoad(instruction->GetType(), locations->Out(), klass,
+               instruction->GetFieldOffset().Int32Value());
+}
+
+void LocationsBuilderARM::VisitStaticFieldSet(HStaticFieldSet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  // Holds the declaring class of the current method.
+  locations->AddTemp(Location::RequiresRegister());
+  if (instruction->GetFieldType() == Primitive::kPrimNot) {
+    // Temporary registers for the write barrier.
+    locations->AddTemp(Location::RequiresRegister());
+    locations->AddTemp(Location::RequiresRegister());
+  }
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitStaticFieldSet(HStaticFieldSet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register klass = locations->GetTemp(0).AsArm().AsCoreRegister();
+  Primitive::Type field_type = instruction->GetFieldType();
+  LoadCurrentMethod(klass);
+  __ LoadFromOffset(kLoadWord, klass, klass,
+                    mirror::ArtMethod::DeclaringClassOffset().Int32Value());
+  GenerateStore(field_type, locations->InAt(0), klass,
+                instruction->GetFieldOffset().Int32Value());
+  if (field_type == Primitive::kPrimNot) {
+    codegen_->MarkGCCard(locations->GetTemp(1).AsArm().AsCoreRegister(),
+                         locations->GetTemp(2).AsArm().AsCoreRegister(),
+                         klass,
+                         locations->InAt(0).AsArm().AsCoreRegister());
+  }
+}
+
+void LocationsBuilderARM::VisitArrayGet(HArrayGet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetInAt(1, Location::RequiresRegister());
+  // Holds the address of the element.
+  locations->AddTemp(Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitArrayGet(HArrayGet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register address = locations->GetTemp(0).AsArm().AsCoreRegister();
+  Primitive::Type type = instruction->GetType();
+  size_t component_size = Primitive::ComponentSize(type);
+  __ add(address, locations->InAt(0).AsArm().AsCoreRegister(),
+         ShifterOperand(locations->InAt(1).AsArm().AsCoreRegister(), LSL,
+                        CTZ(component_size)));
+  GenerateLoad(type, locations->Out(), address,
+               mirror::Array::DataOffset(component_size).Int32Value());
+}
+
+void LocationsBuilderARM::VisitArraySet(HArraySet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  if (instruction->GetComponentType() == Primitive::kPrimNot) {
+    // pAputObject does the store check and marks the card.
+    InvokeRuntimeCallingConvention calling_convention;
+    locations->SetInAt(0, ArmCoreLocation(calling_convention.GetRegisterAt(0)));
+    locations->SetInAt(1, ArmCoreLocation(calling_convention.GetRegisterAt(1)));
+    locations->SetInAt(2, ArmCoreLocation(calling_convention.GetRegisterAt(2)));
+  } else {
+    locations->SetInAt(0, Location::RequiresRegister());
+    locations->SetInAt(1, Location::RequiresRegister());
+    locations->SetInAt(2, Location::RequiresRegister());
+    // Holds the address of the element.
+    locations->AddTemp(Location::RequiresRegister());
+  }
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorARM::VisitArraySet(HArraySet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Primitive::Type type = instruction->GetComponentType();
+  if (type == Primitive::kPrimNot) {
+    int32_t offset = QUICK_ENTRYPOINT_OFFSET(kArmWordSize, pAputObject).Int32Value();
+    __ ldr(LR, Address(TR, offset));
+    __ blx(LR);
+    codegen_->RecordPcInfo(instruction->GetDexPc());
+    return;
+  }
+  Register address = locations->GetTemp(0).AsArm().AsCoreRegister();
+  size_t component_size = Primitive::ComponentSize(type);
+  __ add(address, locations->InAt(0).AsArm().AsCoreRegister(),
+         ShifterOperand(locations->InAt(1).AsArm().AsCoreRegister(), LSL,
+                        CTZ(component_size)));
+  GenerateStore(type, locations->InAt(2), address,
+                mirror::Array::DataOffset(component_size).Int32Value());
+}
+
 }  // namespace arm
 }  // namespace art
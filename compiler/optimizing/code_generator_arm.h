@@ -72,6 +72,11 @@ class LocationsBuilderARM : public HGraphVisitor {
 #undef DECLARE_VISIT_INSTRUCTION
 
  private:
+  void HandleInvoke(HInvoke* invoke);
+  void HandleCondition(HCondition* condition);
+  void HandleShift(HBinaryOperation* instruction);
+  void HandleDivRem(HBinaryOperation* instruction);
+
   CodeGeneratorARM* const codegen_;
   InvokeDexCallingConventionVisitor parameter_visitor_;
 
@@ -93,6 +98,14 @@ class InstructionCodeGeneratorARM : public HGraphVisitor {
   void LoadCurrentMethod(Register reg);
 
  private:
+  void GenerateCondition(HCondition* condition);
+  void GenerateDivRem(HBinaryOperation* instruction, uint32_t dex_pc);
+  void GenerateShift(HBinaryOperation* instruction, Shift shift);
+
+  // Loads or stores a value of the given type at `base` + `offset`.
+  void GenerateLoad(Primitive::Type type, Location out, Register base, int32_t offset);
+  void GenerateStore(Primitive::Type type, Location value, Register base, int32_t offset);
+
   ArmAssembler* const assembler_;
   CodeGeneratorARM* const codegen_;
 
@@ -130,7 +143,10 @@ class CodeGeneratorARM : public CodeGenerator {
       Primitive::Type type, bool* blocked_registers) const OVERRIDE;
   virtual size_t GetNumberOfRegisters() const OVERRIDE;
 
-  int32_t GetStackSlot(HLocal* local) const;
+  int32_t GetStackSlot(HLocal* local) const {
+    return GetStackSlotOfDexRegister(local->GetRegNumber());
+  }
+  virtual int32_t GetStackSlotOfDexRegister(uint16_t reg_number) const OVERRIDE;
   virtual Location GetStackLocation(HLoadLocal* load) const OVERRIDE;
 
   virtual size_t GetNumberOfCoreRegisters() const OVERRIDE {
@@ -144,6 +160,9 @@ class CodeGeneratorARM : public CodeGenerator {
   virtual void DumpCoreRegister(std::ostream& stream, int reg) const OVERRIDE;
   virtual void DumpFloatingPointRegister(std::ostream& stream, int reg) const OVERRIDE;
 
+  // Marks the card of `object` after `value` was stored into it, unless `value` is null.
+  void MarkGCCard(Register temp, Register card, Register object, Register value);
+
  private:
   // Helper method to move a 32bits value between two locations.
   void Move32(Location destination, Location source);
@@ -20,11 +20,12 @@
 #include "utils/x86/managed_register_x86.h"
 
 #include "entrypoints/quick/quick_entrypoints.h"
+#include "gc/accounting/card_table.h"
 #include "mirror/array.h"
 #include "mirror/art_method.h"
+#include "mirror/class.h"
 #include "thread.h"
 
-#define __ reinterpret_cast<X86Assembler*>(GetAssembler())->
 
 namespace art {
 
@@ -37,6 +38,43 @@ namespace x86 {
 static constexpr int kNumberOfPushedRegistersAtEntry = 1;
 static constexpr int kCurrentMethodStackOffset = 0;
 
+#define __ reinterpret_cast<X86Assembler*>(codegen->GetAssembler())->
+
+// Calls a runtime entry point that throws, the slow path does not return.
+class ThrowSlowPathX86 : public SlowPathCode {
+ public:
+  ThrowSlowPathX86(ThreadOffset<kX86WordSize> entry_point, uint32_t dex_pc)
+      : entry_point_(entry_point), dex_pc_(dex_pc) {}
+
+  virtual void EmitNativeCode(CodeGenerator* codegen) OVERRIDE {
+    __ Bind(GetEntryLabel());
+    __ fs()->call(Address::Absolute(entry_point_));
+    codegen->RecordPcInfo(dex_pc_);
+  }
+
+ private:
+  const ThreadOffset<kX86WordSize> entry_point_;
+  const uint32_t dex_pc_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThrowSlowPathX86);
+};
+
+#undef __
+#define __ reinterpret_cast<X86Assembler*>(GetAssembler())->
+
+inline Condition X86Condition(IfCondition cond) {
+  switch (cond) {
+    case kCondEQ: return kEqual;
+    case kCondNE: return kNotEqual;
+    case kCondLT: return kLess;
+    case kCondLE: return kLessEqual;
+    case kCondGT: return kGreater;
+    case kCondGE: return kGreaterEqual;
+  }
+  LOG(FATAL) << "Unknown if condition " << cond;
+  return kEqual;
+}
+
 void CodeGeneratorX86::DumpCoreRegister(std::ostream& stream, int reg) const {
   stream << X86ManagedRegister::FromCpuRegister(Register(reg));
 }
@@ -54,10 +92,24 @@ static bool* GetBlockedRegisterPairs(bool* blocked_registers) {
   return blocked_registers + kNumberOfAllocIds;
 }
 
+// Blocks the register pairs that share a register with an allocated register, so
+// that the inputs of an instruction don't overlap when some of them are longs.
+static void UpdateBlockedPairRegisters(bool* blocked_registers) {
+  bool* blocked_register_pairs = GetBlockedRegisterPairs(blocked_registers);
+  for (int i = 0; i < kNumberOfRegisterPairs; i++) {
+    X86ManagedRegister pair = X86ManagedRegister::FromRegisterPair(static_cast<RegisterPair>(i));
+    if (blocked_registers[pair.AsRegisterPairLow()]
+        || blocked_registers[pair.AsRegisterPairHigh()]) {
+      blocked_register_pairs[i] = true;
+    }
+  }
+}
+
 ManagedRegister CodeGeneratorX86::AllocateFreeRegister(Primitive::Type type,
                                                        bool* blocked_registers) const {
   switch (type) {
     case Primitive::kPrimLong: {
+      UpdateBlockedPairRegisters(blocked_registers);
       size_t reg = AllocateFreeRegisterInternal(
           GetBlockedRegisterPairs(blocked_registers), kNumberOfRegisterPairs);
       X86ManagedRegister pair =
@@ -149,8 +201,7 @@ void InstructionCodeGeneratorX86::LoadCurrentMethod(Register reg) {
   __ movl(reg, Address(ESP, kCurrentMethodStackOffset));
 }
 
-int32_t CodeGeneratorX86::GetStackSlot(HLocal* local) const {
-  uint16_t reg_number = local->GetRegNumber();
+int32_t CodeGeneratorX86::GetStackSlotOfDexRegister(uint16_t reg_number) const {
   uint16_t number_of_vregs = GetGraph()->GetNumberOfVRegs();
   uint16_t number_of_in_vregs = GetGraph()->GetNumberOfInVRegs();
   if (reg_number >= number_of_vregs - number_of_in_vregs) {
@@ -473,16 +524,17 @@ void LocationsBuilderX86::VisitStoreLocal(HStoreLocal* store) {
 void InstructionCodeGeneratorX86::VisitStoreLocal(HStoreLocal* store) {
 }
 
-void LocationsBuilderX86::VisitEqual(HEqual* equal) {
-  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(equal);
+void LocationsBuilderX86::HandleCondition(HCondition* condition) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(condition);
   locations->SetInAt(0, Location::RequiresRegister());
   locations->SetInAt(1, Location::Any());
   locations->SetOut(Location::SameAsFirstInput());
-  equal->SetLocations(locations);
+  condition->SetLocations(locations);
 }
 
-void InstructionCodeGeneratorX86::VisitEqual(HEqual* equal) {
-  LocationSummary* locations = equal->GetLocations();
+void InstructionCodeGeneratorX86::GenerateCondition(HCondition* condition) {
+  LocationSummary* locations = condition->GetLocations();
+  Register out = locations->Out().AsX86().AsCpuRegister();
   if (locations->InAt(1).IsRegister()) {
     __ cmpl(locations->InAt(0).AsX86().AsCpuRegister(),
             locations->InAt(1).AsX86().AsCpuRegister());
@@ -490,7 +542,93 @@ void InstructionCodeGeneratorX86::VisitEqual(HEqual* equal) {
     __ cmpl(locations->InAt(0).AsX86().AsCpuRegister(),
             Address(ESP, locations->InAt(1).GetStackIndex()));
   }
-  __ setb(kEqual, locations->Out().AsX86().AsCpuRegister());
+  // setb only writes the low byte of the output.
+  __ setb(X86Condition(condition->GetCondition()), out);
+  __ movzxb(out, X86ManagedRegister::FromCpuRegister(out).AsByteRegister());
+}
+
+void LocationsBuilderX86::VisitEqual(HEqual* equal) {
+  HandleCondition(equal);
+}
+
+void InstructionCodeGeneratorX86::VisitEqual(HEqual* equal) {
+  GenerateCondition(equal);
+}
+
+void LocationsBuilderX86::VisitLessThan(HLessThan* less_than) {
+  HandleCondition(less_than);
+}
+
+void InstructionCodeGeneratorX86::VisitLessThan(HLessThan* less_than) {
+  GenerateCondition(less_than);
+}
+
+void LocationsBuilderX86::VisitLessThanOrEqual(HLessThanOrEqual* less_than_or_equal) {
+  HandleCondition(less_than_or_equal);
+}
+
+void InstructionCodeGeneratorX86::VisitLessThanOrEqual(HLessThanOrEqual* less_than_or_equal) {
+  GenerateCondition(less_than_or_equal);
+}
+
+void LocationsBuilderX86::VisitGreaterThan(HGreaterThan* greater_than) {
+  HandleCondition(greater_than);
+}
+
+void InstructionCodeGeneratorX86::VisitGreaterThan(HGreaterThan* greater_than) {
+  GenerateCondition(greater_than);
+}
+
+void LocationsBuilderX86::VisitGreaterThanOrEqual(HGreaterThanOrEqual* greater_than_or_equal) {
+  HandleCondition(greater_than_or_equal);
+}
+
+void InstructionCodeGeneratorX86::VisitGreaterThanOrEqual(
+    HGreaterThanOrEqual* greater_than_or_equal) {
+  GenerateCondition(greater_than_or_equal);
+}
+
+void LocationsBuilderX86::VisitCompare(HCompare* compare) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(compare);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetInAt(1, Location::Any());
+  locations->SetOut(Location::RequiresRegister());
+  compare->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitCompare(HCompare* compare) {
+  Label less, greater, done;
+  LocationSummary* locations = compare->GetLocations();
+  X86ManagedRegister left = locations->InAt(0).AsX86();
+  Location right = locations->InAt(1);
+  Register out = locations->Out().AsX86().AsCpuRegister();
+  // The output may be one of the registers of the left input, it is only written once
+  // both words have been compared.
+  if (right.IsRegister()) {
+    __ cmpl(left.AsRegisterPairHigh(), right.AsX86().AsRegisterPairHigh());
+  } else {
+    __ cmpl(left.AsRegisterPairHigh(), Address(ESP, right.GetHighStackIndex(kX86WordSize)));
+  }
+  __ j(kLess, &less);  // Signed compare.
+  __ j(kGreater, &greater);  // Signed compare.
+  if (right.IsRegister()) {
+    __ cmpl(left.AsRegisterPairLow(), right.AsX86().AsRegisterPairLow());
+  } else {
+    __ cmpl(left.AsRegisterPairLow(), Address(ESP, right.GetStackIndex()));
+  }
+  // movl does not change the flags.
+  __ movl(out, Immediate(0));
+  __ j(kEqual, &done);
+  __ j(kBelow, &less);  // Unsigned compare.
+
+  __ Bind(&greater);
+  __ movl(out, Immediate(1));
+  __ jmp(&done);
+
+  __ Bind(&less);
+  __ movl(out, Immediate(-1));
+
+  __ Bind(&done);
 }
 
 void LocationsBuilderX86::VisitIntConstant(HIntConstant* constant) {
@@ -566,8 +704,13 @@ void InstructionCodeGeneratorX86::VisitReturn(HReturn* ret) {
 }
 
 void LocationsBuilderX86::VisitInvokeStatic(HInvokeStatic* invoke) {
+  HandleInvoke(invoke);
+}
+
+void LocationsBuilderX86::HandleInvoke(HInvoke* invoke) {
   LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(invoke);
-  locations->AddTemp(Location::RequiresRegister());
+  // The called method is passed in EAX.
+  locations->AddTemp(X86CpuLocation(EAX));
 
   InvokeDexCallingConventionVisitor calling_convention_visitor;
   for (size_t i = 0; i < invoke->InputCount(); i++) {
@@ -625,6 +768,53 @@ void InstructionCodeGeneratorX86::VisitInvokeStatic(HInvokeStatic* invoke) {
   codegen_->RecordPcInfo(invoke->GetDexPc());
 }
 
+void LocationsBuilderX86::VisitInvokeVirtual(HInvokeVirtual* invoke) {
+  HandleInvoke(invoke);
+}
+
+void InstructionCodeGeneratorX86::VisitInvokeVirtual(HInvokeVirtual* invoke) {
+  Register temp = invoke->GetLocations()->GetTemp(0).AsX86().AsCpuRegister();
+  Register receiver = invoke->GetLocations()->InAt(0).AsX86().AsCpuRegister();
+  size_t method_offset = mirror::Array::DataOffset(sizeof(mirror::Object*)).Int32Value() +
+      invoke->GetVTableIndex() * kX86WordSize;
+
+  // temp = receiver->klass_;
+  __ movl(temp, Address(receiver, mirror::Object::ClassOffset().Int32Value()));
+  // temp = temp->vtable_;
+  __ movl(temp, Address(temp, mirror::Class::VTableOffset().Int32Value()));
+  // temp = temp[vtable_index];
+  __ movl(temp, Address(temp, method_offset));
+  // (temp + offset_of_quick_compiled_code)()
+  __ call(Address(temp, mirror::ArtMethod::EntryPointFromQuickCompiledCodeOffset().Int32Value()));
+
+  codegen_->RecordPcInfo(invoke->GetDexPc());
+}
+
+void LocationsBuilderX86::VisitInvokeInterface(HInvokeInterface* invoke) {
+  HandleInvoke(invoke);
+}
+
+void InstructionCodeGeneratorX86::VisitInvokeInterface(HInvokeInterface* invoke) {
+  Register temp = invoke->GetLocations()->GetTemp(0).AsX86().AsCpuRegister();
+  Register receiver = invoke->GetLocations()->InAt(0).AsX86().AsCpuRegister();
+  size_t method_offset = mirror::Array::DataOffset(sizeof(mirror::Object*)).Int32Value() +
+      invoke->GetImtIndex() * kX86WordSize;
+
+  // The IMT conflict trampoline finds the target with the dex method index in XMM0.
+  __ movl(temp, Immediate(invoke->GetDexMethodIndex()));
+  __ movd(XMM0, temp);
+  // temp = receiver->klass_;
+  __ movl(temp, Address(receiver, mirror::Object::ClassOffset().Int32Value()));
+  // temp = temp->imtable_;
+  __ movl(temp, Address(temp, mirror::Class::ImTableOffset().Int32Value()));
+  // temp = temp[imt_index];
+  __ movl(temp, Address(temp, method_offset));
+  // (temp + offset_of_quick_compiled_code)()
+  __ call(Address(temp, mirror::ArtMethod::EntryPointFromQuickCompiledCodeOffset().Int32Value()));
+
+  codegen_->RecordPcInfo(invoke->GetDexPc());
+}
+
 void LocationsBuilderX86::VisitAdd(HAdd* add) {
   LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(add);
   switch (add->GetResultType()) {
@@ -829,5 +1019,459 @@ void InstructionCodeGeneratorX86::VisitParallelMove(HParallelMove* instruction)
   LOG(FATAL) << "Unimplemented";
 }
 
+void LocationsBuilderX86::VisitMul(HMul* mul) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(mul);
+  switch (mul->GetResultType()) {
+    case Primitive::kPrimInt: {
+      locations->SetInAt(0, Location::RequiresRegister());
+      locations->SetInAt(1, Location::Any());
+      locations->SetOut(Location::SameAsFirstInput());
+      break;
+    }
+
+    case Primitive::kPrimBoolean:
+    case Primitive::kPrimByte:
+    case Primitive::kPrimChar:
+    case Primitive::kPrimShort:
+      LOG(FATAL) << "Unexpected mul type " << mul->GetResultType();
+      break;
+
+    default:
+      LOG(FATAL) << "Unimplemented mul type " << mul->GetResultType();
+  }
+  mul->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitMul(HMul* mul) {
+  LocationSummary* locations = mul->GetLocations();
+  switch (mul->GetResultType()) {
+    case Primitive::kPrimInt: {
+      DCHECK_EQ(locations->InAt(0).AsX86().AsCpuRegister(),
+                locations->Out().AsX86().AsCpuRegister());
+      if (locations->InAt(1).IsRegister()) {
+        __ imull(locations->InAt(0).AsX86().AsCpuRegister(),
+                 locations->InAt(1).AsX86().AsCpuRegister());
+      } else {
+        __ imull(locations->InAt(0).AsX86().AsCpuRegister(),
+                 Address(ESP, locations->InAt(1).GetStackIndex()));
+      }
+      break;
+    }
+
+    case Primitive::kPrimBoolean:
+    case Primitive::kPrimByte:
+    case Primitive::kPrimChar:
+    case Primitive::kPrimShort:
+      LOG(FATAL) << "Unexpected mul type " << mul->GetResultType();
+      break;
+
+    default:
+      LOG(FATAL) << "Unimplemented mul type " << mul->GetResultType();
+  }
+}
+
+void LocationsBuilderX86::HandleDivRem(HBinaryOperation* instruction) {
+  if (instruction->GetResultType() != Primitive::kPrimInt) {
+    LOG(FATAL) << "Unimplemented div/rem type " << instruction->GetResultType();
+  }
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  // idivl divides EDX:EAX, the quotient is in EAX and the remainder in EDX.
+  locations->SetInAt(0, X86CpuLocation(EAX));
+  locations->SetInAt(1, Location::RequiresRegister());
+  locations->AddTemp(X86CpuLocation(EDX));
+  locations->SetOut(X86CpuLocation(instruction->AsDiv() != nullptr ? EAX : EDX));
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::GenerateDivRem(HBinaryOperation* instruction,
+                                                 uint32_t dex_pc) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register divisor = locations->InAt(1).AsX86().AsCpuRegister();
+  DCHECK_EQ(EAX, locations->InAt(0).AsX86().AsCpuRegister());
+
+  SlowPathCode* slow_path = new (GetGraph()->GetArena()) ThrowSlowPathX86(
+      QUICK_ENTRYPOINT_OFFSET(kX86WordSize, pThrowDivZero), dex_pc);
+  codegen_->AddSlowPath(slow_path);
+  __ testl(divisor, divisor);
+  __ j(kEqual, slow_path->GetEntryLabel());
+
+  // idivl faults on kMinInt / -1, the quotient is the negated dividend and the remainder 0.
+  Label not_minus_one, done;
+  __ cmpl(divisor, Immediate(-1));
+  __ j(kNotEqual, &not_minus_one);
+  if (instruction->AsDiv() != nullptr) {
+    __ negl(EAX);
+  } else {
+    __ xorl(EDX, EDX);
+  }
+  __ jmp(&done);
+
+  __ Bind(&not_minus_one);
+  __ cdq();
+  __ idivl(divisor);
+  __ Bind(&done);
+}
+
+void LocationsBuilderX86::VisitDiv(HDiv* div) {
+  HandleDivRem(div);
+}
+
+void InstructionCodeGeneratorX86::VisitDiv(HDiv* div) {
+  GenerateDivRem(div, div->GetDexPc());
+}
+
+void LocationsBuilderX86::VisitRem(HRem* rem) {
+  HandleDivRem(rem);
+}
+
+void InstructionCodeGeneratorX86::VisitRem(HRem* rem) {
+  GenerateDivRem(rem, rem->GetDexPc());
+}
+
+void LocationsBuilderX86::HandleShift(HBinaryOperation* instruction) {
+  if (instruction->GetResultType() != Primitive::kPrimInt) {
+    LOG(FATAL) << "Unimplemented shift type " << instruction->GetResultType();
+  }
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  // The shift count must be in CL, x86 only uses its low five bits as Java requires.
+  locations->SetInAt(1, X86CpuLocation(ECX));
+  locations->SetOut(Location::SameAsFirstInput());
+  instruction->SetLocations(locations);
+}
+
+void LocationsBuilderX86::VisitShl(HShl* shl) {
+  HandleShift(shl);
+}
+
+void InstructionCodeGeneratorX86::VisitShl(HShl* shl) {
+  LocationSummary* locations = shl->GetLocations();
+  DCHECK_EQ(ECX, locations->InAt(1).AsX86().AsCpuRegister());
+  __ shll(locations->InAt(0).AsX86().AsCpuRegister(), ECX);
+}
+
+void LocationsBuilderX86::VisitShr(HShr* shr) {
+  HandleShift(shr);
+}
+
+void InstructionCodeGeneratorX86::VisitShr(HShr* shr) {
+  LocationSummary* locations = shr->GetLocations();
+  DCHECK_EQ(ECX, locations->InAt(1).AsX86().AsCpuRegister());
+  __ sarl(locations->InAt(0).AsX86().AsCpuRegister(), ECX);
+}
+
+void LocationsBuilderX86::VisitUShr(HUShr* ushr) {
+  HandleShift(ushr);
+}
+
+void InstructionCodeGeneratorX86::VisitUShr(HUShr* ushr) {
+  LocationSummary* locations = ushr->GetLocations();
+  DCHECK_EQ(ECX, locations->InAt(1).AsX86().AsCpuRegister());
+  __ shrl(locations->InAt(0).AsX86().AsCpuRegister(), ECX);
+}
+
+void LocationsBuilderX86::VisitNullCheck(HNullCheck* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::Any());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitNullCheck(HNullCheck* instruction) {
+  SlowPathCode* slow_path = new (GetGraph()->GetArena()) ThrowSlowPathX86(
+      QUICK_ENTRYPOINT_OFFSET(kX86WordSize, pThrowNullPointer), instruction->GetDexPc());
+  codegen_->AddSlowPath(slow_path);
+
+  Location obj = instruction->GetLocations()->InAt(0);
+  if (obj.IsRegister()) {
+    __ testl(obj.AsX86().AsCpuRegister(), obj.AsX86().AsCpuRegister());
+  } else {
+    __ cmpl(Address(ESP, obj.GetStackIndex()), Immediate(0));
+  }
+  __ j(kEqual, slow_path->GetEntryLabel());
+}
+
+void LocationsBuilderX86::VisitBoundsCheck(HBoundsCheck* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  // The index and the length are the arguments of pThrowArrayBounds.
+  InvokeRuntimeCallingConvention calling_convention;
+  locations->SetInAt(0, X86CpuLocation(calling_convention.GetRegisterAt(0)));
+  locations->SetInAt(1, Location::RequiresRegister());
+  locations->AddTemp(X86CpuLocation(calling_convention.GetRegisterAt(1)));
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitBoundsCheck(HBoundsCheck* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register index = locations->InAt(0).AsX86().AsCpuRegister();
+  Register array = locations->InAt(1).AsX86().AsCpuRegister();
+  Register length = locations->GetTemp(0).AsX86().AsCpuRegister();
+  SlowPathCode* slow_path = new (GetGraph()->GetArena()) ThrowSlowPathX86(
+      QUICK_ENTRYPOINT_OFFSET(kX86WordSize, pThrowArrayBounds), instruction->GetDexPc());
+  codegen_->AddSlowPath(slow_path);
+
+  __ movl(length, Address(array, mirror::Array::LengthOffset().Int32Value()));
+  __ cmpl(index, length);
+  // The unsigned compare also catches negative indices.
+  __ j(kAboveEqual, slow_path->GetEntryLabel());
+}
+
+void LocationsBuilderX86::VisitArrayLength(HArrayLength* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitArrayLength(HArrayLength* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  __ movl(locations->Out().AsX86().AsCpuRegister(),
+          Address(locations->InAt(0).AsX86().AsCpuRegister(),
+                  mirror::Array::LengthOffset().Int32Value()));
+}
+
+void CodeGeneratorX86::MarkGCCard(Register temp, Register card, Register object, Register value) {
+  Label is_null;
+  __ testl(value, value);
+  __ j(kEqual, &is_null);
+  __ fs()->movl(card, Address::Absolute(Thread::CardTableOffset<kX86WordSize>()));
+  __ movl(temp, object);
+  __ shrl(temp, Immediate(gc::accounting::CardTable::kCardShift));
+  // The biased card table base has its low byte equal to the dirty card value.
+  __ movb(Address(temp, card, TIMES_1, 0),
+          X86ManagedRegister::FromCpuRegister(card).AsByteRegister());
+  __ Bind(&is_null);
+}
+
+void InstructionCodeGeneratorX86::GenerateLoad(Primitive::Type type, Location out,
+                                               const Address& low, const Address& high,
+                                               Register base, Register index) {
+  switch (type) {
+    case Primitive::kPrimBoolean:
+      __ movzxb(out.AsX86().AsCpuRegister(), low);
+      break;
+
+    case Primitive::kPrimByte:
+      __ movsxb(out.AsX86().AsCpuRegister(), low);
+      break;
+
+    case Primitive::kPrimChar:
+      __ movzxw(out.AsX86().AsCpuRegister(), low);
+      break;
+
+    case Primitive::kPrimShort:
+      __ movsxw(out.AsX86().AsCpuRegister(), low);
+      break;
+
+    case Primitive::kPrimInt:
+    case Primitive::kPrimNot:
+      __ movl(out.AsX86().AsCpuRegister(), low);
+      break;
+
+    case Primitive::kPrimLong: {
+      // Don't overwrite the address registers before the second load.
+      Register out_low = out.AsX86().AsRegisterPairLow();
+      if (out_low == base || out_low == index) {
+        __ movl(out.AsX86().AsRegisterPairHigh(), high);
+        __ movl(out_low, low);
+      } else {
+        __ movl(out_low, low);
+        __ movl(out.AsX86().AsRegisterPairHigh(), high);
+      }
+      break;
+    }
+
+    case Primitive::kPrimFloat:
+    case Primitive::kPrimDouble:
+      LOG(FATAL) << "Unimplemented register type " << type;
+
+    case Primitive::kPrimVoid:
+      LOG(FATAL) << "Unreachable type " << type;
+  }
+}
+
+void InstructionCodeGeneratorX86::GenerateStore(Primitive::Type type, Location value,
+                                                const Address& low, const Address& high) {
+  switch (type) {
+    case Primitive::kPrimBoolean:
+    case Primitive::kPrimByte:
+      __ movb(low, value.AsX86().AsByteRegister());
+      break;
+
+    case Primitive::kPrimChar:
+    case Primitive::kPrimShort:
+      __ movw(low, value.AsX86().AsCpuRegister());
+      break;
+
+    case Primitive::kPrimInt:
+    case Primitive::kPrimNot:
+      __ movl(low, value.AsX86().AsCpuRegister());
+      break;
+
+    case Primitive::kPrimLong:
+      __ movl(low, value.AsX86().AsRegisterPairLow());
+      __ movl(high, value.AsX86().AsRegisterPairHigh());
+      break;
+
+    case Primitive::kPrimFloat:
+    case Primitive::kPrimDouble:
+      LOG(FATAL) << "Unimplemented register type " << type;
+
+    case Primitive::kPrimVoid:
+      LOG(FATAL) << "Unreachable type " << type;
+  }
+}
+
+void LocationsBuilderX86::VisitInstanceFieldGet(HInstanceFieldGet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitInstanceFieldGet(HInstanceFieldGet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register obj = locations->InAt(0).AsX86().AsCpuRegister();
+  uint32_t offset = instruction->GetFieldOffset().Uint32Value();
+  GenerateLoad(instruction->GetType(), locations->Out(), Address(obj, offset),
+               Address(obj, offset + kX86WordSize), obj, obj);
+}
+
+void LocationsBuilderX86::VisitInstanceFieldSet(HInstanceFieldSet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetInAt(1, Location::RequiresRegister());
+  if (instruction->GetFieldType() == Primitive::kPrimNot) {
+    // Temporary registers for the write barrier.
+    locations->AddTemp(Location::RequiresRegister());
+    locations->AddTemp(Location::RequiresRegister());
+  }
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitInstanceFieldSet(HInstanceFieldSet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register obj = locations->InAt(0).AsX86().AsCpuRegister();
+  uint32_t offset = instruction->GetFieldOffset().Uint32Value();
+  Primitive::Type field_type = instruction->GetFieldType();
+  GenerateStore(field_type, locations->InAt(1), Address(obj, offset),
+                Address(obj, offset + kX86WordSize));
+  if (field_type == Primitive::kPrimNot) {
+    codegen_->MarkGCCard(locations->GetTemp(0).AsX86().AsCpuRegister(),
+                         locations->GetTemp(1).AsX86().AsCpuRegister(),
+                         obj,
+                         locations->InAt(1).AsX86().AsCpuRegister());
+  }
+}
+
+void LocationsBuilderX86::VisitStaticFieldGet(HStaticFieldGet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  // Holds the declaring class of the current method.
+  locations->AddTemp(Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitStaticFieldGet(HStaticFieldGet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register klass = locations->GetTemp(0).AsX86().AsCpuRegister();
+  uint32_t offset = instruction->GetFieldOffset().Uint32Value();
+  LoadCurrentMethod(klass);
+  __ movl(klass, Address(klass, mirror::ArtMethod::DeclaringClassOffset().Int32Value()));
+  GenerateLoad(instruction->GetType(), locations->Out(), Address(klass, offset),
+               Address(klass, offset + kX86WordSize), klass, klass);
+}
+
+void LocationsBuilderX86::VisitStaticFieldSet(HStaticFieldSet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  // Holds the declaring class of the current method.
+  locations->AddTemp(Location::RequiresRegister());
+  if (instruction->GetFieldType() == Primitive::kPrimNot) {
+    // Temporary registers for the write barrier.
+    locations->AddTemp(Location::RequiresRegister());
+    locations->AddTemp(Location::RequiresRegister());
+  }
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitStaticFieldSet(HStaticFieldSet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register klass = locations->GetTemp(0).AsX86().AsCpuRegister();
+  uint32_t offset = instruction->GetFieldOffset().Uint32Value();
+  Primitive::Type field_type = instruction->GetFieldType();
+  LoadCurrentMethod(klass);
+  __ movl(klass, Address(klass, mirror::ArtMethod::DeclaringClassOffset().Int32Value()));
+  GenerateStore(field_type, locations->InAt(0), Address(klass, offset),
+                Address(klass, offset + kX86WordSize));
+  if (field_type == Primitive::kPrimNot) {
+    codegen_->MarkGCCard(locations->GetTemp(1).AsX86().AsCpuRegister(),
+                         locations->GetTemp(2).AsX86().AsCpuRegister(),
+                         klass,
+                         locations->InAt(0).AsX86().AsCpuRegister());
+  }
+}
+
+static ScaleFactor ComponentScaleFactor(Primitive::Type type) {
+  switch (Primitive::ComponentSize(type)) {
+    case 1: return TIMES_1;
+    case 2: return TIMES_2;
+    case 4: return TIMES_4;
+    case 8: return TIMES_8;
+  }
+  LOG(FATAL) << "Unexpected component type " << type;
+  return TIMES_1;
+}
+
+void LocationsBuilderX86::VisitArrayGet(HArrayGet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  locations->SetInAt(0, Location::RequiresRegister());
+  locations->SetInAt(1, Location::RequiresRegister());
+  locations->SetOut(Location::RequiresRegister());
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitArrayGet(HArrayGet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Register array = locations->InAt(0).AsX86().AsCpuRegister();
+  Register index = locations->InAt(1).AsX86().AsCpuRegister();
+  Primitive::Type type = instruction->GetType();
+  ScaleFactor scale = ComponentScaleFactor(type);
+  int32_t data_offset = mirror::Array::DataOffset(Primitive::ComponentSize(type)).Int32Value();
+  GenerateLoad(type, locations->Out(), Address(array, index, scale, data_offset),
+               Address(array, index, scale, data_offset + kX86WordSize), array, index);
+}
+
+void LocationsBuilderX86::VisitArraySet(HArraySet* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetArena()) LocationSummary(instruction);
+  if (instruction->GetComponentType() == Primitive::kPrimNot) {
+    // pAputObject does the store check and marks the card.
+    InvokeRuntimeCallingConvention calling_convention;
+    locations->SetInAt(0, X86CpuLocation(calling_convention.GetRegisterAt(0)));
+    locations->SetInAt(1, X86CpuLocation(calling_convention.GetRegisterAt(1)));
+    locations->SetInAt(2, X86CpuLocation(calling_convention.GetRegisterAt(2)));
+  } else {
+    locations->SetInAt(0, Location::RequiresRegister());
+    locations->SetInAt(1, Location::RequiresRegister());
+    locations->SetInAt(2, Location::RequiresRegister());
+  }
+  instruction->SetLocations(locations);
+}
+
+void InstructionCodeGeneratorX86::VisitArraySet(HArraySet* instruction) {
+  LocationSummary* locations = instruction->GetLocations();
+  Primitive::Type type = instruction->GetComponentType();
+  if (type == Primitive::kPrimNot) {
+    __ fs()->call(Address::Absolute(QUICK_ENTRYPOINT_OFFSET(kX86WordSize, pAputObject)));
+    codegen_->RecordPcInfo(instruction->GetDexPc());
+    return;
+  }
+  Register array = locations->InAt(0).AsX86().AsCpuRegister();
+  Register index = locations->InAt(1).AsX86().AsCpuRegister();
+  ScaleFactor scale = ComponentScaleFactor(type);
+  int32_t data_offset = mirror::Array::DataOffset(Primitive::ComponentSize(type)).Int32Value();
+  GenerateStore(type, locations->InAt(2), Address(array, index, scale, data_offset),
+                Address(array, index, scale, data_offset + kX86WordSize));
+}
+
 }  // namespace x86
 }  // namespace art
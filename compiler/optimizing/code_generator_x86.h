@@ -72,6 +72,11 @@ class LocationsBuilderX86 : public HGraphVisitor {
 #undef DECLARE_VISIT_INSTRUCTION
 
  private:
+  void HandleInvoke(HInvoke* invoke);
+  void HandleCondition(HCondition* condition);
+  void HandleShift(HBinaryOperation* instruction);
+  void HandleDivRem(HBinaryOperation* instruction);
+
   CodeGeneratorX86* const codegen_;
   InvokeDexCallingConventionVisitor parameter_visitor_;
 
@@ -94,6 +99,16 @@ class InstructionCodeGeneratorX86 : public HGraphVisitor {
   X86Assembler* GetAssembler() const { return assembler_; }
 
  private:
+  void GenerateCondition(HCondition* condition);
+  void GenerateDivRem(HBinaryOperation* instruction, uint32_t dex_pc);
+
+  // Loads or stores a value of the given type, `high` is the address of the high word
+  // of a long. `base` and `index` are the registers used by the addresses.
+  void GenerateLoad(Primitive::Type type, Location out, const Address& low, const Address& high,
+                    Register base, Register index);
+  void GenerateStore(Primitive::Type type, Location value, const Address& low,
+                     const Address& high);
+
   X86Assembler* const assembler_;
   CodeGeneratorX86* const codegen_;
 
@@ -131,7 +146,10 @@ class CodeGeneratorX86 : public CodeGenerator {
   virtual ManagedRegister AllocateFreeRegister(
       Primitive::Type type, bool* blocked_registers) const OVERRIDE;
 
-  int32_t GetStackSlot(HLocal* local) const;
+  int32_t GetStackSlot(HLocal* local) const {
+    return GetStackSlotOfDexRegister(local->GetRegNumber());
+  }
+  virtual int32_t GetStackSlotOfDexRegister(uint16_t reg_number) const OVERRIDE;
   virtual Location GetStackLocation(HLoadLocal* load) const OVERRIDE;
 
   virtual size_t GetNumberOfCoreRegisters() const OVERRIDE {
@@ -145,6 +163,9 @@ class CodeGeneratorX86 : public CodeGenerator {
   virtual void DumpCoreRegister(std::ostream& stream, int reg) const OVERRIDE;
   virtual void DumpFloatingPointRegister(std::ostream& stream, int reg) const OVERRIDE;
 
+  // Marks the card of `object` after `value` was stored into it, unless `value` is null.
+  void MarkGCCard(Register temp, Register card, Register object, Register value);
+
  private:
   // Helper method to move a 32bits value between two locations.
   void Move32(Location destination, Location source);
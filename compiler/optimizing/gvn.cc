@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gvn.h"
+
+namespace art {
+
+void ValueSet::Kill(SideEffects side_effects) {
+  for (size_t i = 0; i < kNumberOfBuckets; ++i) {
+    ValueSetNode* previous = nullptr;
+    for (ValueSetNode* node = buckets_[i]; node != nullptr; node = node->GetNext()) {
+      if (node->GetInstruction()->GetSideEffects().DependsOn(side_effects)) {
+        if (previous == nullptr) {
+          buckets_[i] = node->GetNext();
+        } else {
+          previous->SetNext(node->GetNext());
+        }
+        --number_of_entries_;
+      } else {
+        previous = node;
+      }
+    }
+  }
+}
+
+ValueSet* ValueSet::Copy() const {
+  ValueSet* copy = new (allocator_) ValueSet(allocator_);
+  for (size_t i = 0; i < kNumberOfBuckets; ++i) {
+    ValueSetNode* last = nullptr;
+    for (ValueSetNode* node = buckets_[i]; node != nullptr; node = node->GetNext()) {
+      // Keep the order of the collision list, so that lookups find the same instruction.
+      ValueSetNode* new_node =
+          new (allocator_) ValueSetNode(node->GetInstruction(), node->GetHashCode(), nullptr);
+      if (last == nullptr) {
+        copy->buckets_[i] = new_node;
+      } else {
+        last->SetNext(new_node);
+      }
+      last = new_node;
+    }
+  }
+  copy->number_of_entries_ = number_of_entries_;
+  return copy;
+}
+
+void ValueSet::IntersectionWith(ValueSet* other) {
+  for (size_t i = 0; i < kNumberOfBuckets; ++i) {
+    ValueSetNode* previous = nullptr;
+    for (ValueSetNode* node = buckets_[i]; node != nullptr; node = node->GetNext()) {
+      if (!other->Contains(node->GetInstruction())) {
+        if (previous == nullptr) {
+          buckets_[i] = node->GetNext();
+        } else {
+          previous->SetNext(node->GetNext());
+        }
+        --number_of_entries_;
+      } else {
+        previous = node;
+      }
+    }
+  }
+}
+
+void GlobalValueNumberer::Run() {
+  // Use the reverse post order to ensure the non back-edge predecessors of a block are
+  // visited before the block itself.
+  for (HReversePostOrderIterator it(*graph_); !it.Done(); it.Advance()) {
+    VisitBasicBlock(it.Current());
+  }
+}
+
+void GlobalValueNumberer::VisitBasicBlock(HBasicBlock* block) {
+  ValueSet* set = nullptr;
+  HBasicBlock* dominator = block->GetDominator();
+  if (dominator == nullptr) {
+    set = new (allocator_) ValueSet(allocator_);
+  } else {
+    set = sets_.Get(dominator->GetBlockId())->Copy();
+    if (block->IsLoopHeader()) {
+      // The back edge has not been visited yet, remove what the loop may write.
+      set->Kill(side_effects_.GetLoopEffects(block));
+    } else if (block->GetPredecessors().Size() > 1) {
+      // Only keep what is available on all incoming paths.
+      for (size_t i = 0, e = block->GetPredecessors().Size(); i < e; ++i) {
+        set->IntersectionWith(sets_.Get(block->GetPredecessors().Get(i)->GetBlockId()));
+        if (set->GetNumberOfEntries() == 0) {
+          break;
+        }
+      }
+    }
+  }
+  sets_.Put(block->GetBlockId(), set);
+
+  for (HInstructionIterator it(block->GetInstructions()); !it.Done(); it.Advance()) {
+    HInstruction* current = it.Current();
+    set->Kill(current->GetSideEffects());
+    if (current->CanBeMoved()) {
+      HInstruction* existing = set->Lookup(current);
+      if (existing != nullptr) {
+        current->ReplaceWith(existing);
+        block->RemoveInstruction(current);
+      } else {
+        set->Add(current);
+      }
+    }
+  }
+}
+
+}  // namespace art
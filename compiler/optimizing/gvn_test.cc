@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gvn.h"
+#include "nodes.h"
+#include "optimizing_unit_test.h"
+#include "side_effects_analysis.h"
+#include "utils/arena_allocator.h"
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+static void RunGvn(HGraph* graph) {
+  graph->BuildDominatorTree();
+  ASSERT_TRUE(graph->FindNaturalLoops());
+  SideEffectsAnalysis side_effects(graph);
+  side_effects.Run();
+  GlobalValueNumberer(graph->GetArena(), graph, side_effects).Run();
+}
+
+TEST(GVNTest, LocalFieldElimination) {
+  ArenaPool pool;
+  ArenaAllocator allocator(&pool);
+
+  HGraph* graph = new (&allocator) HGraph(&allocator);
+  HBasicBlock* entry = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(entry);
+  graph->SetEntryBlock(entry);
+  HInstruction* parameter = new (&allocator) HParameterValue(0, Primitive::kPrimNot);
+  entry->AddInstruction(parameter);
+
+  HBasicBlock* block = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(block);
+  entry->AddSuccessor(block);
+
+  block->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimNot));
+  block->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimNot));
+  HInstruction* to_remove = block->GetLastInstruction();
+  block->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(43), Primitive::kPrimNot));
+  HInstruction* different_offset = block->GetLastInstruction();
+  // Kill the value.
+  block->AddInstruction(new (&allocator) HInstanceFieldSet(
+      parameter, parameter, MemberOffset(42), Primitive::kPrimNot));
+  block->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimNot));
+  HInstruction* use_after_kill = block->GetLastInstruction();
+  block->AddInstruction(new (&allocator) HExit());
+
+  ASSERT_EQ(to_remove->GetBlock(), block);
+  ASSERT_EQ(different_offset->GetBlock(), block);
+  ASSERT_EQ(use_after_kill->GetBlock(), block);
+
+  RunGvn(graph);
+  ASSERT_TRUE(to_remove->GetBlock() == nullptr);
+  ASSERT_EQ(different_offset->GetBlock(), block);
+  ASSERT_EQ(use_after_kill->GetBlock(), block);
+}
+
+TEST(GVNTest, GlobalFieldElimination) {
+  ArenaPool pool;
+  ArenaAllocator allocator(&pool);
+
+  HGraph* graph = new (&allocator) HGraph(&allocator);
+  HBasicBlock* entry = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(entry);
+  graph->SetEntryBlock(entry);
+  HInstruction* parameter = new (&allocator) HParameterValue(0, Primitive::kPrimNot);
+  entry->AddInstruction(parameter);
+
+  HBasicBlock* block = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(block);
+  entry->AddSuccessor(block);
+  block->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean));
+
+  block->AddInstruction(new (&allocator) HIf(block->GetLastInstruction()));
+  HBasicBlock* then = new (&allocator) HBasicBlock(graph);
+  HBasicBlock* else_ = new (&allocator) HBasicBlock(graph);
+  HBasicBlock* join = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(then);
+  graph->AddBlock(else_);
+  graph->AddBlock(join);
+
+  block->AddSuccessor(then);
+  block->AddSuccessor(else_);
+  then->AddSuccessor(join);
+  else_->AddSuccessor(join);
+
+  then->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  then->AddInstruction(new (&allocator) HGoto());
+  else_->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  else_->AddInstruction(new (&allocator) HGoto());
+  join->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  join->AddInstruction(new (&allocator) HExit());
+
+  RunGvn(graph);
+
+  // Check that all field get instructions have been GVN'ed.
+  ASSERT_TRUE(then->GetFirstInstruction()->AsGoto() != nullptr);
+  ASSERT_TRUE(else_->GetFirstInstruction()->AsGoto() != nullptr);
+  ASSERT_TRUE(join->GetFirstInstruction()->AsExit() != nullptr);
+}
+
+TEST(GVNTest, MergeKillsFieldGet) {
+  ArenaPool pool;
+  ArenaAllocator allocator(&pool);
+
+  HGraph* graph = new (&allocator) HGraph(&allocator);
+  HBasicBlock* entry = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(entry);
+  graph->SetEntryBlock(entry);
+  HInstruction* parameter = new (&allocator) HParameterValue(0, Primitive::kPrimNot);
+  entry->AddInstruction(parameter);
+
+  HBasicBlock* block = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(block);
+  entry->AddSuccessor(block);
+  block->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  block->AddInstruction(new (&allocator) HIf(block->GetLastInstruction()));
+
+  HBasicBlock* then = new (&allocator) HBasicBlock(graph);
+  HBasicBlock* else_ = new (&allocator) HBasicBlock(graph);
+  HBasicBlock* join = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(then);
+  graph->AddBlock(else_);
+  graph->AddBlock(join);
+
+  block->AddSuccessor(then);
+  block->AddSuccessor(else_);
+  then->AddSuccessor(join);
+  else_->AddSuccessor(join);
+
+  // Only one of the paths writes the field, the value cannot be reused after the merge.
+  then->AddInstruction(new (&allocator) HInstanceFieldSet(
+      parameter, parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  then->AddInstruction(new (&allocator) HGoto());
+  else_->AddInstruction(new (&allocator) HGoto());
+  join->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  HInstruction* field_get = join->GetLastInstruction();
+  join->AddInstruction(new (&allocator) HExit());
+
+  RunGvn(graph);
+  ASSERT_EQ(field_get->GetBlock(), join);
+}
+
+TEST(GVNTest, LoopFieldElimination) {
+  ArenaPool pool;
+  ArenaAllocator allocator(&pool);
+
+  HGraph* graph = new (&allocator) HGraph(&allocator);
+  HBasicBlock* entry = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(entry);
+  graph->SetEntryBlock(entry);
+
+  HInstruction* parameter = new (&allocator) HParameterValue(0, Primitive::kPrimNot);
+  entry->AddInstruction(parameter);
+
+  HBasicBlock* block = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(block);
+  entry->AddSuccessor(block);
+  HInstruction* condition =
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean);
+  block->AddInstruction(condition);
+  block->AddInstruction(new (&allocator) HGoto());
+
+  HBasicBlock* loop_header = new (&allocator) HBasicBlock(graph);
+  HBasicBlock* loop_body = new (&allocator) HBasicBlock(graph);
+  HBasicBlock* exit = new (&allocator) HBasicBlock(graph);
+
+  graph->AddBlock(loop_header);
+  graph->AddBlock(loop_body);
+  graph->AddBlock(exit);
+  block->AddSuccessor(loop_header);
+  loop_header->AddSuccessor(loop_body);
+  loop_header->AddSuccessor(exit);
+  loop_body->AddSuccessor(loop_header);
+
+  loop_header->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  HInstruction* field_get_in_loop_header = loop_header->GetLastInstruction();
+  loop_header->AddInstruction(new (&allocator) HIf(condition));
+
+  // Kill inside the loop body to prevent field gets inside the loop header
+  // and the body to be GVN'ed.
+  loop_body->AddInstruction(new (&allocator) HInstanceFieldSet(
+      parameter, parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  HInstruction* field_set = loop_body->GetLastInstruction();
+  loop_body->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  HInstruction* field_get_in_loop_body = loop_body->GetLastInstruction();
+  loop_body->AddInstruction(new (&allocator) HGoto());
+
+  exit->AddInstruction(
+      new (&allocator) HInstanceFieldGet(parameter, MemberOffset(42), Primitive::kPrimBoolean));
+  HInstruction* field_get_in_exit = exit->GetLastInstruction();
+  exit->AddInstruction(new (&allocator) HExit());
+
+  RunGvn(graph);
+
+  // The field get in the loop header is not removed because of the store in the body,
+  // and the field get in the exit block is replaced by the one of the loop header.
+  ASSERT_EQ(field_get_in_loop_header->GetBlock(), loop_header);
+  ASSERT_EQ(field_get_in_loop_body->GetBlock(), loop_body);
+  ASSERT_EQ(field_set->GetBlock(), loop_body);
+  ASSERT_TRUE(field_get_in_exit->GetBlock() == nullptr);
+}
+
+TEST(GVNTest, ArrayLengthElimination) {
+  ArenaPool pool;
+  ArenaAllocator allocator(&pool);
+
+  HGraph* graph = new (&allocator) HGraph(&allocator);
+  HBasicBlock* entry = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(entry);
+  graph->SetEntryBlock(entry);
+  HInstruction* array = new (&allocator) HParameterValue(0, Primitive::kPrimNot);
+  entry->AddInstruction(array);
+  HInstruction* index = new (&allocator) HParameterValue(1, Primitive::kPrimInt);
+  entry->AddInstruction(index);
+
+  HBasicBlock* block = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(block);
+  entry->AddSuccessor(block);
+
+  HInstruction* length = new (&allocator) HArrayLength(array);
+  block->AddInstruction(length);
+  // Array stores don't change the length of the array, but kill array loads.
+  block->AddInstruction(
+      new (&allocator) HArrayGet(array, index, Primitive::kPrimInt));
+  HInstruction* array_get = block->GetLastInstruction();
+  block->AddInstruction(
+      new (&allocator) HArraySet(array, index, index, Primitive::kPrimInt, 0));
+  HInstruction* second_length = new (&allocator) HArrayLength(array);
+  block->AddInstruction(second_length);
+  block->AddInstruction(
+      new (&allocator) HArrayGet(array, index, Primitive::kPrimInt));
+  HInstruction* second_array_get = block->GetLastInstruction();
+  HInstruction* add = new (&allocator) HAdd(Primitive::kPrimInt, second_length, second_array_get);
+  block->AddInstruction(add);
+  block->AddInstruction(new (&allocator) HReturn(add));
+
+  RunGvn(graph);
+  ASSERT_TRUE(second_length->GetBlock() == nullptr);
+  ASSERT_EQ(add->InputAt(0), length);
+  ASSERT_EQ(array_get->GetBlock(), block);
+  ASSERT_EQ(second_array_get->GetBlock(), block);
+}
+
+TEST(GVNTest, ArrayStoreOfOtherComponentType) {
+  ArenaPool pool;
+  ArenaAllocator allocator(&pool);
+
+  HGraph* graph = new (&allocator) HGraph(&allocator);
+  HBasicBlock* entry = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(entry);
+  graph->SetEntryBlock(entry);
+  HInstruction* int_array = new (&allocator) HParameterValue(0, Primitive::kPrimNot);
+  entry->AddInstruction(int_array);
+  HInstruction* char_array = new (&allocator) HParameterValue(1, Primitive::kPrimNot);
+  entry->AddInstruction(char_array);
+  HInstruction* index = new (&allocator) HParameterValue(2, Primitive::kPrimInt);
+  entry->AddInstruction(index);
+
+  HBasicBlock* block = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(block);
+  entry->AddSuccessor(block);
+
+  // A store into an int array cannot change a char array.
+  block->AddInstruction(new (&allocator) HArrayGet(char_array, index, Primitive::kPrimChar));
+  HInstruction* array_get = block->GetLastInstruction();
+  block->AddInstruction(
+      new (&allocator) HArraySet(int_array, index, index, Primitive::kPrimInt, 0));
+  block->AddInstruction(new (&allocator) HArrayGet(char_array, index, Primitive::kPrimChar));
+  HInstruction* to_remove = block->GetLastInstruction();
+  // A short store may be into the char array, as far as the types tell.
+  block->AddInstruction(
+      new (&allocator) HArraySet(char_array, index, index, Primitive::kPrimShort, 0));
+  block->AddInstruction(new (&allocator) HArrayGet(char_array, index, Primitive::kPrimChar));
+  HInstruction* use_after_kill = block->GetLastInstruction();
+  HInstruction* add = new (&allocator) HAdd(Primitive::kPrimInt, to_remove, use_after_kill);
+  block->AddInstruction(add);
+  block->AddInstruction(new (&allocator) HReturn(add));
+
+  RunGvn(graph);
+  ASSERT_TRUE(to_remove->GetBlock() == nullptr);
+  ASSERT_EQ(add->InputAt(0), array_get);
+  ASSERT_EQ(use_after_kill->GetBlock(), block);
+}
+
+}  // namespace art
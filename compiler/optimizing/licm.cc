@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "licm.h"
+
+namespace art {
+
+static bool IsPhiOf(HInstruction* instruction, HBasicBlock* block) {
+  return instruction->AsPhi() != nullptr && instruction->GetBlock() == block;
+}
+
+// Returns whether all inputs of `instruction` are defined outside of `info`.
+static bool InputsAreDefinedBeforeLoop(HInstruction* instruction, HLoopInformation* info) {
+  for (HInputIterator it(instruction); !it.Done(); it.Advance()) {
+    if (info->Contains(*it.Current()->GetBlock())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns whether all values in the environment of `instruction` are available in the
+// pre header of `info`, assuming the phis of the loop header are replaced by their
+// input coming from the pre header.
+static bool EnvironmentIsAvailableBeforeLoop(HInstruction* instruction, HLoopInformation* info) {
+  HEnvironment* environment = instruction->GetEnvironment();
+  if (environment == nullptr) {
+    return true;
+  }
+  GrowableArray<HInstruction*>* vregs = environment->GetVRegs();
+  for (size_t i = 0; i < vregs->Size(); ++i) {
+    HInstruction* vreg = vregs->Get(i);
+    if (vreg != nullptr
+        && info->Contains(*vreg->GetBlock())
+        && !IsPhiOf(vreg, info->GetHeader())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Updates the environment of an instruction moved to the pre header of `info`.
+static void UpdateEnvironment(HInstruction* instruction, HLoopInformation* info) {
+  HEnvironment* environment = instruction->GetEnvironment();
+  if (environment == nullptr) {
+    return;
+  }
+  HBasicBlock* header = info->GetHeader();
+  size_t pre_header_index = header->GetPredecessorIndexOf(info->GetPreHeader());
+  GrowableArray<HInstruction*>* vregs = environment->GetVRegs();
+  for (size_t i = 0; i < vregs->Size(); ++i) {
+    HInstruction* vreg = vregs->Get(i);
+    if (vreg != nullptr && IsPhiOf(vreg, header)) {
+      HInstruction* input = vreg->InputAt(pre_header_index);
+      vreg->RemoveEnvironmentUser(environment, i);
+      environment->SetRawEnvAt(i, input);
+      input->AddEnvUseAt(environment, i);
+    }
+  }
+}
+
+void LICM::Run() {
+  // Post order visit to visit inner loops before outer loops, so that an instruction
+  // moved out of an inner loop can then be moved out of the outer loop.
+  for (HPostOrderIterator it(*graph_); !it.Done(); it.Advance()) {
+    HBasicBlock* header = it.Current();
+    if (!header->IsLoopHeader()) {
+      continue;
+    }
+    HLoopInformation* info = header->GetLoopInformation();
+    HBasicBlock* pre_header = info->GetPreHeader();
+    HInstruction* cursor = pre_header->GetLastInstruction();
+    DCHECK(cursor->AsGoto() != nullptr);
+    SideEffects loop_effects = side_effects_.GetLoopEffects(header);
+
+    // Only the blocks of this loop, the blocks of inner loops have been handled.
+    for (HReversePostOrderIterator block_it(*graph_); !block_it.Done(); block_it.Advance()) {
+      HBasicBlock* block = block_it.Current();
+      if (block->GetLoopInformation() != info) {
+        continue;
+      }
+      // Instructions of blocks other than the header may not be executed on the
+      // first iteration of the loop, they cannot be speculated if they throw or
+      // dereference an object, which may depend on a check that is not moved.
+      bool found_first_non_hoisted_visible_instruction = (block != header);
+      for (HInstructionIterator inst_it(block->GetInstructions());
+           !inst_it.Done();
+           inst_it.Advance()) {
+        HInstruction* instruction = inst_it.Current();
+        bool can_speculate = !instruction->CanThrow()
+            && !instruction->GetSideEffects().HasDependencies()
+            && instruction->AsArrayLength() == nullptr;
+        if (instruction->CanBeMoved()
+            && (can_speculate || !found_first_non_hoisted_visible_instruction)
+            && !instruction->GetSideEffects().DependsOn(loop_effects)
+            && InputsAreDefinedBeforeLoop(instruction, info)
+            && EnvironmentIsAvailableBeforeLoop(instruction, info)) {
+          UpdateEnvironment(instruction, info);
+          instruction->MoveBefore(cursor);
+        } else if (instruction->CanThrow() || instruction->GetSideEffects().HasSideEffects()) {
+          found_first_non_hoisted_visible_instruction = true;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "licm.h"
+#include "nodes.h"
+#include "optimizing_unit_test.h"
+#include "side_effects_analysis.h"
+#include "utils/arena_allocator.h"
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+/**
+ * Fixture class for the LICM tests. Builds the graph:
+ *
+ *   entry -> pre_header -> header <-> body
+ *                            |
+ *                          exit
+ */
+class LICMTest : public testing::Test {
+ public:
+  LICMTest() : pool_(), allocator_(&pool_) {
+    graph_ = new (&allocator_) HGraph(&allocator_);
+  }
+
+  ~LICMTest() { }
+
+  void BuildLoop() {
+    entry_ = new (&allocator_) HBasicBlock(graph_);
+    pre_header_ = new (&allocator_) HBasicBlock(graph_);
+    header_ = new (&allocator_) HBasicBlock(graph_);
+    body_ = new (&allocator_) HBasicBlock(graph_);
+    exit_ = new (&allocator_) HBasicBlock(graph_);
+
+    graph_->AddBlock(entry_);
+    graph_->AddBlock(pre_header_);
+    graph_->AddBlock(header_);
+    graph_->AddBlock(body_);
+    graph_->AddBlock(exit_);
+    graph_->SetEntryBlock(entry_);
+    graph_->SetExitBlock(exit_);
+
+    entry_->AddSuccessor(pre_header_);
+    pre_header_->AddSuccessor(header_);
+    header_->AddSuccessor(body_);
+    header_->AddSuccessor(exit_);
+    body_->AddSuccessor(header_);
+
+    object_ = new (&allocator_) HParameterValue(0, Primitive::kPrimNot);
+    entry_->AddInstruction(object_);
+    int_value_ = new (&allocator_) HParameterValue(1, Primitive::kPrimInt);
+    entry_->AddInstruction(int_value_);
+    condition_ = new (&allocator_) HParameterValue(2, Primitive::kPrimBoolean);
+    entry_->AddInstruction(condition_);
+    entry_->AddInstruction(new (&allocator_) HGoto());
+    pre_header_->AddInstruction(new (&allocator_) HGoto());
+    exit_->AddInstruction(new (&allocator_) HExit());
+  }
+
+  // Finishes the loop blocks and runs LICM.
+  void PerformLICM() {
+    header_->AddInstruction(new (&allocator_) HIf(condition_));
+    body_->AddInstruction(new (&allocator_) HGoto());
+
+    graph_->BuildDominatorTree();
+    ASSERT_TRUE(graph_->FindNaturalLoops());
+    SideEffectsAnalysis side_effects(graph_);
+    side_effects.Run();
+    LICM(graph_, side_effects).Run();
+  }
+
+  ArenaPool pool_;
+  ArenaAllocator allocator_;
+  HGraph* graph_;
+
+  HBasicBlock* entry_;
+  HBasicBlock* pre_header_;
+  HBasicBlock* header_;
+  HBasicBlock* body_;
+  HBasicBlock* exit_;
+
+  HInstruction* object_;
+  HInstruction* int_value_;
+  HInstruction* condition_;
+};
+
+TEST_F(LICMTest, HoistArithmetic) {
+  BuildLoop();
+  HInstruction* add = new (&allocator_) HAdd(Primitive::kPrimInt, int_value_, int_value_);
+  body_->AddInstruction(add);
+  HInstruction* mul = new (&allocator_) HMul(Primitive::kPrimInt, add, int_value_);
+  body_->AddInstruction(mul);
+  HInstruction* sub = new (&allocator_) HSub(Primitive::kPrimInt, mul, int_value_);
+  body_->AddInstruction(sub);
+
+  PerformLICM();
+  ASSERT_EQ(add->GetBlock(), pre_header_);
+  ASSERT_EQ(mul->GetBlock(), pre_header_);
+  ASSERT_EQ(sub->GetBlock(), pre_header_);
+  // The instructions keep their order and are before the goto of the pre header.
+  ASSERT_EQ(add->GetNext(), mul);
+  ASSERT_EQ(mul->GetNext(), sub);
+  ASSERT_TRUE(sub->GetNext()->AsGoto() != nullptr);
+  ASSERT_TRUE(body_->GetFirstInstruction()->AsGoto() != nullptr);
+}
+
+TEST_F(LICMTest, HoistFieldGetFromHeader) {
+  BuildLoop();
+  HInstruction* field_get =
+      new (&allocator_) HInstanceFieldGet(object_, MemberOffset(42), Primitive::kPrimInt);
+  header_->AddInstruction(field_get);
+  HInstruction* length = new (&allocator_) HArrayLength(object_);
+  header_->AddInstruction(length);
+
+  PerformLICM();
+  ASSERT_EQ(field_get->GetBlock(), pre_header_);
+  ASSERT_EQ(length->GetBlock(), pre_header_);
+}
+
+TEST_F(LICMTest, NoHoistFieldGetWithStoreInLoop) {
+  BuildLoop();
+  HInstruction* field_get =
+      new (&allocator_) HInstanceFieldGet(object_, MemberOffset(42), Primitive::kPrimInt);
+  header_->AddInstruction(field_get);
+  HInstruction* array_get = new (&allocator_) HArrayGet(object_, int_value_, Primitive::kPrimInt);
+  header_->AddInstruction(array_get);
+  body_->AddInstruction(new (&allocator_) HInstanceFieldSet(
+      object_, int_value_, MemberOffset(43), Primitive::kPrimInt));
+
+  PerformLICM();
+  ASSERT_EQ(field_get->GetBlock(), header_);
+  // The field store does not write array elements.
+  ASSERT_EQ(array_get->GetBlock(), pre_header_);
+}
+
+TEST_F(LICMTest, NoSpeculation) {
+  BuildLoop();
+  // The body is not executed if the loop exits right away, loads cannot be moved from it.
+  HInstruction* field_get =
+      new (&allocator_) HInstanceFieldGet(object_, MemberOffset(42), Primitive::kPrimInt);
+  body_->AddInstruction(field_get);
+  HInstruction* length = new (&allocator_) HArrayLength(object_);
+  body_->AddInstruction(length);
+
+  // A load after a store of the header cannot be moved before it.
+  header_->AddInstruction(new (&allocator_) HArraySet(
+      object_, int_value_, int_value_, Primitive::kPrimInt, 0));
+  HInstruction* field_get_after_store =
+      new (&allocator_) HInstanceFieldGet(object_, MemberOffset(42), Primitive::kPrimInt);
+  header_->AddInstruction(field_get_after_store);
+
+  PerformLICM();
+  ASSERT_EQ(field_get->GetBlock(), body_);
+  ASSERT_EQ(length->GetBlock(), body_);
+  ASSERT_EQ(field_get_after_store->GetBlock(), header_);
+}
+
+}  // namespace art
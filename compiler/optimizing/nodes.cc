@@ -332,6 +332,17 @@ static void Remove(HInstructionList* instruction_list,
   for (size_t i = 0; i < instruction->InputCount(); i++) {
     instruction->InputAt(i)->RemoveUser(instruction, i);
   }
+
+  HEnvironment* environment = instruction->GetEnvironment();
+  if (environment != nullptr) {
+    GrowableArray<HInstruction*>* vregs = environment->GetVRegs();
+    for (size_t i = 0; i < vregs->Size(); i++) {
+      HInstruction* vreg = vregs->Get(i);
+      if (vreg != nullptr) {
+        vreg->RemoveEnvironmentUser(environment, i);
+      }
+    }
+  }
 }
 
 void HBasicBlock::RemoveInstruction(HInstruction* instruction) {
@@ -358,6 +369,22 @@ void HInstruction::RemoveUser(HInstruction* user, size_t input_index) {
   }
 }
 
+void HInstruction::RemoveEnvironmentUser(HEnvironment* user, size_t input_index) {
+  HUseListNode<HEnvironment>* previous = nullptr;
+  HUseListNode<HEnvironment>* current = env_uses_;
+  while (current != nullptr) {
+    if (current->GetUser() == user && current->GetIndex() == input_index) {
+      if (previous == nullptr) {
+        env_uses_ = current->GetTail();
+      } else {
+        previous->SetTail(current->GetTail());
+      }
+    }
+    previous = current;
+    current = current->GetTail();
+  }
+}
+
 void HInstructionList::AddInstruction(HInstruction* instruction) {
   if (first_instruction_ == nullptr) {
     DCHECK(last_instruction_ == nullptr);
@@ -409,6 +436,45 @@ void HInstruction::ReplaceWith(HInstruction* other) {
   env_uses_ = nullptr;
 }
 
+void HInstruction::MoveBefore(HInstruction* cursor) {
+  DCHECK(AsPhi() == nullptr);
+  DCHECK(cursor->AsPhi() == nullptr);
+  DCHECK(cursor != this);
+  // Uses and inputs are kept, only the position in the instruction lists changes.
+  block_->instructions_.RemoveInstruction(this);
+  HBasicBlock* block = cursor->GetBlock();
+  previous_ = cursor->previous_;
+  next_ = cursor;
+  if (previous_ != nullptr) {
+    previous_->next_ = this;
+  }
+  cursor->previous_ = this;
+  if (block->instructions_.first_instruction_ == cursor) {
+    block->instructions_.first_instruction_ = this;
+  }
+  block_ = block;
+}
+
+bool HInstruction::Equals(HInstruction* other) const {
+  if (GetKind() != other->GetKind()) return false;
+  if (GetType() != other->GetType()) return false;
+  if (InputCount() != other->InputCount()) return false;
+  for (size_t i = 0, e = InputCount(); i < e; ++i) {
+    if (InputAt(i) != other->InputAt(i)) return false;
+  }
+  if (!InstructionDataEquals(other)) return false;
+  DCHECK(GetSideEffects().Equals(other->GetSideEffects()));
+  return true;
+}
+
+size_t HInstruction::ComputeHashCode() const {
+  size_t result = GetKind();
+  for (size_t i = 0, e = InputCount(); i < e; ++i) {
+    result = (result * 31) + InputAt(i)->GetId();
+  }
+  return result;
+}
+
 void HPhi::AddInput(HInstruction* input) {
   DCHECK(input->GetBlock() != nullptr);
   inputs_.Add(input);
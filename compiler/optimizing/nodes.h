@@ -18,6 +18,7 @@
 #define ART_COMPILER_OPTIMIZING_NODES_H_
 
 #include "locations.h"
+#include "offsets.h"
 #include "utils/allocation.h"
 #include "utils/arena_bit_vector.h"
 #include "utils/growable_array.h"
@@ -25,6 +26,7 @@
 namespace art {
 
 class HBasicBlock;
+class HCondition;
 class HEnvironment;
 class HInstruction;
 class HIntConstant;
@@ -50,6 +52,7 @@ class HInstructionList {
   HInstruction* last_instruction_;
 
   friend class HBasicBlock;
+  friend class HInstruction;
   friend class HInstructionIterator;
   friend class HBackwardInstructionIterator;
 
@@ -369,38 +372,137 @@ class HBasicBlock : public ArenaObject {
   size_t lifetime_start_;
   size_t lifetime_end_;
 
+  friend class HInstruction;
+
   DISALLOW_COPY_AND_ASSIGN(HBasicBlock);
 };
 
 #define FOR_EACH_INSTRUCTION(M)                            \
   M(Add)                                                   \
+  M(ArrayGet)                                              \
+  M(ArrayLength)                                           \
+  M(ArraySet)                                              \
+  M(BoundsCheck)                                           \
+  M(Compare)                                               \
+  M(Div)                                                   \
   M(Equal)                                                 \
   M(Exit)                                                  \
   M(Goto)                                                  \
+  M(GreaterThan)                                           \
+  M(GreaterThanOrEqual)                                    \
   M(If)                                                    \
+  M(InstanceFieldGet)                                      \
+  M(InstanceFieldSet)                                      \
   M(IntConstant)                                           \
+  M(InvokeInterface)                                       \
   M(InvokeStatic)                                          \
+  M(InvokeVirtual)                                         \
+  M(LessThan)                                              \
+  M(LessThanOrEqual)                                       \
   M(LoadLocal)                                             \
   M(Local)                                                 \
   M(LongConstant)                                          \
+  M(Mul)                                                   \
   M(NewInstance)                                           \
   M(Not)                                                   \
+  M(NullCheck)                                             \
   M(ParameterValue)                                        \
   M(ParallelMove)                                          \
   M(Phi)                                                   \
+  M(Rem)                                                   \
   M(Return)                                                \
   M(ReturnVoid)                                            \
+  M(Shl)                                                   \
+  M(Shr)                                                   \
+  M(StaticFieldGet)                                        \
+  M(StaticFieldSet)                                        \
   M(StoreLocal)                                            \
   M(Sub)                                                   \
+  M(UShr)                                                  \
 
 #define FORWARD_DECLARATION(type) class H##type;
 FOR_EACH_INSTRUCTION(FORWARD_DECLARATION)
 #undef FORWARD_DECLARATION
 
-#define DECLARE_INSTRUCTION(type)                          \
-  virtual const char* DebugName() const { return #type; }  \
-  virtual H##type* As##type() { return this; }             \
-  virtual void Accept(HGraphVisitor* visitor)              \
+#define DECLARE_INSTRUCTION(type)                                            \
+  virtual InstructionKind GetKind() const { return HInstruction::k##type; }  \
+  virtual const char* DebugName() const { return #type; }                    \
+  virtual H##type* As##type() { return this; }                               \
+  virtual void Accept(HGraphVisitor* visitor)                                \
+
+// The memory an instruction writes and reads. Fields and array elements are
+// kept apart, so that a store to an array does not invalidate field loads.
+class SideEffects : public ValueObject {
+ public:
+  static SideEffects None() { return SideEffects(0); }
+  static SideEffects All() { return SideEffects(kAllWrites | kAllReads); }
+  static SideEffects FieldWrite() { return SideEffects(kFieldWriteFlag); }
+  static SideEffects ArrayWrite(Primitive::Type type) {
+    return SideEffects(ArrayWriteFlag(type));
+  }
+  static SideEffects FieldRead() { return SideEffects(kFieldWriteFlag << kReadShift); }
+  static SideEffects ArrayRead(Primitive::Type type) {
+    return SideEffects(ArrayWriteFlag(type) << kReadShift);
+  }
+
+  SideEffects Union(SideEffects other) const {
+    return SideEffects(flags_ | other.flags_);
+  }
+
+  bool HasSideEffects() const { return (flags_ & kAllWrites) != 0; }
+  bool HasDependencies() const { return (flags_ & kAllReads) != 0; }
+
+  // Returns whether the memory read by this may be written by `other`.
+  bool DependsOn(SideEffects other) const {
+    return ((flags_ >> kReadShift) & other.flags_ & kAllWrites) != 0;
+  }
+
+  bool Equals(SideEffects other) const { return flags_ == other.flags_; }
+
+ private:
+  // Arrays of different kinds of components are different objects, so accesses to one kind
+  // cannot alias accesses to another. aget and aput don't tell int from float components,
+  // nor their wide versions long from double, so those share a kind. Boolean and byte, char
+  // and short, share one too rather than relying on the verifier to keep them apart.
+  static int ArrayWriteFlag(Primitive::Type type) {
+    switch (type) {
+      case Primitive::kPrimBoolean:
+      case Primitive::kPrimByte:
+        return kByteArrayWriteFlag;
+      case Primitive::kPrimChar:
+      case Primitive::kPrimShort:
+        return kCharArrayWriteFlag;
+      case Primitive::kPrimInt:
+      case Primitive::kPrimFloat:
+        return kIntArrayWriteFlag;
+      case Primitive::kPrimLong:
+      case Primitive::kPrimDouble:
+        return kLongArrayWriteFlag;
+      case Primitive::kPrimNot:
+        return kObjectArrayWriteFlag;
+      case Primitive::kPrimVoid:
+        break;
+    }
+    LOG(FATAL) << "Unexpected array component type " << type;
+    return kAllArrayWrites;
+  }
+
+  static constexpr int kFieldWriteFlag = 1 << 0;
+  static constexpr int kByteArrayWriteFlag = 1 << 1;
+  static constexpr int kCharArrayWriteFlag = 1 << 2;
+  static constexpr int kIntArrayWriteFlag = 1 << 3;
+  static constexpr int kLongArrayWriteFlag = 1 << 4;
+  static constexpr int kObjectArrayWriteFlag = 1 << 5;
+  static constexpr int kAllArrayWrites = kByteArrayWriteFlag | kCharArrayWriteFlag
+      | kIntArrayWriteFlag | kLongArrayWriteFlag | kObjectArrayWriteFlag;
+  static constexpr int kAllWrites = kFieldWriteFlag | kAllArrayWrites;
+  static constexpr int kReadShift = 6;
+  static constexpr int kAllReads = kAllWrites << kReadShift;
+
+  explicit SideEffects(int flags) : flags_(flags) {}
+
+  int flags_;
+};
 
 template <typename T>
 class HUseListNode : public ArenaObject {
@@ -424,6 +526,12 @@ class HUseListNode : public ArenaObject {
 
 class HInstruction : public ArenaObject {
  public:
+#define DECLARE_KIND(type) k##type,
+  enum InstructionKind {
+    FOR_EACH_INSTRUCTION(DECLARE_KIND)
+  };
+#undef DECLARE_KIND
+
   HInstruction()
       : previous_(nullptr),
         next_(nullptr),
@@ -456,6 +564,30 @@ class HInstruction : public ArenaObject {
 
   virtual bool NeedsEnvironment() const { return false; }
 
+  virtual InstructionKind GetKind() const = 0;
+
+  // The memory this instruction writes and reads, used by the optimizations
+  // moving and removing instructions.
+  virtual SideEffects GetSideEffects() const { return SideEffects::None(); }
+
+  // Whether this instruction can throw an exception.
+  virtual bool CanThrow() const { return false; }
+
+  // Whether this instruction only depends on its inputs, its data and the memory
+  // described by its side effects. Such instructions can be value numbered and
+  // hoisted out of loops.
+  virtual bool CanBeMoved() const { return false; }
+
+  // Returns whether the data of `other`, which has the same kind as this
+  // instruction, is the same as the data of this instruction. Inputs are
+  // compared by `Equals`.
+  virtual bool InstructionDataEquals(HInstruction* other) const { return false; }
+
+  // Returns whether this instruction computes the same value as `other`.
+  bool Equals(HInstruction* other) const;
+
+  virtual size_t ComputeHashCode() const;
+
   void AddUseAt(HInstruction* user, size_t index) {
     uses_ = new (block_->GetGraph()->GetArena()) HUseListNode<HInstruction>(user, index, uses_);
   }
@@ -466,6 +598,7 @@ class HInstruction : public ArenaObject {
   }
 
   void RemoveUser(HInstruction* user, size_t index);
+  void RemoveEnvironmentUser(HEnvironment* user, size_t index);
 
   HUseListNode<HInstruction>* GetUses() const { return uses_; }
   HUseListNode<HEnvironment>* GetEnvUses() const { return env_uses_; }
@@ -499,12 +632,18 @@ class HInstruction : public ArenaObject {
 
   void ReplaceWith(HInstruction* instruction);
 
+  // Moves this instruction before `cursor`, which can be in another block.
+  void MoveBefore(HInstruction* cursor);
+
 #define INSTRUCTION_TYPE_CHECK(type)                                           \
   virtual H##type* As##type() { return nullptr; }
 
   FOR_EACH_INSTRUCTION(INSTRUCTION_TYPE_CHECK)
 #undef INSTRUCTION_TYPE_CHECK
 
+  // HCondition is abstract, and not part of the instruction list.
+  virtual HCondition* AsCondition() { return nullptr; }
+
   size_t GetLifetimePosition() const { return lifetime_position_; }
   void SetLifetimePosition(size_t position) { lifetime_position_ = position; }
   LiveInterval* GetLiveInterval() const { return live_interval_; }
@@ -821,22 +960,49 @@ class HBinaryOperation : public HTemplateInstruction<2> {
   virtual bool IsCommutative() { return false; }
   virtual Primitive::Type GetType() const { return GetResultType(); }
 
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const { return true; }
+
  private:
   const Primitive::Type result_type_;
 
   DISALLOW_COPY_AND_ASSIGN(HBinaryOperation);
 };
 
+enum IfCondition {
+  kCondEQ,
+  kCondNE,
+  kCondLT,
+  kCondLE,
+  kCondGT,
+  kCondGE,
+};
+
+// A comparison of two int or reference inputs, materialized as a boolean.
+class HCondition : public HBinaryOperation {
+ public:
+  HCondition(HInstruction* first, HInstruction* second)
+      : HBinaryOperation(Primitive::kPrimBoolean, first, second) {}
+
+  virtual Primitive::Type GetType() const { return Primitive::kPrimBoolean; }
+
+  virtual IfCondition GetCondition() const = 0;
+
+  virtual HCondition* AsCondition() { return this; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HCondition);
+};
 
 // Instruction to check if two inputs are equal to each other.
-class HEqual : public HBinaryOperation {
+class HEqual : public HCondition {
  public:
   HEqual(HInstruction* first, HInstruction* second)
-      : HBinaryOperation(Primitive::kPrimBoolean, first, second) {}
+      : HCondition(first, second) {}
 
   virtual bool IsCommutative() { return true; }
 
-  virtual Primitive::Type GetType() const { return Primitive::kPrimBoolean; }
+  virtual IfCondition GetCondition() const { return kCondEQ; }
 
   DECLARE_INSTRUCTION(Equal);
 
@@ -844,6 +1010,75 @@ class HEqual : public HBinaryOperation {
   DISALLOW_COPY_AND_ASSIGN(HEqual);
 };
 
+class HLessThan : public HCondition {
+ public:
+  HLessThan(HInstruction* first, HInstruction* second)
+      : HCondition(first, second) {}
+
+  virtual IfCondition GetCondition() const { return kCondLT; }
+
+  DECLARE_INSTRUCTION(LessThan);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HLessThan);
+};
+
+class HLessThanOrEqual : public HCondition {
+ public:
+  HLessThanOrEqual(HInstruction* first, HInstruction* second)
+      : HCondition(first, second) {}
+
+  virtual IfCondition GetCondition() const { return kCondLE; }
+
+  DECLARE_INSTRUCTION(LessThanOrEqual);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HLessThanOrEqual);
+};
+
+class HGreaterThan : public HCondition {
+ public:
+  HGreaterThan(HInstruction* first, HInstruction* second)
+      : HCondition(first, second) {}
+
+  virtual IfCondition GetCondition() const { return kCondGT; }
+
+  DECLARE_INSTRUCTION(GreaterThan);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HGreaterThan);
+};
+
+class HGreaterThanOrEqual : public HCondition {
+ public:
+  HGreaterThanOrEqual(HInstruction* first, HInstruction* second)
+      : HCondition(first, second) {}
+
+  virtual IfCondition GetCondition() const { return kCondGE; }
+
+  DECLARE_INSTRUCTION(GreaterThanOrEqual);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HGreaterThanOrEqual);
+};
+
+// Instruction to compare two long inputs, following dex's CMP_LONG semantics:
+// the result is -1, 0 or 1.
+class HCompare : public HBinaryOperation {
+ public:
+  HCompare(Primitive::Type type, HInstruction* first, HInstruction* second)
+      : HBinaryOperation(Primitive::kPrimInt, first, second) {
+    DCHECK_EQ(type, Primitive::kPrimLong);
+    DCHECK_EQ(type, first->GetType());
+    DCHECK_EQ(type, second->GetType());
+  }
+
+  DECLARE_INSTRUCTION(Compare);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HCompare);
+};
+
 // A local in the graph. Corresponds to a Dex register.
 class HLocal : public HTemplateInstruction<0> {
  public:
@@ -905,6 +1140,11 @@ class HIntConstant : public HTemplateInstruction<0> {
   int32_t GetValue() const { return value_; }
   virtual Primitive::Type GetType() const { return Primitive::kPrimInt; }
 
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const {
+    return other->AsIntConstant()->value_ == value_;
+  }
+
   DECLARE_INSTRUCTION(IntConstant);
 
  private:
@@ -921,6 +1161,11 @@ class HLongConstant : public HTemplateInstruction<0> {
 
   virtual Primitive::Type GetType() const { return Primitive::kPrimLong; }
 
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const {
+    return other->AsLongConstant()->value_ == value_;
+  }
+
   DECLARE_INSTRUCTION(LongConstant);
 
  private:
@@ -958,6 +1203,10 @@ class HInvoke : public HInstruction {
 
   virtual Primitive::Type GetType() const { return return_type_; }
 
+  // The callee can write any memory.
+  virtual SideEffects GetSideEffects() const { return SideEffects::All(); }
+  virtual bool CanThrow() const { return true; }
+
   uint32_t GetDexPc() const { return dex_pc_; }
 
  protected:
@@ -989,6 +1238,53 @@ class HInvokeStatic : public HInvoke {
   DISALLOW_COPY_AND_ASSIGN(HInvokeStatic);
 };
 
+// Call through the vtable of the receiver, which is the first argument.
+class HInvokeVirtual : public HInvoke {
+ public:
+  HInvokeVirtual(ArenaAllocator* arena,
+                 uint32_t number_of_arguments,
+                 Primitive::Type return_type,
+                 uint32_t dex_pc,
+                 uint32_t vtable_index)
+      : HInvoke(arena, number_of_arguments, return_type, dex_pc),
+        vtable_index_(vtable_index) {}
+
+  uint32_t GetVTableIndex() const { return vtable_index_; }
+
+  DECLARE_INSTRUCTION(InvokeVirtual);
+
+ private:
+  const uint32_t vtable_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(HInvokeVirtual);
+};
+
+// Call through the interface method table of the receiver. The dex method index
+// is passed to the callee so that the IMT conflict trampoline can find the target.
+class HInvokeInterface : public HInvoke {
+ public:
+  HInvokeInterface(ArenaAllocator* arena,
+                   uint32_t number_of_arguments,
+                   Primitive::Type return_type,
+                   uint32_t dex_pc,
+                   uint32_t dex_method_index,
+                   uint32_t imt_index)
+      : HInvoke(arena, number_of_arguments, return_type, dex_pc),
+        dex_method_index_(dex_method_index),
+        imt_index_(imt_index) {}
+
+  uint32_t GetDexMethodIndex() const { return dex_method_index_; }
+  uint32_t GetImtIndex() const { return imt_index_; }
+
+  DECLARE_INSTRUCTION(InvokeInterface);
+
+ private:
+  const uint32_t dex_method_index_;
+  const uint32_t imt_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(HInvokeInterface);
+};
+
 class HNewInstance : public HTemplateInstruction<0> {
  public:
   HNewInstance(uint32_t dex_pc, uint16_t type_index) : dex_pc_(dex_pc), type_index_(type_index) {}
@@ -1001,6 +1297,10 @@ class HNewInstance : public HTemplateInstruction<0> {
   // Calls runtime so needs an environment.
   virtual bool NeedsEnvironment() const { return true; }
 
+  // The allocation may initialize the class, which runs arbitrary code.
+  virtual SideEffects GetSideEffects() const { return SideEffects::All(); }
+  virtual bool CanThrow() const { return true; }
+
   DECLARE_INSTRUCTION(NewInstance);
 
  private:
@@ -1036,6 +1336,91 @@ class HSub : public HBinaryOperation {
   DISALLOW_COPY_AND_ASSIGN(HSub);
 };
 
+class HMul : public HBinaryOperation {
+ public:
+  HMul(Primitive::Type result_type, HInstruction* left, HInstruction* right)
+      : HBinaryOperation(result_type, left, right) {}
+
+  virtual bool IsCommutative() { return true; }
+
+  DECLARE_INSTRUCTION(Mul);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HMul);
+};
+
+// Division and remainder throw an ArithmeticException when the divisor is zero,
+// so they know their dex pc and need an environment.
+class HDiv : public HBinaryOperation {
+ public:
+  HDiv(Primitive::Type result_type, HInstruction* left, HInstruction* right, uint32_t dex_pc)
+      : HBinaryOperation(result_type, left, right), dex_pc_(dex_pc) {}
+
+  uint32_t GetDexPc() const { return dex_pc_; }
+
+  virtual bool NeedsEnvironment() const { return true; }
+  virtual bool CanThrow() const { return true; }
+
+  DECLARE_INSTRUCTION(Div);
+
+ private:
+  const uint32_t dex_pc_;
+
+  DISALLOW_COPY_AND_ASSIGN(HDiv);
+};
+
+class HRem : public HBinaryOperation {
+ public:
+  HRem(Primitive::Type result_type, HInstruction* left, HInstruction* right, uint32_t dex_pc)
+      : HBinaryOperation(result_type, left, right), dex_pc_(dex_pc) {}
+
+  uint32_t GetDexPc() const { return dex_pc_; }
+
+  virtual bool NeedsEnvironment() const { return true; }
+  virtual bool CanThrow() const { return true; }
+
+  DECLARE_INSTRUCTION(Rem);
+
+ private:
+  const uint32_t dex_pc_;
+
+  DISALLOW_COPY_AND_ASSIGN(HRem);
+};
+
+// Shifts only use the low five bits of their shift count.
+class HShl : public HBinaryOperation {
+ public:
+  HShl(Primitive::Type result_type, HInstruction* left, HInstruction* right)
+      : HBinaryOperation(result_type, left, right) {}
+
+  DECLARE_INSTRUCTION(Shl);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HShl);
+};
+
+class HShr : public HBinaryOperation {
+ public:
+  HShr(Primitive::Type result_type, HInstruction* left, HInstruction* right)
+      : HBinaryOperation(result_type, left, right) {}
+
+  DECLARE_INSTRUCTION(Shr);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HShr);
+};
+
+class HUShr : public HBinaryOperation {
+ public:
+  HUShr(Primitive::Type result_type, HInstruction* left, HInstruction* right)
+      : HBinaryOperation(result_type, left, right) {}
+
+  DECLARE_INSTRUCTION(UShr);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HUShr);
+};
+
 // The value of a parameter in this method. Its location depends on
 // the calling convention.
 class HParameterValue : public HTemplateInstruction<0> {
@@ -1067,12 +1452,254 @@ class HNot : public HTemplateInstruction<1> {
 
   virtual Primitive::Type GetType() const { return Primitive::kPrimBoolean; }
 
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const { return true; }
+
   DECLARE_INSTRUCTION(Not);
 
  private:
   DISALLOW_COPY_AND_ASSIGN(HNot);
 };
 
+// Throws a NullPointerException if its input is null. The checks do not define
+// a value: the instruction they guard reads the same dex register again.
+class HNullCheck : public HTemplateInstruction<1> {
+ public:
+  HNullCheck(HInstruction* value, uint32_t dex_pc) : dex_pc_(dex_pc) {
+    SetRawInputAt(0, value);
+  }
+
+  uint32_t GetDexPc() const { return dex_pc_; }
+
+  virtual bool NeedsEnvironment() const { return true; }
+  virtual bool CanThrow() const { return true; }
+
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const { return true; }
+
+  DECLARE_INSTRUCTION(NullCheck);
+
+ private:
+  const uint32_t dex_pc_;
+
+  DISALLOW_COPY_AND_ASSIGN(HNullCheck);
+};
+
+// Throws an ArrayIndexOutOfBoundsException if the index is not within the
+// length of the array. The array must have been null checked.
+class HBoundsCheck : public HTemplateInstruction<2> {
+ public:
+  HBoundsCheck(HInstruction* index, HInstruction* array, uint32_t dex_pc) : dex_pc_(dex_pc) {
+    SetRawInputAt(0, index);
+    SetRawInputAt(1, array);
+  }
+
+  uint32_t GetDexPc() const { return dex_pc_; }
+
+  virtual bool NeedsEnvironment() const { return true; }
+  virtual bool CanThrow() const { return true; }
+
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const { return true; }
+
+  DECLARE_INSTRUCTION(BoundsCheck);
+
+ private:
+  const uint32_t dex_pc_;
+
+  DISALLOW_COPY_AND_ASSIGN(HBoundsCheck);
+};
+
+class FieldInfo : public ValueObject {
+ public:
+  FieldInfo(MemberOffset field_offset, Primitive::Type field_type)
+      : field_offset_(field_offset), field_type_(field_type) {}
+
+  MemberOffset GetFieldOffset() const { return field_offset_; }
+  Primitive::Type GetFieldType() const { return field_type_; }
+
+ private:
+  const MemberOffset field_offset_;
+  const Primitive::Type field_type_;
+};
+
+// Instance field accesses expect their object to have been null checked.
+class HInstanceFieldGet : public HTemplateInstruction<1> {
+ public:
+  HInstanceFieldGet(HInstruction* object, MemberOffset field_offset, Primitive::Type field_type)
+      : field_info_(field_offset, field_type) {
+    SetRawInputAt(0, object);
+  }
+
+  MemberOffset GetFieldOffset() const { return field_info_.GetFieldOffset(); }
+  Primitive::Type GetFieldType() const { return field_info_.GetFieldType(); }
+
+  virtual Primitive::Type GetType() const { return field_info_.GetFieldType(); }
+
+  virtual SideEffects GetSideEffects() const { return SideEffects::FieldRead(); }
+
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const {
+    return other->AsInstanceFieldGet()->GetFieldOffset().Uint32Value()
+        == GetFieldOffset().Uint32Value();
+  }
+
+  DECLARE_INSTRUCTION(InstanceFieldGet);
+
+ private:
+  const FieldInfo field_info_;
+
+  DISALLOW_COPY_AND_ASSIGN(HInstanceFieldGet);
+};
+
+class HInstanceFieldSet : public HTemplateInstruction<2> {
+ public:
+  HInstanceFieldSet(HInstruction* object,
+                    HInstruction* value,
+                    MemberOffset field_offset,
+                    Primitive::Type field_type)
+      : field_info_(field_offset, field_type) {
+    SetRawInputAt(0, object);
+    SetRawInputAt(1, value);
+  }
+
+  MemberOffset GetFieldOffset() const { return field_info_.GetFieldOffset(); }
+  Primitive::Type GetFieldType() const { return field_info_.GetFieldType(); }
+
+  virtual SideEffects GetSideEffects() const { return SideEffects::FieldWrite(); }
+
+  DECLARE_INSTRUCTION(InstanceFieldSet);
+
+ private:
+  const FieldInfo field_info_;
+
+  DISALLOW_COPY_AND_ASSIGN(HInstanceFieldSet);
+};
+
+// Static field accesses are only built for fields of the class of the compiled
+// method, which is found from the current method and is known to be initialized.
+class HStaticFieldGet : public HTemplateInstruction<0> {
+ public:
+  HStaticFieldGet(MemberOffset field_offset, Primitive::Type field_type)
+      : field_info_(field_offset, field_type) {}
+
+  MemberOffset GetFieldOffset() const { return field_info_.GetFieldOffset(); }
+  Primitive::Type GetFieldType() const { return field_info_.GetFieldType(); }
+
+  virtual Primitive::Type GetType() const { return field_info_.GetFieldType(); }
+
+  virtual SideEffects GetSideEffects() const { return SideEffects::FieldRead(); }
+
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const {
+    return other->AsStaticFieldGet()->GetFieldOffset().Uint32Value()
+        == GetFieldOffset().Uint32Value();
+  }
+
+  DECLARE_INSTRUCTION(StaticFieldGet);
+
+ private:
+  const FieldInfo field_info_;
+
+  DISALLOW_COPY_AND_ASSIGN(HStaticFieldGet);
+};
+
+class HStaticFieldSet : public HTemplateInstruction<1> {
+ public:
+  HStaticFieldSet(HInstruction* value, MemberOffset field_offset, Primitive::Type field_type)
+      : field_info_(field_offset, field_type) {
+    SetRawInputAt(0, value);
+  }
+
+  MemberOffset GetFieldOffset() const { return field_info_.GetFieldOffset(); }
+  Primitive::Type GetFieldType() const { return field_info_.GetFieldType(); }
+
+  virtual SideEffects GetSideEffects() const { return SideEffects::FieldWrite(); }
+
+  DECLARE_INSTRUCTION(StaticFieldSet);
+
+ private:
+  const FieldInfo field_info_;
+
+  DISALLOW_COPY_AND_ASSIGN(HStaticFieldSet);
+};
+
+class HArrayLength : public HTemplateInstruction<1> {
+ public:
+  explicit HArrayLength(HInstruction* array) {
+    SetRawInputAt(0, array);
+  }
+
+  virtual Primitive::Type GetType() const { return Primitive::kPrimInt; }
+
+  // The length of an array never changes.
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const { return true; }
+
+  DECLARE_INSTRUCTION(ArrayLength);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HArrayLength);
+};
+
+// Array accesses expect their array to have been null checked and their index
+// to have been bounds checked.
+class HArrayGet : public HTemplateInstruction<2> {
+ public:
+  HArrayGet(HInstruction* array, HInstruction* index, Primitive::Type type) : type_(type) {
+    SetRawInputAt(0, array);
+    SetRawInputAt(1, index);
+  }
+
+  virtual Primitive::Type GetType() const { return type_; }
+
+  virtual SideEffects GetSideEffects() const { return SideEffects::ArrayRead(type_); }
+
+  virtual bool CanBeMoved() const { return true; }
+  virtual bool InstructionDataEquals(HInstruction* other) const { return true; }
+
+  DECLARE_INSTRUCTION(ArrayGet);
+
+ private:
+  const Primitive::Type type_;
+
+  DISALLOW_COPY_AND_ASSIGN(HArrayGet);
+};
+
+// Stores of references go through the runtime, which also checks that the
+// value can be stored in the array, so they keep their dex pc.
+class HArraySet : public HTemplateInstruction<3> {
+ public:
+  HArraySet(HInstruction* array,
+            HInstruction* index,
+            HInstruction* value,
+            Primitive::Type component_type,
+            uint32_t dex_pc)
+      : component_type_(component_type), dex_pc_(dex_pc) {
+    SetRawInputAt(0, array);
+    SetRawInputAt(1, index);
+    SetRawInputAt(2, value);
+  }
+
+  Primitive::Type GetComponentType() const { return component_type_; }
+  uint32_t GetDexPc() const { return dex_pc_; }
+
+  virtual bool NeedsEnvironment() const { return component_type_ == Primitive::kPrimNot; }
+  virtual bool CanThrow() const { return component_type_ == Primitive::kPrimNot; }
+
+  virtual SideEffects GetSideEffects() const {
+    return SideEffects::ArrayWrite(component_type_);
+  }
+
+  DECLARE_INSTRUCTION(ArraySet);
+
+ private:
+  const Primitive::Type component_type_;
+  const uint32_t dex_pc_;
+
+  DISALLOW_COPY_AND_ASSIGN(HArraySet);
+};
+
 class HPhi : public HInstruction {
  public:
   HPhi(ArenaAllocator* arena, uint32_t reg_number, size_t number_of_inputs, Primitive::Type type)
@@ -23,8 +23,11 @@
 #include "driver/compiler_driver.h"
 #include "driver/dex_compilation_unit.h"
 #include "graph_visualizer.h"
+#include "gvn.h"
+#include "licm.h"
 #include "nodes.h"
 #include "register_allocator.h"
+#include "side_effects_analysis.h"
 #include "ssa_liveness_analysis.h"
 #include "utils/arena_allocator.h"
 
@@ -86,9 +89,8 @@ CompiledMethod* OptimizingCompiler::TryCompile(const DexFile::CodeItem* code_ite
   // with this compiler. This makes sure we're not regressing.
   bool shouldCompile = dex_compilation_unit.GetSymbol().find("00024opt_00024") != std::string::npos;
 
-  ArenaPool pool;
-  ArenaAllocator arena(&pool);
-  HGraphBuilder builder(&arena, &dex_compilation_unit, &dex_file);
+  ArenaAllocator arena(GetCompilerDriver()->GetArenaPool());
+  HGraphBuilder builder(&arena, &dex_compilation_unit, &dex_file, GetCompilerDriver());
 
   HGraph* graph = builder.BuildGraph(*code_item);
   if (graph == nullptr) {
@@ -118,25 +120,33 @@ CompiledMethod* OptimizingCompiler::TryCompile(const DexFile::CodeItem* code_ite
   CodeVectorAllocator allocator;
   codegen->Compile(&allocator);
 
-  std::vector<uint8_t> mapping_table;
-  codegen->BuildMappingTable(&mapping_table);
-  std::vector<uint8_t> vmap_table;
-  codegen->BuildVMapTable(&vmap_table);
-  std::vector<uint8_t> gc_map;
-  codegen->BuildNativeGCMap(&gc_map, dex_compilation_unit);
-
-  // Run these phases to get some test coverage.
-  graph->BuildDominatorTree();
-  graph->TransformToSSA();
-  visualizer.DumpGraph("ssa");
+  std::vector<uint8_t> stack_maps;
+  codegen->BuildStackMaps(&stack_maps, dex_compilation_unit);
+
+  // The code was generated from the graph before SSA, the SSA phases below can't change it yet
+  // and the register allocation is thrown away. Only run them to get some test coverage, on the
+  // methods the tests mark for this compiler.
+  if (shouldCompile) {
+    graph->BuildDominatorTree();
+    graph->TransformToSSA();
+    visualizer.DumpGraph("ssa");
+
+    if (graph->FindNaturalLoops()) {
+      SideEffectsAnalysis side_effects(graph);
+      side_effects.Run();
+      GlobalValueNumberer(graph->GetArena(), graph, side_effects).Run();
+      visualizer.DumpGraph("gvn");
+      LICM(graph, side_effects).Run();
+      visualizer.DumpGraph("licm");
+    }
 
-  graph->FindNaturalLoops();
-  SsaLivenessAnalysis liveness(*graph);
-  liveness.Analyze();
-  visualizer.DumpGraph("liveness");
+    SsaLivenessAnalysis liveness(*graph);
+    liveness.Analyze();
+    visualizer.DumpGraph("liveness");
 
-  RegisterAllocator(graph->GetArena(), *codegen).AllocateRegisters(liveness);
-  visualizer.DumpGraph("register");
+    RegisterAllocator(graph->GetArena(), *codegen).AllocateRegisters(liveness);
+    visualizer.DumpGraph("register");
+  }
 
   return new CompiledMethod(GetCompilerDriver(),
                             instruction_set,
@@ -144,10 +154,7 @@ CompiledMethod* OptimizingCompiler::TryCompile(const DexFile::CodeItem* code_ite
                             codegen->GetFrameSize(),
                             codegen->GetCoreSpillMask(),
                             0, /* FPR spill mask, unused */
-                            mapping_table,
-                            vmap_table,
-                            gc_map,
-                            nullptr);
+                            stack_maps);
 }
 
 }  // namespace art
@@ -22,6 +22,7 @@
 namespace art {
 
 static constexpr size_t kMaxLifetimePosition = -1;
+static constexpr size_t kDefaultNumberOfSpillSlots = 4;
 
 RegisterAllocator::RegisterAllocator(ArenaAllocator* allocator, const CodeGenerator& codegen)
       : allocator_(allocator),
@@ -30,6 +31,7 @@ RegisterAllocator::RegisterAllocator(ArenaAllocator* allocator, const CodeGenera
         handled_(allocator, 0),
         active_(allocator, 0),
         inactive_(allocator, 0),
+        spill_slots_(allocator, kDefaultNumberOfSpillSlots),
         processing_core_registers_(false),
         number_of_registers_(-1),
         registers_array_(nullptr),
@@ -37,6 +39,12 @@ RegisterAllocator::RegisterAllocator(ArenaAllocator* allocator, const CodeGenera
   codegen.SetupBlockedRegisters(blocked_registers_);
 }
 
+static size_t NumberOfSpillSlotsFor(LiveInterval* interval) {
+  bool is_wide = interval->GetType() == Primitive::kPrimLong
+      || interval->GetType() == Primitive::kPrimDouble;
+  return is_wide ? 2 : 1;
+}
+
 static bool ShouldProcess(bool processing_core_registers, HInstruction* instruction) {
   bool is_core_register = (instruction->GetType() != Primitive::kPrimDouble)
       && (instruction->GetType() != Primitive::kPrimFloat);
@@ -128,6 +136,34 @@ bool RegisterAllocator::ValidateIntervals(const GrowableArray<LiveInterval*>& ra
       } while ((range = range->GetNext()) != nullptr);
     } while ((current = current->GetNextSibling()) != nullptr);
   }
+
+  // Check that instructions live at the same time don't share a spill slot.
+  GrowableArray<ArenaBitVector*> spill_slots(allocator, 0);
+  for (size_t i = 0, e = ranges.Size(); i < e; ++i) {
+    LiveInterval* parent = ranges.Get(i)->GetParent();
+    if (parent != ranges.Get(i) || !parent->HasSpillSlot()) {
+      continue;
+    }
+    size_t number_of_slots = NumberOfSpillSlotsFor(parent);
+    for (size_t slot = parent->GetSpillSlot(); slot < parent->GetSpillSlot() + number_of_slots;
+         ++slot) {
+      while (spill_slots.Size() <= slot) {
+        spill_slots.Add(new (allocator) ArenaBitVector(allocator, 0, true));
+      }
+      BitVector* vector = spill_slots.Get(slot);
+      for (size_t j = parent->GetStart(), end = parent->GetLastSibling()->GetEnd(); j < end; ++j) {
+        if (vector->IsBitSet(j)) {
+          if (log_fatal_on_failure) {
+            LOG(FATAL) << "Spill slot conflict at " << j << " for slot " << slot;
+          } else {
+            return false;
+          }
+        } else {
+          vector->SetBit(j);
+        }
+      }
+    }
+  }
   return true;
 }
 
@@ -269,8 +305,8 @@ bool RegisterAllocator::IsBlocked(int reg) const {
 // we spill `current` instead.
 bool RegisterAllocator::AllocateBlockedReg(LiveInterval* current) {
   size_t first_register_use = current->FirstRegisterUse();
-  if (current->FirstRegisterUse() == kNoLifetime) {
-    // TODO: Allocate spill slot for `current`.
+  if (first_register_use == kNoLifetime) {
+    AllocateSpillSlotFor(current);
     return false;
   }
 
@@ -317,6 +353,8 @@ bool RegisterAllocator::AllocateBlockedReg(LiveInterval* current) {
   if (first_register_use >= next_use[reg]) {
     // If the first use of that instruction is after the last use of the found
     // register, we split this interval just before its first register use.
+    // Until then, it lives in its spill slot.
+    AllocateSpillSlotFor(current);
     LiveInterval* split = Split(current, first_register_use - 1);
     AddToUnhandled(split);
     return false;
@@ -352,13 +390,17 @@ bool RegisterAllocator::AllocateBlockedReg(LiveInterval* current) {
 }
 
 void RegisterAllocator::AddToUnhandled(LiveInterval* interval) {
+  size_t insert_at = 0;
   for (size_t i = unhandled_.Size(); i > 0; --i) {
     LiveInterval* current = unhandled_.Get(i - 1);
     if (current->StartsAfter(interval)) {
-      unhandled_.InsertAt(i, interval);
+      insert_at = i;
       break;
     }
   }
+  // If no interval starts after `interval`, it goes first as it is the last one
+  // to process.
+  unhandled_.InsertAt(insert_at, interval);
 }
 
 LiveInterval* RegisterAllocator::Split(LiveInterval* interval, size_t position) {
@@ -370,9 +412,61 @@ LiveInterval* RegisterAllocator::Split(LiveInterval* interval, size_t position)
     return interval;
   } else {
     LiveInterval* new_interval = interval->SplitAt(position);
-    // TODO: Allocate spill slot for `interval`.
     return new_interval;
   }
 }
 
+void RegisterAllocator::AllocateSpillSlotFor(LiveInterval* interval) {
+  LiveInterval* parent = interval->GetParent();
+
+  // An instruction gets a spill slot for its entire lifetime. If the parent
+  // of this interval already has a spill slot, there is nothing to do.
+  if (parent->HasSpillSlot()) {
+    return;
+  }
+
+  HInstruction* defined_by = parent->GetDefinedBy();
+  if (defined_by != nullptr) {
+    if (defined_by->AsParameterValue() != nullptr) {
+      // Parameters are already in the stack, in the caller's frame.
+      return;
+    }
+    if (defined_by->AsIntConstant() != nullptr || defined_by->AsLongConstant() != nullptr) {
+      // Constants are rematerialized at their uses, and don't need a spill slot.
+      return;
+    }
+  }
+
+  size_t end = interval->GetLastSibling()->GetEnd();
+  size_t number_of_slots = NumberOfSpillSlotsFor(parent);
+
+  // Find available spill slots. Intervals are processed by increasing start
+  // position, so a slot whose last interval ended before the start of `parent` is
+  // not used by any other interval live with it. We compare strictly so that the
+  // value of an instruction and the value of its last input don't share a slot.
+  size_t slot = 0;
+  for (size_t e = spill_slots_.Size(); slot < e; ++slot) {
+    bool available = true;
+    for (size_t i = slot; i < slot + number_of_slots && i < e; ++i) {
+      if (spill_slots_.Get(i) >= parent->GetStart()) {
+        available = false;
+        break;
+      }
+    }
+    if (available) {
+      break;
+    }
+  }
+
+  for (size_t i = slot; i < slot + number_of_slots; ++i) {
+    if (i == spill_slots_.Size()) {
+      spill_slots_.Add(end);
+    } else {
+      spill_slots_.Put(i, end);
+    }
+  }
+
+  parent->SetSpillSlot(slot);
+}
+
 }  // namespace art
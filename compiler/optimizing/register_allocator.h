@@ -53,6 +53,10 @@ class RegisterAllocator {
     return ValidateInternal(liveness, log_fatal_on_failure);
   }
 
+  // Returns the number of stack slots needed for the spilled intervals. A long or
+  // double interval takes two consecutive slots.
+  size_t GetNumberOfSpillSlots() const { return spill_slots_.Size(); }
+
   // Helper method for validation. Used by unit testing.
   static bool ValidateIntervals(const GrowableArray<LiveInterval*>& intervals,
                                 const CodeGenerator& codegen,
@@ -75,6 +79,10 @@ class RegisterAllocator {
   // Returns whether `reg` is blocked by the code generator.
   bool IsBlocked(int reg) const;
 
+  // Allocate a spill slot for the given interval, if its instruction does not
+  // already have one.
+  void AllocateSpillSlotFor(LiveInterval* interval);
+
   // Helper methods.
   void AllocateRegistersInternal(const SsaLivenessAnalysis& liveness);
   bool ValidateInternal(const SsaLivenessAnalysis& liveness, bool log_fatal_on_failure) const;
@@ -98,6 +106,10 @@ class RegisterAllocator {
   // That is, they have a lifetime hole that spans the start of the new interval.
   GrowableArray<LiveInterval*> inactive_;
 
+  // The end position of the last interval using each spill slot. A slot can be
+  // reused by an interval starting after that position.
+  GrowableArray<size_t> spill_slots_;
+
   // True if processing core registers. False if processing floating
   // point registers.
   bool processing_core_registers_;
@@ -125,6 +125,25 @@ TEST(RegisterAllocatorTest, ValidateIntervals) {
 
     intervals.Get(0)->GetNextSibling()->SetRegister(0);
     ASSERT_FALSE(RegisterAllocator::ValidateIntervals(intervals, *codegen, &allocator, true, false));
+    intervals.Reset();
+  }
+
+  // Test with spill slots.
+  {
+    static constexpr size_t ranges1[][2] = {{0, 42}};
+    intervals.Add(BuildInterval(ranges1, arraysize(ranges1), &allocator));
+    static constexpr size_t ranges2[][2] = {{40, 50}};
+    intervals.Add(BuildInterval(ranges2, arraysize(ranges2), &allocator));
+    static constexpr size_t ranges3[][2] = {{42, 48}};
+    intervals.Add(BuildInterval(ranges3, arraysize(ranges3), &allocator));
+    intervals.Get(0)->SetSpillSlot(0);
+    intervals.Get(1)->SetSpillSlot(1);
+    intervals.Get(2)->SetSpillSlot(0);
+    // The first and third intervals are not live at the same time.
+    ASSERT_TRUE(RegisterAllocator::ValidateIntervals(intervals, *codegen, &allocator, true, false));
+
+    intervals.Get(2)->SetSpillSlot(1);
+    ASSERT_FALSE(RegisterAllocator::ValidateIntervals(intervals, *codegen, &allocator, true, false));
   }
 }
 
@@ -307,4 +326,70 @@ TEST(RegisterAllocatorTest, Loop3) {
   ASSERT_EQ(phi_interval->GetRegister(), ret->InputAt(0)->GetLiveInterval()->GetRegister());
 }
 
+static size_t NumberOfSpillSlots(const uint16_t* data) {
+  ArenaPool pool;
+  ArenaAllocator allocator(&pool);
+  HGraph* graph = BuildSSAGraph(data, &allocator);
+  SsaLivenessAnalysis liveness(*graph);
+  liveness.Analyze();
+  CodeGenerator* codegen = CodeGenerator::Create(&allocator, graph, kX86);
+  RegisterAllocator register_allocator(&allocator, *codegen);
+  register_allocator.AllocateRegisters(liveness);
+  EXPECT_TRUE(register_allocator.Validate(liveness, false));
+  return register_allocator.GetNumberOfSpillSlots();
+}
+
+TEST(RegisterAllocatorTest, SpillSlotReuse) {
+  /*
+   * Test the following snippet, which has more live values than
+   * allocatable registers on x86:
+   *  int a = 1;
+   *  int b = a + 1, c = a + 2, d = a + 3, e = a + 4, f = a + 5;
+   *  a = b + c + d + e + f;
+   *  return a;
+   */
+  const uint16_t one_pass[] = SIX_REGISTERS_CODE_ITEM(
+    Instruction::CONST_4 | 1 << 12 | 0 << 8,
+    Instruction::ADD_INT_LIT8 | 1 << 8, 1 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 2 << 8, 2 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 3 << 8, 3 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 4 << 8, 4 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 5 << 8, 5 << 8 | 0,
+    Instruction::ADD_INT | 0 << 8, 2 << 8 | 1,
+    Instruction::ADD_INT | 0 << 8, 3 << 8 | 0,
+    Instruction::ADD_INT | 0 << 8, 4 << 8 | 0,
+    Instruction::ADD_INT | 0 << 8, 5 << 8 | 0,
+    Instruction::RETURN | 0 << 8);
+
+  size_t slots_for_one_pass = NumberOfSpillSlots(one_pass);
+  ASSERT_NE(0u, slots_for_one_pass);
+
+  // Do the same computation twice in a row: the values of the second pass are
+  // not live at the same time as the ones of the first pass, and must reuse
+  // their spill slots.
+  const uint16_t two_passes[] = SIX_REGISTERS_CODE_ITEM(
+    Instruction::CONST_4 | 1 << 12 | 0 << 8,
+    Instruction::ADD_INT_LIT8 | 1 << 8, 1 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 2 << 8, 2 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 3 << 8, 3 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 4 << 8, 4 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 5 << 8, 5 << 8 | 0,
+    Instruction::ADD_INT | 0 << 8, 2 << 8 | 1,
+    Instruction::ADD_INT | 0 << 8, 3 << 8 | 0,
+    Instruction::ADD_INT | 0 << 8, 4 << 8 | 0,
+    Instruction::ADD_INT | 0 << 8, 5 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 1 << 8, 1 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 2 << 8, 2 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 3 << 8, 3 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 4 << 8, 4 << 8 | 0,
+    Instruction::ADD_INT_LIT8 | 5 << 8, 5 << 8 | 0,
+    Instruction::ADD_INT | 0 << 8, 2 << 8 | 1,
+    Instruction::ADD_INT | 0 << 8, 3 << 8 | 0,
+    Instruction::ADD_INT | 0 << 8, 4 << 8 | 0,
+    Instruction::ADD_INT | 0 << 8, 5 << 8 | 0,
+    Instruction::RETURN | 0 << 8);
+
+  ASSERT_EQ(slots_for_one_pass, NumberOfSpillSlots(two_passes));
+}
+
 }  // namespace art
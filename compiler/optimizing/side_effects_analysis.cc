@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "side_effects_analysis.h"
+
+namespace art {
+
+void SideEffectsAnalysis::Run() {
+  const GrowableArray<HBasicBlock*>& blocks = graph_->GetBlocks();
+  for (size_t i = 0; i < blocks.Size(); ++i) {
+    SideEffects effects = SideEffects::None();
+    HBasicBlock* block = blocks.Get(i);
+    for (HInstructionIterator it(block->GetInstructions()); !it.Done(); it.Advance()) {
+      effects = effects.Union(it.Current()->GetSideEffects());
+    }
+    block_effects_.Put(i, effects);
+  }
+
+  // The blocks of a loop include the blocks of its inner loops.
+  for (size_t i = 0; i < blocks.Size(); ++i) {
+    SideEffects effects = SideEffects::None();
+    HBasicBlock* header = blocks.Get(i);
+    if (header->IsLoopHeader()) {
+      HLoopInformation* info = header->GetLoopInformation();
+      for (size_t j = 0; j < blocks.Size(); ++j) {
+        if (info->Contains(*blocks.Get(j))) {
+          effects = effects.Union(block_effects_.Get(j));
+        }
+      }
+    }
+    loop_effects_.Put(i, effects);
+  }
+}
+
+SideEffects SideEffectsAnalysis::GetBlockEffects(HBasicBlock* block) const {
+  return block_effects_.Get(block->GetBlockId());
+}
+
+SideEffects SideEffectsAnalysis::GetLoopEffects(HBasicBlock* block) const {
+  DCHECK(block->IsLoopHeader());
+  return loop_effects_.Get(block->GetBlockId());
+}
+
+}  // namespace art
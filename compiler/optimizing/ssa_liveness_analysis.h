@@ -117,14 +117,17 @@ class UsePosition : public ArenaObject {
  */
 class LiveInterval : public ArenaObject {
  public:
-  LiveInterval(ArenaAllocator* allocator, Primitive::Type type)
+  LiveInterval(ArenaAllocator* allocator, Primitive::Type type, HInstruction* defined_by = nullptr)
       : allocator_(allocator),
         first_range_(nullptr),
         last_range_(nullptr),
         first_use_(nullptr),
         type_(type),
         next_sibling_(nullptr),
-        register_(kNoRegister) {}
+        parent_(this),
+        defined_by_(defined_by),
+        register_(kNoRegister),
+        spill_slot_(kNoSpillSlot) {}
 
   void AddUse(HInstruction* instruction) {
     size_t position = instruction->GetLifetimePosition();
@@ -185,6 +188,18 @@ class LiveInterval : public ArenaObject {
 
   LiveRange* GetFirstRange() const { return first_range_; }
 
+  // Returns the instruction defining this interval, if this interval is not the result
+  // of a split. Intervals built by tests don't have one.
+  HInstruction* GetDefinedBy() const { return defined_by_; }
+
+  // Returns the interval this interval has been split from, or itself.
+  LiveInterval* GetParent() const { return parent_; }
+
+  // The spill slot is shared by all siblings, and only set on the parent.
+  int GetSpillSlot() const { return spill_slot_; }
+  void SetSpillSlot(int slot) { spill_slot_ = slot; }
+  bool HasSpillSlot() const { return spill_slot_ != kNoSpillSlot; }
+
   int GetRegister() const { return register_; }
   void SetRegister(int reg) { register_ = reg; }
   void ClearRegister() { register_ = kNoRegister; }
@@ -252,6 +267,18 @@ class LiveInterval : public ArenaObject {
     return first_range_->GetStart();
   }
 
+  size_t GetEnd() const {
+    return last_range_->GetEnd();
+  }
+
+  LiveInterval* GetLastSibling() {
+    LiveInterval* result = this;
+    while (result->next_sibling_ != nullptr) {
+      result = result->next_sibling_;
+    }
+    return result;
+  }
+
   size_t FirstRegisterUseAfter(size_t position) const {
     UsePosition* use = first_use_;
     while (use != nullptr) {
@@ -293,6 +320,7 @@ class LiveInterval : public ArenaObject {
     }
 
     LiveInterval* new_interval = new (allocator_) LiveInterval(allocator_, type_);
+    new_interval->parent_ = parent_;
     next_sibling_ = new_interval;
 
     new_interval->first_use_ = first_use_;
@@ -383,10 +411,21 @@ class LiveInterval : public ArenaObject {
   // Live interval that is the result of a split.
   LiveInterval* next_sibling_;
 
+  // The first interval from which split intervals come from.
+  LiveInterval* parent_;
+
+  // The instruction represented by this interval.
+  HInstruction* const defined_by_;
+
   // The register allocated to this interval.
   int register_;
 
+  // The spill slot allocated to this interval, if one of its siblings is not
+  // in a register.
+  int spill_slot_;
+
   static constexpr int kNoRegister = -1;
+  static constexpr int kNoSpillSlot = -1;
 
   DISALLOW_COPY_AND_ASSIGN(LiveInterval);
 };
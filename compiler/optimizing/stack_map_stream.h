@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_COMPILER_OPTIMIZING_STACK_MAP_STREAM_H_
+#define ART_COMPILER_OPTIMIZING_STACK_MAP_STREAM_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "base/bit_vector.h"
+#include "stack_map.h"
+#include "utils/allocation.h"
+#include "utils/growable_array.h"
+
+namespace art {
+
+/**
+ * Collects the safepoints of a method and encodes them into a CodeInfo, see stack_map.h.
+ * The stack maps are added in increasing native pc offset order, each followed by the
+ * locations of its dex registers.
+ */
+class StackMapStream : public ValueObject {
+ public:
+  explicit StackMapStream(ArenaAllocator* allocator)
+      : allocator_(allocator),
+        stack_maps_(allocator, 16),
+        dex_register_locations_(allocator, 16),
+        number_of_dex_registers_(0) {}
+
+  void AddStackMapEntry(uint32_t dex_pc,
+                        uint32_t native_pc_offset,
+                        uint32_t register_mask,
+                        const BitVector* stack_mask,
+                        uint16_t number_of_dex_registers) {
+    if (stack_maps_.Size() == 0) {
+      number_of_dex_registers_ = number_of_dex_registers;
+    } else {
+      // The stack maps are binary searched.
+      DCHECK_GE(native_pc_offset, stack_maps_.Get(stack_maps_.Size() - 1).native_pc_offset);
+      CHECK_EQ(number_of_dex_registers_, number_of_dex_registers);
+    }
+    StackMapEntry entry;
+    entry.dex_pc = dex_pc;
+    entry.native_pc_offset = native_pc_offset;
+    entry.register_mask = register_mask;
+    entry.stack_mask_size = 0;
+    entry.stack_mask = nullptr;
+    if (stack_mask != nullptr) {
+      int highest_bit = stack_mask->GetHighestBitSet();
+      if (highest_bit >= 0) {
+        entry.stack_mask_size = RoundUp(highest_bit + 1, kBitsPerByte) / kBitsPerByte;
+        entry.stack_mask = allocator_->AllocArray<uint8_t>(entry.stack_mask_size);
+        for (uint32_t slot : stack_mask->Indexes()) {
+          entry.stack_mask[slot / kBitsPerByte] |= 1 << (slot % kBitsPerByte);
+        }
+      }
+    }
+    entry.dex_register_locations_start = dex_register_locations_.Size();
+    stack_maps_.Add(entry);
+  }
+
+  void AddDexRegisterEntry(DexRegisterMap::LocationKind kind, int32_t value) {
+    DCHECK_NE(stack_maps_.Size(), 0u);
+    DexRegisterEntry entry;
+    entry.kind = kind;
+    entry.value = value;
+    dex_register_locations_.Add(entry);
+  }
+
+  void FillIn(std::vector<uint8_t>* data) const {
+    const size_t number_of_stack_maps = stack_maps_.Size();
+    DCHECK_EQ(dex_register_locations_.Size(), number_of_stack_maps * number_of_dex_registers_);
+    // Share the dex register maps of the stack maps with the same locations.
+    std::vector<size_t> unique_maps;
+    std::vector<size_t> map_indexes(number_of_stack_maps);
+    uint32_t max_native_pc_offset = 0;
+    uint32_t max_dex_pc = 0;
+    uint32_t register_masks = 0;
+    size_t stack_mask_size = 0;
+    for (size_t i = 0; i < number_of_stack_maps; ++i) {
+      const StackMapEntry& entry = stack_maps_.Get(i);
+      max_native_pc_offset = std::max(max_native_pc_offset, entry.native_pc_offset);
+      max_dex_pc = std::max(max_dex_pc, entry.dex_pc);
+      register_masks |= entry.register_mask;
+      stack_mask_size = std::max(stack_mask_size, entry.stack_mask_size);
+      size_t map_index = 0;
+      while (map_index < unique_maps.size() &&
+             !SameDexRegisterMaps(unique_maps[map_index], entry.dex_register_locations_start)) {
+        ++map_index;
+      }
+      if (map_index == unique_maps.size()) {
+        unique_maps.push_back(entry.dex_register_locations_start);
+      }
+      map_indexes[i] = map_index;
+    }
+    const size_t dex_register_map_size = number_of_dex_registers_ * DexRegisterMap::kEntrySize;
+    const bool has_dex_register_maps = number_of_dex_registers_ != 0;
+    const size_t native_pc_size = PackedValueSize(max_native_pc_offset);
+    const size_t dex_pc_size = PackedValueSize(max_dex_pc);
+    const size_t register_mask_size = PackedValueSize(register_masks);
+    // The offsets are stored plus one, zero means no dex register map.
+    const size_t dex_register_map_offset_size = has_dex_register_maps
+        ? PackedValueSize((unique_maps.size() - 1) * dex_register_map_size + 1)
+        : 0;
+    const size_t stack_map_size = native_pc_size + dex_pc_size + register_mask_size +
+        dex_register_map_offset_size + stack_mask_size;
+    const size_t dex_register_maps_start =
+        CodeInfo::kHeaderSize + number_of_stack_maps * stack_map_size;
+    const size_t total_size = dex_register_maps_start +
+        (has_dex_register_maps ? unique_maps.size() * dex_register_map_size : 0);
+    CHECK_LE(stack_mask_size, 0xffffu);
+    data->assign(total_size, 0);
+
+    uint8_t* out = &(*data)[0];
+    StorePackedValue(out, total_size, 4);
+    StorePackedValue(out + 4, number_of_stack_maps, 4);
+    StorePackedValue(out + 8, number_of_dex_registers_, 2);
+    out[10] = native_pc_size;
+    out[11] = dex_pc_size;
+    out[12] = register_mask_size;
+    out[13] = dex_register_map_offset_size;
+    StorePackedValue(out + 14, stack_mask_size, 2);
+    out += CodeInfo::kHeaderSize;
+    for (size_t i = 0; i < number_of_stack_maps; ++i) {
+      const StackMapEntry& entry = stack_maps_.Get(i);
+      StorePackedValue(out, entry.native_pc_offset, native_pc_size);
+      out += native_pc_size;
+      StorePackedValue(out, entry.dex_pc, dex_pc_size);
+      out += dex_pc_size;
+      StorePackedValue(out, entry.register_mask, register_mask_size);
+      out += register_mask_size;
+      if (has_dex_register_maps) {
+        StorePackedValue(out, map_indexes[i] * dex_register_map_size + 1,
+                         dex_register_map_offset_size);
+      }
+      out += dex_register_map_offset_size;
+      if (entry.stack_mask_size != 0) {
+        memcpy(out, entry.stack_mask, entry.stack_mask_size);
+      }
+      out += stack_mask_size;
+    }
+    if (has_dex_register_maps) {
+      for (size_t start : unique_maps) {
+        for (size_t i = 0; i < number_of_dex_registers_; ++i) {
+          const DexRegisterEntry& entry = dex_register_locations_.Get(start + i);
+          out[0] = entry.kind;
+          StorePackedValue(out + 1, static_cast<uint32_t>(entry.value), sizeof(int32_t));
+          out += DexRegisterMap::kEntrySize;
+        }
+      }
+    }
+    DCHECK_EQ(static_cast<size_t>(out - &(*data)[0]), total_size);
+  }
+
+ private:
+  struct StackMapEntry {
+    uint32_t dex_pc;
+    uint32_t native_pc_offset;
+    uint32_t register_mask;
+    size_t stack_mask_size;
+    uint8_t* stack_mask;
+    size_t dex_register_locations_start;
+  };
+
+  struct DexRegisterEntry {
+    DexRegisterMap::LocationKind kind;
+    int32_t value;
+  };
+
+  static void StorePackedValue(uint8_t* data, uint32_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<uint8_t>(value >> (i * kBitsPerByte));
+    }
+    DCHECK_EQ(LoadPackedValue(data, size), value);
+  }
+
+  bool SameDexRegisterMaps(size_t start, size_t other_start) const {
+    for (size_t i = 0; i < number_of_dex_registers_; ++i) {
+      const DexRegisterEntry& entry = dex_register_locations_.Get(start + i);
+      const DexRegisterEntry& other = dex_register_locations_.Get(other_start + i);
+      if (entry.kind != other.kind || entry.value != other.value) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  ArenaAllocator* const allocator_;
+  GrowableArray<StackMapEntry> stack_maps_;
+  GrowableArray<DexRegisterEntry> dex_register_locations_;
+  uint16_t number_of_dex_registers_;
+
+  DISALLOW_COPY_AND_ASSIGN(StackMapStream);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_OPTIMIZING_STACK_MAP_STREAM_H_
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "stack_map.h"
+#include "stack_map_stream.h"
+#include "utils/arena_bit_vector.h"
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+TEST(StackMapTest, OneStackMap) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  StackMapStream stream(&arena);
+
+  ArenaBitVector sp_mask(&arena, 0, true);
+  sp_mask.SetBit(2);
+  sp_mask.SetBit(4);
+  stream.AddStackMapEntry(0, 64, 0x3, &sp_mask, 2);
+  stream.AddDexRegisterEntry(DexRegisterMap::kInStack, 0);
+  stream.AddDexRegisterEntry(DexRegisterMap::kConstant, -2);
+
+  std::vector<uint8_t> data;
+  stream.FillIn(&data);
+  CodeInfo code_info(&data[0]);
+  ASSERT_EQ(data.size(), code_info.GetSizeInBytes());
+  ASSERT_EQ(1u, code_info.GetNumberOfStackMaps());
+  ASSERT_EQ(2u, code_info.GetNumberOfDexRegisters());
+
+  size_t index;
+  ASSERT_TRUE(code_info.FindStackMapForDexPc(0, &index));
+  ASSERT_EQ(0u, index);
+  ASSERT_TRUE(code_info.FindStackMapForNativePcOffset(64, &index));
+  ASSERT_EQ(0u, index);
+  ASSERT_FALSE(code_info.FindStackMapForNativePcOffset(65, &index));
+
+  StackMap stack_map = code_info.GetStackMapAt(0);
+  ASSERT_EQ(0u, stack_map.GetDexPc());
+  ASSERT_EQ(64u, stack_map.GetNativePcOffset());
+  ASSERT_EQ(0x3u, stack_map.GetRegisterMask());
+  ASSERT_FALSE(stack_map.IsStackSlotReference(0));
+  ASSERT_TRUE(stack_map.IsStackSlotReference(2));
+  ASSERT_TRUE(stack_map.IsStackSlotReference(4));
+  ASSERT_FALSE(stack_map.IsStackSlotReference(5));
+  ASSERT_FALSE(stack_map.IsStackSlotReference(1000));
+
+  ASSERT_TRUE(stack_map.HasDexRegisterMap());
+  DexRegisterMap dex_registers = code_info.GetDexRegisterMapOf(stack_map);
+  ASSERT_EQ(DexRegisterMap::kInStack, dex_registers.GetLocationKind(0));
+  ASSERT_EQ(DexRegisterMap::kConstant, dex_registers.GetLocationKind(1));
+  ASSERT_EQ(0, dex_registers.GetValue(0));
+  ASSERT_EQ(-2, dex_registers.GetValue(1));
+}
+
+TEST(StackMapTest, BinarySearchAndSharedDexRegisterMaps) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  StackMapStream stream(&arena);
+
+  static constexpr size_t kNumberOfStackMaps = 300;
+  for (size_t i = 0; i < kNumberOfStackMaps; ++i) {
+    ArenaBitVector sp_mask(&arena, 0, true);
+    sp_mask.SetBit(i % 40);
+    // The native pcs need two bytes, the dex pcs one.
+    stream.AddStackMapEntry(i % 7, 10 + i * 4, 0, &sp_mask, 3);
+    stream.AddDexRegisterEntry(DexRegisterMap::kInStack, 8);
+    stream.AddDexRegisterEntry(DexRegisterMap::kInRegister, 3);
+    stream.AddDexRegisterEntry(i % 2 == 0 ? DexRegisterMap::kNone : DexRegisterMap::kConstant, 0);
+  }
+
+  std::vector<uint8_t> data;
+  stream.FillIn(&data);
+  CodeInfo code_info(&data[0]);
+  ASSERT_EQ(kNumberOfStackMaps, code_info.GetNumberOfStackMaps());
+  // 2 bytes of native pc, 1 of dex pc, none of register mask, 1 of dex register map offset and
+  // 5 of stack mask per stack map, and two distinct dex register maps.
+  EXPECT_EQ(CodeInfo::kHeaderSize + kNumberOfStackMaps * 9 + 2 * 3 * DexRegisterMap::kEntrySize,
+            data.size());
+
+  for (size_t i = 0; i < kNumberOfStackMaps; ++i) {
+    size_t index;
+    ASSERT_TRUE(code_info.FindStackMapForNativePcOffset(10 + i * 4, &index));
+    ASSERT_EQ(i, index);
+    ASSERT_FALSE(code_info.FindStackMapForNativePcOffset(11 + i * 4, &index));
+    StackMap stack_map = code_info.GetStackMapAt(index);
+    ASSERT_EQ(i % 7, stack_map.GetDexPc());
+    ASSERT_EQ(0u, stack_map.GetRegisterMask());
+    ASSERT_TRUE(stack_map.IsStackSlotReference(i % 40));
+    ASSERT_FALSE(stack_map.IsStackSlotReference((i + 1) % 40));
+    DexRegisterMap dex_registers = code_info.GetDexRegisterMapOf(stack_map);
+    ASSERT_EQ(DexRegisterMap::kInStack, dex_registers.GetLocationKind(0));
+    ASSERT_EQ(8, dex_registers.GetValue(0));
+    ASSERT_EQ(DexRegisterMap::kInRegister, dex_registers.GetLocationKind(1));
+    ASSERT_EQ(3, dex_registers.GetValue(1));
+    ASSERT_EQ(i % 2 == 0 ? DexRegisterMap::kNone : DexRegisterMap::kConstant,
+              dex_registers.GetLocationKind(2));
+  }
+  size_t index;
+  ASSERT_FALSE(code_info.FindStackMapForNativePcOffset(0, &index));
+  ASSERT_FALSE(code_info.FindStackMapForNativePcOffset(10 + kNumberOfStackMaps * 4, &index));
+}
+
+TEST(StackMapTest, NoDexRegisters) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  StackMapStream stream(&arena);
+  stream.AddStackMapEntry(3, 5, 0, nullptr, 0);
+
+  std::vector<uint8_t> data;
+  stream.FillIn(&data);
+  CodeInfo code_info(&data[0]);
+  ASSERT_EQ(1u, code_info.GetNumberOfStackMaps());
+  StackMap stack_map = code_info.GetStackMapAt(0);
+  ASSERT_EQ(3u, stack_map.GetDexPc());
+  ASSERT_EQ(5u, stack_map.GetNativePcOffset());
+  ASSERT_FALSE(stack_map.HasDexRegisterMap());
+  ASSERT_FALSE(stack_map.IsStackSlotReference(0));
+}
+
+}  // namespace art
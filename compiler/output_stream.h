@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <string>
 
@@ -44,8 +45,30 @@ class OutputStream {
 
   virtual bool WriteFully(const void* buffer, size_t byte_count) = 0;
 
+  // Writes the buffers in order, with a single system call where the stream supports it.
+  virtual bool WriteVectored(const struct iovec* iov, int iov_count) {
+    for (int i = 0; i != iov_count; ++i) {
+      if (!WriteFully(iov[i].iov_base, iov[i].iov_len)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   virtual off_t Seek(off_t offset, Whence whence) = 0;
 
+  // Reserves the space of the final size of the output so that writing it does not fragment it.
+  // Streams that do not write a file ignore it.
+  virtual bool Preallocate(off_t size) {
+    UNUSED(size);
+    return true;
+  }
+
+  // Writes out the data kept by the stream.
+  virtual bool Flush() {
+    return true;
+  }
+
  private:
   const std::string location_;
 
@@ -87,6 +87,46 @@ TEST_F(OutputStreamTest, Buffered) {
   CheckTestOutput(actual);
 }
 
+TEST_F(OutputStreamTest, BufferedVectored) {
+  ScratchFile tmp;
+  std::unique_ptr<BufferedOutputStream> output_stream(
+      new BufferedOutputStream(new FileOutputStream(tmp.GetFile())));
+  EXPECT_TRUE(output_stream->Preallocate(64 * KB));
+  // A small write stays in the buffer and goes out with the large one after it.
+  std::vector<uint8_t> small(10, 1u);
+  std::vector<uint8_t> large(32 * KB);
+  for (size_t i = 0; i != large.size(); ++i) {
+    large[i] = i & 0xff;
+  }
+  EXPECT_TRUE(output_stream->WriteFully(&small[0], small.size()));
+  EXPECT_TRUE(output_stream->WriteFully(&large[0], large.size()));
+  struct iovec iov[] = {
+      { &small[0], small.size() },
+      { &large[0], large.size() },
+  };
+  EXPECT_TRUE(output_stream->WriteFully(&small[0], small.size()));
+  EXPECT_TRUE(output_stream->WriteVectored(iov, 2));
+  EXPECT_EQ(static_cast<off_t>(2 * (small.size() + large.size()) + small.size()),
+            output_stream->Seek(0, kSeekCurrent));
+  output_stream.reset();
+
+  std::vector<uint8_t> expected;
+  for (size_t i = 0; i != 2; ++i) {
+    expected.insert(expected.end(), small.begin(), small.end());
+    if (i == 1) {
+      expected.insert(expected.end(), small.begin(), small.end());
+    }
+    expected.insert(expected.end(), large.begin(), large.end());
+  }
+  std::unique_ptr<File> in(OS::OpenFileForReading(tmp.GetFilename().c_str()));
+  ASSERT_TRUE(in.get() != NULL);
+  // The preallocation keeps the size of the file to what was written.
+  ASSERT_EQ(static_cast<int64_t>(expected.size()), in->GetLength());
+  std::vector<uint8_t> actual(in->GetLength());
+  EXPECT_TRUE(in->ReadFully(&actual[0], actual.size()));
+  EXPECT_TRUE(expected == actual);
+}
+
 TEST_F(OutputStreamTest, Vector) {
   std::vector<uint8_t> output;
   VectorOutputStream output_stream("test vector output", output);
@@ -13,6 +13,9 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <deque>
+#include <set>
+
 #include "scoped_thread_state_change.h"
 #include "sea_ir/types/type_inference.h"
 #include "sea_ir/types/type_inference_visitor.h"
@@ -142,7 +145,9 @@ std::vector<const Type*> FunctionTypeInfo::GetDeclaredArgumentTypes() {
 // TODO: Lock is only used for dumping types (during development). Remove this for performance.
 void TypeInference::ComputeTypes(SeaGraph* graph) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   std::vector<Region*>* regions = graph->GetRegions();
-  std::list<InstructionNode*> worklist;
+  std::deque<InstructionNode*> worklist;
+  // Instructions currently in the work-list, so that each is queued at most once.
+  std::set<InstructionNode*> queued;
   // Fill the work-list with all instructions.
   for (std::vector<Region*>::const_iterator region_it = regions->begin();
       region_it != regions->end(); region_it++) {
@@ -151,6 +156,7 @@ void TypeInference::ComputeTypes(SeaGraph* graph) SHARED_LOCKS_REQUIRED(Locks::m
     std::vector<InstructionNode*>* instructions = (*region_it)->GetInstructions();
     std::copy(instructions->begin(), instructions->end(), std::back_inserter(worklist));
   }
+  queued.insert(worklist.begin(), worklist.end());
   TypeInferenceVisitor tiv(graph, &type_data_, type_cache_);
   // Record return type of the function.
   graph->Accept(&tiv);
@@ -161,25 +167,26 @@ void TypeInference::ComputeTypes(SeaGraph* graph) SHARED_LOCKS_REQUIRED(Locks::m
 
   // Sparse (SSA) fixed-point algorithm that processes each instruction in the work-list,
   // adding consumers of instructions whose result changed type back into the work-list.
-  // Note: According to [1] list iterators should not be invalidated on insertion,
-  //       which simplifies the implementation; not 100% sure other STL implementations
-  //       maintain this invariant, but they should.
-  //       [1] http://www.sgi.com/tech/stl/List.html
+  // A consumer that is already waiting in the work-list is not added again, it will see the new
+  // type when it is processed.
   // TODO: Making this conditional (as in sparse conditional constant propagation) would be good.
-  // TODO: Remove elements as I go.
-  for (std::list<InstructionNode*>::const_iterator instruction_it = worklist.begin();
-        instruction_it != worklist.end(); instruction_it++) {
-    (*instruction_it)->Accept(&tiv);
-    const Type* old_type = type_data_.FindTypeOf((*instruction_it)->Id());
+  while (!worklist.empty()) {
+    InstructionNode* instruction = worklist.front();
+    worklist.pop_front();
+    queued.erase(instruction);
+    instruction->Accept(&tiv);
+    const Type* old_type = type_data_.FindTypeOf(instruction->Id());
     const Type* new_type = tiv.GetType();
     bool type_changed = (old_type != new_type);
     if (type_changed) {
-      type_data_.SetTypeOf((*instruction_it)->Id(), new_type);
+      type_data_.SetTypeOf(instruction->Id(), new_type);
       // Add SSA consumers of the current instruction to the work-list.
-      std::vector<InstructionNode*>* consumers = (*instruction_it)->GetSSAConsumers();
+      std::vector<InstructionNode*>* consumers = instruction->GetSSAConsumers();
       for (std::vector<InstructionNode*>::iterator consumer = consumers->begin();
           consumer != consumers->end(); consumer++) {
-        worklist.push_back(*consumer);
+        if (queued.insert(*consumer).second) {
+          worklist.push_back(*consumer);
+        }
       }
     }
   }
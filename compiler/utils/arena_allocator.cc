@@ -25,14 +25,10 @@
 
 namespace art {
 
-// Memmap is a bit slower than malloc according to my measurements.
-static constexpr bool kUseMemMap = false;
-static constexpr bool kUseMemSet = true && kUseMemMap;
 static constexpr size_t kValgrindRedZoneBytes = 8;
 constexpr size_t Arena::kDefaultSize;
 
-template <bool kCount>
-const char* ArenaAllocatorStatsImpl<kCount>::kAllocNames[kNumArenaAllocKinds] = {
+const char* ArenaAllocatorStats::kAllocNames[kNumArenaAllocKinds] = {
   "Misc       ",
   "BasicBlock ",
   "LIR        ",
@@ -49,38 +45,32 @@ const char* ArenaAllocatorStatsImpl<kCount>::kAllocNames[kNumArenaAllocKinds] =
   "STL        ",
 };
 
-template <bool kCount>
-ArenaAllocatorStatsImpl<kCount>::ArenaAllocatorStatsImpl()
+ArenaAllocatorStats::ArenaAllocatorStats()
     : num_allocations_(0u) {
   std::fill_n(alloc_stats_, arraysize(alloc_stats_), 0u);
 }
 
-template <bool kCount>
-void ArenaAllocatorStatsImpl<kCount>::Copy(const ArenaAllocatorStatsImpl& other) {
+void ArenaAllocatorStats::Copy(const ArenaAllocatorStats& other) {
   num_allocations_ = other.num_allocations_;
   std::copy(other.alloc_stats_, other.alloc_stats_ + arraysize(alloc_stats_), alloc_stats_);
 }
 
-template <bool kCount>
-void ArenaAllocatorStatsImpl<kCount>::RecordAlloc(size_t bytes, ArenaAllocKind kind) {
+void ArenaAllocatorStats::RecordAlloc(size_t bytes, ArenaAllocKind kind) {
   alloc_stats_[kind] += bytes;
   ++num_allocations_;
 }
 
-template <bool kCount>
-size_t ArenaAllocatorStatsImpl<kCount>::NumAllocations() const {
+size_t ArenaAllocatorStats::NumAllocations() const {
   return num_allocations_;
 }
 
-template <bool kCount>
-size_t ArenaAllocatorStatsImpl<kCount>::BytesAllocated() const {
+size_t ArenaAllocatorStats::BytesAllocated() const {
   const size_t init = 0u;  // Initial value of the correct type.
   return std::accumulate(alloc_stats_, alloc_stats_ + arraysize(alloc_stats_), init);
 }
 
-template <bool kCount>
-void ArenaAllocatorStatsImpl<kCount>::Dump(std::ostream& os, const Arena* first,
-                                           ssize_t lost_bytes_adjustment) const {
+void ArenaAllocatorStats::Dump(std::ostream& os, const Arena* first,
+                               ssize_t lost_bytes_adjustment) const {
   size_t malloc_bytes = 0u;
   size_t lost_bytes = 0u;
   size_t num_arenas = 0u;
@@ -106,28 +96,83 @@ void ArenaAllocatorStatsImpl<kCount>::Dump(std::ostream& os, const Arena* first,
   }
 }
 
-// Explicitly instantiate the used implementation.
-template class ArenaAllocatorStatsImpl<kArenaAllocatorCountAllocations>;
+ArenaPoolStats::ArenaPoolStats()
+    : num_allocators_(0u),
+      num_arenas_(0u),
+      peak_bytes_in_arenas_(0u),
+      peak_bytes_allocated_(0u) {
+  std::fill_n(peak_alloc_stats_, arraysize(peak_alloc_stats_), 0u);
+  std::fill_n(total_alloc_stats_, arraysize(total_alloc_stats_), 0u);
+}
+
+void ArenaPoolStats::RecordAllocator(const ArenaAllocatorStats& stats) {
+  ++num_allocators_;
+  peak_bytes_allocated_ = std::max(peak_bytes_allocated_, stats.BytesAllocated());
+  for (int i = 0; i < kNumArenaAllocKinds; i++) {
+    peak_alloc_stats_[i] = std::max(peak_alloc_stats_[i], stats.alloc_stats_[i]);
+    total_alloc_stats_[i] += stats.alloc_stats_[i];
+  }
+}
+
+void ArenaPoolStats::Merge(const ArenaPoolStats& other) {
+  num_allocators_ += other.num_allocators_;
+  num_arenas_ += other.num_arenas_;
+  // The pools may not reach their peaks at the same time, this is an upper bound.
+  peak_bytes_in_arenas_ += other.peak_bytes_in_arenas_;
+  peak_bytes_allocated_ = std::max(peak_bytes_allocated_, other.peak_bytes_allocated_);
+  for (int i = 0; i < kNumArenaAllocKinds; i++) {
+    peak_alloc_stats_[i] = std::max(peak_alloc_stats_[i], other.peak_alloc_stats_[i]);
+    total_alloc_stats_[i] += other.total_alloc_stats_[i];
+  }
+}
+
+void ArenaPoolStats::Dump(std::ostream& os) const {
+  os << " ARENAS: created: " << num_arenas_ << ", peak memory in use: "
+     << PrettySize(peak_bytes_in_arenas_) << "\n";
+  os << "Number of allocators: " << num_allocators_ << ", peak used by an allocator: "
+     << peak_bytes_allocated_ << "\n";
+  os << "===== Peak and total allocation by kind\n";
+  for (int i = 0; i < kNumArenaAllocKinds; i++) {
+      os << ArenaAllocatorStats::kAllocNames[i] << std::setw(10) << peak_alloc_stats_[i]
+         << std::setw(14) << total_alloc_stats_[i] << "\n";
+  }
+}
+
+void ArenaPoolStats::DumpJson(std::ostream& os) const {
+  os << "{\"allocators\": " << num_allocators_
+     << ", \"arenas\": " << num_arenas_
+     << ", \"peak_bytes_in_arenas\": " << peak_bytes_in_arenas_
+     << ", \"peak_bytes_per_allocator\": " << peak_bytes_allocated_
+     << ", \"kinds\": {";
+  for (int i = 0; i < kNumArenaAllocKinds; i++) {
+    // The names are padded for Dump().
+    std::string name(ArenaAllocatorStats::kAllocNames[i]);
+    name.erase(name.find_last_not_of(' ') + 1);
+    os << (i == 0 ? "" : ", ") << "\"" << name << "\": {\"peak_bytes\": " << peak_alloc_stats_[i]
+       << ", \"total_bytes\": " << total_alloc_stats_[i] << "}";
+  }
+  os << "}}";
+}
 
-Arena::Arena(size_t size)
+Arena::Arena(size_t size, bool use_malloc)
     : bytes_allocated_(0),
       map_(nullptr),
       next_(nullptr) {
-  if (kUseMemMap) {
+  if (use_malloc) {
+    memory_ = reinterpret_cast<uint8_t*>(calloc(1, size));
+    size_ = size;
+  } else {
     std::string error_msg;
     map_ = MemMap::MapAnonymous("dalvik-arena", NULL, size, PROT_READ | PROT_WRITE, false,
                                 &error_msg);
     CHECK(map_ != nullptr) << error_msg;
     memory_ = map_->Begin();
     size_ = map_->Size();
-  } else {
-    memory_ = reinterpret_cast<uint8_t*>(calloc(1, size));
-    size_ = size;
   }
 }
 
 Arena::~Arena() {
-  if (kUseMemMap) {
+  if (map_ != nullptr) {
     delete map_;
   } else {
     free(reinterpret_cast<void*>(memory_));
@@ -136,18 +181,25 @@ Arena::~Arena() {
 
 void Arena::Reset() {
   if (bytes_allocated_) {
-    if (kUseMemSet || !kUseMemMap) {
-      memset(Begin(), 0, bytes_allocated_);
-    } else {
-      madvise(Begin(), bytes_allocated_, MADV_DONTNEED);
-    }
+    memset(Begin(), 0, bytes_allocated_);
     bytes_allocated_ = 0;
   }
 }
 
-ArenaPool::ArenaPool()
-    : lock_("Arena pool lock"),
-      free_arenas_(nullptr) {
+void Arena::Release() {
+  DCHECK(map_ != nullptr);
+  if (bytes_allocated_) {
+    madvise(Begin(), RoundUp(bytes_allocated_, kPageSize), MADV_DONTNEED);
+    bytes_allocated_ = 0;
+  }
+}
+
+ArenaPool::ArenaPool(bool use_malloc)
+    : use_malloc_(use_malloc),
+      count_allocations_(kArenaAllocatorCountAllocations),
+      lock_("Arena pool lock"),
+      free_arenas_(nullptr),
+      bytes_in_arenas_(0u) {
 }
 
 ArenaPool::~ArenaPool() {
@@ -166,15 +218,24 @@ Arena* ArenaPool::AllocArena(size_t size) {
     if (free_arenas_ != nullptr && LIKELY(free_arenas_->Size() >= size)) {
       ret = free_arenas_;
       free_arenas_ = free_arenas_->next_;
+      RecordArenaInUse(ret);
     }
   }
   if (ret == nullptr) {
-    ret = new Arena(size);
+    ret = new Arena(size, use_malloc_);
+    MutexLock lock(self, lock_);
+    ++stats_.num_arenas_;
+    RecordArenaInUse(ret);
   }
   ret->Reset();
   return ret;
 }
 
+void ArenaPool::RecordArenaInUse(Arena* arena) {
+  bytes_in_arenas_ += arena->Size();
+  stats_.peak_bytes_in_arenas_ = std::max(stats_.peak_bytes_in_arenas_, bytes_in_arenas_);
+}
+
 void ArenaPool::FreeArenaChain(Arena* first) {
   if (UNLIKELY(RUNNING_ON_VALGRIND > 0)) {
     for (Arena* arena = first; arena != nullptr; arena = arena->next_) {
@@ -182,17 +243,49 @@ void ArenaPool::FreeArenaChain(Arena* first) {
     }
   }
   if (first != nullptr) {
+    size_t bytes_in_chain = first->Size();
     Arena* last = first;
     while (last->next_ != nullptr) {
       last = last->next_;
+      bytes_in_chain += last->Size();
     }
     Thread* self = Thread::Current();
     MutexLock lock(self, lock_);
     last->next_ = free_arenas_;
     free_arenas_ = first;
+    DCHECK_GE(bytes_in_arenas_, bytes_in_chain);
+    bytes_in_arenas_ -= bytes_in_chain;
+  }
+}
+
+void ArenaPool::ReclaimMemory() {
+  Thread* self = Thread::Current();
+  MutexLock lock(self, lock_);
+  if (use_malloc_) {
+    while (free_arenas_ != nullptr) {
+      Arena* arena = free_arenas_;
+      free_arenas_ = free_arenas_->next_;
+      delete arena;
+    }
+  } else {
+    for (Arena* arena = free_arenas_; arena != nullptr; arena = arena->next_) {
+      arena->Release();
+    }
   }
 }
 
+void ArenaPool::RecordAllocatorStats(const ArenaAllocatorStats& stats) {
+  Thread* self = Thread::Current();
+  MutexLock lock(self, lock_);
+  stats_.RecordAllocator(stats);
+}
+
+ArenaPoolStats ArenaPool::GetStats() {
+  Thread* self = Thread::Current();
+  MutexLock lock(self, lock_);
+  return stats_;
+}
+
 size_t ArenaAllocator::BytesAllocated() const {
   return ArenaAllocatorStats::BytesAllocated();
 }
@@ -203,7 +296,9 @@ ArenaAllocator::ArenaAllocator(ArenaPool* pool)
     end_(nullptr),
     ptr_(nullptr),
     arena_head_(nullptr),
-    running_on_valgrind_(RUNNING_ON_VALGRIND > 0) {
+    bytes_in_arenas_(0u),
+    running_on_valgrind_(RUNNING_ON_VALGRIND > 0),
+    count_allocations_(pool->CountAllocations()) {
 }
 
 void ArenaAllocator::UpdateBytesAllocated() {
@@ -223,7 +318,9 @@ void* ArenaAllocator::AllocValgrind(size_t bytes, ArenaAllocKind kind) {
       return nullptr;
     }
   }
-  ArenaAllocatorStats::RecordAlloc(rounded_bytes, kind);
+  if (UNLIKELY(count_allocations_)) {
+    ArenaAllocatorStats::RecordAlloc(rounded_bytes, kind);
+  }
   uint8_t* ret = ptr_;
   ptr_ += rounded_bytes;
   // Check that the memory is already zeroed out.
@@ -237,6 +334,9 @@ void* ArenaAllocator::AllocValgrind(size_t bytes, ArenaAllocKind kind) {
 ArenaAllocator::~ArenaAllocator() {
   // Reclaim all the arenas by giving them back to the thread pool.
   UpdateBytesAllocated();
+  if (count_allocations_) {
+    pool_->RecordAllocatorStats(*this);
+  }
   pool_->FreeArenaChain(arena_head_);
 }
 
@@ -245,6 +345,7 @@ void ArenaAllocator::ObtainNewArenaForAllocation(size_t allocation_size) {
   Arena* new_arena = pool_->AllocArena(std::max(Arena::kDefaultSize, allocation_size));
   new_arena->next_ = arena_head_;
   arena_head_ = new_arena;
+  bytes_in_arenas_ += new_arena->Size();
   // Update our internal data structures.
   ptr_ = begin_ = new_arena->Begin();
   end_ = new_arena->End();
@@ -34,6 +34,8 @@ class ArenaStack;
 class ScopedArenaAllocator;
 class MemStats;
 
+// Whether allocations are counted by default. Counting can also be enabled at
+// runtime for the allocators of a pool, see ArenaPool::SetCountAllocations().
 static constexpr bool kArenaAllocatorCountAllocations = false;
 
 // Type of allocation for memory tuning.
@@ -55,33 +57,13 @@ enum ArenaAllocKind {
   kNumArenaAllocKinds
 };
 
-template <bool kCount>
-class ArenaAllocatorStatsImpl;
-
-template <>
-class ArenaAllocatorStatsImpl<false> {
+class ArenaAllocatorStats {
  public:
-  ArenaAllocatorStatsImpl() = default;
-  ArenaAllocatorStatsImpl(const ArenaAllocatorStatsImpl& other) = default;
-  ArenaAllocatorStatsImpl& operator = (const ArenaAllocatorStatsImpl& other) = delete;
-
-  void Copy(const ArenaAllocatorStatsImpl& other) { UNUSED(other); }
-  void RecordAlloc(size_t bytes, ArenaAllocKind kind) { UNUSED(bytes); UNUSED(kind); }
-  size_t NumAllocations() const { return 0u; }
-  size_t BytesAllocated() const { return 0u; }
-  void Dump(std::ostream& os, const Arena* first, ssize_t lost_bytes_adjustment) const {
-    UNUSED(os); UNUSED(first); UNUSED(lost_bytes_adjustment);
-  }
-};
+  ArenaAllocatorStats();
+  ArenaAllocatorStats(const ArenaAllocatorStats& other) = default;
+  ArenaAllocatorStats& operator = (const ArenaAllocatorStats& other) = delete;
 
-template <bool kCount>
-class ArenaAllocatorStatsImpl {
- public:
-  ArenaAllocatorStatsImpl();
-  ArenaAllocatorStatsImpl(const ArenaAllocatorStatsImpl& other) = default;
-  ArenaAllocatorStatsImpl& operator = (const ArenaAllocatorStatsImpl& other) = delete;
-
-  void Copy(const ArenaAllocatorStatsImpl& other);
+  void Copy(const ArenaAllocatorStats& other);
   void RecordAlloc(size_t bytes, ArenaAllocKind kind);
   size_t NumAllocations() const;
   size_t BytesAllocated() const;
@@ -93,16 +75,50 @@ class ArenaAllocatorStatsImpl {
   size_t alloc_stats_[kNumArenaAllocKinds];  // Bytes used by various allocation kinds.
 
   static const char* kAllocNames[kNumArenaAllocKinds];
+
+  friend class ArenaPoolStats;
 };
 
-typedef ArenaAllocatorStatsImpl<kArenaAllocatorCountAllocations> ArenaAllocatorStats;
+// Memory usage of the allocators of one or more pools. The usage by allocation kind
+// is only known for the allocators counting their allocations.
+class ArenaPoolStats {
+ public:
+  ArenaPoolStats();
+
+  // Records the usage of an allocator giving its arenas back to the pool.
+  void RecordAllocator(const ArenaAllocatorStats& stats);
+  void Merge(const ArenaPoolStats& other);
+  void Dump(std::ostream& os) const;
+  // Writes the stats as a JSON object, with the peak and total bytes of every kind.
+  void DumpJson(std::ostream& os) const;
+
+  size_t NumAllocators() const { return num_allocators_; }
+  size_t NumArenas() const { return num_arenas_; }
+  size_t PeakBytesInArenas() const { return peak_bytes_in_arenas_; }
+  size_t PeakBytesAllocated() const { return peak_bytes_allocated_; }
+  size_t PeakBytesAllocated(ArenaAllocKind kind) const { return peak_alloc_stats_[kind]; }
+  size_t TotalBytesAllocated(ArenaAllocKind kind) const { return total_alloc_stats_[kind]; }
+
+ private:
+  size_t num_allocators_;
+  size_t num_arenas_;  // Arenas created by the pools.
+  size_t peak_bytes_in_arenas_;  // Memory of the arenas used at the same time.
+  size_t peak_bytes_allocated_;  // Largest usage of a single allocator.
+  size_t peak_alloc_stats_[kNumArenaAllocKinds];  // Largest usage of a single allocator by kind.
+  size_t total_alloc_stats_[kNumArenaAllocKinds];  // Usage of all the allocators by kind.
+
+  friend class ArenaPool;
+};
 
 class Arena {
  public:
   static constexpr size_t kDefaultSize = 128 * KB;
-  explicit Arena(size_t size = kDefaultSize);
+  Arena(size_t size, bool use_malloc);
   ~Arena();
   void Reset();
+  // Gives the pages of a mapped arena back to the system. They read as zero
+  // when they are used again.
+  void Release();
   uint8_t* Begin() {
     return memory_;
   }
@@ -129,20 +145,46 @@ class Arena {
   friend class ArenaAllocator;
   friend class ArenaStack;
   friend class ScopedArenaAllocator;
-  template <bool kCount> friend class ArenaAllocatorStatsImpl;
+  friend class ArenaAllocatorStats;
   DISALLOW_COPY_AND_ASSIGN(Arena);
 };
 
 class ArenaPool {
  public:
-  ArenaPool();
+  // Arenas are allocated with malloc or mapped. Mapped arenas are a bit slower
+  // to create, but their memory can be given back to the system while they are
+  // kept in the pool.
+  explicit ArenaPool(bool use_malloc = true);
   ~ArenaPool();
-  Arena* AllocArena(size_t size);
-  void FreeArenaChain(Arena* first);
+  Arena* AllocArena(size_t size) LOCKS_EXCLUDED(lock_);
+  void FreeArenaChain(Arena* first) LOCKS_EXCLUDED(lock_);
+
+  // Gives the memory of the free arenas back to the system: mapped arenas are
+  // released and stay in the pool, malloc-ed arenas are freed.
+  void ReclaimMemory() LOCKS_EXCLUDED(lock_);
+
+  // Whether the allocators created from now on count their allocations, and
+  // record them in the pool statistics when they are done.
+  void SetCountAllocations(bool count_allocations) {
+    count_allocations_ = count_allocations;
+  }
+
+  bool CountAllocations() const {
+    return count_allocations_;
+  }
+
+  void RecordAllocatorStats(const ArenaAllocatorStats& stats) LOCKS_EXCLUDED(lock_);
+  ArenaPoolStats GetStats() LOCKS_EXCLUDED(lock_);
 
  private:
+  void RecordArenaInUse(Arena* arena) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  const bool use_malloc_;
+  bool count_allocations_;
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   Arena* free_arenas_ GUARDED_BY(lock_);
+  size_t bytes_in_arenas_ GUARDED_BY(lock_);  // Memory of the arenas in use.
+  ArenaPoolStats stats_ GUARDED_BY(lock_);
   DISALLOW_COPY_AND_ASSIGN(ArenaPool);
 };
 
@@ -164,7 +206,9 @@ class ArenaAllocator : private ArenaAllocatorStats {
         return nullptr;
       }
     }
-    ArenaAllocatorStats::RecordAlloc(bytes, kind);
+    if (UNLIKELY(count_allocations_)) {
+      ArenaAllocatorStats::RecordAlloc(bytes, kind);
+    }
     uint8_t* ret = ptr_;
     ptr_ += bytes;
     return ret;
@@ -177,6 +221,13 @@ class ArenaAllocator : private ArenaAllocatorStats {
   void* AllocValgrind(size_t bytes, ArenaAllocKind kind);
   void ObtainNewArenaForAllocation(size_t allocation_size);
   size_t BytesAllocated() const;
+
+  // Memory of the arenas taken from the pool, which is known even when the allocations are not
+  // counted.
+  size_t BytesInArenas() const {
+    return bytes_in_arenas_;
+  }
+
   MemStats GetMemStats() const;
 
  private:
@@ -187,7 +238,9 @@ class ArenaAllocator : private ArenaAllocatorStats {
   uint8_t* end_;
   uint8_t* ptr_;
   Arena* arena_head_;
+  size_t bytes_in_arenas_;
   bool running_on_valgrind_;
+  const bool count_allocations_;
 
   DISALLOW_COPY_AND_ASSIGN(ArenaAllocator);
 };  // ArenaAllocator
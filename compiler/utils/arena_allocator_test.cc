@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <sstream>
+
 #include "gtest/gtest.h"
 #include "utils/arena_allocator.h"
 #include "utils/arena_bit_vector.h"
@@ -30,4 +32,88 @@ TEST(ArenaAllocator, Test) {
   EXPECT_EQ(2U, bv.GetStorageSize());
 }
 
+TEST(ArenaAllocator, ReuseArenas) {
+  ArenaPool pool;
+  uint8_t* first_memory;
+  {
+    ArenaAllocator arena(&pool);
+    first_memory = reinterpret_cast<uint8_t*>(arena.Alloc(64, kArenaAllocMisc));
+    memset(first_memory, 0xff, 64);
+  }
+  // The arena comes back from the pool, zeroed.
+  ArenaAllocator arena(&pool);
+  uint8_t* memory = reinterpret_cast<uint8_t*>(arena.Alloc(64, kArenaAllocMisc));
+  EXPECT_EQ(first_memory, memory);
+  for (size_t i = 0; i < 64; ++i) {
+    EXPECT_EQ(0U, memory[i]);
+  }
+  EXPECT_EQ(1U, pool.GetStats().NumArenas());
+}
+
+TEST(ArenaAllocator, ReclaimMemory) {
+  for (bool use_malloc : { true, false }) {
+    ArenaPool pool(use_malloc);
+    {
+      ArenaAllocator arena(&pool);
+      uint8_t* memory = reinterpret_cast<uint8_t*>(arena.Alloc(4 * KB, kArenaAllocMisc));
+      memset(memory, 0xff, 4 * KB);
+    }
+    pool.ReclaimMemory();
+    ArenaAllocator arena(&pool);
+    uint8_t* memory = reinterpret_cast<uint8_t*>(arena.Alloc(4 * KB, kArenaAllocMisc));
+    for (size_t i = 0; i < 4 * KB; ++i) {
+      ASSERT_EQ(0U, memory[i]);
+    }
+    // Malloc-ed arenas are freed, mapped ones are kept.
+    EXPECT_EQ(use_malloc ? 2U : 1U, pool.GetStats().NumArenas());
+  }
+}
+
+TEST(ArenaAllocator, CountAllocations) {
+  ArenaPool pool;
+  pool.SetCountAllocations(true);
+  {
+    ArenaAllocator arena(&pool);
+    arena.Alloc(16, kArenaAllocMisc);
+    arena.Alloc(Arena::kDefaultSize, kArenaAllocLIR);
+    EXPECT_EQ(16U + Arena::kDefaultSize, arena.BytesAllocated());
+  }
+  {
+    ArenaAllocator arena(&pool);
+    arena.Alloc(32, kArenaAllocMisc);
+  }
+  ArenaPoolStats stats = pool.GetStats();
+  EXPECT_EQ(2U, stats.NumAllocators());
+  EXPECT_EQ(2U, stats.NumArenas());
+  EXPECT_EQ(16U + Arena::kDefaultSize, stats.PeakBytesAllocated());
+  EXPECT_EQ(32U, stats.PeakBytesAllocated(kArenaAllocMisc));
+  EXPECT_EQ(Arena::kDefaultSize, stats.PeakBytesAllocated(kArenaAllocLIR));
+  EXPECT_EQ(48U, stats.TotalBytesAllocated(kArenaAllocMisc));
+  EXPECT_EQ(Arena::kDefaultSize, stats.TotalBytesAllocated(kArenaAllocLIR));
+  EXPECT_EQ(2 * Arena::kDefaultSize, stats.PeakBytesInArenas());
+  std::ostringstream os;
+  stats.DumpJson(os);
+  EXPECT_NE(std::string::npos,
+            os.str().find("\"Misc\": {\"peak_bytes\": 32, \"total_bytes\": 48}")) << os.str();
+
+  // Allocators created without counting don't record anything.
+  pool.SetCountAllocations(false);
+  {
+    ArenaAllocator arena(&pool);
+    arena.Alloc(16, kArenaAllocMisc);
+    EXPECT_EQ(0U, arena.BytesAllocated());
+  }
+  EXPECT_EQ(2U, pool.GetStats().NumAllocators());
+}
+
+TEST(ArenaAllocator, BytesInArenas) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  EXPECT_EQ(0U, arena.BytesInArenas());
+  arena.Alloc(16, kArenaAllocMisc);
+  EXPECT_EQ(Arena::kDefaultSize, arena.BytesInArenas());
+  arena.Alloc(2 * Arena::kDefaultSize, kArenaAllocMisc);
+  EXPECT_EQ(3 * Arena::kDefaultSize, arena.BytesInArenas());
+}
+
 }  // namespace art
@@ -297,6 +297,10 @@ void Arm64Assembler::LoadRef(ManagedRegister m_dst, ManagedRegister m_base,
   CHECK(dst.IsCoreRegister() && base.IsCoreRegister());
   LoadWFromOffset(kLoadWord, dst.AsOverlappingCoreRegisterLow(), base.AsCoreRegister(),
                   offs.Int32Value());
+  if (k64BitHeapReferenceShift != 0) {
+    // The W load zero extends the reference, which is decoded to the address.
+    ___ Lsl(reg_x(dst.AsCoreRegister()), reg_x(dst.AsCoreRegister()), k64BitHeapReferenceShift);
+  }
 }
 
 void Arm64Assembler::LoadRawPtr(ManagedRegister m_dst, ManagedRegister m_base, Offset offs) {
@@ -16,6 +16,8 @@
 
 #include "assembler.h"
 
+#include <stdlib.h>
+
 #include <algorithm>
 #include <vector>
 
@@ -30,8 +32,12 @@
 
 namespace art {
 
+// The contents are malloc'ed so that growing them can use realloc, which extends large
+// buffers in place or remaps their pages instead of copying the code emitted so far.
 static byte* NewContents(size_t capacity) {
-  return new byte[capacity];
+  byte* contents = reinterpret_cast<byte*>(malloc(capacity));
+  CHECK(contents != nullptr) << "Failed to allocate " << capacity << " bytes of assembler buffer";
+  return contents;
 }
 
 
@@ -54,7 +60,7 @@ AssemblerBuffer::AssemblerBuffer() {
 
 
 AssemblerBuffer::~AssemblerBuffer() {
-  delete[] contents_;
+  free(contents_);
 }
 
 
@@ -84,18 +90,13 @@ void AssemblerBuffer::ExtendCapacity() {
   size_t old_capacity = Capacity();
   size_t new_capacity = std::min(old_capacity * 2, old_capacity + 1 * MB);
 
-  // Allocate the new data area and copy contents of the old one to it.
-  byte* new_contents = NewContents(new_capacity);
-  memmove(reinterpret_cast<void*>(new_contents),
-          reinterpret_cast<void*>(contents_),
-          old_size);
+  // Grow the data area, the old one is released rather than leaked.
+  byte* new_contents = reinterpret_cast<byte*>(realloc(contents_, new_capacity));
+  CHECK(new_contents != nullptr) << "Failed to grow assembler buffer to " << new_capacity;
 
-  // Compute the relocation delta and switch to the new contents area.
-  ptrdiff_t delta = new_contents - contents_;
+  // Switch to the new contents area, update the cursor and recompute the limit.
   contents_ = new_contents;
-
-  // Update the cursor and recompute the limit.
-  cursor_ += delta;
+  cursor_ = new_contents + old_size;
   limit_ = ComputeLimit(new_contents, new_capacity);
 
   // Verify internal state.
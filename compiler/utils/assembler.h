@@ -184,12 +184,12 @@ class AssemblerBuffer {
   }
 
   template<typename T> T Load(size_t position) {
-    CHECK_LE(position, Size() - static_cast<int>(sizeof(T)));
+    DCHECK_LE(position, Size() - static_cast<int>(sizeof(T)));
     return *reinterpret_cast<T*>(contents_ + position);
   }
 
   template<typename T> void Store(size_t position, T value) {
-    CHECK_LE(position, Size() - static_cast<int>(sizeof(T)));
+    DCHECK_LE(position, Size() - static_cast<int>(sizeof(T)));
     *reinterpret_cast<T*>(contents_ + position) = value;
   }
 
@@ -232,7 +232,7 @@ class AssemblerBuffer {
 
   // Get the size of the emitted code.
   size_t Size() const {
-    CHECK_GE(cursor_, contents_);
+    DCHECK_GE(cursor_, contents_);
     return cursor_ - contents_;
   }
 
@@ -330,7 +330,7 @@ class AssemblerBuffer {
   byte* cursor() const { return cursor_; }
   byte* limit() const { return limit_; }
   size_t Capacity() const {
-    CHECK_GE(limit_, contents_);
+    DCHECK_GE(limit_, contents_);
     return (limit_ - contents_) + kMinimumGap;
   }
 
@@ -17,11 +17,10 @@
 #ifndef ART_COMPILER_UTILS_DEDUPE_SET_H_
 #define ART_COMPILER_UTILS_DEDUPE_SET_H_
 
-#include <set>
+#include <memory>
 #include <string>
 
 #include "base/mutex.h"
-#include "base/stl_util.h"
 #include "base/stringprintf.h"
 
 namespace art {
@@ -29,19 +28,26 @@ namespace art {
 // A set of Keys that support a HashFunc returning HashType. Used to find duplicates of Key in the
 // Add method. The data-structure is thread-safe through the use of internal locks, it also
 // supports the lock being sharded.
+//
+// Each shard is an open addressing hash table with linear probing. The hash of a key is kept
+// with it, so that probing only compares keys with the same hash and growing the table doesn't
+// hash the keys again.
 template <typename Key, typename HashType, typename HashFunc, HashType kShard = 1>
 class DedupeSet {
-  typedef std::pair<HashType, Key*> HashedKey;
-
-  class Comparator {
-   public:
-    bool operator()(const HashedKey& a, const HashedKey& b) const {
-      if (a.first != b.first) {
-        return a.first < b.first;
-      } else {
-        return *a.second < *b.second;
-      }
-    }
+  struct Slot {
+    HashType hash;
+    Key* key;  // nullptr for an empty slot.
+  };
+
+  struct Shard {
+    Shard() : capacity(0u), size(0u), num_adds(0u) { }
+
+    std::string lock_name;
+    std::unique_ptr<Mutex> lock;
+    std::unique_ptr<Slot[]> slots;
+    size_t capacity;  // A power of two.
+    size_t size;
+    size_t num_adds;
   };
 
  public:
@@ -49,36 +55,116 @@ class DedupeSet {
     HashType raw_hash = HashFunc()(key);
     HashType shard_hash = raw_hash / kShard;
     HashType shard_bin = raw_hash % kShard;
-    HashedKey hashed_key(shard_hash, const_cast<Key*>(&key));
-    MutexLock lock(self, *lock_[shard_bin]);
-    auto it = keys_[shard_bin].find(hashed_key);
-    if (it != keys_[shard_bin].end()) {
-      return it->second;
+    Shard& shard = shards_[shard_bin];
+    MutexLock lock(self, *shard.lock);
+    ++shard.num_adds;
+    if (shard.size >= shard.capacity - shard.capacity / kMaxLoadFactorInverse) {
+      Grow(&shard);
+    }
+    Slot* slot = FindSlot(shard, shard_hash, key);
+    if (slot->key == nullptr) {
+      slot->hash = shard_hash;
+      slot->key = new Key(key);
+      ++shard.size;
     }
-    hashed_key.second = new Key(key);
-    keys_[shard_bin].insert(hashed_key);
-    return hashed_key.second;
+    return slot->key;
   }
 
-  explicit DedupeSet(const char* set_name) {
+  explicit DedupeSet(const char* set_name) : set_name_(set_name) {
     for (HashType i = 0; i < kShard; ++i) {
       std::ostringstream oss;
       oss << set_name << " lock " << i;
-      lock_name_[i] = oss.str();
-      lock_[i].reset(new Mutex(lock_name_[i].c_str()));
+      shards_[i].lock_name = oss.str();
+      shards_[i].lock.reset(new Mutex(shards_[i].lock_name.c_str()));
     }
   }
 
   ~DedupeSet() {
     for (HashType i = 0; i < kShard; ++i) {
-      STLDeleteValues(&keys_[i]);
+      for (size_t j = 0; j < shards_[i].capacity; ++j) {
+        delete shards_[i].slots[j].key;
+      }
+    }
+  }
+
+  // Deletes all the keys, the pointers returned by Add are no longer valid.
+  void Clear(Thread* self) {
+    for (HashType i = 0; i < kShard; ++i) {
+      Shard& shard = shards_[i];
+      MutexLock lock(self, *shard.lock);
+      for (size_t j = 0; j < shard.capacity; ++j) {
+        delete shard.slots[j].key;
+      }
+      shard.slots.reset();
+      shard.capacity = 0u;
+      shard.size = 0u;
+      shard.num_adds = 0u;
+    }
+  }
+
+  // Number of distinct keys in the set.
+  size_t Size(Thread* self) const {
+    size_t size = 0u;
+    for (HashType i = 0; i < kShard; ++i) {
+      MutexLock lock(self, *shards_[i].lock);
+      size += shards_[i].size;
     }
+    return size;
+  }
+
+  // Number of keys added to the set, including the duplicates.
+  size_t NumAdds(Thread* self) const {
+    size_t num_adds = 0u;
+    for (HashType i = 0; i < kShard; ++i) {
+      MutexLock lock(self, *shards_[i].lock);
+      num_adds += shards_[i].num_adds;
+    }
+    return num_adds;
+  }
+
+  std::string DumpStats(Thread* self) const {
+    size_t num_adds = NumAdds(self);
+    size_t num_hits = num_adds - Size(self);
+    return StringPrintf("%s: %zu adds, %zu deduplicated (%zu%%)", set_name_.c_str(), num_adds,
+                        num_hits, (num_adds == 0u) ? 0u : num_hits * 100u / num_adds);
   }
 
  private:
-  std::string lock_name_[kShard];
-  std::unique_ptr<Mutex> lock_[kShard];
-  std::set<HashedKey, Comparator> keys_[kShard];
+  // Tables grow when they are more than 3/4 full.
+  static constexpr size_t kMaxLoadFactorInverse = 4u;
+  static constexpr size_t kMinCapacity = 16u;
+
+  // Returns the slot of `key`, or the empty slot where to insert it.
+  static Slot* FindSlot(const Shard& shard, HashType hash, const Key& key) {
+    size_t mask = shard.capacity - 1u;
+    for (size_t index = hash & mask; ; index = (index + 1u) & mask) {
+      Slot* slot = &shard.slots[index];
+      if (slot->key == nullptr || (slot->hash == hash && *slot->key == key)) {
+        return slot;
+      }
+    }
+  }
+
+  static void Grow(Shard* shard) {
+    size_t old_capacity = shard->capacity;
+    std::unique_ptr<Slot[]> old_slots(shard->slots.release());
+    shard->capacity = (old_capacity == 0u) ? kMinCapacity : old_capacity * 2u;
+    shard->slots.reset(new Slot[shard->capacity]());
+    size_t mask = shard->capacity - 1u;
+    for (size_t i = 0; i < old_capacity; ++i) {
+      const Slot& old_slot = old_slots[i];
+      if (old_slot.key != nullptr) {
+        size_t index = old_slot.hash & mask;
+        while (shard->slots[index].key != nullptr) {
+          index = (index + 1u) & mask;
+        }
+        shard->slots[index] = old_slot;
+      }
+    }
+  }
+
+  const std::string set_name_;
+  Shard shards_[kShard];
 
   DISALLOW_COPY_AND_ASSIGN(DedupeSet);
 };
@@ -70,6 +70,77 @@ TEST(DedupeSetTest, Test) {
     ASSERT_NE(array3, &test1);
     ASSERT_EQ(test1, *array3);
   }
+  EXPECT_EQ(2U, deduplicator.Size(self));
+  EXPECT_EQ(3U, deduplicator.NumAdds(self));
+}
+
+class ConstantHashFunc {
+ public:
+  size_t operator()(const std::vector<uint8_t>& array) const {
+    UNUSED(array);
+    return 42;
+  }
+};
+
+TEST(DedupeSetTest, Grow) {
+  Thread* self = Thread::Current();
+  typedef std::vector<uint8_t> ByteArray;
+  DedupeSet<ByteArray, size_t, DedupeHashFunc, 4> deduplicator("test");
+  // Enough arrays for the tables of the shards to grow a few times.
+  static constexpr size_t kNumArrays = 1000;
+  std::vector<ByteArray*> added;
+  for (size_t i = 0; i < kNumArrays; ++i) {
+    ByteArray array;
+    array.push_back(i & 0xff);
+    array.push_back(i >> 8);
+    added.push_back(deduplicator.Add(self, array));
+    ASSERT_EQ(array, *added.back());
+  }
+  for (size_t i = 0; i < kNumArrays; ++i) {
+    ByteArray array;
+    array.push_back(i & 0xff);
+    array.push_back(i >> 8);
+    ASSERT_EQ(added[i], deduplicator.Add(self, array));
+  }
+  EXPECT_EQ(kNumArrays, deduplicator.Size(self));
+  EXPECT_EQ(2 * kNumArrays, deduplicator.NumAdds(self));
+  EXPECT_EQ("test: 2000 adds, 1000 deduplicated (50%)", deduplicator.DumpStats(self));
+}
+
+TEST(DedupeSetTest, HashCollisions) {
+  Thread* self = Thread::Current();
+  typedef std::vector<uint8_t> ByteArray;
+  DedupeSet<ByteArray, size_t, ConstantHashFunc> deduplicator("test");
+  std::vector<ByteArray*> added;
+  for (size_t i = 0; i < 100; ++i) {
+    ByteArray array(i, 1);
+    added.push_back(deduplicator.Add(self, array));
+  }
+  for (size_t i = 0; i < 100; ++i) {
+    ByteArray array(i, 1);
+    ASSERT_EQ(added[i], deduplicator.Add(self, array));
+    ASSERT_EQ(i, added[i]->size());
+  }
+  EXPECT_EQ(100U, deduplicator.Size(self));
+}
+
+TEST(DedupeSetTest, Clear) {
+  Thread* self = Thread::Current();
+  typedef std::vector<uint8_t> ByteArray;
+  DedupeSet<ByteArray, size_t, DedupeHashFunc, 4> deduplicator("test");
+  for (size_t i = 0; i < 100; ++i) {
+    ByteArray array(i, 1);
+    deduplicator.Add(self, array);
+  }
+  deduplicator.Clear(self);
+  EXPECT_EQ(0U, deduplicator.Size(self));
+  EXPECT_EQ(0U, deduplicator.NumAdds(self));
+  // The set is usable again.
+  ByteArray array(3, 2);
+  ByteArray* added = deduplicator.Add(self, array);
+  EXPECT_EQ(array, *added);
+  EXPECT_EQ(added, deduplicator.Add(self, array));
+  EXPECT_EQ(1U, deduplicator.Size(self));
 }
 
 }  // namespace art
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dwarf_cfi.h"
+
+#include "base/logging.h"
+#include "leb128.h"
+
+namespace art {
+
+void PushWord(std::vector<uint8_t>* buf, int32_t data) {
+  buf->push_back(data & 0xff);
+  buf->push_back((data >> 8) & 0xff);
+  buf->push_back((data >> 16) & 0xff);
+  buf->push_back((data >> 24) & 0xff);
+}
+
+static void PushUnsignedLeb128(std::vector<uint8_t>* buf, uint32_t value) {
+  uint8_t buffer[5];
+  uint8_t* end = EncodeUnsignedLeb128(buffer, value);
+  buf->insert(buf->end(), buffer, end);
+}
+
+void DW_CFA_advance_loc(std::vector<uint8_t>* buf, uint32_t increment) {
+  if (increment < 64) {
+    // Encoding in opcode.
+    buf->push_back(0x1 << 6 | increment);
+  } else if (increment < 256) {
+    // Single byte delta.
+    buf->push_back(0x02);
+    buf->push_back(increment);
+  } else if (increment < 256 * 256) {
+    // Two byte delta.
+    buf->push_back(0x03);
+    buf->push_back(increment & 0xff);
+    buf->push_back((increment >> 8) & 0xff);
+  } else {
+    // Four byte delta.
+    buf->push_back(0x04);
+    PushWord(buf, increment);
+  }
+}
+
+void DW_CFA_offset(std::vector<uint8_t>* buf, int reg, uint32_t offset) {
+  DCHECK_GE(reg, 0);
+  if (reg < 64) {
+    // Register in opcode.
+    buf->push_back(0x2 << 6 | reg);
+  } else {
+    // DW_CFA_offset_extended.
+    buf->push_back(0x05);
+    PushUnsignedLeb128(buf, reg);
+  }
+  PushUnsignedLeb128(buf, offset);
+}
+
+void DW_CFA_def_cfa_offset(std::vector<uint8_t>* buf, int32_t offset) {
+  DCHECK_GE(offset, 0);
+  buf->push_back(0x0e);
+  PushUnsignedLeb128(buf, offset);
+}
+
+void DW_CFA_remember_state(std::vector<uint8_t>* buf) {
+  buf->push_back(0x0a);
+}
+
+void DW_CFA_restore_state(std::vector<uint8_t>* buf) {
+  buf->push_back(0x0b);
+}
+
+void WriteFDEHeader(std::vector<uint8_t>* buf, uint32_t code_size) {
+  // Length (filled in by WriteCFILength).
+  PushWord(buf, 0);
+
+  // CIE_pointer (can be filled in by linker); might be left at 0 if there is only
+  // one CIE for the whole debug_frame section.
+  PushWord(buf, 0);
+
+  // 'initial_location' (filled in by linker).
+  PushWord(buf, 0);
+
+  // 'address_range' (number of bytes in the method).
+  PushWord(buf, code_size);
+}
+
+void WriteCFILength(std::vector<uint8_t>* buf) {
+  // Padding to a multiple of 4, DW_CFA_nop is encoded as 0.
+  while ((buf->size() & 3) != 0) {
+    buf->push_back(0);
+  }
+  // The length doesn't include the length field.
+  uint32_t length = buf->size() - 4;
+  DCHECK_GE(buf->size(), 4U);
+  (*buf)[0] = length;
+  (*buf)[1] = length >> 8;
+  (*buf)[2] = length >> 16;
+  (*buf)[3] = length >> 24;
+}
+
+}  // namespace art
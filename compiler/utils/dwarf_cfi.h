@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_COMPILER_UTILS_DWARF_CFI_H_
+#define ART_COMPILER_UTILS_DWARF_CFI_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace art {
+
+// Helpers writing the call frame information of the .debug_frame section, DWARF 3 section 6.4.
+
+/*
+ * @brief Enter a 32 bit quantity into a buffer, little endian.
+ * @param buf buffer.
+ * @param data Data value.
+ */
+void PushWord(std::vector<uint8_t>* buf, int32_t data);
+
+/*
+ * @brief Enter a 'DW_CFA_advance_loc' into an FDE buffer
+ * @param buf FDE buffer.
+ * @param increment Amount by which to increase the current location, in code alignment units.
+ */
+void DW_CFA_advance_loc(std::vector<uint8_t>* buf, uint32_t increment);
+
+/*
+ * @brief Enter a 'DW_CFA_offset' into an FDE buffer, extended for registers above 63.
+ * @param buf FDE buffer.
+ * @param reg DWARF register number.
+ * @param offset Offset of the saved register from the CFA, in data alignment units.
+ */
+void DW_CFA_offset(std::vector<uint8_t>* buf, int reg, uint32_t offset);
+
+/*
+ * @brief Enter a 'DW_CFA_def_cfa_offset' into an FDE buffer
+ * @param buf FDE buffer.
+ * @param offset New offset of the CFA from its register, in bytes.
+ */
+void DW_CFA_def_cfa_offset(std::vector<uint8_t>* buf, int32_t offset);
+
+/*
+ * @brief Enter a 'DW_CFA_remember_state' into an FDE buffer
+ * @param buf FDE buffer.
+ */
+void DW_CFA_remember_state(std::vector<uint8_t>* buf);
+
+/*
+ * @brief Enter a 'DW_CFA_restore_state' into an FDE buffer
+ * @param buf FDE buffer.
+ */
+void DW_CFA_restore_state(std::vector<uint8_t>* buf);
+
+/*
+ * @brief Write the header of an FDE: the length, the CIE pointer and the initial location,
+ * which are filled in later, and the address range.
+ * @param buf FDE buffer.
+ * @param code_size Number of bytes of code the FDE describes.
+ */
+void WriteFDEHeader(std::vector<uint8_t>* buf, uint32_t code_size);
+
+/*
+ * @brief Pad a CIE or FDE to a multiple of 4 bytes and set its length.
+ * @param buf CIE or FDE buffer, which starts with its length.
+ */
+void WriteCFILength(std::vector<uint8_t>* buf);
+
+}  // namespace art
+
+#endif  // ART_COMPILER_UTILS_DWARF_CFI_H_
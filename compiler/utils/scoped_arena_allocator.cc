@@ -30,16 +30,19 @@ ArenaStack::ArenaStack(ArenaPool* arena_pool)
     top_arena_(nullptr),
     top_ptr_(nullptr),
     top_end_(nullptr),
-    running_on_valgrind_(RUNNING_ON_VALGRIND > 0) {
+    running_on_valgrind_(RUNNING_ON_VALGRIND > 0),
+    count_allocations_(arena_pool->CountAllocations()) {
 }
 
 ArenaStack::~ArenaStack() {
   DebugStackRefCounter::CheckNoRefs();
+  RecordPeakStats();
   stats_and_pool_.pool->FreeArenaChain(bottom_arena_);
 }
 
 void ArenaStack::Reset() {
   DebugStackRefCounter::CheckNoRefs();
+  RecordPeakStats();
   stats_and_pool_.pool->FreeArenaChain(bottom_arena_);
   bottom_arena_ = nullptr;
   top_arena_  = nullptr;
@@ -53,6 +56,14 @@ MemStats ArenaStack::GetPeakStats() const {
                   bottom_arena_);
 }
 
+size_t ArenaStack::BytesInArenas() const {
+  size_t bytes = 0u;
+  for (const Arena* arena = bottom_arena_; arena != nullptr; arena = arena->next_) {
+    bytes += arena->Size();
+  }
+  return bytes;
+}
+
 uint8_t* ArenaStack::AllocateFromNextArena(size_t rounded_bytes) {
   UpdateBytesAllocated();
   size_t allocation_size = std::max(Arena::kDefaultSize, rounded_bytes);
@@ -79,6 +90,14 @@ void ArenaStack::UpdatePeakStatsAndRestore(const ArenaAllocatorStats& restore_st
   CurrentStats()->Copy(restore_stats);
 }
 
+void ArenaStack::RecordPeakStats() {
+  if (count_allocations_ && PeakStats()->NumAllocations() != 0u) {
+    stats_and_pool_.pool->RecordAllocatorStats(*PeakStats());
+    // Don't record the same allocations again if the stack is reused.
+    PeakStats()->Copy(ArenaAllocatorStats());
+  }
+}
+
 void ArenaStack::UpdateBytesAllocated() {
   if (top_arena_ != nullptr) {
     // Update how many bytes we have allocated into the arena so that the arena pool knows how
@@ -97,7 +116,9 @@ void* ArenaStack::AllocValgrind(size_t bytes, ArenaAllocKind kind) {
   if (UNLIKELY(static_cast<size_t>(top_end_ - ptr) < rounded_bytes)) {
     ptr = AllocateFromNextArena(rounded_bytes);
   }
-  CurrentStats()->RecordAlloc(bytes, kind);
+  if (UNLIKELY(count_allocations_)) {
+    CurrentStats()->RecordAlloc(bytes, kind);
+  }
   top_ptr_ = ptr + rounded_bytes;
   VALGRIND_MAKE_MEM_UNDEFINED(ptr, bytes);
   VALGRIND_MAKE_MEM_NOACCESS(ptr + bytes, rounded_bytes - bytes);
@@ -45,6 +45,9 @@ class ArenaStack : private DebugStackRefCounter {
 
   MemStats GetPeakStats() const;
 
+  // Memory of the arenas taken from the pool, the stack keeps them until Reset().
+  size_t BytesInArenas() const;
+
  private:
   struct Peak;
   struct Current;
@@ -72,13 +75,16 @@ class ArenaStack : private DebugStackRefCounter {
     if (UNLIKELY(static_cast<size_t>(top_end_ - ptr) < rounded_bytes)) {
       ptr = AllocateFromNextArena(rounded_bytes);
     }
-    CurrentStats()->RecordAlloc(bytes, kind);
+    if (UNLIKELY(count_allocations_)) {
+      CurrentStats()->RecordAlloc(bytes, kind);
+    }
     top_ptr_ = ptr + rounded_bytes;
     return ptr;
   }
 
   uint8_t* AllocateFromNextArena(size_t rounded_bytes);
   void UpdatePeakStatsAndRestore(const ArenaAllocatorStats& restore_stats);
+  void RecordPeakStats();
   void UpdateBytesAllocated();
   void* AllocValgrind(size_t bytes, ArenaAllocKind kind);
 
@@ -89,6 +95,7 @@ class ArenaStack : private DebugStackRefCounter {
   uint8_t* top_end_;
 
   const bool running_on_valgrind_;
+  const bool count_allocations_;
 
   friend class ScopedArenaAllocator;
   template <typename T>
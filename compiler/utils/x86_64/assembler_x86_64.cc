@@ -1205,6 +1205,21 @@ void X86_64Assembler::sarl(CpuRegister operand, CpuRegister shifter) {
 }
 
 
+void X86_64Assembler::shlq(CpuRegister reg, const Immediate& imm) {
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  CHECK(imm.is_int8());
+  EmitRex64(reg);
+  if (imm.value() == 1) {
+    EmitUint8(0xD1);
+    EmitOperand(4, Operand(reg));
+  } else {
+    EmitUint8(0xC1);
+    EmitOperand(4, Operand(reg));
+    EmitUint8(imm.value() & 0xFF);
+  }
+}
+
+
 void X86_64Assembler::negl(CpuRegister reg) {
   AssemblerBuffer::EnsureCapacity ensured(&buffer_);
   EmitOptionalRex32(reg);
@@ -1840,7 +1855,13 @@ void X86_64Assembler::LoadRef(ManagedRegister mdest, ManagedRegister base,
                            MemberOffset offs) {
   X86_64ManagedRegister dest = mdest.AsX86_64();
   CHECK(dest.IsCpuRegister() && dest.IsCpuRegister());
-  movq(dest.AsCpuRegister(), Address(base.AsX86_64().AsCpuRegister(), offs));
+  if (k64BitHeapReferenceShift != 0) {
+    // The zero extended 32-bit reference is decoded to the address.
+    movl(dest.AsCpuRegister(), Address(base.AsX86_64().AsCpuRegister(), offs));
+    shlq(dest.AsCpuRegister(), Immediate(k64BitHeapReferenceShift));
+  } else {
+    movq(dest.AsCpuRegister(), Address(base.AsX86_64().AsCpuRegister(), offs));
+  }
 }
 
 void X86_64Assembler::LoadRawPtr(ManagedRegister mdest, ManagedRegister base,
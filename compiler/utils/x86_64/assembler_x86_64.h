@@ -426,6 +426,7 @@ class X86_64Assembler FINAL : public Assembler {
   void shrl(CpuRegister operand, CpuRegister shifter);
   void sarl(CpuRegister reg, const Immediate& imm);
   void sarl(CpuRegister operand, CpuRegister shifter);
+  void shlq(CpuRegister reg, const Immediate& imm);
 
   void negl(CpuRegister reg);
   void notl(CpuRegister reg);
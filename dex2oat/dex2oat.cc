@@ -16,11 +16,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <valgrind.h>
 
 #include <fstream>
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -30,6 +32,7 @@
 #include <sys/utsname.h>
 #endif
 
+#include "atomic.h"
 #include "base/stl_util.h"
 #include "base/stringpiece.h"
 #include "base/timing_logger.h"
@@ -39,10 +42,12 @@
 #include "compiler_callbacks.h"
 #include "dex_file-inl.h"
 #include "dex/pass_driver_me_opts.h"
+#include "dex/verification_cache.h"
 #include "dex/verification_results.h"
 #include "driver/compiler_callbacks_impl.h"
 #include "driver/compiler_driver.h"
 #include "driver/compiler_options.h"
+#include "driver/previous_oat_file.h"
 #include "elf_fixup.h"
 #include "elf_stripper.h"
 #include "gc/space/image_space.h"
@@ -133,6 +138,10 @@ static void Usage(const char* fmt, ...) {
   UsageError("  --image-classes=<classname-file>: specifies classes to include in an image.");
   UsageError("      Example: --image=frameworks/base/preloaded-classes");
   UsageError("");
+  UsageError("  --app-image=<file.art>: also writes the resolved classes of the single dex file to");
+  UsageError("      an app image, used by the runtime when it is found next to the oat file.");
+  UsageError("      Example: --app-image=/data/dalvik-cache/data@app@Calculator.apk@classes.art");
+  UsageError("");
   UsageError("  --base=<hex-address>: specifies the base address when creating a boot image.");
   UsageError("      Example: --base=0x50000000");
   UsageError("");
@@ -158,8 +167,12 @@ static void Usage(const char* fmt, ...) {
   UsageError("      Example: --compiler-backend=Portable");
   UsageError("      Default: Quick");
   UsageError("");
-  UsageError("  --compiler-filter=(verify-none|interpret-only|space|balanced|speed|everything):");
-  UsageError("      select compiler filter.");
+  UsageError("  --compiler-filter=(verify-none|interpret-only|profiled|speed-profile|space|");
+  UsageError("      balanced|speed|everything): select compiler filter. profiled compiles the hot");
+  UsageError("      methods of the --profile-file, quickens the warm ones and leaves the others");
+  UsageError("      interpreted. speed-profile does the same but compiles the hot methods with");
+  UsageError("      loops with the Optimizing backend, falling back to Quick for the others and");
+  UsageError("      for the code that Optimizing does not support.");
   UsageError("      Example: --compiler-filter=everything");
 #if ART_SMALL_MODE
   UsageError("      Default: interpret-only");
@@ -199,10 +212,30 @@ static void Usage(const char* fmt, ...) {
   UsageError("      Example: --num-dex-method=%d", CompilerOptions::kDefaultNumDexMethodsThreshold);
   UsageError("      Default: %d", CompilerOptions::kDefaultNumDexMethodsThreshold);
   UsageError("");
+  UsageError("  --compiler-arena-budget=<megabytes>: the arena memory a compiler thread may use");
+  UsageError("      for a method before compiling the rest of it without the optional");
+  UsageError("      optimizations. Without -j, the threads are also limited to as many budgets");
+  UsageError("      as fit in the available memory.");
+  UsageError("      Example: --compiler-arena-budget=64");
+  UsageError("      Default: no budget");
+  UsageError("");
+  UsageError("  --inline-tlab-allocation: allocate objects from the thread-local allocation");
+  UsageError("      buffer in compiled code, for runtimes started with -XX:UseTLAB.");
+  UsageError("");
   UsageError("  --host: used with Portable backend to link against host runtime libraries");
   UsageError("");
   UsageError("  --dump-timing: display a breakdown of where time was spent");
   UsageError("");
+  UsageError("  --compilation-decision-log=<file>: write one line per method with its name and");
+  UsageError("      how it was compiled: jni-stub, generic-jni, previous-oat, optimizing,");
+  UsageError("      quick-no-loop, quick-unsupported, compiled, quickened or interpreted.");
+  UsageError("      Example: --compilation-decision-log=/tmp/decisions.txt");
+  UsageError("");
+  UsageError("  --dump-stats-json=<file.json>: write the time of the phases and compiler passes,");
+  UsageError("      the compiler arena usage by kind, the thread utilization and the peak RSS");
+  UsageError("      to <file.json>, for tools/dex2oat-benchmark.py.");
+  UsageError("      Example: --dump-stats-json=/tmp/boot.json");
+  UsageError("");
   UsageError("  --runtime-arg <argument>: used to specify various arguments for the runtime,");
   UsageError("      such as initial heap size, maximum heap size, and verbose output.");
   UsageError("      Use a separate --runtime-arg switch for each argument.");
@@ -210,6 +243,32 @@ static void Usage(const char* fmt, ...) {
   UsageError("");
   UsageError("  --profile-file=<filename>: specify profiler output file to use for compilation.");
   UsageError("");
+  UsageError("  --method-order-file=<file>: lay out the code of the methods listed in <file>,");
+  UsageError("      one name per line as in the profile, at the start of the text section. Without");
+  UsageError("      it, the methods of the --profile-file that are not cold are laid out first.");
+  UsageError("      Example: --method-order-file=frameworks/base/preloaded-methods");
+  UsageError("");
+  UsageError("  --previous-oat-file=<file.oat>: reuse the compiled code of the classes that did not");
+  UsageError("      change since <file.oat> was compiled from an older version of the dex files.");
+  UsageError("      Ignored if it was compiled for another boot image or instruction set.");
+  UsageError("      Example: --previous-oat-file=/data/dalvik-cache/arm/app.apk@classes.dex");
+  UsageError("");
+  UsageError("  --verification-cache=<file>: skip the verification of the classes verified by");
+  UsageError("      an earlier compilation of the same dex files while the classes outside of them");
+  UsageError("      that the verification depended on are unchanged, and update <file>.");
+  UsageError("      Example: --verification-cache=/data/dalvik-cache/arm/app.apk@classes.vdc");
+  UsageError("");
+  UsageError("  --profile-hot-percent=<percent>: with --compiler-filter=profiled, compile the");
+  UsageError("      methods that make up this percentage of the profile samples.");
+  UsageError("      Example: --profile-hot-percent=%.0f", CompilerOptions::kDefaultProfileHotPercent);
+  UsageError("      Default: %.0f", CompilerOptions::kDefaultProfileHotPercent);
+  UsageError("");
+  UsageError("  --profile-warm-percent=<percent>: with --compiler-filter=profiled, quicken the");
+  UsageError("      methods past the hot ones that make up this percentage of the samples.");
+  UsageError("      Example: --profile-warm-percent=%.0f",
+             CompilerOptions::kDefaultProfileWarmPercent);
+  UsageError("      Default: %.0f", CompilerOptions::kDefaultProfileWarmPercent);
+  UsageError("");
   UsageError("  --print-pass-names: print a list of pass names");
   UsageError("");
   UsageError("  --disable-passes=<pass-names>:  disable one or more passes separated by comma.");
@@ -258,6 +317,84 @@ class Dex2Oat {
               << " (threads: " << thread_count_ << ")";
   }
 
+  // Writes the time of the dex2oat phases and compiler passes, the arena usage of the compiler,
+  // the thread utilization and the peak RSS to `filename` as JSON, for comparing builds.
+  bool WriteStatsJson(const std::string& filename, const TimingLogger& timings,
+                      const CompilerDriver& driver) {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+      PLOG(ERROR) << "Failed to get the resource usage for " << filename;
+      return false;
+    }
+    const uint64_t wall_us = NsToUs(NanoTime() - start_ns_);
+    const uint64_t cpu_us =
+        usage.ru_utime.tv_sec * UINT64_C(1000000) + usage.ru_utime.tv_usec +
+        usage.ru_stime.tv_sec * UINT64_C(1000000) + usage.ru_stime.tv_usec;
+    const char* compiler = compiler_kind_ == Compiler::kOptimizing ? "optimizing"
+        : (compiler_kind_ == Compiler::kPortable ? "portable" : "quick");
+    std::ostringstream os;
+    os << "{\n";
+    os << "  \"version\": 1,\n";
+    os << "  \"instruction_set\": \"" << GetInstructionSetString(instruction_set_) << "\",\n";
+    os << "  \"compiler\": \"" << compiler << "\",\n";
+    os << "  \"threads\": " << thread_count_ << ",\n";
+    os << "  \"wall_us\": " << wall_us << ",\n";
+    os << "  \"cpu_us\": " << cpu_us << ",\n";
+    // The share of the threads' time that was spent running, 1 when none of them waited.
+    os << "  \"thread_utilization\": "
+       << (wall_us == 0 ? 0.0 : static_cast<double>(cpu_us) / (wall_us * thread_count_)) << ",\n";
+    // Linux reports ru_maxrss in KB.
+    os << "  \"peak_rss_kb\": " << usage.ru_maxrss << ",\n";
+    os << "  \"phases\": [";
+    const char* separator = "\n";
+    for (const TimingLogger::SplitTiming& split : timings.GetSplits()) {
+      os << separator << "    {\"name\": \"" << split.second << "\", \"us\": "
+         << NsToUs(split.first) << "}";
+      separator = ",\n";
+    }
+    os << "\n  ],\n";
+    // The passes are only timed with --dump-passes, which --dump-stats-json implies.
+    os << "  \"passes\": [";
+    separator = "\n";
+    for (const CumulativeLogger::SplitStats& stats : driver.GetTimingsLogger()->GetSplitStats()) {
+      os << separator << "    {\"name\": \"" << stats.label << "\", \"count\": " << stats.count
+         << ", \"total_us\": " << stats.total_us << ", \"max_us\": " << stats.max_us << "}";
+      separator = ",\n";
+    }
+    os << "\n  ],\n";
+    os << "  \"arena\": ";
+    driver.GetArenaStats().DumpJson(os);
+    os << "\n}\n";
+
+    std::unique_ptr<File> file(OS::CreateEmptyFile(filename.c_str()));
+    if (file.get() == nullptr) {
+      PLOG(ERROR) << "Failed to create " << filename;
+      return false;
+    }
+    const std::string json = os.str();
+    if (!file->WriteFully(json.data(), json.size())) {
+      PLOG(ERROR) << "Failed to write " << filename;
+      return false;
+    }
+    return true;
+  }
+
+  // Writes how each method was compiled to `filename`, one method per line.
+  bool WriteCompilationDecisions(const std::string& filename, const CompilerDriver& driver) {
+    std::ostringstream os;
+    driver.DumpCompilationDecisions(os);
+    std::unique_ptr<File> file(OS::CreateEmptyFile(filename.c_str()));
+    if (file.get() == nullptr) {
+      PLOG(ERROR) << "Failed to create " << filename;
+      return false;
+    }
+    const std::string decisions = os.str();
+    if (!file->WriteFully(decisions.data(), decisions.size())) {
+      PLOG(ERROR) << "Failed to write " << filename;
+      return false;
+    }
+    return true;
+  }
 
   // Reads the class names (java.lang.Object) and returns a set of descriptors (Ljava/lang/Object;)
   CompilerDriver::DescriptorSet* ReadImageClassesFromFile(const char* image_classes_filename) {
@@ -286,6 +423,25 @@ class Dex2Oat {
     return image_classes.release();
   }
 
+  // Reads the method names, as printed by PrettyMethod, one per line.
+  std::set<std::string>* ReadHotMethodsFromFile(const char* method_order_filename) {
+    std::ifstream method_order_file(method_order_filename, std::ifstream::in);
+    if (!method_order_file.good()) {
+      LOG(ERROR) << "Failed to open method order file " << method_order_filename;
+      return nullptr;
+    }
+    std::unique_ptr<std::set<std::string>> hot_methods(new std::set<std::string>);
+    while (method_order_file.good()) {
+      std::string method_name;
+      std::getline(method_order_file, method_name);
+      if (StartsWith(method_name, "#") || method_name.empty()) {
+        continue;
+      }
+      hot_methods->insert(method_name);
+    }
+    return hot_methods.release();
+  }
+
   // Reads the class names (java.lang.Object) and returns a set of descriptors (Ljava/lang/Object;)
   CompilerDriver::DescriptorSet* ReadImageClassesFromZip(const char* zip_filename,
                                                          const char* image_classes_filename,
@@ -324,9 +480,14 @@ class Dex2Oat {
                                       std::unique_ptr<CompilerDriver::DescriptorSet>& image_classes,
                                       bool dump_stats,
                                       bool dump_passes,
+                                      bool count_arena_allocations,
+                                      bool record_compilation_decisions,
                                       TimingLogger& timings,
                                       CumulativeLogger& compiler_phases_timings,
-                                      std::string profile_file) {
+                                      std::string profile_file,
+                                      const std::string& previous_oat_filename,
+                                      const std::string& verification_cache_filename,
+                                      std::unique_ptr<std::set<std::string>>& hot_methods) {
     // Handle and ClassLoader creation needs to come after Runtime::Create
     jobject class_loader = nullptr;
     Thread* self = Thread::Current();
@@ -344,6 +505,7 @@ class Dex2Oat {
       class_loader = soa.Env()->NewGlobalRef(class_loader_local.get());
       Runtime::Current()->SetCompileTimeClassPath(class_loader, class_path_files);
     }
+    class_loader_ = class_loader;
 
     std::unique_ptr<CompilerDriver> driver(new CompilerDriver(compiler_options_,
                                                         verification_results_,
@@ -360,10 +522,16 @@ class Dex2Oat {
                                                         profile_file));
 
     driver->GetCompiler()->SetBitcodeFileName(*driver.get(), bitcode_filename);
+    if (count_arena_allocations) {
+      driver->SetCountArenaAllocations(true);
+    }
+    if (record_compilation_decisions) {
+      driver->SetRecordCompilationDecisions(true);
+    }
+    if (hot_methods.get() != nullptr) {
+      driver->SetHotMethods(hot_methods.release());
+    }
 
-    driver->CompileAll(class_loader, dex_files, &timings);
-
-    timings.NewSplit("dex2oat OatWriter");
     std::string image_file_location;
     uint32_t image_file_location_oat_checksum = 0;
     uintptr_t image_file_location_oat_data_begin = 0;
@@ -376,6 +544,46 @@ class Dex2Oat {
       image_file_location = image_space->GetImageFilename();
     }
 
+    if (!previous_oat_filename.empty()) {
+      TimingLogger::ScopedSplit split("Opening previous oat file", &timings);
+      std::string error_msg;
+      PreviousOatFile* previous_oat_file =
+          PreviousOatFile::Open(previous_oat_filename, instruction_set_,
+                                instruction_set_features_, image_file_location_oat_checksum,
+                                image_file_location_oat_data_begin, dex_files, &error_msg);
+      if (previous_oat_file == nullptr) {
+        // Compile everything instead.
+        LOG(WARNING) << "Not reusing compiled methods: " << error_msg;
+      } else {
+        driver->SetPreviousOatFile(previous_oat_file);
+      }
+    }
+
+    if (!verification_cache_filename.empty()) {
+      TimingLogger::ScopedSplit split("Opening verification cache", &timings);
+      std::string error_msg;
+      VerificationCache* cache =
+          VerificationCache::Open(verification_cache_filename, dex_files, &error_msg);
+      if (cache == nullptr) {
+        LOG(INFO) << "Verifying all classes: " << error_msg;
+      }
+      verification_results_->UseVerificationCache(dex_files, cache);
+    }
+
+    driver->CompileAll(class_loader, dex_files, &timings);
+
+    if (!verification_cache_filename.empty()) {
+      TimingLogger::ScopedSplit split("Writing verification cache", &timings);
+      std::string error_msg;
+      if (!VerificationCache::Write(verification_cache_filename, dex_files, class_loader,
+                                    verification_results_, &error_msg)) {
+        // The next compilation verifies everything again, this one is still good.
+        LOG(WARNING) << error_msg;
+      }
+    }
+
+    timings.NewSplit("dex2oat OatWriter");
+
     OatWriter oat_writer(dex_files,
                          image_file_location_oat_checksum,
                          image_file_location_oat_data_begin,
@@ -388,6 +596,8 @@ class Dex2Oat {
       LOG(ERROR) << "Failed to write ELF file " << oat_file->GetPath();
       return nullptr;
     }
+    // The code is in the oat file, the image writer only needs the patch information.
+    driver->ReleaseCompiledMethods();
 
     return driver.release();
   }
@@ -421,6 +631,26 @@ class Dex2Oat {
     return true;
   }
 
+  // Writes the app image below the boot image. The oat file isn't fixed up, the runtime maps it
+  // after the app image when it uses the image and anywhere otherwise.
+  bool CreateAppImageFile(const std::string& image_filename,
+                          const std::string& oat_filename,
+                          const std::string& oat_location,
+                          const std::vector<const DexFile*>& dex_files,
+                          const CompilerDriver& compiler)
+      LOCKS_EXCLUDED(Locks::mutator_lock_) {
+    CHECK(class_loader_ != nullptr);
+    gc::space::ImageSpace* boot_image_space = Runtime::Current()->GetHeap()->GetImageSpace();
+    uintptr_t image_base = reinterpret_cast<uintptr_t>(boot_image_space->Begin()) -
+        gc::space::ImageSpace::kAppImageAreaSize;
+    ImageWriter image_writer(compiler, class_loader_, dex_files);
+    if (!image_writer.Write(image_filename, image_base, oat_filename, oat_location)) {
+      LOG(ERROR) << "Failed to create app image file " << image_filename;
+      return false;
+    }
+    return true;
+  }
+
  private:
   explicit Dex2Oat(const CompilerOptions* compiler_options,
                    Compiler::Kind compiler_kind,
@@ -436,6 +666,7 @@ class Dex2Oat {
         verification_results_(verification_results),
         method_inliner_map_(method_inliner_map),
         runtime_(nullptr),
+        class_loader_(nullptr),
         thread_count_(thread_count),
         start_ns_(NanoTime()) {
     CHECK(compiler_options != nullptr);
@@ -504,6 +735,8 @@ class Dex2Oat {
   VerificationResults* const verification_results_;
   DexFileToMethodInlinerMap* const method_inliner_map_;
   Runtime* runtime_;
+  // The class loader of the compiled dex files, null for a boot image.
+  jobject class_loader_;
   size_t thread_count_;
   uint64_t start_ns_;
 
@@ -520,28 +753,131 @@ static bool ParseInt(const char* in, int* out) {
   return true;
 }
 
+static bool ParseDouble(const char* in, double min, double max, double* out) {
+  char* end;
+  double result = strtod(in, &end);
+  if (in == end || *end != '\0' || result < min || result > max) {
+    return false;
+  }
+  *out = result;
+  return true;
+}
+
+// Memory that can be allocated without swapping: MemAvailable of /proc/meminfo or, on kernels that
+// do not report it, the free memory. 0 if it is unknown.
+static uint64_t GetAvailableMemory() {
+#if defined(__linux__)
+  std::ifstream meminfo("/proc/meminfo");
+  std::string line;
+  while (std::getline(meminfo, line)) {
+    unsigned long long available_kb;  // NOLINT(runtime/int)
+    if (sscanf(line.c_str(), "MemAvailable: %llu kB", &available_kb) == 1) {
+      return available_kb * KB;
+    }
+  }
+  long free_pages = sysconf(_SC_AVPHYS_PAGES);  // NOLINT(runtime/int)
+  long page_size = sysconf(_SC_PAGESIZE);  // NOLINT(runtime/int)
+  if (free_pages > 0 && page_size > 0) {
+    return static_cast<uint64_t>(free_pages) * page_size;
+  }
+#endif
+  return 0;
+}
+
+// Opens dex files on a few threads, each thread taking the next file that is left to open. Most of
+// the work is the extraction, checksum and verification of each file, which are independent.
+class ParallelDexFileOpener {
+ public:
+  ParallelDexFileOpener(const std::vector<const char*>& dex_filenames,
+                        const std::vector<const char*>& dex_locations)
+      : dex_filenames_(dex_filenames),
+        dex_locations_(dex_locations),
+        next_(0),
+        dex_files_(dex_filenames.size(), nullptr),
+        error_msgs_(dex_filenames.size()) {
+    CHECK_EQ(dex_filenames.size(), dex_locations.size());
+  }
+
+  // Opens all the files, using the calling thread and thread_count - 1 new threads.
+  void Run(size_t thread_count) {
+    std::vector<pthread_t> threads(std::min(thread_count, dex_filenames_.size()) - 1);
+    for (pthread_t& thread : threads) {
+      CHECK_PTHREAD_CALL(pthread_create, (&thread, nullptr, &Callback, this), "dex file opener");
+    }
+    OpenFiles();
+    for (pthread_t& thread : threads) {
+      CHECK_PTHREAD_CALL(pthread_join, (thread, nullptr), "dex file opener");
+    }
+  }
+
+  // The dex file opened for dex_filenames[i], or nullptr with its error.
+  const DexFile* GetDexFile(size_t i) const {
+    return dex_files_[i];
+  }
+
+  const std::string& GetErrorMsg(size_t i) const {
+    return error_msgs_[i];
+  }
+
+ private:
+  static void* Callback(void* arg) {
+    ::art::SetThreadName("dex2oat dex file opener");
+    reinterpret_cast<ParallelDexFileOpener*>(arg)->OpenFiles();
+    return nullptr;
+  }
+
+  void OpenFiles() {
+    for (size_t i = next_.FetchAndAddSequentiallyConsistent(1); i < dex_filenames_.size();
+         i = next_.FetchAndAddSequentiallyConsistent(1)) {
+      dex_files_[i] = DexFile::Open(dex_filenames_[i], dex_locations_[i], &error_msgs_[i]);
+    }
+  }
+
+  const std::vector<const char*>& dex_filenames_;
+  const std::vector<const char*>& dex_locations_;
+  Atomic<size_t> next_;
+  // Each element is only written by the thread opening the file.
+  std::vector<const DexFile*> dex_files_;
+  std::vector<std::string> error_msgs_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelDexFileOpener);
+};
+
+// The class paths have few files, a small pool is enough.
+static constexpr size_t kMaxDexFileOpenThreads = 4;
+
 static size_t OpenDexFiles(const std::vector<const char*>& dex_filenames,
                            const std::vector<const char*>& dex_locations,
+                           size_t thread_count,
                            std::vector<const DexFile*>& dex_files) {
-  size_t failure_count = 0;
+  ATRACE_BEGIN("Opening dex files");
+  std::vector<const char*> existing_filenames;
+  std::vector<const char*> existing_locations;
   for (size_t i = 0; i < dex_filenames.size(); i++) {
-    const char* dex_filename = dex_filenames[i];
-    const char* dex_location = dex_locations[i];
-    ATRACE_BEGIN(StringPrintf("Opening dex file '%s'", dex_filenames[i]).c_str());
-    std::string error_msg;
-    if (!OS::FileExists(dex_filename)) {
-      LOG(WARNING) << "Skipping non-existent dex file '" << dex_filename << "'";
+    if (!OS::FileExists(dex_filenames[i])) {
+      LOG(WARNING) << "Skipping non-existent dex file '" << dex_filenames[i] << "'";
       continue;
     }
-    const DexFile* dex_file = DexFile::Open(dex_filename, dex_location, &error_msg);
-    if (dex_file == nullptr) {
-      LOG(WARNING) << "Failed to open .dex from file '" << dex_filename << "': " << error_msg;
-      ++failure_count;
-    } else {
-      dex_files.push_back(dex_file);
+    existing_filenames.push_back(dex_filenames[i]);
+    existing_locations.push_back(dex_locations[i]);
+  }
+  size_t failure_count = 0;
+  if (!existing_filenames.empty()) {
+    ParallelDexFileOpener opener(existing_filenames, existing_locations);
+    opener.Run(std::max<size_t>(1, std::min(thread_count, kMaxDexFileOpenThreads)));
+    // Keep the order of the command line, which is the order of the class path.
+    for (size_t i = 0; i < existing_filenames.size(); i++) {
+      const DexFile* dex_file = opener.GetDexFile(i);
+      if (dex_file == nullptr) {
+        LOG(WARNING) << "Failed to open .dex from file '" << existing_filenames[i] << "': "
+                     << opener.GetErrorMsg(i);
+        ++failure_count;
+      } else {
+        dex_files.push_back(dex_file);
+      }
     }
-    ATRACE_END();
   }
+  ATRACE_END();
   return failure_count;
 }
 
@@ -755,11 +1091,14 @@ static int dex2oat(int argc, char** argv) {
   const char* image_classes_zip_filename = nullptr;
   const char* image_classes_filename = nullptr;
   std::string image_filename;
+  std::string app_image_filename;
   std::string boot_image_filename;
   uintptr_t image_base = 0;
   std::string android_root;
   std::vector<const char*> runtime_args;
   int thread_count = sysconf(_SC_NPROCESSORS_CONF);
+  bool explicit_thread_count = false;
+  int arena_budget_mb = 0;
   Compiler::Kind compiler_kind = kUsePortableCompiler
       ? Compiler::kPortable
       : Compiler::kQuick;
@@ -769,6 +1108,8 @@ static int dex2oat(int argc, char** argv) {
   int small_method_threshold = CompilerOptions::kDefaultSmallMethodThreshold;
   int tiny_method_threshold = CompilerOptions::kDefaultTinyMethodThreshold;
   int num_dex_methods_threshold = CompilerOptions::kDefaultNumDexMethodsThreshold;
+  double profile_hot_percent = CompilerOptions::kDefaultProfileHotPercent;
+  double profile_warm_percent = CompilerOptions::kDefaultProfileWarmPercent;
 
   // Take the default set of instruction features from the build.
   InstructionSetFeatures instruction_set_features =
@@ -778,14 +1119,20 @@ static int dex2oat(int argc, char** argv) {
 
   // Profile file to use
   std::string profile_file;
+  std::string previous_oat_filename;
+  std::string verification_cache_filename;
+  const char* method_order_filename = nullptr;
 
   bool is_host = false;
   bool dump_stats = false;
   bool dump_timing = false;
   bool dump_passes = false;
+  std::string stats_json_filename;
+  std::string decision_log_filename;
   bool dump_slow_timing = kIsDebugBuild;
   bool watch_dog_enabled = !kIsTargetBuild;
   bool generate_gdb_information = kIsDebugBuild;
+  bool inline_tlab_allocation = false;
 
   for (int i = 0; i < argc; i++) {
     const StringPiece option(argv[i]);
@@ -827,17 +1174,27 @@ static int dex2oat(int argc, char** argv) {
       generate_gdb_information = true;
     } else if (option == "--no-gen-gdb-info") {
       generate_gdb_information = false;
+    } else if (option == "--inline-tlab-allocation") {
+      inline_tlab_allocation = true;
     } else if (option.starts_with("-j")) {
       const char* thread_count_str = option.substr(strlen("-j")).data();
       if (!ParseInt(thread_count_str, &thread_count)) {
         Usage("Failed to parse -j argument '%s' as an integer", thread_count_str);
       }
+      explicit_thread_count = true;
+    } else if (option.starts_with("--compiler-arena-budget=")) {
+      const char* budget = option.substr(strlen("--compiler-arena-budget=")).data();
+      if (!ParseInt(budget, &arena_budget_mb) || arena_budget_mb <= 0) {
+        Usage("Failed to parse --compiler-arena-budget '%s' as a positive integer", budget);
+      }
     } else if (option.starts_with("--oat-location=")) {
       oat_location = option.substr(strlen("--oat-location=")).data();
     } else if (option.starts_with("--bitcode=")) {
       bitcode_filename = option.substr(strlen("--bitcode=")).data();
     } else if (option.starts_with("--image=")) {
       image_filename = option.substr(strlen("--image=")).data();
+    } else if (option.starts_with("--app-image=")) {
+      app_image_filename = option.substr(strlen("--app-image=")).data();
     } else if (option.starts_with("--image-classes=")) {
       image_classes_filename = option.substr(strlen("--image-classes=")).data();
     } else if (option.starts_with("--image-classes-zip=")) {
@@ -936,9 +1293,29 @@ static int dex2oat(int argc, char** argv) {
       dump_passes = true;
     } else if (option == "--dump-stats") {
       dump_stats = true;
+    } else if (option.starts_with("--dump-stats-json=")) {
+      stats_json_filename = option.substr(strlen("--dump-stats-json=")).data();
+    } else if (option.starts_with("--compilation-decision-log=")) {
+      decision_log_filename = option.substr(strlen("--compilation-decision-log=")).data();
+    } else if (option.starts_with("--method-order-file=")) {
+      method_order_filename = option.substr(strlen("--method-order-file=")).data();
+    } else if (option.starts_with("--previous-oat-file=")) {
+      previous_oat_filename = option.substr(strlen("--previous-oat-file=")).data();
+    } else if (option.starts_with("--verification-cache=")) {
+      verification_cache_filename = option.substr(strlen("--verification-cache=")).data();
     } else if (option.starts_with("--profile-file=")) {
       profile_file = option.substr(strlen("--profile-file=")).data();
       VLOG(compiler) << "dex2oat: profile file is " << profile_file;
+    } else if (option.starts_with("--profile-hot-percent=")) {
+      const char* percent = option.substr(strlen("--profile-hot-percent=")).data();
+      if (!ParseDouble(percent, 0.0, 100.0, &profile_hot_percent)) {
+        Usage("Failed to parse --profile-hot-percent '%s' as a percentage", percent);
+      }
+    } else if (option.starts_with("--profile-warm-percent=")) {
+      const char* percent = option.substr(strlen("--profile-warm-percent=")).data();
+      if (!ParseDouble(percent, 0.0, 100.0, &profile_warm_percent)) {
+        Usage("Failed to parse --profile-warm-percent '%s' as a percentage", percent);
+      }
     } else if (option == "--no-profile-file") {
       // No profile
     } else if (option == "--print-pass-names") {
@@ -979,6 +1356,18 @@ static int dex2oat(int argc, char** argv) {
     Usage("--oat-fd should not be used with --image");
   }
 
+  if (!app_image_filename.empty() && !image_filename.empty()) {
+    Usage("--app-image should not be used with --image");
+  }
+
+  if (!app_image_filename.empty() && oat_fd != -1) {
+    Usage("--oat-fd should not be used with --app-image");
+  }
+
+  if (!app_image_filename.empty() && compiler_kind == Compiler::kPortable) {
+    Usage("--app-image should not be used with --compiler-backend=Portable");
+  }
+
   if (android_root.empty()) {
     const char* android_root_env_var = getenv("ANDROID_ROOT");
     if (android_root_env_var == nullptr) {
@@ -1006,6 +1395,18 @@ static int dex2oat(int argc, char** argv) {
     Usage("--image-classes should not be used with --boot-image");
   }
 
+  if (!previous_oat_filename.empty() && image) {
+    Usage("--previous-oat-file should not be used with --image");
+  }
+
+  if (!previous_oat_filename.empty() && compiler_kind == Compiler::kPortable) {
+    Usage("--previous-oat-file should not be used with --compiler-backend=Portable");
+  }
+
+  if (!verification_cache_filename.empty() && image) {
+    Usage("--verification-cache should not be used with --image");
+  }
+
   if (image_classes_zip_filename != nullptr && image_classes_filename == nullptr) {
     Usage("--image-classes-zip should be used with --image-classes");
   }
@@ -1068,6 +1469,10 @@ static int dex2oat(int argc, char** argv) {
     compiler_filter = CompilerOptions::kVerifyNone;
   } else if (strcmp(compiler_filter_string, "interpret-only") == 0) {
     compiler_filter = CompilerOptions::kInterpretOnly;
+  } else if (strcmp(compiler_filter_string, "profiled") == 0) {
+    compiler_filter = CompilerOptions::kProfiled;
+  } else if (strcmp(compiler_filter_string, "speed-profile") == 0) {
+    compiler_filter = CompilerOptions::kSpeedProfile;
   } else if (strcmp(compiler_filter_string, "space") == 0) {
     compiler_filter = CompilerOptions::kSpace;
   } else if (strcmp(compiler_filter_string, "balanced") == 0) {
@@ -1079,6 +1484,17 @@ static int dex2oat(int argc, char** argv) {
   } else {
     Usage("Unknown --compiler-filter value %s", compiler_filter_string);
   }
+  // speed-profile picks the backend of each hot method, which the Optimizing backend does.
+  if (compiler_filter == CompilerOptions::kSpeedProfile) {
+    if (compiler_kind == Compiler::kPortable) {
+      Usage("--compiler-filter=speed-profile is not supported with the Portable backend");
+    }
+    compiler_kind = Compiler::kOptimizing;
+  }
+  if (profile_warm_percent < profile_hot_percent) {
+    Usage("--profile-warm-percent %f is below --profile-hot-percent %f",
+          profile_warm_percent, profile_hot_percent);
+  }
 
   CompilerOptions compiler_options(compiler_filter,
                                    huge_method_threshold,
@@ -1086,11 +1502,28 @@ static int dex2oat(int argc, char** argv) {
                                    small_method_threshold,
                                    tiny_method_threshold,
                                    num_dex_methods_threshold,
+                                   profile_hot_percent,
+                                   profile_warm_percent,
                                    generate_gdb_information
 #ifdef ART_SEA_IR_MODE
                                    , compiler_options.sea_ir_ = true;
 #endif
                                    );  // NOLINT(whitespace/parens)
+  compiler_options.SetInlineTlabAllocation(inline_tlab_allocation);
+  if (arena_budget_mb != 0) {
+    compiler_options.SetArenaBudget(arena_budget_mb * MB);
+    // Each compiler thread may fill its budget, run as many as the memory holds.
+    uint64_t available_memory = GetAvailableMemory();
+    if (!explicit_thread_count && available_memory != 0) {
+      uint64_t memory_thread_count =
+          std::max<uint64_t>(1u, available_memory / (static_cast<uint64_t>(arena_budget_mb) * MB));
+      if (memory_thread_count < static_cast<uint64_t>(thread_count)) {
+        LOG(INFO) << "Using " << memory_thread_count << " threads instead of " << thread_count
+                  << " for " << PrettySize(available_memory) << " of available memory";
+        thread_count = static_cast<int>(memory_thread_count);
+      }
+    }
+  }
 
   // Done with usage checks, enable watchdog if requested
   WatchDog watch_dog(watch_dog_enabled);
@@ -1122,7 +1555,8 @@ static int dex2oat(int argc, char** argv) {
   Runtime::Options runtime_options;
   std::vector<const DexFile*> boot_class_path;
   if (boot_image_option.empty()) {
-    size_t failure_count = OpenDexFiles(dex_filenames, dex_locations, boot_class_path);
+    size_t failure_count = OpenDexFiles(dex_filenames, dex_locations, thread_count,
+                                        boot_class_path);
     if (failure_count > 0) {
       LOG(ERROR) << "Failed to open some dex files: " << failure_count;
       return EXIT_FAILURE;
@@ -1187,6 +1621,14 @@ static int dex2oat(int argc, char** argv) {
     image_classes.reset(new CompilerDriver::DescriptorSet);
   }
 
+  std::unique_ptr<std::set<std::string>> hot_methods;
+  if (method_order_filename != nullptr) {
+    hot_methods.reset(dex2oat->ReadHotMethodsFromFile(method_order_filename));
+    if (hot_methods.get() == nullptr) {
+      return EXIT_FAILURE;
+    }
+  }
+
   std::vector<const DexFile*> dex_files;
   if (boot_image_option.empty()) {
     dex_files = Runtime::Current()->GetClassLinker()->GetBootClassPath();
@@ -1210,7 +1652,8 @@ static int dex2oat(int argc, char** argv) {
       dex_files.push_back(dex_file);
       ATRACE_END();
     } else {
-      size_t failure_count = OpenDexFiles(dex_filenames, dex_locations, dex_files);
+      size_t failure_count = OpenDexFiles(dex_filenames, dex_locations, thread_count,
+                                          dex_files);
       if (failure_count > 0) {
         LOG(ERROR) << "Failed to open some dex files: " << failure_count;
         return EXIT_FAILURE;
@@ -1240,6 +1683,11 @@ static int dex2oat(int argc, char** argv) {
     }
   }
 
+  // The runtime opens an app image with the one dex file it is defining classes of.
+  if (!app_image_filename.empty() && dex_files.size() != 1) {
+    Usage("--app-image needs a single dex file, found %zd", dex_files.size());
+  }
+
   /*
    * If we're not in interpret-only or verify-none mode, go ahead and compile small applications.
    * Don't bother to check if we're doing the image.
@@ -1266,10 +1714,16 @@ static int dex2oat(int argc, char** argv) {
                                                                   image,
                                                                   image_classes,
                                                                   dump_stats,
-                                                                  dump_passes,
+                                                                  dump_passes ||
+                                                                      !stats_json_filename.empty(),
+                                                                  !stats_json_filename.empty(),
+                                                                  !decision_log_filename.empty(),
                                                                   timings,
                                                                   compiler_phases_timings,
-                                                                  profile_file));
+                                                                  profile_file,
+                                                                  previous_oat_filename,
+                                                                  verification_cache_filename,
+                                                                  hot_methods));
 
   if (compiler.get() == nullptr) {
     LOG(ERROR) << "Failed to create oat file: " << oat_location;
@@ -1278,6 +1732,11 @@ static int dex2oat(int argc, char** argv) {
 
   VLOG(compiler) << "Oat file written successfully (unstripped): " << oat_location;
 
+  if (!decision_log_filename.empty() &&
+      !dex2oat->WriteCompilationDecisions(decision_log_filename, *compiler.get())) {
+    return EXIT_FAILURE;
+  }
+
   // Notes on the interleaving of creating the image and oat file to
   // ensure the references between the two are correct.
   //
@@ -1341,13 +1800,27 @@ static int dex2oat(int argc, char** argv) {
     VLOG(compiler) << "Image written successfully: " << image_filename;
   }
 
+  if (!app_image_filename.empty()) {
+    timings.NewSplit("dex2oat app ImageWriter");
+    if (!dex2oat->CreateAppImageFile(app_image_filename, oat_unstripped, oat_location, dex_files,
+                                     *compiler.get())) {
+      return EXIT_FAILURE;
+    }
+    VLOG(compiler) << "App image written successfully: " << app_image_filename;
+  }
+
   if (is_host) {
+    timings.EndSplit();
     if (dump_timing || (dump_slow_timing && timings.GetTotalNs() > MsToNs(1000))) {
       LOG(INFO) << Dumpable<TimingLogger>(timings);
     }
     if (dump_passes) {
       LOG(INFO) << Dumpable<CumulativeLogger>(*compiler.get()->GetTimingsLogger());
     }
+    if (!stats_json_filename.empty() &&
+        !dex2oat->WriteStatsJson(stats_json_filename, timings, *compiler.get())) {
+      return EXIT_FAILURE;
+    }
     return EXIT_SUCCESS;
   }
 
@@ -1393,6 +1866,10 @@ static int dex2oat(int argc, char** argv) {
   if (dump_passes) {
     LOG(INFO) << Dumpable<CumulativeLogger>(compiler_phases_timings);
   }
+  if (!stats_json_filename.empty() &&
+      !dex2oat->WriteStatsJson(stats_json_filename, timings, *compiler.get())) {
+    return EXIT_FAILURE;
+  }
 
   // Everything was successfully written, do an explicit exit here to avoid running Runtime
   // destructors that take time (bug 10645725) unless we're a debug build or running on valgrind.
@@ -701,6 +701,8 @@ DISASSEMBLER_ENTRY(cmp,
       case 0xB1: opcode << "cmpxchg"; has_modrm = true; store = true; break;
       case 0xB6: opcode << "movzxb"; has_modrm = true; load = true; break;
       case 0xB7: opcode << "movzxw"; has_modrm = true; load = true; break;
+      case 0xBC: opcode << "bsf"; has_modrm = true; load = true; break;
+      case 0xBD: opcode << "bsr"; has_modrm = true; load = true; break;
       case 0xBE: opcode << "movsxb"; has_modrm = true; load = true; break;
       case 0xBF: opcode << "movsxw"; has_modrm = true; load = true; break;
       case 0xC5:
@@ -16,12 +16,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "atomic.h"
 #include "base/stringpiece.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
@@ -40,6 +44,7 @@
 #include "mirror/art_method-inl.h"
 #include "mirror/array-inl.h"
 #include "mirror/class-inl.h"
+#include "mirror/iftable-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
 #include "noop_compiler_callbacks.h"
@@ -50,6 +55,7 @@
 #include "runtime.h"
 #include "safe_map.h"
 #include "scoped_thread_state_change.h"
+#include "stack_map.h"
 #include "thread_list.h"
 #include "verifier/dex_gc_map.h"
 #include "verifier/method_verifier.h"
@@ -91,6 +97,19 @@ static void usage() {
           "    Example: --dump:raw_gc_map\n"
           "    Default: neither\n"
           "\n");
+  fprintf(stderr,
+          "  --stats[=<n>]: instead of dumping the --oat-file, print where its code size goes:\n"
+          "      code and table bytes, deduplication, spills, safepoints by kind of check\n"
+          "      and the <n> biggest methods and classes.\n"
+          "      Example: --stats=50\n"
+          "      Default: 20\n"
+          "\n");
+  fprintf(stderr,
+          "  -j<number-of-threads>: the threads dumping the classes of the --oat-file.\n"
+          "      The output does not depend on it.\n"
+          "      Example: -j1\n"
+          "      Default: the number of processors\n"
+          "\n");
   exit(EXIT_FAILURE);
 }
 
@@ -107,11 +126,15 @@ const char* image_roots_descriptions_[] = {
 
 class OatDumper {
  public:
-  explicit OatDumper(const OatFile& oat_file, bool dump_raw_mapping_table, bool dump_raw_gc_map)
+  // The classes are dumped on `thread_count` threads when there is no runtime, which the
+  // verifier output needs.
+  explicit OatDumper(const OatFile& oat_file, bool dump_raw_mapping_table, bool dump_raw_gc_map,
+                     size_t thread_count = 1)
     : oat_file_(oat_file),
       oat_dex_files_(oat_file.GetOatDexFiles()),
       dump_raw_mapping_table_(dump_raw_mapping_table),
       dump_raw_gc_map_(dump_raw_gc_map),
+      thread_count_(thread_count),
       disassembler_(Disassembler::Create(oat_file_.GetOatHeader().GetInstructionSet())) {
     AddAllOffsets();
   }
@@ -191,6 +214,51 @@ class OatDumper {
     }
   }
 
+  // Prints where the code size of the oat file goes, aggregated over all the compiled methods,
+  // with the `top_count` biggest methods and classes.
+  void DumpStats(std::ostream& os, size_t top_count) {
+    CodeStats stats;
+    for (const OatFile::OatDexFile* oat_dex_file : oat_dex_files_) {
+      std::string error_msg;
+      std::unique_ptr<const DexFile> dex_file(oat_dex_file->OpenDexFile(&error_msg));
+      if (dex_file.get() == nullptr) {
+        os << "NOT FOUND: " << oat_dex_file->GetDexFileLocation() << ": " << error_msg << "\n";
+        continue;
+      }
+      for (size_t class_def_index = 0;
+           class_def_index < dex_file->NumClassDefs();
+           class_def_index++) {
+        const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
+        const OatFile::OatClass oat_class = oat_dex_file->GetOatClass(class_def_index);
+        const byte* class_data = dex_file->GetClassData(class_def);
+        if (class_data == nullptr) {
+          continue;
+        }
+        size_t class_code_bytes = 0;
+        ClassDataItemIterator it(*dex_file, class_data);
+        SkipAllFields(it);
+        uint32_t class_method_index = 0;
+        while (it.HasNextDirectMethod()) {
+          class_code_bytes += AddMethodStats(&stats, *dex_file, it.GetMemberIndex(),
+                                             it.GetMethodCodeItem(),
+                                             oat_class.GetOatMethod(class_method_index++));
+          it.Next();
+        }
+        while (it.HasNextVirtualMethod()) {
+          class_code_bytes += AddMethodStats(&stats, *dex_file, it.GetMemberIndex(),
+                                             it.GetMethodCodeItem(),
+                                             oat_class.GetOatMethod(class_method_index++));
+          it.Next();
+        }
+        if (class_code_bytes != 0) {
+          stats.classes.push_back(
+              std::make_pair(class_code_bytes, dex_file->GetClassDescriptor(class_def)));
+        }
+      }
+    }
+    stats.Dump(os, oat_file_.Size(), top_count);
+  }
+
   size_t ComputeSize(const void* oat_data) {
     if (reinterpret_cast<const byte*>(oat_data) < oat_file_.Begin() ||
         reinterpret_cast<const byte*>(oat_data) > oat_file_.End()) {
@@ -288,6 +356,253 @@ class OatDumper {
     offsets_.insert(oat_method.GetNativeGcMapOffset());
   }
 
+  // What a safepoint of a compiled method is for, from the dex instruction it maps to.
+  enum SafepointKind {
+    kSafepointCall,          // Invokes.
+    kSafepointSuspendCheck,  // Branches, switches and returns.
+    kSafepointAccessCheck,   // Instance field and array accesses and monitors: null checks, and
+                             // the bounds checks of arrays.
+    kSafepointRuntimeCall,   // The other instructions calling the runtime or throwing.
+    kNumSafepointKinds
+  };
+
+  static SafepointKind GetSafepointKind(Instruction::Code opcode) {
+    const int flags = Instruction::FlagsOf(opcode);
+    if ((flags & Instruction::kInvoke) != 0) {
+      return kSafepointCall;
+    }
+    if ((flags & (Instruction::kBranch | Instruction::kSwitch | Instruction::kReturn)) != 0) {
+      return kSafepointSuspendCheck;
+    }
+    const Instruction::Format format = Instruction::FormatOf(opcode);
+    if ((flags & (Instruction::kLoad | Instruction::kStore)) != 0 &&
+        (format == Instruction::k22c || format == Instruction::k23x)) {
+      return kSafepointAccessCheck;
+    }
+    switch (opcode) {
+      case Instruction::ARRAY_LENGTH:
+      case Instruction::MONITOR_ENTER:
+      case Instruction::MONITOR_EXIT:
+      case Instruction::FILL_ARRAY_DATA:
+        return kSafepointAccessCheck;
+      default:
+        return kSafepointRuntimeCall;
+    }
+  }
+
+  struct CodeStats {
+    CodeStats()
+        : compiled_methods(0),
+          code_bytes(0),
+          code_bytes_ignoring_deduplication(0),
+          dex_instruction_bytes(0),
+          mapping_table_bytes(0),
+          mapping_table_bytes_ignoring_deduplication(0),
+          vmap_table_bytes(0),
+          vmap_table_bytes_ignoring_deduplication(0),
+          gc_map_bytes(0),
+          gc_map_bytes_ignoring_deduplication(0),
+          stack_map_bytes(0),
+          stack_map_bytes_ignoring_deduplication(0),
+          frame_bytes(0),
+          core_spills(0),
+          fp_spills(0),
+          methods_with_spills(0) {
+      std::fill_n(safepoints, arraysize(safepoints), 0u);
+    }
+
+    // Adds the size of the data at `offset` the first time it is seen, returns its size.
+    static size_t AddDeduplicated(std::set<uint32_t>* seen, uint32_t offset, size_t bytes,
+                                  size_t* total, size_t* total_ignoring_deduplication) {
+      if (offset == 0) {
+        return 0;
+      }
+      if (seen->insert(offset).second) {
+        *total += bytes;
+      }
+      *total_ignoring_deduplication += bytes;
+      return bytes;
+    }
+
+    static double Percent(size_t x, size_t y) {
+      return y == 0 ? 0.0 : 100.0 * static_cast<double>(x) / static_cast<double>(y);
+    }
+
+    static double Ratio(size_t x, size_t y) {
+      return y == 0 ? 0.0 : static_cast<double>(x) / static_cast<double>(y);
+    }
+
+    static void DumpTop(std::ostream& os, const char* title,
+                        std::vector<std::pair<size_t, std::string>>* sizes, size_t top_count,
+                        size_t total) {
+      const size_t count = std::min(top_count, sizes->size());
+      std::partial_sort(sizes->begin(), sizes->begin() + count, sizes->end(),
+                        std::greater<std::pair<size_t, std::string>>());
+      os << StringPrintf("%zd biggest %s:\n", count, title);
+      for (size_t i = 0; i < count; ++i) {
+        os << StringPrintf("%8zd (%4.1f%% of code_bytes) %s\n", (*sizes)[i].first,
+                           Percent((*sizes)[i].first, total), (*sizes)[i].second.c_str());
+      }
+      os << "\n";
+    }
+
+    void Dump(std::ostream& os, size_t oat_file_bytes, size_t top_count) {
+      os << StringPrintf("oat_file_bytes   = %8zd\n"
+                         "compiled_methods = %8zd\n\n",
+                         oat_file_bytes, compiled_methods);
+      os << StringPrintf("code_bytes             = %8zd (%2.0f%% of oat file bytes)\n"
+                         "mapping_table_bytes    = %8zd (%2.0f%% of oat file bytes)\n"
+                         "vmap_table_bytes       = %8zd (%2.0f%% of oat file bytes)\n"
+                         "gc_map_bytes           = %8zd (%2.0f%% of oat file bytes)\n"
+                         "stack_map_bytes        = %8zd (%2.0f%% of oat file bytes)\n\n",
+                         code_bytes, Percent(code_bytes, oat_file_bytes),
+                         mapping_table_bytes, Percent(mapping_table_bytes, oat_file_bytes),
+                         vmap_table_bytes, Percent(vmap_table_bytes, oat_file_bytes),
+                         gc_map_bytes, Percent(gc_map_bytes, oat_file_bytes),
+                         stack_map_bytes, Percent(stack_map_bytes, oat_file_bytes));
+      // How many bytes the methods would take without sharing identical code and tables.
+      os << StringPrintf("deduplication ratios (bytes ignoring deduplication / bytes):\n"
+                         "  code          %5.2f\n"
+                         "  mapping_table %5.2f\n"
+                         "  vmap_table    %5.2f\n"
+                         "  gc_map        %5.2f\n"
+                         "  stack_map     %5.2f\n\n",
+                         Ratio(code_bytes_ignoring_deduplication, code_bytes),
+                         Ratio(mapping_table_bytes_ignoring_deduplication, mapping_table_bytes),
+                         Ratio(vmap_table_bytes_ignoring_deduplication, vmap_table_bytes),
+                         Ratio(gc_map_bytes_ignoring_deduplication, gc_map_bytes),
+                         Ratio(stack_map_bytes_ignoring_deduplication, stack_map_bytes));
+      os << StringPrintf("dex_instruction_bytes = %zd\n"
+                         "code_bytes expansion = %.2f (ignoring deduplication %.2f)\n"
+                         "average code_bytes per method = %.1f\n\n",
+                         dex_instruction_bytes,
+                         Ratio(code_bytes, dex_instruction_bytes),
+                         Ratio(code_bytes_ignoring_deduplication, dex_instruction_bytes),
+                         Ratio(code_bytes_ignoring_deduplication, compiled_methods));
+      os << StringPrintf("methods_with_spills = %zd (%2.0f%% of compiled methods)\n"
+                         "core_spills = %zd (%.2f per method)\n"
+                         "fp_spills = %zd (%.2f per method)\n"
+                         "average frame_size_in_bytes = %.1f\n\n",
+                         methods_with_spills, Percent(methods_with_spills, compiled_methods),
+                         core_spills, Ratio(core_spills, compiled_methods),
+                         fp_spills, Ratio(fp_spills, compiled_methods),
+                         Ratio(frame_bytes, compiled_methods));
+      // The oat file does not tell the code of the checks and slow paths apart from the rest,
+      // their safepoints tell how many of them there are.
+      size_t total_safepoints = 0;
+      for (size_t count : safepoints) {
+        total_safepoints += count;
+      }
+      os << StringPrintf("safepoints = %zd (%.2f per method)\n"
+                         "  calls          = %8zd (%2.0f%%)\n"
+                         "  suspend_checks = %8zd (%2.0f%%)\n"
+                         "  access_checks  = %8zd (%2.0f%%) null and bounds checks, monitors\n"
+                         "  runtime_calls  = %8zd (%2.0f%%) other slow paths\n\n",
+                         total_safepoints, Ratio(total_safepoints, compiled_methods),
+                         safepoints[kSafepointCall],
+                         Percent(safepoints[kSafepointCall], total_safepoints),
+                         safepoints[kSafepointSuspendCheck],
+                         Percent(safepoints[kSafepointSuspendCheck], total_safepoints),
+                         safepoints[kSafepointAccessCheck],
+                         Percent(safepoints[kSafepointAccessCheck], total_safepoints),
+                         safepoints[kSafepointRuntimeCall],
+                         Percent(safepoints[kSafepointRuntimeCall], total_safepoints));
+      DumpTop(os, "methods", &methods, top_count, code_bytes_ignoring_deduplication);
+      DumpTop(os, "classes", &classes, top_count, code_bytes_ignoring_deduplication);
+      os << std::flush;
+    }
+
+    size_t compiled_methods;
+    size_t code_bytes;
+    size_t code_bytes_ignoring_deduplication;
+    size_t dex_instruction_bytes;
+    size_t mapping_table_bytes;
+    size_t mapping_table_bytes_ignoring_deduplication;
+    size_t vmap_table_bytes;
+    size_t vmap_table_bytes_ignoring_deduplication;
+    size_t gc_map_bytes;
+    size_t gc_map_bytes_ignoring_deduplication;
+    size_t stack_map_bytes;
+    size_t stack_map_bytes_ignoring_deduplication;
+    size_t frame_bytes;
+    size_t core_spills;
+    size_t fp_spills;
+    size_t methods_with_spills;
+    size_t safepoints[kNumSafepointKinds];
+    std::set<uint32_t> seen_code;
+    std::set<uint32_t> seen_mapping_tables;
+    std::set<uint32_t> seen_vmap_tables;
+    std::set<uint32_t> seen_gc_maps;
+    // Code bytes and names of the methods and classes, ignoring deduplication.
+    std::vector<std::pair<size_t, std::string>> methods;
+    std::vector<std::pair<size_t, std::string>> classes;
+  };
+
+  // Adds the method to the stats if it was compiled, returns its code bytes.
+  size_t AddMethodStats(CodeStats* stats, const DexFile& dex_file, uint32_t dex_method_idx,
+                        const DexFile::CodeItem* code_item, const OatFile::OatMethod& oat_method) {
+    uint32_t code_size = oat_method.GetQuickCodeSize();
+    if (oat_method.GetQuickCode() == nullptr) {
+      code_size = oat_method.GetPortableCodeSize();
+    }
+    if (code_size == 0) {
+      return 0;
+    }
+    ++stats->compiled_methods;
+    CodeStats::AddDeduplicated(&stats->seen_code, oat_method.GetCodeOffset(), code_size,
+                               &stats->code_bytes, &stats->code_bytes_ignoring_deduplication);
+    if (code_item != nullptr) {
+      stats->dex_instruction_bytes += code_item->insns_size_in_code_units_ * 2;
+    }
+    stats->frame_bytes += oat_method.GetFrameSizeInBytes();
+    const size_t core_spills = POPCOUNT(oat_method.GetCoreSpillMask());
+    const size_t fp_spills = POPCOUNT(oat_method.GetFpSpillMask());
+    stats->core_spills += core_spills;
+    stats->fp_spills += fp_spills;
+    // The return address is part of the core spill mask.
+    if (core_spills > 1 || fp_spills != 0) {
+      ++stats->methods_with_spills;
+    }
+
+    std::vector<uint32_t> safepoint_dex_pcs;
+    if (oat_method.HasStackMaps()) {
+      const CodeInfo code_info(oat_method.GetVmapTable());
+      CodeStats::AddDeduplicated(&stats->seen_vmap_tables, oat_method.GetVmapTableOffset(),
+                                 code_info.GetSizeInBytes(), &stats->stack_map_bytes,
+                                 &stats->stack_map_bytes_ignoring_deduplication);
+      for (size_t i = 0; i < code_info.GetNumberOfStackMaps(); ++i) {
+        safepoint_dex_pcs.push_back(code_info.GetStackMapAt(i).GetDexPc());
+      }
+    } else {
+      CodeStats::AddDeduplicated(&stats->seen_mapping_tables, oat_method.GetMappingTableOffset(),
+                                 ComputeSize(oat_method.GetMappingTable()),
+                                 &stats->mapping_table_bytes,
+                                 &stats->mapping_table_bytes_ignoring_deduplication);
+      CodeStats::AddDeduplicated(&stats->seen_vmap_tables, oat_method.GetVmapTableOffset(),
+                                 ComputeSize(oat_method.GetVmapTable()), &stats->vmap_table_bytes,
+                                 &stats->vmap_table_bytes_ignoring_deduplication);
+      CodeStats::AddDeduplicated(&stats->seen_gc_maps, oat_method.GetNativeGcMapOffset(),
+                                 ComputeSize(oat_method.GetNativeGcMap()), &stats->gc_map_bytes,
+                                 &stats->gc_map_bytes_ignoring_deduplication);
+      if (oat_method.GetMappingTable() != nullptr) {
+        MappingTable table(oat_method.GetMappingTable());
+        for (auto it = table.PcToDexBegin(), end = table.PcToDexEnd(); it != end; ++it) {
+          safepoint_dex_pcs.push_back(it.DexPc());
+        }
+      }
+    }
+    if (code_item != nullptr) {
+      for (uint32_t dex_pc : safepoint_dex_pcs) {
+        if (dex_pc < code_item->insns_size_in_code_units_) {
+          const Instruction* inst = Instruction::At(&code_item->insns_[dex_pc]);
+          ++stats->safepoints[GetSafepointKind(inst->Opcode())];
+        }
+      }
+    }
+    stats->methods.push_back(std::make_pair(code_size, PrettyMethod(dex_method_idx, dex_file)));
+    return code_size;
+  }
+
   void DumpOatDexFile(std::ostream& os, const OatFile::OatDexFile& oat_dex_file) {
     os << "OAT DEX FILE:\n";
     os << StringPrintf("location: %s\n", oat_dex_file.GetDexFileLocation().c_str());
@@ -301,24 +616,108 @@ class OatDumper {
       os << "NOT FOUND: " << error_msg << "\n\n";
       return;
     }
-    for (size_t class_def_index = 0;
-         class_def_index < dex_file->NumClassDefs();
-         class_def_index++) {
-      const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
-      const char* descriptor = dex_file->GetClassDescriptor(class_def);
-      const OatFile::OatClass oat_class = oat_dex_file.GetOatClass(class_def_index);
-      os << StringPrintf("%zd: %s (type_idx=%d)", class_def_index, descriptor, class_def.class_idx_)
-         << " (" << oat_class.GetStatus() << ")"
-         << " (" << oat_class.GetType() << ")\n";
-      // TODO: include bitmap here if type is kOatClassSomeCompiled?
-      Indenter indent_filter(os.rdbuf(), kIndentChar, kIndentBy1Count);
-      std::ostream indented_os(&indent_filter);
-      DumpOatClass(indented_os, oat_class, *(dex_file.get()), class_def);
+    if (thread_count_ > 1 && Runtime::Current() == nullptr) {
+      const size_t num_classes = dex_file->NumClassDefs();
+      const size_t batch_size = kClassesPerThreadInBatch * thread_count_;
+      for (size_t begin = 0; begin < num_classes; begin += batch_size) {
+        ParallelClassDumper dumper(this, oat_dex_file, *dex_file,
+                                   begin, std::min(num_classes, begin + batch_size));
+        dumper.Run(thread_count_);
+        dumper.Write(os);
+      }
+    } else {
+      for (size_t class_def_index = 0;
+           class_def_index < dex_file->NumClassDefs();
+           class_def_index++) {
+        DumpClass(os, disassembler_.get(), oat_dex_file, *dex_file, class_def_index);
+      }
     }
 
     os << std::flush;
   }
 
+  void DumpClass(std::ostream& os, Disassembler* disassembler,
+                 const OatFile::OatDexFile& oat_dex_file, const DexFile& dex_file,
+                 size_t class_def_index) {
+    const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
+    const char* descriptor = dex_file.GetClassDescriptor(class_def);
+    const OatFile::OatClass oat_class = oat_dex_file.GetOatClass(class_def_index);
+    os << StringPrintf("%zd: %s (type_idx=%d)", class_def_index, descriptor, class_def.class_idx_)
+       << " (" << oat_class.GetStatus() << ")"
+       << " (" << oat_class.GetType() << ")\n";
+    // TODO: include bitmap here if type is kOatClassSomeCompiled?
+    Indenter indent_filter(os.rdbuf(), kIndentChar, kIndentBy1Count);
+    std::ostream indented_os(&indent_filter);
+    DumpOatClass(indented_os, disassembler, oat_class, dex_file, class_def);
+  }
+
+  // The classes dumped at once by each thread, their output is buffered until the whole batch
+  // is written.
+  static constexpr size_t kClassesPerThreadInBatch = 64;
+
+  // Dumps a batch of classes on a few threads, each thread taking the next class that is left
+  // and dumping it to its own buffer with its own disassembler. The buffers are written in the
+  // order of the class defs, so the output is the same as with a single thread.
+  class ParallelClassDumper {
+   public:
+    ParallelClassDumper(OatDumper* dumper, const OatFile::OatDexFile& oat_dex_file,
+                        const DexFile& dex_file, size_t begin, size_t end)
+        : dumper_(dumper),
+          oat_dex_file_(oat_dex_file),
+          dex_file_(dex_file),
+          begin_(begin),
+          next_(begin),
+          dumps_(end - begin) {
+    }
+
+    // Dumps the classes, using the calling thread and thread_count - 1 new threads.
+    void Run(size_t thread_count) {
+      std::vector<pthread_t> threads(std::min(thread_count, dumps_.size()) - 1);
+      for (pthread_t& thread : threads) {
+        CHECK_PTHREAD_CALL(pthread_create, (&thread, nullptr, &Callback, this), "class dumper");
+      }
+      DumpClasses();
+      for (pthread_t& thread : threads) {
+        CHECK_PTHREAD_CALL(pthread_join, (thread, nullptr), "class dumper");
+      }
+    }
+
+    void Write(std::ostream& os) {
+      for (const std::string& dump : dumps_) {
+        os.write(dump.data(), dump.size());
+      }
+    }
+
+   private:
+    static void* Callback(void* arg) {
+      ::art::SetThreadName("oatdump class dumper");
+      reinterpret_cast<ParallelClassDumper*>(arg)->DumpClasses();
+      return nullptr;
+    }
+
+    void DumpClasses() {
+      // The disassemblers keep state between instructions, such as the ARM IT blocks.
+      std::unique_ptr<Disassembler> disassembler(
+          Disassembler::Create(dumper_->oat_file_.GetOatHeader().GetInstructionSet()));
+      for (size_t i = next_.FetchAndAddSequentiallyConsistent(1); i < begin_ + dumps_.size();
+           i = next_.FetchAndAddSequentiallyConsistent(1)) {
+        std::ostringstream os;
+        dumper_->DumpClass(os, disassembler.get(), oat_dex_file_, dex_file_, i);
+        dumps_[i - begin_] = os.str();
+      }
+    }
+
+    OatDumper* const dumper_;
+    const OatFile::OatDexFile& oat_dex_file_;
+    const DexFile& dex_file_;
+    const size_t begin_;
+    Atomic<size_t> next_;
+    // Each element is only written by the thread dumping the class.
+    std::vector<std::string> dumps_;
+
+    DISALLOW_COPY_AND_ASSIGN(ParallelClassDumper);
+  };
+
   static void SkipAllFields(ClassDataItemIterator& it) {
     while (it.HasNextStaticField()) {
       it.Next();
@@ -328,7 +727,8 @@ class OatDumper {
     }
   }
 
-  void DumpOatClass(std::ostream& os, const OatFile::OatClass& oat_class, const DexFile& dex_file,
+  void DumpOatClass(std::ostream& os, Disassembler* disassembler,
+                    const OatFile::OatClass& oat_class, const DexFile& dex_file,
                     const DexFile::ClassDef& class_def) {
     const byte* class_data = dex_file.GetClassData(class_def);
     if (class_data == NULL) {  // empty class such as a marker interface?
@@ -339,14 +739,14 @@ class OatDumper {
     uint32_t class_method_idx = 0;
     while (it.HasNextDirectMethod()) {
       const OatFile::OatMethod oat_method = oat_class.GetOatMethod(class_method_idx);
-      DumpOatMethod(os, class_def, class_method_idx, oat_method, dex_file,
+      DumpOatMethod(os, disassembler, class_def, class_method_idx, oat_method, dex_file,
                     it.GetMemberIndex(), it.GetMethodCodeItem(), it.GetMemberAccessFlags());
       class_method_idx++;
       it.Next();
     }
     while (it.HasNextVirtualMethod()) {
       const OatFile::OatMethod oat_method = oat_class.GetOatMethod(class_method_idx);
-      DumpOatMethod(os, class_def, class_method_idx, oat_method, dex_file,
+      DumpOatMethod(os, disassembler, class_def, class_method_idx, oat_method, dex_file,
                     it.GetMemberIndex(), it.GetMethodCodeItem(), it.GetMemberAccessFlags());
       class_method_idx++;
       it.Next();
@@ -355,7 +755,8 @@ class OatDumper {
     os << std::flush;
   }
 
-  void DumpOatMethod(std::ostream& os, const DexFile::ClassDef& class_def,
+  void DumpOatMethod(std::ostream& os, Disassembler* disassembler,
+                     const DexFile::ClassDef& class_def,
                      uint32_t class_method_index,
                      const OatFile::OatMethod& oat_method, const DexFile& dex_file,
                      uint32_t dex_method_idx, const DexFile::CodeItem* code_item,
@@ -384,22 +785,35 @@ class OatDumper {
       DumpSpillMask(*indent2_os, oat_method.GetCoreSpillMask(), false);
       *indent2_os << StringPrintf("\nfp_spill_mask: 0x%08x ", oat_method.GetFpSpillMask());
       DumpSpillMask(*indent2_os, oat_method.GetFpSpillMask(), true);
-      *indent2_os << StringPrintf("\nvmap_table: %p (offset=0x%08x)\n",
-                                  oat_method.GetVmapTable(), oat_method.GetVmapTableOffset());
-      DumpVmap(*indent2_os, oat_method);
-      *indent2_os << StringPrintf("mapping_table: %p (offset=0x%08x)\n",
-                                  oat_method.GetMappingTable(), oat_method.GetMappingTableOffset());
-      if (dump_raw_mapping_table_) {
-        Indenter indent3_filter(indent2_os->rdbuf(), kIndentChar, kIndentBy1Count);
-        std::ostream indent3_os(&indent3_filter);
-        DumpMappingTable(indent3_os, oat_method);
-      }
-      *indent2_os << StringPrintf("gc_map: %p (offset=0x%08x)\n",
-                                  oat_method.GetNativeGcMap(), oat_method.GetNativeGcMapOffset());
-      if (dump_raw_gc_map_) {
-        Indenter indent3_filter(indent2_os->rdbuf(), kIndentChar, kIndentBy1Count);
-        std::ostream indent3_os(&indent3_filter);
-        DumpGcMap(indent3_os, oat_method, code_item);
+      if (oat_method.HasStackMaps()) {
+        // The stack maps replace the vmap, mapping and GC map tables of optimized methods.
+        *indent2_os << StringPrintf("\nstack_maps: %p (offset=0x%08x)\n",
+                                    oat_method.GetVmapTable(), oat_method.GetVmapTableOffset());
+        if (dump_raw_mapping_table_) {
+          Indenter indent3_filter(indent2_os->rdbuf(), kIndentChar, kIndentBy1Count);
+          std::ostream indent3_os(&indent3_filter);
+          DumpStackMaps(indent3_os, oat_method);
+        }
+      } else {
+        *indent2_os << StringPrintf("\nvmap_table: %p (offset=0x%08x)\n",
+                                    oat_method.GetVmapTable(), oat_method.GetVmapTableOffset());
+        DumpVmap(*indent2_os, oat_method);
+        *indent2_os << StringPrintf("mapping_table: %p (offset=0x%08x)\n",
+                                    oat_method.GetMappingTable(),
+                                    oat_method.GetMappingTableOffset());
+        if (dump_raw_mapping_table_) {
+          Indenter indent3_filter(indent2_os->rdbuf(), kIndentChar, kIndentBy1Count);
+          std::ostream indent3_os(&indent3_filter);
+          DumpMappingTable(indent3_os, oat_method);
+        }
+        *indent2_os << StringPrintf("gc_map: %p (offset=0x%08x)\n",
+                                    oat_method.GetNativeGcMap(),
+                                    oat_method.GetNativeGcMapOffset());
+        if (dump_raw_gc_map_) {
+          Indenter indent3_filter(indent2_os->rdbuf(), kIndentChar, kIndentBy1Count);
+          std::ostream indent3_os(&indent3_filter);
+          DumpGcMap(indent3_os, oat_method, code_item);
+        }
       }
     }
     {
@@ -426,9 +840,9 @@ class OatDumper {
                                           code_item, dex_method_idx, nullptr, method_access_flags,
                                           true, true, true);
         verifier.Verify();
-        DumpCode(*indent2_os, &verifier, oat_method, code_item);
+        DumpCode(*indent2_os, disassembler, &verifier, oat_method, code_item);
       } else {
-        DumpCode(*indent2_os, nullptr, oat_method, code_item);
+        DumpCode(*indent2_os, disassembler, nullptr, oat_method, code_item);
       }
     }
   }
@@ -555,6 +969,24 @@ class OatDumper {
     }
   }
 
+  void DumpStackMaps(std::ostream& os, const OatFile::OatMethod& oat_method) {
+    const CodeInfo code_info(oat_method.GetVmapTable());
+    os << "size=" << code_info.GetSizeInBytes()
+       << " dex_registers=" << code_info.GetNumberOfDexRegisters() << "\n";
+    Indenter indent_filter(os.rdbuf(), kIndentChar, kIndentBy1Count);
+    std::ostream indent_os(&indent_filter);
+    for (size_t i = 0; i < code_info.GetNumberOfStackMaps(); ++i) {
+      const StackMap stack_map = code_info.GetStackMapAt(i);
+      indent_os << StringPrintf("0x%04x -> 0x%04x register_mask=0x%08x stack_mask=",
+                                stack_map.GetNativePcOffset(), stack_map.GetDexPc(),
+                                stack_map.GetRegisterMask());
+      for (size_t slot = 0; slot < stack_map.GetNumberOfStackMaskBits(); ++slot) {
+        indent_os << (stack_map.IsStackSlotReference(slot) ? "1" : "0");
+      }
+      indent_os << "\n";
+    }
+  }
+
   void DumpMappingTable(std::ostream& os, const OatFile::OatMethod& oat_method) {
     const void* quick_code = oat_method.GetQuickCode();
     if (quick_code == nullptr) {
@@ -699,7 +1131,7 @@ class OatDumper {
     }
   }
 
-  void DumpCode(std::ostream& os, verifier::MethodVerifier* verifier,
+  void DumpCode(std::ostream& os, Disassembler* disassembler, verifier::MethodVerifier* verifier,
                 const OatFile::OatMethod& oat_method, const DexFile::CodeItem* code_item) {
     const void* portable_code = oat_method.GetPortableCode();
     const void* quick_code = oat_method.GetQuickCode();
@@ -713,7 +1145,7 @@ class OatDumper {
       size_t offset = 0;
       while (offset < code_size) {
         DumpMappingAtOffset(os, oat_method, offset, false);
-        offset += disassembler_->Dump(os, quick_native_pc + offset);
+        offset += disassembler->Dump(os, quick_native_pc + offset);
         uint32_t dex_pc = DumpMappingAtOffset(os, oat_method, offset, true);
         if (dex_pc != DexFile::kDexNoIndex) {
           DumpGcMapAtNativePcOffset(os, oat_method, code_item, offset);
@@ -732,6 +1164,7 @@ class OatDumper {
   std::vector<const OatFile::OatDexFile*> oat_dex_files_;
   bool dump_raw_mapping_table_;
   bool dump_raw_gc_map_;
+  const size_t thread_count_;
   std::set<uintptr_t> offsets_;
   std::unique_ptr<Disassembler> disassembler_;
 };
@@ -754,8 +1187,19 @@ class ImageDumper {
     os << "IMAGE BITMAP OFFSET: " << reinterpret_cast<void*>(image_header_.GetImageBitmapOffset())
        << " SIZE: " << reinterpret_cast<void*>(image_header_.GetImageBitmapSize()) << "\n\n";
 
+    os << "RELOCATIONS OFFSET: " << reinterpret_cast<void*>(image_header_.GetRelocationsOffset())
+       << " SIZE: " << reinterpret_cast<void*>(image_header_.GetRelocationsSize())
+       << " OAT RELOCATIONS: " << image_header_.GetOatRelocationsCount() << "\n\n";
+
+    os << "PATCH DELTA: " << image_header_.GetPatchDelta() << "\n\n";
+
     os << "OAT CHECKSUM: " << StringPrintf("0x%08x\n\n", image_header_.GetOatChecksum());
 
+    if (image_header_.IsAppImage()) {
+      os << "BOOT OAT CHECKSUM: "
+         << StringPrintf("0x%08x\n\n", image_header_.GetBootOatChecksum());
+    }
+
     os << "OAT FILE BEGIN:" << reinterpret_cast<void*>(image_header_.GetOatFileBegin()) << "\n\n";
 
     os << "OAT DATA BEGIN:" << reinterpret_cast<void*>(image_header_.GetOatDataBegin()) << "\n\n";
@@ -989,7 +1433,7 @@ class ImageDumper {
     if (oat_code_begin == nullptr) {
       return 0;
     }
-    return oat_code_begin[-1];
+    return oat_code_begin[-1] & ~OatQuickMethodHeader::kHasStackMapsFlag;
   }
 
   const void* GetQuickOatCodeEnd(mirror::ArtMethod* m)
@@ -1063,6 +1507,8 @@ class ImageDumper {
         PrettyObjectValue(indent_os, value_class, value);
       }
     } else if (obj->IsClass()) {
+      state->stats_.UpdateImt(obj->AsClass(),
+          state->image_header_.GetImageRoot(ImageHeader::kImtConflictMethod)->AsArtMethod());
       mirror::ObjectArray<mirror::ArtField>* sfields = obj->AsClass()->GetSFields();
       if (sfields != NULL) {
         indent_os << "STATICS:\n";
@@ -1188,6 +1634,12 @@ class ImageDumper {
 
     size_t dex_instruction_bytes;
 
+    // The interface method tables of the classes implementing interfaces.
+    size_t imt_classes;
+    size_t imt_conflict_slots;
+    size_t imt_interface_methods;
+    size_t imt_conflict_interface_methods;
+
     std::vector<mirror::ArtMethod*> method_outlier;
     std::vector<size_t> method_outlier_size;
     std::vector<double> method_outlier_expansion;
@@ -1210,7 +1662,11 @@ class ImageDumper {
           gc_map_bytes(0),
           pc_mapping_table_bytes(0),
           vmap_table_bytes(0),
-          dex_instruction_bytes(0) {}
+          dex_instruction_bytes(0),
+          imt_classes(0),
+          imt_conflict_slots(0),
+          imt_interface_methods(0),
+          imt_conflict_interface_methods(0) {}
 
     struct SizeAndCount {
       SizeAndCount(size_t bytes, size_t count) : bytes(bytes), count(count) {}
@@ -1230,6 +1686,34 @@ class ImageDumper {
       }
     }
 
+    // Counts the slots of the interface method table of the class which hold the conflict method,
+    // and the interface methods which are dispatched through it.
+    void UpdateImt(mirror::Class* klass, mirror::ArtMethod* conflict_method)
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+      mirror::ObjectArray<mirror::ArtMethod>* imtable = klass->GetImTable();
+      if (klass->IsInterface() || imtable == nullptr || klass->GetIfTableCount() == 0) {
+        return;
+      }
+      ++imt_classes;
+      for (size_t i = 0; i < ClassLinker::kImtSize; ++i) {
+        if (imtable->Get(i) == conflict_method) {
+          ++imt_conflict_slots;
+        }
+      }
+      mirror::IfTable* iftable = klass->GetIfTable();
+      for (int32_t i = 0; i < klass->GetIfTableCount(); ++i) {
+        mirror::Class* interface = iftable->GetInterface(i);
+        for (size_t j = 0; j < interface->NumVirtualMethods(); ++j) {
+          uint32_t imt_index = interface->GetVirtualMethod(j)->GetDexMethodIndex() %
+              ClassLinker::kImtSize;
+          ++imt_interface_methods;
+          if (imtable->Get(imt_index) == conflict_method) {
+            ++imt_conflict_interface_methods;
+          }
+        }
+      }
+    }
+
     double PercentOfOatBytes(size_t size) {
       return (static_cast<double>(size) / static_cast<double>(oat_file_bytes)) * 100;
     }
@@ -1242,6 +1726,10 @@ class ImageDumper {
       return (static_cast<double>(size) / static_cast<double>(object_bytes)) * 100;
     }
 
+    static double Percent(size_t part, size_t total) {
+      return total == 0 ? 0.0 : (static_cast<double>(part) / static_cast<double>(total)) * 100;
+    }
+
     void ComputeOutliers(size_t total_size, double expansion, mirror::ArtMethod* method) {
       method_outlier_size.push_back(total_size);
       method_outlier_expansion.push_back(expansion);
@@ -1426,6 +1914,17 @@ class ImageDumper {
                              static_cast<double>(dex_instruction_bytes))
          << std::flush;
 
+      os << StringPrintf("imt_size = %zd, %zd classes implement interfaces\n"
+                         "imt_conflict_slots = %zd (%2.0f%% of the slots)\n"
+                         "imt_conflict_methods = %zd (%2.0f%% of %zd interface methods)\n\n",
+                         ClassLinker::kImtSize, imt_classes,
+                         imt_conflict_slots,
+                         Percent(imt_conflict_slots, imt_classes * ClassLinker::kImtSize),
+                         imt_conflict_interface_methods,
+                         Percent(imt_conflict_interface_methods, imt_interface_methods),
+                         imt_interface_methods)
+         << std::flush;
+
       DumpOutliers(os);
     }
   } stats_;
@@ -1470,6 +1969,9 @@ static int oatdump(int argc, char** argv) {
   std::unique_ptr<std::ofstream> out;
   bool dump_raw_mapping_table = false;
   bool dump_raw_gc_map = false;
+  bool dump_stats = false;
+  int stats_top_count = 20;
+  int thread_count = sysconf(_SC_NPROCESSORS_CONF);
 
   for (int i = 0; i < argc; i++) {
     const StringPiece option(argv[i]);
@@ -1501,6 +2003,25 @@ static int oatdump(int argc, char** argv) {
           fprintf(stderr, "Unknown argument %s\n", option.data());
           usage();
         }
+    } else if (option == "--stats") {
+      dump_stats = true;
+    } else if (option.starts_with("--stats=")) {
+      dump_stats = true;
+      const char* top_count = option.substr(strlen("--stats=")).data();
+      char* end;
+      stats_top_count = static_cast<int>(strtol(top_count, &end, 10));
+      if (*top_count == '\0' || *end != '\0' || stats_top_count < 0) {
+        fprintf(stderr, "Failed to parse --stats argument '%s' as a count\n", top_count);
+        usage();
+      }
+    } else if (option.starts_with("-j")) {
+      const char* thread_count_str = option.substr(strlen("-j")).data();
+      char* end;
+      thread_count = static_cast<int>(strtol(thread_count_str, &end, 10));
+      if (*thread_count_str == '\0' || *end != '\0' || thread_count <= 0) {
+        fprintf(stderr, "Failed to parse -j argument '%s' as a thread count\n", thread_count_str);
+        usage();
+      }
     } else if (option.starts_with("--output=")) {
       const char* filename = option.substr(strlen("--output=")).data();
       out.reset(new std::ofstream(filename));
@@ -1525,6 +2046,11 @@ static int oatdump(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  if (dump_stats && oat_filename == NULL) {
+    fprintf(stderr, "--stats requires --oat-file\n");
+    return EXIT_FAILURE;
+  }
+
   if (oat_filename != NULL) {
     std::string error_msg;
     OatFile* oat_file =
@@ -1533,8 +2059,13 @@ static int oatdump(int argc, char** argv) {
       fprintf(stderr, "Failed to open oat file from '%s': %s\n", oat_filename, error_msg.c_str());
       return EXIT_FAILURE;
     }
-    OatDumper oat_dumper(*oat_file, dump_raw_mapping_table, dump_raw_gc_map);
-    oat_dumper.Dump(*os);
+    OatDumper oat_dumper(*oat_file, dump_raw_mapping_table, dump_raw_gc_map,
+                         std::max(thread_count, 1));
+    if (dump_stats) {
+      oat_dumper.DumpStats(*os, stats_top_count);
+    } else {
+      oat_dumper.Dump(*os);
+    }
     return EXIT_SUCCESS;
   }
 
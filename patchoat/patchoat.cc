@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/stringpiece.h"
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "elf_file.h"
+#include "elf_fixup.h"
+#include "image.h"
+#include "oat.h"
+#include "os.h"
+#include "utils.h"
+
+namespace art {
+
+static void UsageErrorV(const char* fmt, va_list ap) {
+  std::string error;
+  StringAppendV(&error, fmt, ap);
+  LOG(ERROR) << error;
+}
+
+static void UsageError(const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  UsageErrorV(fmt, ap);
+  va_end(ap);
+}
+
+static void Usage(const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  UsageErrorV(fmt, ap);
+  va_end(ap);
+
+  UsageError("Usage: patchoat [options]...");
+  UsageError("");
+  UsageError("  --input-image=<file.art>: specifies the boot image to relocate.");
+  UsageError("      Example: --input-image=/system/framework/arm/boot.art");
+  UsageError("");
+  UsageError("  --input-oat=<file.oat>: specifies the oat file of the image. Defaults to the");
+  UsageError("      .oat file next to the input image.");
+  UsageError("");
+  UsageError("  --output-image=<file.art>: specifies the relocated image destination, which may");
+  UsageError("      be the input image.");
+  UsageError("      Example: --output-image=/data/dalvik-cache/arm/system@framework@boot.art");
+  UsageError("");
+  UsageError("  --output-oat=<file.oat>: specifies the relocated oat file destination. Defaults");
+  UsageError("      to the .oat file next to the output image.");
+  UsageError("");
+  UsageError("  --base-offset-delta=<delta>: specifies the page aligned signed number of bytes to");
+  UsageError("      move the image and its oat file by.");
+  UsageError("      Example: --base-offset-delta=-0x200000");
+  UsageError("");
+  std::cerr << "See log for usage error information\n";
+  exit(EXIT_FAILURE);
+}
+
+// Moves a boot image and its oat file by a page aligned delta, using the relocation section
+// written by the ImageWriter, so that a boot image which can't be mapped at its address doesn't
+// need to be compiled again.
+class PatchOat {
+ public:
+  // Relocates input_image and input_oat and writes them to output_image and output_oat, which may
+  // be the same files as the inputs.
+  static bool Patch(const std::string& input_image, const std::string& input_oat,
+                    const std::string& output_image, const std::string& output_oat,
+                    int32_t delta, std::string* error_msg) {
+    std::vector<uint8_t> image;
+    if (!ReadFile(input_image, &image, error_msg)) {
+      return false;
+    }
+    ImageHeader* image_header = reinterpret_cast<ImageHeader*>(image.data());
+    if (image.size() < sizeof(ImageHeader) || !image_header->IsValid()) {
+      *error_msg = StringPrintf("Invalid image header in '%s'", input_image.c_str());
+      return false;
+    }
+    if (image_header->IsAppImage()) {
+      // The references into the boot image would need the delta of the boot image.
+      *error_msg = StringPrintf("'%s' is an app image, which can't be relocated",
+                                input_image.c_str());
+      return false;
+    }
+    if (image_header->GetRelocationsSize() < image_header->GetRelocationBitmapSize() ||
+        image_header->GetRelocationsOffset() + image_header->GetRelocationsSize() > image.size()) {
+      *error_msg = StringPrintf("Image '%s' has no relocations", input_image.c_str());
+      return false;
+    }
+    if (!IsAligned<kPageSize>(delta)) {
+      *error_msg = StringPrintf("Relocation delta %d isn't page aligned", delta);
+      return false;
+    }
+    // The images use 32-bit addresses, the moved image must stay in the low 4GB.
+    const int64_t new_begin =
+        static_cast<int64_t>(PointerToLowMemUInt32(image_header->GetImageBegin())) + delta;
+    const int64_t new_end =
+        static_cast<int64_t>(PointerToLowMemUInt32(image_header->GetOatFileEnd())) + delta;
+    if (new_begin <= 0 || new_end > static_cast<int64_t>(UINT32_MAX)) {
+      *error_msg = StringPrintf("Relocation delta %d moves image '%s' out of the low 4GB", delta,
+                                input_image.c_str());
+      return false;
+    }
+    std::vector<uint8_t> oat;
+    if (!ReadFile(input_oat, &oat, error_msg)) {
+      return false;
+    }
+
+    PatchImage(image.data(), delta);
+    image_header->Relocate(delta);
+    // The oat file is written first, the image refers to it through the updated oat checksum.
+    if (!PatchOatFile(oat, output_oat, image.data(), delta, error_msg)) {
+      return false;
+    }
+    return WriteFile(output_image, image, error_msg);
+  }
+
+ private:
+  // Adds delta to the words of the image marked in the relocation bitmap.
+  static void PatchImage(uint8_t* image, int32_t delta) {
+    const ImageHeader* image_header = reinterpret_cast<const ImageHeader*>(image);
+    const uint32_t* bitmap =
+        reinterpret_cast<const uint32_t*>(image + image_header->GetRelocationsOffset());
+    const size_t bitmap_words = image_header->GetRelocationBitmapSize() / sizeof(uint32_t);
+    uint32_t* words = reinterpret_cast<uint32_t*>(image);
+    for (size_t i = 0; i < bitmap_words; ++i) {
+      for (uint32_t bits = bitmap[i]; bits != 0; bits &= bits - 1) {
+        const size_t word = i * kBitsPerByte * sizeof(uint32_t) + CTZ(bits);
+        DCHECK_LT(word * sizeof(uint32_t), image_header->GetImageSize());
+        words[word] += delta;
+      }
+    }
+  }
+
+  // Writes oat to output_oat moved to the new oat data begin of the image, adds delta to the
+  // addresses the ImageWriter patched into the code and records the new oat checksum in the image.
+  static bool PatchOatFile(const std::vector<uint8_t>& oat, const std::string& output_oat,
+                           uint8_t* image, int32_t delta, std::string* error_msg) {
+    ImageHeader* image_header = reinterpret_cast<ImageHeader*>(image);
+    if (!WriteFile(output_oat, oat, error_msg)) {
+      return false;
+    }
+    std::unique_ptr<File> oat_file(OS::OpenFileReadWrite(output_oat.c_str()));
+    if (oat_file.get() == nullptr) {
+      *error_msg = StringPrintf("Failed to open '%s'", output_oat.c_str());
+      return false;
+    }
+    if (!ElfFixup::Fixup(oat_file.get(), PointerToLowMemUInt32(image_header->GetOatDataBegin()))) {
+      *error_msg = StringPrintf("Failed to move the ELF addresses of '%s'", output_oat.c_str());
+      return false;
+    }
+    std::unique_ptr<ElfFile> elf_file(ElfFile::Open(oat_file.get(), true, false, error_msg));
+    if (elf_file.get() == nullptr) {
+      return false;
+    }
+    OatHeader* oat_header = FindOatHeader(elf_file.get(), image_header->GetOatDataBegin());
+    if (oat_header == nullptr || !oat_header->IsValid()) {
+      *error_msg = StringPrintf("Failed to find the oat header of '%s'", output_oat.c_str());
+      return false;
+    }
+    const uint32_t* oat_relocations = reinterpret_cast<const uint32_t*>(
+        image + image_header->GetRelocationsOffset() + image_header->GetRelocationBitmapSize());
+    uint8_t* oat_data = reinterpret_cast<uint8_t*>(oat_header);
+    for (size_t i = 0; i < image_header->GetOatRelocationsCount(); ++i) {
+      if (oat_data + oat_relocations[i] + sizeof(uint32_t) > elf_file->End()) {
+        *error_msg = StringPrintf("Oat relocation 0x%x is out of '%s'", oat_relocations[i],
+                                  output_oat.c_str());
+        return false;
+      }
+      uint32_t* location = reinterpret_cast<uint32_t*>(oat_data + oat_relocations[i]);
+      *location += delta;
+      // Same as the ImageWriter, which checksums the words it patched.
+      oat_header->UpdateChecksum(location, sizeof(*location));
+    }
+    image_header->SetOatChecksum(oat_header->GetChecksum());
+    return true;
+  }
+
+  // Returns the oat header at the oatdata address in the mapped ELF file.
+  static OatHeader* FindOatHeader(ElfFile* elf_file, const byte* oat_data_begin) {
+    const Elf32_Addr oat_data = PointerToLowMemUInt32(oat_data_begin);
+    if (elf_file->FindSymbolAddress(SHT_DYNSYM, "oatdata", false) != oat_data) {
+      return nullptr;
+    }
+    for (Elf32_Word i = 0; i < elf_file->GetSectionHeaderNum(); ++i) {
+      const Elf32_Shdr& section_header = elf_file->GetSectionHeader(i);
+      if (section_header.sh_type != SHT_NOBITS && section_header.sh_addr <= oat_data &&
+          oat_data - section_header.sh_addr + sizeof(OatHeader) <= section_header.sh_size) {
+        return reinterpret_cast<OatHeader*>(elf_file->Begin() + section_header.sh_offset +
+                                            oat_data - section_header.sh_addr);
+      }
+    }
+    return nullptr;
+  }
+
+  static bool ReadFile(const std::string& filename, std::vector<uint8_t>* data,
+                       std::string* error_msg) {
+    std::unique_ptr<File> file(OS::OpenFileForReading(filename.c_str()));
+    if (file.get() == nullptr) {
+      *error_msg = StringPrintf("Failed to open '%s'", filename.c_str());
+      return false;
+    }
+    int64_t length = file->GetLength();
+    if (length < 0) {
+      *error_msg = StringPrintf("Failed to get the length of '%s'", filename.c_str());
+      return false;
+    }
+    data->resize(length);
+    if (!file->ReadFully(data->data(), length)) {
+      *error_msg = StringPrintf("Failed to read '%s'", filename.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  static bool WriteFile(const std::string& filename, const std::vector<uint8_t>& data,
+                        std::string* error_msg) {
+    std::unique_ptr<File> file(OS::CreateEmptyFile(filename.c_str()));
+    if (file.get() == nullptr) {
+      *error_msg = StringPrintf("Failed to create '%s'", filename.c_str());
+      return false;
+    }
+    if (fchmod(file->Fd(), 0644) != 0 || !file->WriteFully(data.data(), data.size())) {
+      *error_msg = StringPrintf("Failed to write '%s': %s", filename.c_str(), strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(PatchOat);
+};
+
+static int patchoat(int argc, char** argv) {
+  InitLogging(argv);
+
+  // Skip over argv[0].
+  argv++;
+  argc--;
+
+  if (argc == 0) {
+    Usage("No arguments specified");
+  }
+
+  std::string input_image;
+  std::string input_oat;
+  std::string output_image;
+  std::string output_oat;
+  int32_t delta = 0;
+  bool have_delta = false;
+  for (int i = 0; i < argc; ++i) {
+    const StringPiece option(argv[i]);
+    if (option.starts_with("--input-image=")) {
+      input_image = option.substr(strlen("--input-image=")).data();
+    } else if (option.starts_with("--input-oat=")) {
+      input_oat = option.substr(strlen("--input-oat=")).data();
+    } else if (option.starts_with("--output-image=")) {
+      output_image = option.substr(strlen("--output-image=")).data();
+    } else if (option.starts_with("--output-oat=")) {
+      output_oat = option.substr(strlen("--output-oat=")).data();
+    } else if (option.starts_with("--base-offset-delta=")) {
+      const char* delta_str = option.substr(strlen("--base-offset-delta=")).data();
+      char* end;
+      errno = 0;
+      long value = strtol(delta_str, &end, 16);  // NOLINT(runtime/int)
+      if (end == delta_str || *end != '\0' || errno != 0 || value > INT32_MAX ||
+          value < INT32_MIN) {
+        Usage("Failed to parse hexadecimal value for option %s", option.data());
+      }
+      delta = static_cast<int32_t>(value);
+      have_delta = true;
+    } else {
+      Usage("Unknown argument %s", option.data());
+    }
+  }
+  if (input_image.empty()) {
+    Usage("--input-image must be specified");
+  }
+  if (output_image.empty()) {
+    Usage("--output-image must be specified");
+  }
+  if (!have_delta) {
+    Usage("--base-offset-delta must be specified");
+  }
+  if (input_oat.empty()) {
+    input_oat = ImageHeader::GetOatLocationFromImageLocation(input_image);
+  }
+  if (output_oat.empty()) {
+    output_oat = ImageHeader::GetOatLocationFromImageLocation(output_image);
+  }
+
+  std::string error_msg;
+  if (!PatchOat::Patch(input_image, input_oat, output_image, output_oat, delta, &error_msg)) {
+    LOG(ERROR) << "Failed to relocate '" << input_image << "' by " << delta << ": " << error_msg;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+}  // namespace art
+
+int main(int argc, char** argv) {
+  return art::patchoat(argc, argv);
+}
@@ -23,6 +23,8 @@ LIBART_COMMON_SRC_FILES := \
 	barrier.cc \
 	base/allocator.cc \
 	base/bit_vector.cc \
+	base/concurrent_histogram.cc \
+	base/contention_profiler.cc \
 	base/hex_dump.cc \
 	base/logging.cc \
 	base/mutex.cc \
@@ -36,6 +38,7 @@ LIBART_COMMON_SRC_FILES := \
 	base/unix_file/string_file.cc \
 	check_jni.cc \
 	class_linker.cc \
+	class_table.cc \
 	common_throws.cc \
 	debugger.cc \
 	dex_file.cc \
@@ -57,6 +60,7 @@ LIBART_COMMON_SRC_FILES := \
 	gc/collector/partial_mark_sweep.cc \
 	gc/collector/semi_space.cc \
 	gc/collector/sticky_mark_sweep.cc \
+	gc/allocation_sampler.cc \
 	gc/gc_cause.cc \
 	gc/heap.cc \
 	gc/reference_processor.cc \
@@ -85,6 +89,8 @@ LIBART_COMMON_SRC_FILES := \
 	jdwp/jdwp_request.cc \
 	jdwp/jdwp_socket.cc \
 	jdwp/object_registry.cc \
+	jit/jit.cc \
+	jit/jit_code_cache.cc \
 	jni_internal.cc \
 	jobject_comparator.cc \
 	mem_map.cc \
@@ -128,9 +134,11 @@ LIBART_COMMON_SRC_FILES := \
 	offsets.cc \
 	os_linux.cc \
 	parsed_options.cc \
+	perf_map.cc \
 	primitive.cc \
 	quick_exception_handler.cc \
 	quick/inline_method_analyser.cc \
+	read_barrier.cc \
 	reference_table.cc \
 	reflection.cc \
 	runtime.cc \
@@ -146,12 +154,14 @@ LIBART_COMMON_SRC_FILES := \
 	fault_handler.cc \
 	utf.cc \
 	utils.cc \
+	verifier/background_verifier.cc \
 	verifier/dex_gc_map.cc \
 	verifier/instruction_flags.cc \
 	verifier/method_verifier.cc \
 	verifier/reg_type.cc \
 	verifier/reg_type_cache.cc \
 	verifier/register_line.cc \
+	verifier/verifier_deps.cc \
 	well_known_classes.cc \
 	zip_archive.cc
 
@@ -186,6 +196,7 @@ LIBART_COMMON_SRC_FILES += \
 	entrypoints/quick/quick_jni_entrypoints.cc \
 	entrypoints/quick/quick_lock_entrypoints.cc \
 	entrypoints/quick/quick_math_entrypoints.cc \
+	entrypoints/quick/quick_read_barrier_entrypoints.cc \
 	entrypoints/quick/quick_thread_entrypoints.cc \
 	entrypoints/quick/quick_throw_entrypoints.cc \
 	entrypoints/quick/quick_trampoline_entrypoints.cc
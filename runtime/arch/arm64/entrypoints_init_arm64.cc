@@ -111,6 +111,9 @@ extern "C" void art_quick_throw_no_such_method(int32_t method_idx);
 extern "C" void art_quick_throw_null_pointer_exception();
 extern "C" void art_quick_throw_stack_overflow(void*);
 
+// Read barrier entrypoints.
+extern "C" mirror::Object* artReadBarrierMark(mirror::Object* ref);
+
 extern void ResetQuickAllocEntryPoints(QuickEntryPoints* qpoints);
 
 // Generic JNI downcall
@@ -224,6 +227,9 @@ void InitEntryPoints(InterpreterEntryPoints* ipoints, JniEntryPoints* jpoints,
   qpoints->pThrowNoSuchMethod = art_quick_throw_no_such_method;
   qpoints->pThrowNullPointer = art_quick_throw_null_pointer_exception;
   qpoints->pThrowStackOverflow = art_quick_throw_stack_overflow;
+
+  // Read barrier
+  qpoints->pReadBarrierMark = artReadBarrierMark;
 };
 
 }  // namespace art
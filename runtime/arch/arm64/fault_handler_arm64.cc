@@ -21,7 +21,11 @@
 #include "globals.h"
 #include "base/logging.h"
 #include "base/hex_dump.h"
-
+#include "mirror/art_method.h"
+#include "mirror/art_method-inl.h"
+#include "stack.h"
+#include "thread.h"
+#include "thread-inl.h"
 
 //
 // ARM64 specific fault handler functions.
@@ -29,19 +33,100 @@
 
 namespace art {
 
+extern "C" void art_quick_throw_null_pointer_exception();
+extern "C" void art_quick_throw_stack_overflow_from_signal();
+
+// All A64 instructions are 4 bytes.
+static constexpr uint32_t kArm64InstructionSize = 4;
+
 void FaultManager::GetMethodAndReturnPCAndSP(void* context, mirror::ArtMethod** out_method,
                                              uintptr_t* out_return_pc, uintptr_t* out_sp) {
+  struct ucontext *uc = reinterpret_cast<struct ucontext*>(context);
+  struct sigcontext *sc = reinterpret_cast<struct sigcontext*>(&uc->uc_mcontext);
+  *out_sp = static_cast<uintptr_t>(sc->sp);
+  VLOG(signals) << "sp: " << std::hex << *out_sp;
+  if (*out_sp == 0) {
+    return;
+  }
+
+  // In the case of a stack overflow, the stack is not valid and we can't
+  // get the method from the top of the stack.  However it's in x0.
+  uintptr_t fault_addr = static_cast<uintptr_t>(sc->fault_address);
+  uintptr_t overflow_addr = *out_sp - Thread::kStackOverflowReservedBytes;
+  if (overflow_addr == fault_addr) {
+    *out_method = reinterpret_cast<mirror::ArtMethod*>(sc->regs[0]);
+  } else {
+    // The method is at the top of the stack.
+    *out_method = reinterpret_cast<StackReference<mirror::ArtMethod>*>(*out_sp)->AsMirrorPtr();
+  }
+
+  // Work out the return PC.  This will be the address of the instruction
+  // following the faulting ldr/str instruction.
+  VLOG(signals) << "pc: " << std::hex << sc->pc;
+  *out_return_pc = sc->pc + kArm64InstructionSize;
 }
 
 bool NullPointerHandler::Action(int sig, siginfo_t* info, void* context) {
-  return false;
+  // The code that looks for the catch location needs to know the value of the
+  // PC at the point of call.  For null checks we insert a GC map that is immediately after
+  // the load/store instruction that might cause the fault, set LR to it as if the
+  // faulting instruction had called art_quick_throw_null_pointer_exception.
+  struct ucontext *uc = reinterpret_cast<struct ucontext*>(context);
+  struct sigcontext *sc = reinterpret_cast<struct sigcontext*>(&uc->uc_mcontext);
+  sc->regs[30] = sc->pc + kArm64InstructionSize;  // LR needs to point to gc map location.
+  sc->pc = reinterpret_cast<uintptr_t>(art_quick_throw_null_pointer_exception);
+  VLOG(signals) << "Generating null pointer exception";
+  return true;
 }
 
 bool SuspensionHandler::Action(int sig, siginfo_t* info, void* context) {
   return false;
 }
 
+// Stack overflow fault handler.
+//
+// This checks that the fault address is equal to the current stack pointer
+// minus the overflow region size (32K).  The instruction sequence that
+// generates this signal is emitted before the frame is set up:
+//
+// sub x12, sp, #32768
+// ldr w12, [x12]
+//
+// The second instruction will fault if x12 is inside the protected region
+// on the stack.
+//
+// If we determine this is a stack overflow we need to move the stack pointer
+// to the overflow region below the protected region.
 bool StackOverflowHandler::Action(int sig, siginfo_t* info, void* context) {
-  return false;
+  struct ucontext *uc = reinterpret_cast<struct ucontext*>(context);
+  struct sigcontext *sc = reinterpret_cast<struct sigcontext*>(&uc->uc_mcontext);
+  uintptr_t sp = static_cast<uintptr_t>(sc->sp);
+  uintptr_t fault_addr = static_cast<uintptr_t>(sc->fault_address);
+  VLOG(signals) << "checking for stack overflow, sp: " << std::hex << sp <<
+    ", fault_addr: " << fault_addr;
+
+  uintptr_t overflow_addr = sp - Thread::kStackOverflowReservedBytes;
+
+  // Check that the fault address is the value expected for a stack overflow.
+  if (fault_addr != overflow_addr) {
+    VLOG(signals) << "Not a stack overflow";
+    return false;
+  }
+
+  Thread* self = reinterpret_cast<Thread*>(sc->regs[18]);
+  CHECK_EQ(self, Thread::Current());
+  uintptr_t pregion = reinterpret_cast<uintptr_t>(self->GetStackEnd()) -
+      Thread::kStackOverflowProtectedSize;
+  VLOG(signals) << "setting sp to overflow region at " << std::hex << pregion;
+
+  // Since the compiler puts the implicit overflow check before the callee
+  // save instructions, the SP is already pointing to the previous frame and
+  // LR still holds the return address into it.  Tell the stack overflow code
+  // where the new stack pointer should be.
+  sc->regs[16] = pregion;     // aka xIP0
+
+  // Now arrange for the signal handler to return to art_quick_throw_stack_overflow_from_signal.
+  sc->pc = reinterpret_cast<uintptr_t>(art_quick_throw_stack_overflow_from_signal);
+  return true;
 }
 }       // namespace art
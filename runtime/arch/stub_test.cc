@@ -20,6 +20,7 @@
 #include "mirror/class-inl.h"
 #include "mirror/string-inl.h"
 
+#include <algorithm>
 #include <cstdio>
 
 namespace art {
@@ -811,6 +812,58 @@ TEST_F(StubTest, UnlockObject) {
   TestUnlockObject(this);
 }
 
+TEST_F(StubTest, BiasedLockObject) {
+#if defined(__i386__) || defined(__arm__) || defined(__aarch64__) || defined(__x86_64__)
+  static constexpr size_t kBiasedLockLoops = 100;
+
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::String> obj(
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "hello, world!")));
+  // Bias the lock towards us without holding it.
+  obj->SetLockWord(LockWord::FromBiasedLockId(self->GetThreadId(), 0), false);
+
+  // The stubs keep the bias and count how often we hold the lock.
+  for (size_t i = 1; i <= kBiasedLockLoops; ++i) {
+    Invoke3(reinterpret_cast<size_t>(obj.Get()), 0U, 0U,
+            reinterpret_cast<uintptr_t>(&art_quick_lock_object), self);
+    LockWord l_inc = obj->GetLockWord(false);
+    EXPECT_EQ(LockWord::LockState::kBiasLocked, l_inc.GetState());
+    EXPECT_EQ(i, l_inc.ThinLockCount());
+  }
+  for (size_t i = kBiasedLockLoops; i > 0; --i) {
+    Invoke3(reinterpret_cast<size_t>(obj.Get()), 0U, 0U,
+            reinterpret_cast<uintptr_t>(&art_quick_unlock_object), self);
+    EXPECT_FALSE(self->IsExceptionPending());
+    LockWord l_dec = obj->GetLockWord(false);
+    EXPECT_EQ(LockWord::LockState::kBiasLocked, l_dec.GetState());
+    EXPECT_EQ(i - 1, l_dec.ThinLockCount());
+  }
+
+  // Unlocking a biased lock that isn't held is an illegal monitor state.
+  Invoke3(reinterpret_cast<size_t>(obj.Get()), 0U, 0U,
+          reinterpret_cast<uintptr_t>(&art_quick_unlock_object), self);
+  EXPECT_TRUE(self->IsExceptionPending());
+  self->ClearException();
+  LockWord lock_after = obj->GetLockWord(false);
+  EXPECT_EQ(LockWord::LockState::kBiasLocked, lock_after.GetState());
+  EXPECT_EQ(0U, lock_after.ThinLockCount());
+
+  // Hashing revokes the bias.
+  obj->IdentityHashCode();
+  EXPECT_EQ(LockWord::LockState::kFatLocked, obj->GetLockWord(false).GetState());
+  EXPECT_EQ(0U, Monitor::GetLockOwnerThreadId(obj.Get()));
+
+  // Test done.
+#else
+  LOG(INFO) << "Skipping biased lock_object as I don't know how to do that on " << kRuntimeISA;
+  // Force-print to std::cout so it's also outside the logcat.
+  std::cout << "Skipping biased lock_object as I don't know how to do that on " << kRuntimeISA
+            << std::endl;
+#endif
+}
+
 #if defined(__i386__) || defined(__arm__) || defined(__aarch64__) || defined(__x86_64__)
 extern "C" void art_quick_check_cast(void);
 #endif
@@ -1295,6 +1348,94 @@ TEST_F(StubTest, StringCompareTo) {
 }
 
 
+#if defined(__i386__) || defined(__x86_64__)
+extern "C" void art_quick_memcmp16(void);
+#endif
+
+TEST_F(StubTest, Memcmp16) {
+#if defined(__i386__) || defined(__x86_64__)
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+
+  static constexpr size_t kLength = 7;
+  const uint16_t a[kLength] = { 'a', 'b', 0x7fff, 0x8000, 0xfffe, 0xffff, 0 };
+  uint16_t b[kLength];
+  for (size_t count = 0; count <= kLength; ++count) {
+    std::copy(a, a + kLength, b);
+    EXPECT_EQ(0U, Invoke3(reinterpret_cast<size_t>(a), reinterpret_cast<size_t>(b), count,
+                          reinterpret_cast<uintptr_t>(&art_quick_memcmp16), self)) << count;
+    // The first difference decides, whatever follows it. The chars are unsigned.
+    for (size_t i = 0; i < count; ++i) {
+      std::copy(a, a + kLength, b);
+      b[i] = a[i] + 1;
+      if (i + 1 < kLength) {
+        b[i + 1] = a[i + 1] - 1;
+      }
+      size_t result = Invoke3(reinterpret_cast<size_t>(a), reinterpret_cast<size_t>(b), count,
+                              reinterpret_cast<uintptr_t>(&art_quick_memcmp16), self);
+      EXPECT_EQ(static_cast<int32_t>(a[i]) - static_cast<int32_t>(b[i]),
+                static_cast<int32_t>(result)) << count << " " << i;
+    }
+  }
+#else
+  LOG(INFO) << "Skipping memcmp16 as I don't know how to do that on " << kRuntimeISA;
+  // Force-print to std::cout so it's also outside the logcat.
+  std::cout << "Skipping memcmp16 as I don't know how to do that on " << kRuntimeISA <<
+      std::endl;
+#endif
+}
+
+
+#if defined(__arm__)
+extern "C" void art_quick_indexof(void);
+#endif
+
+TEST_F(StubTest, StringIndexOf) {
+  TEST_DISABLED_FOR_HEAP_REFERENCE_POISONING();
+
+#if defined(__arm__)
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+
+  // Lengths around the unrolled loop of the stub, and starts out of the string.
+  static constexpr size_t kStringCount = 5;
+  const char* c[kStringCount] = { "", "a", "abca", "abcdbcd", "abcdefghijkabcdefghijk" };
+  const char kChars[] = { 'a', 'b', 'd', 'k', 'z' };
+  StackHandleScope<kStringCount + 1> hs(self);
+  for (size_t i = 0; i < kStringCount; ++i) {
+    Handle<mirror::String> s(hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, c[i])));
+    int32_t length = s->GetLength();
+    for (char ch : kChars) {
+      for (int32_t start = -1; start <= length + 1; ++start) {
+        size_t result = Invoke3(reinterpret_cast<size_t>(s.Get()), ch, static_cast<size_t>(start),
+                                reinterpret_cast<uintptr_t>(&art_quick_indexof), self);
+        EXPECT_FALSE(self->IsExceptionPending());
+        EXPECT_EQ(s->FastIndexOf(ch, start), static_cast<int32_t>(result))
+            << c[i] << " " << ch << " " << start;
+      }
+    }
+  }
+
+  // A long string, scanned to the end.
+  std::string long_chars(16 * KB, 'a');
+  long_chars += 'b';
+  Handle<mirror::String> s(hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self,
+                                                                              long_chars.c_str())));
+  EXPECT_EQ(16 * KB,
+            Invoke3(reinterpret_cast<size_t>(s.Get()), 'b', 0,
+                    reinterpret_cast<uintptr_t>(&art_quick_indexof), self));
+  EXPECT_EQ(static_cast<size_t>(-1),
+            Invoke3(reinterpret_cast<size_t>(s.Get()), 'c', 0,
+                    reinterpret_cast<uintptr_t>(&art_quick_indexof), self));
+#else
+  LOG(INFO) << "Skipping string_indexof as I don't know how to do that on " << kRuntimeISA;
+  // Force-print to std::cout so it's also outside the logcat.
+  std::cout << "Skipping string_indexof as I don't know how to do that on " << kRuntimeISA <<
+      std::endl;
+#endif
+}
+
+
 #if defined(__i386__) || defined(__arm__) || defined(__aarch64__) || defined(__x86_64__)
 extern "C" void art_quick_set32_static(void);
 extern "C" void art_quick_get32_static(void);
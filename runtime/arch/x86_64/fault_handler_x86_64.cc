@@ -21,7 +21,11 @@
 #include "globals.h"
 #include "base/logging.h"
 #include "base/hex_dump.h"
-
+#include "mirror/art_method.h"
+#include "mirror/art_method-inl.h"
+#include "stack.h"
+#include "thread.h"
+#include "thread-inl.h"
 
 //
 // X86_64 specific fault handler functions.
@@ -29,19 +33,242 @@
 
 namespace art {
 
+extern "C" void art_quick_throw_null_pointer_exception();
+extern "C" void art_quick_throw_stack_overflow_from_signal();
+
+// Get the size of the x86_64 instruction at pc in bytes.  Only the instructions with a memory
+// operand that the compiler can emit are decoded, 0 is returned for any other instruction so
+// that the fault is not taken as one of ours.
+static uint32_t GetInstructionSize(const uint8_t* pc) {
+  const uint8_t* start_pc = pc;
+  bool operand_size_prefix = false;
+  bool prefix_done = false;
+  while (!prefix_done) {
+    switch (*pc) {
+      case 0x66:
+        operand_size_prefix = true;
+        ++pc;
+        break;
+      case 0xF0: case 0xF2: case 0xF3:                         // lock, repne, rep.
+      case 0x26: case 0x2E: case 0x36: case 0x3E: case 0x64: case 0x65:  // Segments.
+      case 0x67:                                               // Address size.
+        ++pc;
+        break;
+      default:
+        prefix_done = true;
+        break;
+    }
+  }
+  bool rex_w = false;
+  if ((*pc & 0xF0) == 0x40) {
+    rex_w = (*pc & 0x08) != 0;
+    ++pc;
+  }
+  // Size of a full immediate, it is 32 bits even with REX.W.
+  const uint32_t imm_size = (operand_size_prefix && !rex_w) ? 2 : 4;
+
+  bool has_modrm = false;
+  uint32_t immediate_size = 0;
+  // 0xF6 and 0xF7 only take an immediate for test, which has 0 in the reg field of the ModRM.
+  uint32_t test_immediate_size = 0;
+  uint8_t opcode = *pc++;
+  if (opcode == 0x0F) {
+    opcode = *pc++;
+    if (opcode == 0x38) {
+      ++pc;
+      has_modrm = true;
+    } else if (opcode == 0x3A) {
+      ++pc;
+      has_modrm = true;
+      immediate_size = 1;
+    } else if ((opcode >= 0x10 && opcode <= 0x17) || (opcode >= 0x28 && opcode <= 0x2F) ||
+               (opcode >= 0x40 && opcode <= 0x6F) || (opcode >= 0x74 && opcode <= 0x76) ||
+               (opcode >= 0x7E && opcode <= 0x7F) || (opcode >= 0x90 && opcode <= 0x9F) ||
+               (opcode >= 0xD0 && opcode <= 0xFE)) {
+      has_modrm = true;
+    } else {
+      switch (opcode) {
+        case 0x70:            // pshufd.
+        case 0xA4: case 0xAC:  // shld, shrd.
+        case 0xBA:            // bt group.
+        case 0xC2: case 0xC4: case 0xC5: case 0xC6:
+          has_modrm = true;
+          immediate_size = 1;
+          break;
+        case 0xA3: case 0xA5: case 0xAB: case 0xAD: case 0xAF:
+        case 0xB0: case 0xB1: case 0xB3: case 0xB6: case 0xB7: case 0xBB:
+        case 0xBE: case 0xBF: case 0xC0: case 0xC1: case 0xC7:
+          has_modrm = true;
+          break;
+        default:
+          break;
+      }
+    }
+  } else if (opcode < 0x40 && (opcode & 7) < 4) {
+    // Two operand arithmetic: add, or, adc, sbb, and, sub, xor, cmp.
+    has_modrm = true;
+  } else {
+    switch (opcode) {
+      case 0x63:                          // movsxd.
+      case 0x84: case 0x85: case 0x86: case 0x87:  // test, xchg.
+      case 0x88: case 0x89: case 0x8A: case 0x8B:  // mov.
+      case 0xD0: case 0xD1: case 0xD2: case 0xD3:  // Shifts by 1 or cl.
+      case 0xD8: case 0xD9: case 0xDA: case 0xDB:  // x87.
+      case 0xDC: case 0xDD: case 0xDE: case 0xDF:
+      case 0xFE: case 0xFF:
+        has_modrm = true;
+        break;
+      case 0x6B: case 0x80: case 0x82: case 0x83:  // imul and arithmetic with an imm8.
+      case 0xC0: case 0xC1:                       // Shifts by an imm8.
+      case 0xC6:                                  // mov of an imm8.
+        has_modrm = true;
+        immediate_size = 1;
+        break;
+      case 0x69: case 0x81: case 0xC7:
+        has_modrm = true;
+        immediate_size = imm_size;
+        break;
+      case 0xF6:
+        has_modrm = true;
+        test_immediate_size = 1;
+        break;
+      case 0xF7:
+        has_modrm = true;
+        test_immediate_size = imm_size;
+        break;
+      default:
+        break;
+    }
+  }
+  if (!has_modrm) {
+    VLOG(signals) << "unknown instruction at " << reinterpret_cast<const void*>(start_pc);
+    return 0;
+  }
+
+  uint8_t modrm = *pc++;
+  uint8_t mod = modrm >> 6;
+  uint8_t reg = (modrm >> 3) & 7;
+  uint8_t rm = modrm & 7;
+  if (mod != 3) {
+    if (rm == 4) {
+      // SIB byte, a base of rbp or r13 without displacement stands for a 32 bit displacement.
+      uint8_t sib = *pc++;
+      if (mod == 0 && (sib & 7) == 5) {
+        pc += 4;
+      }
+    } else if (mod == 0 && rm == 5) {
+      // RIP relative.
+      pc += 4;
+    }
+    if (mod == 1) {
+      pc += 1;
+    } else if (mod == 2) {
+      pc += 4;
+    }
+  }
+  if (reg == 0 || reg == 1) {
+    immediate_size += test_immediate_size;
+  }
+  pc += immediate_size;
+  return pc - start_pc;
+}
+
 void FaultManager::GetMethodAndReturnPCAndSP(void* context, mirror::ArtMethod** out_method,
                                              uintptr_t* out_return_pc, uintptr_t* out_sp) {
+  struct ucontext *uc = reinterpret_cast<struct ucontext*>(context);
+  *out_sp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RSP]);
+  VLOG(signals) << "sp: " << std::hex << *out_sp;
+  if (*out_sp == 0) {
+    return;
+  }
+
+  // In the case of a stack overflow, the stack is not valid and we can't
+  // get the method from the top of the stack.  However it's in rdi.
+  uintptr_t fault_addr = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_CR2]);
+  uintptr_t overflow_addr = *out_sp - Thread::kStackOverflowReservedBytes;
+  if (overflow_addr == fault_addr) {
+    *out_method = reinterpret_cast<mirror::ArtMethod*>(uc->uc_mcontext.gregs[REG_RDI]);
+  } else {
+    // The method is at the top of the stack.
+    *out_method = reinterpret_cast<StackReference<mirror::ArtMethod>*>(*out_sp)->AsMirrorPtr();
+  }
+
+  // Work out the return PC.  This will be the address of the instruction
+  // following the faulting one, which may be of any length.
+  uint8_t* ptr = reinterpret_cast<uint8_t*>(uc->uc_mcontext.gregs[REG_RIP]);
+  VLOG(signals) << "pc: " << std::hex << static_cast<void*>(ptr);
+  uint32_t instr_size = GetInstructionSize(ptr);
+  if (instr_size == 0) {
+    // Not an instruction we know of, so not one of our checks.
+    *out_method = nullptr;
+    return;
+  }
+  *out_return_pc = reinterpret_cast<uintptr_t>(ptr + instr_size);
 }
 
 bool NullPointerHandler::Action(int sig, siginfo_t* info, void* context) {
-  return false;
+  // The code that looks for the catch location needs to know the PC just after the
+  // faulting instruction, which is where the GC map for the null check is.  The return
+  // address of a call is found on the stack, so push it as if the faulting instruction
+  // had called art_quick_throw_null_pointer_exception.
+  struct ucontext *uc = reinterpret_cast<struct ucontext*>(context);
+  uint8_t* ptr = reinterpret_cast<uint8_t*>(uc->uc_mcontext.gregs[REG_RIP]);
+  uint32_t instr_size = GetInstructionSize(ptr);
+  uintptr_t* next_sp =
+      reinterpret_cast<uintptr_t*>(uc->uc_mcontext.gregs[REG_RSP] - sizeof(uintptr_t));
+  *next_sp = reinterpret_cast<uintptr_t>(ptr + instr_size);
+  uc->uc_mcontext.gregs[REG_RSP] = reinterpret_cast<uintptr_t>(next_sp);
+  uc->uc_mcontext.gregs[REG_RIP] =
+      reinterpret_cast<uintptr_t>(art_quick_throw_null_pointer_exception);
+  VLOG(signals) << "Generating null pointer exception";
+  return true;
 }
 
 bool SuspensionHandler::Action(int sig, siginfo_t* info, void* context) {
   return false;
 }
 
+// Stack overflow fault handler.
+//
+// This checks that the fault address is equal to the current stack pointer
+// minus the overflow region size (32K).  The instruction that generates this
+// signal is emitted on entry to the method, before the frame is set up:
+//
+// test eax,[rsp - 32768]
+//
+// It will fault if rsp - 32768 is inside the protected region on the stack.
+//
+// If we determine this is a stack overflow we need to move the stack pointer
+// to the overflow region below the protected region.
 bool StackOverflowHandler::Action(int sig, siginfo_t* info, void* context) {
-  return false;
+  struct ucontext *uc = reinterpret_cast<struct ucontext*>(context);
+  uintptr_t sp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RSP]);
+  uintptr_t fault_addr = reinterpret_cast<uintptr_t>(info->si_addr);
+  VLOG(signals) << "checking for stack overflow, sp: " << std::hex << sp <<
+    ", fault_addr: " << fault_addr;
+
+  uintptr_t overflow_addr = sp - Thread::kStackOverflowReservedBytes;
+
+  // Check that the fault address is the value expected for a stack overflow.
+  if (fault_addr != overflow_addr) {
+    VLOG(signals) << "Not a stack overflow";
+    return false;
+  }
+
+  Thread* self = Thread::Current();
+  uintptr_t pregion = reinterpret_cast<uintptr_t>(self->GetStackEnd()) -
+      Thread::kStackOverflowProtectedSize;
+  VLOG(signals) << "setting sp to overflow region at " << std::hex << pregion;
+
+  // Since the compiler puts the implicit overflow check before the frame is
+  // set up, rsp still points at the return address into the previous frame and
+  // stays as it is.  Tell the stack overflow code where the stack pointer
+  // should be moved to instead.
+  uc->uc_mcontext.gregs[REG_R11] = pregion;
+
+  // Now arrange for the signal handler to return to art_quick_throw_stack_overflow_from_signal.
+  uc->uc_mcontext.gregs[REG_RIP] =
+      reinterpret_cast<uintptr_t>(art_quick_throw_stack_overflow_from_signal);
+  return true;
 }
 }       // namespace art
@@ -88,10 +88,22 @@ class Atomic : public std::atomic<T> {
     return this->compare_exchange_weak(expected_value, desired_value, std::memory_order_release);
   }
 
+  // Atomically replace the value with desired value if it matches the expected value. Unlike the
+  // weak versions this never fails spuriously. Participates in the total order of sequentially
+  // consistent operations.
+  bool CompareExchangeStrongSequentiallyConsistent(T expected_value, T desired_value) {
+    return this->compare_exchange_strong(expected_value, desired_value, std::memory_order_seq_cst);
+  }
+
   T FetchAndAddSequentiallyConsistent(const T value) {
     return this->fetch_add(value, std::memory_order_seq_cst);  // Return old_value.
   }
 
+  // Atomically adds value without ordering other memory accesses, for statistics counters.
+  T FetchAndAddRelaxed(const T value) {
+    return this->fetch_add(value, std::memory_order_relaxed);  // Return old_value.
+  }
+
   T FetchAndSubSequentiallyConsistent(const T value) {
     return this->fetch_sub(value, std::memory_order_seq_cst);  // Return old value.
   }
@@ -151,6 +163,13 @@ class Atomic {
     return __sync_bool_compare_and_swap(&value_, expected_value, desired_value);
   }
 
+  // Atomically replace the value with desired value if it matches the expected value. Unlike the
+  // weak versions this never fails spuriously. Participates in the total order of sequentially
+  // consistent operations.
+  bool CompareExchangeStrongSequentiallyConsistent(T expected_value, T desired_value) {
+    return __sync_bool_compare_and_swap(&value_, expected_value, desired_value);
+  }
+
   volatile T* Address() {
     return &value_;
   }
@@ -159,6 +178,10 @@ class Atomic {
     return __sync_fetch_and_add(&value_, value);  // Return old_value.
   }
 
+  T FetchAndAddRelaxed(const T value) {
+    return __sync_fetch_and_add(&value_, value);  // Return old_value.
+  }
+
   T FetchAndSubSequentiallyConsistent(const T value) {
     return __sync_fetch_and_sub(&value_, value);  // Return old value.
   }
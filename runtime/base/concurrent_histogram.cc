@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "concurrent_histogram.h"
+
+#include <math.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <ostream>
+
+#include "base/logging.h"
+#include "utils.h"
+
+namespace art {
+
+ConcurrentHistogram::ConcurrentHistogram(const char* name)
+    : name_(name), shards_(new Shard[kNumShards]) {
+  Reset();
+}
+
+size_t ConcurrentHistogram::BucketIndex(uint64_t value) {
+  if (value < kSubBuckets) {
+    return value;
+  }
+  size_t shift = (63 - CLZ(value)) - kSubBucketBits;
+  size_t sub_bucket = (value >> shift) & (kSubBuckets - 1);
+  return (shift + 1) * kSubBuckets + sub_bucket;
+}
+
+uint64_t ConcurrentHistogram::BucketUpperBound(size_t index) {
+  DCHECK_LT(index, kNumBuckets);
+  if (index < kSubBuckets) {
+    return index;
+  }
+  size_t shift = index / kSubBuckets - 1;
+  uint64_t lower_bound = static_cast<uint64_t>(kSubBuckets + index % kSubBuckets) << shift;
+  return lower_bound + ((static_cast<uint64_t>(1) << shift) - 1);
+}
+
+ConcurrentHistogram::Shard* ConcurrentHistogram::CurrentShard() {
+  // pthread_self is cheap everywhere and, unlike Thread::Current, works on unattached threads.
+  // Thread descriptors are far apart, mix the bits above the page offset.
+  uintptr_t id = reinterpret_cast<uintptr_t>(pthread_self()) / kPageSize;
+  id ^= id >> 7;
+  return &shards_[id % kNumShards];
+}
+
+void ConcurrentHistogram::AddValue(uint64_t value) {
+  Shard* shard = CurrentShard();
+  shard->frequency[BucketIndex(value)].FetchAndAddRelaxed(1);
+  shard->sample_size.FetchAndAddRelaxed(1);
+  shard->sum.FetchAndAddRelaxed(value);
+  uint64_t max = shard->max.LoadRelaxed();
+  while (value > max && !shard->max.CompareExchangeWeakRelaxed(max, value)) {
+    max = shard->max.LoadRelaxed();
+  }
+}
+
+uint64_t ConcurrentHistogram::SampleSize() const {
+  uint64_t sample_size = 0;
+  for (size_t i = 0; i < kNumShards; ++i) {
+    sample_size += shards_[i].sample_size.LoadRelaxed();
+  }
+  return sample_size;
+}
+
+uint64_t ConcurrentHistogram::Sum() const {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < kNumShards; ++i) {
+    sum += shards_[i].sum.LoadRelaxed();
+  }
+  return sum;
+}
+
+uint64_t ConcurrentHistogram::Max() const {
+  uint64_t max = 0;
+  for (size_t i = 0; i < kNumShards; ++i) {
+    max = std::max(max, shards_[i].max.LoadRelaxed());
+  }
+  return max;
+}
+
+double ConcurrentHistogram::Mean() const {
+  uint64_t sample_size = SampleSize();
+  return sample_size == 0 ? 0.0 : static_cast<double>(Sum()) / sample_size;
+}
+
+uint64_t ConcurrentHistogram::Percentile(double fraction) const {
+  DCHECK_GE(fraction, 0.0);
+  DCHECK_LE(fraction, 1.0);
+  uint64_t frequency[kNumBuckets];
+  uint64_t sample_size = 0;
+  for (size_t b = 0; b < kNumBuckets; ++b) {
+    frequency[b] = 0;
+    for (size_t i = 0; i < kNumShards; ++i) {
+      frequency[b] += shards_[i].frequency[b].LoadRelaxed();
+    }
+    sample_size += frequency[b];
+  }
+  if (sample_size == 0) {
+    return 0;
+  }
+  // The rank of the sample, counting from one.
+  uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * sample_size)));
+  uint64_t seen = 0;
+  for (size_t b = 0; b < kNumBuckets; ++b) {
+    seen += frequency[b];
+    if (seen >= rank) {
+      return std::min(BucketUpperBound(b), Max());
+    }
+  }
+  return Max();
+}
+
+void ConcurrentHistogram::Reset() {
+  for (size_t i = 0; i < kNumShards; ++i) {
+    Shard* shard = &shards_[i];
+    shard->sample_size.StoreRelaxed(0);
+    shard->sum.StoreRelaxed(0);
+    shard->max.StoreRelaxed(0);
+    for (size_t b = 0; b < kNumBuckets; ++b) {
+      shard->frequency[b].StoreRelaxed(0);
+    }
+  }
+}
+
+void ConcurrentHistogram::Dump(std::ostream& os) const {
+  os << name_ << ": count=" << SampleSize() << " mean=" << Mean()
+     << " 50%=" << Percentile(0.5) << " 90%=" << Percentile(0.9)
+     << " 99%=" << Percentile(0.99) << " max=" << Max() << "\n";
+}
+
+}  // namespace art
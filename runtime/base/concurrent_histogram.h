@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_BASE_CONCURRENT_HISTOGRAM_H_
+#define ART_RUNTIME_BASE_CONCURRENT_HISTOGRAM_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "atomic.h"
+#include "base/macros.h"
+
+namespace art {
+
+// A histogram of uint64_t values that any number of threads can add to without locking, for
+// always-on instrumentation of hot paths such as pause or wait times. Unlike Histogram, whose
+// buckets adapt to the values and which needs external locking, the buckets are fixed and
+// log-linear: values below kSubBuckets have a bucket each and every power of two above is split
+// into kSubBuckets buckets, so a bucket is at most 1 / kSubBuckets of its values wide.
+//
+// Adding a value is a few relaxed increments in one of kNumShards shards picked by the calling
+// thread, so threads adding concurrently rarely share a cache line. Readers merge the shards; a
+// read racing with adds sees some of them.
+class ConcurrentHistogram {
+ public:
+  static constexpr size_t kSubBucketBits = 2;
+  static constexpr size_t kSubBuckets = 1u << kSubBucketBits;
+  static constexpr size_t kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+  static constexpr size_t kNumShards = 4;
+
+  explicit ConcurrentHistogram(const char* name);
+
+  void AddValue(uint64_t value);
+
+  uint64_t SampleSize() const;
+  uint64_t Sum() const;
+  uint64_t Max() const;
+  double Mean() const;
+
+  // Returns an upper bound on the value at or below which the given fraction of the samples lie,
+  // at most Max().
+  uint64_t Percentile(double fraction) const;
+
+  // Clears the samples. Samples added concurrently with Reset may be partly kept.
+  void Reset();
+
+  // Prints the sample count, mean, median, 90th and 99th percentiles and max on one line.
+  void Dump(std::ostream& os) const;
+
+  const std::string& Name() const {
+    return name_;
+  }
+
+  static size_t BucketIndex(uint64_t value);
+  // The largest value counted in the bucket.
+  static uint64_t BucketUpperBound(size_t index);
+
+ private:
+  struct Shard {
+    Atomic<uint64_t> sample_size;
+    Atomic<uint64_t> sum;
+    Atomic<uint64_t> max;
+    Atomic<uint32_t> frequency[kNumBuckets];
+  };
+
+  Shard* CurrentShard();
+
+  const std::string name_;
+  std::unique_ptr<Shard[]> shards_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentHistogram);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BASE_CONCURRENT_HISTOGRAM_H_
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "concurrent_histogram.h"
+
+#include <pthread.h>
+
+#include <memory>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+TEST(ConcurrentHistogramTest, Buckets) {
+  // Small values have exact buckets.
+  for (uint64_t value = 0; value < ConcurrentHistogram::kSubBuckets; ++value) {
+    EXPECT_EQ(value, ConcurrentHistogram::BucketIndex(value));
+    EXPECT_EQ(value, ConcurrentHistogram::BucketUpperBound(value));
+  }
+  // Every value lies in its bucket and the buckets are contiguous up to the largest value.
+  uint64_t previous_upper_bound = ConcurrentHistogram::kSubBuckets - 1;
+  for (size_t index = ConcurrentHistogram::kSubBuckets; index < ConcurrentHistogram::kNumBuckets;
+       ++index) {
+    uint64_t lower_bound = previous_upper_bound + 1;
+    uint64_t upper_bound = ConcurrentHistogram::BucketUpperBound(index);
+    EXPECT_EQ(index, ConcurrentHistogram::BucketIndex(lower_bound));
+    EXPECT_EQ(index, ConcurrentHistogram::BucketIndex(upper_bound));
+    // A bucket is at most a kSubBuckets-th of its values wide.
+    EXPECT_LE(upper_bound - lower_bound, lower_bound / ConcurrentHistogram::kSubBuckets);
+    previous_upper_bound = upper_bound;
+  }
+  EXPECT_EQ(UINT64_MAX, previous_upper_bound);
+}
+
+TEST(ConcurrentHistogramTest, Statistics) {
+  std::unique_ptr<ConcurrentHistogram> hist(new ConcurrentHistogram("Statistics"));
+  EXPECT_EQ(0U, hist->SampleSize());
+  EXPECT_EQ(0U, hist->Percentile(0.5));
+  for (uint64_t value = 1; value <= 100; ++value) {
+    hist->AddValue(value);
+  }
+  EXPECT_EQ(100U, hist->SampleSize());
+  EXPECT_EQ(5050U, hist->Sum());
+  EXPECT_EQ(100U, hist->Max());
+  EXPECT_DOUBLE_EQ(50.5, hist->Mean());
+  // Percentiles are bucket upper bounds, within a quarter of the exact value.
+  uint64_t median = hist->Percentile(0.5);
+  EXPECT_GE(median, 50U);
+  EXPECT_LE(median, 50U + 50U / ConcurrentHistogram::kSubBuckets);
+  EXPECT_EQ(100U, hist->Percentile(1.0));
+  std::ostringstream oss;
+  hist->Dump(oss);
+  EXPECT_NE(std::string::npos, oss.str().find("count=100"));
+  hist->Reset();
+  EXPECT_EQ(0U, hist->SampleSize());
+  EXPECT_EQ(0U, hist->Max());
+}
+
+static constexpr size_t kNumThreads = 8;
+static constexpr uint64_t kValuesPerThread = 10000;
+
+static void* AddValues(void* arg) {
+  ConcurrentHistogram* hist = reinterpret_cast<ConcurrentHistogram*>(arg);
+  for (uint64_t value = 1; value <= kValuesPerThread; ++value) {
+    hist->AddValue(value);
+  }
+  return nullptr;
+}
+
+TEST(ConcurrentHistogramTest, ConcurrentAdds) {
+  std::unique_ptr<ConcurrentHistogram> hist(new ConcurrentHistogram("ConcurrentAdds"));
+  pthread_t threads[kNumThreads];
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    ASSERT_EQ(0, pthread_create(&threads[i], nullptr, AddValues, hist.get()));
+  }
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    ASSERT_EQ(0, pthread_join(threads[i], nullptr));
+  }
+  // No sample is lost.
+  EXPECT_EQ(kNumThreads * kValuesPerThread, hist->SampleSize());
+  EXPECT_EQ(kNumThreads * kValuesPerThread * (kValuesPerThread + 1) / 2, hist->Sum());
+  EXPECT_EQ(kValuesPerThread, hist->Max());
+}
+
+}  // namespace art
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "contention_profiler.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "utils.h"
+
+namespace art {
+
+constexpr size_t ContentionProfiler::kMaxSites;
+
+Atomic<bool> ContentionProfiler::enabled_(false);
+Atomic<uint32_t> ContentionProfiler::sample_period_(1);
+Atomic<uint32_t> ContentionProfiler::contention_count_(0);
+
+struct ContentionSite {
+  ContentionSite() : count(0), total_wait_ns(0), max_wait_ns(0), last_waiter_tid(0),
+      last_owner_tid(0) {}
+  uint64_t count;
+  uint64_t total_wait_ns;
+  uint64_t max_wait_ns;
+  uint64_t last_waiter_tid;
+  uint64_t last_owner_tid;
+};
+
+typedef std::pair<std::string, std::string> ContentionKey;
+
+// Not an art::Mutex, a contention on it must not be recorded while it is held.
+static pthread_mutex_t gSitesLock = PTHREAD_MUTEX_INITIALIZER;
+// Leaked, to avoid ordering issues in global variable destruction. Guarded by gSitesLock.
+static std::map<ContentionKey, ContentionSite>* gSites = nullptr;
+static uint64_t gDroppedContentions = 0;
+
+class ScopedSitesLock {
+ public:
+  ScopedSitesLock() {
+    CHECK_PTHREAD_CALL(pthread_mutex_lock, (&gSitesLock), "contention sites lock");
+  }
+  ~ScopedSitesLock() {
+    CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&gSitesLock), "contention sites unlock");
+  }
+};
+
+static bool CompareTotalWait(const std::pair<ContentionKey, ContentionSite>& lhs,
+                             const std::pair<ContentionKey, ContentionSite>& rhs) {
+  return lhs.second.total_wait_ns > rhs.second.total_wait_ns;
+}
+
+void ContentionProfiler::Start(uint32_t sample_period) {
+  CHECK_GT(sample_period, 0U);
+  {
+    ScopedSitesLock mu;
+    if (gSites == nullptr) {
+      gSites = new std::map<ContentionKey, ContentionSite>();
+    }
+    gSites->clear();
+    gDroppedContentions = 0;
+  }
+  sample_period_.StoreRelaxed(sample_period);
+  contention_count_.StoreRelaxed(0);
+  enabled_.StoreSequentiallyConsistent(true);
+}
+
+void ContentionProfiler::Stop() {
+  enabled_.StoreSequentiallyConsistent(false);
+}
+
+bool ContentionProfiler::ShouldSample() {
+  // Racy, a contention more or less in the sample is fine.
+  uint32_t count = contention_count_.LoadRelaxed() + 1;
+  contention_count_.StoreRelaxed(count);
+  return count % sample_period_.LoadRelaxed() == 0;
+}
+
+void ContentionProfiler::RecordContention(const char* lock_name, const char* owner_site,
+                                          uint64_t waiter_tid, uint64_t owner_tid,
+                                          uint64_t wait_ns) {
+  ContentionKey key(lock_name, owner_site != nullptr ? owner_site : "");
+  ScopedSitesLock mu;
+  if (!IsEnabled() || gSites == nullptr) {
+    return;
+  }
+  auto it = gSites->find(key);
+  if (it == gSites->end()) {
+    if (gSites->size() >= kMaxSites) {
+      ++gDroppedContentions;
+      return;
+    }
+    it = gSites->insert(std::make_pair(key, ContentionSite())).first;
+  }
+  ContentionSite& site = it->second;
+  ++site.count;
+  site.total_wait_ns += wait_ns;
+  site.max_wait_ns = std::max(site.max_wait_ns, wait_ns);
+  site.last_waiter_tid = waiter_tid;
+  site.last_owner_tid = owner_tid;
+}
+
+void ContentionProfiler::Dump(std::ostream& os) {
+  std::vector<std::pair<ContentionKey, ContentionSite>> sites;
+  uint64_t dropped;
+  {
+    ScopedSitesLock mu;
+    if (gSites != nullptr) {
+      sites.assign(gSites->begin(), gSites->end());
+    }
+    dropped = gDroppedContentions;
+  }
+  std::sort(sites.begin(), sites.end(), CompareTotalWait);
+  os << "Lock contentions, one in " << sample_period_.LoadRelaxed() << " recorded"
+     << (IsEnabled() ? "" : ", stopped") << ":\n";
+  for (const auto& entry : sites) {
+    const ContentionSite& site = entry.second;
+    os << "  " << entry.first.first;
+    if (!entry.first.second.empty()) {
+      os << " owned at " << entry.first.second;
+    }
+    os << ": " << site.count << " contentions, total wait " << PrettyDuration(site.total_wait_ns)
+       << " max " << PrettyDuration(site.max_wait_ns)
+       << " last waiter tid " << site.last_waiter_tid
+       << " owner tid " << site.last_owner_tid << "\n";
+  }
+  if (dropped != 0) {
+    os << "  " << dropped << " contentions dropped, more than " << kMaxSites << " sites\n";
+  }
+}
+
+size_t ContentionProfiler::GetNumSites() {
+  ScopedSitesLock mu;
+  return gSites != nullptr ? gSites->size() : 0;
+}
+
+}  // namespace art
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_BASE_CONTENTION_PROFILER_H_
+#define ART_RUNTIME_BASE_CONTENTION_PROFILER_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+
+#include "atomic.h"
+#include "base/macros.h"
+
+namespace art {
+
+// Records sampled contentions of runtime mutexes and Java monitors, aggregated by lock and by the
+// call site of the lock owner. Recording is started and stopped at runtime, it is off by default
+// and then costs a relaxed load on the contended paths only.
+class ContentionProfiler {
+ public:
+  // The number of lock and owner site pairs recorded, further pairs are only counted as dropped.
+  static constexpr size_t kMaxSites = 1024;
+
+  // Starts recording one in sample_period contentions, discarding the previous records.
+  static void Start(uint32_t sample_period);
+  static void Stop();
+
+  static bool IsEnabled() {
+    return enabled_.LoadRelaxed();
+  }
+
+  // Returns true if the next contention is to be recorded.
+  static bool ShouldSample();
+
+  // Records that waiter_tid blocked for wait_ns on the lock owned by owner_tid. The owner site is
+  // where the owner acquired the lock and may be null when unknown, both strings are copied.
+  static void RecordContention(const char* lock_name, const char* owner_site, uint64_t waiter_tid,
+                               uint64_t owner_tid, uint64_t wait_ns);
+
+  // Dumps the recorded sites, the longest total wait first.
+  static void Dump(std::ostream& os);
+
+  static size_t GetNumSites();
+
+ private:
+  static Atomic<bool> enabled_;
+  static Atomic<uint32_t> sample_period_;
+  static Atomic<uint32_t> contention_count_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ContentionProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BASE_CONTENTION_PROFILER_H_
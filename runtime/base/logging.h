@@ -291,6 +291,7 @@ struct LogVerbosity {
   bool gc;
   bool heap;
   bool jdwp;
+  bool jit;
   bool jni;
   bool monitor;
   bool profiler;
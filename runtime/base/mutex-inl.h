@@ -23,6 +23,7 @@
 
 #define ATRACE_TAG ATRACE_TAG_DALVIK
 
+#include "base/contention_profiler.h"
 #include "cutils/atomic-inline.h"
 #include "cutils/trace.h"
 #include "runtime.h"
@@ -94,10 +95,11 @@ struct __attribute__((__may_alias__)) glibc_pthread_rwlock_t {
 class ScopedContentionRecorder {
  public:
   ScopedContentionRecorder(BaseMutex* mutex, uint64_t blocked_tid, uint64_t owner_tid)
-      : mutex_(kLogLockContentions ? mutex : NULL),
-        blocked_tid_(kLogLockContentions ? blocked_tid : 0),
-        owner_tid_(kLogLockContentions ? owner_tid : 0),
-        start_nano_time_(kLogLockContentions ? NanoTime() : 0) {
+      : mutex_(mutex),
+        blocked_tid_(blocked_tid),
+        owner_tid_(owner_tid),
+        profile_(ContentionProfiler::IsEnabled() && ContentionProfiler::ShouldSample()),
+        start_nano_time_(kLogLockContentions || profile_ ? NanoTime() : 0) {
     std::string msg = StringPrintf("Lock contention on %s (owner tid: %" PRIu64 ")",
                                    mutex->GetName(), owner_tid);
     ATRACE_BEGIN(msg.c_str());
@@ -105,9 +107,16 @@ class ScopedContentionRecorder {
 
   ~ScopedContentionRecorder() {
     ATRACE_END();
-    if (kLogLockContentions) {
-      uint64_t end_nano_time = NanoTime();
-      mutex_->RecordContention(blocked_tid_, owner_tid_, end_nano_time - start_nano_time_);
+    if (kLogLockContentions || profile_) {
+      uint64_t wait_time = NanoTime() - start_nano_time_;
+      if (kLogLockContentions) {
+        mutex_->RecordContention(blocked_tid_, owner_tid_, wait_time);
+      }
+      if (profile_) {
+        // The owner's stack can't be walked from here, runtime mutexes have no owner site.
+        ContentionProfiler::RecordContention(mutex_->GetName(), nullptr, blocked_tid_, owner_tid_,
+                                             wait_time);
+      }
     }
   }
 
@@ -115,6 +124,8 @@ class ScopedContentionRecorder {
   BaseMutex* const mutex_;
   const uint64_t blocked_tid_;
   const uint64_t owner_tid_;
+  // Whether the contention is sampled by the ContentionProfiler.
+  const bool profile_;
   const uint64_t start_nano_time_;
 };
 
@@ -193,9 +204,50 @@ inline void BaseMutex::RegisterAsUnlocked(Thread* self) {
   }
 }
 
+#if ART_USE_FUTEXES
+inline Atomic<Thread*>& ReaderWriterMutex::GetReaderSlot(const Thread* self) {
+  return reader_slots_[self->GetThreadId() % kNumReaderSlots].reader;
+}
+
+inline bool ReaderWriterMutex::SharedTryLockBiased(Thread* self) {
+  if (reader_slots_ == nullptr || self == nullptr || !reader_bias_.LoadRelaxed()) {
+    return false;
+  }
+  Atomic<Thread*>& slot = GetReaderSlot(self);
+  if (!slot.CompareExchangeStrongSequentiallyConsistent(nullptr, self)) {
+    return false;
+  }
+  // Check the bias again now that a revoking writer is guaranteed to see the slot.
+  if (UNLIKELY(!reader_bias_.LoadSequentiallyConsistent())) {
+    slot.StoreSequentiallyConsistent(nullptr);
+    return false;
+  }
+  return true;
+}
+
+inline bool ReaderWriterMutex::SharedUnlockBiased(Thread* self) {
+  if (reader_slots_ == nullptr || self == nullptr) {
+    return false;
+  }
+  // A thread holding more than one share may release them in any order, each release just needs
+  // to give back one of them.
+  Atomic<Thread*>& slot = GetReaderSlot(self);
+  if (slot.LoadRelaxed() != self) {
+    return false;
+  }
+  slot.StoreSequentiallyConsistent(nullptr);
+  return true;
+}
+#endif
+
 inline void ReaderWriterMutex::SharedLock(Thread* self) {
   DCHECK(self == NULL || self == Thread::Current());
 #if ART_USE_FUTEXES
+  if (SharedTryLockBiased(self)) {
+    RegisterAsLocked(self);
+    AssertSharedHeld(self);
+    return;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_;
@@ -214,6 +266,9 @@ inline void ReaderWriterMutex::SharedLock(Thread* self) {
       android_atomic_dec(&num_pending_readers_);
     }
   } while (!done);
+  if (UNLIKELY(reader_slots_ != nullptr)) {
+    MaybeEnableReaderBias();
+  }
 #else
   CHECK_MUTEX_CALL(pthread_rwlock_rdlock, (&rwlock_));
 #endif
@@ -226,6 +281,9 @@ inline void ReaderWriterMutex::SharedUnlock(Thread* self) {
   AssertSharedHeld(self);
   RegisterAsUnlocked(self);
 #if ART_USE_FUTEXES
+  if (SharedUnlockBiased(self)) {
+    return;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_;
@@ -17,6 +17,7 @@
 #include "mutex.h"
 
 #include <errno.h>
+#include <sched.h>
 #include <sys/time.h>
 
 #include "atomic.h"
@@ -55,7 +56,17 @@ struct AllMutexData {
 };
 static struct AllMutexData gAllMutexData[kAllMutexDataSize];
 
+// Let threads transitioning to runnable take a share of the mutator lock without writing to a
+// cache line shared with all other threads.
+static constexpr bool kReaderBiasedMutatorLock = ART_USE_FUTEXES;
+
 #if ART_USE_FUTEXES
+// Writers revoking the reader bias yield this many times per slot before sleeping.
+static constexpr size_t kRevokeSpinCount = 100;
+static constexpr uint64_t kRevokeSleepNs = 10 * 1000;
+// The reader bias stays disabled for this multiple of the time a revocation took.
+static constexpr uint64_t kReaderBiasInhibitMultiplier = 9;
+
 static bool ComputeRelativeTimeSpec(timespec* result_ts, const timespec& lhs, const timespec& rhs) {
   const int32_t one_sec = 1000 * 1000 * 1000;  // one second in nanoseconds.
   result_ts->tv_sec = lhs.tv_sec - rhs.tv_sec;
@@ -447,13 +458,22 @@ std::ostream& operator<<(std::ostream& os, const Mutex& mu) {
   return os;
 }
 
-ReaderWriterMutex::ReaderWriterMutex(const char* name, LockLevel level)
+ReaderWriterMutex::ReaderWriterMutex(const char* name, LockLevel level, bool reader_biased)
     : BaseMutex(name, level)
 #if ART_USE_FUTEXES
-    , state_(0), exclusive_owner_(0), num_pending_readers_(0), num_pending_writers_(0)
+    , state_(0), exclusive_owner_(0), num_pending_readers_(0), num_pending_writers_(0),
+    reader_slots_(reader_biased ? new ReaderSlot[kNumReaderSlots] : nullptr),
+    reader_bias_(reader_biased), reader_bias_inhibit_until_(0)
 #endif
 {  // NOLINT(whitespace/braces)
-#if !ART_USE_FUTEXES
+#if ART_USE_FUTEXES
+  if (reader_slots_ != nullptr) {
+    for (size_t i = 0; i < kNumReaderSlots; ++i) {
+      reader_slots_[i].reader.StoreRelaxed(nullptr);
+    }
+  }
+#else
+  UNUSED(reader_biased);
   CHECK_MUTEX_CALL(pthread_rwlock_init, (&rwlock_, NULL));
 #endif
 }
@@ -464,6 +484,12 @@ ReaderWriterMutex::~ReaderWriterMutex() {
   CHECK_EQ(exclusive_owner_, 0U);
   CHECK_EQ(num_pending_readers_, 0);
   CHECK_EQ(num_pending_writers_.LoadRelaxed(), 0);
+  if (reader_slots_ != nullptr) {
+    for (size_t i = 0; i < kNumReaderSlots; ++i) {
+      CHECK(reader_slots_[i].reader.LoadRelaxed() == nullptr) << "Reader slot " << i << " in use";
+    }
+    delete[] reader_slots_;
+  }
 #else
   // We can't use CHECK_MUTEX_CALL here because on shutdown a suspended daemon thread
   // may still be using locks.
@@ -504,6 +530,9 @@ void ReaderWriterMutex::ExclusiveLock(Thread* self) {
     }
   } while (!done);
   DCHECK_EQ(state_, -1);
+  if (reader_slots_ != nullptr) {
+    RevokeReaderBias(nullptr);
+  }
   exclusive_owner_ = SafeGetTid(self);
 #else
   CHECK_MUTEX_CALL(pthread_rwlock_wrlock, (&rwlock_));
@@ -576,6 +605,14 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
       num_pending_writers_--;
     }
   } while (!done);
+  if (reader_slots_ != nullptr && !RevokeReaderBias(&end_abs_ts)) {
+    // Readers didn't leave in time, give up state_ again.
+    CHECK(__sync_bool_compare_and_swap(&state_, -1 /* cur_state */, 0 /* new state */));
+    if (num_pending_readers_ > 0 || num_pending_writers_.LoadRelaxed() > 0) {
+      futex(&state_, FUTEX_WAKE, -1, NULL, NULL, 0);
+    }
+    return false;  // Timed out.
+  }
   exclusive_owner_ = SafeGetTid(self);
 #else
   timespec ts;
@@ -598,6 +635,11 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
 bool ReaderWriterMutex::SharedTryLock(Thread* self) {
   DCHECK(self == NULL || self == Thread::Current());
 #if ART_USE_FUTEXES
+  if (SharedTryLockBiased(self)) {
+    RegisterAsLocked(self);
+    AssertSharedHeld(self);
+    return true;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_;
@@ -635,10 +677,60 @@ bool ReaderWriterMutex::IsSharedHeld(const Thread* self) const {
   return result;
 }
 
+#if ART_USE_FUTEXES
+void ReaderWriterMutex::MaybeEnableReaderBias() {
+  // Holding a share means no writer can be revoking the bias concurrently.
+  if (!reader_bias_.LoadRelaxed() && NanoTime() >= reader_bias_inhibit_until_.LoadRelaxed()) {
+    reader_bias_.StoreRelaxed(true);
+  }
+}
+
+bool ReaderWriterMutex::RevokeReaderBias(const timespec* end_abs_ts) {
+  DCHECK_EQ(state_, -1);
+  if (!reader_bias_.LoadRelaxed()) {
+    return true;
+  }
+  const uint64_t start_time = NanoTime();
+  reader_bias_.StoreSequentiallyConsistent(false);
+  bool revoked = true;
+  for (size_t i = 0; i < kNumReaderSlots && revoked; ++i) {
+    size_t spins = 0;
+    while (reader_slots_[i].reader.LoadSequentiallyConsistent() != nullptr) {
+      if (end_abs_ts != nullptr) {
+        timespec now_abs_ts;
+        InitTimeSpec(true, CLOCK_REALTIME, 0, 0, &now_abs_ts);
+        timespec rel_ts;
+        if (ComputeRelativeTimeSpec(&rel_ts, *end_abs_ts, now_abs_ts)) {
+          revoked = false;
+          break;
+        }
+      }
+      // Readers announce their release only through the slot, poll with a back off.
+      if (++spins < kRevokeSpinCount) {
+        sched_yield();
+      } else {
+        NanoSleep(kRevokeSleepNs);
+      }
+    }
+  }
+  // Keep the bias disabled for a multiple of the revocation time so that readers pay for the
+  // futex lock rather than writers for repeated revocations when writes are frequent.
+  const uint64_t end_time = NanoTime();
+  reader_bias_inhibit_until_.StoreRelaxed(
+      end_time + (end_time - start_time) * kReaderBiasInhibitMultiplier);
+  return revoked;
+}
+#endif
+
 void ReaderWriterMutex::Dump(std::ostream& os) const {
   os << name_
       << " level=" << static_cast<int>(level_)
       << " owner=" << GetExclusiveOwnerTid() << " ";
+#if ART_USE_FUTEXES
+  if (reader_slots_ != nullptr) {
+    os << "reader_bias=" << reader_bias_.LoadRelaxed() << " ";
+  }
+#endif
   DumpContention(os);
 }
 
@@ -839,7 +931,8 @@ void Locks::Init() {
     // Create global locks in level order from highest lock level to lowest.
     LockLevel current_lock_level = kMutatorLock;
     DCHECK(mutator_lock_ == nullptr);
-    mutator_lock_ = new ReaderWriterMutex("mutator lock", current_lock_level);
+    mutator_lock_ = new ReaderWriterMutex("mutator lock", current_lock_level,
+                                          kReaderBiasedMutatorLock);
 
     #define UPDATE_CURRENT_LOCK_LEVEL(new_level) \
         DCHECK_LT(new_level, current_lock_level); \
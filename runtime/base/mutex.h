@@ -57,16 +57,20 @@ enum LockLevel {
   kMemMapsLock,
   kUnexpectedSignalLock,
   kThreadSuspendCountLock,
+  kConcurrentCopyingMarkStackLock,
   kAbortLock,
+  kPerfMapLock,
   kJdwpSocketLock,
   kRosAllocGlobalLock,
   kRosAllocBracketLock,
   kRosAllocBulkFreeLock,
   kAllocSpaceLock,
   kReferenceProcessorLock,
+  kJitCodeCacheLock,
   kDexFileMethodInlinerLock,
   kDexFileToMethodInlinerMapLock,
   kMarkSweepMarkStackLock,
+  kInternTableShardLock,
   kTransactionLogLock,
   kInternTableLock,
   kMonitorPoolLock,
@@ -268,10 +272,18 @@ class LOCKABLE Mutex : public BaseMutex {
 // Exclusive | Block         | Free            | Block            | error
 // Shared(n) | Block         | error           | SharedLock(n+1)* | Shared(n-1) or Free
 // * for large values of n the SharedLock may block.
+//
+// A reader biased ReaderWriterMutex lets readers acquire a share without touching the shared
+// state_ word while the bias is enabled: each reader instead publishes itself in a slot selected
+// by its thread id, so uncontended readers only write to a cache line no other thread uses. A
+// writer takes state_ as usual, then revokes the bias and waits for the published readers to
+// leave. Readers re-enable the bias once a multiple of the last revocation time has passed, so
+// that frequent writers fall back to the plain futex lock.
 std::ostream& operator<<(std::ostream& os, const ReaderWriterMutex& mu);
 class LOCKABLE ReaderWriterMutex : public BaseMutex {
  public:
-  explicit ReaderWriterMutex(const char* name, LockLevel level = kDefaultMutexLevel);
+  explicit ReaderWriterMutex(const char* name, LockLevel level = kDefaultMutexLevel,
+                             bool reader_biased = false);
   ~ReaderWriterMutex();
 
   virtual bool IsReaderWriterMutex() const { return true; }
@@ -348,6 +360,35 @@ class LOCKABLE ReaderWriterMutex : public BaseMutex {
 
  private:
 #if ART_USE_FUTEXES
+  // Number of reader slots of a reader biased mutex, threads whose ids collide fall back to
+  // state_.
+  static constexpr size_t kNumReaderSlots = 256;
+
+  // A reader slot, padded so that readers in different slots don't share a cache line.
+  struct ReaderSlot {
+    Atomic<Thread*> reader;
+    uint8_t padding[64 - sizeof(Atomic<Thread*>)];
+  };
+
+  Atomic<Thread*>& GetReaderSlot(const Thread* self) ALWAYS_INLINE;
+
+  // Try to acquire a share through the reader slot of self, fails if the bias is disabled or the
+  // slot is taken by another thread.
+  bool SharedTryLockBiased(Thread* self) ALWAYS_INLINE;
+
+  // Release a share acquired through the reader slot of self, returns false if the share was
+  // acquired through state_.
+  bool SharedUnlockBiased(Thread* self) ALWAYS_INLINE;
+
+  // Called by readers holding a share through state_ to re-enable the bias once the writer
+  // inhibition period has passed.
+  void MaybeEnableReaderBias();
+
+  // Called by a writer which owns state_ exclusively. Disables the bias and waits for readers
+  // that acquired a share through their slot to release it. Returns false if end_abs_ts, when
+  // non-null, passed first.
+  bool RevokeReaderBias(const timespec* end_abs_ts);
+
   // -1 implies held exclusive, +ve shared held by state_ many owners.
   volatile int32_t state_;
   // Exclusive owner.
@@ -356,6 +397,12 @@ class LOCKABLE ReaderWriterMutex : public BaseMutex {
   volatile int32_t num_pending_readers_;
   // Pending writers.
   AtomicInteger num_pending_writers_;
+  // Reader slots, null if the mutex isn't reader biased.
+  ReaderSlot* const reader_slots_;
+  // Whether readers may acquire a share through their slot.
+  Atomic<bool> reader_bias_;
+  // NanoTime before which readers don't re-enable the bias after a writer revoked it.
+  Atomic<uint64_t> reader_bias_inhibit_until_;
 #else
   pthread_rwlock_t rwlock_;
 #endif
@@ -16,6 +16,9 @@
 
 #include "mutex.h"
 
+#include <sstream>
+
+#include "base/contention_profiler.h"
 #include "common_runtime_test.h"
 
 namespace art {
@@ -135,6 +138,38 @@ TEST_F(MutexTest, RecursiveLockWait) {
   RecursiveLockWaitTest();
 }
 
+static void* LockUnlockCallback(void* arg) NO_THREAD_SAFETY_ANALYSIS {
+  Mutex* mu = reinterpret_cast<Mutex*>(arg);
+  mu->Lock(Thread::Current());
+  mu->Unlock(Thread::Current());
+  return NULL;
+}
+
+// GCC has trouble with our mutex tests, so we have to turn off thread safety analysis.
+static void ProfileContentionTest() NO_THREAD_SAFETY_ANALYSIS {
+  Mutex mu("profiled mutex");
+  ContentionProfiler::Start(1);
+  mu.Lock(Thread::Current());
+  pthread_t pthread;
+  int pthread_create_result = pthread_create(&pthread, NULL, LockUnlockCallback, &mu);
+  ASSERT_EQ(0, pthread_create_result);
+  // Give the thread the time to block on the mutex.
+  NanoSleep(MsToNs(50));
+  mu.Unlock(Thread::Current());
+  EXPECT_EQ(pthread_join(pthread, NULL), 0);
+  ContentionProfiler::Stop();
+#if ART_USE_FUTEXES
+  EXPECT_GE(ContentionProfiler::GetNumSites(), 1U);
+  std::ostringstream os;
+  ContentionProfiler::Dump(os);
+  EXPECT_NE(std::string::npos, os.str().find("profiled mutex: ")) << os.str();
+#endif
+}
+
+TEST_F(MutexTest, ProfileContention) {
+  ProfileContentionTest();
+}
+
 TEST_F(MutexTest, SharedLockUnlock) {
   ReaderWriterMutex mu("test rwmutex");
   mu.AssertNotHeld(Thread::Current());
@@ -170,4 +205,30 @@ TEST_F(MutexTest, SharedTryLockUnlock) {
   SharedTryLockUnlockTest();
 }
 
+TEST_F(MutexTest, ReaderBiasedLockUnlock) {
+  Thread* self = Thread::Current();
+  ReaderWriterMutex mu("test reader biased rwmutex", kDefaultMutexLevel, true);
+  mu.AssertNotHeld(self);
+  mu.SharedLock(self);
+  mu.AssertSharedHeld(self);
+  mu.AssertNotExclusiveHeld(self);
+  mu.SharedUnlock(self);
+  mu.AssertNotHeld(self);
+  // Revokes the reader bias, readers then go through the shared state until it is re-enabled.
+  mu.ExclusiveLock(self);
+  mu.AssertExclusiveHeld(self);
+  mu.ExclusiveUnlock(self);
+  mu.AssertNotHeld(self);
+  for (size_t i = 0; i < 2; ++i) {
+    mu.SharedLock(self);
+    mu.AssertSharedHeld(self);
+    mu.SharedUnlock(self);
+    mu.AssertNotHeld(self);
+  }
+  mu.ExclusiveLock(self);
+  mu.AssertExclusiveHeld(self);
+  mu.ExclusiveUnlock(self);
+  mu.AssertNotHeld(self);
+}
+
 }  // namespace art
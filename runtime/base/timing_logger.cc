@@ -26,6 +26,7 @@
 #include "base/stl_util.h"
 #include "base/histogram-inl.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 
@@ -79,6 +80,21 @@ size_t CumulativeLogger::GetIterations() const {
   return iterations_;
 }
 
+std::vector<CumulativeLogger::SplitStats> CumulativeLogger::GetSplitStats() const {
+  MutexLock mu(Thread::Current(), lock_);
+  std::vector<SplitStats> stats;
+  stats.reserve(histograms_.size());
+  for (const Histogram<uint64_t>* histogram : histograms_) {
+    SplitStats split_stats = { histogram->Name(), histogram->SampleSize(), histogram->Sum(),
+                               histogram->Max() };
+    stats.push_back(split_stats);
+  }
+  std::sort(stats.begin(), stats.end(), [](const SplitStats& a, const SplitStats& b) {
+    return a.total_us > b.total_us;
+  });
+  return stats;
+}
+
 void CumulativeLogger::Dump(std::ostream &os) const {
   MutexLock mu(Thread::Current(), lock_);
   DumpHistogram(os);
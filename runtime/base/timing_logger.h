@@ -45,6 +45,16 @@ class CumulativeLogger {
   void AddLogger(const TimingLogger& logger) LOCKS_EXCLUDED(lock_);
   size_t GetIterations() const;
 
+  // Times of the splits with the same label, in microseconds.
+  struct SplitStats {
+    std::string label;
+    uint64_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+  };
+  // Returns the stats of every label, by decreasing total time.
+  std::vector<SplitStats> GetSplitStats() const LOCKS_EXCLUDED(lock_);
+
  private:
   class HistogramComparator {
    public:
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_BASE_WORK_STEALING_DEQUE_H_
+#define ART_RUNTIME_BASE_WORK_STEALING_DEQUE_H_
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "atomic.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "utils.h"
+
+namespace art {
+
+// A Chase-Lev work stealing deque. The owning thread pushes and pops at the bottom without any
+// atomic read-modify-write in the common case, other threads steal from the top with a single
+// CAS. The storage grows when the deque fills up. Arrays which were grown out of are kept alive
+// until the deque is destroyed since a thief may still be reading from them.
+//
+// T must be trivially copyable, typically a pointer.
+template <typename T>
+class WorkStealingDeque {
+ public:
+  static constexpr size_t kDefaultCapacity = 1 * KB;
+
+  explicit WorkStealingDeque(size_t initial_capacity = kDefaultCapacity)
+      : top_(0), bottom_(0), array_(nullptr) {
+    CHECK(IsPowerOfTwo(initial_capacity)) << initial_capacity;
+    arrays_.emplace_back(new Array(initial_capacity));
+    array_.StoreRelaxed(arrays_.back().get());
+  }
+
+  // Push a value onto the bottom of the deque, only called by the owning thread.
+  void Push(T value) {
+    const intptr_t bottom = bottom_.LoadRelaxed();
+    const intptr_t top = top_.LoadSequentiallyConsistent();
+    Array* array = array_.LoadRelaxed();
+    if (UNLIKELY(bottom - top >= static_cast<intptr_t>(array->Capacity()))) {
+      array = Grow(array, top, bottom);
+    }
+    array->Put(bottom, value);
+    // The element must be visible before a thief can see the new bottom.
+    QuasiAtomic::MembarStoreStore();
+    bottom_.StoreRelaxed(bottom + 1);
+  }
+
+  // Pop a value from the bottom of the deque, only called by the owning thread. Returns false if
+  // the deque is empty or a thief took the last element.
+  bool Pop(T* value) {
+    const intptr_t bottom = bottom_.LoadRelaxed() - 1;
+    Array* array = array_.LoadRelaxed();
+    bottom_.StoreRelaxed(bottom);
+    // Publish the reservation of the bottom element before reading top, this is what makes a
+    // concurrent steal of the same element detectable.
+    QuasiAtomic::MembarStoreLoad();
+    const intptr_t top = top_.LoadRelaxed();
+    if (top > bottom) {
+      // Empty.
+      bottom_.StoreRelaxed(bottom + 1);
+      return false;
+    }
+    *value = array->Get(bottom);
+    if (top == bottom) {
+      // Last element, race against the thieves for it.
+      const bool won = top_.CompareExchangeStrongSequentiallyConsistent(top, top + 1);
+      bottom_.StoreRelaxed(bottom + 1);
+      return won;
+    }
+    return true;
+  }
+
+  // Steal a value from the top of the deque, may be called by any thread. Returns false if the
+  // deque is empty or we lost a race with the owner or another thief.
+  bool Steal(T* value) {
+    const intptr_t top = top_.LoadSequentiallyConsistent();
+    QuasiAtomic::MembarStoreLoad();
+    const intptr_t bottom = bottom_.LoadSequentiallyConsistent();
+    if (top >= bottom) {
+      return false;
+    }
+    Array* array = array_.LoadSequentiallyConsistent();
+    const T result = array->Get(top);
+    if (!top_.CompareExchangeStrongSequentiallyConsistent(top, top + 1)) {
+      return false;
+    }
+    *value = result;
+    return true;
+  }
+
+  // Approximate number of elements, exact if there are no concurrent operations.
+  size_t Size() const {
+    const intptr_t bottom = bottom_.LoadSequentiallyConsistent();
+    const intptr_t top = top_.LoadSequentiallyConsistent();
+    return bottom > top ? static_cast<size_t>(bottom - top) : 0U;
+  }
+
+  bool IsEmpty() const {
+    return Size() == 0U;
+  }
+
+  size_t Capacity() const {
+    return array_.LoadRelaxed()->Capacity();
+  }
+
+ private:
+  // Circular storage, indices are masked with the power of two capacity.
+  class Array {
+   public:
+    explicit Array(size_t capacity) : mask_(capacity - 1), slots_(new Atomic<T>[capacity]) {
+      DCHECK(IsPowerOfTwo(capacity));
+    }
+
+    size_t Capacity() const {
+      return mask_ + 1;
+    }
+
+    T Get(intptr_t index) const {
+      return slots_[static_cast<size_t>(index) & mask_].LoadRelaxed();
+    }
+
+    void Put(intptr_t index, T value) {
+      slots_[static_cast<size_t>(index) & mask_].StoreRelaxed(value);
+    }
+
+   private:
+    const size_t mask_;
+    std::unique_ptr<Atomic<T>[]> slots_;
+
+    DISALLOW_COPY_AND_ASSIGN(Array);
+  };
+
+  // Copies the live range to an array of twice the capacity, only called by the owning thread.
+  Array* Grow(Array* old_array, intptr_t top, intptr_t bottom) {
+    Array* new_array = new Array(old_array->Capacity() * 2);
+    for (intptr_t i = top; i < bottom; ++i) {
+      new_array->Put(i, old_array->Get(i));
+    }
+    arrays_.emplace_back(new_array);
+    array_.StoreSequentiallyConsistent(new_array);
+    return new_array;
+  }
+
+  // Index of the oldest element, advanced by thieves and by the owner when taking the last one.
+  Atomic<intptr_t> top_;
+  // Index past the newest element, only written by the owner.
+  Atomic<intptr_t> bottom_;
+  // Current storage.
+  Atomic<Array*> array_;
+  // Every array used by this deque, only accessed by the owner.
+  std::vector<std::unique_ptr<Array>> arrays_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingDeque);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BASE_WORK_STEALING_DEQUE_H_
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "work_stealing_deque.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+TEST(WorkStealingDeque, PushPop) {
+  WorkStealingDeque<intptr_t> deque(4);
+  intptr_t value = 0;
+  EXPECT_TRUE(deque.IsEmpty());
+  EXPECT_FALSE(deque.Pop(&value));
+  EXPECT_FALSE(deque.Steal(&value));
+  // Push past the initial capacity to force the deque to grow.
+  for (intptr_t i = 0; i < 10; ++i) {
+    deque.Push(i);
+  }
+  EXPECT_EQ(10U, deque.Size());
+  EXPECT_GE(deque.Capacity(), 10U);
+  // The owner pops the newest elements, thieves take the oldest ones.
+  ASSERT_TRUE(deque.Pop(&value));
+  EXPECT_EQ(9, value);
+  ASSERT_TRUE(deque.Steal(&value));
+  EXPECT_EQ(0, value);
+  ASSERT_TRUE(deque.Steal(&value));
+  EXPECT_EQ(1, value);
+  for (intptr_t i = 8; i >= 2; --i) {
+    ASSERT_TRUE(deque.Pop(&value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_TRUE(deque.IsEmpty());
+  EXPECT_FALSE(deque.Pop(&value));
+  EXPECT_FALSE(deque.Steal(&value));
+}
+
+static constexpr intptr_t kConcurrentItems = 100000;
+static constexpr size_t kThieves = 3;
+
+struct StealState {
+  WorkStealingDeque<intptr_t>* deque;
+  Atomic<bool>* done;
+  std::vector<intptr_t> stolen;
+};
+
+static void* StealCallback(void* arg) {
+  StealState* state = reinterpret_cast<StealState*>(arg);
+  for (;;) {
+    intptr_t value;
+    if (state->deque->Steal(&value)) {
+      state->stolen.push_back(value);
+    } else if (state->done->LoadSequentiallyConsistent()) {
+      // The owner only sets done once the deque is drained.
+      break;
+    } else {
+      sched_yield();
+    }
+  }
+  return nullptr;
+}
+
+// Every pushed element must be taken exactly once, by either the owner or a thief.
+TEST(WorkStealingDeque, ConcurrentSteal) {
+  WorkStealingDeque<intptr_t> deque(16);
+  Atomic<bool> done(false);
+  StealState states[kThieves];
+  pthread_t threads[kThieves];
+  for (size_t i = 0; i < kThieves; ++i) {
+    states[i].deque = &deque;
+    states[i].done = &done;
+    ASSERT_EQ(0, pthread_create(&threads[i], nullptr, StealCallback, &states[i]));
+  }
+  std::vector<intptr_t> popped;
+  for (intptr_t i = 0; i < kConcurrentItems; ++i) {
+    deque.Push(i);
+    // Pop every other element so that the owner and the thieves race for the bottom.
+    intptr_t value;
+    if ((i & 1) != 0 && deque.Pop(&value)) {
+      popped.push_back(value);
+    }
+  }
+  intptr_t value;
+  while (deque.Pop(&value)) {
+    popped.push_back(value);
+  }
+  done.StoreSequentiallyConsistent(true);
+  std::vector<bool> seen(kConcurrentItems, false);
+  for (size_t i = 0; i < kThieves; ++i) {
+    ASSERT_EQ(0, pthread_join(threads[i], nullptr));
+    for (intptr_t v : states[i].stolen) {
+      ASSERT_FALSE(seen[v]) << v;
+      seen[v] = true;
+    }
+  }
+  for (intptr_t v : popped) {
+    ASSERT_FALSE(seen[v]) << v;
+    seen[v] = true;
+  }
+  for (intptr_t i = 0; i < kConcurrentItems; ++i) {
+    EXPECT_TRUE(seen[i]) << i;
+  }
+}
+
+}  // namespace art
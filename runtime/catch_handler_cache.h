@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_CATCH_HANDLER_CACHE_H_
+#define ART_RUNTIME_CATCH_HANDLER_CACHE_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "globals.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+  class Class;
+}  // namespace mirror
+
+// Per-thread cache of the catch handler searches of ArtMethod::FindCatchBlock. It maps a method,
+// the dex pc of a throwing instruction and the class of the exception to the dex pc of the
+// handler, or to DexFile::kDexNoIndex when the method doesn't catch the exception there. Code
+// that throws the same exceptions over and over skips the decoding of the try items and the
+// resolution of the caught types. Quick exception delivery also keeps the native pc of the
+// handler, valid while the method keeps the code it was computed for.
+//
+// Like the InterpreterCache, it is direct mapped, owned by its thread and cleared with it when
+// the GC visits the roots of the thread.
+class CatchHandlerCache {
+ public:
+  // Number of entries, a power of two.
+  static constexpr size_t kSize = 64;
+
+  CatchHandlerCache() {
+    Clear();
+  }
+
+  // Returns whether the search is cached, and then its handler dex pc and whether the handler
+  // starts without a move-exception. The latter is only set when there is a handler.
+  bool Lookup(mirror::ArtMethod* method, uint32_t dex_pc, mirror::Class* exception_class,
+              uint32_t* handler_dex_pc, bool* has_no_move_exception) const {
+    const Entry& entry = entries_[IndexOf(method, dex_pc, exception_class)];
+    if (!entry.Matches(method, dex_pc, exception_class)) {
+      return false;
+    }
+    *handler_dex_pc = entry.handler_dex_pc;
+    if (entry.handler_dex_pc != kNoHandler) {
+      *has_no_move_exception = entry.has_no_move_exception;
+    }
+    return true;
+  }
+
+  void Insert(mirror::ArtMethod* method, uint32_t dex_pc, mirror::Class* exception_class,
+              uint32_t handler_dex_pc, bool has_no_move_exception) {
+    Entry& entry = entries_[IndexOf(method, dex_pc, exception_class)];
+    entry.method = method;
+    entry.exception_class = exception_class;
+    entry.dex_pc = dex_pc;
+    entry.handler_dex_pc = handler_dex_pc;
+    entry.has_no_move_exception = has_no_move_exception;
+    entry.code = nullptr;
+    entry.handler_native_pc = 0;
+  }
+
+  // Returns the native pc of the handler of a cached search, or 0 if it isn't known for the
+  // current code of the method.
+  uintptr_t GetHandlerNativePc(mirror::ArtMethod* method, uint32_t dex_pc,
+                               mirror::Class* exception_class, const void* code) const {
+    const Entry& entry = entries_[IndexOf(method, dex_pc, exception_class)];
+    return (entry.Matches(method, dex_pc, exception_class) && entry.code == code)
+        ? entry.handler_native_pc : 0;
+  }
+
+  // Records the native pc of the handler of a cached search, in the given code of the method.
+  void SetHandlerNativePc(mirror::ArtMethod* method, uint32_t dex_pc,
+                          mirror::Class* exception_class, const void* code,
+                          uintptr_t handler_native_pc) {
+    Entry& entry = entries_[IndexOf(method, dex_pc, exception_class)];
+    if (entry.Matches(method, dex_pc, exception_class)) {
+      entry.code = code;
+      entry.handler_native_pc = handler_native_pc;
+    }
+  }
+
+  void Clear() {
+    for (Entry& entry : entries_) {
+      entry.method = nullptr;
+      entry.exception_class = nullptr;
+      entry.dex_pc = 0;
+      entry.handler_dex_pc = kNoHandler;
+      entry.has_no_move_exception = false;
+      entry.code = nullptr;
+      entry.handler_native_pc = 0;
+    }
+  }
+
+ private:
+  // DexFile::kDexNoIndex, without including dex_file.h here.
+  static constexpr uint32_t kNoHandler = 0xFFFFFFFFu;
+
+  struct Entry {
+    mirror::ArtMethod* method;
+    mirror::Class* exception_class;
+    uint32_t dex_pc;
+    uint32_t handler_dex_pc;
+    bool has_no_move_exception;
+    // The code the native pc of the handler is in, null if it isn't known.
+    const void* code;
+    uintptr_t handler_native_pc;
+
+    bool Matches(mirror::ArtMethod* m, uint32_t pc, mirror::Class* klass) const {
+      return method == m && dex_pc == pc && exception_class == klass;
+    }
+  };
+
+  static size_t IndexOf(mirror::ArtMethod* method, uint32_t dex_pc,
+                        mirror::Class* exception_class) {
+    // Objects are kObjectAlignment aligned.
+    uintptr_t method_bits = reinterpret_cast<uintptr_t>(method) / kObjectAlignment;
+    uintptr_t class_bits = reinterpret_cast<uintptr_t>(exception_class) / kObjectAlignment;
+    return (method_bits ^ (dex_pc * 7) ^ (class_bits * 31)) & (kSize - 1);
+  }
+
+  Entry entries_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(CatchHandlerCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CATCH_HANDLER_CACHE_H_
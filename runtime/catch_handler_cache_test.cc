@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch_handler_cache.h"
+
+#include <memory>
+
+#include "dex_file.h"
+#include "gtest/gtest.h"
+
+namespace art {
+
+// The cache only compares the pointers, fake addresses with the right alignments are enough.
+static mirror::ArtMethod* const kMethod = reinterpret_cast<mirror::ArtMethod*>(0x60000000);
+static mirror::Class* const kClass = reinterpret_cast<mirror::Class*>(0x70000008);
+
+// A search is keyed by the dex pc of the throwing instruction too.
+TEST(CatchHandlerCache, DexPcs) {
+  std::unique_ptr<CatchHandlerCache> cache(new CatchHandlerCache);
+  cache->Insert(kMethod, 4, kClass, 12, true);
+  cache->Insert(kMethod, 6, kClass, 20, false);
+  uint32_t handler_dex_pc = 0;
+  bool has_no_move_exception = false;
+  ASSERT_TRUE(cache->Lookup(kMethod, 4, kClass, &handler_dex_pc, &has_no_move_exception));
+  EXPECT_EQ(12U, handler_dex_pc);
+  EXPECT_TRUE(has_no_move_exception);
+  ASSERT_TRUE(cache->Lookup(kMethod, 6, kClass, &handler_dex_pc, &has_no_move_exception));
+  EXPECT_EQ(20U, handler_dex_pc);
+  EXPECT_FALSE(has_no_move_exception);
+  EXPECT_FALSE(cache->Lookup(kMethod, 8, kClass, &handler_dex_pc, &has_no_move_exception));
+}
+
+// Searches which found no handler are cached as well.
+TEST(CatchHandlerCache, NoHandler) {
+  std::unique_ptr<CatchHandlerCache> cache(new CatchHandlerCache);
+  cache->Insert(kMethod, 2, kClass, DexFile::kDexNoIndex, false);
+  uint32_t handler_dex_pc = 0;
+  bool has_no_move_exception = true;
+  ASSERT_TRUE(cache->Lookup(kMethod, 2, kClass, &handler_dex_pc, &has_no_move_exception));
+  EXPECT_TRUE(handler_dex_pc == DexFile::kDexNoIndex);
+  // The flag is left alone without a handler.
+  EXPECT_TRUE(has_no_move_exception);
+  cache->Clear();
+  EXPECT_FALSE(cache->Lookup(kMethod, 2, kClass, &handler_dex_pc, &has_no_move_exception));
+}
+
+TEST(CatchHandlerCache, NativePc) {
+  std::unique_ptr<CatchHandlerCache> cache(new CatchHandlerCache);
+  const void* code = reinterpret_cast<const void*>(0x40001000);
+  // Only cached searches keep a native pc.
+  cache->SetHandlerNativePc(kMethod, 4, kClass, code, 0x40001020);
+  EXPECT_EQ(0U, cache->GetHandlerNativePc(kMethod, 4, kClass, code));
+  cache->Insert(kMethod, 4, kClass, 12, false);
+  EXPECT_EQ(0U, cache->GetHandlerNativePc(kMethod, 4, kClass, code));
+  cache->SetHandlerNativePc(kMethod, 4, kClass, code, 0x40001020);
+  EXPECT_EQ(0x40001020U, cache->GetHandlerNativePc(kMethod, 4, kClass, code));
+  // The native pc is only valid for the code it was found in.
+  EXPECT_EQ(0U, cache->GetHandlerNativePc(kMethod, 4, kClass,
+                                          reinterpret_cast<const void*>(0x40002000)));
+  // A new search of the entry forgets it.
+  cache->Insert(kMethod, 4, kClass, 12, false);
+  EXPECT_EQ(0U, cache->GetHandlerNativePc(kMethod, 4, kClass, code));
+}
+
+}  // namespace art
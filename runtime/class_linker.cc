@@ -19,6 +19,7 @@
 #include <fcntl.h>
 #include <sys/file.h>
 #include <sys/stat.h>
+#include <algorithm>
 #include <deque>
 #include <memory>
 #include <string>
@@ -40,6 +41,8 @@
 #include "handle_scope.h"
 #include "intern_table.h"
 #include "interpreter/interpreter.h"
+#include "jit/jit.h"
+#include "jit/jit_code_cache.h"
 #include "leb128.h"
 #include "oat.h"
 #include "oat_file.h"
@@ -56,6 +59,7 @@
 #include "mirror/stack_trace_element.h"
 #include "object_utils.h"
 #include "os.h"
+#include "perf_map.h"
 #include "runtime.h"
 #include "entrypoints/entrypoint_utils.h"
 #include "ScopedLocalRef.h"
@@ -63,6 +67,7 @@
 #include "handle_scope-inl.h"
 #include "thread.h"
 #include "utils.h"
+#include "verifier/background_verifier.h"
 #include "verifier/method_verifier.h"
 #include "well_known_classes.h"
 
@@ -179,6 +184,9 @@ ClassLinker::ClassLinker(InternTable* intern_table)
       init_done_(false),
       log_new_dex_caches_roots_(false),
       log_new_class_table_roots_(false),
+      allow_new_classes_(true),
+      new_classes_lock_("ClassLinker new classes lock"),
+      new_classes_condition_("New classes condition", new_classes_lock_),
       intern_table_(intern_table),
       portable_resolution_trampoline_(nullptr),
       quick_resolution_trampoline_(nullptr),
@@ -190,6 +198,26 @@ ClassLinker::ClassLinker(InternTable* intern_table)
   memset(find_array_class_cache_, 0, kFindArrayCacheSize * sizeof(mirror::Class*));
 }
 
+class ClassLinker::ScopedClassLoadingTimer {
+ public:
+  ScopedClassLoadingTimer(ClassLinker* class_linker, ClassLoadingPhase phase,
+                          const mirror::ClassLoader* class_loader)
+      : counter_(&class_linker->class_loading_counters_[class_loader != nullptr][phase]),
+        start_ns_(NanoTime()) {
+  }
+
+  ~ScopedClassLoadingTimer() {
+    counter_->count.FetchAndAddRelaxed(1);
+    counter_->time_ns.FetchAndAddRelaxed(NanoTime() - start_ns_);
+  }
+
+ private:
+  ClassLoadingCounter* const counter_;
+  const uint64_t start_ns_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedClassLoadingTimer);
+};
+
 // To set a value for generic JNI. May be necessary in compiler tests.
 extern "C" void art_quick_generic_jni_trampoline(mirror::ArtMethod*);
 
@@ -1125,15 +1153,23 @@ void ClassLinker::InitFromImage() {
 void ClassLinker::VisitRoots(RootCallback* callback, void* arg, VisitRootFlags flags) {
   callback(reinterpret_cast<mirror::Object**>(&class_roots_), arg, 0, kRootVMInternal);
   Thread* self = Thread::Current();
+  // The classes and dex caches of the other class loaders are marked through their class loader
+  // and swept by the GC.
+  const bool boot_only = (flags & kVisitRootFlagUnloadClasses) != 0;
   {
     ReaderMutexLock mu(self, dex_lock_);
     if ((flags & kVisitRootFlagAllRoots) != 0) {
       for (mirror::DexCache*& dex_cache : dex_caches_) {
-        callback(reinterpret_cast<mirror::Object**>(&dex_cache), arg, 0, kRootVMInternal);
+        if (!boot_only || IsBootDexCache(dex_cache)) {
+          callback(reinterpret_cast<mirror::Object**>(&dex_cache), arg, 0, kRootVMInternal);
+        }
       }
     } else if ((flags & kVisitRootFlagNewRoots) != 0) {
       for (size_t index : new_dex_cache_roots_) {
-        callback(reinterpret_cast<mirror::Object**>(&dex_caches_[index]), arg, 0, kRootVMInternal);
+        if (!boot_only || IsBootDexCache(dex_caches_[index])) {
+          callback(reinterpret_cast<mirror::Object**>(&dex_caches_[index]), arg, 0,
+                   kRootVMInternal);
+        }
       }
     }
     if ((flags & kVisitRootFlagClearRootLog) != 0) {
@@ -1148,24 +1184,19 @@ void ClassLinker::VisitRoots(RootCallback* callback, void* arg, VisitRootFlags f
   {
     WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
     if ((flags & kVisitRootFlagAllRoots) != 0) {
-      for (std::pair<const size_t, mirror::Class*>& it : class_table_) {
-        callback(reinterpret_cast<mirror::Object**>(&it.second), arg, 0, kRootStickyClass);
-      }
+      class_table_.VisitRoots(callback, arg, kRootStickyClass, boot_only);
     } else if ((flags & kVisitRootFlagNewRoots) != 0) {
       for (auto& pair : new_class_roots_) {
-        mirror::Object* old_ref = pair.second;
+        mirror::Class* old_ref = pair.second;
+        if (boot_only && old_ref->GetClassLoader() != nullptr) {
+          continue;
+        }
         callback(reinterpret_cast<mirror::Object**>(&pair.second), arg, 0, kRootStickyClass);
         if (UNLIKELY(pair.second != old_ref)) {
           // Uh ohes, GC moved a root in the log. Need to search the class_table and update the
           // corresponding object. This is slow, but luckily for us, this may only happen with a
           // concurrent moving GC.
-          for (auto it = class_table_.lower_bound(pair.first), end = class_table_.end();
-              it != end && it->first == pair.first; ++it) {
-            // If the class stored matches the old class, update it to the new value.
-            if (old_ref == it->second) {
-              it->second = pair.second;
-            }
-          }
+          class_table_.Update(pair.first, old_ref, pair.second);
         }
       }
     }
@@ -1177,29 +1208,99 @@ void ClassLinker::VisitRoots(RootCallback* callback, void* arg, VisitRootFlags f
     } else if ((flags & kVisitRootFlagStopLoggingNewRoots) != 0) {
       log_new_class_table_roots_ = false;
     }
-    // We deliberately ignore the class roots in the image since we
-    // handle image roots by using the MS/CMS rescanning of dirty cards.
+    // We deliberately ignore the class roots in the image, including the image section of the
+    // class table, since we handle image roots by using the MS/CMS rescanning of dirty cards.
   }
   callback(reinterpret_cast<mirror::Object**>(&array_iftable_), arg, 0, kRootVMInternal);
   DCHECK(array_iftable_ != nullptr);
   for (size_t i = 0; i < kFindArrayCacheSize; ++i) {
-    if (find_array_class_cache_[i] != nullptr) {
+    if (find_array_class_cache_[i] != nullptr &&
+        (!boot_only || find_array_class_cache_[i]->GetClassLoader() == nullptr)) {
       callback(reinterpret_cast<mirror::Object**>(&find_array_class_cache_[i]), arg, 0,
                kRootVMInternal);
     }
   }
 }
 
+bool ClassLinker::IsBootDexCache(mirror::DexCache* dex_cache) const {
+  return std::find(boot_class_path_.begin(), boot_class_path_.end(), dex_cache->GetDexFile()) !=
+      boot_class_path_.end();
+}
+
+size_t ClassLinker::MarkClassesOfMarkedClassLoaders(IsMarkedCallback* is_marked_callback,
+                                                    MarkObjectCallback* mark_callback, void* arg) {
+  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  return class_table_.MarkClassesOfMarkedClassLoaders(is_marked_callback, mark_callback, arg);
+}
+
+size_t ClassLinker::SweepClassLoaderClasses(IsMarkedCallback* callback, void* arg) {
+  Thread* self = Thread::Current();
+  DCHECK(!allow_new_classes_.LoadRelaxed());
+  size_t num_unloaded;
+  {
+    WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+    num_unloaded = class_table_.SweepClassLoaderClasses(callback, arg);
+  }
+  // The array classes of the cache have the class loader of their component type, which isn't
+  // requested again if it is unloaded.
+  for (size_t i = 0; i < kFindArrayCacheSize; ++i) {
+    mirror::Class* klass = find_array_class_cache_[i];
+    if (klass != nullptr && klass->GetClassLoader() != nullptr) {
+      find_array_class_cache_[i] = down_cast<mirror::Class*>(callback(klass, arg));
+    }
+  }
+  // A dex cache is marked by its classes, the DexFile of an unmarked one is no longer registered
+  // and is freed once its Java DexFile is closed.
+  WriterMutexLock mu(self, dex_lock_);
+  DCHECK(new_dex_cache_roots_.empty());
+  size_t num_dex_caches = 0;
+  for (mirror::DexCache* dex_cache : dex_caches_) {
+    if (!IsBootDexCache(dex_cache)) {
+      mirror::Object* new_dex_cache = callback(dex_cache, arg);
+      if (new_dex_cache == nullptr) {
+        VLOG(class_linker) << "Unloading " << dex_cache->GetDexFile()->GetLocation();
+        continue;
+      }
+      dex_cache = down_cast<mirror::DexCache*>(new_dex_cache);
+    }
+    dex_caches_[num_dex_caches++] = dex_cache;
+  }
+  dex_caches_.resize(num_dex_caches);
+  return num_unloaded;
+}
+
+void ClassLinker::DisallowNewClasses() {
+  MutexLock mu(Thread::Current(), new_classes_lock_);
+  allow_new_classes_.StoreRelaxed(false);
+}
+
+void ClassLinker::AllowNewClasses() {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, new_classes_lock_);
+  allow_new_classes_.StoreRelaxed(true);
+  new_classes_condition_.Broadcast(self);
+}
+
+void ClassLinker::WaitUntilNewClassesAllowed(Thread* self) {
+  // New classes are disallowed with the mutators suspended, the callers don't reach a suspend
+  // point between this and their addition.
+  if (LIKELY(allow_new_classes_.LoadRelaxed())) {
+    return;
+  }
+  MutexLock mu(self, new_classes_lock_);
+  while (!allow_new_classes_.LoadRelaxed()) {
+    new_classes_condition_.WaitHoldingLocks(self);
+  }
+}
+
 void ClassLinker::VisitClasses(ClassVisitor* visitor, void* arg) {
   if (dex_cache_image_class_lookup_required_) {
     MoveImageClassesToClassTable();
   }
-  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-    if (!visitor(it.second, arg)) {
-      return;
-    }
-  }
+  Thread* self = Thread::Current();
+  WaitUntilNewClassesAllowed(self);
+  WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  class_table_.Visit(visitor, arg);
 }
 
 static bool GetClassesVisitor(mirror::Class* c, void* arg) {
@@ -1383,6 +1484,7 @@ mirror::Class* ClassLinker::FindClass(Thread* self, const char* descriptor,
     return EnsureResolved(self, klass);
   }
   // Class is not yet loaded.
+  ScopedClassLoadingTimer timer(this, kClassLoadingFind, class_loader.Get());
   if (descriptor[0] == '[') {
     return CreateArrayClass(self, descriptor, class_loader);
   } else if (class_loader.Get() == nullptr) {
@@ -1453,9 +1555,13 @@ mirror::Class* ClassLinker::DefineClass(const char* descriptor,
                                         Handle<mirror::ClassLoader> class_loader,
                                         const DexFile& dex_file,
                                         const DexFile::ClassDef& dex_class_def) {
+  ScopedClassLoadingTimer timer(this, kClassLoadingDefine, class_loader.Get());
   Thread* self = Thread::Current();
-  StackHandleScope<2> hs(self);
+  StackHandleScope<3> hs(self);
   auto klass = hs.NewHandle<mirror::Class>(nullptr);
+  // Until the class references it, the handle keeps a GC unloading classes from sweeping the dex
+  // cache of a dex file which was just registered.
+  Handle<mirror::DexCache> dex_cache(hs.NewHandle(FindDexCache(dex_file)));
   // Load the class from the dex file.
   if (UNLIKELY(!init_done_)) {
     // finish up init of hand crafted class_roots_
@@ -1481,7 +1587,7 @@ mirror::Class* ClassLinker::DefineClass(const char* descriptor,
     CHECK(self->IsExceptionPending());  // Expect an OOME.
     return NULL;
   }
-  klass->SetDexCache(FindDexCache(dex_file));
+  klass->SetDexCache(dex_cache.Get());
   LoadClass(dex_file, dex_class_def, klass, class_loader.Get());
   // Check for a pending exception during load
   if (self->IsExceptionPending()) {
@@ -1529,9 +1635,30 @@ mirror::Class* ClassLinker::DefineClass(const char* descriptor,
    */
   Dbg::PostClassPrepare(klass.Get());
 
+  verifier::BackgroundVerifier* background_verifier = Runtime::Current()->GetBackgroundVerifier();
+  if (background_verifier != nullptr && !IsVerifiedInOatFile(dex_file, klass.Get())) {
+    background_verifier->AddClass(self, klass.Get());
+  }
+
   return klass.Get();
 }
 
+bool ClassLinker::IsVerifiedInOatFile(const DexFile& dex_file, mirror::Class* klass) {
+  const OatFile* oat_file = FindOpenedOatFileForDexFile(dex_file);
+  if (oat_file == nullptr) {
+    return false;
+  }
+  uint32_t dex_location_checksum = dex_file.GetLocationChecksum();
+  const OatFile::OatDexFile* oat_dex_file = oat_file->GetOatDexFile(dex_file.GetLocation().c_str(),
+                                                                    &dex_location_checksum);
+  if (oat_dex_file == nullptr) {
+    return false;
+  }
+  mirror::Class::Status status =
+      oat_dex_file->GetOatClass(klass->GetDexClassDefIndex()).GetStatus();
+  return status == mirror::Class::kStatusVerified || status == mirror::Class::kStatusInitialized;
+}
+
 // Precomputes size that will be needed for Class, matching LinkStaticFields
 uint32_t ClassLinker::SizeOfClass(const DexFile& dex_file,
                                 const DexFile::ClassDef& dex_class_def) {
@@ -1657,6 +1784,17 @@ const void* ClassLinker::GetQuickOatCodeFor(mirror::ArtMethod* method) {
   if (method->IsProxyMethod()) {
     return GetQuickProxyInvokeHandler();
   }
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    // Code compiled at runtime takes over from the interpreter, e.g. when the stubs installed by
+    // the instrumentation are removed.
+    MethodHelper mh(method);
+    const void* code = jit->GetCodeCache()->GetCodeFor(
+        Thread::Current(), MethodReference(&mh.GetDexFile(), method->GetDexMethodIndex()));
+    if (code != nullptr) {
+      return code;
+    }
+  }
   const void* result = GetOatMethodFor(method).GetQuickCode();
   if (result == nullptr) {
     if (method->IsNative()) {
@@ -1797,9 +1935,7 @@ void ClassLinker::FixupStaticTrampolines(mirror::Class* klass) {
 void ClassLinker::LinkCode(Handle<mirror::ArtMethod> method, const OatFile::OatClass* oat_class,
                            const DexFile& dex_file, uint32_t dex_method_index,
                            uint32_t method_index) {
-  // Method shouldn't have already been linked.
-  DCHECK(method->GetEntryPointFromQuickCompiledCode() == nullptr);
-  DCHECK(method->GetEntryPointFromPortableCompiledCode() == nullptr);
+  // The method may run in the interpreter until here, see LinkCodeToInterpreter.
   // Every kind of method should at least get an invoke stub from the oat_method.
   // non-abstract methods also get their code pointers.
   const OatFile::OatMethod oat_method = oat_class->GetOatMethod(method_index);
@@ -1847,16 +1983,12 @@ void ClassLinker::LinkCode(Handle<mirror::ArtMethod> method, const OatFile::OatC
     method->SetEntryPointFromPortableCompiledCode(GetPortableToQuickBridge());
   }
 
-  if (method->IsNative()) {
-    // Unregistering restores the dlsym lookup stub.
-    method->UnregisterNative(Thread::Current());
-
-    if (enter_interpreter) {
-      // We have a native method here without code. Then it should have either the GenericJni
-      // trampoline as entrypoint (non-static), or the Resolution trampoline (static).
-      DCHECK(method->GetEntryPointFromQuickCompiledCode() == GetQuickResolutionTrampoline()
-          || method->GetEntryPointFromQuickCompiledCode() == GetQuickGenericJniTrampoline());
-    }
+  if (method->IsNative() && enter_interpreter) {
+    // We have a native method here without code. Then it should have either the GenericJni
+    // trampoline as entrypoint (non-static), or the Resolution trampoline (static). The native
+    // method itself was registered or set to the dlsym lookup stub by LinkCodeToInterpreter.
+    DCHECK(method->GetEntryPointFromQuickCompiledCode() == GetQuickResolutionTrampoline()
+        || method->GetEntryPointFromQuickCompiledCode() == GetQuickGenericJniTrampoline());
   }
 
   // Allow instrumentation its chance to hijack code.
@@ -1864,12 +1996,93 @@ void ClassLinker::LinkCode(Handle<mirror::ArtMethod> method, const OatFile::OatC
                                                    method->GetEntryPointFromQuickCompiledCode(),
                                                    method->GetEntryPointFromPortableCompiledCode(),
                                                    have_portable_code);
+
+  PerfMap* perf_map = runtime->GetPerfMap();
+  if (perf_map != nullptr && oat_method.GetQuickCode() != nullptr) {
+    perf_map->AddMethod(method.Get(),
+                        mirror::ArtMethod::EntryPointToCodePointer(oat_method.GetQuickCode()),
+                        oat_method.GetQuickCodeSize());
+  }
+}
+
+void ClassLinker::LinkCodeToInterpreter(Handle<mirror::ArtMethod> method) {
+  // Method shouldn't have already been linked.
+  DCHECK(method->GetEntryPointFromQuickCompiledCode() == nullptr);
+  DCHECK(method->GetEntryPointFromPortableCompiledCode() == nullptr);
+  // Same entry points as LinkCode gives to a method without compiled code, except that native
+  // methods are entered through the compiled code bridge.
+  if (method->IsNative()) {
+    method->SetEntryPointFromInterpreter(artInterpreterToCompiledCodeBridge);
+  } else {
+    method->SetEntryPointFromInterpreter(interpreter::artInterpreterToInterpreterBridge);
+  }
+  if (method->IsStatic() && !method->IsConstructor()) {
+    method->SetEntryPointFromQuickCompiledCode(GetQuickResolutionTrampoline());
+    method->SetEntryPointFromPortableCompiledCode(GetPortableResolutionTrampoline());
+  } else if (!method->IsNative()) {
+    method->SetEntryPointFromQuickCompiledCode(GetQuickToInterpreterBridge());
+    method->SetEntryPointFromPortableCompiledCode(GetPortableToInterpreterBridge());
+  } else {
+    method->SetEntryPointFromQuickCompiledCode(GetQuickGenericJniTrampoline());
+    method->SetEntryPointFromPortableCompiledCode(GetPortableToQuickBridge());
+  }
+
+  if (method->IsNative()) {
+    // Unregistering restores the dlsym lookup stub. It is done once here, natives may be
+    // registered before the class is initialized and its code is linked.
+    method->UnregisterNative(Thread::Current());
+  }
+
+  // Allow instrumentation its chance to hijack code.
+  Runtime::Current()->GetInstrumentation()->UpdateMethodsCode(
+      method.Get(), method->GetEntryPointFromQuickCompiledCode(),
+      method->GetEntryPointFromPortableCompiledCode(), false);
+}
+
+void ClassLinker::LinkClassCode(Handle<mirror::Class> klass) {
+  DCHECK(klass->HasUnlinkedCode()) << PrettyDescriptor(klass.Get());
+  klass->SetHasUnlinkedCode(false);
+  const DexFile& dex_file = klass->GetDexFile();
+  const DexFile::ClassDef* dex_class_def = klass->GetClassDef();
+  CHECK(dex_class_def != nullptr);
+  const byte* class_data = dex_file.GetClassData(*dex_class_def);
+  // There should always be class data if there were methods to link.
+  CHECK(class_data != nullptr) << PrettyDescriptor(klass.Get());
+  const OatFile::OatClass oat_class = GetOatClass(dex_file, klass->GetDexClassDefIndex());
+  ClassDataItemIterator it(dex_file, class_data);
+  // Skip fields
+  while (it.HasNextStaticField()) {
+    it.Next();
+  }
+  while (it.HasNextInstanceField()) {
+    it.Next();
+  }
+  Thread* self = Thread::Current();
+  size_t class_def_method_index = 0;
+  for (size_t i = 0; it.HasNextDirectMethod(); i++, it.Next()) {
+    StackHandleScope<1> hs(self);
+    Handle<mirror::ArtMethod> method(hs.NewHandle(klass->GetDirectMethod(i)));
+    LinkCode(method, &oat_class, dex_file, it.GetMemberIndex(), class_def_method_index);
+    class_def_method_index++;
+  }
+  // The miranda methods appended by LinkInterfaceMethods follow the methods of the class.
+  for (size_t i = 0; it.HasNextVirtualMethod(); i++, it.Next()) {
+    StackHandleScope<1> hs(self);
+    Handle<mirror::ArtMethod> method(hs.NewHandle(klass->GetVirtualMethod(i)));
+    // Abstract methods have no code, their interpreter entry points are final.
+    if (!method->IsAbstract()) {
+      LinkCode(method, &oat_class, dex_file, it.GetMemberIndex(), class_def_method_index);
+    }
+    class_def_method_index++;
+  }
+  DCHECK(!it.HasNext());
 }
 
 void ClassLinker::LoadClass(const DexFile& dex_file,
                             const DexFile::ClassDef& dex_class_def,
                             Handle<mirror::Class> klass,
                             mirror::ClassLoader* class_loader) {
+  ScopedClassLoadingTimer timer(this, kClassLoadingLoad, class_loader);
   CHECK(klass.Get() != NULL);
   CHECK(klass->GetDexCache() != NULL);
   CHECK_EQ(mirror::Class::kStatusNotReady, klass->GetStatus());
@@ -1896,19 +2109,18 @@ void ClassLinker::LoadClass(const DexFile& dex_file,
     return;  // no fields or methods - for example a marker interface
   }
 
-  if (Runtime::Current()->IsStarted() && !Runtime::Current()->UseCompileTimeClassPath()) {
-    const OatFile::OatClass oat_class = GetOatClass(dex_file, klass->GetDexClassDefIndex());
-    LoadClassMembers(dex_file, class_data, klass, class_loader, &oat_class);
-  } else {
-    LoadClassMembers(dex_file, class_data, klass, class_loader, nullptr);
-  }
+  // Most methods of a loaded class never run, their compiled code is only looked up in the oat
+  // file by LinkClassCode when the class is initialized.
+  const bool link_code = Runtime::Current()->IsStarted() &&
+      !Runtime::Current()->UseCompileTimeClassPath();
+  LoadClassMembers(dex_file, class_data, klass, class_loader, link_code);
 }
 
 void ClassLinker::LoadClassMembers(const DexFile& dex_file,
                                    const byte* class_data,
                                    Handle<mirror::Class> klass,
                                    mirror::ClassLoader* class_loader,
-                                   const OatFile::OatClass* oat_class) {
+                                   bool link_code) {
   // Load fields.
   ClassDataItemIterator it(dex_file, class_data);
   Thread* self = Thread::Current();
@@ -1980,8 +2192,8 @@ void ClassLinker::LoadClassMembers(const DexFile& dex_file,
       return;
     }
     klass->SetDirectMethod(i, method.Get());
-    if (oat_class != nullptr) {
-      LinkCode(method, oat_class, dex_file, it.GetMemberIndex(), class_def_method_index);
+    if (link_code) {
+      LinkCodeToInterpreter(method);
     }
     method->SetMethodIndex(class_def_method_index);
     class_def_method_index++;
@@ -1995,12 +2207,15 @@ void ClassLinker::LoadClassMembers(const DexFile& dex_file,
     }
     klass->SetVirtualMethod(i, method.Get());
     DCHECK_EQ(class_def_method_index, it.NumDirectMethods() + i);
-    if (oat_class != nullptr) {
-      LinkCode(method, oat_class, dex_file, it.GetMemberIndex(), class_def_method_index);
+    if (link_code) {
+      LinkCodeToInterpreter(method);
     }
     class_def_method_index++;
   }
   DCHECK(!it.HasNext());
+  if (link_code && class_def_method_index != 0) {
+    klass->SetHasUnlinkedCode(true);
+  }
 }
 
 void ClassLinker::LoadField(const DexFile& /*dex_file*/, const ClassDataItemIterator& it,
@@ -2133,6 +2348,7 @@ void ClassLinker::RegisterDexFile(const DexFile& dex_file) {
   StackHandleScope<1> hs(self);
   Handle<mirror::DexCache> dex_cache(hs.NewHandle(AllocDexCache(self, dex_file)));
   CHECK(dex_cache.Get() != NULL) << "Failed to allocate dex cache for " << dex_file.GetLocation();
+  WaitUntilNewClassesAllowed(self);
   {
     WriterMutexLock mu(self, dex_lock_);
     if (IsDexFileRegisteredLocked(dex_file)) {
@@ -2144,10 +2360,101 @@ void ClassLinker::RegisterDexFile(const DexFile& dex_file) {
 
 void ClassLinker::RegisterDexFile(const DexFile& dex_file,
                                   Handle<mirror::DexCache> dex_cache) {
-  WriterMutexLock mu(Thread::Current(), dex_lock_);
+  Thread* self = Thread::Current();
+  WaitUntilNewClassesAllowed(self);
+  WriterMutexLock mu(self, dex_lock_);
   RegisterDexFileLocked(dex_file, dex_cache);
 }
 
+bool ClassLinker::OpenAppImage(const DexFile& dex_file, Handle<mirror::ClassLoader> class_loader) {
+  Runtime* runtime = Runtime::Current();
+  // The image holds compiled code entry points, which the instrumentation doesn't know about.
+  if (runtime->IsCompiler() || class_loader.Get() == nullptr ||
+      runtime->GetInstrumentation()->InterpretOnly() || IsDexFileRegistered(dex_file)) {
+    return false;
+  }
+  const OatFile* oat_file = FindOpenedOatFileForDexFile(dex_file);
+  if (oat_file == nullptr) {
+    return false;
+  }
+  const std::string image_location(
+      ImageHeader::GetAppImageLocationFromOatLocation(oat_file->GetLocation()));
+  if (!OS::FileExists(image_location.c_str())) {
+    return false;
+  }
+  std::string error_msg;
+  std::unique_ptr<gc::space::ImageSpace> space(
+      gc::space::ImageSpace::CreateAppImage(image_location.c_str(), *oat_file, &error_msg));
+  if (space.get() == nullptr) {
+    LOG(WARNING) << "Not using app image: " << error_msg;
+    return false;
+  }
+  const ImageHeader& image_header = space->GetImageHeader();
+  mirror::ObjectArray<mirror::DexCache>* dex_caches =
+      image_header.GetImageRoot(ImageHeader::kDexCaches)->AsObjectArray<mirror::DexCache>();
+  if (dex_caches->GetLength() != 1 || !dex_caches->Get(0)->GetLocation()->Equals(
+      dex_file.GetLocation())) {
+    LOG(WARNING) << "Not using app image " << image_location << " written for other dex files than "
+                 << dex_file.GetLocation();
+    return false;
+  }
+  // Nothing may suspend before the space is part of the heap, the GC doesn't know its objects.
+  gc::space::ImageSpace* image_space = space.release();
+  runtime->GetHeap()->AddAppImageSpace(image_space);
+
+  Thread* self = Thread::Current();
+  StackHandleScope<2> hs(self);
+  Handle<mirror::DexCache> dex_cache(hs.NewHandle(dex_caches->Get(0)));
+  Handle<mirror::ObjectArray<mirror::Class>> classes(hs.NewHandle(
+      image_header.GetImageRoot(ImageHeader::kClassRoots)->AsObjectArray<mirror::Class>()));
+  // The strings of the image are only unique within it, the ones the code finds through the dex
+  // cache must be the interned ones of the runtime.
+  for (size_t i = 0; i < dex_cache->NumStrings(); ++i) {
+    mirror::String* string = dex_cache->GetResolvedString(i);
+    if (string != nullptr) {
+      mirror::String* interned = intern_table_->InternStrong(string);
+      if (interned != string) {
+        dex_cache->SetResolvedString(i, interned);
+      }
+    }
+  }
+  std::vector<std::string> descriptors;
+  for (int32_t i = 0; i < classes->GetLength(); ++i) {
+    descriptors.push_back(classes->Get(i)->GetDescriptor());
+  }
+  // The classes and the dex cache are published together, so that no class of the dex file is
+  // defined again for the class loader.
+  WaitUntilNewClassesAllowed(self);
+  WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  for (const std::string& descriptor : descriptors) {
+    if (class_table_.Lookup(descriptor.c_str(), class_loader.Get(),
+                            Hash(descriptor.c_str())) != nullptr) {
+      LOG(WARNING) << "Not using app image " << image_location << ", " << descriptor
+                   << " is already defined";
+      return false;
+    }
+  }
+  {
+    WriterMutexLock mu2(self, dex_lock_);
+    if (IsDexFileRegisteredLocked(dex_file)) {
+      return false;
+    }
+    RegisterDexFileLocked(dex_file, dex_cache);
+  }
+  for (int32_t i = 0; i < classes->GetLength(); ++i) {
+    mirror::Class* klass = classes->Get(i);
+    klass->SetClassLoader(class_loader.Get());
+    size_t hash = Hash(descriptors[i].c_str());
+    class_table_.Insert(klass, hash);
+    if (log_new_class_table_roots_) {
+      new_class_roots_.push_back(std::make_pair(hash, klass));
+    }
+  }
+  VLOG(class_linker) << "Using app image " << image_location << " with " << descriptors.size()
+                     << " classes";
+  return true;
+}
+
 mirror::DexCache* ClassLinker::FindDexCache(const DexFile& dex_file) const {
   ReaderMutexLock mu(Thread::Current(), dex_lock_);
   // Search assuming unique-ness of dex file.
@@ -2383,9 +2690,10 @@ mirror::Class* ClassLinker::InsertClass(const char* descriptor, mirror::Class* k
     }
     LOG(INFO) << "Loaded class " << descriptor << source;
   }
-  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  mirror::Class* existing =
-      LookupClassFromTableLocked(descriptor, klass->GetClassLoader(), hash);
+  Thread* self = Thread::Current();
+  WaitUntilNewClassesAllowed(self);
+  WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  mirror::Class* existing = class_table_.Lookup(descriptor, klass->GetClassLoader(), hash);
   if (existing != NULL) {
     return existing;
   }
@@ -2398,7 +2706,7 @@ mirror::Class* ClassLinker::InsertClass(const char* descriptor, mirror::Class* k
     }
   }
   VerifyObject(klass);
-  class_table_.insert(std::make_pair(hash, klass));
+  class_table_.Insert(klass, hash);
   if (log_new_class_table_roots_) {
     new_class_roots_.push_back(std::make_pair(hash, klass));
   }
@@ -2408,33 +2716,22 @@ mirror::Class* ClassLinker::InsertClass(const char* descriptor, mirror::Class* k
 bool ClassLinker::RemoveClass(const char* descriptor, const mirror::ClassLoader* class_loader) {
   size_t hash = Hash(descriptor);
   WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  for (auto it = class_table_.lower_bound(hash), end = class_table_.end();
-       it != end && it->first == hash;
-       ++it) {
-    mirror::Class* klass = it->second;
-    if (klass->GetClassLoader() == class_loader && klass->DescriptorEquals(descriptor)) {
-      class_table_.erase(it);
-      return true;
-    }
-  }
-  return false;
+  return class_table_.Remove(descriptor, class_loader, hash);
 }
 
 mirror::Class* ClassLinker::LookupClass(const char* descriptor,
                                         const mirror::ClassLoader* class_loader) {
   size_t hash = Hash(descriptor);
-  {
-    ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-    mirror::Class* result = LookupClassFromTableLocked(descriptor, class_loader, hash);
-    if (result != NULL) {
-      return result;
-    }
+  // The class table lookups don't need the classlinker_classes_lock_.
+  mirror::Class* result = class_table_.Lookup(descriptor, class_loader, hash);
+  if (result != NULL) {
+    return result;
   }
   if (class_loader != NULL || !dex_cache_image_class_lookup_required_) {
     return NULL;
   } else {
     // Lookup failed but need to search dex_caches_.
-    mirror::Class* result = LookupClassFromImage(descriptor);
+    result = LookupClassFromImage(descriptor);
     if (result != NULL) {
       InsertClass(descriptor, result, hash);
     } else {
@@ -2450,29 +2747,6 @@ mirror::Class* ClassLinker::LookupClass(const char* descriptor,
   }
 }
 
-mirror::Class* ClassLinker::LookupClassFromTableLocked(const char* descriptor,
-                                                       const mirror::ClassLoader* class_loader,
-                                                       size_t hash) {
-  auto end = class_table_.end();
-  for (auto it = class_table_.lower_bound(hash); it != end && it->first == hash; ++it) {
-    mirror::Class* klass = it->second;
-    if (klass->GetClassLoader() == class_loader && klass->DescriptorEquals(descriptor)) {
-      if (kIsDebugBuild) {
-        // Check for duplicates in the table.
-        for (++it; it != end && it->first == hash; ++it) {
-          mirror::Class* klass2 = it->second;
-          CHECK(!(klass2->GetClassLoader() == class_loader &&
-              klass2->DescriptorEquals(descriptor)))
-              << PrettyClass(klass) << " " << klass << " " << klass->GetClassLoader() << " "
-              << PrettyClass(klass2) << " " << klass2 << " " << klass2->GetClassLoader();
-        }
-      }
-      return klass;
-    }
-  }
-  return NULL;
-}
-
 static mirror::ObjectArray<mirror::DexCache>* GetImageDexCaches()
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   gc::space::ImageSpace* image = Runtime::Current()->GetHeap()->GetImageSpace();
@@ -2489,6 +2763,8 @@ void ClassLinker::MoveImageClassesToClassTable() {
   }
   const char* old_no_suspend_cause =
       self->StartAssertNoThreadSuspension("Moving image classes to class table");
+  std::vector<std::pair<size_t, mirror::Class*>> image_classes;
+  std::set<mirror::Class*> seen_classes;
   mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches();
   for (int32_t i = 0; i < dex_caches->GetLength(); i++) {
     mirror::DexCache* dex_cache = dex_caches->Get(i);
@@ -2499,19 +2775,19 @@ void ClassLinker::MoveImageClassesToClassTable() {
         DCHECK(klass->GetClassLoader() == NULL);
         std::string descriptor = klass->GetDescriptor();
         size_t hash = Hash(descriptor.c_str());
-        mirror::Class* existing = LookupClassFromTableLocked(descriptor.c_str(), NULL, hash);
+        mirror::Class* existing = class_table_.Lookup(descriptor.c_str(), NULL, hash);
         if (existing != NULL) {
           CHECK(existing == klass) << PrettyClassAndClassLoader(existing) << " != "
               << PrettyClassAndClassLoader(klass);
-        } else {
-          class_table_.insert(std::make_pair(hash, klass));
-          if (log_new_class_table_roots_) {
-            new_class_roots_.push_back(std::make_pair(hash, klass));
-          }
+        } else if (seen_classes.insert(klass).second) {
+          // The same class may be resolved in several of the image dex caches.
+          image_classes.push_back(std::make_pair(hash, klass));
         }
       }
     }
   }
+  // The image classes never move, they don't need to be logged as new roots.
+  class_table_.SetImageClasses(image_classes);
   dex_cache_image_class_lookup_required_ = false;
   self->EndAssertNoThreadSuspension(old_no_suspend_cause);
 }
@@ -2548,15 +2824,8 @@ void ClassLinker::LookupClasses(const char* descriptor, std::vector<mirror::Clas
   if (dex_cache_image_class_lookup_required_) {
     MoveImageClassesToClassTable();
   }
-  size_t hash = Hash(descriptor);
-  ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  for (auto it = class_table_.lower_bound(hash), end = class_table_.end();
-      it != end && it->first == hash; ++it) {
-    mirror::Class* klass = it->second;
-    if (klass->DescriptorEquals(descriptor)) {
-      result.push_back(klass);
-    }
-  }
+  WaitUntilNewClassesAllowed(Thread::Current());
+  class_table_.LookupAll(descriptor, Hash(descriptor), &result);
 }
 
 void ClassLinker::VerifyClass(Handle<mirror::Class> klass) {
@@ -2577,6 +2846,7 @@ void ClassLinker::VerifyClass(Handle<mirror::Class> klass) {
     return;
   }
 
+  ScopedClassLoadingTimer timer(this, kClassLoadingVerify, klass->GetClassLoader());
   if (klass->GetStatus() == mirror::Class::kStatusResolved) {
     klass->SetStatus(mirror::Class::kStatusVerifying, self);
   } else {
@@ -2700,7 +2970,7 @@ bool ClassLinker::VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class
   // If we're compiling, we can only verify the class using the oat file if
   // we are not compiling the image or if the class we're verifying is not part of
   // the app.  In other words, we will only check for preverification of bootclasspath
-  // classes.
+  // classes. App classes may have been verified by an earlier compilation instead.
   if (Runtime::Current()->IsCompiler()) {
     // Are we compiling the bootclasspath?
     if (!Runtime::Current()->UseCompileTimeClassPath()) {
@@ -2710,7 +2980,8 @@ bool ClassLinker::VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class
 
     // Is this an app class? (I.e. not a bootclasspath class)
     if (klass->GetClassLoader() != NULL) {
-      return false;
+      // An earlier compilation of the same dex file may have verified it.
+      return Runtime::Current()->GetCompilerCallbacks()->RestoreVerifiedClass(klass);
     }
   }
 
@@ -3129,6 +3400,7 @@ bool ClassLinker::InitializeClass(Handle<mirror::Class> klass, bool can_init_sta
   if (!CanWeInitializeClass(klass.Get(), can_init_statics, can_init_parents)) {
     return false;
   }
+  ScopedClassLoadingTimer timer(this, kClassLoadingInitialize, klass->GetClassLoader());
 
   Thread* self = Thread::Current();
   uint64_t t0;
@@ -3185,6 +3457,12 @@ bool ClassLinker::InitializeClass(Handle<mirror::Class> klass, bool can_init_sta
 
     CHECK_EQ(klass->GetStatus(), mirror::Class::kStatusVerified) << PrettyClass(klass.Get());
 
+    // Link the compiled code before <clinit> and other threads may call the methods, which run in
+    // the interpreter until then.
+    if (klass->HasUnlinkedCode()) {
+      LinkClassCode(klass);
+    }
+
     // From here out other threads may observe that we're initializing and so changes of state
     // require the a notification.
     klass->SetClinitThreadId(self->GetTid());
@@ -3396,11 +3674,14 @@ bool ClassLinker::LinkClass(Thread* self, Handle<mirror::Class> klass,
   if (!LinkMethods(klass, interfaces)) {
     return false;
   }
-  if (!LinkInstanceFields(klass)) {
-    return false;
-  }
-  if (!LinkStaticFields(klass)) {
-    return false;
+  {
+    ScopedClassLoadingTimer timer(this, kClassLoadingLinkFields, klass->GetClassLoader());
+    if (!LinkInstanceFields(klass)) {
+      return false;
+    }
+    if (!LinkStaticFields(klass)) {
+      return false;
+    }
   }
   CreateReferenceInstanceOffsets(klass);
   CreateReferenceStaticOffsets(klass);
@@ -3534,6 +3815,7 @@ bool ClassLinker::LinkMethods(Handle<mirror::Class> klass,
 }
 
 bool ClassLinker::LinkVirtualMethods(Handle<mirror::Class> klass) {
+  ScopedClassLoadingTimer timer(this, kClassLoadingLinkVTable, klass->GetClassLoader());
   Thread* self = Thread::Current();
   if (klass->HasSuperClass()) {
     uint32_t max_count = (klass->NumVirtualMethods() +
@@ -3622,6 +3904,7 @@ bool ClassLinker::LinkVirtualMethods(Handle<mirror::Class> klass) {
 
 bool ClassLinker::LinkInterfaceMethods(Handle<mirror::Class> klass,
                                        Handle<mirror::ObjectArray<mirror::Class>> interfaces) {
+  ScopedClassLoadingTimer timer(this, kClassLoadingLinkInterfaces, klass->GetClassLoader());
   Thread* const self = Thread::Current();
   // Set the imt table to be all conflicts by default.
   klass->SetImTable(Runtime::Current()->GetDefaultImt());
@@ -4413,6 +4696,11 @@ const char* ClassLinker::MethodShorty(uint32_t method_idx, mirror::ArtMethod* re
   return dex_file.GetMethodShorty(method_id, length);
 }
 
+static bool GetClassesInVectorVisitor(mirror::Class* c, void* arg) {
+  reinterpret_cast<std::vector<mirror::Class*>*>(arg)->push_back(c);
+  return true;
+}
+
 void ClassLinker::DumpAllClasses(int flags) {
   if (dex_cache_image_class_lookup_required_) {
     MoveImageClassesToClassTable();
@@ -4422,9 +4710,7 @@ void ClassLinker::DumpAllClasses(int flags) {
   std::vector<mirror::Class*> all_classes;
   {
     ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-    for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-      all_classes.push_back(it.second);
-    }
+    class_table_.Visit(GetClassesInVectorVisitor, &all_classes);
   }
 
   for (size_t i = 0; i < all_classes.size(); ++i) {
@@ -4432,12 +4718,49 @@ void ClassLinker::DumpAllClasses(int flags) {
   }
 }
 
+// Counts the entries of a resolved array of a dex cache that hold more than the initial value.
+template <typename T>
+static size_t CountResolved(mirror::ObjectArray<T>* array, T* unresolved)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  size_t count = 0;
+  for (int32_t i = 0, length = array->GetLength(); i != length; ++i) {
+    T* entry = array->GetWithoutChecks(i);
+    if (entry != nullptr && entry != unresolved) {
+      ++count;
+    }
+  }
+  return count;
+}
+
 void ClassLinker::DumpForSigQuit(std::ostream& os) {
   if (dex_cache_image_class_lookup_required_) {
     MoveImageClassesToClassTable();
   }
-  ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  os << "Loaded classes: " << class_table_.size() << " allocated classes\n";
+  Thread* self = Thread::Current();
+  {
+    ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+    os << "Loaded classes: " << class_table_.Size() << " allocated classes\n";
+  }
+  // The resolved arrays are sized by the ids of the dex files, which shows how much of them the
+  // process uses, per dex file outside of the image.
+  gc::space::ImageSpace* image_space = Runtime::Current()->GetHeap()->GetImageSpace();
+  mirror::ArtMethod* resolution_method = Runtime::Current()->GetResolutionMethod();
+  ReaderMutexLock mu(self, dex_lock_);
+  for (mirror::DexCache* dex_cache : dex_caches_) {
+    if (image_space != nullptr && image_space->HasAddress(dex_cache)) {
+      continue;
+    }
+    const size_t entries = dex_cache->NumStrings() + dex_cache->NumResolvedTypes() +
+        dex_cache->NumResolvedMethods() + dex_cache->NumResolvedFields();
+    const size_t resolved =
+        CountResolved<mirror::String>(dex_cache->GetStrings(), nullptr) +
+        CountResolved<mirror::Class>(dex_cache->GetResolvedTypes(), nullptr) +
+        CountResolved<mirror::ArtMethod>(dex_cache->GetResolvedMethods(), resolution_method) +
+        CountResolved<mirror::ArtField>(dex_cache->GetResolvedFields(), nullptr);
+    os << "Dex cache " << dex_cache->GetDexFile()->GetLocation() << ": " << resolved << " of "
+       << entries << " entries resolved, "
+       << PrettySize(entries * sizeof(mirror::HeapReference<mirror::Object>)) << "\n";
+  }
 }
 
 size_t ClassLinker::NumLoadedClasses() {
@@ -4445,7 +4768,27 @@ size_t ClassLinker::NumLoadedClasses() {
     MoveImageClassesToClassTable();
   }
   ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  return class_table_.size();
+  return class_table_.Size();
+}
+
+void ClassLinker::GetClassLoadingMetrics(
+    std::vector<std::pair<std::string, uint64_t>>* metrics) const {
+  static const char* const kLoaderNames[] = { "boot", "app" };
+  static const char* const kPhaseNames[] = {
+    "find", "define", "load", "link-vtable", "link-interfaces", "link-fields", "verify",
+    "initialize",
+  };
+  COMPILE_ASSERT(arraysize(kPhaseNames) == static_cast<size_t>(kClassLoadingPhaseCount),
+                 phase_names_out_of_sync);
+  for (size_t loader = 0; loader < arraysize(kLoaderNames); ++loader) {
+    for (size_t phase = 0; phase < kClassLoadingPhaseCount; ++phase) {
+      const ClassLoadingCounter& counter = class_loading_counters_[loader][phase];
+      const std::string prefix = std::string("art.class-loading.") + kLoaderNames[loader] + "." +
+          kPhaseNames[phase] + ".";
+      metrics->push_back(std::make_pair(prefix + "count", counter.count.LoadRelaxed()));
+      metrics->push_back(std::make_pair(prefix + "time-ns", counter.time_ns.LoadRelaxed()));
+    }
+  }
 }
 
 pid_t ClassLinker::GetClassesLockOwner() {
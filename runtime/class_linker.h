@@ -23,6 +23,7 @@
 
 #include "base/macros.h"
 #include "base/mutex.h"
+#include "class_table.h"
 #include "dex_file.h"
 #include "gtest/gtest.h"
 #include "jni.h"
@@ -49,16 +50,18 @@ template<class T> class ObjectLock;
 class ScopedObjectAccessAlreadyRunnable;
 template<class T> class Handle;
 
-typedef bool (ClassVisitor)(mirror::Class* c, void* arg);
-
 enum VisitRootFlags : uint8_t;
 
 class ClassLinker {
  public:
   // Interface method table size. Increasing this value reduces the chance of two interface methods
   // colliding in the interface method table but increases the size of classes that implement
-  // (non-marker) interfaces.
+  // (non-marker) interfaces. Set with ART_IMT_SIZE at build time.
+#if defined(ART_IMT_SIZE)
+  static constexpr size_t kImtSize = ART_IMT_SIZE;
+#else
   static constexpr size_t kImtSize = 64;
+#endif
 
   explicit ClassLinker(InternTable* intern_table);
   ~ClassLinker();
@@ -127,6 +130,25 @@ class ClassLinker {
       LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // The timed phases of loading a class. They nest: finding a class which isn't loaded yet
+  // includes defining it, which includes loading and linking it and finding its superclasses.
+  enum ClassLoadingPhase {
+    kClassLoadingFind,
+    kClassLoadingDefine,
+    kClassLoadingLoad,
+    kClassLoadingLinkVTable,
+    kClassLoadingLinkInterfaces,
+    kClassLoadingLinkFields,
+    kClassLoadingVerify,
+    kClassLoadingInitialize,
+    kClassLoadingPhaseCount,
+  };
+
+  // Appends the count and time of each class loading phase since the start, separately for the
+  // boot class loader and for all the other class loaders, as the
+  // "art.class-loading.<loader>.<phase>.count" and ".time-ns" metrics.
+  void GetClassLoadingMetrics(std::vector<std::pair<std::string, uint64_t>>* metrics) const;
+
   // Resolve a String with the given index from the DexFile, storing the
   // result in the DexCache. The referrer is used to identify the
   // target DexCache and ClassLoader to use for resolution.
@@ -234,6 +256,13 @@ class ClassLinker {
   const OatFile* RegisterOatFile(const OatFile* oat_file)
       LOCKS_EXCLUDED(dex_lock_);
 
+  // Registers the dex file with the dex cache and classes of the app image written with its oat
+  // file, defined by class_loader. Returns false if there is no usable app image, the dex file is
+  // then registered as usual.
+  bool OpenAppImage(const DexFile& dex_file, Handle<mirror::ClassLoader> class_loader)
+      LOCKS_EXCLUDED(dex_lock_, Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   const std::vector<const DexFile*>& GetBootClassPath() {
     return boot_class_path_;
   }
@@ -250,6 +279,26 @@ class ClassLinker {
   void VisitRoots(RootCallback* callback, void* arg, VisitRootFlags flags)
       LOCKS_EXCLUDED(Locks::classlinker_classes_lock_, dex_lock_);
 
+  // Marks the unmarked classes whose class loader is marked, for a GC which visited the roots with
+  // kVisitRootFlagUnloadClasses. Returns the number of classes marked, the GC repeats this after
+  // processing its mark stack until it returns zero.
+  size_t MarkClassesOfMarkedClassLoaders(IsMarkedCallback* is_marked_callback,
+                                         MarkObjectCallback* mark_callback, void* arg)
+      LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Removes the unmarked classes of the class loaders and their dex caches once the marking of a
+  // GC which visited the roots with kVisitRootFlagUnloadClasses is done. Returns the number of
+  // classes removed, which the GC may only free once no lookup still probes them.
+  size_t SweepClassLoaderClasses(IsMarkedCallback* callback, void* arg)
+      LOCKS_EXCLUDED(Locks::classlinker_classes_lock_, dex_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // The classes and dex caches added between the pause of a GC unloading classes and its sweep
+  // would not be marked, their additions wait, as do the visits of all the classes.
+  void DisallowNewClasses() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void AllowNewClasses() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   mirror::DexCache* FindDexCache(const DexFile& dex_file) const
       LOCKS_EXCLUDED(dex_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -447,7 +496,7 @@ class ClassLinker {
                         const byte* class_data,
                         Handle<mirror::Class> klass,
                         mirror::ClassLoader* class_loader,
-                        const OatFile::OatClass* oat_class)
+                        bool link_code)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void LoadField(const DexFile& dex_file, const ClassDataItemIterator& it,
@@ -462,6 +511,10 @@ class ClassLinker {
   void FixupStaticTrampolines(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Finds the associated oat class for a dex_file and descriptor
+  // Whether the oat file has the class as verified, so that it needs no verification at runtime.
+  bool IsVerifiedInOatFile(const DexFile& dex_file, mirror::Class* klass)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   OatFile::OatClass GetOatClass(const DexFile& dex_file, uint16_t class_def_idx)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -519,6 +572,12 @@ class ClassLinker {
   void LinkCode(Handle<mirror::ArtMethod> method, const OatFile::OatClass* oat_class,
                 const DexFile& dex_file, uint32_t dex_method_index, uint32_t method_index)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Sets up a loaded method to run without its compiled code, which is linked by LinkClassCode.
+  void LinkCodeToInterpreter(Handle<mirror::ArtMethod> method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Links the compiled code of the methods of a class loaded with HasUnlinkedCode.
+  void LinkClassCode(Handle<mirror::Class> klass)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
 
   void CreateReferenceInstanceOffsets(Handle<mirror::Class> klass)
@@ -561,6 +620,20 @@ class ClassLinker {
                                        Handle<mirror::ArtMethod> prototype)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Whether the dex cache is one of the boot class path, which are never unloaded.
+  bool IsBootDexCache(mirror::DexCache* dex_cache) const;
+
+  // Waits while a GC unloading classes hasn't swept them yet.
+  void WaitUntilNewClassesAllowed(Thread* self) LOCKS_EXCLUDED(new_classes_lock_);
+
+  // Counts a class loading phase and adds its duration when it goes out of scope.
+  class ScopedClassLoadingTimer;
+
+  struct ClassLoadingCounter {
+    Atomic<uint64_t> count;
+    Atomic<uint64_t> time_ns;
+  };
+
   std::vector<const DexFile*> boot_class_path_;
 
   mutable ReaderWriterMutex dex_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
@@ -569,12 +642,11 @@ class ClassLinker {
   std::vector<const OatFile*> oat_files_ GUARDED_BY(dex_lock_);
 
 
-  // multimap from a string hash code of a class descriptor to
-  // mirror::Class* instances. Results should be compared for a matching
-  // Class::descriptor_ and Class::class_loader_.
-  typedef std::multimap<size_t, mirror::Class*> Table;
-  Table class_table_ GUARDED_BY(Locks::classlinker_classes_lock_);
-  std::vector<std::pair<size_t, mirror::Class*>> new_class_roots_;
+  // The loaded classes keyed by the string hash code of their descriptor. Lookups are lock free,
+  // modifications require the classlinker_classes_lock_.
+  ClassTable class_table_;
+  std::vector<std::pair<size_t, mirror::Class*>> new_class_roots_
+      GUARDED_BY(Locks::classlinker_classes_lock_);
 
   // Do we need to search dex caches to find image classes?
   bool dex_cache_image_class_lookup_required_;
@@ -582,11 +654,6 @@ class ClassLinker {
   // the classes into the class_table_ to avoid dex cache based searches.
   AtomicInteger failed_dex_cache_class_lookups_;
 
-  mirror::Class* LookupClassFromTableLocked(const char* descriptor,
-                                            const mirror::ClassLoader* class_loader,
-                                            size_t hash)
-      SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_, Locks::mutator_lock_);
-
   void MoveImageClassesToClassTable() LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   mirror::Class* LookupClassFromImage(const char* descriptor)
@@ -665,8 +732,19 @@ class ClassLinker {
   bool log_new_dex_caches_roots_ GUARDED_BY(dex_lock_);
   bool log_new_class_table_roots_ GUARDED_BY(Locks::classlinker_classes_lock_);
 
+  // Cleared by DisallowNewClasses with the mutators suspended, so the adders that see it set
+  // don't take new_classes_lock_ since they don't reach a suspend point before they are done.
+  Atomic<bool> allow_new_classes_;
+  Mutex new_classes_lock_;
+  ConditionVariable new_classes_condition_ GUARDED_BY(new_classes_lock_);
+
   InternTable* intern_table_;
 
+  // Indexed by whether the class loader is another one than the boot class loader, then by phase.
+  // Class loaders are neither stable keys under a moving GC nor kept alive, so the other class
+  // loaders share their counters.
+  ClassLoadingCounter class_loading_counters_[2][kClassLoadingPhaseCount];
+
   const void* portable_resolution_trampoline_;
   const void* quick_resolution_trampoline_;
   const void* portable_imt_conflict_trampoline_;
@@ -18,6 +18,8 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "class_linker-inl.h"
 #include "common_runtime_test.h"
@@ -1115,4 +1117,56 @@ TEST_F(ClassLinkerTest, ClassRootDescriptors) {
   }
 }
 
+static uint64_t GetClassLoadingMetric(ClassLinker* class_linker, const std::string& name) {
+  std::vector<std::pair<std::string, uint64_t>> metrics;
+  class_linker->GetClassLoadingMetrics(&metrics);
+  for (const auto& metric : metrics) {
+    if (metric.first == name) {
+      return metric.second;
+    }
+  }
+  ADD_FAILURE() << "No class loading metric " << name;
+  return 0;
+}
+
+// Loads the classes of the core library which aren't loaded yet, as a benchmark of cold class
+// loading. The time of each phase is logged with -verbose:class.
+TEST_F(ClassLinkerTest, ClassLoadingMetrics) {
+  ScopedObjectAccess soa(Thread::Current());
+  std::vector<const char*> cold_descriptors;
+  for (size_t i = 0; i < java_lang_dex_file_->NumClassDefs(); ++i) {
+    const char* descriptor =
+        java_lang_dex_file_->GetClassDescriptor(java_lang_dex_file_->GetClassDef(i));
+    if (class_linker_->LookupClass(descriptor, nullptr) == nullptr) {
+      cold_descriptors.push_back(descriptor);
+    }
+  }
+  ASSERT_FALSE(cold_descriptors.empty());
+  const uint64_t define_count =
+      GetClassLoadingMetric(class_linker_, "art.class-loading.boot.define.count");
+  const uint64_t link_fields_count =
+      GetClassLoadingMetric(class_linker_, "art.class-loading.boot.link-fields.count");
+  const uint64_t start_ns = NanoTime();
+  for (const char* descriptor : cold_descriptors) {
+    EXPECT_TRUE(class_linker_->FindSystemClass(soa.Self(), descriptor) != nullptr) << descriptor;
+  }
+  const uint64_t duration_ns = NanoTime() - start_ns;
+
+  // Each class was defined and linked, at least once when another thread raced to define it.
+  EXPECT_GE(GetClassLoadingMetric(class_linker_, "art.class-loading.boot.define.count"),
+            define_count + cold_descriptors.size());
+  EXPECT_GE(GetClassLoadingMetric(class_linker_, "art.class-loading.boot.link-fields.count"),
+            link_fields_count + cold_descriptors.size());
+  EXPECT_EQ(0U, GetClassLoadingMetric(class_linker_, "art.class-loading.app.define.count"));
+  VLOG(class_linker) << "Loaded " << cold_descriptors.size() << " classes in "
+                     << PrettyDuration(duration_ns);
+  if (VLOG_IS_ON(class_linker)) {
+    std::vector<std::pair<std::string, uint64_t>> metrics;
+    class_linker_->GetClassLoadingMetrics(&metrics);
+    for (const auto& metric : metrics) {
+      VLOG(class_linker) << metric.first << "=" << metric.second;
+    }
+  }
+}
+
 }  // namespace art
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_table.h"
+
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "utils.h"
+
+namespace art {
+
+mirror::Class* const ClassTable::kRemovedClass = reinterpret_cast<mirror::Class*>(1);
+
+ClassTable::Shard::Shard() : array(nullptr), used(0), removed(0) {
+}
+
+ClassTable::ClassTable() : image_classes_(nullptr), num_image_classes_(0) {
+  for (Shard& shard : shards_) {
+    shard.arrays.emplace_back(new Array(kInitialShardCapacity));
+    shard.array.StoreRelaxed(shard.arrays.back().get());
+  }
+}
+
+ClassTable::~ClassTable() {
+}
+
+mirror::Class* ClassTable::LookupInArray(Array* array, const char* descriptor,
+                                         const mirror::ClassLoader* class_loader, size_t hash) {
+  for (size_t index = GetIndex(hash); ; ++index) {
+    Slot* slot = array->GetSlot(index);
+    // Pairs with the release in InsertIntoArray, the hash of a published class is visible.
+    mirror::Class* klass = slot->klass.LoadSequentiallyConsistent();
+    if (klass == nullptr) {
+      return nullptr;
+    }
+    if (klass != kRemovedClass && slot->hash.LoadRelaxed() == hash &&
+        klass->GetClassLoader() == class_loader && klass->DescriptorEquals(descriptor)) {
+      return klass;
+    }
+  }
+}
+
+void ClassTable::LookupAllInArray(Array* array, const char* descriptor, size_t hash,
+                                  std::vector<mirror::Class*>* classes) {
+  for (size_t index = GetIndex(hash); ; ++index) {
+    Slot* slot = array->GetSlot(index);
+    mirror::Class* klass = slot->klass.LoadSequentiallyConsistent();
+    if (klass == nullptr) {
+      return;
+    }
+    if (klass != kRemovedClass && slot->hash.LoadRelaxed() == hash &&
+        klass->DescriptorEquals(descriptor)) {
+      classes->push_back(klass);
+    }
+  }
+}
+
+void ClassTable::InsertIntoArray(Array* array, mirror::Class* klass, size_t hash) {
+  for (size_t index = GetIndex(hash); ; ++index) {
+    Slot* slot = array->GetSlot(index);
+    if (slot->klass.LoadRelaxed() == nullptr) {
+      slot->hash.StoreRelaxed(hash);
+      // Publish the class after its hash.
+      slot->klass.StoreSequentiallyConsistent(klass);
+      return;
+    }
+  }
+}
+
+mirror::Class* ClassTable::Lookup(const char* descriptor, const mirror::ClassLoader* class_loader,
+                                  size_t hash) {
+  if (class_loader == nullptr) {
+    Array* image_classes = image_classes_.LoadSequentiallyConsistent();
+    if (image_classes != nullptr) {
+      mirror::Class* klass = LookupInArray(image_classes, descriptor, class_loader, hash);
+      if (klass != nullptr) {
+        return klass;
+      }
+    }
+  }
+  Array* array = GetShard(hash)->array.LoadSequentiallyConsistent();
+  return LookupInArray(array, descriptor, class_loader, hash);
+}
+
+void ClassTable::LookupAll(const char* descriptor, size_t hash,
+                           std::vector<mirror::Class*>* classes) {
+  Array* image_classes = image_classes_.LoadSequentiallyConsistent();
+  if (image_classes != nullptr) {
+    LookupAllInArray(image_classes, descriptor, hash, classes);
+  }
+  LookupAllInArray(GetShard(hash)->array.LoadSequentiallyConsistent(), descriptor, hash, classes);
+}
+
+void ClassTable::EnsureCapacity(Shard* shard) {
+  Array* array = shard->array.LoadRelaxed();
+  const size_t capacity = array->Capacity();
+  // Keep the load factor, removed slots included, under 1/2 so that the probes stay short.
+  if ((shard->used + shard->removed + 1) * 2 <= capacity) {
+    return;
+  }
+  // Rehash at the same size if it is mostly removed slots, grow otherwise.
+  size_t new_capacity = capacity;
+  while ((shard->used + 1) * 4 > new_capacity) {
+    new_capacity *= 2;
+  }
+  Array* new_array = new Array(new_capacity);
+  for (size_t i = 0; i < capacity; ++i) {
+    Slot* slot = array->GetSlot(i);
+    mirror::Class* klass = slot->klass.LoadRelaxed();
+    if (klass != nullptr && klass != kRemovedClass) {
+      InsertIntoArray(new_array, klass, slot->hash.LoadRelaxed());
+    }
+  }
+  shard->arrays.emplace_back(new_array);
+  shard->removed = 0;
+  // Publish the new array once it is filled.
+  shard->array.StoreSequentiallyConsistent(new_array);
+}
+
+void ClassTable::Insert(mirror::Class* klass, size_t hash) {
+  DCHECK(klass != nullptr);
+  Shard* shard = GetShard(hash);
+  EnsureCapacity(shard);
+  InsertIntoArray(shard->array.LoadRelaxed(), klass, hash);
+  ++shard->used;
+}
+
+bool ClassTable::Remove(const char* descriptor, const mirror::ClassLoader* class_loader,
+                        size_t hash) {
+  Shard* shard = GetShard(hash);
+  Array* array = shard->array.LoadRelaxed();
+  for (size_t index = GetIndex(hash); ; ++index) {
+    Slot* slot = array->GetSlot(index);
+    mirror::Class* klass = slot->klass.LoadRelaxed();
+    if (klass == nullptr) {
+      return false;
+    }
+    if (klass != kRemovedClass && slot->hash.LoadRelaxed() == hash &&
+        klass->GetClassLoader() == class_loader && klass->DescriptorEquals(descriptor)) {
+      // Keep the slot so that the probe sequences going through it are not cut short.
+      slot->klass.StoreSequentiallyConsistent(kRemovedClass);
+      --shard->used;
+      ++shard->removed;
+      return true;
+    }
+  }
+}
+
+bool ClassTable::Update(size_t hash, mirror::Class* old_klass, mirror::Class* new_klass) {
+  Array* array = GetShard(hash)->array.LoadRelaxed();
+  for (size_t index = GetIndex(hash); ; ++index) {
+    Slot* slot = array->GetSlot(index);
+    mirror::Class* klass = slot->klass.LoadRelaxed();
+    if (klass == nullptr) {
+      return false;
+    }
+    if (klass == old_klass) {
+      slot->klass.StoreSequentiallyConsistent(new_klass);
+      return true;
+    }
+  }
+}
+
+void ClassTable::SetImageClasses(const std::vector<std::pair<size_t, mirror::Class*>>& classes) {
+  CHECK(image_classes_storage_.get() == nullptr) << "Image classes already set";
+  size_t capacity = kInitialShardCapacity;
+  while (classes.size() * 2 >= capacity) {
+    capacity *= 2;
+  }
+  image_classes_storage_.reset(new Array(capacity));
+  for (const std::pair<size_t, mirror::Class*>& pair : classes) {
+    InsertIntoArray(image_classes_storage_.get(), pair.second, pair.first);
+  }
+  num_image_classes_ = classes.size();
+  image_classes_.StoreSequentiallyConsistent(image_classes_storage_.get());
+}
+
+bool ClassTable::Visit(ClassVisitor* visitor, void* arg) {
+  Array* image_classes = image_classes_.LoadRelaxed();
+  if (image_classes != nullptr) {
+    for (size_t i = 0, capacity = image_classes->Capacity(); i < capacity; ++i) {
+      mirror::Class* klass = image_classes->GetSlot(i)->klass.LoadRelaxed();
+      if (klass != nullptr && !visitor(klass, arg)) {
+        return false;
+      }
+    }
+  }
+  for (Shard& shard : shards_) {
+    Array* array = shard.array.LoadRelaxed();
+    for (size_t i = 0, capacity = array->Capacity(); i < capacity; ++i) {
+      mirror::Class* klass = array->GetSlot(i)->klass.LoadRelaxed();
+      if (klass != nullptr && klass != kRemovedClass && !visitor(klass, arg)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void ClassTable::VisitRoots(RootCallback* callback, void* arg, RootType root_type,
+                            bool boot_only) {
+  for (Shard& shard : shards_) {
+    Array* array = shard.array.LoadRelaxed();
+    for (size_t i = 0, capacity = array->Capacity(); i < capacity; ++i) {
+      Slot* slot = array->GetSlot(i);
+      mirror::Class* klass = slot->klass.LoadRelaxed();
+      if (klass != nullptr && klass != kRemovedClass &&
+          (!boot_only || klass->GetClassLoader() == nullptr)) {
+        mirror::Object* root = klass;
+        callback(&root, arg, 0, root_type);
+        if (root != klass) {
+          slot->klass.StoreSequentiallyConsistent(down_cast<mirror::Class*>(root));
+        }
+      }
+    }
+  }
+}
+
+size_t ClassTable::MarkClassesOfMarkedClassLoaders(IsMarkedCallback* is_marked_callback,
+                                                   MarkObjectCallback* mark_callback, void* arg) {
+  size_t count = 0;
+  for (Shard& shard : shards_) {
+    Array* array = shard.array.LoadRelaxed();
+    for (size_t i = 0, capacity = array->Capacity(); i < capacity; ++i) {
+      mirror::Class* klass = array->GetSlot(i)->klass.LoadRelaxed();
+      if (klass == nullptr || klass == kRemovedClass) {
+        continue;
+      }
+      mirror::ClassLoader* class_loader = klass->GetClassLoader();
+      if (class_loader != nullptr && is_marked_callback(klass, arg) == nullptr &&
+          is_marked_callback(class_loader, arg) != nullptr) {
+        mark_callback(klass, arg);
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+size_t ClassTable::SweepClassLoaderClasses(IsMarkedCallback* callback, void* arg) {
+  size_t count = 0;
+  for (Shard& shard : shards_) {
+    Array* array = shard.array.LoadRelaxed();
+    for (size_t i = 0, capacity = array->Capacity(); i < capacity; ++i) {
+      Slot* slot = array->GetSlot(i);
+      mirror::Class* klass = slot->klass.LoadRelaxed();
+      if (klass == nullptr || klass == kRemovedClass || klass->GetClassLoader() == nullptr) {
+        continue;
+      }
+      mirror::Object* new_klass = callback(klass, arg);
+      if (new_klass == nullptr) {
+        slot->klass.StoreSequentiallyConsistent(kRemovedClass);
+        --shard.used;
+        ++shard.removed;
+        ++count;
+      } else if (new_klass != klass) {
+        slot->klass.StoreSequentiallyConsistent(down_cast<mirror::Class*>(new_klass));
+      }
+    }
+  }
+  return count;
+}
+
+size_t ClassTable::Size() const {
+  size_t size = num_image_classes_;
+  for (const Shard& shard : shards_) {
+    size += shard.used;
+  }
+  return size;
+}
+
+}  // namespace art
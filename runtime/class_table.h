@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CLASS_TABLE_H_
+#define ART_RUNTIME_CLASS_TABLE_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "object_callbacks.h"
+
+namespace art {
+
+namespace mirror {
+  class Class;
+  class ClassLoader;
+}  // namespace mirror
+
+typedef bool (ClassVisitor)(mirror::Class* c, void* arg);
+
+// The loaded classes of the ClassLinker, keyed by the hash of their descriptor. Lookups take no
+// lock and may run concurrently with the writers, which are serialized by
+// Locks::classlinker_classes_lock_.
+//
+// The classes are spread over shards by descriptor hash, each shard being an open addressing hash
+// table. A reader loads the current array of a shard and probes it, a writer only ever fills empty
+// slots or marks slots as removed, so the reader always sees a consistent table. Growing a shard
+// publishes a new array; the old arrays are kept until the table is destroyed since readers may
+// still be probing them. Their contents are never seen across a GC since the readers don't suspend
+// in the middle of a lookup.
+//
+// The image classes are in a separate section which is built once, by SetImageClasses, and is
+// read-only afterwards. It isn't visited as roots since the image classes never move.
+class ClassTable {
+ public:
+  ClassTable();
+  ~ClassTable();
+
+  // Returns the class with the given descriptor and class loader, or null. Lock free.
+  mirror::Class* Lookup(const char* descriptor, const mirror::ClassLoader* class_loader,
+                        size_t hash)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Appends every class with the given descriptor to classes, regardless of class loader. Lock
+  // free.
+  void LookupAll(const char* descriptor, size_t hash, std::vector<mirror::Class*>* classes)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Adds a class which must not be in the table yet.
+  void Insert(mirror::Class* klass, size_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  // Removes the class with the given descriptor and class loader, returns false if there is none.
+  // Image classes can't be removed.
+  bool Remove(const char* descriptor, const mirror::ClassLoader* class_loader, size_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Replaces old_klass by new_klass after the GC moved it, returns false if old_klass isn't in the
+  // table.
+  bool Update(size_t hash, mirror::Class* old_klass, mirror::Class* new_klass)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  // Installs the read-only image section, may only be called once. The classes must not be in the
+  // table yet.
+  void SetImageClasses(const std::vector<std::pair<size_t, mirror::Class*>>& classes)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  // Calls the visitor on all of the classes, including the image section, until it returns false.
+  // Returns false if the visitor stopped the iteration.
+  bool Visit(ClassVisitor* visitor, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  // Visits the classes outside of the image section as roots, only the ones of the boot class
+  // loader if boot_only.
+  void VisitRoots(RootCallback* callback, void* arg, RootType root_type, bool boot_only)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Marks the unmarked classes of marked class loaders, returns how many were marked.
+  size_t MarkClassesOfMarkedClassLoaders(IsMarkedCallback* is_marked_callback,
+                                         MarkObjectCallback* mark_callback, void* arg)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Removes the unmarked classes of the class loaders other than the boot one and updates the
+  // moved ones, returns how many were removed. The lookups may still probe the removed classes
+  // until they reach a suspend point.
+  size_t SweepClassLoaderClasses(IsMarkedCallback* callback, void* arg)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  size_t Size() const SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+ private:
+  static constexpr size_t kShardCount = 16;
+  static constexpr size_t kShardShift = 4;
+  static constexpr size_t kInitialShardCapacity = 64;
+
+  struct Slot {
+    // Written before the class is published.
+    Atomic<size_t> hash;
+    // Null if the slot was never used, kRemovedClass if its class was removed.
+    Atomic<mirror::Class*> klass;
+  };
+
+  // A power of two sized array of slots using linear probing.
+  class Array {
+   public:
+    explicit Array(size_t capacity) : mask_(capacity - 1), slots_(new Slot[capacity]) {}
+
+    size_t Capacity() const {
+      return mask_ + 1;
+    }
+
+    Slot* GetSlot(size_t index) {
+      return &slots_[index & mask_];
+    }
+
+   private:
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+
+    DISALLOW_COPY_AND_ASSIGN(Array);
+  };
+
+  struct Shard {
+    Shard();
+
+    // The current array, read by the lock free lookups.
+    Atomic<Array*> array;
+    // Number of live and removed slots of the current array.
+    size_t used GUARDED_BY(Locks::classlinker_classes_lock_);
+    size_t removed GUARDED_BY(Locks::classlinker_classes_lock_);
+    // Every array of this shard, including the ones that were grown out of.
+    std::vector<std::unique_ptr<Array>> arrays GUARDED_BY(Locks::classlinker_classes_lock_);
+  };
+
+  static mirror::Class* const kRemovedClass;
+
+  Shard* GetShard(size_t hash) {
+    return &shards_[hash & (kShardCount - 1)];
+  }
+
+  // The index of the first slot to probe, the low bits select the shard.
+  static size_t GetIndex(size_t hash) {
+    return hash >> kShardShift;
+  }
+
+  static mirror::Class* LookupInArray(Array* array, const char* descriptor,
+                                      const mirror::ClassLoader* class_loader, size_t hash)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static void LookupAllInArray(Array* array, const char* descriptor, size_t hash,
+                               std::vector<mirror::Class*>* classes)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Stores into the first empty slot, the caller makes sure there is one.
+  static void InsertIntoArray(Array* array, mirror::Class* klass, size_t hash);
+
+  // Grows or rehashes the shard so that one more class can be inserted.
+  void EnsureCapacity(Shard* shard) EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  Shard shards_[kShardCount];
+
+  // The read-only image section, null if not set yet.
+  Atomic<Array*> image_classes_;
+  std::unique_ptr<Array> image_classes_storage_ GUARDED_BY(Locks::classlinker_classes_lock_);
+  size_t num_image_classes_ GUARDED_BY(Locks::classlinker_classes_lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(ClassTable);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CLASS_TABLE_H_
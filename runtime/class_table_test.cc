@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_table.h"
+
+#include <set>
+
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "utf.h"
+
+namespace art {
+
+class ClassTableTest : public CommonRuntimeTest {};
+
+static const char* const kDescriptors[] = {
+    "Ljava/lang/Object;", "Ljava/lang/String;", "Ljava/lang/Class;", "Ljava/lang/Thread;",
+    "Ljava/lang/Integer;", "Ljava/lang/Long;", "Ljava/lang/Short;", "Ljava/lang/Byte;",
+    "Ljava/lang/Character;", "Ljava/lang/Boolean;", "Ljava/lang/Float;", "Ljava/lang/Double;",
+    "Ljava/lang/Throwable;", "Ljava/lang/Exception;", "Ljava/lang/Error;",
+    "Ljava/lang/ClassLoader;", "[Ljava/lang/Object;", "[Ljava/lang/String;", "[I", "[J", "[B",
+    "I", "J", "Z",
+};
+
+static bool CountVisitor(mirror::Class* /*klass*/, void* arg) {
+  ++*reinterpret_cast<size_t*>(arg);
+  return true;
+}
+
+TEST_F(ClassTableTest, InsertLookupRemove) {
+  ScopedObjectAccess soa(Thread::Current());
+  // Enough classes to spread over the shards.
+  std::vector<mirror::Class*> classes;
+  for (const char* descriptor : kDescriptors) {
+    mirror::Class* klass = class_linker_->FindSystemClass(soa.Self(), descriptor);
+    ASSERT_TRUE(klass != nullptr) << descriptor;
+    classes.push_back(klass);
+  }
+  ClassTable table;
+  WriterMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
+  for (size_t i = 0; i < arraysize(kDescriptors); ++i) {
+    const size_t hash = ComputeModifiedUtf8Hash(kDescriptors[i]);
+    EXPECT_TRUE(table.Lookup(kDescriptors[i], nullptr, hash) == nullptr);
+    table.Insert(classes[i], hash);
+  }
+  EXPECT_EQ(arraysize(kDescriptors), table.Size());
+  for (size_t i = 0; i < arraysize(kDescriptors); ++i) {
+    const size_t hash = ComputeModifiedUtf8Hash(kDescriptors[i]);
+    EXPECT_EQ(classes[i], table.Lookup(kDescriptors[i], nullptr, hash));
+    std::vector<mirror::Class*> all;
+    table.LookupAll(kDescriptors[i], hash, &all);
+    ASSERT_EQ(1U, all.size());
+    EXPECT_EQ(classes[i], all[0]);
+  }
+  size_t count = 0;
+  EXPECT_TRUE(table.Visit(CountVisitor, &count));
+  EXPECT_EQ(arraysize(kDescriptors), count);
+
+  // Remove every other class, the others must still be found past the removed slots.
+  for (size_t i = 0; i < arraysize(kDescriptors); i += 2) {
+    const size_t hash = ComputeModifiedUtf8Hash(kDescriptors[i]);
+    EXPECT_TRUE(table.Remove(kDescriptors[i], nullptr, hash));
+    EXPECT_FALSE(table.Remove(kDescriptors[i], nullptr, hash));
+  }
+  for (size_t i = 0; i < arraysize(kDescriptors); ++i) {
+    const size_t hash = ComputeModifiedUtf8Hash(kDescriptors[i]);
+    mirror::Class* expected = (i % 2 == 0) ? nullptr : classes[i];
+    EXPECT_EQ(expected, table.Lookup(kDescriptors[i], nullptr, hash)) << kDescriptors[i];
+  }
+  EXPECT_EQ(arraysize(kDescriptors) / 2, table.Size());
+}
+
+TEST_F(ClassTableTest, ImageClasses) {
+  ScopedObjectAccess soa(Thread::Current());
+  const char* image_descriptor = "Ljava/lang/Object;";
+  const char* descriptor = "Ljava/lang/String;";
+  mirror::Class* image_class = class_linker_->FindSystemClass(soa.Self(), image_descriptor);
+  mirror::Class* klass = class_linker_->FindSystemClass(soa.Self(), descriptor);
+  ClassTable table;
+  WriterMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
+  std::vector<std::pair<size_t, mirror::Class*>> image_classes;
+  image_classes.push_back(std::make_pair(ComputeModifiedUtf8Hash(image_descriptor), image_class));
+  table.SetImageClasses(image_classes);
+  table.Insert(klass, ComputeModifiedUtf8Hash(descriptor));
+  EXPECT_EQ(image_class,
+            table.Lookup(image_descriptor, nullptr, ComputeModifiedUtf8Hash(image_descriptor)));
+  EXPECT_EQ(klass, table.Lookup(descriptor, nullptr, ComputeModifiedUtf8Hash(descriptor)));
+  EXPECT_EQ(2U, table.Size());
+  size_t count = 0;
+  EXPECT_TRUE(table.Visit(CountVisitor, &count));
+  EXPECT_EQ(2U, count);
+  // Image classes are read-only.
+  EXPECT_FALSE(table.Remove(image_descriptor, nullptr, ComputeModifiedUtf8Hash(image_descriptor)));
+}
+
+// The objects of the set are the marked ones, marking adds to it.
+static mirror::Object* IsInSetCallback(mirror::Object* object, void* arg) {
+  std::set<mirror::Object*>* marked = reinterpret_cast<std::set<mirror::Object*>*>(arg);
+  return marked->find(object) != marked->end() ? object : nullptr;
+}
+
+static mirror::Object* AddToSetCallback(mirror::Object* object, void* arg) {
+  reinterpret_cast<std::set<mirror::Object*>*>(arg)->insert(object);
+  return object;
+}
+
+TEST_F(ClassTableTest, SweepClassLoaderClasses) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<3> hs(soa.Self());
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader*>(LoadDex("Nested"))));
+  Handle<mirror::Class> outer(
+      hs.NewHandle(class_linker_->FindClass(soa.Self(), "LNested;", class_loader)));
+  Handle<mirror::Class> inner(
+      hs.NewHandle(class_linker_->FindClass(soa.Self(), "LNested$Inner;", class_loader)));
+  ASSERT_TRUE(outer.Get() != nullptr);
+  ASSERT_TRUE(inner.Get() != nullptr);
+  const char* boot_descriptor = "Ljava/lang/String;";
+  mirror::Class* boot_class = class_linker_->FindSystemClass(soa.Self(), boot_descriptor);
+  ClassTable table;
+  WriterMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
+  table.Insert(outer.Get(), ComputeModifiedUtf8Hash("LNested;"));
+  table.Insert(inner.Get(), ComputeModifiedUtf8Hash("LNested$Inner;"));
+  table.Insert(boot_class, ComputeModifiedUtf8Hash(boot_descriptor));
+
+  // Nothing is marked through an unmarked class loader.
+  std::set<mirror::Object*> marked;
+  marked.insert(inner.Get());
+  EXPECT_EQ(0U, table.MarkClassesOfMarkedClassLoaders(IsInSetCallback, AddToSetCallback,
+                                                      &marked));
+  EXPECT_EQ(1U, marked.size());
+
+  // The unmarked classes of the class loaders are removed, the boot classes are roots.
+  EXPECT_EQ(1U, table.SweepClassLoaderClasses(IsInSetCallback, &marked));
+  EXPECT_TRUE(table.Lookup("LNested;", class_loader.Get(),
+                           ComputeModifiedUtf8Hash("LNested;")) == nullptr);
+  EXPECT_EQ(inner.Get(), table.Lookup("LNested$Inner;", class_loader.Get(),
+                                      ComputeModifiedUtf8Hash("LNested$Inner;")));
+  EXPECT_EQ(boot_class, table.Lookup(boot_descriptor, nullptr,
+                                     ComputeModifiedUtf8Hash(boot_descriptor)));
+  EXPECT_EQ(2U, table.Size());
+
+  // A marked class loader keeps all of its classes.
+  table.Insert(outer.Get(), ComputeModifiedUtf8Hash("LNested;"));
+  marked.insert(class_loader.Get());
+  EXPECT_EQ(1U, table.MarkClassesOfMarkedClassLoaders(IsInSetCallback, AddToSetCallback,
+                                                      &marked));
+  EXPECT_EQ(0U, table.MarkClassesOfMarkedClassLoaders(IsInSetCallback, AddToSetCallback,
+                                                      &marked));
+  EXPECT_EQ(0U, table.SweepClassLoaderClasses(IsInSetCallback, &marked));
+  EXPECT_EQ(3U, table.Size());
+}
+
+}  // namespace art
@@ -22,9 +22,16 @@
 
 namespace art {
 
+namespace mirror {
+
+class Class;
+
+}  // namespace mirror
+
 namespace verifier {
 
 class MethodVerifier;
+class VerifierDeps;
 
 }  // namespace verifier
 
@@ -36,6 +43,19 @@ class CompilerCallbacks {
         SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) = 0;
     virtual void ClassRejected(ClassReference ref) = 0;
 
+    // The dependencies of the verification on the classes outside of the dex files being
+    // compiled, null if they are not recorded.
+    virtual verifier::VerifierDeps* GetVerifierDeps() const {
+      return nullptr;
+    }
+
+    // Returns true if the results of the verification of the class by an earlier compilation
+    // were restored, in which case the class doesn't need to be verified again.
+    virtual bool RestoreVerifiedClass(mirror::Class* klass)
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+      return false;
+    }
+
   protected:
     CompilerCallbacks() { }
 };
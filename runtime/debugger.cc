@@ -240,6 +240,25 @@ uint32_t Dbg::instrumentation_events_ = 0;
 // Breakpoints.
 static std::vector<Breakpoint> gBreakpoints GUARDED_BY(Locks::breakpoint_lock_);
 
+// One bit per hash of the methods holding breakpoints, rebuilt whenever gBreakpoints changes or
+// its methods are visited by the GC. Every dex pc of a deoptimized method is checked for a
+// breakpoint, and with full deoptimization that is every dex pc of every thread; a clear bit
+// answers those checks without taking breakpoint_lock_ or scanning gBreakpoints.
+static Atomic<uint64_t> gBreakpointMethodFilter(0);
+
+static uint64_t BreakpointMethodFilterBit(const mirror::ArtMethod* m) {
+  uintptr_t bits = reinterpret_cast<uintptr_t>(m) / kObjectAlignment;
+  return static_cast<uint64_t>(1) << ((bits ^ (bits >> 6)) % 64);
+}
+
+static void UpdateBreakpointMethodFilter() EXCLUSIVE_LOCKS_REQUIRED(Locks::breakpoint_lock_) {
+  uint64_t filter = 0;
+  for (const Breakpoint& breakpoint : gBreakpoints) {
+    filter |= BreakpointMethodFilterBit(breakpoint.method);
+  }
+  gBreakpointMethodFilter.StoreRelaxed(filter);
+}
+
 void DebugInvokeReq::VisitRoots(RootCallback* callback, void* arg, uint32_t tid,
                                 RootType root_type) {
   if (receiver != nullptr) {
@@ -290,6 +309,11 @@ void DeoptimizationRequest::VisitRoots(RootCallback* callback, void* arg) {
 static bool IsBreakpoint(const mirror::ArtMethod* m, uint32_t dex_pc)
     LOCKS_EXCLUDED(Locks::breakpoint_lock_)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  // A thread racing with a new breakpoint may miss it at this dex pc, as it would by checking just
+  // before it was added. Methods only hit breakpoints once deoptimized, which suspends all threads.
+  if ((gBreakpointMethodFilter.LoadRelaxed() & BreakpointMethodFilterBit(m)) == 0) {
+    return false;
+  }
   MutexLock mu(Thread::Current(), *Locks::breakpoint_lock_);
   for (size_t i = 0, e = gBreakpoints.size(); i < e; ++i) {
     if (gBreakpoints[i].method == m && gBreakpoints[i].dex_pc == dex_pc) {
@@ -579,6 +603,8 @@ void Dbg::VisitRoots(RootCallback* callback, void* arg) {
     for (Breakpoint& bp : gBreakpoints) {
       bp.VisitRoots(callback, arg);
     }
+    // The methods may have moved.
+    UpdateBreakpointMethodFilter();
   }
   if (deoptimization_lock_ != nullptr) {  // only true if the debugger is started.
     MutexLock mu(Thread::Current(), *deoptimization_lock_);
@@ -2947,6 +2973,7 @@ void Dbg::WatchLocation(const JDWP::JdwpLocation* location, DeoptimizationReques
   }
 
   gBreakpoints.push_back(Breakpoint(m, location->dex_pc, need_full_deoptimization));
+  UpdateBreakpointMethodFilter();
   VLOG(jdwp) << "Set breakpoint #" << (gBreakpoints.size() - 1) << ": "
              << gBreakpoints[gBreakpoints.size() - 1];
 }
@@ -2965,6 +2992,7 @@ void Dbg::UnwatchLocation(const JDWP::JdwpLocation* location, DeoptimizationRequ
       need_full_deoptimization = gBreakpoints[i].need_full_deoptimization;
       DCHECK_NE(need_full_deoptimization, Runtime::Current()->GetInstrumentation()->IsDeoptimized(m));
       gBreakpoints.erase(gBreakpoints.begin() + i);
+      UpdateBreakpointMethodFilter();
       break;
     }
   }
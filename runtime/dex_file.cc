@@ -245,7 +245,20 @@ const DexFile* DexFile::Open(const ZipArchive& zip_archive, const std::string& l
   if (zip_entry.get() == NULL) {
     return nullptr;
   }
-  std::unique_ptr<MemMap> map(zip_entry->ExtractToMemMap(location.c_str(), kClassesDex, error_msg));
+  std::unique_ptr<MemMap> map;
+  // A stored classes.dex that is suitably aligned is used in place rather than copied to dirty
+  // anonymous memory.
+  if (zip_entry->IsUncompressed() && zip_entry->IsAlignedTo(alignof(Header))) {
+    map.reset(zip_entry->MapDirectlyFromFile(location.c_str(), error_msg));
+    if (map.get() == nullptr) {
+      LOG(WARNING) << "Failed to map '" << kClassesDex << "' directly from '" << location
+                   << "', extracting it: " << *error_msg;
+      error_msg->clear();
+    }
+  }
+  if (map.get() == nullptr) {
+    map.reset(zip_entry->ExtractToMemMap(location.c_str(), kClassesDex, error_msg));
+  }
   if (map.get() == NULL) {
     *error_msg = StringPrintf("Failed to extract '%s' from '%s': %s", kClassesDex, location.c_str(),
                               error_msg->c_str());
@@ -258,7 +271,8 @@ const DexFile* DexFile::Open(const ZipArchive& zip_archive, const std::string& l
                               error_msg->c_str());
     return nullptr;
   }
-  if (!dex_file->DisableWrite()) {
+  // A dex file mapped from the zip file is already read only.
+  if (!dex_file->IsReadOnly() && !dex_file->DisableWrite()) {
     *error_msg = StringPrintf("Failed to make dex file '%s' read only", location.c_str());
     return nullptr;
   }
@@ -299,7 +313,8 @@ DexFile::DexFile(const byte* base, size_t size,
       field_ids_(reinterpret_cast<const FieldId*>(base + header_->field_ids_off_)),
       method_ids_(reinterpret_cast<const MethodId*>(base + header_->method_ids_off_)),
       proto_ids_(reinterpret_cast<const ProtoId*>(base + header_->proto_ids_off_)),
-      class_defs_(reinterpret_cast<const ClassDef*>(base + header_->class_defs_off_)) {
+      class_defs_(reinterpret_cast<const ClassDef*>(base + header_->class_defs_off_)),
+      class_def_index_(nullptr) {
   CHECK(begin_ != NULL) << GetLocation();
   CHECK_GT(size_, 0U) << GetLocation();
 }
@@ -309,6 +324,7 @@ DexFile::~DexFile() {
   // that's only called after DetachCurrentThread, which means there's no JNIEnv. We could
   // re-attach, but cleaning up these global references is not obviously useful. It's not as if
   // the global reference table is otherwise empty!
+  delete class_def_index_.LoadSequentiallyConsistent();
 }
 
 bool DexFile::Init(std::string* error_msg) {
@@ -357,11 +373,93 @@ uint32_t DexFile::GetVersion() const {
   return atoi(version);
 }
 
+static constexpr uint32_t kClassDefIndexEmpty = DexFile::kDexNoIndex16;
+static constexpr uint32_t kClassDefIndexHashMask = 0xFFFF0000;
+
+void DexFile::CreateClassDefIndex(std::vector<uint32_t>* entries) const {
+  COMPILE_ASSERT(kMaxClassDefsForIndex == kClassDefIndexEmpty,
+                 class_def_index_collides_with_empty_marker);
+  entries->clear();
+  size_t num_class_defs = NumClassDefs();
+  if (!UseClassDefIndex(num_class_defs)) {
+    return;
+  }
+  // Keep the load factor at or below one half.
+  size_t mask = ClassDefIndexSize(num_class_defs) - 1;
+  entries->resize(mask + 1, kClassDefIndexEmpty);
+  for (size_t i = 0; i < num_class_defs; ++i) {
+    uint32_t hash = ComputeModifiedUtf8Hash(GetClassDescriptor(GetClassDef(i)));
+    size_t slot = hash & mask;
+    // The class defs are inserted in order, so that a duplicate descriptor finds the first one
+    // like the linear search.
+    while ((*entries)[slot] != kClassDefIndexEmpty) {
+      slot = (slot + 1) & mask;
+    }
+    (*entries)[slot] = (hash & kClassDefIndexHashMask) | i;
+  }
+}
+
+size_t DexFile::ClassDefIndexSize(size_t num_class_defs) {
+  return RoundUpToPowerOfTwo(num_class_defs * 2);
+}
+
+const DexFile::ClassDefIndex* DexFile::InstallClassDefIndex(ClassDefIndex* new_index) const {
+  // Another thread may have raced us to install an index, keep the first one.
+  while (!class_def_index_.CompareExchangeWeakRelease(nullptr, new_index)) {
+    ClassDefIndex* index = class_def_index_.LoadSequentiallyConsistent();
+    if (index != nullptr) {
+      delete new_index;
+      return index;
+    }
+  }
+  return new_index;
+}
+
+const DexFile::ClassDefIndex* DexFile::GetClassDefIndex() const {
+  ClassDefIndex* index = class_def_index_.LoadSequentiallyConsistent();
+  if (LIKELY(index != nullptr)) {
+    return index;
+  }
+  index = new ClassDefIndex();
+  CreateClassDefIndex(&index->storage);
+  index->entries = &index->storage[0];
+  index->mask = index->storage.size() - 1;
+  return InstallClassDefIndex(index);
+}
+
+bool DexFile::SetClassDefIndex(const uint32_t* entries, size_t num_entries) const {
+  if (!UseClassDefIndex(NumClassDefs()) || num_entries != ClassDefIndexSize(NumClassDefs())) {
+    return false;
+  }
+  ClassDefIndex* index = new ClassDefIndex();
+  index->entries = entries;
+  index->mask = num_entries - 1;
+  InstallClassDefIndex(index);
+  return true;
+}
+
 const DexFile::ClassDef* DexFile::FindClassDef(const char* descriptor) const {
   size_t num_class_defs = NumClassDefs();
   if (num_class_defs == 0) {
     return NULL;
   }
+  if (UseClassDefIndex(num_class_defs)) {
+    const ClassDefIndex* index = GetClassDefIndex();
+    const size_t mask = index->mask;
+    uint32_t hash = ComputeModifiedUtf8Hash(descriptor);
+    for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+      uint32_t entry = index->entries[slot];
+      if (entry == kClassDefIndexEmpty) {
+        return NULL;
+      }
+      if ((entry & kClassDefIndexHashMask) == (hash & kClassDefIndexHashMask)) {
+        const ClassDef& class_def = GetClassDef(entry & ~kClassDefIndexHashMask);
+        if (strcmp(GetClassDescriptor(class_def), descriptor) == 0) {
+          return &class_def;
+        }
+      }
+    }
+  }
   const StringId* string_id = FindStringId(descriptor);
   if (string_id == NULL) {
     return NULL;
@@ -382,6 +480,10 @@ const DexFile::ClassDef* DexFile::FindClassDef(const char* descriptor) const {
 
 const DexFile::ClassDef* DexFile::FindClassDef(uint16_t type_idx) const {
   size_t num_class_defs = NumClassDefs();
+  if (UseClassDefIndex(num_class_defs)) {
+    // Type ids are unique, so matching the descriptor is the same as matching the type index.
+    return FindClassDef(StringByTypeIdx(type_idx));
+  }
   for (size_t i = 0; i < num_class_defs; ++i) {
     const ClassDef& class_def = GetClassDef(i);
     if (class_def.class_idx_ == type_idx) {
@@ -391,6 +493,44 @@ const DexFile::ClassDef* DexFile::FindClassDef(uint16_t type_idx) const {
   return NULL;
 }
 
+bool DexFile::IsMethodAnnotationPresent(const ClassDef& class_def, uint32_t method_idx,
+                                        const char* descriptor) const {
+  if (class_def.annotations_off_ == 0) {
+    return false;
+  }
+  const AnnotationsDirectoryItem* directory =
+      reinterpret_cast<const AnnotationsDirectoryItem*>(begin_ + class_def.annotations_off_);
+  // The method annotations follow the field annotations, sorted by method index.
+  const MethodAnnotationsItem* method_annotations =
+      reinterpret_cast<const MethodAnnotationsItem*>(
+          reinterpret_cast<const FieldAnnotationsItem*>(directory + 1) + directory->fields_size_);
+  const AnnotationSetItem* annotation_set = nullptr;
+  for (uint32_t i = 0; i < directory->methods_size_; ++i) {
+    if (method_annotations[i].method_idx_ == method_idx) {
+      annotation_set = reinterpret_cast<const AnnotationSetItem*>(
+          begin_ + method_annotations[i].annotations_off_);
+      break;
+    }
+    if (method_annotations[i].method_idx_ > method_idx) {
+      break;
+    }
+  }
+  if (annotation_set == nullptr) {
+    return false;
+  }
+  for (uint32_t i = 0; i < annotation_set->size_; ++i) {
+    const AnnotationItem* annotation =
+        reinterpret_cast<const AnnotationItem*>(begin_ + annotation_set->entries_[i]);
+    // The encoded annotation starts with the type index of the annotation.
+    const byte* annotation_data = annotation->annotation_;
+    const uint32_t type_idx = DecodeUnsignedLeb128(&annotation_data);
+    if (strcmp(StringByTypeIdx(type_idx), descriptor) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 const DexFile::FieldId* DexFile::FindFieldId(const DexFile::TypeId& declaring_klass,
                                               const DexFile::StringId& name,
                                               const DexFile::TypeId& type) const {
@@ -21,6 +21,7 @@
 #include <string>
 #include <vector>
 
+#include "atomic.h"
 #include "base/logging.h"
 #include "base/mutex.h"  // For Locks::mutator_lock_.
 #include "globals.h"
@@ -597,12 +598,27 @@ class DexFile {
     return StringByTypeIdx(class_def.class_idx_);
   }
 
-  // Looks up a class definition by its class descriptor.
+  // Looks up a class definition by its class descriptor. Uses a hash index of the class
+  // definitions built on first use, unless the dex file is small.
   const ClassDef* FindClassDef(const char* descriptor) const;
 
   // Looks up a class definition by its type index.
   const ClassDef* FindClassDef(uint16_t type_idx) const;
 
+  // Returns true if the method of the class definition has an annotation, of any visibility, of
+  // the type with the given descriptor.
+  bool IsMethodAnnotationPresent(const ClassDef& class_def, uint32_t method_idx,
+                                 const char* descriptor) const;
+
+  // Fills entries with the hash table FindClassDef uses to look up class definitions, or leaves
+  // it empty if the dex file is small enough to be searched linearly. dex2oat stores the table in
+  // the oat file so that the runtime doesn't need to build it.
+  void CreateClassDefIndex(std::vector<uint32_t>* entries) const;
+
+  // Makes FindClassDef use a table created by CreateClassDefIndex, which must outlive this
+  // DexFile. Returns false if the table doesn't match the dex file. Thread safe.
+  bool SetClassDefIndex(const uint32_t* entries, size_t num_entries) const;
+
   const TypeList* GetInterfacesList(const ClassDef& class_def) const {
     if (class_def.interfaces_off_ == 0) {
         return NULL;
@@ -855,6 +871,36 @@ class DexFile {
       DexDebugNewPositionCb position_cb, DexDebugNewLocalCb local_cb,
       void* context, const byte* stream, LocalInfo* local_in_reg) const;
 
+  // Open addressing hash table of the class definitions keyed by the descriptor hash. An entry
+  // holds the class def index in its low 16 bits and the high bits of the hash in its high 16
+  // bits, so that most mismatches are rejected without comparing the descriptors.
+  struct ClassDefIndex {
+    // A power of two number of entries.
+    const uint32_t* entries;
+    size_t mask;
+    // Holds the entries unless they are mapped from an oat file.
+    std::vector<uint32_t> storage;
+  };
+
+  // Dex files with fewer class definitions are searched linearly.
+  static constexpr size_t kMinClassDefsForIndex = 16;
+  // The index holds 16 bit class def indices and marks its empty slots with kDexNoIndex16, dex
+  // files with more class definitions are searched linearly too.
+  static constexpr size_t kMaxClassDefsForIndex = 0xFFFF;
+
+  static bool UseClassDefIndex(size_t num_class_defs) {
+    return num_class_defs >= kMinClassDefsForIndex && num_class_defs <= kMaxClassDefsForIndex;
+  }
+
+  // The number of entries of the class def index.
+  static size_t ClassDefIndexSize(size_t num_class_defs);
+
+  // Returns the class def index, building it if this is the first lookup. Thread safe.
+  const ClassDefIndex* GetClassDefIndex() const;
+
+  // Publishes new_index unless another thread did first, returns the published index.
+  const ClassDefIndex* InstallClassDefIndex(ClassDefIndex* new_index) const;
+
   // The base address of the memory mapping.
   const byte* const begin_;
 
@@ -892,6 +938,9 @@ class DexFile {
 
   // Points to the base of the class definition list.
   const ClassDef* const class_defs_;
+
+  // Lazily created by GetClassDefIndex.
+  mutable Atomic<ClassDefIndex*> class_def_index_;
 };
 std::ostream& operator<<(std::ostream& os, const DexFile& dex_file);
 
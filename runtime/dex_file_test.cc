@@ -290,6 +290,26 @@ TEST_F(DexFileTest, FindTypeId) {
   }
 }
 
+TEST_F(DexFileTest, FindClassDef) {
+  // Large enough to use the class def index.
+  ASSERT_GE(java_lang_dex_file_->NumClassDefs(), 16U);
+  for (size_t i = 0; i < java_lang_dex_file_->NumClassDefs(); i++) {
+    const DexFile::ClassDef& class_def = java_lang_dex_file_->GetClassDef(i);
+    const char* descriptor = java_lang_dex_file_->GetClassDescriptor(class_def);
+    EXPECT_EQ(&class_def, java_lang_dex_file_->FindClassDef(descriptor)) << descriptor;
+    EXPECT_EQ(&class_def, java_lang_dex_file_->FindClassDef(class_def.class_idx_)) << descriptor;
+  }
+  EXPECT_TRUE(java_lang_dex_file_->FindClassDef("LNoSuchClass;") == NULL);
+  EXPECT_TRUE(java_lang_dex_file_->FindClassDef("[Ljava/lang/Object;") == NULL);
+
+  ScopedObjectAccess soa(Thread::Current());
+  const DexFile* raw(OpenTestDexFile("Nested"));
+  ASSERT_TRUE(raw != NULL);
+  EXPECT_EQ(&raw->GetClassDef(0), raw->FindClassDef("LNested$Inner;"));
+  EXPECT_EQ(&raw->GetClassDef(1), raw->FindClassDef("LNested;"));
+  EXPECT_TRUE(raw->FindClassDef("Ljava/lang/Object;") == NULL);
+}
+
 TEST_F(DexFileTest, FindProtoId) {
   for (size_t i = 0; i < java_lang_dex_file_->NumProtoIds(); i++) {
     const DexFile::ProtoId& to_find = java_lang_dex_file_->GetProtoId(i);
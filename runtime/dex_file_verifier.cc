@@ -17,12 +17,12 @@
 #include "dex_file_verifier.h"
 
 #include <zlib.h>
+#include <algorithm>
 #include <memory>
 
 #include "base/stringprintf.h"
 #include "dex_file-inl.h"
 #include "leb128.h"
-#include "safe_map.h"
 #include "utf-inl.h"
 #include "utils.h"
 
@@ -693,12 +693,34 @@ bool DexFileVerifier::CheckIntraCodeItem() {
   return true;
 }
 
+// Are all the bytes of word in 0x01..0x7f, each being a whole character of the string data?
+static bool IsNonNulAsciiWord(uint64_t word) {
+  static constexpr uint64_t kLowBits = UINT64_C(0x0101010101010101);
+  static constexpr uint64_t kHighBits = UINT64_C(0x8080808080808080);
+  // A byte has its high bit set, or is zero which borrows and sets it in word - kLowBits.
+  return ((word | (word - kLowBits)) & kHighBits) == 0;
+}
+
 bool DexFileVerifier::CheckIntraStringDataItem() {
   uint32_t size = DecodeUnsignedLeb128(&ptr_);
   const byte* file_end = begin_ + size_;
 
   for (uint32_t i = 0; i < size; i++) {
     CHECK_LT(i, size);  // b/15014252 Prevents hitting the impossible case below
+    // Skip runs of plain ASCII, most of the string data, a word at a time.
+    while ((size - i >= sizeof(uint64_t)) &&
+           (static_cast<size_t>(file_end - ptr_) >= sizeof(uint64_t))) {
+      uint64_t word;
+      memcpy(&word, ptr_, sizeof(word));
+      if (!IsNonNulAsciiWord(word)) {
+        break;
+      }
+      ptr_ += sizeof(uint64_t);
+      i += sizeof(uint64_t);
+    }
+    if (i == size) {
+      break;
+    }
     if (UNLIKELY(ptr_ >= file_end)) {
       ErrorStringPrintf("String data would go beyond end-of-file");
       return false;
@@ -1133,7 +1155,9 @@ bool DexFileVerifier::CheckIntraSectionIterate(size_t offset, uint32_t count, ui
     }
 
     if (IsDataSectionType(type)) {
-      offset_to_type_map_.Put(aligned_offset, type);
+      // The map is in increasing offsets, the sections and their items being checked in order.
+      DCHECK(offset_to_type_map_.empty() || offset_to_type_map_.back().first < aligned_offset);
+      offset_to_type_map_.push_back(std::make_pair(aligned_offset, type));
     }
 
     aligned_offset = ptr_ - begin_;
@@ -1305,9 +1329,14 @@ bool DexFileVerifier::CheckIntraSection() {
   return true;
 }
 
+static bool OffsetLess(const std::pair<uint32_t, uint16_t>& entry, size_t offset) {
+  return entry.first < offset;
+}
+
 bool DexFileVerifier::CheckOffsetToTypeMap(size_t offset, uint16_t type) {
-  auto it = offset_to_type_map_.find(offset);
-  if (UNLIKELY(it == offset_to_type_map_.end())) {
+  auto it = std::lower_bound(offset_to_type_map_.begin(), offset_to_type_map_.end(), offset,
+                             OffsetLess);
+  if (UNLIKELY(it == offset_to_type_map_.end() || it->first != offset)) {
     ErrorStringPrintf("No data map entry found @ %zx; expected %x", offset, type);
     return false;
   }
@@ -1559,6 +1588,46 @@ bool DexFileVerifier::CheckInterMethodIdItem() {
   return true;
 }
 
+bool DexFileVerifier::CheckNoDuplicateInterfaces(const DexFile::TypeList* interfaces) {
+  static constexpr uint32_t kMaxInterfacesForPairwiseCheck = 16;
+  uint32_t size = interfaces->Size();
+  if (size <= kMaxInterfacesForPairwiseCheck) {
+    // The number of interfaces implemented by a class is usually low, compare them pairwise.
+    for (uint32_t i = 1; i < size; i++) {
+      uint32_t idx1 = interfaces->GetTypeItem(i).type_idx_;
+      for (uint32_t j = 0; j < i; j++) {
+        uint32_t idx2 = interfaces->GetTypeItem(j).type_idx_;
+        if (UNLIKELY(idx1 == idx2)) {
+          ErrorStringPrintf("Duplicate interface: '%s'", dex_file_->StringByTypeIdx(idx1));
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+  // Otherwise mark the type indexes seen in a bitmap, which is left clear for the next class.
+  seen_type_indexes_.resize(header_->type_ids_size_, false);
+  bool result = true;
+  uint32_t i = 0;
+  for (; i < size; i++) {
+    uint32_t idx = interfaces->GetTypeItem(i).type_idx_;
+    if (!CheckIndex(idx, header_->type_ids_size_, "interfaces type_idx")) {
+      result = false;
+      break;
+    }
+    if (UNLIKELY(seen_type_indexes_[idx])) {
+      ErrorStringPrintf("Duplicate interface: '%s'", dex_file_->StringByTypeIdx(idx));
+      result = false;
+      break;
+    }
+    seen_type_indexes_[idx] = true;
+  }
+  for (uint32_t j = 0; j < i; j++) {
+    seen_type_indexes_[interfaces->GetTypeItem(j).type_idx_] = false;
+  }
+  return result;
+}
+
 bool DexFileVerifier::CheckInterClassDefItem() {
   const DexFile::ClassDef* item = reinterpret_cast<const DexFile::ClassDef*>(ptr_);
   uint32_t class_idx = item->class_idx_;
@@ -1607,19 +1676,8 @@ bool DexFileVerifier::CheckInterClassDefItem() {
       }
     }
 
-    /*
-     * Ensure that there are no duplicates. This is an O(N^2) test, but in
-     * practice the number of interfaces implemented by any given class is low.
-     */
-    for (uint32_t i = 1; i < size; i++) {
-      uint32_t idx1 = interfaces->GetTypeItem(i).type_idx_;
-      for (uint32_t j =0; j < i; j++) {
-        uint32_t idx2 = interfaces->GetTypeItem(j).type_idx_;
-        if (UNLIKELY(idx1 == idx2)) {
-          ErrorStringPrintf("Duplicate interface: '%s'", dex_file_->StringByTypeIdx(idx1));
-          return false;
-        }
-      }
+    if (!CheckNoDuplicateInterfaces(interfaces)) {
+      return false;
     }
   }
 
@@ -17,8 +17,10 @@
 #ifndef ART_RUNTIME_DEX_FILE_VERIFIER_H_
 #define ART_RUNTIME_DEX_FILE_VERIFIER_H_
 
+#include <utility>
+#include <vector>
+
 #include "dex_file.h"
-#include "safe_map.h"
 
 namespace art {
 
@@ -79,6 +81,7 @@ class DexFileVerifier {
   bool CheckInterProtoIdItem();
   bool CheckInterFieldIdItem();
   bool CheckInterMethodIdItem();
+  bool CheckNoDuplicateInterfaces(const DexFile::TypeList* interfaces);
   bool CheckInterClassDefItem();
   bool CheckInterAnnotationSetRefList();
   bool CheckInterAnnotationSetItem();
@@ -97,7 +100,10 @@ class DexFileVerifier {
   const char* const location_;
   const DexFile::Header* const header_;
 
-  SafeMap<uint32_t, uint16_t> offset_to_type_map_;
+  // The offsets and types of the data items, sorted by offset.
+  std::vector<std::pair<uint32_t, uint16_t>> offset_to_type_map_;
+  // Scratch bitmap over the type ids, clear between uses.
+  std::vector<bool> seen_type_indexes_;
   const byte* ptr_;
   const void* previous_item_;
 
@@ -772,7 +772,7 @@ size_t ElfFile::GetLoadedSize() const {
   return loaded_size;
 }
 
-bool ElfFile::Load(bool executable, std::string* error_msg) {
+bool ElfFile::Load(bool executable, byte* requested_base, std::string* error_msg) {
   CHECK(program_header_only_) << file_->GetPath();
 
   if (executable) {
@@ -845,8 +845,8 @@ bool ElfFile::Load(bool executable, std::string* error_msg) {
       std::string reservation_name("ElfFile reservation for ");
       reservation_name += file_->GetPath();
       std::unique_ptr<MemMap> reserve(MemMap::MapAnonymous(reservation_name.c_str(),
-                                                     NULL, GetLoadedSize(), PROT_NONE, false,
-                                                     error_msg));
+                                                     requested_base, GetLoadedSize(), PROT_NONE,
+                                                     false, error_msg));
       if (reserve.get() == nullptr) {
         *error_msg = StringPrintf("Failed to allocate %s: %s",
                                   reservation_name.c_str(), error_msg->c_str());
@@ -902,6 +902,11 @@ bool ElfFile::Load(bool executable, std::string* error_msg) {
                                 i, file_->GetPath().c_str(), p_vaddr, segment->Begin());
       return false;
     }
+    if ((prot & PROT_EXEC) != 0) {
+      // Hot compiled code suffers from iTLB misses, the kernel may not support file backed huge
+      // pages though.
+      segment->AdviseHugePages();
+    }
     segments_.push_back(segment.release());
   }
 
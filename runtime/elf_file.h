@@ -119,8 +119,9 @@ class ElfFile {
   size_t GetLoadedSize() const;
 
   // Load segments into memory based on PT_LOAD program headers.
-  // executable is true at run time, false at compile time.
-  bool Load(bool executable, std::string* error_msg);
+  // executable is true at run time, false at compile time. Files whose segments don't have
+  // fixed addresses are loaded at requested_base, or anywhere if it is null.
+  bool Load(bool executable, byte* requested_base, std::string* error_msg);
 
  private:
   ElfFile(File* file, bool writable, bool program_header_only);
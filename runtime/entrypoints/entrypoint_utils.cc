@@ -158,8 +158,10 @@ JValue InvokeProxyInvocationHandler(ScopedObjectAccessAlreadyRunnable& soa, cons
     }
     for (size_t i = 0; i < args.size(); ++i) {
       if (shorty[i + 1] == 'L') {
-        jobject val = args.at(i).l;
-        soa.Env()->SetObjectArrayElement(args_jobj, i, val);
+        // Any object can be stored in an Object[], the JNI checks of SetObjectArrayElement aren't
+        // needed.
+        mirror::Object* val = soa.Decode<mirror::Object*>(args[i].l);
+        soa.Decode<mirror::ObjectArray<mirror::Object>* >(args_jobj)->Set<false>(i, val);
       } else {
         JValue jv;
         jv.SetJ(args.at(i).j);
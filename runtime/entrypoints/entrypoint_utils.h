@@ -621,8 +621,10 @@ static inline mirror::Class* ResolveVerifyAndClinit(uint32_t type_idx,
     ThrowIllegalAccessErrorClass(referring_class, klass);
     return nullptr;  // Failure - Indicate to caller to deliver exception
   }
-  // If we're just implementing const-class, we shouldn't call <clinit>.
-  if (!can_run_clinit) {
+  // If we're just implementing const-class, we shouldn't call <clinit>. Nor for a class another
+  // thread initialized, which compiled code finds uninitialized until the dex cache has it. The
+  // status is read with acquire semantics, the static fields written by <clinit> are visible.
+  if (!can_run_clinit || LIKELY(klass->IsInitialized())) {
     return klass;
   }
   // If we are the <clinit> of this class, just return our storage.
@@ -235,7 +235,7 @@ extern "C" uint64_t artPortableToInterpreterBridge(mirror::ArtMethod* method, Th
 class BuildPortableArgumentVisitor : public PortableArgumentVisitor {
  public:
   BuildPortableArgumentVisitor(MethodHelper& caller_mh, mirror::ArtMethod** sp,
-                               ScopedObjectAccessUnchecked& soa, std::vector<jvalue>& args) :
+                               ScopedObjectAccessAlreadyRunnable& soa, std::vector<jvalue>& args) :
     PortableArgumentVisitor(caller_mh, sp), soa_(soa), args_(args) {}
 
   virtual void Visit() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -268,7 +268,7 @@ class BuildPortableArgumentVisitor : public PortableArgumentVisitor {
   }
 
  private:
-  ScopedObjectAccessUnchecked& soa_;
+  ScopedObjectAccessAlreadyRunnable& soa_;
   std::vector<jvalue>& args_;
 
   DISALLOW_COPY_AND_ASSIGN(BuildPortableArgumentVisitor);
@@ -288,7 +288,7 @@ extern "C" uint64_t artPortableProxyInvokeHandler(mirror::ArtMethod* proxy_metho
   self->VerifyStack();
   // Start new JNI local reference state.
   JNIEnvExt* env = self->GetJniEnv();
-  ScopedObjectAccessUnchecked soa(env);
+  ScopedObjectAccessNested soa(env);
   ScopedJniEnvLocalRefState env_state(env);
   // Create local ref. copies of proxy method and the receiver.
   jobject rcvr_jobj = soa.AddLocalReference<jobject>(receiver);
@@ -140,6 +140,9 @@ struct PACKED(4) QuickEntryPoints {
   void (*pThrowNoSuchMethod)(int32_t);
   void (*pThrowNullPointer)();
   void (*pThrowStackOverflow)(void*);
+
+  // Read barrier
+  mirror::Object* (*pReadBarrierMark)(mirror::Object*);
 };
 
 
@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirror/object-inl.h"
+#include "read_barrier-inl.h"
+
+namespace art {
+
+// Called by compiled code, out of line, for a reference loaded from a gray object. Doesn't set up
+// a frame, marking never suspends the thread nor throws.
+extern "C" mirror::Object* artReadBarrierMark(mirror::Object* ref)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  DCHECK(kUseBakerReadBarrier);
+  return ReadBarrier::Mark(ref);
+}
+
+}  // namespace art
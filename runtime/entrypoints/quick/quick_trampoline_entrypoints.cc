@@ -513,7 +513,7 @@ class BuildQuickArgumentVisitor FINAL : public QuickArgumentVisitor {
  public:
   BuildQuickArgumentVisitor(StackReference<mirror::ArtMethod>* sp, bool is_static,
                             const char* shorty, uint32_t shorty_len,
-                            ScopedObjectAccessUnchecked* soa, std::vector<jvalue>* args) :
+                            ScopedObjectAccessAlreadyRunnable* soa, std::vector<jvalue>* args) :
     QuickArgumentVisitor(sp, is_static, shorty, shorty_len), soa_(soa), args_(args) {}
 
   void Visit() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) OVERRIDE;
@@ -521,7 +521,7 @@ class BuildQuickArgumentVisitor FINAL : public QuickArgumentVisitor {
   void FixupReferences() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
  private:
-  ScopedObjectAccessUnchecked* const soa_;
+  ScopedObjectAccessAlreadyRunnable* const soa_;
   std::vector<jvalue>* const args_;
   // References which we must update when exiting in case the GC moved the objects.
   std::vector<std::pair<jobject, StackReference<mirror::Object>*>> references_;
@@ -594,7 +594,7 @@ extern "C" uint64_t artQuickProxyInvokeHandler(mirror::ArtMethod* proxy_method,
   self->VerifyStack();
   // Start new JNI local reference state.
   JNIEnvExt* env = self->GetJniEnv();
-  ScopedObjectAccessUnchecked soa(env);
+  ScopedObjectAccessNested soa(env);
   ScopedJniEnvLocalRefState env_state(env);
   // Create local ref. copies of proxy method and the receiver.
   jobject rcvr_jobj = soa.AddLocalReference<jobject>(receiver);
@@ -603,6 +603,7 @@ extern "C" uint64_t artQuickProxyInvokeHandler(mirror::ArtMethod* proxy_method,
   MethodHelper proxy_mh(proxy_method);
   DCHECK(!proxy_mh.IsStatic()) << PrettyMethod(proxy_method);
   std::vector<jvalue> args;
+  args.reserve(proxy_mh.GetShortyLength());
   BuildQuickArgumentVisitor local_ref_visitor(sp, proxy_mh.IsStatic(), proxy_mh.GetShorty(),
                                               proxy_mh.GetShortyLength(), &soa, &args);
 
@@ -632,7 +633,7 @@ class RememberForGcArgumentVisitor FINAL : public QuickArgumentVisitor {
  public:
   RememberForGcArgumentVisitor(StackReference<mirror::ArtMethod>* sp, bool is_static,
                                const char* shorty, uint32_t shorty_len,
-                               ScopedObjectAccessUnchecked* soa) :
+                               ScopedObjectAccessAlreadyRunnable* soa) :
     QuickArgumentVisitor(sp, is_static, shorty, shorty_len), soa_(soa) {}
 
   void Visit() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) OVERRIDE;
@@ -640,7 +641,7 @@ class RememberForGcArgumentVisitor FINAL : public QuickArgumentVisitor {
   void FixupReferences() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
  private:
-  ScopedObjectAccessUnchecked* const soa_;
+  ScopedObjectAccessAlreadyRunnable* const soa_;
   // References which we must update when exiting in case the GC moved the objects.
   std::vector<std::pair<jobject, StackReference<mirror::Object>*>> references_;
   DISALLOW_COPY_AND_ASSIGN(RememberForGcArgumentVisitor);
@@ -674,7 +675,7 @@ extern "C" const void* artQuickResolutionTrampoline(mirror::ArtMethod* called,
   FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsAndArgs);
   // Start new JNI local reference state
   JNIEnvExt* env = self->GetJniEnv();
-  ScopedObjectAccessUnchecked soa(env);
+  ScopedObjectAccessNested soa(env);
   ScopedJniEnvLocalRefState env_state(env);
   const char* old_cause = self->StartAssertNoThreadSuspension("Quick method resolution set up");
 
@@ -1887,7 +1888,7 @@ extern "C" MethodAndCode artInvokeInterfaceTrampoline(mirror::ArtMethod* interfa
         dex_file->GetMethodShorty(dex_file->GetMethodId(dex_method_idx), &shorty_len);
     {
       // Remember the args in case a GC happens in FindMethodFromCode.
-      ScopedObjectAccessUnchecked soa(self->GetJniEnv());
+      ScopedObjectAccessNested soa(self->GetJniEnv());
       RememberForGcArgumentVisitor visitor(sp, false, shorty, shorty_len, &soa);
       visitor.VisitArguments();
       method = FindMethodFromCode<kInterface, false>(dex_method_idx, &this_object, &caller_method,
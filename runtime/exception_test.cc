@@ -236,6 +236,17 @@ TEST_F(ExceptionTest, StackTraceElement) {
   EXPECT_STREQ("f", trace_array->Get(1)->GetMethodName()->ToModifiedUtf8().c_str());
   EXPECT_EQ(22, trace_array->Get(1)->GetLineNumber());
 
+  // The frames of a class share its name and source file strings.
+  EXPECT_EQ(trace_array->Get(0)->GetDeclaringClass(), trace_array->Get(1)->GetDeclaringClass());
+  EXPECT_EQ(trace_array->Get(0)->GetFileName(), trace_array->Get(1)->GetFileName());
+
+  // Compiled and interpreted frames record different pcs which map to the same dex pc.
+  mirror::ObjectArray<mirror::Object>* method_trace =
+      soa.Decode<mirror::ObjectArray<mirror::Object>*>(internal);
+  mirror::IntArray* pc_trace = down_cast<mirror::IntArray*>(method_trace->Get(2));
+  EXPECT_EQ(3U, Thread::InternalStackTraceDexPc(method_g_, pc_trace->Get(0)));
+  EXPECT_EQ(3U, Thread::InternalStackTraceDexPc(method_f_, pc_trace->Get(1)));
+
 #if !defined(ART_USE_PORTABLE_COMPILER)
   thread->SetTopOfStack(NULL, 0);  // Disarm the assertion that no code is running when we detach.
 #else
@@ -15,12 +15,14 @@
  */
 
 #include "fault_handler.h"
+#include <algorithm>
 #include <sys/mman.h>
 #include <sys/ucontext.h>
 #include "base/macros.h"
 #include "globals.h"
 #include "base/logging.h"
 #include "base/hex_dump.h"
+#include "base/stl_util.h"
 #include "thread.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
@@ -50,7 +52,8 @@ static void art_fault_handler(int sig, siginfo_t* info, void* context) {
   fault_manager.HandleFault(sig, info, context);
 }
 
-FaultManager::FaultManager() {
+FaultManager::FaultManager()
+    : generated_code_ranges_lock_(nullptr), generated_code_ranges_(nullptr) {
   sigaction(SIGSEGV, nullptr, &oldaction_);
 }
 
@@ -59,10 +62,16 @@ FaultManager::~FaultManager() {
   UnclaimSignalChain(SIGSEGV);
 #endif
   sigaction(SIGSEGV, &oldaction_, nullptr);   // Restore old handler.
+  delete generated_code_ranges_.LoadSequentiallyConsistent();
+  STLDeleteElements(&retired_generated_code_ranges_);
+  delete generated_code_ranges_lock_;
 }
 
 
 void FaultManager::Init() {
+  generated_code_ranges_lock_ = new Mutex("fault manager generated code ranges lock");
+  generated_code_ranges_.StoreSequentiallyConsistent(new std::vector<GeneratedCodeRange>());
+
   struct sigaction action;
   action.sa_sigaction = art_fault_handler;
   sigemptyset(&action.sa_mask);
@@ -108,6 +117,63 @@ void FaultManager::HandleFault(int sig, siginfo_t* info, void* context) {
 #endif
 }
 
+void FaultManager::AddGeneratedCodeRange(const void* begin, size_t size) {
+  if (generated_code_ranges_lock_ == nullptr) {
+    return;
+  }
+  GeneratedCodeRange range;
+  range.begin = reinterpret_cast<uintptr_t>(begin);
+  range.end = range.begin + size;
+  MutexLock mu(Thread::Current(), *generated_code_ranges_lock_);
+  const std::vector<GeneratedCodeRange>* old_ranges = generated_code_ranges_.LoadRelaxed();
+  std::vector<GeneratedCodeRange>* new_ranges = new std::vector<GeneratedCodeRange>(*old_ranges);
+  auto it = std::upper_bound(new_ranges->begin(), new_ranges->end(), range,
+                             [](const GeneratedCodeRange& lhs, const GeneratedCodeRange& rhs) {
+                               return lhs.begin < rhs.begin;
+                             });
+  new_ranges->insert(it, range);
+  generated_code_ranges_.StoreSequentiallyConsistent(new_ranges);
+  retired_generated_code_ranges_.push_back(old_ranges);
+}
+
+void FaultManager::RemoveGeneratedCodeRange(const void* begin) {
+  if (generated_code_ranges_lock_ == nullptr) {
+    return;
+  }
+  MutexLock mu(Thread::Current(), *generated_code_ranges_lock_);
+  const std::vector<GeneratedCodeRange>* old_ranges = generated_code_ranges_.LoadRelaxed();
+  std::vector<GeneratedCodeRange>* new_ranges = new std::vector<GeneratedCodeRange>();
+  new_ranges->reserve(old_ranges->size());
+  for (const GeneratedCodeRange& range : *old_ranges) {
+    if (range.begin != reinterpret_cast<uintptr_t>(begin)) {
+      new_ranges->push_back(range);
+    }
+  }
+  generated_code_ranges_.StoreSequentiallyConsistent(new_ranges);
+  retired_generated_code_ranges_.push_back(old_ranges);
+}
+
+bool FaultManager::IsInGeneratedCodeRange(uintptr_t pc) const {
+  const std::vector<GeneratedCodeRange>* ranges =
+      generated_code_ranges_.LoadSequentiallyConsistent();
+  if (ranges == nullptr) {
+    // Not initialized, nothing registered.
+    return true;
+  }
+  // Find the last range starting at or below pc.
+  size_t lo = 0;
+  size_t hi = ranges->size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if ((*ranges)[mid].begin <= pc) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo != 0 && pc < (*ranges)[lo - 1].end;
+}
+
 void FaultManager::AddHandler(FaultHandler* handler, bool generated_code) {
   if (generated_code) {
     generated_code_handlers_.push_back(handler);
@@ -163,6 +229,13 @@ bool FaultManager::IsInGeneratedCode(void* context, bool check_dex_pc) {
   // are in architecture specific files in arch/<arch>/fault_handler_<arch>.
   GetMethodAndReturnPCAndSP(context, &method_obj, &return_pc, &sp);
 
+  // The return pc is just past the faulting instruction, with the thumb bit set on arm. It is left
+  // 0 where the architecture does not compute it.
+  if (return_pc != 0 && !IsInGeneratedCodeRange((return_pc & ~static_cast<uintptr_t>(1)) - 1)) {
+    VLOG(signals) << "pc not in generated code";
+    return false;
+  }
+
   // If we don't have a potential method, we're outta here.
   VLOG(signals) << "potential method: " << method_obj;
   if (method_obj == 0 || !IsAligned<kObjectAlignment>(method_obj)) {
@@ -23,6 +23,7 @@
 #include <setjmp.h>
 #include <stdint.h>
 
+#include "atomic.h"
 #include "base/mutex.h"   // For annotalysis.
 
 namespace art {
@@ -47,10 +48,33 @@ class FaultManager {
                                  uintptr_t* out_return_pc, uintptr_t* out_sp);
   bool IsInGeneratedCode(void *context, bool check_dex_pc) NO_THREAD_SAFETY_ANALYSIS;
 
+  // Registers [begin, begin + size) as holding generated code, e.g. an executable oat file or the
+  // JIT code cache. Once the manager is initialized, faults at any other pc are passed on without
+  // looking for a method on the stack. Does nothing before Init.
+  void AddGeneratedCodeRange(const void* begin, size_t size);
+  void RemoveGeneratedCodeRange(const void* begin);
+
  private:
+  struct GeneratedCodeRange {
+    uintptr_t begin;
+    uintptr_t end;
+  };
+
+  // Async-signal-safe.
+  bool IsInGeneratedCodeRange(uintptr_t pc) const;
+
   std::vector<FaultHandler*> generated_code_handlers_;
   std::vector<FaultHandler*> other_handlers_;
   struct sigaction oldaction_;
+
+  // Created by Init, so that the manager can be statically constructed before the locks.
+  Mutex* generated_code_ranges_lock_;
+  // The ranges sorted by begin. Updates publish a new copy and the signal handler only reads the
+  // published one, so it never takes a lock. Replaced copies may still be read by a handler and
+  // are only freed with the manager.
+  Atomic<const std::vector<GeneratedCodeRange>*> generated_code_ranges_;
+  std::vector<const std::vector<GeneratedCodeRange>*> retired_generated_code_ranges_
+      GUARDED_BY(generated_code_ranges_lock_);
   DISALLOW_COPY_AND_ASSIGN(FaultManager);
 };
 
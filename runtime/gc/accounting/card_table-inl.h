@@ -17,6 +17,12 @@
 #ifndef ART_RUNTIME_GC_ACCOUNTING_CARD_TABLE_INL_H_
 #define ART_RUNTIME_GC_ACCOUNTING_CARD_TABLE_INL_H_
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 #include "base/logging.h"
 #include "card_table.h"
 #include "cutils/atomic-inline.h"
@@ -42,6 +48,55 @@ static inline bool byte_cas(byte old_value, byte new_value, byte* address) {
   return success;
 }
 
+// Returns true if all the cards of the kCardBlockSize aligned block are clean.
+static inline bool IsCleanCardBlock(const byte* block) {
+  DCHECK_ALIGNED(block, CardTable::kCardBlockSize);
+#if defined(__SSE2__)
+  const __m128i* vectors = reinterpret_cast<const __m128i*>(block);
+  __m128i cards = _mm_or_si128(_mm_load_si128(vectors), _mm_load_si128(vectors + 1));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(cards, _mm_setzero_si128())) == 0xFFFF;
+#elif defined(__ARM_NEON__)
+  uint8x16_t cards = vorrq_u8(vld1q_u8(block), vld1q_u8(block + 16));
+  uint32x2_t folded = vorr_u32(vget_low_u32(vreinterpretq_u32_u8(cards)),
+                               vget_high_u32(vreinterpretq_u32_u8(cards)));
+  return (vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) == 0;
+#else
+  const uintptr_t* words = reinterpret_cast<const uintptr_t*>(block);
+  uintptr_t cards = 0;
+  for (size_t i = 0; i < CardTable::kCardBlockSize / sizeof(uintptr_t); ++i) {
+    cards |= words[i];
+  }
+  return cards == 0;
+#endif
+}
+
+// Returns the first word of cards in [card_cur, card_end) which has a card that isn't clean, or
+// card_end. Both are word aligned. The clean cards are mostly skipped a block at a time.
+static inline byte* FindNonCleanCardWord(byte* card_cur, byte* card_end) {
+  DCHECK_ALIGNED(card_cur, sizeof(uintptr_t));
+  DCHECK_ALIGNED(card_end, sizeof(uintptr_t));
+  // Handle the words up to the first block.
+  while (!IsAligned<CardTable::kCardBlockSize>(card_cur) && card_cur < card_end) {
+    if (*reinterpret_cast<uintptr_t*>(card_cur) != 0) {
+      return card_cur;
+    }
+    card_cur += sizeof(uintptr_t);
+  }
+  byte* block_end =
+      card_cur + RoundDown(static_cast<size_t>(card_end - card_cur), CardTable::kCardBlockSize);
+  while (card_cur < block_end && LIKELY(IsCleanCardBlock(card_cur))) {
+    card_cur += CardTable::kCardBlockSize;
+  }
+  // Find the word in the block, or in the words after the last block.
+  while (card_cur < card_end) {
+    if (*reinterpret_cast<uintptr_t*>(card_cur) != 0) {
+      return card_cur;
+    }
+    card_cur += sizeof(uintptr_t);
+  }
+  return card_end;
+}
+
 template <typename Visitor>
 inline size_t CardTable::Scan(ContinuousSpaceBitmap* bitmap, byte* scan_begin, byte* scan_end,
                               const Visitor& visitor, const byte minimum_age) const {
@@ -69,11 +124,10 @@ inline size_t CardTable::Scan(ContinuousSpaceBitmap* bitmap, byte* scan_begin, b
   uintptr_t* word_end = reinterpret_cast<uintptr_t*>(aligned_end);
   for (uintptr_t* word_cur = reinterpret_cast<uintptr_t*>(card_cur); word_cur < word_end;
       ++word_cur) {
-    while (LIKELY(*word_cur == 0)) {
-      ++word_cur;
-      if (UNLIKELY(word_cur >= word_end)) {
-        goto exit_for;
-      }
+    word_cur = reinterpret_cast<uintptr_t*>(
+        FindNonCleanCardWord(reinterpret_cast<byte*>(word_cur), aligned_end));
+    if (UNLIKELY(word_cur >= word_end)) {
+      break;
     }
 
     // Find the first dirty card.
@@ -93,7 +147,6 @@ inline size_t CardTable::Scan(ContinuousSpaceBitmap* bitmap, byte* scan_begin, b
       start += kCardSize;
     }
   }
-  exit_for:
 
   // Handle any unaligned cards at the end.
   card_cur = reinterpret_cast<byte*>(word_end);
@@ -164,8 +217,13 @@ inline void CardTable::ModifyCardsAtomic(byte* scan_begin, byte* scan_end, const
     uint8_t new_bytes[sizeof(uintptr_t)];
   };
 
-  // TODO: Parallelize.
   while (word_cur < word_end) {
+    // Clean cards stay clean, skip them.
+    word_cur = reinterpret_cast<uintptr_t*>(
+        FindNonCleanCardWord(reinterpret_cast<byte*>(word_cur), card_end));
+    if (word_cur >= word_end) {
+      break;
+    }
     while (true) {
       expected_word = *word_cur;
       if (LIKELY(expected_word == 0)) {
@@ -59,6 +59,8 @@ CardTable* CardTable::Create(const byte* heap_begin, size_t heap_capacity) {
                                                  capacity + 256, PROT_READ | PROT_WRITE,
                                                  false, &error_msg));
   CHECK(mem_map.get() != NULL) << "couldn't allocate card table: " << error_msg;
+  mem_map->AdviseHugePages();
+  mem_map->AdviseNumaInterleave();
   // All zeros is the correct initial value; all clean. Anonymous mmaps are initialized to zero, we
   // don't clear the card table to avoid unnecessary pages being allocated
   COMPILE_ASSERT(kCardClean == 0, card_clean_must_be_0);
@@ -50,6 +50,8 @@ class CardTable {
   static const size_t kCardSize = (1 << kCardShift);
   static const uint8_t kCardClean = 0x0;
   static const uint8_t kCardDirty = 0x70;
+  // The number of cards tested at once when looking for the ones which aren't clean.
+  static constexpr size_t kCardBlockSize = 32;
 
   static CardTable* Create(const byte* heap_begin, size_t heap_capacity);
 
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "card_table.h"
+
+#include <memory>
+#include <vector>
+
+#include "card_table-inl.h"
+#include "common_runtime_test.h"
+#include "scoped_thread_state_change.h"
+#include "space_bitmap-inl.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+class CardTableTest : public CommonRuntimeTest {
+ protected:
+  static byte* HeapBegin() {
+    return reinterpret_cast<byte*>(0x10000000);
+  }
+
+  void CreateTables(size_t heap_capacity) {
+    card_table_.reset(CardTable::Create(HeapBegin(), heap_capacity));
+    ASSERT_TRUE(card_table_.get() != nullptr);
+    bitmap_.reset(ContinuousSpaceBitmap::Create("test bitmap", HeapBegin(), heap_capacity));
+    ASSERT_TRUE(bitmap_.get() != nullptr);
+  }
+
+  // Marks an object at the start of every card so that a scan visits one object per card.
+  void MarkObjectPerCard(size_t heap_capacity) {
+    for (size_t offset = 0; offset < heap_capacity; offset += CardTable::kCardSize) {
+      bitmap_->Set(reinterpret_cast<mirror::Object*>(HeapBegin() + offset));
+    }
+  }
+
+  // Dirties every stride-th card and returns the number of cards dirtied.
+  size_t DirtyCards(size_t heap_capacity, size_t stride) {
+    size_t num_dirty = 0;
+    for (size_t offset = 0; offset < heap_capacity; offset += stride * CardTable::kCardSize) {
+      card_table_->MarkCard(HeapBegin() + offset);
+      ++num_dirty;
+    }
+    return num_dirty;
+  }
+
+  std::unique_ptr<CardTable> card_table_;
+  std::unique_ptr<ContinuousSpaceBitmap> bitmap_;
+};
+
+class CountVisitor {
+ public:
+  explicit CountVisitor(size_t* count) : count_(count) {}
+
+  void operator()(mirror::Object* obj) const {
+    UNUSED(obj);
+    ++*count_;
+  }
+
+ private:
+  size_t* const count_;
+};
+
+class AgeCardVisitor {
+ public:
+  byte operator()(byte card) const {
+    return (card == CardTable::kCardDirty) ? card - 1 : 0;
+  }
+};
+
+class CountModifiedVisitor {
+ public:
+  explicit CountModifiedVisitor(size_t* count) : count_(count) {}
+
+  void operator()(byte* card, byte expected_value, byte new_value) const {
+    UNUSED(card);
+    EXPECT_NE(expected_value, new_value);
+    ++*count_;
+  }
+
+ private:
+  size_t* const count_;
+};
+
+TEST_F(CardTableTest, ScanAndAge) {
+  const size_t heap_capacity = 4 * MB;
+  CreateTables(heap_capacity);
+  MarkObjectPerCard(heap_capacity);
+  ScopedObjectAccess soa(Thread::Current());
+  WriterMutexLock mu(soa.Self(), *Locks::heap_bitmap_lock_);
+  const size_t num_cards = heap_capacity / CardTable::kCardSize;
+  // Dirty cards at irregular positions, inside and across the blocks tested at once.
+  size_t num_dirty = 0;
+  for (size_t i = 0; i < num_cards; i += (i % 7) * 13 + 1) {
+    card_table_->MarkCard(HeapBegin() + i * CardTable::kCardSize);
+    ++num_dirty;
+  }
+  byte* heap_end = HeapBegin() + heap_capacity;
+  size_t num_visited = 0;
+  EXPECT_EQ(num_dirty, card_table_->Scan(bitmap_.get(), HeapBegin(), heap_end,
+                                         CountVisitor(&num_visited)));
+  EXPECT_EQ(num_dirty, num_visited);
+
+  // Unaligned ranges, which start and end inside words of cards.
+  for (size_t begin_card : { 1u, 3u, 37u }) {
+    for (size_t end_card : { num_cards - 1, num_cards - 5, num_cards - 70 }) {
+      size_t expected = 0;
+      for (size_t i = begin_card; i < end_card; ++i) {
+        if (card_table_->GetCard(reinterpret_cast<mirror::Object*>(
+                HeapBegin() + i * CardTable::kCardSize)) == CardTable::kCardDirty) {
+          ++expected;
+        }
+      }
+      num_visited = 0;
+      EXPECT_EQ(expected, card_table_->Scan(bitmap_.get(),
+                                            HeapBegin() + begin_card * CardTable::kCardSize,
+                                            HeapBegin() + end_card * CardTable::kCardSize,
+                                            CountVisitor(&num_visited)));
+      EXPECT_EQ(expected, num_visited);
+    }
+  }
+
+  // Aging modifies exactly the dirty cards, which are found again with the aged minimum age.
+  size_t num_modified = 0;
+  card_table_->ModifyCardsAtomic(HeapBegin(), heap_end, AgeCardVisitor(),
+                                 CountModifiedVisitor(&num_modified));
+  EXPECT_EQ(num_dirty, num_modified);
+  num_visited = 0;
+  EXPECT_EQ(0U, card_table_->Scan(bitmap_.get(), HeapBegin(), heap_end,
+                                  CountVisitor(&num_visited)));
+  EXPECT_EQ(num_dirty, card_table_->Scan(bitmap_.get(), HeapBegin(), heap_end,
+                                         CountVisitor(&num_visited),
+                                         CardTable::kCardDirty - 1));
+  // A second aging clears them.
+  num_modified = 0;
+  card_table_->ModifyCardsAtomic(HeapBegin(), heap_end, AgeCardVisitor(),
+                                 CountModifiedVisitor(&num_modified));
+  EXPECT_EQ(num_dirty, num_modified);
+  EXPECT_EQ(0U, card_table_->Scan(bitmap_.get(), HeapBegin(), heap_end,
+                                  CountVisitor(&num_visited), 1));
+}
+
+class RandGen {
+ public:
+  explicit RandGen(uint32_t seed) : val_(seed) {}
+
+  uint32_t next() {
+    val_ = val_ * 48271 % 2147483647;
+    return val_;
+  }
+
+  uint32_t val_;
+};
+
+// The block-wise scan and aging agree with a card by card walk on random card patterns, from
+// mostly clean tables to mostly dirty ones.
+TEST_F(CardTableTest, RandomCards) {
+  const size_t heap_capacity = 1 * MB;
+  CreateTables(heap_capacity);
+  MarkObjectPerCard(heap_capacity);
+  ScopedObjectAccess soa(Thread::Current());
+  WriterMutexLock mu(soa.Self(), *Locks::heap_bitmap_lock_);
+  const size_t num_cards = heap_capacity / CardTable::kCardSize;
+  static constexpr byte kCardValues[] = {
+      CardTable::kCardClean, 1, CardTable::kCardDirty - 1, CardTable::kCardDirty };
+  // Seed with 0x1234 for reproducability.
+  RandGen r(0x1234);
+  for (size_t percent_not_clean : { 0u, 1u, 10u, 50u, 100u }) {
+    std::vector<byte> cards(num_cards);
+    for (size_t i = 0; i < num_cards; ++i) {
+      cards[i] = (r.next() % 100 < percent_not_clean) ? kCardValues[1 + r.next() % 3]
+                                                      : CardTable::kCardClean;
+      *card_table_->CardFromAddr(HeapBegin() + i * CardTable::kCardSize) = cards[i];
+    }
+    for (size_t j = 0; j < 20; ++j) {
+      size_t begin_card = r.next() % num_cards;
+      size_t end_card = begin_card + r.next() % (num_cards - begin_card + 1);
+      for (byte minimum_age : { static_cast<byte>(1),
+                                static_cast<byte>(CardTable::kCardDirty) }) {
+        size_t expected = 0;
+        for (size_t i = begin_card; i < end_card; ++i) {
+          if (cards[i] >= minimum_age) {
+            ++expected;
+          }
+        }
+        size_t num_visited = 0;
+        EXPECT_EQ(expected, card_table_->Scan(bitmap_.get(),
+                                              HeapBegin() + begin_card * CardTable::kCardSize,
+                                              HeapBegin() + end_card * CardTable::kCardSize,
+                                              CountVisitor(&num_visited), minimum_age))
+            << begin_card << " " << end_card << " " << static_cast<int>(minimum_age);
+        EXPECT_EQ(expected, num_visited);
+      }
+    }
+    size_t expected_modified = 0;
+    for (size_t i = 0; i < num_cards; ++i) {
+      byte aged = AgeCardVisitor()(cards[i]);
+      if (aged != cards[i]) {
+        ++expected_modified;
+      }
+      cards[i] = aged;
+    }
+    size_t num_modified = 0;
+    card_table_->ModifyCardsAtomic(HeapBegin(), HeapBegin() + heap_capacity, AgeCardVisitor(),
+                                   CountModifiedVisitor(&num_modified));
+    EXPECT_EQ(expected_modified, num_modified);
+    for (size_t i = 0; i < num_cards; ++i) {
+      ASSERT_EQ(cards[i], card_table_->GetCard(
+          reinterpret_cast<mirror::Object*>(HeapBegin() + i * CardTable::kCardSize))) << i;
+    }
+  }
+}
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
@@ -302,6 +302,65 @@ void ModUnionTableReferenceCache::UpdateAndMarkReferences(MarkHeapReferenceCallb
   }
 }
 
+size_t ModUnionTableReferenceCache::PrepareParallelUpdate() {
+  DCHECK(parallel_cleared_cards_.empty());
+  parallel_cleared_cards_.assign(cleared_cards_.begin(), cleared_cards_.end());
+  parallel_card_references_.resize(parallel_cleared_cards_.size());
+  for (const auto& ref_pair : references_) {
+    if (cleared_cards_.find(const_cast<byte*>(ref_pair.first)) == cleared_cards_.end()) {
+      parallel_other_references_.push_back(&ref_pair.second);
+    }
+  }
+  return parallel_cleared_cards_.size() + parallel_other_references_.size();
+}
+
+void ModUnionTableReferenceCache::UpdateAndMarkReferences(size_t begin, size_t end,
+                                                          MarkHeapReferenceCallback* callback,
+                                                          void* arg) {
+  CardTable* card_table = heap_->GetCardTable();
+  const size_t num_cleared_cards = parallel_cleared_cards_.size();
+  for (size_t i = begin; i < end; ++i) {
+    if (i < num_cleared_cards) {
+      // Re-compute the references of the card into its own slot, the table itself is only updated
+      // by FinishParallelUpdate.
+      std::vector<mirror::HeapReference<Object>*>* cards_references =
+          &parallel_card_references_[i];
+      ModUnionReferenceVisitor add_visitor(this, cards_references);
+      uintptr_t start =
+          reinterpret_cast<uintptr_t>(card_table->AddrFromCard(parallel_cleared_cards_[i]));
+      auto* space = heap_->FindContinuousSpaceFromObject(reinterpret_cast<Object*>(start), false);
+      DCHECK(space != nullptr);
+      space->GetLiveBitmap()->VisitMarkedRange(start, start + CardTable::kCardSize, add_visitor);
+      for (mirror::HeapReference<Object>* obj_ptr : *cards_references) {
+        callback(obj_ptr, arg);
+      }
+    } else {
+      const auto* refs = parallel_other_references_[i - num_cleared_cards];
+      for (mirror::HeapReference<Object>* obj_ptr : *refs) {
+        callback(obj_ptr, arg);
+      }
+    }
+  }
+}
+
+void ModUnionTableReferenceCache::FinishParallelUpdate() {
+  for (size_t i = 0; i < parallel_cleared_cards_.size(); ++i) {
+    byte* card = parallel_cleared_cards_[i];
+    auto found = references_.find(card);
+    if (found == references_.end()) {
+      if (!parallel_card_references_[i].empty()) {
+        references_.Put(card, parallel_card_references_[i]);
+      }
+    } else {
+      found->second.swap(parallel_card_references_[i]);
+    }
+  }
+  cleared_cards_.clear();
+  parallel_cleared_cards_.clear();
+  parallel_card_references_.clear();
+  parallel_other_references_.clear();
+}
+
 void ModUnionTableCardCache::ClearCards() {
   CardTable* card_table = GetHeap()->GetCardTable();
   ModUnionClearCardSetVisitor visitor(&cleared_cards_);
@@ -322,6 +381,31 @@ void ModUnionTableCardCache::UpdateAndMarkReferences(MarkHeapReferenceCallback*
   }
 }
 
+size_t ModUnionTableCardCache::PrepareParallelUpdate() {
+  DCHECK(parallel_cleared_cards_.empty());
+  parallel_cleared_cards_.assign(cleared_cards_.begin(), cleared_cards_.end());
+  return parallel_cleared_cards_.size();
+}
+
+void ModUnionTableCardCache::UpdateAndMarkReferences(size_t begin, size_t end,
+                                                     MarkHeapReferenceCallback* callback,
+                                                     void* arg) {
+  CardTable* card_table = heap_->GetCardTable();
+  ModUnionScanImageRootVisitor scan_visitor(callback, arg);
+  ContinuousSpaceBitmap* bitmap = space_->GetLiveBitmap();
+  for (size_t i = begin; i < end; ++i) {
+    uintptr_t start =
+        reinterpret_cast<uintptr_t>(card_table->AddrFromCard(parallel_cleared_cards_[i]));
+    DCHECK(space_->HasAddress(reinterpret_cast<Object*>(start)));
+    bitmap->VisitMarkedRange(start, start + CardTable::kCardSize, scan_visitor);
+  }
+}
+
+void ModUnionTableCardCache::FinishParallelUpdate() {
+  // The cards stay in the table like with UpdateAndMarkReferences.
+  parallel_cleared_cards_.clear();
+}
+
 void ModUnionTableCardCache::Dump(std::ostream& os) {
   CardTable* card_table = heap_->GetCardTable();
   os << "ModUnionTable dirty cards: [";
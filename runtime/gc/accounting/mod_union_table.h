@@ -70,6 +70,15 @@ class ModUnionTable {
   // spaces which are stored in the mod-union table.
   virtual void UpdateAndMarkReferences(MarkHeapReferenceCallback* callback, void* arg) = 0;
 
+  // The same update split for the GC thread pool: PrepareParallelUpdate returns the number of work
+  // items, disjoint ranges of them are then processed concurrently by UpdateAndMarkReferences,
+  // which may call the callback from several threads, and FinishParallelUpdate commits the
+  // updates.
+  virtual size_t PrepareParallelUpdate() = 0;
+  virtual void UpdateAndMarkReferences(size_t begin, size_t end,
+                                       MarkHeapReferenceCallback* callback, void* arg) = 0;
+  virtual void FinishParallelUpdate() = 0;
+
   // Verification, sanity checks that we don't have clean cards which conflict with out cached data
   // for said cards. Exclusive lock is required since verify sometimes uses
   // SpaceBitmap::VisitMarkedRange and VisitMarkedRange can't know if the callback will modify the
@@ -109,6 +118,15 @@ class ModUnionTableReferenceCache : public ModUnionTable {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
+  // The work items are the cleared cards, whose references are recomputed, followed by the other
+  // cards of the table, whose cached references are marked.
+  size_t PrepareParallelUpdate();
+  void UpdateAndMarkReferences(size_t begin, size_t end, MarkHeapReferenceCallback* callback,
+                               void* arg)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void FinishParallelUpdate();
+
   // Exclusive lock is required since verify uses SpaceBitmap::VisitMarkedRange and
   // VisitMarkedRange can't know if the callback will modify the bitmap or not.
   void Verify()
@@ -128,6 +146,13 @@ class ModUnionTableReferenceCache : public ModUnionTable {
   SafeMap<const byte*, std::vector<mirror::HeapReference<mirror::Object>*>, std::less<const byte*>,
       GcAllocator<std::pair<const byte*, std::vector<mirror::HeapReference<mirror::Object>*>>> >
       references_;
+
+  // The work items of a parallel update: the cleared cards with their recomputed references, and
+  // the cached references of the other cards.
+  std::vector<byte*> parallel_cleared_cards_;
+  std::vector<std::vector<mirror::HeapReference<mirror::Object>*>> parallel_card_references_;
+  std::vector<const std::vector<mirror::HeapReference<mirror::Object>*>*>
+      parallel_other_references_;
 };
 
 // Card caching implementation. Keeps track of which cards we cleared and only this information.
@@ -145,6 +170,14 @@ class ModUnionTableCardCache : public ModUnionTable {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // The work items are the cleared cards.
+  size_t PrepareParallelUpdate();
+  void UpdateAndMarkReferences(size_t begin, size_t end, MarkHeapReferenceCallback* callback,
+                               void* arg)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void FinishParallelUpdate();
+
   // Nothing to verify.
   void Verify() {}
 
@@ -153,6 +186,9 @@ class ModUnionTableCardCache : public ModUnionTable {
  protected:
   // Cleared card array, used to update the mod-union table.
   CardSet cleared_cards_;
+
+  // The cleared cards in the order of the work items of a parallel update.
+  std::vector<const byte*> parallel_cleared_cards_;
 };
 
 }  // namespace accounting
@@ -39,22 +39,26 @@ namespace accounting {
 
 class RememberedSetCardVisitor {
  public:
-  explicit RememberedSetCardVisitor(RememberedSet::CardSet* const dirty_cards)
-      : dirty_cards_(dirty_cards) {}
+  RememberedSetCardVisitor(RememberedSet::CardSet* const dirty_cards,
+                           RememberedSet::CardSlotMap* const card_slots)
+      : dirty_cards_(dirty_cards), card_slots_(card_slots) {}
 
   void operator()(byte* card, byte expected_value, byte new_value) const {
     if (expected_value == CardTable::kCardDirty) {
       dirty_cards_->insert(card);
+      // The card was written to, its remembered slots may be out of date.
+      card_slots_->erase(card);
     }
   }
 
  private:
   RememberedSet::CardSet* const dirty_cards_;
+  RememberedSet::CardSlotMap* const card_slots_;
 };
 
 void RememberedSet::ClearCards() {
   CardTable* card_table = GetHeap()->GetCardTable();
-  RememberedSetCardVisitor card_visitor(&dirty_cards_);
+  RememberedSetCardVisitor card_visitor(&dirty_cards_, &card_slots_);
   // Clear dirty cards in the space and insert them into the dirty card set.
   card_table->ModifyCardsAtomic(space_->Begin(), space_->End(), AgeCardVisitor(), card_visitor);
 }
@@ -64,9 +68,12 @@ class RememberedSetReferenceVisitor {
   RememberedSetReferenceVisitor(MarkHeapReferenceCallback* callback,
                                 DelayReferenceReferentCallback* ref_callback,
                                 space::ContinuousSpace* target_space,
-                                bool* const contains_reference_to_target_space, void* arg)
+                                bool* const contains_reference_to_target_space,
+                                RememberedSet::SlotList* const slots, bool* const slots_precise,
+                                void* arg)
       : callback_(callback), ref_callback_(ref_callback), target_space_(target_space), arg_(arg),
-        contains_reference_to_target_space_(contains_reference_to_target_space) {}
+        contains_reference_to_target_space_(contains_reference_to_target_space), slots_(slots),
+        slots_precise_(slots_precise) {}
 
   void operator()(mirror::Object* obj, MemberOffset offset, bool /* is_static */) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -74,6 +81,7 @@ class RememberedSetReferenceVisitor {
     mirror::HeapReference<mirror::Object>* ref_ptr = obj->GetFieldObjectReferenceAddr(offset);
     if (target_space_->HasAddress(ref_ptr->AsMirrorPtr())) {
       *contains_reference_to_target_space_ = true;
+      slots_->push_back(ref_ptr);
       callback_(ref_ptr, arg_);
       DCHECK(!target_space_->HasAddress(ref_ptr->AsMirrorPtr()));
     }
@@ -84,6 +92,8 @@ class RememberedSetReferenceVisitor {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_) {
     if (target_space_->HasAddress(ref->GetReferent())) {
       *contains_reference_to_target_space_ = true;
+      // The referent goes through the reference processing, not a plain slot.
+      *slots_precise_ = false;
       ref_callback_(klass, ref, arg_);
     }
   }
@@ -94,6 +104,8 @@ class RememberedSetReferenceVisitor {
   space::ContinuousSpace* const target_space_;
   void* const arg_;
   bool* const contains_reference_to_target_space_;
+  RememberedSet::SlotList* const slots_;
+  bool* const slots_precise_;
 };
 
 class RememberedSetObjectVisitor {
@@ -101,14 +113,18 @@ class RememberedSetObjectVisitor {
   RememberedSetObjectVisitor(MarkHeapReferenceCallback* callback,
                              DelayReferenceReferentCallback* ref_callback,
                              space::ContinuousSpace* target_space,
-                             bool* const contains_reference_to_target_space, void* arg)
+                             bool* const contains_reference_to_target_space,
+                             RememberedSet::SlotList* const slots, bool* const slots_precise,
+                             void* arg)
       : callback_(callback), ref_callback_(ref_callback), target_space_(target_space), arg_(arg),
-        contains_reference_to_target_space_(contains_reference_to_target_space) {}
+        contains_reference_to_target_space_(contains_reference_to_target_space), slots_(slots),
+        slots_precise_(slots_precise) {}
 
   void operator()(mirror::Object* obj) const EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     RememberedSetReferenceVisitor visitor(callback_, ref_callback_, target_space_,
-                                          contains_reference_to_target_space_, arg_);
+                                          contains_reference_to_target_space_, slots_,
+                                          slots_precise_, arg_);
     obj->VisitReferences<kMovingClasses>(visitor, visitor);
   }
 
@@ -118,6 +134,8 @@ class RememberedSetObjectVisitor {
   space::ContinuousSpace* const target_space_;
   void* const arg_;
   bool* const contains_reference_to_target_space_;
+  RememberedSet::SlotList* const slots_;
+  bool* const slots_precise_;
 };
 
 void RememberedSet::UpdateAndMarkReferences(MarkHeapReferenceCallback* callback,
@@ -125,15 +143,43 @@ void RememberedSet::UpdateAndMarkReferences(MarkHeapReferenceCallback* callback,
                                             space::ContinuousSpace* target_space, void* arg) {
   CardTable* card_table = heap_->GetCardTable();
   bool contains_reference_to_target_space = false;
+  SlotList slots;
+  bool slots_precise = true;
   RememberedSetObjectVisitor obj_visitor(callback, ref_callback, target_space,
-                                         &contains_reference_to_target_space, arg);
+                                         &contains_reference_to_target_space, &slots,
+                                         &slots_precise, arg);
   ContinuousSpaceBitmap* bitmap = space_->GetLiveBitmap();
   CardSet remove_card_set;
   for (byte* const card_addr : dirty_cards_) {
     contains_reference_to_target_space = false;
-    uintptr_t start = reinterpret_cast<uintptr_t>(card_table->AddrFromCard(card_addr));
-    DCHECK(space_->HasAddress(reinterpret_cast<mirror::Object*>(start)));
-    bitmap->VisitMarkedRange(start, start + CardTable::kCardSize, obj_visitor);
+    auto it = card_slots_.find(card_addr);
+    if (kUsePreciseSlots && it != card_slots_.end()) {
+      // The card is clean since its last scan, only the slots which referred to the target space
+      // then can do so now. Keep the ones which still do.
+      SlotList* card_slots = &it->second;
+      size_t kept = 0;
+      for (mirror::HeapReference<mirror::Object>* ref_ptr : *card_slots) {
+        if (target_space->HasAddress(ref_ptr->AsMirrorPtr())) {
+          callback(ref_ptr, arg);
+          DCHECK(!target_space->HasAddress(ref_ptr->AsMirrorPtr()));
+          (*card_slots)[kept++] = ref_ptr;
+        }
+      }
+      card_slots->resize(kept);
+      contains_reference_to_target_space = kept != 0;
+      if (!contains_reference_to_target_space) {
+        card_slots_.erase(it);
+      }
+    } else {
+      slots.clear();
+      slots_precise = true;
+      uintptr_t start = reinterpret_cast<uintptr_t>(card_table->AddrFromCard(card_addr));
+      DCHECK(space_->HasAddress(reinterpret_cast<mirror::Object*>(start)));
+      bitmap->VisitMarkedRange(start, start + CardTable::kCardSize, obj_visitor);
+      if (kUsePreciseSlots && contains_reference_to_target_space && slots_precise) {
+        card_slots_.Put(card_addr, slots);
+      }
+    }
     if (!contains_reference_to_target_space) {
       // It was in the dirty card set, but it didn't actually contain
       // a reference to the target space. So, remove it from the dirty
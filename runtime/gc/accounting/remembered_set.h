@@ -43,7 +43,14 @@ namespace accounting {
 // from the free list spaces to the bump pointer spaces.
 class RememberedSet {
  public:
+  // If true, remember the addresses of the references to the target space found on a card and
+  // only visit those while the card stays clean, rather than rescanning all of its objects.
+  static constexpr bool kUsePreciseSlots = true;
+
   typedef std::set<byte*, std::less<byte*>, GcAllocator<byte*>> CardSet;
+  typedef std::vector<mirror::HeapReference<mirror::Object>*> SlotList;
+  typedef SafeMap<const byte*, SlotList, std::less<const byte*>,
+      GcAllocator<std::pair<const byte*, SlotList>>> CardSlotMap;
 
   explicit RememberedSet(const std::string& name, Heap* heap, space::ContinuousSpace* space)
       : name_(name), heap_(heap), space_(space) {}
@@ -51,6 +58,12 @@ class RememberedSet {
   // Clear dirty cards and add them to the dirty card set.
   void ClearCards();
 
+  // Forget the remembered slots, needed before the objects of the space may be freed since a slot
+  // could then end up in the middle of a new object.
+  void ClearSlots() {
+    card_slots_.clear();
+  }
+
   // Mark through all references to the target space.
   void UpdateAndMarkReferences(MarkHeapReferenceCallback* callback,
                                DelayReferenceReferentCallback* ref_callback,
@@ -77,6 +90,10 @@ class RememberedSet {
   space::ContinuousSpace* const space_;
 
   CardSet dirty_cards_;
+  // The references to the target space of the remembered cards which weren't dirtied since their
+  // last scan, if kUsePreciseSlots. Cards with java.lang.ref.Reference objects referring to the
+  // target space are always rescanned.
+  CardSlotMap card_slots_;
 };
 
 }  // namespace accounting
@@ -121,8 +121,14 @@ inline void SpaceBitmap<kAlignment>::VisitMarkedRange(uintptr_t visit_begin, uin
       } while (left_edge != 0);
     }
 
-    // Traverse the middle, full part.
+    // Traverse the middle, full part. Skip the groups of zero words first.
     for (size_t i = index_start + 1; i < index_end; ++i) {
+      while (i + kZeroSkipWords <= index_end && IsZeroGroup(&bitmap_begin_[i])) {
+        i += kZeroSkipWords;
+      }
+      if (i == index_end) {
+        break;
+      }
       uword w = bitmap_begin_[i];
       if (w != 0) {
         const uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
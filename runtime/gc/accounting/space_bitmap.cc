@@ -57,6 +57,8 @@ SpaceBitmap<kAlignment>* SpaceBitmap<kAlignment>::Create(
     LOG(ERROR) << "Failed to allocate bitmap " << name << ": " << error_msg;
     return nullptr;
   }
+  mem_map->AdviseHugePages();
+  mem_map->AdviseNumaInterleave();
   return CreateFromMemMap(name, mem_map.release(), heap_begin, heap_capacity);
 }
 
@@ -144,6 +146,13 @@ void SpaceBitmap<kAlignment>::SweepWalk(const SpaceBitmap<kAlignment>& live_bitm
   uword* live = live_bitmap.bitmap_begin_;
   uword* mark = mark_bitmap.bitmap_begin_;
   for (size_t i = start; i <= end; i++) {
+    // Skip the groups of words without live objects, in sparse spaces most of them.
+    while (i + kZeroSkipWords <= end + 1 && IsZeroGroup(&live[i])) {
+      i += kZeroSkipWords;
+    }
+    if (i > end) {
+      break;
+    }
     uword garbage = live[i] & ~mark[i];
     if (UNLIKELY(garbage != 0)) {
       uintptr_t ptr_base = IndexToOffset(i) + live_bitmap.heap_begin_;
@@ -257,6 +266,7 @@ void SpaceBitmap<kAlignment>::InOrderWalk(ObjectCallback* callback, void* arg) {
 
 template class SpaceBitmap<kObjectAlignment>;
 template class SpaceBitmap<kPageSize>;
+template class SpaceBitmap<sizeof(uint32_t)>;
 
 }  // namespace accounting
 }  // namespace gc
@@ -204,6 +204,20 @@ class SpaceBitmap {
   // Helper function for computing bitmap size based on a 64 bit capacity.
   static size_t ComputeBitmapSize(uint64_t capacity);
 
+  // The walks test this many bitmap words at once for zero, 128 bits on 32-bit targets and 256 bits
+  // on 64-bit ones, to get over the empty stretches of sparse bitmaps quickly.
+  static constexpr size_t kZeroSkipWords = 4;
+
+  // Whether the kZeroSkipWords words at words are all zero. Or-ing them rather than branching on
+  // each lets the compiler use vector loads.
+  static bool IsZeroGroup(const uword* words) ALWAYS_INLINE {
+    uword bits = 0;
+    for (size_t i = 0; i < kZeroSkipWords; ++i) {
+      bits |= words[i];
+    }
+    return bits == 0;
+  }
+
   template<bool kSetBit>
   bool Modify(const mirror::Object* obj);
 
@@ -235,6 +249,8 @@ class SpaceBitmap {
 
 typedef SpaceBitmap<kObjectAlignment> ContinuousSpaceBitmap;
 typedef SpaceBitmap<kLargeObjectAlignment> LargeObjectBitmap;
+// The words of an image holding absolute addresses, see ImageHeader::GetRelocationBitmapSize().
+typedef SpaceBitmap<sizeof(uint32_t)> RelocationBitmap;
 
 template<size_t kAlignment>
 std::ostream& operator << (std::ostream& stream, const SpaceBitmap<kAlignment>& bitmap);
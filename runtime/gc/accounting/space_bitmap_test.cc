@@ -165,6 +165,51 @@ TEST_F(SpaceBitmapTest, VisitorPageAlignment) {
   RunTest<kPageSize>();
 }
 
+static void CountSwept(size_t ptr_count, mirror::Object** ptrs, void* arg) {
+  *reinterpret_cast<size_t*>(arg) += ptr_count;
+}
+
+TEST_F(SpaceBitmapTest, SweepWalkSparse) {
+  byte* heap_begin = reinterpret_cast<byte*>(0x10000000);
+  size_t heap_capacity = 16 * MB;
+  std::unique_ptr<ContinuousSpaceBitmap> live_bitmap(
+      ContinuousSpaceBitmap::Create("live bitmap", heap_begin, heap_capacity));
+  std::unique_ptr<ContinuousSpaceBitmap> mark_bitmap(
+      ContinuousSpaceBitmap::Create("mark bitmap", heap_begin, heap_capacity));
+  // Few live objects, most of the bitmap words are zero. Mark one live object out of three.
+  RandGen r(0x1234);
+  for (int i = 0; i < 1000; ++i) {
+    const mirror::Object* obj = reinterpret_cast<mirror::Object*>(
+        heap_begin + RoundDown(r.next() % heap_capacity, kObjectAlignment));
+    live_bitmap->Set(obj);
+    if (i % 3 == 0) {
+      mark_bitmap->Set(obj);
+    }
+  }
+  for (int i = 0; i < 50; ++i) {
+    size_t begin = RoundDown(r.next() % heap_capacity, kObjectAlignment);
+    size_t end = begin + RoundDown(r.next() % (heap_capacity - begin + 1), kObjectAlignment);
+    size_t swept = 0;
+    ContinuousSpaceBitmap::SweepWalk(*live_bitmap, *mark_bitmap,
+                                     reinterpret_cast<uintptr_t>(heap_begin) + begin,
+                                     reinterpret_cast<uintptr_t>(heap_begin) + end,
+                                     CountSwept, &swept);
+    // SweepWalk works on whole bitmap words.
+    const size_t kWordBytes = kBitsPerWord * kObjectAlignment;
+    size_t manual = 0;
+    if (end > begin) {
+      for (size_t k = RoundDown(begin, kWordBytes); k < RoundUp(end, kWordBytes);
+           k += kObjectAlignment) {
+        const mirror::Object* obj = reinterpret_cast<mirror::Object*>(heap_begin + k);
+        if (live_bitmap->Test(obj) && !mark_bitmap->Test(obj)) {
+          manual++;
+        }
+      }
+    }
+    EXPECT_EQ(manual, swept);
+  }
+}
+
 }  // namespace accounting
 }  // namespace gc
 }  // namespace art
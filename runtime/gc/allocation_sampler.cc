@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "allocation_sampler.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <ostream>
+
+#include "base/stringprintf.h"
+#include "dex_file.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
+#include "stack.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+namespace gc {
+
+constexpr size_t AllocationSampler::kNumSamples;
+constexpr size_t AllocationSampler::kMaxStackDepth;
+
+AllocationSampler::AllocationSampler()
+    : lock_("allocation sampler lock"), interval_(0), num_samples_(0), slots_(nullptr) {
+  COMPILE_ASSERT(IsPowerOfTwo(kNumSamples), number_of_samples_not_a_power_of_two);
+}
+
+AllocationSampler::~AllocationSampler() {
+  delete[] slots_.LoadRelaxed();
+}
+
+bool AllocationSampler::Start(size_t interval) {
+  CHECK_NE(interval, 0U);
+  MutexLock mu(Thread::Current(), lock_);
+  if (slots_.LoadRelaxed() == nullptr) {
+    Slot* slots = new Slot[kNumSamples];
+    for (size_t i = 0; i < kNumSamples; ++i) {
+      slots[i].sequence.StoreRelaxed(0);
+    }
+    // Published before the interval enables the sampling.
+    slots_.StoreSequentiallyConsistent(slots);
+  }
+  bool was_sampling = IsSampling();
+  interval_.StoreSequentiallyConsistent(interval);
+  return !was_sampling;
+}
+
+bool AllocationSampler::Stop() {
+  MutexLock mu(Thread::Current(), lock_);
+  bool was_sampling = IsSampling();
+  interval_.StoreSequentiallyConsistent(0);
+  return was_sampling;
+}
+
+size_t AllocationSampler::NextSampleDistance(Thread* self, size_t interval) {
+  // SplitMix64 of the time and the thread, random enough for spreading the samples.
+  uint64_t x = NanoTime() + static_cast<uint64_t>(self->GetTid()) * UINT64_C(0x9E3779B97F4A7C15);
+  x = (x ^ (x >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+  x = (x ^ (x >> 27)) * UINT64_C(0x94D049BB133111EB);
+  x ^= x >> 31;
+  // Uniform in (0, 1].
+  double uniform = (static_cast<double>(x >> 11) + 1.0) / static_cast<double>(UINT64_C(1) << 53);
+  double distance = -log(uniform) * static_cast<double>(interval);
+  // Bound the tail so that a thread is sampled again in reasonable time.
+  return static_cast<size_t>(std::max(1.0, std::min(distance, 64.0 * interval)));
+}
+
+void AllocationSampler::RecordAllocation(Thread* self, mirror::Class* klass, size_t byte_count) {
+  const size_t interval = interval_.LoadRelaxed();
+  if (interval == 0) {
+    return;
+  }
+  size_t bytes_left = self->GetAllocationSampleBytesLeft();
+  if (LIKELY(bytes_left > byte_count)) {
+    self->SetAllocationSampleBytesLeft(bytes_left - byte_count);
+    return;
+  }
+  // A thread not sampled yet only draws its first distance.
+  if (bytes_left != 0) {
+    TakeSample(self, klass, byte_count);
+  }
+  self->SetAllocationSampleBytesLeft(NextSampleDistance(self, interval));
+}
+
+class SampleStackVisitor : public StackVisitor {
+ public:
+  SampleStackVisitor(Thread* thread, AllocationSampler::Sample* sample)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      : StackVisitor(thread, nullptr), sample_(sample) {
+    sample_->depth = 0;
+  }
+
+  bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (sample_->depth == AllocationSampler::kMaxStackDepth) {
+      return false;
+    }
+    mirror::ArtMethod* m = GetMethod();
+    if (!m->IsRuntimeMethod() && !m->IsProxyMethod()) {
+      AllocationSampler::Frame* frame = &sample_->stack[sample_->depth++];
+      frame->dex_file = &MethodHelper(m).GetDexFile();
+      frame->method_index = m->GetDexMethodIndex();
+      frame->dex_pc = GetDexPc();
+    }
+    return true;
+  }
+
+ private:
+  AllocationSampler::Sample* const sample_;
+};
+
+void AllocationSampler::TakeSample(Thread* self, mirror::Class* klass, size_t byte_count) {
+  const uint64_t index = num_samples_.FetchAndAddSequentiallyConsistent(1);
+  Slot* slot = &slots_.LoadRelaxed()[index & (kNumSamples - 1)];
+  // The sequence is odd while the sample is written, the readers skip the slot meanwhile.
+  slot->sequence.StoreSequentiallyConsistent(2 * index + 1);
+  QuasiAtomic::MembarStoreStore();
+  Sample* sample = &slot->sample;
+  std::string descriptor(klass->GetDescriptor());
+  size_t length = std::min(descriptor.size(), kMaxDescriptorLength - 1);
+  memcpy(sample->descriptor, descriptor.data(), length);
+  sample->descriptor[length] = '\0';
+  sample->byte_count = byte_count;
+  sample->thread_id = self->GetThreadId();
+  SampleStackVisitor visitor(self, sample);
+  visitor.WalkStack();
+  QuasiAtomic::MembarStoreStore();
+  slot->sequence.StoreSequentiallyConsistent(2 * index + 2);
+}
+
+void AllocationSampler::GetSamples(std::vector<Sample>* samples) const {
+  samples->clear();
+  const Slot* slots = slots_.LoadSequentiallyConsistent();
+  if (slots == nullptr) {
+    return;
+  }
+  const uint64_t end = num_samples_.LoadSequentiallyConsistent();
+  const uint64_t begin = (end > kNumSamples) ? end - kNumSamples : 0;
+  samples->reserve(end - begin);
+  for (uint64_t index = begin; index < end; ++index) {
+    const Slot* slot = &slots[index & (kNumSamples - 1)];
+    const uint64_t sequence = slot->sequence.LoadSequentiallyConsistent();
+    if (sequence != 2 * index + 2) {
+      // Being written, or already overwritten by a newer sample.
+      continue;
+    }
+    QuasiAtomic::MembarLoadLoad();
+    Sample sample = slot->sample;
+    QuasiAtomic::MembarLoadLoad();
+    if (slot->sequence.LoadSequentiallyConsistent() == sequence) {
+      samples->push_back(sample);
+    }
+  }
+}
+
+void AllocationSampler::DumpSamples(std::ostream& os) const {
+  std::vector<Sample> samples;
+  GetSamples(&samples);
+  for (const Sample& sample : samples) {
+    os << PrettyDescriptor(sample.descriptor) << " " << sample.byte_count << " bytes, thread "
+       << sample.thread_id << "\n";
+    for (size_t i = 0; i < sample.depth; ++i) {
+      const Frame& frame = sample.stack[i];
+      os << "  at " << PrettyMethod(frame.method_index, *frame.dex_file, false)
+         << StringPrintf(" (dex pc 0x%x)", frame.dex_pc) << "\n";
+    }
+  }
+}
+
+}  // namespace gc
+}  // namespace art
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_GC_ALLOCATION_SAMPLER_H_
+#define ART_RUNTIME_GC_ALLOCATION_SAMPLER_H_
+
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class DexFile;
+class Thread;
+
+namespace mirror {
+class Class;
+}  // namespace mirror
+
+namespace gc {
+
+// Samples the allocations, on average one every interval bytes allocated by each thread, at
+// intervals drawn from an exponential distribution so that the samples are a Poisson process of
+// the allocated bytes. Each sample records the class and the stack of the allocation. The samples
+// are written into a ring buffer without locks, the most recent kNumSamples can be read anytime.
+// The allocations are sampled by the instrumented allocation paths, which the heap enables while
+// sampling.
+class AllocationSampler {
+ public:
+  static constexpr size_t kNumSamples = 1024;  // Must be a power of 2.
+  static constexpr size_t kMaxStackDepth = 16;
+  static constexpr size_t kMaxDescriptorLength = 64;
+
+  // A frame of the stack of a sample. Dex files and method indexes don't move, unlike methods.
+  struct Frame {
+    const DexFile* dex_file;
+    uint32_t method_index;
+    uint32_t dex_pc;
+  };
+
+  struct Sample {
+    // The descriptor of the class, truncated and nul terminated.
+    char descriptor[kMaxDescriptorLength];
+    size_t byte_count;
+    uint32_t thread_id;
+    uint32_t depth;
+    Frame stack[kMaxStackDepth];
+  };
+
+  AllocationSampler();
+  ~AllocationSampler();
+
+  // Starts sampling, or changes the interval if already sampling. Returns false if it was already
+  // sampling.
+  bool Start(size_t interval) LOCKS_EXCLUDED(lock_);
+  // Stops sampling, the samples taken stay readable. Returns false if it wasn't sampling.
+  bool Stop() LOCKS_EXCLUDED(lock_);
+
+  bool IsSampling() const {
+    return interval_.LoadRelaxed() != 0;
+  }
+
+  size_t GetInterval() const {
+    return interval_.LoadRelaxed();
+  }
+
+  // Called by the instrumented allocation paths for each allocation.
+  void RecordAllocation(Thread* self, mirror::Class* klass, size_t byte_count)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Copies the recent samples, oldest first. The samples being written meanwhile are left out.
+  void GetSamples(std::vector<Sample>* samples) const;
+
+  // Prints the recent samples with their stack.
+  void DumpSamples(std::ostream& os) const;
+
+  // The number of samples taken since the sampler was created.
+  uint64_t GetNumSamples() const {
+    return num_samples_.LoadSequentiallyConsistent();
+  }
+
+ private:
+  struct Slot {
+    // 2 * i + 1 while the ith sample is written in the slot, 2 * i + 2 once it is written.
+    Atomic<uint64_t> sequence;
+    Sample sample;
+  };
+
+  // Draws the number of bytes until the next sample of a thread.
+  size_t NextSampleDistance(Thread* self, size_t interval);
+
+  void TakeSample(Thread* self, mirror::Class* klass, size_t byte_count)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Guards the start and the stop, the sampling itself doesn't lock.
+  Mutex lock_;
+  // The mean number of bytes between two samples of a thread, 0 while not sampling.
+  Atomic<size_t> interval_;
+  // The number of samples claimed, the ith sample goes to the slot i % kNumSamples.
+  Atomic<uint64_t> num_samples_;
+  // Allocated on the first start and kept until the sampler is deleted, so that the threads
+  // sampling don't need a lock.
+  Atomic<Slot*> slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocationSampler);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ALLOCATION_SAMPLER_H_
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "allocation_sampler.h"
+
+#include <string.h>
+
+#include "common_runtime_test.h"
+#include "gc/heap.h"
+#include "handle_scope-inl.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/string-inl.h"
+#include "scoped_thread_state_change.h"
+
+namespace art {
+namespace gc {
+
+class AllocationSamplerTest : public CommonRuntimeTest {};
+
+TEST_F(AllocationSamplerTest, SampleAllocations) {
+  Heap* heap = Runtime::Current()->GetHeap();
+  AllocationSampler* sampler = heap->GetAllocationSampler();
+  static constexpr size_t kInterval = 4 * KB;
+  heap->StartAllocationSampling(kInterval);
+  EXPECT_TRUE(sampler->IsSampling());
+  EXPECT_EQ(kInterval, sampler->GetInterval());
+  const uint64_t num_samples_before = sampler->GetNumSamples();
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    StackHandleScope<1> hs(soa.Self());
+    mirror::Class* c = class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;");
+    Handle<mirror::ObjectArray<mirror::Object>> array(hs.NewHandle(
+        mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c, 1024)));
+    ASSERT_TRUE(array.Get() != nullptr);
+    // About 1 MB of strings, far more than the interval.
+    for (size_t i = 0; i < 16 * KB; ++i) {
+      mirror::String* string = mirror::String::AllocFromModifiedUtf8(soa.Self(), "hello, world!");
+      ASSERT_TRUE(string != nullptr);
+      array->Set<false>(i % 1024, string);
+    }
+  }
+  heap->StopAllocationSampling();
+  EXPECT_FALSE(sampler->IsSampling());
+  const uint64_t num_samples = sampler->GetNumSamples() - num_samples_before;
+  EXPECT_GT(num_samples, 0U);
+
+  // The samples stay readable after the sampling stops, and nothing is sampled anymore.
+  std::vector<AllocationSampler::Sample> samples;
+  sampler->GetSamples(&samples);
+  ASSERT_FALSE(samples.empty());
+  EXPECT_LE(samples.size(), AllocationSampler::kNumSamples);
+  bool found_string = false;
+  for (const AllocationSampler::Sample& sample : samples) {
+    EXPECT_GT(sample.byte_count, 0U);
+    EXPECT_LE(sample.depth, AllocationSampler::kMaxStackDepth);
+    if (strcmp(sample.descriptor, "Ljava/lang/String;") == 0) {
+      found_string = true;
+    }
+  }
+  EXPECT_TRUE(found_string);
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    mirror::String::AllocFromModifiedUtf8(soa.Self(), "hello, world!");
+  }
+  EXPECT_EQ(num_samples + num_samples_before, sampler->GetNumSamples());
+}
+
+}  // namespace gc
+}  // namespace art
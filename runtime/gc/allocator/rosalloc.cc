@@ -22,6 +22,7 @@
 #include "thread_list.h"
 #include "rosalloc.h"
 
+#include <algorithm>
 #include <map>
 #include <list>
 #include <vector>
@@ -50,7 +51,7 @@ RosAlloc::Run* RosAlloc::dedicated_full_run_ =
 RosAlloc::RosAlloc(void* base, size_t capacity, size_t max_capacity,
                    PageReleaseMode page_release_mode, size_t page_release_size_threshold)
     : base_(reinterpret_cast<byte*>(base)), footprint_(capacity),
-      capacity_(capacity), max_capacity_(max_capacity),
+      capacity_(capacity), max_capacity_(max_capacity), trim_epoch_(0),
       lock_("rosalloc global lock", kRosAllocGlobalLock),
       bulk_free_lock_("rosalloc bulk free lock", kRosAllocBulkFreeLock),
       page_release_mode_(page_release_mode),
@@ -72,6 +73,7 @@ RosAlloc::RosAlloc(void* base, size_t capacity, size_t max_capacity,
         StringPrintf("an rosalloc size bracket %d lock", static_cast<int>(i));
     size_bracket_locks_[i] = new Mutex(size_bracket_lock_names[i].c_str(), kRosAllocBracketLock);
     current_runs_[i] = dedicated_full_run_;
+    free_run_cache_[i] = nullptr;
   }
   DCHECK_EQ(footprint_, capacity_);
   size_t num_of_pages = footprint_ / kPageSize;
@@ -81,9 +83,16 @@ RosAlloc::RosAlloc(void* base, size_t capacity, size_t max_capacity,
                                                PROT_READ | PROT_WRITE, false, &error_msg));
   CHECK(page_map_mem_map_.get() != nullptr) << "Couldn't allocate the page map : " << error_msg;
   page_map_ = page_map_mem_map_->Begin();
+  new_page_map_mem_map_.reset(MemMap::MapAnonymous("rosalloc new page map", NULL,
+                                                   RoundUp(max_num_of_pages, kPageSize),
+                                                   PROT_READ | PROT_WRITE, false, &error_msg));
+  CHECK(new_page_map_mem_map_.get() != nullptr) << "Couldn't allocate the new page map : "
+                                                << error_msg;
+  new_page_map_ = new_page_map_mem_map_->Begin();
   page_map_size_ = num_of_pages;
   max_page_map_size_ = max_num_of_pages;
   free_page_run_size_map_.resize(num_of_pages);
+  free_page_run_stamp_map_.resize(num_of_pages);
   FreePageRun* free_pages = reinterpret_cast<FreePageRun*>(base_);
   if (kIsDebugBuild) {
     free_pages->magic_num_ = kMagicNumFree;
@@ -133,6 +142,7 @@ void* RosAlloc::AllocPages(Thread* self, size_t num_pages, byte page_map_type) {
           remainder->magic_num_ = kMagicNumFree;
         }
         remainder->SetByteSize(this, fpr_byte_size - req_byte_size);
+        remainder->SetStamp(this, fpr->Stamp(this));
         DCHECK_EQ(remainder->ByteSize(this) % kPageSize, static_cast<size_t>(0));
         // Don't need to call madvise on remainder here.
         free_page_runs_.insert(remainder);
@@ -178,6 +188,7 @@ void* RosAlloc::AllocPages(Thread* self, size_t num_pages, byte page_map_type) {
       page_map_size_ = new_num_of_pages;
       DCHECK_LE(page_map_size_, max_page_map_size_);
       free_page_run_size_map_.resize(new_num_of_pages);
+      free_page_run_stamp_map_.resize(new_num_of_pages);
       art_heap_rosalloc_morecore(this, increment);
       if (last_free_page_run_size > 0) {
         // There was a free page run at the end. Expand its size.
@@ -192,6 +203,8 @@ void* RosAlloc::AllocPages(Thread* self, size_t num_pages, byte page_map_type) {
           new_free_page_run->magic_num_ = kMagicNumFree;
         }
         new_free_page_run->SetByteSize(this, increment);
+        // The new pages were never touched.
+        new_free_page_run->SetStamp(this, kReleasedStamp);
         DCHECK_EQ(new_free_page_run->ByteSize(this) % kPageSize, static_cast<size_t>(0));
         free_page_runs_.insert(new_free_page_run);
         DCHECK_EQ(*free_page_runs_.rbegin(), new_free_page_run);
@@ -231,6 +244,7 @@ void* RosAlloc::AllocPages(Thread* self, size_t num_pages, byte page_map_type) {
           remainder->magic_num_ = kMagicNumFree;
         }
         remainder->SetByteSize(this, fpr_byte_size - req_byte_size);
+        remainder->SetStamp(this, fpr->Stamp(this));
         DCHECK_EQ(remainder->ByteSize(this) % kPageSize, static_cast<size_t>(0));
         free_page_runs_.insert(remainder);
         if (kTraceRosAlloc) {
@@ -458,6 +472,9 @@ void* RosAlloc::AllocLargeObject(Thread* self, size_t size, size_t* bytes_alloca
   {
     MutexLock mu(self, lock_);
     r = AllocPages(self, num_pages, kPageMapLargeObject);
+    if (r != nullptr) {
+      new_page_map_[ToPageMapIndex(r)] = 1;
+    }
   }
   if (UNLIKELY(r == nullptr)) {
     if (kTraceRosAlloc) {
@@ -467,6 +484,7 @@ void* RosAlloc::AllocLargeObject(Thread* self, size_t size, size_t* bytes_alloca
   }
   const size_t total_bytes = num_pages * kPageSize;
   *bytes_allocated = total_bytes;
+  self->AddAllocatedBytes(total_bytes);
   if (kTraceRosAlloc) {
     LOG(INFO) << "RosAlloc::AllocLargeObject() : 0x" << std::hex << reinterpret_cast<intptr_t>(r)
               << "-0x" << (reinterpret_cast<intptr_t>(r) + num_pages * kPageSize)
@@ -488,41 +506,41 @@ size_t RosAlloc::FreeInternal(Thread* self, void* ptr) {
   DCHECK_LT(ptr, base_ + footprint_);
   size_t pm_idx = RoundDownToPageMapIndex(ptr);
   Run* run = nullptr;
-  {
-    MutexLock mu(self, lock_);
-    DCHECK_LT(pm_idx, page_map_size_);
-    byte page_map_entry = page_map_[pm_idx];
-    if (kTraceRosAlloc) {
-      LOG(INFO) << "RosAlloc::FreeInternal() : " << std::hex << ptr << ", pm_idx=" << std::dec << pm_idx
-                << ", page_map_entry=" << static_cast<int>(page_map_entry);
+  // The page map entries of the pages of an allocated object don't change until it is freed, so
+  // they are read without the lock like in BulkFree(). Only the large objects need the lock.
+  byte page_map_entry = page_map_[pm_idx];
+  if (kTraceRosAlloc) {
+    LOG(INFO) << "RosAlloc::FreeInternal() : " << std::hex << ptr << ", pm_idx=" << std::dec << pm_idx
+              << ", page_map_entry=" << static_cast<int>(page_map_entry);
+  }
+  switch (page_map_entry) {
+    case kPageMapEmpty:
+      LOG(FATAL) << "Unreachable - page map type: " << page_map_entry;
+      return 0;
+    case kPageMapLargeObject: {
+      MutexLock mu(self, lock_);
+      DCHECK_LT(pm_idx, page_map_size_);
+      return FreePages(self, ptr, false);
     }
-    switch (page_map_[pm_idx]) {
-      case kPageMapEmpty:
-        LOG(FATAL) << "Unreachable - page map type: " << page_map_[pm_idx];
-        return 0;
-      case kPageMapLargeObject:
-        return FreePages(self, ptr, false);
-      case kPageMapLargeObjectPart:
-        LOG(FATAL) << "Unreachable - page map type: " << page_map_[pm_idx];
-        return 0;
-      case kPageMapRun:
-      case kPageMapRunPart: {
-        size_t pi = pm_idx;
-        DCHECK(page_map_[pi] == kPageMapRun || page_map_[pi] == kPageMapRunPart);
-        // Find the beginning of the run.
-        while (page_map_[pi] != kPageMapRun) {
-          pi--;
-          DCHECK_LT(pi, capacity_ / kPageSize);
-        }
-        DCHECK_EQ(page_map_[pi], kPageMapRun);
-        run = reinterpret_cast<Run*>(base_ + pi * kPageSize);
-        DCHECK_EQ(run->magic_num_, kMagicNum);
-        break;
+    case kPageMapLargeObjectPart:
+      LOG(FATAL) << "Unreachable - page map type: " << page_map_entry;
+      return 0;
+    case kPageMapRun:
+    case kPageMapRunPart: {
+      size_t pi = pm_idx;
+      // Find the beginning of the run.
+      while (page_map_[pi] != kPageMapRun) {
+        pi--;
+        DCHECK_LT(pi, capacity_ / kPageSize);
       }
-      default:
-        LOG(FATAL) << "Unreachable - page map type: " << page_map_[pm_idx];
-        return 0;
+      DCHECK_EQ(page_map_[pi], kPageMapRun);
+      run = reinterpret_cast<Run*>(base_ + pi * kPageSize);
+      DCHECK_EQ(run->magic_num_, kMagicNum);
+      break;
     }
+    default:
+      LOG(FATAL) << "Unreachable - page map type: " << page_map_entry;
+      return 0;
   }
   DCHECK(run != nullptr);
   return FreeFromRun(self, ptr, run);
@@ -578,10 +596,104 @@ RosAlloc::Run* RosAlloc::RefillRun(Thread* self, size_t idx) {
     DCHECK(non_full_run != nullptr);
     DCHECK(!non_full_run->IsThreadLocal());
     bt->erase(it);
+    MarkNewRun(non_full_run);
     return non_full_run;
   }
+  // Then a run which became all free.
+  Run* free_run = free_run_cache_[idx];
+  if (free_run != nullptr) {
+    DCHECK(free_run->IsAllFree());
+    free_run_cache_[idx] = nullptr;
+    MarkNewRun(free_run);
+    return free_run;
+  }
   // If there's none, allocate a new run and use it as the current run.
-  return AllocRun(self, idx);
+  Run* new_run = AllocRun(self, idx);
+  if (new_run != nullptr) {
+    MarkNewRun(new_run);
+  }
+  return new_run;
+}
+
+void RosAlloc::FreeAllFreeRun(Thread* self, size_t idx, Run* run) {
+  size_bracket_locks_[idx]->AssertHeld(self);
+  DCHECK(run->IsAllFree());
+  DCHECK(!run->IsThreadLocal());
+  DCHECK(!run->to_be_bulk_freed_);
+  // The slots are zeroed when they are freed, so the run is as good as a new one. Keeping it isn't
+  // worth it when all the free pages are released.
+  if (free_run_cache_[idx] == nullptr && !DoesReleaseAllPages()) {
+    DCHECK_EQ(run->first_search_vec_idx_, 0U);
+    free_run_cache_[idx] = run;
+    return;
+  }
+  run->ZeroHeader();
+  MutexLock mu(self, lock_);
+  FreePages(self, run, true);
+}
+
+void RosAlloc::FreeCachedRuns(Thread* self) {
+  for (size_t idx = 0; idx < kNumOfSizeBrackets; ++idx) {
+    MutexLock mu(self, *size_bracket_locks_[idx]);
+    Run* free_run = free_run_cache_[idx];
+    if (free_run != nullptr) {
+      free_run_cache_[idx] = nullptr;
+      free_run->ZeroHeader();
+      MutexLock mu2(self, lock_);
+      FreePages(self, free_run, true);
+    }
+  }
+}
+
+RosAlloc::Run* RosAlloc::RefreshThreadLocalRun(Thread* self, size_t idx) {
+  Run* thread_local_run = reinterpret_cast<Run*>(self->GetRosAllocRun(idx));
+  DCHECK(thread_local_run != nullptr);
+  DCHECK(thread_local_run->IsFull());
+  MutexLock mu(self, *size_bracket_locks_[idx]);
+  bool is_all_free_after_merge;
+  // This is safe to do for the dedicated_full_run_ since the bitmaps are empty.
+  if (thread_local_run->MergeThreadLocalFreeBitMapToAllocBitMap(&is_all_free_after_merge)) {
+    DCHECK_NE(thread_local_run, dedicated_full_run_);
+    // Some slot got freed. Keep it.
+    DCHECK(!thread_local_run->IsFull());
+    DCHECK_EQ(is_all_free_after_merge, thread_local_run->IsAllFree());
+    if (is_all_free_after_merge) {
+      // Check that the bitmap idx is back at 0 if it's all free.
+      DCHECK_EQ(thread_local_run->first_search_vec_idx_, 0U);
+    }
+  } else {
+    // No slots got freed. Try to refill the thread-local run.
+    DCHECK(thread_local_run->IsFull());
+    if (thread_local_run != dedicated_full_run_) {
+      thread_local_run->SetIsThreadLocal(false);
+      if (kIsDebugBuild) {
+        full_runs_[idx].insert(thread_local_run);
+        if (kTraceRosAlloc) {
+          LOG(INFO) << "RosAlloc::RefreshThreadLocalRun() : Inserted run 0x" << std::hex
+                    << reinterpret_cast<intptr_t>(thread_local_run)
+                    << " into full_runs_[" << std::dec << idx << "]";
+        }
+      }
+      DCHECK(non_full_runs_[idx].find(thread_local_run) == non_full_runs_[idx].end());
+      DCHECK(full_runs_[idx].find(thread_local_run) != full_runs_[idx].end());
+    }
+
+    thread_local_run = RefillRun(self, idx);
+    if (UNLIKELY(thread_local_run == nullptr)) {
+      self->SetRosAllocRun(idx, dedicated_full_run_);
+      return nullptr;
+    }
+    DCHECK(non_full_runs_[idx].find(thread_local_run) == non_full_runs_[idx].end());
+    DCHECK(full_runs_[idx].find(thread_local_run) == full_runs_[idx].end());
+    thread_local_run->SetIsThreadLocal(true);
+    self->SetRosAllocRun(idx, thread_local_run);
+  }
+  DCHECK(!thread_local_run->IsFull());
+  DCHECK(thread_local_run->IsThreadLocal());
+  // Count the free slots as allocated now rather than at each allocation, until the run is
+  // revoked.
+  self->AddAllocatedBytes(thread_local_run->NumberOfFreeSlots() * bracketSizes[idx]);
+  return thread_local_run;
 }
 
 inline void* RosAlloc::AllocFromCurrentRunUnlocked(Thread* self, size_t idx) {
@@ -633,11 +745,23 @@ void* RosAlloc::AllocFromRunThreadUnsafe(Thread* self, size_t size, size_t* byte
   if (LIKELY(slot_addr != nullptr)) {
     DCHECK(bytes_allocated != nullptr);
     *bytes_allocated = bracket_size;
+    self->AddAllocatedBytes(bracket_size);
     // Caller verifies that it is all 0.
   }
   return slot_addr;
 }
 
+inline bool RosAlloc::UseThreadLocalRun(Thread* self, size_t idx) {
+  if (LIKELY(idx < kNumThreadLocalSizeBrackets)) {
+    return true;
+  }
+  if (self->GetRosAllocRun(idx) != dedicated_full_run_) {
+    return true;
+  }
+  return self->IncrementRosAllocSharedAllocations(idx) >
+      numOfSlots[idx] / kAdaptiveThreadLocalRunThreshold;
+}
+
 void* RosAlloc::AllocFromRun(Thread* self, size_t size, size_t* bytes_allocated) {
   DCHECK_LE(size, kLargeSizeThreshold);
   size_t bracket_size;
@@ -650,7 +774,7 @@ void* RosAlloc::AllocFromRun(Thread* self, size_t size, size_t* bytes_allocated)
 
   void* slot_addr;
 
-  if (LIKELY(idx < kNumThreadLocalSizeBrackets)) {
+  if (UseThreadLocalRun(self, idx)) {
     // Use a thread-local run.
     Run* thread_local_run = reinterpret_cast<Run*>(self->GetRosAllocRun(idx));
     // Allow invalid since this will always fail the allocation.
@@ -667,52 +791,12 @@ void* RosAlloc::AllocFromRun(Thread* self, size_t size, size_t* bytes_allocated)
     DCHECK(thread_local_run != dedicated_full_run_ || slot_addr == nullptr)
         << "allocated from an invalid run";
     if (UNLIKELY(slot_addr == nullptr)) {
-      // The run got full. Try to free slots.
+      // The run got full. Try to free slots or get another run.
       DCHECK(thread_local_run->IsFull());
-      MutexLock mu(self, *size_bracket_locks_[idx]);
-      bool is_all_free_after_merge;
-      // This is safe to do for the dedicated_full_run_ since the bitmaps are empty.
-      if (thread_local_run->MergeThreadLocalFreeBitMapToAllocBitMap(&is_all_free_after_merge)) {
-        DCHECK_NE(thread_local_run, dedicated_full_run_);
-        // Some slot got freed. Keep it.
-        DCHECK(!thread_local_run->IsFull());
-        DCHECK_EQ(is_all_free_after_merge, thread_local_run->IsAllFree());
-        if (is_all_free_after_merge) {
-          // Check that the bitmap idx is back at 0 if it's all free.
-          DCHECK_EQ(thread_local_run->first_search_vec_idx_, 0U);
-        }
-      } else {
-        // No slots got freed. Try to refill the thread-local run.
-        DCHECK(thread_local_run->IsFull());
-        if (thread_local_run != dedicated_full_run_) {
-          thread_local_run->SetIsThreadLocal(false);
-          if (kIsDebugBuild) {
-            full_runs_[idx].insert(thread_local_run);
-            if (kTraceRosAlloc) {
-              LOG(INFO) << "RosAlloc::AllocFromRun() : Inserted run 0x" << std::hex
-                        << reinterpret_cast<intptr_t>(thread_local_run)
-                        << " into full_runs_[" << std::dec << idx << "]";
-            }
-          }
-          DCHECK(non_full_runs_[idx].find(thread_local_run) == non_full_runs_[idx].end());
-          DCHECK(full_runs_[idx].find(thread_local_run) != full_runs_[idx].end());
-        }
-
-        thread_local_run = RefillRun(self, idx);
-        if (UNLIKELY(thread_local_run == nullptr)) {
-          self->SetRosAllocRun(idx, dedicated_full_run_);
-          return nullptr;
-        }
-        DCHECK(non_full_runs_[idx].find(thread_local_run) == non_full_runs_[idx].end());
-        DCHECK(full_runs_[idx].find(thread_local_run) == full_runs_[idx].end());
-        thread_local_run->SetIsThreadLocal(true);
-        self->SetRosAllocRun(idx, thread_local_run);
-        DCHECK(!thread_local_run->IsFull());
+      thread_local_run = RefreshThreadLocalRun(self, idx);
+      if (UNLIKELY(thread_local_run == nullptr)) {
+        return nullptr;
       }
-
-      DCHECK(thread_local_run != nullptr);
-      DCHECK(!thread_local_run->IsFull());
-      DCHECK(thread_local_run->IsThreadLocal());
       slot_addr = thread_local_run->AllocSlot();
       // Must succeed now with a new run.
       DCHECK(slot_addr != nullptr);
@@ -726,6 +810,9 @@ void* RosAlloc::AllocFromRun(Thread* self, size_t size, size_t* bytes_allocated)
     // Use the (shared) current run.
     MutexLock mu(self, *size_bracket_locks_[idx]);
     slot_addr = AllocFromCurrentRunUnlocked(self, idx);
+    if (LIKELY(slot_addr != nullptr)) {
+      self->AddAllocatedBytes(bracket_size);
+    }
     if (kTraceRosAlloc) {
       LOG(INFO) << "RosAlloc::AllocFromRun() : 0x" << std::hex << reinterpret_cast<intptr_t>(slot_addr)
                 << "-0x" << (reinterpret_cast<intptr_t>(slot_addr) + bracket_size)
@@ -738,6 +825,63 @@ void* RosAlloc::AllocFromRun(Thread* self, size_t size, size_t* bytes_allocated)
   return slot_addr;
 }
 
+size_t RosAlloc::AllocBatch(Thread* self, size_t size, size_t num_ptrs, void** ptrs,
+                            size_t* bytes_allocated) {
+  DCHECK(bytes_allocated != nullptr);
+  *bytes_allocated = 0;
+  if (UNLIKELY(size > kLargeSizeThreshold)) {
+    return 0;
+  }
+  size_t bracket_size;
+  size_t idx = SizeToIndexAndBracketSize(size, &bracket_size);
+  DCHECK_EQ(idx, SizeToIndex(size));
+  DCHECK_EQ(bracket_size, bracketSizes[idx]);
+  size_t num_allocated = 0;
+  if (UseThreadLocalRun(self, idx)) {
+    // Take the slots from the thread-local run, without locking until it gets full.
+    Run* thread_local_run = reinterpret_cast<Run*>(self->GetRosAllocRun(idx));
+    DCHECK(thread_local_run != nullptr);
+    DCHECK(thread_local_run->IsThreadLocal() || thread_local_run == dedicated_full_run_);
+    while (true) {
+      num_allocated += thread_local_run->AllocSlots(num_ptrs - num_allocated,
+                                                    ptrs + num_allocated);
+      if (num_allocated == num_ptrs) {
+        break;
+      }
+      thread_local_run = RefreshThreadLocalRun(self, idx);
+      if (UNLIKELY(thread_local_run == nullptr)) {
+        break;
+      }
+    }
+  } else {
+    // Use the (shared) current run, locking once for the whole batch.
+    MutexLock mu(self, *size_bracket_locks_[idx]);
+    while (num_allocated < num_ptrs) {
+      void* slot_addr = AllocFromCurrentRunUnlocked(self, idx);
+      if (UNLIKELY(slot_addr == nullptr)) {
+        break;
+      }
+      ptrs[num_allocated++] = slot_addr;
+    }
+    self->AddAllocatedBytes(num_allocated * bracket_size);
+  }
+  if (kTraceRosAlloc) {
+    LOG(INFO) << "RosAlloc::AllocBatch() : " << num_allocated << "/" << num_ptrs
+              << " slots of " << bracket_size << " bytes";
+  }
+  // Check if the returned memory is really all zero.
+  if (kCheckZeroMemory) {
+    for (size_t i = 0; i < num_allocated; ++i) {
+      byte* bytes = reinterpret_cast<byte*>(ptrs[i]);
+      for (size_t j = 0; j < size; ++j) {
+        DCHECK_EQ(bytes[j], 0);
+      }
+    }
+  }
+  *bytes_allocated = num_allocated * bracket_size;
+  return num_allocated;
+}
+
 size_t RosAlloc::FreeFromRun(Thread* self, void* ptr, Run* run) {
   DCHECK_EQ(run->magic_num_, kMagicNum);
   DCHECK_LT(run, ptr);
@@ -754,7 +898,7 @@ size_t RosAlloc::FreeFromRun(Thread* self, void* ptr, Run* run) {
   }
   if (LIKELY(run->IsThreadLocal())) {
     // It's a thread-local run. Just mark the thread-local free bit map and return.
-    DCHECK_LT(run->size_bracket_idx_, kNumThreadLocalSizeBrackets);
+    DCHECK_LT(run->size_bracket_idx_, kNumMaxThreadLocalSizeBrackets);
     DCHECK(non_full_runs_[idx].find(run) == non_full_runs_[idx].end());
     DCHECK(full_runs_[idx].find(run) == full_runs_[idx].end());
     run->MarkThreadLocalFreeBitMap(ptr);
@@ -783,11 +927,7 @@ size_t RosAlloc::FreeFromRun(Thread* self, void* ptr, Run* run) {
     }
     DCHECK(non_full_runs_[idx].find(run) == non_full_runs_[idx].end());
     DCHECK(full_runs_[idx].find(run) == full_runs_[idx].end());
-    run->ZeroHeader();
-    {
-      MutexLock mu(self, lock_);
-      FreePages(self, run, true);
-    }
+    FreeAllFreeRun(self, idx, run);
   } else {
     // It is not completely free. If it wasn't the current run or
     // already in the non-full run set (i.e., it was full) insert it
@@ -888,6 +1028,44 @@ inline void* RosAlloc::Run::AllocSlot() {
   }
 }
 
+size_t RosAlloc::Run::AllocSlots(size_t num_slots, void** slots) {
+  const size_t idx = size_bracket_idx_;
+  const size_t num_vec = NumberOfBitmapVectors();
+  byte* const slot_base = reinterpret_cast<byte*>(this) + headerSizes[idx];
+  const size_t bracket_size = bracketSizes[idx];
+  size_t num_allocated = 0;
+  while (num_allocated < num_slots) {
+    uint32_t* const alloc_bitmap_ptr = &alloc_bit_map_[first_search_vec_idx_];
+    uint32_t free_bits = ~*alloc_bitmap_ptr;
+    const uint32_t vec_base = first_search_vec_idx_ * sizeof(*alloc_bitmap_ptr) * kBitsPerByte;
+    // Take the free slots of the word from the lowest one.
+    while (free_bits != 0 && num_allocated < num_slots) {
+      const uint32_t ffz = __builtin_ctz(free_bits);
+      const uint32_t slot_idx = vec_base + ffz;
+      DCHECK_LT(slot_idx, numOfSlots[idx]) << "out of range";
+      free_bits &= ~(1U << ffz);
+      slots[num_allocated++] = slot_base + slot_idx * bracket_size;
+    }
+    // Set the bits of the slots taken in one store.
+    *alloc_bitmap_ptr = ~free_bits;
+    if (free_bits != 0) {
+      break;
+    }
+    if (first_search_vec_idx_ + 1 >= num_vec) {
+      DCHECK(IsFull());
+      // Already at the last word.
+      break;
+    }
+    // The word is full, move to the next one like AllocSlot().
+    ++first_search_vec_idx_;
+  }
+  if (kTraceRosAlloc) {
+    LOG(INFO) << "RosAlloc::Run::AllocSlots() : " << num_allocated << " slots"
+              << ", bracket_size=" << std::dec << bracket_size;
+  }
+  return num_allocated;
+}
+
 void RosAlloc::Run::FreeSlot(void* ptr) {
   DCHECK(!IsThreadLocal());
   const byte idx = size_bracket_idx_;
@@ -1063,6 +1241,16 @@ inline bool RosAlloc::Run::IsFull() {
   return true;
 }
 
+inline size_t RosAlloc::Run::NumberOfFreeSlots() {
+  // The bits of the invalid slots at the end of the last vector are set.
+  const size_t num_vec = NumberOfBitmapVectors();
+  size_t num_free = 0;
+  for (size_t v = 0; v < num_vec; ++v) {
+    num_free += POPCOUNT(~alloc_bit_map_[v]);
+  }
+  return num_free;
+}
+
 inline bool RosAlloc::Run::IsBulkFreeBitmapClean() {
   const size_t num_vec = NumberOfBitmapVectors();
   for (size_t v = 0; v < num_vec; v++) {
@@ -1137,6 +1325,40 @@ void RosAlloc::Run::InspectAllSlots(void (*handler)(void* start, void* end, size
   }
 }
 
+void RosAlloc::Run::VisitAllocatedSlots(void (*callback)(void* ptr, void* arg), void* arg) {
+  size_t idx = size_bracket_idx_;
+  byte* slot_base = reinterpret_cast<byte*>(this) + headerSizes[idx];
+  size_t num_slots = numOfSlots[idx];
+  size_t bracket_size = IndexToBracketSize(idx);
+  size_t num_vec = RoundUp(num_slots, 32) / 32;
+  size_t slots = 0;
+  for (size_t v = 0; v < num_vec; v++, slots += 32) {
+    // The bits past the end of the run are set, don't visit them.
+    uint32_t vec = alloc_bit_map_[v];
+    size_t end = std::min(num_slots - slots, static_cast<size_t>(32));
+    for (size_t i = 0; i < end; ++i) {
+      if (((vec >> i) & 0x1) != 0) {
+        callback(slot_base + (slots + i) * bracket_size, arg);
+      }
+    }
+  }
+}
+
+bool RosAlloc::Run::IsAllocatedSlot(const void* ptr) {
+  size_t idx = size_bracket_idx_;
+  const byte* slot_base = reinterpret_cast<byte*>(this) + headerSizes[idx];
+  if (ptr < slot_base) {
+    return false;
+  }
+  size_t offset = reinterpret_cast<const byte*>(ptr) - slot_base;
+  size_t bracket_size = IndexToBracketSize(idx);
+  size_t slot_idx = offset / bracket_size;
+  if (offset % bracket_size != 0 || slot_idx >= numOfSlots[idx]) {
+    return false;
+  }
+  return ((alloc_bit_map_[slot_idx / 32] >> (slot_idx % 32)) & 0x1) != 0;
+}
+
 // If true, read the page map entries in BulkFree() without using the
 // lock for better performance, assuming that the existence of an
 // allocated chunk/pointer being freed in BulkFree() guarantees that
@@ -1153,7 +1375,9 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
     return freed_bytes;
   }
 
-  WriterMutexLock wmu(self, bulk_free_lock_);
+  // The bulk free bit maps and the flags of the runs aren't shared with the concurrent bulk frees,
+  // which free slots of other runs.
+  ReaderMutexLock rmu(self, bulk_free_lock_);
 
   // First mark slots to free in the bulk free bit map without locking the
   // size bracket locks. On host, unordered_set is faster than vector + flag.
@@ -1246,7 +1470,7 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
     size_t idx = run->size_bracket_idx_;
     MutexLock mu(self, *size_bracket_locks_[idx]);
     if (run->IsThreadLocal()) {
-      DCHECK_LT(run->size_bracket_idx_, kNumThreadLocalSizeBrackets);
+      DCHECK_LT(run->size_bracket_idx_, kNumMaxThreadLocalSizeBrackets);
       DCHECK(non_full_runs_[idx].find(run) == non_full_runs_[idx].end());
       DCHECK(full_runs_[idx].find(run) == full_runs_[idx].end());
       run->UnionBulkFreeBitMapToThreadLocalFreeBitMap();
@@ -1304,9 +1528,7 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
           DCHECK(non_full_runs->find(run) == non_full_runs->end());
         }
         if (!run_was_current) {
-          run->ZeroHeader();
-          MutexLock mu(self, lock_);
-          FreePages(self, run, true);
+          FreeAllFreeRun(self, idx, run);
         }
       } else {
         // It is not completely free. If it wasn't the current run or
@@ -1483,7 +1705,10 @@ size_t RosAlloc::UsableSize(void* ptr) {
 }
 
 bool RosAlloc::Trim() {
-  MutexLock mu(Thread::Current(), lock_);
+  Thread* self = Thread::Current();
+  // The cached runs would keep the free pages at the end of the space from being trimmed.
+  FreeCachedRuns(self);
+  MutexLock mu(self, lock_);
   FreePageRun* last_free_page_run;
   DCHECK_EQ(footprint_ % kPageSize, static_cast<size_t>(0));
   auto it = free_page_runs_.rbegin();
@@ -1514,6 +1739,7 @@ bool RosAlloc::Trim() {
     }
     page_map_size_ = new_num_of_pages;
     free_page_run_size_map_.resize(new_num_of_pages);
+    free_page_run_stamp_map_.resize(new_num_of_pages);
     DCHECK_EQ(free_page_run_size_map_.size(), new_num_of_pages);
     art_heap_rosalloc_morecore(this, -(static_cast<intptr_t>(decrement)));
     if (kTraceRosAlloc) {
@@ -1615,6 +1841,37 @@ void RosAlloc::InspectAll(void (*handler)(void* start, void* end, size_t used_by
   }
 }
 
+size_t RosAlloc::FreeSlotBytes(size_t* run_bytes) {
+  MutexLock mu(Thread::Current(), lock_);
+  size_t free_slot_bytes = 0;
+  *run_bytes = 0;
+  size_t i = 0;
+  while (i < page_map_size_) {
+    if (page_map_[i] != kPageMapRun) {
+      ++i;
+      continue;
+    }
+    Run* run = reinterpret_cast<Run*>(base_ + i * kPageSize);
+    const size_t idx = run->size_bracket_idx_;
+    *run_bytes += numOfPages[idx] * kPageSize;
+    free_slot_bytes += run->NumberOfFreeSlots() * bracketSizes[idx];
+    i += numOfPages[idx];
+  }
+  return free_slot_bytes;
+}
+
+byte* RosAlloc::RoundUpToRunBoundary(byte* addr) {
+  DCHECK_LE(base_, addr);
+  MutexLock mu(Thread::Current(), lock_);
+  const size_t num_pages = footprint_ / kPageSize;
+  size_t i = RoundUp(static_cast<size_t>(addr - base_), kPageSize) / kPageSize;
+  while (i < num_pages &&
+         (page_map_[i] == kPageMapRunPart || page_map_[i] == kPageMapLargeObjectPart)) {
+    ++i;
+  }
+  return base_ + std::min(i, num_pages) * kPageSize;
+}
+
 size_t RosAlloc::Footprint() {
   MutexLock mu(Thread::Current(), lock_);
   return footprint_;
@@ -1640,7 +1897,9 @@ void RosAlloc::RevokeThreadLocalRuns(Thread* thread) {
   Thread* self = Thread::Current();
   // Avoid race conditions on the bulk free bit maps with BulkFree() (GC).
   WriterMutexLock wmu(self, bulk_free_lock_);
-  for (size_t idx = 0; idx < kNumThreadLocalSizeBrackets; idx++) {
+  // The thread has to allocate at a high enough rate again to get the adaptive runs back.
+  thread->ResetRosAllocSharedAllocations();
+  for (size_t idx = 0; idx < kNumMaxThreadLocalSizeBrackets; idx++) {
     MutexLock mu(self, *size_bracket_locks_[idx]);
     Run* thread_local_run = reinterpret_cast<Run*>(thread->GetRosAllocRun(idx));
     CHECK(thread_local_run != nullptr);
@@ -1649,6 +1908,8 @@ void RosAlloc::RevokeThreadLocalRuns(Thread* thread) {
     if (thread_local_run != dedicated_full_run_) {
       thread->SetRosAllocRun(idx, dedicated_full_run_);
       DCHECK_EQ(thread_local_run->magic_num_, kMagicNum);
+      // The slots the thread didn't use were counted as allocated when it took the run.
+      thread->SubtractAllocatedBytes(thread_local_run->NumberOfFreeSlots() * bracketSizes[idx]);
       // Note the thread local run may not be full here.
       bool dont_care;
       thread_local_run->MergeThreadLocalFreeBitMapToAllocBitMap(&dont_care);
@@ -1675,9 +1936,7 @@ void RosAlloc::RevokeRun(Thread* self, size_t idx, Run* run) {
       }
     }
   } else if (run->IsAllFree()) {
-    run->ZeroHeader();
-    MutexLock mu(self, lock_);
-    FreePages(self, run, true);
+    FreeAllFreeRun(self, idx, run);
   } else {
     non_full_runs_[idx].insert(run);
     DCHECK(non_full_runs_[idx].find(run) != non_full_runs_[idx].end());
@@ -1701,6 +1960,70 @@ void RosAlloc::RevokeThreadUnsafeCurrentRuns() {
   }
 }
 
+void RosAlloc::VisitNewAllocations(void (*callback)(void* ptr, void* arg), void* arg,
+                                   bool clear) {
+  Thread* self = Thread::Current();
+  if (clear) {
+    Locks::mutator_lock_->AssertExclusiveHeld(self);
+    // Revoke every run the mutators allocate from so that the runs they allocate from next are
+    // handed out by RefillRun() again, which marks them.
+    RevokeAllThreadLocalRuns();
+    for (size_t idx = kNumThreadLocalSizeBrackets; idx < kNumOfSizeBrackets; ++idx) {
+      MutexLock mu(self, *size_bracket_locks_[idx]);
+      if (current_runs_[idx] != dedicated_full_run_) {
+        RevokeRun(self, idx, current_runs_[idx]);
+        current_runs_[idx] = dedicated_full_run_;
+      }
+    }
+  }
+  MutexLock mu(self, lock_);
+  for (size_t i = 0; i < page_map_size_; ++i) {
+    if (new_page_map_[i] == 0) {
+      continue;
+    }
+    if (clear) {
+      new_page_map_[i] = 0;
+    }
+    // The pages may have been freed and reused since they were marked.
+    switch (page_map_[i]) {
+      case kPageMapRun: {
+        Run* run = reinterpret_cast<Run*>(base_ + i * kPageSize);
+        DCHECK_EQ(run->magic_num_, kMagicNum);
+        run->VisitAllocatedSlots(callback, arg);
+        break;
+      }
+      case kPageMapLargeObject:
+        callback(base_ + i * kPageSize, arg);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+bool RosAlloc::IsNewAllocation(const void* ptr) {
+  MutexLock mu(Thread::Current(), lock_);
+  if (ptr < base_ || ptr >= base_ + footprint_) {
+    return false;
+  }
+  size_t pm_idx = ToPageMapIndex(AlignDown(ptr, kPageSize));
+  while (pm_idx > 0 && (page_map_[pm_idx] == kPageMapRunPart ||
+                        page_map_[pm_idx] == kPageMapLargeObjectPart)) {
+    --pm_idx;
+  }
+  if (new_page_map_[pm_idx] == 0) {
+    return false;
+  }
+  switch (page_map_[pm_idx]) {
+    case kPageMapRun:
+      return reinterpret_cast<Run*>(base_ + pm_idx * kPageSize)->IsAllocatedSlot(ptr);
+    case kPageMapLargeObject:
+      return ptr == base_ + pm_idx * kPageSize;
+    default:
+      return false;
+  }
+}
+
 void RosAlloc::RevokeAllThreadLocalRuns() {
   // This is called when a mutator thread won't allocate such as at
   // the Zygote creation time or during the GC pause.
@@ -1718,7 +2041,7 @@ void RosAlloc::AssertThreadLocalRunsAreRevoked(Thread* thread) {
     Thread* self = Thread::Current();
     // Avoid race conditions on the bulk free bit maps with BulkFree() (GC).
     WriterMutexLock wmu(self, bulk_free_lock_);
-    for (size_t idx = 0; idx < kNumThreadLocalSizeBrackets; idx++) {
+    for (size_t idx = 0; idx < kNumMaxThreadLocalSizeBrackets; idx++) {
       MutexLock mu(self, *size_bracket_locks_[idx]);
       Run* thread_local_run = reinterpret_cast<Run*>(thread->GetRosAllocRun(idx));
       DCHECK(thread_local_run == nullptr || thread_local_run == dedicated_full_run_);
@@ -1955,7 +2278,7 @@ void RosAlloc::Verify() {
   }
   std::list<Thread*> threads = Runtime::Current()->GetThreadList()->GetList();
   for (Thread* thread : threads) {
-    for (size_t i = 0; i < kNumThreadLocalSizeBrackets; ++i) {
+    for (size_t i = 0; i < kNumMaxThreadLocalSizeBrackets; ++i) {
       MutexLock mu(self, *size_bracket_locks_[i]);
       Run* thread_local_run = reinterpret_cast<Run*>(thread->GetRosAllocRun(i));
       CHECK(thread_local_run != nullptr);
@@ -2006,7 +2329,7 @@ void RosAlloc::Run::Verify(Thread* self, RosAlloc* rosalloc) {
     std::list<Thread*> thread_list = Runtime::Current()->GetThreadList()->GetList();
     for (auto it = thread_list.begin(); it != thread_list.end(); ++it) {
       Thread* thread = *it;
-      for (size_t i = 0; i < kNumThreadLocalSizeBrackets; i++) {
+      for (size_t i = 0; i < kNumMaxThreadLocalSizeBrackets; i++) {
         MutexLock mu(self, *rosalloc->size_bracket_locks_[i]);
         Run* thread_local_run = reinterpret_cast<Run*>(thread->GetRosAllocRun(i));
         if (thread_local_run == this) {
@@ -2030,7 +2353,8 @@ void RosAlloc::Run::Verify(Thread* self, RosAlloc* rosalloc) {
       MutexLock mu(self, *rosalloc->size_bracket_locks_[i]);
       Run* current_run = rosalloc->current_runs_[i];
       if (idx == i) {
-        if (this == current_run) {
+        // A cached free run is checked like a current run, it is in no run set.
+        if (this == current_run || this == rosalloc->free_run_cache_[i]) {
           is_current_run = true;
         }
       } else {
@@ -2092,52 +2416,63 @@ size_t RosAlloc::ReleasePages() {
   VLOG(heap) << "RosAlloc::ReleasePages()";
   DCHECK(!DoesReleaseAllPages());
   Thread* self = Thread::Current();
+  // The free page runs which may have dirty pages with their stamps, the oldest ones are released
+  // first since the recently freed pages are the most likely to be allocated again.
+  std::vector<std::pair<uint32_t, size_t>> candidates;
+  {
+    MutexLock mu(self, lock_);
+    for (FreePageRun* fpr : free_page_runs_) {
+      uint32_t stamp = fpr->Stamp(this);
+      if (stamp != kReleasedStamp) {
+        candidates.push_back(std::make_pair(stamp, ToPageMapIndex(fpr)));
+      }
+    }
+    ++trim_epoch_;
+    if (UNLIKELY(trim_epoch_ == kReleasedStamp)) {
+      trim_epoch_ = 0;
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
   size_t reclaimed_bytes = 0;
   size_t i = 0;
-  while (true) {
+  // The offset in the current candidate run to release from, if a batch ended in the middle of it.
+  size_t run_offset = 0;
+  while (i < candidates.size()) {
     MutexLock mu(self, lock_);
-    // Check the page map size which might have changed due to grow/shrink.
-    size_t pm_end = page_map_size_;
-    if (i >= pm_end) {
-      // Reached the end.
-      break;
-    }
-    byte pm = page_map_[i];
-    switch (pm) {
-      case kPageMapEmpty: {
-        // The start of a free page run. Release pages.
-        FreePageRun* fpr = reinterpret_cast<FreePageRun*>(base_ + i * kPageSize);
-        DCHECK(free_page_runs_.find(fpr) != free_page_runs_.end());
-        size_t fpr_size = fpr->ByteSize(this);
-        DCHECK(IsAligned<kPageSize>(fpr_size));
-        byte* start = reinterpret_cast<byte*>(fpr);
-        if (kIsDebugBuild) {
-          // In the debug build, the first page of a free page run
-          // contains a magic number for debugging. Exclude it.
-          start = reinterpret_cast<byte*>(fpr) + kPageSize;
-        }
-        byte* end = reinterpret_cast<byte*>(fpr) + fpr_size;
-        CHECK_EQ(madvise(start, end - start, MADV_DONTNEED), 0);
-        reclaimed_bytes += fpr_size;
-        size_t num_pages = fpr_size / kPageSize;
-        if (kIsDebugBuild) {
-          for (size_t j = i + 1; j < i + num_pages; ++j) {
-            DCHECK_EQ(page_map_[j], kPageMapEmpty);
-          }
-        }
-        i += num_pages;
-        DCHECK_LE(i, pm_end);
-        break;
+    size_t batch_bytes = 0;
+    while (i < candidates.size() && batch_bytes < kPageReleaseBatchSize) {
+      size_t pm_idx = candidates[i].second;
+      FreePageRun* fpr = reinterpret_cast<FreePageRun*>(base_ + pm_idx * kPageSize);
+      // The run may have been allocated, trimmed or coalesced into a lower run since the lock was
+      // released. A run which grew by coalescing with a higher run is still released as a whole.
+      if (pm_idx >= page_map_size_ || page_map_[pm_idx] != kPageMapEmpty ||
+          free_page_runs_.find(fpr) == free_page_runs_.end() ||
+          fpr->Stamp(this) == kReleasedStamp) {
+        ++i;
+        run_offset = 0;
+        continue;
+      }
+      DCHECK(fpr->IsFree());
+      size_t fpr_size = fpr->ByteSize(this);
+      DCHECK(IsAligned<kPageSize>(fpr_size));
+      if (kIsDebugBuild && run_offset == 0) {
+        // In the debug build, the first page of a free page run
+        // contains a magic number for debugging. Exclude it.
+        run_offset = kPageSize;
       }
-      case kPageMapLargeObject:      // Fall through.
-      case kPageMapLargeObjectPart:  // Fall through.
-      case kPageMapRun:              // Fall through.
-      case kPageMapRunPart:          // Fall through.
+      size_t release_size = std::min(fpr_size - run_offset, kPageReleaseBatchSize - batch_bytes);
+      if (release_size > 0) {
+        byte* start = reinterpret_cast<byte*>(fpr) + run_offset;
+        CHECK_EQ(madvise(start, release_size, MADV_DONTNEED), 0);
+        reclaimed_bytes += release_size;
+        batch_bytes += release_size;
+        run_offset += release_size;
+      }
+      if (run_offset == fpr_size) {
+        fpr->SetStamp(this, kReleasedStamp);
         ++i;
-        break;  // Skip.
-      default:
-        LOG(FATAL) << "Unreachable - page map type: " << pm;
-        break;
+        run_offset = 0;
+      }
     }
   }
   return reclaimed_bytes;
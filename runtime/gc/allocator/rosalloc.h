@@ -65,6 +65,13 @@ class RosAlloc {
       size_t pm_idx = rosalloc->ToPageMapIndex(fpr_base);
       rosalloc->free_page_run_size_map_[pm_idx] = byte_size;
     }
+    // The trim epoch in which the run was last freed, or kReleasedStamp if its pages are released.
+    uint32_t Stamp(RosAlloc* rosalloc) const EXCLUSIVE_LOCKS_REQUIRED(rosalloc->lock_) {
+      return rosalloc->free_page_run_stamp_map_[rosalloc->ToPageMapIndex(this)];
+    }
+    void SetStamp(RosAlloc* rosalloc, uint32_t stamp) EXCLUSIVE_LOCKS_REQUIRED(rosalloc->lock_) {
+      rosalloc->free_page_run_stamp_map_[rosalloc->ToPageMapIndex(this)] = stamp;
+    }
     void* Begin() {
       return reinterpret_cast<void*>(this);
     }
@@ -118,6 +125,11 @@ class RosAlloc {
           madvise(start, byte_size, MADV_DONTNEED);
         }
       }
+      if (release_pages) {
+        SetStamp(rosalloc, kReleasedStamp);
+      } else {
+        SetStamp(rosalloc, rosalloc->trim_epoch_);
+      }
     }
   };
 
@@ -230,6 +242,10 @@ class RosAlloc {
     void UnionBulkFreeBitMapToThreadLocalFreeBitMap();
     // Allocates a slot in a run.
     void* AllocSlot();
+    // Allocates up to num_slots slots in a run, claiming the free slots of a bit map word at
+    // once, and stores their addresses in slots. Returns the number of slots allocated, which is
+    // less than num_slots only if the run got full.
+    size_t AllocSlots(size_t num_slots, void** slots);
     // Frees a slot in a run. This is used in a non-bulk free.
     void FreeSlot(void* ptr);
     // Marks the slots to free in the bulk free bit map. Returns the bracket size.
@@ -243,6 +259,8 @@ class RosAlloc {
     bool IsAllFree();
     // Returns true if all the slots in the run are in use.
     bool IsFull();
+    // Returns the number of slots not allocated in the alloc bit map.
+    size_t NumberOfFreeSlots();
     // Returns true if the bulk free bit map is clean.
     bool IsBulkFreeBitmapClean();
     // Returns true if the thread local free bit map is clean.
@@ -257,6 +275,10 @@ class RosAlloc {
     void FillAllocBitMap();
     // Iterate over all the slots and apply the given function.
     void InspectAllSlots(void (*handler)(void* start, void* end, size_t used_bytes, void* callback_arg), void* arg);
+    // Calls the callback on each allocated slot.
+    void VisitAllocatedSlots(void (*callback)(void* ptr, void* arg), void* arg);
+    // Returns true if ptr is the start of an allocated slot.
+    bool IsAllocatedSlot(const void* ptr);
     // Dump the run metadata for debugging.
     std::string Dump();
     // Verify for debugging.
@@ -416,10 +438,21 @@ class RosAlloc {
   // The default value for page_release_size_threshold_.
   static constexpr size_t kDefaultPageReleaseSizeThreshold = 4 * MB;
 
+  // The most bytes ReleasePages releases before letting the allocating threads take the lock.
+  static constexpr size_t kPageReleaseBatchSize = 1 * MB;
+
   // We use thread-local runs for the size Brackets whose indexes
   // are less than this index. We use shared (current) runs for the rest.
   static const size_t kNumThreadLocalSizeBrackets = 11;
 
+  // The number of size brackets which may use thread-local runs. A thread only takes one for the
+  // brackets from kNumThreadLocalSizeBrackets on after it allocated
+  // kAdaptiveThreadLocalRunThreshold of a run's slots from the shared run since its thread-local
+  // runs were last revoked, which is at every GC, so that the threads allocating few mid-size
+  // objects don't hold a large run each. Sync this with the length of Thread::rosalloc_runs_.
+  static const size_t kNumMaxThreadLocalSizeBrackets = kNumOfSizeBrackets;
+  static constexpr size_t kAdaptiveThreadLocalRunThreshold = 2;  // The fraction 1/N of a run.
+
  private:
   // The base address of the memory region that's managed by this allocator.
   byte* base_;
@@ -453,6 +486,10 @@ class RosAlloc {
   // the size brackes that do not use thread-local
   // runs. current_runs_[i] is guarded by size_bracket_locks_[i].
   Run* current_runs_[kNumOfSizeBrackets];
+  // A run of each size bracket which became all free, kept to refill the thread-local and current
+  // runs without taking the global lock to free and allocate its pages again. Null if there is
+  // none. free_run_cache_[i] is guarded by size_bracket_locks_[i].
+  Run* free_run_cache_[kNumOfSizeBrackets];
   // The mutexes, one per size bracket.
   Mutex* size_bracket_locks_[kNumOfSizeBrackets];
   // Bracket lock names (since locks only have char* names).
@@ -471,17 +508,29 @@ class RosAlloc {
   size_t max_page_map_size_;
   std::unique_ptr<MemMap> page_map_mem_map_;
 
+  // The table that indicates which runs and large objects were handed out for allocation since
+  // the last VisitNewAllocations() with clear set, one byte per page like page_map_. Set for the
+  // first page only and left set when the pages are freed.
+  byte* new_page_map_;
+  std::unique_ptr<MemMap> new_page_map_mem_map_;
+
   // The table that indicates the size of free page runs. These sizes
   // are stored here to avoid storing in the free page header and
   // release backing pages.
   std::vector<size_t> free_page_run_size_map_ GUARDED_BY(lock_);
+  // The stamps of the free page runs, also indexed by the first page of the run. ReleasePages
+  // skips the runs that are already released and releases the ones freed the longest ago first.
+  std::vector<uint32_t> free_page_run_stamp_map_ GUARDED_BY(lock_);
+  static constexpr uint32_t kReleasedStamp = 0xFFFFFFFFU;
+  // Incremented by each ReleasePages.
+  uint32_t trim_epoch_ GUARDED_BY(lock_);
   // The global lock. Used to guard the page map, the free page set,
   // and the footprint.
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
-  // The reader-writer lock to allow one bulk free at a time while
-  // allowing multiple individual frees at the same time. Also, this
-  // is used to avoid race conditions between BulkFree() and
-  // RevokeThreadLocalRuns() on the bulk free bitmaps.
+  // The reader-writer lock to allow bulk frees of different runs and
+  // individual frees at the same time. Also, this is used to avoid
+  // race conditions between BulkFree() and RevokeThreadLocalRuns() on
+  // the bulk free bitmaps.
   ReaderWriterMutex bulk_free_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
   // The page release mode.
@@ -521,6 +570,11 @@ class RosAlloc {
   // thread-local or current run gets full.
   Run* RefillRun(Thread* self, size_t idx) LOCKS_EXCLUDED(lock_);
 
+  // Used when the thread-local run of a size bracket gets full. Frees the slots marked in its
+  // thread-local free bit map or replaces it with a new/reused run. Returns the non-full
+  // thread-local run, or null if there is none left.
+  Run* RefreshThreadLocalRun(Thread* self, size_t idx) LOCKS_EXCLUDED(lock_);
+
   // The internal of non-bulk Free().
   size_t FreeInternal(Thread* self, void* ptr) LOCKS_EXCLUDED(lock_);
 
@@ -530,9 +584,26 @@ class RosAlloc {
   // Revoke a run by adding it to non_full_runs_ or freeing the pages.
   void RevokeRun(Thread* self, size_t idx, Run* run);
 
+  // Whether an allocation of the size bracket uses the thread-local run. For the adaptive
+  // brackets, counts the allocations from the shared run until the thread is due a thread-local
+  // run.
+  static bool UseThreadLocalRun(Thread* self, size_t idx) ALWAYS_INLINE;
+
+  // Called when a run which isn't thread-local becomes all free, with the size bracket lock held.
+  // Keeps it in the free run cache of the size bracket if there is room, or frees its pages.
+  void FreeAllFreeRun(Thread* self, size_t idx, Run* run) LOCKS_EXCLUDED(lock_);
+
+  // Frees the pages of the cached free runs.
+  void FreeCachedRuns(Thread* self) LOCKS_EXCLUDED(lock_);
+
   // Revoke the current runs which share an index with the thread local runs.
   void RevokeThreadUnsafeCurrentRuns();
 
+  // Marks a run which is about to become a current or thread-local run as new.
+  void MarkNewRun(Run* run) {
+    new_page_map_[ToPageMapIndex(run)] = 1;
+  }
+
  public:
   RosAlloc(void* base, size_t capacity, size_t max_capacity,
            PageReleaseMode page_release_mode,
@@ -543,8 +614,17 @@ class RosAlloc {
   template<bool kThreadSafe = true>
   void* Alloc(Thread* self, size_t size, size_t* bytes_allocated)
       LOCKS_EXCLUDED(lock_);
+  // Allocates up to num_ptrs slots of the size bracket of size at once and stores them in ptrs.
+  // Returns the number of slots allocated, which is less than num_ptrs only if the allocator ran
+  // out of runs, and sets bytes_allocated to their total size. Sizes above the large size
+  // threshold aren't batched and return 0.
+  size_t AllocBatch(Thread* self, size_t size, size_t num_ptrs, void** ptrs,
+                    size_t* bytes_allocated)
+      LOCKS_EXCLUDED(lock_);
   size_t Free(Thread* self, void* ptr)
       LOCKS_EXCLUDED(bulk_free_lock_);
+  // Frees the slots at once. Several threads may bulk free at the same time as long as they free
+  // slots of different runs, as the parallel sweep does with ranges split by RoundUpToRunBoundary.
   size_t BulkFree(Thread* self, void** ptrs, size_t num_ptrs)
       LOCKS_EXCLUDED(bulk_free_lock_);
   // Returns the size of the allocated slot for a given allocated memory chunk.
@@ -564,8 +644,24 @@ class RosAlloc {
   void InspectAll(void (*handler)(void* start, void* end, size_t used_bytes, void* callback_arg),
                   void* arg)
       LOCKS_EXCLUDED(lock_);
-  // Release empty pages.
+  // Calls the callback on each slot and large object allocated in the runs and the large object
+  // pages handed out since the last call with clear set, which include the objects allocated
+  // since then and may include older ones. With clear, which requires the mutators to be
+  // suspended, all the thread-local and current runs are revoked and the pages are unmarked.
+  void VisitNewAllocations(void (*callback)(void* ptr, void* arg), void* arg, bool clear)
+      LOCKS_EXCLUDED(lock_, Locks::thread_list_lock_);
+  // Returns true if ptr is an allocated slot or large object which VisitNewAllocations() visits.
+  bool IsNewAllocation(const void* ptr) LOCKS_EXCLUDED(lock_);
+  // Release empty pages, in batches of at most kPageReleaseBatchSize bytes between which the lock
+  // is released.
   size_t ReleasePages() LOCKS_EXCLUDED(lock_);
+  // Returns the bytes of the free slots of the runs, which only a compaction of the space gives
+  // back, and sets run_bytes to the bytes of the pages of the runs. The slots are counted without
+  // the size bracket locks, so the result is approximate.
+  size_t FreeSlotBytes(size_t* run_bytes) LOCKS_EXCLUDED(lock_);
+  // Returns the first page boundary at or after addr which isn't inside a run or a large object,
+  // or the end of the footprint. The slots between two such boundaries belong to their own runs.
+  byte* RoundUpToRunBoundary(byte* addr) LOCKS_EXCLUDED(lock_);
   // Returns the current footprint.
   size_t Footprint() LOCKS_EXCLUDED(lock_);
   // Returns the current capacity, maximum footprint.
@@ -16,10 +16,723 @@
 
 #include "concurrent_copying.h"
 
+#include <sched.h>
+
+#include "base/logging.h"
+#include "base/mutex-inl.h"
+#include "base/timing_logger.h"
+#include "gc/accounting/atomic_stack.h"
+#include "gc/accounting/heap_bitmap-inl.h"
+#include "gc/accounting/mod_union_table.h"
+#include "gc/accounting/space_bitmap-inl.h"
+#include "gc/heap.h"
+#include "gc/reference_processor.h"
+#include "gc/space/bump_pointer_space.h"
+#include "gc/space/bump_pointer_space-inl.h"
+#include "gc/space/large_object_space.h"
+#include "gc/space/space-inl.h"
+#include "instrumentation.h"
+#include "lock_word.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/reference-inl.h"
+#include "read_barrier.h"
+#include "runtime.h"
+#include "thread-inl.h"
+#include "thread_list.h"
+
+using ::art::mirror::Object;
+
 namespace art {
 namespace gc {
 namespace collector {
 
+static constexpr bool kProtectFromSpace = true;
+
+// Brooks pointer value of a from-space object while a thread is copying it. The other threads
+// which need the object wait until the forwarding pointer is published.
+static Object* const kBusyForwardingAddress = reinterpret_cast<Object*>(1);
+
+// With the Baker read barrier the forwarding address is kept in the lock word, a null forwarding
+// address marks the object as being copied.
+static LockWord BusyLockWord() {
+  return LockWord::FromForwardingAddress(0);
+}
+
+ConcurrentCopying::ConcurrentCopying(Heap* heap, bool generational,
+                                     const std::string& name_prefix)
+    : GarbageCollector(heap,
+                       name_prefix + (name_prefix.empty() ? "" : " ") +
+                       "concurrent copying + mark sweep"),
+      to_space_(nullptr),
+      from_space_(nullptr),
+      heap_mark_bitmap_(nullptr),
+      gc_mark_stack_(nullptr),
+      mark_stack_lock_("concurrent copying mark stack lock", kConcurrentCopyingMarkStackLock),
+      thread_running_gc_(nullptr),
+      concurrent_(false),
+      is_marking_(false),
+      gray_immune_objects_(false),
+      alloc_thread_unsafe_(false),
+      use_tlab_(false),
+      bytes_moved_(0),
+      objects_moved_(0),
+      collector_name_(name_) {
+  UNUSED(generational);
+}
+
+bool ConcurrentCopying::IsConcurrent() const {
+  // Compiled code does not have read barriers, so the mutators may only run during the copying if
+  // everything is interpreted.
+  return kUseBakerOrBrooksReadBarrier &&
+      Runtime::Current()->GetInstrumentation()->InterpretOnly();
+}
+
+void ConcurrentCopying::RunPhases() {
+  Thread* self = Thread::Current();
+  InitializePhase();
+  if (Locks::mutator_lock_->IsExclusiveHeld(self)) {
+    // We may be called with the mutators already suspended, do everything inside of the current
+    // pause in that case.
+    DCHECK(!concurrent_);
+    GetHeap()->PreGcVerificationPaused(this);
+    GetHeap()->PrePauseRosAllocVerification(this);
+    FlipPhase();
+    CopyingPhase();
+    PausePhase();
+    ReclaimPhase();
+    GetHeap()->PostGcVerificationPaused(this);
+  } else {
+    Locks::mutator_lock_->AssertNotHeld(self);
+    if (concurrent_) {
+      {
+        ScopedPause pause(this);
+        GetHeap()->PreGcVerificationPaused(this);
+        GetHeap()->PrePauseRosAllocVerification(this);
+        FlipPhase();
+      }
+      {
+        ReaderMutexLock mu(self, *Locks::mutator_lock_);
+        CopyingPhase();
+      }
+      {
+        ScopedPause pause(this);
+        PausePhase();
+      }
+    } else {
+      ScopedPause pause(this);
+      GetHeap()->PreGcVerificationPaused(this);
+      GetHeap()->PrePauseRosAllocVerification(this);
+      FlipPhase();
+      CopyingPhase();
+      PausePhase();
+    }
+    {
+      ReaderMutexLock mu(self, *Locks::mutator_lock_);
+      ReclaimPhase();
+    }
+    GetHeap()->PostGcVerification(this);
+  }
+  FinishPhase();
+}
+
+void ConcurrentCopying::InitializePhase() {
+  TimingLogger::ScopedSplit split("InitializePhase", &timings_);
+  thread_running_gc_ = Thread::Current();
+  gc_mark_stack_ = heap_->GetMarkStack();
+  DCHECK(gc_mark_stack_ != nullptr);
+  DCHECK(gc_mark_stack_->IsEmpty());
+  immune_region_.Reset();
+  bytes_moved_.StoreRelaxed(0);
+  objects_moved_.StoreRelaxed(0);
+  concurrent_ = IsConcurrent() && !Locks::mutator_lock_->IsExclusiveHeld(thread_running_gc_);
+  use_tlab_ = heap_->GetCurrentAllocator() == kAllocatorTypeTLAB;
+  CHECK(from_space_ != nullptr && to_space_ != nullptr);
+  CHECK(from_space_->CanMoveObjects()) << "Attempting to move from " << *from_space_;
+  CHECK(to_space_->IsEmpty()) << "To-space is not empty " << *to_space_;
+  // Copying always clears soft references, the same as the non-generational semi-space.
+  clear_soft_references_ = true;
+  {
+    ReaderMutexLock mu(thread_running_gc_, *Locks::heap_bitmap_lock_);
+    heap_mark_bitmap_ = heap_->GetMarkBitmap();
+  }
+  name_ = collector_name_ + (concurrent_ ? "" : " paused");
+}
+
+void ConcurrentCopying::BindBitmaps() {
+  timings_.StartSplit("BindBitmaps");
+  WriterMutexLock mu(thread_running_gc_, *Locks::heap_bitmap_lock_);
+  // Mark all of the spaces we never collect as immune.
+  for (const auto& space : GetHeap()->GetContinuousSpaces()) {
+    if (space->GetGcRetentionPolicy() == space::kGcRetentionPolicyNeverCollect ||
+        space->GetGcRetentionPolicy() == space::kGcRetentionPolicyFullCollect) {
+      CHECK(immune_region_.AddContinuousSpace(space)) << "Failed to add space " << *space;
+    }
+  }
+  timings_.EndSplit();
+}
+
+void ConcurrentCopying::FlipPhase() {
+  Locks::mutator_lock_->AssertExclusiveHeld(thread_running_gc_);
+  TimingLogger::ScopedSplit split("FlipPhase", &timings_);
+  // Revoke the thread local buffers so that the from-space is walkable and its object count is
+  // final, the mutators allocate into the to-space after the flip.
+  RevokeAllThreadLocalBuffers();
+  BindBitmaps();
+  // Process dirty cards and add dirty cards to mod-union tables.
+  heap_->ProcessCards(timings_, false, true);
+  timings_.NewSplit("SwapStacks");
+  if (kUseThreadLocalAllocationStack) {
+    heap_->RevokeAllThreadLocalAllocationStacks(thread_running_gc_);
+  }
+  heap_->SwapStacks(thread_running_gc_);
+  {
+    timings_.NewSplit("MarkStackAsLive");
+    WriterMutexLock mu(thread_running_gc_, *Locks::heap_bitmap_lock_);
+    accounting::ObjectStack* live_stack = heap_->GetLiveStack();
+    heap_->MarkAllocStackAsLive(live_stack);
+    live_stack->Reset();
+  }
+  // The to-space is empty, the GC thread may bump allocate into its main block until a mutator
+  // allocates a thread local buffer.
+  alloc_thread_unsafe_ = true;
+  // From now on the mutators allocate into the to-space.
+  heap_->SwapSemiSpaces();
+  // The immune objects may hold from-space references until their mod-union tables are processed,
+  // gray them when they are marked until then.
+  gray_immune_objects_ = kUseBakerReadBarrier;
+  timings_.NewSplit("FlipRoots");
+  Runtime::Current()->VisitRoots(FlipRootCallback, this);
+  timings_.EndSplit();
+  if (concurrent_) {
+    alloc_thread_unsafe_ = false;
+    // Make the forwarding visible to the read barrier before the mutators resume.
+    QuasiAtomic::MembarStoreLoad();
+    is_marking_ = true;
+    ReadBarrier::SetMarking(this, true);
+    QuasiAtomic::MembarStoreLoad();
+  }
+}
+
+void ConcurrentCopying::CopyingPhase() {
+  TimingLogger::ScopedSplit split("CopyingPhase", &timings_);
+  // Forward the references from the image and zygote spaces to the from-space.
+  UpdateAndMarkModUnion();
+  // Every reference from the immune spaces is now forwarded.
+  QuasiAtomic::MembarStoreStore();
+  gray_immune_objects_ = false;
+  // Recursively copy the remaining objects.
+  ProcessMarkStack();
+}
+
+void ConcurrentCopying::PausePhase() {
+  Locks::mutator_lock_->AssertExclusiveHeld(thread_running_gc_);
+  TimingLogger::ScopedSplit split("PausePhase", &timings_);
+  // Objects pushed by the mutators between the end of the concurrent copying and the pause.
+  ProcessMarkStack();
+  ProcessReferences(thread_running_gc_);
+  SweepSystemWeaks();
+  {
+    WriterMutexLock mu(thread_running_gc_, *Locks::heap_bitmap_lock_);
+    MarkAllocStackAsBlack();
+  }
+  // The mark stacks may not be empty if new objects have been pushed by the mark alloc stack.
+  ProcessMarkStack();
+  if (kIsDebugBuild) {
+    MutexLock mu(thread_running_gc_, mark_stack_lock_);
+    CHECK(shared_mark_stack_.empty());
+  }
+  is_marking_ = false;
+  ReadBarrier::SetMarking(this, false);
+  RecordFromSpaceFree();
+  // Clear and protect the from space.
+  from_space_->Clear();
+  VLOG(heap) << "Protecting from_space_: " << *from_space_;
+  from_space_->GetMemMap()->Protect(kProtectFromSpace ? PROT_NONE : PROT_READ);
+  timings_.StartSplit("PreSweepingGcVerification");
+  heap_->PreSweepingGcVerification(this);
+  timings_.EndSplit();
+}
+
+void ConcurrentCopying::MarkAllocStackAsBlack() {
+  timings_.StartSplit("MarkAllocStackAsBlack");
+  // The non-moving objects allocated since the flip only refer to to-space objects, they are
+  // allocated black and don't need to be scanned.
+  if (kUseThreadLocalAllocationStack) {
+    heap_->RevokeAllThreadLocalAllocationStacks(thread_running_gc_);
+  }
+  heap_->SwapStacks(thread_running_gc_);
+  accounting::ObjectStack* live_stack = heap_->GetLiveStack();
+  heap_->MarkAllocStackAsLive(live_stack);
+  for (Object** it = live_stack->Begin(), **end = live_stack->End(); it != end; ++it) {
+    Object* obj = *it;
+    if (obj != nullptr) {
+      heap_mark_bitmap_->Set(obj, VoidFunctor());
+    }
+  }
+  live_stack->Reset();
+  timings_.EndSplit();
+}
+
+void ConcurrentCopying::RecordFromSpaceFree() {
+  timings_.StartSplit("RecordFree");
+  // Revoke buffers before measuring how many objects were moved since the TLABs need to be revoked
+  // before they are properly counted.
+  RevokeAllThreadLocalBuffers();
+  const int64_t from_bytes = from_space_->GetBytesAllocated();
+  const int64_t to_bytes = bytes_moved_.LoadRelaxed();
+  const uint64_t from_objects = from_space_->GetObjectsAllocated();
+  const uint64_t to_objects = objects_moved_.LoadRelaxed();
+  CHECK_LE(to_objects, from_objects);
+  // Note: Freed bytes can be negative if we copy objects to the non-moving space.
+  RecordFree(from_objects - to_objects, from_bytes - to_bytes);
+  timings_.EndSplit();
+}
+
+void ConcurrentCopying::UpdateAndMarkModUnion() {
+  for (auto& space : heap_->GetContinuousSpaces()) {
+    // If the space is immune then we need to mark the references to other spaces.
+    if (immune_region_.ContainsSpace(space)) {
+      accounting::ModUnionTable* table = heap_->FindModUnionTableFromSpace(space);
+      if (table != nullptr) {
+        TimingLogger::ScopedSplit split(
+            space->IsZygoteSpace() ? "UpdateAndMarkZygoteModUnionTable" :
+                                     "UpdateAndMarkImageModUnionTable",
+                                     &timings_);
+        table->UpdateAndMarkReferences(MarkHeapReferenceCallback, this);
+      }
+    }
+  }
+}
+
+void ConcurrentCopying::ProcessReferences(Thread* self) {
+  TimingLogger::ScopedSplit split("ProcessReferences", &timings_);
+  WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+  GetHeap()->GetReferenceProcessor()->ProcessReferences(
+      false, &timings_, clear_soft_references_, &IsMarkedCallback, &MarkObjectCallback,
+      &ProcessMarkStackCallback, this);
+}
+
+void ConcurrentCopying::SweepSystemWeaks() {
+  timings_.StartSplit("SweepSystemWeaks");
+  ReaderMutexLock mu(thread_running_gc_, *Locks::heap_bitmap_lock_);
+  Runtime::Current()->SweepSystemWeaks(IsMarkedCallback, this);
+  timings_.EndSplit();
+}
+
+void ConcurrentCopying::ReclaimPhase() {
+  TimingLogger::ScopedSplit split("ReclaimPhase", &timings_);
+  WriterMutexLock mu(thread_running_gc_, *Locks::heap_bitmap_lock_);
+  // Reclaim unmarked objects.
+  Sweep(false);
+  // Swap the live and mark bitmaps for each space which we modified space. This is an
+  // optimization that enables us to not clear live bits inside of the sweep. Only swaps unbound
+  // bitmaps.
+  timings_.StartSplit("SwapBitmaps");
+  SwapBitmaps();
+  timings_.EndSplit();
+  // Unbind the live and mark bitmaps.
+  TimingLogger::ScopedSplit unbind_split("UnBindBitmaps", &timings_);
+  GetHeap()->UnBindBitmaps();
+}
+
+bool ConcurrentCopying::ShouldSweepSpace(space::ContinuousSpace* space) const {
+  return space != from_space_ && space != to_space_ && !immune_region_.ContainsSpace(space);
+}
+
+void ConcurrentCopying::Sweep(bool swap_bitmaps) {
+  DCHECK(gc_mark_stack_->IsEmpty());
+  TimingLogger::ScopedSplit split("Sweep", &timings_);
+  for (const auto& space : GetHeap()->GetContinuousSpaces()) {
+    if (space->IsContinuousMemMapAllocSpace()) {
+      space::ContinuousMemMapAllocSpace* alloc_space = space->AsContinuousMemMapAllocSpace();
+      if (!ShouldSweepSpace(alloc_space)) {
+        continue;
+      }
+      TimingLogger::ScopedSplit split(
+          alloc_space->IsZygoteSpace() ? "SweepZygoteSpace" : "SweepAllocSpace", &timings_);
+      size_t freed_objects = 0;
+      size_t freed_bytes = 0;
+      alloc_space->Sweep(swap_bitmaps, &freed_objects, &freed_bytes);
+      RecordFree(freed_objects, freed_bytes);
+    }
+  }
+  SweepLargeObjects(swap_bitmaps);
+}
+
+void ConcurrentCopying::SweepLargeObjects(bool swap_bitmaps) {
+  TimingLogger::ScopedSplit split("SweepLargeObjects", &timings_);
+  size_t freed_objects = 0;
+  size_t freed_bytes = 0;
+  heap_->GetLargeObjectsSpace()->Sweep(swap_bitmaps, &freed_objects, &freed_bytes);
+  RecordFreeLargeObjects(freed_objects, freed_bytes);
+}
+
+void ConcurrentCopying::FinishPhase() {
+  TimingLogger::ScopedSplit split("FinishPhase", &timings_);
+  // Null the "to" and "from" spaces since compacting from one to the other isn't valid until
+  // further action is done by the heap.
+  to_space_ = nullptr;
+  from_space_ = nullptr;
+  CHECK(gc_mark_stack_->IsEmpty());
+  gc_mark_stack_->Reset();
+  thread_running_gc_ = nullptr;
+  alloc_thread_unsafe_ = false;
+  // Clear all of the spaces' mark bitmaps.
+  WriterMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
+  heap_->ClearMarkedObjects();
+}
+
+void ConcurrentCopying::RevokeAllThreadLocalBuffers() {
+  timings_.StartSplit("(Paused)RevokeAllThreadLocalBuffers");
+  GetHeap()->RevokeAllThreadLocalBuffers();
+  timings_.EndSplit();
+}
+
+void ConcurrentCopying::SetToSpace(space::BumpPointerSpace* to_space) {
+  DCHECK(to_space != nullptr);
+  to_space_ = to_space;
+}
+
+void ConcurrentCopying::SetFromSpace(space::BumpPointerSpace* from_space) {
+  DCHECK(from_space != nullptr);
+  from_space_ = from_space;
+}
+
+inline Object* ConcurrentCopying::GetFwdPtr(Object* from_ref) {
+  DCHECK(from_space_->HasAddress(from_ref));
+  if (kUseBrooksReadBarrier) {
+    Object* rb_ptr = from_ref->GetReadBarrierPointer();
+    if (rb_ptr == from_ref || rb_ptr == kBusyForwardingAddress) {
+      return nullptr;
+    }
+    return rb_ptr;
+  }
+  LockWord lock_word = from_ref->GetLockWord(kUseBakerReadBarrier);
+  if (lock_word.GetState() != LockWord::kForwardingAddress) {
+    return nullptr;
+  }
+  // Null while another thread is copying the object.
+  return reinterpret_cast<Object*>(lock_word.ForwardingAddress());
+}
+
+Object* ConcurrentCopying::AllocateCopy(Thread* self, size_t obj_size, size_t* bytes_allocated,
+                                        bool* in_to_space) {
+  Object* to_ref = nullptr;
+  *in_to_space = true;
+  if (alloc_thread_unsafe_) {
+    // Only the GC thread runs, see FlipPhase.
+    DCHECK_EQ(self, thread_running_gc_);
+    to_ref = to_space_->AllocThreadUnsafe(self, obj_size, bytes_allocated, nullptr);
+  } else if (use_tlab_) {
+    // The to-space is made of blocks, so copies must go through thread local buffers to keep it
+    // walkable.
+    const size_t alloc_size = RoundUp(obj_size, space::BumpPointerSpace::kAlignment);
+    if (self->TlabSize() < alloc_size && self == thread_running_gc_) {
+      // Only the GC thread can take the block lock here, the mutators may be holding locks which
+      // are ordered before it.
+      to_space_->AllocNewTlab(self, alloc_size + Heap::kDefaultTLABSize);
+    }
+    if (self->TlabSize() >= alloc_size) {
+      to_ref = self->AllocTlab(alloc_size);
+      *bytes_allocated = alloc_size;
+    }
+  } else {
+    to_ref = to_space_->Alloc(self, obj_size, bytes_allocated, nullptr);
+  }
+  if (UNLIKELY(to_ref == nullptr)) {
+    // Fall back to the non-moving space.
+    space::MallocSpace* non_moving_space = heap_->GetNonMovingSpace();
+    to_ref = non_moving_space->Alloc(self, obj_size, bytes_allocated, nullptr);
+    CHECK(to_ref != nullptr) << "Out of memory when copying " << PrettySize(obj_size);
+    *in_to_space = false;
+    // The copy is live and already marked.
+    non_moving_space->GetLiveBitmap()->AtomicTestAndSet(to_ref);
+    non_moving_space->GetMarkBitmap()->AtomicTestAndSet(to_ref);
+  }
+  return to_ref;
+}
+
+Object* ConcurrentCopying::Copy(Object* from_ref) {
+  DCHECK(from_space_->HasAddress(from_ref));
+  LockWord lock_word;
+  if (kUseBrooksReadBarrier) {
+    // Claim the object by installing the busy marker, whoever succeeds does the copy.
+    while (true) {
+      Object* rb_ptr = from_ref->GetReadBarrierPointer();
+      if (rb_ptr == kBusyForwardingAddress) {
+        // Another thread is copying the object, wait for it to publish the forwarding pointer.
+        sched_yield();
+        continue;
+      }
+      if (rb_ptr != from_ref) {
+        // Already forwarded.
+        return rb_ptr;
+      }
+      if (from_ref->AtomicSetReadBarrierPointer(from_ref, kBusyForwardingAddress)) {
+        break;
+      }
+    }
+  } else if (kUseBakerReadBarrier) {
+    // Claim the object by installing the busy lock word. The mutators only see to-space references
+    // after the flip, so only the copying threads may change the lock word of a from-space object.
+    while (true) {
+      lock_word = from_ref->GetLockWord(true);
+      if (lock_word.GetState() == LockWord::kForwardingAddress) {
+        if (lock_word.ForwardingAddress() == 0) {
+          // Another thread is copying the object, wait for it to publish the forwarding address.
+          sched_yield();
+          continue;
+        }
+        return reinterpret_cast<Object*>(lock_word.ForwardingAddress());
+      }
+      if (from_ref->CasLockWord(lock_word, BusyLockWord())) {
+        break;
+      }
+    }
+  } else {
+    // Without a read barrier to forward the references, the mutators are suspended.
+    DCHECK(!concurrent_);
+    Object* fwd_ptr = GetFwdPtr(from_ref);
+    if (fwd_ptr != nullptr) {
+      return fwd_ptr;
+    }
+  }
+  Thread* self = Thread::Current();
+  // The class may have been copied already, the from-space copy remains valid until the end of
+  // the collection.
+  const size_t obj_size = from_ref->SizeOf<kVerifyNone, kWithoutReadBarrier>();
+  size_t bytes_allocated = 0;
+  bool in_to_space;
+  Object* to_ref = AllocateCopy(self, obj_size, &bytes_allocated, &in_to_space);
+  memcpy(to_ref, from_ref, obj_size);
+  objects_moved_.FetchAndAddSequentiallyConsistent(1);
+  bytes_moved_.FetchAndAddSequentiallyConsistent(bytes_allocated);
+  if (!in_to_space) {
+    // Dirty the card at the destination as it may contain references to the to-space.
+    heap_->WriteBarrierEveryFieldOf(to_ref);
+  }
+  if (kUseBrooksReadBarrier) {
+    // The copy points to itself, then publish the forwarding pointer.
+    to_ref->SetReadBarrierPointer(to_ref);
+    QuasiAtomic::MembarStoreStore();
+    CHECK(from_ref->AtomicSetReadBarrierPointer(kBusyForwardingAddress, to_ref));
+  } else if (kUseBakerReadBarrier) {
+    // Restore the lock word that the busy marker replaced, the copy stays gray until it is
+    // scanned, then publish the forwarding address.
+    to_ref->SetLockWord(lock_word, false);
+    to_ref->SetReadBarrierPointer(ReadBarrier::GrayPtr());
+    QuasiAtomic::MembarStoreStore();
+    CHECK(from_ref->CasLockWord(BusyLockWord(),
+                                LockWord::FromForwardingAddress(reinterpret_cast<size_t>(to_ref))));
+  } else {
+    // Make sure to only update the forwarding address AFTER you copy the object so that the
+    // monitor word doesn't get stomped over.
+    from_ref->SetLockWord(LockWord::FromForwardingAddress(reinterpret_cast<size_t>(to_ref)),
+                          false);
+  }
+  PushOntoMarkStack(to_ref);
+  return to_ref;
+}
+
+Object* ConcurrentCopying::Mark(Object* from_ref) {
+  if (from_ref == nullptr) {
+    return nullptr;
+  }
+  if (from_space_->HasAddress(from_ref)) {
+    Object* fwd_ptr = GetFwdPtr(from_ref);
+    return fwd_ptr != nullptr ? fwd_ptr : Copy(from_ref);
+  }
+  if (to_space_->HasAddress(from_ref)) {
+    // To-space objects are either allocated since the flip or already copied.
+    return from_ref;
+  }
+  if (immune_region_.ContainsObject(from_ref)) {
+    if (kUseBakerReadBarrier && gray_immune_objects_ &&
+        from_ref->AtomicSetReadBarrierPointer(ReadBarrier::WhitePtr(), ReadBarrier::GrayPtr())) {
+      PushOntoMarkStack(from_ref);
+    }
+    return from_ref;
+  }
+  if (kUseBakerReadBarrier) {
+    // A non-moving object must be gray before it is marked, otherwise a mutator could read a
+    // from-space reference through an object that another thread marked but not yet grayed.
+    if (TestMarkBit(from_ref) ||
+        !from_ref->AtomicSetReadBarrierPointer(ReadBarrier::WhitePtr(), ReadBarrier::GrayPtr())) {
+      return from_ref;
+    }
+    if (TestAndSetMarkBit(from_ref)) {
+      // Marked and scanned since we tested the mark bit, undo the graying.
+      CHECK(from_ref->AtomicSetReadBarrierPointer(ReadBarrier::GrayPtr(), ReadBarrier::WhitePtr()));
+      return from_ref;
+    }
+    PushOntoMarkStack(from_ref);
+    return from_ref;
+  }
+  // A non-moving object, gray it if we are the first to mark it.
+  if (!TestAndSetMarkBit(from_ref)) {
+    PushOntoMarkStack(from_ref);
+  }
+  return from_ref;
+}
+
+Object* ConcurrentCopying::IsMarked(Object* from_ref) {
+  DCHECK(from_ref != nullptr);
+  if (from_space_->HasAddress(from_ref)) {
+    // Returns either the forwarding address or nullptr.
+    return GetFwdPtr(from_ref);
+  }
+  if (to_space_->HasAddress(from_ref) || immune_region_.ContainsObject(from_ref)) {
+    return from_ref;
+  }
+  return TestMarkBit(from_ref) ? from_ref : nullptr;
+}
+
+bool ConcurrentCopying::TestAndSetMarkBit(Object* obj) {
+  return heap_mark_bitmap_->AtomicTestAndSet(obj, VoidFunctor());
+}
+
+bool ConcurrentCopying::TestMarkBit(Object* obj) {
+  return heap_mark_bitmap_->Test(obj);
+}
+
+void ConcurrentCopying::PushOntoMarkStack(Object* to_ref) {
+  if (Thread::Current() == thread_running_gc_) {
+    if (UNLIKELY(gc_mark_stack_->Size() >= gc_mark_stack_->Capacity())) {
+      std::vector<Object*> temp(gc_mark_stack_->Begin(), gc_mark_stack_->End());
+      gc_mark_stack_->Resize(gc_mark_stack_->Capacity() * 2);
+      for (Object* obj : temp) {
+        gc_mark_stack_->PushBack(obj);
+      }
+    }
+    gc_mark_stack_->PushBack(to_ref);
+  } else {
+    // A mutator grayed the object through the read barrier.
+    MutexLock mu(Thread::Current(), mark_stack_lock_);
+    shared_mark_stack_.push_back(to_ref);
+  }
+}
+
+void ConcurrentCopying::ProcessMarkStack() {
+  timings_.StartSplit("ProcessMarkStack");
+  std::vector<Object*> mutator_grays;
+  while (true) {
+    while (!gc_mark_stack_->IsEmpty()) {
+      Scan(gc_mark_stack_->PopBack());
+    }
+    {
+      MutexLock mu(thread_running_gc_, mark_stack_lock_);
+      if (shared_mark_stack_.empty()) {
+        break;
+      }
+      mutator_grays.swap(shared_mark_stack_);
+    }
+    for (Object* obj : mutator_grays) {
+      Scan(obj);
+    }
+    mutator_grays.clear();
+  }
+  timings_.EndSplit();
+}
+
+inline void ConcurrentCopying::Process(Object* obj, MemberOffset offset) {
+  Object* ref = obj->GetFieldObject<Object, kVerifyNone, kWithoutReadBarrier>(offset);
+  Object* to_ref = Mark(ref);
+  if (to_ref != ref) {
+    // If the CAS fails, a mutator has stored a to-space reference (or null) in the field meanwhile.
+    obj->CasFieldObject<false, false, kVerifyNone>(offset, ref, to_ref);
+  }
+}
+
+void ConcurrentCopying::DelayReferenceReferent(mirror::Class* klass,
+                                               mirror::Reference* reference) {
+  while (true) {
+    Object* referent = reference->GetReferent<kWithoutReadBarrier>();
+    if (referent == nullptr) {
+      return;
+    }
+    Object* fwd_ptr = IsMarked(referent);
+    if (fwd_ptr == nullptr) {
+      heap_->GetReferenceProcessor()->DelayReferenceReferent(klass, reference, &IsMarkedCallback,
+                                                             this);
+      return;
+    }
+    // Forward an already copied referent ourselves rather than with the plain store of the
+    // reference processor, so that a concurrent Reference.clear() isn't undone.
+    if (fwd_ptr == referent ||
+        reference->CasFieldObject<false, false, kVerifyNone>(
+            mirror::Reference::ReferentOffset(), referent, fwd_ptr)) {
+      return;
+    }
+  }
+}
+
+class ConcurrentCopyingRefFieldsVisitor {
+ public:
+  explicit ConcurrentCopyingRefFieldsVisitor(ConcurrentCopying* collector)
+      : collector_(collector) {
+  }
+
+  void operator()(Object* obj, MemberOffset offset, bool /* is_static */) const ALWAYS_INLINE
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    collector_->Process(obj, offset);
+  }
+
+  void operator()(mirror::Class* klass, mirror::Reference* ref) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    collector_->DelayReferenceReferent(klass, ref);
+  }
+
+ private:
+  ConcurrentCopying* const collector_;
+};
+
+// Visit all of the references of a gray object and forward them.
+void ConcurrentCopying::Scan(Object* to_ref) {
+  DCHECK(!from_space_->HasAddress(to_ref)) << "Scanning object " << to_ref << " in from space";
+  ConcurrentCopyingRefFieldsVisitor visitor(this);
+  to_ref->VisitReferences<kMovingClasses>(visitor, visitor);
+  if (kUseBakerReadBarrier) {
+    // The forwarded fields must be visible before the mutators stop marking what they load.
+    QuasiAtomic::MembarStoreStore();
+    CHECK(to_ref->AtomicSetReadBarrierPointer(ReadBarrier::GrayPtr(), ReadBarrier::WhitePtr()));
+  }
+}
+
+void ConcurrentCopying::FlipRootCallback(Object** root, void* arg, uint32_t /*thread_id*/,
+                                         RootType /*root_type*/) {
+  Object* ref = *root;
+  Object* to_ref = reinterpret_cast<ConcurrentCopying*>(arg)->Mark(ref);
+  if (to_ref != ref) {
+    *root = to_ref;
+  }
+}
+
+Object* ConcurrentCopying::MarkObjectCallback(Object* from_ref, void* arg) {
+  return reinterpret_cast<ConcurrentCopying*>(arg)->Mark(from_ref);
+}
+
+void ConcurrentCopying::MarkHeapReferenceCallback(mirror::HeapReference<Object>* ref, void* arg) {
+  Object* from_ref = ref->AsMirrorPtr();
+  Object* to_ref = reinterpret_cast<ConcurrentCopying*>(arg)->Mark(from_ref);
+  if (to_ref != from_ref) {
+    // The field may be concurrently written by a mutator, don't overwrite its store.
+    volatile uint32_t* addr = reinterpret_cast<volatile uint32_t*>(ref);
+    __sync_bool_compare_and_swap(addr,
+                                 mirror::HeapReference<Object>::FromMirrorPtr(from_ref).AsVRegValue(),
+                                 mirror::HeapReference<Object>::FromMirrorPtr(to_ref).AsVRegValue());
+  }
+}
+
+Object* ConcurrentCopying::IsMarkedCallback(Object* from_ref, void* arg) {
+  return reinterpret_cast<ConcurrentCopying*>(arg)->IsMarked(from_ref);
+}
+
+void ConcurrentCopying::ProcessMarkStackCallback(void* arg) {
+  reinterpret_cast<ConcurrentCopying*>(arg)->ProcessMarkStack();
+}
+
 }  // namespace collector
 }  // namespace gc
 }  // namespace art
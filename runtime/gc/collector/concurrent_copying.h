@@ -17,32 +17,237 @@
 #ifndef ART_RUNTIME_GC_COLLECTOR_CONCURRENT_COPYING_H_
 #define ART_RUNTIME_GC_COLLECTOR_CONCURRENT_COPYING_H_
 
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
 #include "garbage_collector.h"
+#include "immune_region.h"
+#include "object_callbacks.h"
+#include "offsets.h"
 
 namespace art {
+
+class Thread;
+
+namespace mirror {
+  class Class;
+  class Object;
+  class Reference;
+}  // namespace mirror
+
 namespace gc {
+
+class Heap;
+
+namespace accounting {
+  class HeapBitmap;
+  template <typename T> class AtomicStack;
+  typedef AtomicStack<mirror::Object*> ObjectStack;
+}  // namespace accounting
+
+namespace space {
+  class BumpPointerSpace;
+  class ContinuousSpace;
+}  // namespace space
+
 namespace collector {
 
+// A mostly concurrent copying collector. Live objects are evacuated from the from-space (the bump
+// pointer space that mutators were allocating into) to the to-space while the mutators run. The
+// root set is flipped to the to-space in a short initial pause and, from then on, every reference
+// a mutator loads is forwarded by the read barrier (see ReadBarrier::Barrier) so that mutators only
+// ever observe to-space objects. A second short pause drains the remaining gray objects, processes
+// java.lang.ref.References and sweeps the system weaks. The non-moving spaces are marked and swept
+// concurrently, the image and zygote spaces are immune and are updated through their mod-union
+// tables.
+//
+// With USE_BROOKS_READ_BARRIER the forwarding pointers are installed in the Brooks pointer and
+// every reference loaded while marking is forwarded. With USE_BAKER_READ_BARRIER the forwarding
+// pointers are installed in the lock word and only the references loaded from gray objects, the
+// objects which may still hold from-space references, are forwarded. Either way the collector
+// only runs concurrently when the managed code is interpreted, since Quick does not yet emit read
+// barriers for all of its reference loads. Otherwise the copying runs inside a single pause, with
+// the forwarding pointers stored in the lock word as the semi-space collector does.
 class ConcurrentCopying : public GarbageCollector {
  public:
   explicit ConcurrentCopying(Heap* heap, bool generational = false,
-                             const std::string& name_prefix = "")
-      : GarbageCollector(heap,
-                         name_prefix + (name_prefix.empty() ? "" : " ") +
-                         "concurrent copying + mark sweep") {}
+                             const std::string& name_prefix = "");
 
   ~ConcurrentCopying() {}
 
-  virtual void RunPhases() OVERRIDE {}
+  virtual void RunPhases() OVERRIDE NO_THREAD_SAFETY_ANALYSIS;
+  virtual void InitializePhase();
+  // Flips the roots to the to-space with the mutators suspended.
+  void FlipPhase() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Copies the objects reachable from the roots, concurrently with the mutators if IsConcurrent().
+  void CopyingPhase() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Drains the mark stacks and processes the weak references with the mutators suspended.
+  void PausePhase() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+  virtual void ReclaimPhase() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
+  virtual void FinishPhase() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   virtual GcType GetGcType() const OVERRIDE {
     return kGcTypePartial;
   }
   virtual CollectorType GetCollectorType() const OVERRIDE {
     return kCollectorTypeCC;
   }
-  virtual void RevokeAllThreadLocalBuffers() OVERRIDE {}
+  virtual void RevokeAllThreadLocalBuffers() OVERRIDE;
+
+  // Sets which space we will be copying objects to.
+  void SetToSpace(space::BumpPointerSpace* to_space);
+
+  // Set the space where we copy objects from.
+  void SetFromSpace(space::BumpPointerSpace* from_space);
+
+  // Returns true if the copying can run concurrently with the mutators, which requires every
+  // reference load to go through the read barrier.
+  bool IsConcurrent() const;
+
+  // True between the flip and the end of the copying, the read barrier needs to forward the
+  // references loaded by the mutators during that time.
+  bool IsMarking() const {
+    return is_marking_;
+  }
+
+  // Returns the to-space address of from_ref, copying it first if needed. Objects outside of the
+  // from-space are marked and returned as is. Called by the GC thread and, through the read
+  // barrier, by the mutators.
+  mirror::Object* Mark(mirror::Object* from_ref) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns null if the object is not marked, otherwise returns the forwarding address (same as
+  // object for non movable things).
+  mirror::Object* IsMarked(mirror::Object* from_ref) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Updates the reference field at offset of obj to the to-space, without overwriting a value that
+  // a mutator stored concurrently.
+  void Process(mirror::Object* obj, MemberOffset offset)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Schedules an unmarked object for reference processing.
+  void DelayReferenceReferent(mirror::Class* klass, mirror::Reference* reference)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static void FlipRootCallback(mirror::Object** root, void* arg, uint32_t /*tid*/,
+                               RootType /*root_type*/)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static mirror::Object* MarkObjectCallback(mirror::Object* from_ref, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static void MarkHeapReferenceCallback(mirror::HeapReference<mirror::Object>* ref, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static mirror::Object* IsMarkedCallback(mirror::Object* from_ref, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static void ProcessMarkStackCallback(void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
  private:
+  // Bind the live bits to the mark bits of bitmaps for spaces that are never collected, ie
+  // the image. Mark that portion of the heap as immune.
+  void BindBitmaps() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
+
+  // Copies from_ref to the to-space and installs the forwarding pointer, or returns the copy that
+  // another thread installed first.
+  mirror::Object* Copy(mirror::Object* from_ref) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Allocates the storage for a copy, falling back to the non-moving space if the to-space is full.
+  mirror::Object* AllocateCopy(Thread* self, size_t obj_size, size_t* bytes_allocated,
+                               bool* in_to_space)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns the forwarding address of an object in the from-space, or null if it isn't copied yet.
+  mirror::Object* GetFwdPtr(mirror::Object* from_ref) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Accesses the mark bits of the non-moving objects. The mutators mark through the read barrier
+  // without holding the heap bitmap lock, this is safe since the bitmaps are only swapped in the
+  // reclaim phase, after the marking is done.
+  bool TestAndSetMarkBit(mirror::Object* obj) NO_THREAD_SAFETY_ANALYSIS;
+  bool TestMarkBit(mirror::Object* obj) NO_THREAD_SAFETY_ANALYSIS;
+
+  // Visit all of the references of a gray object and forward them.
+  void Scan(mirror::Object* to_ref) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Push a gray object, the mutators push onto the shared mark stack.
+  void PushOntoMarkStack(mirror::Object* to_ref) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Scan the gray objects until both the GC and the shared mark stacks are empty.
+  void ProcessMarkStack() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Forward the references from the immune spaces through their mod-union tables.
+  void UpdateAndMarkModUnion() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Marks the objects that were allocated into the non-moving spaces since the flip, they are
+  // allocated black.
+  void MarkAllocStackAsBlack() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_,
+                                                        Locks::heap_bitmap_lock_);
+
+  void ProcessReferences(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  void SweepSystemWeaks() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns true if we should sweep the space.
+  bool ShouldSweepSpace(space::ContinuousSpace* space) const;
+
+  // Sweeps unmarked objects of the non-moving spaces to complete the garbage collection.
+  void Sweep(bool swap_bitmaps) EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+
+  // Sweeps unmarked large objects.
+  void SweepLargeObjects(bool swap_bitmaps) EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+
+  // Record the bytes and objects freed by evacuating the from-space.
+  void RecordFromSpaceFree() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  space::BumpPointerSpace* to_space_;
+  space::BumpPointerSpace* from_space_;
+
+  // Immune region, every object inside the immune region is assumed to be marked.
+  ImmuneRegion immune_region_;
+
+  // Cached heap mark bitmap.
+  accounting::HeapBitmap* heap_mark_bitmap_;
+
+  // The GC thread's mark stack, only accessed by thread_running_gc_.
+  accounting::ObjectStack* gc_mark_stack_;
+
+  // Gray objects pushed by the mutators through the read barrier.
+  Mutex mark_stack_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::vector<mirror::Object*> shared_mark_stack_ GUARDED_BY(mark_stack_lock_);
+
+  Thread* thread_running_gc_;
+
+  // Whether this collection runs concurrently, see IsConcurrent().
+  bool concurrent_;
+
+  // Set while the read barrier needs to forward references.
+  volatile bool is_marking_;
+
+  // Set while the immune objects must be grayed when marked, see FlipPhase.
+  volatile bool gray_immune_objects_;
+
+  // True while no mutator has allocated into the to-space during this collection, the to-space
+  // is then a single main block and the GC thread copies objects with AllocThreadUnsafe.
+  bool alloc_thread_unsafe_;
+
+  // True if the TLAB allocator is used, copies then go through thread local buffers so that the
+  // to-space stays walkable.
+  bool use_tlab_;
+
+  // How many objects and bytes we moved, used to compute how many objects and bytes we freed from
+  // the from-space. Mutators copy objects too, hence atomic.
+  Atomic<size_t> bytes_moved_;
+  Atomic<size_t> objects_moved_;
+
+  // The name of the collector.
+  std::string collector_name_;
+
+  friend class ConcurrentCopyingRefFieldsVisitor;
   DISALLOW_COPY_AND_ASSIGN(ConcurrentCopying);
 };
 
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "concurrent_copying.h"
+
+#include "common_runtime_test.h"
+#include "gc/heap.h"
+#include "gc/space/bump_pointer_space.h"
+#include "handle_scope-inl.h"
+#include "lock_word-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/string-inl.h"
+#include "monitor.h"
+#include "object_utils.h"
+#include "read_barrier-inl.h"
+#include "scoped_thread_state_change.h"
+
+namespace art {
+namespace gc {
+namespace collector {
+
+class ConcurrentCopyingTest : public CommonRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(Runtime::Options *options) OVERRIDE {
+    options->push_back(std::make_pair("-Xgc:CC", nullptr));
+  }
+
+  bool UsesConcurrentCopying() {
+    return kMovingCollector &&
+        Runtime::Current()->GetHeap()->CurrentCollectorType() == kCollectorTypeCC;
+  }
+
+  // The space the mutators allocate into, the from-space of the next collection.
+  space::BumpPointerSpace* AllocationSpace() {
+    return Runtime::Current()->GetHeap()->bump_pointer_space_;
+  }
+
+  // The to-space of the next collection.
+  space::BumpPointerSpace* TempSpace() {
+    return Runtime::Current()->GetHeap()->temp_space_;
+  }
+
+  void Collect(Thread* self) {
+    ScopedThreadStateChange tsc(self, kNative);
+    Runtime::Current()->GetHeap()->CollectGarbage(false);
+  }
+};
+
+// Counts the reference fields which point into a space.
+class SpaceReferenceCounter {
+ public:
+  explicit SpaceReferenceCounter(space::BumpPointerSpace* space) : space_(space), count_(0) {
+  }
+
+  void operator()(mirror::Object* obj, MemberOffset offset, bool /* is_static */) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    mirror::Object* ref = obj->GetFieldObject<mirror::Object, kVerifyNone, kWithoutReadBarrier>(
+        offset);
+    if (space_->HasAddress(ref)) {
+      ++count_;
+    }
+  }
+
+  static void Callback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    obj->VisitReferences<true, kVerifyNone>(*reinterpret_cast<SpaceReferenceCounter*>(arg),
+                                            VoidFunctor());
+  }
+
+  size_t GetCount() const {
+    return count_;
+  }
+
+ private:
+  space::BumpPointerSpace* const space_;
+  mutable size_t count_;
+};
+
+TEST_F(ConcurrentCopyingTest, FlipAndCopy) {
+  if (!UsesConcurrentCopying()) {
+    return;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::String> string(
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "hello, world!")));
+  ASSERT_TRUE(string.Get() != nullptr);
+  mirror::Object* from_ref = string.Get();
+  space::BumpPointerSpace* from_space = AllocationSpace();
+  ASSERT_TRUE(from_space->HasAddress(from_ref));
+
+  Collect(soa.Self());
+  // The root was flipped to the copy, the mutators now allocate next to it.
+  space::BumpPointerSpace* to_space = AllocationSpace();
+  EXPECT_NE(from_space, to_space);
+  EXPECT_NE(from_ref, string.Get());
+  EXPECT_TRUE(to_space->HasAddress(string.Get()));
+  EXPECT_TRUE(string->Equals("hello, world!"));
+  mirror::String* new_string = mirror::String::AllocFromModifiedUtf8(soa.Self(), "new");
+  ASSERT_TRUE(new_string != nullptr);
+  EXPECT_TRUE(to_space->HasAddress(new_string));
+}
+
+TEST_F(ConcurrentCopyingTest, Forwarding) {
+  if (!UsesConcurrentCopying()) {
+    return;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<3> hs(soa.Self());
+  Handle<mirror::Class> c(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;")));
+  Handle<mirror::ObjectArray<mirror::Object>> array(
+      hs.NewHandle(mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c.Get(), 3)));
+  ASSERT_TRUE(array.Get() != nullptr);
+  Handle<mirror::String> string(
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "hello, world!")));
+  ASSERT_TRUE(string.Get() != nullptr);
+  array->Set<false>(0, string.Get());
+  array->Set<false>(1, string.Get());
+  array->Set<false>(2, array.Get());
+
+  Collect(soa.Self());
+  // Every reference to an object is forwarded to its single copy.
+  EXPECT_EQ(string.Get(), array->Get(0));
+  EXPECT_EQ(string.Get(), array->Get(1));
+  EXPECT_EQ(array.Get(), array->Get(2));
+  // The forwarding addresses only replace the lock words of the from-space objects.
+  EXPECT_NE(LockWord::kForwardingAddress, string->GetLockWord(false).GetState());
+  EXPECT_NE(LockWord::kForwardingAddress, array->GetLockWord(false).GetState());
+}
+
+TEST_F(ConcurrentCopyingTest, CopyKeepsLock) {
+  if (!UsesConcurrentCopying()) {
+    return;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::String> string(
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "locked")));
+  ASSERT_TRUE(string.Get() != nullptr);
+  mirror::Object* from_ref = string.Get();
+  ObjectLock<mirror::String> lock(soa.Self(), string);
+
+  Collect(soa.Self());
+  ASSERT_NE(from_ref, string.Get());
+  EXPECT_EQ(soa.Self()->GetThreadId(), Monitor::GetLockOwnerThreadId(string.Get()));
+}
+
+TEST_F(ConcurrentCopyingTest, FromSpaceInvariants) {
+  if (!UsesConcurrentCopying()) {
+    return;
+  }
+  static constexpr size_t kNumStrings = 256;
+  ConcurrentCopying* collector = Runtime::Current()->GetHeap()->ConcurrentCopyingCollector();
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> c(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;")));
+  Handle<mirror::ObjectArray<mirror::Object>> array(
+      hs.NewHandle(mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c.Get(), kNumStrings)));
+  ASSERT_TRUE(array.Get() != nullptr);
+  for (size_t i = 0; i < kNumStrings; ++i) {
+    mirror::String* string = mirror::String::AllocFromModifiedUtf8(soa.Self(), "hello, world!");
+    ASSERT_TRUE(string != nullptr);
+    // Only keep every other string.
+    if (i % 2 == 0) {
+      array->Set<false>(i, string);
+    }
+  }
+  space::BumpPointerSpace* from_space = AllocationSpace();
+  const uint64_t freed_objects_before = collector->GetTotalFreedObjects();
+
+  Collect(soa.Self());
+  EXPECT_FALSE(collector->IsMarking());
+  EXPECT_FALSE(ReadBarrier::IsMarking());
+  // The from-space is evacuated and cleared, it is the to-space of the next collection.
+  EXPECT_EQ(from_space, TempSpace());
+  EXPECT_TRUE(from_space->IsEmpty());
+  // The unreachable strings were left behind.
+  EXPECT_GE(collector->GetTotalFreedObjects() - freed_objects_before, kNumStrings / 2);
+  // No copy refers to the from-space.
+  SpaceReferenceCounter counter(from_space);
+  AllocationSpace()->Walk(SpaceReferenceCounter::Callback, &counter);
+  EXPECT_EQ(0U, counter.GetCount());
+  for (size_t i = 0; i < kNumStrings; i += 2) {
+    ASSERT_TRUE(array->Get(i) != nullptr);
+    EXPECT_TRUE(array->Get(i)->AsString()->Equals("hello, world!"));
+  }
+}
+
+}  // namespace collector
+}  // namespace gc
+}  // namespace art
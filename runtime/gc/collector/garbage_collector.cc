@@ -51,6 +51,7 @@ void GarbageCollector::ResetCumulativeStatistics() {
   cumulative_timings_.Reset();
   pause_histogram_.Reset();
   total_time_ns_ = 0;
+  total_cpu_time_ns_ = 0;
   total_freed_objects_ = 0;
   total_freed_bytes_ = 0;
 }
@@ -58,6 +59,7 @@ void GarbageCollector::ResetCumulativeStatistics() {
 void GarbageCollector::Run(GcCause gc_cause, bool clear_soft_references) {
   Thread* self = Thread::Current();
   uint64_t start_time = NanoTime();
+  uint64_t start_cpu_time = ThreadCpuNanoTime();
   timings_.Reset();
   pause_times_.clear();
   duration_ns_ = 0;
@@ -83,6 +85,7 @@ void GarbageCollector::Run(GcCause gc_cause, bool clear_soft_references) {
     RegisterPause(duration_ns_);
   }
   total_time_ns_ += GetDurationNs();
+  total_cpu_time_ns_ += ThreadCpuNanoTime() - start_cpu_time;
   for (uint64_t pause_time : pause_times_) {
     pause_histogram_.AddValue(pause_time / 1000);
   }
@@ -144,6 +147,7 @@ void GarbageCollector::ResetMeasurements() {
   cumulative_timings_.Reset();
   pause_histogram_.Reset();
   total_time_ns_ = 0;
+  total_cpu_time_ns_ = 0;
   total_freed_objects_ = 0;
   total_freed_bytes_ = 0;
 }
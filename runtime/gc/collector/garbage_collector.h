@@ -108,6 +108,12 @@ class GarbageCollector {
     return pause_histogram_.Sum();
   }
 
+  // Returns the CPU time used by the threads which ran the GC iterations, without the time of
+  // the thread pool workers.
+  uint64_t GetTotalCpuTimeNs() const {
+    return total_cpu_time_ns_;
+  }
+
   int64_t GetTotalFreedBytes() const {
     return total_freed_bytes_;
   }
@@ -162,6 +168,7 @@ class GarbageCollector {
   // Cumulative statistics.
   Histogram<uint64_t> pause_histogram_;
   uint64_t total_time_ns_;
+  uint64_t total_cpu_time_ns_;
   uint64_t total_freed_objects_;
   int64_t total_freed_bytes_;
 
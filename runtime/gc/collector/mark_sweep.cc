@@ -16,9 +16,11 @@
 
 #include "mark_sweep.h"
 
+#include <algorithm>
 #include <functional>
 #include <numeric>
 #include <climits>
+#include <sched.h>
 #include <vector>
 
 #include "base/bounded_fifo.h"
@@ -26,6 +28,8 @@
 #include "base/macros.h"
 #include "base/mutex-inl.h"
 #include "base/timing_logger.h"
+#include "base/work_stealing_deque.h"
+#include "class_linker.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/mod_union_table.h"
@@ -34,10 +38,12 @@
 #include "gc/reference_processor.h"
 #include "gc/space/image_space.h"
 #include "gc/space/large_object_space.h"
+#include "gc/space/rosalloc_space.h"
 #include "gc/space/space-inl.h"
 #include "mark_sweep-inl.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/object-inl.h"
+#include "mirror/object_array-inl.h"
 #include "runtime.h"
 #include "scoped_thread_state_change.h"
 #include "thread-inl.h"
@@ -55,6 +61,9 @@ namespace collector {
 // Performance options.
 static constexpr bool kUseRecursiveMark = false;
 static constexpr bool kUseMarkStackPrefetch = true;
+// Number of popped objects whose header is being prefetched ahead of the scan.
+// TODO: Tune this.
+static constexpr size_t kMarkStackPrefetchFifoSize = 4;
 static constexpr size_t kSweepArrayChunkFreeSize = 1024;
 static constexpr bool kPreCleanCards = true;
 
@@ -67,6 +76,17 @@ static constexpr bool kParallelRecursiveMark = true;
 // ProcessMarkStack with very small mark stacks.
 static constexpr size_t kMinimumParallelMarkStackSize = 128;
 static constexpr bool kParallelProcessMarkStack = true;
+// Split the object arrays found by the parallel mark stack processing into slices of n elements
+// which the other marking threads can steal, so that one huge array doesn't serialize the marking.
+static constexpr bool kSliceLargeObjectArrays = true;
+static constexpr size_t kObjectArraySliceLength = 1024;
+static constexpr bool kParallelModUnion = true;
+// Mark the thread roots in the pauses with the GC threads once there are at least n threads.
+static constexpr bool kParallelThreadRoots = true;
+static constexpr size_t kMinimumParallelThreadRoots = 4;
+static constexpr bool kParallelSweep = true;
+// Don't split the sweep of a RosAlloc space smaller than this, nor into ranges smaller than this.
+static constexpr size_t kMinimumParallelSweepSize = 1 * MB;
 
 // Profiling and information flags.
 static constexpr bool kProfileLargeObjects = false;
@@ -74,6 +94,9 @@ static constexpr bool kMeasureOverhead = false;
 static constexpr bool kCountTasks = false;
 static constexpr bool kCountJavaLangRefs = false;
 static constexpr bool kCountMarkedObjects = false;
+// Time the mark stack processing loops and report the objects scanned per second per marking
+// thread, to compare the loops with and without kUseMarkStackPrefetch.
+static constexpr bool kMeasureMarkStackThroughput = false;
 
 // Turn off kCheckLocks when profiling the GC since it slows the GC down by up to 40%.
 static constexpr bool kCheckLocks = kDebugLocking;
@@ -83,6 +106,21 @@ static constexpr bool kVerifyRootsMarked = kIsDebugBuild;
 // checkpoint, as opposed to during the pause.
 static constexpr bool kRevokeRosAllocThreadLocalBuffersAtCheckpoint = true;
 
+typedef BoundedFifoPowerOfTwo<Object*, kMarkStackPrefetchFifoSize> MarkStackPrefetchFifo;
+
+// Takes the next object to scan out of the prefetch FIFO. The header of the new front was
+// prefetched a few scans ago, so its class pointer is likely cached by now: prefetch the class as
+// well since VisitReferences starts by reading the reference offsets out of it.
+static inline Object* PopPrefetchedObject(MarkStackPrefetchFifo* fifo)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  Object* obj = fifo->front();
+  fifo->pop_front();
+  if (!fifo->empty()) {
+    __builtin_prefetch(fifo->front()->GetClass<kVerifyNone, kWithoutReadBarrier>());
+  }
+  return obj;
+}
+
 void MarkSweep::BindBitmaps() {
   timings_.StartSplit("BindBitmaps");
   WriterMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
@@ -102,7 +140,7 @@ MarkSweep::MarkSweep(Heap* heap, bool is_concurrent, const std::string& name_pre
       current_space_bitmap_(nullptr), mark_bitmap_(nullptr), mark_stack_(nullptr),
       gc_barrier_(new Barrier(0)),
       mark_stack_lock_("mark sweep mark stack lock", kMarkSweepMarkStackLock),
-      is_concurrent_(is_concurrent), live_stack_freeze_size_(0) {
+      is_concurrent_(is_concurrent), unload_classes_(false), live_stack_freeze_size_(0) {
   std::string error_msg;
   MemMap* mem_map = MemMap::MapAnonymous(
       "mark sweep sweep array free buffer", nullptr,
@@ -130,6 +168,11 @@ void MarkSweep::InitializePhase() {
   mark_immune_count_.StoreRelaxed(0);
   mark_fastpath_count_.StoreRelaxed(0);
   mark_slowpath_count_.StoreRelaxed(0);
+  mark_stack_scanned_objects_.StoreRelaxed(0);
+  mark_stack_scan_time_ns_.StoreRelaxed(0);
+  work_steals_ = 0;
+  failed_work_steals_ = 0;
+  steal_idle_time_ns_ = 0;
   {
     // TODO: I don't think we should need heap bitmap lock to Get the mark bitmap.
     ReaderMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
@@ -139,6 +182,8 @@ void MarkSweep::InitializePhase() {
     // Always clear soft references if a non-sticky collection.
     clear_soft_references_ = GetGcType() != collector::kGcTypeSticky;
   }
+  unload_classes_ = GetGcType() == collector::kGcTypeFull &&
+      Runtime::Current()->CanUnloadClasses();
 }
 
 void MarkSweep::RunPhases() {
@@ -192,6 +237,10 @@ void MarkSweep::PausePhase() {
     // Scan dirty objects, this is only required if we are not doing concurrent GC.
     RecursiveMarkDirtyObjects(true, accounting::CardTable::kCardDirty);
   }
+  if (unload_classes_) {
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    MarkClassesOfLiveClassLoaders(true);
+  }
   {
     TimingLogger::ScopedSplit split("SwapStacks", &timings_);
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
@@ -209,6 +258,10 @@ void MarkSweep::PausePhase() {
   // incorrectly sweep it. This also fixes a race where interning may attempt to return a strong
   // reference to a string that is about to be swept.
   Runtime::Current()->DisallowNewSystemWeaks();
+  // Same for the classes and dex caches, which are swept along with the system weaks.
+  if (unload_classes_) {
+    Runtime::Current()->GetClassLinker()->DisallowNewClasses();
+  }
   // Enable the reference processing slow path, needs to be done with mutators paused since there
   // is no lock in the GetReferent fast path.
   GetHeap()->GetReferenceProcessor()->EnableSlowPath();
@@ -220,7 +273,7 @@ void MarkSweep::PreCleanCards() {
     Thread* self = Thread::Current();
     CHECK(!Locks::mutator_lock_->IsExclusiveHeld(self));
     // Process dirty cards and add dirty cards to mod union tables, also ages cards.
-    heap_->ProcessCards(timings_, false);
+    heap_->ProcessCards(timings_, false, true);
     // The checkpoint root marking is required to avoid a race condition which occurs if the
     // following happens during a reference write:
     // 1. mutator dirties the card (write barrier)
@@ -235,8 +288,8 @@ void MarkSweep::PreCleanCards() {
     // The other roots are also marked to help reduce the pause.
     MarkRootsCheckpoint(self, false);
     MarkNonThreadRoots();
-    MarkConcurrentRoots(
-        static_cast<VisitRootFlags>(kVisitRootFlagClearRootLog | kVisitRootFlagNewRoots));
+    MarkConcurrentRoots(AddUnloadClassesFlag(
+        static_cast<VisitRootFlags>(kVisitRootFlagClearRootLog | kVisitRootFlagNewRoots)));
     // Process the newly aged cards.
     RecursiveMarkDirtyObjects(false, accounting::CardTable::kCardDirty - 1);
     // TODO: Empty allocation stack to reduce the number of objects we need to test / mark as live
@@ -260,16 +313,22 @@ void MarkSweep::MarkingPhase() {
   FindDefaultSpaceBitmap();
 
   // Process dirty cards and add dirty cards to mod union tables.
-  heap_->ProcessCards(timings_, false);
+  heap_->ProcessCards(timings_, false, true);
 
   WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
   MarkRoots(self);
   MarkReachableObjects();
+  if (unload_classes_ && IsConcurrent()) {
+    // Most of the classes are marked before the pause, which only marks the ones of the class
+    // loaders marked since.
+    MarkClassesOfLiveClassLoaders(false);
+  }
   // Pre-clean dirtied cards to reduce pauses.
   PreCleanCards();
 }
 
 void MarkSweep::UpdateAndMarkModUnion() {
+  const size_t thread_count = GetThreadCount(!IsConcurrent());
   for (const auto& space : heap_->GetContinuousSpaces()) {
     if (immune_region_.ContainsSpace(space)) {
       const char* name = space->IsZygoteSpace() ? "UpdateAndMarkZygoteModUnionTable" :
@@ -277,7 +336,11 @@ void MarkSweep::UpdateAndMarkModUnion() {
       TimingLogger::ScopedSplit split(name, &timings_);
       accounting::ModUnionTable* mod_union_table = heap_->FindModUnionTableFromSpace(space);
       CHECK(mod_union_table != nullptr);
-      mod_union_table->UpdateAndMarkReferences(MarkHeapReferenceCallback, this);
+      if (kParallelModUnion && thread_count > 1) {
+        UpdateAndMarkModUnionParallel(mod_union_table, thread_count);
+      } else {
+        mod_union_table->UpdateAndMarkReferences(MarkHeapReferenceCallback, this);
+      }
     }
   }
 }
@@ -294,7 +357,16 @@ void MarkSweep::ReclaimPhase() {
   // Process the references concurrently.
   ProcessReferences(self);
   SweepSystemWeaks(self);
+  const size_t unloaded_classes = unload_classes_ ? SweepClassLoaderClasses(self) : 0;
   Runtime::Current()->AllowNewSystemWeaks();
+  if (unload_classes_) {
+    Runtime::Current()->GetClassLinker()->AllowNewClasses();
+  }
+  if (unloaded_classes != 0) {
+    // The lock free class lookups may still be probing the removed classes, they are done once
+    // the mutators passed a suspend point. The classes are freed by the sweep.
+    RunEmptyCheckpoint(self);
+  }
   {
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
 
@@ -510,16 +582,19 @@ void MarkSweep::VerifyRoots() {
 void MarkSweep::MarkRoots(Thread* self) {
   if (Locks::mutator_lock_->IsExclusiveHeld(self)) {
     // If we exclusively hold the mutator lock, all threads must be suspended.
+    MarkThreadRoots(self);
     timings_.StartSplit("MarkRoots");
-    Runtime::Current()->VisitRoots(MarkRootCallback, this);
+    Runtime::Current()->VisitNonThreadRoots(MarkRootCallback, this);
+    Runtime::Current()->VisitConcurrentRoots(MarkRootCallback, this,
+                                             AddUnloadClassesFlag(kVisitRootFlagAllRoots));
     timings_.EndSplit();
     RevokeAllThreadLocalAllocationStacks(self);
   } else {
     MarkRootsCheckpoint(self, kRevokeRosAllocThreadLocalBuffersAtCheckpoint);
     // At this point the live stack should no longer have any mutators which push into it.
     MarkNonThreadRoots();
-    MarkConcurrentRoots(
-        static_cast<VisitRootFlags>(kVisitRootFlagAllRoots | kVisitRootFlagStartLoggingNewRoots));
+    MarkConcurrentRoots(AddUnloadClassesFlag(
+        static_cast<VisitRootFlags>(kVisitRootFlagAllRoots | kVisitRootFlagStartLoggingNewRoots)));
   }
 }
 
@@ -671,13 +746,13 @@ class MarkStackTask : public Task {
   virtual void Run(Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_) {
     ScanObjectParallelVisitor visitor(this);
-    // TODO: Tune this.
-    static const size_t kFifoSize = 4;
-    BoundedFifoPowerOfTwo<Object*, kFifoSize> prefetch_fifo;
+    const uint64_t start_time = kMeasureMarkStackThroughput ? NanoTime() : 0u;
+    size_t scanned = 0;
+    MarkStackPrefetchFifo prefetch_fifo;
     for (;;) {
       Object* obj = nullptr;
       if (kUseMarkStackPrefetch) {
-        while (mark_stack_pos_ != 0 && prefetch_fifo.size() < kFifoSize) {
+        while (mark_stack_pos_ != 0 && prefetch_fifo.size() < kMarkStackPrefetchFifoSize) {
           Object* obj = mark_stack_[--mark_stack_pos_];
           DCHECK(obj != nullptr);
           __builtin_prefetch(obj);
@@ -686,8 +761,7 @@ class MarkStackTask : public Task {
         if (UNLIKELY(prefetch_fifo.empty())) {
           break;
         }
-        obj = prefetch_fifo.front();
-        prefetch_fifo.pop_front();
+        obj = PopPrefetchedObject(&prefetch_fifo);
       } else {
         if (UNLIKELY(mark_stack_pos_ == 0)) {
           break;
@@ -696,6 +770,10 @@ class MarkStackTask : public Task {
       }
       DCHECK(obj != nullptr);
       visitor(obj);
+      ++scanned;
+    }
+    if (kMeasureMarkStackThroughput) {
+      mark_sweep_->RecordMarkStackThroughput(scanned, NanoTime() - start_time);
     }
   }
 };
@@ -734,6 +812,302 @@ class CardScanTask : public MarkStackTask<false> {
   }
 };
 
+// Updates a range of the work items of a mod-union table and marks the references of the items,
+// the objects newly marked are then scanned from the local mark stack of the task.
+class ModUnionScanTask : public MarkStackTask<false> {
+ public:
+  ModUnionScanTask(ThreadPool* thread_pool, MarkSweep* mark_sweep,
+                   accounting::ModUnionTable* mod_union_table, size_t begin, size_t end)
+      : MarkStackTask<false>(thread_pool, mark_sweep, 0, nullptr),
+        mod_union_table_(mod_union_table),
+        begin_(begin),
+        end_(end) {
+  }
+
+ protected:
+  accounting::ModUnionTable* const mod_union_table_;
+  const size_t begin_;
+  const size_t end_;
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+  static void MarkHeapReferenceCallback(mirror::HeapReference<mirror::Object>* ref, void* arg)
+      NO_THREAD_SAFETY_ANALYSIS {
+    ModUnionScanTask* task = reinterpret_cast<ModUnionScanTask*>(arg);
+    Object* obj = ref->AsMirrorPtr();
+    if (obj != nullptr && task->mark_sweep_->MarkObjectParallel(obj)) {
+      task->MarkStackPush(obj);
+    }
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    mod_union_table_->UpdateAndMarkReferences(begin_, end_, MarkHeapReferenceCallback, this);
+    // Finish by emptying our local mark stack.
+    MarkStackTask::Run(self);
+  }
+};
+
+// One marking task per GC thread for ProcessMarkStackParallel. Each task owns a work stealing
+// deque: newly marked objects are pushed to the bottom of the deque of the thread which marked
+// them and, once a task runs out of work, it steals from the top of the other deques. Unlike
+// MarkStackTask this never goes through the thread pool task queue once the marking started.
+class WorkStealingMarkTask : public Task {
+ public:
+  WorkStealingMarkTask(MarkSweep* mark_sweep, std::vector<WorkStealingMarkTask*>* tasks,
+                       size_t index, AtomicInteger* idle_count)
+      : mark_sweep_(mark_sweep),
+        tasks_(tasks),
+        index_(index),
+        idle_count_(idle_count),
+        random_state_(static_cast<uint32_t>(index) * 2654435761U + 1),
+        steals_(0),
+        failed_steals_(0),
+        idle_time_ns_(0) {
+  }
+
+  // Only called by the thread creating the tasks before the workers are started.
+  void Seed(Object* obj) {
+    deque_.Push(obj);
+  }
+
+  bool HasWork() const {
+    return !deque_.IsEmpty();
+  }
+
+  uint64_t GetSteals() const {
+    return steals_;
+  }
+
+  uint64_t GetFailedSteals() const {
+    return failed_steals_;
+  }
+
+  uint64_t GetIdleTimeNs() const {
+    return idle_time_ns_;
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    const int32_t num_tasks = static_cast<int32_t>(tasks_->size());
+    for (;;) {
+      ProcessDeque();
+      if (TrySteal()) {
+        continue;
+      }
+      // Out of work, we are done once every other task is idle too. An idle task has an empty
+      // deque and only the owner pushes onto its deque, so all the deques are empty at that point.
+      const uint64_t idle_start = NanoTime();
+      idle_count_->FetchAndAddSequentiallyConsistent(1);
+      bool done = false;
+      while (!done) {
+        if (idle_count_->LoadSequentiallyConsistent() == num_tasks) {
+          done = true;
+        } else if (AnyTaskHasWork()) {
+          idle_count_->FetchAndSubSequentiallyConsistent(1);
+          break;
+        } else {
+          sched_yield();
+        }
+      }
+      idle_time_ns_ += NanoTime() - idle_start;
+      if (done) {
+        break;
+      }
+    }
+  }
+
+ private:
+  class MarkObjectParallelVisitor {
+   public:
+    explicit MarkObjectParallelVisitor(WorkStealingMarkTask* task) ALWAYS_INLINE
+        : task_(task) {}
+
+    void operator()(Object* obj, MemberOffset offset, bool /* static */) const ALWAYS_INLINE
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+      mirror::Object* ref = obj->GetFieldObject<mirror::Object>(offset);
+      if (ref != nullptr && task_->mark_sweep_->MarkObjectParallel(ref)) {
+        task_->deque_.Push(ref);
+      }
+    }
+
+   private:
+    WorkStealingMarkTask* const task_;
+  };
+
+  // A slice of kObjectArraySliceLength elements of a large object array goes on the deques as the
+  // address of its first element tagged in the low bit, which is never set in an object pointer.
+  static constexpr uintptr_t kSliceTag = 1;
+
+  static Object* EncodeSlice(mirror::HeapReference<Object>* first_element) {
+    return reinterpret_cast<Object*>(reinterpret_cast<uintptr_t>(first_element) | kSliceTag);
+  }
+
+  static bool IsSlice(Object* item) {
+    return (reinterpret_cast<uintptr_t>(item) & kSliceTag) != 0;
+  }
+
+  static mirror::HeapReference<Object>* DecodeSlice(Object* item) {
+    DCHECK(IsSlice(item));
+    return reinterpret_cast<mirror::HeapReference<Object>*>(
+        reinterpret_cast<uintptr_t>(item) & ~kSliceTag);
+  }
+
+  void MarkElements(mirror::HeapReference<Object>* elements, size_t count)
+      NO_THREAD_SAFETY_ANALYSIS {
+    for (size_t i = 0; i < count; ++i) {
+      Object* ref = elements[i].AsMirrorPtr();
+      if (ref != nullptr && mark_sweep_->MarkObjectParallel(ref)) {
+        deque_.Push(ref);
+      }
+    }
+  }
+
+  // Pushes the whole slices of an object array of at least two slices and marks the remaining
+  // elements, returns false if obj isn't such an array.
+  bool SliceLargeObjectArray(Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+    if (!obj->GetClass<kVerifyNone>()->IsObjectArrayClass<kVerifyNone>()) {
+      return false;
+    }
+    ObjectArray<Object>* array = obj->AsObjectArray<Object, kVerifyNone>();
+    const size_t length = static_cast<size_t>(array->GetLength());
+    if (length < 2 * kObjectArraySliceLength) {
+      return false;
+    }
+    mirror::HeapReference<Object>* elements = reinterpret_cast<mirror::HeapReference<Object>*>(
+        reinterpret_cast<byte*>(array) + ObjectArray<Object>::OffsetOfElement(0).Uint32Value());
+    const size_t sliced_length = RoundDown(length, kObjectArraySliceLength);
+    for (size_t i = 0; i < sliced_length; i += kObjectArraySliceLength) {
+      deque_.Push(EncodeSlice(elements + i));
+    }
+    MarkElements(elements + sliced_length, length - sliced_length);
+    return true;
+  }
+
+  void Scan(Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+    if (kSliceLargeObjectArrays) {
+      if (IsSlice(obj)) {
+        MarkElements(DecodeSlice(obj), kObjectArraySliceLength);
+        return;
+      }
+      if (SliceLargeObjectArray(obj)) {
+        return;
+      }
+    }
+    MarkObjectParallelVisitor mark_visitor(this);
+    DelayReferenceReferentVisitor ref_visitor(mark_sweep_);
+    mark_sweep_->ScanObjectVisit(obj, mark_visitor, ref_visitor);
+  }
+
+  // The objects sitting in the prefetch FIFO can't be stolen, which is fine since there are only a
+  // few of them and the deque is refilled as they get scanned.
+  void ProcessDeque() {
+    const uint64_t start_time = kMeasureMarkStackThroughput ? NanoTime() : 0u;
+    size_t scanned = 0;
+    Object* obj;
+    if (kUseMarkStackPrefetch) {
+      MarkStackPrefetchFifo prefetch_fifo;
+      for (;;) {
+        while (prefetch_fifo.size() < kMarkStackPrefetchFifoSize && deque_.Pop(&obj)) {
+          DCHECK(obj != nullptr);
+          if (kSliceLargeObjectArrays && IsSlice(obj)) {
+            // Slices have no header to prefetch, the elements are read sequentially.
+            Scan(obj);
+            ++scanned;
+            continue;
+          }
+          __builtin_prefetch(obj);
+          prefetch_fifo.push_back(obj);
+        }
+        if (prefetch_fifo.empty()) {
+          break;
+        }
+        Scan(PopPrefetchedObject(&prefetch_fifo));
+        ++scanned;
+      }
+    } else {
+      while (deque_.Pop(&obj)) {
+        DCHECK(obj != nullptr);
+        Scan(obj);
+        ++scanned;
+      }
+    }
+    if (kMeasureMarkStackThroughput && scanned != 0) {
+      mark_sweep_->RecordMarkStackThroughput(scanned, NanoTime() - start_time);
+    }
+  }
+
+  // Try to steal one object from each of the other tasks, starting at a random victim so that the
+  // thieves don't all hit the same deque.
+  bool TrySteal() {
+    const size_t num_tasks = tasks_->size();
+    const size_t start = NextRandom() % num_tasks;
+    for (size_t i = 0; i < num_tasks; ++i) {
+      const size_t victim = (start + i) % num_tasks;
+      if (victim == index_) {
+        continue;
+      }
+      Object* obj;
+      if ((*tasks_)[victim]->deque_.Steal(&obj)) {
+        ++steals_;
+        Scan(obj);
+        return true;
+      }
+      ++failed_steals_;
+    }
+    return false;
+  }
+
+  bool AnyTaskHasWork() const {
+    for (WorkStealingMarkTask* task : *tasks_) {
+      if (task->HasWork()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint32_t NextRandom() {
+    // Xorshift, good enough to spread the victims.
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 17;
+    random_state_ ^= random_state_ << 5;
+    return random_state_;
+  }
+
+  MarkSweep* const mark_sweep_;
+  std::vector<WorkStealingMarkTask*>* const tasks_;
+  const size_t index_;
+  // Number of tasks which ran out of work, shared by all of the tasks.
+  AtomicInteger* const idle_count_;
+  WorkStealingDeque<Object*> deque_;
+  uint32_t random_state_;
+  uint64_t steals_;
+  uint64_t failed_steals_;
+  uint64_t idle_time_ns_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingMarkTask);
+};
+
+void MarkSweep::UpdateAndMarkModUnionParallel(accounting::ModUnionTable* mod_union_table,
+                                              size_t thread_count) {
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  const size_t num_items = mod_union_table->PrepareParallelUpdate();
+  // A few tasks per thread since the work items differ in size, most of the cleared cards of an
+  // image space have no object with a reference to the alloc spaces.
+  const size_t item_delta = num_items / (thread_count * 4) + 1;
+  for (size_t begin = 0; begin < num_items; begin += item_delta) {
+    thread_pool->AddTask(self, new ModUnionScanTask(thread_pool, this, mod_union_table, begin,
+                                                    std::min(begin + item_delta, num_items)));
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  mod_union_table->FinishParallelUpdate();
+}
+
 size_t MarkSweep::GetThreadCount(bool paused) const {
   if (heap_->GetThreadPool() == nullptr || !heap_->CareAboutPauseTimes()) {
     return 1;
@@ -932,16 +1306,21 @@ void MarkSweep::RecursiveMarkDirtyObjects(bool paused, byte minimum_age) {
 }
 
 void MarkSweep::ReMarkRoots() {
-  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  Thread* self = Thread::Current();
+  Locks::mutator_lock_->AssertExclusiveHeld(self);
+  // The stacks have no write barrier, all of them are scanned again.
+  MarkThreadRoots(self);
   timings_.StartSplit("(Paused)ReMarkRoots");
-  Runtime::Current()->VisitRoots(
-      MarkRootCallback, this, static_cast<VisitRootFlags>(kVisitRootFlagNewRoots |
-                                                          kVisitRootFlagStopLoggingNewRoots |
-                                                          kVisitRootFlagClearRootLog));
+  Runtime::Current()->VisitNonThreadRoots(MarkRootCallback, this);
+  Runtime::Current()->VisitConcurrentRoots(
+      MarkRootCallback, this, AddUnloadClassesFlag(
+          static_cast<VisitRootFlags>(kVisitRootFlagNewRoots | kVisitRootFlagStopLoggingNewRoots |
+                                      kVisitRootFlagClearRootLog)));
   timings_.EndSplit();
   if (kVerifyRootsMarked) {
     timings_.StartSplit("(Paused)VerifyRoots");
-    Runtime::Current()->VisitRoots(VerifyRootMarked, this);
+    Runtime::Current()->VisitRoots(VerifyRootMarked, this,
+                                   AddUnloadClassesFlag(kVisitRootFlagAllRoots));
     timings_.EndSplit();
   }
 }
@@ -953,6 +1332,53 @@ void MarkSweep::SweepSystemWeaks(Thread* self) {
   timings_.EndSplit();
 }
 
+void MarkSweep::MarkClassesOfLiveClassLoaders(bool paused) {
+  TimingLogger::ScopedSplit split(paused ? "(Paused)MarkClassesOfLiveClassLoaders" :
+      "MarkClassesOfLiveClassLoaders", &timings_);
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  // The marked classes may reference more class loaders.
+  while (class_linker->MarkClassesOfMarkedClassLoaders(&IsMarkedCallback, &MarkObjectCallback,
+                                                       this) != 0) {
+    ProcessMarkStack(paused);
+  }
+}
+
+size_t MarkSweep::SweepClassLoaderClasses(Thread* self) {
+  WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+  TimingLogger::ScopedSplit split("SweepClassLoaderClasses", &timings_);
+  size_t unloaded_classes =
+      Runtime::Current()->GetClassLinker()->SweepClassLoaderClasses(&IsMarkedCallback, this);
+  VLOG(gc) << "Unloaded " << unloaded_classes << " classes";
+  return unloaded_classes;
+}
+
+class EmptyCheckpoint : public Closure {
+ public:
+  explicit EmptyCheckpoint(MarkSweep* mark_sweep) : mark_sweep_(mark_sweep) {
+  }
+
+  virtual void Run(Thread* thread) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    UNUSED(thread);
+    // Note: self is not necessarily equal to thread since thread may be suspended.
+    mark_sweep_->GetBarrier().Pass(Thread::Current());
+  }
+
+ private:
+  MarkSweep* const mark_sweep_;
+};
+
+void MarkSweep::RunEmptyCheckpoint(Thread* self) {
+  TimingLogger::ScopedSplit split("RunEmptyCheckpoint", &timings_);
+  EmptyCheckpoint check_point(this);
+  size_t barrier_count = Runtime::Current()->GetThreadList()->RunCheckpoint(&check_point);
+  Locks::mutator_lock_->SharedUnlock(self);
+  {
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    gc_barrier_->Increment(self, barrier_count);
+  }
+  Locks::mutator_lock_->SharedLock(self);
+}
+
 mirror::Object* MarkSweep::VerifySystemWeakIsLiveCallback(Object* obj, void* arg) {
   reinterpret_cast<MarkSweep*>(arg)->VerifyIsLive(obj);
   // We don't actually want to sweep the object, so lets return "marked"
@@ -1026,6 +1452,67 @@ void MarkSweep::MarkRootsCheckpoint(Thread* self,
   timings_.EndSplit();
 }
 
+// Marks the roots of the threads of the list with the next unclaimed index, one of these tasks
+// runs on each GC thread while the mutators are suspended.
+class MarkThreadRootsTask : public Task {
+ public:
+  MarkThreadRootsTask(MarkSweep* mark_sweep, const std::vector<Thread*>* threads,
+                      AtomicInteger* next_thread)
+      : mark_sweep_(mark_sweep), threads_(threads), next_thread_(next_thread) {
+  }
+
+  virtual void Run(Thread* self) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    UNUSED(self);
+    for (;;) {
+      const size_t index = next_thread_->FetchAndAddSequentiallyConsistent(1);
+      if (index >= threads_->size()) {
+        break;
+      }
+      (*threads_)[index]->VisitRoots(MarkSweep::MarkRootParallelCallback, mark_sweep_);
+    }
+  }
+
+  virtual void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  MarkSweep* const mark_sweep_;
+  const std::vector<Thread*>* const threads_;
+  AtomicInteger* const next_thread_;
+};
+
+void MarkSweep::MarkThreadRoots(Thread* self) {
+  Locks::mutator_lock_->AssertExclusiveHeld(self);
+  timings_.StartSplit("(Paused)MarkThreadRoots");
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  // Holding the lock keeps the threads from exiting while the GC threads visit their roots.
+  MutexLock mu(self, *Locks::thread_list_lock_);
+  std::list<Thread*> thread_list_copy = thread_list->GetList();
+  const std::vector<Thread*> threads(thread_list_copy.begin(), thread_list_copy.end());
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  const size_t thread_count = GetThreadCount(true);
+  if (!kParallelThreadRoots || thread_count <= 1 || threads.size() < kMinimumParallelThreadRoots) {
+    for (Thread* thread : threads) {
+      thread->VisitRoots(MarkRootCallback, this);
+    }
+    timings_.EndSplit();
+    return;
+  }
+  // The GC threads claim the threads one at a time, a thread with a deep stack doesn't hold up the
+  // others. This thread runs one of the tasks itself.
+  const size_t num_tasks = std::min(thread_count, threads.size());
+  AtomicInteger next_thread(0);
+  for (size_t i = 0; i < num_tasks; ++i) {
+    thread_pool->AddTask(self, new MarkThreadRootsTask(this, &threads, &next_thread));
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  timings_.EndSplit();
+}
+
 void MarkSweep::SweepArray(accounting::ObjectStack* allocations, bool swap_bitmaps) {
   timings_.StartSplit("SweepArray");
   Thread* self = Thread::Current();
@@ -1135,6 +1622,76 @@ void MarkSweep::SweepArray(accounting::ObjectStack* allocations, bool swap_bitma
   DCHECK_EQ(success, 0) << "Failed to madvise the sweep array free buffer pages.";
 }
 
+// Sweeps a range of a RosAlloc space, or the large object space when the space is null, on a GC
+// worker. The ranges of a space are split at run boundaries so that the bulk frees of the tasks
+// free the slots of different runs.
+class SweepTask : public Task {
+ public:
+  SweepTask(space::ContinuousMemMapAllocSpace* space, bool swap_bitmaps, uintptr_t begin,
+            uintptr_t end, Atomic<size_t>* freed_objects, Atomic<size_t>* freed_bytes)
+      : space_(space),
+        swap_bitmaps_(swap_bitmaps),
+        begin_(begin),
+        end_(end),
+        freed_objects_(freed_objects),
+        freed_bytes_(freed_bytes) {
+  }
+
+ private:
+  space::ContinuousMemMapAllocSpace* const space_;
+  const bool swap_bitmaps_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  Atomic<size_t>* const freed_objects_;
+  Atomic<size_t>* const freed_bytes_;
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+  // The GC thread holds the heap bitmap lock for the tasks.
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    UNUSED(self);
+    size_t freed_objects = 0;
+    size_t freed_bytes = 0;
+    if (space_ != nullptr) {
+      space_->SweepRange(swap_bitmaps_, begin_, end_, true, &freed_objects, &freed_bytes);
+    } else {
+      Runtime::Current()->GetHeap()->GetLargeObjectsSpace()->Sweep(swap_bitmaps_, &freed_objects,
+                                                                   &freed_bytes, true);
+    }
+    freed_objects_->FetchAndAddSequentiallyConsistent(freed_objects);
+    freed_bytes_->FetchAndAddSequentiallyConsistent(freed_bytes);
+  }
+};
+
+size_t MarkSweep::AddSweepTasks(space::RosAllocSpace* space, bool swap_bitmaps,
+                                size_t thread_count, Atomic<size_t>* freed_objects,
+                                Atomic<size_t>* freed_bytes) {
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  allocator::RosAlloc* rosalloc = space->GetRosAlloc();
+  // A few ranges per thread since the garbage isn't spread evenly over the space.
+  const size_t range_size = std::max(RoundUp(space->Size() / (thread_count * 4), kPageSize),
+                                     kMinimumParallelSweepSize);
+  byte* const end = space->End();
+  byte* begin = space->Begin();
+  size_t num_tasks = 0;
+  while (begin < end) {
+    byte* range_end = end;
+    if (static_cast<size_t>(end - begin) > range_size) {
+      range_end = std::min(rosalloc->RoundUpToRunBoundary(begin + range_size), end);
+    }
+    thread_pool->AddTask(self, new SweepTask(space, swap_bitmaps,
+                                             reinterpret_cast<uintptr_t>(begin),
+                                             reinterpret_cast<uintptr_t>(range_end),
+                                             freed_objects, freed_bytes));
+    ++num_tasks;
+    begin = range_end;
+  }
+  return num_tasks;
+}
+
 void MarkSweep::Sweep(bool swap_bitmaps) {
   // Ensure that nobody inserted items in the live stack after we swapped the stacks.
   CHECK_GE(live_stack_freeze_size_, GetHeap()->GetLiveStack()->Size());
@@ -1147,18 +1704,55 @@ void MarkSweep::Sweep(bool swap_bitmaps) {
   timings_.EndSplit();
 
   DCHECK(mark_stack_->IsEmpty());
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  const size_t thread_count = GetThreadCount(false);
+  Atomic<size_t> freed_objects(0);
+  Atomic<size_t> freed_bytes(0);
+  size_t num_tasks = 0;
+  std::vector<space::ContinuousSpace*> parallel_spaces;
+  if (kParallelSweep && thread_count > 1) {
+    // The RosAlloc spaces are swept by the GC workers, the other spaces by the GC thread meanwhile.
+    for (const auto& space : GetHeap()->GetContinuousSpaces()) {
+      if (space->IsRosAllocSpace() && space->Size() >= kMinimumParallelSweepSize) {
+        num_tasks += AddSweepTasks(space->AsRosAllocSpace(), swap_bitmaps, thread_count,
+                                   &freed_objects, &freed_bytes);
+        parallel_spaces.push_back(space);
+      }
+    }
+  }
+  Atomic<size_t> freed_large_objects(0);
+  Atomic<size_t> freed_large_object_bytes(0);
+  if (num_tasks != 0) {
+    // The large objects are freed under the lock of their space, they are swept by one task.
+    thread_pool->AddTask(self, new SweepTask(nullptr, swap_bitmaps, 0, 0, &freed_large_objects,
+                                             &freed_large_object_bytes));
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+  }
   for (const auto& space : GetHeap()->GetContinuousSpaces()) {
-    if (space->IsContinuousMemMapAllocSpace()) {
+    if (space->IsContinuousMemMapAllocSpace() &&
+        std::find(parallel_spaces.begin(), parallel_spaces.end(), space) ==
+            parallel_spaces.end()) {
       space::ContinuousMemMapAllocSpace* alloc_space = space->AsContinuousMemMapAllocSpace();
       TimingLogger::ScopedSplit split(
           alloc_space->IsZygoteSpace() ? "SweepZygoteSpace" : "SweepMallocSpace", &timings_);
-      size_t freed_objects = 0;
-      size_t freed_bytes = 0;
-      alloc_space->Sweep(swap_bitmaps, &freed_objects, &freed_bytes);
-      RecordFree(freed_objects, freed_bytes);
+      size_t space_freed_objects = 0;
+      size_t space_freed_bytes = 0;
+      alloc_space->Sweep(swap_bitmaps, &space_freed_objects, &space_freed_bytes);
+      RecordFree(space_freed_objects, space_freed_bytes);
     }
   }
-  SweepLargeObjects(swap_bitmaps);
+  if (num_tasks == 0) {
+    SweepLargeObjects(swap_bitmaps);
+    return;
+  }
+  TimingLogger::ScopedSplit split("SweepParallel", &timings_);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  RecordFree(freed_objects.LoadRelaxed(), freed_bytes.LoadRelaxed());
+  RecordFreeLargeObjects(freed_large_objects.LoadRelaxed(),
+                         freed_large_object_bytes.LoadRelaxed());
 }
 
 void MarkSweep::SweepLargeObjects(bool swap_bitmaps) {
@@ -1213,23 +1807,36 @@ void MarkSweep::ProcessMarkStackCallback(void* arg) {
 void MarkSweep::ProcessMarkStackParallel(size_t thread_count) {
   Thread* self = Thread::Current();
   ThreadPool* thread_pool = GetHeap()->GetThreadPool();
-  const size_t chunk_size = std::min(mark_stack_->Size() / thread_count + 1,
-                                     static_cast<size_t>(MarkStackTask<false>::kMaxSize));
-  CHECK_GT(chunk_size, 0U);
-  // Split the current mark stack up into work tasks.
-  for (mirror::Object **it = mark_stack_->Begin(), **end = mark_stack_->End(); it < end; ) {
-    const size_t delta = std::min(static_cast<size_t>(end - it), chunk_size);
-    thread_pool->AddTask(self, new MarkStackTask<false>(thread_pool, this, delta, it));
-    it += delta;
+  // Every task must run on its own thread since a task only returns once all of the tasks are out
+  // of work. The thread pool workers each take one task and this thread takes the last one.
+  const size_t num_tasks = std::min(thread_count, thread_pool->GetThreadCount() + 1);
+  CHECK_GT(num_tasks, 1U);
+  AtomicInteger idle_count(0);
+  std::vector<WorkStealingMarkTask*> tasks;
+  for (size_t i = 0; i < num_tasks; ++i) {
+    tasks.push_back(new WorkStealingMarkTask(this, &tasks, i, &idle_count));
+  }
+  // Deal the current mark stack out to the tasks.
+  size_t index = 0;
+  for (mirror::Object **it = mark_stack_->Begin(), **end = mark_stack_->End(); it < end; ++it) {
+    tasks[index]->Seed(*it);
+    index = (index + 1) % num_tasks;
   }
-  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  mark_stack_->Reset();
+  for (WorkStealingMarkTask* task : tasks) {
+    thread_pool->AddTask(self, task);
+  }
+  thread_pool->SetMaxActiveWorkers(num_tasks - 1);
   thread_pool->StartWorkers(self);
   thread_pool->Wait(self, true, true);
   thread_pool->StopWorkers(self);
-  mark_stack_->Reset();
-  CHECK_EQ(work_chunks_created_.LoadSequentiallyConsistent(),
-           work_chunks_deleted_.LoadSequentiallyConsistent())
-      << " some of the work chunks were leaked";
+  for (WorkStealingMarkTask* task : tasks) {
+    DCHECK(!task->HasWork());
+    work_steals_ += task->GetSteals();
+    failed_work_steals_ += task->GetFailedSteals();
+    steal_idle_time_ns_ += task->GetIdleTimeNs();
+    delete task;
+  }
 }
 
 // Scan anything that's on the mark stack.
@@ -1240,13 +1847,13 @@ void MarkSweep::ProcessMarkStack(bool paused) {
       mark_stack_->Size() >= kMinimumParallelMarkStackSize) {
     ProcessMarkStackParallel(thread_count);
   } else {
-    // TODO: Tune this.
-    static const size_t kFifoSize = 4;
-    BoundedFifoPowerOfTwo<Object*, kFifoSize> prefetch_fifo;
+    const uint64_t start_time = kMeasureMarkStackThroughput ? NanoTime() : 0u;
+    size_t scanned = 0;
+    MarkStackPrefetchFifo prefetch_fifo;
     for (;;) {
       Object* obj = NULL;
       if (kUseMarkStackPrefetch) {
-        while (!mark_stack_->IsEmpty() && prefetch_fifo.size() < kFifoSize) {
+        while (!mark_stack_->IsEmpty() && prefetch_fifo.size() < kMarkStackPrefetchFifoSize) {
           Object* obj = mark_stack_->PopBack();
           DCHECK(obj != NULL);
           __builtin_prefetch(obj);
@@ -1255,8 +1862,7 @@ void MarkSweep::ProcessMarkStack(bool paused) {
         if (prefetch_fifo.empty()) {
           break;
         }
-        obj = prefetch_fifo.front();
-        prefetch_fifo.pop_front();
+        obj = PopPrefetchedObject(&prefetch_fifo);
       } else {
         if (mark_stack_->IsEmpty()) {
           break;
@@ -1265,11 +1871,20 @@ void MarkSweep::ProcessMarkStack(bool paused) {
       }
       DCHECK(obj != nullptr);
       ScanObject(obj);
+      ++scanned;
+    }
+    if (kMeasureMarkStackThroughput) {
+      RecordMarkStackThroughput(scanned, NanoTime() - start_time);
     }
   }
   timings_.EndSplit();
 }
 
+void MarkSweep::RecordMarkStackThroughput(size_t scanned_objects, uint64_t time_ns) {
+  mark_stack_scanned_objects_.FetchAndAddSequentiallyConsistent(scanned_objects);
+  mark_stack_scan_time_ns_.FetchAndAddSequentiallyConsistent(time_ns);
+}
+
 inline bool MarkSweep::IsMarked(const Object* object) const
     SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_) {
   if (immune_region_.ContainsObject(object)) {
@@ -1306,6 +1921,18 @@ void MarkSweep::FinishPhase() {
         << " fastpath=" << mark_fastpath_count_.LoadRelaxed()
         << " slowpath=" << mark_slowpath_count_.LoadRelaxed();
   }
+  if (kMeasureMarkStackThroughput) {
+    const uint64_t scanned = mark_stack_scanned_objects_.LoadRelaxed();
+    const uint64_t time_ns = mark_stack_scan_time_ns_.LoadRelaxed();
+    VLOG(gc) << "Mark stack " << (kUseMarkStackPrefetch ? "with" : "without") << " prefetch: "
+        << scanned << " objects scanned in " << PrettyDuration(time_ns) << " of thread time, "
+        << (time_ns != 0 ? scanned * 1000000000 / time_ns : 0) << " objects/s per thread";
+  }
+  if (work_steals_ != 0 || steal_idle_time_ns_ != 0) {
+    VLOG(gc) << "Parallel marking steals=" << work_steals_
+        << " failed steals=" << failed_work_steals_
+        << " idle time=" << PrettyDuration(steal_idle_time_ns_);
+  }
   CHECK(mark_stack_->IsEmpty());  // Ensure that the mark stack is empty.
   mark_stack_->Reset();
   WriterMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
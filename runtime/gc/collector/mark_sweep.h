@@ -46,9 +46,14 @@ class Heap;
 
 namespace accounting {
   template<typename T> class AtomicStack;
+  class ModUnionTable;
   typedef AtomicStack<mirror::Object*> ObjectStack;
 }  // namespace accounting
 
+namespace space {
+  class RosAllocSpace;
+}  // namespace space
+
 namespace collector {
 
 class MarkSweep : public GarbageCollector {
@@ -102,6 +107,10 @@ class MarkSweep : public GarbageCollector {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Marks the roots of every thread while the mutators are suspended, spread over the GC threads.
+  void MarkThreadRoots(Thread* self)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_);
+
   // Builds a mark stack and recursively mark until it empties.
   void RecursiveMark()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
@@ -140,6 +149,11 @@ class MarkSweep : public GarbageCollector {
   // Sweeps unmarked objects to complete the garbage collection.
   void SweepLargeObjects(bool swap_bitmaps) EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
+  // Adds the tasks sweeping the ranges of a RosAlloc space in parallel, returns their number.
+  size_t AddSweepTasks(space::RosAllocSpace* space, bool swap_bitmaps, size_t thread_count,
+                       Atomic<size_t>* freed_objects, Atomic<size_t>* freed_bytes)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+
   // Sweep only pointers within an array. WARNING: Trashes objects.
   void SweepArray(accounting::ObjectStack* allocation_stack_, bool swap_bitmaps)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
@@ -160,6 +174,25 @@ class MarkSweep : public GarbageCollector {
   void SweepSystemWeaks(Thread* self)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
 
+  // Marks the classes of the marked class loaders and what they reference, until no more class
+  // loaders get marked. Only when unloading classes, whose roots are then the boot classes.
+  void MarkClassesOfLiveClassLoaders(bool paused)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Removes the unmarked classes and dex caches from the class linker, returns the number of
+  // classes removed.
+  size_t SweepClassLoaderClasses(Thread* self)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
+
+  // Waits until every mutator passed a suspend point.
+  void RunEmptyCheckpoint(Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  VisitRootFlags AddUnloadClassesFlag(VisitRootFlags flags) const {
+    return unload_classes_ ? static_cast<VisitRootFlags>(flags | kVisitRootFlagUnloadClasses)
+                           : flags;
+  }
+
   static mirror::Object* VerifySystemWeakIsLiveCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
@@ -265,6 +298,12 @@ class MarkSweep : public GarbageCollector {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Updates the mod-union table and marks its references with the GC thread pool.
+  void UpdateAndMarkModUnionParallel(accounting::ModUnionTable* mod_union_table,
+                                     size_t thread_count)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Used to Get around thread safety annotations. The call is from MarkingPhase and is guarded by
   // IsExclusiveHeld.
   void RevokeAllThreadLocalAllocationStacks(Thread* self) NO_THREAD_SAFETY_ANALYSIS;
@@ -272,6 +311,10 @@ class MarkSweep : public GarbageCollector {
   // Revoke all the thread-local buffers.
   void RevokeAllThreadLocalBuffers();
 
+  // Adds the objects scanned by one mark stack processing loop and the time the loop took, if
+  // kMeasureMarkStackThroughput.
+  void RecordMarkStackThroughput(size_t scanned_objects, uint64_t time_ns);
+
   // Whether or not we count how many of each type of object were scanned.
   static const bool kCountScannedTypes = false;
 
@@ -304,12 +347,25 @@ class MarkSweep : public GarbageCollector {
   AtomicInteger mark_immune_count_;
   AtomicInteger mark_fastpath_count_;
   AtomicInteger mark_slowpath_count_;
+  // Objects scanned by the mark stack processing loops and the time summed over the marking
+  // threads, if kMeasureMarkStackThroughput.
+  Atomic<uint64_t> mark_stack_scanned_objects_;
+  Atomic<uint64_t> mark_stack_scan_time_ns_;
+  // Work stealing statistics of ProcessMarkStackParallel for the current GC, only updated by the
+  // GC thread once the marking tasks are done: successful and failed steals, and the total time the
+  // marking threads spent out of work.
+  uint64_t work_steals_;
+  uint64_t failed_work_steals_;
+  uint64_t steal_idle_time_ns_;
 
   std::unique_ptr<Barrier> gc_barrier_;
   Mutex mark_stack_lock_ ACQUIRED_AFTER(Locks::classlinker_classes_lock_);
 
   const bool is_concurrent_;
 
+  // Whether this GC unloads the classes of the unreachable class loaders, only full GCs do.
+  bool unload_classes_;
+
   // Verification.
   size_t live_stack_freeze_size_;
 
@@ -329,7 +385,9 @@ class MarkSweep : public GarbageCollector {
   friend class ModUnionTableBitmap;
   friend class ModUnionTableReferenceCache;
   friend class ModUnionScanImageRootVisitor;
+  friend class ModUnionScanTask;
   template<bool kUseFinger> friend class MarkStackTask;
+  friend class WorkStealingMarkTask;
   friend class FifoMarkStackChunk;
   friend class MarkSweepMarkObjectSlowPath;
 
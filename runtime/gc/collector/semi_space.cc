@@ -16,6 +16,7 @@
 
 #include "semi_space-inl.h"
 
+#include <algorithm>
 #include <functional>
 #include <numeric>
 #include <climits>
@@ -25,6 +26,7 @@
 #include "base/macros.h"
 #include "base/mutex-inl.h"
 #include "base/timing_logger.h"
+#include "base/work_stealing_deque.h"
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/mod_union_table.h"
 #include "gc/accounting/remembered_set.h"
@@ -43,6 +45,7 @@
 #include "monitor.h"
 #include "mirror/art_field.h"
 #include "mirror/art_field-inl.h"
+#include "mirror/array-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/class_loader.h"
 #include "mirror/dex_cache.h"
@@ -54,6 +57,7 @@
 #include "stack.h"
 #include "thread-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "verifier/method_verifier.h"
 
 using ::art::mirror::Class;
@@ -108,7 +112,10 @@ SemiSpace::SemiSpace(Heap* heap, bool generational, const std::string& name_pref
       large_object_bytes_allocated_at_last_whole_heap_collection_(0),
       whole_heap_collection_(true),
       collector_name_(name_),
-      swap_semi_spaces_(true) {
+      swap_semi_spaces_(true),
+      collect_from_space_only_(false),
+      promote_all_objects_(false),
+      parallel_copying_(true) {
 }
 
 void SemiSpace::RunPhases() {
@@ -192,6 +199,10 @@ void SemiSpace::MarkingPhase() {
       // collection, collect the whole heap.
       whole_heap_collection_ = true;
     }
+    if (collect_from_space_only_) {
+      // The whole heap is collected by the concurrent mark sweep of the heap.
+      whole_heap_collection_ = false;
+    }
     if (whole_heap_collection_) {
       VLOG(heap) << "Whole heap collection";
       name_ = collector_name_ + " whole";
@@ -221,7 +232,10 @@ void SemiSpace::MarkingPhase() {
     // (the to-space from last GC), then point it to the beginning of
     // the from-space. For example, the very first GC or the
     // pre-zygote compaction.
-    if (!from_space_->HasAddress(reinterpret_cast<mirror::Object*>(last_gc_to_space_end_))) {
+    if (promote_all_objects_) {
+      // Every object of the from-space is older than the end of the from-space.
+      last_gc_to_space_end_ = from_space_->End();
+    } else if (!from_space_->HasAddress(reinterpret_cast<mirror::Object*>(last_gc_to_space_end_))) {
       last_gc_to_space_end_ = from_space_->Begin();
     }
     // Reset this before the marking starts below.
@@ -229,8 +243,10 @@ void SemiSpace::MarkingPhase() {
   }
   // Assume the cleared space is already empty.
   BindBitmaps();
-  // Process dirty cards and add dirty cards to mod-union tables.
-  heap_->ProcessCards(timings_, kUseRememberedSet && generational_);
+  // Process dirty cards and add dirty cards to mod-union tables. Only the bump pointer space only
+  // collections leave the objects of the spaces with remembered sets alone.
+  heap_->ProcessCards(timings_, kUseRememberedSet && generational_,
+                      !generational_ || whole_heap_collection_);
   // Clear the whole card table since we can not Get any additional dirty cards during the
   // paused GC. This saves memory but only works for pause the world collectors.
   timings_.NewSplit("ClearCardTable");
@@ -731,6 +747,13 @@ void SemiSpace::ScanObject(Object* obj) {
 
 // Scan anything that's on the mark stack.
 void SemiSpace::ProcessMarkStack() {
+  const size_t thread_count = GetCopyingThreadCount();
+  if (thread_count > 1 && mark_stack_->Size() >= kMinimumParallelMarkStackSize) {
+    timings_.StartSplit("ProcessMarkStackParallel");
+    ProcessMarkStackParallel(thread_count);
+    timings_.EndSplit();
+    return;
+  }
   space::MallocSpace* promo_dest_space = nullptr;
   accounting::ContinuousSpaceBitmap* live_bitmap = nullptr;
   if (generational_ && !whole_heap_collection_) {
@@ -758,6 +781,394 @@ void SemiSpace::ProcessMarkStack() {
   timings_.EndSplit();
 }
 
+
+size_t SemiSpace::GetCopyingThreadCount() const {
+  // The parallel copies are carved with a CAS off the end of the to-space, which needs a bump
+  // pointer space. The read barrier pointers of the dummy objects would need to be set too.
+  if (!parallel_copying_ || kUseBakerOrBrooksReadBarrier || !to_space_->IsBumpPointerSpace() ||
+      heap_->GetThreadPool() == nullptr) {
+    return 1;
+  }
+  return heap_->GetParallelGCThreadCount() + 1;
+}
+
+// Turns the memory at addr into a dead object of byte_size bytes, an int array or a plain
+// java.lang.Object for the smallest size, so that the objects after it can be walked to.
+static void FillWithDummyObject(mirror::Object* addr, size_t byte_size)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  DCHECK_ALIGNED(byte_size, space::BumpPointerSpace::kAlignment);
+  const size_t data_offset = mirror::Array::DataOffset(sizeof(int32_t)).Uint32Value();
+  mirror::Class* int_array_class = mirror::IntArray::GetArrayClass();
+  if (byte_size < data_offset) {
+    DCHECK_EQ(byte_size, sizeof(mirror::Object));
+    addr->SetClass(int_array_class->GetSuperClass());
+  } else {
+    addr->SetClass(int_array_class);
+    addr->AsArray<kVerifyNone>()->SetLength((byte_size - data_offset) / sizeof(int32_t));
+  }
+  addr->SetLockWord(LockWord(), false);
+  DCHECK_EQ(RoundUp(addr->SizeOf(), space::BumpPointerSpace::kAlignment), byte_size);
+}
+
+// One copying task per GC thread for ProcessMarkStackParallel, which steals work like the
+// WorkStealingMarkTask of MarkSweep. A task copies into its own LAB, a chunk carved off the end of
+// the to-space, or into the promotion space through its thread safe allocation. Two tasks may copy
+// the same object: the one which installs the forwarding address with a CAS wins, the other copy
+// is freed or turned into a dummy object which keeps the to-space walkable.
+class SemiSpaceCopyTask : public Task {
+ public:
+  SemiSpaceCopyTask(SemiSpace* semi_space, std::vector<SemiSpaceCopyTask*>* tasks, size_t index,
+                    AtomicInteger* idle_count)
+      : semi_space_(semi_space),
+        to_space_(semi_space->to_space_->AsBumpPointerSpace()),
+        promo_dest_space_(nullptr),
+        delayed_live_bitmap_(nullptr),
+        tasks_(tasks),
+        index_(index),
+        idle_count_(idle_count),
+        self_(nullptr),
+        lab_pos_(nullptr),
+        lab_end_(nullptr),
+        random_state_(static_cast<uint32_t>(index) * 2654435761U + 1),
+        objects_moved_(0),
+        to_space_objects_(0),
+        to_space_bytes_(0),
+        bytes_promoted_(0),
+        saved_bytes_(0),
+        steals_(0),
+        failed_steals_(0) {
+    if (semi_space->generational_) {
+      promo_dest_space_ = semi_space->GetHeap()->GetPrimaryFreeListSpace();
+      if (!semi_space->whole_heap_collection_) {
+        // As in ProcessMarkStack, the live bits of the promoted objects are set when they are
+        // scanned.
+        delayed_live_bitmap_ = promo_dest_space_->GetLiveBitmap();
+      }
+    }
+  }
+
+  // Only called by the thread creating the tasks before the workers are started.
+  void Seed(Object* obj) {
+    deque_.Push(obj);
+  }
+
+  bool HasWork() const {
+    return !deque_.IsEmpty();
+  }
+
+  size_t GetObjectsMoved() const {
+    return objects_moved_;
+  }
+
+  size_t GetToSpaceObjects() const {
+    return to_space_objects_;
+  }
+
+  // Includes the dummy objects and the unused ends of the LABs.
+  size_t GetToSpaceBytes() const {
+    return to_space_bytes_;
+  }
+
+  size_t GetBytesPromoted() const {
+    return bytes_promoted_;
+  }
+
+  size_t GetSavedBytes() const {
+    return saved_bytes_;
+  }
+
+  uint64_t GetSteals() const {
+    return steals_;
+  }
+
+  uint64_t GetFailedSteals() const {
+    return failed_steals_;
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    self_ = self;
+    const int32_t num_tasks = static_cast<int32_t>(tasks_->size());
+    for (;;) {
+      ProcessDeque();
+      if (TrySteal()) {
+        continue;
+      }
+      // Same termination as WorkStealingMarkTask, only the owner pushes onto its deque.
+      idle_count_->FetchAndAddSequentiallyConsistent(1);
+      bool done = false;
+      while (!done) {
+        if (idle_count_->LoadSequentiallyConsistent() == num_tasks) {
+          done = true;
+        } else if (AnyTaskHasWork()) {
+          idle_count_->FetchAndSubSequentiallyConsistent(1);
+          break;
+        } else {
+          sched_yield();
+        }
+      }
+      if (done) {
+        break;
+      }
+    }
+    FillLabRemainder();
+  }
+
+ private:
+  // The LAB size, larger objects get a chunk of their own.
+  static constexpr size_t kLabSize = 32 * KB;
+  static constexpr size_t kMaxLabObjectSize = kLabSize / 4;
+
+  class CopyObjectVisitor {
+   public:
+    explicit CopyObjectVisitor(SemiSpaceCopyTask* task) : task_(task) {}
+
+    void operator()(Object* obj, MemberOffset offset, bool /* is_static */) const ALWAYS_INLINE
+        NO_THREAD_SAFETY_ANALYSIS {
+      task_->MarkObject(obj->GetFieldObjectReferenceAddr<kVerifyNone>(offset));
+    }
+
+    void operator()(mirror::Class* klass, mirror::Reference* ref) const
+        NO_THREAD_SAFETY_ANALYSIS {
+      task_->semi_space_->DelayReferenceReferent(klass, ref);
+    }
+
+   private:
+    SemiSpaceCopyTask* const task_;
+  };
+
+  // The parallel version of SemiSpace::MarkObject.
+  void MarkObject(mirror::HeapReference<mirror::Object>* obj_ptr) NO_THREAD_SAFETY_ANALYSIS {
+    mirror::Object* obj = obj_ptr->AsMirrorPtr();
+    if (obj == nullptr || semi_space_->immune_region_.ContainsObject(obj)) {
+      return;
+    }
+    if (semi_space_->from_space_->HasAddress(obj)) {
+      mirror::Object* forward_address = semi_space_->GetForwardingAddressInFromSpace(obj);
+      if (forward_address == nullptr) {
+        forward_address = Copy(obj);
+      }
+      obj_ptr->Assign(forward_address);
+    } else {
+      BitmapSetSlowPathVisitor visitor(semi_space_);
+      if (!semi_space_->mark_bitmap_->AtomicTestAndSet(obj, visitor)) {
+        deque_.Push(obj);
+      }
+    }
+  }
+
+  // Returns the forwarding address of obj, copied by this task or another one.
+  mirror::Object* Copy(mirror::Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+    const LockWord lock_word = obj->GetLockWord(false);
+    if (lock_word.GetState() == LockWord::kForwardingAddress) {
+      return reinterpret_cast<mirror::Object*>(lock_word.ForwardingAddress());
+    }
+    const size_t object_size = obj->SizeOf();
+    space::MallocSpace* promo_dest_space = nullptr;
+    mirror::Object* forward_address = nullptr;
+    size_t bytes_allocated = 0;
+    if (promo_dest_space_ != nullptr &&
+        reinterpret_cast<byte*>(obj) < semi_space_->last_gc_to_space_end_) {
+      forward_address = promo_dest_space_->Alloc(self_, object_size, &bytes_allocated, nullptr);
+      if (forward_address != nullptr) {
+        promo_dest_space = promo_dest_space_;
+      }
+    }
+    if (forward_address == nullptr) {
+      bytes_allocated = RoundUp(object_size, space::BumpPointerSpace::kAlignment);
+      forward_address = AllocInToSpace(bytes_allocated);
+    }
+    CHECK(forward_address != nullptr) << "Out of memory in the to-space.";
+    const size_t saved_bytes = CopyAvoidingDirtyingPages(forward_address, obj, object_size);
+    // The copy must be complete before other threads can see the forwarding address.
+    if (!obj->CasLockWord(lock_word, LockWord::FromForwardingAddress(
+        reinterpret_cast<size_t>(forward_address)))) {
+      // Another task won, the lock word only ever changes to a forwarding address here.
+      if (promo_dest_space != nullptr) {
+        promo_dest_space->Free(self_, forward_address);
+      } else {
+        FillWithDummyObject(forward_address, bytes_allocated);
+      }
+      forward_address = semi_space_->GetForwardingAddressInFromSpace(obj);
+      DCHECK(forward_address != nullptr);
+      return forward_address;
+    }
+    ++objects_moved_;
+    saved_bytes_ += saved_bytes;
+    if (promo_dest_space != nullptr) {
+      bytes_promoted_ += bytes_allocated;
+      semi_space_->GetHeap()->WriteBarrierEveryFieldOf(forward_address);
+      if (delayed_live_bitmap_ == nullptr) {
+        promo_dest_space->GetLiveBitmap()->AtomicTestAndSet(forward_address);
+        promo_dest_space->GetMarkBitmap()->AtomicTestAndSet(forward_address);
+      }
+    } else {
+      ++to_space_objects_;
+    }
+    deque_.Push(forward_address);
+    return forward_address;
+  }
+
+  mirror::Object* AllocInToSpace(size_t bytes) {
+    if (UNLIKELY(bytes > static_cast<size_t>(lab_end_ - lab_pos_))) {
+      if (bytes > kMaxLabObjectSize) {
+        return AllocChunk(bytes);
+      }
+      FillLabRemainder();
+      lab_pos_ = reinterpret_cast<byte*>(AllocChunk(kLabSize));
+      if (UNLIKELY(lab_pos_ == nullptr)) {
+        // The to-space is almost full, what is left may still fit the object.
+        lab_end_ = nullptr;
+        return AllocChunk(bytes);
+      }
+      lab_end_ = lab_pos_ + kLabSize;
+    }
+    mirror::Object* obj = reinterpret_cast<mirror::Object*>(lab_pos_);
+    lab_pos_ += bytes;
+    return obj;
+  }
+
+  mirror::Object* AllocChunk(size_t bytes) {
+    mirror::Object* chunk = to_space_->AllocNonvirtualWithoutAccounting(bytes);
+    if (chunk != nullptr) {
+      to_space_bytes_ += bytes;
+    }
+    return chunk;
+  }
+
+  void FillLabRemainder() NO_THREAD_SAFETY_ANALYSIS {
+    if (lab_pos_ != lab_end_) {
+      FillWithDummyObject(reinterpret_cast<mirror::Object*>(lab_pos_), lab_end_ - lab_pos_);
+    }
+    lab_pos_ = nullptr;
+    lab_end_ = nullptr;
+  }
+
+  void Scan(Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+    if (delayed_live_bitmap_ != nullptr && promo_dest_space_->HasAddress(obj)) {
+      const bool was_live = delayed_live_bitmap_->AtomicTestAndSet(obj);
+      DCHECK(!was_live);
+    }
+    DCHECK(!semi_space_->from_space_->HasAddress(obj)) << "Scanning object " << obj
+                                                       << " in from space";
+    CopyObjectVisitor visitor(this);
+    obj->VisitReferences<kMovingClasses>(visitor, visitor);
+  }
+
+  void ProcessDeque() {
+    Object* obj;
+    while (deque_.Pop(&obj)) {
+      DCHECK(obj != nullptr);
+      Scan(obj);
+    }
+  }
+
+  // Try to steal one object from each of the other tasks, starting at a random victim.
+  bool TrySteal() {
+    const size_t num_tasks = tasks_->size();
+    const size_t start = NextRandom() % num_tasks;
+    for (size_t i = 0; i < num_tasks; ++i) {
+      const size_t victim = (start + i) % num_tasks;
+      if (victim == index_) {
+        continue;
+      }
+      Object* obj;
+      if ((*tasks_)[victim]->deque_.Steal(&obj)) {
+        ++steals_;
+        Scan(obj);
+        return true;
+      }
+      ++failed_steals_;
+    }
+    return false;
+  }
+
+  bool AnyTaskHasWork() const {
+    for (SemiSpaceCopyTask* task : *tasks_) {
+      if (task->HasWork()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint32_t NextRandom() {
+    // Xorshift, good enough to spread the victims.
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 17;
+    random_state_ ^= random_state_ << 5;
+    return random_state_;
+  }
+
+  SemiSpace* const semi_space_;
+  space::BumpPointerSpace* const to_space_;
+  space::MallocSpace* promo_dest_space_;
+  accounting::ContinuousSpaceBitmap* delayed_live_bitmap_;
+  std::vector<SemiSpaceCopyTask*>* const tasks_;
+  const size_t index_;
+  // Number of tasks which ran out of work, shared by all of the tasks.
+  AtomicInteger* const idle_count_;
+  WorkStealingDeque<Object*> deque_;
+  // The thread running the task.
+  Thread* self_;
+  byte* lab_pos_;
+  byte* lab_end_;
+  uint32_t random_state_;
+  size_t objects_moved_;
+  size_t to_space_objects_;
+  size_t to_space_bytes_;
+  size_t bytes_promoted_;
+  size_t saved_bytes_;
+  uint64_t steals_;
+  uint64_t failed_steals_;
+
+  DISALLOW_COPY_AND_ASSIGN(SemiSpaceCopyTask);
+};
+
+void SemiSpace::ProcessMarkStackParallel(size_t thread_count) {
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  // As in MarkSweep::ProcessMarkStackParallel, every task runs on its own thread.
+  const size_t num_tasks = std::min(thread_count, thread_pool->GetThreadCount() + 1);
+  CHECK_GT(num_tasks, 1U);
+  AtomicInteger idle_count(0);
+  std::vector<SemiSpaceCopyTask*> tasks;
+  for (size_t i = 0; i < num_tasks; ++i) {
+    tasks.push_back(new SemiSpaceCopyTask(this, &tasks, i, &idle_count));
+  }
+  size_t index = 0;
+  for (Object **it = mark_stack_->Begin(), **end = mark_stack_->End(); it < end; ++it) {
+    tasks[index]->Seed(*it);
+    index = (index + 1) % num_tasks;
+  }
+  mark_stack_->Reset();
+  for (SemiSpaceCopyTask* task : tasks) {
+    thread_pool->AddTask(self, task);
+  }
+  thread_pool->SetMaxActiveWorkers(num_tasks - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  size_t to_space_objects = 0;
+  size_t to_space_bytes = 0;
+  uint64_t steals = 0;
+  uint64_t failed_steals = 0;
+  for (SemiSpaceCopyTask* task : tasks) {
+    DCHECK(!task->HasWork());
+    objects_moved_ += task->GetObjectsMoved();
+    bytes_moved_ += task->GetToSpaceBytes() + task->GetBytesPromoted();
+    bytes_promoted_ += task->GetBytesPromoted();
+    saved_bytes_ += task->GetSavedBytes();
+    to_space_objects += task->GetToSpaceObjects();
+    to_space_bytes += task->GetToSpaceBytes();
+    steals += task->GetSteals();
+    failed_steals += task->GetFailedSteals();
+    delete task;
+  }
+  to_space_->AsBumpPointerSpace()->RecordAllocations(to_space_objects, to_space_bytes);
+  VLOG(heap) << "Copied with " << num_tasks << " threads, " << steals << " steals, "
+             << failed_steals << " failed steals";
+}
+
 inline Object* SemiSpace::GetMarkedForwardAddress(mirror::Object* obj) const
     SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_) {
   // All immune objects are assumed marked.
@@ -826,6 +1237,14 @@ void SemiSpace::FinishPhase() {
   heap_->ClearMarkedObjects();
 }
 
+void SemiSpace::WholeHeapCollected() {
+  DCHECK(generational_);
+  bytes_promoted_since_last_whole_heap_collection_ = 0;
+  large_object_bytes_allocated_at_last_whole_heap_collection_ =
+      GetHeap()->GetLargeObjectsSpace()->GetBytesAllocated();
+  whole_heap_collection_ = false;
+}
+
 void SemiSpace::RevokeAllThreadLocalBuffers() {
   timings_.StartSplit("(Paused)RevokeAllThreadLocalBuffers");
   GetHeap()->RevokeAllThreadLocalBuffers();
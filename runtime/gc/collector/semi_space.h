@@ -72,7 +72,7 @@ class SemiSpace : public GarbageCollector {
   void MarkReachableObjects()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_);
   virtual GcType GetGcType() const OVERRIDE {
-    return kGcTypePartial;
+    return collect_from_space_only_ ? kGcTypeSticky : kGcTypePartial;
   }
   virtual CollectorType GetCollectorType() const OVERRIDE {
     return generational_ ? kCollectorTypeGSS : kCollectorTypeSS;
@@ -90,6 +90,35 @@ class SemiSpace : public GarbageCollector {
     swap_semi_spaces_ = swap_semi_spaces;
   }
 
+  // Used for the generational mode of kCollectorTypeGenCMS, where the other spaces are collected
+  // by a concurrent mark sweep. When true, only the from space is collected.
+  void SetCollectFromSpaceOnly(bool collect_from_space_only) {
+    DCHECK(generational_);
+    collect_from_space_only_ = collect_from_space_only;
+  }
+
+  // When true, all the reachable objects of the from space are promoted, which leaves the to
+  // space empty unless the promotion destination space runs out of space.
+  void SetPromoteAllObjects(bool promote_all_objects) {
+    DCHECK(generational_);
+    promote_all_objects_ = promote_all_objects;
+  }
+
+  // When true, the mark stack is processed by the GC thread pool if the to-space is a bump pointer
+  // space, see ProcessMarkStackParallel.
+  void SetParallelCopying(bool parallel_copying) {
+    parallel_copying_ = parallel_copying;
+  }
+
+  // Whether enough was promoted or allocated in the large object space since the last whole heap
+  // collection for the next collection to be a whole heap collection.
+  bool ShouldCollectWholeHeap() const {
+    return whole_heap_collection_;
+  }
+
+  // Tells the collector that the whole heap was collected by another collector.
+  void WholeHeapCollected();
+
   // Initializes internal structures.
   void Init();
 
@@ -189,6 +218,14 @@ class SemiSpace : public GarbageCollector {
   void ProcessMarkStack()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_);
 
+  // The number of threads copying the objects of the mark stack, 1 if they are copied serially.
+  size_t GetCopyingThreadCount() const;
+
+  // Copies and scans the objects reachable from the mark stack with one SemiSpaceCopyTask per
+  // thread.
+  void ProcessMarkStackParallel(size_t thread_count)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_);
+
   inline mirror::Object* GetForwardingAddressInFromSpace(mirror::Object* obj) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -262,8 +299,21 @@ class SemiSpace : public GarbageCollector {
   // Whether or not we swap the semi spaces in the heap during the marking phase.
   bool swap_semi_spaces_;
 
+  // Used for the generational mode. When true, the whole heap is never collected by this
+  // collector.
+  bool collect_from_space_only_;
+
+  // Used for the generational mode. When true, every object of the from space is promoted.
+  bool promote_all_objects_;
+
+  // See SetParallelCopying.
+  bool parallel_copying_;
+
  private:
+  static constexpr size_t kMinimumParallelMarkStackSize = 128;
+
   friend class BitmapSetSlowPathVisitor;
+  friend class SemiSpaceCopyTask;
   DISALLOW_COPY_AND_ASSIGN(SemiSpace);
 };
 
@@ -34,8 +34,13 @@ enum CollectorType {
   kCollectorTypeSS,
   // A generational variant of kCollectorTypeSS.
   kCollectorTypeGSS,
+  // Generational concurrent mark-sweep: a bump pointer nursery collected by kCollectorTypeGSS
+  // and an old generation collected by kCollectorTypeCMS.
+  kCollectorTypeGenCMS,
   // Heap trimming collector, doesn't do any actual collecting.
   kCollectorTypeHeapTrim,
+  // Class census, doesn't do any actual collecting either.
+  kCollectorTypeClassCensus,
   // A (mostly) concurrent copying collector.
   kCollectorTypeCC,
 };
@@ -32,6 +32,8 @@ const char* PrettyCause(GcCause cause) {
     case kGcCauseCollectorTransition: return "CollectorTransition";
     case kGcCauseDisableMovingGc: return "DisableMovingGc";
     case kGcCauseTrim: return "HeapTrim";
+    case kGcCauseAddAppImageSpace: return "AddAppImageSpace";
+    case kGcCauseClassCensus: return "ClassCensus";
     default:
       LOG(FATAL) << "Unreachable";
   }
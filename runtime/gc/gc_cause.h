@@ -39,6 +39,10 @@ enum GcCause {
   kGcCauseDisableMovingGc,
   // Not a real GC cause, used when we trim the heap.
   kGcCauseTrim,
+  // Not a real GC cause, used when we add an app image space to the heap.
+  kGcCauseAddAppImageSpace,
+  // Not a real GC cause, used when we take a class census of the heap.
+  kGcCauseClassCensus,
 };
 
 const char* PrettyCause(GcCause cause);
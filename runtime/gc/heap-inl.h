@@ -70,7 +70,8 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self, mirror::Clas
       return nullptr;
     }
   }
-  DCHECK_GT(bytes_allocated, 0u);
+  // TLAB allocations are counted when the TLAB is handed out.
+  DCHECK(bytes_allocated > 0u || allocator == kAllocatorTypeTLAB);
   DCHECK_GT(usable_size, 0u);
   obj->SetClass(klass);
   if (kUseBakerOrBrooksReadBarrier) {
@@ -110,13 +111,16 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self, mirror::Clas
   } else {
     DCHECK(!Runtime::Current()->HasStatsEnabled());
   }
-  if (AllocatorHasAllocationStack(allocator)) {
+  if (AllocationUsesAllocationStack(allocator)) {
     PushOnAllocationStack(self, &obj);
   }
   if (kInstrumented) {
     if (Dbg::IsAllocTrackingEnabled()) {
       Dbg::RecordAllocation(klass, bytes_allocated);
     }
+    if (UNLIKELY(allocation_sampler_->IsSampling())) {
+      allocation_sampler_->RecordAllocation(self, klass, bytes_allocated);
+    }
   } else {
     DCHECK(!Dbg::IsAllocTrackingEnabled());
   }
@@ -132,6 +136,89 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self, mirror::Clas
   return obj;
 }
 
+template <bool kInstrumented, typename PreFenceVisitor>
+inline size_t Heap::AllocObjectBatch(Thread* self, mirror::Class* klass, size_t byte_count,
+                                     size_t num_objects, mirror::Object** objects,
+                                     const PreFenceVisitor& pre_fence_visitor) {
+  if (kIsDebugBuild) {
+    CheckPreconditionsForAllocObject(klass, byte_count);
+  }
+  DCHECK_EQ(self->GetState(), kRunnable);
+  const AllocatorType allocator = GetCurrentAllocator();
+  if (allocator != kAllocatorTypeRosAlloc || running_on_valgrind_ || num_objects == 0 ||
+      ShouldAllocLargeObject(klass, byte_count)) {
+    return 0;
+  }
+  allocator::RosAlloc* rosalloc = rosalloc_space_->GetRosAlloc();
+  const size_t usable_size = rosalloc->UsableSize(byte_count);
+  if (UNLIKELY(IsOutOfMemoryOnAllocation<false>(allocator, usable_size * num_objects))) {
+    return 0;
+  }
+  size_t bytes_allocated;
+  const size_t num_allocated = rosalloc_space_->AllocBatchNonvirtual(self, byte_count, num_objects,
+                                                                    objects, &bytes_allocated);
+  if (num_allocated == 0) {
+    return 0;
+  }
+  // The objects aren't pushed onto the allocation stack, the GC finds them from the runs.
+  DCHECK(!AllocationUsesAllocationStack(allocator));
+  for (size_t i = 0; i < num_allocated; ++i) {
+    mirror::Object* obj = objects[i];
+    obj->SetClass(klass);
+    if (kUseBakerOrBrooksReadBarrier) {
+      if (kUseBrooksReadBarrier) {
+        obj->SetReadBarrierPointer(obj);
+      }
+      obj->AssertReadBarrierPointer();
+    }
+    pre_fence_visitor(obj, usable_size);
+  }
+  num_bytes_allocated_.FetchAndAddSequentiallyConsistent(bytes_allocated);
+  // TODO: Deprecate.
+  if (kInstrumented) {
+    if (Runtime::Current()->HasStatsEnabled()) {
+      RuntimeStats* thread_stats = self->GetStats();
+      thread_stats->allocated_objects += num_allocated;
+      thread_stats->allocated_bytes += bytes_allocated;
+      RuntimeStats* global_stats = Runtime::Current()->GetStats();
+      global_stats->allocated_objects += num_allocated;
+      global_stats->allocated_bytes += bytes_allocated;
+    }
+    if (Dbg::IsAllocTrackingEnabled()) {
+      for (size_t i = 0; i < num_allocated; ++i) {
+        Dbg::RecordAllocation(klass, usable_size);
+      }
+    }
+    if (UNLIKELY(allocation_sampler_->IsSampling())) {
+      for (size_t i = 0; i < num_allocated; ++i) {
+        allocation_sampler_->RecordAllocation(self, klass, usable_size);
+      }
+    }
+  } else {
+    DCHECK(!Runtime::Current()->HasStatsEnabled());
+    DCHECK(!Dbg::IsAllocTrackingEnabled());
+  }
+  // The concurrent GC isn't requested here since the objects aren't reachable yet, the next
+  // allocation with AllocObject requests it.
+  for (size_t i = 0; i < num_allocated; ++i) {
+    VerifyObject(objects[i]);
+  }
+  return num_allocated;
+}
+
+inline bool Heap::AllocationUsesAllocationStack(AllocatorType allocator_type) const {
+  if (!AllocatorHasAllocationStack(allocator_type)) {
+    return false;
+  }
+  // Under valgrind the objects don't start at the slots because of the red zones.
+  if (allocator_type == kAllocatorTypeRosAlloc) {
+    return running_on_valgrind_;
+  } else if (allocator_type == kAllocatorTypeNonMoving) {
+    return running_on_valgrind_ || !non_moving_space_->IsRosAllocSpace();
+  }
+  return true;
+}
+
 // The size of a thread-local allocation stack in the number of references.
 static constexpr size_t kThreadLocalAllocationStackSize = 128;
 
@@ -170,6 +257,7 @@ inline mirror::Object* Heap::TryToAllocate(Thread* self, AllocatorType allocator
       if (LIKELY(ret != nullptr)) {
         *bytes_allocated = alloc_size;
         *usable_size = alloc_size;
+        self->AddAllocatedBytes(alloc_size);
       }
       break;
     }
@@ -191,14 +279,24 @@ inline mirror::Object* Heap::TryToAllocate(Thread* self, AllocatorType allocator
         DCHECK(!running_on_valgrind_);
         ret = dlmalloc_space_->AllocNonvirtual(self, alloc_size, bytes_allocated, usable_size);
       }
+      if (LIKELY(ret != nullptr)) {
+        self->AddAllocatedBytes(*bytes_allocated);
+      }
       break;
     }
     case kAllocatorTypeNonMoving: {
       ret = non_moving_space_->Alloc(self, alloc_size, bytes_allocated, usable_size);
+      // RosAlloc counts the bytes allocated by the threads itself.
+      if (LIKELY(ret != nullptr) && !non_moving_space_->IsRosAllocSpace()) {
+        self->AddAllocatedBytes(*bytes_allocated);
+      }
       break;
     }
     case kAllocatorTypeLOS: {
       ret = large_object_space_->Alloc(self, alloc_size, bytes_allocated, usable_size);
+      if (LIKELY(ret != nullptr)) {
+        self->AddAllocatedBytes(*bytes_allocated);
+      }
       // Note that the bump pointer spaces aren't necessarily next to
       // the other continuous spaces like the non-moving alloc space or
       // the zygote space.
@@ -210,14 +308,22 @@ inline mirror::Object* Heap::TryToAllocate(Thread* self, AllocatorType allocator
       if (UNLIKELY(self->TlabSize() < alloc_size)) {
         // Try allocating a new thread local buffer, if the allocaiton fails the space must be
         // full so return nullptr.
-        if (!bump_pointer_space_->AllocNewTlab(self, alloc_size + kDefaultTLABSize)) {
+        // While the entrypoints are instrumented the TLAB only holds this object, so that compiled
+        // code, which bumps the TLAB inline, finds it full and calls the entrypoints.
+        const size_t new_tlab_size = UNLIKELY(single_object_tlabs_) ? alloc_size :
+            alloc_size + space::BumpPointerSpace::NextTlabSize(self);
+        if (!bump_pointer_space_->AllocNewTlab(self, new_tlab_size)) {
           return nullptr;
         }
+        // The whole TLAB counts as allocated when it is handed out since compiled code doesn't
+        // count the objects it allocates inline. The next GC gives back the unused part.
+        *bytes_allocated = new_tlab_size;
+      } else {
+        *bytes_allocated = 0;
       }
       // The allocation can't fail.
       ret = self->AllocTlab(alloc_size);
       DCHECK(ret != nullptr);
-      *bytes_allocated = alloc_size;
       *usable_size = alloc_size;
       break;
     }
@@ -18,9 +18,14 @@
 
 #define ATRACE_TAG ATRACE_TAG_DALVIK
 #include <cutils/trace.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <limits>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "base/histogram-inl.h"
@@ -51,8 +56,10 @@
 #include "entrypoints/quick/quick_alloc_entrypoints.h"
 #include "heap-inl.h"
 #include "image.h"
+#include "instrumentation.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/class-inl.h"
+#include "mirror/dex_cache.h"
 #include "mirror/object.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
@@ -78,6 +85,11 @@ static constexpr size_t kGcAlotInterval = KB;
 // Minimum amount of remaining bytes before a concurrent GC is triggered.
 static constexpr size_t kMinConcurrentRemainingBytes = 128 * KB;
 static constexpr size_t kMaxConcurrentRemainingBytes = 512 * KB;
+// With GC pacing, how the headroom of the concurrent GC start grows after allocations stalled and
+// decays after a GC without stalls, and its maximum.
+static constexpr double kPacingHeadroomGrowth = 2.0;
+static constexpr double kPacingHeadroomDecay = 0.9;
+static constexpr double kPacingMaxHeadroom = 8.0;
 // Sticky GC throughput adjustment, divided by 4. Increasing this causes sticky GC to occur more
 // relative to partial/full GC. This may be desirable since sticky GCs interfere less with mutator
 // threads (lower pauses, use less memory bandwidth).
@@ -92,6 +104,8 @@ static constexpr size_t kNonMovingSpaceCapacity = 64 * MB;
 static constexpr size_t kAllocationStackReserveSize = 1024;
 // Default mark stack size in bytes.
 static const size_t kDefaultMarkStackSize = 64 * KB;
+// The number of classes listed by the class census of the SIGQUIT dump.
+static constexpr size_t kSigQuitClassCensusSize = 20;
 
 Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max_free,
            double target_utilization, double foreground_heap_growth_multiplier, size_t capacity,
@@ -123,6 +137,7 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       ignore_max_footprint_(ignore_max_footprint),
       zygote_creation_lock_("zygote creation lock", kZygoteCreationLock),
       have_zygote_space_(false),
+      zygote_end_(nullptr),
       large_object_threshold_(std::numeric_limits<size_t>::max()),  // Starts out disabled.
       collector_type_running_(kCollectorTypeNone),
       last_gc_type_(collector::kGcTypeNone),
@@ -151,6 +166,10 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       verify_pre_sweeping_rosalloc_(verify_pre_sweeping_rosalloc),
       verify_post_gc_rosalloc_(verify_post_gc_rosalloc),
       allocation_rate_(0),
+      gc_pacing_(false),
+      concurrent_start_headroom_(1.0),
+      last_gc_allocation_stall_count_(0),
+      verify_sample_percent_(0),
       /* For GC a lot mode, we limit the allocations stacks to be kGcAlotInterval allocations. This
        * causes a lot of GC since we do a GC for alloc whenever the stack is full. When heap
        * verification is enabled, we limit the size of allocation stacks to speed up their
@@ -167,14 +186,24 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       target_utilization_(target_utilization),
       foreground_heap_growth_multiplier_(foreground_heap_growth_multiplier),
       total_wait_time_(0),
+      allocation_stall_count_(0),
+      native_blocking_count_(0),
+      native_blocking_time_ns_(0),
+      last_gc_tlab_waste_bytes_(0),
+      total_tlab_waste_bytes_(0),
       total_allocation_time_(0),
       verify_object_mode_(kVerifyObjectModeDisabled),
       disable_moving_gc_count_(0),
+      semi_space_collector_(nullptr),
+      concurrent_copying_collector_(nullptr),
       running_on_valgrind_(Runtime::Current()->RunningOnValgrind()),
-      use_tlab_(use_tlab) {
+      use_tlab_(use_tlab),
+      // The entrypoints are instrumented for valgrind before the runtime knows the heap.
+      single_object_tlabs_(running_on_valgrind_) {
   if (VLOG_IS_ON(heap) || VLOG_IS_ON(startup)) {
     LOG(INFO) << "Heap() entering";
   }
+  std::fill_n(zygote_region_begins_, static_cast<size_t>(kZygoteRegionCount), nullptr);
   const bool is_zygote = Runtime::Current()->IsZygote();
   // If we aren't the zygote, switch to the default non zygote allocator. This may update the
   // entrypoints.
@@ -211,6 +240,8 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
         "main space", requested_alloc_space_begin + kNonMovingSpaceCapacity, capacity,
         PROT_READ | PROT_WRITE, true, &error_str);
     CHECK(mem_map != nullptr) << error_str;
+    mem_map->AdviseHugePages();
+    mem_map->AdviseNumaInterleave();
     // Non moving space is always dlmalloc since we currently don't have support for multiple
     // rosalloc spaces.
     non_moving_space_ = space::DlMallocSpace::Create(
@@ -223,6 +254,8 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
     MemMap* mem_map = MemMap::MapAnonymous("main/non-moving space", requested_alloc_space_begin,
                                            capacity, PROT_READ | PROT_WRITE, true, &error_str);
     CHECK(mem_map != nullptr) << error_str;
+    mem_map->AdviseHugePages();
+    mem_map->AdviseNumaInterleave();
     // Create the main free list space, which doubles as the non moving space. We can do this since
     // non zygote means that we won't have any background compaction.
     CreateMainMallocSpace(mem_map, initial_size, growth_limit, capacity);
@@ -269,6 +302,11 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
 
   // Relies on the spaces being sorted.
   byte* heap_begin = continuous_spaces_.front()->Begin();
+  if (GetImageSpace() != nullptr) {
+    // App images are added below the boot image once the app's class loader is created.
+    CHECK_GT(reinterpret_cast<uintptr_t>(heap_begin), space::ImageSpace::kAppImageAreaSize);
+    heap_begin -= space::ImageSpace::kAppImageAreaSize;
+  }
   byte* heap_end = continuous_spaces_.back()->Limit();
   size_t heap_capacity = heap_end - heap_begin;
 
@@ -315,6 +353,7 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
   gc_complete_cond_.reset(new ConditionVariable("GC complete condition variable",
                                                 *gc_complete_lock_));
   heap_trim_request_lock_ = new Mutex("Heap trim request lock");
+  allocation_sampler_.reset(new AllocationSampler);
   last_gc_size_ = GetBytesAllocated();
 
   if (ignore_max_footprint_) {
@@ -332,9 +371,14 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
   }
   if (kMovingCollector) {
     // TODO: Clean this up.
-    bool generational = foreground_collector_type_ == kCollectorTypeGSS;
+    bool generational = foreground_collector_type_ == kCollectorTypeGSS ||
+        foreground_collector_type_ == kCollectorTypeGenCMS ||
+        background_collector_type_ == kCollectorTypeGenCMS;
     semi_space_collector_ = new collector::SemiSpace(this, generational,
                                                      generational ? "generational" : "");
+    if (generational) {
+      semi_space_collector_->SetCollectFromSpaceOnly(collector_type_ == kCollectorTypeGenCMS);
+    }
     garbage_collectors_.push_back(semi_space_collector_);
 
     concurrent_copying_collector_ = new collector::ConcurrentCopying(this);
@@ -573,10 +617,97 @@ void Heap::VisitObjects(ObjectCallback callback, void* arg) {
       callback(obj, arg);
     }
   }
+  VisitNewRosAllocObjects(callback, arg);
   GetLiveBitmap()->Walk(callback, arg);
   self->EndAssertNoThreadSuspension(old_cause);
 }
 
+// Walks a range of a live bitmap for VisitLiveBitmapParallel.
+class ObjectCallbackTask : public Task {
+ public:
+  ObjectCallbackTask(accounting::ContinuousSpaceBitmap* bitmap, uintptr_t begin, uintptr_t end,
+                     ObjectCallback* callback, void* arg)
+      : bitmap_(bitmap), begin_(begin), end_(end), callback_(callback), arg_(arg) {}
+
+  // The thread starting the walk holds the mutator lock exclusively.
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    bitmap_->VisitMarkedRange(begin_, end_, *this);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+  void operator()(mirror::Object* obj) const NO_THREAD_SAFETY_ANALYSIS {
+    callback_(obj, arg_);
+  }
+
+ private:
+  accounting::ContinuousSpaceBitmap* const bitmap_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  ObjectCallback* const callback_;
+  void* const arg_;
+};
+
+void Heap::VisitObjectsParallel(Thread* self, ObjectCallback callback, void* arg) {
+  const char* old_cause = self->StartAssertNoThreadSuspension("Visiting objects");
+  if (bump_pointer_space_ != nullptr) {
+    bump_pointer_space_->Walk(callback, arg);
+  }
+  for (mirror::Object** it = allocation_stack_->Begin(), **end = allocation_stack_->End();
+      it < end; ++it) {
+    mirror::Object* obj = *it;
+    if (obj != nullptr && obj->GetClass() != nullptr) {
+      callback(obj, arg);
+    }
+  }
+  VisitNewRosAllocObjects(callback, arg);
+  VisitLiveBitmapParallel(self, callback, arg);
+  self->EndAssertNoThreadSuspension(old_cause);
+}
+
+void Heap::VisitLiveBitmapParallel(Thread* self, ObjectCallback callback, void* arg) {
+  Locks::mutator_lock_->AssertExclusiveHeld(self);
+  ThreadPool* thread_pool = GetThreadPool();
+  const size_t thread_count = (thread_pool != nullptr) ? thread_pool->GetThreadCount() + 1 : 1;
+  // A few tasks per thread since the density of the live objects varies.
+  std::vector<ObjectCallbackTask*> tasks;
+  for (space::ContinuousSpace* space : continuous_spaces_) {
+    accounting::ContinuousSpaceBitmap* bitmap = space->GetLiveBitmap();
+    if (bitmap == nullptr) {
+      continue;
+    }
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(space->Begin());
+    const uintptr_t end = reinterpret_cast<uintptr_t>(space->End());
+    const uintptr_t delta = RoundUp((end - begin) / (thread_count * 4) + 1, kPageSize);
+    for (uintptr_t task_begin = begin; task_begin < end; task_begin += delta) {
+      tasks.push_back(new ObjectCallbackTask(bitmap, task_begin, std::min(task_begin + delta, end),
+                                             callback, arg));
+    }
+  }
+  if (thread_count > 1) {
+    for (ObjectCallbackTask* task : tasks) {
+      thread_pool->AddTask(self, task);
+    }
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+  }
+  // The large objects are few, this thread visits them while the workers run.
+  for (space::DiscontinuousSpace* space : discontinuous_spaces_) {
+    space->GetLiveBitmap()->Walk(callback, arg);
+  }
+  if (thread_count > 1) {
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+  } else {
+    for (ObjectCallbackTask* task : tasks) {
+      task->Run(self);
+      task->Finalize();
+    }
+  }
+}
+
 void Heap::MarkAllocStackAsLive(accounting::ObjectStack* stack) {
   space::ContinuousSpace* space1 = rosalloc_space_ != nullptr ? rosalloc_space_ : non_moving_space_;
   space::ContinuousSpace* space2 = dlmalloc_space_ != nullptr ? dlmalloc_space_ : non_moving_space_;
@@ -594,6 +725,34 @@ void Heap::MarkAllocStackAsLive(accounting::ObjectStack* stack) {
                  large_object_space_->GetLiveBitmap(), stack);
 }
 
+void Heap::AddAppImageSpace(space::ImageSpace* space) {
+  DCHECK(space->IsAppImage());
+  Thread* self = Thread::Current();
+  // No GC may see the space without its mod-union table.
+  ScopedThreadStateChange tsc(self, kWaitingForGcToComplete);
+  MutexLock mu(self, *gc_complete_lock_);
+  WaitForGcToCompleteLocked(kGcCauseAddAppImageSpace, self);
+  // The card table was created to cover the app image area below the boot image.
+  CHECK(card_table_->AddrIsInCardTable(space->Begin()) &&
+        card_table_->AddrIsInCardTable(space->Limit() - 1)) << *space;
+  AddSpace(space);
+  accounting::ModUnionTable* mod_union_table =
+      new accounting::ModUnionTableToZygoteAllocspace("App image mod-union table", this, space);
+  AddModUnionTable(mod_union_table);
+}
+
+void Heap::StartAllocationSampling(size_t interval) {
+  if (allocation_sampler_->Start(interval)) {
+    Runtime::Current()->GetInstrumentation()->InstrumentQuickAllocEntryPoints();
+  }
+}
+
+void Heap::StopAllocationSampling() {
+  if (allocation_sampler_->Stop()) {
+    Runtime::Current()->GetInstrumentation()->UninstrumentQuickAllocEntryPoints();
+  }
+}
+
 void Heap::DeleteThreadPool() {
   thread_pool_.reset(nullptr);
 }
@@ -736,11 +895,110 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
        << "\n";
   }
   os << "Total mutator paused time: " << PrettyDuration(total_paused_time) << "\n";
+  reference_processor_.DumpBlockingInfo(os);
+  os << "Total objects kept alive for finalization: "
+     << reference_processor_.GetTotalFinalizableCount() << " with total size "
+     << PrettySize(reference_processor_.GetTotalFinalizableBytes()) << "\n";
   os << "Total time waiting for GC to complete: " << PrettyDuration(total_wait_time_) << "\n";
+  const uint64_t native_blocking_count = native_blocking_count_.LoadRelaxed();
+  if (native_blocking_count != 0) {
+    os << "Native allocation registrations blocked: " << native_blocking_count << " for "
+       << PrettyDuration(native_blocking_time_ns_.LoadRelaxed()) << "\n";
+  }
+  if (large_object_space_ != nullptr) {
+    os << "Large object bytes released to the kernel: "
+       << PrettySize(large_object_space_->GetTotalBytesReleased()) << "\n";
+  }
+  if (use_tlab_) {
+    os << "Total TLAB waste: " << PrettySize(total_tlab_waste_bytes_) << "\n";
+  }
   os << "Approximate GC data structures memory overhead: " << gc_memory_overhead_.LoadRelaxed();
   BaseMutex::DumpAll(os);
 }
 
+// Returns the name of the collector in lower case with runs of other characters as dashes.
+static std::string GcMetricPrefix(const char* collector_name) {
+  std::string prefix("art.gc.");
+  for (const char* c = collector_name; *c != '\0'; ++c) {
+    if (isalnum(*c)) {
+      prefix += tolower(*c);
+    } else if (prefix[prefix.size() - 1] != '-' && prefix[prefix.size() - 1] != '.') {
+      prefix += '-';
+    }
+  }
+  if (prefix[prefix.size() - 1] == '-') {
+    prefix.resize(prefix.size() - 1);
+  }
+  return prefix + ".";
+}
+
+// In floating point, the bytes times a second in nanoseconds overflow.
+static uint64_t BytesPerSecond(uint64_t bytes, uint64_t ns) {
+  return ns != 0 ? static_cast<uint64_t>(bytes * 1000000000.0 / ns) : 0;
+}
+
+void Heap::GetGcMetrics(Thread* self, std::vector<std::pair<std::string, uint64_t>>* metrics) {
+  ScopedThreadStateChange tsc(self, kWaitingForGcToComplete);
+  MutexLock mu(self, *gc_complete_lock_);
+  // The GC updates its histograms while it runs. Not counted in total_wait_time_, the caller
+  // isn't waiting for memory.
+  while (collector_type_running_ != kCollectorTypeNone) {
+    gc_complete_cond_->Wait(self);
+  }
+  uint64_t total_cpu_time = 0;
+  uint64_t total_time = 0;
+  uint64_t total_freed_bytes = 0;
+  for (collector::GarbageCollector* collector : garbage_collectors_) {
+    const CumulativeLogger& logger = collector->GetCumulativeTimings();
+    const Histogram<uint64_t>& pause_histogram = collector->GetPauseHistogram();
+    const std::string prefix = GcMetricPrefix(collector->GetName());
+    const uint64_t iterations = logger.GetIterations();
+    const uint64_t time = logger.GetTotalNs();
+    const uint64_t cpu_time = collector->GetTotalCpuTimeNs();
+    const uint64_t freed_bytes = std::max<int64_t>(collector->GetTotalFreedBytes(), 0);
+    metrics->push_back(std::make_pair(prefix + "count", iterations));
+    metrics->push_back(std::make_pair(prefix + "time-ns", time));
+    metrics->push_back(std::make_pair(prefix + "cpu-time-ns", cpu_time));
+    metrics->push_back(std::make_pair(prefix + "freed-bytes", freed_bytes));
+    metrics->push_back(std::make_pair(prefix + "freed-bytes-per-second",
+                                      BytesPerSecond(freed_bytes, time)));
+    // The pauses are recorded in microseconds.
+    uint64_t p50 = 0, p90 = 0, p99 = 0, max = 0;
+    if (pause_histogram.SampleSize() != 0) {
+      Histogram<uint64_t>::CumulativeData cumulative_data;
+      pause_histogram.CreateHistogram(&cumulative_data);
+      p50 = pause_histogram.Percentile(0.5, cumulative_data) * 1000;
+      p90 = pause_histogram.Percentile(0.9, cumulative_data) * 1000;
+      p99 = pause_histogram.Percentile(0.99, cumulative_data) * 1000;
+      max = pause_histogram.Max() * 1000;
+    }
+    metrics->push_back(std::make_pair(prefix + "pause-count", pause_histogram.SampleSize()));
+    metrics->push_back(std::make_pair(prefix + "pause-p50-ns", p50));
+    metrics->push_back(std::make_pair(prefix + "pause-p90-ns", p90));
+    metrics->push_back(std::make_pair(prefix + "pause-p99-ns", p99));
+    metrics->push_back(std::make_pair(prefix + "pause-max-ns", max));
+    total_cpu_time += cpu_time;
+    total_time += time;
+    total_freed_bytes += freed_bytes;
+  }
+  metrics->push_back(std::make_pair("art.gc.time-ns", total_time));
+  metrics->push_back(std::make_pair("art.gc.cpu-time-ns", total_cpu_time));
+  metrics->push_back(std::make_pair("art.gc.freed-bytes-per-second",
+                                    BytesPerSecond(total_freed_bytes, total_time)));
+  metrics->push_back(std::make_pair("art.gc.wait-time-ns", total_wait_time_));
+  metrics->push_back(std::make_pair("art.gc.allocation-stall-count",
+                                    allocation_stall_count_.LoadRelaxed()));
+  metrics->push_back(std::make_pair("art.gc.tlab-waste-bytes", total_tlab_waste_bytes_));
+  metrics->push_back(std::make_pair("art.gc.finalizable-count",
+                                    reference_processor_.GetTotalFinalizableCount()));
+  metrics->push_back(std::make_pair("art.gc.finalizable-bytes",
+                                    reference_processor_.GetTotalFinalizableBytes()));
+  metrics->push_back(std::make_pair("art.gc.native-blocking-count",
+                                    native_blocking_count_.LoadRelaxed()));
+  metrics->push_back(std::make_pair("art.gc.native-blocking-time-ns",
+                                    native_blocking_time_ns_.LoadRelaxed()));
+}
+
 Heap::~Heap() {
   VLOG(heap) << "Starting ~Heap()";
   STLDeleteElements(&garbage_collectors_);
@@ -792,7 +1050,7 @@ space::Space* Heap::FindSpaceFromObject(const mirror::Object* obj, bool fail_ok)
 
 space::ImageSpace* Heap::GetImageSpace() const {
   for (const auto& space : continuous_spaces_) {
-    if (space->IsImageSpace()) {
+    if (space->IsImageSpace() && !space->AsImageSpace()->IsAppImage()) {
       return space->AsImageSpace();
     }
   }
@@ -853,20 +1111,40 @@ void Heap::DoPendingTransitionOrTrim() {
     usleep(wait_time / 1000);  // Usleep takes microseconds.
   }
   // Transition the collector if the desired collector type is not the same as the current
-  // collector type.
-  TransitionCollector(desired_collector_type);
+  // collector type. A transition to a moving collector compacts the heap, it waits for enough
+  // fragmentation. The desired collector type stays pending and is checked again at the next
+  // request, which the GCs in the background make through RequestHeapTrim.
+  if (desired_collector_type != collector_type_ && IsMovingGc(desired_collector_type) &&
+      !IsBackgroundCompactionWorthwhile()) {
+    VLOG(heap) << "Deferring the transition to " << desired_collector_type;
+  } else {
+    TransitionCollector(desired_collector_type);
+  }
+  // Deflate the idle monitors, this runs concurrently with the mutators so it doesn't matter
+  // whether we care about pauses.
+  Runtime::Current()->GetMonitorList()->DeflateMonitors();
   if (!CareAboutPauseTimes()) {
-    // Deflate the monitors, this can cause a pause but shouldn't matter since we don't care
-    // about pauses.
-    Runtime* runtime = Runtime::Current();
-    runtime->GetThreadList()->SuspendAll();
-    runtime->GetMonitorList()->DeflateMonitors();
-    runtime->GetThreadList()->ResumeAll();
     // Do a heap trim if it is needed.
     Trim();
   }
 }
 
+bool Heap::IsBackgroundCompactionWorthwhile() {
+  if (main_space_ == nullptr || !main_space_->IsRosAllocSpace()) {
+    // No fragmentation metrics, compact as soon as the process is in the background.
+    return true;
+  }
+  // The free pages are already released by the trims, the free slots of the runs are the
+  // resident memory which only a compaction gives back. The large objects aren't moved.
+  size_t run_bytes = 0;
+  const size_t free_slot_bytes =
+      main_space_->AsRosAllocSpace()->GetRosAlloc()->FreeSlotBytes(&run_bytes);
+  VLOG(heap) << "Main space runs use " << PrettySize(run_bytes) << ", "
+             << PrettySize(free_slot_bytes) << " of which in free slots";
+  return free_slot_bytes >= kMinBackgroundCompactionReclaim &&
+      free_slot_bytes >= run_bytes * kMinBackgroundCompactionFragmentation;
+}
+
 void Heap::Trim() {
   Thread* self = Thread::Current();
   {
@@ -983,6 +1261,12 @@ bool Heap::IsLiveObjectLocked(mirror::Object* obj, bool search_allocation_stack,
       }
     }
   }
+  // The objects RosAlloc allocated since the last GC are only in its runs.
+  if (search_allocation_stack && !running_on_valgrind_ && c_space != nullptr &&
+      c_space->IsRosAllocSpace() &&
+      c_space->AsRosAllocSpace()->GetRosAlloc()->IsNewAllocation(obj)) {
+    return true;
+  }
   // This is covering the allocation/live stack swapping that is done without mutators suspended.
   for (size_t i = 0; i < (sorted ? 1 : 5); ++i) {
     if (i > 0) {
@@ -1099,6 +1383,7 @@ mirror::Object* Heap::AllocateInternalWithGc(Thread* self, AllocatorType allocat
   StackHandleScope<1> hs(self);
   HandleWrapper<mirror::Class> h(hs.NewHandleWrapper(klass));
   klass = nullptr;  // Invalidate for safety.
+  allocation_stall_count_.FetchAndAddSequentiallyConsistent(1);
   // The allocation failed. If the GC is running, block until it completes, and then retry the
   // allocation.
   collector::GcType last_gc = WaitForGcToComplete(kGcCauseForAlloc, self);
@@ -1119,6 +1404,11 @@ mirror::Object* Heap::AllocateInternalWithGc(Thread* self, AllocatorType allocat
   collector::GcType tried_type = next_gc_type_;
   const bool gc_ran =
       CollectGarbageInternal(tried_type, kGcCauseForAlloc, false) != collector::kGcTypeNone;
+  if (collector_type_ == kCollectorTypeGenCMS && next_gc_type_ != collector::kGcTypeSticky) {
+    // The nursery collection promoted enough for the old generation to be collected, do it in the
+    // background rather than at the next allocation failure.
+    RequestConcurrentGC(self);
+  }
   if (was_default_allocator && allocator != GetCurrentAllocator()) {
     return nullptr;
   }
@@ -1239,6 +1529,207 @@ void Heap::CountInstances(const std::vector<mirror::Class*>& classes, bool use_i
   self->EndAssertNoThreadSuspension(old_cause);
 }
 
+// Counts the instances and bytes per class of the objects visited, for one task of a class census.
+class ClassCensusCounter {
+ public:
+  typedef std::unordered_map<mirror::Class*, ClassCensusEntry> Counts;
+
+  ClassCensusCounter() : last_class_(nullptr), last_counts_(nullptr) {}
+
+  void Count(mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    mirror::Class* klass = obj->GetClass();
+    // Neighbouring objects often have the same class, save the lookup.
+    if (klass != last_class_) {
+      last_class_ = klass;
+      last_counts_ = &counts_[klass];
+    }
+    const size_t size = obj->SizeOf();
+    ++last_counts_->count;
+    last_counts_->bytes += size;
+    last_counts_->compact_header_savings += RoundUp(size, kObjectAlignment) -
+        RoundUp(size - sizeof(LockWord), kObjectAlignment);
+    if (obj->GetLockWord(false).GetState() != LockWord::kUnlocked) {
+      ++last_counts_->lock_word_count;
+    }
+  }
+
+  static void Callback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    reinterpret_cast<ClassCensusCounter*>(arg)->Count(obj);
+  }
+
+  const Counts& GetCounts() const {
+    return counts_;
+  }
+
+ private:
+  Counts counts_;
+  mirror::Class* last_class_;
+  ClassCensusEntry* last_counts_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClassCensusCounter);
+};
+
+class ClassCensusVisitor {
+ public:
+  explicit ClassCensusVisitor(ClassCensusCounter* counter) : counter_(counter) {}
+
+  void operator()(mirror::Object* obj) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    counter_->Count(obj);
+  }
+
+ private:
+  ClassCensusCounter* const counter_;
+};
+
+// Counts the marked objects of a range of a live bitmap.
+class ClassCensusTask : public Task {
+ public:
+  ClassCensusTask(accounting::ContinuousSpaceBitmap* bitmap, uintptr_t begin, uintptr_t end,
+                  ClassCensusCounter* counter)
+      : bitmap_(bitmap), begin_(begin), end_(end), counter_(counter) {}
+
+  // The thread taking the census holds the mutator lock and no GC runs meanwhile.
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    bitmap_->VisitMarkedRange(begin_, end_, ClassCensusVisitor(counter_));
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  accounting::ContinuousSpaceBitmap* const bitmap_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  ClassCensusCounter* const counter_;
+};
+
+static bool CompareClassCensusEntries(const ClassCensusEntry& a, const ClassCensusEntry& b) {
+  return a.bytes > b.bytes || (a.bytes == b.bytes && a.count > b.count);
+}
+
+bool Heap::TakeClassCensus(Thread* self, bool wait_for_gc, std::vector<ClassCensusEntry>* census) {
+  // Pretend we are doing a GC so that no GC changes the bitmaps or uses the thread pool meanwhile.
+  if (wait_for_gc) {
+    ScopedThreadStateChange tsc(self, kWaitingForGcToComplete);
+    MutexLock mu(self, *gc_complete_lock_);
+    WaitForGcToCompleteLocked(kGcCauseClassCensus, self);
+    collector_type_running_ = kCollectorTypeClassCensus;
+  } else {
+    MutexLock mu(self, *gc_complete_lock_);
+    if (collector_type_running_ != kCollectorTypeNone) {
+      return false;
+    }
+    collector_type_running_ = kCollectorTypeClassCensus;
+  }
+  const char* old_cause = self->StartAssertNoThreadSuspension("Class census");
+  ThreadPool* thread_pool = GetThreadPool();
+  const size_t thread_count = (thread_pool != nullptr) ? thread_pool->GetThreadCount() + 1 : 1;
+  // The first counter is for the objects visited by this thread.
+  std::vector<std::unique_ptr<ClassCensusCounter>> counters;
+  counters.emplace_back(new ClassCensusCounter);
+  {
+    ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    // A few tasks per thread since the density of the live objects varies.
+    std::vector<ClassCensusTask*> tasks;
+    for (space::ContinuousSpace* space : continuous_spaces_) {
+      accounting::ContinuousSpaceBitmap* bitmap = space->GetLiveBitmap();
+      if (bitmap == nullptr) {
+        continue;
+      }
+      const uintptr_t begin = reinterpret_cast<uintptr_t>(space->Begin());
+      const uintptr_t end = reinterpret_cast<uintptr_t>(space->End());
+      const uintptr_t delta = RoundUp((end - begin) / (thread_count * 4) + 1, kPageSize);
+      for (uintptr_t task_begin = begin; task_begin < end; task_begin += delta) {
+        counters.emplace_back(new ClassCensusCounter);
+        tasks.push_back(new ClassCensusTask(bitmap, task_begin, std::min(task_begin + delta, end),
+                                            counters.back().get()));
+      }
+    }
+    if (thread_count > 1) {
+      for (ClassCensusTask* task : tasks) {
+        thread_pool->AddTask(self, task);
+      }
+      thread_pool->SetMaxActiveWorkers(thread_count - 1);
+      thread_pool->StartWorkers(self);
+    }
+    // The rest of the heap is small, this thread walks it while the workers run.
+    ClassCensusCounter* counter = counters[0].get();
+    if (bump_pointer_space_ != nullptr) {
+      bump_pointer_space_->Walk(ClassCensusCounter::Callback, counter);
+    }
+    for (mirror::Object** it = allocation_stack_->Begin(), **end = allocation_stack_->End();
+        it < end; ++it) {
+      mirror::Object* obj = *it;
+      if (obj != nullptr && obj->GetClass() != nullptr) {
+        counter->Count(obj);
+      }
+    }
+    VisitNewRosAllocObjects(ClassCensusCounter::Callback, counter);
+    for (space::DiscontinuousSpace* space : discontinuous_spaces_) {
+      space->GetLiveBitmap()->Walk(ClassCensusCounter::Callback, counter);
+    }
+    if (thread_count > 1) {
+      thread_pool->Wait(self, true, true);
+      thread_pool->StopWorkers(self);
+    } else {
+      for (ClassCensusTask* task : tasks) {
+        task->Run(self);
+        task->Finalize();
+      }
+    }
+  }
+  // Merge the counts of all the tasks.
+  ClassCensusCounter::Counts counts;
+  for (const std::unique_ptr<ClassCensusCounter>& counter : counters) {
+    for (const auto& class_counts : counter->GetCounts()) {
+      ClassCensusEntry& merged = counts[class_counts.first];
+      merged.count += class_counts.second.count;
+      merged.bytes += class_counts.second.bytes;
+      merged.compact_header_savings += class_counts.second.compact_header_savings;
+      merged.lock_word_count += class_counts.second.lock_word_count;
+    }
+  }
+  census->clear();
+  census->reserve(counts.size());
+  for (const auto& class_counts : counts) {
+    census->push_back(class_counts.second);
+    census->back().klass = class_counts.first;
+  }
+  std::sort(census->begin(), census->end(), CompareClassCensusEntries);
+  self->EndAssertNoThreadSuspension(old_cause);
+  FinishGC(self, collector::kGcTypeNone);
+  return true;
+}
+
+void Heap::DumpClassCensus(std::ostream& os, size_t max_classes) {
+  uint64_t start_time = NanoTime();
+  std::vector<ClassCensusEntry> census;
+  if (!TakeClassCensus(Thread::Current(), false, &census)) {
+    os << "Class census skipped, a GC is running\n";
+    return;
+  }
+  uint64_t total_count = 0;
+  uint64_t total_bytes = 0;
+  uint64_t total_compact_header_savings = 0;
+  uint64_t total_lock_word_count = 0;
+  for (const ClassCensusEntry& entry : census) {
+    total_count += entry.count;
+    total_bytes += entry.bytes;
+    total_compact_header_savings += entry.compact_header_savings;
+    total_lock_word_count += entry.lock_word_count;
+  }
+  os << "Class census: " << total_count << " objects of " << census.size() << " classes, "
+     << PrettySize(total_bytes) << ", took " << PrettyDuration(NanoTime() - start_time) << "\n";
+  os << "Headers without lock words would save " << PrettySize(total_compact_header_savings)
+     << ", " << total_lock_word_count << " objects have a lock word in use\n";
+  for (size_t i = 0; i < std::min(max_classes, census.size()); ++i) {
+    os << StringPrintf("  %10" PRIu64 " %10" PRIu64 " ", census[i].count, census[i].bytes)
+       << PrettyDescriptor(census[i].klass) << "\n";
+  }
+}
+
 class InstanceCollector {
  public:
   InstanceCollector(mirror::Class* c, int32_t max_count, std::vector<mirror::Object*>& instances)
@@ -1390,12 +1881,22 @@ void Heap::TransitionCollector(CollectorType collector_type) {
       }
       break;
     }
+    case kCollectorTypeGenCMS: {
+      // The old generation stays in the main space, only the nursery needs to be usable.
+      CHECK(!IsMovingGc(collector_type_))
+          << "Attempted to transition to GenCMS from " << static_cast<size_t>(collector_type_);
+      bump_pointer_space_->GetMemMap()->Protect(PROT_READ | PROT_WRITE);
+      break;
+    }
     case kCollectorTypeMS:
       // Fall through.
     case kCollectorTypeCMS: {
       if (IsMovingGc(collector_type_)) {
         // Compact to the main space from the bump pointer space, don't need to swap semispaces.
-        AddSpace(main_space_);
+        // The main space of kCollectorTypeGenCMS holds its old generation and was never removed.
+        if (collector_type_ != kCollectorTypeGenCMS) {
+          AddSpace(main_space_);
+        }
         main_space_->GetMemMap()->Protect(PROT_READ | PROT_WRITE);
         Compact(main_space_, bump_pointer_space_);
       }
@@ -1451,10 +1952,26 @@ void Heap::ChangeCollector(CollectorType collector_type) {
         ChangeAllocator(kUseRosAlloc ? kAllocatorTypeRosAlloc : kAllocatorTypeDlMalloc);
         break;
       }
+      case kCollectorTypeGenCMS: {
+        // Sticky collects the nursery, partial and full the old generation.
+        gc_plan_.push_back(collector::kGcTypeSticky);
+        gc_plan_.push_back(collector::kGcTypePartial);
+        gc_plan_.push_back(collector::kGcTypeFull);
+        if (use_tlab_) {
+          ChangeAllocator(kAllocatorTypeTLAB);
+        } else {
+          ChangeAllocator(kAllocatorTypeBumpPointer);
+        }
+        break;
+      }
       default: {
         LOG(FATAL) << "Unimplemented";
       }
     }
+    if (semi_space_collector_ != nullptr &&
+        semi_space_collector_->GetCollectorType() == kCollectorTypeGSS) {
+      semi_space_collector_->SetCollectFromSpaceOnly(collector_type_ == kCollectorTypeGenCMS);
+    }
     if (IsGcConcurrent()) {
       concurrent_start_bytes_ =
           std::max(max_allowed_footprint_, kMinConcurrentRemainingBytes) - kMinConcurrentRemainingBytes;
@@ -1469,6 +1986,10 @@ class ZygoteCompactingCollector FINAL : public collector::SemiSpace {
  public:
   explicit ZygoteCompactingCollector(gc::Heap* heap) : SemiSpace(heap, false, "zygote collector"),
       bin_live_bitmap_(nullptr), bin_mark_bitmap_(nullptr) {
+    // The objects go to the bins first, which MarkNonForwardedObject hands out serially.
+    SetParallelCopying(false);
+    std::fill_n(region_begins_, static_cast<size_t>(kZygoteRegionCount), nullptr);
+    std::fill_n(region_positions_, static_cast<size_t>(kZygoteRegionCount), nullptr);
   }
 
   void BuildBins(space::ContinuousSpace* space) {
@@ -1484,7 +2005,55 @@ class ZygoteCompactingCollector FINAL : public collector::SemiSpace {
     AddBin(reinterpret_cast<uintptr_t>(space->End()) - context.prev_, context.prev_);
   }
 
+  // The objects are sorted with the mutators suspended, before any of them moves.
+  virtual void MarkingPhase() OVERRIDE EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
+    RevokeAllThreadLocalBuffers();
+    SortObjects();
+    SemiSpace::MarkingPhase();
+  }
+
+  // The start of a region of the target space, nullptr for the non-moving region.
+  byte* GetRegionBegin(ZygoteRegion region) const {
+    return region_begins_[region];
+  }
+
  private:
+  // Finds the strings and the likely written objects of the from space, and reserves their regions
+  // at the start of the to space. The immutable region follows and grows with the compaction.
+  void SortObjects() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
+    {
+      WriterMutexLock mu(self_, *Locks::heap_bitmap_lock_);
+      if (from_space_->IsBumpPointerSpace()) {
+        from_space_->AsBumpPointerSpace()->Walk(SortCallback, this);
+      } else {
+        from_space_->GetLiveBitmap()->Walk(SortCallback, this);
+      }
+    }
+    size_t region_sizes[kZygoteRegionCount] = {};
+    for (const auto& object_region : object_regions_) {
+      region_sizes[object_region.second] +=
+          RoundUp(object_region.first->SizeOf(), kObjectAlignment);
+    }
+    const size_t reserved_size = region_sizes[kZygoteRegionStrings] +
+        region_sizes[kZygoteRegionWritten];
+    byte* begin = to_space_->End();
+    if (reserved_size != 0) {
+      size_t bytes_allocated;
+      begin = reinterpret_cast<byte*>(to_space_->Alloc(self_, reserved_size, &bytes_allocated,
+                                                       nullptr));
+      CHECK(begin != nullptr) << "Failed to reserve " << PrettySize(reserved_size)
+                              << " for the zygote regions";
+    }
+    region_begins_[kZygoteRegionStrings] = begin;
+    region_begins_[kZygoteRegionWritten] = begin + region_sizes[kZygoteRegionStrings];
+    region_begins_[kZygoteRegionImmutable] = begin + reserved_size;
+    std::copy(region_begins_, region_begins_ + kZygoteRegionCount, region_positions_);
+    VLOG(heap) << "Zygote regions: strings " << PrettySize(region_sizes[kZygoteRegionStrings])
+               << ", written " << PrettySize(region_sizes[kZygoteRegionWritten]);
+  }
+
   struct BinContext {
     uintptr_t prev_;  // The end of the previous object.
     ZygoteCompactingCollector* collector_;
@@ -1495,6 +2064,12 @@ class ZygoteCompactingCollector FINAL : public collector::SemiSpace {
   accounting::ContinuousSpaceBitmap* bin_live_bitmap_;
   // Mark bitmap of the space which contains the bins.
   accounting::ContinuousSpaceBitmap* bin_mark_bitmap_;
+  // The region of the objects of the from space which aren't immutable.
+  std::unordered_map<mirror::Object*, ZygoteRegion> object_regions_;
+  // The start and the allocation position of each region of the target space. The strings and the
+  // written regions end where the next region starts.
+  byte* region_begins_[kZygoteRegionCount];
+  byte* region_positions_[kZygoteRegionCount];
 
   static void Callback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -1508,6 +2083,69 @@ class ZygoteCompactingCollector FINAL : public collector::SemiSpace {
     context->prev_ = object_addr + RoundUp(obj->SizeOf(), kObjectAlignment);
   }
 
+  static void SortCallback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    DCHECK(arg != nullptr);
+    reinterpret_cast<ZygoteCompactingCollector*>(arg)->SortObject(obj);
+  }
+
+  void SortObject(mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (obj->GetClass()->IsStringClass()) {
+      SetRegion(obj, kZygoteRegionStrings);
+    } else if (obj->IsClass()) {
+      mirror::Class* klass = obj->AsClass();
+      if (IsLikelyWritten(klass)) {
+        SetRegion(klass, kZygoteRegionWritten);
+      }
+      // The children resolve strings, types, methods and fields into the dex caches.
+      mirror::DexCache* dex_cache = klass->GetDexCache();
+      if (dex_cache != nullptr && GetRegion(dex_cache) != kZygoteRegionWritten) {
+        SetRegion(dex_cache, kZygoteRegionWritten);
+        SetRegion(dex_cache->GetStrings(), kZygoteRegionWritten);
+        SetRegion(dex_cache->GetResolvedTypes(), kZygoteRegionWritten);
+        SetRegion(dex_cache->GetResolvedMethods(), kZygoteRegionWritten);
+        SetRegion(dex_cache->GetResolvedFields(), kZygoteRegionWritten);
+      }
+    }
+  }
+
+  // A class gets written when the children initialize it or write its static fields.
+  static bool IsLikelyWritten(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (!klass->IsInitialized()) {
+      return true;
+    }
+    const size_t num_static_fields = klass->NumStaticFields();
+    for (size_t i = 0; i < num_static_fields; ++i) {
+      if (!klass->GetStaticField(i)->IsFinal()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Only records the objects of the sorted space, the other ones don't move.
+  void SetRegion(mirror::Object* obj, ZygoteRegion region) {
+    if (obj != nullptr && from_space_->HasAddress(obj)) {
+      object_regions_[obj] = region;
+    }
+  }
+
+  ZygoteRegion GetRegion(mirror::Object* obj) const {
+    auto it = object_regions_.find(obj);
+    return it != object_regions_.end() ? it->second : kZygoteRegionImmutable;
+  }
+
+  // Returns the next position of the region if obj fits before the region ends, nullptr otherwise.
+  mirror::Object* AllocInRegion(ZygoteRegion region, size_t object_size) {
+    DCHECK_LT(region, kZygoteRegionImmutable);
+    byte* position = region_positions_[region];
+    if (position == nullptr || position + object_size > region_begins_[region + 1]) {
+      return nullptr;
+    }
+    region_positions_[region] = position + object_size;
+    return reinterpret_cast<mirror::Object*>(position);
+  }
+
   void AddBin(size_t size, uintptr_t position) {
     if (size != 0) {
       bins_.insert(std::make_pair(size, position));
@@ -1523,14 +2161,21 @@ class ZygoteCompactingCollector FINAL : public collector::SemiSpace {
   virtual mirror::Object* MarkNonForwardedObject(mirror::Object* obj)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_, Locks::mutator_lock_) {
     size_t object_size = RoundUp(obj->SizeOf(), kObjectAlignment);
-    mirror::Object* forward_address;
-    // Find the smallest bin which we can move obj in.
-    auto it = bins_.lower_bound(object_size);
+    mirror::Object* forward_address = nullptr;
+    const ZygoteRegion region = GetRegion(obj);
+    // Find the smallest bin which we can move obj in, only immutable objects fill the bins so that
+    // they don't get dirtied along with the written objects.
+    auto it = region == kZygoteRegionImmutable ? bins_.lower_bound(object_size) : bins_.end();
     if (it == bins_.end()) {
-      // No available space in the bins, place it in the target space instead (grows the zygote
-      // space).
-      size_t bytes_allocated;
-      forward_address = to_space_->Alloc(self_, object_size, &bytes_allocated, nullptr);
+      if (region != kZygoteRegionImmutable) {
+        forward_address = AllocInRegion(region, object_size);
+      }
+      if (forward_address == nullptr) {
+        // No available space in the bins or in the region, place it in the target space instead
+        // (grows the zygote space).
+        size_t bytes_allocated;
+        forward_address = to_space_->Alloc(self_, object_size, &bytes_allocated, nullptr);
+      }
       if (to_space_live_bitmap_ != nullptr) {
         to_space_live_bitmap_->Set(forward_address);
       } else {
@@ -1611,6 +2256,9 @@ void Heap::PreZygoteFork() {
     zygote_collector.SetToSpace(&target_space);
     zygote_collector.SetSwapSemiSpaces(false);
     zygote_collector.Run(kGcCauseCollectorTransition, false);
+    for (size_t i = kZygoteRegionStrings; i < kZygoteRegionCount; ++i) {
+      zygote_region_begins_[i] = zygote_collector.GetRegionBegin(static_cast<ZygoteRegion>(i));
+    }
     if (reset_main_space) {
       main_space_->GetMemMap()->Protect(PROT_READ | PROT_WRITE);
       madvise(main_space_->Begin(), main_space_->Capacity(), MADV_DONTNEED);
@@ -1656,6 +2304,14 @@ void Heap::PreZygoteFork() {
                                                                         &non_moving_space_);
   delete old_alloc_space;
   CHECK(zygote_space != nullptr) << "Failed creating zygote space";
+  zygote_region_begins_[kZygoteRegionNonMoving] = zygote_space->Begin();
+  zygote_end_ = zygote_space->End();
+  for (size_t i = kZygoteRegionStrings; i < kZygoteRegionCount; ++i) {
+    // Without compaction all of the zygote space is the non-moving region.
+    if (zygote_region_begins_[i] == nullptr) {
+      zygote_region_begins_[i] = zygote_end_;
+    }
+  }
   AddSpace(zygote_space);
   non_moving_space_->SetFootprintLimit(non_moving_space_->Capacity());
   AddSpace(non_moving_space_);
@@ -1710,6 +2366,30 @@ void Heap::SwapSemiSpaces() {
   std::swap(bump_pointer_space_, temp_space_);
 }
 
+bool Heap::EvacuateNursery(GcCause gc_cause, bool clear_soft_references) {
+  ThreadList* tl = Runtime::Current()->GetThreadList();
+  tl->SuspendAll();
+  temp_space_->GetMemMap()->Protect(PROT_READ | PROT_WRITE);
+  CHECK(temp_space_->IsEmpty());
+  semi_space_collector_->SetFromSpace(bump_pointer_space_);
+  semi_space_collector_->SetToSpace(temp_space_);
+  semi_space_collector_->SetSwapSemiSpaces(true);
+  semi_space_collector_->SetPromoteAllObjects(true);
+  semi_space_collector_->Run(gc_cause, clear_soft_references);
+  semi_space_collector_->SetPromoteAllObjects(false);
+  total_objects_freed_ever_ += semi_space_collector_->GetFreedObjects();
+  total_bytes_freed_ever_ += semi_space_collector_->GetFreedBytes();
+  // The semi spaces were swapped, the objects which couldn't be promoted are in the nursery.
+  const bool evacuated = bump_pointer_space_->IsEmpty();
+  if (evacuated) {
+    ChangeAllocator(kUseRosAlloc ? kAllocatorTypeRosAlloc : kAllocatorTypeDlMalloc);
+  } else {
+    LOG(WARNING) << "Main space full, not collecting the old generation";
+  }
+  tl->ResumeAll();
+  return evacuated;
+}
+
 void Heap::Compact(space::ContinuousMemMapAllocSpace* target_space,
                    space::ContinuousMemMapAllocSpace* source_space) {
   CHECK(kMovingCollector);
@@ -1780,7 +2460,24 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
 
   collector::GarbageCollector* collector = nullptr;
   // TODO: Clean this up.
-  if (compacting_gc) {
+  if (collector_type_ == kCollectorTypeGenCMS) {
+    DCHECK(current_allocator_ == kAllocatorTypeBumpPointer ||
+           current_allocator_ == kAllocatorTypeTLAB);
+    if (gc_type != collector::kGcTypeSticky && EvacuateNursery(gc_cause, clear_soft_references)) {
+      collector = FindCollectorByGcType(gc_type);
+    } else {
+      // Copy the survivors of the nursery, the oldest ones are promoted to the main space. This
+      // is also the collection which ran if the nursery couldn't be emptied for the old
+      // generation.
+      temp_space_->GetMemMap()->Protect(PROT_READ | PROT_WRITE);
+      CHECK(temp_space_->IsEmpty());
+      semi_space_collector_->SetFromSpace(bump_pointer_space_);
+      semi_space_collector_->SetToSpace(temp_space_);
+      semi_space_collector_->SetSwapSemiSpaces(true);
+      collector = semi_space_collector_;
+      gc_type = collector::kGcTypeSticky;
+    }
+  } else if (compacting_gc) {
     DCHECK(current_allocator_ == kAllocatorTypeBumpPointer ||
            current_allocator_ == kAllocatorTypeTLAB);
     if (collector_type_ == kCollectorTypeSS || collector_type_ == kCollectorTypeGSS) {
@@ -1791,6 +2488,8 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
       semi_space_collector_->SetSwapSemiSpaces(true);
     } else if (collector_type_ == kCollectorTypeCC) {
       gc_type = concurrent_copying_collector_->GetGcType();
+      concurrent_copying_collector_->SetFromSpace(bump_pointer_space_);
+      concurrent_copying_collector_->SetToSpace(temp_space_);
       collector = concurrent_copying_collector_;
     } else {
       LOG(FATAL) << "Unreachable - invalid collector type " << static_cast<size_t>(collector_type_);
@@ -1811,6 +2510,29 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
   collector->Run(gc_cause, clear_soft_references || runtime->IsZygote());
   total_objects_freed_ever_ += collector->GetFreedObjects();
   total_bytes_freed_ever_ += collector->GetFreedBytes();
+  if (use_tlab_) {
+    last_gc_tlab_waste_bytes_ = 0;
+    for (space::BumpPointerSpace* space : { bump_pointer_space_, temp_space_ }) {
+      if (space != nullptr) {
+        last_gc_tlab_waste_bytes_ += space->TakeTlabWasteBytes();
+      }
+    }
+    total_tlab_waste_bytes_ += last_gc_tlab_waste_bytes_;
+    // The TLABs were counted as allocated in full when they were handed out.
+    num_bytes_allocated_.FetchAndSubSequentiallyConsistent(last_gc_tlab_waste_bytes_);
+  }
+  if (collector_type_ == kCollectorTypeGenCMS && collector != semi_space_collector_) {
+    // The old generation was collected, allocate in the nursery again.
+    ThreadList* tl = runtime->GetThreadList();
+    tl->SuspendAll();
+    if (use_tlab_) {
+      ChangeAllocator(kAllocatorTypeTLAB);
+    } else {
+      ChangeAllocator(kAllocatorTypeBumpPointer);
+    }
+    tl->ResumeAll();
+    semi_space_collector_->WholeHeapCollected();
+  }
   RequestHeapTrim();
   // Enqueue cleared references.
   reference_processor_.EnqueueClearedReferences();
@@ -1838,6 +2560,16 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
         pause_string << PrettyDuration((pause_times[i] / 1000) * 1000)
                      << ((i != pause_times.size() - 1) ? "," : "");
     }
+    std::ostringstream blocked_string;
+    const size_t blocked_count = reference_processor_.GetLastBlockedGetReferentCount();
+    if (blocked_count != 0) {
+      blocked_string << ", " << blocked_count << " GetReferent calls blocked for "
+                     << PrettyDuration(reference_processor_.GetLastBlockedGetReferentNs());
+    }
+    std::ostringstream tlab_string;
+    if (use_tlab_) {
+      tlab_string << ", " << PrettySize(last_gc_tlab_waste_bytes_) << " TLAB waste";
+    }
     LOG(INFO) << gc_cause << " " << collector->GetName()
               << " GC freed "  <<  collector->GetFreedObjects() << "("
               << PrettySize(collector->GetFreedBytes()) << ") AllocSpace objects, "
@@ -1845,7 +2577,8 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
               << PrettySize(collector->GetFreedLargeObjectBytes()) << ") LOS objects, "
               << percent_free << "% free, " << PrettySize(current_heap_size) << "/"
               << PrettySize(total_memory) << ", " << "paused " << pause_string.str()
-              << " total " << PrettyDuration((duration / 1000) * 1000);
+              << " total " << PrettyDuration((duration / 1000) * 1000)
+              << blocked_string.str() << tlab_string.str();
     VLOG(heap) << ConstDumpable<TimingLogger>(collector->GetTimings());
   }
   FinishGC(self, gc_type);
@@ -2003,13 +2736,16 @@ class VerifyReferenceVisitor {
                          byte_cover_begin + accounting::CardTable::kCardSize, scan_visitor);
       }
 
-      // Search to see if any of the roots reference our object.
-      void* arg = const_cast<void*>(reinterpret_cast<const void*>(obj));
-      Runtime::Current()->VisitRoots(&RootMatchesObjectVisitor, arg);
+      // The thread pool workers verifying in parallel can't visit the roots.
+      if (Locks::mutator_lock_->IsExclusiveHeld(Thread::Current())) {
+        // Search to see if any of the roots reference our object.
+        void* arg = const_cast<void*>(reinterpret_cast<const void*>(obj));
+        Runtime::Current()->VisitRoots(&RootMatchesObjectVisitor, arg);
 
-      // Search to see if any of the roots reference our reference.
-      arg = const_cast<void*>(reinterpret_cast<const void*>(ref));
-      Runtime::Current()->VisitRoots(&RootMatchesObjectVisitor, arg);
+        // Search to see if any of the roots reference our reference.
+        arg = const_cast<void*>(reinterpret_cast<const void*>(ref));
+        Runtime::Current()->VisitRoots(&RootMatchesObjectVisitor, arg);
+      }
     }
     return false;
   }
@@ -2022,12 +2758,17 @@ class VerifyReferenceVisitor {
 // Verify all references within an object, for use with HeapBitmap::Visit.
 class VerifyObjectVisitor {
  public:
-  explicit VerifyObjectVisitor(Heap* heap, Atomic<size_t>* fail_count, bool verify_referent)
-      : heap_(heap), fail_count_(fail_count), verify_referent_(verify_referent) {
+  explicit VerifyObjectVisitor(Heap* heap, Atomic<size_t>* fail_count, bool verify_referent,
+                               size_t sample_percent = 100, uint32_t sample_seed = 0)
+      : heap_(heap), fail_count_(fail_count), verify_referent_(verify_referent),
+        sample_percent_(sample_percent), sample_seed_(sample_seed) {
   }
 
   void operator()(mirror::Object* obj) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_) {
+    if (sample_percent_ < 100 && !IsSampled(obj)) {
+      return;
+    }
     // Note: we are verifying the references in obj but not obj itself, this is because obj must
     // be live or else how did we find it in the live bitmap?
     VerifyReferenceVisitor visitor(heap_, fail_count_, verify_referent_);
@@ -2046,9 +2787,19 @@ class VerifyObjectVisitor {
   }
 
  private:
+  // Hashes the address rather than counting the objects so that the threads walking the heap in
+  // parallel agree on the sample. The seed changes the sample from one verification to the next.
+  bool IsSampled(const mirror::Object* obj) const {
+    uint64_t hash = (reinterpret_cast<uintptr_t>(obj) / kObjectAlignment) ^ sample_seed_;
+    hash *= UINT64_C(0x9E3779B97F4A7C15);
+    return (hash >> 32) % 100 < sample_percent_;
+  }
+
   Heap* const heap_;
   Atomic<size_t>* const fail_count_;
   const bool verify_referent_;
+  const size_t sample_percent_;
+  const uint32_t sample_seed_;
 };
 
 void Heap::PushOnAllocationStackWithInternalGC(Thread* self, mirror::Object** obj) {
@@ -2089,7 +2840,7 @@ void Heap::PushOnThreadLocalAllocationStackWithInternalGC(Thread* self, mirror::
 }
 
 // Must do this with mutators suspended since we are directly accessing the allocation stacks.
-size_t Heap::VerifyHeapReferences(bool verify_referents) {
+size_t Heap::VerifyHeapReferences(bool verify_referents, size_t sample_percent) {
   Thread* self = Thread::Current();
   Locks::mutator_lock_->AssertExclusiveHeld(self);
   // Lets sort our allocation stacks so that we can efficiently binary search them.
@@ -2099,13 +2850,14 @@ size_t Heap::VerifyHeapReferences(bool verify_referents) {
   // thread-local allocation stacks.
   RevokeAllThreadLocalAllocationStacks(self);
   Atomic<size_t> fail_count_(0);
-  VerifyObjectVisitor visitor(this, &fail_count_, verify_referents);
+  VerifyObjectVisitor visitor(this, &fail_count_, verify_referents, sample_percent,
+                              static_cast<uint32_t>(NanoTime()));
   // Verify objects in the allocation stack since these will be objects which were:
   // 1. Allocated prior to the GC (pre GC verification).
   // 2. Allocated during the GC (pre sweep GC verification).
   // We don't want to verify the objects in the live stack since they themselves may be
   // pointing to dead objects if they are not reachable.
-  VisitObjects(VerifyObjectVisitor::VisitCallback, &visitor);
+  VisitObjectsParallel(self, VerifyObjectVisitor::VisitCallback, &visitor);
   // Verify the roots:
   Runtime::Current()->VisitRoots(VerifyReferenceVisitor::VerifyRootCallback, &visitor);
   if (visitor.GetFailureCount() > 0) {
@@ -2205,17 +2957,27 @@ class VerifyLiveStackReferences {
 
   void operator()(mirror::Object* obj) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_) {
-    VerifyReferenceCardVisitor visitor(heap_, const_cast<bool*>(&failed_));
+    bool failed = false;
+    VerifyReferenceCardVisitor visitor(heap_, &failed);
     obj->VisitReferences<true>(visitor, VoidFunctor());
+    if (failed) {
+      failed_.StoreRelaxed(true);
+    }
+  }
+
+  static void VisitCallback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_) {
+    reinterpret_cast<VerifyLiveStackReferences*>(arg)->operator()(obj);
   }
 
   bool Failed() const {
-    return failed_;
+    return failed_.LoadRelaxed();
   }
 
  private:
   Heap* const heap_;
-  bool failed_;
+  // Set by the thread pool workers in parallel.
+  mutable Atomic<bool> failed_;
 };
 
 bool Heap::VerifyMissingCardMarks() {
@@ -2228,7 +2990,7 @@ bool Heap::VerifyMissingCardMarks() {
   // thread-local allocation stacks.
   RevokeAllThreadLocalAllocationStacks(self);
   VerifyLiveStackReferences visitor(this);
-  GetLiveBitmap()->Visit(visitor);
+  VisitLiveBitmapParallel(self, VerifyLiveStackReferences::VisitCallback, &visitor);
 
   // We can verify objects in the live stack since none of these should reference dead objects.
   for (mirror::Object** it = live_stack_->Begin(); it != live_stack_->End(); ++it) {
@@ -2248,9 +3010,89 @@ void Heap::SwapStacks(Thread* self) {
   if (kUseThreadLocalAllocationStack) {
     live_stack_->AssertAllZero();
   }
+  PushNewRosAllocObjects(self);
   allocation_stack_.swap(live_stack_);
 }
 
+struct NewRosAllocObjectsContext {
+  accounting::ContinuousSpaceBitmap* live_bitmap;
+  ObjectCallback* callback;
+  void* arg;
+};
+
+// The callers of VisitNewAllocations() hold the mutator lock.
+static void NewRosAllocObjectCallback(void* ptr, void* arg) NO_THREAD_SAFETY_ANALYSIS {
+  NewRosAllocObjectsContext* context = reinterpret_cast<NewRosAllocObjectsContext*>(arg);
+  mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr);
+  // The runs also hold the objects which were live before they were handed out again, and
+  // the objects being allocated may not have their class yet.
+  if (!context->live_bitmap->Test(obj) && obj->GetClass() != nullptr) {
+    context->callback(obj, context->arg);
+  }
+}
+
+void Heap::VisitNewRosAllocObjects(ObjectCallback* callback, void* arg) {
+  if (running_on_valgrind_) {
+    return;
+  }
+  for (space::ContinuousSpace* space : continuous_spaces_) {
+    if (space->IsRosAllocSpace()) {
+      NewRosAllocObjectsContext context = { space->GetLiveBitmap(), callback, arg };
+      space->AsRosAllocSpace()->GetRosAlloc()->VisitNewAllocations(NewRosAllocObjectCallback,
+                                                                   &context, false);
+    }
+  }
+}
+
+struct PushNewRosAllocObjectsContext {
+  accounting::ContinuousSpaceBitmap* live_bitmap;
+  accounting::ObjectStack* stack;
+  std::vector<mirror::Object*>* overflow;
+};
+
+static void PushNewRosAllocObjectCallback(void* ptr, void* arg) {
+  PushNewRosAllocObjectsContext* context = reinterpret_cast<PushNewRosAllocObjectsContext*>(arg);
+  mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr);
+  if (!context->live_bitmap->Test(obj) &&
+      !context->stack->AtomicPushBackIgnoreGrowthLimit(obj)) {
+    context->overflow->push_back(obj);
+  }
+}
+
+void Heap::PushNewRosAllocObjects(Thread* self) {
+  Locks::mutator_lock_->AssertExclusiveHeld(self);
+  if (running_on_valgrind_) {
+    return;
+  }
+  std::vector<mirror::Object*> overflow;
+  for (space::ContinuousSpace* space : continuous_spaces_) {
+    if (space->IsRosAllocSpace()) {
+      PushNewRosAllocObjectsContext context = { space->GetLiveBitmap(), allocation_stack_.get(),
+                                                &overflow };
+      space->AsRosAllocSpace()->GetRosAlloc()->VisitNewAllocations(PushNewRosAllocObjectCallback,
+                                                                   &context, true);
+    }
+  }
+  if (UNLIKELY(!overflow.empty())) {
+    // Resizing unmaps the stack the thread-local allocation stacks point into.
+    if (kUseThreadLocalAllocationStack) {
+      RevokeAllThreadLocalAllocationStacks(self);
+    }
+    std::vector<mirror::Object*> temp(allocation_stack_->Begin(), allocation_stack_->End());
+    const size_t new_capacity = std::max(allocation_stack_->Capacity() * 2,
+                                         temp.size() + overflow.size());
+    VLOG(heap) << "Growing the allocation stack to " << new_capacity << " for "
+               << overflow.size() << " more new RosAlloc objects";
+    allocation_stack_->Resize(new_capacity);
+    for (mirror::Object* obj : temp) {
+      CHECK(allocation_stack_->AtomicPushBack(obj));
+    }
+    for (mirror::Object* obj : overflow) {
+      CHECK(allocation_stack_->AtomicPushBack(obj));
+    }
+  }
+}
+
 void Heap::RevokeAllThreadLocalAllocationStacks(Thread* self) {
   // This must be called only during the pause.
   CHECK(Locks::mutator_lock_->IsExclusiveHeld(self));
@@ -2286,18 +3128,22 @@ accounting::RememberedSet* Heap::FindRememberedSetFromSpace(space::Space* space)
   return it->second;
 }
 
-void Heap::ProcessCards(TimingLogger& timings, bool use_rem_sets) {
+void Heap::ProcessCards(TimingLogger& timings, bool use_rem_sets, bool clear_rem_set_slots) {
   // Clear cards and keep track of cards cleared in the mod-union table.
   for (const auto& space : continuous_spaces_) {
     accounting::ModUnionTable* table = FindModUnionTableFromSpace(space);
     accounting::RememberedSet* rem_set = FindRememberedSetFromSpace(space);
+    if (clear_rem_set_slots && rem_set != nullptr) {
+      rem_set->ClearSlots();
+    }
     if (table != nullptr) {
       const char* name = space->IsZygoteSpace() ? "ZygoteModUnionClearCards" :
           "ImageModUnionClearCards";
       TimingLogger::ScopedSplit split(name, &timings);
       table->ClearCards();
     } else if (use_rem_sets && rem_set != nullptr) {
-      DCHECK(collector::SemiSpace::kUseRememberedSet && collector_type_ == kCollectorTypeGSS)
+      DCHECK(collector::SemiSpace::kUseRememberedSet &&
+             (collector_type_ == kCollectorTypeGSS || collector_type_ == kCollectorTypeGenCMS))
           << static_cast<int>(collector_type_);
       TimingLogger::ScopedSplit split("AllocSpaceRemSetClearCards", &timings);
       rem_set->ClearCards();
@@ -2403,21 +3249,24 @@ void Heap::PostGcVerificationPaused(collector::GarbageCollector* gc) {
   if (verify_post_gc_rosalloc_) {
     RosAllocVerification(timings, "PostGcRosAllocVerification");
   }
-  if (verify_post_gc_heap_) {
+  if (verify_post_gc_heap_ || verify_sample_percent_ > 0) {
     TimingLogger::ScopedSplit split("PostGcVerifyHeapReferences", timings);
     ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-    size_t failures = VerifyHeapReferences();
+    // Without postverify, only sample the heap.
+    const size_t sample_percent = verify_post_gc_heap_ ? 100 : verify_sample_percent_;
+    size_t failures = VerifyHeapReferences(true, sample_percent);
     if (failures > 0) {
-      LOG(FATAL) << "Pre " << gc->GetName() << " heap verification failed with " << failures
+      LOG(FATAL) << "Post " << gc->GetName() << " heap verification failed with " << failures
           << " failures";
     }
   }
 }
 
 void Heap::PostGcVerification(collector::GarbageCollector* gc) {
-  if (verify_system_weaks_ || verify_post_gc_rosalloc_ || verify_post_gc_heap_) {
+  if (verify_system_weaks_ || verify_post_gc_rosalloc_ || verify_post_gc_heap_ ||
+      verify_sample_percent_ > 0) {
     collector::GarbageCollector::ScopedPause pause(gc);
-    PreGcVerificationPaused(gc);
+    PostGcVerificationPaused(gc);
   }
 }
 
@@ -2456,10 +3305,98 @@ collector::GcType Heap::WaitForGcToCompleteLocked(GcCause cause, Thread* self) {
   return last_gc_type;
 }
 
-void Heap::DumpForSigQuit(std::ostream& os) {
+void Heap::DumpForSigQuit(std::ostream& os, bool take_class_census) {
   os << "Heap: " << GetPercentFree() << "% free, " << PrettySize(GetBytesAllocated()) << "/"
      << PrettySize(GetTotalMemory()) << "; " << GetObjectsAllocated() << " objects\n";
   DumpGcPerformanceInfo(os);
+  if (take_class_census) {
+    DumpClassCensus(os, kSigQuitClassCensusSize);
+  }
+  DumpZygotePageSharing(os);
+}
+
+// The pagemap entry of a page tells whether it is resident and whether only this process maps it.
+// The zygote pages a child wrote are its own copies, as are the image pages it wrote since the
+// image is a private file mapping.
+static constexpr uint64_t kPagemapPresent = UINT64_C(1) << 63;
+static constexpr uint64_t kPagemapExclusive = UINT64_C(1) << 56;
+
+// Counts the resident pages of [begin, end), and those of them which only this process maps. A
+// page which spans two ranges counts in both.
+static bool CountPrivatePages(int pagemap_fd, const byte* begin, const byte* end,
+                              size_t* resident_pages, size_t* private_pages) {
+  const uintptr_t first_page = reinterpret_cast<uintptr_t>(begin) / kPageSize;
+  const uintptr_t end_page = RoundUp(reinterpret_cast<uintptr_t>(end), kPageSize) / kPageSize;
+  if (first_page >= end_page) {
+    return true;
+  }
+  std::vector<uint64_t> entries(end_page - first_page);
+  const size_t length = entries.size() * sizeof(entries[0]);
+  const off_t offset = static_cast<off_t>(first_page * sizeof(entries[0]));
+  if (TEMP_FAILURE_RETRY(pread(pagemap_fd, &entries[0], length, offset)) !=
+      static_cast<ssize_t>(length)) {
+    return false;
+  }
+  for (uint64_t entry : entries) {
+    if ((entry & kPagemapPresent) != 0) {
+      ++*resident_pages;
+      if ((entry & kPagemapExclusive) != 0) {
+        ++*private_pages;
+      }
+    }
+  }
+  return true;
+}
+
+void Heap::DumpZygotePageSharing(std::ostream& os) {
+  if (!have_zygote_space_) {
+    return;
+  }
+  int pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+  if (pagemap_fd == -1) {
+    VLOG(heap) << "Failed to open /proc/self/pagemap: " << strerror(errno);
+    return;
+  }
+  std::ostringstream oss;
+  bool success = true;
+  oss << "Zygote private/resident pages:";
+  for (size_t i = kZygoteRegionNonMoving; i < kZygoteRegionCount && success; ++i) {
+    const byte* end = i + 1 < kZygoteRegionCount ? zygote_region_begins_[i + 1] : zygote_end_;
+    size_t resident_pages = 0;
+    size_t private_pages = 0;
+    success = CountPrivatePages(pagemap_fd, zygote_region_begins_[i], end, &resident_pages,
+                                &private_pages);
+    oss << " " << static_cast<ZygoteRegion>(i) << " " << private_pages << "/" << resident_pages;
+  }
+  size_t resident_pages = 0;
+  size_t private_pages = 0;
+  for (const auto& space : continuous_spaces_) {
+    if (space->IsImageSpace() && success) {
+      success = CountPrivatePages(pagemap_fd, space->Begin(), space->End(), &resident_pages,
+                                  &private_pages);
+    }
+  }
+  oss << ", image " << private_pages << "/" << resident_pages << "\n";
+  close(pagemap_fd);
+  if (success) {
+    os << oss.str();
+  } else {
+    VLOG(heap) << "Failed to read /proc/self/pagemap: " << strerror(errno);
+  }
+}
+
+ZygoteRegion Heap::GetZygoteRegion(const mirror::Object* obj) const {
+  const byte* addr = reinterpret_cast<const byte*>(obj);
+  if (!have_zygote_space_ || addr < zygote_region_begins_[kZygoteRegionNonMoving] ||
+      addr >= zygote_end_) {
+    return kZygoteRegionCount;
+  }
+  size_t region = kZygoteRegionNonMoving;
+  // Skip the empty regions, which start where the next one starts.
+  while (region + 1 < kZygoteRegionCount && addr >= zygote_region_begins_[region + 1]) {
+    ++region;
+  }
+  return static_cast<ZygoteRegion>(region);
 }
 
 size_t Heap::GetPercentFree() {
@@ -2500,8 +3437,17 @@ void Heap::UpdateMaxNativeFootprint() {
 }
 
 collector::GarbageCollector* Heap::FindCollectorByGcType(collector::GcType gc_type) {
+  CollectorType collector_type = collector_type_;
+  if (collector_type_ == kCollectorTypeGenCMS) {
+    // The nursery is collected by the generational semi space collector, the old generation by
+    // the concurrent mark sweep collectors.
+    if (gc_type == collector::kGcTypeSticky) {
+      return semi_space_collector_;
+    }
+    collector_type = kCollectorTypeCMS;
+  }
   for (const auto& collector : garbage_collectors_) {
-    if (collector->GetCollectorType() == collector_type_ &&
+    if (collector->GetCollectorType() == collector_type &&
         collector->GetGcType() == gc_type) {
       return collector;
     }
@@ -2525,11 +3471,32 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran) {
   last_gc_time_ns_ = NanoTime();
   uint64_t target_size;
   collector::GcType gc_type = collector_ran->GetGcType();
+  // The bytes estimated to be allocated while a concurrent GC runs.
+  const double gc_duration_seconds = NsToMs(collector_ran->GetDurationNs()) / 1000.0;
+  uint64_t gc_allocated_bytes = allocation_rate_ * gc_duration_seconds;
+  if (gc_pacing_) {
+    const uint64_t stall_count = allocation_stall_count_.LoadRelaxed();
+    if (stall_count != last_gc_allocation_stall_count_) {
+      concurrent_start_headroom_ =
+          std::min(concurrent_start_headroom_ * kPacingHeadroomGrowth, kPacingMaxHeadroom);
+    } else {
+      concurrent_start_headroom_ =
+          std::max(concurrent_start_headroom_ * kPacingHeadroomDecay, 1.0);
+    }
+    last_gc_allocation_stall_count_ = stall_count;
+    gc_allocated_bytes *= concurrent_start_headroom_;
+    VLOG(heap) << "GC pacing headroom " << concurrent_start_headroom_ << ", "
+               << PrettySize(gc_allocated_bytes) << " allocated during a GC";
+  }
   if (gc_type != collector::kGcTypeSticky) {
     // Grow the heap for non sticky GC.
     const float multiplier = HeapGrowthMultiplier();  // Use the multiplier to grow more for
     // foreground.
-    intptr_t delta = bytes_allocated / GetTargetHeapUtilization() - bytes_allocated;
+    // The objects the GC kept alive only for their finalizers die once the finalizer daemon got to
+    // them, don't grow the heap for them: a finalizer backlog then makes the next GC come sooner.
+    const uint64_t surviving_bytes = bytes_allocated -
+        std::min(reference_processor_.GetLastFinalizableBytes(), bytes_allocated);
+    intptr_t delta = surviving_bytes / GetTargetHeapUtilization() - surviving_bytes;
     CHECK_GE(delta, 0);
     target_size = bytes_allocated + delta * multiplier;
     target_size = std::min(target_size,
@@ -2548,8 +3515,13 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran) {
     // We also check that the bytes allocated aren't over the footprint limit in order to prevent a
     // pathological case where dead objects which aren't reclaimed by sticky could get accumulated
     // if the sticky GC throughput always remained >= the full/partial throughput.
-    if (collector_ran->GetEstimatedLastIterationThroughput() * kStickyGcThroughputAdjustment >=
-        non_sticky_collector->GetEstimatedMeanThroughput() &&
+    // The nursery of kCollectorTypeGenCMS is collected until enough was promoted for the old
+    // generation to be collected instead.
+    if (collector_type_ == kCollectorTypeGenCMS) {
+      next_gc_type_ = semi_space_collector_->ShouldCollectWholeHeap() ? non_sticky_gc_type :
+          collector::kGcTypeSticky;
+    } else if (collector_ran->GetEstimatedLastIterationThroughput() *
+        kStickyGcThroughputAdjustment >= non_sticky_collector->GetEstimatedMeanThroughput() &&
         non_sticky_collector->GetIterations() > 0 &&
         bytes_allocated <= max_allowed_footprint_) {
       next_gc_type_ = collector::kGcTypeSticky;
@@ -2563,15 +3535,22 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran) {
       target_size = std::max(bytes_allocated, static_cast<uint64_t>(max_allowed_footprint_));
     }
   }
+  if (gc_pacing_ && IsGcConcurrent()) {
+    // Leave room for the allocations of the next concurrent GC on top of min_free_, otherwise the
+    // next GC has to start right away to finish before the heap is exhausted.
+    target_size = std::max(target_size, bytes_allocated + gc_allocated_bytes + min_free_);
+  }
   if (!ignore_max_footprint_) {
     SetIdealFootprint(target_size);
     if (IsGcConcurrent()) {
       // Calculate when to perform the next ConcurrentGC.
-      // Calculate the estimated GC duration.
-      const double gc_duration_seconds = NsToMs(collector_ran->GetDurationNs()) / 1000.0;
       // Estimate how many remaining bytes we will have when we need to start the next GC.
-      size_t remaining_bytes = allocation_rate_ * gc_duration_seconds;
-      remaining_bytes = std::min(remaining_bytes, kMaxConcurrentRemainingBytes);
+      size_t remaining_bytes = gc_allocated_bytes;
+      if (gc_pacing_) {
+        remaining_bytes = std::min(remaining_bytes, max_allowed_footprint_ / 2);
+      } else {
+        remaining_bytes = std::min(remaining_bytes, kMaxConcurrentRemainingBytes);
+      }
       remaining_bytes = std::max(remaining_bytes, kMinConcurrentRemainingBytes);
       if (UNLIKELY(remaining_bytes > max_allowed_footprint_)) {
         // A never going to happen situation that from the estimated allocation rate we will exceed
@@ -2735,6 +3714,14 @@ void Heap::RevokeAllThreadLocalBuffers() {
   }
 }
 
+void Heap::SetSingleObjectTlabs(bool single_object_tlabs) {
+  if (use_tlab_ && single_object_tlabs) {
+    // The TLABs handed out before have room for allocations which bypass the entrypoints.
+    RevokeAllThreadLocalBuffers();
+  }
+  single_object_tlabs_ = single_object_tlabs;
+}
+
 bool Heap::IsGCRequestPending() const {
   return concurrent_start_bytes_ != std::numeric_limits<size_t>::max();
 }
@@ -2753,42 +3740,54 @@ void Heap::RunFinalization(JNIEnv* env) {
 
 void Heap::RegisterNativeAllocation(JNIEnv* env, int bytes) {
   Thread* self = ThreadForEnv(env);
-  if (native_need_to_run_finalization_) {
-    RunFinalization(env);
-    UpdateMaxNativeFootprint();
-    native_need_to_run_finalization_ = false;
-  }
   // Total number of native bytes allocated.
   size_t new_native_bytes_allocated = native_bytes_allocated_.FetchAndAddSequentiallyConsistent(bytes);
   new_native_bytes_allocated += bytes;
-  if (new_native_bytes_allocated > native_footprint_gc_watermark_) {
-    collector::GcType gc_type = have_zygote_space_ ? collector::kGcTypePartial :
-        collector::kGcTypeFull;
-
-    // The second watermark is higher than the gc watermark. If you hit this it means you are
-    // allocating native objects faster than the GC can keep up with.
-    if (new_native_bytes_allocated > native_footprint_limit_) {
-      if (WaitForGcToComplete(kGcCauseForNativeAlloc, self) != collector::kGcTypeNone) {
-        // Just finished a GC, attempt to run finalizers.
-        RunFinalization(env);
-        CHECK(!env->ExceptionCheck());
-      }
-      // If we still are over the watermark, attempt a GC for alloc and run finalizers.
-      if (new_native_bytes_allocated > native_footprint_limit_) {
-        CollectGarbageInternal(gc_type, kGcCauseForNativeAlloc, false);
-        RunFinalization(env);
-        native_need_to_run_finalization_ = false;
-        CHECK(!env->ExceptionCheck());
-      }
-      // We have just run finalizers, update the native watermark since it is very likely that
-      // finalizers released native managed allocations.
-      UpdateMaxNativeFootprint();
-    } else if (!IsGCRequestPending()) {
-      if (IsGcConcurrent()) {
-        RequestConcurrentGC(self);
-      } else {
-        CollectGarbageInternal(gc_type, kGcCauseForNativeAlloc, false);
-      }
+  if (new_native_bytes_allocated <= native_footprint_gc_watermark_) {
+    return;
+  }
+  if (native_need_to_run_finalization_) {
+    // A GC ran since the watermarks were computed and the finalizer daemon has been releasing the
+    // native memory of the dead objects since, recompute them from what is left rather than running
+    // the finalizers here.
+    native_need_to_run_finalization_ = false;
+    UpdateMaxNativeFootprint();
+    if (new_native_bytes_allocated <= native_footprint_gc_watermark_) {
+      return;
+    }
+  }
+  collector::GcType gc_type = have_zygote_space_ ? collector::kGcTypePartial :
+      collector::kGcTypeFull;
+  // The second watermark is higher than the gc watermark. If you hit this it means you are
+  // allocating native objects faster than the GC can keep up with, block until enough was freed.
+  if (new_native_bytes_allocated > native_footprint_limit_) {
+    const uint64_t start_time = NanoTime();
+    if (WaitForGcToComplete(kGcCauseForNativeAlloc, self) != collector::kGcTypeNone) {
+      // Just finished a GC, attempt to run finalizers.
+      RunFinalization(env);
+      CHECK(!env->ExceptionCheck());
+    }
+    // If we still are over the watermark, attempt a GC for alloc and run finalizers.
+    if (native_bytes_allocated_.LoadRelaxed() > native_footprint_limit_) {
+      CollectGarbageInternal(gc_type, kGcCauseForNativeAlloc, false);
+      RunFinalization(env);
+      CHECK(!env->ExceptionCheck());
+    }
+    native_need_to_run_finalization_ = false;
+    // We have just run finalizers, update the native watermark since it is very likely that
+    // finalizers released native managed allocations.
+    UpdateMaxNativeFootprint();
+    const uint64_t blocked_time = NanoTime() - start_time;
+    native_blocking_count_.FetchAndAddSequentiallyConsistent(1);
+    native_blocking_time_ns_.FetchAndAddSequentiallyConsistent(blocked_time);
+    VLOG(heap) << "Blocked " << PrettyDuration(blocked_time) << " registering "
+               << PrettySize(bytes) << " of native memory, "
+               << PrettySize(new_native_bytes_allocated) << " were allocated";
+  } else if (!IsGCRequestPending()) {
+    if (IsGcConcurrent()) {
+      RequestConcurrentGC(self);
+    } else {
+      CollectGarbageInternal(gc_type, kGcCauseForNativeAlloc, false);
     }
   }
 }
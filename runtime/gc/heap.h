@@ -26,6 +26,7 @@
 #include "base/timing_logger.h"
 #include "gc/accounting/atomic_stack.h"
 #include "gc/accounting/card_table.h"
+#include "gc/allocation_sampler.h"
 #include "gc/gc_cause.h"
 #include "gc/collector/gc_type.h"
 #include "gc/collector_type.h"
@@ -65,6 +66,7 @@ namespace accounting {
 
 namespace collector {
   class ConcurrentCopying;
+  class ConcurrentCopyingTest;
   class GarbageCollector;
   class MarkSweep;
   class SemiSpace;
@@ -109,6 +111,32 @@ enum ProcessState {
 };
 std::ostream& operator<<(std::ostream& os, const ProcessState& process_state);
 
+// The regions of the zygote space, in address order. The zygote compaction sorts the moving
+// objects by how likely the zygote children are to write them, so that the pages the children
+// dirty are not spread over the whole space. The non-moving region holds the non-moving objects
+// and the immutable objects which fill its holes. The strings get written when they cache their
+// hash code. The written region holds the classes still to initialize or with non-final statics
+// and the dex caches with their arrays. The immutable region holds the other moving objects.
+enum ZygoteRegion {
+  kZygoteRegionNonMoving,  // <<non-moving>>
+  kZygoteRegionStrings,    // <<strings>>
+  kZygoteRegionWritten,    // <<written>>
+  kZygoteRegionImmutable,  // <<immutable>>
+  kZygoteRegionCount,
+};
+std::ostream& operator<<(std::ostream& os, const ZygoteRegion& zygote_region);
+
+// The instances of a class found by a class census, and their shallow size.
+struct ClassCensusEntry {
+  mirror::Class* klass;
+  uint64_t count;
+  uint64_t bytes;
+  // Estimates for a header without the lock word: the bytes saved after the object alignment, and
+  // the instances whose lock word is in use, locked or hashed, which would take side table entries.
+  uint64_t compact_header_savings;
+  uint64_t lock_word_count;
+};
+
 class Heap {
  public:
   // If true, measure the total allocation time.
@@ -134,6 +162,10 @@ class Heap {
   static constexpr uint64_t kHeapTrimWait = MsToNs(5000);
   // How long we wait after a transition request to perform a collector transition (nanoseconds).
   static constexpr uint64_t kCollectorTransitionWait = MsToNs(5000);
+  // The compaction of a transition to a moving background collector is deferred until the main
+  // space has at least this many free bytes in its runs, and this fraction of their bytes.
+  static constexpr size_t kMinBackgroundCompactionReclaim = 1 * MB;
+  static constexpr double kMinBackgroundCompactionFragmentation = 0.1;
 
   // Create a heap with the requested sizes. The possible empty
   // image_file_names names specify Spaces to load based on
@@ -172,6 +204,16 @@ class Heap {
                                                          pre_fence_visitor);
   }
 
+  // Allocates up to num_objects objects of byte_count bytes at once with the RosAlloc allocator
+  // and returns how many were allocated, 0 if the current allocator isn't RosAlloc. Never
+  // collects garbage: the caller must make the objects reachable before it allocates again or
+  // suspends, and allocates the ones missing with AllocObject.
+  template <bool kInstrumented, typename PreFenceVisitor>
+  size_t AllocObjectBatch(Thread* self, mirror::Class* klass, size_t byte_count,
+                          size_t num_objects, mirror::Object** objects,
+                          const PreFenceVisitor& pre_fence_visitor)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   template <bool kInstrumented, bool kCheckLargeObject, typename PreFenceVisitor>
   ALWAYS_INLINE mirror::Object* AllocObjectWithAllocator(
       Thread* self, mirror::Class* klass, size_t byte_count, AllocatorType allocator,
@@ -186,6 +228,10 @@ class Heap {
     return current_non_moving_allocator_;
   }
 
+  bool UsesTlab() const {
+    return use_tlab_;
+  }
+
   // Visit all of the live objects in the heap.
   void VisitObjects(ObjectCallback callback, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_, Locks::mutator_lock_);
@@ -209,6 +255,10 @@ class Heap {
   void ChangeCollector(CollectorType collector_type)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  CollectorType CurrentCollectorType() const {
+    return collector_type_;
+  }
+
   // The given reference is believed to be to an object in the Java heap, check the soundness of it.
   // TODO: NO_THREAD_SAFETY_ANALYSIS since we call this everywhere and it is impossible to find a
   // proper lock ordering for it.
@@ -216,8 +266,9 @@ class Heap {
 
   // Check sanity of all live references.
   void VerifyHeap() LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
-  // Returns how many failures occured.
-  size_t VerifyHeapReferences(bool verify_referents = true)
+  // Returns how many failures occured. Only verifies the references of about sample_percent of
+  // the objects, picked anew for each call, and those of all the roots.
+  size_t VerifyHeapReferences(bool verify_referents = true, size_t sample_percent = 100)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_, Locks::mutator_lock_);
   bool VerifyMissingCardMarks()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_, Locks::mutator_lock_);
@@ -270,6 +321,27 @@ class Heap {
   void GetReferringObjects(mirror::Object* o, int32_t max_count, std::vector<mirror::Object*>& referring_objects)
       LOCKS_EXCLUDED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Counts the instances of every class and their bytes in a single walk of the heap, split
+  // across the heap thread pool. Unreachable objects not yet collected are counted too. The
+  // entries are sorted by decreasing bytes. Returns false without a census if a GC is running and
+  // wait_for_gc is false, which it must be if the caller holds the mutator lock exclusively.
+  bool TakeClassCensus(Thread* self, bool wait_for_gc, std::vector<ClassCensusEntry>* census)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_, gc_complete_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Prints the max_classes classes with the most bytes of instances, for the SIGQUIT dump.
+  void DumpClassCensus(std::ostream& os, size_t max_classes)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_, gc_complete_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Samples the allocations, on average one every interval bytes allocated by each thread.
+  // Changes the interval if already sampling.
+  void StartAllocationSampling(size_t interval)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::runtime_shutdown_lock_);
+  void StopAllocationSampling()
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::runtime_shutdown_lock_);
+  AllocationSampler* GetAllocationSampler() {
+    return allocation_sampler_.get();
+  }
 
   // Removes the growth limit on the alloc space so it may grow to its maximum capacity. Used to
   // implement dalvik.system.VMRuntime.clearGrowthLimit.
@@ -292,6 +364,11 @@ class Heap {
   void AddSpace(space::Space* space) LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
   void RemoveSpace(space::Space* space) LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
 
+  // Adds the space of an app image mapped after the heap was created, with a mod-union table for
+  // its references to the other spaces. Waits for a running GC first.
+  void AddAppImageSpace(space::ImageSpace* space)
+      LOCKS_EXCLUDED(gc_complete_lock_, Locks::heap_bitmap_lock_);
+
   // Set target ideal heap utilization ratio, implements
   // dalvik.system.VMRuntime.setTargetHeapUtilization.
   void SetTargetHeapUtilization(float target);
@@ -300,6 +377,19 @@ class Heap {
   // from the system. Doesn't allow the space to exceed its growth limit.
   void SetIdealFootprint(size_t max_allowed_footprint);
 
+  // Pace the concurrent GCs from the measured allocation rate and GC duration, set from
+  // -XX:GcPacing.
+  void SetGcPacing(bool gc_pacing) {
+    gc_pacing_ = gc_pacing;
+  }
+
+  // Verify the references of this percent of the objects after each GC, set from
+  // -XX:HeapVerificationSamplePercent. 0 turns the sampled verification off.
+  void SetVerificationSamplePercent(size_t percent) {
+    DCHECK_LE(percent, 100U);
+    verify_sample_percent_ = percent;
+  }
+
   // Blocks the caller until the garbage collector becomes idle and returns the type of GC we
   // waited for.
   collector::GcType WaitForGcToComplete(GcCause cause, Thread* self)
@@ -419,18 +509,35 @@ class Heap {
                                                               bool fail_ok) const;
   space::Space* FindSpaceFromObject(const mirror::Object*, bool fail_ok) const;
 
-  void DumpForSigQuit(std::ostream& os);
+  // The class census needs all other threads suspended.
+  void DumpForSigQuit(std::ostream& os, bool take_class_census)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Dumps the resident pages of each zygote region and of the image spaces, and how many of them
+  // this process dirtied, as found in /proc/self/pagemap.
+  void DumpZygotePageSharing(std::ostream& os);
+
+  // Returns the zygote region which contains obj, or kZygoteRegionCount if obj isn't in the
+  // zygote space.
+  ZygoteRegion GetZygoteRegion(const mirror::Object* obj) const;
 
 
   // Do a pending heap transition or trim.
   void DoPendingTransitionOrTrim() LOCKS_EXCLUDED(heap_trim_request_lock_);
 
+  // Whether compacting the main space is expected to give back enough resident memory, see
+  // kMinBackgroundCompactionReclaim.
+  bool IsBackgroundCompactionWorthwhile();
+
   // Trim the managed and native heaps by releasing unused memory back to the OS.
   void Trim() LOCKS_EXCLUDED(heap_trim_request_lock_);
 
   void RevokeThreadLocalBuffers(Thread* thread);
   void RevokeRosAllocThreadLocalBuffers(Thread* thread);
   void RevokeAllThreadLocalBuffers();
+  // While set, the TLABs only hold the object they are allocated for, used while the allocation
+  // entrypoints are instrumented. Called with the other threads suspended.
+  void SetSingleObjectTlabs(bool single_object_tlabs);
   void AssertAllBumpPointerSpaceThreadLocalBuffersAreRevoked();
   void RosAllocVerification(TimingLogger* timings, const char* name)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -474,7 +581,7 @@ class Heap {
   void UnBindBitmaps() EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
   // DEPRECATED: Should remove in "near" future when support for multiple image spaces is added.
-  // Assumes there is only one image space.
+  // Returns the boot image space, app image spaces are only found by address.
   space::ImageSpace* GetImageSpace() const;
 
   // Permenantly disable compaction.
@@ -522,6 +629,13 @@ class Heap {
   // GC performance measuring
   void DumpGcPerformanceInfo(std::ostream& os);
 
+  // Appends the named GC metrics: the pause percentiles, CPU time and throughput of each
+  // collector, the time mutators waited for GCs and the number of allocations which stalled for
+  // a GC. The per collector values cover the GCs since the last DumpGcPerformanceInfo. Waits for
+  // the running GC to complete.
+  void GetGcMetrics(Thread* self, std::vector<std::pair<std::string, uint64_t>>* metrics)
+      LOCKS_EXCLUDED(gc_complete_lock_);
+
   // Returns true if we currently care about pause times.
   bool CareAboutPauseTimes() const {
     return process_state_ == kProcessStateJankPerceptible;
@@ -556,6 +670,10 @@ class Heap {
     return &reference_processor_;
   }
 
+  collector::ConcurrentCopying* ConcurrentCopyingCollector() {
+    return concurrent_copying_collector_;
+  }
+
  private:
   void Compact(space::ContinuousMemMapAllocSpace* target_space,
                space::ContinuousMemMapAllocSpace* source_space)
@@ -568,12 +686,16 @@ class Heap {
         allocator_type != kAllocatorTypeBumpPointer &&
         allocator_type != kAllocatorTypeTLAB;
   }
+  // Returns true if the objects of the allocator are pushed onto the allocation stack. The objects
+  // RosAlloc allocates are found from the runs it handed out since the last GC instead, see
+  // PushNewRosAllocObjects().
+  ALWAYS_INLINE bool AllocationUsesAllocationStack(AllocatorType allocator_type) const;
   static ALWAYS_INLINE bool AllocatorMayHaveConcurrentGC(AllocatorType allocator_type) {
     return AllocatorHasAllocationStack(allocator_type);
   }
   static bool IsMovingGc(CollectorType collector_type) {
     return collector_type == kCollectorTypeSS || collector_type == kCollectorTypeGSS ||
-        collector_type == kCollectorTypeCC;
+        collector_type == kCollectorTypeCC || collector_type == kCollectorTypeGenCMS;
   }
   bool ShouldAllocLargeObject(mirror::Class* c, size_t byte_count) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -663,6 +785,13 @@ class Heap {
       LOCKS_EXCLUDED(Locks::mutator_lock_);
   void PostGcVerificationPaused(collector::GarbageCollector* gc)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Like VisitObjects but walks the live bitmaps of the continuous spaces on the thread pool, the
+  // callback must be safe to call from several threads at a time.
+  void VisitObjectsParallel(Thread* self, ObjectCallback callback, void* arg)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Visits the objects of the live bitmaps, the continuous spaces on the thread pool.
+  void VisitLiveBitmapParallel(Thread* self, ObjectCallback callback, void* arg)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Update the watermark for the native allocated bytes based on the current number of native
   // bytes allocated and the target utilization ratio.
@@ -671,6 +800,13 @@ class Heap {
   // Find a collector based on GC type.
   collector::GarbageCollector* FindCollectorByGcType(collector::GcType gc_type);
 
+  // Used by kCollectorTypeGenCMS before its old generation is collected. Promotes the reachable
+  // objects of the nursery into the main space with the mutators suspended and makes the
+  // mutators allocate in the main space, since the concurrent mark sweep doesn't handle the
+  // bump pointer spaces. Returns false if the nursery couldn't be emptied.
+  bool EvacuateNursery(GcCause gc_cause, bool clear_soft_references)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   // Create the main free list space, typically either a RosAlloc space or DlMalloc space.
   void CreateMainMallocSpace(MemMap* mem_map, size_t initial_size, size_t growth_limit,
                              size_t capacity);
@@ -685,11 +821,22 @@ class Heap {
   static void VerificationCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
-  // Swap the allocation stack with the live stack.
+  // Swap the allocation stack with the live stack, after pushing the new RosAlloc objects onto the
+  // allocation stack.
   void SwapStacks(Thread* self);
 
-  // Clear cards and update the mod union table.
-  void ProcessCards(TimingLogger& timings, bool use_rem_sets);
+  // Pushes the objects RosAlloc allocated since the last call onto the allocation stack, growing it
+  // if needed. Must be called with the mutators suspended.
+  void PushNewRosAllocObjects(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Calls the callback on the objects RosAlloc allocated since the last PushNewRosAllocObjects(),
+  // which are neither on the allocation stack nor in the live bitmaps.
+  void VisitNewRosAllocObjects(ObjectCallback* callback, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Clear cards and update the mod union table. The remembered slots of the remembered sets must be
+  // cleared by the collections which may free objects of their spaces.
+  void ProcessCards(TimingLogger& timings, bool use_rem_sets, bool clear_rem_set_slots);
 
   // Signal the heap trim daemon that there is something to do, either a heap transition or heap
   // trim.
@@ -704,9 +851,11 @@ class Heap {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // What kind of concurrency behavior is the runtime after? Currently true for concurrent mark
-  // sweep GC, false for other GC types.
+  // sweep GC, false for other GC types. The nursery collections of kCollectorTypeGenCMS pause the
+  // mutators but its old generation is collected concurrently.
   bool IsGcConcurrent() const ALWAYS_INLINE {
-    return collector_type_ == kCollectorTypeCMS || collector_type_ == kCollectorTypeCC;
+    return collector_type_ == kCollectorTypeCMS || collector_type_ == kCollectorTypeCC ||
+        collector_type_ == kCollectorTypeGenCMS;
   }
 
   // All-known continuous spaces, where objects lie within fixed bounds.
@@ -788,6 +937,11 @@ class Heap {
   // If we have a zygote space.
   bool have_zygote_space_;
 
+  // The start of each zygote region, a region ends where the next one starts and the last one at
+  // the end of the zygote space. Set when creating the zygote space.
+  byte* zygote_region_begins_[kZygoteRegionCount];
+  byte* zygote_end_;
+
   // Minimum allocation size of large object.
   size_t large_object_threshold_;
 
@@ -823,7 +977,8 @@ class Heap {
   // The watermark at which a GC is performed inside of registerNativeAllocation.
   size_t native_footprint_limit_;
 
-  // Whether or not we need to run finalizers in the next native allocation.
+  // Whether or not a GC ran since the native watermarks were computed, they are then recomputed
+  // the next time a native allocation goes over native_footprint_gc_watermark_.
   bool native_need_to_run_finalization_;
 
   // Whether or not we currently care about pause times.
@@ -888,6 +1043,9 @@ class Heap {
   // Parallel GC data structures.
   std::unique_ptr<ThreadPool> thread_pool_;
 
+  // Samples the allocations of the instrumented allocation paths.
+  std::unique_ptr<AllocationSampler> allocation_sampler_;
+
   // The nanosecond time at which the last GC ended.
   uint64_t last_gc_time_ns_;
 
@@ -898,6 +1056,20 @@ class Heap {
   // and the start of the current one.
   uint64_t allocation_rate_;
 
+  // If true, the concurrent GCs start early enough to finish at the estimated allocation rate
+  // rather than at most kMaxConcurrentRemainingBytes before the footprint limit, and the heap grows
+  // enough for them not to start right away.
+  bool gc_pacing_;
+
+  // With gc_pacing_, the factor applied to the bytes estimated to be allocated during a concurrent
+  // GC. Raised when allocations stalled since the previous GC and decayed back towards 1 when they
+  // didn't, given the allocation_stall_count_ seen at the end of the previous GC.
+  double concurrent_start_headroom_;
+  uint64_t last_gc_allocation_stall_count_;
+
+  // If non zero, the references of this percent of the objects are verified after each GC.
+  size_t verify_sample_percent_;
+
   // For a GC cycle, a bitmap that is set corresponding to the
   std::unique_ptr<accounting::HeapBitmap> live_bitmap_ GUARDED_BY(Locks::heap_bitmap_lock_);
   std::unique_ptr<accounting::HeapBitmap> mark_bitmap_ GUARDED_BY(Locks::heap_bitmap_lock_);
@@ -941,6 +1113,18 @@ class Heap {
   // Total time which mutators are paused or waiting for GC to complete.
   uint64_t total_wait_time_;
 
+  // Number of allocations which failed to allocate without running or waiting for a GC.
+  Atomic<uint64_t> allocation_stall_count_;
+
+  // Number of RegisterNativeAllocation calls which went over native_footprint_limit_ and blocked
+  // waiting for a GC and the finalizers, and the total time they blocked.
+  Atomic<uint64_t> native_blocking_count_;
+  Atomic<uint64_t> native_blocking_time_ns_;
+
+  // The unused ends of the TLABs revoked during the last GC cycle, and since the start.
+  size_t last_gc_tlab_waste_bytes_;
+  uint64_t total_tlab_waste_bytes_;
+
   // Total number of objects allocated in microseconds.
   AtomicInteger total_allocation_time_;
 
@@ -956,7 +1140,11 @@ class Heap {
 
   const bool running_on_valgrind_;
   const bool use_tlab_;
+  // Whether the TLABs are sized for a single object, see SetSingleObjectTlabs.
+  bool single_object_tlabs_;
 
+  friend class collector::ConcurrentCopying;
+  friend class collector::ConcurrentCopyingTest;
   friend class collector::GarbageCollector;
   friend class collector::MarkSweep;
   friend class collector::SemiSpace;
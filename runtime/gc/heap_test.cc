@@ -21,6 +21,9 @@
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
 #include "handle_scope-inl.h"
+#include "mirror/string-inl.h"
+#include "os.h"
+#include "scoped_thread_state_change.h"
 
 namespace art {
 namespace gc {
@@ -60,6 +63,90 @@ TEST_F(HeapTest, GarbageCollectClassLinkerInit) {
   Runtime::Current()->GetHeap()->CollectGarbage(false);
 }
 
+TEST_F(HeapTest, ClassCensus) {
+  ScopedObjectAccess soa(Thread::Current());
+  Heap* heap = Runtime::Current()->GetHeap();
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> c(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;")));
+  static constexpr size_t kNumArrays = 100;
+  Handle<mirror::ObjectArray<mirror::Object>> arrays(hs.NewHandle(
+      mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c.Get(), kNumArrays)));
+  ASSERT_TRUE(arrays.Get() != nullptr);
+  for (size_t i = 0; i < kNumArrays; ++i) {
+    mirror::ObjectArray<mirror::Object>* array =
+        mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c.Get(), 16);
+    ASSERT_TRUE(array != nullptr);
+    arrays->Set<false>(i, array);
+  }
+
+  std::vector<ClassCensusEntry> census;
+  ASSERT_TRUE(heap->TakeClassCensus(soa.Self(), true, &census));
+  ASSERT_FALSE(census.empty());
+  bool found = false;
+  for (size_t i = 0; i < census.size(); ++i) {
+    if (i != 0) {
+      EXPECT_GE(census[i - 1].bytes, census[i].bytes);
+    }
+    if (census[i].klass == c.Get()) {
+      found = true;
+      EXPECT_GE(census[i].count, kNumArrays + 1);
+      EXPECT_GE(census[i].bytes, census[i].count * sizeof(mirror::Object));
+      // The arrays of 16 and 100 references end 4 bytes past the object alignment, a header
+      // without the lock word saves an alignment unit on each.
+      EXPECT_GE(census[i].compact_header_savings, (kNumArrays + 1) * kObjectAlignment);
+      EXPECT_LE(census[i].compact_header_savings, census[i].count * kObjectAlignment);
+    }
+  }
+  EXPECT_TRUE(found);
+  std::ostringstream os;
+  heap->DumpClassCensus(os, 5);
+  EXPECT_NE(std::string::npos, os.str().find("Class census:"));
+  EXPECT_NE(std::string::npos, os.str().find("Headers without lock words would save"));
+}
+
+TEST_F(HeapTest, ThreadAllocatedBytes) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::Class> c(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;")));
+  const uint64_t before = soa.Self()->GetAllocatedBytes();
+  static constexpr size_t kNumArrays = 64;
+  static constexpr size_t kArrayLength = 1024;
+  size_t bytes = 0;
+  for (size_t i = 0; i < kNumArrays; ++i) {
+    mirror::ObjectArray<mirror::Object>* array =
+        mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c.Get(), kArrayLength);
+    ASSERT_TRUE(array != nullptr);
+    bytes += array->SizeOf();
+  }
+  // The counter includes the unused part of the thread's buffers, it never undercounts.
+  EXPECT_GE(soa.Self()->GetAllocatedBytes() - before, bytes);
+}
+
+TEST_F(HeapTest, GcMetrics) {
+  Heap* heap = Runtime::Current()->GetHeap();
+  heap->CollectGarbage(false);
+  std::vector<std::pair<std::string, uint64_t>> metrics;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    heap->GetGcMetrics(soa.Self(), &metrics);
+  }
+  uint64_t gc_count = 0;
+  bool found_wait_time = false;
+  for (const auto& metric : metrics) {
+    const std::string& name = metric.first;
+    EXPECT_EQ(0U, name.find("art.gc.")) << name;
+    EXPECT_EQ(std::string::npos, name.find(' ')) << name;
+    if (name.size() > 6 && name.compare(name.size() - 6, 6, ".count") == 0) {
+      gc_count += metric.second;
+    }
+    found_wait_time = found_wait_time || name == "art.gc.wait-time-ns";
+  }
+  EXPECT_GE(gc_count, 1U);
+  EXPECT_TRUE(found_wait_time);
+}
+
 TEST_F(HeapTest, HeapBitmapCapacityTest) {
   byte* heap_begin = reinterpret_cast<byte*>(0x1000);
   const size_t heap_capacity = kObjectAlignment * (sizeof(intptr_t) * 8 + 1);
@@ -70,5 +157,89 @@ TEST_F(HeapTest, HeapBitmapCapacityTest) {
   bitmap->Set(fake_end_of_heap_object);
 }
 
+class ZygoteCompactionTest : public CommonRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(Runtime::Options *options) OVERRIDE {
+    // The compaction moves the objects of the bump pointer space.
+    options->push_back(std::make_pair("-Xgc:SS", nullptr));
+  }
+};
+
+TEST_F(ZygoteCompactionTest, SortObjects) {
+  Heap* heap = Runtime::Current()->GetHeap();
+  if (!kMovingCollector) {
+    return;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<3> hs(soa.Self());
+  Handle<mirror::String> string(
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "zygote")));
+  ASSERT_TRUE(string.Get() != nullptr);
+  Handle<mirror::CharArray> chars(hs.NewHandle(string->GetCharArray()));
+  // Loading doesn't initialize the class.
+  Handle<mirror::Class> klass(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "Ljava/util/zip/Adler32;")));
+  ASSERT_TRUE(klass.Get() != nullptr);
+  EXPECT_EQ(kZygoteRegionCount, heap->GetZygoteRegion(string.Get()));
+  {
+    ScopedThreadStateChange tsc(soa.Self(), kNative);
+    heap->PreZygoteFork();
+  }
+  EXPECT_EQ(kZygoteRegionStrings, heap->GetZygoteRegion(string.Get()));
+  // The immutable objects may fill the holes of the non-moving space.
+  const ZygoteRegion chars_region = heap->GetZygoteRegion(chars.Get());
+  EXPECT_TRUE(chars_region == kZygoteRegionImmutable || chars_region == kZygoteRegionNonMoving)
+      << chars_region;
+  EXPECT_TRUE(string->Equals("zygote"));
+  // The children initialize the class.
+  if (!klass->IsInitialized()) {
+    EXPECT_EQ(kZygoteRegionWritten, heap->GetZygoteRegion(klass.Get()));
+  }
+  if (OS::FileExists("/proc/self/pagemap")) {
+    std::ostringstream os;
+    heap->DumpZygotePageSharing(os);
+    EXPECT_NE(std::string::npos, os.str().find("Zygote private/resident pages:")) << os.str();
+  }
+}
+
+class GenCMSHeapTest : public CommonRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(Runtime::Options *options) OVERRIDE {
+    options->push_back(std::make_pair("-Xgc:GenCMS", nullptr));
+  }
+};
+
+TEST_F(GenCMSHeapTest, PromoteToOldGeneration) {
+  Heap* heap = Runtime::Current()->GetHeap();
+  if (!kMovingCollector || heap->CurrentCollectorType() != kCollectorTypeGenCMS) {
+    return;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> c(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;")));
+  Handle<mirror::ObjectArray<mirror::Object>> array(hs.NewHandle(
+      mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c.Get(), 256)));
+  ASSERT_TRUE(array.Get() != nullptr);
+  for (size_t i = 0; i < 256; ++i) {
+    // The allocation may move the array.
+    mirror::String* string = mirror::String::AllocFromModifiedUtf8(soa.Self(), "hello, world!");
+    ASSERT_TRUE(string != nullptr);
+    array->Set<false>(i, string);
+  }
+  EXPECT_FALSE(heap->GetPrimaryFreeListSpace()->Contains(array.Get()));
+  {
+    ScopedThreadStateChange tsc(soa.Self(), kNative);
+    // Evacuates the nursery and collects the old generation.
+    heap->CollectGarbage(false);
+  }
+  // The survivors are in the old generation and the mutators allocate in the nursery again.
+  EXPECT_TRUE(heap->GetPrimaryFreeListSpace()->Contains(array.Get()));
+  EXPECT_TRUE(heap->GetPrimaryFreeListSpace()->Contains(array->Get(255)));
+  EXPECT_TRUE(array->Get(255)->AsString()->Equals("hello, world!"));
+  EXPECT_TRUE(heap->GetCurrentAllocator() == kAllocatorTypeTLAB ||
+              heap->GetCurrentAllocator() == kAllocatorTypeBumpPointer);
+}
+
 }  // namespace gc
 }  // namespace art
@@ -16,6 +16,8 @@
 
 #include "reference_processor.h"
 
+#include <ostream>
+
 #include "mirror/object-inl.h"
 #include "mirror/reference-inl.h"
 #include "reflection.h"
@@ -27,9 +29,14 @@ namespace art {
 namespace gc {
 
 ReferenceProcessor::ReferenceProcessor()
-    : process_references_args_(nullptr, nullptr, nullptr), slow_path_enabled_(false),
-      preserving_references_(false), lock_("reference processor lock", kReferenceProcessorLock),
-      condition_("reference processor condition", lock_) {
+    : process_references_args_(nullptr, nullptr, nullptr), is_marked_sequence_(1),
+      slow_path_enabled_(false), preserving_references_(false),
+      lock_("reference processor lock", kReferenceProcessorLock),
+      condition_("reference processor condition", lock_), blocking_generation_(0),
+      blocked_count_(0), blocked_ns_(0), waiting_count_(0), waiting_start_ns_(0),
+      last_blocked_count_(0), last_blocked_ns_(0), total_blocked_count_(0),
+      total_blocked_ns_(0), last_finalizable_count_(0), last_finalizable_bytes_(0),
+      total_finalizable_count_(0), total_finalizable_bytes_(0) {
 }
 
 void ReferenceProcessor::EnableSlowPath() {
@@ -39,9 +46,86 @@ void ReferenceProcessor::EnableSlowPath() {
 
 void ReferenceProcessor::DisableSlowPath(Thread* self) {
   slow_path_enabled_ = false;
+  FinishBlockingAccounting();
   condition_.Broadcast(self);
 }
 
+mirror::Object* ReferenceProcessor::GetMarkedReferentLockFree(mirror::Object* referent) {
+  const int32_t sequence = is_marked_sequence_.LoadSequentiallyConsistent();
+  if ((sequence & 1) != 0) {
+    return nullptr;
+  }
+  // Racy reads, the result is only used if the sequence didn't change in the meantime. A marked
+  // referent is black while the GC isn't preserving references, so the mutator can't hide a
+  // white object from the GC by storing one of its fields.
+  IsMarkedCallback* const is_marked_callback = process_references_args_.is_marked_callback_;
+  void* const arg = process_references_args_.arg_;
+  if (is_marked_callback == nullptr) {
+    return nullptr;
+  }
+  mirror::Object* const obj = is_marked_callback(referent, arg);
+  // Order the read of the mark bit before the second read of the sequence.
+  QuasiAtomic::MembarLoadLoad();
+  if (obj == nullptr || is_marked_sequence_.LoadSequentiallyConsistent() != sequence) {
+    return nullptr;
+  }
+  return obj;
+}
+
+uint32_t ReferenceProcessor::StartBlocking(uint64_t start_ns) {
+  ++blocked_count_;
+  ++waiting_count_;
+  waiting_start_ns_ += start_ns;
+  return blocking_generation_;
+}
+
+void ReferenceProcessor::FinishBlocking(uint32_t generation, uint64_t start_ns) {
+  // Calls still waiting when the processing finished were accounted by FinishBlockingAccounting.
+  if (generation == blocking_generation_) {
+    DCHECK_NE(waiting_count_, 0U);
+    --waiting_count_;
+    waiting_start_ns_ -= start_ns;
+    blocked_ns_ += NanoTime() - start_ns;
+  }
+}
+
+void ReferenceProcessor::FinishBlockingAccounting() {
+  blocked_ns_ += waiting_count_ * NanoTime() - waiting_start_ns_;
+  last_blocked_count_ = blocked_count_;
+  last_blocked_ns_ = blocked_ns_;
+  total_blocked_count_ += blocked_count_;
+  total_blocked_ns_ += blocked_ns_;
+  if (blocked_count_ != 0) {
+    VLOG(heap) << "Reference processing blocked " << blocked_count_ << " GetReferent calls for "
+               << PrettyDuration(blocked_ns_);
+  }
+  ++blocking_generation_;
+  blocked_count_ = 0;
+  blocked_ns_ = 0;
+  waiting_count_ = 0;
+  waiting_start_ns_ = 0;
+}
+
+size_t ReferenceProcessor::GetLastBlockedGetReferentCount() {
+  MutexLock mu(Thread::Current(), lock_);
+  return last_blocked_count_;
+}
+
+uint64_t ReferenceProcessor::GetLastBlockedGetReferentNs() {
+  MutexLock mu(Thread::Current(), lock_);
+  return last_blocked_ns_;
+}
+
+void ReferenceProcessor::DumpBlockingInfo(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Total GetReferent calls blocked by reference processing: " << total_blocked_count_;
+  if (total_blocked_count_ != 0) {
+    os << " for " << PrettyDuration(total_blocked_ns_) << ", mean "
+       << PrettyDuration(total_blocked_ns_ / total_blocked_count_);
+  }
+  os << "\n";
+}
+
 mirror::Object* ReferenceProcessor::GetReferent(Thread* self, mirror::Reference* reference) {
   mirror::Object* const referent = reference->GetReferent();
   if (LIKELY(!slow_path_enabled_)) {
@@ -52,11 +136,21 @@ mirror::Object* ReferenceProcessor::GetReferent(Thread* self, mirror::Reference*
   if (referent == nullptr) {
     return nullptr;
   }
+  // Return a marked referent without contending on the lock with the GC and the other readers.
+  mirror::Object* const marked_referent = GetMarkedReferentLockFree(referent);
+  if (marked_referent != nullptr) {
+    return marked_referent;
+  }
   MutexLock mu(self, lock_);
+  uint64_t block_start_ns = 0;
+  uint32_t block_generation = 0;
   while (slow_path_enabled_) {
     mirror::Object* const referent = reference->GetReferent();
     // If the referent became cleared, return it.
     if (referent == nullptr) {
+      if (block_start_ns != 0) {
+        FinishBlocking(block_generation, block_start_ns);
+      }
       return nullptr;
     }
     // Try to see if the referent is already marked by using the is_marked_callback. We can return
@@ -69,11 +163,21 @@ mirror::Object* ReferenceProcessor::GetReferent(Thread* self, mirror::Reference*
       // If it's null it means not marked, but it could become marked if the referent is reachable
       // by finalizer referents. So we can not return in this case and must block.
       if (obj != nullptr) {
+        if (block_start_ns != 0) {
+          FinishBlocking(block_generation, block_start_ns);
+        }
         return obj;
       }
     }
+    if (block_start_ns == 0) {
+      block_start_ns = NanoTime();
+      block_generation = StartBlocking(block_start_ns);
+    }
     condition_.WaitHoldingLocks(self);
   }
+  if (block_start_ns != 0) {
+    FinishBlocking(block_generation, block_start_ns);
+  }
   return reference->GetReferent();
 }
 
@@ -86,11 +190,14 @@ mirror::Object* ReferenceProcessor::PreserveSoftReferenceCallback(mirror::Object
 void ReferenceProcessor::StartPreservingReferences(Thread* self) {
   MutexLock mu(self, lock_);
   preserving_references_ = true;
+  // Disable the lock free fast path of GetReferent before the GC marks anything.
+  is_marked_sequence_.FetchAndAddSequentiallyConsistent(1);
 }
 
 void ReferenceProcessor::StopPreservingReferences(Thread* self) {
   MutexLock mu(self, lock_);
   preserving_references_ = false;
+  is_marked_sequence_.FetchAndAddSequentiallyConsistent(1);
   // We are done preserving references, some people who are blocked may see a marked referent.
   condition_.Broadcast(self);
 }
@@ -109,6 +216,10 @@ void ReferenceProcessor::ProcessReferences(bool concurrent, TimingLogger* timing
     process_references_args_.mark_callback_ = mark_object_callback;
     process_references_args_.arg_ = arg;
     CHECK_EQ(slow_path_enabled_, concurrent) << "Slow path must be enabled iff concurrent";
+    if (concurrent) {
+      // The process args are set, enable the lock free fast path of GetReferent.
+      is_marked_sequence_.FetchAndAddSequentiallyConsistent(1);
+    }
   }
   timings->StartSplit(concurrent ? "ProcessReferences" : "(Paused)ProcessReferences");
   // Unless required to clear soft references with white references, preserve some white referents.
@@ -136,8 +247,14 @@ void ReferenceProcessor::ProcessReferences(bool concurrent, TimingLogger* timing
       StartPreservingReferences(self);
     }
     // Preserve all white objects with finalize methods and schedule them for finalization.
+    last_finalizable_count_ = 0;
+    last_finalizable_bytes_ = 0;
     finalizer_reference_queue_.EnqueueFinalizerReferences(cleared_references_, is_marked_callback,
-                                                          mark_object_callback, arg);
+                                                          mark_object_callback, arg,
+                                                          &last_finalizable_count_,
+                                                          &last_finalizable_bytes_);
+    total_finalizable_count_ += last_finalizable_count_;
+    total_finalizable_bytes_ += last_finalizable_bytes_;
     process_mark_stack_callback(arg);
     if (concurrent) {
       StopPreservingReferences(self);
@@ -159,6 +276,9 @@ void ReferenceProcessor::ProcessReferences(bool concurrent, TimingLogger* timing
     // could result in a stale is_marked_callback_ being called before the reference processing
     // starts since there is a small window of time where slow_path_enabled_ is enabled but the
     // callback isn't yet set.
+    if (concurrent) {
+      is_marked_sequence_.FetchAndAddSequentiallyConsistent(1);
+    }
     process_references_args_.is_marked_callback_ = nullptr;
     if (concurrent) {
       // Done processing, disable the slow path and broadcast to the waiters.
@@ -17,6 +17,9 @@
 #ifndef ART_RUNTIME_GC_REFERENCE_PROCESSOR_H_
 #define ART_RUNTIME_GC_REFERENCE_PROCESSOR_H_
 
+#include <iosfwd>
+
+#include "atomic.h"
 #include "base/mutex.h"
 #include "globals.h"
 #include "jni.h"
@@ -58,6 +61,25 @@ class ReferenceProcessor {
   void DelayReferenceReferent(mirror::Class* klass, mirror::Reference* ref,
                               IsMarkedCallback is_marked_callback, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // How many GetReferent calls blocked during the last concurrent reference processing and for
+  // how long in total.
+  size_t GetLastBlockedGetReferentCount() LOCKS_EXCLUDED(lock_);
+  uint64_t GetLastBlockedGetReferentNs() LOCKS_EXCLUDED(lock_);
+  void DumpBlockingInfo(std::ostream& os) LOCKS_EXCLUDED(lock_);
+  // How many objects the last reference processing kept alive for their finalizers and their size,
+  // the finalizer backlog until the finalizer daemon gets to them. Only used by the GC threads.
+  size_t GetLastFinalizableCount() const {
+    return last_finalizable_count_;
+  }
+  uint64_t GetLastFinalizableBytes() const {
+    return last_finalizable_bytes_;
+  }
+  uint64_t GetTotalFinalizableCount() const {
+    return total_finalizable_count_;
+  }
+  uint64_t GetTotalFinalizableBytes() const {
+    return total_finalizable_bytes_;
+  }
 
  private:
   class ProcessReferencesArgs {
@@ -74,13 +96,28 @@ class ReferenceProcessor {
   };
   // Called by ProcessReferences.
   void DisableSlowPath(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Returns the referent if it is marked and the GC isn't preserving references, without
+  // acquiring lock_. Returns null if the caller has to go through the locked slow path.
+  mirror::Object* GetMarkedReferentLockFree(mirror::Object* referent) NO_THREAD_SAFETY_ANALYSIS;
+  // Starts and finishes accounting a GetReferent which blocks, StartBlocking returns the
+  // generation to pass to FinishBlocking.
+  uint32_t StartBlocking(uint64_t start_ns) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void FinishBlocking(uint32_t generation, uint64_t start_ns) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Accounts the GetReferent calls still blocked at the end of the processing.
+  void FinishBlockingAccounting() EXCLUSIVE_LOCKS_REQUIRED(lock_);
   // If we are preserving references it means that some dead objects may become live, we use start
   // and stop preserving to block mutators using GetReferrent from getting access to these
   // referents.
   void StartPreservingReferences(Thread* self) LOCKS_EXCLUDED(lock_);
   void StopPreservingReferences(Thread* self) LOCKS_EXCLUDED(lock_);
-  // Process args, used by the GetReferent to return referents which are already marked.
+  // Process args, used by the GetReferent to return referents which are already marked. Written
+  // with lock_ held, the lock free fast path of GetReferent reads them when
+  // is_marked_sequence_ is even.
   ProcessReferencesArgs process_references_args_ GUARDED_BY(lock_);
+  // Incremented when the process args become usable, before and after the GC preserves
+  // references and before the process args are cleared. Even iff GetReferent may return a marked
+  // referent without acquiring lock_.
+  AtomicInteger is_marked_sequence_;
   // Boolean for whether or not we need to go slow path in GetReferent.
   volatile bool slow_path_enabled_;
   // Boolean for whether or not we are preserving references (either soft references or finalizers).
@@ -91,6 +128,24 @@ class ReferenceProcessor {
   // Condition that people wait on if they attempt to get the referent of a reference while
   // processing is in progress.
   ConditionVariable condition_ GUARDED_BY(lock_);
+  // The GetReferent calls which blocked during the current processing, the sum of the times they
+  // blocked for the ones which are done, and the number and sum of the start times of the ones
+  // still waiting. The generation is incremented once the processing is accounted.
+  uint32_t blocking_generation_ GUARDED_BY(lock_);
+  size_t blocked_count_ GUARDED_BY(lock_);
+  uint64_t blocked_ns_ GUARDED_BY(lock_);
+  size_t waiting_count_ GUARDED_BY(lock_);
+  uint64_t waiting_start_ns_ GUARDED_BY(lock_);
+  // The same for the last processing and since the start of the runtime.
+  size_t last_blocked_count_ GUARDED_BY(lock_);
+  uint64_t last_blocked_ns_ GUARDED_BY(lock_);
+  uint64_t total_blocked_count_ GUARDED_BY(lock_);
+  uint64_t total_blocked_ns_ GUARDED_BY(lock_);
+  // The objects preserved for finalization by the last processing and since the start.
+  size_t last_finalizable_count_;
+  uint64_t last_finalizable_bytes_;
+  uint64_t total_finalizable_count_;
+  uint64_t total_finalizable_bytes_;
   // Reference queues used by the GC.
   ReferenceQueue soft_reference_queue_;
   ReferenceQueue weak_reference_queue_;
@@ -133,7 +133,8 @@ void ReferenceQueue::ClearWhiteReferences(ReferenceQueue& cleared_references,
 void ReferenceQueue::EnqueueFinalizerReferences(ReferenceQueue& cleared_references,
                                                 IsMarkedCallback* is_marked_callback,
                                                 MarkObjectCallback* mark_object_callback,
-                                                void* arg) {
+                                                void* arg, size_t* finalizable_count,
+                                                uint64_t* finalizable_bytes) {
   while (!IsEmpty()) {
     mirror::FinalizerReference* ref = DequeuePendingReference()->AsFinalizerReference();
     mirror::Object* referent = ref->GetReferent<kWithoutReadBarrier>();
@@ -153,6 +154,8 @@ void ReferenceQueue::EnqueueFinalizerReferences(ReferenceQueue& cleared_referenc
           ref->ClearReferent<false>();
         }
         cleared_references.EnqueueReference(ref);
+        ++*finalizable_count;
+        *finalizable_bytes += forward_address->SizeOf();
       } else if (referent != forward_address) {
         ref->SetReferent<false>(forward_address);
       }
@@ -57,10 +57,12 @@ class ReferenceQueue {
   void EnqueuePendingReference(mirror::Reference* ref) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   mirror::Reference* DequeuePendingReference() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   // Enqueues finalizer references with white referents.  White referents are blackened, moved to the
-  // zombie field, and the referent field is cleared.
+  // zombie field, and the referent field is cleared. Adds the number of referents and their size
+  // to finalizable_count and finalizable_bytes.
   void EnqueueFinalizerReferences(ReferenceQueue& cleared_references,
                                   IsMarkedCallback* is_marked_callback,
-                                  MarkObjectCallback* mark_object_callback, void* arg)
+                                  MarkObjectCallback* mark_object_callback, void* arg,
+                                  size_t* finalizable_count, uint64_t* finalizable_bytes)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   // Walks the reference list marking any references subject to the reference clearing policy.
   // References with a black referent are removed from the list.  References with white referents
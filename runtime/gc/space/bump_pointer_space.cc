@@ -16,6 +16,7 @@
 
 #include "bump_pointer_space.h"
 #include "bump_pointer_space-inl.h"
+#include "gc/heap.h"
 #include "mirror/object-inl.h"
 #include "mirror/class-inl.h"
 #include "thread_list.h"
@@ -49,7 +50,8 @@ BumpPointerSpace::BumpPointerSpace(const std::string& name, byte* begin, byte* l
       objects_allocated_(0), bytes_allocated_(0),
       block_lock_("Block lock"),
       main_block_size_(0),
-      num_blocks_(0) {
+      num_blocks_(0),
+      tlab_waste_bytes_(0) {
 }
 
 BumpPointerSpace::BumpPointerSpace(const std::string& name, MemMap* mem_map)
@@ -59,7 +61,8 @@ BumpPointerSpace::BumpPointerSpace(const std::string& name, MemMap* mem_map)
       objects_allocated_(0), bytes_allocated_(0),
       block_lock_("Block lock"),
       main_block_size_(0),
-      num_blocks_(0) {
+      num_blocks_(0),
+      tlab_waste_bytes_(0) {
 }
 
 void BumpPointerSpace::Clear() {
@@ -73,7 +76,7 @@ void BumpPointerSpace::Clear() {
   growth_end_ = Limit();
   {
     MutexLock mu(Thread::Current(), block_lock_);
-    num_blocks_ = 0;
+    num_blocks_.StoreRelaxed(0);
     main_block_size_ = 0;
   }
 }
@@ -91,7 +94,15 @@ mirror::Object* BumpPointerSpace::GetNextObject(mirror::Object* obj) {
 
 void BumpPointerSpace::RevokeThreadLocalBuffers(Thread* thread) {
   MutexLock mu(Thread::Current(), block_lock_);
-  RevokeThreadLocalBuffersLocked(thread);
+  // A thread which took at most one TLAB since the last GC and used less than half of it gets
+  // smaller ones, what it leaves at each GC is wasted.
+  const size_t tlab_size = thread->GetTlabTargetSize();
+  if (thread->HasTlab() && thread->GetTlabRefills() <= 1 && tlab_size > kMinTlabSize &&
+      thread->GetThreadLocalBytesAllocated() < tlab_size / 2) {
+    thread->SetTlabTargetSize(std::max(tlab_size / 2, kMinTlabSize));
+  }
+  thread->ResetTlabRefills();
+  RevokeTlab(thread);
 }
 
 void BumpPointerSpace::RevokeAllThreadLocalBuffers() {
@@ -126,23 +137,27 @@ void BumpPointerSpace::AssertAllThreadLocalBuffersAreRevoked() {
 }
 
 void BumpPointerSpace::UpdateMainBlock() {
-  DCHECK_EQ(num_blocks_, 0U);
+  DCHECK_EQ(num_blocks_.LoadRelaxed(), 0U);
   main_block_size_ = Size();
 }
 
 // Returns the start of the storage.
 byte* BumpPointerSpace::AllocBlock(size_t bytes) {
-  bytes = RoundUp(bytes, kAlignment);
-  if (!num_blocks_) {
+  if (num_blocks_.LoadRelaxed() == 0) {
     UpdateMainBlock();
   }
+  return AllocBlockWithoutLock(bytes);
+}
+
+byte* BumpPointerSpace::AllocBlockWithoutLock(size_t bytes) {
+  bytes = RoundUp(bytes, kAlignment);
   byte* storage = reinterpret_cast<byte*>(
       AllocNonvirtualWithoutAccounting(bytes + sizeof(BlockHeader)));
   if (LIKELY(storage != nullptr)) {
     BlockHeader* header = reinterpret_cast<BlockHeader*>(storage);
     header->size_ = bytes;  // Write out the block header.
     storage += sizeof(BlockHeader);
-    ++num_blocks_;
+    num_blocks_.FetchAndAddSequentiallyConsistent(1);
   }
   return storage;
 }
@@ -155,11 +170,11 @@ void BumpPointerSpace::Walk(ObjectCallback* callback, void* arg) {
     MutexLock mu(Thread::Current(), block_lock_);
     // If we have 0 blocks then we need to update the main header since we have bump pointer style
     // allocation into an unbounded region (actually bounded by Capacity()).
-    if (num_blocks_ == 0) {
+    if (num_blocks_.LoadSequentiallyConsistent() == 0) {
       UpdateMainBlock();
     }
     main_end = Begin() + main_block_size_;
-    if (num_blocks_ == 0) {
+    if (num_blocks_.LoadSequentiallyConsistent() == 0) {
       // We don't have any other blocks, this means someone else may be allocating into the main
       // block. In this case, we don't want to try and visit the other blocks after the main block
       // since these could actually be part of the main block.
@@ -212,7 +227,7 @@ uint64_t BumpPointerSpace::GetBytesAllocated() {
   MutexLock mu3(Thread::Current(), block_lock_);
   // If we don't have any blocks, we don't have any thread local buffers. This check is required
   // since there can exist multiple bump pointer spaces which exist at the same time.
-  if (num_blocks_ > 0) {
+  if (num_blocks_.LoadSequentiallyConsistent() > 0) {
     for (Thread* thread : thread_list) {
       total += thread->GetThreadLocalBytesAllocated();
     }
@@ -230,7 +245,7 @@ uint64_t BumpPointerSpace::GetObjectsAllocated() {
   MutexLock mu3(Thread::Current(), block_lock_);
   // If we don't have any blocks, we don't have any thread local buffers. This check is required
   // since there can exist multiple bump pointer spaces which exist at the same time.
-  if (num_blocks_ > 0) {
+  if (num_blocks_.LoadSequentiallyConsistent() > 0) {
     for (Thread* thread : thread_list) {
       total += thread->GetThreadLocalObjectsAllocated();
     }
@@ -238,23 +253,51 @@ uint64_t BumpPointerSpace::GetObjectsAllocated() {
   return total;
 }
 
-void BumpPointerSpace::RevokeThreadLocalBuffersLocked(Thread* thread) {
+void BumpPointerSpace::RevokeTlab(Thread* thread) {
   objects_allocated_.FetchAndAddSequentiallyConsistent(thread->GetThreadLocalObjectsAllocated());
   bytes_allocated_.FetchAndAddSequentiallyConsistent(thread->GetThreadLocalBytesAllocated());
+  if (thread->HasTlab()) {
+    tlab_waste_bytes_.FetchAndAddSequentiallyConsistent(thread->TlabSize());
+  }
   thread->SetTlab(nullptr, nullptr);
 }
 
 bool BumpPointerSpace::AllocNewTlab(Thread* self, size_t bytes) {
-  MutexLock mu(Thread::Current(), block_lock_);
-  RevokeThreadLocalBuffersLocked(self);
-  byte* start = AllocBlock(bytes);
+  byte* start;
+  if (LIKELY(num_blocks_.LoadSequentiallyConsistent() != 0)) {
+    // The main block is fixed, the new block goes at the end of the space like an object. The TLAB
+    // of a thread is only revoked by itself or while it is suspended. The counts read by
+    // GetBytesAllocated may be off by this TLAB meanwhile.
+    RevokeTlab(self);
+    start = AllocBlockWithoutLock(bytes);
+  } else {
+    MutexLock mu(self, block_lock_);
+    RevokeTlab(self);
+    start = AllocBlock(bytes);
+  }
   if (start == nullptr) {
     return false;
   }
-  self->SetTlab(start, start + bytes);
+  self->SetTlab(start, start + RoundUp(bytes, kAlignment));
   return true;
 }
 
+size_t BumpPointerSpace::NextTlabSize(Thread* self) {
+  size_t tlab_size = self->GetTlabTargetSize();
+  if (self->IncrementTlabRefills() >= kTlabRefillsBeforeGrowing && tlab_size < kMaxTlabSize) {
+    tlab_size = std::min(tlab_size * 2, kMaxTlabSize);
+    self->SetTlabTargetSize(tlab_size);
+    self->ResetTlabRefills();
+  }
+  return tlab_size;
+}
+
+size_t BumpPointerSpace::TakeTlabWasteBytes() {
+  const size_t waste_bytes = tlab_waste_bytes_.LoadSequentiallyConsistent();
+  tlab_waste_bytes_.FetchAndSubSequentiallyConsistent(waste_bytes);
+  return waste_bytes;
+}
+
 }  // namespace space
 }  // namespace gc
 }  // namespace art
@@ -56,6 +56,13 @@ class BumpPointerSpace FINAL : public ContinuousMemMapAllocSpace {
   mirror::Object* AllocNonvirtual(size_t num_bytes);
   mirror::Object* AllocNonvirtualWithoutAccounting(size_t num_bytes);
 
+  // Accounts for objects placed in memory from AllocNonvirtualWithoutAccounting, e.g. by the GC
+  // threads copying into their own chunks of the space.
+  void RecordAllocations(size_t num_objects, size_t num_bytes) {
+    objects_allocated_.FetchAndAddSequentiallyConsistent(num_objects);
+    bytes_allocated_.FetchAndAddSequentiallyConsistent(num_bytes);
+  }
+
   // Return the storage space required by obj.
   size_t AllocationSize(mirror::Object* obj, size_t* usable_size) OVERRIDE
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -132,9 +139,18 @@ class BumpPointerSpace FINAL : public ContinuousMemMapAllocSpace {
   static mirror::Object* GetNextObject(mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  // Allocate a new TLAB, returns false if the allocation failed.
+  // Allocate a new TLAB, returns false if the allocation failed. Once the space has blocks, the
+  // TLAB is bumped off the end of the space without taking the block lock.
   bool AllocNewTlab(Thread* self, size_t bytes);
 
+  // The size of the next TLAB of self, to add to the allocation which needs it. It doubles for the
+  // threads which refill often between two GCs and halves at the GCs for the threads which don't
+  // use their TLAB.
+  static size_t NextTlabSize(Thread* self);
+
+  // Returns the bytes left unused at the end of the TLABs revoked since the last call.
+  size_t TakeTlabWasteBytes();
+
   BumpPointerSpace* AsBumpPointerSpace() OVERRIDE {
     return this;
   }
@@ -147,13 +163,21 @@ class BumpPointerSpace FINAL : public ContinuousMemMapAllocSpace {
 
   // Object alignment within the space.
   static constexpr size_t kAlignment = 8;
+  // The bounds of the adaptive TLAB size, which starts at Heap::kDefaultTLABSize.
+  static constexpr size_t kMinTlabSize = 32 * KB;
+  static constexpr size_t kMaxTlabSize = 2 * MB;
+  // The refills between two GCs after which the TLAB size of a thread doubles.
+  static constexpr size_t kTlabRefillsBeforeGrowing = 4;
 
  protected:
   BumpPointerSpace(const std::string& name, MemMap* mem_map);
 
   // Allocate a raw block of bytes.
   byte* AllocBlock(size_t bytes) EXCLUSIVE_LOCKS_REQUIRED(block_lock_);
-  void RevokeThreadLocalBuffersLocked(Thread* thread) EXCLUSIVE_LOCKS_REQUIRED(block_lock_);
+  // Only once there are blocks, the main block doesn't change anymore.
+  byte* AllocBlockWithoutLock(size_t bytes);
+  // Called with the block lock held, or without it by the thread refilling its own TLAB.
+  void RevokeTlab(Thread* thread);
 
   // The main block is an unbounded block where objects go when there are no other blocks. This
   // enables us to maintain tightly packed objects when you are not using thread local buffers for
@@ -168,8 +192,10 @@ class BumpPointerSpace FINAL : public ContinuousMemMapAllocSpace {
   // have a header, this lets us walk empty spaces which are mprotected.
   size_t main_block_size_ GUARDED_BY(block_lock_);
   // The number of blocks in the space, if it is 0 then the space has one long continuous block
-  // which doesn't have an updated header.
-  size_t num_blocks_ GUARDED_BY(block_lock_);
+  // which doesn't have an updated header. Only goes from 0 to 1 with the block lock held.
+  Atomic<size_t> num_blocks_;
+  // The unused ends of the revoked TLABs.
+  Atomic<size_t> tlab_waste_bytes_;
 
  private:
   struct BlockHeader {
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "bump_pointer_space.h"
+
+#include <memory>
+
+#include "common_runtime_test.h"
+#include "gc/heap.h"
+#include "thread-inl.h"
+
+namespace art {
+namespace gc {
+namespace space {
+
+class BumpPointerSpaceTest : public CommonRuntimeTest {};
+
+TEST_F(BumpPointerSpaceTest, AdaptiveTlabSize) {
+  Thread* self = Thread::Current();
+  std::unique_ptr<BumpPointerSpace> space(BumpPointerSpace::Create("test", 16 * MB, nullptr));
+  ASSERT_TRUE(space.get() != nullptr);
+  const size_t default_size = Heap::kDefaultTLABSize;
+  ASSERT_EQ(default_size, self->GetTlabTargetSize());
+  self->ResetTlabRefills();
+
+  // The size doubles on the refill which reaches the threshold.
+  const size_t num_refills = BumpPointerSpace::kTlabRefillsBeforeGrowing;
+  for (size_t i = 1; i < num_refills; ++i) {
+    size_t tlab_size = BumpPointerSpace::NextTlabSize(self);
+    EXPECT_EQ(default_size, tlab_size);
+    ASSERT_TRUE(space->AllocNewTlab(self, tlab_size));
+  }
+  size_t tlab_size = BumpPointerSpace::NextTlabSize(self);
+  EXPECT_EQ(2 * default_size, tlab_size);
+  ASSERT_TRUE(space->AllocNewTlab(self, tlab_size));
+  EXPECT_EQ(tlab_size, self->TlabSize());
+
+  // The TLABs replaced while unused are waste, and so is the unused last one once revoked.
+  self->AllocTlab(BumpPointerSpace::kAlignment);
+  space->RevokeThreadLocalBuffers(self);
+  EXPECT_FALSE(self->HasTlab());
+  EXPECT_EQ((num_refills - 1) * default_size + tlab_size - BumpPointerSpace::kAlignment,
+            space->TakeTlabWasteBytes());
+  EXPECT_EQ(0U, space->TakeTlabWasteBytes());
+  // It was barely used since the last refill, so the size halves.
+  EXPECT_EQ(default_size, self->GetTlabTargetSize());
+  EXPECT_EQ(0U, self->GetTlabRefills());
+}
+
+}  // namespace space
+}  // namespace gc
+}  // namespace art
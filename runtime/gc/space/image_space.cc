@@ -16,9 +16,14 @@
 
 #include "image_space.h"
 
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
 #include "gc/accounting/space_bitmap-inl.h"
+#include "gc/heap.h"
 #include "mirror/art_method.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
@@ -98,6 +103,36 @@ static bool GenerateImage(const std::string& image_filename, std::string* error_
   return Exec(arg_vector, error_msg);
 }
 
+// Largest number of bytes an image which can't be mapped at its address is moved by.
+static constexpr int32_t kMaxRelocationDelta = 16 * MB;
+
+// Picks a page aligned delta other than zero within kMaxRelocationDelta bytes either way.
+static int32_t ChooseRelocationOffsetDelta() {
+  const int32_t max_pages = kMaxRelocationDelta / kPageSize;
+  int32_t pages = static_cast<int32_t>(NanoTime() % (2 * max_pages)) - max_pages;
+  if (pages >= 0) {
+    ++pages;
+  }
+  return pages * kPageSize;
+}
+
+// Moves the image and its oat file by rewriting their absolute addresses with patchoat, which is
+// much faster than compiling them again with GenerateImage.
+static bool RelocateImage(const std::string& image_filename, const std::string& dest_filename,
+                          std::string* error_msg) {
+  std::vector<std::string> arg_vector;
+  arg_vector.push_back(Runtime::Current()->GetPatchoatExecutable());
+  arg_vector.push_back("--input-image=" + image_filename);
+  arg_vector.push_back("--output-image=" + dest_filename);
+  const int32_t delta = ChooseRelocationOffsetDelta();
+  arg_vector.push_back(StringPrintf("--base-offset-delta=%s%#x", delta < 0 ? "-" : "",
+                                    static_cast<uint32_t>(std::abs(delta))));
+
+  std::string command_line(Join(arg_vector, ' '));
+  LOG(INFO) << "RelocateImage: " << command_line;
+  return Exec(arg_vector, error_msg);
+}
+
 bool ImageSpace::FindImageFilename(const char* image_location,
                                    const InstructionSet image_isa,
                                    std::string* image_filename,
@@ -155,6 +190,24 @@ ImageSpace* ImageSpace::Create(const char* image_location,
       return space;
     }
 
+    // The image may only fail to map at its address, try to move it elsewhere. The /system image
+    // is read-only and moved to the dalvik-cache.
+    std::string relocated_filename(image_filename);
+    if (is_system) {
+      const std::string dalvik_cache = GetDalvikCacheOrDie(GetInstructionSetString(image_isa));
+      relocated_filename = GetDalvikCacheFilenameOrDie(image_location, dalvik_cache.c_str());
+    }
+    std::string relocation_error_msg;
+    if (RelocateImage(image_filename, relocated_filename, &relocation_error_msg)) {
+      space = ImageSpace::Init(relocated_filename.c_str(), image_location, !is_system,
+                               &relocation_error_msg);
+      if (space != nullptr) {
+        return space;
+      }
+    }
+    LOG(WARNING) << "Failed to relocate image '" << image_filename << "': "
+                 << relocation_error_msg;
+
     // If the /system file exists, it should be up-to-date, don't try to generate it.
     // If it's not the /system file, log a warning and fall through to GenerateImage.
     if (is_system) {
@@ -188,17 +241,8 @@ void ImageSpace::VerifyImageAllocations() {
   }
 }
 
-ImageSpace* ImageSpace::Init(const char* image_filename, const char* image_location,
-                             bool validate_oat_file, std::string* error_msg) {
-  CHECK(image_filename != nullptr);
-  CHECK(image_location != nullptr);
-
-  uint64_t start_time = 0;
-  if (VLOG_IS_ON(heap) || VLOG_IS_ON(startup)) {
-    start_time = NanoTime();
-    LOG(INFO) << "ImageSpace::Init entering image_filename=" << image_filename;
-  }
-
+ImageSpace* ImageSpace::MapImage(const char* image_filename, const char* image_location,
+                                 std::string* error_msg) {
   std::unique_ptr<File> file(OS::OpenFileForReading(image_filename));
   if (file.get() == NULL) {
     *error_msg = StringPrintf("Failed to open '%s'", image_filename);
@@ -250,8 +294,25 @@ ImageSpace* ImageSpace::Init(const char* image_filename, const char* image_locat
     return nullptr;
   }
 
-  std::unique_ptr<ImageSpace> space(new ImageSpace(image_filename, image_location,
-                                             map.release(), bitmap.release()));
+  return new ImageSpace(image_filename, image_location, map.release(), bitmap.release());
+}
+
+ImageSpace* ImageSpace::Init(const char* image_filename, const char* image_location,
+                             bool validate_oat_file, std::string* error_msg) {
+  CHECK(image_filename != nullptr);
+  CHECK(image_location != nullptr);
+
+  uint64_t start_time = 0;
+  if (VLOG_IS_ON(heap) || VLOG_IS_ON(startup)) {
+    start_time = NanoTime();
+    LOG(INFO) << "ImageSpace::Init entering image_filename=" << image_filename;
+  }
+
+  std::unique_ptr<ImageSpace> space(MapImage(image_filename, image_location, error_msg));
+  if (space.get() == nullptr) {
+    return nullptr;
+  }
+  const ImageHeader& image_header = space->GetImageHeader();
 
   // VerifyImageAllocations() will be called later in Runtime::Init()
   // as some class roots like ArtMethod::java_lang_reflect_ArtMethod_
@@ -294,6 +355,53 @@ ImageSpace* ImageSpace::Init(const char* image_filename, const char* image_locat
   return space.release();
 }
 
+ImageSpace* ImageSpace::CreateAppImage(const char* image_filename, const OatFile& oat_file,
+                                       std::string* error_msg) {
+  ImageSpace* boot_image_space = Runtime::Current()->GetHeap()->GetImageSpace();
+  CHECK(boot_image_space != nullptr);
+  std::unique_ptr<ImageSpace> space(MapImage(image_filename, image_filename, error_msg));
+  if (space.get() == nullptr) {
+    return nullptr;
+  }
+  const ImageHeader& image_header = space->GetImageHeader();
+  // The app image points into the boot image, it is only valid with the one it was written for.
+  uint32_t boot_oat_checksum = boot_image_space->GetImageHeader().GetOatChecksum();
+  if (!image_header.IsAppImage() || image_header.GetBootOatChecksum() != boot_oat_checksum) {
+    *error_msg = StringPrintf("App image %s was written for boot oat checksum 0x%x instead of 0x%x",
+                              image_filename, image_header.GetBootOatChecksum(),
+                              boot_oat_checksum);
+    return nullptr;
+  }
+  if (image_header.GetOatChecksum() != oat_file.GetOatHeader().GetChecksum()) {
+    *error_msg = StringPrintf("App image %s was written for oat checksum 0x%x instead of 0x%x",
+                              image_filename, image_header.GetOatChecksum(),
+                              oat_file.GetOatHeader().GetChecksum());
+    return nullptr;
+  }
+  // The heap's card table only covers the area below the boot image reserved for app images.
+  byte* area_begin = boot_image_space->Begin() - kAppImageAreaSize;
+  if (space->Begin() < area_begin || image_header.GetOatFileEnd() > boot_image_space->Begin()) {
+    *error_msg = StringPrintf("App image %s at %p is outside of the app image area at %p",
+                              image_filename, space->Begin(), area_begin);
+    return nullptr;
+  }
+  // A mapping of the oat file at the address its code is referenced from by the image.
+  space->oat_file_.reset(OatFile::Open(oat_file.GetLocation(), oat_file.GetLocation(),
+                                       image_header.GetOatDataBegin(),
+                                       !Runtime::Current()->IsCompiler(), error_msg));
+  if (space->oat_file_.get() == nullptr) {
+    *error_msg = StringPrintf("Failed to open oat file '%s' referenced from app image %s: %s",
+                              oat_file.GetLocation().c_str(), image_filename, error_msg->c_str());
+    return nullptr;
+  }
+  if (space->oat_file_->GetOatHeader().GetChecksum() != image_header.GetOatChecksum()) {
+    *error_msg = StringPrintf("Oat file '%s' changed while opening app image %s",
+                              oat_file.GetLocation().c_str(), image_filename);
+    return nullptr;
+  }
+  return space.release();
+}
+
 OatFile* ImageSpace::OpenOatFile(const char* image_path, std::string* error_msg) const {
   const ImageHeader& image_header = GetImageHeader();
   std::string oat_filename = ImageHeader::GetOatLocationFromImageLocation(image_path);
@@ -337,6 +445,143 @@ bool ImageSpace::ValidateOatFile(std::string* error_msg) const {
   return true;
 }
 
+static void AdviseWillNeedRange(const byte* begin, const byte* end) {
+  byte* aligned_begin = AlignDown(const_cast<byte*>(begin), kPageSize);
+  byte* aligned_end = AlignUp(const_cast<byte*>(end), kPageSize);
+  if (madvise(aligned_begin, aligned_end - aligned_begin, MADV_WILLNEED) != 0) {
+    // Only a hint, startup is just slower without it.
+    PLOG(WARNING) << "madvise(" << reinterpret_cast<void*>(aligned_begin) << ", "
+                  << aligned_end - aligned_begin << ", MADV_WILLNEED) failed";
+  }
+}
+
+void ImageSpace::AdviseWillNeed() const {
+  CHECK(oat_file_.get() != NULL);
+  AdviseWillNeedRange(Begin(), End());
+  AdviseWillNeedRange(oat_file_->Begin(), oat_file_->End());
+}
+
+// A prefetch profile is a text file. The first line holds the page counts of the image and of
+// the oat data, so that a profile recorded against another image is ignored. Each following
+// line is a run of resident pages, "i <first page> <page count>" for the image and "o ..." for
+// the oat data.
+static size_t PageCount(const byte* begin, const byte* end) {
+  return (AlignUp(const_cast<byte*>(end), kPageSize) -
+          AlignDown(const_cast<byte*>(begin), kPageSize)) / kPageSize;
+}
+
+static void AppendResidentRuns(char tag, const byte* begin, const byte* end,
+                               std::string* profile) {
+  byte* aligned_begin = AlignDown(const_cast<byte*>(begin), kPageSize);
+  size_t num_pages = PageCount(begin, end);
+  std::vector<unsigned char> residency(num_pages);
+  if (mincore(aligned_begin, num_pages * kPageSize, &residency[0]) != 0) {
+    PLOG(WARNING) << "mincore(" << reinterpret_cast<void*>(aligned_begin) << ", "
+                  << num_pages * kPageSize << ") failed";
+    return;
+  }
+  size_t page = 0;
+  while (page < num_pages) {
+    if ((residency[page] & 1) == 0) {
+      ++page;
+      continue;
+    }
+    size_t first = page;
+    while (page < num_pages && (residency[page] & 1) != 0) {
+      ++page;
+    }
+    StringAppendF(profile, "%c %zu %zu\n", tag, first, page - first);
+  }
+}
+
+struct PrefetchRecording {
+  std::string profile;
+  uint32_t delay_s;
+  const byte* image_begin;
+  const byte* image_end;
+  const byte* oat_begin;
+  const byte* oat_end;
+};
+
+// Runs detached and never attaches to the runtime; it only looks at address ranges, which stay
+// mapped for the life of the process.
+static void* RecordPrefetchProfile(void* arg) {
+  std::unique_ptr<PrefetchRecording> recording(reinterpret_cast<PrefetchRecording*>(arg));
+  sleep(recording->delay_s);
+  std::string profile = StringPrintf("%zu %zu\n",
+                                     PageCount(recording->image_begin, recording->image_end),
+                                     PageCount(recording->oat_begin, recording->oat_end));
+  AppendResidentRuns('i', recording->image_begin, recording->image_end, &profile);
+  AppendResidentRuns('o', recording->oat_begin, recording->oat_end, &profile);
+  std::unique_ptr<File> file(OS::CreateEmptyFile(recording->profile.c_str()));
+  if (file.get() == nullptr || !file->WriteFully(profile.data(), profile.size())) {
+    PLOG(WARNING) << "Failed to write image prefetch profile " << recording->profile;
+    return nullptr;
+  }
+  VLOG(startup) << "Wrote image prefetch profile " << recording->profile;
+  return nullptr;
+}
+
+void ImageSpace::StartRecordingPrefetchProfile(const std::string& profile,
+                                               uint32_t delay_s) const {
+  const ImageHeader& image_header = GetImageHeader();
+  PrefetchRecording* recording = new PrefetchRecording;
+  recording->profile = profile;
+  recording->delay_s = delay_s;
+  recording->image_begin = Begin();
+  recording->image_end = End();
+  recording->oat_begin = image_header.GetOatDataBegin();
+  recording->oat_end = image_header.GetOatDataEnd();
+  pthread_attr_t attr;
+  CHECK_PTHREAD_CALL(pthread_attr_init, (&attr), "image prefetch recorder");
+  CHECK_PTHREAD_CALL(pthread_attr_setdetachstate, (&attr, PTHREAD_CREATE_DETACHED),
+                     "image prefetch recorder");
+  pthread_t thread;
+  int rc = pthread_create(&thread, &attr, RecordPrefetchProfile, recording);
+  CHECK_PTHREAD_CALL(pthread_attr_destroy, (&attr), "image prefetch recorder");
+  if (rc != 0) {
+    errno = rc;
+    PLOG(WARNING) << "Failed to start the image prefetch recorder";
+    delete recording;
+  }
+}
+
+bool ImageSpace::AdviseWillNeedFromProfile(const std::string& profile) const {
+  std::string contents;
+  if (!ReadFileToString(profile, &contents)) {
+    return false;
+  }
+  const ImageHeader& image_header = GetImageHeader();
+  const byte* image_begin = AlignDown(Begin(), kPageSize);
+  const byte* oat_begin = AlignDown(image_header.GetOatDataBegin(), kPageSize);
+  size_t image_pages = PageCount(Begin(), End());
+  size_t oat_pages = PageCount(image_header.GetOatDataBegin(), image_header.GetOatDataEnd());
+  std::vector<std::string> lines;
+  Split(contents, '\n', lines);
+  size_t profile_image_pages;
+  size_t profile_oat_pages;
+  if (lines.empty() ||
+      sscanf(lines[0].c_str(), "%zu %zu", &profile_image_pages, &profile_oat_pages) != 2 ||
+      profile_image_pages != image_pages || profile_oat_pages != oat_pages) {
+    VLOG(startup) << "Ignoring stale image prefetch profile " << profile;
+    return false;
+  }
+  for (size_t i = 1; i < lines.size(); ++i) {
+    char tag;
+    size_t first;
+    size_t count;
+    if (sscanf(lines[i].c_str(), "%c %zu %zu", &tag, &first, &count) != 3 ||
+        (tag != 'i' && tag != 'o') || first > (tag == 'i' ? image_pages : oat_pages) ||
+        count > (tag == 'i' ? image_pages : oat_pages) - first) {
+      LOG(WARNING) << "Bad line in image prefetch profile " << profile << ": " << lines[i];
+      return false;
+    }
+    const byte* begin = (tag == 'i' ? image_begin : oat_begin) + first * kPageSize;
+    AdviseWillNeedRange(begin, begin + count * kPageSize);
+  }
+  return true;
+}
+
 OatFile* ImageSpace::ReleaseOatFile() {
   CHECK(oat_file_.get() != NULL);
   return oat_file_.release();
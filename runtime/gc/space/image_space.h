@@ -46,6 +46,17 @@ class ImageSpace : public MemMapSpace {
   static ImageSpace* Create(const char* image, InstructionSet image_isa)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Maps the app image at image_filename along with a second mapping of its oat file, which is
+  // already open as oat_file, at the address the image expects. Returns null if the image can't be
+  // used with the boot image of the runtime or be mapped at its address.
+  static ImageSpace* CreateAppImage(const char* image_filename, const OatFile& oat_file,
+                                    std::string* error_msg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Size of the area below the boot image that app images and their oat files are written for.
+  // The heap's card table covers it so that app images can be added to the running heap.
+  static constexpr size_t kAppImageAreaSize = 64 * MB;
+
   // Reads the image header from the specified image location for the
   // instruction set image_isa.
   static ImageHeader* ReadImageHeaderOrDie(const char* image_location,
@@ -59,10 +70,28 @@ class ImageSpace : public MemMapSpace {
   void VerifyImageAllocations()
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Asks the kernel to start reading in the image and its oat file. Readahead is asynchronous,
+  // so the I/O overlaps the rest of runtime startup instead of faulting in page by page. Must
+  // be called before ReleaseOatFile.
+  void AdviseWillNeed() const;
+
+  // Like AdviseWillNeed, but only for the pages listed in a profile written by an earlier run.
+  // Returns false if there is no usable profile. Issues part of the advice if a bad entry is
+  // found part way through.
+  bool AdviseWillNeedFromProfile(const std::string& profile) const;
+
+  // Starts a detached thread that records which pages of the image and its oat data are resident
+  // after delay_s seconds and writes them to profile for AdviseWillNeedFromProfile.
+  void StartRecordingPrefetchProfile(const std::string& profile, uint32_t delay_s) const;
+
   const ImageHeader& GetImageHeader() const {
     return *reinterpret_cast<ImageHeader*>(Begin());
   }
 
+  bool IsAppImage() const {
+    return GetImageHeader().IsAppImage();
+  }
+
   // Actual filename where image was loaded from.
   // For example: /data/dalvik-cache/arm/system@framework@boot.art
   const std::string GetImageFilename() const {
@@ -107,6 +136,10 @@ class ImageSpace : public MemMapSpace {
                           bool validate_oat_file, std::string* error_msg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Maps the image and its live bitmap, without the oat file.
+  static ImageSpace* MapImage(const char* image_filename, const char* image_location,
+                              std::string* error_msg);
+
   // Returns the filename of the image corresponding to
   // requested image_location, or the filename where a new image
   // should be written if one doesn't exist. Looks for a generated
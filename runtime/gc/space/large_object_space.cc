@@ -16,6 +16,7 @@
 
 #include "large_object_space.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "gc/accounting/space_bitmap-inl.h"
@@ -87,7 +88,7 @@ void LargeObjectSpace::SwapBitmaps() {
 LargeObjectSpace::LargeObjectSpace(const std::string& name, byte* begin, byte* end)
     : DiscontinuousSpace(name, kGcRetentionPolicyAlwaysCollect),
       num_bytes_allocated_(0), num_objects_allocated_(0), total_bytes_allocated_(0),
-      total_objects_allocated_(0), begin_(begin), end_(end) {
+      total_objects_allocated_(0), total_bytes_released_(0), begin_(begin), end_(end) {
 }
 
 
@@ -149,6 +150,7 @@ size_t LargeObjectMapSpace::Free(Thread* self, mirror::Object* ptr) {
   size_t allocation_size = found->second->Size();
   num_bytes_allocated_ -= allocation_size;
   --num_objects_allocated_;
+  total_bytes_released_ += allocation_size;
   delete found->second;
   mem_maps_.erase(found);
   return allocation_size;
@@ -206,6 +208,8 @@ FreeListSpace::FreeListSpace(const std::string& name, MemMap* mem_map, byte* beg
       mem_map_(mem_map),
       lock_("free list space lock", kAllocSpaceLock) {
   free_end_ = end - begin;
+  std::fill(free_bins_, free_bins_ + kNumBins, nullptr);
+  std::fill(non_empty_bins_, non_empty_bins_ + kNumBinWords, 0u);
 }
 
 FreeListSpace::~FreeListSpace() {}
@@ -225,13 +229,98 @@ void FreeListSpace::Walk(DlMallocSpace::WalkCallback callback, void* arg) {
   }
 }
 
+size_t FreeListSpace::GetBinIndex(size_t free_size) {
+  DCHECK(IsAligned<kAlignment>(free_size));
+  const size_t num_pages = free_size / kAlignment;
+  DCHECK_NE(num_pages, 0U);
+  if (num_pages <= kNumExactBins) {
+    return num_pages - 1;
+  }
+  // Blocks of [2^n, 2^(n+1)) pages, starting from the first power of 2 after the exact bins.
+  const size_t high_bit = sizeof(size_t) * kBitsPerByte - 1 - CLZ(num_pages);
+  const size_t bin_index = kNumExactBins + high_bit - CTZ(kNumExactBins);
+  DCHECK_LT(bin_index, kNumBins);
+  return bin_index;
+}
+
+void FreeListSpace::AddFreePrev(AllocationHeader* header) {
+  DCHECK(!header->IsFree());
+  DCHECK_GT(header->GetPrevFree(), size_t(0));
+  const size_t bin_index = GetBinIndex(header->GetPrevFree());
+  AllocationHeader* const head = free_bins_[bin_index];
+  header->prev_free_block_ = nullptr;
+  header->next_free_block_ = head;
+  if (head != nullptr) {
+    head->prev_free_block_ = header;
+  }
+  free_bins_[bin_index] = header;
+  non_empty_bins_[bin_index / 64] |= UINT64_C(1) << (bin_index % 64);
+}
+
 void FreeListSpace::RemoveFreePrev(AllocationHeader* header) {
   CHECK(!header->IsFree());
   CHECK_GT(header->GetPrevFree(), size_t(0));
-  FreeBlocks::iterator found = free_blocks_.lower_bound(header);
-  CHECK(found != free_blocks_.end());
-  CHECK_EQ(*found, header);
-  free_blocks_.erase(found);
+  const size_t bin_index = GetBinIndex(header->GetPrevFree());
+  AllocationHeader* const prev = header->prev_free_block_;
+  AllocationHeader* const next = header->next_free_block_;
+  if (prev != nullptr) {
+    DCHECK_EQ(prev->next_free_block_, header);
+    prev->next_free_block_ = next;
+  } else {
+    CHECK_EQ(free_bins_[bin_index], header);
+    free_bins_[bin_index] = next;
+    if (next == nullptr) {
+      non_empty_bins_[bin_index / 64] &= ~(UINT64_C(1) << (bin_index % 64));
+    }
+  }
+  if (next != nullptr) {
+    DCHECK_EQ(next->prev_free_block_, header);
+    next->prev_free_block_ = prev;
+  }
+  header->prev_free_block_ = nullptr;
+  header->next_free_block_ = nullptr;
+}
+
+size_t FreeListSpace::FindNonEmptyBin(size_t bin_index) const {
+  if (bin_index >= kNumBins) {
+    return kNumBins;
+  }
+  size_t word_index = bin_index / 64;
+  uint64_t word = non_empty_bins_[word_index] & (~UINT64_C(0) << (bin_index % 64));
+  while (word == 0) {
+    if (++word_index == kNumBinWords) {
+      return kNumBins;
+    }
+    word = non_empty_bins_[word_index];
+  }
+  return word_index * 64 + CTZ(word);
+}
+
+FreeListSpace::AllocationHeader* FreeListSpace::FindBestFit(size_t size) const {
+  size_t bin_index = FindNonEmptyBin(GetBinIndex(size));
+  while (bin_index < kNumBins) {
+    if (bin_index < kNumExactBins) {
+      // All the blocks of an exact bin have the same size.
+      return free_bins_[bin_index];
+    }
+    // Find the smallest block of the bin which fits, the lowest one if there are several. Only
+    // the bin of the requested size may not have any.
+    AllocationHeader* best = nullptr;
+    for (AllocationHeader* cur = free_bins_[bin_index]; cur != nullptr;
+         cur = cur->next_free_block_) {
+      const size_t free_size = cur->GetPrevFree();
+      if (free_size >= size &&
+          (best == nullptr || free_size < best->GetPrevFree() ||
+           (free_size == best->GetPrevFree() && cur < best))) {
+        best = cur;
+      }
+    }
+    if (best != nullptr) {
+      return best;
+    }
+    bin_index = FindNonEmptyBin(bin_index + 1);
+  }
+  return nullptr;
 }
 
 FreeListSpace::AllocationHeader* FreeListSpace::GetAllocationHeader(const mirror::Object* obj) {
@@ -252,6 +341,51 @@ FreeListSpace::AllocationHeader* FreeListSpace::AllocationHeader::GetNextNonFree
 
 size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
   MutexLock mu(self, lock_);
+  const size_t allocation_size = FreeLocked(obj);
+  byte* const begin = reinterpret_cast<byte*>(GetAllocationHeader(obj));
+  ReleasePages(begin, begin + allocation_size);
+  return allocation_size;
+}
+
+size_t FreeListSpace::FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) {
+  MutexLock mu(self, lock_);
+  size_t total = 0;
+  // The swept objects come in address order, so runs of adjacent objects are released at once.
+  byte* release_begin = nullptr;
+  byte* release_end = nullptr;
+  for (size_t i = 0; i < num_ptrs; ++i) {
+    const size_t allocation_size = FreeLocked(ptrs[i]);
+    byte* const begin = reinterpret_cast<byte*>(GetAllocationHeader(ptrs[i]));
+    total += allocation_size;
+    if (begin != release_end) {
+      if (release_begin != nullptr) {
+        ReleasePages(release_begin, release_end);
+      }
+      release_begin = begin;
+    }
+    release_end = begin + allocation_size;
+  }
+  if (release_begin != nullptr) {
+    ReleasePages(release_begin, release_end);
+  }
+  return total;
+}
+
+void FreeListSpace::ReleasePages(byte* begin, byte* end) {
+  DCHECK_LT(begin, end);
+  DCHECK(IsAligned<kAlignment>(begin));
+  DCHECK(IsAligned<kAlignment>(end));
+  // Free memory always reads as zero after this, which is what lets Alloc skip clearing the
+  // recycled chunks however large they are.
+  madvise(begin, end - begin, MADV_DONTNEED);
+  total_bytes_released_ += end - begin;
+  if (kIsDebugBuild) {
+    // Can't disallow reads since we use them to find next chunks during coalescing.
+    mprotect(begin, end - begin, PROT_READ);
+  }
+}
+
+size_t FreeListSpace::FreeLocked(mirror::Object* obj) {
   DCHECK(Contains(obj));
   AllocationHeader* header = GetAllocationHeader(obj);
   CHECK(IsAligned<kAlignment>(header));
@@ -287,16 +421,14 @@ size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
       new_free_header = next_header;
     }
     new_free_header->prev_free_ = new_free_size;
-    free_blocks_.insert(new_free_header);
+    AddFreePrev(new_free_header);
   }
+  // The header is free memory now, even before the page release zeroes it.
+  header->SetPrevFree(0);
+  header->alloc_size_ = 0;
   --num_objects_allocated_;
   DCHECK_LE(allocation_size, num_bytes_allocated_);
   num_bytes_allocated_ -= allocation_size;
-  madvise(header, allocation_size, MADV_DONTNEED);
-  if (kIsDebugBuild) {
-    // Can't disallow reads since we use them to find next chunks during coalescing.
-    mprotect(header, allocation_size, PROT_READ);
-  }
   return allocation_size;
 }
 
@@ -319,15 +451,11 @@ mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* byt
                                      size_t* usable_size) {
   MutexLock mu(self, lock_);
   size_t allocation_size = RoundUp(num_bytes + sizeof(AllocationHeader), kAlignment);
-  AllocationHeader temp;
-  temp.SetPrevFree(allocation_size);
-  temp.SetAllocationSize(0);
   AllocationHeader* new_header;
   // Find the smallest chunk at least num_bytes in size.
-  FreeBlocks::iterator found = free_blocks_.lower_bound(&temp);
-  if (found != free_blocks_.end()) {
-    AllocationHeader* header = *found;
-    free_blocks_.erase(found);
+  AllocationHeader* header = FindBestFit(allocation_size);
+  if (header != nullptr) {
+    RemoveFreePrev(header);
 
     // Fit our object in the previous free header space.
     new_header = header->GetPrevFreeAllocationHeader();
@@ -335,8 +463,8 @@ mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* byt
     // Remove the newly allocated block from the header and update the prev_free_.
     header->prev_free_ -= allocation_size;
     if (header->prev_free_ > 0) {
-      // If there is remaining space, insert back into the free set.
-      free_blocks_.insert(header);
+      // If there is remaining space, insert back into its new bin.
+      AddFreePrev(header);
     }
   } else {
     // Try to steal some memory from the free space at the end of the space.
@@ -361,12 +489,15 @@ mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* byt
   total_bytes_allocated_ += allocation_size;
 
   // We always put our object at the start of the free block, there can not be another free block
-  // before it.
+  // before it. The block was released when it was freed, so apart from the header written below
+  // the object is backed by zero pages and needs no clearing.
   if (kIsDebugBuild) {
     mprotect(new_header, allocation_size, PROT_READ | PROT_WRITE);
   }
   new_header->SetPrevFree(0);
   new_header->SetAllocationSize(allocation_size);
+  new_header->prev_free_block_ = nullptr;
+  new_header->next_free_block_ = nullptr;
   return new_header->GetObjectAddress();
 }
 
@@ -402,7 +533,9 @@ void LargeObjectSpace::SweepCallback(size_t num_ptrs, mirror::Object** ptrs, voi
   SweepCallbackContext* context = static_cast<SweepCallbackContext*>(arg);
   space::LargeObjectSpace* space = context->space->AsLargeObjectSpace();
   Thread* self = context->self;
-  Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
+  if (!context->on_gc_worker) {
+    Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
+  }
   // If the bitmaps aren't swapped we need to clear the bits since the GC isn't going to re-swap
   // the bitmaps as an optimization.
   if (!context->swap_bitmaps) {
@@ -416,7 +549,7 @@ void LargeObjectSpace::SweepCallback(size_t num_ptrs, mirror::Object** ptrs, voi
 }
 
 void LargeObjectSpace::Sweep(bool swap_bitmaps, size_t* out_freed_objects,
-                             size_t* out_freed_bytes) {
+                             size_t* out_freed_bytes, bool on_gc_worker) {
   if (Begin() >= End()) {
     return;
   }
@@ -427,7 +560,7 @@ void LargeObjectSpace::Sweep(bool swap_bitmaps, size_t* out_freed_objects,
   }
   DCHECK(out_freed_objects != nullptr);
   DCHECK(out_freed_bytes != nullptr);
-  SweepCallbackContext scc(swap_bitmaps, this);
+  SweepCallbackContext scc(swap_bitmaps, this, on_gc_worker);
   accounting::LargeObjectBitmap::SweepWalk(*live_bitmap, *mark_bitmap,
                                            reinterpret_cast<uintptr_t>(Begin()),
                                            reinterpret_cast<uintptr_t>(End()), SweepCallback, &scc);
@@ -22,7 +22,6 @@
 #include "safe_map.h"
 #include "space.h"
 
-#include <set>
 #include <vector>
 
 namespace art {
@@ -57,6 +56,12 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
     return total_objects_allocated_;
   }
 
+  // Bytes of freed large objects which have been handed back to the kernel. Allocations reuse
+  // them as fresh zero pages, so they never need to be cleared by the allocating thread.
+  uint64_t GetTotalBytesReleased() const {
+    return total_bytes_released_;
+  }
+
   size_t FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) OVERRIDE;
 
   // LargeObjectSpaces don't have thread local state.
@@ -73,7 +78,9 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
     return this;
   }
 
-  void Sweep(bool swap_bitmaps, size_t* out_freed_objects, size_t* out_freed_bytes);
+  // Set on_gc_worker when a GC worker sweeps while the GC thread holds the heap bitmap lock.
+  void Sweep(bool swap_bitmaps, size_t* out_freed_objects, size_t* out_freed_bytes,
+             bool on_gc_worker = false);
 
   virtual bool CanMoveObjects() const OVERRIDE {
     return false;
@@ -99,6 +106,7 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
   uint64_t num_objects_allocated_;
   uint64_t total_bytes_allocated_;
   uint64_t total_objects_allocated_;
+  uint64_t total_bytes_released_;
 
   // Begin and end, may change as more large objects are allocated.
   byte* begin_;
@@ -150,6 +158,9 @@ class FreeListSpace FINAL : public LargeObjectSpace {
   mirror::Object* Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated,
                         size_t* usable_size) OVERRIDE;
   size_t Free(Thread* self, mirror::Object* obj) OVERRIDE;
+  // Frees the objects under a single acquisition of the lock and releases the pages of objects
+  // adjacent in memory with a single madvise.
+  size_t FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) OVERRIDE;
   bool Contains(const mirror::Object* obj) const OVERRIDE;
   void Walk(DlMallocSpace::WalkCallback callback, void* arg) OVERRIDE LOCKS_EXCLUDED(lock_);
 
@@ -172,6 +183,11 @@ class FreeListSpace FINAL : public LargeObjectSpace {
 
  protected:
   static const size_t kAlignment = kPageSize;
+  // Free blocks of up to kNumExactBins pages are kept in one bin per number of pages, larger free
+  // blocks in one bin per power of 2 of their number of pages.
+  static constexpr size_t kNumExactBins = 64;
+  static constexpr size_t kNumBins = kNumExactBins + sizeof(size_t) * kBitsPerByte;
+  static constexpr size_t kNumBinWords = RoundUp(kNumBins, 64) / 64;
 
   class AllocationHeader {
    public:
@@ -222,20 +238,6 @@ class FreeListSpace FINAL : public LargeObjectSpace {
     // TODO: Optimize, currently O(n) for n free following pages.
     AllocationHeader* GetNextNonFree();
 
-    // Used to implement best fit object allocation. Each allocation has an AllocationHeader which
-    // contains the size of the previous free block preceding it. Implemented in such a way that we
-    // can also find the iterator for any allocation header pointer.
-    class SortByPrevFree {
-     public:
-      bool operator()(const AllocationHeader* a, const AllocationHeader* b) const {
-        if (a->GetPrevFree() < b->GetPrevFree()) return true;
-        if (a->GetPrevFree() > b->GetPrevFree()) return false;
-        if (a->AllocationSize() < b->AllocationSize()) return true;
-        if (a->AllocationSize() > b->AllocationSize()) return false;
-        return reinterpret_cast<uintptr_t>(a) < reinterpret_cast<uintptr_t>(b);
-      }
-    };
-
    private:
     // Contains the size of the previous free block, if 0 then the memory preceding us is an
     // allocation.
@@ -244,26 +246,49 @@ class FreeListSpace FINAL : public LargeObjectSpace {
     // Allocation size of this object, 0 means that the allocation header is free memory.
     size_t alloc_size_;
 
+    // Links of the free block bin list, valid only if the previous free block isn't empty. The
+    // free blocks are tracked by the header following them so that no memory is needed for them.
+    AllocationHeader* prev_free_block_;
+    AllocationHeader* next_free_block_;
+
     friend class FreeListSpace;
   };
 
   FreeListSpace(const std::string& name, MemMap* mem_map, byte* begin, byte* end);
 
-  // Removes header from the free blocks set by finding the corresponding iterator and erasing it.
+  // Returns the index of the bin of free blocks of free_size bytes.
+  static size_t GetBinIndex(size_t free_size);
+
+  // Adds the free block preceding header to its bin.
+  void AddFreePrev(AllocationHeader* header) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Removes the free block preceding header from its bin.
   void RemoveFreePrev(AllocationHeader* header) EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Returns the index of the first non empty bin at or after bin_index, kNumBins if there is none.
+  size_t FindNonEmptyBin(size_t bin_index) const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Returns the header following the smallest free block of at least size bytes, null if there is
+  // no such block.
+  AllocationHeader* FindBestFit(size_t size) const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Frees obj without releasing its pages and returns its allocation size.
+  size_t FreeLocked(mirror::Object* obj) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Returns the pages of the freed memory to the kernel.
+  void ReleasePages(byte* begin, byte* end) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Finds the allocation header corresponding to obj.
   AllocationHeader* GetAllocationHeader(const mirror::Object* obj);
 
-  typedef std::set<AllocationHeader*, AllocationHeader::SortByPrevFree,
-                   accounting::GcAllocator<AllocationHeader*>> FreeBlocks;
-
   // There is not footer for any allocations at the end of the space, so we keep track of how much
   // free space there is at the end manually.
   std::unique_ptr<MemMap> mem_map_;
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   size_t free_end_ GUARDED_BY(lock_);
-  FreeBlocks free_blocks_ GUARDED_BY(lock_);
+  // Heads of the doubly linked lists of free blocks, and a bitmap of the non empty lists.
+  AllocationHeader* free_bins_[kNumBins] GUARDED_BY(lock_);
+  uint64_t non_empty_bins_[kNumBinWords] GUARDED_BY(lock_);
 };
 
 }  // namespace space
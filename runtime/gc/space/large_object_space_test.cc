@@ -28,6 +28,8 @@ class LargeObjectSpaceTest : public SpaceTest {
   static constexpr size_t kNumThreads = 10;
   static constexpr size_t kNumIterations = 1000;
   void RaceTest();
+
+  void BestFitTest();
 };
 
 
@@ -143,6 +145,68 @@ void LargeObjectSpaceTest::RaceTest() {
   }
 }
 
+// Allocates an object spanning exactly num_pages pages of a FreeListSpace.
+static mirror::Object* AllocPages(FreeListSpace* los, size_t num_pages) {
+  size_t bytes_allocated = 0;
+  // The allocation header is much smaller than the slack left for it.
+  mirror::Object* obj = los->Alloc(Thread::Current(), num_pages * kPageSize - 256,
+                                   &bytes_allocated, nullptr);
+  EXPECT_TRUE(obj != nullptr);
+  EXPECT_EQ(num_pages * kPageSize, bytes_allocated);
+  return obj;
+}
+
+void LargeObjectSpaceTest::BestFitTest() {
+  Thread* self = Thread::Current();
+  std::unique_ptr<FreeListSpace> los(
+      FreeListSpace::Create("large object space", nullptr, 128 * MB));
+  // Free blocks of 3, 2, 120 and 100 pages, separated by live objects so they don't coalesce.
+  static const size_t kFreePages[] = { 3, 2, 120, 100 };
+  std::vector<mirror::Object*> free_objects;
+  std::vector<mirror::Object*> live_objects;
+  for (size_t num_pages : kFreePages) {
+    free_objects.push_back(AllocPages(los.get(), num_pages));
+    memset(free_objects.back(), 0xFF, num_pages * kPageSize - 256);
+    live_objects.push_back(AllocPages(los.get(), 1));
+  }
+  // Free them at once, in address order like the sweeping does.
+  EXPECT_EQ(225 * kPageSize,
+            los->FreeList(self, free_objects.size(), free_objects.data()));
+  EXPECT_EQ(live_objects.size(), los->GetObjectsAllocated());
+  EXPECT_EQ(225 * kPageSize, los->GetTotalBytesReleased());
+
+  // The exact bins return the block of the requested size, zeroed by the release of its pages.
+  EXPECT_EQ(free_objects[1], AllocPages(los.get(), 2));
+  const byte* recycled = reinterpret_cast<const byte*>(free_objects[1]);
+  for (size_t i = 0; i < 2 * kPageSize - 256; ++i) {
+    ASSERT_EQ(0U, recycled[i]);
+  }
+  EXPECT_EQ(free_objects[0], AllocPages(los.get(), 3));
+  // 100 and 120 pages are in the same bin, the smallest which fits is used.
+  EXPECT_EQ(free_objects[3], AllocPages(los.get(), 90));
+  // Splits of the remaining blocks.
+  EXPECT_EQ(free_objects[2], AllocPages(los.get(), 101));
+  mirror::Object* split = AllocPages(los.get(), 10);
+  EXPECT_EQ(reinterpret_cast<byte*>(free_objects[3]) + 90 * kPageSize,
+            reinterpret_cast<byte*>(split));
+
+  // Freeing everything coalesces all the blocks with the free end of the space.
+  for (mirror::Object* obj : live_objects) {
+    los->Free(self, obj);
+  }
+  los->Free(self, free_objects[0]);
+  los->Free(self, free_objects[1]);
+  los->Free(self, free_objects[2]);
+  los->Free(self, free_objects[3]);
+  los->Free(self, split);
+  EXPECT_EQ(0U, los->GetBytesAllocated());
+  EXPECT_EQ(0U, los->GetObjectsAllocated());
+  size_t bytes_allocated = 0;
+  mirror::Object* obj = los->Alloc(self, 100 * MB, &bytes_allocated, nullptr);
+  EXPECT_EQ(los->Begin(), AlignDown(reinterpret_cast<byte*>(obj), kPageSize));
+  los->Free(self, obj);
+}
+
 TEST_F(LargeObjectSpaceTest, LargeObjectTest) {
   LargeObjectTest();
 }
@@ -151,6 +215,10 @@ TEST_F(LargeObjectSpaceTest, RaceTest) {
   RaceTest();
 }
 
+TEST_F(LargeObjectSpaceTest, BestFitTest) {
+  BestFitTest();
+}
+
 }  // namespace space
 }  // namespace gc
 }  // namespace art
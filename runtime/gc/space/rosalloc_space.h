@@ -75,6 +75,13 @@ class RosAllocSpace : public MallocSpace {
     // RosAlloc zeroes memory internally. Pass in false for thread unsafe.
     return AllocCommon<false>(self, num_bytes, bytes_allocated, usable_size);
   }
+  // Allocates up to num_objects objects of num_bytes at once, returns how many were allocated.
+  size_t AllocBatchNonvirtual(Thread* self, size_t num_bytes, size_t num_objects,
+                              mirror::Object** objects, size_t* bytes_allocated) {
+    // RosAlloc zeroes memory internally.
+    return rosalloc_->AllocBatch(self, num_bytes, num_objects, reinterpret_cast<void**>(objects),
+                                 bytes_allocated);
+  }
 
   // TODO: NO_THREAD_SAFETY_ANALYSIS because SizeOf() requires that mutator_lock is held.
   size_t AllocationSizeNonvirtual(mirror::Object* obj, size_t* usable_size)
@@ -28,6 +28,173 @@ MallocSpace* CreateRosAllocSpace(const std::string& name, size_t initial_size, s
 
 TEST_SPACE_CREATE_FN_BASE(RosAllocSpace, CreateRosAllocSpace)
 
+TEST_F(RosAllocSpaceBaseTest, AllocBatch) {
+  RosAllocSpace* space =
+      down_cast<RosAllocSpace*>(CreateRosAllocSpace("test", 4 * MB, 16 * MB, 16 * MB, nullptr));
+  ASSERT_TRUE(space != nullptr);
+  AddSpace(space);
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+
+  // More than fit in one run, for a thread-local and a shared size bracket.
+  for (size_t size : { 16u, 1024u }) {
+    mirror::Object* objects[1024];
+    size_t bytes_allocated;
+    size_t num_allocated = space->AllocBatchNonvirtual(self, size, arraysize(objects), objects,
+                                                       &bytes_allocated);
+    ASSERT_EQ(arraysize(objects), num_allocated);
+    size_t usable_size = space->GetRosAlloc()->UsableSize(size);
+    EXPECT_EQ(num_allocated * usable_size, bytes_allocated);
+    std::set<mirror::Object*> distinct(objects, objects + num_allocated);
+    EXPECT_EQ(num_allocated, distinct.size());
+    for (mirror::Object* obj : objects) {
+      EXPECT_TRUE(space->Contains(obj));
+      EXPECT_EQ(usable_size, space->GetRosAlloc()->UsableSize(obj));
+    }
+    for (mirror::Object* obj : objects) {
+      space->GetRosAlloc()->Free(self, obj);
+    }
+  }
+
+  // Large sizes aren't batched.
+  mirror::Object* large_object;
+  size_t bytes_allocated;
+  EXPECT_EQ(0U, space->AllocBatchNonvirtual(self, 8 * KB, 1, &large_object, &bytes_allocated));
+  EXPECT_EQ(0U, bytes_allocated);
+}
+
+TEST_F(RosAllocSpaceBaseTest, AdaptiveThreadLocalRuns) {
+  RosAllocSpace* space =
+      down_cast<RosAllocSpace*>(CreateRosAllocSpace("test", 4 * MB, 16 * MB, 16 * MB, nullptr));
+  ASSERT_TRUE(space != nullptr);
+  AddSpace(space);
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  allocator::RosAlloc* rosalloc = space->GetRosAlloc();
+  rosalloc->RevokeThreadLocalRuns(self);
+  void* const dedicated_full_run = allocator::RosAlloc::GetDedicatedFullRun();
+  // The 1 KB bracket, the last but one.
+  const size_t idx = allocator::RosAlloc::kNumMaxThreadLocalSizeBrackets - 2;
+  ASSERT_GE(idx, static_cast<size_t>(allocator::RosAlloc::kNumThreadLocalSizeBrackets));
+  EXPECT_EQ(dedicated_full_run, self->GetRosAllocRun(idx));
+
+  // A few allocations use the shared run, a steady stream of them gets a thread-local run.
+  std::vector<mirror::Object*> objects;
+  size_t bytes_allocated;
+  objects.push_back(space->AllocNonvirtual(self, 1 * KB, &bytes_allocated, nullptr));
+  EXPECT_EQ(dedicated_full_run, self->GetRosAllocRun(idx));
+  for (size_t i = 0; i < 256; ++i) {
+    objects.push_back(space->AllocNonvirtual(self, 1 * KB, &bytes_allocated, nullptr));
+  }
+  EXPECT_NE(dedicated_full_run, self->GetRosAllocRun(idx));
+
+  // Revoking returns the run and the thread starts over.
+  rosalloc->RevokeThreadLocalRuns(self);
+  EXPECT_EQ(dedicated_full_run, self->GetRosAllocRun(idx));
+  for (mirror::Object* obj : objects) {
+    ASSERT_TRUE(obj != nullptr);
+    rosalloc->Free(self, obj);
+  }
+}
+
+TEST_F(RosAllocSpaceBaseTest, ReleasePages) {
+  RosAllocSpace* space =
+      down_cast<RosAllocSpace*>(CreateRosAllocSpace("test", 16 * MB, 16 * MB, 16 * MB, nullptr));
+  ASSERT_TRUE(space != nullptr);
+  AddSpace(space);
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  allocator::RosAlloc* rosalloc = space->GetRosAlloc();
+  if (rosalloc->DoesReleaseAllPages()) {
+    return;
+  }
+
+  // Free runs of more than a release batch, which aren't at the end of the space so that they
+  // are not released when they are freed.
+  static constexpr size_t kObjectSize = 128 * KB;
+  static constexpr size_t kNumObjects = 33;
+  mirror::Object* objects[kNumObjects];
+  for (size_t i = 0; i < kNumObjects; ++i) {
+    size_t bytes_allocated;
+    objects[i] = space->AllocNonvirtual(self, kObjectSize, &bytes_allocated, nullptr);
+    ASSERT_TRUE(objects[i] != nullptr);
+  }
+  for (size_t i = 0; i < kNumObjects - 1; ++i) {
+    rosalloc->Free(self, objects[i]);
+  }
+  const size_t freed_bytes = (kNumObjects - 1) * kObjectSize;
+  ASSERT_GT(freed_bytes, static_cast<size_t>(allocator::RosAlloc::kPageReleaseBatchSize));
+  EXPECT_GE(rosalloc->ReleasePages(), freed_bytes - kPageSize);
+  // The released runs are skipped by the next release.
+  size_t released_again = rosalloc->ReleasePages();
+  EXPECT_LT(released_again, freed_bytes - kPageSize);
+  rosalloc->Free(self, objects[kNumObjects - 1]);
+}
+
+TEST_F(RosAllocSpaceBaseTest, FreeSlotBytes) {
+  RosAllocSpace* space =
+      down_cast<RosAllocSpace*>(CreateRosAllocSpace("test", 16 * MB, 16 * MB, 16 * MB, nullptr));
+  ASSERT_TRUE(space != nullptr);
+  AddSpace(space);
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  allocator::RosAlloc* rosalloc = space->GetRosAlloc();
+  size_t run_bytes = 0;
+  EXPECT_EQ(0U, rosalloc->FreeSlotBytes(&run_bytes));
+  EXPECT_EQ(0U, run_bytes);
+
+  static constexpr size_t kObjectSize = 64;
+  static constexpr size_t kNumObjects = 256;
+  mirror::Object* objects[kNumObjects];
+  for (size_t i = 0; i < kNumObjects; ++i) {
+    size_t bytes_allocated;
+    objects[i] = space->AllocNonvirtual(self, kObjectSize, &bytes_allocated, nullptr);
+    ASSERT_TRUE(objects[i] != nullptr);
+  }
+  // Every other slot becomes free, the thread-local frees are seen once the runs are revoked.
+  for (size_t i = 0; i < kNumObjects; i += 2) {
+    rosalloc->Free(self, objects[i]);
+  }
+  rosalloc->RevokeThreadLocalRuns(self);
+  const size_t free_slot_bytes = rosalloc->FreeSlotBytes(&run_bytes);
+  EXPECT_GE(free_slot_bytes, kNumObjects / 2 * kObjectSize);
+  EXPECT_GE(run_bytes, free_slot_bytes + kNumObjects / 2 * kObjectSize);
+  for (size_t i = 1; i < kNumObjects; i += 2) {
+    rosalloc->Free(self, objects[i]);
+  }
+}
+
+TEST_F(RosAllocSpaceBaseTest, RoundUpToRunBoundary) {
+  RosAllocSpace* space =
+      down_cast<RosAllocSpace*>(CreateRosAllocSpace("test", 16 * MB, 16 * MB, 16 * MB, nullptr));
+  ASSERT_TRUE(space != nullptr);
+  AddSpace(space);
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  allocator::RosAlloc* rosalloc = space->GetRosAlloc();
+  size_t small_bytes_allocated;
+  mirror::Object* small_object =
+      space->AllocNonvirtual(self, 64, &small_bytes_allocated, nullptr);
+  ASSERT_TRUE(small_object != nullptr);
+  size_t bytes_allocated;
+  // Large objects take whole pages, the boundaries skip their pages.
+  mirror::Object* large_object =
+      space->AllocNonvirtual(self, 3 * kPageSize, &bytes_allocated, nullptr);
+  ASSERT_TRUE(large_object != nullptr);
+  byte* large_begin = reinterpret_cast<byte*>(large_object);
+  EXPECT_EQ(large_begin, rosalloc->RoundUpToRunBoundary(large_begin));
+  EXPECT_EQ(large_begin + 3 * kPageSize, rosalloc->RoundUpToRunBoundary(large_begin + 1));
+  EXPECT_EQ(large_begin + 3 * kPageSize,
+            rosalloc->RoundUpToRunBoundary(large_begin + 2 * kPageSize));
+  // The slots of a run are before the boundary which follows them.
+  byte* small_begin = reinterpret_cast<byte*>(small_object);
+  EXPECT_GE(rosalloc->RoundUpToRunBoundary(small_begin), small_begin + small_bytes_allocated);
+  EXPECT_TRUE(IsAligned<kPageSize>(rosalloc->RoundUpToRunBoundary(small_begin)));
+  byte* footprint_end = space->Begin() + rosalloc->Footprint();
+  EXPECT_EQ(footprint_end, rosalloc->RoundUpToRunBoundary(footprint_end));
+  rosalloc->Free(self, large_object);
+  rosalloc->Free(self, small_object);
+}
 
 }  // namespace space
 }  // namespace gc
@@ -82,22 +82,30 @@ DiscontinuousSpace::DiscontinuousSpace(const std::string& name,
 }
 
 void ContinuousMemMapAllocSpace::Sweep(bool swap_bitmaps, size_t* freed_objects, size_t* freed_bytes) {
+  SweepRange(swap_bitmaps, reinterpret_cast<uintptr_t>(Begin()),
+             reinterpret_cast<uintptr_t>(End()), false, freed_objects, freed_bytes);
+}
+
+void ContinuousMemMapAllocSpace::SweepRange(bool swap_bitmaps, uintptr_t begin, uintptr_t end,
+                                            bool on_gc_worker, size_t* freed_objects,
+                                            size_t* freed_bytes) {
   DCHECK(freed_objects != nullptr);
   DCHECK(freed_bytes != nullptr);
+  DCHECK_ALIGNED(begin - reinterpret_cast<uintptr_t>(Begin()),
+                 kObjectAlignment * kBitsPerWord);
   accounting::ContinuousSpaceBitmap* live_bitmap = GetLiveBitmap();
   accounting::ContinuousSpaceBitmap* mark_bitmap = GetMarkBitmap();
   // If the bitmaps are bound then sweeping this space clearly won't do anything.
   if (live_bitmap == mark_bitmap) {
     return;
   }
-  SweepCallbackContext scc(swap_bitmaps, this);
+  SweepCallbackContext scc(swap_bitmaps, this, on_gc_worker);
   if (swap_bitmaps) {
     std::swap(live_bitmap, mark_bitmap);
   }
   // Bitmaps are pre-swapped for optimization which enables sweeping with the heap unlocked.
-  accounting::ContinuousSpaceBitmap::SweepWalk(
-      *live_bitmap, *mark_bitmap, reinterpret_cast<uintptr_t>(Begin()),
-      reinterpret_cast<uintptr_t>(End()), GetSweepCallback(), reinterpret_cast<void*>(&scc));
+  accounting::ContinuousSpaceBitmap::SweepWalk(*live_bitmap, *mark_bitmap, begin, end,
+                                               GetSweepCallback(), reinterpret_cast<void*>(&scc));
   *freed_objects += scc.freed_objects;
   *freed_bytes += scc.freed_bytes;
 }
@@ -136,9 +144,10 @@ void ContinuousMemMapAllocSpace::SwapBitmaps() {
   mark_bitmap_->SetName(temp_name);
 }
 
-Space::SweepCallbackContext::SweepCallbackContext(bool swap_bitmaps, space::Space* space)
-    : swap_bitmaps(swap_bitmaps), space(space), self(Thread::Current()), freed_objects(0),
-      freed_bytes(0) {
+Space::SweepCallbackContext::SweepCallbackContext(bool swap_bitmaps, space::Space* space,
+                                                  bool on_gc_worker)
+    : swap_bitmaps(swap_bitmaps), space(space), self(Thread::Current()),
+      on_gc_worker(on_gc_worker), freed_objects(0), freed_bytes(0) {
 }
 
 }  // namespace space
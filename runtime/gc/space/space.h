@@ -174,10 +174,12 @@ class Space {
  protected:
   struct SweepCallbackContext {
    public:
-    SweepCallbackContext(bool swap_bitmaps, space::Space* space);
+    SweepCallbackContext(bool swap_bitmaps, space::Space* space, bool on_gc_worker = false);
     const bool swap_bitmaps;
     space::Space* const space;
     Thread* const self;
+    // Set when a GC worker sweeps for the GC thread, which holds the heap bitmap lock.
+    const bool on_gc_worker;
     size_t freed_objects;
     size_t freed_bytes;
   };
@@ -416,6 +418,11 @@ class ContinuousMemMapAllocSpace : public MemMapSpace, public AllocSpace {
   }
 
   void Sweep(bool swap_bitmaps, size_t* freed_objects, size_t* freed_bytes);
+  // Sweeps the objects in [begin, end), whose bounds are aligned to the words of the bitmaps. The
+  // GC workers sweep ranges of the space at the same time while the GC thread holds the heap
+  // bitmap lock, the space must then support concurrent FreeList calls for the ranges.
+  void SweepRange(bool swap_bitmaps, uintptr_t begin, uintptr_t end, bool on_gc_worker,
+                  size_t* freed_objects, size_t* freed_bytes);
   virtual accounting::ContinuousSpaceBitmap::SweepCallback* GetSweepCallback() = 0;
 
  protected:
@@ -25,6 +25,13 @@
 namespace art {
 
 // Lightweight wrapper for native PC offset to reference bit maps.
+//
+// The map starts with a header of 2 bytes holding the native offset width minus one in bits 0-1,
+// the dictionary flag in bit 2 and the width of the reference bitmaps in bits 3-15, followed by
+// 2 bytes holding the number of entries. The entries form a hash table on the native offset. An
+// entry holds the native offset and the bitmap of its references, or with the dictionary flag the
+// index of the bitmap in a dictionary of the distinct bitmaps following the table. A dictionary
+// map has 2 more header bytes with the number of bitmaps in the dictionary.
 class NativePcOffsetToReferenceMap {
  public:
   explicit NativePcOffsetToReferenceMap(const uint8_t* data) : data_(data) {
@@ -38,8 +45,16 @@ class NativePcOffsetToReferenceMap {
 
   // Return address of bitmap encoding what are live references.
   const uint8_t* GetBitMap(size_t index) const {
-    size_t entry_offset = index * EntryWidth();
-    return &Table()[entry_offset + NativeOffsetWidth()];
+    size_t entry_offset = index * EntryWidth() + NativeOffsetWidth();
+    if (!HasDictionary()) {
+      return &Table()[entry_offset];
+    }
+    size_t bitmap_index = Table()[entry_offset];
+    if (DictionaryIndexWidth() == 2) {
+      bitmap_index |= Table()[entry_offset + 1] << 8;
+    }
+    DCHECK_LT(bitmap_index, NumDictionaryEntries());
+    return &Dictionary()[bitmap_index * RegWidth()];
   }
 
   // Get the native PC encoded in the table at the given index.
@@ -87,20 +102,60 @@ class NativePcOffsetToReferenceMap {
     return (static_cast<size_t>(data_[0]) | (static_cast<size_t>(data_[1]) << 8)) >> 3;
   }
 
+  // Whether the entries hold indexes into a dictionary of bitmaps rather than the bitmaps.
+  bool HasDictionary() const {
+    return (data_[0] & kDictionaryFlag) != 0;
+  }
+
+  // The number of distinct bitmaps of a map with a dictionary.
+  size_t NumDictionaryEntries() const {
+    return HasDictionary() ? (data_[4] | (data_[5] << 8)) : 0u;
+  }
+
+  // The number of bytes of the map, its header included.
+  size_t SizeInBytes() const {
+    return HeaderSize(HasDictionary()) + NumEntries() * EntryWidth() +
+        NumDictionaryEntries() * RegWidth();
+  }
+
+  // Bits of the first header byte.
+  static constexpr uint8_t kNativeOffsetWidthMask = 3;
+  static constexpr uint8_t kDictionaryFlag = 4;
+
+  // The maximum number of bitmaps indexed with a single byte.
+  static constexpr size_t kMaxShortDictionary = 256;
+
+  static size_t HeaderSize(bool has_dictionary) {
+    return has_dictionary ? 6u : 4u;
+  }
+
+  static size_t DictionaryIndexWidth(size_t num_dictionary_entries) {
+    return num_dictionary_entries <= kMaxShortDictionary ? 1u : 2u;
+  }
+
  private:
   // Skip the size information at the beginning of data.
   const uint8_t* Table() const {
-    return data_ + 4;
+    return data_ + HeaderSize(HasDictionary());
+  }
+
+  // The distinct bitmaps follow the table.
+  const uint8_t* Dictionary() const {
+    return Table() + NumEntries() * EntryWidth();
   }
 
   // Number of bytes used to encode a native offset.
   size_t NativeOffsetWidth() const {
-    return data_[0] & 7;
+    return (data_[0] & kNativeOffsetWidthMask) + 1u;
+  }
+
+  size_t DictionaryIndexWidth() const {
+    return DictionaryIndexWidth(NumDictionaryEntries());
   }
 
   // The width of an entry in the table.
   size_t EntryWidth() const {
-    return NativeOffsetWidth() + RegWidth();
+    return NativeOffsetWidth() + (HasDictionary() ? DictionaryIndexWidth() : RegWidth());
   }
 
   const uint8_t* const data_;  // The header and table data
@@ -123,6 +123,19 @@ static constexpr bool kUseBakerOrBrooksReadBarrier = kUseBakerReadBarrier || kUs
 // If true, references within the heap are poisoned (negated).
 static constexpr bool kPoisonHeapReferences = false;
 
+// The 32-bit references of the 64-bit runtime may be shifted right by up to the bits of the object
+// alignment, which places the heap anywhere below 4GB << shift instead of in the low 4GB. The
+// compiler reads the 64-bit value to generate code for the 64-bit targets.
+#if defined(ART_HEAP_REFERENCE_SHIFT)
+static constexpr size_t k64BitHeapReferenceShift = ART_HEAP_REFERENCE_SHIFT;
+#else
+static constexpr size_t k64BitHeapReferenceShift = 0;
+#endif
+static constexpr size_t kHeapReferenceShift = sizeof(void*) == 8 ? k64BitHeapReferenceShift : 0;
+// The end of the addresses which the references reach.
+static constexpr uint64_t kHeapReferenceLimit =
+    static_cast<uint64_t>(4) * GB << kHeapReferenceShift;
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_GLOBALS_H_
@@ -15,27 +15,32 @@
  */
 
 /*
- * Preparation and completion of hprof data generation.  The output is
- * written into two files and then combined.  This is necessary because
- * we generate some of the data (strings and classes) while we dump the
- * heap, and some analysis tools require that the class and string data
- * appear first.
+ * Preparation and completion of hprof data generation.  Some analysis
+ * tools require that the class and string data appear first, but we
+ * generate them while we dump the heap.  Dumps to files therefore walk
+ * the heap twice: the first walk only collects the strings and classes,
+ * the second streams the heap data after them.  Dumps sent to DDMS are
+ * built in memory, in a header and a body which are then combined.
  */
 
 #include "hprof.h"
 
-#include <cutils/open_memstream.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/time.h>
 #include <sys/uio.h>
+#include <sys/wait.h>
 #include <time.h>
 #include <time.h>
 #include <unistd.h>
+#include <zlib.h>
 
+#include <memory>
 #include <set>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/stringprintf.h"
@@ -170,6 +175,239 @@ enum HprofBasicType {
 typedef uint32_t HprofStringId;
 typedef uint32_t HprofClassObjectId;
 
+// Where the serialized records of a dump go.
+class HprofOutput {
+ public:
+  HprofOutput() : size_(0) {}
+  virtual ~HprofOutput() {}
+
+  virtual bool Write(const void* data, size_t size) = 0;
+
+  // The number of bytes written, before any compression.
+  size_t Size() const {
+    return size_;
+  }
+
+ protected:
+  size_t size_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HprofOutput);
+};
+
+// Keeps the output in memory, for DDMS which takes a whole dump at once.
+class HprofMemoryOutput : public HprofOutput {
+ public:
+  HprofMemoryOutput() {}
+
+  bool Write(const void* data, size_t size) OVERRIDE {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    data_.insert(data_.end(), bytes, bytes + size);
+    size_ += size;
+    return true;
+  }
+
+  uint8_t* Data() {
+    return data_.data();
+  }
+
+ private:
+  std::vector<uint8_t> data_;
+
+  DISALLOW_COPY_AND_ASSIGN(HprofMemoryOutput);
+};
+
+// Discards the output, for the walk that only collects the strings and classes.
+class HprofNullOutput : public HprofOutput {
+ public:
+  HprofNullOutput() {}
+
+  bool Write(const void* /* data */, size_t size) OVERRIDE {
+    size_ += size;
+    return true;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HprofNullOutput);
+};
+
+// Streams the output to a file in fixed size chunks, optionally gzip compressed. A writer thread
+// compresses and writes the filled chunks while the heap walk fills the next ones, so that the
+// memory used is bounded by kNumChunks chunks. The writer thread isn't attached to the runtime,
+// it keeps running while the other threads are suspended.
+class HprofStreamOutput : public HprofOutput {
+ public:
+  HprofStreamOutput(File* file, bool compress)
+      : file_(file), compress_(compress), gz_file_(nullptr), fill_index_(0), write_index_(0),
+        num_pending_(0), finishing_(false), failed_(false), error_(0), started_(false) {
+    for (std::vector<uint8_t>& chunk : chunks_) {
+      chunk.reserve(kChunkSize);
+    }
+  }
+
+  ~HprofStreamOutput() {
+    CHECK(!started_) << "Stream output not finished";
+  }
+
+  bool Start(std::string* error_msg) {
+    if (compress_) {
+      // zlib closes the descriptor it is given, keep the one of the file.
+      int fd = dup(file_->Fd());
+      gz_file_ = (fd >= 0) ? gzdopen(fd, "wb1") : nullptr;
+      if (gz_file_ == nullptr) {
+        *error_msg = StringPrintf("Couldn't start compressing to \"%s\": %s",
+                                  file_->GetPath().c_str(), strerror(errno));
+        if (fd >= 0) {
+          close(fd);
+        }
+        return false;
+      }
+    }
+    const char* reason = "hprof writer thread startup";
+    CHECK_PTHREAD_CALL(pthread_mutex_init, (&mutex_, nullptr), reason);
+    CHECK_PTHREAD_CALL(pthread_cond_init, (&cond_, nullptr), reason);
+    CHECK_PTHREAD_CALL(pthread_create, (&writer_thread_, nullptr, &WriterCallback, this), reason);
+    started_ = true;
+    return true;
+  }
+
+  bool Write(const void* data, size_t size) OVERRIDE {
+    DCHECK(started_);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    size_ += size;
+    while (size != 0) {
+      std::vector<uint8_t>& chunk = chunks_[fill_index_];
+      size_t count = std::min(size, kChunkSize - chunk.size());
+      chunk.insert(chunk.end(), bytes, bytes + count);
+      bytes += count;
+      size -= count;
+      if (chunk.size() == kChunkSize && !QueueChunk()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Writes the rest of the output and stops the writer thread. Returns false with an error if
+  // anything couldn't be written.
+  bool Finish(std::string* error_msg) {
+    DCHECK(started_);
+    if (!chunks_[fill_index_].empty()) {
+      QueueChunk();
+    }
+    const char* reason = "hprof writer thread shutdown";
+    CHECK_PTHREAD_CALL(pthread_mutex_lock, (&mutex_), reason);
+    finishing_ = true;
+    CHECK_PTHREAD_CALL(pthread_cond_broadcast, (&cond_), reason);
+    CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&mutex_), reason);
+    CHECK_PTHREAD_CALL(pthread_join, (writer_thread_, nullptr), reason);
+    CHECK_PTHREAD_CALL(pthread_cond_destroy, (&cond_), reason);
+    CHECK_PTHREAD_CALL(pthread_mutex_destroy, (&mutex_), reason);
+    started_ = false;
+    if (gz_file_ != nullptr && gzclose(gz_file_) != Z_OK && !failed_) {
+      failed_ = true;
+      error_ = EIO;
+    }
+    gz_file_ = nullptr;
+    if (failed_) {
+      *error_msg = StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
+                                file_->GetPath().c_str(), strerror(error_));
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  static constexpr size_t kChunkSize = 1 * MB;
+  static constexpr size_t kNumChunks = 4;
+
+  // Hands the chunk being filled over to the writer thread and waits for a free one.
+  bool QueueChunk() {
+    const char* reason = "hprof chunk queueing";
+    CHECK_PTHREAD_CALL(pthread_mutex_lock, (&mutex_), reason);
+    ++num_pending_;
+    CHECK_PTHREAD_CALL(pthread_cond_broadcast, (&cond_), reason);
+    while (num_pending_ == kNumChunks) {
+      CHECK_PTHREAD_CALL(pthread_cond_wait, (&cond_, &mutex_), reason);
+    }
+    bool failed = failed_;
+    CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&mutex_), reason);
+    fill_index_ = (fill_index_ + 1) % kNumChunks;
+    DCHECK(chunks_[fill_index_].empty());
+    return !failed;
+  }
+
+  static void* WriterCallback(void* arg) {
+    ::art::SetThreadName("hprof writer");
+    reinterpret_cast<HprofStreamOutput*>(arg)->WriteChunks();
+    return nullptr;
+  }
+
+  void WriteChunks() {
+    const char* reason = "hprof chunk writing";
+    CHECK_PTHREAD_CALL(pthread_mutex_lock, (&mutex_), reason);
+    while (true) {
+      while (num_pending_ == 0 && !finishing_) {
+        CHECK_PTHREAD_CALL(pthread_cond_wait, (&cond_, &mutex_), reason);
+      }
+      if (num_pending_ == 0) {
+        break;
+      }
+      bool failed = failed_;
+      CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&mutex_), reason);
+      // The chunk stays queued while it is written, so the heap walk doesn't reuse it.
+      std::vector<uint8_t>& chunk = chunks_[write_index_];
+      int error = 0;
+      if (!failed) {
+        error = WriteChunk(chunk);
+      }
+      chunk.clear();
+      write_index_ = (write_index_ + 1) % kNumChunks;
+      CHECK_PTHREAD_CALL(pthread_mutex_lock, (&mutex_), reason);
+      if (error != 0 && !failed_) {
+        failed_ = true;
+        error_ = error;
+      }
+      --num_pending_;
+      CHECK_PTHREAD_CALL(pthread_cond_broadcast, (&cond_), reason);
+    }
+    CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&mutex_), reason);
+  }
+
+  // Returns 0 or an errno value.
+  int WriteChunk(const std::vector<uint8_t>& chunk) {
+    if (gz_file_ != nullptr) {
+      int written = gzwrite(gz_file_, chunk.data(), chunk.size());
+      return (written == static_cast<int>(chunk.size())) ? 0 : ((errno != 0) ? errno : EIO);
+    }
+    return file_->WriteFully(chunk.data(), chunk.size()) ? 0 : errno;
+  }
+
+  File* const file_;
+  const bool compress_;
+  gzFile gz_file_;
+
+  std::vector<uint8_t> chunks_[kNumChunks];
+  // Only used by the heap walk.
+  size_t fill_index_;
+  // Only used by the writer thread.
+  size_t write_index_;
+
+  pthread_t writer_thread_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+  // The chunks filled and not yet written, guarded by mutex_.
+  size_t num_pending_;
+  bool finishing_;
+  bool failed_;
+  int error_;
+  bool started_;
+
+  DISALLOW_COPY_AND_ASSIGN(HprofStreamOutput);
+};
+
+constexpr size_t HprofStreamOutput::kChunkSize;
+
 // Represents a top-level hprof record, whose serialized format is:
 // U1  TAG: denoting the type of the record
 // U4  TIME: number of microseconds since the time stamp in the header
@@ -177,7 +415,8 @@ typedef uint32_t HprofClassObjectId;
 // U1* BODY: as many bytes as specified in the above uint32_t field
 class HprofRecord {
  public:
-  HprofRecord() : alloc_length_(128), fp_(nullptr), tag_(0), time_(0), length_(0), dirty_(false) {
+  HprofRecord()
+      : alloc_length_(128), output_(nullptr), tag_(0), time_(0), length_(0), dirty_(false) {
     body_ = reinterpret_cast<unsigned char*>(malloc(alloc_length_));
   }
 
@@ -185,13 +424,13 @@ class HprofRecord {
     free(body_);
   }
 
-  int StartNewRecord(FILE* fp, uint8_t tag, uint32_t time) {
+  int StartNewRecord(HprofOutput* output, uint8_t tag, uint32_t time) {
     int rc = Flush();
     if (rc != 0) {
       return rc;
     }
 
-    fp_ = fp;
+    output_ = output;
     tag_ = tag;
     time_ = time;
     length_ = 0;
@@ -207,12 +446,10 @@ class HprofRecord {
       U4_TO_BUF_BE(headBuf, 1, time_);
       U4_TO_BUF_BE(headBuf, 5, length_);
 
-      int nb = fwrite(headBuf, 1, sizeof(headBuf), fp_);
-      if (nb != sizeof(headBuf)) {
+      if (!output_->Write(headBuf, sizeof(headBuf))) {
         return UNIQUE_ERROR;
       }
-      nb = fwrite(body_, 1, length_, fp_);
-      if (nb != static_cast<int>(length_)) {
+      if (!output_->Write(body_, length_)) {
         return UNIQUE_ERROR;
       }
 
@@ -371,7 +608,7 @@ class HprofRecord {
   size_t alloc_length_;
   unsigned char* body_;
 
-  FILE* fp_;
+  HprofOutput* output_;
   uint8_t tag_;
   uint32_t time_;
   size_t length_;
@@ -392,70 +629,29 @@ class Hprof {
         gc_scan_state_(0),
         current_heap_(HPROF_HEAP_DEFAULT),
         objects_in_segment_(0),
-        header_fp_(NULL),
-        header_data_ptr_(NULL),
-        header_data_size_(0),
-        body_fp_(NULL),
-        body_data_ptr_(NULL),
-        body_data_size_(0),
+        body_output_(nullptr),
         next_string_id_(0x400000) {
     LOG(INFO) << "hprof: heap dump \"" << filename_ << "\" starting...";
-
-    header_fp_ = open_memstream(&header_data_ptr_, &header_data_size_);
-    if (header_fp_ == NULL) {
-      PLOG(FATAL) << "header open_memstream failed";
-    }
-
-    body_fp_ = open_memstream(&body_data_ptr_, &body_data_size_);
-    if (body_fp_ == NULL) {
-      PLOG(FATAL) << "body open_memstream failed";
-    }
   }
 
-  ~Hprof() {
-    if (header_fp_ != NULL) {
-      fclose(header_fp_);
-    }
-    if (body_fp_ != NULL) {
-      fclose(body_fp_);
-    }
-    free(header_data_ptr_);
-    free(body_data_ptr_);
-  }
-
-  void Dump()
+  // Returns false with an error if the dump couldn't be written.
+  bool Dump(std::string* error_msg)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
       LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
-    // Walk the roots and the heap.
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
-    Runtime::Current()->VisitRoots(RootVisitor, this);
-    Thread* self = Thread::Current();
-    {
-      ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-      Runtime::Current()->GetHeap()->VisitObjects(VisitObjectCallback, this);
-    }
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_END, HPROF_TIME);
-    current_record_.Flush();
-    fflush(body_fp_);
-
-    // Write the header.
-    WriteFixedHeader();
-    // Write the string and class tables, and any stack traces, to the header.
-    // (jhat requires that these appear before any of the data in the body that refers to them.)
-    WriteStringTable();
-    WriteClassTable();
-    WriteStackTraces();
-    current_record_.Flush();
-    fflush(header_fp_);
-
     bool okay = true;
+    size_t dump_size;
     if (direct_to_ddms_) {
+      HprofMemoryOutput header;
+      HprofMemoryOutput body;
+      WriteHeapData(&body);
+      WriteHeader(&header);
+      dump_size = header.Size() + body.Size();
       // Send the data off to DDMS.
       iovec iov[2];
-      iov[0].iov_base = header_data_ptr_;
-      iov[0].iov_len = header_data_size_;
-      iov[1].iov_base = body_data_ptr_;
-      iov[1].iov_len = body_data_size_;
+      iov[0].iov_base = header.Data();
+      iov[0].iov_len = header.Size();
+      iov[1].iov_base = body.Data();
+      iov[1].iov_len = body.Size();
       Dbg::DdmSendChunkV(CHUNK_TYPE("HPDS"), iov, 2);
     } else {
       // Where exactly are we writing to?
@@ -463,36 +659,49 @@ class Hprof {
       if (fd_ >= 0) {
         out_fd = dup(fd_);
         if (out_fd < 0) {
-          ThrowRuntimeException("Couldn't dump heap; dup(%d) failed: %s", fd_, strerror(errno));
-          return;
+          *error_msg = StringPrintf("Couldn't dump heap; dup(%d) failed: %s", fd_, strerror(errno));
+          return false;
         }
       } else {
         out_fd = open(filename_.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
         if (out_fd < 0) {
-          ThrowRuntimeException("Couldn't dump heap; open(\"%s\") failed: %s", filename_.c_str(),
-                                strerror(errno));
-          return;
+          *error_msg = StringPrintf("Couldn't dump heap; open(\"%s\") failed: %s",
+                                    filename_.c_str(), strerror(errno));
+          return false;
         }
       }
-
       std::unique_ptr<File> file(new File(out_fd, filename_));
-      okay = file->WriteFully(header_data_ptr_, header_data_size_) &&
-          file->WriteFully(body_data_ptr_, body_data_size_);
-      if (!okay) {
-        std::string msg(StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
-                                     filename_.c_str(), strerror(errno)));
-        ThrowRuntimeException("%s", msg.c_str());
-        LOG(ERROR) << msg;
+
+      // Collect the strings and classes, discarding the heap data.
+      {
+        HprofNullOutput null_output;
+        WriteHeapData(&null_output);
+      }
+      const size_t num_strings = strings_.size();
+      const size_t num_classes = classes_.size();
+
+      // Stream the header, then the heap data again.
+      HprofStreamOutput output(file.get(), EndsWith(filename_, ".gz"));
+      okay = output.Start(error_msg);
+      if (okay) {
+        WriteHeader(&output);
+        WriteHeapData(&output);
+        okay = output.Finish(error_msg);
       }
+      // The heap didn't change while the threads are suspended.
+      DCHECK_EQ(num_strings, strings_.size());
+      DCHECK_EQ(num_classes, classes_.size());
+      dump_size = output.Size();
     }
 
     // Throw out a log message for the benefit of "runhat".
     if (okay) {
       uint64_t duration = NanoTime() - start_ns_;
       LOG(INFO) << "hprof: heap dump completed ("
-          << PrettySize(header_data_size_ + body_data_size_ + 1023)
+          << PrettySize(dump_size + 1023)
           << ") in " << PrettyDuration(duration);
     }
+    return okay;
   }
 
  private:
@@ -516,17 +725,45 @@ class Hprof {
 
   int DumpHeapObject(mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  void Finish() {
+  // Walk the roots and the heap.
+  void WriteHeapData(HprofOutput* output)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
+    body_output_ = output;
+    gc_thread_serial_number_ = 0;
+    gc_scan_state_ = 0;
+    current_heap_ = HPROF_HEAP_DEFAULT;
+    objects_in_segment_ = 0;
+    current_record_.StartNewRecord(body_output_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
+    Runtime::Current()->VisitRoots(RootVisitor, this);
+    Thread* self = Thread::Current();
+    {
+      ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+      Runtime::Current()->GetHeap()->VisitObjects(VisitObjectCallback, this);
+    }
+    current_record_.StartNewRecord(body_output_, HPROF_TAG_HEAP_DUMP_END, HPROF_TIME);
+    current_record_.Flush();
+    body_output_ = nullptr;
   }
 
-  int WriteClassTable() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  // Write the header, then the string and class tables and any stack traces.
+  // (jhat requires that these appear before any of the data in the body that refers to them.)
+  void WriteHeader(HprofOutput* output) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    WriteFixedHeader(output);
+    WriteStringTable(output);
+    WriteClassTable(output);
+    WriteStackTraces(output);
+    current_record_.Flush();
+  }
+
+  int WriteClassTable(HprofOutput* output) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     HprofRecord* rec = &current_record_;
     uint32_t nextSerialNumber = 1;
 
     for (mirror::Class* c : classes_) {
       CHECK(c != nullptr);
 
-      int err = current_record_.StartNewRecord(header_fp_, HPROF_TAG_LOAD_CLASS, HPROF_TIME);
+      int err = current_record_.StartNewRecord(output, HPROF_TAG_LOAD_CLASS, HPROF_TIME);
       if (UNLIKELY(err != 0)) {
         return err;
       }
@@ -545,14 +782,14 @@ class Hprof {
     return 0;
   }
 
-  int WriteStringTable() {
+  int WriteStringTable(HprofOutput* output) {
     HprofRecord* rec = &current_record_;
 
     for (std::pair<std::string, HprofStringId> p : strings_) {
       const std::string& string = p.first;
       size_t id = p.second;
 
-      int err = current_record_.StartNewRecord(header_fp_, HPROF_TAG_STRING, HPROF_TIME);
+      int err = current_record_.StartNewRecord(output, HPROF_TAG_STRING, HPROF_TIME);
       if (err != 0) {
         return err;
       }
@@ -576,7 +813,7 @@ class Hprof {
 
   void StartNewHeapDumpSegment() {
     // This flushes the old segment and starts a new one.
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
+    current_record_.StartNewRecord(body_output_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
     objects_in_segment_ = 0;
 
     // Starting a new HEAP_DUMP resets the heap to default.
@@ -626,17 +863,17 @@ class Hprof {
     return LookupStringId(PrettyDescriptor(c));
   }
 
-  void WriteFixedHeader() {
+  void WriteFixedHeader(HprofOutput* output) {
     char magic[] = "JAVA PROFILE 1.0.3";
     unsigned char buf[4];
 
     // Write the file header.
     // U1: NUL-terminated magic string.
-    fwrite(magic, 1, sizeof(magic), header_fp_);
+    output->Write(magic, sizeof(magic));
 
     // U4: size of identifiers.  We're using addresses as IDs, so make sure a pointer fits.
     U4_TO_BUF_BE(buf, 0, sizeof(void*));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);
+    output->Write(buf, sizeof(uint32_t));
 
     // The current time, in milliseconds since 0:00 GMT, 1/1/70.
     timeval now;
@@ -649,16 +886,16 @@ class Hprof {
 
     // U4: high word of the 64-bit time.
     U4_TO_BUF_BE(buf, 0, (uint32_t)(nowMs >> 32));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);
+    output->Write(buf, sizeof(uint32_t));
 
     // U4: low word of the 64-bit time.
     U4_TO_BUF_BE(buf, 0, (uint32_t)(nowMs & 0xffffffffULL));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);  // xxx fix the time
+    output->Write(buf, sizeof(uint32_t));  // xxx fix the time
   }
 
-  void WriteStackTraces() {
+  void WriteStackTraces(HprofOutput* output) {
     // Write a dummy stack trace record so the analysis tools don't freak out.
-    current_record_.StartNewRecord(header_fp_, HPROF_TAG_STACK_TRACE, HPROF_TIME);
+    current_record_.StartNewRecord(output, HPROF_TAG_STACK_TRACE, HPROF_TIME);
     current_record_.AddU4(HPROF_NULL_STACK_TRACE);
     current_record_.AddU4(HPROF_NULL_THREAD);
     current_record_.AddU4(0);    // no frames
@@ -680,13 +917,8 @@ class Hprof {
   HprofHeapId current_heap_;  // Which heap we're currently dumping.
   size_t objects_in_segment_;
 
-  FILE* header_fp_;
-  char* header_data_ptr_;
-  size_t header_data_size_;
-
-  FILE* body_fp_;
-  char* body_data_ptr_;
-  size_t body_data_size_;
+  // Where the heap data of the current walk goes.
+  HprofOutput* body_output_;
 
   std::set<mirror::Class*> classes_;
   HprofStringId next_string_id_;
@@ -1080,13 +1312,96 @@ void Hprof::VisitRoot(const mirror::Object* obj, uint32_t thread_id, RootType ty
 // sent directly to DDMS.
 // If "fd" is >= 0, the output will be written to that file descriptor.
 // Otherwise, "filename" is used to create an output file.
+// Dumps the heap from a forked copy of the process, which sees the heap as it was when the threads
+// were suspended. The threads are resumed once the child is forked, unless fork_failed is set.
+// Returns false with an error if the child reported one or if it couldn't be forked.
+static bool ForkAndDumpHeap(const char* filename, int fd, bool* fork_failed,
+                            std::string* error_msg)
+    // Resumes the threads only on success of the fork.
+    NO_THREAD_SAFETY_ANALYSIS {
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  *fork_failed = true;
+  // The child reports its error through the pipe.
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) {
+    *error_msg = StringPrintf("pipe failed: %s", strerror(errno));
+    return false;
+  }
+  pid_t pid = fork();
+  if (pid < 0) {
+    *error_msg = StringPrintf("fork failed: %s", strerror(errno));
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return false;
+  }
+  if (pid == 0) {
+    // Only this thread exists in the child and it holds the mutator lock, the heap can't change.
+    close(pipe_fds[0]);
+    Hprof hprof(filename, fd, false);
+    std::string child_error_msg;
+    bool okay = hprof.Dump(&child_error_msg);
+    if (!okay) {
+      File error_file(pipe_fds[1]);
+      error_file.WriteFully(child_error_msg.data(), child_error_msg.size());
+    }
+    // Don't run the exit handlers of the parent's copy.
+    _exit(okay ? 0 : 1);
+  }
+  *fork_failed = false;
+  close(pipe_fds[1]);
+  thread_list->ResumeAll();
+
+  std::string child_error_msg;
+  char buf[256];
+  ssize_t count;
+  while ((count = TEMP_FAILURE_RETRY(read(pipe_fds[0], buf, sizeof(buf)))) > 0) {
+    child_error_msg.append(buf, count);
+  }
+  close(pipe_fds[0]);
+  int status;
+  if (TEMP_FAILURE_RETRY(waitpid(pid, &status, 0)) != pid) {
+    *error_msg = StringPrintf("Couldn't dump heap; waitpid(%d) failed: %s", pid, strerror(errno));
+    return false;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    *error_msg = !child_error_msg.empty() ? child_error_msg
+        : StringPrintf("Couldn't dump heap; heap dump process %d failed with status %d",
+                       pid, status);
+    return false;
+  }
+  return true;
+}
+
 void DumpHeap(const char* filename, int fd, bool direct_to_ddms) {
   CHECK(filename != NULL);
 
-  Runtime::Current()->GetThreadList()->SuspendAll();
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll();
+  std::string error_msg;
+  bool okay;
+  if (!direct_to_ddms && Runtime::Current()->ForkHeapDumps()) {
+    bool fork_failed;
+    okay = ForkAndDumpHeap(filename, fd, &fork_failed, &error_msg);
+    if (!okay) {
+      if (!fork_failed) {
+        // The threads were resumed by the parent.
+        ScopedObjectAccess soa(Thread::Current());
+        ThrowRuntimeException("%s", error_msg.c_str());
+        LOG(ERROR) << error_msg;
+        return;
+      }
+      LOG(WARNING) << "hprof: " << error_msg << ", dumping the heap in process";
+    } else {
+      return;
+    }
+  }
   Hprof hprof(filename, fd, direct_to_ddms);
-  hprof.Dump();
-  Runtime::Current()->GetThreadList()->ResumeAll();
+  okay = hprof.Dump(&error_msg);
+  if (!okay) {
+    ThrowRuntimeException("%s", error_msg.c_str());
+    LOG(ERROR) << error_msg;
+  }
+  thread_list->ResumeAll();
 }
 
 }  // namespace hprof
@@ -21,6 +21,9 @@ namespace art {
 
 namespace hprof {
 
+// Dumps the heap to the file, or to DDMS. Dumps to files are streamed with bounded memory and are
+// gzip compressed when the file name ends with ".gz". With -XX:ForkHeapDumps they are written by a
+// forked copy of the process, and the threads only stay suspended for the fork.
 void DumpHeap(const char* filename, int fd, bool direct_to_ddms);
 
 }  // namespace hprof
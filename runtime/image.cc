@@ -24,14 +24,16 @@
 namespace art {
 
 const byte ImageHeader::kImageMagic[] = { 'a', 'r', 't', '\n' };
-const byte ImageHeader::kImageVersion[] = { '0', '0', '7', '\0' };
+const byte ImageHeader::kImageVersion[] = { '0', '0', '9', '\0' };
 
 ImageHeader::ImageHeader(uint32_t image_begin,
                          uint32_t image_size,
                          uint32_t image_bitmap_offset,
                          uint32_t image_bitmap_size,
+                         uint32_t relocations_offset,
                          uint32_t image_roots,
                          uint32_t oat_checksum,
+                         uint32_t boot_oat_checksum,
                          uint32_t oat_file_begin,
                          uint32_t oat_data_begin,
                          uint32_t oat_data_end,
@@ -40,7 +42,11 @@ ImageHeader::ImageHeader(uint32_t image_begin,
     image_size_(image_size),
     image_bitmap_offset_(image_bitmap_offset),
     image_bitmap_size_(image_bitmap_size),
+    relocations_offset_(relocations_offset),
+    relocations_size_(0),
+    patch_delta_(0),
     oat_checksum_(oat_checksum),
+    boot_oat_checksum_(boot_oat_checksum),
     oat_file_begin_(oat_file_begin),
     oat_data_begin_(oat_data_begin),
     oat_data_end_(oat_data_end),
@@ -49,6 +55,8 @@ ImageHeader::ImageHeader(uint32_t image_begin,
   CHECK_EQ(image_begin, RoundUp(image_begin, kPageSize));
   CHECK_EQ(oat_file_begin, RoundUp(oat_file_begin, kPageSize));
   CHECK_EQ(oat_data_begin, RoundUp(oat_data_begin, kPageSize));
+  CHECK_EQ(relocations_offset, RoundUp(relocations_offset, kPageSize));
+  CHECK_GE(relocations_offset, image_bitmap_offset + image_bitmap_size);
   CHECK_LT(image_begin, image_roots);
   CHECK_LT(image_roots, oat_file_begin);
   CHECK_LE(oat_file_begin, oat_data_begin);
@@ -68,6 +76,17 @@ bool ImageHeader::IsValid() const {
   return true;
 }
 
+void ImageHeader::Relocate(int32_t delta) {
+  CHECK(IsAligned<kPageSize>(delta)) << delta;
+  image_begin_ += delta;
+  oat_file_begin_ += delta;
+  oat_data_begin_ += delta;
+  oat_data_end_ += delta;
+  oat_file_end_ += delta;
+  image_roots_ += delta;
+  patch_delta_ += delta;
+}
+
 const char* ImageHeader::GetMagic() const {
   CHECK(IsValid());
   return reinterpret_cast<const char*>(magic_);
@@ -34,8 +34,10 @@ class PACKED(4) ImageHeader {
               uint32_t image_size_,
               uint32_t image_bitmap_offset,
               uint32_t image_bitmap_size,
+              uint32_t relocations_offset,
               uint32_t image_roots,
               uint32_t oat_checksum,
+              uint32_t boot_oat_checksum,
               uint32_t oat_file_begin,
               uint32_t oat_data_begin,
               uint32_t oat_data_end,
@@ -60,6 +62,35 @@ class PACKED(4) ImageHeader {
     return image_bitmap_size_;
   }
 
+  size_t GetRelocationsOffset() const {
+    return relocations_offset_;
+  }
+
+  size_t GetRelocationsSize() const {
+    return relocations_size_;
+  }
+
+  // The relocation section starts with a bitmap of the 32-bit words of the image which hold an
+  // absolute address into the image or its oat file, for 64-bit pointer fields the low word.
+  size_t GetRelocationBitmapSize() const {
+    return RoundUp(image_size_, kBytesPerRelocationBitmapWord) / kBytesPerRelocationBitmapWord *
+        sizeof(uint32_t);
+  }
+
+  // The bitmap is followed by the offsets from the oat header of the 32-bit words of the oat code
+  // which hold an absolute address, patched in by the ImageWriter.
+  size_t GetOatRelocationsCount() const {
+    return (relocations_size_ - GetRelocationBitmapSize()) / sizeof(uint32_t);
+  }
+
+  // Sum of the deltas the image and its oat file were moved by since they were written.
+  int32_t GetPatchDelta() const {
+    return patch_delta_;
+  }
+
+  // Moves the addresses of the header by delta, for an image relocated with its oat file.
+  void Relocate(int32_t delta);
+
   uint32_t GetOatChecksum() const {
     return oat_checksum_;
   }
@@ -68,6 +99,16 @@ class PACKED(4) ImageHeader {
     oat_checksum_ = oat_checksum;
   }
 
+  // Checksum of the oat file of the boot image an app image references, zero for a boot image.
+  uint32_t GetBootOatChecksum() const {
+    return boot_oat_checksum_;
+  }
+
+  // App images hold the classes of an app and point into the boot image they were written with.
+  bool IsAppImage() const {
+    return boot_oat_checksum_ != 0;
+  }
+
   byte* GetOatFileBegin() const {
     return reinterpret_cast<byte*>(oat_file_begin_);
   }
@@ -98,6 +139,21 @@ class PACKED(4) ImageHeader {
     return oat_filename;
   }
 
+  // Returns the location of the app image written next to an app oat file, with the extension of
+  // the oat file replaced.
+  static std::string GetAppImageLocationFromOatLocation(const std::string& oat) {
+    std::string image_filename = oat;
+    size_t last_slash = image_filename.rfind('/');
+    size_t last_dot = image_filename.rfind('.');
+    if (last_dot == std::string::npos ||
+        (last_slash != std::string::npos && last_dot < last_slash)) {
+      image_filename += ".art";
+    } else {
+      image_filename.replace(last_dot + 1, std::string::npos, "art");
+    }
+    return image_filename;
+  }
+
   enum ImageRoot {
     kResolutionMethod,
     kImtConflictMethod,
@@ -116,6 +172,10 @@ class PACKED(4) ImageHeader {
  private:
   mirror::ObjectArray<mirror::Object>* GetImageRoots() const;
 
+  // Bytes of the image covered by a 32-bit word of the relocation bitmap.
+  static constexpr size_t kBytesPerRelocationBitmapWord = sizeof(uint32_t) * kBitsPerByte *
+      sizeof(uint32_t);
+
   static const byte kImageMagic[4];
   static const byte kImageVersion[4];
 
@@ -134,9 +194,21 @@ class PACKED(4) ImageHeader {
   // Size of the image bitmap.
   uint32_t image_bitmap_size_;
 
+  // Page aligned relocation section offset in the file, after the image bitmap.
+  uint32_t relocations_offset_;
+
+  // Size of the relocation section, zero if the image can't be relocated.
+  uint32_t relocations_size_;
+
+  // Delta the image was relocated by.
+  int32_t patch_delta_;
+
   // Checksum of the oat file we link to for load time sanity check.
   uint32_t oat_checksum_;
 
+  // Checksum of the boot oat file the references out of an app image point into.
+  uint32_t boot_oat_checksum_;
+
   // Start address for oat file. Will be before oat_data_begin_ for .so files.
   uint32_t oat_file_begin_;
 
@@ -19,6 +19,7 @@
 
 #include "base/logging.h"
 #include "base/macros.h"
+#include <string.h>
 #include <streambuf>
 
 const char kIndentChar =' ';
@@ -55,6 +56,35 @@ class Indenter : public std::streambuf {
     return r;
   }
 
+  // Writes the text up to each new line at once, instead of a character at a time through
+  // overflow(), which matters for the large dumps of oatdump.
+  std::streamsize xsputn(const char* s, std::streamsize n) {
+    std::streamsize written = 0;
+    while (written < n) {
+      if (indent_next_) {
+        for (size_t i = 0; i < count_; ++i) {
+          Write(&text_, 1);
+        }
+      }
+      const char* line = s + written;
+      const char* new_line = static_cast<const char*>(memchr(line, '\n', n - written));
+      std::streamsize line_length = (new_line == nullptr) ? n - written : new_line + 1 - line;
+      Write(line, line_length);
+      indent_next_ = (new_line != nullptr);
+      written += line_length;
+    }
+    return written;
+  }
+
+  void Write(const char* s, std::streamsize n) {
+    std::streamsize r = out_sbuf_->sputn(s, n);
+    if (UNLIKELY(r != n)) {
+      out_sbuf_->pubsync();
+      std::streamsize r2 = out_sbuf_->sputn(s + r, n - r);
+      CHECK_EQ(r2, n - r) << "Error writing to buffer. Disk full?";
+    }
+  }
+
   int sync() {
     return out_sbuf_->pubsync();
   }
@@ -33,3 +33,17 @@ TEST(IndenterTest, MultiLineTest) {
   input << "\n";
   EXPECT_EQ(output.str(), "\t\thello\n\t\thello again\n");
 }
+
+TEST(IndenterTest, NestedMultiLineWriteTest) {
+  std::ostringstream output;
+  Indenter indent1_filter(output.rdbuf(), ' ', 2);
+  std::ostream indent1_os(&indent1_filter);
+  Indenter indent2_filter(indent1_os.rdbuf(), ' ', 2);
+  std::ostream indent2_os(&indent2_filter);
+
+  indent1_os << "a\n";
+  indent2_os << "b\nc\n\nd";
+  indent2_os << "e\n";
+  indent1_os << 'f' << '\n';
+  EXPECT_EQ("  a\n    b\n    c\n    \n    de\n  f\n", output.str());
+}
@@ -16,6 +16,7 @@
 
 #include "indirect_reference_table-inl.h"
 
+#include "atomic.h"
 #include "jni_internal.h"
 #include "reference_table.h"
 #include "runtime.h"
@@ -54,6 +55,38 @@ std::ostream& operator<<(std::ostream& os, const MutatorLockedDumpable<T>& rhs)
   return os;
 }
 
+// The memory of the local reference tables of exited threads, kept so that a starting thread does
+// not have to map and fault in fresh pages. The cache is a few lock-free slots since tables are
+// created and destroyed while the thread list lock may be held.
+struct LocalTableMemory {
+  MemMap* table_mem_map;
+  MemMap* slot_mem_map;
+  size_t max_count;
+};
+static constexpr size_t kLocalTableMemoryCacheSize = 8;
+static Atomic<LocalTableMemory*> local_table_memory_cache[kLocalTableMemoryCacheSize];
+
+static LocalTableMemory* TakeCachedLocalTableMemory(size_t max_count) {
+  for (Atomic<LocalTableMemory*>& cache_slot : local_table_memory_cache) {
+    LocalTableMemory* memory = cache_slot.LoadRelaxed();
+    if (memory != nullptr && memory->max_count == max_count &&
+        cache_slot.CompareExchangeStrongSequentiallyConsistent(memory, nullptr)) {
+      return memory;
+    }
+  }
+  return nullptr;
+}
+
+static bool CacheLocalTableMemory(LocalTableMemory* memory) {
+  for (Atomic<LocalTableMemory*>& cache_slot : local_table_memory_cache) {
+    if (cache_slot.LoadRelaxed() == nullptr &&
+        cache_slot.CompareExchangeStrongSequentiallyConsistent(nullptr, memory)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void IndirectReferenceTable::AbortIfNoCheckJNI() {
   // If -Xcheck:jni is on, it'll give a more detailed error before aborting.
   if (!Runtime::Current()->GetJavaVM()->check_jni) {
@@ -71,18 +104,28 @@ IndirectReferenceTable::IndirectReferenceTable(size_t initialCount,
   std::string error_str;
   const size_t initial_bytes = initialCount * sizeof(const mirror::Object*);
   const size_t table_bytes = maxCount * sizeof(const mirror::Object*);
-  table_mem_map_.reset(MemMap::MapAnonymous("indirect ref table", nullptr, table_bytes,
-                                            PROT_READ | PROT_WRITE, false, &error_str));
-  CHECK(table_mem_map_.get() != nullptr) << error_str;
+  const size_t slot_bytes = maxCount * sizeof(IndirectRefSlot);
+  LocalTableMemory* cached_memory =
+      (desiredKind == kLocal) ? TakeCachedLocalTableMemory(maxCount) : nullptr;
+  if (cached_memory != nullptr) {
+    table_mem_map_.reset(cached_memory->table_mem_map);
+    slot_mem_map_.reset(cached_memory->slot_mem_map);
+    delete cached_memory;
+    // Give the slots the contents of fresh pages.
+    memset(slot_mem_map_->Begin(), 0, slot_bytes);
+  } else {
+    table_mem_map_.reset(MemMap::MapAnonymous("indirect ref table", nullptr, table_bytes,
+                                              PROT_READ | PROT_WRITE, false, &error_str));
+    CHECK(table_mem_map_.get() != nullptr) << error_str;
+    slot_mem_map_.reset(MemMap::MapAnonymous("indirect ref table slots", nullptr, slot_bytes,
+                                             PROT_READ | PROT_WRITE, false, &error_str));
+    CHECK(slot_mem_map_.get() != nullptr) << error_str;
+  }
 
   table_ = reinterpret_cast<mirror::Object**>(table_mem_map_->Begin());
   CHECK(table_ != nullptr);
   memset(table_, 0xd1, initial_bytes);
 
-  const size_t slot_bytes = maxCount * sizeof(IndirectRefSlot);
-  slot_mem_map_.reset(MemMap::MapAnonymous("indirect ref table slots", nullptr, slot_bytes,
-                                           PROT_READ | PROT_WRITE, false, &error_str));
-  CHECK(slot_mem_map_.get() != nullptr) << error_str;
   slot_data_ = reinterpret_cast<IndirectRefSlot*>(slot_mem_map_->Begin());
   CHECK(slot_data_ != nullptr);
 
@@ -93,6 +136,17 @@ IndirectReferenceTable::IndirectReferenceTable(size_t initialCount,
 }
 
 IndirectReferenceTable::~IndirectReferenceTable() {
+  if (kind_ == kLocal) {
+    LocalTableMemory* memory = new LocalTableMemory;
+    memory->table_mem_map = table_mem_map_.release();
+    memory->slot_mem_map = slot_mem_map_.release();
+    memory->max_count = max_entries_;
+    if (!CacheLocalTableMemory(memory)) {
+      delete memory->table_mem_map;
+      delete memory->slot_mem_map;
+      delete memory;
+    }
+  }
 }
 
 IndirectRef IndirectReferenceTable::Add(uint32_t cookie, mirror::Object* obj) {
@@ -258,6 +258,28 @@ class IndirectReferenceTable {
   IndirectRef Add(uint32_t cookie, mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  /*
+   * Add a new local reference.  When the current segment has no holes and
+   * the table doesn't need to grow, the entry is bumped onto the top without
+   * the checks of Add.  The serial number of the slot is then only advanced
+   * with CheckJNI, so that a stale reference to a reused slot is only
+   * detected with CheckJNI.  Otherwise behaves like Add.
+   */
+  IndirectRef AddLocal(uint32_t cookie, mirror::Object* obj, bool check_jni)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) ALWAYS_INLINE {
+    IRTSegmentState prevState;
+    prevState.all = cookie;
+    const uint32_t topIndex = segment_state_.parts.topIndex;
+    if (UNLIKELY(check_jni || topIndex >= alloc_entries_ ||
+                 segment_state_.parts.numHoles != prevState.parts.numHoles)) {
+      return Add(cookie, obj);
+    }
+    DCHECK(obj != nullptr);
+    table_[topIndex] = obj;
+    segment_state_.parts.topIndex = topIndex + 1;
+    return ToIndirectRef(obj, topIndex);
+  }
+
   /*
    * Given an IndirectRef in the table, return the Object it refers to.
    *
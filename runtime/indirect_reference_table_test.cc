@@ -249,4 +249,49 @@ TEST_F(IndirectReferenceTableTest, BasicTest) {
   CheckDump(&irt, 0, 0);
 }
 
+TEST_F(IndirectReferenceTableTest, AddLocal) {
+  ScopedObjectAccess soa(Thread::Current());
+  static const size_t kTableInitial = 4;
+  static const size_t kTableMax = 16;
+  IndirectReferenceTable irt(kTableInitial, kTableMax, kLocal);
+
+  mirror::Class* c = class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+  ASSERT_TRUE(c != NULL);
+  mirror::Object* obj0 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj0 != NULL);
+  mirror::Object* obj1 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj1 != NULL);
+
+  const uint32_t cookie = IRT_FIRST_SEGMENT;
+  // Fills the table past its initial size, the fast path falls back to Add to grow it.
+  IndirectRef irefs[kTableInitial * 2];
+  for (size_t i = 0; i < arraysize(irefs); ++i) {
+    irefs[i] = irt.AddLocal(cookie, (i % 2 == 0) ? obj0 : obj1, false);
+    EXPECT_TRUE(irefs[i] != NULL);
+  }
+  EXPECT_EQ(arraysize(irefs), irt.Capacity());
+  for (size_t i = 0; i < arraysize(irefs); ++i) {
+    EXPECT_EQ((i % 2 == 0) ? obj0 : obj1, irt.Get(irefs[i]));
+  }
+  CheckDump(&irt, arraysize(irefs), 2);
+
+  // A hole in the segment, the fast path falls back to Add which fills it.
+  EXPECT_TRUE(irt.Remove(cookie, irefs[1]));
+  IndirectRef hole_iref = irt.AddLocal(cookie, obj0, false);
+  EXPECT_EQ(arraysize(irefs), irt.Capacity());
+  EXPECT_EQ(obj0, irt.Get(hole_iref));
+
+  // A new segment, popped by restoring the cookie.
+  const uint32_t segment_cookie = irt.GetSegmentState();
+  IndirectRef segment_iref = irt.AddLocal(segment_cookie, obj1, false);
+  EXPECT_EQ(obj1, irt.Get(segment_iref));
+  // Without CheckJNI the serial of the slot doesn't change, with CheckJNI it does.
+  irt.SetSegmentState(segment_cookie);
+  EXPECT_EQ(segment_iref, irt.AddLocal(segment_cookie, obj0, false));
+  irt.SetSegmentState(segment_cookie);
+  EXPECT_NE(segment_iref, irt.AddLocal(segment_cookie, obj0, true));
+  irt.SetSegmentState(segment_cookie);
+  EXPECT_EQ(arraysize(irefs), irt.Capacity());
+}
+
 }  // namespace art
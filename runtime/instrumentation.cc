@@ -24,6 +24,7 @@
 #include "debugger.h"
 #include "dex_file-inl.h"
 #include "entrypoints/quick/quick_alloc_entrypoints.h"
+#include "gc/heap.h"
 #include "interpreter/interpreter.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
@@ -149,7 +150,8 @@ void Instrumentation::InstallStubsForMethod(mirror::ArtMethod* method) {
         new_portable_code = class_linker->GetPortableOatCodeFor(method, &have_portable_code);
         new_quick_code = class_linker->GetQuickOatCodeFor(method);
         DCHECK(new_quick_code != GetQuickToInterpreterBridgeTrampoline(class_linker));
-        if (entry_exit_stubs_installed_ && new_quick_code != GetQuickToInterpreterBridge()) {
+        if (entry_exit_stubs_installed_ && new_quick_code != GetQuickToInterpreterBridge() &&
+            IsMethodTraced(method)) {
           DCHECK(new_portable_code != GetPortableToInterpreterBridge());
           new_portable_code = GetPortableToInterpreterBridge();
           new_quick_code = GetQuickInstrumentationEntryPoint();
@@ -518,6 +520,11 @@ void Instrumentation::SetEntrypointsInstrumented(bool instrumented) {
     SetQuickAllocEntryPointsInstrumented(instrumented);
     ResetQuickAllocEntryPoints();
   }
+  // Compiled code allocates from the TLABs without calling the entrypoints.
+  gc::Heap* heap = runtime->GetHeap();
+  if (heap != nullptr) {
+    heap->SetSingleObjectTlabs(instrumented);
+  }
   if (runtime->IsStarted()) {
     tl->ResumeAll();
   }
@@ -575,7 +582,7 @@ void Instrumentation::UpdateMethodsCode(mirror::ArtMethod* method, const void* q
       new_portable_code = portable_code;
       new_quick_code = quick_code;
       new_have_portable_code = have_portable_code;
-    } else if (entry_exit_stubs_installed_) {
+    } else if (entry_exit_stubs_installed_ && IsMethodTraced(method)) {
       new_quick_code = GetQuickInstrumentationEntryPoint();
       new_portable_code = GetPortableToInterpreterBridge();
       new_have_portable_code = false;
@@ -703,13 +710,28 @@ void Instrumentation::UndeoptimizeEverything() {
   ConfigureStubs(false, false);
 }
 
-void Instrumentation::EnableMethodTracing() {
+void Instrumentation::EnableMethodTracing(const std::string& class_descriptor_prefix) {
+  method_tracing_filter_ = class_descriptor_prefix;
   bool require_interpreter = kDeoptimizeForAccurateMethodEntryExitListeners;
   ConfigureStubs(!require_interpreter, require_interpreter);
 }
 
+bool Instrumentation::IsMethodTraced(mirror::ArtMethod* method) const {
+  if (LIKELY(method_tracing_filter_.empty())) {
+    return true;
+  }
+  mirror::Class* klass = method->GetDeclaringClass();
+  if (UNLIKELY(klass->IsProxyClass())) {
+    return StartsWith(klass->GetDescriptor(), method_tracing_filter_.c_str());
+  }
+  MethodHelper mh(method);
+  return strncmp(mh.GetDeclaringClassDescriptor(), method_tracing_filter_.c_str(),
+                 method_tracing_filter_.size()) == 0;
+}
+
 void Instrumentation::DisableMethodTracing() {
   ConfigureStubs(false, false);
+  method_tracing_filter_.clear();
 }
 
 const void* Instrumentation::GetQuickCodeFor(mirror::ArtMethod* method) const {
@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include <set>
 #include <list>
+#include <string>
 
 namespace art {
 namespace mirror {
@@ -163,11 +164,17 @@ class Instrumentation {
 
   bool IsDeoptimized(mirror::ArtMethod* method) const LOCKS_EXCLUDED(deoptimized_methods_lock_);
 
-  // Enable method tracing by installing instrumentation entry/exit stubs.
-  void EnableMethodTracing()
+  // Enable method tracing by installing instrumentation entry/exit stubs. Only the methods of the
+  // classes whose descriptor starts with class_descriptor_prefix get the stubs, the others keep
+  // running their compiled code at full speed. All the methods get them if the prefix is empty.
+  void EnableMethodTracing(const std::string& class_descriptor_prefix)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
       LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
 
+  // Returns whether method tracing reports the method, which is the case for all the methods
+  // when method tracing isn't restricted to some classes.
+  bool IsMethodTraced(mirror::ArtMethod* method) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Disable method tracing by uninstalling instrumentation entry/exit stubs.
   void DisableMethodTracing()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
@@ -423,6 +430,10 @@ class Instrumentation {
   // modified.
   InterpreterHandlerTable interpreter_handler_table_;
 
+  // Prefix of the descriptors of the classes whose methods get the entry/exit stubs of method
+  // tracing, all the methods get them if it is empty.
+  std::string method_tracing_filter_;
+
   // Greater than 0 if quick alloc entry points instrumented.
   // TODO: The access and changes to this is racy and should be guarded by a lock.
   AtomicInteger quick_alloc_entry_points_instrumentation_counter_;
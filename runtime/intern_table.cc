@@ -28,74 +28,91 @@
 
 namespace art {
 
+InternTable::Shard::Shard()
+    : lock_("InternTable shard lock", kInternTableShardLock), log_new_roots_(false) {
+}
+
 InternTable::InternTable()
-    : log_new_roots_(false), allow_new_interns_(true),
+    : allow_new_interns_(true),
       new_intern_condition_("New intern condition", *Locks::intern_table_lock_) {
 }
 
 size_t InternTable::Size() const {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  return strong_interns_.size() + weak_interns_.size();
+  Thread* self = Thread::Current();
+  size_t size = 0;
+  for (const Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock_);
+    size += shard.strong_interns_.size() + shard.weak_interns_.size();
+  }
+  return size;
 }
 
 void InternTable::DumpForSigQuit(std::ostream& os) const {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  os << "Intern table: " << strong_interns_.size() << " strong; "
-     << weak_interns_.size() << " weak\n";
+  Thread* self = Thread::Current();
+  size_t strong = 0;
+  size_t weak = 0;
+  for (const Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock_);
+    strong += shard.strong_interns_.size();
+    weak += shard.weak_interns_.size();
+  }
+  os << "Intern table: " << strong << " strong; " << weak << " weak\n";
 }
 
 void InternTable::VisitRoots(RootCallback* callback, void* arg, VisitRootFlags flags) {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  if ((flags & kVisitRootFlagAllRoots) != 0) {
-    for (auto& strong_intern : strong_interns_) {
-      callback(reinterpret_cast<mirror::Object**>(&strong_intern.second), arg, 0,
-               kRootInternedString);
-      DCHECK(strong_intern.second != nullptr);
+  Thread* self = Thread::Current();
+  // The flags are applied to each shard while holding its lock, so that a string inserted into
+  // a shard is either visited below or logged as a new root.
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock_);
+    if ((flags & kVisitRootFlagAllRoots) != 0) {
+      for (auto& strong_intern : shard.strong_interns_) {
+        callback(reinterpret_cast<mirror::Object**>(&strong_intern.second), arg, 0,
+                 kRootInternedString);
+        DCHECK(strong_intern.second != nullptr);
+      }
+    } else if ((flags & kVisitRootFlagNewRoots) != 0) {
+      for (auto& pair : shard.new_strong_intern_roots_) {
+        mirror::String* old_ref = pair.second;
+        callback(reinterpret_cast<mirror::Object**>(&pair.second), arg, 0, kRootInternedString);
+        if (UNLIKELY(pair.second != old_ref)) {
+          // Uh ohes, GC moved a root in the log. Need to search the strong interns and update the
+          // corresponding object. This is slow, but luckily for us, this may only happen with a
+          // concurrent moving GC.
+          for (auto it = shard.strong_interns_.lower_bound(pair.first),
+              end = shard.strong_interns_.end(); it != end && it->first == pair.first; ++it) {
+            // If the class stored matches the old class, update it to the new value.
+            if (old_ref == it->second) {
+              it->second = pair.second;
+            }
+          }
+        }
+      }
     }
-  } else if ((flags & kVisitRootFlagNewRoots) != 0) {
-    for (auto& pair : new_strong_intern_roots_) {
-       mirror::String* old_ref = pair.second;
-       callback(reinterpret_cast<mirror::Object**>(&pair.second), arg, 0, kRootInternedString);
-       if (UNLIKELY(pair.second != old_ref)) {
-         // Uh ohes, GC moved a root in the log. Need to search the strong interns and update the
-         // corresponding object. This is slow, but luckily for us, this may only happen with a
-         // concurrent moving GC.
-         for (auto it = strong_interns_.lower_bound(pair.first), end = strong_interns_.end();
-             it != end && it->first == pair.first; ++it) {
-           // If the class stored matches the old class, update it to the new value.
-           if (old_ref == it->second) {
-             it->second = pair.second;
-           }
-         }
-       }
-     }
-  }
 
-  if ((flags & kVisitRootFlagClearRootLog) != 0) {
-    new_strong_intern_roots_.clear();
-  }
-  if ((flags & kVisitRootFlagStartLoggingNewRoots) != 0) {
-    log_new_roots_ = true;
-  } else if ((flags & kVisitRootFlagStopLoggingNewRoots) != 0) {
-    log_new_roots_ = false;
+    if ((flags & kVisitRootFlagClearRootLog) != 0) {
+      shard.new_strong_intern_roots_.clear();
+    }
+    if ((flags & kVisitRootFlagStartLoggingNewRoots) != 0) {
+      shard.log_new_roots_ = true;
+    } else if ((flags & kVisitRootFlagStopLoggingNewRoots) != 0) {
+      shard.log_new_roots_ = false;
+    }
   }
   // Note: we deliberately don't visit the weak_interns_ table and the immutable image roots.
 }
 
-mirror::String* InternTable::LookupStrong(mirror::String* s, int32_t hash_code) {
-  return Lookup<kWithoutReadBarrier>(&strong_interns_, s, hash_code);
+mirror::String* InternTable::LookupStrong(Shard* shard, mirror::String* s, int32_t hash_code) {
+  return Lookup<kWithoutReadBarrier>(&shard->strong_interns_, s, hash_code);
 }
 
-mirror::String* InternTable::LookupWeak(mirror::String* s, int32_t hash_code) {
+mirror::String* InternTable::LookupWeak(Shard* shard, mirror::String* s, int32_t hash_code) {
   // Weak interns need a read barrier because they are weak roots.
-  return Lookup<kWithReadBarrier>(&weak_interns_, s, hash_code);
+  return Lookup<kWithReadBarrier>(&shard->weak_interns_, s, hash_code);
 }
 
 template<ReadBarrierOption kReadBarrierOption>
 mirror::String* InternTable::Lookup(Table* table, mirror::String* s, int32_t hash_code) {
-  CHECK_EQ(table == &weak_interns_, kReadBarrierOption == kWithReadBarrier)
-      << "Only weak_interns_ needs a read barrier.";
-  Locks::intern_table_lock_->AssertHeld(Thread::Current());
   for (auto it = table->lower_bound(hash_code), end = table->end();
        it != end && it->first == hash_code; ++it) {
     mirror::String** weak_root = &it->second;
@@ -108,43 +125,29 @@ mirror::String* InternTable::Lookup(Table* table, mirror::String* s, int32_t has
   return NULL;
 }
 
-mirror::String* InternTable::InsertStrong(mirror::String* s, int32_t hash_code) {
-  Runtime* runtime = Runtime::Current();
-  if (runtime->IsActiveTransaction()) {
-    runtime->RecordStrongStringInsertion(s, hash_code);
+mirror::String* InternTable::InsertStrong(Shard* shard, mirror::String* s, int32_t hash_code) {
+  if (shard->log_new_roots_) {
+    shard->new_strong_intern_roots_.push_back(std::make_pair(hash_code, s));
   }
-  if (log_new_roots_) {
-    new_strong_intern_roots_.push_back(std::make_pair(hash_code, s));
-  }
-  strong_interns_.insert(std::make_pair(hash_code, s));
+  shard->strong_interns_.insert(std::make_pair(hash_code, s));
   return s;
 }
 
-mirror::String* InternTable::InsertWeak(mirror::String* s, int32_t hash_code) {
-  Runtime* runtime = Runtime::Current();
-  if (runtime->IsActiveTransaction()) {
-    runtime->RecordWeakStringInsertion(s, hash_code);
-  }
-  weak_interns_.insert(std::make_pair(hash_code, s));
+mirror::String* InternTable::InsertWeak(Shard* shard, mirror::String* s, int32_t hash_code) {
+  shard->weak_interns_.insert(std::make_pair(hash_code, s));
   return s;
 }
 
-void InternTable::RemoveStrong(mirror::String* s, int32_t hash_code) {
-  Remove<kWithoutReadBarrier>(&strong_interns_, s, hash_code);
+void InternTable::RemoveStrong(Shard* shard, mirror::String* s, int32_t hash_code) {
+  Remove<kWithoutReadBarrier>(&shard->strong_interns_, s, hash_code);
 }
 
-void InternTable::RemoveWeak(mirror::String* s, int32_t hash_code) {
-  Runtime* runtime = Runtime::Current();
-  if (runtime->IsActiveTransaction()) {
-    runtime->RecordWeakStringRemoval(s, hash_code);
-  }
-  Remove<kWithReadBarrier>(&weak_interns_, s, hash_code);
+void InternTable::RemoveWeak(Shard* shard, mirror::String* s, int32_t hash_code) {
+  Remove<kWithReadBarrier>(&shard->weak_interns_, s, hash_code);
 }
 
 template<ReadBarrierOption kReadBarrierOption>
 void InternTable::Remove(Table* table, mirror::String* s, int32_t hash_code) {
-  CHECK_EQ(table == &weak_interns_, kReadBarrierOption == kWithReadBarrier)
-      << "Only weak_interns_ needs a read barrier.";
   for (auto it = table->lower_bound(hash_code), end = table->end();
        it != end && it->first == hash_code; ++it) {
     mirror::String** weak_root = &it->second;
@@ -160,19 +163,27 @@ void InternTable::Remove(Table* table, mirror::String* s, int32_t hash_code) {
 // Insert/remove methods used to undo changes made during an aborted transaction.
 mirror::String* InternTable::InsertStrongFromTransaction(mirror::String* s, int32_t hash_code) {
   DCHECK(!Runtime::Current()->IsActiveTransaction());
-  return InsertStrong(s, hash_code);
+  Shard* shard = GetShard(hash_code);
+  MutexLock mu(Thread::Current(), shard->lock_);
+  return InsertStrong(shard, s, hash_code);
 }
 mirror::String* InternTable::InsertWeakFromTransaction(mirror::String* s, int32_t hash_code) {
   DCHECK(!Runtime::Current()->IsActiveTransaction());
-  return InsertWeak(s, hash_code);
+  Shard* shard = GetShard(hash_code);
+  MutexLock mu(Thread::Current(), shard->lock_);
+  return InsertWeak(shard, s, hash_code);
 }
 void InternTable::RemoveStrongFromTransaction(mirror::String* s, int32_t hash_code) {
   DCHECK(!Runtime::Current()->IsActiveTransaction());
-  RemoveStrong(s, hash_code);
+  Shard* shard = GetShard(hash_code);
+  MutexLock mu(Thread::Current(), shard->lock_);
+  RemoveStrong(shard, s, hash_code);
 }
 void InternTable::RemoveWeakFromTransaction(mirror::String* s, int32_t hash_code) {
   DCHECK(!Runtime::Current()->IsActiveTransaction());
-  RemoveWeak(s, hash_code);
+  Shard* shard = GetShard(hash_code);
+  MutexLock mu(Thread::Current(), shard->lock_);
+  RemoveWeak(shard, s, hash_code);
 }
 
 static mirror::String* LookupStringFromImage(mirror::String* s)
@@ -203,70 +214,114 @@ static mirror::String* LookupStringFromImage(mirror::String* s)
 void InternTable::AllowNewInterns() {
   Thread* self = Thread::Current();
   MutexLock mu(self, *Locks::intern_table_lock_);
-  allow_new_interns_ = true;
+  allow_new_interns_.StoreRelaxed(true);
   new_intern_condition_.Broadcast(self);
 }
 
 void InternTable::DisallowNewInterns() {
   Thread* self = Thread::Current();
   MutexLock mu(self, *Locks::intern_table_lock_);
-  allow_new_interns_ = false;
+  allow_new_interns_.StoreRelaxed(false);
 }
 
 mirror::String* InternTable::Insert(mirror::String* s, bool is_strong) {
+  DCHECK(s != NULL);
   Thread* self = Thread::Current();
-  MutexLock mu(self, *Locks::intern_table_lock_);
+  const int32_t hash_code = s->GetHashCode();
+  Shard* shard = GetShard(hash_code);
+  Runtime* runtime = Runtime::Current();
 
-  DCHECK(s != NULL);
-  uint32_t hash_code = s->GetHashCode();
+  // Fast path, only the shard is locked. New interns are disallowed with the mutators suspended,
+  // which can't happen before we are done since we don't reach a suspend point in between.
+  if (LIKELY(allow_new_interns_.LoadRelaxed() && !runtime->IsActiveTransaction())) {
+    MutexLock mu(self, shard->lock_);
+    return InsertLocked(shard, s, hash_code, is_strong, nullptr);
+  }
 
-  while (UNLIKELY(!allow_new_interns_)) {
+  // Slow path, wait for the GC to allow new interns and record the modifications if a transaction
+  // is active. Transactions log under intern_table_lock_, the shard lock is released first since
+  // the transaction log lock is taken before the shard locks during a rollback.
+  MutexLock mu(self, *Locks::intern_table_lock_);
+  while (UNLIKELY(!allow_new_interns_.LoadRelaxed())) {
     new_intern_condition_.WaitHoldingLocks(self);
   }
+  Modifications modifications;
+  mirror::String* result;
+  {
+    MutexLock mu2(self, shard->lock_);
+    result = InsertLocked(shard, s, hash_code, is_strong, &modifications);
+  }
+  if (runtime->IsActiveTransaction()) {
+    if (modifications.removed_weak != nullptr) {
+      runtime->RecordWeakStringRemoval(modifications.removed_weak, hash_code);
+    }
+    if (modifications.inserted != nullptr) {
+      if (modifications.inserted_strong) {
+        runtime->RecordStrongStringInsertion(modifications.inserted, hash_code);
+      } else {
+        runtime->RecordWeakStringInsertion(modifications.inserted, hash_code);
+      }
+    }
+  }
+  return result;
+}
 
+mirror::String* InternTable::InsertLocked(Shard* shard, mirror::String* s, int32_t hash_code,
+                                          bool is_strong, Modifications* modifications) {
+  Modifications unused;
+  if (modifications == nullptr) {
+    modifications = &unused;
+  }
   if (is_strong) {
     // Check the strong table for a match.
-    mirror::String* strong = LookupStrong(s, hash_code);
+    mirror::String* strong = LookupStrong(shard, s, hash_code);
     if (strong != NULL) {
       return strong;
     }
 
+    modifications->inserted_strong = true;
     // Check the image for a match.
     mirror::String* image = LookupStringFromImage(s);
     if (image != NULL) {
-      return InsertStrong(image, hash_code);
+      modifications->inserted = image;
+      return InsertStrong(shard, image, hash_code);
     }
 
     // There is no match in the strong table, check the weak table.
-    mirror::String* weak = LookupWeak(s, hash_code);
+    mirror::String* weak = LookupWeak(shard, s, hash_code);
     if (weak != NULL) {
       // A match was found in the weak table. Promote to the strong table.
-      RemoveWeak(weak, hash_code);
-      return InsertStrong(weak, hash_code);
+      RemoveWeak(shard, weak, hash_code);
+      modifications->removed_weak = weak;
+      modifications->inserted = weak;
+      return InsertStrong(shard, weak, hash_code);
     }
 
     // No match in the strong table or the weak table. Insert into the strong
     // table.
-    return InsertStrong(s, hash_code);
+    modifications->inserted = s;
+    return InsertStrong(shard, s, hash_code);
   }
 
   // Check the strong table for a match.
-  mirror::String* strong = LookupStrong(s, hash_code);
+  mirror::String* strong = LookupStrong(shard, s, hash_code);
   if (strong != NULL) {
     return strong;
   }
   // Check the image for a match.
   mirror::String* image = LookupStringFromImage(s);
   if (image != NULL) {
-    return InsertWeak(image, hash_code);
+    modifications->inserted = image;
+    return InsertWeak(shard, image, hash_code);
   }
   // Check the weak table for a match.
-  mirror::String* weak = LookupWeak(s, hash_code);
+  mirror::String* weak = LookupWeak(shard, s, hash_code);
   if (weak != NULL) {
     return weak;
   }
   // Insert into the weak table.
-  return InsertWeak(s, hash_code);
+  modifications->inserted = s;
+  return InsertWeak(shard, s, hash_code);
 }
 
 mirror::String* InternTable::InternStrong(int32_t utf16_length, const char* utf8_data) {
@@ -295,23 +350,29 @@ mirror::String* InternTable::InternWeak(mirror::String* s) {
 }
 
 bool InternTable::ContainsWeak(mirror::String* s) {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  const mirror::String* found = LookupWeak(s, s->GetHashCode());
+  const int32_t hash_code = s->GetHashCode();
+  Shard* shard = GetShard(hash_code);
+  MutexLock mu(Thread::Current(), shard->lock_);
+  const mirror::String* found = LookupWeak(shard, s, hash_code);
   return found == s;
 }
 
 void InternTable::SweepInternTableWeaks(IsMarkedCallback* callback, void* arg) {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  for (auto it = weak_interns_.begin(), end = weak_interns_.end(); it != end;) {
-    // This does not need a read barrier because this is called by GC.
-    mirror::Object* object = it->second;
-    mirror::Object* new_object = callback(object, arg);
-    if (new_object == nullptr) {
-      // TODO: use it = weak_interns_.erase(it) when we get a c++11 stl.
-      weak_interns_.erase(it++);
-    } else {
-      it->second = down_cast<mirror::String*>(new_object);
-      ++it;
+  Thread* self = Thread::Current();
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock_);
+    Table* weak_interns = &shard.weak_interns_;
+    for (auto it = weak_interns->begin(), end = weak_interns->end(); it != end;) {
+      // This does not need a read barrier because this is called by GC.
+      mirror::Object* object = it->second;
+      mirror::Object* new_object = callback(object, arg);
+      if (new_object == nullptr) {
+        // TODO: use it = weak_interns_.erase(it) when we get a c++11 stl.
+        weak_interns->erase(it++);
+      } else {
+        it->second = down_cast<mirror::String*>(new_object);
+        ++it;
+      }
     }
   }
 }
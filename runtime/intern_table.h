@@ -18,7 +18,9 @@
 #define ART_RUNTIME_INTERN_TABLE_H_
 
 #include <map>
+#include <vector>
 
+#include "atomic.h"
 #include "base/mutex.h"
 #include "object_callbacks.h"
 
@@ -75,31 +77,71 @@ class InternTable {
  private:
   typedef std::multimap<int32_t, mirror::String*> Table;
 
+  // The strings are spread over independently locked shards by hash code so that threads interning
+  // different strings rarely contend. A string and its hash code always map to the same shard, so
+  // the strong and weak table of a shard can be checked and updated together.
+  static constexpr size_t kShardCount = 16;
+
+  struct Shard {
+    Shard();
+
+    mutable Mutex lock_ ACQUIRED_AFTER(Locks::intern_table_lock_);
+    bool log_new_roots_ GUARDED_BY(lock_);
+    Table strong_interns_ GUARDED_BY(lock_);
+    std::vector<std::pair<int32_t, mirror::String*>> new_strong_intern_roots_ GUARDED_BY(lock_);
+    // Since weak_interns_ contain weak roots, they need a read
+    // barrier. Do not directly access the strings in it. Use functions
+    // that contain read barriers.
+    Table weak_interns_ GUARDED_BY(lock_);
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(Shard);
+  };
+
+  // What InsertLocked changed in the tables, recorded by Insert when a transaction is active.
+  struct Modifications {
+    Modifications() : removed_weak(nullptr), inserted(nullptr), inserted_strong(false) {}
+
+    mirror::String* removed_weak;
+    mirror::String* inserted;
+    bool inserted_strong;
+  };
+
+  Shard* GetShard(int32_t hash_code) {
+    const uint32_t hash = static_cast<uint32_t>(hash_code);
+    return &shards_[(hash ^ (hash >> 16)) & (kShardCount - 1)];
+  }
+
   mirror::String* Insert(mirror::String* s, bool is_strong)
       LOCKS_EXCLUDED(Locks::intern_table_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  mirror::String* InsertLocked(Shard* shard, mirror::String* s, int32_t hash_code, bool is_strong,
+                               Modifications* modifications)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      EXCLUSIVE_LOCKS_REQUIRED(shard->lock_);
 
-  mirror::String* LookupStrong(mirror::String* s, int32_t hash_code)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  mirror::String* LookupWeak(mirror::String* s, int32_t hash_code)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  mirror::String* LookupStrong(Shard* shard, mirror::String* s, int32_t hash_code)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      EXCLUSIVE_LOCKS_REQUIRED(shard->lock_);
+  mirror::String* LookupWeak(Shard* shard, mirror::String* s, int32_t hash_code)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      EXCLUSIVE_LOCKS_REQUIRED(shard->lock_);
   template<ReadBarrierOption kReadBarrierOption = kWithReadBarrier>
   mirror::String* Lookup(Table* table, mirror::String* s, int32_t hash_code)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  mirror::String* InsertStrong(mirror::String* s, int32_t hash_code)
-      EXCLUSIVE_LOCKS_REQUIRED(Locks::intern_table_lock_);
-  mirror::String* InsertWeak(mirror::String* s, int32_t hash_code)
-      EXCLUSIVE_LOCKS_REQUIRED(Locks::intern_table_lock_);
-  void RemoveStrong(mirror::String* s, int32_t hash_code)
+  mirror::String* InsertStrong(Shard* shard, mirror::String* s, int32_t hash_code)
+      EXCLUSIVE_LOCKS_REQUIRED(shard->lock_);
+  mirror::String* InsertWeak(Shard* shard, mirror::String* s, int32_t hash_code)
+      EXCLUSIVE_LOCKS_REQUIRED(shard->lock_);
+  void RemoveStrong(Shard* shard, mirror::String* s, int32_t hash_code)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
-      EXCLUSIVE_LOCKS_REQUIRED(Locks::intern_table_lock_);
-  void RemoveWeak(mirror::String* s, int32_t hash_code)
+      EXCLUSIVE_LOCKS_REQUIRED(shard->lock_);
+  void RemoveWeak(Shard* shard, mirror::String* s, int32_t hash_code)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
-      EXCLUSIVE_LOCKS_REQUIRED(Locks::intern_table_lock_);
+      EXCLUSIVE_LOCKS_REQUIRED(shard->lock_);
   template<ReadBarrierOption kReadBarrierOption = kWithReadBarrier>
   void Remove(Table* table, mirror::String* s, int32_t hash_code)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
-      EXCLUSIVE_LOCKS_REQUIRED(Locks::intern_table_lock_);
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Transaction rollback access.
   mirror::String* InsertStrongFromTransaction(mirror::String* s, int32_t hash_code)
@@ -114,16 +156,12 @@ class InternTable {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::intern_table_lock_);
   friend class Transaction;
 
-  bool log_new_roots_ GUARDED_BY(Locks::intern_table_lock_);
-  bool allow_new_interns_ GUARDED_BY(Locks::intern_table_lock_);
+  // Cleared while the GC sweeps the weak interns. Only written with the mutators suspended or
+  // while holding intern_table_lock_, readers that see it set may intern without the lock since
+  // the GC can't disallow new interns before they reach a suspend point.
+  Atomic<bool> allow_new_interns_;
   ConditionVariable new_intern_condition_ GUARDED_BY(Locks::intern_table_lock_);
-  Table strong_interns_ GUARDED_BY(Locks::intern_table_lock_);
-  std::vector<std::pair<int32_t, mirror::String*>> new_strong_intern_roots_
-      GUARDED_BY(Locks::intern_table_lock_);
-  // Since weak_interns_ contain weak roots, they need a read
-  // barrier. Do not directly access the strings in it. Use functions
-  // that contain read barriers.
-  Table weak_interns_ GUARDED_BY(Locks::intern_table_lock_);
+  Shard shards_[kShardCount];
 };
 
 }  // namespace art
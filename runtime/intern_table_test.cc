@@ -180,4 +180,45 @@ TEST_F(InternTableTest, ContainsWeak) {
   }
 }
 
+static void CountRootCallback(mirror::Object** root, void* arg, uint32_t /*thread_id*/,
+                              RootType /*root_type*/) {
+  EXPECT_TRUE(*root != nullptr);
+  ++*reinterpret_cast<size_t*>(arg);
+}
+
+TEST_F(InternTableTest, VisitRoots) {
+  ScopedObjectAccess soa(Thread::Current());
+  InternTable t;
+  // Enough strings to end up in several shards.
+  static const char* const kStrings[] = {
+      "a", "b", "c", "d", "e", "f", "g", "h", "ab", "bc", "cd", "de", "ef", "fg", "gh", "hi",
+      "abc", "bcd", "cde", "def", "efg", "fgh", "ghi", "hij",
+  };
+  for (const char* string : kStrings) {
+    t.InternStrong(string);
+  }
+  size_t count = 0;
+  t.VisitRoots(CountRootCallback, &count,
+               static_cast<VisitRootFlags>(kVisitRootFlagAllRoots |
+                                           kVisitRootFlagStartLoggingNewRoots));
+  EXPECT_EQ(arraysize(kStrings), count);
+
+  // Only the strings interned since we started logging are new roots.
+  t.InternStrong("new root");
+  t.InternStrong("another new root");
+  t.InternStrong("a");
+  count = 0;
+  t.VisitRoots(CountRootCallback, &count,
+               static_cast<VisitRootFlags>(kVisitRootFlagNewRoots |
+                                           kVisitRootFlagStopLoggingNewRoots |
+                                           kVisitRootFlagClearRootLog));
+  EXPECT_EQ(2U, count);
+  EXPECT_EQ(arraysize(kStrings) + 2, t.Size());
+
+  t.InternStrong("not logged");
+  count = 0;
+  t.VisitRoots(CountRootCallback, &count, kVisitRootFlagNewRoots);
+  EXPECT_EQ(0U, count);
+}
+
 }  // namespace art
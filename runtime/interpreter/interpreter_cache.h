@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
+#define ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "globals.h"
+
+namespace art {
+
+class Instruction;
+
+namespace mirror {
+  class ArtField;
+  class ArtMethod;
+  class Class;
+}  // namespace mirror
+
+// Per-thread inline cache of the interpreter. It maps an invoke-virtual or invoke-interface
+// instruction and the class of its receiver to the method the invoke dispatches to, and a field
+// access instruction to its field. This saves the resolution, the access checks and the vtable or
+// iftable search of the instructions found in the cache. The instruction address identifies the
+// call site, so sites with several receiver classes keep one entry per class and are cached
+// polymorphically.
+//
+// The cache is direct mapped: a new entry overwrites whatever maps to its slot. Only its thread
+// uses it, without locking, and Thread::VisitRoots clears it since the GC may move the classes.
+class InterpreterCache {
+ public:
+  // Number of entries, a power of two.
+  static constexpr size_t kSize = 256;
+
+  InterpreterCache() {
+    Clear();
+  }
+
+  // Returns the cached target of the invoke for receivers of the given class, or null.
+  mirror::ArtMethod* GetMethod(const Instruction* inst, mirror::Class* klass) const {
+    return static_cast<mirror::ArtMethod*>(Get(inst, klass));
+  }
+
+  void SetMethod(const Instruction* inst, mirror::Class* klass, mirror::ArtMethod* method) {
+    Set(inst, klass, method);
+  }
+
+  // Returns the cached field of the field access, or null. Fields don't depend on the receiver.
+  mirror::ArtField* GetField(const Instruction* inst) const {
+    return static_cast<mirror::ArtField*>(Get(inst, nullptr));
+  }
+
+  void SetField(const Instruction* inst, mirror::ArtField* field) {
+    Set(inst, nullptr, field);
+  }
+
+  void Clear() {
+    for (Entry& entry : entries_) {
+      entry.inst = nullptr;
+      entry.klass = nullptr;
+      entry.value = nullptr;
+    }
+  }
+
+ private:
+  struct Entry {
+    const Instruction* inst;
+    mirror::Class* klass;
+    // The ArtMethod of an invoke or the ArtField of a field access.
+    void* value;
+  };
+
+  void* Get(const Instruction* inst, mirror::Class* klass) const {
+    const Entry& entry = entries_[IndexOf(inst, klass)];
+    return (entry.inst == inst && entry.klass == klass) ? entry.value : nullptr;
+  }
+
+  void Set(const Instruction* inst, mirror::Class* klass, void* value) {
+    Entry& entry = entries_[IndexOf(inst, klass)];
+    entry.inst = inst;
+    entry.klass = klass;
+    entry.value = value;
+  }
+
+  static size_t IndexOf(const Instruction* inst, mirror::Class* klass) {
+    // Instructions are 2 byte aligned and objects are kObjectAlignment aligned.
+    uintptr_t inst_bits = reinterpret_cast<uintptr_t>(inst) >> 1;
+    uintptr_t klass_bits = reinterpret_cast<uintptr_t>(klass) / kObjectAlignment;
+    return (inst_bits ^ (klass_bits * 31)) & (kSize - 1);
+  }
+
+  Entry entries_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(InterpreterCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
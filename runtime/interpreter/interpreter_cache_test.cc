@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interpreter_cache.h"
+
+#include <memory>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+// The cache only compares the pointers, fake addresses with the right alignments are enough.
+static const Instruction* FakeInstruction(uintptr_t address) {
+  return reinterpret_cast<const Instruction*>(address);
+}
+
+static mirror::Class* FakeClass(uintptr_t address) {
+  return reinterpret_cast<mirror::Class*>(address);
+}
+
+static mirror::ArtMethod* FakeMethod(uintptr_t address) {
+  return reinterpret_cast<mirror::ArtMethod*>(address);
+}
+
+// An invoke is keyed by its call site and the class of its receiver, several receiver classes
+// of one call site are cached side by side.
+TEST(InterpreterCache, PolymorphicCallSite) {
+  std::unique_ptr<InterpreterCache> cache(new InterpreterCache);
+  const Instruction* inst = FakeInstruction(0x2000);
+  static constexpr size_t kNumClasses = 4;
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    cache->SetMethod(inst, FakeClass(0x70000000 + i * kObjectAlignment),
+                     FakeMethod(0x60000000 + i * 8));
+  }
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    EXPECT_EQ(FakeMethod(0x60000000 + i * 8),
+              cache->GetMethod(inst, FakeClass(0x70000000 + i * kObjectAlignment)));
+  }
+  // The same receiver class at another call site is a different invoke.
+  EXPECT_TRUE(cache->GetMethod(FakeInstruction(0x2006), FakeClass(0x70000000)) == nullptr);
+}
+
+// A field access only depends on its instruction, and never answers an invoke lookup.
+TEST(InterpreterCache, FieldsIgnoreReceiver) {
+  std::unique_ptr<InterpreterCache> cache(new InterpreterCache);
+  const Instruction* inst = FakeInstruction(0x3004);
+  mirror::ArtField* field = reinterpret_cast<mirror::ArtField*>(0x50000000);
+  cache->SetField(inst, field);
+  EXPECT_EQ(field, cache->GetField(inst));
+  EXPECT_TRUE(cache->GetMethod(inst, FakeClass(0x70000008)) == nullptr);
+}
+
+}  // namespace art
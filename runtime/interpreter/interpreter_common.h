@@ -125,8 +125,21 @@ static inline bool DoInvoke(Thread* self, ShadowFrame& shadow_frame, const Instr
   const uint32_t vregC = (is_range) ? inst->VRegC_3rc() : inst->VRegC_35c();
   Object* receiver = (type == kStatic) ? nullptr : shadow_frame.GetVRegReference(vregC);
   mirror::ArtMethod* sf_method = shadow_frame.GetMethod();
-  ArtMethod* const method = FindMethodFromCode<type, do_access_check>(
-      method_idx, &receiver, &sf_method, self);
+  ArtMethod* method;
+  if ((type == kVirtual || type == kInterface) && LIKELY(receiver != nullptr)) {
+    // The target only depends on the call site and the class of the receiver.
+    InterpreterCache* cache = self->GetInterpreterCache();
+    method = cache->GetMethod(inst, receiver->GetClass());
+    if (method == nullptr) {
+      method = FindMethodFromCode<type, do_access_check>(method_idx, &receiver, &sf_method, self);
+      if (method != nullptr) {
+        // The resolution may have suspended, the receiver is the updated one.
+        cache->SetMethod(inst, receiver->GetClass(), method);
+      }
+    }
+  } else {
+    method = FindMethodFromCode<type, do_access_check>(method_idx, &receiver, &sf_method, self);
+  }
   // The shadow frame should already be pushed, so we don't need to update it.
   if (UNLIKELY(method == nullptr)) {
     CHECK(self->IsExceptionPending());
@@ -171,6 +184,29 @@ static inline bool DoInvokeVirtualQuick(Thread* self, ShadowFrame& shadow_frame,
   }
 }
 
+// Resolves the field of an iget-XXX, iput-XXX, sget-XXX or sput-XXX instruction through the
+// interpreter cache of the thread, which saves the resolution and the access checks of the
+// accesses found in the cache.
+// Returns the field on success, otherwise throws an exception and returns null.
+template<FindFieldType find_type, bool do_access_check>
+static inline ArtField* FindFieldFromCache(Thread* self, const ShadowFrame& shadow_frame,
+                                           const Instruction* inst, uint32_t field_idx,
+                                           size_t expected_size)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  InterpreterCache* cache = self->GetInterpreterCache();
+  ArtField* f = cache->GetField(inst);
+  if (f == nullptr) {
+    f = FindFieldFromCode<find_type, do_access_check>(field_idx, shadow_frame.GetMethod(), self,
+                                                      expected_size);
+    // Static fields are cached once their class is initialized, so that the accesses found in
+    // the cache need no initialization check.
+    if (f != nullptr && (!f->IsStatic() || f->GetDeclaringClass()->IsInitialized())) {
+      cache->SetField(inst, f);
+    }
+  }
+  return f;
+}
+
 // Handles iget-XXX and sget-XXX instructions.
 // Returns true on success, otherwise throws an exception and returns false.
 template<FindFieldType find_type, Primitive::Type field_type, bool do_access_check>
@@ -178,8 +214,8 @@ static SOMETIMES_INLINE_KEYWORD bool DoFieldGet(Thread* self, ShadowFrame& shado
                                                 const Instruction* inst, uint16_t inst_data) {
   const bool is_static = (find_type == StaticObjectRead) || (find_type == StaticPrimitiveRead);
   const uint32_t field_idx = is_static ? inst->VRegB_21c() : inst->VRegC_22c();
-  ArtField* f = FindFieldFromCode<find_type, do_access_check>(field_idx, shadow_frame.GetMethod(), self,
-                                                              Primitive::FieldSize(field_type));
+  ArtField* f = FindFieldFromCache<find_type, do_access_check>(self, shadow_frame, inst, field_idx,
+                                                               Primitive::FieldSize(field_type));
   if (UNLIKELY(f == nullptr)) {
     CHECK(self->IsExceptionPending());
     return false;
@@ -312,8 +348,8 @@ static SOMETIMES_INLINE_KEYWORD bool DoFieldPut(Thread* self, const ShadowFrame&
   bool do_assignability_check = do_access_check;
   bool is_static = (find_type == StaticObjectWrite) || (find_type == StaticPrimitiveWrite);
   uint32_t field_idx = is_static ? inst->VRegB_21c() : inst->VRegC_22c();
-  ArtField* f = FindFieldFromCode<find_type, do_access_check>(field_idx, shadow_frame.GetMethod(), self,
-                                                              Primitive::FieldSize(field_type));
+  ArtField* f = FindFieldFromCache<find_type, do_access_check>(self, shadow_frame, inst, field_idx,
+                                                               Primitive::FieldSize(field_type));
   if (UNLIKELY(f == nullptr)) {
     CHECK(self->IsExceptionPending());
     return false;
@@ -350,6 +350,9 @@ struct JdwpState {
 
   JdwpEvent* event_list_ GUARDED_BY(event_list_lock_);
   size_t event_list_size_ GUARDED_BY(event_list_lock_);  // Number of elements in event_list_.
+  // Number of elements in event_list_ of each JdwpEventKind, so that FindMatchingEvents can skip
+  // the list walk for kinds nobody asked for.
+  size_t event_kind_counts_[EK_VM_DISCONNECTED + 1] GUARDED_BY(event_list_lock_);
 
   // Used to synchronize suspension of the event thread (to avoid receiving "resume"
   // events before the thread has finished suspending itself).
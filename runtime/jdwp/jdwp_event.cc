@@ -108,10 +108,11 @@ namespace JDWP {
  */
 struct ModBasket {
   ModBasket() : pLoc(NULL), threadId(0), classId(0), excepClassId(0),
-                caught(false), fieldTypeID(0), fieldId(0), thisPtr(0) { }
+                caught(false), fieldTypeID(0), fieldId(0), thisPtr(0),
+                className_valid(false) { }
 
   const JdwpLocation* pLoc;           /* LocationOnly */
-  std::string         className;      /* ClassMatch/ClassExclude */
+  std::string         className;      /* ClassMatch/ClassExclude, see GetBasketClassName */
   ObjectId            threadId;       /* ThreadOnly */
   RefTypeId           classId;        /* ClassOnly */
   RefTypeId           excepClassId;   /* ExceptionOnly */
@@ -120,8 +121,24 @@ struct ModBasket {
   FieldId             fieldId;        /* FieldOnly */
   ObjectId            thisPtr;        /* InstanceOnly */
   /* nothing for StepOnly -- handled differently */
+  bool                className_valid;
 };
 
+/*
+ * Return the name of the basket's class, computing it on first use. Only
+ * ClassMatch/ClassExclude mods need it, and building the dotted name for
+ * every breakpoint, step and method entry/exit event is a large part of
+ * the cost of posting one.
+ */
+static const std::string& GetBasketClassName(ModBasket* basket)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (!basket->className_valid) {
+    basket->className = Dbg::GetClassName(basket->classId);
+    basket->className_valid = true;
+  }
+  return basket->className;
+}
+
 static bool NeedsFullDeoptimization(JdwpEventKind eventKind) {
   switch (eventKind) {
       case EK_METHOD_ENTRY:
@@ -217,6 +234,7 @@ JdwpError JdwpState::RegisterEvent(JdwpEvent* pEvent) {
     }
     event_list_ = pEvent;
     ++event_list_size_;
+    ++event_kind_counts_[pEvent->eventKind];
   }
 
   Dbg::ManageDeoptimization();
@@ -290,6 +308,8 @@ void JdwpState::UnregisterEvent(JdwpEvent* pEvent) {
 
   --event_list_size_;
   CHECK(event_list_size_ != 0 || event_list_ == NULL);
+  CHECK_NE(event_kind_counts_[pEvent->eventKind], 0U);
+  --event_kind_counts_[pEvent->eventKind];
 }
 
 /*
@@ -472,12 +492,12 @@ static bool ModsMatch(JdwpEvent* pEvent, ModBasket* basket)
       }
       break;
     case MK_CLASS_MATCH:
-      if (!PatternMatch(pMod->classMatch.classPattern, basket->className)) {
+      if (!PatternMatch(pMod->classMatch.classPattern, GetBasketClassName(basket))) {
         return false;
       }
       break;
     case MK_CLASS_EXCLUDE:
-      if (PatternMatch(pMod->classMatch.classPattern, basket->className)) {
+      if (PatternMatch(pMod->classMatch.classPattern, GetBasketClassName(basket))) {
         return false;
       }
       break;
@@ -532,6 +552,10 @@ static bool ModsMatch(JdwpEvent* pEvent, ModBasket* basket)
  */
 void JdwpState::FindMatchingEvents(JdwpEventKind eventKind, ModBasket* basket,
                                    JdwpEvent** match_list, int* pMatchCount) {
+  if (event_kind_counts_[eventKind] == 0) {
+    return;
+  }
+
   /* start after the existing entries */
   match_list += *pMatchCount;
 
@@ -802,7 +826,6 @@ bool JdwpState::PostLocationEvent(const JdwpLocation* pLoc, ObjectId thisPtr, in
   basket.classId = pLoc->class_id;
   basket.thisPtr = thisPtr;
   basket.threadId = Dbg::GetThreadSelfId();
-  basket.className = Dbg::GetClassName(pLoc->class_id);
 
   /*
    * On rare occasions we may need to execute interpreted code in the VM
@@ -825,7 +848,7 @@ bool JdwpState::PostLocationEvent(const JdwpLocation* pLoc, ObjectId thisPtr, in
    * method invocation to complete.
    */
   if (InvokeInProgress()) {
-    VLOG(jdwp) << "Not checking breakpoints during invoke (" << basket.className << ")";
+    VLOG(jdwp) << "Not checking breakpoints during invoke (" << GetBasketClassName(&basket) << ")";
     return false;
   }
 
@@ -850,7 +873,7 @@ bool JdwpState::PostLocationEvent(const JdwpLocation* pLoc, ObjectId thisPtr, in
     }
     if (match_count != 0) {
       VLOG(jdwp) << "EVENT: " << match_list[0]->eventKind << "(" << match_count << " total) "
-                 << basket.className << "." << Dbg::GetMethodName(pLoc->method_id)
+                 << GetBasketClassName(&basket) << "." << Dbg::GetMethodName(pLoc->method_id)
                  << StringPrintf(" thread=%#" PRIx64 "  dex_pc=%#" PRIx64 ")",
                                  basket.threadId, pLoc->dex_pc);
 
@@ -888,7 +911,6 @@ bool JdwpState::PostFieldEvent(const JdwpLocation* pLoc, RefTypeId typeId, Field
   basket.classId = pLoc->class_id;
   basket.thisPtr = thisPtr;
   basket.threadId = Dbg::GetThreadSelfId();
-  basket.className = Dbg::GetClassName(pLoc->class_id);
   basket.fieldTypeID = typeId;
   basket.fieldId = fieldId;
 
@@ -926,7 +948,7 @@ bool JdwpState::PostFieldEvent(const JdwpLocation* pLoc, RefTypeId typeId, Field
     }
     if (match_count != 0) {
       VLOG(jdwp) << "EVENT: " << match_list[0]->eventKind << "(" << match_count << " total) "
-                 << basket.className << "." << Dbg::GetMethodName(pLoc->method_id)
+                 << GetBasketClassName(&basket) << "." << Dbg::GetMethodName(pLoc->method_id)
                  << StringPrintf(" thread=%#" PRIx64 "  dex_pc=%#" PRIx64 ")",
                                  basket.threadId, pLoc->dex_pc);
 
@@ -1061,14 +1083,13 @@ bool JdwpState::PostException(const JdwpLocation* pThrowLoc,
   basket.pLoc = pThrowLoc;
   basket.classId = pThrowLoc->class_id;
   basket.threadId = Dbg::GetThreadSelfId();
-  basket.className = Dbg::GetClassName(basket.classId);
   basket.excepClassId = exceptionClassId;
   basket.caught = (pCatchLoc->class_id != 0);
   basket.thisPtr = thisPtr;
 
   /* don't try to post an exception caused by the debugger */
   if (InvokeInProgress()) {
-    VLOG(jdwp) << "Not posting exception hit during invoke (" << basket.className << ")";
+    VLOG(jdwp) << "Not posting exception hit during invoke (" << GetBasketClassName(&basket) << ")";
     return false;
   }
 
@@ -1132,11 +1153,10 @@ bool JdwpState::PostClassPrepare(JdwpTypeTag tag, RefTypeId refTypeId, const std
 
   basket.classId = refTypeId;
   basket.threadId = Dbg::GetThreadSelfId();
-  basket.className = Dbg::GetClassName(basket.classId);
 
   /* suppress class prep caused by debugger */
   if (InvokeInProgress()) {
-    VLOG(jdwp) << "Not posting class prep caused by invoke (" << basket.className << ")";
+    VLOG(jdwp) << "Not posting class prep caused by invoke (" << GetBasketClassName(&basket) << ")";
     return false;
   }
 
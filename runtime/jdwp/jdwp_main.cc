@@ -224,6 +224,7 @@ JdwpState::JdwpState(const JdwpOptions* options)
       ddm_is_active_(false),
       should_exit_(false),
       exit_status_(0) {
+  memset(event_kind_counts_, 0, sizeof(event_kind_counts_));
 }
 
 /*
@@ -16,6 +16,8 @@
 
 #include "object_registry.h"
 
+#include <algorithm>
+
 #include "scoped_thread_state_change.h"
 
 namespace art {
@@ -32,7 +34,78 @@ std::ostream& operator<<(std::ostream& os, const ObjectRegistryEntry& rhs) {
 
 ObjectRegistry::ObjectRegistry()
     : lock_("ObjectRegistry lock", kJdwpObjectRegistryLock), allow_new_objects_(true),
-      condition_("object registry condition", lock_), next_id_(1) {
+      condition_("object registry condition", lock_), num_objects_(0), next_id_(1) {
+}
+
+static size_t HashObject(mirror::Object* o) {
+  // Objects are aligned, mix the address so that neighbours don't fill consecutive slots.
+  uint64_t address = reinterpret_cast<uintptr_t>(o) / kObjectAlignment;
+  return static_cast<size_t>((address * UINT64_C(0x9E3779B97F4A7C15)) >> 32);
+}
+
+size_t ObjectRegistry::FindSlot(mirror::Object* o) const {
+  DCHECK(!object_slots_.empty());
+  const size_t mask = object_slots_.size() - 1;
+  size_t index = HashObject(o) & mask;
+  while (object_slots_[index].object != nullptr && object_slots_[index].object != o) {
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+
+ObjectRegistryEntry* ObjectRegistry::FindEntry(mirror::Object* o) const {
+  if (num_objects_ == 0) {
+    return nullptr;
+  }
+  return object_slots_[FindSlot(o)].entry;
+}
+
+void ObjectRegistry::InsertEntry(mirror::Object* o, ObjectRegistryEntry* entry) {
+  DCHECK(o != nullptr);
+  if ((num_objects_ + 1) * 2 > object_slots_.size()) {
+    Resize(std::max(kMinObjectSlots, object_slots_.size() * 2));
+  }
+  ObjectSlot& slot = object_slots_[FindSlot(o)];
+  DCHECK(slot.object == nullptr) << o;
+  slot.object = o;
+  slot.entry = entry;
+  ++num_objects_;
+}
+
+void ObjectRegistry::RemoveEntry(mirror::Object* o) {
+  if (num_objects_ == 0) {
+    return;
+  }
+  const size_t mask = object_slots_.size() - 1;
+  size_t hole = FindSlot(o);
+  if (object_slots_[hole].object == nullptr) {
+    return;
+  }
+  // Move back the following objects of the run which may no longer be found past the hole.
+  for (size_t index = (hole + 1) & mask; object_slots_[index].object != nullptr;
+       index = (index + 1) & mask) {
+    size_t home = HashObject(object_slots_[index].object) & mask;
+    if (((index - home) & mask) >= ((index - hole) & mask)) {
+      object_slots_[hole] = object_slots_[index];
+      hole = index;
+    }
+  }
+  object_slots_[hole].object = nullptr;
+  object_slots_[hole].entry = nullptr;
+  --num_objects_;
+}
+
+void ObjectRegistry::Resize(size_t capacity) {
+  DCHECK(IsPowerOfTwo(capacity));
+  DCHECK_GE(capacity, num_objects_ * 2);
+  ObjectSlot empty = { nullptr, nullptr };
+  std::vector<ObjectSlot> old_slots(capacity, empty);
+  old_slots.swap(object_slots_);
+  for (const ObjectSlot& slot : old_slots) {
+    if (slot.object != nullptr) {
+      object_slots_[FindSlot(slot.object)] = slot;
+    }
+  }
 }
 
 JDWP::RefTypeId ObjectRegistry::AddRefType(mirror::Class* c) {
@@ -53,11 +126,9 @@ JDWP::ObjectId ObjectRegistry::InternalAdd(mirror::Object* o) {
   while (UNLIKELY(!allow_new_objects_)) {
     condition_.WaitHoldingLocks(soa.Self());
   }
-  ObjectRegistryEntry* entry;
-  auto it = object_to_entry_.find(o);
-  if (it != object_to_entry_.end()) {
+  ObjectRegistryEntry* entry = FindEntry(o);
+  if (entry != nullptr) {
     // This object was already in our map.
-    entry = it->second;
     ++entry->reference_count;
   } else {
     entry = new ObjectRegistryEntry;
@@ -65,7 +136,7 @@ JDWP::ObjectId ObjectRegistry::InternalAdd(mirror::Object* o) {
     entry->jni_reference = nullptr;
     entry->reference_count = 0;
     entry->id = 0;
-    object_to_entry_.insert(std::make_pair(o, entry));
+    InsertEntry(o, entry);
 
     // This object isn't in the registry yet, so add it.
     JNIEnv* env = soa.Env();
@@ -86,25 +157,27 @@ JDWP::ObjectId ObjectRegistry::InternalAdd(mirror::Object* o) {
 
 bool ObjectRegistry::Contains(mirror::Object* o) {
   MutexLock mu(Thread::Current(), lock_);
-  return object_to_entry_.find(o) != object_to_entry_.end();
+  return FindEntry(o) != nullptr;
 }
 
 void ObjectRegistry::Clear() {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  VLOG(jdwp) << "Object registry contained " << object_to_entry_.size() << " entries";
-  // Delete all the JNI references.
+  VLOG(jdwp) << "Object registry contained " << id_to_entry_.size() << " entries";
+  // Delete all the JNI references, including the ones of the collected objects.
   JNIEnv* env = self->GetJniEnv();
-  for (const auto& pair : object_to_entry_) {
-    const ObjectRegistryEntry& entry = *pair.second;
-    if (entry.jni_reference_type == JNIWeakGlobalRefType) {
-      env->DeleteWeakGlobalRef(entry.jni_reference);
+  for (const auto& pair : id_to_entry_) {
+    ObjectRegistryEntry* entry = pair.second;
+    if (entry->jni_reference_type == JNIWeakGlobalRefType) {
+      env->DeleteWeakGlobalRef(entry->jni_reference);
     } else {
-      env->DeleteGlobalRef(entry.jni_reference);
+      env->DeleteGlobalRef(entry->jni_reference);
     }
+    delete entry;
   }
   // Clear the maps.
-  object_to_entry_.clear();
+  object_slots_.clear();
+  num_objects_ = 0;
   id_to_entry_.clear();
 }
 
@@ -200,7 +273,9 @@ void ObjectRegistry::DisposeObject(JDWP::ObjectId id, uint32_t reference_count)
     } else {
       env->DeleteGlobalRef(entry->jni_reference);
     }
-    object_to_entry_.erase(object);
+    if (object != nullptr) {
+      RemoveEntry(object);
+    }
     id_to_entry_.erase(id);
     delete entry;
   }
@@ -208,20 +283,26 @@ void ObjectRegistry::DisposeObject(JDWP::ObjectId id, uint32_t reference_count)
 
 void ObjectRegistry::UpdateObjectPointers(IsMarkedCallback* callback, void* arg) {
   MutexLock mu(Thread::Current(), lock_);
-  if (object_to_entry_.empty()) {
+  if (num_objects_ == 0) {
     return;
   }
-  std::map<mirror::Object*, ObjectRegistryEntry*> new_object_to_entry;
-  for (auto& pair : object_to_entry_) {
-    mirror::Object* new_obj;
-    if (pair.first != nullptr) {
-      new_obj = callback(pair.first, arg);
+  // Every object may move, so the table is rebuilt rather than updated slot by slot.
+  ObjectSlot empty = { nullptr, nullptr };
+  std::vector<ObjectSlot> old_slots(object_slots_.size(), empty);
+  old_slots.swap(object_slots_);
+  num_objects_ = 0;
+  for (const ObjectSlot& slot : old_slots) {
+    if (slot.object != nullptr) {
+      mirror::Object* new_obj = callback(slot.object, arg);
       if (new_obj != nullptr) {
-        new_object_to_entry.insert(std::make_pair(new_obj, pair.second));
+        ObjectSlot& new_slot = object_slots_[FindSlot(new_obj)];
+        DCHECK(new_slot.object == nullptr) << new_obj;
+        new_slot.object = new_obj;
+        new_slot.entry = slot.entry;
+        ++num_objects_;
       }
     }
   }
-  object_to_entry_ = new_object_to_entry;
 }
 
 void ObjectRegistry::AllowNewObjects() {
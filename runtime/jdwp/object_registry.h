@@ -19,7 +19,7 @@
 
 #include <stdint.h>
 
-#include <map>
+#include <vector>
 
 #include "jdwp/jdwp.h"
 #include "mirror/art_field-inl.h"
@@ -99,11 +99,32 @@ class ObjectRegistry {
   void Demote(ObjectRegistryEntry& entry) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, lock_);
   void Promote(ObjectRegistryEntry& entry) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, lock_);
 
+  // The entry of an object, or null if it isn't registered.
+  ObjectRegistryEntry* FindEntry(mirror::Object* o) const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Adds an object which isn't registered yet.
+  void InsertEntry(mirror::Object* o, ObjectRegistryEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void RemoveEntry(mirror::Object* o) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // The slot holding the object, or the empty slot where it would be inserted.
+  size_t FindSlot(mirror::Object* o) const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void Resize(size_t capacity) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  static constexpr size_t kMinObjectSlots = 64;
+
+  struct ObjectSlot {
+    // Null if the slot is empty.
+    mirror::Object* object;
+    ObjectRegistryEntry* entry;
+  };
+
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   bool allow_new_objects_ GUARDED_BY(lock_);
   ConditionVariable condition_ GUARDED_BY(lock_);
 
-  std::map<mirror::Object*, ObjectRegistryEntry*> object_to_entry_ GUARDED_BY(lock_);
+  // The objects are found by address in an open addressing table with linear probing, which is at
+  // most half full. Removals shift the following slots back so there are no tombstones, and the GC
+  // moves the objects by rebuilding the table in one pass over the slots.
+  std::vector<ObjectSlot> object_slots_ GUARDED_BY(lock_);
+  size_t num_objects_ GUARDED_BY(lock_);
   SafeMap<JDWP::ObjectId, ObjectRegistryEntry*> id_to_entry_ GUARDED_BY(lock_);
 
   size_t next_id_ GUARDED_BY(lock_);
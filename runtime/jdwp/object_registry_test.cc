@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "object_registry.h"
+
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/string.h"
+#include "scoped_thread_state_change.h"
+
+namespace art {
+
+class ObjectRegistryTest : public CommonRuntimeTest {};
+
+// Moves the even indexed strings to the next odd one and drops the others.
+static mirror::Object* MoveEvenCallback(mirror::Object* obj, void* arg) {
+  mirror::ObjectArray<mirror::Object>* objects =
+      reinterpret_cast<mirror::ObjectArray<mirror::Object>*>(arg);
+  for (int32_t i = 0; i < objects->GetLength(); i += 2) {
+    if (objects->Get(i) == obj) {
+      return objects->Get(i + 1);
+    }
+  }
+  return nullptr;
+}
+
+TEST_F(ObjectRegistryTest, AddAndDispose) {
+  ScopedObjectAccess soa(Thread::Current());
+  static constexpr int32_t kNumObjects = 1000;
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::ObjectArray<mirror::Object>> objects(
+      hs.NewHandle(class_linker_->AllocObjectArray<mirror::Object>(soa.Self(), kNumObjects)));
+  ASSERT_TRUE(objects.Get() != nullptr);
+  for (int32_t i = 0; i < kNumObjects; ++i) {
+    mirror::String* s = mirror::String::AllocFromModifiedUtf8(soa.Self(), "object");
+    ASSERT_TRUE(s != nullptr);
+    objects->Set<false>(i, s);
+  }
+
+  ObjectRegistry registry;
+  EXPECT_EQ(0U, registry.Add(nullptr));
+  std::vector<JDWP::ObjectId> ids;
+  for (int32_t i = 0; i < kNumObjects; ++i) {
+    ids.push_back(registry.Add(objects->Get(i)));
+  }
+  for (int32_t i = 0; i < kNumObjects; ++i) {
+    // Adding an object again gives the same id.
+    EXPECT_EQ(ids[i], registry.Add(objects->Get(i)));
+    EXPECT_TRUE(registry.Contains(objects->Get(i)));
+    EXPECT_EQ(objects->Get(i), registry.Get<mirror::Object*>(ids[i]));
+  }
+
+  // The odd objects were added twice, dispose of both references, only one for the even ones.
+  for (int32_t i = 0; i < kNumObjects; ++i) {
+    registry.DisposeObject(ids[i], (i % 2 == 0) ? 1 : 2);
+  }
+  for (int32_t i = 0; i < kNumObjects; ++i) {
+    EXPECT_EQ(i % 2 == 0, registry.Contains(objects->Get(i))) << i;
+  }
+  EXPECT_EQ(ObjectRegistry::kInvalidObject, registry.Get<mirror::Object*>(ids[1]));
+
+  // After the even objects moved to the odd addresses, they are found at their new address.
+  registry.UpdateObjectPointers(MoveEvenCallback, objects.Get());
+  for (int32_t i = 0; i < kNumObjects; ++i) {
+    EXPECT_EQ(i % 2 == 1, registry.Contains(objects->Get(i))) << i;
+  }
+  registry.Clear();
+  EXPECT_FALSE(registry.Contains(objects->Get(1)));
+  EXPECT_EQ(ObjectRegistry::kInvalidObject, registry.Get<mirror::Object*>(ids[0]));
+}
+
+}  // namespace art
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jit.h"
+
+#include <dlfcn.h>
+
+#include "debugger.h"
+#include "entrypoints/entrypoint_utils.h"
+#include "handle_scope-inl.h"
+#include "interpreter/interpreter.h"
+#include "jit_code_cache.h"
+#include "jni_internal.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+namespace art {
+namespace jit {
+
+// Compiles a method queued by AddHotMethods. The method is held through a weak global so that
+// it may be moved or unloaded while it waits in the queue.
+class JitCompileTask : public Task {
+ public:
+  JitCompileTask(Jit* jit, jweak method) : jit_(jit), method_(method) {}
+
+  virtual void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    JavaVMExt* vm = soa.Vm();
+    mirror::Object* method = vm->DecodeWeakGlobal(self, method_);
+    if (method != nullptr) {
+      jit_->CompileMethod(self, down_cast<mirror::ArtMethod*>(method));
+    }
+    vm->DeleteWeakGlobalRef(self, method_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  Jit* const jit_;
+  const jweak method_;
+
+  DISALLOW_COPY_AND_ASSIGN(JitCompileTask);
+};
+
+Jit::Jit(size_t compile_threshold)
+    : compile_threshold_(compile_threshold), jit_library_handle_(nullptr),
+      jit_compiler_handle_(nullptr), jit_load_(nullptr), jit_unload_(nullptr),
+      jit_compile_method_(nullptr), lock_("JIT lock"), num_compiled_(0), num_failed_(0) {
+}
+
+Jit* Jit::Create(size_t code_cache_capacity, size_t compile_threshold, std::string* error_msg) {
+  std::unique_ptr<Jit> jit(new Jit(compile_threshold));
+  jit->code_cache_.reset(JitCodeCache::Create(code_cache_capacity, error_msg));
+  if (jit->code_cache_.get() == nullptr) {
+    return nullptr;
+  }
+  if (!jit->LoadCompiler(error_msg)) {
+    return nullptr;
+  }
+  jit->thread_pool_.reset(new ThreadPool("Jit thread pool", 1));
+  jit->thread_pool_->StartWorkers(Thread::Current());
+  VLOG(jit) << "JIT created with code cache of " << PrettySize(jit->code_cache_->Capacity())
+            << " and compile threshold of " << compile_threshold << " samples";
+  return jit.release();
+}
+
+bool Jit::LoadCompiler(std::string* error_msg) {
+  const char* library_name = kIsDebugBuild ? "libartd-compiler.so" : "libart-compiler.so";
+  jit_library_handle_ = dlopen(library_name, RTLD_NOW);
+  if (jit_library_handle_ == nullptr) {
+    *error_msg = StringPrintf("Failed to load %s: %s", library_name, dlerror());
+    return false;
+  }
+  jit_load_ = reinterpret_cast<void* (*)()>(dlsym(jit_library_handle_, "jit_load"));
+  jit_unload_ = reinterpret_cast<void (*)(void*)>(dlsym(jit_library_handle_, "jit_unload"));
+  jit_compile_method_ = reinterpret_cast<bool (*)(void*, mirror::ArtMethod*, Thread*)>(
+      dlsym(jit_library_handle_, "jit_compile_method"));
+  if (jit_load_ == nullptr || jit_unload_ == nullptr || jit_compile_method_ == nullptr) {
+    *error_msg = StringPrintf("Missing JIT entry points in %s", library_name);
+    dlclose(jit_library_handle_);
+    jit_library_handle_ = nullptr;
+    return false;
+  }
+  jit_compiler_handle_ = jit_load_();
+  if (jit_compiler_handle_ == nullptr) {
+    *error_msg = "Failed to create the JIT compiler";
+    return false;
+  }
+  return true;
+}
+
+Jit::~Jit() {
+  DeleteThreadPool();
+  if (jit_compiler_handle_ != nullptr) {
+    jit_unload_(jit_compiler_handle_);
+  }
+  if (jit_library_handle_ != nullptr) {
+    dlclose(jit_library_handle_);
+  }
+}
+
+void Jit::DeleteThreadPool() {
+  // Waits for the compilation in progress.
+  thread_pool_.reset();
+}
+
+void Jit::AddHotMethods(Thread* self, const std::vector<mirror::ArtMethod*>& methods) {
+  if (thread_pool_.get() == nullptr) {
+    return;
+  }
+  JavaVMExt* vm = self->GetJniEnv()->vm;
+  for (mirror::ArtMethod* method : methods) {
+    if (method->IsNative() || method->IsAbstract() || method->IsProxyMethod() ||
+        code_cache_->ContainsMethod(method)) {
+      continue;
+    }
+    MethodHelper mh(method);
+    MethodReference ref(&mh.GetDexFile(), method->GetDexMethodIndex());
+    {
+      MutexLock mu(self, lock_);
+      if (!queued_methods_.insert(ref).second) {
+        continue;
+      }
+    }
+    jweak weak_method = vm->AddWeakGlobalReference(self, method);
+    thread_pool_->AddTask(self, new JitCompileTask(this, weak_method));
+  }
+}
+
+bool Jit::CompileMethod(Thread* self, mirror::ArtMethod* method) {
+  Runtime* runtime = Runtime::Current();
+  instrumentation::Instrumentation* instrumentation = runtime->GetInstrumentation();
+  // Only the methods running from the interpreter are compiled, code installed by the
+  // instrumentation or the debugger must not be replaced.
+  if (instrumentation->InterpretOnly() || instrumentation->AreExitStubsInstalled() ||
+      Dbg::IsDebuggerActive() ||
+      method->GetEntryPointFromQuickCompiledCode() != GetQuickToInterpreterBridge()) {
+    return false;
+  }
+  const uint64_t start_ns = NanoTime();
+  // The compiler suspends, the method may move in the meantime.
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ArtMethod> h_method(hs.NewHandle(method));
+  bool success = jit_compile_method_(jit_compiler_handle_, method, self);
+  method = h_method.Get();
+  const void* code = nullptr;
+  if (success) {
+    MethodHelper mh(method);
+    code = code_cache_->GetCodeFor(self, MethodReference(&mh.GetDexFile(),
+                                                         method->GetDexMethodIndex()));
+    success = code != nullptr &&
+        method->GetEntryPointFromQuickCompiledCode() == GetQuickToInterpreterBridge();
+  }
+  if (success) {
+    // The native gc map was set by the compiler, the interpreter bridge stays valid until the
+    // entry points are switched.
+    method->SetEntryPointFromPortableCompiledCode(GetPortableToQuickBridge());
+    method->SetEntryPointFromInterpreter(artInterpreterToCompiledCodeBridge);
+    method->SetEntryPointFromQuickCompiledCode(code);
+  }
+  MutexLock mu(self, lock_);
+  if (success) {
+    ++num_compiled_;
+    VLOG(compiler) << "JIT compiled " << PrettyMethod(method) << " in "
+                   << PrettyDuration(NanoTime() - start_ns) << " at " << code;
+  } else {
+    ++num_failed_;
+  }
+  return success;
+}
+
+void Jit::DumpInfo(std::ostream& os) {
+  Thread* self = Thread::Current();
+  size_t num_compiled;
+  size_t num_failed;
+  {
+    MutexLock mu(self, lock_);
+    num_compiled = num_compiled_;
+    num_failed = num_failed_;
+  }
+  os << "JIT compiled methods: " << num_compiled << " (" << num_failed << " not compiled)\n"
+     << "JIT code cache size: " << PrettySize(code_cache_->Size(self)) << "/"
+     << PrettySize(code_cache_->Capacity()) << "\n";
+}
+
+}  // namespace jit
+}  // namespace art
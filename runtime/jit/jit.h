@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_JIT_H_
+#define ART_RUNTIME_JIT_JIT_H_
+
+#include <iosfwd>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "method_reference.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+}  // namespace mirror
+
+class Thread;
+class ThreadPool;
+
+namespace jit {
+
+class JitCodeCache;
+
+// Compiles the methods found hot by the BackgroundMethodSamplingProfiler so that applications
+// running from the interpreter, because their oat file is missing or out of date, get compiled
+// code without being reinstalled.
+//
+// The compiler lives in libart-compiler, which is loaded on demand. The methods are compiled one
+// at a time on a background thread with the Quick backend, their code is copied into the
+// JitCodeCache and installed as their quick entry point.
+class Jit {
+ public:
+  // Number of samples of a profile run after which a method is compiled.
+  static constexpr size_t kDefaultCompileThreshold = 10;
+
+  // Loads the compiler and maps the code cache, returns null and sets error_msg on failure.
+  static Jit* Create(size_t code_cache_capacity, size_t compile_threshold, std::string* error_msg);
+
+  ~Jit();
+
+  // Queues the methods for compilation, the ones which were already queued are skipped.
+  void AddHotMethods(Thread* self, const std::vector<mirror::ArtMethod*>& methods)
+      LOCKS_EXCLUDED(lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Compiles the method and installs its code, returns false if the method wasn't compiled.
+  bool CompileMethod(Thread* self, mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Stops the compilation thread, called before the runtime shuts down. The compilations still
+  // queued are dropped.
+  void DeleteThreadPool();
+
+  size_t GetCompileThreshold() const {
+    return compile_threshold_;
+  }
+
+  JitCodeCache* GetCodeCache() {
+    return code_cache_.get();
+  }
+
+  void DumpInfo(std::ostream& os) LOCKS_EXCLUDED(lock_);
+
+ private:
+  explicit Jit(size_t compile_threshold);
+
+  bool LoadCompiler(std::string* error_msg);
+
+  const size_t compile_threshold_;
+
+  // The compiler library and its entry points.
+  void* jit_library_handle_;
+  void* jit_compiler_handle_;
+  void* (*jit_load_)();
+  void (*jit_unload_)(void*);
+  bool (*jit_compile_method_)(void*, mirror::ArtMethod*, Thread*);
+
+  std::unique_ptr<JitCodeCache> code_cache_;
+
+  // Runs the compilations in the background.
+  std::unique_ptr<ThreadPool> thread_pool_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+
+  // The methods which were queued, so that a method is compiled at most once whether or not its
+  // compilation succeeds.
+  std::set<MethodReference, MethodReferenceComparator> queued_methods_ GUARDED_BY(lock_);
+
+  size_t num_compiled_ GUARDED_BY(lock_);
+  size_t num_failed_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(Jit);
+};
+
+}  // namespace jit
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_JIT_H_
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jit_code_cache.h"
+
+#include <sys/mman.h>
+
+#include "fault_handler.h"
+#include "mirror/art_method-inl.h"
+#include "utils.h"
+
+namespace art {
+namespace jit {
+
+JitCodeCache* JitCodeCache::Create(size_t capacity, std::string* error_msg) {
+  CHECK_GT(capacity, 0U);
+  CHECK_LE(capacity, kMaxCapacity);
+  std::string error_str;
+  MemMap* mem_map = MemMap::MapAnonymous("jit-code-cache", nullptr, RoundUp(capacity, kPageSize),
+                                         PROT_READ | PROT_WRITE | PROT_EXEC, false, &error_str);
+  if (mem_map == nullptr) {
+    *error_msg = StringPrintf("Failed to create the JIT code cache of %zd bytes: %s", capacity,
+                              error_str.c_str());
+    return nullptr;
+  }
+  return new JitCodeCache(mem_map);
+}
+
+JitCodeCache::JitCodeCache(MemMap* mem_map)
+    : lock_("JIT code cache lock", kJitCodeCacheLock), mem_map_(mem_map),
+      ptr_(mem_map->Begin()) {
+  fault_manager.AddGeneratedCodeRange(mem_map_->Begin(), mem_map_->Size());
+}
+
+JitCodeCache::~JitCodeCache() {
+  fault_manager.RemoveGeneratedCodeRange(mem_map_->Begin());
+}
+
+uint8_t* JitCodeCache::ReserveChunk(Thread* self, size_t size, size_t alignment) {
+  DCHECK(IsPowerOfTwo(alignment));
+  MutexLock mu(self, lock_);
+  uint8_t* result = reinterpret_cast<uint8_t*>(RoundUp(reinterpret_cast<uintptr_t>(ptr_),
+                                                       alignment));
+  if (result + size > mem_map_->End()) {
+    return nullptr;
+  }
+  ptr_ = result + size;
+  // The anonymous mapping is zero filled and chunks are never reused.
+  return result;
+}
+
+void JitCodeCache::SaveCompiledCode(Thread* self, MethodReference ref, const void* code) {
+  DCHECK(ContainsCodePtr(code));
+  MutexLock mu(self, lock_);
+  method_code_map_.Overwrite(ref, code);
+}
+
+const void* JitCodeCache::GetCodeFor(Thread* self, MethodReference ref) {
+  MutexLock mu(self, lock_);
+  auto it = method_code_map_.find(ref);
+  return it != method_code_map_.end() ? it->second : nullptr;
+}
+
+bool JitCodeCache::ContainsMethod(mirror::ArtMethod* method) const {
+  return ContainsCodePtr(method->GetEntryPointFromQuickCompiledCode());
+}
+
+size_t JitCodeCache::Size(Thread* self) {
+  MutexLock mu(self, lock_);
+  return ptr_ - mem_map_->Begin();
+}
+
+size_t JitCodeCache::NumMethods(Thread* self) {
+  MutexLock mu(self, lock_);
+  return method_code_map_.size();
+}
+
+}  // namespace jit
+}  // namespace art
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_JIT_CODE_CACHE_H_
+#define ART_RUNTIME_JIT_JIT_CODE_CACHE_H_
+
+#include <memory>
+#include <string>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "globals.h"
+#include "mem_map.h"
+#include "method_reference.h"
+#include "safe_map.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+}  // namespace mirror
+
+namespace jit {
+
+// The executable memory holding the code compiled by the JIT. Each method gets a single chunk
+// laid out like in an oat file: the gc map, the mapping and vmap tables, the OatQuickMethodHeader
+// and then the code, so that the ArtMethod accessors find the tables from the code pointer.
+//
+// Chunks are bump allocated and never freed, the cache simply stops accepting code once it is
+// full.
+class JitCodeCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 2 * MB;
+  static constexpr size_t kMaxCapacity = 64 * MB;
+
+  // Maps the cache, returns null and sets error_msg on failure.
+  static JitCodeCache* Create(size_t capacity, std::string* error_msg);
+
+  ~JitCodeCache();
+
+  // Returns a zeroed chunk of size bytes aligned to alignment, or null if the cache is full.
+  uint8_t* ReserveChunk(Thread* self, size_t size, size_t alignment) LOCKS_EXCLUDED(lock_);
+
+  // Records the code compiled for the method, once the chunk holding it is filled in.
+  void SaveCompiledCode(Thread* self, MethodReference ref, const void* code)
+      LOCKS_EXCLUDED(lock_);
+
+  // Returns the quick entry point compiled for the method, or null.
+  const void* GetCodeFor(Thread* self, MethodReference ref) LOCKS_EXCLUDED(lock_);
+
+  // Whether the pointer is in the cache, e.g. the entry point of a JIT compiled method.
+  bool ContainsCodePtr(const void* ptr) const {
+    return ptr >= mem_map_->Begin() && ptr < mem_map_->End();
+  }
+
+  bool ContainsMethod(mirror::ArtMethod* method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  size_t Capacity() const {
+    return mem_map_->Size();
+  }
+
+  size_t Size(Thread* self) LOCKS_EXCLUDED(lock_);
+
+  size_t NumMethods(Thread* self) LOCKS_EXCLUDED(lock_);
+
+ private:
+  explicit JitCodeCache(MemMap* mem_map);
+
+  Mutex lock_;
+
+  // The read, write and execute mapping of the chunks.
+  std::unique_ptr<MemMap> mem_map_;
+
+  // Start of the free space.
+  uint8_t* ptr_ GUARDED_BY(lock_);
+
+  // The entry points of the compiled methods.
+  SafeMap<MethodReference, const void*, MethodReferenceComparator> method_code_map_
+      GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(JitCodeCache);
+};
+
+}  // namespace jit
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_JIT_CODE_CACHE_H_
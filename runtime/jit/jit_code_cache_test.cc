@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jit_code_cache.h"
+
+#include "common_runtime_test.h"
+
+namespace art {
+namespace jit {
+
+class JitCodeCacheTest : public CommonRuntimeTest {};
+
+TEST_F(JitCodeCacheTest, ReserveChunk) {
+  Thread* self = Thread::Current();
+  std::string error_msg;
+  std::unique_ptr<JitCodeCache> code_cache(JitCodeCache::Create(kPageSize, &error_msg));
+  ASSERT_TRUE(code_cache.get() != nullptr) << error_msg;
+  EXPECT_EQ(kPageSize, code_cache->Capacity());
+  EXPECT_EQ(0U, code_cache->Size(self));
+
+  uint8_t* first = code_cache->ReserveChunk(self, 3, 1);
+  ASSERT_TRUE(first != nullptr);
+  EXPECT_TRUE(code_cache->ContainsCodePtr(first));
+  uint8_t* second = code_cache->ReserveChunk(self, 16, 16);
+  ASSERT_TRUE(second != nullptr);
+  EXPECT_TRUE(IsAligned<16>(second));
+  EXPECT_GE(second, first + 3);
+  EXPECT_EQ(static_cast<size_t>(second + 16 - first), code_cache->Size(self));
+
+  // The cache doesn't grow.
+  EXPECT_TRUE(code_cache->ReserveChunk(self, kPageSize, 1) == nullptr);
+  EXPECT_FALSE(code_cache->ContainsCodePtr(first + kPageSize));
+}
+
+TEST_F(JitCodeCacheTest, SaveCompiledCode) {
+  Thread* self = Thread::Current();
+  std::string error_msg;
+  std::unique_ptr<JitCodeCache> code_cache(JitCodeCache::Create(kPageSize, &error_msg));
+  ASSERT_TRUE(code_cache.get() != nullptr) << error_msg;
+  const DexFile* dex_file = java_lang_dex_file_;
+  MethodReference ref(dex_file, 1);
+  EXPECT_TRUE(code_cache->GetCodeFor(self, ref) == nullptr);
+
+  uint8_t* code = code_cache->ReserveChunk(self, 8, 4);
+  ASSERT_TRUE(code != nullptr);
+  code_cache->SaveCompiledCode(self, ref, code);
+  EXPECT_EQ(code, code_cache->GetCodeFor(self, ref));
+  EXPECT_TRUE(code_cache->GetCodeFor(self, MethodReference(dex_file, 2)) == nullptr);
+  EXPECT_EQ(1U, code_cache->NumMethods(self));
+}
+
+}  // namespace jit
+}  // namespace art
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_JNI_CALL_CACHE_H_
+#define ART_RUNTIME_JNI_CALL_CACHE_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "globals.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+  class Class;
+}  // namespace mirror
+
+// Per-thread cache of the upcalls of the JNI Call<Type>Method functions and of Method.invoke. It
+// maps the method of a jmethodID or of a reflected method and the class of the receiver to the
+// method the call dispatches to and its shorty, which gives the shape of the arguments. Native
+// loops making the same upcalls over and over skip the vtable or iftable search and the shorty
+// lookup in the dex file. Calls which don't dispatch on the receiver are cached with a null class.
+//
+// Like the InterpreterCache, it is direct mapped, owned by its thread and cleared with it when
+// the GC visits the roots of the thread.
+class JniCallCache {
+ public:
+  // Number of entries, a power of two.
+  static constexpr size_t kSize = 64;
+
+  JniCallCache() {
+    Clear();
+  }
+
+  // Returns the cached target of the call for receivers of the given class and sets its shorty,
+  // or returns null.
+  mirror::ArtMethod* Lookup(mirror::ArtMethod* method, mirror::Class* klass, const char** shorty,
+                            uint32_t* shorty_length) const {
+    const Entry& entry = entries_[IndexOf(method, klass)];
+    if (entry.method != method || entry.klass != klass) {
+      return nullptr;
+    }
+    *shorty = entry.shorty;
+    *shorty_length = entry.shorty_length;
+    return entry.target;
+  }
+
+  void Insert(mirror::ArtMethod* method, mirror::Class* klass, mirror::ArtMethod* target,
+              const char* shorty, uint32_t shorty_length) {
+    Entry& entry = entries_[IndexOf(method, klass)];
+    entry.method = method;
+    entry.klass = klass;
+    entry.target = target;
+    entry.shorty = shorty;
+    entry.shorty_length = shorty_length;
+  }
+
+  void Clear() {
+    for (Entry& entry : entries_) {
+      entry.method = nullptr;
+      entry.klass = nullptr;
+      entry.target = nullptr;
+      entry.shorty = nullptr;
+      entry.shorty_length = 0;
+    }
+  }
+
+ private:
+  struct Entry {
+    mirror::ArtMethod* method;
+    mirror::Class* klass;
+    mirror::ArtMethod* target;
+    // The shorty of the target, in its dex file.
+    const char* shorty;
+    uint32_t shorty_length;
+  };
+
+  static size_t IndexOf(mirror::ArtMethod* method, mirror::Class* klass) {
+    // Objects are kObjectAlignment aligned.
+    uintptr_t method_bits = reinterpret_cast<uintptr_t>(method) / kObjectAlignment;
+    uintptr_t class_bits = reinterpret_cast<uintptr_t>(klass) / kObjectAlignment;
+    return (method_bits ^ (class_bits * 31)) & (kSize - 1);
+  }
+
+  Entry entries_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(JniCallCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_JNI_CALL_CACHE_H_
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni_call_cache.h"
+
+#include <memory>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+// The cache only compares the pointers, fake addresses with the right alignments are enough.
+static mirror::ArtMethod* const kMethod = reinterpret_cast<mirror::ArtMethod*>(0x60000000);
+static mirror::Class* const kClass = reinterpret_cast<mirror::Class*>(0x70000008);
+
+// The shorty of the target comes back with it.
+TEST(JniCallCache, Shorty) {
+  std::unique_ptr<JniCallCache> cache(new JniCallCache);
+  mirror::ArtMethod* target = reinterpret_cast<mirror::ArtMethod*>(0x60000100);
+  const char* shorty = "VIL";
+  cache->Insert(kMethod, kClass, target, shorty, 3);
+  const char* found_shorty = nullptr;
+  uint32_t found_shorty_length = 0;
+  EXPECT_EQ(target, cache->Lookup(kMethod, kClass, &found_shorty, &found_shorty_length));
+  EXPECT_EQ(shorty, found_shorty);
+  EXPECT_EQ(3U, found_shorty_length);
+}
+
+// Calls which don't dispatch are cached with a null class, apart from the virtual calls of the
+// same method.
+TEST(JniCallCache, NonVirtualCall) {
+  std::unique_ptr<JniCallCache> cache(new JniCallCache);
+  const char* found_shorty = nullptr;
+  uint32_t found_shorty_length = 0;
+  cache->Insert(kMethod, nullptr, kMethod, "J", 1);
+  EXPECT_EQ(kMethod, cache->Lookup(kMethod, nullptr, &found_shorty, &found_shorty_length));
+  EXPECT_STREQ("J", found_shorty);
+  EXPECT_TRUE(cache->Lookup(kMethod, kClass, &found_shorty, &found_shorty_length) == nullptr);
+}
+
+}  // namespace art
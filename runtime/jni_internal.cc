@@ -62,6 +62,7 @@ static const size_t kLocalsMax = 512;  // Arbitrary sanity check.
 
 static const size_t kPinTableInitial = 16;  // Arbitrary.
 static const size_t kPinTableMax = 1024;  // Arbitrary sanity check.
+static const size_t kPinnedArraysInitial = 4;  // Arbitrary.
 
 static size_t gGlobalsInitial = 512;  // Arbitrary.
 static size_t gGlobalsMax = 51200;  // Arbitrary sanity check. (Must fit in 16 bits.)
@@ -226,8 +227,14 @@ static jfieldID FindFieldID(const ScopedObjectAccess& soa, jclass jni_class, con
   return soa.EncodeField(field);
 }
 
+// An array which can't move only needs to be kept alive, which the thread's own table does without
+// a lock. Codecs which pin many small buffers from many threads don't contend on pins_lock.
 static void PinPrimitiveArray(const ScopedObjectAccess& soa, mirror::Array* array)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (!Runtime::Current()->GetHeap()->IsMovableObject(array)) {
+    soa.Env()->pinned_arrays.Add(array);
+    return;
+  }
   JavaVMExt* vm = soa.Vm();
   MutexLock mu(soa.Self(), vm->pins_lock);
   vm->pin_table.Add(array);
@@ -235,6 +242,10 @@ static void PinPrimitiveArray(const ScopedObjectAccess& soa, mirror::Array* arra
 
 static void UnpinPrimitiveArray(const ScopedObjectAccess& soa, mirror::Array* array)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  // An array pinned by another thread stays in that thread's table until the thread detaches.
+  if (soa.Env()->pinned_arrays.Remove(array)) {
+    return;
+  }
   JavaVMExt* vm = soa.Vm();
   MutexLock mu(soa.Self(), vm->pins_lock);
   vm->pin_table.Remove(array);
@@ -2901,7 +2912,8 @@ JNIEnvExt::JNIEnvExt(Thread* self, JavaVMExt* vm)
       locals(kLocalsInitial, kLocalsMax, kLocal),
       check_jni(false),
       critical(0),
-      monitors("monitors", kMonitorsInitial, kMonitorsMax) {
+      monitors("monitors", kMonitorsInitial, kMonitorsMax),
+      pinned_arrays("pinned arrays", kPinnedArraysInitial, kPinTableMax) {
   functions = unchecked_functions = &gJniNativeInterface;
   if (vm->check_jni) {
     SetCheckJniEnabled(true);
@@ -2915,7 +2927,7 @@ jobject JNIEnvExt::NewLocalRef(mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks:
   if (obj == nullptr) {
     return nullptr;
   }
-  return reinterpret_cast<jobject>(locals.Add(local_ref_cookie, obj));
+  return reinterpret_cast<jobject>(locals.AddLocal(local_ref_cookie, obj, check_jni));
 }
 
 void JNIEnvExt::DeleteLocalRef(jobject obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -22,6 +22,7 @@
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "indirect_reference_table.h"
+#include "jni_call_cache.h"
 #include "object_callbacks.h"
 #include "reference_table.h"
 #include "runtime.h"
@@ -189,6 +190,12 @@ struct JNIEnvExt : public JNIEnv {
   // Entered JNI monitors, for bulk exit on thread detach.
   ReferenceTable monitors;
 
+  // Arrays in non-moving spaces pinned by this thread, which don't need the VM's pin table lock.
+  ReferenceTable pinned_arrays;
+
+  // Targets and shorties of the recent calls into managed code.
+  JniCallCache call_cache;
+
   // Used by -Xcheck:jni.
   const JNINativeInterface* unchecked_functions;
 };
@@ -218,7 +225,7 @@ class ScopedJniEnvLocalRefState {
 
 template<typename T>
 inline T JNIEnvExt::AddLocalReference(mirror::Object* obj) {
-  IndirectRef ref = locals.Add(local_ref_cookie, obj);
+  IndirectRef ref = locals.AddLocal(local_ref_cookie, obj, check_jni);
 
   // TODO: fix this to understand PushLocalFrame, so we can turn it on.
   if (false) {
@@ -50,6 +50,22 @@ static inline uint32_t DecodeUnsignedLeb128(const uint8_t** data) {
   return static_cast<uint32_t>(result);
 }
 
+// Reads an unsigned LEB128 value like DecodeUnsignedLeb128, for data that may be malformed.
+// Returns false, leaving the pointer as it is, if the value runs past end.
+static inline bool DecodeUnsignedLeb128Checked(const uint8_t** data, const uint8_t* end,
+                                               uint32_t* value) {
+  // A ULEB128 value has at most 5 bytes, the last one without the continuation bit.
+  const uint8_t* pos = *data;
+  while (pos != end && pos - *data < 5 && (*pos & 0x80) != 0) {
+    ++pos;
+  }
+  if (pos == end || pos - *data == 5) {
+    return false;
+  }
+  *value = DecodeUnsignedLeb128(data);
+  return true;
+}
+
 // Reads an unsigned LEB128 + 1 value. updating the given pointer to point
 // just past the end of the read value. This function tolerates
 // non-zero high-order bits in the fifth encoded byte.
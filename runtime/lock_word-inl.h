@@ -23,12 +23,12 @@
 namespace art {
 
 inline uint32_t LockWord::ThinLockOwner() const {
-  DCHECK_EQ(GetState(), kThinLocked);
+  DCHECK(GetState() == kThinLocked || GetState() == kBiasLocked) << GetState();
   return (value_ >> kThinLockOwnerShift) & kThinLockOwnerMask;
 }
 
 inline uint32_t LockWord::ThinLockCount() const {
-  DCHECK_EQ(GetState(), kThinLocked);
+  DCHECK(GetState() == kThinLocked || GetState() == kBiasLocked) << GetState();
   return (value_ >> kThinLockCountShift) & kThinLockCountMask;
 }
 
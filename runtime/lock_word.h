@@ -34,9 +34,17 @@ class Monitor;
  * the state. The three possible states are fat locked, thin/unlocked, and hash code.
  * When the lock word is in the "thin" state and its bits are formatted as follows:
  *
- *  |33|22222222221111|1111110000000000|
- *  |10|98765432109876|5432109876543210|
- *  |00| lock count   |thread id owner |
+ *  |33|2|2222222221111|1111110000000000|
+ *  |10|9|8765432109876|5432109876543210|
+ *  |00|0| lock count  |thread id owner |
+ *
+ * When the lock word is in the "biased" state, the owner is the thread the lock is biased towards
+ * and the count is the number of times it holds the lock, zero when the lock isn't held. Only the
+ * owner changes the lock word of a biased lock, other threads suspend it to revoke the bias:
+ *
+ *  |33|2|2222222221111|1111110000000000|
+ *  |10|9|8765432109876|5432109876543210|
+ *  |00|1| hold count  |thread id owner |
  *
  * When the lock word is in the "fat" state and its bits are formatted as follows:
  *
@@ -57,19 +65,23 @@ class LockWord {
     kStateSize = 2,
     // Number of bits to encode the thin lock owner.
     kThinLockOwnerSize = 16,
+    // Number of bits to encode whether a thin lock is biased.
+    kThinLockBiasedSize = 1,
     // Remaining bits are the recursive lock count.
-    kThinLockCountSize = 32 - kThinLockOwnerSize - kStateSize,
+    kThinLockCountSize = 32 - kThinLockOwnerSize - kThinLockBiasedSize - kStateSize,
     // Thin lock bits. Owner in lowest bits.
 
     kThinLockOwnerShift = 0,
     kThinLockOwnerMask = (1 << kThinLockOwnerSize) - 1,
     // Count in higher bits.
     kThinLockCountShift = kThinLockOwnerSize + kThinLockOwnerShift,
-    kThinLockCountMask = (1 << kThinLockCountShift) - 1,
+    kThinLockCountMask = (1 << kThinLockCountSize) - 1,
     kThinLockMaxCount = kThinLockCountMask,
+    // Biased bit above the count.
+    kThinLockBiasedShift = kThinLockCountSize + kThinLockCountShift,
 
     // State in the highest bits.
-    kStateShift = kThinLockCountSize + kThinLockCountShift,
+    kStateShift = kThinLockBiasedSize + kThinLockBiasedShift,
     kStateMask = (1 << kStateSize) - 1,
     kStateThinOrUnlocked = 0,
     kStateFat = 1,
@@ -88,6 +100,12 @@ class LockWord {
                      (kStateThinOrUnlocked << kStateShift));
   }
 
+  static LockWord FromBiasedLockId(uint32_t thread_id, uint32_t count) {
+    CHECK_LE(thread_id, static_cast<uint32_t>(kThinLockOwnerMask));
+    return LockWord((thread_id << kThinLockOwnerShift) | (count << kThinLockCountShift) |
+                    (1 << kThinLockBiasedShift) | (kStateThinOrUnlocked << kStateShift));
+  }
+
   static LockWord FromForwardingAddress(size_t target) {
     DCHECK(IsAligned < 1 << kStateSize>(target));
     return LockWord((target >> kStateSize) | (kStateForwardingAddress << kStateShift));
@@ -101,6 +119,7 @@ class LockWord {
   enum LockState {
     kUnlocked,    // No lock owners.
     kThinLocked,  // Single uncontended owner.
+    kBiasLocked,  // Single owner locking without atomic operations.
     kFatLocked,   // See associated monitor.
     kHashCode,    // Lock word contains an identity hash.
     kForwardingAddress,  // Lock word contains the forwarding address of an object.
@@ -113,7 +132,7 @@ class LockWord {
       uint32_t internal_state = (value_ >> kStateShift) & kStateMask;
       switch (internal_state) {
         case kStateThinOrUnlocked:
-          return kThinLocked;
+          return ((value_ >> kThinLockBiasedShift) & 1) != 0 ? kBiasLocked : kThinLocked;
         case kStateHash:
           return kHashCode;
         case kStateForwardingAddress:
@@ -125,10 +144,11 @@ class LockWord {
     }
   }
 
-  // Return the owner thin lock thread id.
+  // Return the owner thin lock thread id, or the thread a biased lock is biased towards.
   uint32_t ThinLockOwner() const;
 
-  // Return the number of times a lock value has been locked.
+  // Return the number of times a lock value has been locked. For a thin lock this is the number
+  // of recursive acquisitions, for a biased lock the number of times the owner holds it.
   uint32_t ThinLockCount() const;
 
   // Return the Monitor encoded in a fat lock.
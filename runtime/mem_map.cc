@@ -19,7 +19,14 @@
 
 #include <inttypes.h>
 #include <backtrace/BacktraceMap.h>
+#include <algorithm>
 #include <memory>
+#include <sstream>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 // See CreateStartPos below.
 #ifdef __BIONIC__
@@ -36,6 +43,15 @@
 #include <cutils/ashmem.h>
 #endif
 
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+
+// From linux/mempolicy.h, which the C libraries don't all provide.
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
 namespace art {
 
 static std::ostream& operator<<(
@@ -64,8 +80,10 @@ std::ostream& operator<<(std::ostream& os, const std::multimap<void*, MemMap*>&
 }
 
 std::multimap<void*, MemMap*> MemMap::maps_;
+bool MemMap::use_huge_pages_ = false;
+bool MemMap::use_numa_interleave_ = false;
 
-#if defined(__LP64__) && !defined(__x86_64__)
+#if USE_ART_LOW_4G_ALLOCATOR
 // Handling mem_map in 32b address range for 64b architectures that do not support MAP_32BIT.
 
 // The regular start of memory allocations. The first 64KB is protected by SELinux.
@@ -199,13 +217,13 @@ MemMap* MemMap::MapAnonymous(const char* name, byte* expected, size_t byte_count
   int saved_errno = 0;
 
 #ifdef __LP64__
-  // When requesting low_4g memory and having an expectation, the requested range should fit into
-  // 4GB.
+  // When requesting low_4g memory and having an expectation, the requested range should fit below
+  // the heap reference limit.
   if (low_4gb && (
       // Start out of bounds.
-      (reinterpret_cast<uintptr_t>(expected) >> 32) != 0 ||
+      reinterpret_cast<uintptr_t>(expected) >= kHeapReferenceLimit ||
       // End out of bounds. For simplicity, this will fail for the last page of memory.
-      (reinterpret_cast<uintptr_t>(expected + page_aligned_byte_count) >> 32) != 0)) {
+      reinterpret_cast<uintptr_t>(expected + page_aligned_byte_count) >= kHeapReferenceLimit)) {
     *error_msg = StringPrintf("The requested address space (%p, %p) cannot fit in low_4gb",
                               expected, expected + page_aligned_byte_count);
     return nullptr;
@@ -216,15 +234,15 @@ MemMap* MemMap::MapAnonymous(const char* name, byte* expected, size_t byte_count
   // A page allocator would be a useful abstraction here, as
   // 1) It is doubtful that MAP_32BIT on x86_64 is doing the right job for us
   // 2) The linear scheme, even with simple saving of the last known position, is very crude
-#if defined(__LP64__) && !defined(__x86_64__)
+#if USE_ART_LOW_4G_ALLOCATOR
   // MAP_32BIT only available on x86_64.
   void* actual = MAP_FAILED;
   if (low_4gb && expected == nullptr) {
     bool first_run = true;
 
-    for (uintptr_t ptr = next_mem_pos_; ptr < 4 * GB; ptr += kPageSize) {
-      if (4U * GB - ptr < page_aligned_byte_count) {
-        // Not enough memory until 4GB.
+    for (uintptr_t ptr = next_mem_pos_; ptr < kHeapReferenceLimit; ptr += kPageSize) {
+      if (kHeapReferenceLimit - ptr < page_aligned_byte_count) {
+        // Not enough memory until the limit.
         if (first_run) {
           // Try another time from the bottom;
           ptr = LOW_MEM_START - kPageSize;
@@ -257,7 +275,8 @@ MemMap* MemMap::MapAnonymous(const char* name, byte* expected, size_t byte_count
         if (actual != MAP_FAILED) {
           // Since we didn't use MAP_FIXED the kernel may have mapped it somewhere not in the low
           // 4GB. If this is the case, unmap and retry.
-          if (reinterpret_cast<uintptr_t>(actual) + page_aligned_byte_count < 4 * GB) {
+          if (reinterpret_cast<uintptr_t>(actual) + page_aligned_byte_count <
+              kHeapReferenceLimit) {
             break;
           } else {
             munmap(actual, page_aligned_byte_count);
@@ -388,7 +407,7 @@ MemMap::~MemMap() {
 MemMap::MemMap(const std::string& name, byte* begin, size_t size, void* base_begin,
                size_t base_size, int prot)
     : name_(name), begin_(begin), size_(size), base_begin_(base_begin), base_size_(base_size),
-      prot_(prot) {
+      prot_(prot), huge_pages_requested_(false), huge_pages_(false), numa_interleave_(false) {
   if (size_ == 0) {
     CHECK(begin_ == nullptr);
     CHECK(base_begin_ == nullptr);
@@ -489,6 +508,156 @@ bool MemMap::Protect(int prot) {
   return false;
 }
 
+bool MemMap::AdviseHugePages() {
+  if (!use_huge_pages_ || base_size_ == 0) {
+    return false;
+  }
+  huge_pages_requested_ = true;
+  // Only the huge pages fully inside the map may be backed by a huge page.
+  byte* begin = AlignUp(reinterpret_cast<byte*>(base_begin_), kHugePageSize);
+  byte* end = AlignDown(reinterpret_cast<byte*>(BaseEnd()), kHugePageSize);
+  if (begin >= end) {
+    VLOG(heap) << "Not using huge pages for " << *this << ", it doesn't contain a huge page";
+    return false;
+  }
+  if (madvise(begin, end - begin, MADV_HUGEPAGE) != 0) {
+    // Kernels without transparent huge pages, or without them for this kind of mapping.
+    PLOG(WARNING) << "madvise(" << reinterpret_cast<void*>(begin) << ", " << end - begin
+                  << ", MADV_HUGEPAGE) failed for " << name_ << ", using "
+                  << PrettySize(kPageSize) << " pages";
+    return false;
+  }
+  huge_pages_ = true;
+  return true;
+}
+
+// Returns the amount of memory of [begin, end) backed by anonymous huge pages according to the
+// contents of /proc/self/smaps.
+static size_t GetAnonHugePagesSize(const std::string& smaps, uintptr_t begin, uintptr_t end) {
+  size_t total = 0;
+  bool in_range = false;
+  std::istringstream in(smaps);
+  std::string line;
+  while (std::getline(in, line)) {
+    uintptr_t vma_begin;
+    uintptr_t vma_end;
+    if (sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR " ", &vma_begin, &vma_end) == 2) {
+      in_range = vma_begin < end && begin < vma_end;
+      continue;
+    }
+    size_t kb;
+    if (in_range && sscanf(line.c_str(), "AnonHugePages: %zu kB", &kb) == 1) {
+      total += kb * KB;
+    }
+  }
+  return total;
+}
+
+void MemMap::DumpHugePages(std::ostream& os) {
+  if (!use_huge_pages_) {
+    return;
+  }
+  std::string smaps;
+  if (!ReadFileToString("/proc/self/smaps", &smaps)) {
+    os << "Huge pages: failed to read /proc/self/smaps\n";
+    return;
+  }
+  MutexLock mu(Thread::Current(), *Locks::mem_maps_lock_);
+  os << "Huge pages:\n";
+  for (const std::pair<void*, MemMap*>& entry : maps_) {
+    const MemMap* map = entry.second;
+    if (!map->huge_pages_requested_) {
+      continue;
+    }
+    os << "  " << map->GetName() << " " << PrettySize(map->BaseSize()) << ": ";
+    if (!map->huge_pages_) {
+      os << "huge pages unavailable, " << PrettySize(kPageSize) << " pages\n";
+      continue;
+    }
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(map->BaseBegin());
+    const uintptr_t end = reinterpret_cast<uintptr_t>(map->BaseEnd());
+    const size_t huge_size = std::min(map->BaseSize(), GetAnonHugePagesSize(smaps, begin, end));
+    os << PrettySize(huge_size) << " in " << PrettySize(kHugePageSize) << " pages, "
+       << PrettySize(map->BaseSize() - huge_size) << " in " << PrettySize(kPageSize) << " pages\n";
+  }
+}
+
+bool MemMap::AdviseNumaInterleave() {
+  if (!use_numa_interleave_ || base_size_ == 0) {
+    return false;
+  }
+#if defined(__linux__) && defined(__NR_mbind)
+  // The kernel restricts the mask to the nodes the process is allowed to use.
+  const unsigned long all_nodes = ~0UL;  // NOLINT(runtime/int)
+  if (syscall(__NR_mbind, base_begin_, base_size_, MPOL_INTERLEAVE, &all_nodes,
+              sizeof(all_nodes) * kBitsPerByte, 0) != 0) {
+    PLOG(WARNING) << "mbind(" << base_begin_ << ", " << base_size_ << ", MPOL_INTERLEAVE) failed for "
+                  << name_;
+    return false;
+  }
+  numa_interleave_ = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void MemMap::DumpNumaNodes(std::ostream& os) {
+  if (!use_numa_interleave_) {
+    return;
+  }
+  std::string numa_maps;
+  if (!ReadFileToString("/proc/self/numa_maps", &numa_maps)) {
+    os << "NUMA nodes: failed to read /proc/self/numa_maps\n";
+    return;
+  }
+  MutexLock mu(Thread::Current(), *Locks::mem_maps_lock_);
+  os << "NUMA nodes:\n";
+  for (const std::pair<void*, MemMap*>& entry : maps_) {
+    const MemMap* map = entry.second;
+    if (!map->numa_interleave_) {
+      continue;
+    }
+    // Each line starts with the address of a VMA followed by its policy and, for each node with
+    // resident pages, N<node>=<pages>. The map may have been split into several VMAs.
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(map->BaseBegin());
+    const uintptr_t end = reinterpret_cast<uintptr_t>(map->BaseEnd());
+    std::map<size_t, size_t> node_bytes;
+    std::istringstream in(numa_maps);
+    std::string line;
+    while (std::getline(in, line)) {
+      uintptr_t vma_begin;
+      if (sscanf(line.c_str(), "%" SCNxPTR " ", &vma_begin) != 1 ||
+          vma_begin < begin || vma_begin >= end) {
+        continue;
+      }
+      size_t page_size = kPageSize;
+      std::vector<std::pair<size_t, size_t>> vma_nodes;
+      std::istringstream fields(line);
+      std::string field;
+      while (fields >> field) {
+        size_t node, pages, kb;
+        if (sscanf(field.c_str(), "N%zu=%zu", &node, &pages) == 2) {
+          vma_nodes.push_back(std::make_pair(node, pages));
+        } else if (sscanf(field.c_str(), "kernelpagesize_kB=%zu", &kb) == 1) {
+          page_size = kb * KB;
+        }
+      }
+      for (const std::pair<size_t, size_t>& vma_node : vma_nodes) {
+        node_bytes[vma_node.first] += vma_node.second * page_size;
+      }
+    }
+    os << "  " << map->GetName() << " " << PrettySize(map->BaseSize()) << ":";
+    if (node_bytes.empty()) {
+      os << " nothing resident";
+    }
+    for (const std::pair<const size_t, size_t>& node : node_bytes) {
+      os << " node " << node.first << " " << PrettySize(node.second);
+    }
+    os << "\n";
+  }
+}
+
 bool MemMap::CheckNoGaps(MemMap* begin_map, MemMap* end_map) {
   MutexLock mu(Thread::Current(), *Locks::mem_maps_lock_);
   CHECK(begin_map != nullptr);
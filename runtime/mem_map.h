@@ -28,6 +28,14 @@
 
 #include "globals.h"
 
+// MAP_32BIT only maps on x86_64 and below 2GB, the other 64-bit architectures and the shifted heap
+// references, which reach further, scan for free pages below the heap reference limit instead.
+#if defined(__LP64__) && (!defined(__x86_64__) || defined(ART_HEAP_REFERENCE_SHIFT))
+#define USE_ART_LOW_4G_ALLOCATOR 1
+#else
+#define USE_ART_LOW_4G_ALLOCATOR 0
+#endif
+
 namespace art {
 
 // Used to keep track of mmap segments.
@@ -39,6 +47,9 @@ namespace art {
 // Otherwise, calls might see uninitialized values.
 class MemMap {
  public:
+  // Size of the transparent huge pages of the kernel.
+  static constexpr size_t kHugePageSize = 2 * MB;
+
   // Request an anonymous region of length 'byte_count' and a requested base address.
   // Use NULL as the requested base address if you don't care.
   //
@@ -46,6 +57,9 @@ class MemMap {
   // 'ashmem_name' will be used -- on systems that support it -- to give the mapping
   // a name.
   //
+  // With low_4gb the region is below kHeapReferenceLimit, the low 4GB unless the heap references
+  // are shifted, so that the references reach the objects in it.
+  //
   // On success, returns returns a MemMap instance.  On failure, returns a NULL;
   static MemMap* MapAnonymous(const char* ashmem_name, byte* addr, size_t byte_count, int prot,
                               bool low_4gb, std::string* error_msg);
@@ -77,6 +91,29 @@ class MemMap {
 
   bool Protect(int prot);
 
+  // Enables AdviseHugePages, which does nothing by default. Set from -XX:UseHugePages.
+  static void SetUseHugePages(bool use_huge_pages) {
+    use_huge_pages_ = use_huge_pages;
+  }
+
+  // Asks the kernel to back the huge page aligned part of the map with transparent huge pages,
+  // if they are enabled. Returns false if the kernel can't, the map keeps its normal pages then.
+  bool AdviseHugePages();
+
+  bool UsesHugePages() const {
+    return huge_pages_;
+  }
+
+  // Enables AdviseNumaInterleave, which does nothing by default. Set from -XX:NumaInterleave.
+  static void SetUseNumaInterleave(bool use_numa_interleave) {
+    use_numa_interleave_ = use_numa_interleave;
+  }
+
+  // Asks the kernel to spread the pages of the map over the memory nodes the process may use
+  // rather than to place them on the node of the thread touching them first. Returns false if the
+  // kernel can't, on kernels without NUMA support for instance.
+  bool AdviseNumaInterleave();
+
   int GetProtect() const {
     return prot_;
   }
@@ -117,6 +154,12 @@ class MemMap {
       LOCKS_EXCLUDED(Locks::mem_maps_lock_);
   static void DumpMaps(std::ostream& os)
       LOCKS_EXCLUDED(Locks::mem_maps_lock_);
+  // Dumps the effective page sizes of the maps for which huge pages were requested.
+  static void DumpHugePages(std::ostream& os)
+      LOCKS_EXCLUDED(Locks::mem_maps_lock_);
+  // Dumps how much of the maps for which interleaving was requested is on each memory node.
+  static void DumpNumaNodes(std::ostream& os)
+      LOCKS_EXCLUDED(Locks::mem_maps_lock_);
 
  private:
   MemMap(const std::string& name, byte* begin, size_t size, void* base_begin, size_t base_size,
@@ -138,8 +181,14 @@ class MemMap {
   void* const base_begin_;  // Page-aligned base address.
   size_t base_size_;  // Length of mapping. May be changed by RemapAtEnd (ie Zygote).
   int prot_;  // Protection of the map.
+  bool huge_pages_requested_;  // AdviseHugePages was called while huge pages are enabled.
+  bool huge_pages_;  // The kernel accepted to use huge pages for the map.
+  bool numa_interleave_;  // The kernel accepted to interleave the pages of the map.
+
+  static bool use_huge_pages_;
+  static bool use_numa_interleave_;
 
-#if defined(__LP64__) && !defined(__x86_64__)
+#if USE_ART_LOW_4G_ALLOCATOR
   static uintptr_t next_mem_pos_;   // next memory location to check for low_4g extent
 #endif
 
@@ -17,6 +17,7 @@
 #include "mem_map.h"
 
 #include <memory>
+#include <sstream>
 
 #include "gtest/gtest.h"
 
@@ -85,14 +86,14 @@ class MemMapTest : public testing::Test {
     delete m1;
   }
 
-#if defined(__LP64__) && !defined(__x86_64__)
+#if USE_ART_LOW_4G_ALLOCATOR
   static uintptr_t GetLinearScanPos() {
     return MemMap::next_mem_pos_;
   }
 #endif
 };
 
-#if defined(__LP64__) && !defined(__x86_64__)
+#if USE_ART_LOW_4G_ALLOCATOR
 
 #ifdef __BIONIC__
 extern uintptr_t CreateStartPos(uint64_t input);
@@ -150,7 +151,7 @@ TEST_F(MemMapTest, MapAnonymousEmpty32bit) {
                                              &error_msg));
   ASSERT_TRUE(map.get() != nullptr) << error_msg;
   ASSERT_TRUE(error_msg.empty());
-  ASSERT_LT(reinterpret_cast<uintptr_t>(BaseBegin(map.get())), 1ULL << 32);
+  ASSERT_LT(reinterpret_cast<uintptr_t>(BaseBegin(map.get())), kHeapReferenceLimit);
 }
 #endif
 
@@ -228,7 +229,7 @@ TEST_F(MemMapTest, MapAnonymousOverflow) {
 TEST_F(MemMapTest, MapAnonymousLow4GBExpectedTooHigh) {
   std::string error_msg;
   std::unique_ptr<MemMap> map(MemMap::MapAnonymous("MapAnonymousLow4GBExpectedTooHigh",
-                                             reinterpret_cast<byte*>(UINT64_C(0x100000000)),
+                                             reinterpret_cast<byte*>(kHeapReferenceLimit),
                                              kPageSize,
                                              PROT_READ | PROT_WRITE,
                                              true,
@@ -240,7 +241,8 @@ TEST_F(MemMapTest, MapAnonymousLow4GBExpectedTooHigh) {
 TEST_F(MemMapTest, MapAnonymousLow4GBRangeTooHigh) {
   std::string error_msg;
   std::unique_ptr<MemMap> map(MemMap::MapAnonymous("MapAnonymousLow4GBRangeTooHigh",
-                                             reinterpret_cast<byte*>(0xF0000000),
+                                             reinterpret_cast<byte*>(kHeapReferenceLimit -
+                                                                     0x10000000),
                                              0x20000000,
                                              PROT_READ | PROT_WRITE,
                                              true,
@@ -311,4 +313,31 @@ TEST_F(MemMapTest, CheckNoGaps) {
   ASSERT_FALSE(MemMap::CheckNoGaps(map0.get(), map2.get()));
 }
 
+TEST_F(MemMapTest, AdviseHugePages) {
+  std::string error_msg;
+  std::unique_ptr<MemMap> map(MemMap::MapAnonymous("MapAnonymousHugePages",
+                                                   nullptr,
+                                                   3 * MemMap::kHugePageSize,
+                                                   PROT_READ | PROT_WRITE,
+                                                   false,
+                                                   &error_msg));
+  ASSERT_TRUE(map.get() != nullptr) << error_msg;
+  // Huge pages are opt-in.
+  EXPECT_FALSE(map->AdviseHugePages());
+  EXPECT_FALSE(map->UsesHugePages());
+  std::ostringstream disabled_oss;
+  MemMap::DumpHugePages(disabled_oss);
+  EXPECT_TRUE(disabled_oss.str().empty());
+
+  MemMap::SetUseHugePages(true);
+  // The map contains at least one aligned huge page, but the kernel may not support them.
+  bool advised = map->AdviseHugePages();
+  EXPECT_EQ(advised, map->UsesHugePages());
+  memset(map->Begin(), 1, map->Size());
+  std::ostringstream oss;
+  MemMap::DumpHugePages(oss);
+  EXPECT_NE(std::string::npos, oss.str().find("MapAnonymousHugePages")) << oss.str();
+  MemMap::SetUseHugePages(false);
+}
+
 }  // namespace art
@@ -33,6 +33,42 @@
 namespace art {
 namespace mirror {
 
+// Allocates the innermost sub-arrays of a multi-dimensional array a batch at a time and stores
+// them into the elements of the array, as long as the heap can batch them. Returns the number of
+// elements filled, the caller creates the others one at a time.
+static int32_t BatchCreateInnermostArrays(Thread* self, Handle<Array> array,
+                                          Handle<Class> sub_array_class, int32_t sub_array_length)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const size_t component_size = sub_array_class->GetComponentSize();
+  // Only small arrays are batched, their size can't overflow.
+  if (static_cast<size_t>(sub_array_length) > kPageSize / component_size) {
+    return 0;
+  }
+  const size_t size = Array::DataOffset(component_size).SizeValue() +
+      sub_array_length * component_size;
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  SetLengthVisitor visitor(sub_array_length);
+  const int32_t array_length = array->GetLength();
+  static constexpr size_t kBatchSize = 64;
+  Object* sub_arrays[kBatchSize];
+  int32_t num_filled = 0;
+  while (num_filled < array_length) {
+    const size_t num_wanted = std::min(kBatchSize, static_cast<size_t>(array_length - num_filled));
+    const size_t num_allocated = heap->AllocObjectBatch<true>(self, sub_array_class.Get(), size,
+                                                              num_wanted, sub_arrays, visitor);
+    // The batch must be reachable before the next allocation.
+    ObjectArray<Array>* elements = array->AsObjectArray<Array>();
+    for (size_t i = 0; i < num_allocated; ++i) {
+      // Use non-transactional mode without check.
+      elements->Set<false, false>(num_filled++, down_cast<Array*>(sub_arrays[i]));
+    }
+    if (num_allocated < num_wanted) {
+      break;
+    }
+  }
+  return num_filled;
+}
+
 // Create a multi-dimensional array of Objects or primitive types.
 //
 // We have to generate the names for X[], X[][], X[][][], and so on.  The
@@ -56,8 +92,15 @@ static Array* RecursiveCreateMultiArray(Thread* self,
     return nullptr;
   }
   if (current_dimension + 1 < dimensions->GetLength()) {
-    // Create a new sub-array in every element of the array.
-    for (int32_t i = 0; i < array_length; i++) {
+    int32_t i = 0;
+    if (current_dimension + 2 == dimensions->GetLength()) {
+      StackHandleScope<1> hs(self);
+      Handle<mirror::Class> h_component_type(hs.NewHandle(array_class->GetComponentType()));
+      i = BatchCreateInnermostArrays(self, new_array, h_component_type,
+                                     dimensions->Get(current_dimension + 1));
+    }
+    // Create a new sub-array in every remaining element of the array.
+    for (; i < array_length; i++) {
       StackHandleScope<1> hs(self);
       Handle<mirror::Class> h_component_type(hs.NewHandle(array_class->GetComponentType()));
       Array* sub_array = RecursiveCreateMultiArray(self, h_component_type,
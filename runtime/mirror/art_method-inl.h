@@ -25,6 +25,7 @@
 #include "oat.h"
 #include "quick/quick_method_frame_info.h"
 #include "runtime-inl.h"
+#include "stack_map.h"
 
 namespace art {
 namespace mirror {
@@ -82,7 +83,7 @@ inline uint32_t ArtMethod::GetCodeSize() {
   if (code == nullptr) {
     return 0u;
   }
-  return reinterpret_cast<const OatQuickMethodHeader*>(code)[-1].code_size_;
+  return reinterpret_cast<const OatQuickMethodHeader*>(code)[-1].GetCodeSize();
 }
 
 inline bool ArtMethod::CheckIncompatibleClassChange(InvokeType type) {
@@ -212,6 +213,16 @@ inline const uint8_t* ArtMethod::GetVmapTable(const void* code_pointer) {
   return reinterpret_cast<const uint8_t*>(code_pointer) - offset;
 }
 
+inline bool ArtMethod::IsOptimized(const void* code_pointer) {
+  DCHECK(code_pointer != nullptr);
+  return reinterpret_cast<const OatQuickMethodHeader*>(code_pointer)[-1].HasStackMaps();
+}
+
+inline CodeInfo ArtMethod::GetOptimizedCodeInfo(const void* code_pointer) {
+  DCHECK(IsOptimized(code_pointer));
+  return CodeInfo(GetVmapTable(code_pointer));
+}
+
 inline void ArtMethod::SetOatNativeGcMapOffset(uint32_t gc_map_offset) {
   DCHECK(!Runtime::Current()->IsStarted());
   SetNativeGcMap(reinterpret_cast<uint8_t*>(gc_map_offset));
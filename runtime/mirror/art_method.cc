@@ -138,9 +138,11 @@ ArtMethod* ArtMethod::FindOverriddenMethod() {
   } else {
     // Method didn't override superclass method so search interfaces
     if (IsProxyMethod()) {
+      // Every proxy invocation gets here, the search of the dex caches under the dex lock is only
+      // a debug check.
       result = GetDexCacheResolvedMethods()->Get(GetDexMethodIndex());
-      CHECK_EQ(result,
-               Runtime::Current()->GetClassLinker()->FindMethodForProxy(GetDeclaringClass(), this));
+      DCHECK_EQ(result,
+                Runtime::Current()->GetClassLinker()->FindMethodForProxy(GetDeclaringClass(), this));
     } else {
       MethodHelper mh(this);
       MethodHelper interface_mh;
@@ -171,6 +173,20 @@ uint32_t ArtMethod::ToDexPc(const uintptr_t pc, bool abort_on_failure) {
     return static_cast<uint32_t>(pc);
   }
   const void* entry_point = GetQuickOatEntryPoint();
+  if (entry_point != nullptr && IsOptimized(EntryPointToCodePointer(entry_point))) {
+    // The stack maps are sorted by native pc offset.
+    CodeInfo code_info = GetOptimizedCodeInfo(EntryPointToCodePointer(entry_point));
+    uint32_t sought_offset = pc - reinterpret_cast<uintptr_t>(entry_point);
+    size_t index;
+    if (code_info.FindStackMapForNativePcOffset(sought_offset, &index)) {
+      return code_info.GetStackMapAt(index).GetDexPc();
+    }
+    if (abort_on_failure) {
+      LOG(FATAL) << "Failed to find stack map for PC offset "
+                 << reinterpret_cast<void*>(sought_offset) << " in " << PrettyMethod(this);
+    }
+    return DexFile::kDexNoIndex;
+  }
   MappingTable table(
       entry_point != nullptr ? GetMappingTable(EntryPointToCodePointer(entry_point)) : nullptr);
   if (table.TotalSize() == 0) {
@@ -204,6 +220,15 @@ uint32_t ArtMethod::ToDexPc(const uintptr_t pc, bool abort_on_failure) {
 
 uintptr_t ArtMethod::ToNativePc(const uint32_t dex_pc) {
   const void* entry_point = GetQuickOatEntryPoint();
+  if (entry_point != nullptr && IsOptimized(EntryPointToCodePointer(entry_point))) {
+    CodeInfo code_info = GetOptimizedCodeInfo(EntryPointToCodePointer(entry_point));
+    size_t index;
+    CHECK(code_info.FindStackMapForDexPc(dex_pc, &index))
+        << "Failed to find stack map for dex pc 0x" << std::hex << dex_pc << " in "
+        << PrettyMethod(this);
+    return reinterpret_cast<uintptr_t>(entry_point) +
+        code_info.GetStackMapAt(index).GetNativePcOffset();
+  }
   MappingTable table(
       entry_point != nullptr ? GetMappingTable(EntryPointToCodePointer(entry_point)) : nullptr);
   if (table.TotalSize() == 0) {
@@ -231,16 +256,23 @@ uintptr_t ArtMethod::ToNativePc(const uint32_t dex_pc) {
 
 uint32_t ArtMethod::FindCatchBlock(Handle<Class> exception_type, uint32_t dex_pc,
                                    bool* has_no_move_exception) {
+  Thread* self = Thread::Current();
+  CatchHandlerCache* cache = self->GetCatchHandlerCache();
+  uint32_t cached_dex_pc;
+  if (cache->Lookup(this, dex_pc, exception_type.Get(), &cached_dex_pc, has_no_move_exception)) {
+    return cached_dex_pc;
+  }
   MethodHelper mh(this);
   const DexFile::CodeItem* code_item = mh.GetCodeItem();
   // Set aside the exception while we resolve its type.
-  Thread* self = Thread::Current();
   ThrowLocation throw_location;
   StackHandleScope<1> hs(self);
   Handle<mirror::Throwable> exception(hs.NewHandle(self->GetException(&throw_location)));
   self->ClearException();
   // Default to handler not found.
   uint32_t found_dex_pc = DexFile::kDexNoIndex;
+  // The search isn't cached if a type couldn't be resolved, it may be defined later.
+  bool cacheable = true;
   // Iterate over the catch handlers associated with dex_pc.
   for (CatchHandlerIterator it(*code_item, dex_pc); it.HasNext(); it.Next()) {
     uint16_t iter_type_idx = it.GetHandlerTypeIndex();
@@ -256,6 +288,7 @@ uint32_t ArtMethod::FindCatchBlock(Handle<Class> exception_type, uint32_t dex_pc
       // removed by a pro-guard like tool.
       // Note: this is not RI behavior. RI would have failed when loading the class.
       self->ClearException();
+      cacheable = false;
       // Delete any long jump context as this routine is called during a stack walk which will
       // release its in use context at the end.
       delete self->GetLongJumpContext();
@@ -271,6 +304,10 @@ uint32_t ArtMethod::FindCatchBlock(Handle<Class> exception_type, uint32_t dex_pc
         Instruction::At(&code_item->insns_[found_dex_pc]);
     *has_no_move_exception = (first_catch_instr->Opcode() != Instruction::MOVE_EXCEPTION);
   }
+  if (cacheable) {
+    cache->Insert(this, dex_pc, exception_type.Get(), found_dex_pc,
+                  found_dex_pc != DexFile::kDexNoIndex && *has_no_move_exception);
+  }
   // Put the exception back.
   if (exception.Get() != nullptr) {
     self->SetException(throw_location, exception.Get());
@@ -28,6 +28,7 @@
 namespace art {
 
 struct ArtMethodOffsets;
+class CodeInfo;
 struct ConstructorMethodOffsets;
 union JValue;
 struct MethodClassOffsets;
@@ -226,6 +227,10 @@ class MANAGED ArtMethod : public Object {
                OFFSET_OF_OBJECT_MEMBER(ArtMethod, entry_point_from_interpreter_));
   }
 
+  static MemberOffset EntryPointFromInterpreterOffset() {
+    return MemberOffset(OFFSETOF_MEMBER(ArtMethod, entry_point_from_interpreter_));
+  }
+
   template<VerifyObjectFlags kVerifyFlags = kDefaultVerifyFlags>
   void SetEntryPointFromInterpreter(EntryPointFromInterpreter* entry_point_from_interpreter)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -312,6 +317,15 @@ class MANAGED ArtMethod : public Object {
   const uint8_t* GetVmapTable(const void* code_pointer)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Optimized code has stack maps in its vmap table, and no mapping table nor GC map.
+  bool IsOptimized(const void* code_pointer) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  CodeInfo GetOptimizedCodeInfo(const void* code_pointer)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static MemberOffset NativeGcMapOffset() {
+    return MemberOffset(OFFSETOF_MEMBER(ArtMethod, gc_map_));
+  }
+
   const uint8_t* GetNativeGcMap() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     return GetFieldPtr<uint8_t*>(OFFSET_OF_OBJECT_MEMBER(ArtMethod, gc_map_));
   }
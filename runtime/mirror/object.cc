@@ -161,9 +161,18 @@ int32_t Object::IdentityHashCode() const {
         }
         break;
       }
-      case LockWord::kThinLocked: {
-        // Inflate the thin lock to a monitor and stick the hash code inside of the monitor.
+      case LockWord::kThinLocked:
+        // Fall-through.
+      case LockWord::kBiasLocked: {
         Thread* self = Thread::Current();
+        if (lw.ThinLockOwner() == self->GetThreadId()) {
+          // Keep the hash code of a lock we own on the side rather than inflating it.
+          int32_t hash_code;
+          if (Monitor::GetOwnedLockHashCode(self, current_this, lw, &hash_code)) {
+            return hash_code;
+          }
+        }
+        // Inflate the thin lock to a monitor and stick the hash code inside of the monitor.
         StackHandleScope<1> hs(self);
         Handle<mirror::Object> h_this(hs.NewHandle(current_this));
         Monitor::InflateThinLocked(self, h_this, lw, GenerateIdentityHashCode());
@@ -175,7 +184,12 @@ int32_t Object::IdentityHashCode() const {
         // Already inflated, return the has stored in the monitor.
         Monitor* monitor = lw.FatLockMonitor();
         DCHECK(monitor != nullptr);
-        return monitor->GetHashCode();
+        int32_t hash_code;
+        if (monitor->GetInstalledHashCode(&hash_code)) {
+          return hash_code;
+        }
+        // The monitor was deflated meanwhile, read the lock word again.
+        break;
       }
       case LockWord::kHashCode: {
         return lw.GetHashCode();
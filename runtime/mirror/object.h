@@ -74,6 +74,15 @@ class MANAGED LOCKABLE Object {
   template<VerifyObjectFlags kVerifyFlags = kDefaultVerifyFlags>
   void SetClass(Class* new_klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  static MemberOffset ReadBarrierPointerOffset() {
+#ifdef USE_BAKER_OR_BROOKS_READ_BARRIER
+    return OFFSET_OF_OBJECT_MEMBER(Object, x_rb_ptr_);
+#else
+    LOG(FATAL) << "Unreachable";
+    return MemberOffset(0);
+#endif
+  }
+
   Object* GetReadBarrierPointer() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void SetReadBarrierPointer(Object* rb_ptr) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   bool AtomicSetReadBarrierPointer(Object* expected_rb_ptr, Object* rb_ptr)
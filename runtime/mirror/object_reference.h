@@ -29,6 +29,9 @@ class Object;
 // extra platform specific padding.
 #define MANAGED PACKED(4)
 
+COMPILE_ASSERT((static_cast<size_t>(1) << k64BitHeapReferenceShift) <= kObjectAlignment,
+               heap_reference_shift_exceeds_object_alignment);
+
 // Value type representing a reference to a mirror::Object of type MirrorType.
 template<bool kPoisonReferences, class MirrorType>
 class MANAGED ObjectReference {
@@ -55,16 +58,20 @@ class MANAGED ObjectReference {
       : reference_(Compress(mirror_ptr)) {
   }
 
-  // Compress reference to its bit representation.
+  // Compress reference to its bit representation. The aligned addresses lose their low zero bits
+  // when the references are shifted.
   static uint32_t Compress(MirrorType* mirror_ptr) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     uintptr_t as_bits = reinterpret_cast<uintptr_t>(mirror_ptr);
+    DCHECK_EQ(as_bits & ((static_cast<uintptr_t>(1) << kHeapReferenceShift) - 1), 0U);
+    DCHECK_LT(static_cast<uint64_t>(as_bits), kHeapReferenceLimit);
+    as_bits >>= kHeapReferenceShift;
     return static_cast<uint32_t>(kPoisonReferences ? -as_bits : as_bits);
   }
 
   // Uncompress an encoded reference from its bit representation.
   MirrorType* UnCompress() const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    uintptr_t as_bits = kPoisonReferences ? -reference_ : reference_;
-    return reinterpret_cast<MirrorType*>(as_bits);
+    uint32_t as_bits = kPoisonReferences ? -reference_ : reference_;
+    return reinterpret_cast<MirrorType*>(static_cast<uintptr_t>(as_bits) << kHeapReferenceShift);
   }
 
   friend class Object;
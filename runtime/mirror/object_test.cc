@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <memory>
+#include <vector>
 
 #include "array-inl.h"
 #include "art_field-inl.h"
@@ -37,6 +38,7 @@
 #include "object_array-inl.h"
 #include "handle_scope-inl.h"
 #include "string-inl.h"
+#include "utf.h"
 
 namespace art {
 namespace mirror {
@@ -113,6 +115,21 @@ TEST_F(ObjectTest, Clone) {
   EXPECT_TRUE(clone->GetClass() == a1->GetClass());
 }
 
+TEST_F(ObjectTest, HeapReference) {
+  ScopedObjectAccess soa(Thread::Current());
+  Object* obj = class_linker_->AllocObjectArray<Object>(soa.Self(), 1);
+  ASSERT_TRUE(obj != nullptr);
+  HeapReference<Object> ref = HeapReference<Object>::FromMirrorPtr(obj);
+  EXPECT_EQ(obj, ref.AsMirrorPtr());
+  // The encoded references of the heap objects are 32-bit, shifted on 64-bit if configured.
+  const uint32_t encoded = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(obj) >>
+                                                 kHeapReferenceShift);
+  EXPECT_EQ(kPoisonHeapReferences ? -encoded : encoded, ref.AsVRegValue());
+  EXPECT_EQ(obj, StackReference<Object>::FromMirrorPtr(obj).AsMirrorPtr());
+  ref.Clear();
+  EXPECT_TRUE(ref.AsMirrorPtr() == nullptr);
+}
+
 TEST_F(ObjectTest, AllocObjectArray) {
   ScopedObjectAccess soa(Thread::Current());
   StackHandleScope<2> hs(soa.Self());
@@ -517,6 +534,20 @@ TEST_F(ObjectTest, StringHashCode) {
   EXPECT_EQ(0, empty->GetHashCode());
   EXPECT_EQ(65, A->GetHashCode());
   EXPECT_EQ(64578, ABC->GetHashCode());
+
+  // Lengths and offsets around the unrolled loop, against the plain definition.
+  const char* chars = "the quick brown fox jumps over the lazy dog";
+  std::vector<uint16_t> utf16(chars, chars + strlen(chars));
+  for (size_t offset = 0; offset < 4; ++offset) {
+    for (size_t length = 0; offset + length <= utf16.size(); ++length) {
+      int32_t expected = 0;
+      for (size_t i = 0; i < length; ++i) {
+        expected = expected * 31 + utf16[offset + i];
+      }
+      EXPECT_EQ(expected, ComputeUtf16Hash(&utf16[offset], length)) << offset << " " << length;
+    }
+  }
+  EXPECT_EQ(64578, ComputeUtf16Hash(ABC->GetCharArray(), ABC->GetOffset(), ABC->GetLength()));
 }
 
 TEST_F(ObjectTest, InstanceOf) {
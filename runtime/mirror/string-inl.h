@@ -43,6 +43,16 @@ inline void String::SetArray(CharArray* new_array) {
   SetFieldObject<false, false>(OFFSET_OF_OBJECT_MEMBER(String, array_), new_array);
 }
 
+inline void String::ShareCharArray(CharArray* array, int32_t offset) {
+  DCHECK_LE(0, offset);
+  DCHECK_LE(offset + GetLength(), array->GetLength());
+  DCHECK_EQ(0, memcmp(array->GetData() + offset, GetCharArray()->GetData() + GetOffset(),
+                      GetLength() * sizeof(uint16_t)));
+  SetArray(array);
+  // Like the array, the offset is invariant once the string is published.
+  SetField32<false, false>(OFFSET_OF_OBJECT_MEMBER(String, offset_), offset);
+}
+
 inline String* String::Intern() {
   return Runtime::Current()->GetInternTable()->InternWeak(this);
 }
@@ -46,6 +46,10 @@ class MANAGED String : public Object {
     return OFFSET_OF_OBJECT_MEMBER(String, offset_);
   }
 
+  static MemberOffset HashCodeOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(String, hash_code_);
+  }
+
   CharArray* GetCharArray() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   int32_t GetOffset() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -102,6 +106,12 @@ class MANAGED String : public Object {
 
   int32_t CompareTo(String* other) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Points this string at the characters starting at offset in another string's array. The
+  // array must already hold this string's characters there; used by the image writer to let
+  // equal strings and prefixes share one array.
+  void ShareCharArray(CharArray* array, int32_t offset)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   static Class* GetJavaLangString() {
     DCHECK(java_lang_String_ != NULL);
     return java_lang_String_;
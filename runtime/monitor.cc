@@ -18,6 +18,8 @@
 
 #include <vector>
 
+#include "barrier.h"
+#include "base/contention_profiler.h"
 #include "base/mutex.h"
 #include "base/stl_util.h"
 #include "class_linker.h"
@@ -50,6 +52,12 @@ namespace art {
  * from the "thin" state to the "fat" state and this transition is referred to as inflation. Once
  * a lock has been inflated it remains in the "fat" state indefinitely.
  *
+ * With -XX:UseBiasedLocking, an unlocked object locked by the runtime becomes "biased" towards the
+ * locking thread, which later enters and exits it with plain stores to the lock word. Another
+ * thread using the object revokes the bias by suspending the owner and inflating the lock, the
+ * same way contended thin locks are inflated. Inflated locks aren't biased again until deflated.
+ * The unheld locks biased towards a thread that has exited are unlocked instead.
+ *
  * The lock value itself is stored in mirror::Object::monitor_ and the representation is described
  * in the LockWord value type.
  *
@@ -66,6 +74,7 @@ namespace art {
 
 bool (*Monitor::is_sensitive_thread_hook_)() = NULL;
 uint32_t Monitor::lock_profiling_threshold_ = 0;
+bool Monitor::use_biased_locking_ = false;
 
 bool Monitor::IsSensitiveThread() {
   if (is_sensitive_thread_hook_ != NULL) {
@@ -74,9 +83,11 @@ bool Monitor::IsSensitiveThread() {
   return false;
 }
 
-void Monitor::Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread_hook)()) {
+void Monitor::Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread_hook)(),
+                   bool use_biased_locking) {
   lock_profiling_threshold_ = lock_profiling_threshold;
   is_sensitive_thread_hook_ = is_sensitive_thread_hook;
+  use_biased_locking_ = use_biased_locking;
 }
 
 Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code)
@@ -85,8 +96,11 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
       num_waiters_(0),
       owner_(owner),
       lock_count_(0),
+      spin_budget_(kMinSpinBudget),
+      spin_skips_(0),
       obj_(obj),
       wait_set_(NULL),
+      wake_set_(NULL),
       hash_code_(hash_code),
       locking_method_(NULL),
       locking_dex_pc_(0),
@@ -107,6 +121,17 @@ int32_t Monitor::GetHashCode() {
   return hash_code_.LoadRelaxed();
 }
 
+bool Monitor::GetInstalledHashCode(int32_t* hash_code) {
+  // Generating the hash under monitor_lock_ orders it with a concurrent deflation, which either
+  // sees the hash or has already let go of the object.
+  MutexLock mu(Thread::Current(), monitor_lock_);
+  if (UNLIKELY(obj_ == nullptr)) {
+    return false;
+  }
+  *hash_code = GetHashCode();
+  return true;
+}
+
 bool Monitor::Install(Thread* self) {
   MutexLock mu(self, monitor_lock_);  // Uncontended mutex acquisition as monitor isn't yet public.
   CHECK(owner_ == nullptr || owner_ == self || owner_->IsSuspended());
@@ -118,6 +143,16 @@ bool Monitor::Install(Thread* self) {
       lock_count_ = lw.ThinLockCount();
       break;
     }
+    case LockWord::kBiasLocked: {
+      CHECK_EQ(owner_->GetThreadId(), lw.ThinLockOwner());
+      if (lw.ThinLockCount() == 0) {
+        // The bias is revoked while the owner doesn't hold the lock.
+        owner_ = nullptr;
+      } else {
+        lock_count_ = lw.ThinLockCount() - 1;
+      }
+      break;
+    }
     case LockWord::kHashCode: {
       CHECK_EQ(hash_code_.LoadRelaxed(), static_cast<int32_t>(lw.GetHashCode()));
       break;
@@ -139,7 +174,7 @@ bool Monitor::Install(Thread* self) {
   // Publish the updated lock word, which may race with other threads.
   bool success = GetObject()->CasLockWord(lw, fat);
   // Lock profiling.
-  if (success && owner_ != nullptr && lock_profiling_threshold_ != 0) {
+  if (success && owner_ != nullptr && RecordsLockingMethod()) {
     locking_method_ = owner_->GetCurrentMethod(&locking_dex_pc_);
   }
   return success;
@@ -171,6 +206,44 @@ void Monitor::AppendToWaitSet(Thread* thread) {
   t->SetWaitNext(thread);
 }
 
+// Unlinks a thread from a list linked through Thread::wait_next_, returns whether it was in it.
+static bool RemoveFromWaitList(Thread** list, Thread* thread) {
+  if (*list == NULL) {
+    return false;
+  }
+  if (*list == thread) {
+    *list = thread->GetWaitNext();
+    thread->SetWaitNext(nullptr);
+    return true;
+  }
+
+  Thread* t = *list;
+  while (t->GetWaitNext() != NULL) {
+    if (t->GetWaitNext() == thread) {
+      t->SetWaitNext(thread->GetWaitNext());
+      thread->SetWaitNext(nullptr);
+      return true;
+    }
+    t = t->GetWaitNext();
+  }
+  return false;
+}
+
+/*
+ * Links a list of notified threads at the end of the wake set.
+ */
+void Monitor::AppendToWakeSet(Thread* threads) {
+  if (wake_set_ == NULL) {
+    wake_set_ = threads;
+    return;
+  }
+  Thread* t = wake_set_;
+  while (t->GetWaitNext() != nullptr) {
+    t = t->GetWaitNext();
+  }
+  t->SetWaitNext(threads);
+}
+
 /*
  * Unlinks a thread from a monitor's wait set.  The monitor lock must
  * be held by the caller of this routine.
@@ -178,23 +251,24 @@ void Monitor::AppendToWaitSet(Thread* thread) {
 void Monitor::RemoveFromWaitSet(Thread *thread) {
   DCHECK(owner_ == Thread::Current());
   DCHECK(thread != NULL);
-  if (wait_set_ == NULL) {
-    return;
+  if (!RemoveFromWaitList(&wait_set_, thread)) {
+    // Notified, but woke up on its own (timeout, interrupt or spuriously) before being woken.
+    RemoveFromWaitList(&wake_set_, thread);
   }
-  if (wait_set_ == thread) {
-    wait_set_ = thread->GetWaitNext();
+}
+
+void Monitor::WakeNotifiedWaiter(Thread* self) {
+  while (wake_set_ != NULL) {
+    Thread* thread = wake_set_;
+    wake_set_ = thread->GetWaitNext();
     thread->SetWaitNext(nullptr);
-    return;
-  }
 
-  Thread* t = wait_set_;
-  while (t->GetWaitNext() != NULL) {
-    if (t->GetWaitNext() == thread) {
-      t->SetWaitNext(thread->GetWaitNext());
-      thread->SetWaitNext(nullptr);
+    // Skip threads which already woke up on their own and are on their way to relock.
+    MutexLock mu(self, *thread->GetWaitMutex());
+    if (thread->GetWaitMonitor() != nullptr) {
+      thread->GetWaitConditionVariable()->Signal(self);
       return;
     }
-    t = t->GetWaitNext();
   }
 }
 
@@ -202,25 +276,79 @@ void Monitor::SetObject(mirror::Object* object) {
   obj_ = object;
 }
 
-void Monitor::Lock(Thread* self) {
+// Hints the processor that we are in a spin loop.
+static inline void SpinPause() {
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+  __asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+bool Monitor::SpinWhileOwned(Thread* self) {
+  if (spin_budget_ == 0) {
+    // Spinning recently failed, only try again once in a while in case the owners changed.
+    if (++spin_skips_ < kSpinRetryInterval) {
+      return false;
+    }
+    spin_skips_ = 0;
+    spin_budget_ = kMinSpinBudget;
+  }
+  const uint32_t budget = spin_budget_;
+  uint32_t spins = 0;
+  monitor_lock_.Unlock(self);
+  // The monitor may be deflated once it is released, Lock checks for that. Stop early if we need
+  // to suspend.
+  while (spins < budget && IsOwnedRacy() && !self->ReadFlag(kSuspendRequest)) {
+    SpinPause();
+    ++spins;
+  }
+  monitor_lock_.Lock(self);
+  if (owner_ == nullptr) {
+    // Move the budget towards twice the time the owner still held the lock.
+    const uint32_t new_budget = budget / 2 + spins;
+    spin_budget_ = (new_budget < kMinSpinBudget) ? kMinSpinBudget
+        : ((new_budget > kMaxSpinBudget) ? kMaxSpinBudget : new_budget);
+    return true;
+  }
+  // Spinning failed, halve the budget and stop spinning once it gets too small.
+  spin_budget_ = (budget / 2 < kMinSpinBudget) ? 0 : budget / 2;
+  return false;
+}
+
+bool Monitor::Lock(Thread* self) {
   MutexLock mu(self, monitor_lock_);
   while (true) {
+    // An unowned monitor without waiters can be deflated concurrently, it is only safe to take it
+    // while it is still installed. Deflation also holds monitor_lock_, this is the handshake.
+    if (UNLIKELY(obj_ == nullptr)) {
+      DCHECK(owner_ == nullptr);
+      return false;
+    }
     if (owner_ == nullptr) {  // Unowned.
       owner_ = self;
       CHECK_EQ(lock_count_, 0);
       // When debugging, save the current monitor holder for future
       // acquisition failures to use in sampled logging.
-      if (lock_profiling_threshold_ != 0) {
+      if (RecordsLockingMethod()) {
         locking_method_ = self->GetCurrentMethod(&locking_dex_pc_);
       }
-      return;
+      return true;
     } else if (owner_ == self) {  // Recursive.
       lock_count_++;
-      return;
+      return true;
+    }
+    // Contended. Short critical sections are cheaper to wait for than to block on.
+    if (SpinWhileOwned(self)) {
+      continue;  // Try to take the released lock.
     }
-    // Contended.
     const bool log_contention = (lock_profiling_threshold_ != 0);
-    uint64_t wait_start_ms = log_contention ? 0 : MilliTime();
+    uint64_t wait_start_ms = log_contention ? MilliTime() : 0;
+    const bool profile_contention =
+        ContentionProfiler::IsEnabled() && ContentionProfiler::ShouldSample();
+    uint64_t wait_start_ns = profile_contention ? NanoTime() : 0;
+    uint64_t owner_tid = profile_contention ? owner_->GetTid() : 0;
+    bool waited = false;
     mirror::ArtMethod* owners_method = locking_method_;
     uint32_t owners_dex_pc = locking_dex_pc_;
     // Do this before releasing the lock so that we don't get deflated.
@@ -232,6 +360,7 @@ void Monitor::Lock(Thread* self) {
       MutexLock mu2(self, monitor_lock_);  // Reacquire monitor_lock_ without mutator_lock_ for Wait.
       if (owner_ != NULL) {  // Did the owner_ give the lock up?
         monitor_contenders_.Wait(self);  // Still contended so wait.
+        waited = true;
         // Woken from contention.
         if (log_contention) {
           uint64_t wait_ms = MilliTime() - wait_start_ms;
@@ -251,11 +380,34 @@ void Monitor::Lock(Thread* self) {
       }
     }
     self->SetMonitorEnterObject(nullptr);
+    if (profile_contention && waited) {
+      ProfileContention(self, owner_tid, owners_method, owners_dex_pc, NanoTime() - wait_start_ns);
+    }
     monitor_lock_.Lock(self);  // Reacquire locks in order.
     --num_waiters_;
   }
 }
 
+bool Monitor::RecordsLockingMethod() {
+  return lock_profiling_threshold_ != 0 || ContentionProfiler::IsEnabled();
+}
+
+void Monitor::ProfileContention(Thread* self, uint64_t owner_tid, mirror::ArtMethod* owners_method,
+                                uint32_t owners_dex_pc, uint64_t wait_ns) {
+  std::string lock_name("monitor of ");
+  lock_name += PrettyTypeOf(GetObject());
+  std::string owner_site;
+  if (owners_method != nullptr) {
+    const char* owners_filename;
+    uint32_t owners_line_number;
+    TranslateLocation(owners_method, owners_dex_pc, &owners_filename, &owners_line_number);
+    owner_site = StringPrintf("%s (%s:%u)", PrettyMethod(owners_method).c_str(), owners_filename,
+                              owners_line_number);
+  }
+  ContentionProfiler::RecordContention(lock_name.c_str(), owner_site.c_str(), self->GetTid(),
+                                       owner_tid, wait_ns);
+}
+
 static void ThrowIllegalMonitorStateExceptionF(const char* fmt, ...)
                                               __attribute__((format(printf, 1, 2)));
 
@@ -354,8 +506,9 @@ bool Monitor::Unlock(Thread* self) {
       owner_ = NULL;
       locking_method_ = NULL;
       locking_dex_pc_ = 0;
-      // Wake a contender.
+      // Wake a contender, and a notified waiter which will contend for the monitor once woken.
       monitor_contenders_.Signal(self);
+      WakeNotifiedWaiter(self);
     } else {
       --lock_count_;
     }
@@ -440,6 +593,9 @@ void Monitor::Wait(Thread* self, int64_t ms, int32_t ns,
   locking_method_ = NULL;
   uintptr_t saved_dex_pc = locking_dex_pc_;
   locking_dex_pc_ = 0;
+  // Releasing the monitor hands it to a notified waiter like Unlock. This takes the waiter's wait
+  // mutex, so it is done before taking our own.
+  WakeNotifiedWaiter(self);
 
   /*
    * Update thread state. If the GC wakes up, it'll ignore us, knowing
@@ -494,8 +650,9 @@ void Monitor::Wait(Thread* self, int64_t ms, int32_t ns,
     self->SetWaitMonitor(nullptr);
   }
 
-  // Re-acquire the monitor and lock.
-  Lock(self);
+  // Re-acquire the monitor and lock. We're counted as a waiter, so it can't have been deflated.
+  bool locked = Lock(self);
+  DCHECK(locked);
   monitor_lock_.Lock(self);
   self->GetWaitMutex()->AssertNotHeld(self);
 
@@ -540,7 +697,8 @@ void Monitor::Notify(Thread* self) {
     ThrowIllegalMonitorStateExceptionF("object not locked by thread before notify()");
     return;
   }
-  // Signal the first waiting thread in the wait set.
+  // Move the first waiting thread of the wait set to the wake set. It is woken when the monitor is
+  // released, since it could not make progress before.
   while (wait_set_ != NULL) {
     Thread* thread = wait_set_;
     wait_set_ = thread->GetWaitNext();
@@ -549,7 +707,7 @@ void Monitor::Notify(Thread* self) {
     // Check to see if the thread is still waiting.
     MutexLock mu(self, *thread->GetWaitMutex());
     if (thread->GetWaitMonitor() != nullptr) {
-      thread->GetWaitConditionVariable()->Signal(self);
+      AppendToWakeSet(thread);
       return;
     }
   }
@@ -563,54 +721,37 @@ void Monitor::NotifyAll(Thread* self) {
     ThrowIllegalMonitorStateExceptionF("object not locked by thread before notifyAll()");
     return;
   }
-  // Signal all threads in the wait set.
-  while (wait_set_ != NULL) {
-    Thread* thread = wait_set_;
-    wait_set_ = thread->GetWaitNext();
-    thread->SetWaitNext(nullptr);
-    thread->Notify();
+  // Move all threads of the wait set to the wake set, the monitor wakes them one per release.
+  if (wait_set_ != NULL) {
+    AppendToWakeSet(wait_set_);
+    wait_set_ = NULL;
   }
 }
 
-bool Monitor::Deflate(Thread* self, mirror::Object* obj) {
-  DCHECK(obj != nullptr);
-  // Don't need volatile since we only deflate with mutators suspended.
-  LockWord lw(obj->GetLockWord(false));
-  // If the lock isn't an inflated monitor, then we don't need to deflate anything.
-  if (lw.GetState() == LockWord::kFatLocked) {
-    Monitor* monitor = lw.FatLockMonitor();
-    DCHECK(monitor != nullptr);
-    MutexLock mu(self, monitor->monitor_lock_);
-    // Can't deflate if we have anybody waiting on the CV.
-    if (monitor->num_waiters_ > 0) {
-      return false;
-    }
-    Thread* owner = monitor->owner_;
-    if (owner != nullptr) {
-      // Can't deflate if we are locked and have a hash code.
-      if (monitor->HasHashCode()) {
-        return false;
-      }
-      // Can't deflate if our lock count is too high.
-      if (monitor->lock_count_ > LockWord::kThinLockMaxCount) {
-        return false;
-      }
-      // Deflate to a thin lock.
-      obj->SetLockWord(LockWord::FromThinLockId(owner->GetThreadId(), monitor->lock_count_), false);
-      VLOG(monitor) << "Deflated " << obj << " to thin lock " << owner->GetTid() << " / "
-          << monitor->lock_count_;
-    } else if (monitor->HasHashCode()) {
-      obj->SetLockWord(LockWord::FromHashCode(monitor->GetHashCode()), false);
-      VLOG(monitor) << "Deflated " << obj << " to hash monitor " << monitor->GetHashCode();
-    } else {
-      // No lock and no hash, just put an empty lock word inside the object.
-      obj->SetLockWord(LockWord(), false);
-      VLOG(monitor) << "Deflated" << obj << " to empty lock word";
-    }
-    // The monitor is deflated, mark the object as nullptr so that we know to delete it during the
-    // next GC.
-    monitor->obj_ = nullptr;
+bool Monitor::DeflateIfIdle(Thread* self) {
+  MutexLock mu(self, monitor_lock_);
+  mirror::Object* obj = GetObject();
+  if (obj == nullptr) {
+    return true;  // Already deflated.
+  }
+  // Can't deflate if the monitor is held or if we have anybody waiting on the CV. Threads that
+  // are about to lock the monitor check that it is still installed once they hold monitor_lock_.
+  if (owner_ != nullptr || num_waiters_ > 0) {
+    return false;
   }
+  DCHECK(wait_set_ == nullptr);
+  DCHECK(wake_set_ == nullptr);
+  LockWord lw(obj->GetLockWord(true));
+  DCHECK_EQ(lw.GetState(), LockWord::kFatLocked);
+  DCHECK_EQ(lw.FatLockMonitor(), this);
+  LockWord deflated = HasHashCode() ? LockWord::FromHashCode(GetHashCode()) : LockWord();
+  if (!obj->CasLockWord(lw, deflated)) {
+    return false;
+  }
+  VLOG(monitor) << "Deflated " << obj << " to " << (HasHashCode() ? "hash monitor" : "empty")
+      << " lock word";
+  // The object no longer refers to us, make concurrent lockers read the lock word again.
+  obj_ = nullptr;
   return true;
 }
 
@@ -622,9 +763,31 @@ bool Monitor::Deflate(Thread* self, mirror::Object* obj) {
 void Monitor::Inflate(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code) {
   DCHECK(self != NULL);
   DCHECK(obj != NULL);
-  // Allocate and acquire a new monitor.
-  std::unique_ptr<Monitor> m(new Monitor(self, owner, obj, hash_code));
-  if (m->Install(self)) {
+  MonitorList* monitor_list = Runtime::Current()->GetMonitorList();
+  std::unique_ptr<Monitor> m;
+  bool installed;
+  LockWord lock_word = obj->GetLockWord(true);
+  if (hash_code == 0 && lock_word.GetState() == LockWord::kBiasLocked) {
+    // Move the hash code kept on the side into the monitor. The owner of the bias is self or
+    // suspended, the shard stays locked until the monitor is installed so that a racing inflation
+    // doesn't install a monitor without the hash code.
+    MonitorList::Shard& shard = monitor_list->ShardOf(lock_word.ThinLockOwner());
+    MutexLock mu(self, shard.monitor_list_lock);
+    auto it = shard.biased_hash_codes.find(obj);
+    if (it != shard.biased_hash_codes.end()) {
+      hash_code = it->second;
+    }
+    m.reset(new Monitor(self, owner, obj, hash_code));
+    installed = m->Install(self);
+    if (installed && it != shard.biased_hash_codes.end()) {
+      shard.biased_hash_codes.erase(it);
+    }
+  } else {
+    // Allocate and acquire a new monitor.
+    m.reset(new Monitor(self, owner, obj, hash_code));
+    installed = m->Install(self);
+  }
+  if (installed) {
     if (owner != nullptr) {
       VLOG(monitor) << "monitor: thread" << owner->GetThreadId()
           << " created monitor " << m.get() << " for object " << obj;
@@ -632,14 +795,15 @@ void Monitor::Inflate(Thread* self, Thread* owner, mirror::Object* obj, int32_t
       VLOG(monitor) << "monitor: Inflate with hashcode " << hash_code
           << " created monitor " << m.get() << " for object " << obj;
     }
-    Runtime::Current()->GetMonitorList()->Add(m.release());
+    monitor_list->Add(m.release());
     CHECK_EQ(obj->GetLockWord(true).GetState(), LockWord::kFatLocked);
   }
 }
 
 void Monitor::InflateThinLocked(Thread* self, Handle<mirror::Object> obj, LockWord lock_word,
                                 uint32_t hash_code) {
-  DCHECK_EQ(lock_word.GetState(), LockWord::kThinLocked);
+  DCHECK(lock_word.GetState() == LockWord::kThinLocked ||
+         lock_word.GetState() == LockWord::kBiasLocked) << lock_word.GetState();
   uint32_t owner_thread_id = lock_word.ThinLockOwner();
   if (owner_thread_id == self->GetThreadId()) {
     // We own the monitor, we can easily inflate it.
@@ -657,17 +821,47 @@ void Monitor::InflateThinLocked(Thread* self, Handle<mirror::Object> obj, LockWo
     if (owner != nullptr) {
       // We succeeded in suspending the thread, check the lock's status didn't change.
       lock_word = obj->GetLockWord(true);
-      if (lock_word.GetState() == LockWord::kThinLocked &&
+      if ((lock_word.GetState() == LockWord::kThinLocked ||
+           lock_word.GetState() == LockWord::kBiasLocked) &&
           lock_word.ThinLockOwner() == owner_thread_id) {
         // Go ahead and inflate the lock.
         Inflate(self, owner, obj.Get(), hash_code);
       }
       thread_list->Resume(owner, false);
+    } else if (lock_word.GetState() == LockWord::kBiasLocked && lock_word.ThinLockCount() == 0) {
+      // The bias can't be revoked by suspending the owner once it has exited, unlock the object.
+      if (thread_list->RevokeExitedThreadBias(self, obj.Get(), owner_thread_id)) {
+        VLOG(monitor) << "monitor: thread " << self->GetThreadId() << " unlocked " << obj.Get()
+            << " biased towards exited thread " << owner_thread_id;
+      }
     }
     self->SetMonitorEnterObject(nullptr);
   }
 }
 
+bool Monitor::GetOwnedLockHashCode(Thread* self, mirror::Object* obj, LockWord lock_word,
+                                   int32_t* hash_code) {
+  uint32_t thread_id = self->GetThreadId();
+  DCHECK_EQ(lock_word.ThinLockOwner(), thread_id);
+  LockWord biased = lock_word;
+  if (lock_word.GetState() == LockWord::kThinLocked) {
+    // A biased lock counts the holds rather than the recursive acquisitions.
+    uint32_t hold_count = lock_word.ThinLockCount() + 1;
+    if (hold_count > LockWord::kThinLockMaxCount) {
+      return false;
+    }
+    biased = LockWord::FromBiasedLockId(thread_id, hold_count);
+  } else {
+    DCHECK_EQ(lock_word.GetState(), LockWord::kBiasLocked);
+  }
+  *hash_code = Runtime::Current()->GetMonitorList()->GetOrAddBiasedHashCode(self, obj);
+  if (!(biased == lock_word)) {
+    // Only the owner changes the lock word of a thin or biased lock, other threads suspend it.
+    obj->SetLockWord(biased, false);
+  }
+  return true;
+}
+
 // Fool annotalysis into thinking that the lock on obj is acquired.
 static mirror::Object* FakeLock(mirror::Object* obj)
     EXCLUSIVE_LOCK_FUNCTION(obj) NO_THREAD_SAFETY_ANALYSIS {
@@ -692,7 +886,8 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
     LockWord lock_word = h_obj->GetLockWord(true);
     switch (lock_word.GetState()) {
       case LockWord::kUnlocked: {
-        LockWord thin_locked(LockWord::FromThinLockId(thread_id, 0));
+        LockWord thin_locked(use_biased_locking_ ? LockWord::FromBiasedLockId(thread_id, 1)
+                                                 : LockWord::FromThinLockId(thread_id, 0));
         if (h_obj->CasLockWord(lock_word, thin_locked)) {
           QuasiAtomic::MembarLoadLoad();
           return h_obj.Get();  // Success!
@@ -716,7 +911,12 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
           // Contention.
           contention_count++;
           Runtime* runtime = Runtime::Current();
-          if (contention_count <= runtime->GetMaxSpinsBeforeThinkLockInflation()) {
+          if (contention_count <= kThinLockBusySpins) {
+            // Most thin locks are held briefly, re-attempt without a syscall first.
+            for (size_t i = 0; i < kThinLockSpinPauses; ++i) {
+              SpinPause();
+            }
+          } else if (contention_count <= runtime->GetMaxSpinsBeforeThinkLockInflation()) {
             NanoSleep(1000);  // Sleep for 1us and re-attempt.
           } else {
             contention_count = 0;
@@ -725,10 +925,28 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
         }
         continue;  // Start from the beginning.
       }
+      case LockWord::kBiasLocked: {
+        if (lock_word.ThinLockOwner() == thread_id) {
+          // Only we change the lock word of a lock biased towards us, no atomics are needed.
+          uint32_t new_count = lock_word.ThinLockCount() + 1;
+          if (LIKELY(new_count <= LockWord::kThinLockMaxCount)) {
+            h_obj->SetLockWord(LockWord::FromBiasedLockId(thread_id, new_count), false);
+            return h_obj.Get();  // Success!
+          }
+        } else {
+          VLOG(monitor) << "monitor: thread " << thread_id << " revoking bias of " << h_obj.Get()
+              << " towards thread " << lock_word.ThinLockOwner();
+        }
+        // Overflow or another thread's bias, inflate the monitor.
+        InflateThinLocked(self, h_obj, lock_word, 0);
+        continue;  // Start from the beginning.
+      }
       case LockWord::kFatLocked: {
         Monitor* mon = lock_word.FatLockMonitor();
-        mon->Lock(self);
-        return h_obj.Get();  // Success!
+        if (mon->Lock(self)) {
+          return h_obj.Get();  // Success!
+        }
+        continue;  // Deflated meanwhile, start from the beginning.
       }
       case LockWord::kHashCode:
         // Inflate with the existing hashcode.
@@ -776,6 +994,25 @@ bool Monitor::MonitorExit(Thread* self, mirror::Object* obj) {
         return true;  // Success!
       }
     }
+    case LockWord::kBiasLocked: {
+      uint32_t thread_id = self->GetThreadId();
+      uint32_t owner_thread_id = lock_word.ThinLockOwner();
+      if (owner_thread_id != thread_id) {
+        Thread* owner =
+            Runtime::Current()->GetThreadList()->FindThreadByThreadId(owner_thread_id);
+        FailedUnlock(h_obj.Get(), self, owner, nullptr);
+        return false;  // Failure.
+      } else if (lock_word.ThinLockCount() == 0) {
+        // Biased towards us but not held.
+        FailedUnlock(h_obj.Get(), self, nullptr, nullptr);
+        return false;  // Failure.
+      } else {
+        // Keep the bias when releasing the lock.
+        uint32_t new_count = lock_word.ThinLockCount() - 1;
+        h_obj->SetLockWord(LockWord::FromBiasedLockId(thread_id, new_count), false);
+        return true;  // Success!
+      }
+    }
     case LockWord::kFatLocked: {
       Monitor* mon = lock_word.FatLockMonitor();
       return mon->Unlock(self);
@@ -814,6 +1051,16 @@ void Monitor::Wait(Thread* self, mirror::Object *obj, int64_t ms, int32_t ns,
       }
       break;
     }
+    case LockWord::kBiasLocked: {
+      if (lock_word.ThinLockOwner() != self->GetThreadId() || lock_word.ThinLockCount() == 0) {
+        ThrowIllegalMonitorStateExceptionF("object not locked by thread before wait()");
+        return;  // Failure.
+      }
+      // We hold the lock, inflate to enqueue ourself on the Monitor.
+      Inflate(self, self, obj, 0);
+      lock_word = obj->GetLockWord(true);
+      break;
+    }
     case LockWord::kFatLocked:
       break;  // Already set for a wait.
     default: {
@@ -846,6 +1093,13 @@ void Monitor::DoNotify(Thread* self, mirror::Object* obj, bool notify_all) {
         return;  // Success.
       }
     }
+    case LockWord::kBiasLocked: {
+      if (lock_word.ThinLockOwner() != self->GetThreadId() || lock_word.ThinLockCount() == 0) {
+        ThrowIllegalMonitorStateExceptionF("object not locked by thread before notify()");
+      }
+      // Otherwise we hold the lock but there's no Monitor and therefore no waiters.
+      return;
+    }
     case LockWord::kFatLocked: {
       Monitor* mon = lock_word.FatLockMonitor();
       if (notify_all) {
@@ -872,6 +1126,9 @@ uint32_t Monitor::GetLockOwnerThreadId(mirror::Object* obj) {
       return ThreadList::kInvalidThreadId;
     case LockWord::kThinLocked:
       return lock_word.ThinLockOwner();
+    case LockWord::kBiasLocked:
+      return lock_word.ThinLockCount() != 0 ? lock_word.ThinLockOwner()
+                                            : ThreadList::kInvalidThreadId;
     case LockWord::kFatLocked: {
       Monitor* mon = lock_word.FatLockMonitor();
       return mon->GetOwnerThreadId();
@@ -909,7 +1166,8 @@ void Monitor::DescribeWait(std::ostream& os, const Thread* thread) {
     if (pretty_object == nullptr) {
       os << wait_message << "an unknown object";
     } else {
-      if ((pretty_object->GetLockWord(true).GetState() == LockWord::kThinLocked) &&
+      LockWord::LockState lock_state = pretty_object->GetLockWord(true).GetState();
+      if ((lock_state == LockWord::kThinLocked || lock_state == LockWord::kBiasLocked) &&
           Locks::mutator_lock_->IsExclusiveHeld(Thread::Current())) {
         // Getting the identity hashcode here would result in lock inflation and suspension of the
         // current thread, which isn't safe if this is the only runnable thread.
@@ -1013,16 +1271,20 @@ bool Monitor::IsValidLockWord(LockWord lock_word) {
       // Nothing to check.
       return true;
     case LockWord::kThinLocked:
+      // Fall-through.
+    case LockWord::kBiasLocked:
       // Basic sanity check of owner.
       return lock_word.ThinLockOwner() != ThreadList::kInvalidThreadId;
     case LockWord::kFatLocked: {
       // Check the  monitor appears in the monitor list.
       Monitor* mon = lock_word.FatLockMonitor();
       MonitorList* list = Runtime::Current()->GetMonitorList();
-      MutexLock mu(Thread::Current(), list->monitor_list_lock_);
-      for (Monitor* list_mon : list->list_) {
-        if (mon == list_mon) {
-          return true;  // Found our monitor.
+      for (MonitorList::Shard& shard : list->shards_) {
+        MutexLock mu(Thread::Current(), shard.monitor_list_lock);
+        for (Monitor* list_mon : shard.list) {
+          if (mon == list_mon) {
+            return true;  // Found our monitor.
+          }
         }
       }
       return false;  // Fail - unowned monitor in an object.
@@ -1066,71 +1328,165 @@ uint32_t Monitor::GetOwnerThreadId() {
   }
 }
 
-MonitorList::MonitorList()
-    : allow_new_monitors_(true), monitor_list_lock_("MonitorList lock", kMonitorListLock),
-      monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_) {
+MonitorList::Shard::Shard()
+    : allow_new_monitors(true), monitor_list_lock("MonitorList lock", kMonitorListLock),
+      monitor_add_condition("MonitorList disallow condition", monitor_list_lock) {
+}
+
+MonitorList::MonitorList() {
 }
 
 MonitorList::~MonitorList() {
-  MutexLock mu(Thread::Current(), monitor_list_lock_);
-  STLDeleteElements(&list_);
+  Thread* self = Thread::Current();
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.monitor_list_lock);
+    STLDeleteElements(&shard.list);
+  }
 }
 
 void MonitorList::DisallowNewMonitors() {
-  MutexLock mu(Thread::Current(), monitor_list_lock_);
-  allow_new_monitors_ = false;
+  Thread* self = Thread::Current();
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.monitor_list_lock);
+    shard.allow_new_monitors = false;
+  }
 }
 
 void MonitorList::AllowNewMonitors() {
   Thread* self = Thread::Current();
-  MutexLock mu(self, monitor_list_lock_);
-  allow_new_monitors_ = true;
-  monitor_add_condition_.Broadcast(self);
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.monitor_list_lock);
+    shard.allow_new_monitors = true;
+    shard.monitor_add_condition.Broadcast(self);
+  }
 }
 
 void MonitorList::Add(Monitor* m) {
   Thread* self = Thread::Current();
-  MutexLock mu(self, monitor_list_lock_);
-  while (UNLIKELY(!allow_new_monitors_)) {
-    monitor_add_condition_.WaitHoldingLocks(self);
+  Shard& shard = shards_[self->GetThreadId() % kNumShards];
+  MutexLock mu(self, shard.monitor_list_lock);
+  while (UNLIKELY(!shard.allow_new_monitors)) {
+    shard.monitor_add_condition.WaitHoldingLocks(self);
   }
-  list_.push_front(m);
+  shard.list.push_front(m);
 }
 
-void MonitorList::SweepMonitorList(IsMarkedCallback* callback, void* arg) {
-  MutexLock mu(Thread::Current(), monitor_list_lock_);
-  for (auto it = list_.begin(); it != list_.end(); ) {
-    Monitor* m = *it;
-    // Disable the read barrier in GetObject() as this is called by GC.
-    mirror::Object* obj = m->GetObject<kWithoutReadBarrier>();
-    // The object of a monitor can be null if we have deflated it.
-    mirror::Object* new_obj = obj != nullptr ? callback(obj, arg) : nullptr;
-    if (new_obj == nullptr) {
-      VLOG(monitor) << "freeing monitor " << m << " belonging to unmarked object "
-                    << obj;
-      delete m;
-      it = list_.erase(it);
+int32_t MonitorList::GetOrAddBiasedHashCode(Thread* self, mirror::Object* obj) {
+  Shard& shard = ShardOf(self->GetThreadId());
+  MutexLock mu(self, shard.monitor_list_lock);
+  auto it = shard.biased_hash_codes.find(obj);
+  if (it != shard.biased_hash_codes.end()) {
+    return it->second;
+  }
+  // Like the new monitors, the new entries wait for the sweeping to finish.
+  while (UNLIKELY(!shard.allow_new_monitors)) {
+    shard.monitor_add_condition.WaitHoldingLocks(self);
+  }
+  int32_t hash_code = mirror::Object::GenerateIdentityHashCode();
+  shard.biased_hash_codes.insert(std::make_pair(obj, hash_code));
+  return hash_code;
+}
+
+void MonitorList::RevokeBiasedHashCodes(Thread* self) {
+  uint32_t thread_id = self->GetThreadId();
+  Shard& shard = ShardOf(thread_id);
+  MutexLock mu(self, shard.monitor_list_lock);
+  for (auto it = shard.biased_hash_codes.begin(); it != shard.biased_hash_codes.end(); ) {
+    mirror::Object* obj = it->first;
+    LockWord lock_word = obj->GetLockWord(true);
+    if (lock_word.GetState() == LockWord::kBiasLocked && lock_word.ThinLockOwner() == thread_id &&
+        lock_word.ThinLockCount() == 0) {
+      // Only we change the lock word of a lock biased towards us.
+      obj->SetLockWord(LockWord::FromHashCode(it->second), true);
+      it = shard.biased_hash_codes.erase(it);
     } else {
-      m->SetObject(new_obj);
       ++it;
     }
   }
 }
 
-static mirror::Object* MonitorDeflateCallback(mirror::Object* object, void* arg)
-    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  if (Monitor::Deflate(reinterpret_cast<Thread*>(arg), object)) {
-    DCHECK_NE(object->GetLockWord(true).GetState(), LockWord::kFatLocked);
-    // If we deflated, return nullptr so that the monitor gets removed from the array.
-    return nullptr;
+void MonitorList::SweepMonitorList(IsMarkedCallback* callback, void* arg) {
+  Thread* self = Thread::Current();
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.monitor_list_lock);
+    for (auto it = shard.list.begin(); it != shard.list.end(); ) {
+      Monitor* m = *it;
+      // Disable the read barrier in GetObject() as this is called by GC.
+      mirror::Object* obj = m->GetObject<kWithoutReadBarrier>();
+      // The object of a monitor can be null if we have deflated it.
+      mirror::Object* new_obj = obj != nullptr ? callback(obj, arg) : nullptr;
+      if (new_obj == nullptr) {
+        VLOG(monitor) << "freeing monitor " << m << " belonging to unmarked object "
+                      << obj;
+        delete m;
+        it = shard.list.erase(it);
+      } else {
+        m->SetObject(new_obj);
+        ++it;
+      }
+    }
+    std::vector<std::pair<mirror::Object*, int32_t>> moved;
+    for (auto it = shard.biased_hash_codes.begin(); it != shard.biased_hash_codes.end(); ) {
+      mirror::Object* new_obj = callback(it->first, arg);
+      if (new_obj == it->first) {
+        ++it;
+        continue;
+      }
+      if (new_obj != nullptr) {
+        moved.push_back(std::make_pair(new_obj, it->second));
+      }
+      it = shard.biased_hash_codes.erase(it);
+    }
+    shard.biased_hash_codes.insert(moved.begin(), moved.end());
   }
-  return object;  // Monitor was not deflated.
 }
 
+class DeflationCheckpoint : public Closure {
+ public:
+  explicit DeflationCheckpoint(Barrier* barrier) : barrier_(barrier) {
+  }
+
+  virtual void Run(Thread* thread) OVERRIDE {
+    UNUSED(thread);
+    // Note: self is not necessarily equal to thread since thread may be suspended.
+    barrier_->Pass(Thread::Current());
+  }
+
+ private:
+  Barrier* const barrier_;
+};
+
 void MonitorList::DeflateMonitors() {
   Thread* self = Thread::Current();
-  Locks::mutator_lock_->AssertExclusiveHeld(self);
-  SweepMonitorList(MonitorDeflateCallback, reinterpret_cast<Thread*>(self));
+  std::vector<Monitor*> deflated;
+  for (Shard& shard : shards_) {
+    // Only stay runnable for a shard at a time, the deflation mustn't hold off a suspension.
+    ScopedObjectAccess soa(self);
+    MutexLock mu(self, shard.monitor_list_lock);
+    for (auto it = shard.list.begin(); it != shard.list.end(); ) {
+      Monitor* m = *it;
+      if (m->DeflateIfIdle(self)) {
+        deflated.push_back(m);
+        it = shard.list.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  if (deflated.empty()) {
+    return;
+  }
+  // Threads that read a lock word before it was deflated may still use the monitor, but they do so
+  // without passing a suspend point. Once every thread ran a checkpoint, the monitors can go.
+  Barrier barrier(0);
+  DeflationCheckpoint checkpoint(&barrier);
+  size_t barrier_count = Runtime::Current()->GetThreadList()->RunCheckpoint(&checkpoint);
+  {
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    barrier.Increment(self, barrier_count);
+  }
+  VLOG(monitor) << "Deflated " << deflated.size() << " monitors";
+  STLDeleteElements(&deflated);
 }
 
 MonitorInfo::MonitorInfo(mirror::Object* obj) : owner_(NULL), entry_count_(0) {
@@ -1148,6 +1504,13 @@ MonitorInfo::MonitorInfo(mirror::Object* obj) : owner_(NULL), entry_count_(0) {
       entry_count_ = 1 + lock_word.ThinLockCount();
       // Thin locks have no waiters.
       break;
+    case LockWord::kBiasLocked:
+      if (lock_word.ThinLockCount() != 0) {
+        owner_ = Runtime::Current()->GetThreadList()->FindThreadByThreadId(
+            lock_word.ThinLockOwner());
+        entry_count_ = lock_word.ThinLockCount();
+      }
+      break;
     case LockWord::kFatLocked: {
       Monitor* mon = lock_word.FatLockMonitor();
       owner_ = mon->owner_;
@@ -22,6 +22,7 @@
 
 #include <iosfwd>
 #include <list>
+#include <unordered_map>
 #include <vector>
 
 #include "atomic.h"
@@ -48,11 +49,23 @@ class Monitor {
   // The default number of spins that are done before thread suspension is used to forcibly inflate
   // a lock word. See Runtime::max_spins_before_thin_lock_inflation_.
   constexpr static size_t kDefaultMaxSpinsBeforeThinLockInflation = 50;
+  // The first spins on a contended thin lock busy wait kThinLockSpinPauses pauses rather than
+  // sleeping.
+  constexpr static size_t kThinLockBusySpins = 10;
+  constexpr static size_t kThinLockSpinPauses = 64;
+
+  // Bounds of the number of iterations a contender spins on a fat lock before blocking.
+  constexpr static uint32_t kMinSpinBudget = 16;
+  constexpr static uint32_t kMaxSpinBudget = 4096;
+  // After spinning failed, the number of contentions that block right away before spinning is
+  // attempted again.
+  constexpr static uint32_t kSpinRetryInterval = 16;
 
   ~Monitor();
 
   static bool IsSensitiveThread();
-  static void Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread_hook)());
+  static void Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread_hook)(),
+                   bool use_biased_locking);
 
   // Return the thread id of the lock owner or 0 when there is no owner.
   static uint32_t GetLockOwnerThreadId(mirror::Object* obj)
@@ -106,6 +119,10 @@ class Monitor {
 
   int32_t GetHashCode();
 
+  // Reads the hash code, generating it if needed, unless the monitor was deflated concurrently
+  // after the caller read it from the lock word. Returns false in that case.
+  bool GetInstalledHashCode(int32_t* hash_code) LOCKS_EXCLUDED(monitor_lock_);
+
   bool IsLocked() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   bool HasHashCode() const {
@@ -119,7 +136,19 @@ class Monitor {
   static void InflateThinLocked(Thread* self, Handle<mirror::Object> obj, LockWord lock_word,
                                 uint32_t hash_code) NO_THREAD_SAFETY_ANALYSIS;
 
-  static bool Deflate(Thread* self, mirror::Object* obj)
+  // Returns the identity hash code of obj, whose thin or biased lock is owned by self, without
+  // inflating the lock. The hash code is kept on the side and a thin lock becomes biased towards
+  // self, so that the lock word keeps naming the owner after the lock is released and other
+  // threads inflate the lock, which moves the hash code into the monitor, before they use it.
+  // Returns false if the hold count of the biased lock would overflow.
+  static bool GetOwnedLockHashCode(Thread* self, mirror::Object* obj, LockWord lock_word,
+                                   int32_t* hash_code)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Deflates the monitor if nobody owns or waits on it, other threads may be running. Returns
+  // true if the object no longer refers to the monitor.
+  bool DeflateIfIdle(Thread* self)
+      LOCKS_EXCLUDED(monitor_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
  private:
@@ -133,7 +162,12 @@ class Monitor {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void AppendToWaitSet(Thread* thread) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
+  void AppendToWakeSet(Thread* threads) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
+  // Unlinks the thread from the wait set or the wake set, whichever it is in.
   void RemoveFromWaitSet(Thread* thread) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
+  // Wakes the first thread of the wake set that is still waiting, called when the monitor is
+  // released.
+  void WakeNotifiedWaiter(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
 
   static void Inflate(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -142,13 +176,34 @@ class Monitor {
                           const char* owner_filename, uint32_t owner_line_number)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Whether owners record where they acquired the lock, for the contention event log or the
+  // ContentionProfiler.
+  static bool RecordsLockingMethod();
+
+  // Records a sampled contention with the ContentionProfiler.
+  void ProfileContention(Thread* self, uint64_t owner_tid, mirror::ArtMethod* owners_method,
+                         uint32_t owners_dex_pc, uint64_t wait_ns)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   static void FailedUnlock(mirror::Object* obj, Thread* expected_owner, Thread* found_owner, Monitor* mon)
       LOCKS_EXCLUDED(Locks::thread_list_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  void Lock(Thread* self)
+  // Returns false, without locking, if the monitor was deflated concurrently after the caller read
+  // it from the lock word. The caller needs to read the lock word again.
+  bool Lock(Thread* self)
       LOCKS_EXCLUDED(monitor_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Spins while the lock is owned, for a budget adapted to how long owners held it when previous
+  // contenders spun. Returns true if the lock was released, the caller still needs to acquire it.
+  bool SpinWhileOwned(Thread* self)
+      EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Whether the lock is owned, read without monitor_lock_ for spinning. owner_ is volatile, so
+  // each call loads it again.
+  bool IsOwnedRacy() const NO_THREAD_SAFETY_ANALYSIS {
+    return owner_ != nullptr;
+  }
   bool Unlock(Thread* thread)
       LOCKS_EXCLUDED(monitor_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -178,6 +233,8 @@ class Monitor {
 
   static bool (*is_sensitive_thread_hook_)();
   static uint32_t lock_profiling_threshold_;
+  // Whether unlocked objects locked by the runtime are biased towards the locking thread.
+  static bool use_biased_locking_;
 
   Mutex monitor_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
@@ -192,6 +249,12 @@ class Monitor {
   // Owner's recursive lock depth.
   int lock_count_ GUARDED_BY(monitor_lock_);
 
+  // Number of iterations contenders spin before blocking, zero after spinning kept failing.
+  uint32_t spin_budget_ GUARDED_BY(monitor_lock_);
+
+  // Contentions that didn't spin since the spin budget dropped to zero.
+  uint32_t spin_skips_ GUARDED_BY(monitor_lock_);
+
   // What object are we part of. This is a weak root. Do not access
   // this directly, use GetObject() to read it so it will be guarded
   // by a read barrier.
@@ -200,6 +263,11 @@ class Monitor {
   // Threads currently waiting on this monitor.
   Thread* wait_set_ GUARDED_BY(monitor_lock_);
 
+  // Threads notified while waiting on this monitor, which are still parked on their wait
+  // condition variable. Notify only moves threads here and the monitor wakes them one at a time
+  // as it is released, rather than having every notified thread contend for it at once.
+  Thread* wake_set_ GUARDED_BY(monitor_lock_);
+
   // Stored object hash code, generated lazily by GetHashCode.
   AtomicInteger hash_code_;
 
@@ -226,21 +294,46 @@ class MonitorList {
   void Add(Monitor* m);
 
   void SweepMonitorList(IsMarkedCallback* callback, void* arg)
-      LOCKS_EXCLUDED(monitor_list_lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  void DisallowNewMonitors() LOCKS_EXCLUDED(monitor_list_lock_);
-  void AllowNewMonitors() LOCKS_EXCLUDED(monitor_list_lock_);
-  void DeflateMonitors() LOCKS_EXCLUDED(monitor_list_lock_)
-      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void DisallowNewMonitors();
+  void AllowNewMonitors();
+  // Returns the identity hash code kept on the side for obj, whose lock is biased towards self,
+  // generating it if there's none yet.
+  int32_t GetOrAddBiasedHashCode(Thread* self, mirror::Object* obj)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Moves the identity hash codes kept on the side for the released locks biased towards self
+  // into their lock words, called when self exits.
+  void RevokeBiasedHashCodes(Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Deflates the idle monitors while the mutators keep running, one shard at a time.
+  void DeflateMonitors()
+      LOCKS_EXCLUDED(Locks::mutator_lock_, Locks::thread_list_lock_);
 
  private:
-  // During sweeping we may free an object and on a separate thread have an object created using
-  // the newly freed memory. That object may then have its lock-word inflated and a monitor created.
-  // If we allow new monitor registration during sweeping this monitor may be incorrectly freed as
-  // the object wasn't marked when sweeping began.
-  bool allow_new_monitors_ GUARDED_BY(monitor_list_lock_);
-  Mutex monitor_list_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
-  ConditionVariable monitor_add_condition_ GUARDED_BY(monitor_list_lock_);
-  std::list<Monitor*> list_ GUARDED_BY(monitor_list_lock_);
+  // Monitors are spread over shards by the id of the inflating thread, so that inflating threads
+  // and the walks of the list don't serialize on a single lock.
+  static constexpr size_t kNumShards = 16;
+
+  struct Shard {
+    Shard();
+
+    // During sweeping we may free an object and on a separate thread have an object created using
+    // the newly freed memory. That object may then have its lock-word inflated and a monitor
+    // created. If we allow new monitor registration during sweeping this monitor may be
+    // incorrectly freed as the object wasn't marked when sweeping began.
+    bool allow_new_monitors GUARDED_BY(monitor_list_lock);
+    Mutex monitor_list_lock DEFAULT_MUTEX_ACQUIRED_AFTER;
+    ConditionVariable monitor_add_condition GUARDED_BY(monitor_list_lock);
+    std::list<Monitor*> list GUARDED_BY(monitor_list_lock);
+    // The identity hash codes of the objects whose locks are biased towards the threads of the
+    // shard, see Monitor::GetOwnedLockHashCode().
+    std::unordered_map<mirror::Object*, int32_t> biased_hash_codes GUARDED_BY(monitor_list_lock);
+  };
+
+  Shard& ShardOf(uint32_t thread_id) {
+    return shards_[thread_id % kNumShards];
+  }
+
+  Shard shards_[kNumShards];
 
   friend class Monitor;
   DISALLOW_COPY_AND_ASSIGN(MonitorList);
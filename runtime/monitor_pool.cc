@@ -16,6 +16,8 @@
 
 #include "monitor_pool.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/mutex-inl.h"
 #include "thread-inl.h"
@@ -23,36 +25,104 @@
 
 namespace art {
 
-MonitorPool::MonitorPool() : allocated_ids_lock_("allocated monitor ids lock",
-                                                 LockLevel::kMonitorPoolLock) {
+MonitorPool::MonitorPool()
+    : allocated_ids_lock_("allocated monitor ids lock", LockLevel::kMonitorPoolLock),
+      chunks_(nullptr), num_chunks_(0),
+      next_id_(1) {  // Zero is reserved to mean "invalid".
+  std::string error_msg;
+  chunks_map_.reset(MemMap::MapAnonymous("monitor pool chunks", nullptr,
+                                         kMaxChunks * sizeof(Monitor**),
+                                         PROT_READ | PROT_WRITE, false, &error_msg));
+  CHECK(chunks_map_.get() != nullptr) << error_msg;
+  chunks_ = reinterpret_cast<Monitor***>(chunks_map_->Begin());
+}
+
+MonitorPool::~MonitorPool() {
+  for (size_t i = 0; i < num_chunks_; ++i) {
+    delete[] chunks_[i];
+  }
 }
 
 Monitor* MonitorPool::LookupMonitorFromTable(MonitorId mon_id) {
-  ReaderMutexLock mu(Thread::Current(), allocated_ids_lock_);
-  return table_.Get(mon_id);
+  // The chunk and slot were written before the id was published in a lock word.
+  Monitor* mon = *SlotForMonitorId(mon_id);
+  DCHECK(mon != nullptr) << mon_id;
+  return mon;
 }
 
-MonitorId MonitorPool::AllocMonitorIdFromTable(Thread* self, Monitor* mon) {
-  WriterMutexLock mu(self, allocated_ids_lock_);
-  for (size_t i = 0; i < allocated_ids_.size(); ++i) {
-    if (!allocated_ids_[i]) {
-      allocated_ids_.set(i);
-      MonitorId mon_id = i + 1;  // Zero is reserved to mean "invalid".
-      table_.Put(mon_id, mon);
-      return mon_id;
+size_t MonitorPool::RefillThreadLocalIds(Thread* self, uint32_t* cache, size_t count) {
+  MutexLock mu(self, allocated_ids_lock_);
+  size_t reused = std::min(count, free_ids_.size());
+  if (reused != 0) {
+    std::copy(free_ids_.end() - reused, free_ids_.end(), cache);
+    free_ids_.resize(free_ids_.size() - reused);
+    return reused;
+  }
+  // Hand out ids that were never used, growing the table a chunk at a time.
+  while (next_id_ + count > num_chunks_ * kChunkSize) {
+    if (num_chunks_ == kMaxChunks) {
+      LOG(FATAL) << "Out of internal monitor ids";
     }
+    chunks_[num_chunks_] = new Monitor*[kChunkSize]();
+    ++num_chunks_;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    cache[i] = next_id_ + i;
   }
-  LOG(FATAL) << "Out of internal monitor ids";
-  return 0;
+  next_id_ += count;
+  return count;
+}
+
+MonitorId MonitorPool::AllocMonitorIdFromTable(Thread* self, Monitor* mon) {
+  uint32_t* cache = self->GetMonitorIdCache();
+  size_t count = self->GetMonitorIdCacheCount();
+  if (count == 0) {
+    count = RefillThreadLocalIds(self, cache, Thread::kMonitorIdCacheSize / 2);
+  }
+  --count;
+  MonitorId mon_id = cache[count];
+  self->SetMonitorIdCacheCount(count);
+  Monitor** slot = SlotForMonitorId(mon_id);
+  DCHECK(*slot == nullptr) << mon_id;
+  *slot = mon;
+  return mon_id;
 }
 
 void MonitorPool::ReleaseMonitorIdFromTable(MonitorId mon_id) {
-  WriterMutexLock mu(Thread::Current(), allocated_ids_lock_);
-  DCHECK(table_.Get(mon_id) != nullptr);
-  table_.erase(mon_id);
-  --mon_id;  // Zero is reserved to mean "invalid".
-  DCHECK(allocated_ids_[mon_id]) << mon_id;
-  allocated_ids_.reset(mon_id);
+  Thread* self = Thread::Current();
+  Monitor** slot = SlotForMonitorId(mon_id);
+  DCHECK(*slot != nullptr) << mon_id;
+  *slot = nullptr;
+  if (UNLIKELY(self == nullptr)) {
+    MutexLock mu(self, allocated_ids_lock_);
+    free_ids_.push_back(mon_id);
+    return;
+  }
+  // Sweeping frees many monitors on one thread, so a full cache gives half of its ids back at once.
+  uint32_t* cache = self->GetMonitorIdCache();
+  size_t count = self->GetMonitorIdCacheCount();
+  if (count == Thread::kMonitorIdCacheSize) {
+    size_t spilled = count / 2;
+    {
+      MutexLock mu(self, allocated_ids_lock_);
+      free_ids_.insert(free_ids_.end(), cache, cache + spilled);
+    }
+    std::copy(cache + spilled, cache + count, cache);
+    count -= spilled;
+  }
+  cache[count] = mon_id;
+  self->SetMonitorIdCacheCount(count + 1);
+}
+
+void MonitorPool::RevokeThreadLocalIdsFromTable(Thread* self) {
+  size_t count = self->GetMonitorIdCacheCount();
+  if (count == 0) {
+    return;
+  }
+  uint32_t* cache = self->GetMonitorIdCache();
+  MutexLock mu(self, allocated_ids_lock_);
+  free_ids_.insert(free_ids_.end(), cache, cache + count);
+  self->SetMonitorIdCacheCount(0);
 }
 
 }  // namespace art
@@ -20,17 +20,21 @@
 #include "monitor.h"
 
 #ifdef __LP64__
-#include <bitset>
 #include <stdint.h>
+#include <memory>
+#include <vector>
 
+#include "lock_word.h"
+#include "mem_map.h"
 #include "runtime.h"
-#include "safe_map.h"
 #endif
 
 namespace art {
 
 // Abstraction to keep monitors small enough to fit in a lock word (32bits). On 32bit systems the
-// monitor id loses the alignment bits of the Monitor*.
+// monitor id loses the alignment bits of the Monitor*. On 64bit systems the monitor id indexes a
+// table that is grown in chunks, so a lookup is a chunk plus an offset and needs no lock. Free ids
+// are cached per thread and only go back to the shared pool in batches.
 class MonitorPool {
  public:
   static MonitorPool* Create() {
@@ -74,22 +78,58 @@ class MonitorPool {
 #endif
   }
 
+  // Return the free monitor ids cached by a thread that is going away.
+  static void RevokeThreadLocalIds(Thread* self) {
+#ifndef __LP64__
+    UNUSED(self);
+#else
+    Runtime::Current()->GetMonitorPool()->RevokeThreadLocalIdsFromTable(self);
+#endif
+  }
+
+#ifdef __LP64__
+  ~MonitorPool();
+#endif
+
  private:
 #ifdef __LP64__
   MonitorPool();
 
   Monitor* LookupMonitorFromTable(MonitorId mon_id);
 
-  MonitorId LookupMonitorIdFromTable(Monitor* mon);
-
   MonitorId AllocMonitorIdFromTable(Thread* self, Monitor* mon);
 
   void ReleaseMonitorIdFromTable(MonitorId mon_id);
 
-  ReaderWriterMutex allocated_ids_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
-  static constexpr uint32_t kMaxMonitorId = 0xFFFF;
-  std::bitset<kMaxMonitorId> allocated_ids_ GUARDED_BY(allocated_ids_lock_);
-  SafeMap<MonitorId, Monitor*> table_ GUARDED_BY(allocated_ids_lock_);
+  void RevokeThreadLocalIdsFromTable(Thread* self) LOCKS_EXCLUDED(allocated_ids_lock_);
+
+  // Move up to count free ids into the thread's cache, returns the number moved.
+  size_t RefillThreadLocalIds(Thread* self, uint32_t* cache, size_t count)
+      LOCKS_EXCLUDED(allocated_ids_lock_);
+
+  Monitor** SlotForMonitorId(MonitorId mon_id) {
+    DCHECK_NE(mon_id, 0U);
+    DCHECK_LT(mon_id >> kChunkShift, kMaxChunks);
+    return &chunks_[mon_id >> kChunkShift][mon_id & kChunkMask];
+  }
+
+  // Each chunk holds the Monitor* of 4K ids.
+  static constexpr size_t kChunkShift = 12;
+  static constexpr size_t kChunkSize = 1U << kChunkShift;
+  static constexpr size_t kChunkMask = kChunkSize - 1;
+  // The monitor id takes all the non-state bits of a fat lock word.
+  static constexpr size_t kMaxChunks = (1U << LockWord::kStateShift) >> kChunkShift;
+
+  Mutex allocated_ids_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // Directory of chunks, reserved up front so that readers never see it move. Only the pages
+  // holding allocated chunk pointers get touched.
+  std::unique_ptr<MemMap> chunks_map_;
+  Monitor*** chunks_;
+  size_t num_chunks_ GUARDED_BY(allocated_ids_lock_);
+  // Lowest id that was never handed out.
+  MonitorId next_id_ GUARDED_BY(allocated_ids_lock_);
+  // Ids released by threads whose cache was full or that have exited.
+  std::vector<MonitorId> free_ids_ GUARDED_BY(allocated_ids_lock_);
 #endif
 };
 
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_pool.h"
+
+#include <set>
+#include <vector>
+
+#include "common_runtime_test.h"
+
+namespace art {
+
+class MonitorPoolTest : public CommonRuntimeTest {};
+
+// The pool never dereferences the monitors, it only hands them back from lookups.
+static Monitor* FakeMonitor(size_t i) {
+  return reinterpret_cast<Monitor*>((i + 1) << 3);
+}
+
+TEST_F(MonitorPoolTest, AllocLookupRelease) {
+  Thread* self = Thread::Current();
+  // Enough ids to span several chunks and many refills of the thread's cache.
+  static constexpr size_t kNumIds = 10000;
+  std::vector<MonitorId> ids;
+  for (size_t i = 0; i < kNumIds; ++i) {
+    MonitorId mon_id = MonitorPool::CreateMonitorId(self, FakeMonitor(i));
+    EXPECT_NE(0U, mon_id);
+    ids.push_back(mon_id);
+  }
+  std::set<MonitorId> unique_ids(ids.begin(), ids.end());
+  EXPECT_EQ(kNumIds, unique_ids.size());
+  for (size_t i = 0; i < kNumIds; ++i) {
+    EXPECT_EQ(FakeMonitor(i), MonitorPool::MonitorFromMonitorId(ids[i]));
+  }
+  for (MonitorId mon_id : ids) {
+    MonitorPool::ReleaseMonitorId(mon_id);
+  }
+
+#ifdef __LP64__
+  // Released ids are recycled before the table grows.
+  for (size_t i = 0; i < kNumIds; ++i) {
+    MonitorId mon_id = MonitorPool::CreateMonitorId(self, FakeMonitor(i));
+    EXPECT_EQ(1U, unique_ids.count(mon_id)) << mon_id;
+    EXPECT_EQ(FakeMonitor(i), MonitorPool::MonitorFromMonitorId(mon_id));
+    ids[i] = mon_id;
+  }
+  for (MonitorId mon_id : ids) {
+    MonitorPool::ReleaseMonitorId(mon_id);
+  }
+#endif
+}
+
+}  // namespace art
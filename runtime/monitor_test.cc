@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor.h"
+
+#include "common_runtime_test.h"
+#include "lock_word-inl.h"
+#include "mirror/object-inl.h"
+#include "mirror/string.h"
+#include "scoped_thread_state_change.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class MonitorTest : public CommonRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(Runtime::Options *options) OVERRIDE {
+    options->push_back(std::make_pair("-XX:UseBiasedLocking", nullptr));
+  }
+
+  // Returns a global reference to a new object.
+  jobject NewGlobalObject(Thread* self) {
+    jobject local;
+    {
+      ScopedObjectAccess soa(self);
+      local = soa.AddLocalReference<jobject>(
+          mirror::String::AllocFromModifiedUtf8(self, "biased"));
+    }
+    return self->GetJniEnv()->NewGlobalRef(local);
+  }
+
+  // Locks and unlocks obj on a thread which exits afterwards, returns the id of the thread.
+  uint32_t LockOnExitedThread(Thread* self, jobject obj);
+};
+
+class LockUnlockTask : public Task {
+ public:
+  LockUnlockTask(jobject obj, uint32_t* thread_id) : obj_(obj), thread_id_(thread_id) {}
+
+  void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    mirror::Object* obj = soa.Decode<mirror::Object*>(obj_);
+    Monitor::MonitorEnter(self, obj);
+    Monitor::MonitorExit(self, obj);
+    *thread_id_ = self->GetThreadId();
+  }
+
+  void Finalize() {
+    delete this;
+  }
+
+ private:
+  const jobject obj_;
+  uint32_t* const thread_id_;
+};
+
+uint32_t MonitorTest::LockOnExitedThread(Thread* self, jobject obj) {
+  uint32_t thread_id = 0;
+  {
+    // The worker detaches from the runtime when the pool is destroyed.
+    ThreadPool thread_pool("Monitor test thread pool", 1);
+    thread_pool.AddTask(self, new LockUnlockTask(obj, &thread_id));
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, false, false);
+  }
+  EXPECT_NE(0U, thread_id);
+  EXPECT_NE(self->GetThreadId(), thread_id);
+  return thread_id;
+}
+
+// The lock stays biased towards the thread after it exits, locking it mustn't wait for the
+// thread to release it.
+TEST_F(MonitorTest, LockBiasedTowardsExitedThread) {
+  Thread* self = Thread::Current();
+  jobject obj = NewGlobalObject(self);
+  uint32_t owner_id = LockOnExitedThread(self, obj);
+  {
+    ScopedObjectAccess soa(self);
+    mirror::Object* o = soa.Decode<mirror::Object*>(obj);
+    LockWord lock_word = o->GetLockWord(false);
+    ASSERT_EQ(LockWord::kBiasLocked, lock_word.GetState());
+    EXPECT_EQ(owner_id, lock_word.ThinLockOwner());
+    EXPECT_EQ(0U, lock_word.ThinLockCount());
+
+    Monitor::MonitorEnter(self, o);
+    EXPECT_EQ(self->GetThreadId(), Monitor::GetLockOwnerThreadId(o));
+    EXPECT_TRUE(Monitor::MonitorExit(self, o));
+  }
+  self->GetJniEnv()->DeleteGlobalRef(obj);
+}
+
+TEST_F(MonitorTest, HashBiasedTowardsExitedThread) {
+  Thread* self = Thread::Current();
+  jobject obj = NewGlobalObject(self);
+  LockOnExitedThread(self, obj);
+  {
+    ScopedObjectAccess soa(self);
+    mirror::Object* o = soa.Decode<mirror::Object*>(obj);
+    ASSERT_EQ(LockWord::kBiasLocked, o->GetLockWord(false).GetState());
+
+    int32_t hash_code = o->IdentityHashCode();
+    EXPECT_EQ(hash_code, o->IdentityHashCode());
+    EXPECT_EQ(0U, Monitor::GetLockOwnerThreadId(o));
+  }
+  self->GetJniEnv()->DeleteGlobalRef(obj);
+}
+
+}  // namespace art
@@ -190,12 +190,18 @@ static jclass DexFile_defineClassNative(JNIEnv* env, jclass, jstring javaName, j
   }
   ScopedObjectAccess soa(env);
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  class_linker->RegisterDexFile(*dex_file);
   StackHandleScope<1> hs(soa.Self());
   Handle<mirror::ClassLoader> class_loader(
       hs.NewHandle(soa.Decode<mirror::ClassLoader*>(javaLoader)));
-  mirror::Class* result = class_linker->DefineClass(descriptor.c_str(), class_loader, *dex_file,
-                                                    *dex_class_def);
+  mirror::Class* result;
+  if (class_linker->OpenAppImage(*dex_file, class_loader) &&
+      (result = class_linker->LookupClass(descriptor.c_str(), class_loader.Get())) != nullptr) {
+    // The class comes from the app image, with the other classes of the dex file.
+    VLOG(class_linker) << "DexFile_defineClassNative returning " << result << " from app image";
+    return soa.AddLocalReference<jclass>(result);
+  }
+  class_linker->RegisterDexFile(*dex_file);
+  result = class_linker->DefineClass(descriptor.c_str(), class_loader, *dex_file, *dex_class_def);
   VLOG(class_linker) << "DexFile_defineClassNative returning " << result;
   return soa.AddLocalReference<jclass>(result);
 }
@@ -17,9 +17,13 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <sstream>
+
+#include "base/contention_profiler.h"
 #include "class_linker.h"
 #include "common_throws.h"
 #include "debugger.h"
+#include "gc/heap.h"
 #include "gc/space/bump_pointer_space.h"
 #include "gc/space/dlmalloc_space.h"
 #include "gc/space/large_object_space.h"
@@ -262,6 +266,97 @@ static jlong VMDebug_countInstancesOfClass(JNIEnv* env, jclass, jclass javaClass
   return count;
 }
 
+// Returns one "class instances bytes" line per class with instances, by decreasing bytes. Unlike
+// countInstancesOfClass this doesn't collect the garbage first, to stay cheap enough to run
+// periodically.
+static jstring VMDebug_getClassCensus(JNIEnv* env, jclass) {
+  std::ostringstream os;
+  {
+    ScopedObjectAccess soa(env);
+    std::vector<gc::ClassCensusEntry> census;
+    Runtime::Current()->GetHeap()->TakeClassCensus(soa.Self(), true, &census);
+    for (const gc::ClassCensusEntry& entry : census) {
+      os << PrettyDescriptor(entry.klass) << ' ' << entry.count << ' ' << entry.bytes << '\n';
+    }
+  }
+  return env->NewStringUTF(os.str().c_str());
+}
+
+static void VMDebug_startAllocationSampling(JNIEnv*, jclass, jint interval) {
+  if (interval <= 0) {
+    ScopedObjectAccess soa(Thread::Current());
+    ThrowIllegalArgumentException(nullptr, "Allocation sampling interval must be positive");
+    return;
+  }
+  Runtime::Current()->GetHeap()->StartAllocationSampling(interval);
+}
+
+static void VMDebug_stopAllocationSampling(JNIEnv*, jclass) {
+  Runtime::Current()->GetHeap()->StopAllocationSampling();
+}
+
+// Returns the recent allocation samples, each with its size, thread and stack.
+static jstring VMDebug_getAllocationSamples(JNIEnv* env, jclass) {
+  std::ostringstream os;
+  Runtime::Current()->GetHeap()->GetAllocationSampler()->DumpSamples(os);
+  return env->NewStringUTF(os.str().c_str());
+}
+
+static void VMDebug_startLockContentionProfiling(JNIEnv*, jclass, jint sample_period) {
+  if (sample_period <= 0) {
+    ScopedObjectAccess soa(Thread::Current());
+    ThrowIllegalArgumentException(nullptr, "Lock contention sample period must be positive");
+    return;
+  }
+  ContentionProfiler::Start(sample_period);
+}
+
+static void VMDebug_stopLockContentionProfiling(JNIEnv*, jclass) {
+  ContentionProfiler::Stop();
+}
+
+// Returns the recorded contentions of each lock and owner call site.
+static jstring VMDebug_getLockContentionProfile(JNIEnv* env, jclass) {
+  std::ostringstream os;
+  ContentionProfiler::Dump(os);
+  return env->NewStringUTF(os.str().c_str());
+}
+
+// Returns the GC metrics as "name=value" lines, see Heap::GetGcMetrics.
+static jstring VMDebug_getGcMetrics(JNIEnv* env, jclass) {
+  std::vector<std::pair<std::string, uint64_t>> metrics;
+  Runtime::Current()->GetHeap()->GetGcMetrics(Thread::Current(), &metrics);
+  std::ostringstream os;
+  for (const auto& metric : metrics) {
+    os << metric.first << "=" << metric.second << "\n";
+  }
+  return env->NewStringUTF(os.str().c_str());
+}
+
+// Returns the class loading metrics as "name=value" lines, see
+// ClassLinker::GetClassLoadingMetrics.
+static jstring VMDebug_getClassLoadingMetrics(JNIEnv* env, jclass) {
+  std::vector<std::pair<std::string, uint64_t>> metrics;
+  Runtime::Current()->GetClassLinker()->GetClassLoadingMetrics(&metrics);
+  std::ostringstream os;
+  for (const auto& metric : metrics) {
+    os << metric.first << "=" << metric.second << "\n";
+  }
+  return env->NewStringUTF(os.str().c_str());
+}
+
+// Returns the bytes allocated so far by the thread, the current thread when null, or -1 if the
+// thread isn't running. Reads the thread's own counter, not the global allocation stats.
+static jlong VMDebug_getThreadAllocatedBytes(JNIEnv* env, jclass, jobject java_thread) {
+  ScopedObjectAccess soa(env);
+  if (java_thread == nullptr) {
+    return static_cast<jlong>(soa.Self()->GetAllocatedBytes());
+  }
+  MutexLock mu(soa.Self(), *Locks::thread_list_lock_);
+  Thread* thread = Thread::FromManagedThread(soa, java_thread);
+  return thread != nullptr ? static_cast<jlong>(thread->GetAllocatedBytes()) : -1;
+}
+
 // We export the VM internal per-heap-space size/alloc/free metrics
 // for the zygote space, alloc space (application heap), and the large
 // object space for dumpsys meminfo. The other memory region data such
@@ -355,8 +450,32 @@ static JNINativeMethod gMethods[] = {
   NATIVE_METHOD(VMDebug, threadCpuTimeNanos, "!()J"),
 };
 
+// The methods not declared by every libcore.
+static JNINativeMethod gOptionalMethods[] = {
+  NATIVE_METHOD(VMDebug, getAllocationSamples, "()Ljava/lang/String;"),
+  NATIVE_METHOD(VMDebug, getClassCensus, "()Ljava/lang/String;"),
+  NATIVE_METHOD(VMDebug, getClassLoadingMetrics, "()Ljava/lang/String;"),
+  NATIVE_METHOD(VMDebug, getGcMetrics, "()Ljava/lang/String;"),
+  NATIVE_METHOD(VMDebug, getLockContentionProfile, "()Ljava/lang/String;"),
+  NATIVE_METHOD(VMDebug, getThreadAllocatedBytes, "(Ljava/lang/Thread;)J"),
+  NATIVE_METHOD(VMDebug, startAllocationSampling, "(I)V"),
+  NATIVE_METHOD(VMDebug, startLockContentionProfiling, "(I)V"),
+  NATIVE_METHOD(VMDebug, stopAllocationSampling, "()V"),
+  NATIVE_METHOD(VMDebug, stopLockContentionProfiling, "()V"),
+};
+
 void register_dalvik_system_VMDebug(JNIEnv* env) {
   REGISTER_NATIVE_METHODS("dalvik/system/VMDebug");
+  // Only register the optional methods the libcore declares, an unknown method would abort.
+  ScopedLocalRef<jclass> c(env, env->FindClass("dalvik/system/VMDebug"));
+  for (size_t i = 0; i < arraysize(gOptionalMethods); ++i) {
+    if (env->GetStaticMethodID(c.get(), gOptionalMethods[i].name,
+                               gOptionalMethods[i].signature) == nullptr) {
+      env->ExceptionClear();
+      continue;
+    }
+    RegisterNativeMethods(env, "dalvik/system/VMDebug", &gOptionalMethods[i], 1);
+  }
 }
 
 }  // namespace art
@@ -94,6 +94,11 @@ static bool CheckReceiver(const ScopedFastNativeObjectAccess& soa, jobject j_rcv
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   soa.Self()->AssertThreadSuspensionIsAllowable();
   if (f->IsStatic()) {
+    mirror::Class* declaring_class = f->GetDeclaringClass();
+    if (LIKELY(declaring_class->IsInitialized())) {
+      *class_or_rcvr = declaring_class;
+      return true;
+    }
     StackHandleScope<1> hs(soa.Self());
     Handle<mirror::Class> h_klass(hs.NewHandle(f->GetDeclaringClass()));
     if (UNLIKELY(!Runtime::Current()->GetClassLinker()->EnsureInitialized(h_klass, true, true))) {
@@ -272,14 +277,18 @@ static void Field_set(JNIEnv* env, jobject javaField, jobject javaObj, jobject j
     const char* field_type_desciptor = fh.GetTypeDescriptor();
     field_prim_type = Primitive::GetType(field_type_desciptor[0]);
     if (field_prim_type == Primitive::kPrimNot) {
-      StackHandleScope<1> hs(soa.Self());
-      HandleWrapper<mirror::Object> h(hs.NewHandleWrapper(&o));
-      // May cause resolution.
-      CHECK(!kMovingFields) << "Resolution may trigger thread suspension";
-      field_type = fh.GetType(true);
+      // The type of a field which was set before is usually resolved already.
+      field_type = fh.GetType(false);
       if (field_type == nullptr) {
-        DCHECK(soa.Self()->IsExceptionPending());
-        return;
+        StackHandleScope<1> hs(soa.Self());
+        HandleWrapper<mirror::Object> h(hs.NewHandleWrapper(&o));
+        // May cause resolution.
+        CHECK(!kMovingFields) << "Resolution may trigger thread suspension";
+        field_type = fh.GetType(true);
+        if (field_type == nullptr) {
+          DCHECK(soa.Self()->IsExceptionPending());
+          return;
+        }
       }
     } else {
       field_type = Runtime::Current()->GetClassLinker()->FindPrimitiveClass(field_type_desciptor[0]);
@@ -22,7 +22,7 @@
 namespace art {
 
 const uint8_t OatHeader::kOatMagic[] = { 'o', 'a', 't', '\n' };
-const uint8_t OatHeader::kOatVersion[] = { '0', '3', '3', '\0' };
+const uint8_t OatHeader::kOatVersion[] = { '0', '3', '6', '\0' };
 
 OatHeader::OatHeader() {
   memset(this, 0, sizeof(*this));
@@ -99,6 +99,11 @@ void OatHeader::UpdateChecksum(const void* data, size_t length) {
   adler32_checksum_ = adler32(adler32_checksum_, bytes, length);
 }
 
+void OatHeader::CombineChecksum(uint32_t data_checksum, size_t length) {
+  DCHECK(IsValid());
+  adler32_checksum_ = adler32_combine(adler32_checksum_, data_checksum, length);
+}
+
 InstructionSet OatHeader::GetInstructionSet() const {
   CHECK(IsValid());
   return instruction_set_;
@@ -366,12 +371,13 @@ OatQuickMethodHeader::OatQuickMethodHeader()
 
 OatQuickMethodHeader::OatQuickMethodHeader(
     uint32_t mapping_table_offset, uint32_t vmap_table_offset, uint32_t frame_size_in_bytes,
-    uint32_t core_spill_mask, uint32_t fp_spill_mask, uint32_t code_size)
+    uint32_t core_spill_mask, uint32_t fp_spill_mask, uint32_t code_size, bool has_stack_maps)
   : mapping_table_offset_(mapping_table_offset),
     vmap_table_offset_(vmap_table_offset),
     frame_info_(frame_size_in_bytes, core_spill_mask, fp_spill_mask),
-    code_size_(code_size)
-{}
+    code_size_(code_size | (has_stack_maps ? kHasStackMapsFlag : 0u)) {
+  DCHECK_EQ(code_size & kHasStackMapsFlag, 0u);
+}
 
 OatQuickMethodHeader::~OatQuickMethodHeader() {}
 
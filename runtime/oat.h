@@ -43,6 +43,8 @@ class PACKED(4) OatHeader {
   const char* GetMagic() const;
   uint32_t GetChecksum() const;
   void UpdateChecksum(const void* data, size_t length);
+  // Appends data of the given length whose own adler32 checksum is already known.
+  void CombineChecksum(uint32_t data_checksum, size_t length);
   uint32_t GetDexFileCount() const {
     DCHECK(IsValid());
     return dex_file_count_;
@@ -153,17 +155,30 @@ class PACKED(4) OatQuickMethodHeader {
 
   explicit OatQuickMethodHeader(uint32_t mapping_table_offset, uint32_t vmap_table_offset,
                                 uint32_t frame_size_in_bytes, uint32_t core_spill_mask,
-                                uint32_t fp_spill_mask, uint32_t code_size);
+                                uint32_t fp_spill_mask, uint32_t code_size,
+                                bool has_stack_maps = false);
 
   ~OatQuickMethodHeader();
 
+  // The top bit of the code size is set for optimized code, whose vmap table holds the stack
+  // maps and which has no mapping table and GC map.
+  static constexpr uint32_t kHasStackMapsFlag = 0x80000000u;
+
+  uint32_t GetCodeSize() const {
+    return code_size_ & ~kHasStackMapsFlag;
+  }
+
+  bool HasStackMaps() const {
+    return (code_size_ & kHasStackMapsFlag) != 0;
+  }
+
   // The offset in bytes from the start of the mapping table to the end of the header.
   uint32_t mapping_table_offset_;
   // The offset in bytes from the start of the vmap table to the end of the header.
   uint32_t vmap_table_offset_;
   // The stack frame information.
   QuickMethodFrameInfo frame_info_;
-  // The code size in bytes.
+  // The code size in bytes, and kHasStackMapsFlag.
   uint32_t code_size_;
 };
 
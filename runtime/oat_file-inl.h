@@ -45,6 +45,14 @@ inline uint32_t OatFile::OatMethod::GetFpSpillMask() const {
   return reinterpret_cast<const OatQuickMethodHeader*>(code)[-1].frame_info_.FpSpillMask();
 }
 
+inline bool OatFile::OatMethod::HasStackMaps() const {
+  const void* code = mirror::ArtMethod::EntryPointToCodePointer(GetQuickCode());
+  if (code == nullptr) {
+    return false;
+  }
+  return reinterpret_cast<const OatQuickMethodHeader*>(code)[-1].HasStackMaps();
+}
+
 inline uint32_t OatFile::OatMethod::GetMappingTableOffset() const {
   const uint8_t* mapping_table = GetMappingTable();
   return static_cast<uint32_t>(mapping_table != nullptr ? mapping_table - begin_ : 0u);
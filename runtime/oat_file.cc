@@ -22,6 +22,7 @@
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
 #include "elf_file.h"
+#include "fault_handler.h"
 #include "oat.h"
 #include "mirror/art_method.h"
 #include "mirror/art_method-inl.h"
@@ -112,11 +113,15 @@ OatFile* OatFile::OpenElfFile(File* file,
 }
 
 OatFile::OatFile(const std::string& location)
-    : location_(location), begin_(NULL), end_(NULL), dlopen_handle_(NULL) {
+    : location_(location), begin_(NULL), end_(NULL), dlopen_handle_(NULL),
+      code_range_registered_(false) {
   CHECK(!location_.empty());
 }
 
 OatFile::~OatFile() {
+  if (code_range_registered_) {
+    fault_manager.RemoveGeneratedCodeRange(begin_);
+  }
   STLDeleteValues(&oat_dex_files_);
   if (dlopen_handle_ != NULL) {
     dlclose(dlopen_handle_);
@@ -157,7 +162,22 @@ bool OatFile::Dlopen(const std::string& elf_filename, byte* requested_base,
   }
   // Readjust to be non-inclusive upper bound.
   end_ += sizeof(uint32_t);
-  return Setup(error_msg);
+  if (!Setup(error_msg)) {
+    return false;
+  }
+  RegisterCodeRange();
+  return true;
+}
+
+// Returns whether the segments of the file were fixed up to an address, see ElfFixup.
+static bool HasFixedAddress(const ElfFile& elf_file) {
+  for (Elf32_Word i = 0; i < elf_file.GetProgramHeaderNum(); i++) {
+    const Elf32_Phdr& program_header = elf_file.GetProgramHeader(i);
+    if (program_header.p_type == PT_LOAD) {
+      return program_header.p_vaddr != 0;
+    }
+  }
+  return false;
 }
 
 bool OatFile::ElfFileOpen(File* file, byte* requested_base, bool writable, bool executable,
@@ -167,7 +187,21 @@ bool OatFile::ElfFileOpen(File* file, byte* requested_base, bool writable, bool
     DCHECK(!error_msg->empty());
     return false;
   }
-  bool loaded = elf_file_->Load(executable, error_msg);
+  // Oat files which weren't fixed up to an address have an oatdata symbol relative to their start,
+  // load them so that it is at the requested base.
+  byte* load_base = nullptr;
+  if (requested_base != nullptr && !HasFixedAddress(*elf_file_)) {
+    std::unique_ptr<ElfFile> symbols(ElfFile::Open(file, false, false, error_msg));
+    if (symbols.get() == nullptr) {
+      DCHECK(!error_msg->empty());
+      return false;
+    }
+    Elf32_Addr oat_data_offset = symbols->FindSymbolAddress(SHT_DYNSYM, "oatdata", false);
+    if (oat_data_offset != 0 && oat_data_offset < reinterpret_cast<uintptr_t>(requested_base)) {
+      load_base = requested_base - oat_data_offset;
+    }
+  }
+  bool loaded = elf_file_->Load(executable, load_base, error_msg);
   if (!loaded) {
     DCHECK(!error_msg->empty());
     return false;
@@ -191,7 +225,19 @@ bool OatFile::ElfFileOpen(File* file, byte* requested_base, bool writable, bool
   }
   // Readjust to be non-inclusive upper bound.
   end_ += sizeof(uint32_t);
-  return Setup(error_msg);
+  if (!Setup(error_msg)) {
+    return false;
+  }
+  if (executable) {
+    RegisterCodeRange();
+  }
+  return true;
+}
+
+void OatFile::RegisterCodeRange() {
+  // The range includes the headers and tables before the code, which never fault.
+  fault_manager.AddGeneratedCodeRange(begin_, end_ - begin_);
+  code_range_registered_ = true;
 }
 
 bool OatFile::Setup(std::string* error_msg) {
@@ -292,11 +338,31 @@ bool OatFile::Setup(std::string* error_msg) {
       return false;
     }
 
+    uint32_t class_def_index_size = *reinterpret_cast<const uint32_t*>(oat);
+    oat += sizeof(class_def_index_size);
+    if (UNLIKELY(oat > End())) {
+      *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' truncated "
+                                " after class def index size", GetLocation().c_str(), i,
+                                dex_file_location.c_str());
+      return false;
+    }
+    const uint32_t* class_def_index_pointer = reinterpret_cast<const uint32_t*>(oat);
+    if (UNLIKELY(class_def_index_size >
+                 static_cast<size_t>(End() - oat) / sizeof(*class_def_index_pointer))) {
+      *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' with truncated "
+                                " class def index of size %u", GetLocation().c_str(), i,
+                                dex_file_location.c_str(), class_def_index_size);
+      return false;
+    }
+    oat += sizeof(*class_def_index_pointer) * class_def_index_size;
+
     oat_dex_files_.Put(dex_file_location, new OatDexFile(this,
                                                          dex_file_location,
                                                          dex_file_checksum,
                                                          dex_file_pointer,
-                                                         methods_offsets_pointer));
+                                                         methods_offsets_pointer,
+                                                         class_def_index_pointer,
+                                                         class_def_index_size));
   }
   return true;
 }
@@ -357,12 +423,16 @@ OatFile::OatDexFile::OatDexFile(const OatFile* oat_file,
                                 const std::string& dex_file_location,
                                 uint32_t dex_file_location_checksum,
                                 const byte* dex_file_pointer,
-                                const uint32_t* oat_class_offsets_pointer)
+                                const uint32_t* oat_class_offsets_pointer,
+                                const uint32_t* class_def_index_pointer,
+                                uint32_t class_def_index_size)
     : oat_file_(oat_file),
       dex_file_location_(dex_file_location),
       dex_file_location_checksum_(dex_file_location_checksum),
       dex_file_pointer_(dex_file_pointer),
-      oat_class_offsets_pointer_(oat_class_offsets_pointer) {}
+      oat_class_offsets_pointer_(oat_class_offsets_pointer),
+      class_def_index_pointer_(class_def_index_pointer),
+      class_def_index_size_(class_def_index_size) {}
 
 OatFile::OatDexFile::~OatDexFile() {}
 
@@ -371,8 +441,20 @@ size_t OatFile::OatDexFile::FileSize() const {
 }
 
 const DexFile* OatFile::OatDexFile::OpenDexFile(std::string* error_msg) const {
-  return DexFile::Open(dex_file_pointer_, FileSize(), dex_file_location_,
-                       dex_file_location_checksum_, error_msg);
+  const DexFile* dex_file = DexFile::Open(dex_file_pointer_, FileSize(), dex_file_location_,
+                                          dex_file_location_checksum_, error_msg);
+  if (dex_file != nullptr && class_def_index_size_ != 0) {
+    // Spare the dex file from hashing all of its class descriptors on the first class lookup.
+    if (UNLIKELY(!dex_file->SetClassDefIndex(class_def_index_pointer_, class_def_index_size_))) {
+      *error_msg = StringPrintf("In oat file '%s' found class def index of size %u mismatching "
+                                "the %zd class defs of '%s'", oat_file_->GetLocation().c_str(),
+                                class_def_index_size_, dex_file->NumClassDefs(),
+                                dex_file_location_.c_str());
+      delete dex_file;
+      return nullptr;
+    }
+  }
+  return dex_file;
 }
 
 OatFile::OatClass OatFile::OatDexFile::GetOatClass(uint16_t class_def_index) const {
@@ -492,7 +574,7 @@ uint32_t OatFile::OatMethod::GetQuickCodeSize() const {
   }
   // TODO: make this Thumb2 specific
   code &= ~0x1;
-  return reinterpret_cast<uint32_t*>(code)[-1];
+  return reinterpret_cast<const OatQuickMethodHeader*>(code)[-1].GetCodeSize();
 }
 
 void OatFile::OatMethod::LinkMethod(mirror::ArtMethod* method) const {
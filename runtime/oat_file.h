@@ -114,6 +114,8 @@ class OatFile {
     uint32_t GetVmapTableOffset() const;
     const uint8_t* GetMappingTable() const;
     const uint8_t* GetVmapTable() const;
+    // Whether the vmap table holds the stack maps of optimized code, see stack_map.h.
+    bool HasStackMaps() const;
 
     ~OatMethod();
 
@@ -197,6 +199,15 @@ class OatFile {
     // Returns the OatClass for the class specified by the given DexFile class_def_index.
     OatClass GetOatClass(uint16_t class_def_index) const;
 
+    // Returns the class def index precomputed by dex2oat, see DexFile::CreateClassDefIndex. It is
+    // empty for small dex files. OpenDexFile makes the DexFile use it for FindClassDef.
+    const uint32_t* GetClassDefIndex() const {
+      return class_def_index_pointer_;
+    }
+    uint32_t GetClassDefIndexSize() const {
+      return class_def_index_size_;
+    }
+
     ~OatDexFile();
 
    private:
@@ -204,13 +215,17 @@ class OatFile {
                const std::string& dex_file_location,
                uint32_t dex_file_checksum,
                const byte* dex_file_pointer,
-               const uint32_t* oat_class_offsets_pointer);
+               const uint32_t* oat_class_offsets_pointer,
+               const uint32_t* class_def_index_pointer,
+               uint32_t class_def_index_size);
 
     const OatFile* oat_file_;
     std::string dex_file_location_;
     uint32_t dex_file_location_checksum_;
     const byte* dex_file_pointer_;
     const uint32_t* oat_class_offsets_pointer_;
+    const uint32_t* class_def_index_pointer_;
+    const uint32_t class_def_index_size_;
 
     friend class OatFile;
     DISALLOW_COPY_AND_ASSIGN(OatDexFile);
@@ -246,6 +261,8 @@ class OatFile {
   bool ElfFileOpen(File* file, byte* requested_base, bool writable, bool executable,
                    std::string* error_msg);
   bool Setup(std::string* error_msg);
+  // Tells the fault manager that the code of this file may hit implicit checks.
+  void RegisterCodeRange();
 
   const byte* Begin() const;
   const byte* End() const;
@@ -270,6 +287,9 @@ class OatFile {
   // dlopen handle during runtime.
   void* dlopen_handle_;
 
+  // Whether [begin_, end_) was registered with the fault manager.
+  bool code_range_registered_;
+
   typedef SafeMap<std::string, const OatDexFile*> Table;
   Table oat_dex_files_;
 
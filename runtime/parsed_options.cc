@@ -21,6 +21,9 @@
 #endif
 
 #include "debugger.h"
+#include "jit/jit.h"
+#include "jit/jit_code_cache.h"
+#include "verifier/background_verifier.h"
 #include "monitor.h"
 
 namespace art {
@@ -108,6 +111,8 @@ static gc::CollectorType ParseCollectorType(const std::string& option) {
     return gc::kCollectorTypeSS;
   } else if (option == "GSS") {
     return gc::kCollectorTypeGSS;
+  } else if (option == "GenCMS") {
+    return gc::kCollectorTypeGenCMS;
   } else if (option == "CC") {
     return gc::kCollectorTypeCC;
   } else {
@@ -189,6 +194,8 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
   collector_type_ = gc::kCollectorTypeSS;
 #elif ART_DEFAULT_GC_TYPE_IS_GSS
   collector_type_ = gc::kCollectorTypeGSS;
+#elif ART_DEFAULT_GC_TYPE_IS_GENCMS
+  collector_type_ = gc::kCollectorTypeGenCMS;
 #else
 #error "ART default GC type must be set"
 #endif
@@ -199,6 +206,13 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
   max_spins_before_thin_lock_inflation_ = Monitor::kDefaultMaxSpinsBeforeThinLockInflation;
   low_memory_mode_ = false;
   use_tlab_ = false;
+  use_huge_pages_ = false;
+  use_numa_interleave_ = false;
+  gc_pacing_ = false;
+  class_unloading_ = false;
+  use_biased_locking_ = false;
+  fork_heap_dumps_ = false;
+  perf_map_ = false;
   verify_pre_gc_heap_ = false;
   // Pre sweeping is the one that usually fails if the GC corrupted the heap.
   verify_pre_sweeping_heap_ = kIsDebugBuild;
@@ -206,12 +220,13 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
   verify_pre_gc_rosalloc_ = kIsDebugBuild;
   verify_pre_sweeping_rosalloc_ = false;
   verify_post_gc_rosalloc_ = false;
+  verify_heap_sample_percent_ = 0;
 
   compiler_callbacks_ = nullptr;
   is_zygote_ = false;
-  if (kPoisonHeapReferences) {
-    // kPoisonHeapReferences currently works only with the interpreter only.
-    // TODO: make it work with the compiler.
+  if (kPoisonHeapReferences || kHeapReferenceShift != 0) {
+    // kPoisonHeapReferences and kHeapReferenceShift currently work only with the interpreter only.
+    // TODO: make them work with the compiler.
     interpreter_only_ = true;
   } else {
     interpreter_only_ = false;
@@ -235,6 +250,7 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
 //  gLogVerbosity.gc = true;  // TODO: don't check this in!
 //  gLogVerbosity.heap = true;  // TODO: don't check this in!
 //  gLogVerbosity.jdwp = true;  // TODO: don't check this in!
+//  gLogVerbosity.jit = true;  // TODO: don't check this in!
 //  gLogVerbosity.jni = true;  // TODO: don't check this in!
 //  gLogVerbosity.monitor = true;  // TODO: don't check this in!
 //  gLogVerbosity.profiler = true;  // TODO: don't check this in!
@@ -247,15 +263,27 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
   method_trace_ = false;
   method_trace_file_ = "/data/method-trace-file.bin";
   method_trace_file_size_ = 10 * MB;
+  method_trace_filter_.clear();
 
   profile_ = false;
   profile_period_s_ = 10;           // Seconds.
   profile_duration_s_ = 20;          // Seconds.
   profile_interval_us_ = 500;       // Microseconds.
+  profile_interval_jitter_us_ = 0;  // Microseconds.
   profile_backoff_coefficient_ = 2.0;
   profile_start_immediately_ = true;
   profile_clock_source_ = kDefaultProfilerClockSource;
 
+  image_prefetch_profile_.clear();
+  image_prefetch_record_delay_s_ = 10;  // Seconds.
+
+  sigquit_checkpoint_dump_ = false;
+
+  use_jit_ = false;
+  jit_code_cache_capacity_ = jit::JitCodeCache::kDefaultCapacity;
+  jit_compile_threshold_ = jit::Jit::kDefaultCompileThreshold;
+  verifier_thread_count_ = verifier::BackgroundVerifier::kDefaultThreadCount;
+
   verify_ = true;
   image_isa_ = kRuntimeISA;
 
@@ -409,6 +437,14 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
         return false;
       }
       long_gc_log_threshold_ = MsToNs(value);
+    } else if (StartsWith(option, "-XX:HeapVerificationSamplePercent=")) {
+      if (!ParseUnsignedInteger(option, '=', &verify_heap_sample_percent_)) {
+        return false;
+      }
+      if (verify_heap_sample_percent_ > 100) {
+        Usage("Invalid heap verification sample percent %s\n", option.c_str());
+        return false;
+      }
     } else if (option == "-XX:DumpGCPerformanceOnShutdown") {
       dump_gc_performance_on_shutdown_ = true;
     } else if (option == "-XX:IgnoreMaxFootprint") {
@@ -417,6 +453,20 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
       low_memory_mode_ = true;
     } else if (option == "-XX:UseTLAB") {
       use_tlab_ = true;
+    } else if (option == "-XX:UseHugePages") {
+      use_huge_pages_ = true;
+    } else if (option == "-XX:NumaInterleave") {
+      use_numa_interleave_ = true;
+    } else if (option == "-XX:GcPacing") {
+      gc_pacing_ = true;
+    } else if (option == "-XX:ClassUnloading") {
+      class_unloading_ = true;
+    } else if (option == "-XX:UseBiasedLocking") {
+      use_biased_locking_ = true;
+    } else if (option == "-XX:ForkHeapDumps") {
+      fork_heap_dumps_ = true;
+    } else if (option == "-XX:PerfMap") {
+      perf_map_ = true;
     } else if (StartsWith(option, "-D")) {
       properties_.push_back(option.substr(strlen("-D")));
     } else if (StartsWith(option, "-Xjnitrace:")) {
@@ -463,6 +513,8 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
           gLogVerbosity.heap = true;
         } else if (verbose_options[i] == "jdwp") {
           gLogVerbosity.jdwp = true;
+        } else if (verbose_options[i] == "jit") {
+          gLogVerbosity.jit = true;
         } else if (verbose_options[i] == "jni") {
           gLogVerbosity.jni = true;
         } else if (verbose_options[i] == "monitor") {
@@ -528,6 +580,8 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
       if (!ParseUnsignedInteger(option, ':', &method_trace_file_size_)) {
         return false;
       }
+    } else if (StartsWith(option, "-Xmethod-trace-filter:")) {
+      method_trace_filter_ = option.substr(strlen("-Xmethod-trace-filter:"));
     } else if (option == "-Xprofile:threadcpuclock") {
       Trace::SetDefaultClockSource(kProfilerClockSourceThreadCpu);
     } else if (option == "-Xprofile:wallclock") {
@@ -551,12 +605,47 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
       if (!ParseUnsignedInteger(option, ':', &profile_interval_us_)) {
         return false;
       }
+    } else if (StartsWith(option, "-Xprofile-interval-jitter:")) {
+      if (!ParseUnsignedInteger(option, ':', &profile_interval_jitter_us_)) {
+        return false;
+      }
     } else if (StartsWith(option, "-Xprofile-backoff:")) {
       if (!ParseDouble(option, ':', 1.0, 10.0, &profile_backoff_coefficient_)) {
         return false;
       }
     } else if (option == "-Xprofile-start-lazy") {
       profile_start_immediately_ = false;
+    } else if (StartsWith(option, "-Ximage-prefetch-profile:")) {
+      if (!ParseStringAfterChar(option, ':', &image_prefetch_profile_)) {
+        return false;
+      }
+    } else if (StartsWith(option, "-Ximage-prefetch-record-delay:")) {
+      if (!ParseUnsignedInteger(option, ':', &image_prefetch_record_delay_s_)) {
+        return false;
+      }
+    } else if (option == "-Xsigquit-checkpoint-dump") {
+      sigquit_checkpoint_dump_ = true;
+    } else if (option == "-Xjit") {
+      use_jit_ = true;
+    } else if (StartsWith(option, "-Xjitcodecachesize:")) {
+      // In kilobytes, as for Dalvik.
+      unsigned int size_kb;
+      if (!ParseUnsignedInteger(option, ':', &size_kb)) {
+        return false;
+      }
+      if (size_kb == 0 || size_kb > jit::JitCodeCache::kMaxCapacity / KB) {
+        Usage("Invalid JIT code cache size %s\n", option.c_str());
+        return false;
+      }
+      jit_code_cache_capacity_ = size_kb * KB;
+    } else if (StartsWith(option, "-Xjitthreshold:")) {
+      if (!ParseUnsignedInteger(option, ':', &jit_compile_threshold_)) {
+        return false;
+      }
+    } else if (StartsWith(option, "-Xverifythreads:")) {
+      if (!ParseUnsignedInteger(option, ':', &verifier_thread_count_)) {
+        return false;
+      }
     } else if (StartsWith(option, "-implicit-checks:")) {
       std::string checks;
       if (!ParseStringAfterChar(option, ':', &checks)) {
@@ -609,6 +698,10 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
       if (!ParseStringAfterChar(option, ':', &compiler_executable_)) {
         return false;
       }
+    } else if (StartsWith(option, "-Xpatchoat:")) {
+      if (!ParseStringAfterChar(option, ':', &patchoat_executable_)) {
+        return false;
+      }
     } else if (option == "-Xcompiler-option") {
       i++;
       if (i == options.size()) {
@@ -655,8 +748,6 @@ bool ParsedOptions::Parse(const Runtime::Options& options, bool ignore_unrecogni
                (option == "-Xincludeselectedop") ||
                StartsWith(option, "-Xjitop:") ||
                (option == "-Xincludeselectedmethod") ||
-               StartsWith(option, "-Xjitthreshold:") ||
-               StartsWith(option, "-Xjitcodecachesize:") ||
                (option == "-Xjitblocking") ||
                StartsWith(option, "-Xjitmethod:") ||
                StartsWith(option, "-Xjitclass:") ||
@@ -784,21 +875,39 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -XX:MaxSpinsBeforeThinLockInflation=integervalue\n");
   UsageMessage(stream, "  -XX:LongPauseLogThreshold=integervalue\n");
   UsageMessage(stream, "  -XX:LongGCLogThreshold=integervalue\n");
+  UsageMessage(stream, "  -XX:HeapVerificationSamplePercent=integervalue\n");
   UsageMessage(stream, "  -XX:DumpGCPerformanceOnShutdown\n");
   UsageMessage(stream, "  -XX:IgnoreMaxFootprint\n");
   UsageMessage(stream, "  -XX:UseTLAB\n");
+  UsageMessage(stream, "  -XX:UseHugePages\n");
+  UsageMessage(stream, "  -XX:NumaInterleave\n");
+  UsageMessage(stream, "  -XX:GcPacing\n");
+  UsageMessage(stream, "  -XX:ClassUnloading\n");
+  UsageMessage(stream, "  -XX:UseBiasedLocking\n");
+  UsageMessage(stream, "  -XX:ForkHeapDumps\n");
+  UsageMessage(stream, "  -XX:PerfMap\n");
   UsageMessage(stream, "  -XX:BackgroundGC=none\n");
   UsageMessage(stream, "  -Xmethod-trace\n");
   UsageMessage(stream, "  -Xmethod-trace-file:filename");
   UsageMessage(stream, "  -Xmethod-trace-file-size:integervalue\n");
+  UsageMessage(stream, "  -Xmethod-trace-filter:classdescriptorprefix\n");
   UsageMessage(stream, "  -Xprofile-filename:filename\n");
   UsageMessage(stream, "  -Xprofile-period:integervalue\n");
   UsageMessage(stream, "  -Xprofile-duration:integervalue\n");
   UsageMessage(stream, "  -Xprofile-interval:integervalue\n");
+  UsageMessage(stream, "  -Xprofile-interval-jitter:integervalue\n");
   UsageMessage(stream, "  -Xprofile-backoff:doublevalue\n");
+  UsageMessage(stream, "  -Ximage-prefetch-profile:filename\n");
+  UsageMessage(stream, "  -Ximage-prefetch-record-delay:integervalue\n");
+  UsageMessage(stream, "  -Xsigquit-checkpoint-dump\n");
+  UsageMessage(stream, "  -Xjit\n");
+  UsageMessage(stream, "  -Xjitcodecachesize:decimalvalueofkbytes\n");
+  UsageMessage(stream, "  -Xjitthreshold:integervalue\n");
+  UsageMessage(stream, "  -Xverifythreads:integervalue\n");
   UsageMessage(stream, "  -Xcompiler:filename\n");
   UsageMessage(stream, "  -Xcompiler-option dex2oat-option\n");
   UsageMessage(stream, "  -Ximage-compiler-option dex2oat-option\n");
+  UsageMessage(stream, "  -Xpatchoat:filename\n");
   UsageMessage(stream, "\n");
 
   UsageMessage(stream, "The following previously supported Dalvik options are ignored:\n");
@@ -823,8 +932,6 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -Xincludeselectedop\n");
   UsageMessage(stream, "  -Xjitop:hexopvalue[-endvalue][,hexopvalue[-endvalue]]*\n");
   UsageMessage(stream, "  -Xincludeselectedmethod\n");
-  UsageMessage(stream, "  -Xjitthreshold:integervalue\n");
-  UsageMessage(stream, "  -Xjitcodecachesize:decimalvalueofkbytes\n");
   UsageMessage(stream, "  -Xjitblocking\n");
   UsageMessage(stream, "  -Xjitmethod:signature[,signature]* (eg Ljava/lang/String\\;replace)\n");
   UsageMessage(stream, "  -Xjitclass:classname[,classname]*\n");
@@ -40,12 +40,20 @@ class ParsedOptions {
   bool interpreter_only_;
   bool is_explicit_gc_disabled_;
   bool use_tlab_;
+  bool use_huge_pages_;
+  bool use_numa_interleave_;
+  bool gc_pacing_;
+  bool class_unloading_;
+  bool use_biased_locking_;
+  bool fork_heap_dumps_;
+  bool perf_map_;
   bool verify_pre_gc_heap_;
   bool verify_pre_sweeping_heap_;
   bool verify_post_gc_heap_;
   bool verify_pre_gc_rosalloc_;
   bool verify_pre_sweeping_rosalloc_;
   bool verify_post_gc_rosalloc_;
+  unsigned int verify_heap_sample_percent_;
   unsigned int long_pause_log_threshold_;
   unsigned int long_gc_log_threshold_;
   bool dump_gc_performance_on_shutdown_;
@@ -69,12 +77,14 @@ class ParsedOptions {
   bool method_trace_;
   std::string method_trace_file_;
   unsigned int method_trace_file_size_;
+  std::string method_trace_filter_;
   bool (*hook_is_sensitive_thread_)();
   jint (*hook_vfprintf_)(FILE* stream, const char* format, va_list ap);
   void (*hook_exit_)(jint status);
   void (*hook_abort_)();
   std::vector<std::string> properties_;
   std::string compiler_executable_;
+  std::string patchoat_executable_;
   std::vector<std::string> compiler_options_;
   std::vector<std::string> image_compiler_options_;
   bool profile_;
@@ -82,9 +92,17 @@ class ParsedOptions {
   uint32_t profile_period_s_;
   uint32_t profile_duration_s_;
   uint32_t profile_interval_us_;
+  uint32_t profile_interval_jitter_us_;
   double profile_backoff_coefficient_;
   bool profile_start_immediately_;
+  std::string image_prefetch_profile_;
+  unsigned int image_prefetch_record_delay_s_;
+  bool sigquit_checkpoint_dump_;
   ProfilerClockSource profile_clock_source_;
+  bool use_jit_;
+  size_t jit_code_cache_capacity_;
+  unsigned int jit_compile_threshold_;
+  unsigned int verifier_thread_count_;
   bool verify_;
   InstructionSet image_isa_;
 
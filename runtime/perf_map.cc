@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "perf_map.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "base/mutex-inl.h"
+#include "base/stringprintf.h"
+#include "class_linker.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "oat.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+PerfMap* PerfMap::Create(std::string* error_msg) {
+  std::string filename(StringPrintf("/tmp/perf-%d.map", getpid()));
+  File* file = OS::CreateEmptyFile(filename.c_str());
+  if (file == nullptr) {
+    *error_msg = StringPrintf("Failed to create %s: %s", filename.c_str(), strerror(errno));
+    return nullptr;
+  }
+  return new PerfMap(file);
+}
+
+PerfMap::PerfMap(File* file) : lock_("perf map lock", kPerfMapLock), file_(file) {
+}
+
+void PerfMap::AddMethod(mirror::ArtMethod* method, const void* code, size_t code_size) {
+  if (code == nullptr || code_size == 0) {
+    return;
+  }
+  std::string line(StringPrintf("%" PRIxPTR " %zx %s\n", reinterpret_cast<uintptr_t>(code),
+                                code_size, PrettyMethod(method).c_str()));
+  MutexLock mu(Thread::Current(), lock_);
+  if (!file_->WriteFully(line.data(), line.size())) {
+    PLOG(WARNING) << "Failed to write to " << file_->GetPath();
+  }
+}
+
+bool PerfMap::AddClassMethods(mirror::Class* klass, void* arg) {
+  PerfMap* perf_map = reinterpret_cast<PerfMap*>(arg);
+  if (klass->IsProxyClass() || !klass->IsResolved()) {
+    return true;
+  }
+  for (size_t i = 0, e = klass->NumDirectMethods() + klass->NumVirtualMethods(); i < e; ++i) {
+    mirror::ArtMethod* method = i < klass->NumDirectMethods()
+        ? klass->GetDirectMethod(i)
+        : klass->GetVirtualMethod(i - klass->NumDirectMethods());
+    // Inherited methods are found in their declaring class.
+    if (method->GetDeclaringClass() != klass) {
+      continue;
+    }
+    // The code in the oat file, even while a static method still has the resolution trampoline.
+    const void* code = method->GetQuickOatCodePointer();
+    if (code != nullptr) {
+      perf_map->AddMethod(method, code,
+                          reinterpret_cast<const OatQuickMethodHeader*>(code)[-1].GetCodeSize());
+    }
+  }
+  return true;
+}
+
+void PerfMap::AddLoadedClasses(ClassLinker* class_linker) {
+  // Finding the oat code of a method may take class linker locks.
+  class_linker->VisitClassesWithoutClassesLock(AddClassMethods, this);
+}
+
+}  // namespace art
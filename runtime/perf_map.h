@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_PERF_MAP_H_
+#define ART_RUNTIME_PERF_MAP_H_
+
+#include <memory>
+#include <string>
+
+#include "base/mutex.h"
+#include "base/unix_file/fd_file.h"
+#include "os.h"
+
+namespace art {
+
+class ClassLinker;
+namespace mirror {
+class ArtMethod;
+class Class;
+}  // namespace mirror
+
+// Writes /tmp/perf-<pid>.map, the symbol map which perf and simpleperf read for code that isn't
+// in an ELF file with symbols. Each line is the start and size of a method's compiled code in
+// hex, then the method's name. Methods are added as their classes are linked or their code is
+// compiled by the JIT, so only the names of the methods of loaded classes are resolved.
+class PerfMap {
+ public:
+  // Creates the map of the current process, truncating any previous map of the same pid.
+  static PerfMap* Create(std::string* error_msg);
+
+  // Adds the compiled code of a method, code is the code pointer, not the entry point.
+  void AddMethod(mirror::ArtMethod* method, const void* code, size_t code_size)
+      LOCKS_EXCLUDED(lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Adds the compiled code of the methods of the classes loaded so far, the boot image classes
+  // are never linked.
+  void AddLoadedClasses(ClassLinker* class_linker)
+      LOCKS_EXCLUDED(lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  explicit PerfMap(File* file);
+
+  static bool AddClassMethods(mirror::Class* klass, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::unique_ptr<File> file_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(PerfMap);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_PERF_MAP_H_
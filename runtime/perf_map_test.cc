@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "perf_map.h"
+
+#include <unistd.h>
+
+#include <memory>
+
+#include "base/stringprintf.h"
+#include "common_runtime_test.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "scoped_thread_state_change.h"
+#include "utils.h"
+
+namespace art {
+
+class PerfMapTest : public CommonRuntimeTest {};
+
+TEST_F(PerfMapTest, AddMethod) {
+  ScopedObjectAccess soa(Thread::Current());
+  std::string error_msg;
+  std::unique_ptr<PerfMap> perf_map(PerfMap::Create(&error_msg));
+  ASSERT_TRUE(perf_map.get() != nullptr) << error_msg;
+  mirror::Class* klass = class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+  ASSERT_TRUE(klass != nullptr);
+  mirror::ArtMethod* method = klass->FindDeclaredVirtualMethod("hashCode", "()I");
+  ASSERT_TRUE(method != nullptr);
+  perf_map->AddMethod(method, reinterpret_cast<const void*>(0x1234), 0x56);
+  // Methods without code are ignored.
+  perf_map->AddMethod(method, nullptr, 0);
+
+  const std::string filename(StringPrintf("/tmp/perf-%d.map", getpid()));
+  std::string contents;
+  ASSERT_TRUE(ReadFileToString(filename, &contents));
+  EXPECT_EQ("1234 56 int java.lang.Object.hashCode()\n", contents);
+  unlink(filename.c_str());
+}
+
+}  // namespace art
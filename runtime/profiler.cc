@@ -16,6 +16,7 @@
 
 #include "profiler.h"
 
+#include <algorithm>
 #include <fstream>
 #include <sys/uio.h>
 #include <sys/file.h>
@@ -27,6 +28,8 @@
 #include "debugger.h"
 #include "dex_file-inl.h"
 #include "instrumentation.h"
+#include "jit/jit.h"
+#include "leb128.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/dex_cache.h"
@@ -38,6 +41,7 @@
 #include "ScopedLocalRef.h"
 #include "thread.h"
 #include "thread_list.h"
+#include "utils.h"
 
 #ifdef HAVE_ANDROID_OS
 #include "cutils/properties.h"
@@ -59,20 +63,44 @@ volatile bool BackgroundMethodSamplingProfiler::shutting_down_ = false;
 // have some performance data after it's been used for a while.
 
 
+// Finds the method at the top of the stack and, when it is a virtual method called from managed
+// code, the caller and the dex pc of its invoke.
+class SampleVisitor FINAL : public StackVisitor {
+ public:
+  explicit SampleVisitor(Thread* thread) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      : StackVisitor(thread, nullptr), method_(nullptr), caller_(nullptr), caller_dex_pc_(0) {}
+
+  bool VisitFrame() OVERRIDE SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    mirror::ArtMethod* m = GetMethod();
+    if (m->IsRuntimeMethod()) {
+      // Continue if this is a runtime method.
+      return true;
+    }
+    if (method_ == nullptr) {
+      method_ = m;
+      // Only the calls which may dispatch to different methods are of interest.
+      return !m->IsDirect();
+    }
+    if (!m->IsNative() && !m->IsProxyMethod()) {
+      caller_ = m;
+      caller_dex_pc_ = GetDexPc();
+    }
+    return false;
+  }
+
+  mirror::ArtMethod* method_;
+  mirror::ArtMethod* caller_;
+  uint32_t caller_dex_pc_;
+};
+
 // This is called from either a thread list traversal or from a checkpoint.  Regardless
 // of which caller, the mutator lock must be held.
 static void GetSample(Thread* thread, void* arg) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   BackgroundMethodSamplingProfiler* profiler =
       reinterpret_cast<BackgroundMethodSamplingProfiler*>(arg);
-  mirror::ArtMethod* method = thread->GetCurrentMethod(nullptr);
-  if (false && method == nullptr) {
-    LOG(INFO) << "No current method available";
-    std::ostringstream os;
-    thread->Dump(os);
-    std::string data(os.str());
-    LOG(INFO) << data;
-  }
-  profiler->RecordMethod(method);
+  SampleVisitor visitor(thread);
+  visitor.WalkStack(false);
+  profiler->AddSample(visitor.method_, visitor.caller_, visitor.caller_dex_pc_);
 }
 
 
@@ -178,11 +206,16 @@ void* BackgroundMethodSamplingProfiler::RunProfilerThread(void* arg) {
         break;
       }
 
-      usleep(profiler->interval_us_);    // Non-interruptible sleep.
+      uint32_t jitter_us = 0;
+      if (profiler->interval_jitter_us_ > 0) {
+        jitter_us = rand() % (profiler->interval_jitter_us_ + 1);
+      }
+      usleep(profiler->interval_us_ + jitter_us);    // Non-interruptible sleep.
 
       ThreadList* thread_list = runtime->GetThreadList();
 
       profiler->profiler_barrier_->Init(self, 0);
+      profiler->num_samples_.StoreRelaxed(0);
       size_t barrier_count = thread_list->RunCheckpointOnRunnableThreads(&check_point);
 
       // All threads are suspended, nothing to do.
@@ -193,33 +226,53 @@ void* BackgroundMethodSamplingProfiler::RunProfilerThread(void* arg) {
 
       valid_samples += barrier_count;
 
-      ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+      {
+        ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
 
-      // Wait for the barrier to be crossed by all runnable threads.  This wait
-      // is done with a timeout so that we can detect problems with the checkpoint
-      // running code.  We should never see this.
-      const uint32_t kWaitTimeoutMs = 10000;
-      const uint32_t kWaitTimeoutUs = kWaitTimeoutMs * 1000;
+        // Wait for the barrier to be crossed by all runnable threads.  This wait
+        // is done with a timeout so that we can detect problems with the checkpoint
+        // running code.  We should never see this.
+        const uint32_t kWaitTimeoutMs = 10000;
+        const uint32_t kWaitTimeoutUs = kWaitTimeoutMs * 1000;
 
-      uint64_t waitstart_us = MicroTime();
-      // Wait for all threads to pass the barrier.
-      profiler->profiler_barrier_->Increment(self, barrier_count, kWaitTimeoutMs);
-      uint64_t waitend_us = MicroTime();
-      uint64_t waitdiff_us = waitend_us - waitstart_us;
+        uint64_t waitstart_us = MicroTime();
+        // Wait for all threads to pass the barrier.
+        profiler->profiler_barrier_->Increment(self, barrier_count, kWaitTimeoutMs);
+        uint64_t waitend_us = MicroTime();
+        uint64_t waitdiff_us = waitend_us - waitstart_us;
 
-      // We should never get a timeout.  If we do, it suggests a problem with the checkpoint
-      // code.  Crash the process in this case.
-      CHECK_LT(waitdiff_us, kWaitTimeoutUs);
+        // We should never get a timeout.  If we do, it suggests a problem with the checkpoint
+        // code.  Crash the process in this case.
+        CHECK_LT(waitdiff_us, kWaitTimeoutUs);
+      }
+
+      {
+        ScopedObjectAccess soa(self);
+        profiler->MergeSamples();
+      }
 
       // Update the current time.
       now_us = MicroTime();
     }
 
     if (valid_samples > 0) {
-      // After the profile has been taken, write it out.
       ScopedObjectAccess soa(self);   // Acquire the mutator lock.
-      uint32_t size = profiler->WriteProfile();
-      VLOG(profiler) << "Profile size: " << size;
+      // Hand the hot methods to the JIT before the table is cleaned.
+      jit::Jit* jit = runtime->GetJit();
+      if (jit != nullptr) {
+        std::vector<mirror::ArtMethod*> hot_methods;
+        profiler->profile_table_.GetHotMethods(jit->GetCompileThreshold(), &hot_methods);
+        VLOG(profiler) << "Hot methods for the JIT: " << hot_methods.size();
+        jit->AddHotMethods(self, hot_methods);
+      }
+      if (!profiler->profile_file_name_.empty()) {
+        // After the profile has been taken, write it out.
+        uint32_t size = profiler->WriteProfile();
+        VLOG(profiler) << "Profile size: " << size;
+      } else {
+        // Only sampling for the JIT.
+        profiler->CleanProfile();
+      }
     }
   }
 
@@ -270,6 +323,9 @@ uint32_t BackgroundMethodSamplingProfiler::WriteProfile() {
   // Truncate the file to the new length.
   ftruncate(fd, full_length);
 
+  // Under the profile file lock, which serializes the processes sharing the call site file.
+  WriteCallSites();
+
   // Now unlock the file, allowing another process in.
   err = flock(fd, LOCK_UN);
   if (err < 0) {
@@ -285,10 +341,27 @@ uint32_t BackgroundMethodSamplingProfiler::WriteProfile() {
   return num_methods;
 }
 
+void BackgroundMethodSamplingProfiler::WriteCallSites() {
+  CallSiteProfile call_sites;
+  profile_table_.GetCallSites(&call_sites);
+  if (call_sites.NumCallSites() == 0) {
+    return;
+  }
+  std::string file_name = CallSiteProfile::GetFileName(profile_file_name_);
+  CallSiteProfile previous;
+  previous.ReadFromFile(file_name);
+  call_sites.Merge(previous);
+  if (!call_sites.WriteToFile(file_name)) {
+    LOG(ERROR) << "Failed to write call site profile " << file_name;
+    return;
+  }
+  VLOG(profiler) << "Call sites: " << call_sites.NumCallSites();
+}
+
 // Start a profile thread with the user-supplied arguments.
 void BackgroundMethodSamplingProfiler::Start(int period, int duration,
                   const std::string& profile_file_name, const std::string& procName,
-                  int interval_us,
+                  int interval_us, int interval_jitter_us,
                   double backoff_coefficient, bool startImmediately) {
   Thread* self = Thread::Current();
   {
@@ -301,24 +374,26 @@ void BackgroundMethodSamplingProfiler::Start(int period, int duration,
 
   // Only on target...
 #ifdef HAVE_ANDROID_OS
-  // Switch off profiler if the dalvik.vm.profiler property has value 0.
+  // Switch off profiler if the dalvik.vm.profiler property has value 0. The JIT always needs
+  // the samples.
   char buf[PROP_VALUE_MAX];
   property_get("dalvik.vm.profiler", buf, "0");
-  if (strcmp(buf, "0") == 0) {
+  if (strcmp(buf, "0") == 0 && Runtime::Current()->GetJit() == nullptr) {
     LOG(INFO) << "Profiler disabled.  To enable setprop dalvik.vm.profiler 1";
     return;
   }
 #endif
 
   LOG(INFO) << "Starting profile with period " << period << "s, duration " << duration <<
-      "s, interval " << interval_us << "us.  Profile file " << profile_file_name;
+      "s, interval " << interval_us << "us, jitter " << interval_jitter_us <<
+      "us.  Profile file " << profile_file_name;
 
   {
     MutexLock mu(self, *Locks::profiler_lock_);
     profiler_ = new BackgroundMethodSamplingProfiler(period, duration, profile_file_name,
                                       procName,
                                       backoff_coefficient,
-                                      interval_us, startImmediately);
+                                      interval_us, interval_jitter_us, startImmediately);
 
     CHECK_PTHREAD_CALL(pthread_create, (&profiler_pthread_, nullptr, &RunProfilerThread,
         reinterpret_cast<void*>(profiler_)),
@@ -335,6 +410,10 @@ void BackgroundMethodSamplingProfiler::Stop() {
     MutexLock trace_mu(Thread::Current(), *Locks::profiler_lock_);
     CHECK(!shutting_down_);
     profiler = profiler_;
+    if (profiler == nullptr) {
+      // Never started, e.g. disabled by the property.
+      return;
+    }
     shutting_down_ = true;
     profiler_pthread = profiler_pthread_;
   }
@@ -359,18 +438,24 @@ void BackgroundMethodSamplingProfiler::Shutdown() {
   Stop();
 }
 
+bool BackgroundMethodSamplingProfiler::IsStarted() {
+  MutexLock mu(Thread::Current(), *Locks::profiler_lock_);
+  return profiler_ != nullptr;
+}
+
 BackgroundMethodSamplingProfiler::BackgroundMethodSamplingProfiler(int period, int duration,
                    const std::string& profile_file_name,
                    const std::string& process_name,
-                   double backoff_coefficient, int interval_us, bool startImmediately)
+                   double backoff_coefficient, int interval_us, int interval_jitter_us,
+                   bool startImmediately)
     : profile_file_name_(profile_file_name), process_name_(process_name),
       period_s_(period), start_immediately_(startImmediately),
-      interval_us_(interval_us), backoff_factor_(1.0),
+      interval_us_(interval_us), interval_jitter_us_(interval_jitter_us), backoff_factor_(1.0),
       backoff_coefficient_(backoff_coefficient), duration_s_(duration),
       wait_lock_("Profile wait lock"),
       period_condition_("Profile condition", wait_lock_),
       profile_table_(wait_lock_),
-      profiler_barrier_(new Barrier(0)) {
+      profiler_barrier_(new Barrier(0)), samples_(kInitialSampleSlots), num_samples_(0) {
   // Populate the filtered_methods set.
   // This is empty right now, but to add a method, do this:
   //
@@ -417,6 +502,43 @@ void BackgroundMethodSamplingProfiler::RecordMethod(mirror::ArtMethod* method) {
   }
 }
 
+void BackgroundMethodSamplingProfiler::RecordCallSite(mirror::ArtMethod* caller, uint32_t dex_pc,
+                                                      mirror::ArtMethod* callee) {
+  // Only the call sites of the methods the compiler sees are of interest, as for the methods.
+  if (caller->GetDeclaringClass()->GetClassLoader() == nullptr || caller->IsConstructor()) {
+    return;
+  }
+  profile_table_.PutCallSite(caller, dex_pc, callee);
+}
+
+void BackgroundMethodSamplingProfiler::AddSample(mirror::ArtMethod* method,
+                                                 mirror::ArtMethod* caller, uint32_t dex_pc) {
+  size_t index = num_samples_.FetchAndAddSequentiallyConsistent(1);
+  if (LIKELY(index < samples_.size())) {
+    Sample& sample = samples_[index];
+    sample.method = method;
+    sample.caller = caller;
+    sample.dex_pc = dex_pc;
+  }
+}
+
+void BackgroundMethodSamplingProfiler::MergeSamples() {
+  size_t num_samples = num_samples_.LoadRelaxed();
+  size_t num_recorded = std::min(num_samples, samples_.size());
+  for (size_t i = 0; i < num_recorded; ++i) {
+    const Sample& sample = samples_[i];
+    RecordMethod(sample.method);
+    if (sample.caller != nullptr) {
+      RecordCallSite(sample.caller, sample.dex_pc, sample.method);
+    }
+  }
+  if (UNLIKELY(num_samples > samples_.size())) {
+    // The samples which didn't fit are lost, make room for them in the next ticks.
+    VLOG(profiler) << "Dropped " << (num_samples - samples_.size()) << " samples";
+    samples_.resize(2 * num_samples);
+  }
+}
+
 // Clean out any recordings for the method traces.
 void BackgroundMethodSamplingProfiler::CleanProfile() {
   profile_table_.Clear();
@@ -461,6 +583,23 @@ void ProfileSampleResults::Put(mirror::ArtMethod* method) {
   lock_.Unlock(Thread::Current());
 }
 
+void ProfileSampleResults::PutCallSite(mirror::ArtMethod* caller, uint32_t dex_pc,
+                                       mirror::ArtMethod* callee) {
+  MutexLock mu(Thread::Current(), lock_);
+  ++call_sites_[std::make_pair(caller, dex_pc)][callee];
+}
+
+void ProfileSampleResults::GetCallSites(CallSiteProfile* call_sites) {
+  MutexLock mu(Thread::Current(), lock_);
+  for (const auto& site : call_sites_) {
+    std::string caller_name = PrettyMethod(site.first.first);
+    for (const auto& callee : site.second) {
+      call_sites->AddSample(caller_name, site.first.second, PrettyMethod(callee.first),
+                            callee.second);
+    }
+  }
+}
+
 // Write the profile table to the output stream.  Also merge with the previous profile.
 uint32_t ProfileSampleResults::Write(std::ostream &os) {
   ScopedObjectAccess soa(Thread::Current());
@@ -507,6 +646,22 @@ uint32_t ProfileSampleResults::Write(std::ostream &os) {
   return num_methods;
 }
 
+void ProfileSampleResults::GetHotMethods(uint32_t threshold,
+                                         std::vector<mirror::ArtMethod*>* methods) {
+  MutexLock mu(Thread::Current(), lock_);
+  for (int i = 0; i < kHashSize; i++) {
+    Map *map = table[i];
+    if (map == nullptr) {
+      continue;
+    }
+    for (const auto& meth_iter : *map) {
+      if (meth_iter.second >= threshold) {
+        methods->push_back(meth_iter.first);
+      }
+    }
+  }
+}
+
 void ProfileSampleResults::Clear() {
   num_samples_ = 0;
   num_null_methods_ = 0;
@@ -515,6 +670,7 @@ void ProfileSampleResults::Clear() {
      delete table[i];
      table[i] = nullptr;
   }
+  call_sites_.clear();
   previous_.clear();
 }
 
@@ -674,4 +830,199 @@ bool ProfileHelper::LoadTopKSamples(std::set<std::string>& topKSamples, const st
   return true;
 }
 
+const uint8_t CallSiteProfile::kMagic[4] = { 'c', 's', 'p', '\n' };
+
+void CallSiteProfile::AddSample(const std::string& caller, uint32_t dex_pc,
+                                const std::string& callee, uint32_t count) {
+  CallSite& site = call_sites_[std::make_pair(caller, dex_pc)];
+  site.num_samples_ += count;
+  std::vector<Target>& targets = site.targets_;
+  auto it = std::find_if(targets.begin(), targets.end(),
+                         [&callee](const Target& target) { return target.callee_ == callee; });
+  if (it == targets.end()) {
+    if (targets.size() == kMaxTargetsPerCallSite) {
+      if (targets.back().count_ >= count) {
+        // Megamorphic call site, the new target is only counted in the samples.
+        return;
+      }
+      targets.pop_back();
+    }
+    it = targets.insert(targets.end(), Target(callee, 0u));
+  }
+  it->count_ += count;
+  // Keep the most frequent target first.
+  while (it != targets.begin() && (it - 1)->count_ < it->count_) {
+    std::iter_swap(it - 1, it);
+    --it;
+  }
+}
+
+void CallSiteProfile::Merge(const CallSiteProfile& other) {
+  for (const auto& site : other.call_sites_) {
+    uint32_t num_target_samples = 0u;
+    for (const Target& target : site.second.targets_) {
+      AddSample(site.first.first, site.first.second, target.callee_, target.count_);
+      num_target_samples += target.count_;
+    }
+    // The samples of the targets the other profile dropped.
+    call_sites_[site.first].num_samples_ += site.second.num_samples_ - num_target_samples;
+  }
+}
+
+const CallSiteProfile::CallSite* CallSiteProfile::GetCallSite(const std::string& caller,
+                                                              uint32_t dex_pc) const {
+  auto it = call_sites_.find(std::make_pair(caller, dex_pc));
+  return (it != call_sites_.end()) ? &it->second : nullptr;
+}
+
+const CallSiteProfile::Target* CallSiteProfile::GetDominantTarget(const std::string& caller,
+                                                                  uint32_t dex_pc,
+                                                                  uint32_t min_samples,
+                                                                  double min_percent) const {
+  const CallSite* site = GetCallSite(caller, dex_pc);
+  if (site == nullptr || site->num_samples_ < min_samples || site->targets_.empty()) {
+    return nullptr;
+  }
+  const Target& target = site->targets_.front();
+  if (target.count_ * 100.0 < min_percent * site->num_samples_) {
+    return nullptr;
+  }
+  return &target;
+}
+
+// The magic and version, then the names in ULEB128 length and bytes, then the call sites as
+// the ULEB128 caller name index, dex pc, samples and targets, each target as the ULEB128 callee
+// name index and count.
+void CallSiteProfile::Encode(std::vector<uint8_t>* data) const {
+  std::map<std::string, uint32_t> name_indexes;
+  std::vector<const std::string*> names;
+  auto name_index = [&name_indexes, &names](const std::string& name) {
+    auto it = name_indexes.insert(std::make_pair(name, static_cast<uint32_t>(names.size())));
+    if (it.second) {
+      names.push_back(&it.first->first);
+    }
+    return it.first->second;
+  };
+  Leb128EncodingVector sites;
+  sites.PushBackUnsigned(call_sites_.size());
+  for (const auto& site : call_sites_) {
+    sites.PushBackUnsigned(name_index(site.first.first));
+    sites.PushBackUnsigned(site.first.second);
+    sites.PushBackUnsigned(site.second.num_samples_);
+    sites.PushBackUnsigned(site.second.targets_.size());
+    for (const Target& target : site.second.targets_) {
+      sites.PushBackUnsigned(name_index(target.callee_));
+      sites.PushBackUnsigned(target.count_);
+    }
+  }
+  Leb128EncodingVector header;
+  header.PushBackUnsigned(kVersion);
+  header.PushBackUnsigned(names.size());
+  data->assign(kMagic, kMagic + sizeof(kMagic));
+  data->insert(data->end(), header.GetData().begin(), header.GetData().end());
+  for (const std::string* name : names) {
+    Leb128EncodingVector length;
+    length.PushBackUnsigned(name->size());
+    data->insert(data->end(), length.GetData().begin(), length.GetData().end());
+    data->insert(data->end(), name->begin(), name->end());
+  }
+  data->insert(data->end(), sites.GetData().begin(), sites.GetData().end());
+}
+
+bool CallSiteProfile::Decode(const uint8_t* data, size_t size) {
+  Clear();
+  const uint8_t* end = data + size;
+  if (size < sizeof(kMagic) || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+  data += sizeof(kMagic);
+  uint32_t version;
+  uint32_t num_names;
+  if (!DecodeUnsignedLeb128Checked(&data, end, &version) || version != kVersion ||
+      !DecodeUnsignedLeb128Checked(&data, end, &num_names)) {
+    return false;
+  }
+  std::vector<std::string> names;
+  for (uint32_t i = 0; i < num_names; ++i) {
+    uint32_t length;
+    if (!DecodeUnsignedLeb128Checked(&data, end, &length) ||
+        length > static_cast<size_t>(end - data)) {
+      return false;
+    }
+    names.push_back(std::string(reinterpret_cast<const char*>(data), length));
+    data += length;
+  }
+  uint32_t num_sites;
+  if (!DecodeUnsignedLeb128Checked(&data, end, &num_sites)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_sites; ++i) {
+    uint32_t caller, dex_pc, num_samples, num_targets;
+    if (!DecodeUnsignedLeb128Checked(&data, end, &caller) || caller >= names.size() ||
+        !DecodeUnsignedLeb128Checked(&data, end, &dex_pc) ||
+        !DecodeUnsignedLeb128Checked(&data, end, &num_samples) ||
+        !DecodeUnsignedLeb128Checked(&data, end, &num_targets) ||
+        num_targets > kMaxTargetsPerCallSite) {
+      Clear();
+      return false;
+    }
+    Key key(names[caller], dex_pc);
+    if (call_sites_.find(key) != call_sites_.end()) {
+      Clear();
+      return false;
+    }
+    CallSite& site = call_sites_[key];
+    site.num_samples_ = num_samples;
+    uint32_t num_target_samples = 0u;
+    for (uint32_t j = 0; j < num_targets; ++j) {
+      uint32_t callee, count;
+      if (!DecodeUnsignedLeb128Checked(&data, end, &callee) || callee >= names.size() ||
+          !DecodeUnsignedLeb128Checked(&data, end, &count)) {
+        Clear();
+        return false;
+      }
+      site.targets_.push_back(Target(names[callee], count));
+      num_target_samples += count;
+    }
+    if (num_target_samples > num_samples) {
+      Clear();
+      return false;
+    }
+  }
+  if (data != end) {
+    Clear();
+    return false;
+  }
+  return true;
+}
+
+bool CallSiteProfile::ReadFromFile(const std::string& file_name) {
+  std::string contents;
+  if (!ReadFileToString(file_name, &contents)) {
+    Clear();
+    return false;
+  }
+  return Decode(reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+}
+
+bool CallSiteProfile::WriteToFile(const std::string& file_name) const {
+  std::vector<uint8_t> data;
+  Encode(&data);
+  // Written aside and renamed, so that the compiler never reads a partial file.
+  std::string temp_name = file_name + ".tmp";
+  std::unique_ptr<File> file(OS::CreateEmptyFile(temp_name.c_str()));
+  if (file.get() == nullptr) {
+    return false;
+  }
+  if (!file->WriteFully(data.data(), data.size()) || file->Close() != 0) {
+    unlink(temp_name.c_str());
+    return false;
+  }
+  if (rename(temp_name.c_str(), file_name.c_str()) != 0) {
+    unlink(temp_name.c_str());
+    return false;
+  }
+  return true;
+}
+
 }  // namespace art
@@ -17,12 +17,15 @@
 #ifndef ART_RUNTIME_PROFILER_H_
 #define ART_RUNTIME_PROFILER_H_
 
+#include <map>
 #include <memory>
 #include <ostream>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "atomic.h"
 #include "barrier.h"
 #include "base/macros.h"
 #include "base/mutex.h"
@@ -39,6 +42,67 @@ namespace mirror {
 }  // namespace mirror
 class Thread;
 
+//
+// The methods that virtual and interface calls dispatched to, sampled at their call sites
+// with the caller of the method at the top of the stack. A call site is named by the full
+// name of the caller, as in the profile, and the dex pc of its invoke. A call site dispatching
+// mostly to one target is a candidate for a devirtualized call guarded by the target.
+//
+// The table is stored next to the profile in a compact binary file, so that the text profile
+// stays readable by its existing users.
+class CallSiteProfile {
+ public:
+  struct Target {
+    Target(const std::string& callee, uint32_t count) : callee_(callee), count_(count) {}
+    std::string callee_;       // Full name of the method called.
+    uint32_t count_;           // Number of samples calling it.
+  };
+
+  struct CallSite {
+    CallSite() : num_samples_(0) {}
+    uint32_t num_samples_;          // Samples of the call site, including the dropped targets.
+    std::vector<Target> targets_;   // Most frequent first.
+  };
+
+  CallSiteProfile() {}
+
+  void AddSample(const std::string& caller, uint32_t dex_pc, const std::string& callee,
+                 uint32_t count);
+  void Merge(const CallSiteProfile& other);
+  void Clear() { call_sites_.clear(); }
+  size_t NumCallSites() const { return call_sites_.size(); }
+
+  // The samples of the invoke at dex_pc in caller, null if it was never sampled.
+  const CallSite* GetCallSite(const std::string& caller, uint32_t dex_pc) const;
+
+  // The target of at least min_percent of the samples of the call site if the call site has
+  // at least min_samples samples, null otherwise.
+  const Target* GetDominantTarget(const std::string& caller, uint32_t dex_pc,
+                                  uint32_t min_samples, double min_percent) const;
+
+  void Encode(std::vector<uint8_t>* data) const;
+  // Returns false, and leaves the profile empty, if the data is malformed.
+  bool Decode(const uint8_t* data, size_t size);
+
+  // Returns false if there was no file or it was malformed.
+  bool ReadFromFile(const std::string& file_name);
+  bool WriteToFile(const std::string& file_name) const;
+
+  // The file holding the call sites of the given profile file.
+  static std::string GetFileName(const std::string& profile_file_name) {
+    return profile_file_name + ".callsites";
+  }
+
+ private:
+  // Targets kept per call site, the other targets are only counted in the samples.
+  static constexpr size_t kMaxTargetsPerCallSite = 4;
+  static constexpr uint32_t kVersion = 1;
+  static const uint8_t kMagic[4];
+
+  typedef std::pair<std::string, uint32_t> Key;
+  std::map<Key, CallSite> call_sites_;
+};
+
 //
 // This class holds all the results for all runs of the profiler.  It also
 // counts the number of null methods (where we can't determine the method) and
@@ -52,9 +116,15 @@ class ProfileSampleResults {
   ~ProfileSampleResults();
 
   void Put(mirror::ArtMethod* method);
+  // Records that the invoke at dex_pc in caller dispatched to callee.
+  void PutCallSite(mirror::ArtMethod* caller, uint32_t dex_pc, mirror::ArtMethod* callee);
+  // Adds the call sites of this run to call_sites, named like the methods of the profile.
+  void GetCallSites(CallSiteProfile* call_sites) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   uint32_t Write(std::ostream &os);
   void ReadPrevious(int fd);
   void Clear();
+  // Appends the methods sampled at least threshold times in this run.
+  void GetHotMethods(uint32_t threshold, std::vector<mirror::ArtMethod*>* methods);
   uint32_t GetNumSamples() { return num_samples_; }
   void NullMethod() { ++num_null_methods_; }
   void BootMethod() { ++num_boot_methods_; }
@@ -70,6 +140,10 @@ class ProfileSampleResults {
   typedef std::map<mirror::ArtMethod*, uint32_t> Map;   // Map of method vs its count.
   Map *table[kHashSize];
 
+  // Callees sampled at each (caller, dex pc) call site of this run.
+  typedef std::map<std::pair<mirror::ArtMethod*, uint32_t>, Map> CallSiteMap;
+  CallSiteMap call_sites_;
+
   struct PreviousValue {
     PreviousValue() : count_(0), method_size_(0) {}
     PreviousValue(uint32_t count, uint32_t method_size) : count_(count), method_size_(method_size) {}
@@ -102,7 +176,7 @@ class ProfileSampleResults {
 class BackgroundMethodSamplingProfiler {
  public:
   static void Start(int period, int duration, const std::string& profile_filename,
-                    const std::string& procName, int interval_us,
+                    const std::string& procName, int interval_us, int interval_jitter_us,
                     double backoff_coefficient, bool startImmediately)
   LOCKS_EXCLUDED(Locks::mutator_lock_,
                  Locks::thread_list_lock_,
@@ -112,8 +186,19 @@ class BackgroundMethodSamplingProfiler {
   static void Stop() LOCKS_EXCLUDED(Locks::profiler_lock_, wait_lock_);
   static void Shutdown() LOCKS_EXCLUDED(Locks::profiler_lock_);
 
+  // Whether there is a profiler, sampling or waiting for its next run.
+  static bool IsStarted() LOCKS_EXCLUDED(Locks::profiler_lock_);
+
   void RecordMethod(mirror::ArtMethod *method) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // A method has been hit while called from the invoke at dex_pc in caller, record the call site.
+  void RecordCallSite(mirror::ArtMethod* caller, uint32_t dex_pc, mirror::ArtMethod* callee)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Adds the method sampled by a checkpoint to the samples of the current tick, without locking.
+  // The caller is null unless the method is a virtual method called from managed code.
+  void AddSample(mirror::ArtMethod* method, mirror::ArtMethod* caller, uint32_t dex_pc);
+
   Barrier& GetBarrier() {
     return *profiler_barrier_;
   }
@@ -122,12 +207,19 @@ class BackgroundMethodSamplingProfiler {
   explicit BackgroundMethodSamplingProfiler(int period, int duration,
                                             const std::string& profile_filename,
                                             const std::string& process_name,
-                                            double backoff_coefficient, int interval_us, bool startImmediately);
+                                            double backoff_coefficient, int interval_us,
+                                            int interval_jitter_us, bool startImmediately);
+
+  // Records the samples of the tick in the profile table, called once all the threads passed the
+  // barrier.
+  void MergeSamples() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // The sampling interval in microseconds is passed as an argument.
   static void* RunProfilerThread(void* arg) LOCKS_EXCLUDED(Locks::profiler_lock_);
 
   uint32_t WriteProfile() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Merges the call sites of this run into the call site file of the profile.
+  void WriteCallSites() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void CleanProfile();
   uint32_t DumpProfile(std::ostream& os) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -141,6 +233,9 @@ class BackgroundMethodSamplingProfiler {
   // Sampling thread, non-zero when sampling.
   static pthread_t profiler_pthread_;
 
+  // Number of samples a tick can take before samples_ grows.
+  static constexpr size_t kInitialSampleSlots = 64;
+
   // Some measure of the number of samples that are significant
   static constexpr uint32_t kSignificantSamples = 10;
 
@@ -161,6 +256,10 @@ class BackgroundMethodSamplingProfiler {
 
   uint32_t interval_us_;
 
+  // Upper bound of a random time added to each interval, so that the samples don't keep hitting
+  // the same phase of periodic work.
+  uint32_t interval_jitter_us_;
+
   // A backoff coefficent to adjust the profile period based on time.
   double backoff_factor_;
 
@@ -179,6 +278,17 @@ class BackgroundMethodSamplingProfiler {
 
   std::unique_ptr<Barrier> profiler_barrier_;
 
+  // Methods sampled by the checkpoints of the current tick. The sampled threads claim their slot
+  // with num_samples_ rather than locking the profile table, the profiler thread merges the
+  // samples into it after the barrier. It grows when a tick has more samples than slots.
+  struct Sample {
+    mirror::ArtMethod* method;
+    mirror::ArtMethod* caller;
+    uint32_t dex_pc;
+  };
+  std::vector<Sample> samples_;
+  AtomicInteger num_samples_;
+
   // Set of methods to be filtered out.  This will probably be rare because
   // most of the methods we want to be filtered reside in the boot path and
   // are automatically filtered.
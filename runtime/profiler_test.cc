@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "profiler.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+static const char kCaller[] = "void Foo.bar()";
+static const char kCallee[] = "int Foo.size()";
+static const char kOtherCallee[] = "int SubFoo.size()";
+
+TEST(CallSiteProfileTest, DominantTarget) {
+  CallSiteProfile profile;
+  EXPECT_TRUE(profile.GetCallSite(kCaller, 3) == nullptr);
+  profile.AddSample(kCaller, 3, kCallee, 9);
+  profile.AddSample(kCaller, 3, kOtherCallee, 1);
+  profile.AddSample(kCaller, 7, kOtherCallee, 2);
+  EXPECT_EQ(2U, profile.NumCallSites());
+
+  const CallSiteProfile::CallSite* site = profile.GetCallSite(kCaller, 3);
+  ASSERT_TRUE(site != nullptr);
+  EXPECT_EQ(10U, site->num_samples_);
+  ASSERT_EQ(2U, site->targets_.size());
+  EXPECT_EQ(kCallee, site->targets_[0].callee_);
+
+  const CallSiteProfile::Target* target = profile.GetDominantTarget(kCaller, 3, 10, 90.0);
+  ASSERT_TRUE(target != nullptr);
+  EXPECT_EQ(kCallee, target->callee_);
+  EXPECT_TRUE(profile.GetDominantTarget(kCaller, 3, 11, 90.0) == nullptr);
+  EXPECT_TRUE(profile.GetDominantTarget(kCaller, 3, 10, 95.0) == nullptr);
+
+  // The other target becomes the most frequent one.
+  profile.AddSample(kCaller, 3, kOtherCallee, 20);
+  EXPECT_EQ(kOtherCallee, profile.GetCallSite(kCaller, 3)->targets_[0].callee_);
+}
+
+TEST(CallSiteProfileTest, Megamorphic) {
+  CallSiteProfile profile;
+  for (uint32_t i = 0; i < 8; ++i) {
+    profile.AddSample(kCaller, 0, std::string(kCallee) + std::to_string(i), 1);
+  }
+  const CallSiteProfile::CallSite* site = profile.GetCallSite(kCaller, 0);
+  ASSERT_TRUE(site != nullptr);
+  EXPECT_EQ(8U, site->num_samples_);
+  EXPECT_GT(8U, site->targets_.size());
+  EXPECT_TRUE(profile.GetDominantTarget(kCaller, 0, 1, 50.0) == nullptr);
+}
+
+TEST(CallSiteProfileTest, EncodeDecode) {
+  CallSiteProfile profile;
+  profile.AddSample(kCaller, 3, kCallee, 300);
+  profile.AddSample(kCaller, 3, kOtherCallee, 1);
+  profile.AddSample(kCallee, 1000, kOtherCallee, 2);
+  std::vector<uint8_t> data;
+  profile.Encode(&data);
+
+  CallSiteProfile decoded;
+  ASSERT_TRUE(decoded.Decode(data.data(), data.size()));
+  EXPECT_EQ(2U, decoded.NumCallSites());
+  const CallSiteProfile::CallSite* site = decoded.GetCallSite(kCaller, 3);
+  ASSERT_TRUE(site != nullptr);
+  EXPECT_EQ(301U, site->num_samples_);
+  ASSERT_EQ(2U, site->targets_.size());
+  EXPECT_EQ(kCallee, site->targets_[0].callee_);
+  EXPECT_EQ(300U, site->targets_[0].count_);
+  ASSERT_TRUE(decoded.GetCallSite(kCallee, 1000) != nullptr);
+
+  // Merging adds up the samples.
+  decoded.Merge(profile);
+  EXPECT_EQ(602U, decoded.GetCallSite(kCaller, 3)->num_samples_);
+  EXPECT_EQ(4U, decoded.GetCallSite(kCallee, 1000)->num_samples_);
+
+  // Truncated or corrupted data is rejected.
+  for (size_t size = 0; size < data.size(); ++size) {
+    EXPECT_FALSE(decoded.Decode(data.data(), size)) << size;
+    EXPECT_EQ(0U, decoded.NumCallSites());
+  }
+  data[0] = 'x';
+  EXPECT_FALSE(decoded.Decode(data.data(), data.size()));
+}
+
+}  // namespace art
@@ -130,6 +130,58 @@ bool InlineMethodAnalyser::AnalyseMethodCode(verifier::MethodVerifier* verifier,
     case Instruction::IPUT_SHORT:
     case Instruction::IPUT_WIDE:
       return AnalyseIPutMethod(verifier, method);
+    case Instruction::ADD_INT:
+    case Instruction::SUB_INT:
+    case Instruction::MUL_INT:
+    case Instruction::DIV_INT:
+    case Instruction::REM_INT:
+    case Instruction::AND_INT:
+    case Instruction::OR_INT:
+    case Instruction::XOR_INT:
+    case Instruction::SHL_INT:
+    case Instruction::SHR_INT:
+    case Instruction::USHR_INT:
+    case Instruction::ADD_FLOAT:
+    case Instruction::SUB_FLOAT:
+    case Instruction::MUL_FLOAT:
+    case Instruction::DIV_FLOAT:
+    case Instruction::REM_FLOAT:
+    case Instruction::ADD_INT_2ADDR:
+    case Instruction::SUB_INT_2ADDR:
+    case Instruction::MUL_INT_2ADDR:
+    case Instruction::DIV_INT_2ADDR:
+    case Instruction::REM_INT_2ADDR:
+    case Instruction::AND_INT_2ADDR:
+    case Instruction::OR_INT_2ADDR:
+    case Instruction::XOR_INT_2ADDR:
+    case Instruction::SHL_INT_2ADDR:
+    case Instruction::SHR_INT_2ADDR:
+    case Instruction::USHR_INT_2ADDR:
+    case Instruction::ADD_FLOAT_2ADDR:
+    case Instruction::SUB_FLOAT_2ADDR:
+    case Instruction::MUL_FLOAT_2ADDR:
+    case Instruction::DIV_FLOAT_2ADDR:
+    case Instruction::REM_FLOAT_2ADDR:
+    case Instruction::ADD_INT_LIT16:
+    case Instruction::RSUB_INT:
+    case Instruction::MUL_INT_LIT16:
+    case Instruction::DIV_INT_LIT16:
+    case Instruction::REM_INT_LIT16:
+    case Instruction::AND_INT_LIT16:
+    case Instruction::OR_INT_LIT16:
+    case Instruction::XOR_INT_LIT16:
+    case Instruction::ADD_INT_LIT8:
+    case Instruction::RSUB_INT_LIT8:
+    case Instruction::MUL_INT_LIT8:
+    case Instruction::DIV_INT_LIT8:
+    case Instruction::REM_INT_LIT8:
+    case Instruction::AND_INT_LIT8:
+    case Instruction::OR_INT_LIT8:
+    case Instruction::XOR_INT_LIT8:
+    case Instruction::SHL_INT_LIT8:
+    case Instruction::SHR_INT_LIT8:
+    case Instruction::USHR_INT_LIT8:
+      return AnalyseBinaryOpMethod(code_item, method);
     default:
       return false;
   }
@@ -196,6 +248,72 @@ bool InlineMethodAnalyser::AnalyseConstMethod(const DexFile::CodeItem* code_item
   return true;
 }
 
+bool InlineMethodAnalyser::AnalyseBinaryOpMethod(const DexFile::CodeItem* code_item,
+                                                 InlineMethod* result) {
+  const Instruction* instruction = Instruction::At(code_item->insns_);
+  const Instruction* return_instruction = instruction->Next();
+  if (return_instruction->Opcode() != Instruction::RETURN) {
+    return false;
+  }
+  Instruction::Code opcode = instruction->Opcode();
+  uint32_t dest_reg = instruction->VRegA();
+  uint32_t src1_reg;
+  uint32_t src2_reg = 0u;
+  int32_t literal = 0;
+  switch (Instruction::FormatOf(opcode)) {
+    case Instruction::k23x:
+      src1_reg = instruction->VRegB();
+      src2_reg = instruction->VRegC();
+      break;
+    case Instruction::k12x:
+      src1_reg = dest_reg;
+      src2_reg = instruction->VRegB();
+      opcode = static_cast<Instruction::Code>(opcode - Instruction::ADD_INT_2ADDR +
+                                              Instruction::ADD_INT);
+      break;
+    default:
+      DCHECK(Instruction::FormatOf(opcode) == Instruction::k22s ||
+             Instruction::FormatOf(opcode) == Instruction::k22b);
+      src1_reg = instruction->VRegB();
+      literal = instruction->VRegC();
+      break;
+  }
+  if (return_instruction->VRegA_11x() != dest_reg) {
+    return false;  // Not returning the result of the op?
+  }
+  // The inlined op must not throw, only a division by a non-zero literal qualifies.
+  switch (opcode) {
+    case Instruction::DIV_INT:
+    case Instruction::REM_INT:
+      return false;
+    case Instruction::DIV_INT_LIT16:
+    case Instruction::REM_INT_LIT16:
+    case Instruction::DIV_INT_LIT8:
+    case Instruction::REM_INT_LIT8:
+      if (literal == 0) {
+        return false;
+      }
+      break;
+    default:
+      break;
+  }
+  bool has_literal = Instruction::FormatOf(opcode) != Instruction::k23x;
+  uint32_t arg_start = code_item->registers_size_ - code_item->ins_size_;
+  if (src1_reg < arg_start || (!has_literal && src2_reg < arg_start)) {
+    return false;  // An operand is not an argument?
+  }
+  if (result != nullptr) {
+    result->opcode = kInlineOpBinaryOp;
+    result->flags = kInlineSpecial;
+    InlineBinaryOpData* data = &result->d.binary_op_data;
+    data->opcode = opcode;
+    data->src1_arg = src1_reg - arg_start;
+    data->src2_arg = has_literal ? 0u : src2_reg - arg_start;
+    data->literal = literal;
+  }
+  return true;
+}
+
 bool InlineMethodAnalyser::AnalyseIGetMethod(verifier::MethodVerifier* verifier,
                                              InlineMethod* result) {
   const DexFile::CodeItem* code_item = verifier->CodeItem();
@@ -38,6 +38,9 @@ enum InlineMethodOpcode : uint16_t {
   kIntrinsicDoubleCvt,
   kIntrinsicFloatCvt,
   kIntrinsicReverseBytes,
+  kIntrinsicNumberOfLeadingZeros,
+  kIntrinsicNumberOfTrailingZeros,
+  kIntrinsicRotate,
   kIntrinsicAbsInt,
   kIntrinsicAbsLong,
   kIntrinsicAbsFloat,
@@ -48,7 +51,11 @@ enum InlineMethodOpcode : uint16_t {
   kIntrinsicCompareTo,
   kIntrinsicIsEmptyOrLength,
   kIntrinsicIndexOf,
+  kIntrinsicStringEquals,
+  kIntrinsicStringHashCode,
+  kIntrinsicIdentityHashCode,
   kIntrinsicCurrentThread,
+  kIntrinsicSystemArrayCopy,
   kIntrinsicPeek,
   kIntrinsicPoke,
   kIntrinsicCas,
@@ -60,6 +67,7 @@ enum InlineMethodOpcode : uint16_t {
   kInlineOpNonWideConst,
   kInlineOpIGet,
   kInlineOpIPut,
+  kInlineOpBinaryOp,
 };
 std::ostream& operator<<(std::ostream& os, const InlineMethodOpcode& rhs);
 
@@ -84,6 +92,10 @@ enum IntrinsicFlags {
   // kIntrinsicIndexOf
   kIntrinsicFlagBase0 = kIntrinsicFlagMin,
 
+  // kIntrinsicRotate
+  kIntrinsicFlagRight = kIntrinsicFlagNone,
+  kIntrinsicFlagLeft = kIntrinsicFlagMin,
+
   // kIntrinsicUnsafeGet, kIntrinsicUnsafePut, kIntrinsicUnsafeCas
   kIntrinsicFlagIsLong     = kIntrinsicFlagMin,
   // kIntrinsicUnsafeGet, kIntrinsicUnsafePut
@@ -118,6 +130,14 @@ struct InlineReturnArgData {
 };
 COMPILE_ASSERT(sizeof(InlineReturnArgData) == sizeof(uint64_t), InvalidSizeOfInlineReturnArgData);
 
+struct InlineBinaryOpData {
+  uint16_t opcode;   // The 3-register or literal form of the op, never the 2addr form.
+  uint8_t src1_arg;
+  uint8_t src2_arg;  // Unused by the literal forms.
+  int32_t literal;   // Literal forms only.
+};
+COMPILE_ASSERT(sizeof(InlineBinaryOpData) == sizeof(uint64_t), InvalidSizeOfInlineBinaryOpData);
+
 struct InlineMethod {
   InlineMethodOpcode opcode;
   InlineMethodFlags flags;
@@ -125,6 +145,7 @@ struct InlineMethod {
     uint64_t data;
     InlineIGetIPutData ifield_data;
     InlineReturnArgData return_data;
+    InlineBinaryOpData binary_op_data;
   } d;
 };
 
@@ -163,6 +184,7 @@ class InlineMethodAnalyser {
  private:
   static bool AnalyseReturnMethod(const DexFile::CodeItem* code_item, InlineMethod* result);
   static bool AnalyseConstMethod(const DexFile::CodeItem* code_item, InlineMethod* result);
+  static bool AnalyseBinaryOpMethod(const DexFile::CodeItem* code_item, InlineMethod* result);
   static bool AnalyseIGetMethod(verifier::MethodVerifier* verifier, InlineMethod* result)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static bool AnalyseIPutMethod(verifier::MethodVerifier* verifier, InlineMethod* result)
@@ -89,7 +89,8 @@ class CatchBlockStackVisitor FINAL : public StackVisitor {
       if (found_dex_pc != DexFile::kDexNoIndex) {
         exception_handler_->SetHandlerMethod(method);
         exception_handler_->SetHandlerDexPc(found_dex_pc);
-        exception_handler_->SetHandlerQuickFramePc(method->ToNativePc(found_dex_pc));
+        exception_handler_->SetHandlerQuickFramePc(
+            GetHandlerNativePc(method, dex_pc, to_find.Get(), found_dex_pc));
         exception_handler_->SetHandlerQuickFrame(GetCurrentQuickFrame());
         return false;  // End stack walk.
       }
@@ -97,6 +98,20 @@ class CatchBlockStackVisitor FINAL : public StackVisitor {
     return true;  // Continue stack walk.
   }
 
+  // The native pc of the handler is cached along with the search of FindCatchBlock.
+  uintptr_t GetHandlerNativePc(mirror::ArtMethod* method, uint32_t dex_pc,
+                               mirror::Class* exception_class, uint32_t handler_dex_pc)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    CatchHandlerCache* cache = self_->GetCatchHandlerCache();
+    const void* code = method->GetQuickOatEntryPoint();
+    uintptr_t handler_native_pc = cache->GetHandlerNativePc(method, dex_pc, exception_class, code);
+    if (handler_native_pc == 0) {
+      handler_native_pc = method->ToNativePc(handler_dex_pc);
+      cache->SetHandlerNativePc(method, dex_pc, exception_class, code, handler_native_pc);
+    }
+    return handler_native_pc;
+  }
+
   Thread* const self_;
   // The exception we're looking for the catch block of.
   Handle<mirror::Throwable>* exception_;
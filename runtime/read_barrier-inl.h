@@ -19,6 +19,8 @@
 
 #include "read_barrier.h"
 
+#include "atomic.h"
+#include "mirror/object.h"
 #include "mirror/object_reference.h"
 
 namespace art {
@@ -26,17 +28,24 @@ namespace art {
 template <typename MirrorType, ReadBarrierOption kReadBarrierOption>
 inline MirrorType* ReadBarrier::Barrier(
     mirror::Object* obj, MemberOffset offset, mirror::HeapReference<MirrorType>* ref_addr) {
-  // Unused for now.
-  UNUSED(obj);
   UNUSED(offset);
-  UNUSED(ref_addr);
   const bool with_read_barrier = kReadBarrierOption == kWithReadBarrier;
   if (with_read_barrier && kUseBakerReadBarrier) {
-    // To be implemented.
-    return ref_addr->AsMirrorPtr();
+    // The state is read before the reference: the collector forwards the references of a gray
+    // object before it turns the object white.
+    const bool is_gray = IsGray(obj);
+    QuasiAtomic::MembarLoadLoad();
+    MirrorType* ref = ref_addr->AsMirrorPtr();
+    if (UNLIKELY(is_gray)) {
+      ref = reinterpret_cast<MirrorType*>(Mark(ref));
+    }
+    return ref;
   } else if (with_read_barrier && kUseBrooksReadBarrier) {
-    // To be implemented.
-    return ref_addr->AsMirrorPtr();
+    MirrorType* ref = ref_addr->AsMirrorPtr();
+    if (ref != nullptr && UNLIKELY(IsMarking())) {
+      ref = reinterpret_cast<MirrorType*>(Mark(ref));
+    }
+    return ref;
   } else {
     // No read barrier.
     return ref_addr->AsMirrorPtr();
@@ -47,17 +56,29 @@ template <typename MirrorType, ReadBarrierOption kReadBarrierOption>
 inline MirrorType* ReadBarrier::BarrierForWeakRoot(MirrorType** weak_root) {
   MirrorType* ref = *weak_root;
   const bool with_read_barrier = kReadBarrierOption == kWithReadBarrier;
-  if (with_read_barrier && kUseBakerReadBarrier) {
-    // To be implemented.
-    return ref;
-  } else if (with_read_barrier && kUseBrooksReadBarrier) {
-    // To be implemented.
+  if (with_read_barrier && kUseBakerOrBrooksReadBarrier) {
+    // Roots have no holder to be gray, forward them for as long as the collector is marking.
+    if (ref != nullptr && UNLIKELY(IsMarking())) {
+      ref = reinterpret_cast<MirrorType*>(Mark(ref));
+    }
     return ref;
   } else {
     return ref;
   }
 }
 
+inline bool ReadBarrier::IsGray(mirror::Object* obj) {
+  DCHECK(kUseBakerReadBarrier);
+  // Read the raw field, the state is not a reference.
+  volatile uint32_t* state_addr = reinterpret_cast<volatile uint32_t*>(
+      reinterpret_cast<byte*>(obj) + mirror::Object::ReadBarrierPointerOffset().SizeValue());
+  return *state_addr == kGrayState;
+}
+
+inline bool ReadBarrier::IsMarking() {
+  return is_marking_;
+}
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_READ_BARRIER_INL_H_
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "read_barrier.h"
+
+#include "base/logging.h"
+#include "gc/collector/concurrent_copying.h"
+
+namespace art {
+
+gc::collector::ConcurrentCopying* ReadBarrier::collector_ = nullptr;
+volatile bool ReadBarrier::is_marking_ = false;
+
+mirror::Object* ReadBarrier::Mark(mirror::Object* ref) {
+  DCHECK(collector_ != nullptr);
+  return collector_->Mark(ref);
+}
+
+void ReadBarrier::SetMarking(gc::collector::ConcurrentCopying* collector, bool is_marking) {
+  if (is_marking) {
+    collector_ = collector;
+  }
+  is_marking_ = is_marking;
+}
+
+}  // namespace art
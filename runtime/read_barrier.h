@@ -26,6 +26,11 @@
 // which needs to be a C header file for asm_support.h.
 
 namespace art {
+namespace gc {
+namespace collector {
+  class ConcurrentCopying;
+}  // namespace collector
+}  // namespace gc
 namespace mirror {
   class Object;
   template<typename MirrorType> class HeapReference;
@@ -33,6 +38,19 @@ namespace mirror {
 
 class ReadBarrier {
  public:
+  // The states of the Baker read barrier, kept in the read barrier pointer of the object header.
+  // An object is gray while the concurrent copying collector may still have to forward some of
+  // its references, the references loaded from a gray object go through Mark().
+  static constexpr uint32_t kWhiteState = 0;
+  static constexpr uint32_t kGrayState = 1;
+
+  static mirror::Object* WhitePtr() {
+    return reinterpret_cast<mirror::Object*>(kWhiteState);
+  }
+  static mirror::Object* GrayPtr() {
+    return reinterpret_cast<mirror::Object*>(kGrayState);
+  }
+
   template <typename MirrorType, ReadBarrierOption kReadBarrierOption = kWithReadBarrier>
   ALWAYS_INLINE static MirrorType* Barrier(
       mirror::Object* obj, MemberOffset offset, mirror::HeapReference<MirrorType>* ref_addr)
@@ -41,6 +59,29 @@ class ReadBarrier {
   template <typename MirrorType, ReadBarrierOption kReadBarrierOption = kWithReadBarrier>
   ALWAYS_INLINE static MirrorType* BarrierForWeakRoot(MirrorType** weak_root)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns true if obj is gray, see kGrayState.
+  ALWAYS_INLINE static bool IsGray(mirror::Object* obj)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns true while the concurrent copying collector needs the loaded references forwarded.
+  ALWAYS_INLINE static bool IsMarking() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns the to-space reference of ref, copying the object if needed.
+  static mirror::Object* Mark(mirror::Object* ref) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Called by the concurrent copying collector when it starts and stops forwarding the loaded
+  // references.
+  static void SetMarking(gc::collector::ConcurrentCopying* collector, bool is_marking);
+
+ private:
+  // The collector that forwards the references. It is kept once the marking ends for the mutators
+  // still loading from an object they found gray.
+  static gc::collector::ConcurrentCopying* collector_;
+
+  // Mirrors ConcurrentCopying::IsMarking(), so that the barrier reads a static rather than going
+  // through the runtime and the heap.
+  static volatile bool is_marking_;
 };
 
 }  // namespace art
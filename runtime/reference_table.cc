@@ -48,14 +48,15 @@ void ReferenceTable::Add(mirror::Object* obj) {
   entries_.push_back(obj);
 }
 
-void ReferenceTable::Remove(mirror::Object* obj) {
+bool ReferenceTable::Remove(mirror::Object* obj) {
   // We iterate backwards on the assumption that references are LIFO.
   for (int i = entries_.size() - 1; i >= 0; --i) {
     if (entries_[i] == obj) {
       entries_.erase(entries_.begin() + i);
-      return;
+      return true;
     }
   }
+  return false;
 }
 
 // If "obj" is an array, return the number of elements in the array.
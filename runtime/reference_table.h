@@ -41,7 +41,8 @@ class ReferenceTable {
 
   void Add(mirror::Object* obj);
 
-  void Remove(mirror::Object* obj);
+  // Removes the most recent entry of obj, returns false if the table doesn't hold obj.
+  bool Remove(mirror::Object* obj);
 
   size_t Size() const;
 
@@ -37,11 +37,11 @@ TEST_F(ReferenceTableTest, Basics) {
   }
 
   // Check removal of all NULLs in a empty table is a no-op.
-  rt.Remove(NULL);
+  EXPECT_FALSE(rt.Remove(NULL));
   EXPECT_EQ(0U, rt.Size());
 
   // Check removal of all o1 in a empty table is a no-op.
-  rt.Remove(o1);
+  EXPECT_FALSE(rt.Remove(o1));
   EXPECT_EQ(0U, rt.Size());
 
   // Add o1 and check we have 1 element and can dump.
@@ -76,7 +76,7 @@ TEST_F(ReferenceTableTest, Basics) {
 
   // Remove o1 (first element).
   {
-    rt.Remove(o1);
+    EXPECT_TRUE(rt.Remove(o1));
     EXPECT_EQ(10U, rt.Size());
     std::ostringstream oss;
     rt.Dump(oss);
@@ -85,7 +85,7 @@ TEST_F(ReferenceTableTest, Basics) {
 
   // Remove o2 ten times.
   for (size_t i = 0; i < 10; ++i) {
-    rt.Remove(o2);
+    EXPECT_TRUE(rt.Remove(o2));
     EXPECT_EQ(9 - i, rt.Size());
     std::ostringstream oss;
     rt.Dump(oss);
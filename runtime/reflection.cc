@@ -34,6 +34,139 @@
 
 namespace art {
 
+// Returns the primitive type boxed by o and sets value to the boxed value, or returns kPrimNot if
+// o isn't a box. The descriptor is looked up once rather than compared against each box class.
+static Primitive::Type GetBoxedPrimitiveValue(mirror::Object* o, JValue* value)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  mirror::Class* klass = o->GetClass();
+  // The boxes are ordinary classes with a dex class def.
+  if (klass->IsArrayClass() || klass->IsPrimitive() || klass->IsProxyClass()) {
+    return Primitive::kPrimNot;
+  }
+  const DexFile& dex_file = klass->GetDexFile();
+  const char* descriptor =
+      dex_file.GetTypeDescriptor(dex_file.GetTypeId(klass->GetClassDef()->class_idx_));
+  static constexpr char kJavaLang[] = "Ljava/lang/";
+  if (strncmp(descriptor, kJavaLang, sizeof(kJavaLang) - 1) != 0) {
+    return Primitive::kPrimNot;
+  }
+  const char* name = descriptor + sizeof(kJavaLang) - 1;
+  Primitive::Type type;
+  if (strcmp(name, "Integer;") == 0) {
+    type = Primitive::kPrimInt;
+  } else if (strcmp(name, "Long;") == 0) {
+    type = Primitive::kPrimLong;
+  } else if (strcmp(name, "Boolean;") == 0) {
+    type = Primitive::kPrimBoolean;
+  } else if (strcmp(name, "Double;") == 0) {
+    type = Primitive::kPrimDouble;
+  } else if (strcmp(name, "Float;") == 0) {
+    type = Primitive::kPrimFloat;
+  } else if (strcmp(name, "Character;") == 0) {
+    type = Primitive::kPrimChar;
+  } else if (strcmp(name, "Byte;") == 0) {
+    type = Primitive::kPrimByte;
+  } else if (strcmp(name, "Short;") == 0) {
+    type = Primitive::kPrimShort;
+  } else {
+    return Primitive::kPrimNot;
+  }
+  mirror::ArtField* primitive_field = klass->GetIFields()->Get(0);
+  switch (type) {
+    case Primitive::kPrimBoolean:
+      value->SetZ(primitive_field->GetBoolean(o));
+      break;
+    case Primitive::kPrimByte:
+      value->SetB(primitive_field->GetByte(o));
+      break;
+    case Primitive::kPrimChar:
+      value->SetC(primitive_field->GetChar(o));
+      break;
+    case Primitive::kPrimShort:
+      value->SetS(primitive_field->GetShort(o));
+      break;
+    case Primitive::kPrimInt:
+      value->SetI(primitive_field->GetInt(o));
+      break;
+    case Primitive::kPrimLong:
+      value->SetJ(primitive_field->GetLong(o));
+      break;
+    case Primitive::kPrimFloat:
+      value->SetF(primitive_field->GetFloat(o));
+      break;
+    case Primitive::kPrimDouble:
+      value->SetD(primitive_field->GetDouble(o));
+      break;
+    default:
+      LOG(FATAL) << "Unexpected box type " << type;
+  }
+  return type;
+}
+
+// Applies the identity or widening primitive conversion from srcType to dstType. Returns false,
+// without throwing, if there is none.
+static bool WidenPrimitiveValue(Primitive::Type srcType, Primitive::Type dstType,
+                                const JValue& src, JValue* dst) {
+  DCHECK(srcType != Primitive::kPrimNot && dstType != Primitive::kPrimNot);
+  if (LIKELY(srcType == dstType)) {
+    dst->SetJ(src.GetJ());
+    return true;
+  }
+  switch (dstType) {
+  case Primitive::kPrimBoolean:  // Fall-through.
+  case Primitive::kPrimChar:  // Fall-through.
+  case Primitive::kPrimByte:
+    // Only expect assignment with source and destination of identical type.
+    break;
+  case Primitive::kPrimShort:
+    if (srcType == Primitive::kPrimByte) {
+      dst->SetS(src.GetI());
+      return true;
+    }
+    break;
+  case Primitive::kPrimInt:
+    if (srcType == Primitive::kPrimByte || srcType == Primitive::kPrimChar ||
+        srcType == Primitive::kPrimShort) {
+      dst->SetI(src.GetI());
+      return true;
+    }
+    break;
+  case Primitive::kPrimLong:
+    if (srcType == Primitive::kPrimByte || srcType == Primitive::kPrimChar ||
+        srcType == Primitive::kPrimShort || srcType == Primitive::kPrimInt) {
+      dst->SetJ(src.GetI());
+      return true;
+    }
+    break;
+  case Primitive::kPrimFloat:
+    if (srcType == Primitive::kPrimByte || srcType == Primitive::kPrimChar ||
+        srcType == Primitive::kPrimShort || srcType == Primitive::kPrimInt) {
+      dst->SetF(src.GetI());
+      return true;
+    } else if (srcType == Primitive::kPrimLong) {
+      dst->SetF(src.GetJ());
+      return true;
+    }
+    break;
+  case Primitive::kPrimDouble:
+    if (srcType == Primitive::kPrimByte || srcType == Primitive::kPrimChar ||
+        srcType == Primitive::kPrimShort || srcType == Primitive::kPrimInt) {
+      dst->SetD(src.GetI());
+      return true;
+    } else if (srcType == Primitive::kPrimLong) {
+      dst->SetD(src.GetJ());
+      return true;
+    } else if (srcType == Primitive::kPrimFloat) {
+      dst->SetD(src.GetF());
+      return true;
+    }
+    break;
+  default:
+    break;
+  }
+  return false;
+}
+
 class ArgArray {
  public:
   explicit ArgArray(const char* shorty, uint32_t shorty_len)
@@ -210,14 +343,6 @@ class ArgArray {
     }
   }
 
-  static void ThrowIllegalPrimitiveArgumentException(const char* expected,
-                                                     const StringPiece& found_descriptor)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    ThrowIllegalArgumentException(nullptr,
-        StringPrintf("Invalid primitive conversion from %s to %s", expected,
-                     PrettyDescriptor(found_descriptor.as_string()).c_str()).c_str());
-  }
-
   bool BuildArgArrayFromObjectArray(const ScopedObjectAccessAlreadyRunnable& soa,
                                     mirror::Object* receiver,
                                     mirror::ObjectArray<mirror::Object>* args, MethodHelper& mh)
@@ -243,96 +368,56 @@ class ArgArray {
         }
       }
 
-#define DO_FIRST_ARG(match_descriptor, get_fn, append) { \
-          if (LIKELY(arg != nullptr && arg->GetClass<>()->DescriptorEquals(match_descriptor))) { \
-            mirror::ArtField* primitive_field = arg->GetClass()->GetIFields()->Get(0); \
-            append(primitive_field-> get_fn(arg));
-
-#define DO_ARG(match_descriptor, get_fn, append) \
-          } else if (LIKELY(arg != nullptr && \
-                            arg->GetClass<>()->DescriptorEquals(match_descriptor))) { \
-            mirror::ArtField* primitive_field = arg->GetClass()->GetIFields()->Get(0); \
-            append(primitive_field-> get_fn(arg));
-
-#define DO_FAIL(expected) \
-          } else { \
-            if (arg->GetClass<>()->IsPrimitive()) { \
-              ThrowIllegalPrimitiveArgumentException(expected, \
-                                                     arg->GetClass<>()->GetDescriptor().c_str()); \
-            } else { \
-              ThrowIllegalArgumentException(nullptr, \
-                  StringPrintf("method %s argument %zd has type %s, got %s", \
-                      PrettyMethod(mh.GetMethod(), false).c_str(), \
-                      args_offset + 1, \
-                      expected, \
-                      PrettyTypeOf(arg).c_str()).c_str()); \
-            } \
-            return false; \
-          } }
-
-      switch (shorty_[i]) {
-        case 'L':
-          Append(arg);
+      if (shorty_[i] == 'L') {
+        Append(arg);
+        continue;
+      }
+      // A primitive parameter, arg is non-null after the check above. Unbox it and widen it to
+      // the parameter type.
+      Primitive::Type dst_type = Primitive::GetType(shorty_[i]);
+      JValue boxed_value;
+      JValue value;
+      Primitive::Type src_type = GetBoxedPrimitiveValue(arg, &boxed_value);
+      if (UNLIKELY(src_type == Primitive::kPrimNot ||
+                   !WidenPrimitiveValue(src_type, dst_type, boxed_value, &value))) {
+        ThrowIllegalArgumentException(nullptr,
+            StringPrintf("method %s argument %zd has type %s, got %s",
+                PrettyMethod(mh.GetMethod(), false).c_str(),
+                args_offset + 1,
+                PrettyDescriptor(dst_type).c_str(),
+                PrettyTypeOf(arg).c_str()).c_str());
+        return false;
+      }
+      switch (dst_type) {
+        case Primitive::kPrimBoolean:
+          Append(value.GetZ());
           break;
-        case 'Z':
-          DO_FIRST_ARG("Ljava/lang/Boolean;", GetBoolean, Append)
-          DO_FAIL("boolean")
+        case Primitive::kPrimByte:
+          Append(value.GetB());
           break;
-        case 'B':
-          DO_FIRST_ARG("Ljava/lang/Byte;", GetByte, Append)
-          DO_FAIL("byte")
+        case Primitive::kPrimChar:
+          Append(value.GetC());
           break;
-        case 'C':
-          DO_FIRST_ARG("Ljava/lang/Character;", GetChar, Append)
-          DO_FAIL("char")
+        case Primitive::kPrimShort:
+          Append(value.GetS());
           break;
-        case 'S':
-          DO_FIRST_ARG("Ljava/lang/Short;", GetShort, Append)
-          DO_ARG("Ljava/lang/Byte;", GetByte, Append)
-          DO_FAIL("short")
+        case Primitive::kPrimInt:
+          Append(value.GetI());
           break;
-        case 'I':
-          DO_FIRST_ARG("Ljava/lang/Integer;", GetInt, Append)
-          DO_ARG("Ljava/lang/Character;", GetChar, Append)
-          DO_ARG("Ljava/lang/Short;", GetShort, Append)
-          DO_ARG("Ljava/lang/Byte;", GetByte, Append)
-          DO_FAIL("int")
+        case Primitive::kPrimLong:
+          AppendWide(value.GetJ());
           break;
-        case 'J':
-          DO_FIRST_ARG("Ljava/lang/Long;", GetLong, AppendWide)
-          DO_ARG("Ljava/lang/Integer;", GetInt, AppendWide)
-          DO_ARG("Ljava/lang/Character;", GetChar, AppendWide)
-          DO_ARG("Ljava/lang/Short;", GetShort, AppendWide)
-          DO_ARG("Ljava/lang/Byte;", GetByte, AppendWide)
-          DO_FAIL("long")
+        case Primitive::kPrimFloat:
+          AppendFloat(value.GetF());
           break;
-        case 'F':
-          DO_FIRST_ARG("Ljava/lang/Float;", GetFloat, AppendFloat)
-          DO_ARG("Ljava/lang/Long;", GetLong, AppendFloat)
-          DO_ARG("Ljava/lang/Integer;", GetInt, AppendFloat)
-          DO_ARG("Ljava/lang/Character;", GetChar, AppendFloat)
-          DO_ARG("Ljava/lang/Short;", GetShort, AppendFloat)
-          DO_ARG("Ljava/lang/Byte;", GetByte, AppendFloat)
-          DO_FAIL("float")
-          break;
-        case 'D':
-          DO_FIRST_ARG("Ljava/lang/Double;", GetDouble, AppendDouble)
-          DO_ARG("Ljava/lang/Float;", GetFloat, AppendDouble)
-          DO_ARG("Ljava/lang/Long;", GetLong, AppendDouble)
-          DO_ARG("Ljava/lang/Integer;", GetInt, AppendDouble)
-          DO_ARG("Ljava/lang/Character;", GetChar, AppendDouble)
-          DO_ARG("Ljava/lang/Short;", GetShort, AppendDouble)
-          DO_ARG("Ljava/lang/Byte;", GetByte, AppendDouble)
-          DO_FAIL("double")
+        case Primitive::kPrimDouble:
+          AppendDouble(value.GetD());
           break;
 #ifndef NDEBUG
         default:
           LOG(FATAL) << "Unexpected shorty character: " << shorty_[i];
 #endif
       }
-#undef DO_FIRST_ARG
-#undef DO_ARG
-#undef DO_FAIL
     }
     return true;
   }
@@ -372,7 +457,8 @@ static void CheckMethodArguments(mirror::ArtMethod* m, uint32_t* args)
       ++error_count;
     } else if (!param_type->IsPrimitive()) {
       // TODO: check primitives are in range.
-      mirror::Object* argument = reinterpret_cast<mirror::Object*>(args[i + offset]);
+      mirror::Object* argument =
+          reinterpret_cast<StackReference<mirror::Object>*>(&args[i + offset])->AsMirrorPtr();
       if (argument != nullptr && !argument->InstanceOf(param_type)) {
         LOG(ERROR) << "JNI ERROR (app bug): attempt to pass an instance of "
                    << PrettyTypeOf(argument) << " as argument " << (i + 1)
@@ -409,50 +495,79 @@ static void InvokeWithArgArray(const ScopedObjectAccessAlreadyRunnable& soa,
   method->Invoke(soa.Self(), args, arg_array->GetNumBytes(), result, shorty);
 }
 
+// Returns the method a call of method from JNI or reflection dispatches to, and its shorty. The
+// receiver is only given for the calls which dispatch on it. The thread caches the results for its
+// next calls.
+static mirror::ArtMethod* FindMethodForCall(const ScopedObjectAccessAlreadyRunnable& soa,
+                                            mirror::ArtMethod* method, mirror::Object* receiver,
+                                            const char** shorty, uint32_t* shorty_length)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  mirror::Class* klass = (receiver != nullptr) ? receiver->GetClass() : nullptr;
+  JniCallCache* call_cache = &soa.Env()->call_cache;
+  mirror::ArtMethod* target = call_cache->Lookup(method, klass, shorty, shorty_length);
+  if (LIKELY(target != nullptr)) {
+    return target;
+  }
+  target = (receiver != nullptr) ? FindVirtualMethod(receiver, method) : method;
+  MethodHelper mh(target);
+  *shorty = mh.GetShorty();
+  *shorty_length = mh.GetShortyLength();
+  call_cache->Insert(method, klass, target, *shorty, *shorty_length);
+  return target;
+}
+
 JValue InvokeWithVarArgs(const ScopedObjectAccessAlreadyRunnable& soa, jobject obj, jmethodID mid,
                          va_list args)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   mirror::ArtMethod* method = soa.DecodeMethod(mid);
   mirror::Object* receiver = method->IsStatic() ? nullptr : soa.Decode<mirror::Object*>(obj);
-  MethodHelper mh(method);
+  const char* shorty;
+  uint32_t shorty_length;
+  method = FindMethodForCall(soa, method, nullptr, &shorty, &shorty_length);
   JValue result;
-  ArgArray arg_array(mh.GetShorty(), mh.GetShortyLength());
+  ArgArray arg_array(shorty, shorty_length);
   arg_array.BuildArgArrayFromVarArgs(soa, receiver, args);
-  InvokeWithArgArray(soa, method, &arg_array, &result, mh.GetShorty());
+  InvokeWithArgArray(soa, method, &arg_array, &result, shorty);
   return result;
 }
 
 JValue InvokeWithJValues(const ScopedObjectAccessAlreadyRunnable& soa, mirror::Object* receiver,
                          jmethodID mid, jvalue* args) {
-  mirror::ArtMethod* method = soa.DecodeMethod(mid);
-  MethodHelper mh(method);
+  const char* shorty;
+  uint32_t shorty_length;
+  mirror::ArtMethod* method = FindMethodForCall(soa, soa.DecodeMethod(mid), nullptr, &shorty,
+                                                   &shorty_length);
   JValue result;
-  ArgArray arg_array(mh.GetShorty(), mh.GetShortyLength());
+  ArgArray arg_array(shorty, shorty_length);
   arg_array.BuildArgArrayFromJValues(soa, receiver, args);
-  InvokeWithArgArray(soa, method, &arg_array, &result, mh.GetShorty());
+  InvokeWithArgArray(soa, method, &arg_array, &result, shorty);
   return result;
 }
 
 JValue InvokeVirtualOrInterfaceWithJValues(const ScopedObjectAccessAlreadyRunnable& soa,
                                            mirror::Object* receiver, jmethodID mid, jvalue* args) {
-  mirror::ArtMethod* method = FindVirtualMethod(receiver, soa.DecodeMethod(mid));
-  MethodHelper mh(method);
+  const char* shorty;
+  uint32_t shorty_length;
+  mirror::ArtMethod* method = FindMethodForCall(soa, soa.DecodeMethod(mid), receiver, &shorty,
+                                                   &shorty_length);
   JValue result;
-  ArgArray arg_array(mh.GetShorty(), mh.GetShortyLength());
+  ArgArray arg_array(shorty, shorty_length);
   arg_array.BuildArgArrayFromJValues(soa, receiver, args);
-  InvokeWithArgArray(soa, method, &arg_array, &result, mh.GetShorty());
+  InvokeWithArgArray(soa, method, &arg_array, &result, shorty);
   return result;
 }
 
 JValue InvokeVirtualOrInterfaceWithVarArgs(const ScopedObjectAccessAlreadyRunnable& soa,
                                            jobject obj, jmethodID mid, va_list args) {
   mirror::Object* receiver = soa.Decode<mirror::Object*>(obj);
-  mirror::ArtMethod* method = FindVirtualMethod(receiver, soa.DecodeMethod(mid));
-  MethodHelper mh(method);
+  const char* shorty;
+  uint32_t shorty_length;
+  mirror::ArtMethod* method = FindMethodForCall(soa, soa.DecodeMethod(mid), receiver, &shorty,
+                                                   &shorty_length);
   JValue result;
-  ArgArray arg_array(mh.GetShorty(), mh.GetShortyLength());
+  ArgArray arg_array(shorty, shorty_length);
   arg_array.BuildArgArrayFromVarArgs(soa, receiver, args);
-  InvokeWithArgArray(soa, method, &arg_array, &result, mh.GetShorty());
+  InvokeWithArgArray(soa, method, &arg_array, &result, shorty);
   return result;
 }
 
@@ -485,11 +600,14 @@ jobject InvokeMethod(const ScopedObjectAccessAlreadyRunnable& soa, jobject javaM
     if (!VerifyObjectIsClass(receiver, declaring_class)) {
       return NULL;
     }
-
-    // Find the actual implementation of the virtual method.
-    m = receiver->GetClass()->FindVirtualMethodForVirtualOrInterface(m);
   }
 
+  // Find the actual implementation of a virtual method, cached for the next calls with receivers
+  // of the same class.
+  const char* shorty;
+  uint32_t shorty_length;
+  m = FindMethodForCall(soa, m, receiver, &shorty, &shorty_length);
+
   // Get our arrays of arguments and their types, and check they're the same size.
   mirror::ObjectArray<mirror::Object>* objects =
       soa.Decode<mirror::ObjectArray<mirror::Object>*>(javaArgs);
@@ -513,13 +631,13 @@ jobject InvokeMethod(const ScopedObjectAccessAlreadyRunnable& soa, jobject javaM
 
   // Invoke the method.
   JValue result;
-  ArgArray arg_array(mh.GetShorty(), mh.GetShortyLength());
+  ArgArray arg_array(shorty, shorty_length);
   if (!arg_array.BuildArgArrayFromObjectArray(soa, receiver, objects, mh)) {
     CHECK(soa.Self()->IsExceptionPending());
     return nullptr;
   }
 
-  InvokeWithArgArray(soa, m, &arg_array, &result, mh.GetShorty());
+  InvokeWithArgArray(soa, m, &arg_array, &result, shorty);
 
   // Wrap any exception with "Ljava/lang/reflect/InvocationTargetException;" and return early.
   if (soa.Self()->IsExceptionPending()) {
@@ -532,9 +650,8 @@ jobject InvokeMethod(const ScopedObjectAccessAlreadyRunnable& soa, jobject javaM
     return NULL;
   }
 
-  // Box if necessary and return.
-  return soa.AddLocalReference<jobject>(BoxPrimitive(mh.GetReturnType()->GetPrimitiveType(),
-                                                     result));
+  // Box if necessary and return. The shorty gives the primitive type without resolving the class.
+  return soa.AddLocalReference<jobject>(BoxPrimitive(Primitive::GetType(shorty[0]), result));
 }
 
 bool VerifyObjectIsClass(mirror::Object* o, mirror::Class* c) {
@@ -556,63 +673,9 @@ bool VerifyObjectIsClass(mirror::Object* o, mirror::Class* c) {
 bool ConvertPrimitiveValue(const ThrowLocation* throw_location, bool unbox_for_result,
                            Primitive::Type srcType, Primitive::Type dstType,
                            const JValue& src, JValue* dst) {
-  DCHECK(srcType != Primitive::kPrimNot && dstType != Primitive::kPrimNot);
-  if (LIKELY(srcType == dstType)) {
-    dst->SetJ(src.GetJ());
+  if (LIKELY(WidenPrimitiveValue(srcType, dstType, src, dst))) {
     return true;
   }
-  switch (dstType) {
-  case Primitive::kPrimBoolean:  // Fall-through.
-  case Primitive::kPrimChar:  // Fall-through.
-  case Primitive::kPrimByte:
-    // Only expect assignment with source and destination of identical type.
-    break;
-  case Primitive::kPrimShort:
-    if (srcType == Primitive::kPrimByte) {
-      dst->SetS(src.GetI());
-      return true;
-    }
-    break;
-  case Primitive::kPrimInt:
-    if (srcType == Primitive::kPrimByte || srcType == Primitive::kPrimChar ||
-        srcType == Primitive::kPrimShort) {
-      dst->SetI(src.GetI());
-      return true;
-    }
-    break;
-  case Primitive::kPrimLong:
-    if (srcType == Primitive::kPrimByte || srcType == Primitive::kPrimChar ||
-        srcType == Primitive::kPrimShort || srcType == Primitive::kPrimInt) {
-      dst->SetJ(src.GetI());
-      return true;
-    }
-    break;
-  case Primitive::kPrimFloat:
-    if (srcType == Primitive::kPrimByte || srcType == Primitive::kPrimChar ||
-        srcType == Primitive::kPrimShort || srcType == Primitive::kPrimInt) {
-      dst->SetF(src.GetI());
-      return true;
-    } else if (srcType == Primitive::kPrimLong) {
-      dst->SetF(src.GetJ());
-      return true;
-    }
-    break;
-  case Primitive::kPrimDouble:
-    if (srcType == Primitive::kPrimByte || srcType == Primitive::kPrimChar ||
-        srcType == Primitive::kPrimShort || srcType == Primitive::kPrimInt) {
-      dst->SetD(src.GetI());
-      return true;
-    } else if (srcType == Primitive::kPrimLong) {
-      dst->SetD(src.GetJ());
-      return true;
-    } else if (srcType == Primitive::kPrimFloat) {
-      dst->SetD(src.GetF());
-      return true;
-    }
-    break;
-  default:
-    break;
-  }
   if (!unbox_for_result) {
     ThrowIllegalArgumentException(throw_location,
                                   StringPrintf("Invalid primitive conversion from %s to %s",
@@ -676,8 +739,7 @@ mirror::Object* BoxPrimitive(Primitive::Type src_class, const JValue& value) {
     shorty = nullptr;
   }
 
-  ScopedObjectAccessUnchecked soa(Thread::Current());
-  DCHECK_EQ(soa.Self()->GetState(), kRunnable);
+  ScopedObjectAccessNested soa(Thread::Current());
 
   ArgArray arg_array(shorty, 2);
   JValue result;
@@ -745,35 +807,8 @@ static bool UnboxPrimitive(const ThrowLocation* throw_location, mirror::Object*
   }
 
   JValue boxed_value;
-  mirror::Class* klass = o->GetClass();
-  mirror::Class* src_class = nullptr;
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  mirror::ArtField* primitive_field = o->GetClass()->GetIFields()->Get(0);
-  if (klass->DescriptorEquals("Ljava/lang/Boolean;")) {
-    src_class = class_linker->FindPrimitiveClass('Z');
-    boxed_value.SetZ(primitive_field->GetBoolean(o));
-  } else if (klass->DescriptorEquals("Ljava/lang/Byte;")) {
-    src_class = class_linker->FindPrimitiveClass('B');
-    boxed_value.SetB(primitive_field->GetByte(o));
-  } else if (klass->DescriptorEquals("Ljava/lang/Character;")) {
-    src_class = class_linker->FindPrimitiveClass('C');
-    boxed_value.SetC(primitive_field->GetChar(o));
-  } else if (klass->DescriptorEquals("Ljava/lang/Float;")) {
-    src_class = class_linker->FindPrimitiveClass('F');
-    boxed_value.SetF(primitive_field->GetFloat(o));
-  } else if (klass->DescriptorEquals("Ljava/lang/Double;")) {
-    src_class = class_linker->FindPrimitiveClass('D');
-    boxed_value.SetD(primitive_field->GetDouble(o));
-  } else if (klass->DescriptorEquals("Ljava/lang/Integer;")) {
-    src_class = class_linker->FindPrimitiveClass('I');
-    boxed_value.SetI(primitive_field->GetInt(o));
-  } else if (klass->DescriptorEquals("Ljava/lang/Long;")) {
-    src_class = class_linker->FindPrimitiveClass('J');
-    boxed_value.SetJ(primitive_field->GetLong(o));
-  } else if (klass->DescriptorEquals("Ljava/lang/Short;")) {
-    src_class = class_linker->FindPrimitiveClass('S');
-    boxed_value.SetS(primitive_field->GetShort(o));
-  } else {
+  Primitive::Type src_type = GetBoxedPrimitiveValue(o, &boxed_value);
+  if (src_type == Primitive::kPrimNot) {
     ThrowIllegalArgumentException(throw_location,
                                   StringPrintf("%s has type %s, got %s",
                                                UnboxingFailureKind(f).c_str(),
@@ -783,7 +818,7 @@ static bool UnboxPrimitive(const ThrowLocation* throw_location, mirror::Object*
   }
 
   return ConvertPrimitiveValue(throw_location, unbox_for_result,
-                               src_class->GetPrimitiveType(), dst_class->GetPrimitiveType(),
+                               src_type, dst_class->GetPrimitiveType(),
                                boxed_value, unboxed_value);
 }
 
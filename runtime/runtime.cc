@@ -42,15 +42,20 @@
 #include "arch/x86_64/quick_method_frame_info_x86_64.h"
 #include "arch/x86_64/registers_x86_64.h"
 #include "atomic.h"
+#include "base/contention_profiler.h"
+#include "base/timing_logger.h"
 #include "class_linker.h"
 #include "debugger.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/heap.h"
+#include "gc/space/image_space.h"
 #include "gc/space/space.h"
 #include "image.h"
 #include "instrumentation.h"
 #include "intern_table.h"
+#include "jit/jit.h"
 #include "jni_internal.h"
+#include "mem_map.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/array.h"
@@ -60,6 +65,7 @@
 #include "mirror/throwable.h"
 #include "monitor.h"
 #include "parsed_options.h"
+#include "perf_map.h"
 #include "oat_file.h"
 #include "quick/quick_method_frame_info.h"
 #include "reflection.h"
@@ -73,6 +79,7 @@
 #include "trace.h"
 #include "transaction.h"
 #include "profiler.h"
+#include "verifier/background_verifier.h"
 #include "verifier/method_verifier.h"
 #include "well_known_classes.h"
 
@@ -127,8 +134,17 @@ Runtime::Runtime()
       profile_period_s_(0),
       profile_duration_s_(0),
       profile_interval_us_(0),
+      profile_interval_jitter_us_(0),
       profile_backoff_coefficient_(0),
       profile_start_immediately_(true),
+      image_prefetch_record_delay_s_(0),
+      sigquit_checkpoint_dump_(false),
+      fork_heap_dumps_(false),
+      use_jit_(false),
+      jit_code_cache_capacity_(0),
+      jit_compile_threshold_(0),
+      class_unloading_(false),
+      verifier_thread_count_(0),
       method_trace_(false),
       method_trace_file_size_(0),
       instrumentation_(),
@@ -166,9 +182,15 @@ Runtime::~Runtime() {
     shutting_down_ = true;
   }
   // Shut down background profiler before the runtime exits.
-  if (profile_) {
+  if (profile_ || jit_.get() != nullptr) {
     BackgroundMethodSamplingProfiler::Shutdown();
   }
+  if (jit_.get() != nullptr) {
+    jit_->DeleteThreadPool();
+  }
+  if (background_verifier_.get() != nullptr) {
+    background_verifier_->DeleteThreadPool();
+  }
 
   Trace::Shutdown();
 
@@ -182,6 +204,9 @@ Runtime::~Runtime() {
 
   // Make sure all other non-daemon threads have terminated, and all daemon threads are suspended.
   delete thread_list_;
+  // The suspended daemon threads may be in JIT compiled code, only now can the code cache go.
+  jit_.reset();
+  background_verifier_.reset();
   delete monitor_list_;
   delete monitor_pool_;
   delete class_linker_;
@@ -380,8 +405,18 @@ std::string Runtime::GetCompilerExecutable() const {
   return compiler_executable;
 }
 
+std::string Runtime::GetPatchoatExecutable() const {
+  if (!patchoat_executable_.empty()) {
+    return patchoat_executable_;
+  }
+  std::string patchoat_executable(GetAndroidRoot());
+  patchoat_executable += (kIsDebugBuild ? "/bin/patchoatd" : "/bin/patchoat");
+  return patchoat_executable;
+}
+
 bool Runtime::Start() {
   VLOG(startup) << "Runtime::Start entering";
+  TimingLogger timings("Runtime::Start", false, false);
 
   // Restore main thread state to kNative as expected by native code.
   Thread* self = Thread::Current();
@@ -391,13 +426,16 @@ bool Runtime::Start() {
 
   // InitNativeMethods needs to be after started_ so that the classes
   // it touches will have methods linked to the oat file if necessary.
+  timings.StartSplit("InitNativeMethods");
   InitNativeMethods();
 
   // Initialize well known thread group values that may be accessed threads while attaching.
+  timings.NewSplit("InitThreadGroups");
   InitThreadGroups(self);
 
   Thread::FinishStartup();
 
+  timings.NewSplit(is_zygote_ ? "InitZygote" : "DidForkFromZygote");
   if (is_zygote_) {
     if (!InitZygote()) {
       return false;
@@ -406,15 +444,25 @@ bool Runtime::Start() {
     DidForkFromZygote();
   }
 
+  timings.NewSplit("StartDaemonThreads");
   StartDaemonThreads();
+  if (!image_prefetch_profile_.empty() && heap_->HasImageSpace()) {
+    heap_->GetImageSpace()->StartRecordingPrefetchProfile(image_prefetch_profile_,
+                                                          image_prefetch_record_delay_s_);
+  }
 
+  timings.NewSplit("CreateSystemClassLoader");
   system_class_loader_ = CreateSystemClassLoader();
+  timings.EndSplit();
 
   {
     ScopedObjectAccess soa(self);
     self->GetJniEnv()->locals.AssertEmpty();
   }
 
+  if (VLOG_IS_ON(startup)) {
+    LOG(INFO) << Dumpable<TimingLogger>(timings);
+  }
   VLOG(startup) << "Runtime::Start exiting";
 
   finished_starting_ = true;
@@ -429,6 +477,17 @@ bool Runtime::Start() {
     StartProfiler(profile_output_filename_.c_str(), "");
   }
 
+  if (use_jit_ && !GetInstrumentation()->InterpretOnly()) {
+    std::string error_msg;
+    jit_.reset(jit::Jit::Create(jit_code_cache_capacity_, jit_compile_threshold_, &error_msg));
+    if (jit_.get() == nullptr) {
+      LOG(WARNING) << "Failed to create the JIT: " << error_msg;
+    } else if (!profile_) {
+      // The samples only feed the JIT, there is no profile file to write.
+      StartProfiler("", "");
+    }
+  }
+
   return true;
 }
 
@@ -480,13 +539,34 @@ void Runtime::DidForkFromZygote() {
   // Create the thread pool.
   heap_->CreateThreadPool();
 
+  // The zygote can't fork with the workers running, the apps have their own.
+  if (verifier_thread_count_ != 0 && verify_ && !IsCompiler()) {
+    background_verifier_.reset(new verifier::BackgroundVerifier(verifier_thread_count_));
+  }
+
   StartSignalCatcher();
 
+  // The child has its own pid, it needs its own map of the code it inherited.
+  if (perf_map_.get() != nullptr) {
+    ScopedObjectAccess soa(Thread::Current());
+    CreatePerfMap();
+  }
+
   // Start the JDWP thread. If the command-line debugger flags specified "suspend=y",
   // this will pause the runtime, so we probably want this to come last.
   Dbg::StartJdwp();
 }
 
+void Runtime::CreatePerfMap() {
+  std::string error_msg;
+  perf_map_.reset(PerfMap::Create(&error_msg));
+  if (perf_map_.get() == nullptr) {
+    LOG(WARNING) << "Not writing a perf map: " << error_msg;
+    return;
+  }
+  perf_map_->AddLoadedClasses(class_linker_);
+}
+
 void Runtime::StartSignalCatcher() {
   if (!is_zygote_) {
     signal_catcher_ = new SignalCatcher(stack_trace_file_);
@@ -526,10 +606,12 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
     return false;
   }
   VLOG(startup) << "Runtime::Init -verbose:startup enabled";
+  TimingLogger timings("Runtime::Init", false, false);
 
   QuasiAtomic::Startup();
 
-  Monitor::Init(options->lock_profiling_threshold_, options->hook_is_sensitive_thread_);
+  Monitor::Init(options->lock_profiling_threshold_, options->hook_is_sensitive_thread_,
+                options->use_biased_locking_);
 
   boot_class_path_string_ = options->boot_class_path_string_;
   class_path_string_ = options->class_path_string_;
@@ -547,6 +629,7 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   stack_trace_file_ = options->stack_trace_file_;
 
   compiler_executable_ = options->compiler_executable_;
+  patchoat_executable_ = options->patchoat_executable_;
   compiler_options_ = options->compiler_options_;
   image_compiler_options_ = options->image_compiler_options_;
 
@@ -564,9 +647,16 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   }
 
   bool implicit_checks_supported = false;
+  // The suspend trigger load is only recognized by the ARM fault handler.
+  bool implicit_suspend_checks_supported = false;
   switch (kRuntimeISA) {
     case kArm:
     case kThumb2:
+      implicit_checks_supported = true;
+      implicit_suspend_checks_supported = true;
+      break;
+    case kArm64:
+    case kX86_64:
       implicit_checks_supported = true;
       break;
     default:
@@ -581,7 +671,8 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
 
     // These need to be in a specific order.  The null point check handler must be
     // after the suspend check and stack overflow check handlers.
-    if ((options->explicit_checks_ & ParsedOptions::kExplicitSuspendCheck) == 0) {
+    if (implicit_suspend_checks_supported &&
+        (options->explicit_checks_ & ParsedOptions::kExplicitSuspendCheck) == 0) {
       suspend_handler_ = new SuspensionHandler(&fault_manager);
     }
 
@@ -598,6 +689,10 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
     }
   }
 
+  // Before the heap creates the maps which may use huge pages.
+  MemMap::SetUseHugePages(options->use_huge_pages_);
+  MemMap::SetUseNumaInterleave(options->use_numa_interleave_);
+  timings.StartSplit("CreateHeap");
   heap_ = new gc::Heap(options->heap_initial_size_,
                        options->heap_growth_limit_,
                        options->heap_min_free_,
@@ -623,6 +718,21 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
                        options->verify_pre_sweeping_rosalloc_,
                        options->verify_post_gc_rosalloc_);
 
+  image_prefetch_profile_ = options->image_prefetch_profile_;
+  image_prefetch_record_delay_s_ = options->image_prefetch_record_delay_s_;
+  sigquit_checkpoint_dump_ = options->sigquit_checkpoint_dump_;
+  if (heap_->HasImageSpace()) {
+    // Start reading the image and oat file in now, the class linker and the native method
+    // registration in Start touch most of their pages. A profile from an earlier run narrows
+    // this down to the pages that run actually used.
+    gc::space::ImageSpace* image_space = heap_->GetImageSpace();
+    if (image_prefetch_profile_.empty() ||
+        !image_space->AdviseWillNeedFromProfile(image_prefetch_profile_)) {
+      image_space->AdviseWillNeed();
+    }
+  }
+  heap_->SetGcPacing(options->gc_pacing_);
+  heap_->SetVerificationSamplePercent(options->verify_heap_sample_percent_);
   dump_gc_performance_on_shutdown_ = options->dump_gc_performance_on_shutdown_;
 
   BlockSignals();
@@ -646,6 +756,7 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   GetHeap()->EnableObjectValidation();
 
   CHECK_GE(GetHeap()->GetContinuousSpaces().size(), 1U);
+  timings.NewSplit("InitClassLinker");
   class_linker_ = new ClassLinker(intern_table_);
   if (GetHeap()->HasImageSpace()) {
     class_linker_->InitFromImage();
@@ -659,20 +770,32 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   }
   CHECK(class_linker_ != NULL);
   verifier::MethodVerifier::Init();
+  timings.EndSplit();
 
   method_trace_ = options->method_trace_;
   method_trace_file_ = options->method_trace_file_;
   method_trace_file_size_ = options->method_trace_file_size_;
+  method_trace_filter_ = options->method_trace_filter_;
 
   // Extract the profile options.
   // TODO: move into a Trace options struct?
   profile_period_s_ = options->profile_period_s_;
   profile_duration_s_ = options->profile_duration_s_;
   profile_interval_us_ = options->profile_interval_us_;
+  profile_interval_jitter_us_ = options->profile_interval_jitter_us_;
   profile_backoff_coefficient_ = options->profile_backoff_coefficient_;
   profile_start_immediately_ = options->profile_start_immediately_;
   profile_ = options->profile_;
   profile_output_filename_ = options->profile_output_filename_;
+  fork_heap_dumps_ = options->fork_heap_dumps_;
+  if (options->perf_map_) {
+    CreatePerfMap();
+  }
+  use_jit_ = options->use_jit_;
+  jit_code_cache_capacity_ = options->jit_code_cache_capacity_;
+  jit_compile_threshold_ = options->jit_compile_threshold_;
+  class_unloading_ = options->class_unloading_;
+  verifier_thread_count_ = options->verifier_thread_count_;
   // TODO: move this to just be an Trace::Start argument
   Trace::SetDefaultClockSource(options->profile_clock_source_);
 
@@ -688,6 +811,9 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   pre_allocated_OutOfMemoryError_ = self->GetException(NULL);
   self->ClearException();
 
+  if (VLOG_IS_ON(startup)) {
+    LOG(INFO) << Dumpable<TimingLogger>(timings);
+  }
   VLOG(startup) << "Runtime::Init exiting";
   return true;
 }
@@ -790,14 +916,39 @@ void Runtime::RegisterRuntimeNativeMethods(JNIEnv* env) {
 }
 
 void Runtime::DumpForSigQuit(std::ostream& os) {
+  DumpStateForSigQuit(os, true);
+  thread_list_->DumpForSigQuit(os);
+  DumpLocksForSigQuit(os);
+}
+
+void Runtime::DumpForSigQuitWithCheckpoint(std::ostream& os) {
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    // The class census walks the live bitmaps, which needs the world stopped.
+    DumpStateForSigQuit(os, false);
+  }
+  thread_list_->DumpForSigQuitWithCheckpoint(os);
+  DumpLocksForSigQuit(os);
+}
+
+void Runtime::DumpStateForSigQuit(std::ostream& os, bool take_class_census) {
   GetClassLinker()->DumpForSigQuit(os);
   GetInternTable()->DumpForSigQuit(os);
   GetJavaVM()->DumpForSigQuit(os);
-  GetHeap()->DumpForSigQuit(os);
+  GetHeap()->DumpForSigQuit(os, take_class_census);
+  if (background_verifier_.get() != nullptr) {
+    background_verifier_->DumpInfo(os);
+  }
+  MemMap::DumpHugePages(os);
+  MemMap::DumpNumaNodes(os);
   os << "\n";
+}
 
-  thread_list_->DumpForSigQuit(os);
+void Runtime::DumpLocksForSigQuit(std::ostream& os) {
   BaseMutex::DumpAll(os);
+  if (ContentionProfiler::IsEnabled()) {
+    ContentionProfiler::Dump(os);
+  }
 }
 
 void Runtime::DumpLockHolders(std::ostream& os) {
@@ -1125,9 +1276,16 @@ void Runtime::RemoveMethodVerifier(verifier::MethodVerifier* verifier) {
   method_verifiers_.erase(it);
 }
 
+bool Runtime::CanUnloadClasses() const {
+  return class_unloading_ && !IsCompiler() && !use_jit_ &&
+      !BackgroundMethodSamplingProfiler::IsStarted() && !Dbg::IsDebuggerActive() &&
+      Trace::GetMethodTracingMode() == kTracingInactive;
+}
+
 void Runtime::StartProfiler(const char* appDir, const char* procName) {
   BackgroundMethodSamplingProfiler::Start(profile_period_s_, profile_duration_s_, appDir,
-      procName, profile_interval_us_, profile_backoff_coefficient_, profile_start_immediately_);
+      procName, profile_interval_us_, profile_interval_jitter_us_, profile_backoff_coefficient_,
+      profile_start_immediately_);
 }
 
 // Transaction support.
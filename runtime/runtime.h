@@ -54,7 +54,11 @@ namespace mirror {
   class String;
   class Throwable;
 }  // namespace mirror
+namespace jit {
+  class Jit;
+}  // namespace jit
 namespace verifier {
+class BackgroundVerifier;
 class MethodVerifier;
 }
 class ClassLinker;
@@ -64,6 +68,7 @@ class InternTable;
 class JavaVMExt;
 class MonitorList;
 class MonitorPool;
+class PerfMap;
 class SignalCatcher;
 class ThreadList;
 class Trace;
@@ -78,6 +83,9 @@ enum VisitRootFlags : uint8_t {
   kVisitRootFlagStartLoggingNewRoots = 0x4,
   kVisitRootFlagStopLoggingNewRoots = 0x8,
   kVisitRootFlagClearRootLog = 0x10,
+  // Only the classes and dex caches of the boot class loader are roots, the others are swept by
+  // the GC once their class loader is unreachable.
+  kVisitRootFlagUnloadClasses = 0x20,
 };
 
 class Runtime {
@@ -88,6 +96,10 @@ class Runtime {
   static bool Create(const Options& options, bool ignore_unrecognized)
       SHARED_TRYLOCK_FUNCTION(true, Locks::mutator_lock_);
 
+  bool UseCheckpointForSigQuitDump() const {
+    return sigquit_checkpoint_dump_;
+  }
+
   bool IsCompiler() const {
     return compiler_callbacks_ != nullptr;
   }
@@ -105,6 +117,7 @@ class Runtime {
   }
 
   std::string GetCompilerExecutable() const;
+  std::string GetPatchoatExecutable() const;
 
   const std::vector<std::string>& GetCompilerOptions() const {
     return compiler_options_;
@@ -171,6 +184,10 @@ class Runtime {
 
   void DumpForSigQuit(std::ostream& os)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Like DumpForSigQuit, but only holds the mutator lock shared and collects the thread stacks
+  // with a checkpoint, so that running threads are only stopped to dump their own stack.
+  void DumpForSigQuitWithCheckpoint(std::ostream& os)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
   void DumpLockHolders(std::ostream& os);
 
   ~Runtime();
@@ -389,6 +406,44 @@ class Runtime {
   void StartProfiler(const char* appDir, const char* procName);
   void UpdateProfilerState(int state);
 
+  // Prefix of the descriptors of the classes whose methods are traced, set by
+  // -Xmethod-trace-filter. All the methods are traced when it is empty.
+  const std::string& GetMethodTraceFilter() const {
+    return method_trace_filter_;
+  }
+
+  // Whether heap dumps to files are written by a forked copy of the process, set by
+  // -XX:ForkHeapDumps. The threads then only stay suspended for the fork.
+  bool ForkHeapDumps() const {
+    return fork_heap_dumps_;
+  }
+
+  // The symbol map of the compiled code for perf, written with -XX:PerfMap, otherwise null.
+  PerfMap* GetPerfMap() {
+    return perf_map_.get();
+  }
+
+  // Whether hot methods are compiled with the JIT, set by -Xjit.
+  bool UseJit() const {
+    return use_jit_;
+  }
+
+  // The JIT, null until the runtime is started or if it couldn't be created.
+  jit::Jit* GetJit() {
+    return jit_.get();
+  }
+
+  // Whether the full GCs may unload the classes of the unreachable class loaders, set by
+  // -XX:ClassUnloading. Never with the JIT, the profiler, method tracing or a debugger, which keep
+  // raw pointers to methods and dex files.
+  bool CanUnloadClasses() const;
+
+  // Verifies the classes linked at runtime ahead of their initialization, null in the zygote, in
+  // the compiler, or if -Xverifythreads:0 was given.
+  verifier::BackgroundVerifier* GetBackgroundVerifier() {
+    return background_verifier_.get();
+  }
+
   // Transaction support.
   bool IsActiveTransaction() const {
     return preinitialization_transaction_ != nullptr;
@@ -468,6 +523,12 @@ class Runtime {
 
   void StartDaemonThreads();
   void StartSignalCatcher();
+  // Creates the perf map of this process with the code of the classes loaded so far.
+  void CreatePerfMap() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // The parts of the SIGQUIT dump before and after the threads.
+  void DumpStateForSigQuit(std::ostream& os, bool take_class_census)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void DumpLocksForSigQuit(std::ostream& os);
 
   // A pointer to the active runtime or NULL.
   static Runtime* instance_;
@@ -493,6 +554,7 @@ class Runtime {
   bool is_explicit_gc_disabled_;
 
   std::string compiler_executable_;
+  std::string patchoat_executable_;
   std::vector<std::string> compiler_options_;
   std::vector<std::string> image_compiler_options_;
 
@@ -565,13 +627,38 @@ class Runtime {
   uint32_t profile_period_s_;           // Generate profile every n seconds.
   uint32_t profile_duration_s_;         // Run profile for n seconds.
   uint32_t profile_interval_us_;        // Microseconds between samples.
+  uint32_t profile_interval_jitter_us_; // Most microseconds randomly added to the interval.
   double profile_backoff_coefficient_;  // Coefficient to exponential backoff.
   bool profile_start_immediately_;      // Whether the profile should start upon app
                                         // startup or be delayed by some random offset.
 
+  // Pages of the boot image to prefetch at startup, recorded again by every run.
+  std::string image_prefetch_profile_;
+  uint32_t image_prefetch_record_delay_s_;
+
+  // Whether SIGQUIT dumps collect thread stacks with a checkpoint instead of suspending all
+  // threads for the whole dump.
+  bool sigquit_checkpoint_dump_;
+
+  bool fork_heap_dumps_;
+
+  std::unique_ptr<PerfMap> perf_map_;
+
+  // JIT support, fed by the background profiler.
+  bool use_jit_;
+  size_t jit_code_cache_capacity_;
+  size_t jit_compile_threshold_;
+  std::unique_ptr<jit::Jit> jit_;
+
+  bool class_unloading_;
+
+  size_t verifier_thread_count_;
+  std::unique_ptr<verifier::BackgroundVerifier> background_verifier_;
+
   bool method_trace_;
   std::string method_trace_file_;
   size_t method_trace_file_size_;
+  std::string method_trace_filter_;
   instrumentation::Instrumentation instrumentation_;
 
   typedef SafeMap<jobject, std::vector<const DexFile*>, JobjectComparator> CompileTimeClassPaths;
@@ -248,6 +248,28 @@ class ScopedObjectAccessUnchecked : public ScopedObjectAccessAlreadyRunnable {
   DISALLOW_COPY_AND_ASSIGN(ScopedObjectAccessUnchecked);
 };
 
+// Object access for runtime code that is already Runnable, for example entrypoints called from
+// managed code or helpers nested within another scoped object access. Unlike
+// ScopedObjectAccessUnchecked it neither reads nor restores the thread state. Requiring the
+// mutator_lock_ lets annotalysis reject uses from code that would need a real transition.
+class ScopedObjectAccessNested : public ScopedObjectAccessAlreadyRunnable {
+ public:
+  explicit ScopedObjectAccessNested(JNIEnv* env)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) ALWAYS_INLINE
+      : ScopedObjectAccessAlreadyRunnable(env) {
+    DCHECK(IsRunnable());
+  }
+
+  explicit ScopedObjectAccessNested(Thread* self)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) ALWAYS_INLINE
+      : ScopedObjectAccessAlreadyRunnable(self) {
+    DCHECK(IsRunnable());
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScopedObjectAccessNested);
+};
+
 // Annotalysis helping variant of the above.
 class ScopedObjectAccess : public ScopedObjectAccessUnchecked {
  public:
@@ -116,6 +116,10 @@ void SignalCatcher::Output(const std::string& s) {
 
 void SignalCatcher::HandleSigQuit() {
   Runtime* runtime = Runtime::Current();
+  if (runtime->UseCheckpointForSigQuitDump()) {
+    HandleSigQuitWithCheckpoint();
+    return;
+  }
   ThreadList* thread_list = runtime->GetThreadList();
 
   // Grab exclusively the mutator lock, set state to Runnable without checking for a pending
@@ -155,6 +159,24 @@ void SignalCatcher::HandleSigQuit() {
   Output(os.str());
 }
 
+// Dumps the same sections as HandleSigQuit, but without suspending all threads for the length of
+// the dump: each thread dumps its own stack at a checkpoint and the rest only takes the locks it
+// reads under. The class census, which has to walk the heap with the world stopped, is left out.
+void SignalCatcher::HandleSigQuitWithCheckpoint() {
+  std::ostringstream os;
+  os << "\n"
+      << "----- pid " << getpid() << " at " << GetIsoDate() << " -----\n";
+
+  DumpCmdLine(os);
+
+  os << "Build type: " << (kIsDebugBuild ? "debug" : "optimized") << "\n";
+
+  Runtime::Current()->DumpForSigQuitWithCheckpoint(os);
+
+  os << "----- end " << getpid() << " -----\n";
+  Output(os.str());
+}
+
 void SignalCatcher::HandleSigUsr1() {
   LOG(INFO) << "SIGUSR1 forcing GC (no HPROF)";
   Runtime::Current()->GetHeap()->CollectGarbage(false);
@@ -43,6 +43,9 @@ class SignalCatcher {
  private:
   static void* Run(void* arg);
 
+  void HandleSigQuitWithCheckpoint() LOCKS_EXCLUDED(Locks::mutator_lock_,
+                                                    Locks::thread_list_lock_,
+                                                    Locks::thread_suspend_count_lock_);
   void HandleSigUsr1();
   void Output(const std::string& s);
   void SetHaltFlag(bool new_value);
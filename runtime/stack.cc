@@ -25,6 +25,7 @@
 #include "object_utils.h"
 #include "quick/quick_method_frame_info.h"
 #include "runtime.h"
+#include "stack_map.h"
 #include "thread.h"
 #include "thread_list.h"
 #include "throw_location.h"
@@ -148,6 +149,22 @@ uint32_t StackVisitor::GetVReg(mirror::ArtMethod* m, uint16_t vreg, VRegKind kin
     DCHECK(m == GetMethod());
     const void* code_pointer = m->GetQuickOatCodePointer();
     DCHECK(code_pointer != nullptr);
+    if (m->IsOptimized(code_pointer)) {
+      const DexRegisterMap dex_register_map = GetOptimizedDexRegisterMap(m, code_pointer);
+      int32_t value = dex_register_map.GetValue(vreg);
+      switch (dex_register_map.GetLocationKind(vreg)) {
+        case DexRegisterMap::kInStack:
+          return *reinterpret_cast<uint32_t*>(
+              reinterpret_cast<byte*>(GetCurrentQuickFrame()) + value);
+        case DexRegisterMap::kInRegister:
+          return GetGPR(value);
+        case DexRegisterMap::kConstant:
+          return value;
+        default:
+          LOG(FATAL) << "Dex register v" << vreg << " is not live in " << PrettyMethod(m);
+          return 0;
+      }
+    }
     const VmapTable vmap_table(m->GetVmapTable(code_pointer));
     QuickMethodFrameInfo frame_info = m->GetQuickFrameInfo(code_pointer);
     uint32_t vmap_offset;
@@ -174,6 +191,22 @@ void StackVisitor::SetVReg(mirror::ArtMethod* m, uint16_t vreg, uint32_t new_val
     DCHECK(m == GetMethod());
     const void* code_pointer = m->GetQuickOatCodePointer();
     DCHECK(code_pointer != nullptr);
+    if (m->IsOptimized(code_pointer)) {
+      const DexRegisterMap dex_register_map = GetOptimizedDexRegisterMap(m, code_pointer);
+      int32_t value = dex_register_map.GetValue(vreg);
+      switch (dex_register_map.GetLocationKind(vreg)) {
+        case DexRegisterMap::kInStack:
+          *reinterpret_cast<uint32_t*>(reinterpret_cast<byte*>(GetCurrentQuickFrame()) + value) =
+              new_value;
+          break;
+        case DexRegisterMap::kInRegister:
+          SetGPR(value, new_value);
+          break;
+        default:
+          LOG(FATAL) << "Dex register v" << vreg << " can't be written in " << PrettyMethod(m);
+      }
+      return;
+    }
     const VmapTable vmap_table(m->GetVmapTable(code_pointer));
     QuickMethodFrameInfo frame_info = m->GetQuickFrameInfo(code_pointer);
     uint32_t vmap_offset;
@@ -196,6 +229,17 @@ void StackVisitor::SetVReg(mirror::ArtMethod* m, uint16_t vreg, uint32_t new_val
   }
 }
 
+DexRegisterMap StackVisitor::GetOptimizedDexRegisterMap(mirror::ArtMethod* m,
+                                                        const void* code_pointer) const {
+  CodeInfo code_info = m->GetOptimizedCodeInfo(code_pointer);
+  size_t index;
+  CHECK(code_info.FindStackMapForNativePcOffset(GetNativePcOffset(), &index))
+      << "No stack map at native pc offset " << GetNativePcOffset() << " in " << PrettyMethod(m);
+  StackMap stack_map = code_info.GetStackMapAt(index);
+  CHECK(stack_map.HasDexRegisterMap()) << PrettyMethod(m);
+  return code_info.GetDexRegisterMapOf(stack_map);
+}
+
 uintptr_t* StackVisitor::GetGPRAddress(uint32_t reg) const {
   DCHECK(cur_quick_frame_ != NULL) << "This is a quick frame routine";
   return context_->GetGPRAddress(reg);
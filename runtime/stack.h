@@ -39,6 +39,7 @@ namespace mirror {
 }  // namespace mirror
 
 class Context;
+class DexRegisterMap;
 class ShadowFrame;
 class HandleScope;
 class ScopedObjectAccess;
@@ -704,6 +705,10 @@ class StackVisitor {
 
   void SanityCheckFrame() const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // The locations of the dex registers at the current pc of an optimized frame.
+  DexRegisterMap GetOptimizedDexRegisterMap(mirror::ArtMethod* m, const void* code_pointer) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   Thread* const thread_;
   ShadowFrame* cur_shadow_frame_;
   StackReference<mirror::ArtMethod>* cur_quick_frame_;
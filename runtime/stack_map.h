@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_STACK_MAP_H_
+#define ART_RUNTIME_STACK_MAP_H_
+
+#include <stdint.h>
+
+#include "base/logging.h"
+#include "base/macros.h"
+#include "globals.h"
+
+namespace art {
+
+// Reads a little endian value of 'size' bytes, 0 to 4, which needs no alignment.
+static inline uint32_t LoadPackedValue(const uint8_t* data, size_t size) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint32_t>(data[i]) << (i * kBitsPerByte);
+  }
+  return value;
+}
+
+// The number of bytes which hold 'value' in LoadPackedValue.
+static inline size_t PackedValueSize(uint32_t value) {
+  size_t size = 0;
+  while (value != 0) {
+    value >>= kBitsPerByte;
+    ++size;
+  }
+  return size;
+}
+
+// The locations of the dex registers at a stack map. Each dex register has a one byte location
+// kind followed by a 4 byte value: the offset from the stack pointer, the register number or
+// the constant.
+class DexRegisterMap {
+ public:
+  enum LocationKind {
+    kNone = 0,        // The register is dead or holds no value yet.
+    kInStack = 1,     // The value is at an offset from the stack pointer.
+    kInRegister = 2,  // The value is in a register.
+    kConstant = 3,    // The value is a constant.
+  };
+
+  static constexpr size_t kEntrySize = 1 + sizeof(int32_t);
+
+  explicit DexRegisterMap(const uint8_t* data) : data_(data) {
+    DCHECK(data_ != nullptr);
+  }
+
+  LocationKind GetLocationKind(uint16_t dex_register) const {
+    return static_cast<LocationKind>(data_[dex_register * kEntrySize]);
+  }
+
+  int32_t GetValue(uint16_t dex_register) const {
+    return static_cast<int32_t>(LoadPackedValue(&data_[dex_register * kEntrySize + 1],
+                                                sizeof(int32_t)));
+  }
+
+ private:
+  const uint8_t* const data_;
+};
+
+// A safepoint of compiled code: the native pc offset, the dex pc, the registers and the stack
+// slots which hold references, and the locations of the dex registers. The fields have the
+// widths of their code info.
+class StackMap {
+ public:
+  StackMap(const uint8_t* data, size_t native_pc_size, size_t dex_pc_size,
+           size_t register_mask_size, size_t dex_register_map_size, size_t stack_mask_size)
+      : data_(data), native_pc_size_(native_pc_size), dex_pc_size_(dex_pc_size),
+        register_mask_size_(register_mask_size), dex_register_map_size_(dex_register_map_size),
+        stack_mask_size_(stack_mask_size) {
+  }
+
+  uint32_t GetNativePcOffset() const {
+    return LoadPackedValue(data_, native_pc_size_);
+  }
+
+  uint32_t GetDexPc() const {
+    return LoadPackedValue(data_ + native_pc_size_, dex_pc_size_);
+  }
+
+  // Bit i is set when a reference is in core register i.
+  uint32_t GetRegisterMask() const {
+    return LoadPackedValue(data_ + native_pc_size_ + dex_pc_size_, register_mask_size_);
+  }
+
+  bool HasDexRegisterMap() const {
+    return GetDexRegisterMapValue() != 0;
+  }
+
+  // The offset of the dex register map in the dex register maps of the code info.
+  uint32_t GetDexRegisterMapOffset() const {
+    DCHECK(HasDexRegisterMap());
+    return GetDexRegisterMapValue() - 1;
+  }
+
+  // The stack mask has a bit per vreg sized slot of the frame.
+  static constexpr size_t kStackSlotSize = 4;
+
+  // Bit i is set when a reference is in the stack slot at i * kStackSlotSize from the stack
+  // pointer, the bits past the stack mask are clear.
+  bool IsStackSlotReference(size_t slot) const {
+    if (slot >= stack_mask_size_ * kBitsPerByte) {
+      return false;
+    }
+    return ((StackMask()[slot / kBitsPerByte] >> (slot % kBitsPerByte)) & 1) != 0;
+  }
+
+  size_t GetNumberOfStackMaskBits() const {
+    return stack_mask_size_ * kBitsPerByte;
+  }
+
+ private:
+  // The offsets are stored plus one, zero means no dex register map.
+  uint32_t GetDexRegisterMapValue() const {
+    return LoadPackedValue(data_ + native_pc_size_ + dex_pc_size_ + register_mask_size_,
+                           dex_register_map_size_);
+  }
+
+  const uint8_t* StackMask() const {
+    return data_ + native_pc_size_ + dex_pc_size_ + register_mask_size_ + dex_register_map_size_;
+  }
+
+  const uint8_t* const data_;
+  const size_t native_pc_size_;
+  const size_t dex_pc_size_;
+  const size_t register_mask_size_;
+  const size_t dex_register_map_size_;
+  const size_t stack_mask_size_;
+};
+
+// The stack maps of a method compiled by the optimizing backend, which replace its mapping table,
+// vmap table and GC map. The layout is:
+//   uint32_t total size in bytes, uint32_t number of stack maps, uint16_t number of dex
+//   registers, one byte each for the widths of the native pc offset, dex pc, register mask and
+//   dex register map offset fields, uint16_t size of the stack masks in bytes,
+//   the stack maps sorted by native pc offset, all of the same size,
+//   the dex register maps, shared by the stack maps with the same locations.
+class CodeInfo {
+ public:
+  static constexpr size_t kHeaderSize = 4 + 4 + 2 + 4 + 2;
+
+  explicit CodeInfo(const uint8_t* data) : data_(data) {
+    DCHECK(data_ != nullptr);
+  }
+
+  size_t GetSizeInBytes() const {
+    return LoadPackedValue(data_, 4);
+  }
+
+  size_t GetNumberOfStackMaps() const {
+    return LoadPackedValue(data_ + 4, 4);
+  }
+
+  uint16_t GetNumberOfDexRegisters() const {
+    return LoadPackedValue(data_ + 8, 2);
+  }
+
+  size_t GetStackMapSize() const {
+    return NativePcSize() + DexPcSize() + RegisterMaskSize() + DexRegisterMapSize() +
+        StackMaskSize();
+  }
+
+  StackMap GetStackMapAt(size_t i) const {
+    DCHECK_LT(i, GetNumberOfStackMaps());
+    return StackMap(data_ + kHeaderSize + i * GetStackMapSize(), NativePcSize(), DexPcSize(),
+                    RegisterMaskSize(), DexRegisterMapSize(), StackMaskSize());
+  }
+
+  // Binary search of the stack maps, which are sorted by native pc offset.
+  bool FindStackMapForNativePcOffset(uint32_t native_pc_offset, size_t* index) const {
+    size_t low = 0;
+    size_t high = GetNumberOfStackMaps();
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      uint32_t mid_offset = GetStackMapAt(mid).GetNativePcOffset();
+      if (mid_offset < native_pc_offset) {
+        low = mid + 1;
+      } else if (mid_offset > native_pc_offset) {
+        high = mid;
+      } else {
+        *index = mid;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Not called from performance critical code, the dex pcs aren't sorted.
+  bool FindStackMapForDexPc(uint32_t dex_pc, size_t* index) const {
+    for (size_t i = 0, e = GetNumberOfStackMaps(); i < e; ++i) {
+      if (GetStackMapAt(i).GetDexPc() == dex_pc) {
+        *index = i;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  DexRegisterMap GetDexRegisterMapOf(const StackMap& stack_map) const {
+    return DexRegisterMap(data_ + kHeaderSize + GetNumberOfStackMaps() * GetStackMapSize() +
+                          stack_map.GetDexRegisterMapOffset());
+  }
+
+ private:
+  size_t NativePcSize() const {
+    return data_[10];
+  }
+
+  size_t DexPcSize() const {
+    return data_[11];
+  }
+
+  size_t RegisterMaskSize() const {
+    return data_[12];
+  }
+
+  size_t DexRegisterMapSize() const {
+    return data_[13];
+  }
+
+  size_t StackMaskSize() const {
+    return LoadPackedValue(data_ + 14, 2);
+  }
+
+  const uint8_t* const data_;
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_STACK_MAP_H_
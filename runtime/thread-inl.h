@@ -103,6 +103,10 @@ inline void Thread::TransitionFromRunnableToSuspended(ThreadState new_state) {
       break;
     }
   }
+  if (UNLIKELY((old_state_and_flags.as_struct.flags & kSuspendRequest) != 0)) {
+    // Published to the suspending thread by the release of the mutator lock.
+    suspend_acknowledge_time_ns_ = NanoTime();
+  }
   // Release share on mutator_lock_.
   Locks::mutator_lock_->SharedUnlock(this);
 }
@@ -118,6 +122,16 @@ inline ThreadState Thread::TransitionFromSuspendedToRunnable() {
     old_state_and_flags.as_int = tls32_.state_and_flags.as_int;
     DCHECK_EQ(old_state_and_flags.as_struct.state, old_state);
     if (UNLIKELY((old_state_and_flags.as_struct.flags & kSuspendRequest) != 0)) {
+#if ART_USE_FUTEXES
+      // Wait while our suspend count is non-zero. ModifySuspendCount wakes us once it clears the
+      // flag, and the futex doesn't sleep if the word changed in between.
+      while ((old_state_and_flags.as_struct.flags & kSuspendRequest) != 0) {
+        futex(&tls32_.state_and_flags.as_int, FUTEX_WAIT, old_state_and_flags.as_int, nullptr,
+              nullptr, 0);
+        old_state_and_flags.as_int = tls32_.state_and_flags.as_int;
+        DCHECK_EQ(old_state_and_flags.as_struct.state, old_state);
+      }
+#else
       // Wait while our suspend count is non-zero.
       MutexLock mu(this, *Locks::thread_suspend_count_lock_);
       old_state_and_flags.as_int = tls32_.state_and_flags.as_int;
@@ -129,6 +143,7 @@ inline ThreadState Thread::TransitionFromSuspendedToRunnable() {
         DCHECK_EQ(old_state_and_flags.as_struct.state, old_state);
       }
       DCHECK_EQ(GetSuspendCount(), 0);
+#endif
     }
     // Re-acquire shared mutator_lock_ access.
     Locks::mutator_lock_->SharedLock(this);
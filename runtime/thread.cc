@@ -54,6 +54,7 @@
 #include "mirror/object_array-inl.h"
 #include "mirror/stack_trace_element.h"
 #include "monitor.h"
+#include "monitor_pool.h"
 #include "object_utils.h"
 #include "quick_exception_handler.h"
 #include "quick/quick_method_frame_info.h"
@@ -64,6 +65,7 @@
 #include "ScopedUtfChars.h"
 #include "handle_scope-inl.h"
 #include "stack.h"
+#include "stack_map.h"
 #include "thread-inl.h"
 #include "thread_list.h"
 #include "utils.h"
@@ -640,6 +642,14 @@ void Thread::ModifySuspendCount(Thread* self, int delta, bool for_debugger) {
 
   if (tls32_.suspend_count == 0) {
     AtomicClearFlag(kSuspendRequest);
+#if ART_USE_FUTEXES
+    // A suspended thread waits for the flag on its own state and flags word, see
+    // TransitionFromSuspendedToRunnable. Waking each thread by itself spares the resumed threads
+    // from taking thread_suspend_count_lock_ in turn after a broadcast.
+    if (this != self && GetState() != kRunnable) {
+      futex(&tls32_.state_and_flags.as_int, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+#endif
   } else {
     AtomicSetFlag(kSuspendRequest);
     TriggerSuspend();
@@ -917,7 +927,8 @@ struct StackDumpVisitor : public StackVisitor {
     if (o == nullptr) {
       os << "an unknown object";
     } else {
-      if ((o->GetLockWord(false).GetState() == LockWord::kThinLocked) &&
+      LockWord::LockState lock_state = o->GetLockWord(false).GetState();
+      if ((lock_state == LockWord::kThinLocked || lock_state == LockWord::kBiasLocked) &&
           Locks::mutator_lock_->IsExclusiveHeld(Thread::Current())) {
         // Getting the identity hashcode here would result in lock inflation and suspension of the
         // current thread, which isn't safe if this is the only runnable thread.
@@ -1046,7 +1057,11 @@ void Thread::Shutdown() {
   }
 }
 
-Thread::Thread(bool daemon) : tls32_(daemon), wait_monitor_(nullptr), interrupted_(false) {
+Thread::Thread(bool daemon)
+    : tls32_(daemon), wait_monitor_(nullptr), interrupted_(false), trace_buffer_pos_(nullptr),
+      trace_buffer_end_(nullptr), allocation_sample_bytes_left_(0), allocated_bytes_(0),
+      tlab_target_size_(gc::Heap::kDefaultTLABSize), tlab_refills_(0),
+      suspend_acknowledge_time_ns_(0) {
   wait_mutex_ = new Mutex("a thread wait mutex");
   wait_cond_ = new ConditionVariable("a thread wait condition variable", *wait_mutex_);
   tlsPtr_.debug_invoke_req = new DebugInvokeReq;
@@ -1059,8 +1074,9 @@ Thread::Thread(bool daemon) : tls32_(daemon), wait_monitor_(nullptr), interrupte
   tls32_.state_and_flags.as_struct.state = kNative;
   memset(&tlsPtr_.held_mutexes[0], 0, sizeof(tlsPtr_.held_mutexes));
   std::fill(tlsPtr_.rosalloc_runs,
-            tlsPtr_.rosalloc_runs + gc::allocator::RosAlloc::kNumThreadLocalSizeBrackets,
+            tlsPtr_.rosalloc_runs + gc::allocator::RosAlloc::kNumMaxThreadLocalSizeBrackets,
             gc::allocator::RosAlloc::GetDedicatedFullRun());
+  ResetRosAllocSharedAllocations();
   for (uint32_t i = 0; i < kMaxCheckpoints; ++i) {
     tlsPtr_.checkpoint_functions[i] = nullptr;
   }
@@ -1145,6 +1161,15 @@ void Thread::Destroy() {
   if (tlsPtr_.jni_env != nullptr) {
     tlsPtr_.jni_env->monitors.VisitRoots(MonitorExitVisitor, self, 0, kRootVMInternal);
   }
+
+  // The locks biased towards this thread can't be revoked by suspending it once it's gone.
+  {
+    ScopedObjectAccess soa(self);
+    Runtime::Current()->GetMonitorList()->RevokeBiasedHashCodes(self);
+  }
+
+  // Hand the monitor ids this thread reserved back to the pool.
+  MonitorPool::RevokeThreadLocalIds(self);
 }
 
 Thread::~Thread() {
@@ -1286,9 +1311,10 @@ mirror::Object* Thread::DecodeJObject(jobject obj) const {
     // Local references do not need a read barrier.
     result = locals.Get<kWithoutReadBarrier>(ref);
   } else if (kind == kHandleScopeOrInvalid) {
-    // TODO: make stack indirect reference table lookup more efficient.
-    // Check if this is a local reference in the handle scope.
-    if (LIKELY(HandleScopeContains(obj))) {
+    // The arguments of a native method are entries of the handle scope of its JNI stub. Searching
+    // the handle scopes for them is left to CheckJNI and debug builds, which report invalid
+    // references, instead of being paid by every argument a native method decodes.
+    if (LIKELY(!kIsDebugBuild && !tlsPtr_.jni_env->check_jni) || HandleScopeContains(obj)) {
       // Read from handle scope.
       result = reinterpret_cast<StackReference<mirror::Object>*>(obj)->AsMirrorPtr();
       VerifyObject(result);
@@ -1390,6 +1416,10 @@ class CountStackDepthVisitor : public StackVisitor {
   bool skipping_;
 };
 
+// Set in the pc trace of an internal stack trace for the native pc offsets of compiled frames.
+// Dex pcs are below it, except for DexFile::kDexNoIndex.
+static constexpr uint32_t kNativePcOffsetFlag = 0x80000000u;
+
 template<bool kTransactionActive>
 class BuildInternalStackTraceVisitor : public StackVisitor {
  public:
@@ -1444,11 +1474,29 @@ class BuildInternalStackTraceVisitor : public StackVisitor {
     }
     method_trace_->Set<kTransactionActive>(count_, m);
     dex_pc_trace_->Set<kTransactionActive>(count_,
-        m->IsProxyMethod() ? DexFile::kDexNoIndex : GetDexPc());
+        m->IsProxyMethod() ? DexFile::kDexNoIndex : GetTracePc(m));
     ++count_;
     return true;
   }
 
+  // Most traces are never printed, so the search of the mapping table of compiled frames is
+  // left to InternalStackTraceDexPc.
+  uint32_t GetTracePc(mirror::ArtMethod* m) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (IsShadowFrame()) {
+      return GetDexPc();
+    }
+    const void* entry_point = m->GetQuickOatEntryPoint();
+    if (entry_point == nullptr) {
+      return GetDexPc();
+    }
+    uintptr_t native_pc_offset =
+        GetCurrentQuickFramePc() - reinterpret_cast<uintptr_t>(entry_point);
+    if (native_pc_offset >= kNativePcOffsetFlag) {
+      return GetDexPc();
+    }
+    return native_pc_offset | kNativePcOffsetFlag;
+  }
+
   mirror::ObjectArray<mirror::Object>* GetInternalStackTrace() const {
     return method_trace_;
   }
@@ -1494,6 +1542,19 @@ template jobject Thread::CreateInternalStackTrace<false>(
 template jobject Thread::CreateInternalStackTrace<true>(
     const ScopedObjectAccessAlreadyRunnable& soa) const;
 
+uint32_t Thread::InternalStackTraceDexPc(mirror::ArtMethod* method, uint32_t pc) {
+  if (pc == DexFile::kDexNoIndex || (pc & kNativePcOffsetFlag) == 0) {
+    return pc;
+  }
+  const void* entry_point = method->GetQuickOatEntryPoint();
+  if (entry_point == nullptr) {
+    return DexFile::kDexNoIndex;
+  }
+  // The method may have been given new code since the trace was taken, find no dex pc then.
+  uintptr_t native_pc = reinterpret_cast<uintptr_t>(entry_point) + (pc & ~kNativePcOffsetFlag);
+  return method->ToDexPc(native_pc, false);
+}
+
 jobjectArray Thread::InternalStackTraceToStackTraceElementArray(
     const ScopedObjectAccessAlreadyRunnable& soa, jobject internal, jobjectArray output_array,
     int* stack_depth) {
@@ -1529,10 +1590,11 @@ jobjectArray Thread::InternalStackTraceToStackTraceElementArray(
     mirror::ObjectArray<mirror::Object>* method_trace =
           soa.Decode<mirror::ObjectArray<mirror::Object>*>(internal);
     // Prepare parameters for StackTraceElement(String cls, String method, String file, int line)
-    mirror::ArtMethod* method = down_cast<mirror::ArtMethod*>(method_trace->Get(i));
-    MethodHelper mh(method);
+    StackHandleScope<4> hs(soa.Self());
+    Handle<mirror::ArtMethod> method(
+        hs.NewHandle(down_cast<mirror::ArtMethod*>(method_trace->Get(i))));
+    MethodHelper mh(method.Get());
     int32_t line_number;
-    StackHandleScope<3> hs(soa.Self());
     auto class_name_object(hs.NewHandle<mirror::String>(nullptr));
     auto source_name_object(hs.NewHandle<mirror::String>(nullptr));
     if (method->IsProxyMethod()) {
@@ -1541,29 +1603,26 @@ jobjectArray Thread::InternalStackTraceToStackTraceElementArray(
       // source_name_object intentionally left null for proxy methods
     } else {
       mirror::IntArray* pc_trace = down_cast<mirror::IntArray*>(method_trace->Get(depth));
-      uint32_t dex_pc = pc_trace->Get(i);
+      uint32_t dex_pc = InternalStackTraceDexPc(method.Get(), pc_trace->Get(i));
       line_number = mh.GetLineNumFromDexPC(dex_pc);
-      // Allocate element, potentially triggering GC
-      // TODO: reuse class_name_object via Class::name_?
-      const char* descriptor = mh.GetDeclaringClassDescriptor();
-      CHECK(descriptor != nullptr);
-      std::string class_name(PrettyDescriptor(descriptor));
-      class_name_object.Assign(mirror::String::AllocFromModifiedUtf8(soa.Self(), class_name.c_str()));
+      // The class keeps its name once computed, and the source file is resolved through the
+      // dex cache like the names of the methods, so that the frames of a class share strings.
+      const DexFile::ClassDef& class_def = mh.GetClassDef();
+      Handle<mirror::Class> klass(hs.NewHandle(method->GetDeclaringClass()));
+      class_name_object.Assign(mirror::Class::ComputeName(klass));
       if (class_name_object.Get() == nullptr) {
         return nullptr;
       }
-      const char* source_file = mh.GetDeclaringClassSourceFile();
-      if (source_file != nullptr) {
-        source_name_object.Assign(mirror::String::AllocFromModifiedUtf8(soa.Self(), source_file));
+      if (class_def.source_file_idx_ != DexFile::kDexNoIndex) {
+        mh.ChangeMethod(method.Get());
+        source_name_object.Assign(mh.ResolveString(class_def.source_file_idx_));
         if (source_name_object.Get() == nullptr) {
           return nullptr;
         }
       }
     }
-    const char* method_name = mh.GetName();
-    CHECK(method_name != nullptr);
-    Handle<mirror::String> method_name_object(
-        hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), method_name)));
+    mh.ChangeMethod(method.Get());
+    Handle<mirror::String> method_name_object(hs.NewHandle(mh.GetNameAsString()));
     if (method_name_object.Get() == nullptr) {
       return nullptr;
     }
@@ -1883,6 +1942,7 @@ void Thread::DumpThreadOffset(std::ostream& os, uint32_t offset) {
   QUICK_ENTRY_POINT_INFO(pThrowNoSuchMethod)
   QUICK_ENTRY_POINT_INFO(pThrowNullPointer)
   QUICK_ENTRY_POINT_INFO(pThrowStackOverflow)
+  QUICK_ENTRY_POINT_INFO(pReadBarrierMark)
 #undef QUICK_ENTRY_POINT_INFO
 
   os << offset;
@@ -2042,6 +2102,12 @@ class ReferenceMapVisitor : public StackVisitor {
 
     // Process register map (which native and runtime methods don't have)
     if (!m->IsNative() && !m->IsRuntimeMethod() && !m->IsProxyMethod()) {
+      const void* entry_point = Runtime::Current()->GetInstrumentation()->GetQuickCodeFor(m);
+      const void* code_pointer = mirror::ArtMethod::EntryPointToCodePointer(entry_point);
+      if (m->IsOptimized(code_pointer)) {
+        VisitOptimizedFrame(m, entry_point, code_pointer);
+        return;
+      }
       const uint8_t* native_gc_map = m->GetNativeGcMap();
       CHECK(native_gc_map != nullptr) << PrettyMethod(m);
       mh_.ChangeMethod(m);
@@ -2051,12 +2117,9 @@ class ReferenceMapVisitor : public StackVisitor {
       size_t num_regs = std::min(map.RegWidth() * 8,
                                  static_cast<size_t>(code_item->registers_size_));
       if (num_regs > 0) {
-        Runtime* runtime = Runtime::Current();
-        const void* entry_point = runtime->GetInstrumentation()->GetQuickCodeFor(m);
         uintptr_t native_pc_offset = m->NativePcOffset(GetCurrentQuickFramePc(), entry_point);
         const uint8_t* reg_bitmap = map.FindBitMap(native_pc_offset);
         DCHECK(reg_bitmap != nullptr);
-        const void* code_pointer = mirror::ArtMethod::EntryPointToCodePointer(entry_point);
         const VmapTable vmap_table(m->GetVmapTable(code_pointer));
         QuickMethodFrameInfo frame_info = m->GetQuickFrameInfo(code_pointer);
         // For all dex registers in the bitmap
@@ -2094,6 +2157,42 @@ class ReferenceMapVisitor : public StackVisitor {
     }
   }
 
+  // Optimized frames describe their references by stack slot and register, not by dex register.
+  void VisitOptimizedFrame(mirror::ArtMethod* m, const void* entry_point, const void* code_pointer)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    CodeInfo code_info = m->GetOptimizedCodeInfo(code_pointer);
+    uintptr_t native_pc_offset = m->NativePcOffset(GetCurrentQuickFramePc(), entry_point);
+    size_t index;
+    CHECK(code_info.FindStackMapForNativePcOffset(native_pc_offset, &index))
+        << "No stack map at native pc offset " << native_pc_offset << " in " << PrettyMethod(m);
+    StackMap stack_map = code_info.GetStackMapAt(index);
+    byte* frame = reinterpret_cast<byte*>(GetCurrentQuickFrame());
+    for (size_t slot = 0; slot < stack_map.GetNumberOfStackMaskBits(); ++slot) {
+      if (stack_map.IsStackSlotReference(slot)) {
+        byte* slot_addr = frame + slot * StackMap::kStackSlotSize;
+        StackReference<mirror::Object>* ref_addr =
+            reinterpret_cast<StackReference<mirror::Object>*>(slot_addr);
+        mirror::Object* ref = ref_addr->AsMirrorPtr();
+        if (ref != nullptr) {
+          mirror::Object* new_ref = ref;
+          visitor_(&new_ref, slot, this);
+          if (ref != new_ref) {
+            ref_addr->Assign(new_ref);
+          }
+        }
+      }
+    }
+    uint32_t register_mask = stack_map.GetRegisterMask();
+    for (size_t reg = 0; register_mask != 0; ++reg, register_mask >>= 1) {
+      if ((register_mask & 1) != 0) {
+        mirror::Object** ref_addr = reinterpret_cast<mirror::Object**>(GetGPRAddress(reg));
+        if (*ref_addr != nullptr) {
+          visitor_(ref_addr, reg, this);
+        }
+      }
+    }
+  }
+
   static bool TestBitmap(size_t reg, const uint8_t* reg_vector) {
     return ((reg_vector[reg / kBitsPerByte] >> (reg % kBitsPerByte)) & 0x01) != 0;
   }
@@ -2127,6 +2226,10 @@ void Thread::SetClassLoaderOverride(mirror::ClassLoader* class_loader_override)
 
 void Thread::VisitRoots(RootCallback* visitor, void* arg) {
   uint32_t thread_id = GetThreadId();
+  // The cached classes may be moved by the collection visiting the roots.
+  interpreter_cache_.Clear();
+  catch_handler_cache_.Clear();
+  tlsPtr_.jni_env->call_cache.Clear();
   if (tlsPtr_.opeer != nullptr) {
     visitor(&tlsPtr_.opeer, arg, thread_id, kRootThreadObject);
   }
@@ -2143,6 +2246,7 @@ void Thread::VisitRoots(RootCallback* visitor, void* arg) {
   }
   tlsPtr_.jni_env->locals.VisitRoots(visitor, arg, thread_id, kRootJNILocal);
   tlsPtr_.jni_env->monitors.VisitRoots(visitor, arg, thread_id, kRootJNIMonitor);
+  tlsPtr_.jni_env->pinned_arrays.VisitRoots(visitor, arg, thread_id, kRootVMInternal);
   HandleScopeVisitRoots(visitor, arg, thread_id);
   if (tlsPtr_.debug_invoke_req != nullptr) {
     tlsPtr_.debug_invoke_req->VisitRoots(visitor, arg, thread_id, kRootDebugger);
@@ -2210,12 +2314,22 @@ void Thread::SetStackEndForStackOverflow() {
 
 void Thread::SetTlab(byte* start, byte* end) {
   DCHECK_LE(start, end);
+  // The used part of the previous TLAB is counted as allocated once it is given up.
+  AddAllocatedBytes(GetThreadLocalBytesAllocated());
   tlsPtr_.thread_local_start = start;
   tlsPtr_.thread_local_pos  = tlsPtr_.thread_local_start;
   tlsPtr_.thread_local_end = end;
   tlsPtr_.thread_local_objects = 0;
 }
 
+uint64_t Thread::GetAllocatedBytes() const {
+  const byte* start = tlsPtr_.thread_local_start;
+  const byte* pos = tlsPtr_.thread_local_pos;
+  // Another thread may be changing its TLAB meanwhile.
+  const size_t tlab_bytes = (pos > start) ? pos - start : 0;
+  return allocated_bytes_.LoadRelaxed() + tlab_bytes;
+}
+
 bool Thread::HasTlab() const {
   bool has_tlab = tlsPtr_.thread_local_pos != nullptr;
   if (has_tlab) {
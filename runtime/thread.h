@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_THREAD_H_
 #define ART_RUNTIME_THREAD_H_
 
+#include <algorithm>
 #include <bitset>
 #include <deque>
 #include <iosfwd>
@@ -24,8 +25,10 @@
 #include <memory>
 #include <string>
 
+#include "atomic.h"
 #include "base/macros.h"
 #include "base/mutex.h"
+#include "catch_handler_cache.h"
 #include "entrypoints/interpreter/interpreter_entrypoints.h"
 #include "entrypoints/jni/jni_entrypoints.h"
 #include "entrypoints/portable/portable_entrypoints.h"
@@ -33,6 +36,7 @@
 #include "gc/allocator/rosalloc.h"
 #include "globals.h"
 #include "handle_scope.h"
+#include "interpreter/interpreter_cache.h"
 #include "jvalue.h"
 #include "object_callbacks.h"
 #include "offsets.h"
@@ -469,6 +473,11 @@ class Thread {
       jobjectArray output_array = nullptr, int* stack_depth = nullptr)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Returns the dex pc of an entry of the pc trace of an internal stack trace. Compiled frames
+  // record their native pc offset, which is only mapped to a dex pc when the trace is decoded.
+  static uint32_t InternalStackTraceDexPc(mirror::ArtMethod* method, uint32_t pc)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void VisitRoots(RootCallback* visitor, void* arg) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   ALWAYS_INLINE void VerifyStack() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -563,6 +572,25 @@ class Thread {
         OFFSETOF_MEMBER(tls_ptr_sized_values, suspend_trigger));
   }
 
+  // TLAB fields, bumped by compiled code allocating objects inline.
+  template<size_t pointer_size>
+  static ThreadOffset<pointer_size> ThreadLocalPosOffset() {
+    return ThreadOffsetFromTlsPtr<pointer_size>(
+        OFFSETOF_MEMBER(tls_ptr_sized_values, thread_local_pos));
+  }
+
+  template<size_t pointer_size>
+  static ThreadOffset<pointer_size> ThreadLocalEndOffset() {
+    return ThreadOffsetFromTlsPtr<pointer_size>(
+        OFFSETOF_MEMBER(tls_ptr_sized_values, thread_local_end));
+  }
+
+  template<size_t pointer_size>
+  static ThreadOffset<pointer_size> ThreadLocalObjectsOffset() {
+    return ThreadOffsetFromTlsPtr<pointer_size>(
+        OFFSETOF_MEMBER(tls_ptr_sized_values, thread_local_objects));
+  }
+
   // Size of stack less any space reserved for stack overflow
   size_t GetStackSize() const {
     return tlsPtr_.stack_size - (tlsPtr_.stack_end - tlsPtr_.stack_begin);
@@ -769,6 +797,43 @@ class Thread {
   void SetTlab(byte* start, byte* end);
   bool HasTlab() const;
 
+  byte* GetTraceBufferPos() const {
+    return trace_buffer_pos_;
+  }
+
+  byte* GetTraceBufferEnd() const {
+    return trace_buffer_end_;
+  }
+
+  void SetTraceBuffer(byte* pos, byte* end) {
+    trace_buffer_pos_ = pos;
+    trace_buffer_end_ = end;
+  }
+
+  InterpreterCache* GetInterpreterCache() {
+    return &interpreter_cache_;
+  }
+
+  CatchHandlerCache* GetCatchHandlerCache() {
+    return &catch_handler_cache_;
+  }
+
+  // When this thread last released its share of the mutator lock for a suspend request, for
+  // the time to safepoint statistics of ThreadList::SuspendAll.
+  uint64_t GetSuspendAcknowledgeTime() const {
+    return suspend_acknowledge_time_ns_;
+  }
+
+  // The bytes this thread allocates before its next allocation sample, 0 until the first sampled
+  // allocation of the thread draws it.
+  size_t GetAllocationSampleBytesLeft() const {
+    return allocation_sample_bytes_left_;
+  }
+
+  void SetAllocationSampleBytesLeft(size_t bytes) {
+    allocation_sample_bytes_left_ = bytes;
+  }
+
   // Remove the suspend trigger for this thread by making the suspend_trigger_ TLS value
   // equal to a valid pointer.
   // TODO: does this need to atomic?  I don't think so.
@@ -801,6 +866,44 @@ class Thread {
     return tlsPtr_.thread_local_objects;
   }
 
+  // The bytes allocated by this thread since it started, always counted. They are counted when
+  // the thread takes a TLAB or a RosAlloc thread-local run, not at each allocation. The free slots
+  // of the current thread-local runs count as allocated until the runs are revoked. Read for
+  // another thread, the value may be off by a TLAB.
+  uint64_t GetAllocatedBytes() const;
+
+  // Only called by this thread, or by another one while this thread is suspended.
+  void AddAllocatedBytes(size_t bytes) {
+    allocated_bytes_.StoreRelaxed(allocated_bytes_.LoadRelaxed() + bytes);
+  }
+
+  void SubtractAllocatedBytes(size_t bytes) {
+    DCHECK_GE(allocated_bytes_.LoadRelaxed(), bytes);
+    allocated_bytes_.StoreRelaxed(allocated_bytes_.LoadRelaxed() - bytes);
+  }
+
+  // The size of the next TLAB, adapted by the BumpPointerSpace to how fast the thread fills them.
+  size_t GetTlabTargetSize() const {
+    return tlab_target_size_;
+  }
+
+  void SetTlabTargetSize(size_t size) {
+    tlab_target_size_ = size;
+  }
+
+  // The TLAB refills since the last GC.
+  size_t GetTlabRefills() const {
+    return tlab_refills_;
+  }
+
+  size_t IncrementTlabRefills() {
+    return ++tlab_refills_;
+  }
+
+  void ResetTlabRefills() {
+    tlab_refills_ = 0;
+  }
+
   void* GetRosAllocRun(size_t index) const {
     return tlsPtr_.rosalloc_runs[index];
   }
@@ -809,6 +912,34 @@ class Thread {
     tlsPtr_.rosalloc_runs[index] = run;
   }
 
+  // The allocations from the shared runs of the adaptive thread-local size brackets, since the
+  // thread-local runs were last revoked.
+  size_t IncrementRosAllocSharedAllocations(size_t index) {
+    return ++rosalloc_shared_allocations_[index];
+  }
+
+  void ResetRosAllocSharedAllocations() {
+    std::fill(rosalloc_shared_allocations_,
+              rosalloc_shared_allocations_ + gc::allocator::RosAlloc::kNumMaxThreadLocalSizeBrackets,
+              0);
+  }
+
+  // Maximum number of free monitor ids a thread keeps to itself.
+  static constexpr size_t kMonitorIdCacheSize = 16;
+
+  uint32_t* GetMonitorIdCache() {
+    return tlsPtr_.monitor_id_cache;
+  }
+
+  size_t GetMonitorIdCacheCount() const {
+    return tlsPtr_.monitor_id_cache_count;
+  }
+
+  void SetMonitorIdCacheCount(size_t count) {
+    DCHECK_LE(count, kMonitorIdCacheSize);
+    tlsPtr_.monitor_id_cache_count = count;
+  }
+
  private:
   explicit Thread(bool daemon);
   ~Thread() LOCKS_EXCLUDED(Locks::mutator_lock_,
@@ -972,7 +1103,8 @@ class Thread {
       deoptimization_shadow_frame(nullptr), shadow_frame_under_construction(nullptr), name(nullptr),
       pthread_self(0), last_no_thread_suspension_cause(nullptr), thread_local_start(nullptr),
       thread_local_pos(nullptr), thread_local_end(nullptr), thread_local_objects(0),
-      thread_local_alloc_stack_top(nullptr), thread_local_alloc_stack_end(nullptr) {
+      thread_local_alloc_stack_top(nullptr), thread_local_alloc_stack_end(nullptr),
+      monitor_id_cache_count(0) {
     }
 
     // The biased card table, see CardTable for details.
@@ -1075,13 +1207,17 @@ class Thread {
     byte* thread_local_end;
     size_t thread_local_objects;
 
-    // There are RosAlloc::kNumThreadLocalSizeBrackets thread-local size brackets per thread.
-    void* rosalloc_runs[gc::allocator::RosAlloc::kNumThreadLocalSizeBrackets];
+    // There are RosAlloc::kNumMaxThreadLocalSizeBrackets thread-local size brackets per thread.
+    void* rosalloc_runs[gc::allocator::RosAlloc::kNumMaxThreadLocalSizeBrackets];
 
     // Thread-local allocation stack data/routines.
     mirror::Object** thread_local_alloc_stack_top;
     mirror::Object** thread_local_alloc_stack_end;
 
+    // Free monitor ids reserved by this thread from the MonitorPool.
+    size_t monitor_id_cache_count;
+    uint32_t monitor_id_cache[kMonitorIdCacheSize];
+
     // Support for Mutex lock hierarchy bug detection.
     BaseMutex* held_mutexes[kLockLevelCount];
   } tlsPtr_;
@@ -1097,6 +1233,32 @@ class Thread {
   // Thread "interrupted" status; stays raised until queried or thrown.
   bool interrupted_ GUARDED_BY(wait_mutex_);
 
+  // The unused part of the chunk of the method trace buffer reserved by this thread.
+  byte* trace_buffer_pos_;
+  byte* trace_buffer_end_;
+
+  // Targets of the virtual and interface invokes run by the interpreter on this thread.
+  InterpreterCache interpreter_cache_;
+
+  // The catch handlers found for the exceptions thrown on this thread.
+  CatchHandlerCache catch_handler_cache_;
+
+  // Only used by the allocation sampler.
+  size_t allocation_sample_bytes_left_;
+
+  // The bytes allocated outside of the current TLAB, see GetAllocatedBytes.
+  Atomic<uint64_t> allocated_bytes_;
+
+  // Only used by the BumpPointerSpace, see GetTlabTargetSize.
+  size_t tlab_target_size_;
+  size_t tlab_refills_;
+
+  // See GetSuspendAcknowledgeTime.
+  uint64_t suspend_acknowledge_time_ns_;
+
+  // Only used by RosAlloc, indexed by size bracket.
+  size_t rosalloc_shared_allocations_[gc::allocator::RosAlloc::kNumMaxThreadLocalSizeBrackets];
+
   friend class Dbg;  // For SetStateUnsafe.
   friend class gc::collector::SemiSpace;  // For getting stack traces.
   friend class Runtime;  // For CreatePeer.
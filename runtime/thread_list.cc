@@ -22,15 +22,18 @@
 #include <dirent.h>
 #include <ScopedLocalRef.h>
 #include <ScopedUtfChars.h>
+#include <sstream>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "barrier.h"
 #include "base/mutex.h"
 #include "base/mutex-inl.h"
 #include "base/timing_logger.h"
 #include "debugger.h"
 #include "jni_internal.h"
-#include "lock_word.h"
+#include "lock_word-inl.h"
+#include "mirror/object-inl.h"
 #include "monitor.h"
 #include "scoped_thread_state_change.h"
 #include "thread.h"
@@ -40,7 +43,10 @@
 namespace art {
 
 ThreadList::ThreadList()
-    : suspend_all_count_(0), debug_suspend_all_count_(0),
+    : suspend_all_histogram_("suspend all time to safepoint", kSuspendAllBucketSize,
+                             kSuspendAllBucketCount),
+      longest_suspend_all_ns_(0),
+      suspend_all_count_(0), debug_suspend_all_count_(0),
       thread_exit_cond_("thread exit condition variable", *Locks::thread_list_lock_) {
   CHECK(Monitor::IsValidLockWord(LockWord::FromThinLockId(kMaxThreadId, 1)));
 }
@@ -89,10 +95,77 @@ void ThreadList::DumpForSigQuit(std::ostream& os) {
   {
     MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
     DumpLocked(os);
+    DumpSuspendAllStats(os);
   }
   DumpUnattachedThreads(os);
 }
 
+// Dumps the thread it runs for into a string of its own, so that threads only wait for each
+// other to append the result.
+class DumpCheckpoint : public Closure {
+ public:
+  explicit DumpCheckpoint(Barrier* barrier)
+      : lock_("SIGQUIT dump checkpoint lock"), barrier_(barrier) {
+  }
+
+  virtual void Run(Thread* thread) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    // Note: self is not necessarily equal to thread since thread may be suspended.
+    Thread* self = Thread::Current();
+    std::ostringstream local_os;
+    {
+      ScopedObjectAccess soa(self);
+      thread->Dump(local_os);
+    }
+    local_os << "\n";
+    {
+      MutexLock mu(self, lock_);
+      thread_dumps_.push_back(local_os.str());
+    }
+    barrier_->Pass(self);
+  }
+
+  const std::vector<std::string>& GetThreadDumps() const {
+    return thread_dumps_;
+  }
+
+ private:
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::vector<std::string> thread_dumps_ GUARDED_BY(lock_);
+  Barrier* const barrier_;
+};
+
+void ThreadList::DumpForSigQuitWithCheckpoint(std::ostream& os) {
+  Thread* self = Thread::Current();
+  Barrier barrier(0);
+  DumpCheckpoint checkpoint(&barrier);
+  size_t barrier_count = RunCheckpoint(&checkpoint);
+  {
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    barrier.Increment(self, barrier_count);
+  }
+  // Every thread passed the barrier after appending its dump.
+  const std::vector<std::string>& thread_dumps = checkpoint.GetThreadDumps();
+  os << "DALVIK THREADS (" << thread_dumps.size() << "):\n";
+  for (const std::string& thread_dump : thread_dumps) {
+    os << thread_dump;
+  }
+  {
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    DumpSuspendAllStats(os);
+  }
+  DumpUnattachedThreads(os);
+}
+
+void ThreadList::DumpSuspendAllStats(std::ostream& os) {
+  if (suspend_all_histogram_.SampleSize() != 0) {
+    Histogram<uint64_t>::CumulativeData cumulative_data;
+    suspend_all_histogram_.CreateHistogram(&cumulative_data);
+    suspend_all_histogram_.PrintConfidenceIntervals(os, 0.99, cumulative_data);
+    os << "Longest suspend all: " << PrettyDuration(longest_suspend_all_ns_)
+       << ", last thread to suspend: " << longest_suspend_all_thread_ << "\n";
+  }
+}
+
 static void DumpUnattachedThread(std::ostream& os, pid_t tid) NO_THREAD_SAFETY_ANALYSIS {
   // TODO: No thread safety analysis as DumpState with a NULL thread won't access fields, should
   // refactor DumpState to avoid skipping analysis.
@@ -313,6 +386,7 @@ void ThreadList::SuspendAll() {
   if (kDebugLocking) {
     CHECK_NE(self->GetState(), kRunnable);
   }
+  const uint64_t start_time = NanoTime();
   {
     MutexLock mu(self, *Locks::thread_list_lock_);
     MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
@@ -338,6 +412,8 @@ void ThreadList::SuspendAll() {
   Locks::mutator_lock_->ExclusiveLock(self);
 #endif
 
+  RecordSuspendAll(self, start_time);
+
   if (kDebugLocking) {
     // Debug check that all threads are suspended.
     AssertThreadsAreSuspended(self, self);
@@ -349,6 +425,39 @@ void ThreadList::SuspendAll() {
   VLOG(threads) << *self << " SuspendAll complete";
 }
 
+void ThreadList::RecordSuspendAll(Thread* self, uint64_t start_time) {
+  const uint64_t duration = NanoTime() - start_time;
+  MutexLock mu(self, *Locks::thread_list_lock_);
+  // The threads which were runnable acknowledged the request by releasing their share of the
+  // mutator lock, the others were already suspended.
+  Thread* slowest_thread = nullptr;
+  uint64_t slowest_time = start_time;
+  for (const auto& thread : list_) {
+    if (thread != self && thread->GetSuspendAcknowledgeTime() >= slowest_time) {
+      slowest_thread = thread;
+      slowest_time = thread->GetSuspendAcknowledgeTime();
+    }
+  }
+  suspend_all_histogram_.AddValue(duration / 1000);
+  if (duration <= longest_suspend_all_ns_ && duration <= kLongSuspendAllNs) {
+    return;
+  }
+  std::string slowest_name("none, all threads were suspended");
+  if (slowest_thread != nullptr) {
+    std::ostringstream oss;
+    oss << *slowest_thread;
+    slowest_name = oss.str();
+  }
+  if (duration > longest_suspend_all_ns_) {
+    longest_suspend_all_ns_ = duration;
+    longest_suspend_all_thread_ = slowest_name;
+  }
+  if (duration > kLongSuspendAllNs) {
+    LOG(INFO) << "Suspending all threads took " << PrettyDuration(duration)
+              << ", last thread to suspend: " << slowest_name;
+  }
+}
+
 void ThreadList::ResumeAll() {
   Thread* self = Thread::Current();
 
@@ -857,6 +966,16 @@ uint32_t ThreadList::AllocThreadId(Thread* self) {
   return 0;
 }
 
+bool ThreadList::RevokeExitedThreadBias(Thread* self, mirror::Object* obj, uint32_t thread_id) {
+  // A thread only takes the biases towards its id once allocated the id, which holding the
+  // allocated_thread_ids_lock_ excludes until the lock word is unlocked.
+  MutexLock mu(self, *Locks::allocated_thread_ids_lock_);
+  if (allocated_ids_[thread_id - 1]) {
+    return false;
+  }
+  return obj->CasLockWord(LockWord::FromBiasedLockId(thread_id, 0), LockWord());
+}
+
 void ThreadList::ReleaseThreadId(Thread* self, uint32_t id) {
   MutexLock mu(self, *Locks::allocated_thread_ids_lock_);
   --id;  // Zero is reserved to mean "invalid".
@@ -17,14 +17,19 @@
 #ifndef ART_RUNTIME_THREAD_LIST_H_
 #define ART_RUNTIME_THREAD_LIST_H_
 
+#include "base/histogram.h"
 #include "base/mutex.h"
 #include "jni.h"
 #include "object_callbacks.h"
 
 #include <bitset>
 #include <list>
+#include <string>
 
 namespace art {
+namespace mirror {
+  class Object;
+}  // namespace mirror
 class Closure;
 class Thread;
 class TimingLogger;
@@ -41,6 +46,12 @@ class ThreadList {
   void DumpForSigQuit(std::ostream& os)
       LOCKS_EXCLUDED(Locks::thread_list_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Has every thread dump its own stack at a checkpoint rather than dumping all threads under
+  // SuspendAll.
+  void DumpForSigQuitWithCheckpoint(std::ostream& os)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_,
+                     Locks::thread_suspend_count_lock_,
+                     Locks::mutator_lock_);
   void DumpLocked(std::ostream& os)  // For thread suspend timeout dumps.
       EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_list_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -84,6 +95,12 @@ class ThreadList {
   // Find an already suspended thread (or self) by its id.
   Thread* FindThreadByThreadId(uint32_t thin_lock_id);
 
+  // Unlocks obj if its lock is biased towards thread_id, isn't held and no thread has the id, as
+  // happens once the thread the lock is biased towards exits. Returns whether obj was unlocked.
+  bool RevokeExitedThreadBias(Thread* self, mirror::Object* obj, uint32_t thread_id)
+      LOCKS_EXCLUDED(Locks::allocated_thread_ids_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Run a checkpoint on threads, running threads are not suspended but run the checkpoint inside
   // of the suspend check. Returns how many checkpoints we should expect to run.
   size_t RunCheckpoint(Closure* checkpoint_function)
@@ -137,6 +154,9 @@ class ThreadList {
   bool Contains(Thread* thread) EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_list_lock_);
   bool Contains(pid_t tid) EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_list_lock_);
 
+  void DumpSuspendAllStats(std::ostream& os)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_list_lock_);
+
   void DumpUnattachedThreads(std::ostream& os)
       LOCKS_EXCLUDED(Locks::thread_list_lock_);
 
@@ -151,11 +171,28 @@ class ThreadList {
       LOCKS_EXCLUDED(Locks::thread_list_lock_,
                      Locks::thread_suspend_count_lock_);
 
+  // Records the time to safepoint of a SuspendAll started at start_time, along with the last
+  // thread to acknowledge it.
+  void RecordSuspendAll(Thread* self, uint64_t start_time)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_);
+
+  // Time to safepoint histogram buckets, in microseconds.
+  static constexpr size_t kSuspendAllBucketSize = 100;
+  static constexpr size_t kSuspendAllBucketCount = 32;
+  // SuspendAll calls taking longer are logged with their slowest thread.
+  static constexpr uint64_t kLongSuspendAllNs = 5 * 1000 * 1000;
+
   std::bitset<kMaxThreadId> allocated_ids_ GUARDED_BY(Locks::allocated_thread_ids_lock_);
 
   // The actual list of all threads.
   std::list<Thread*> list_ GUARDED_BY(Locks::thread_list_lock_);
 
+  // The times to safepoint of SuspendAll, and the slowest thread of the longest one.
+  Histogram<uint64_t> suspend_all_histogram_ GUARDED_BY(Locks::thread_list_lock_);
+  uint64_t longest_suspend_all_ns_ GUARDED_BY(Locks::thread_list_lock_);
+  std::string longest_suspend_all_thread_ GUARDED_BY(Locks::thread_list_lock_);
+
   // Ongoing suspend all requests, used to ensure threads added to list_ respect SuspendAll.
   int suspend_all_count_ GUARDED_BY(Locks::thread_suspend_count_lock_);
   int debug_suspend_all_count_ GUARDED_BY(Locks::thread_suspend_count_lock_);
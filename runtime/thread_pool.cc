@@ -16,7 +16,10 @@
 
 #include "thread_pool.h"
 
+#include <sched.h>
+
 #include "base/casts.h"
+#include "base/histogram-inl.h"
 #include "base/stl_util.h"
 #include "runtime.h"
 #include "thread-inl.h"
@@ -25,6 +28,11 @@ namespace art {
 
 static constexpr bool kMeasureWaitTime = false;
 
+// How many times an idle worker yields while polling for new tasks before it parks on the task
+// queue condition. Producers often submit tasks in quick succession, spinning briefly avoids a
+// futex wait and wake round trip for each of them.
+static constexpr size_t kMaxSpinsBeforePark = 64;
+
 ThreadPoolWorker::ThreadPoolWorker(ThreadPool* thread_pool, const std::string& name,
                                    size_t stack_size)
     : thread_pool_(thread_pool),
@@ -58,7 +66,8 @@ void ThreadPoolWorker::Run() {
 void* ThreadPoolWorker::Callback(void* arg) {
   ThreadPoolWorker* worker = reinterpret_cast<ThreadPoolWorker*>(arg);
   Runtime* runtime = Runtime::Current();
-  CHECK(runtime->AttachCurrentThread(worker->name_.c_str(), true, NULL, false));
+  CHECK(runtime->AttachCurrentThread(worker->name_.c_str(), true, NULL,
+                                     worker->thread_pool_->create_peers_));
   // Do work until its time to shut down.
   worker->Run();
   runtime->DetachCurrentThread();
@@ -66,15 +75,41 @@ void* ThreadPoolWorker::Callback(void* arg) {
 }
 
 void ThreadPool::AddTask(Thread* self, Task* task) {
+  const uint64_t enqueue_time = NanoTime();
+  MutexLock mu(self, task_queue_lock_);
+  tasks_.push_back(QueuedTask {task, enqueue_time});
+  num_queued_tasks_.StoreRelaxed(tasks_.size());
+  SignalWorkersLocked(self, 1);
+}
+
+void ThreadPool::AddTasks(Thread* self, const std::vector<Task*>& tasks) {
+  if (tasks.empty()) {
+    return;
+  }
+  const uint64_t enqueue_time = NanoTime();
   MutexLock mu(self, task_queue_lock_);
-  tasks_.push_back(task);
-  // If we have any waiters, signal one.
-  if (started_ && waiting_count_ != 0) {
-    task_queue_condition_.Signal(self);
+  for (Task* task : tasks) {
+    tasks_.push_back(QueuedTask {task, enqueue_time});
   }
+  num_queued_tasks_.StoreRelaxed(tasks_.size());
+  SignalWorkersLocked(self, tasks.size());
 }
 
-ThreadPool::ThreadPool(const char* name, size_t num_threads)
+void ThreadPool::SignalWorkersLocked(Thread* self, size_t num_tasks) {
+  if (!started_ || waiting_count_ == 0) {
+    return;
+  }
+  // Wake everyone with a single broadcast if there is enough work for all of the waiters.
+  if (num_tasks >= waiting_count_) {
+    task_queue_condition_.Broadcast(self);
+  } else {
+    for (size_t i = 0; i < num_tasks; ++i) {
+      task_queue_condition_.Signal(self);
+    }
+  }
+}
+
+ThreadPool::ThreadPool(const char* name, size_t num_threads, bool create_peers)
   : name_(name),
     task_queue_lock_("task queue lock"),
     task_queue_condition_("task queue condition", task_queue_lock_),
@@ -82,6 +117,9 @@ ThreadPool::ThreadPool(const char* name, size_t num_threads)
     started_(false),
     shutting_down_(false),
     waiting_count_(0),
+    num_queued_tasks_(0),
+    queue_wait_histogram_("Task queue wait time", 10),
+    create_peers_(create_peers),
     start_time_(0),
     total_wait_time_(0),
     // Add one since the caller of constructor waits on the barrier too.
@@ -124,41 +162,69 @@ void ThreadPool::StartWorkers(Thread* self) {
   total_wait_time_ = 0;
 }
 
+void ThreadPool::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), task_queue_lock_);
+  os << "Thread pool " << name_ << ": " << GetThreadCount() << " threads, "
+     << waiting_count_ << " waiting, " << tasks_.size() << " queued tasks\n";
+  if (kMeasureWaitTime) {
+    os << "Total worker wait time: " << PrettyDuration(total_wait_time_) << "\n";
+  }
+  if (queue_wait_histogram_.SampleSize() != 0) {
+    Histogram<uint64_t>::CumulativeData cumulative_data;
+    queue_wait_histogram_.CreateHistogram(&cumulative_data);
+    queue_wait_histogram_.PrintConfidenceIntervals(os, 0.99, cumulative_data);
+  }
+}
+
 void ThreadPool::StopWorkers(Thread* self) {
   MutexLock mu(self, task_queue_lock_);
   started_ = false;
 }
 
 Task* ThreadPool::GetTask(Thread* self) {
-  MutexLock mu(self, task_queue_lock_);
-  while (!IsShuttingDown()) {
-    const size_t thread_count = GetThreadCount();
-    // Ensure that we don't use more threads than the maximum active workers.
-    const size_t active_threads = thread_count - waiting_count_;
-    // <= since self is considered an active worker.
-    if (active_threads <= max_active_workers_) {
-      Task* task = TryGetTaskLocked(self);
-      if (task != NULL) {
-        return task;
-      }
-    }
+  size_t spins_left = kMaxSpinsBeforePark;
+  while (true) {
+    {
+      MutexLock mu(self, task_queue_lock_);
+      while (!IsShuttingDown()) {
+        const size_t thread_count = GetThreadCount();
+        // Ensure that we don't use more threads than the maximum active workers.
+        const size_t active_threads = thread_count - waiting_count_;
+        // <= since self is considered an active worker.
+        if (active_threads <= max_active_workers_) {
+          Task* task = TryGetTaskLocked(self);
+          if (task != NULL) {
+            return task;
+          }
+          // Poll for new tasks outside of the lock for a little while before parking.
+          if (started_ && spins_left != 0) {
+            break;
+          }
+        }
 
-    ++waiting_count_;
-    if (waiting_count_ == GetThreadCount() && tasks_.empty()) {
-      // We may be done, lets broadcast to the completion condition.
-      completion_condition_.Broadcast(self);
-    }
-    const uint64_t wait_start = kMeasureWaitTime ? NanoTime() : 0;
-    task_queue_condition_.Wait(self);
-    if (kMeasureWaitTime) {
-      const uint64_t wait_end = NanoTime();
-      total_wait_time_ += wait_end - std::max(wait_start, start_time_);
+        ++waiting_count_;
+        if (waiting_count_ == GetThreadCount() && tasks_.empty()) {
+          // We may be done, lets broadcast to the completion condition.
+          completion_condition_.Broadcast(self);
+        }
+        const uint64_t wait_start = kMeasureWaitTime ? NanoTime() : 0;
+        task_queue_condition_.Wait(self);
+        if (kMeasureWaitTime) {
+          const uint64_t wait_end = NanoTime();
+          total_wait_time_ += wait_end - std::max(wait_start, start_time_);
+        }
+        --waiting_count_;
+      }
+      if (IsShuttingDown()) {
+        // We are shutting down, return NULL to tell the worker thread to stop looping.
+        return NULL;
+      }
     }
-    --waiting_count_;
+    do {
+      --spins_left;
+      sched_yield();
+    } while (spins_left != 0 && num_queued_tasks_.LoadRelaxed() == 0);
   }
-
-  // We are shutting down, return NULL to tell the worker thread to stop looping.
-  return NULL;
 }
 
 Task* ThreadPool::TryGetTask(Thread* self) {
@@ -168,9 +234,13 @@ Task* ThreadPool::TryGetTask(Thread* self) {
 
 Task* ThreadPool::TryGetTaskLocked(Thread* self) {
   if (started_ && !tasks_.empty()) {
-    Task* task = tasks_.front();
+    const QueuedTask queued = tasks_.front();
     tasks_.pop_front();
-    return task;
+    num_queued_tasks_.StoreRelaxed(tasks_.size());
+    // Tasks queued before the workers were started only count from the start.
+    const uint64_t enqueue_time = std::max(queued.enqueue_time, start_time_);
+    queue_wait_histogram_.AddValue((NanoTime() - enqueue_time) / 1000);
+    return queued.task;
   }
   return NULL;
 }
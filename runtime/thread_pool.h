@@ -20,7 +20,9 @@
 #include <deque>
 #include <vector>
 
+#include "atomic.h"
 #include "barrier.h"
+#include "base/histogram.h"
 #include "base/mutex.h"
 #include "closure.h"
 #include "mem_map.h"
@@ -78,7 +80,13 @@ class ThreadPool {
   // after running it, it is the caller's responsibility.
   void AddTask(Thread* self, Task* task);
 
-  explicit ThreadPool(const char* name, size_t num_threads);
+  // Add a batch of tasks while taking the task queue lock only once, waking as many workers as
+  // there are new tasks.
+  void AddTasks(Thread* self, const std::vector<Task*>& tasks);
+
+  // Workers with peers are java.lang.Threads and may run managed code, the pool must then be
+  // created after the runtime started.
+  explicit ThreadPool(const char* name, size_t num_threads, bool create_peers = false);
   virtual ~ThreadPool();
 
   // Wait for all tasks currently on queue to get completed.
@@ -95,6 +103,9 @@ class ThreadPool {
   // thread count of the thread pool.
   void SetMaxActiveWorkers(size_t threads);
 
+  // Dump the state of the pool and the time tasks spent on the queue before being picked up.
+  void Dump(std::ostream& os) LOCKS_EXCLUDED(task_queue_lock_);
+
  protected:
   // get a task to run, blocks if there are no tasks left
   virtual Task* GetTask(Thread* self);
@@ -103,6 +114,10 @@ class ThreadPool {
   Task* TryGetTask(Thread* self);
   Task* TryGetTaskLocked(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(task_queue_lock_);
 
+  // Signal up to num_tasks waiting workers that new tasks are available.
+  void SignalWorkersLocked(Thread* self, size_t num_tasks)
+      EXCLUSIVE_LOCKS_REQUIRED(task_queue_lock_);
+
   // Are we shutting down?
   bool IsShuttingDown() const EXCLUSIVE_LOCKS_REQUIRED(task_queue_lock_) {
     return shutting_down_;
@@ -116,9 +131,20 @@ class ThreadPool {
   volatile bool shutting_down_ GUARDED_BY(task_queue_lock_);
   // How many worker threads are waiting on the condition.
   volatile size_t waiting_count_ GUARDED_BY(task_queue_lock_);
-  std::deque<Task*> tasks_ GUARDED_BY(task_queue_lock_);
+  // A queued task along with the time it was added, used for the queue wait time statistics.
+  struct QueuedTask {
+    Task* task;
+    uint64_t enqueue_time;
+  };
+  std::deque<QueuedTask> tasks_ GUARDED_BY(task_queue_lock_);
+  // Mirror of tasks_.size() which workers can poll without the lock while spinning before they
+  // park on task_queue_condition_. Only written with task_queue_lock_ held.
+  Atomic<size_t> num_queued_tasks_;
+  // How long tasks waited on the queue before a worker picked them up, in microseconds.
+  Histogram<uint64_t> queue_wait_histogram_ GUARDED_BY(task_queue_lock_);
   // TODO: make this immutable/const?
   std::vector<ThreadPoolWorker*> threads_;
+  const bool create_peers_;
   // Work balance detection.
   uint64_t start_time_ GUARDED_BY(task_queue_lock_);
   uint64_t total_wait_time_;
@@ -72,6 +72,23 @@ TEST_F(ThreadPoolTest, CheckRun) {
   EXPECT_EQ(num_tasks, count.LoadSequentiallyConsistent());
 }
 
+// Check that tasks added as a batch are all run.
+TEST_F(ThreadPoolTest, AddTasks) {
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool("Thread pool test thread pool", num_threads);
+  AtomicInteger count(0);
+  static const int32_t num_tasks = num_threads * 4;
+  thread_pool.StartWorkers(self);
+  std::vector<Task*> tasks;
+  for (int32_t i = 0; i < num_tasks; ++i) {
+    tasks.push_back(new CountTask(&count));
+  }
+  thread_pool.AddTasks(self, tasks);
+  thread_pool.Wait(self, true, false);
+  EXPECT_EQ(num_tasks, count.LoadSequentiallyConsistent());
+  EXPECT_EQ(0U, thread_pool.GetTaskCount(self));
+}
+
 TEST_F(ThreadPoolTest, StopStart) {
   Thread* self = Thread::Current();
   ThreadPool thread_pool("Thread pool test thread pool", num_threads);
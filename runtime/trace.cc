@@ -18,6 +18,9 @@
 
 #include <sys/uio.h>
 
+#include <algorithm>
+
+#include "barrier.h"
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
@@ -119,7 +122,6 @@ ProfilerClockSource Trace::default_clock_source_ = kDefaultProfilerClockSource;
 
 Trace* volatile Trace::the_trace_ = NULL;
 pthread_t Trace::sampling_pthread_ = 0U;
-std::unique_ptr<std::vector<mirror::ArtMethod*>> Trace::temp_stack_trace_;
 
 static mirror::ArtMethod* DecodeTraceMethodId(uint32_t tmid) {
   return reinterpret_cast<mirror::ArtMethod*>(tmid & ~kTraceMethodActionMask);
@@ -137,16 +139,11 @@ static uint32_t EncodeTraceMethodAndAction(mirror::ArtMethod* method,
 }
 
 std::vector<mirror::ArtMethod*>* Trace::AllocStackTrace() {
-  if (temp_stack_trace_.get() != NULL) {
-    return temp_stack_trace_.release();
-  } else {
-    return new std::vector<mirror::ArtMethod*>();
-  }
+  return new std::vector<mirror::ArtMethod*>();
 }
 
 void Trace::FreeStackTrace(std::vector<mirror::ArtMethod*>* stack_trace) {
-  stack_trace->clear();
-  temp_stack_trace_.reset(stack_trace);
+  delete stack_trace;
 }
 
 void Trace::SetDefaultClockSource(ProfilerClockSource clock_source) {
@@ -242,6 +239,30 @@ static void GetSample(Thread* thread, void* arg) SHARED_LOCKS_REQUIRED(Locks::mu
   the_trace->CompareAndUpdateStackTrace(thread, stack_trace);
 }
 
+// Samples the stack of each thread as a checkpoint, so that the threads aren't all suspended at
+// once. The running threads sample themselves at their next suspend check, the suspended ones
+// are sampled by the sampling thread.
+class SampleCheckpoint : public Closure {
+ public:
+  SampleCheckpoint(Trace* trace, Barrier* barrier) : trace_(trace), barrier_(barrier) {
+  }
+
+  virtual void Run(Thread* thread) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    // Note: self is not necessarily equal to thread since thread may be suspended.
+    Thread* self = Thread::Current();
+    GetSample(thread, trace_);
+    barrier_->Pass(self);
+  }
+
+ private:
+  Trace* const trace_;
+  Barrier* const barrier_;
+};
+
+static void ClearThreadTraceBuffer(Thread* thread, void* arg) {
+  thread->SetTraceBuffer(nullptr, nullptr);
+}
+
 static void ClearThreadStackTraceAndClockBase(Thread* thread, void* arg) {
   thread->SetTraceClockBase(0);
   std::vector<mirror::ArtMethod*>* stack_trace = thread->GetStackTraceSample();
@@ -251,7 +272,6 @@ static void ClearThreadStackTraceAndClockBase(Thread* thread, void* arg) {
 
 void Trace::CompareAndUpdateStackTrace(Thread* thread,
                                        std::vector<mirror::ArtMethod*>* stack_trace) {
-  CHECK_EQ(pthread_self(), sampling_pthread_);
   std::vector<mirror::ArtMethod*>* old_stack_trace = thread->GetStackTraceSample();
   // Update the thread's stack trace sample.
   thread->SetStackTraceSample(stack_trace);
@@ -312,12 +332,18 @@ void* Trace::RunSamplingThread(void* arg) {
       }
     }
 
-    runtime->GetThreadList()->SuspendAll();
+    Barrier barrier(0);
+    SampleCheckpoint checkpoint(the_trace, &barrier);
+    size_t barrier_count;
     {
-      MutexLock mu(self, *Locks::thread_list_lock_);
-      runtime->GetThreadList()->ForEach(GetSample, the_trace);
+      // The stacks of the suspended threads are walked by this thread.
+      ReaderMutexLock mu(self, *Locks::mutator_lock_);
+      barrier_count = runtime->GetThreadList()->RunCheckpoint(&checkpoint);
+    }
+    {
+      ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+      barrier.Increment(self, barrier_count);
     }
-    runtime->GetThreadList()->ResumeAll();
     ATRACE_END();
   }
 
@@ -380,7 +406,7 @@ void Trace::Start(const char* trace_filename, int trace_fd, int buffer_size, int
                                                    instrumentation::Instrumentation::kMethodEntered |
                                                    instrumentation::Instrumentation::kMethodExited |
                                                    instrumentation::Instrumentation::kMethodUnwind);
-        runtime->GetInstrumentation()->EnableMethodTracing();
+        runtime->GetInstrumentation()->EnableMethodTracing(runtime->GetMethodTraceFilter());
       }
     }
   }
@@ -405,6 +431,11 @@ void Trace::Stop() {
   }
   if (the_trace != NULL) {
     the_trace->FinishTracing();
+    {
+      // The chunks of the threads are in the buffer of the trace.
+      MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
+      runtime->GetThreadList()->ForEach(ClearThreadTraceBuffer, NULL);
+    }
 
     if (the_trace->sampling_enabled_) {
       MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
@@ -480,7 +511,7 @@ void Trace::FinishTracing() {
   // Compute elapsed time.
   uint64_t elapsed = MicroTime() - start_time_;
 
-  size_t final_offset = cur_offset_;
+  size_t final_offset = CompactRecords(cur_offset_);
   uint32_t clock_overhead_ns = GetClockOverheadNanoSeconds(this);
 
   if ((flags_ & kTraceCountAllocs) != 0) {
@@ -566,6 +597,9 @@ void Trace::FieldWritten(Thread* /*thread*/, mirror::Object* this_object,
 
 void Trace::MethodEntered(Thread* thread, mirror::Object* this_object,
                           mirror::ArtMethod* method, uint32_t dex_pc) {
+  if (!Runtime::Current()->GetInstrumentation()->IsMethodTraced(method)) {
+    return;
+  }
   uint32_t thread_clock_diff = 0;
   uint32_t wall_clock_diff = 0;
   ReadClocks(thread, &thread_clock_diff, &wall_clock_diff);
@@ -577,6 +611,9 @@ void Trace::MethodExited(Thread* thread, mirror::Object* this_object,
                          mirror::ArtMethod* method, uint32_t dex_pc,
                          const JValue& return_value) {
   UNUSED(return_value);
+  if (!Runtime::Current()->GetInstrumentation()->IsMethodTraced(method)) {
+    return;
+  }
   uint32_t thread_clock_diff = 0;
   uint32_t wall_clock_diff = 0;
   ReadClocks(thread, &thread_clock_diff, &wall_clock_diff);
@@ -586,6 +623,9 @@ void Trace::MethodExited(Thread* thread, mirror::Object* this_object,
 
 void Trace::MethodUnwind(Thread* thread, mirror::Object* this_object,
                          mirror::ArtMethod* method, uint32_t dex_pc) {
+  if (!Runtime::Current()->GetInstrumentation()->IsMethodTraced(method)) {
+    return;
+  }
   uint32_t thread_clock_diff = 0;
   uint32_t wall_clock_diff = 0;
   ReadClocks(thread, &thread_clock_diff, &wall_clock_diff);
@@ -616,20 +656,54 @@ void Trace::ReadClocks(Thread* thread, uint32_t* thread_clock_diff, uint32_t* wa
   }
 }
 
-void Trace::LogMethodTraceEvent(Thread* thread, mirror::ArtMethod* method,
-                                instrumentation::Instrumentation::InstrumentationEvent event,
-                                uint32_t thread_clock_diff, uint32_t wall_clock_diff) {
-  // Advance cur_offset_ atomically.
+uint8_t* Trace::ReserveChunk(Thread* thread) {
+  const int32_t record_size = GetRecordSize(clock_source_);
+  // The last chunk is shorter, it ends at the last record fitting in the buffer.
+  const int32_t end_offset = kTraceHeaderLength +
+      (buffer_size_ - kTraceHeaderLength) / record_size * record_size;
   int32_t new_offset;
   int32_t old_offset;
   do {
     old_offset = cur_offset_;
-    new_offset = old_offset + GetRecordSize(clock_source_);
-    if (new_offset > buffer_size_) {
+    if (old_offset >= end_offset) {
       overflow_ = true;
-      return;
+      return nullptr;
     }
+    new_offset = std::min<int32_t>(old_offset + record_size * kRecordsPerChunk, end_offset);
   } while (android_atomic_release_cas(old_offset, new_offset, &cur_offset_) != 0);
+  thread->SetTraceBuffer(buf_.get() + old_offset, buf_.get() + new_offset);
+  return buf_.get() + old_offset;
+}
+
+size_t Trace::CompactRecords(size_t end_offset) {
+  const size_t record_size = GetRecordSize(clock_source_);
+  uint8_t* const end = buf_.get() + end_offset;
+  uint8_t* dst = buf_.get() + kTraceHeaderLength;
+  for (uint8_t* src = dst; src < end; src += record_size) {
+    // The buffer is zeroed and the method of a record is never null, records with no method
+    // weren't written.
+    uint32_t tmid = src[2] | (src[3] << 8) | (src[4] << 16) | (src[5] << 24);
+    if (tmid != 0) {
+      if (dst != src) {
+        memmove(dst, src, record_size);
+      }
+      dst += record_size;
+    }
+  }
+  return dst - buf_.get();
+}
+
+void Trace::LogMethodTraceEvent(Thread* thread, mirror::ArtMethod* method,
+                                instrumentation::Instrumentation::InstrumentationEvent event,
+                                uint32_t thread_clock_diff, uint32_t wall_clock_diff) {
+  uint8_t* ptr = thread->GetTraceBufferPos();
+  if (UNLIKELY(ptr == thread->GetTraceBufferEnd())) {
+    ptr = ReserveChunk(thread);
+    if (ptr == nullptr) {
+      return;
+    }
+  }
+  thread->SetTraceBuffer(ptr + GetRecordSize(clock_source_), thread->GetTraceBufferEnd());
 
   TraceAction action = kTraceMethodEnter;
   switch (event) {
@@ -649,7 +723,6 @@ void Trace::LogMethodTraceEvent(Thread* thread, mirror::ArtMethod* method,
   uint32_t method_value = EncodeTraceMethodAndAction(method, action);
 
   // Write data
-  uint8_t* ptr = buf_.get() + old_offset;
   Append2LE(ptr, thread->GetTid());
   Append4LE(ptr + 2, method_value);
   ptr += 6;
@@ -105,12 +105,15 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
                        mirror::Throwable* exception_object)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) OVERRIDE;
 
-  // Reuse an old stack trace if it exists, otherwise allocate a new one.
+  // Allocate and free the stack traces of the samples. The samples are taken concurrently by
+  // the sampled threads, so there is no shared spare stack trace to reuse.
   static std::vector<mirror::ArtMethod*>* AllocStackTrace();
-  // Clear and store an old stack trace for later use.
   static void FreeStackTrace(std::vector<mirror::ArtMethod*>* stack_trace);
 
  private:
+  // Number of records of the chunks of buf_ reserved by the threads.
+  static constexpr size_t kRecordsPerChunk = 256;
+
   explicit Trace(File* trace_file, int buffer_size, int flags, bool sampling_enabled);
 
   // The sampling interval in microseconds is passed as an argument.
@@ -120,6 +123,14 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
 
   void ReadClocks(Thread* thread, uint32_t* thread_clock_diff, uint32_t* wall_clock_diff);
 
+  // Reserves a new chunk of buf_ for the records of the thread, returns its beginning or null
+  // once buf_ is full.
+  uint8_t* ReserveChunk(Thread* thread);
+
+  // Removes the unused ends of the chunks of the threads from the records of buf_, returns the
+  // offset of the end of the records.
+  size_t CompactRecords(size_t end_offset);
+
   void LogMethodTraceEvent(Thread* thread, mirror::ArtMethod* method,
                            instrumentation::Instrumentation::InstrumentationEvent event,
                            uint32_t thread_clock_diff, uint32_t wall_clock_diff);
@@ -139,9 +150,6 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
   // Sampling thread, non-zero when sampling.
   static pthread_t sampling_pthread_;
 
-  // Used to remember an unused stack trace to avoid re-allocation during sampling.
-  static std::unique_ptr<std::vector<mirror::ArtMethod*>> temp_stack_trace_;
-
   // File to write trace data out to, NULL if direct to ddms.
   std::unique_ptr<File> trace_file_;
 
@@ -162,7 +170,8 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
   // Time trace was created.
   const uint64_t start_time_;
 
-  // Offset into buf_.
+  // Offset into buf_ of the first byte not reserved by a thread. The threads write their records
+  // to the chunks they reserve, so that they don't all update this offset for every record.
   volatile int32_t cur_offset_;
 
   // Did we overflow the buffer recording traces?
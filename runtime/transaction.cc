@@ -23,6 +23,7 @@
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
 
+#include <algorithm>
 #include <list>
 
 namespace art {
@@ -30,7 +31,15 @@ namespace art {
 // TODO: remove (only used for debugging purpose).
 static constexpr bool kEnableTransactionStats = false;
 
-Transaction::Transaction() : log_lock_("transaction log lock", kTransactionLogLock) {
+// Object and array logs are not compacted before they reach this many entries.
+static constexpr size_t kMinLogSizeToCompact = 16;
+
+Transaction::Transaction()
+    : log_lock_("transaction log lock", kTransactionLogLock),
+      last_object_(nullptr),
+      last_object_log_(nullptr),
+      last_array_(nullptr),
+      last_array_log_(nullptr) {
   CHECK(Runtime::Current()->IsCompiler());
 }
 
@@ -39,12 +48,12 @@ Transaction::~Transaction() {
     MutexLock mu(Thread::Current(), log_lock_);
     size_t objects_count = object_logs_.size();
     size_t field_values_count = 0;
-    for (auto it : object_logs_) {
+    for (const auto& it : object_logs_) {
       field_values_count += it.second.Size();
     }
     size_t array_count = array_logs_.size();
     size_t array_values_count = 0;
-    for (auto it : array_logs_) {
+    for (const auto& it : array_logs_) {
       array_values_count += it.second.Size();
     }
     size_t string_count = intern_string_logs_.size();
@@ -61,24 +70,21 @@ void Transaction::RecordWriteField32(mirror::Object* obj, MemberOffset field_off
                                      bool is_volatile) {
   DCHECK(obj != nullptr);
   MutexLock mu(Thread::Current(), log_lock_);
-  ObjectLog& object_log = object_logs_[obj];
-  object_log.Log32BitsValue(field_offset, value, is_volatile);
+  GetObjectLog(obj)->Log32BitsValue(field_offset, value, is_volatile);
 }
 
 void Transaction::RecordWriteField64(mirror::Object* obj, MemberOffset field_offset, uint64_t value,
                                      bool is_volatile) {
   DCHECK(obj != nullptr);
   MutexLock mu(Thread::Current(), log_lock_);
-  ObjectLog& object_log = object_logs_[obj];
-  object_log.Log64BitsValue(field_offset, value, is_volatile);
+  GetObjectLog(obj)->Log64BitsValue(field_offset, value, is_volatile);
 }
 
 void Transaction::RecordWriteFieldReference(mirror::Object* obj, MemberOffset field_offset,
                                             mirror::Object* value, bool is_volatile) {
   DCHECK(obj != nullptr);
   MutexLock mu(Thread::Current(), log_lock_);
-  ObjectLog& object_log = object_logs_[obj];
-  object_log.LogReferenceValue(field_offset, value, is_volatile);
+  GetObjectLog(obj)->LogReferenceValue(field_offset, value, is_volatile);
 }
 
 void Transaction::RecordWriteArray(mirror::Array* array, size_t index, uint64_t value) {
@@ -86,8 +92,23 @@ void Transaction::RecordWriteArray(mirror::Array* array, size_t index, uint64_t
   DCHECK(array->IsArrayInstance());
   DCHECK(!array->IsObjectArray());
   MutexLock mu(Thread::Current(), log_lock_);
-  ArrayLog& array_log = array_logs_[array];
-  array_log.LogValue(index, value);
+  GetArrayLog(array)->LogValue(index, value);
+}
+
+Transaction::ObjectLog* Transaction::GetObjectLog(mirror::Object* obj) {
+  if (obj != last_object_) {
+    last_object_ = obj;
+    last_object_log_ = &object_logs_[obj];
+  }
+  return last_object_log_;
+}
+
+Transaction::ArrayLog* Transaction::GetArrayLog(mirror::Array* array) {
+  if (array != last_array_) {
+    last_array_ = array;
+    last_array_log_ = &array_logs_[array];
+  }
+  return last_array_log_;
 }
 
 void Transaction::RecordStrongStringInsertion(mirror::String* s, uint32_t hash_code) {
@@ -130,19 +151,23 @@ void Transaction::Abort() {
 void Transaction::UndoObjectModifications() {
   // TODO we may not need to restore objects allocated during this transaction. Or we could directly
   // remove them from the heap.
-  for (auto it : object_logs_) {
+  for (auto& it : object_logs_) {
     it.second.Undo(it.first);
   }
   object_logs_.clear();
+  last_object_ = nullptr;
+  last_object_log_ = nullptr;
 }
 
 void Transaction::UndoArrayModifications() {
   // TODO we may not need to restore array allocated during this transaction. Or we could directly
   // remove them from the heap.
-  for (auto it : array_logs_) {
+  for (auto& it : array_logs_) {
     it.second.Undo(it.first);
   }
   array_logs_.clear();
+  last_array_ = nullptr;
+  last_array_log_ = nullptr;
 }
 
 void Transaction::UndoInternStringTableModifications() {
@@ -168,7 +193,7 @@ void Transaction::VisitObjectLogs(RootCallback* callback, void* arg) {
   std::list<ObjectPair> moving_roots;
 
   // Visit roots.
-  for (auto it : object_logs_) {
+  for (auto& it : object_logs_) {
     it.second.VisitRoots(callback, arg);
     mirror::Object* old_root = it.first;
     mirror::Object* new_root = old_root;
@@ -188,6 +213,10 @@ void Transaction::VisitObjectLogs(RootCallback* callback, void* arg) {
     object_logs_.insert(std::make_pair(new_root, old_root_it->second));
     object_logs_.erase(old_root_it);
   }
+  if (!moving_roots.empty()) {
+    last_object_ = nullptr;
+    last_object_log_ = nullptr;
+  }
 }
 
 void Transaction::VisitArrayLogs(RootCallback* callback, void* arg) {
@@ -195,7 +224,7 @@ void Transaction::VisitArrayLogs(RootCallback* callback, void* arg) {
   typedef std::pair<mirror::Array*, mirror::Array*> ArrayPair;
   std::list<ArrayPair> moving_roots;
 
-  for (auto it : array_logs_) {
+  for (const auto& it : array_logs_) {
     mirror::Array* old_root = it.first;
     CHECK(!old_root->IsObjectArray());
     mirror::Array* new_root = old_root;
@@ -215,6 +244,10 @@ void Transaction::VisitArrayLogs(RootCallback* callback, void* arg) {
     array_logs_.insert(std::make_pair(new_root, old_root_it->second));
     array_logs_.erase(old_root_it);
   }
+  if (!moving_roots.empty()) {
+    last_array_ = nullptr;
+    last_array_log_ = nullptr;
+  }
 }
 
 void Transaction::VisitStringLogs(RootCallback* callback, void* arg) {
@@ -224,43 +257,51 @@ void Transaction::VisitStringLogs(RootCallback* callback, void* arg) {
 }
 
 void Transaction::ObjectLog::Log32BitsValue(MemberOffset offset, uint32_t value, bool is_volatile) {
-  auto it = field_values_.find(offset.Uint32Value());
-  if (it == field_values_.end()) {
-    ObjectLog::FieldValue field_value;
-    field_value.value = value;
-    field_value.is_volatile = is_volatile;
-    field_value.kind = ObjectLog::k32Bits;
-    field_values_.insert(std::make_pair(offset.Uint32Value(), field_value));
-  }
+  LogValue(offset, value, ObjectLog::k32Bits, is_volatile);
 }
 
 void Transaction::ObjectLog::Log64BitsValue(MemberOffset offset, uint64_t value, bool is_volatile) {
-  auto it = field_values_.find(offset.Uint32Value());
-  if (it == field_values_.end()) {
-    ObjectLog::FieldValue field_value;
-    field_value.value = value;
-    field_value.is_volatile = is_volatile;
-    field_value.kind = ObjectLog::k64Bits;
-    field_values_.insert(std::make_pair(offset.Uint32Value(), field_value));
-  }
+  LogValue(offset, value, ObjectLog::k64Bits, is_volatile);
 }
 
 void Transaction::ObjectLog::LogReferenceValue(MemberOffset offset, mirror::Object* obj, bool is_volatile) {
-  auto it = field_values_.find(offset.Uint32Value());
-  if (it == field_values_.end()) {
-    ObjectLog::FieldValue field_value;
-    field_value.value = reinterpret_cast<uintptr_t>(obj);
-    field_value.is_volatile = is_volatile;
-    field_value.kind = ObjectLog::kReference;
-    field_values_.insert(std::make_pair(offset.Uint32Value(), field_value));
+  LogValue(offset, reinterpret_cast<uintptr_t>(obj), ObjectLog::kReference, is_volatile);
+}
+
+void Transaction::ObjectLog::LogValue(MemberOffset offset, uint64_t value, FieldValueKind kind,
+                                      bool is_volatile) {
+  ObjectLog::FieldValue field_value;
+  field_value.value = value;
+  field_value.offset = offset.Uint32Value();
+  field_value.kind = kind;
+  field_value.is_volatile = is_volatile;
+  field_values_.push_back(field_value);
+  if (field_values_.size() >= kMinLogSizeToCompact &&
+      field_values_.size() >= 2 * compacted_size_) {
+    Compact();
   }
 }
 
+// Sort the log by offset and keep only the first, i.e. oldest, value logged for each field, which
+// is the one a rollback has to restore. The sort is stable so that logging order is preserved
+// among the values of one field.
+void Transaction::ObjectLog::Compact() {
+  std::stable_sort(field_values_.begin(), field_values_.end(),
+                   [](const FieldValue& a, const FieldValue& b) { return a.offset < b.offset; });
+  auto new_end = std::unique(field_values_.begin(), field_values_.end(),
+                             [](const FieldValue& a, const FieldValue& b) {
+                               return a.offset == b.offset;
+                             });
+  field_values_.erase(new_end, field_values_.end());
+  compacted_size_ = field_values_.size();
+}
+
 void Transaction::ObjectLog::Undo(mirror::Object* obj) {
-  for (auto& it : field_values_) {
+  Compact();
+  for (const FieldValue& field_value : field_values_) {
     // Garbage collector needs to access object's class and array's length. So we don't rollback
     // these values.
-    MemberOffset field_offset(it.first);
+    MemberOffset field_offset(field_value.offset);
     if (field_offset.Uint32Value() == mirror::Class::ClassOffset().Uint32Value()) {
       // Skip Object::class field.
       continue;
@@ -270,7 +311,6 @@ void Transaction::ObjectLog::Undo(mirror::Object* obj) {
       // Skip Array::length field.
       continue;
     }
-    FieldValue& field_value = it.second;
     UndoFieldWrite(obj, field_offset, field_value);
   }
 }
@@ -313,8 +353,7 @@ void Transaction::ObjectLog::UndoFieldWrite(mirror::Object* obj, MemberOffset fi
 }
 
 void Transaction::ObjectLog::VisitRoots(RootCallback* callback, void* arg) {
-  for (auto it : field_values_) {
-    FieldValue& field_value = it.second;
+  for (FieldValue& field_value : field_values_) {
     if (field_value.kind == ObjectLog::kReference) {
       mirror::Object* obj =
           reinterpret_cast<mirror::Object*>(static_cast<uintptr_t>(field_value.value));
@@ -368,18 +407,35 @@ void Transaction::InternStringLog::VisitRoots(RootCallback* callback, void* arg)
 }
 
 void Transaction::ArrayLog::LogValue(size_t index, uint64_t value) {
-  auto it = array_values_.find(index);
-  if (it == array_values_.end()) {
-    array_values_.insert(std::make_pair(index, value));
+  ArrayLog::ArrayValue array_value;
+  array_value.value = value;
+  array_value.index = index;
+  array_values_.push_back(array_value);
+  if (array_values_.size() >= kMinLogSizeToCompact &&
+      array_values_.size() >= 2 * compacted_size_) {
+    Compact();
   }
 }
 
+// See ObjectLog::Compact.
+void Transaction::ArrayLog::Compact() {
+  std::stable_sort(array_values_.begin(), array_values_.end(),
+                   [](const ArrayValue& a, const ArrayValue& b) { return a.index < b.index; });
+  auto new_end = std::unique(array_values_.begin(), array_values_.end(),
+                             [](const ArrayValue& a, const ArrayValue& b) {
+                               return a.index == b.index;
+                             });
+  array_values_.erase(new_end, array_values_.end());
+  compacted_size_ = array_values_.size();
+}
+
 void Transaction::ArrayLog::Undo(mirror::Array* array) {
   DCHECK(array != nullptr);
   DCHECK(array->IsArrayInstance());
+  Compact();
   Primitive::Type type = array->GetClass()->GetComponentType()->GetPrimitiveType();
-  for (auto it : array_values_) {
-    UndoArrayWrite(array, type, it.first, it.second);
+  for (const ArrayValue& array_value : array_values_) {
+    UndoArrayWrite(array, type, array_value.index, array_value.value);
   }
 }
 
@@ -26,6 +26,7 @@
 
 #include <list>
 #include <map>
+#include <vector>
 
 namespace art {
 namespace mirror {
@@ -80,8 +81,13 @@ class Transaction {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
  private:
+  // Object and array logs are append-only: every write records the old value, and the log is
+  // only sorted by offset (or index) and reduced to the oldest value of each slot when it has
+  // doubled in size since the last compaction, or before it is used for rollback.
   class ObjectLog {
    public:
+    ObjectLog() : compacted_size_(0) {}
+
     void Log32BitsValue(MemberOffset offset, uint32_t value, bool is_volatile);
     void Log64BitsValue(MemberOffset offset, uint64_t value, bool is_volatile);
     void LogReferenceValue(MemberOffset offset, mirror::Object* obj, bool is_volatile);
@@ -102,19 +108,27 @@ class Transaction {
     struct FieldValue {
       // TODO use JValue instead ?
       uint64_t value;
+      uint32_t offset;
       FieldValueKind kind;
       bool is_volatile;
     };
 
+    void LogValue(MemberOffset offset, uint64_t value, FieldValueKind kind, bool is_volatile);
+    void Compact();
+
     void UndoFieldWrite(mirror::Object* obj, MemberOffset field_offset,
                         const FieldValue& field_value) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-    // Maps field's offset to its value.
-    std::map<uint32_t, FieldValue> field_values_;
+    // Old field values in logging order until compacted.
+    std::vector<FieldValue> field_values_;
+    // Size of field_values_ after the last compaction.
+    size_t compacted_size_;
   };
 
   class ArrayLog {
    public:
+    ArrayLog() : compacted_size_(0) {}
+
     void LogValue(size_t index, uint64_t value);
 
     void Undo(mirror::Array* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -124,12 +138,21 @@ class Transaction {
     }
 
    private:
+    struct ArrayValue {
+      // TODO use JValue instead ?
+      uint64_t value;
+      size_t index;
+    };
+
+    void Compact();
+
     void UndoArrayWrite(mirror::Array* array, Primitive::Type array_type, size_t index,
                         uint64_t value) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-    // Maps index to value.
-    // TODO use JValue instead ?
-    std::map<size_t, uint64_t> array_values_;
+    // Old element values in logging order until compacted.
+    std::vector<ArrayValue> array_values_;
+    // Size of array_values_ after the last compaction.
+    size_t compacted_size_;
   };
 
   class InternStringLog {
@@ -163,6 +186,9 @@ class Transaction {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::intern_table_lock_)
       LOCKS_EXCLUDED(log_lock_);
 
+  ObjectLog* GetObjectLog(mirror::Object* obj) EXCLUSIVE_LOCKS_REQUIRED(log_lock_);
+  ArrayLog* GetArrayLog(mirror::Array* array) EXCLUSIVE_LOCKS_REQUIRED(log_lock_);
+
   void UndoObjectModifications()
       EXCLUSIVE_LOCKS_REQUIRED(log_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -189,6 +215,14 @@ class Transaction {
   std::map<mirror::Array*, ArrayLog> array_logs_  GUARDED_BY(log_lock_);
   std::list<InternStringLog> intern_string_logs_ GUARDED_BY(log_lock_);
 
+  // The last object and array written, since <clinit>s tend to write many fields or elements of
+  // the same object in a row. Map nodes are stable, so these stay valid until the entry is moved
+  // or erased.
+  mirror::Object* last_object_ GUARDED_BY(log_lock_);
+  ObjectLog* last_object_log_ GUARDED_BY(log_lock_);
+  mirror::Array* last_array_ GUARDED_BY(log_lock_);
+  ArrayLog* last_array_log_ GUARDED_BY(log_lock_);
+
   DISALLOW_COPY_AND_ASSIGN(Transaction);
 };
 
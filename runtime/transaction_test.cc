@@ -99,6 +99,38 @@ TEST_F(TransactionTest, Array_length) {
   EXPECT_EQ(h_obj->GetLength(), kArraySize);
 }
 
+TEST_F(TransactionTest, Array_repeatedWrites) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+
+  constexpr int32_t kArraySize = 64;
+  constexpr int32_t kRounds = 10;
+
+  // Allocate and fill the array before the transaction.
+  Handle<mirror::IntArray> h_array(hs.NewHandle(mirror::IntArray::Alloc(soa.Self(), kArraySize)));
+  ASSERT_TRUE(h_array.Get() != nullptr);
+  for (int32_t i = 0; i < kArraySize; ++i) {
+    h_array->Set<false>(i, i);
+  }
+
+  Transaction transaction;
+  Runtime::Current()->EnterTransactionMode(&transaction);
+  // Write every element several times, in an order that is not sorted by index, so that the log
+  // is compacted with several values per element.
+  for (int32_t round = 0; round < kRounds; ++round) {
+    for (int32_t i = kArraySize - 1; i >= 0; --i) {
+      h_array->Set<true>(i, round * kArraySize + i + 1000);
+    }
+  }
+  Runtime::Current()->ExitTransactionMode();
+
+  // Aborting transaction must restore the values written before it.
+  transaction.Abort();
+  for (int32_t i = 0; i < kArraySize; ++i) {
+    EXPECT_EQ(h_array->Get(i), i);
+  }
+}
+
 TEST_F(TransactionTest, StaticFieldsTest) {
   ScopedObjectAccess soa(Thread::Current());
   StackHandleScope<4> hs(soa.Self());
@@ -20,13 +20,35 @@
 #include "mirror/array.h"
 #include "mirror/object-inl.h"
 #include "utf-inl.h"
+#include "utils.h"
 
 namespace art {
 
+// Modified UTF-8 never contains an embedded NUL, so a word whose bytes are all non-zero and
+// below 0x80 is a run of sizeof(uintptr_t) one-byte characters. Words are only read at aligned
+// addresses, so a read never crosses into a page the string does not touch.
+static constexpr uintptr_t kLowBytes = ~static_cast<uintptr_t>(0) / 0xff;
+static constexpr uintptr_t kHighBits = kLowBytes * 0x80;
+
+static inline bool IsAsciiWordWithoutNul(uintptr_t word) {
+  return ((word | ((word - kLowBytes) & ~word)) & kHighBits) == 0;
+}
+
 size_t CountModifiedUtf8Chars(const char* utf8) {
   size_t len = 0;
-  int ic;
-  while ((ic = *utf8++) != '\0') {
+  while (true) {
+    if (IsAligned<sizeof(uintptr_t)>(utf8)) {
+      const uintptr_t* words = reinterpret_cast<const uintptr_t*>(utf8);
+      while (IsAsciiWordWithoutNul(*words)) {
+        ++words;
+      }
+      len += reinterpret_cast<const char*>(words) - utf8;
+      utf8 = reinterpret_cast<const char*>(words);
+    }
+    int ic = *utf8++;
+    if (ic == '\0') {
+      break;
+    }
     len++;
     if ((ic & 0x80) == 0) {
       // one-byte encoding
@@ -45,7 +67,19 @@ size_t CountModifiedUtf8Chars(const char* utf8) {
 }
 
 void ConvertModifiedUtf8ToUtf16(uint16_t* utf16_data_out, const char* utf8_data_in) {
-  while (*utf8_data_in != '\0') {
+  while (true) {
+    if (IsAligned<sizeof(uintptr_t)>(utf8_data_in)) {
+      while (IsAsciiWordWithoutNul(*reinterpret_cast<const uintptr_t*>(utf8_data_in))) {
+        for (size_t i = 0; i < sizeof(uintptr_t); ++i) {
+          utf16_data_out[i] = static_cast<uint8_t>(utf8_data_in[i]);
+        }
+        utf16_data_out += sizeof(uintptr_t);
+        utf8_data_in += sizeof(uintptr_t);
+      }
+    }
+    if (*utf8_data_in == '\0') {
+      break;
+    }
     *utf16_data_out++ = GetUtf16FromUtf8(&utf8_data_in);
   }
 }
@@ -70,18 +104,31 @@ void ConvertUtf16ToModifiedUtf8(char* utf8_out, const uint16_t* utf16_in, size_t
 
 int32_t ComputeUtf16Hash(mirror::CharArray* chars, int32_t offset,
                          size_t char_count) {
-  int32_t hash = 0;
-  for (size_t i = 0; i < char_count; i++) {
-    hash = hash * 31 + chars->Get(offset + i);
-  }
-  return hash;
+  DCHECK_LE(offset + char_count, static_cast<size_t>(chars->GetLength()));
+  return ComputeUtf16Hash(chars->GetData() + offset, char_count);
 }
 
 int32_t ComputeUtf16Hash(const uint16_t* chars, size_t char_count) {
-  int32_t hash = 0;
+  // Four chars per iteration with the powers of 31 folded in, so that the multiplications
+  // don't form a single dependency chain. Unsigned arithmetic wraps like the Java hash.
+  static constexpr uint32_t k31_2 = 31 * 31;
+  static constexpr uint32_t k31_3 = 31 * 31 * 31;
+  static constexpr uint32_t k31_4 = 31 * 31 * 31 * 31;
+  uint32_t hash = 0;
+  for (; char_count >= 4; char_count -= 4, chars += 4) {
+    hash = hash * k31_4 + chars[0] * k31_3 + chars[1] * k31_2 + chars[2] * 31u + chars[3];
+  }
   while (char_count--) {
     hash = hash * 31 + *chars++;
   }
+  return static_cast<int32_t>(hash);
+}
+
+uint32_t ComputeModifiedUtf8Hash(const char* chars) {
+  uint32_t hash = 0;
+  while (*chars != '\0') {
+    hash = hash * 31 + static_cast<uint8_t>(*chars++);
+  }
   return hash;
 }
 
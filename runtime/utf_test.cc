@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utf.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "utf-inl.h"
+
+namespace art {
+
+// Reference decoder without the word-at-a-time fast path.
+static std::vector<uint16_t> SlowConvert(const char* utf8) {
+  std::vector<uint16_t> result;
+  while (*utf8 != '\0') {
+    result.push_back(GetUtf16FromUtf8(&utf8));
+  }
+  return result;
+}
+
+// Checks the word-at-a-time count and conversion of pattern against the reference decoder, with
+// pattern starting at every alignment.
+static void CheckAllAlignments(const std::string& pattern) {
+  for (size_t offset = 0; offset < 2 * sizeof(uintptr_t); ++offset) {
+    std::string buffer(offset, 'x');
+    buffer += pattern;
+    const char* utf8 = buffer.c_str() + offset;
+    std::vector<uint16_t> expected = SlowConvert(utf8);
+    ASSERT_EQ(expected.size(), CountModifiedUtf8Chars(utf8)) << " offset = " << offset;
+    std::vector<uint16_t> actual(expected.size() + 1, 0xffff);
+    ConvertModifiedUtf8ToUtf16(&actual[0], utf8);
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i], actual[i]) << " offset = " << offset << " i = " << i;
+    }
+    EXPECT_EQ(0xffff, actual[expected.size()]) << " offset = " << offset;
+  }
+}
+
+TEST(UtfTest, AsciiFastPathAllAlignments) {
+  // Mix long ASCII runs with two- and three-byte sequences and an encoded NUL so that the
+  // fast path is entered and left at every alignment.
+  CheckAllAlignments(
+      "The quick brown fox \xc3\xa9 jumps over \xe2\x82\xac the lazy dog \xc0\x80 again.");
+}
+
+TEST(UtfTest, SurrogatePairs) {
+  // U+1F600 is encoded as the two three-byte sequences of its surrogates in modified UTF-8.
+  const char* smiley = "\xed\xa0\xbd\xed\xb8\x80";
+  EXPECT_EQ(2U, CountModifiedUtf8Chars(smiley));
+  uint16_t out[2];
+  ConvertModifiedUtf8ToUtf16(out, smiley);
+  EXPECT_EQ(0xd83d, out[0]);
+  EXPECT_EQ(0xde00, out[1]);
+  CheckAllAlignments(std::string("ASCII before the pair ") + smiley + " and after the pair.");
+  CheckAllAlignments(std::string(smiley) + smiley + "12345678" + smiley);
+}
+
+TEST(UtfTest, FourByteSequences) {
+  // Standard UTF-8 four-byte sequences aren't modified UTF-8, the fast path must still decode
+  // them the same way as the reference decoder rather than skip over them.
+  CheckAllAlignments("abcdefgh" "\xf0\x9f\x98\x80" "abcdefghijklmnop" "\xf0\x9f\x98\x80" "xy");
+}
+
+TEST(UtfTest, RoundTrip) {
+  // Every UTF-16 value, including NUL and unpaired surrogates, survives the encoding.
+  std::vector<uint16_t> chars;
+  for (uint32_t c = 0; c <= 0xffff; c += 7) {
+    chars.push_back(static_cast<uint16_t>(c));
+    // ASCII runs long enough for the fast path in between.
+    for (size_t i = 0; i < (c % 19); ++i) {
+      chars.push_back(static_cast<uint16_t>('a' + i));
+    }
+  }
+  std::vector<char> utf8(CountUtf8Bytes(&chars[0], chars.size()) + 1, '\0');
+  ConvertUtf16ToModifiedUtf8(&utf8[0], &chars[0], chars.size());
+  ASSERT_EQ(chars.size(), CountModifiedUtf8Chars(&utf8[0]));
+  std::vector<uint16_t> decoded(chars.size());
+  ConvertModifiedUtf8ToUtf16(&decoded[0], &utf8[0]);
+  EXPECT_TRUE(chars == decoded);
+  EXPECT_TRUE(chars == SlowConvert(&utf8[0]));
+}
+
+TEST(UtfTest, EmptyAndShortStrings) {
+  EXPECT_EQ(0U, CountModifiedUtf8Chars(""));
+  EXPECT_EQ(1U, CountModifiedUtf8Chars("a"));
+  EXPECT_EQ(1U, CountModifiedUtf8Chars("\xe2\x82\xac"));
+  uint16_t out[2] = { 0xffff, 0xffff };
+  ConvertModifiedUtf8ToUtf16(out, "\xc3\xa9");
+  EXPECT_EQ(0xe9, out[0]);
+  EXPECT_EQ(0xffff, out[1]);
+}
+
+}  // namespace art
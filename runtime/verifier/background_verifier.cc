@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "background_verifier.h"
+
+#include "class_linker.h"
+#include "handle_scope-inl.h"
+#include "jni_internal.h"
+#include "mirror/class-inl.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread_pool.h"
+
+namespace art {
+namespace verifier {
+
+// Verifies a class queued by AddClass. The class is held through a weak global so that it may
+// be unloaded while it waits in the queue.
+class BackgroundVerifyTask : public Task {
+ public:
+  BackgroundVerifyTask(BackgroundVerifier* verifier, jweak klass)
+      : verifier_(verifier), klass_(klass) {}
+
+  virtual void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    JavaVMExt* vm = soa.Vm();
+    mirror::Object* klass = vm->DecodeWeakGlobal(self, klass_);
+    if (klass != nullptr) {
+      verifier_->VerifyClass(self, down_cast<mirror::Class*>(klass));
+    }
+    vm->DeleteWeakGlobalRef(self, klass_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  BackgroundVerifier* const verifier_;
+  const jweak klass_;
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundVerifyTask);
+};
+
+BackgroundVerifier::BackgroundVerifier(size_t thread_count)
+    : thread_pool_(new ThreadPool("Verifier thread pool", thread_count, true)),
+      lock_("background verifier lock"), num_queued_(0), num_verified_(0), num_skipped_(0) {
+  thread_pool_->StartWorkers(Thread::Current());
+}
+
+BackgroundVerifier::~BackgroundVerifier() {
+  DeleteThreadPool();
+}
+
+void BackgroundVerifier::DeleteThreadPool() {
+  // Waits for the verifications in progress.
+  thread_pool_.reset();
+}
+
+void BackgroundVerifier::AddClass(Thread* self, mirror::Class* klass) {
+  if (thread_pool_.get() == nullptr) {
+    return;
+  }
+  {
+    MutexLock mu(self, lock_);
+    ++num_queued_;
+  }
+  jweak weak_class = self->GetJniEnv()->vm->AddWeakGlobalReference(self, klass);
+  thread_pool_->AddTask(self, new BackgroundVerifyTask(this, weak_class));
+}
+
+void BackgroundVerifier::VerifyClass(Thread* self, mirror::Class* klass) {
+  StackHandleScope<1> hs(self);
+  Handle<mirror::Class> h_class(hs.NewHandle(klass));
+  // ClassLinker::VerifyClass checks again with the class lock held.
+  const bool verify = !h_class->IsVerified() && !h_class->IsErroneous();
+  if (verify) {
+    Runtime::Current()->GetClassLinker()->VerifyClass(h_class);
+    // A verification error is thrown again by the initialization of the class.
+    self->ClearException();
+  }
+  MutexLock mu(self, lock_);
+  if (verify) {
+    ++num_verified_;
+  } else {
+    ++num_skipped_;
+  }
+}
+
+void BackgroundVerifier::DumpInfo(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Background verifier queued classes: " << num_queued_ << " (" << num_verified_
+     << " verified, " << num_skipped_ << " verified by their initialization)\n";
+}
+
+}  // namespace verifier
+}  // namespace art
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_VERIFIER_BACKGROUND_VERIFIER_H_
+#define ART_RUNTIME_VERIFIER_BACKGROUND_VERIFIER_H_
+
+#include <iosfwd>
+#include <memory>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+namespace mirror {
+  class Class;
+}  // namespace mirror
+
+class Thread;
+class ThreadPool;
+
+namespace verifier {
+
+// Verifies the classes the oat file doesn't have as verified on background threads, as soon as
+// they are linked and in the order they are defined, so that their initialization doesn't have
+// to. An initialization that races ahead of the verification waits for it on the class lock, as
+// it would for the verification by another thread initializing the class.
+//
+// The workers are java.lang.Threads, the verifier may load classes through the class loader of
+// the class it verifies.
+class BackgroundVerifier {
+ public:
+  static constexpr size_t kDefaultThreadCount = 1;
+
+  // Starts the workers, the runtime must be started and the calling thread suspended.
+  explicit BackgroundVerifier(size_t thread_count);
+
+  ~BackgroundVerifier();
+
+  // Queues the verification of a class which was just linked.
+  void AddClass(Thread* self, mirror::Class* klass)
+      LOCKS_EXCLUDED(lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Verifies the class unless its initialization did already.
+  void VerifyClass(Thread* self, mirror::Class* klass)
+      LOCKS_EXCLUDED(lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Stops the workers, called before the runtime shuts down. The verifications still queued are
+  // dropped.
+  void DeleteThreadPool();
+
+  void DumpInfo(std::ostream& os) LOCKS_EXCLUDED(lock_);
+
+ private:
+  std::unique_ptr<ThreadPool> thread_pool_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+
+  size_t num_queued_ GUARDED_BY(lock_);
+  // Classes verified by the workers, the others were verified by their initialization first.
+  size_t num_verified_ GUARDED_BY(lock_);
+  size_t num_skipped_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundVerifier);
+};
+
+}  // namespace verifier
+}  // namespace art
+
+#endif  // ART_RUNTIME_VERIFIER_BACKGROUND_VERIFIER_H_
@@ -42,6 +42,7 @@
 #include "scoped_thread_state_change.h"
 #include "handle_scope-inl.h"
 #include "verifier/dex_gc_map.h"
+#include "verifier/verifier_deps.h"
 
 namespace art {
 namespace verifier {
@@ -2905,6 +2906,18 @@ const RegType& MethodVerifier::GetCaughtExceptionType() {
   return *common_super;
 }
 
+static VerifierDeps::MethodResolutionKind GetMethodResolutionKind(MethodType method_type) {
+  switch (method_type) {
+    case METHOD_DIRECT:
+    case METHOD_STATIC:
+      return VerifierDeps::kDirectMethodResolution;
+    case METHOD_INTERFACE:
+      return VerifierDeps::kInterfaceMethodResolution;
+    default:
+      return VerifierDeps::kVirtualMethodResolution;
+  }
+}
+
 mirror::ArtMethod* MethodVerifier::ResolveMethodAndCheckAccess(uint32_t dex_method_idx,
                                                                MethodType method_type) {
   const DexFile::MethodId& method_id = dex_file_->GetMethodId(dex_method_idx);
@@ -2942,6 +2955,8 @@ mirror::ArtMethod* MethodVerifier::ResolveMethodAndCheckAccess(uint32_t dex_meth
         res_method = klass->FindDirectMethod(name, signature);
       }
       if (res_method == NULL) {
+        VerifierDeps::MaybeRecordMethodResolution(*dex_file_, dex_method_idx,
+                                                  GetMethodResolutionKind(method_type), nullptr);
         Fail(VERIFY_ERROR_NO_METHOD) << "couldn't find method "
                                      << PrettyDescriptor(klass) << "." << name
                                      << " " << signature;
@@ -2949,6 +2964,8 @@ mirror::ArtMethod* MethodVerifier::ResolveMethodAndCheckAccess(uint32_t dex_meth
       }
     }
   }
+  VerifierDeps::MaybeRecordMethodResolution(*dex_file_, dex_method_idx,
+                                            GetMethodResolutionKind(method_type), res_method);
   // Make sure calls to constructors are "direct". There are additional restrictions but we don't
   // enforce them here.
   if (res_method->IsConstructor() && method_type != METHOD_DIRECT) {
@@ -3420,6 +3437,7 @@ mirror::ArtField* MethodVerifier::GetStaticField(int field_idx) {
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   mirror::ArtField* field = class_linker->ResolveFieldJLS(*dex_file_, field_idx, *dex_cache_,
                                                           *class_loader_);
+  VerifierDeps::MaybeRecordFieldResolution(*dex_file_, field_idx, field);
   if (field == NULL) {
     VLOG(verifier) << "Unable to resolve static field " << field_idx << " ("
               << dex_file_->GetFieldName(field_id) << ") in "
@@ -3455,6 +3473,7 @@ mirror::ArtField* MethodVerifier::GetInstanceField(const RegType& obj_type, int
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   mirror::ArtField* field = class_linker->ResolveFieldJLS(*dex_file_, field_idx, *dex_cache_,
                                                           *class_loader_);
+  VerifierDeps::MaybeRecordFieldResolution(*dex_file_, field_idx, field);
   if (field == NULL) {
     VLOG(verifier) << "Unable to resolve instance field " << field_idx << " ("
               << dex_file_->GetFieldName(field_id) << ") in "
@@ -166,6 +166,10 @@ class MethodVerifier {
     return &reg_types_;
   }
 
+  RegisterBlockPool* GetRegisterBlockPool() {
+    return &register_blocks_;
+  }
+
   // Log a verification failure.
   std::ostream& Fail(VerifyError error);
 
@@ -615,6 +619,9 @@ class MethodVerifier {
 
   RegTypeCache reg_types_;
 
+  // The storage of the register lines, declared before them so that it outlives them.
+  RegisterBlockPool register_blocks_;
+
   PcToRegisterLineTable reg_table_;
 
   // Storage for the register status we're currently working on.
@@ -27,6 +27,7 @@
 #include "object_utils.h"
 #include "reg_type_cache-inl.h"
 #include "scoped_thread_state_change.h"
+#include "verifier_deps.h"
 
 #include <limits>
 #include <sstream>
@@ -742,10 +743,11 @@ static bool AssignableFrom(const RegType& lhs, const RegType& rhs, bool strict)
         return true;
       } else if (lhs.IsJavaLangObjectArray()) {
         return rhs.IsObjectArrayTypes();  // All reference arrays may be assigned to Object[]
-      } else if (lhs.HasClass() && rhs.HasClass() &&
-                 lhs.GetClass()->IsAssignableFrom(rhs.GetClass())) {
-        // We're assignable from the Class point-of-view.
-        return true;
+      } else if (lhs.HasClass() && rhs.HasClass()) {
+        // We're assignable if we are from the Class point-of-view.
+        bool is_assignable = lhs.GetClass()->IsAssignableFrom(rhs.GetClass());
+        VerifierDeps::MaybeRecordAssignability(lhs.GetClass(), rhs.GetClass(), is_assignable);
+        return is_assignable;
       } else {
         // Unresolved types are only assignable for null and equality.
         return false;
@@ -894,6 +896,10 @@ const RegType& RegType::Merge(const RegType& incoming_type, RegTypeCache* reg_ty
       DCHECK(c1 != NULL && !c1->IsPrimitive());
       DCHECK(c2 != NULL && !c2->IsPrimitive());
       mirror::Class* join_class = ClassJoin(c1, c2);
+      // The join found with other classes would be more precise, but this one stays sound as
+      // long as both types are assignable to it.
+      VerifierDeps::MaybeRecordAssignability(join_class, c1, true);
+      VerifierDeps::MaybeRecordAssignability(join_class, c2, true);
       if (c1 == join_class && !IsPreciseReference()) {
         return *this;
       } else if (c2 == join_class && !incoming_type.IsPreciseReference()) {
@@ -22,6 +22,9 @@
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
 #include "object_utils.h"
+#include "utf.h"
+#include "utils.h"
+#include "verifier_deps.h"
 
 namespace art {
 namespace verifier {
@@ -29,6 +32,8 @@ namespace verifier {
 bool RegTypeCache::primitive_initialized_ = false;
 uint16_t RegTypeCache::primitive_count_ = 0;
 PreciseConstType* RegTypeCache::small_precise_constants_[kMaxSmallConstant - kMinSmallConstant + 1];
+constexpr uint16_t RegTypeCache::kNoEntry;
+constexpr size_t RegTypeCache::kEntryChunkSize;
 
 static bool MatchingPrecisionForClass(RegType* entry, bool precise)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -64,6 +69,76 @@ void RegTypeCache::FillPrimitiveAndSmallConstantTypes() {
     entries_.push_back(small_precise_constants_[i]);
   }
   DCHECK_EQ(entries_.size(), primitive_count_);
+  // The shared entries are looked up directly, they are never linked in the indexes.
+  next_with_descriptor_.resize(entries_.size(), kNoEntry);
+  next_with_class_.resize(entries_.size(), kNoEntry);
+}
+
+void* RegTypeCache::AllocEntry(size_t size) {
+  size = RoundUp(size, kEntryAlignment);
+  DCHECK_LE(size, kEntryChunkSize);
+  if (static_cast<size_t>(chunk_end_ - chunk_pos_) < size) {
+    uint8_t* chunk = new uint8_t[kEntryChunkSize];
+    chunks_.push_back(std::unique_ptr<uint8_t[]>(chunk));
+    chunk_pos_ = chunk;
+    chunk_end_ = chunk + kEntryChunkSize;
+  }
+  void* result = chunk_pos_;
+  chunk_pos_ += size;
+  return result;
+}
+
+template <class Type, typename... Args>
+Type* RegTypeCache::AddEntry(Args&&... args) {
+  COMPILE_ASSERT(alignof(Type) <= kEntryAlignment, reg_type_alignment_too_large);
+  Type* entry =
+      new (AllocEntry(sizeof(Type))) Type(std::forward<Args>(args)..., entries_.size());
+  DCHECK_EQ(entry->GetId(), entries_.size());
+  entries_.push_back(entry);
+  next_with_descriptor_.push_back(kNoEntry);
+  next_with_class_.push_back(kNoEntry);
+  if (!entry->descriptor_.empty()) {
+    LinkEntry(&descriptor_chains_, &next_with_descriptor_,
+              ComputeModifiedUtf8Hash(entry->descriptor_.c_str()), entry->GetId());
+  }
+  if (entry->klass_ != nullptr) {
+    LinkEntry(&class_chains_, &next_with_class_, entry->klass_, entry->GetId());
+  }
+  return entry;
+}
+
+template <typename Key>
+void RegTypeCache::LinkEntry(std::unordered_map<Key, Chain>* chains,
+                             std::vector<uint16_t>* next, Key key, uint16_t id) {
+  auto it = chains->find(key);
+  if (it == chains->end()) {
+    chains->insert(std::make_pair(key, Chain(id, id)));
+  } else {
+    // Append so that the chains are walked in the order of the ids, like entries_ would be.
+    (*next)[it->second.second] = id;
+    it->second.second = id;
+  }
+}
+
+uint16_t RegTypeCache::FirstWithDescriptor(const char* descriptor) const {
+  auto it = descriptor_chains_.find(ComputeModifiedUtf8Hash(descriptor));
+  return (it != descriptor_chains_.end()) ? it->second.first : kNoEntry;
+}
+
+uint16_t RegTypeCache::FirstWithClass(mirror::Class* klass) const {
+  auto it = class_chains_.find(klass);
+  return (it != class_chains_.end()) ? it->second.first : kNoEntry;
+}
+
+void RegTypeCache::RelinkClasses() {
+  class_chains_.clear();
+  std::fill(next_with_class_.begin(), next_with_class_.end(), kNoEntry);
+  for (size_t i = primitive_count_; i < entries_.size(); i++) {
+    RegType* entry = entries_[i];
+    if (entry->klass_ != nullptr) {
+      LinkEntry(&class_chains_, &next_with_class_, entry->klass_, entry->GetId());
+    }
+  }
 }
 
 const RegType& RegTypeCache::FromDescriptor(mirror::ClassLoader* loader, const char* descriptor,
@@ -160,7 +235,8 @@ mirror::Class* RegTypeCache::ResolveClass(const char* descriptor, mirror::ClassL
 const RegType& RegTypeCache::From(mirror::ClassLoader* loader, const char* descriptor,
                                   bool precise) {
   // Try looking up the class in the cache first.
-  for (size_t i = primitive_count_; i < entries_.size(); i++) {
+  for (uint16_t i = FirstWithDescriptor(descriptor); i != kNoEntry;
+       i = next_with_descriptor_[i]) {
     if (MatchDescriptor(i, descriptor, precise)) {
       return *(entries_[i]);
     }
@@ -168,6 +244,10 @@ const RegType& RegTypeCache::From(mirror::ClassLoader* loader, const char* descr
   // Class not found in the cache, will create a new type for that.
   // Try resolving class.
   mirror::Class* klass = ResolveClass(descriptor, loader);
+  if (can_load_classes_) {
+    // Types which weren't looked for may just not be loaded yet.
+    VerifierDeps::MaybeRecordClassResolution(descriptor, klass);
+  }
   if (klass != NULL) {
     // Class resolved, first look for the class in the list of entries
     // Class was not found, must create new type.
@@ -182,11 +262,10 @@ const RegType& RegTypeCache::From(mirror::ClassLoader* loader, const char* descr
     if (klass->CannotBeAssignedFromOtherTypes() || precise) {
       DCHECK(!(klass->IsAbstract()) || klass->IsArrayClass());
       DCHECK(!klass->IsInterface());
-      entry = new PreciseReferenceType(klass, descriptor, entries_.size());
+      entry = AddEntry<PreciseReferenceType>(klass, descriptor);
     } else {
-      entry = new ReferenceType(klass, descriptor, entries_.size());
+      entry = AddEntry<ReferenceType>(klass, descriptor);
     }
-    entries_.push_back(entry);
     return *entry;
   } else {  // Class not resolved.
     // We tried loading the class and failed, this might get an exception raised
@@ -198,8 +277,7 @@ const RegType& RegTypeCache::From(mirror::ClassLoader* loader, const char* descr
       DCHECK(!Thread::Current()->IsExceptionPending());
     }
     if (IsValidDescriptor(descriptor)) {
-      RegType* entry = new UnresolvedReferenceType(descriptor, entries_.size());
-      entries_.push_back(entry);
+      RegType* entry = AddEntry<UnresolvedReferenceType>(descriptor);
       return *entry;
     } else {
       // The descriptor is broken return the unknown type as there's nothing sensible that
@@ -217,42 +295,41 @@ const RegType& RegTypeCache::FromClass(const char* descriptor, mirror::Class* kl
     return RegTypeFromPrimitiveType(klass->GetPrimitiveType());
   } else {
     // Look for the reference in the list of entries to have.
-    for (size_t i = primitive_count_; i < entries_.size(); i++) {
+    for (uint16_t i = FirstWithClass(klass); i != kNoEntry; i = next_with_class_[i]) {
       RegType* cur_entry = entries_[i];
-      if (cur_entry->klass_ == klass && MatchingPrecisionForClass(cur_entry, precise)) {
+      if (MatchingPrecisionForClass(cur_entry, precise)) {
         return *cur_entry;
       }
     }
     // No reference to the class was found, create new reference.
+    VerifierDeps::MaybeRecordClassResolution(descriptor, klass);
     RegType* entry;
     if (precise) {
-      entry = new PreciseReferenceType(klass, descriptor, entries_.size());
+      entry = AddEntry<PreciseReferenceType>(klass, descriptor);
     } else {
-      entry = new ReferenceType(klass, descriptor, entries_.size());
+      entry = AddEntry<ReferenceType>(klass, descriptor);
     }
-    entries_.push_back(entry);
     return *entry;
   }
 }
 
-RegTypeCache::RegTypeCache(bool can_load_classes) : can_load_classes_(can_load_classes) {
+RegTypeCache::RegTypeCache(bool can_load_classes)
+    : chunk_pos_(nullptr), chunk_end_(nullptr), can_load_classes_(can_load_classes) {
   if (kIsDebugBuild && can_load_classes) {
     Thread::Current()->AssertThreadSuspensionIsAllowable();
   }
   entries_.reserve(64);
+  next_with_descriptor_.reserve(64);
+  next_with_class_.reserve(64);
   FillPrimitiveAndSmallConstantTypes();
 }
 
 RegTypeCache::~RegTypeCache() {
   CHECK_LE(primitive_count_, entries_.size());
-  // Delete only the non primitive types.
-  if (entries_.size() == kNumPrimitivesAndSmallConstants) {
-    // All entries are from the global pool, nothing to delete.
-    return;
+  // Destroy only the non primitive types, their storage goes with the chunks.
+  for (size_t i = kNumPrimitivesAndSmallConstants; i < entries_.size(); i++) {
+    entries_[i]->~RegType();
   }
-  std::vector<RegType*>::iterator non_primitive_begin = entries_.begin();
-  std::advance(non_primitive_begin, kNumPrimitivesAndSmallConstants);
-  STLDeleteContainerPointers(non_primitive_begin, entries_.end());
 }
 
 void RegTypeCache::ShutDown() {
@@ -339,8 +416,7 @@ const RegType& RegTypeCache::FromUnresolvedMerge(const RegType& left, const RegT
     }
   }
   // Create entry.
-  RegType* entry = new UnresolvedMergedType(left.GetId(), right.GetId(), this, entries_.size());
-  entries_.push_back(entry);
+  RegType* entry = AddEntry<UnresolvedMergedType>(left.GetId(), right.GetId(), this);
   if (kIsDebugBuild) {
     UnresolvedMergedType* tmp_entry = down_cast<UnresolvedMergedType*>(entry);
     std::set<uint16_t> check_types = tmp_entry->GetMergedTypes();
@@ -363,8 +439,7 @@ const RegType& RegTypeCache::FromUnresolvedSuperClass(const RegType& child) {
       }
     }
   }
-  RegType* entry = new UnresolvedSuperClass(child.GetId(), this, entries_.size());
-  entries_.push_back(entry);
+  RegType* entry = AddEntry<UnresolvedSuperClass>(child.GetId(), this);
   return *entry;
 }
 
@@ -372,7 +447,8 @@ const UninitializedType& RegTypeCache::Uninitialized(const RegType& type, uint32
   UninitializedType* entry = NULL;
   const std::string& descriptor(type.GetDescriptor());
   if (type.IsUnresolvedTypes()) {
-    for (size_t i = primitive_count_; i < entries_.size(); i++) {
+    for (uint16_t i = FirstWithDescriptor(descriptor.c_str()); i != kNoEntry;
+         i = next_with_descriptor_[i]) {
       RegType* cur_entry = entries_[i];
       if (cur_entry->IsUnresolvedAndUninitializedReference() &&
           down_cast<UnresolvedUninitializedRefType*>(cur_entry)->GetAllocationPc() == allocation_pc &&
@@ -380,21 +456,19 @@ const UninitializedType& RegTypeCache::Uninitialized(const RegType& type, uint32
         return *down_cast<UnresolvedUninitializedRefType*>(cur_entry);
       }
     }
-    entry = new UnresolvedUninitializedRefType(descriptor, allocation_pc, entries_.size());
+    entry = AddEntry<UnresolvedUninitializedRefType>(descriptor, allocation_pc);
   } else {
     mirror::Class* klass = type.GetClass();
-    for (size_t i = primitive_count_; i < entries_.size(); i++) {
+    for (uint16_t i = FirstWithClass(klass); i != kNoEntry; i = next_with_class_[i]) {
       RegType* cur_entry = entries_[i];
       if (cur_entry->IsUninitializedReference() &&
           down_cast<UninitializedReferenceType*>(cur_entry)
-              ->GetAllocationPc() == allocation_pc &&
-          cur_entry->GetClass() == klass) {
+              ->GetAllocationPc() == allocation_pc) {
         return *down_cast<UninitializedReferenceType*>(cur_entry);
       }
     }
-    entry = new UninitializedReferenceType(klass, descriptor, allocation_pc, entries_.size());
+    entry = AddEntry<UninitializedReferenceType>(klass, descriptor, allocation_pc);
   }
-  entries_.push_back(entry);
   return *entry;
 }
 
@@ -403,40 +477,40 @@ const RegType& RegTypeCache::FromUninitialized(const RegType& uninit_type) {
 
   if (uninit_type.IsUnresolvedTypes()) {
     const std::string& descriptor(uninit_type.GetDescriptor());
-    for (size_t i = primitive_count_; i < entries_.size(); i++) {
+    for (uint16_t i = FirstWithDescriptor(descriptor.c_str()); i != kNoEntry;
+         i = next_with_descriptor_[i]) {
       RegType* cur_entry = entries_[i];
       if (cur_entry->IsUnresolvedReference() &&
           cur_entry->GetDescriptor() == descriptor) {
         return *cur_entry;
       }
     }
-    entry = new UnresolvedReferenceType(descriptor.c_str(), entries_.size());
+    entry = AddEntry<UnresolvedReferenceType>(descriptor.c_str());
   } else {
     mirror::Class* klass = uninit_type.GetClass();
     if (uninit_type.IsUninitializedThisReference() && !klass->IsFinal()) {
       // For uninitialized "this reference" look for reference types that are not precise.
-      for (size_t i = primitive_count_; i < entries_.size(); i++) {
+      for (uint16_t i = FirstWithClass(klass); i != kNoEntry; i = next_with_class_[i]) {
         RegType* cur_entry = entries_[i];
-        if (cur_entry->IsReference() && cur_entry->GetClass() == klass) {
+        if (cur_entry->IsReference()) {
           return *cur_entry;
         }
       }
-      entry = new ReferenceType(klass, "", entries_.size());
+      entry = AddEntry<ReferenceType>(klass, "");
     } else if (klass->IsInstantiable()) {
       // We're uninitialized because of allocation, look or create a precise type as allocations
       // may only create objects of that type.
-      for (size_t i = primitive_count_; i < entries_.size(); i++) {
+      for (uint16_t i = FirstWithClass(klass); i != kNoEntry; i = next_with_class_[i]) {
         RegType* cur_entry = entries_[i];
-        if (cur_entry->IsPreciseReference() && cur_entry->GetClass() == klass) {
+        if (cur_entry->IsPreciseReference()) {
           return *cur_entry;
         }
       }
-      entry = new PreciseReferenceType(klass, uninit_type.GetDescriptor(), entries_.size());
+      entry = AddEntry<PreciseReferenceType>(klass, uninit_type.GetDescriptor());
     } else {
       return Conflict();
     }
   }
-  entries_.push_back(entry);
   return *entry;
 }
 
@@ -481,25 +555,25 @@ const UninitializedType& RegTypeCache::UninitializedThisArgument(const RegType&
   UninitializedType* entry;
   const std::string& descriptor(type.GetDescriptor());
   if (type.IsUnresolvedTypes()) {
-    for (size_t i = primitive_count_; i < entries_.size(); i++) {
+    for (uint16_t i = FirstWithDescriptor(descriptor.c_str()); i != kNoEntry;
+         i = next_with_descriptor_[i]) {
       RegType* cur_entry = entries_[i];
       if (cur_entry->IsUnresolvedAndUninitializedThisReference() &&
           cur_entry->GetDescriptor() == descriptor) {
         return *down_cast<UninitializedType*>(cur_entry);
       }
     }
-    entry = new UnresolvedUninitializedThisRefType(descriptor, entries_.size());
+    entry = AddEntry<UnresolvedUninitializedThisRefType>(descriptor);
   } else {
     mirror::Class* klass = type.GetClass();
-    for (size_t i = primitive_count_; i < entries_.size(); i++) {
+    for (uint16_t i = FirstWithClass(klass); i != kNoEntry; i = next_with_class_[i]) {
       RegType* cur_entry = entries_[i];
-      if (cur_entry->IsUninitializedThisReference() && cur_entry->GetClass() == klass) {
+      if (cur_entry->IsUninitializedThisReference()) {
         return *down_cast<UninitializedType*>(cur_entry);
       }
     }
-    entry = new UninitializedThisReferenceType(klass, descriptor, entries_.size());
+    entry = AddEntry<UninitializedThisReferenceType>(klass, descriptor);
   }
-  entries_.push_back(entry);
   return *entry;
 }
 
@@ -514,11 +588,10 @@ const ConstantType& RegTypeCache::FromCat1NonSmallConstant(int32_t value, bool p
   }
   ConstantType* entry;
   if (precise) {
-    entry = new PreciseConstType(value, entries_.size());
+    entry = AddEntry<PreciseConstType>(value);
   } else {
-    entry = new ImpreciseConstType(value, entries_.size());
+    entry = AddEntry<ImpreciseConstType>(value);
   }
-  entries_.push_back(entry);
   return *entry;
 }
 
@@ -532,11 +605,10 @@ const ConstantType& RegTypeCache::FromCat2ConstLo(int32_t value, bool precise) {
   }
   ConstantType* entry;
   if (precise) {
-    entry = new PreciseConstLoType(value, entries_.size());
+    entry = AddEntry<PreciseConstLoType>(value);
   } else {
-    entry = new ImpreciseConstLoType(value, entries_.size());
+    entry = AddEntry<ImpreciseConstLoType>(value);
   }
-  entries_.push_back(entry);
   return *entry;
 }
 
@@ -550,11 +622,10 @@ const ConstantType& RegTypeCache::FromCat2ConstHi(int32_t value, bool precise) {
   }
   ConstantType* entry;
   if (precise) {
-    entry = new PreciseConstHiType(value, entries_.size());
+    entry = AddEntry<PreciseConstHiType>(value);
   } else {
-    entry = new ImpreciseConstHiType(value, entries_.size());
+    entry = AddEntry<ImpreciseConstHiType>(value);
   }
-  entries_.push_back(entry);
   return *entry;
 }
 
@@ -582,8 +653,15 @@ void RegTypeCache::Dump(std::ostream& os) {
 }
 
 void RegTypeCache::VisitRoots(RootCallback* callback, void* arg) {
+  bool classes_moved = false;
   for (RegType* entry : entries_) {
+    mirror::Class* old_klass = entry->klass_;
     entry->VisitRoots(callback, arg);
+    classes_moved = classes_moved || (entry->klass_ != old_klass);
+  }
+  if (classes_moved) {
+    // The class index is keyed on the addresses of the classes.
+    RelinkClasses();
   }
 }
 
@@ -25,6 +25,9 @@
 #include "runtime.h"
 
 #include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace art {
@@ -154,6 +157,23 @@ class RegTypeCache {
   const ConstantType& FromCat1NonSmallConstant(int32_t value, bool precise)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // The first and last ids of the entries linked under the same key.
+  typedef std::pair<uint16_t, uint16_t> Chain;
+
+  // Create a new entry with the next id in the storage of the cache and index it.
+  template <class Type, typename... Args>
+  Type* AddEntry(Args&&... args) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void* AllocEntry(size_t size);
+  template <typename Key>
+  static void LinkEntry(std::unordered_map<Key, Chain>* chains, std::vector<uint16_t>* next,
+                        Key key, uint16_t id);
+  // The first entry whose descriptor has the hash of the given one, or kNoEntry.
+  uint16_t FirstWithDescriptor(const char* descriptor) const;
+  // The first entry of the given class, or kNoEntry.
+  uint16_t FirstWithClass(mirror::Class* klass) const;
+  // Rebuild the class index after a moving collection.
+  void RelinkClasses();
+
   template <class Type>
   static Type* CreatePrimitiveTypeInstance(const std::string& descriptor)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -162,6 +182,22 @@ class RegTypeCache {
   // The actual storage for the RegTypes.
   std::vector<RegType*> entries_;
 
+  // Lookups walk the entries with a given descriptor hash or class rather than all the entries.
+  // Id 0 is the undefined type which is never linked, it ends the chains.
+  static constexpr uint16_t kNoEntry = 0;
+  std::unordered_map<uint32_t, Chain> descriptor_chains_;
+  std::unordered_map<mirror::Class*, Chain> class_chains_;
+  // The next entry in the chain of each entry, indexed by id.
+  std::vector<uint16_t> next_with_descriptor_;
+  std::vector<uint16_t> next_with_class_;
+
+  // The non primitive entries are bump allocated in chunks which are freed with the cache.
+  static constexpr size_t kEntryChunkSize = 4 * KB;
+  static constexpr size_t kEntryAlignment = 8;
+  std::vector<std::unique_ptr<uint8_t[]>> chunks_;
+  uint8_t* chunk_pos_;
+  uint8_t* chunk_end_;
+
   // A quick look up for popular small constants.
   static constexpr int32_t kMinSmallConstant = -1;
   static constexpr int32_t kMaxSmallConstant = 4;
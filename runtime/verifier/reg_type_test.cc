@@ -17,10 +17,13 @@
 #include "reg_type.h"
 
 #include <set>
+#include <string>
+#include <vector>
 
 #include "base/casts.h"
 #include "common_runtime_test.h"
 #include "reg_type_cache-inl.h"
+#include "utf.h"
 
 namespace art {
 namespace verifier {
@@ -391,6 +394,67 @@ TEST_F(RegTypeReferenceTest, UnresolvedUnintializedType) {
   EXPECT_TRUE(unresolved_unintialised.Equals(unresolved_unintialised_2));
 }
 
+// Repeated lookups of the types of the core library find the entries created for them, and
+// distinct descriptors get distinct entries.
+TEST_F(RegTypeReferenceTest, LookupIdentity) {
+  ScopedObjectAccess soa(Thread::Current());
+  RegTypeCache cache(false);
+  const DexFile* dex_file = java_lang_dex_file_;
+  const size_t num_types = std::min<size_t>(dex_file->NumTypeIds(), 8 * KB);
+  std::vector<const RegType*> types;
+  for (size_t i = 0; i < num_types; ++i) {
+    const char* descriptor = dex_file->StringByTypeIdx(i);
+    const RegType& type = cache.FromDescriptor(NULL, descriptor, false);
+    types.push_back(&type);
+  }
+  const size_t cache_size = cache.GetCacheSize();
+  for (size_t i = 0; i < num_types; ++i) {
+    const char* descriptor = dex_file->StringByTypeIdx(i);
+    const RegType& type = cache.FromDescriptor(NULL, descriptor, false);
+    ASSERT_EQ(types[i], &type) << descriptor;
+    EXPECT_EQ(types[i]->GetId(), type.GetId()) << descriptor;
+  }
+  EXPECT_EQ(cache_size, cache.GetCacheSize());
+  // The type ids of a dex file name distinct types, except for the primitive ones which may share
+  // entries with the constants of the cache.
+  size_t num_references = 0;
+  std::set<uint16_t> reference_ids;
+  for (size_t i = 0; i < num_types; ++i) {
+    if (types[i]->IsReferenceTypes()) {
+      ++num_references;
+      reference_ids.insert(types[i]->GetId());
+    }
+  }
+  EXPECT_EQ(num_references, reference_ids.size());
+}
+
+// Descriptors with the same hash are chained, the lookups still tell them apart.
+TEST_F(RegTypeReferenceTest, LookupHashCollisions) {
+  ScopedObjectAccess soa(Thread::Current());
+  RegTypeCache cache(false);
+  // "Aa" and "BB" have the same hash, so have all the concatenations of them of the same length.
+  const char* descriptors[] = { "LAaAa;", "LAaBB;", "LBBAa;", "LBBBB;" };
+  for (size_t i = 1; i < arraysize(descriptors); ++i) {
+    ASSERT_EQ(ComputeModifiedUtf8Hash(descriptors[0]), ComputeModifiedUtf8Hash(descriptors[i]));
+  }
+  std::vector<const RegType*> types;
+  for (const char* descriptor : descriptors) {
+    types.push_back(&cache.FromDescriptor(NULL, descriptor, false));
+    EXPECT_TRUE(types.back()->IsUnresolvedReference()) << descriptor;
+  }
+  const size_t cache_size = cache.GetCacheSize();
+  // Look them up in the reverse order, from the end of the chain.
+  for (size_t i = arraysize(descriptors); i != 0; --i) {
+    const RegType& type = cache.FromDescriptor(NULL, descriptors[i - 1], false);
+    EXPECT_EQ(types[i - 1], &type) << descriptors[i - 1];
+    EXPECT_EQ(std::string(descriptors[i - 1]), type.GetDescriptor());
+    for (size_t j = 0; j < i - 1; ++j) {
+      EXPECT_NE(types[j]->GetId(), type.GetId());
+    }
+  }
+  EXPECT_EQ(cache_size, cache.GetCacheSize());
+}
+
 TEST_F(RegTypeReferenceTest, Dump) {
   // Tests types for proper Dump messages.
   ScopedObjectAccess soa(Thread::Current());
@@ -23,6 +23,65 @@
 namespace art {
 namespace verifier {
 
+RegisterBlockPool::RegisterBlockPool() {
+  blocks_.emplace_back(new RegisterBlock);
+  undefined_block_ = blocks_.back().get();
+  // The undefined type has id 0, its block is never written as the pool holds a reference.
+  undefined_block_->ref_count = 1;
+  memset(undefined_block_->type_ids, 0, sizeof(undefined_block_->type_ids));
+}
+
+RegisterBlock* RegisterBlockPool::Copy(const RegisterBlock* block) {
+  RegisterBlock* copy;
+  if (!free_blocks_.empty()) {
+    copy = free_blocks_.back();
+    free_blocks_.pop_back();
+  } else {
+    blocks_.emplace_back(new RegisterBlock);
+    copy = blocks_.back().get();
+  }
+  copy->ref_count = 1;
+  memcpy(copy->type_ids, block->type_ids, sizeof(copy->type_ids));
+  return copy;
+}
+
+RegisterLine* RegisterLine::Create(size_t num_regs, MethodVerifier* verifier) {
+  const size_t num_blocks = RoundUp(num_regs, RegisterBlock::kRegistersPerBlock) >>
+      RegisterBlock::kRegistersPerBlockShift;
+  uint8_t* memory = new uint8_t[sizeof(RegisterLine) + (num_blocks * sizeof(RegisterBlock*))];
+  RegisterLine* rl = new (memory) RegisterLine(num_regs, verifier);
+  return rl;
+}
+
+RegisterLine::RegisterLine(size_t num_regs, MethodVerifier* verifier)
+    : verifier_(verifier),
+      pool_(verifier->GetRegisterBlockPool()),
+      num_regs_(num_regs) {
+  for (size_t i = 0; i < NumBlocks(); i++) {
+    blocks_[i] = pool_->UndefinedBlock();
+  }
+  SetResultTypeToUnknown();
+}
+
+RegisterLine::~RegisterLine() {
+  for (size_t i = 0; i < NumBlocks(); i++) {
+    pool_->Release(blocks_[i]);
+  }
+}
+
+void RegisterLine::CopyFromLine(const RegisterLine* src) {
+  DCHECK_EQ(num_regs_, src->num_regs_);
+  for (size_t i = 0; i < NumBlocks(); i++) {
+    if (blocks_[i] != src->blocks_[i]) {
+      RegisterBlockPool::Acquire(src->blocks_[i]);
+      pool_->Release(blocks_[i]);
+      blocks_[i] = src->blocks_[i];
+    }
+  }
+  monitors_ = src->monitors_;
+  reg_to_lock_depths_ = src->reg_to_lock_depths_;
+}
+
 bool RegisterLine::CheckConstructorReturn() const {
   for (size_t i = 0; i < num_regs_; i++) {
     if (GetRegisterType(i).IsUninitializedThisReference() ||
@@ -45,7 +104,7 @@ bool RegisterLine::SetRegisterType(uint32_t vdst, const RegType& new_type) {
     verifier_->Fail(VERIFY_ERROR_BAD_CLASS_SOFT) << "Set register to unknown type " << new_type;
     return false;
   } else {
-    line_[vdst] = new_type.GetId();
+    SetRegisterId(vdst, new_type.GetId());
   }
   // Clear the monitor entry bits for this register.
   ClearAllRegToLockDepths(vdst);
@@ -60,8 +119,8 @@ bool RegisterLine::SetRegisterTypeWide(uint32_t vdst, const RegType& new_type1,
         << new_type1 << "' '" << new_type2 << "'";
     return false;
   } else {
-    line_[vdst] = new_type1.GetId();
-    line_[vdst + 1] = new_type2.GetId();
+    SetRegisterId(vdst, new_type1.GetId());
+    SetRegisterId(vdst + 1, new_type2.GetId());
   }
   // Clear the monitor entry bits for this register.
   ClearAllRegToLockDepths(vdst);
@@ -167,7 +226,7 @@ void RegisterLine::MarkRefsAsInitialized(const RegType& uninit_type) {
   size_t changed = 0;
   for (uint32_t i = 0; i < num_regs_; i++) {
     if (GetRegisterType(i).Equals(uninit_type)) {
-      line_[i] = init_type.GetId();
+      SetRegisterId(i, init_type.GetId());
       changed++;
     }
   }
@@ -177,7 +236,7 @@ void RegisterLine::MarkRefsAsInitialized(const RegType& uninit_type) {
 void RegisterLine::MarkAllRegistersAsConflicts() {
   uint16_t conflict_type_id = verifier_->GetRegTypeCache()->Conflict().GetId();
   for (uint32_t i = 0; i < num_regs_; i++) {
-    line_[i] = conflict_type_id;
+    SetRegisterId(i, conflict_type_id);
   }
 }
 
@@ -185,7 +244,7 @@ void RegisterLine::MarkAllRegistersAsConflictsExcept(uint32_t vsrc) {
   uint16_t conflict_type_id = verifier_->GetRegTypeCache()->Conflict().GetId();
   for (uint32_t i = 0; i < num_regs_; i++) {
     if (i != vsrc) {
-      line_[i] = conflict_type_id;
+      SetRegisterId(i, conflict_type_id);
     }
   }
 }
@@ -194,7 +253,7 @@ void RegisterLine::MarkAllRegistersAsConflictsExceptWide(uint32_t vsrc) {
   uint16_t conflict_type_id = verifier_->GetRegTypeCache()->Conflict().GetId();
   for (uint32_t i = 0; i < num_regs_; i++) {
     if ((i != vsrc) && (i != (vsrc + 1))) {
-      line_[i] = conflict_type_id;
+      SetRegisterId(i, conflict_type_id);
     }
   }
 }
@@ -215,7 +274,7 @@ std::string RegisterLine::Dump() const {
 void RegisterLine::MarkUninitRefsAsInvalid(const RegType& uninit_type) {
   for (size_t i = 0; i < num_regs_; i++) {
     if (GetRegisterType(i).Equals(uninit_type)) {
-      line_[i] = verifier_->GetRegTypeCache()->Conflict().GetId();
+      SetRegisterId(i, verifier_->GetRegTypeCache()->Conflict().GetId());
       ClearAllRegToLockDepths(i);
     }
   }
@@ -461,13 +520,30 @@ bool RegisterLine::VerifyMonitorStackEmpty() const {
 bool RegisterLine::MergeRegisters(const RegisterLine* incoming_line) {
   bool changed = false;
   DCHECK(incoming_line != nullptr);
-  for (size_t idx = 0; idx < num_regs_; idx++) {
-    if (line_[idx] != incoming_line->line_[idx]) {
-      const RegType& incoming_reg_type = incoming_line->GetRegisterType(idx);
-      const RegType& cur_type = GetRegisterType(idx);
-      const RegType& new_type = cur_type.Merge(incoming_reg_type, verifier_->GetRegTypeCache());
-      changed = changed || !cur_type.Equals(new_type);
-      line_[idx] = new_type.GetId();
+  DCHECK_EQ(num_regs_, incoming_line->num_regs_);
+  for (size_t block = 0; block < NumBlocks(); block++) {
+    RegisterBlock* incoming_block = incoming_line->blocks_[block];
+    if (blocks_[block] == incoming_block) {
+      // Shared by both lines, there is nothing to merge.
+      continue;
+    }
+    const size_t begin = block << RegisterBlock::kRegistersPerBlockShift;
+    const size_t end = std::min<size_t>(begin + RegisterBlock::kRegistersPerBlock, num_regs_);
+    for (size_t idx = begin; idx < end; idx++) {
+      if (GetRegisterId(idx) != incoming_line->GetRegisterId(idx)) {
+        const RegType& incoming_reg_type = incoming_line->GetRegisterType(idx);
+        const RegType& cur_type = GetRegisterType(idx);
+        const RegType& new_type = cur_type.Merge(incoming_reg_type, verifier_->GetRegTypeCache());
+        changed = changed || !cur_type.Equals(new_type);
+        SetRegisterId(idx, new_type.GetId());
+      }
+    }
+    if (memcmp(blocks_[block]->type_ids, incoming_block->type_ids,
+               sizeof(incoming_block->type_ids)) == 0) {
+      // The merge took the incoming types, share the block again so the next merge skips it.
+      RegisterBlockPool::Acquire(incoming_block);
+      pool_->Release(blocks_[block]);
+      blocks_[block] = incoming_block;
     }
   }
 #if 0
@@ -23,6 +23,7 @@
 #include "dex_instruction.h"
 #include "reg_type.h"
 #include "safe_map.h"
+#include "utils.h"
 
 namespace art {
 namespace verifier {
@@ -45,16 +46,59 @@ enum TypeCategory {
   kTypeCategoryRef = 3,         // object reference
 };
 
+// The RegType ids of a run of consecutive registers. Register lines share the blocks they have in
+// common, a block is copied on the first write to it while it is shared.
+struct RegisterBlock {
+  static constexpr size_t kRegistersPerBlockShift = 5;
+  static constexpr size_t kRegistersPerBlock = 1 << kRegistersPerBlockShift;
+
+  uint32_t ref_count;
+  uint16_t type_ids[kRegistersPerBlock];
+};
+
+// Allocates the register blocks of a verifier and recycles the released ones.
+class RegisterBlockPool {
+ public:
+  RegisterBlockPool();
+
+  // A new reference to the block of undefined registers that new lines start with.
+  RegisterBlock* UndefinedBlock() {
+    Acquire(undefined_block_);
+    return undefined_block_;
+  }
+
+  // A new unshared copy of block.
+  RegisterBlock* Copy(const RegisterBlock* block);
+
+  static void Acquire(RegisterBlock* block) {
+    block->ref_count++;
+  }
+
+  void Release(RegisterBlock* block) {
+    DCHECK_GT(block->ref_count, 0U);
+    block->ref_count--;
+    if (block->ref_count == 0) {
+      free_blocks_.push_back(block);
+    }
+  }
+
+ private:
+  std::vector<std::unique_ptr<RegisterBlock>> blocks_;
+  std::vector<RegisterBlock*> free_blocks_;
+  // Holds a reference of the pool, it is never written to.
+  RegisterBlock* undefined_block_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegisterBlockPool);
+};
+
 // During verification, we associate one of these with every "interesting" instruction. We track
 // the status of all registers, and (if the method has any monitor-enter instructions) maintain a
 // stack of entered monitors (identified by code unit offset).
 class RegisterLine {
  public:
-  static RegisterLine* Create(size_t num_regs, MethodVerifier* verifier) {
-    uint8_t* memory = new uint8_t[sizeof(RegisterLine) + (num_regs * sizeof(uint16_t))];
-    RegisterLine* rl = new (memory) RegisterLine(num_regs, verifier);
-    return rl;
-  }
+  static RegisterLine* Create(size_t num_regs, MethodVerifier* verifier);
+
+  ~RegisterLine();
 
   // Implement category-1 "move" instructions. Copy a 32-bit value from "vsrc" to "vdst".
   void CopyRegister1(uint32_t vdst, uint32_t vsrc, TypeCategory cat)
@@ -103,17 +147,15 @@ class RegisterLine {
   bool VerifyRegisterTypeWide(uint32_t vsrc, const RegType& check_type1, const RegType& check_type2)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  void CopyFromLine(const RegisterLine* src) {
-    DCHECK_EQ(num_regs_, src->num_regs_);
-    memcpy(&line_, &src->line_, num_regs_ * sizeof(uint16_t));
-    monitors_ = src->monitors_;
-    reg_to_lock_depths_ = src->reg_to_lock_depths_;
-  }
+  // Shares the blocks of src.
+  void CopyFromLine(const RegisterLine* src);
 
   std::string Dump() const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void FillWithGarbage() {
-    memset(&line_, 0xf1, num_regs_ * sizeof(uint16_t));
+    for (size_t i = 0; i < num_regs_; i++) {
+      SetRegisterId(i, 0xf1f1);
+    }
     while (!monitors_.empty()) {
       monitors_.pop_back();
     }
@@ -158,7 +200,18 @@ class RegisterLine {
   int CompareLine(const RegisterLine* line2) const {
     DCHECK(monitors_ == line2->monitors_);
     // TODO: DCHECK(reg_to_lock_depths_ == line2->reg_to_lock_depths_);
-    return memcmp(&line_, &line2->line_, num_regs_ * sizeof(uint16_t));
+    DCHECK_EQ(num_regs_, line2->num_regs_);
+    for (size_t i = 0; i < NumBlocks(); i++) {
+      if (blocks_[i] != line2->blocks_[i]) {
+        // The registers past num_regs_ in the last block are always undefined.
+        int result = memcmp(blocks_[i]->type_ids, line2->blocks_[i]->type_ids,
+                            sizeof(blocks_[i]->type_ids));
+        if (result != 0) {
+          return result;
+        }
+      }
+    }
+    return 0;
   }
 
   size_t NumRegs() const {
@@ -292,6 +345,30 @@ class RegisterLine {
   }
 
  private:
+  size_t NumBlocks() const {
+    return RoundUp(num_regs_, RegisterBlock::kRegistersPerBlock) >>
+        RegisterBlock::kRegistersPerBlockShift;
+  }
+
+  uint16_t GetRegisterId(size_t reg) const {
+    return blocks_[reg >> RegisterBlock::kRegistersPerBlockShift]
+        ->type_ids[reg & (RegisterBlock::kRegistersPerBlock - 1)];
+  }
+
+  void SetRegisterId(size_t reg, uint16_t id) {
+    RegisterBlock*& block = blocks_[reg >> RegisterBlock::kRegistersPerBlockShift];
+    uint16_t* type_id = &block->type_ids[reg & (RegisterBlock::kRegistersPerBlock - 1)];
+    if (*type_id != id) {
+      if (block->ref_count != 1) {
+        RegisterBlock* copy = pool_->Copy(block);
+        pool_->Release(block);
+        block = copy;
+        type_id = &block->type_ids[reg & (RegisterBlock::kRegistersPerBlock - 1)];
+      }
+      *type_id = id;
+    }
+  }
+
   void CopyRegToLockDepth(size_t dst, size_t src) {
     SafeMap<uint32_t, uint32_t>::iterator it = reg_to_lock_depths_.find(src);
     if (it != reg_to_lock_depths_.end()) {
@@ -336,12 +413,7 @@ class RegisterLine {
     reg_to_lock_depths_.erase(reg);
   }
 
-  RegisterLine(size_t num_regs, MethodVerifier* verifier)
-      : verifier_(verifier),
-        num_regs_(num_regs) {
-    memset(&line_, 0, num_regs_ * sizeof(uint16_t));
-    SetResultTypeToUnknown();
-  }
+  RegisterLine(size_t num_regs, MethodVerifier* verifier);
 
   // Storage for the result register's type, valid after an invocation
   uint16_t result_[2];
@@ -349,6 +421,9 @@ class RegisterLine {
   // Back link to the verifier
   MethodVerifier* verifier_;
 
+  // The pool of the verifier that the blocks come from.
+  RegisterBlockPool* const pool_;
+
   // Length of reg_types_
   const uint32_t num_regs_;
   // A stack of monitor enter locations
@@ -358,8 +433,8 @@ class RegisterLine {
   // monitor-enter on v5 and then on v6, we expect the monitor-exit to be on v6 then on v5
   SafeMap<uint32_t, uint32_t> reg_to_lock_depths_;
 
-  // An array of RegType Ids associated with each dex register.
-  uint16_t line_[0];
+  // The blocks of RegType Ids associated with the dex registers.
+  RegisterBlock* blocks_[0];
 };
 std::ostream& operator<<(std::ostream& os, const RegisterLine& rhs);
 
@@ -0,0 +1,410 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "verifier_deps.h"
+
+#include "class_linker.h"
+#include "compiler_callbacks.h"
+#include "dex_file-inl.h"
+#include "handle_scope-inl.h"
+#include "leb128.h"
+#include "mirror/art_field-inl.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "modifiers.h"
+#include "runtime.h"
+
+namespace art {
+namespace verifier {
+
+VerifierDeps::VerifierDeps(const std::vector<const DexFile*>& dex_files)
+    : dex_files_(dex_files.begin(), dex_files.end()),
+      lock_("verifier deps lock") {
+}
+
+VerifierDeps* VerifierDeps::GetRecorder() {
+  CompilerCallbacks* callbacks = Runtime::Current()->GetCompilerCallbacks();
+  return (callbacks != nullptr) ? callbacks->GetVerifierDeps() : nullptr;
+}
+
+bool VerifierDeps::NeedsRecording(mirror::Class* klass) const {
+  while (klass->IsArrayClass()) {
+    klass = klass->GetComponentType();
+  }
+  if (klass->IsPrimitive()) {
+    return false;
+  }
+  mirror::DexCache* dex_cache = klass->GetDexCache();
+  return dex_cache == nullptr || dex_files_.find(dex_cache->GetDexFile()) == dex_files_.end();
+}
+
+uint32_t VerifierDeps::GetAccessFlags(mirror::Class* klass) {
+  return klass->GetAccessFlags() & kAccJavaFlagsMask;
+}
+
+VerifierDeps::MemberResolution VerifierDeps::GetFieldResolution(mirror::ArtField* field) {
+  if (field == nullptr) {
+    return MemberResolution(std::string(), kUnresolvedMarker);
+  }
+  return MemberResolution(field->GetDeclaringClass()->GetDescriptor(),
+                          field->GetAccessFlags() & kAccJavaFlagsMask);
+}
+
+VerifierDeps::MemberResolution VerifierDeps::GetMethodResolution(mirror::ArtMethod* method) {
+  if (method == nullptr) {
+    return MemberResolution(std::string(), kUnresolvedMarker);
+  }
+  return MemberResolution(method->GetDeclaringClass()->GetDescriptor(),
+                          method->GetAccessFlags() & kAccJavaFlagsMask);
+}
+
+void VerifierDeps::MaybeRecordClassResolution(const char* descriptor, mirror::Class* klass) {
+  VerifierDeps* deps = GetRecorder();
+  if (deps == nullptr || (klass != nullptr && !deps->NeedsRecording(klass))) {
+    return;
+  }
+  uint32_t access_flags = (klass != nullptr) ? GetAccessFlags(klass) : kUnresolvedMarker;
+  MutexLock mu(Thread::Current(), deps->lock_);
+  deps->classes_.insert(std::make_pair(std::string(descriptor), access_flags));
+}
+
+void VerifierDeps::MaybeRecordAssignability(mirror::Class* destination, mirror::Class* source,
+                                            bool is_assignable) {
+  // A class of the dex files is only assignable from classes of the dex files, through
+  // superclasses and interfaces which don't depend on the classes outside of them.
+  VerifierDeps* deps = GetRecorder();
+  if (deps == nullptr || !deps->NeedsRecording(destination)) {
+    return;
+  }
+  std::pair<std::string, std::string> key(destination->GetDescriptor(), source->GetDescriptor());
+  MutexLock mu(Thread::Current(), deps->lock_);
+  deps->assignability_.insert(std::make_pair(key, is_assignable));
+}
+
+void VerifierDeps::MaybeRecordFieldResolution(const DexFile& dex_file, uint32_t field_idx,
+                                              mirror::ArtField* field) {
+  VerifierDeps* deps = GetRecorder();
+  if (deps == nullptr || (field != nullptr && !deps->NeedsRecording(field->GetDeclaringClass()))) {
+    return;
+  }
+  const DexFile::FieldId& field_id = dex_file.GetFieldId(field_idx);
+  FieldKey key(dex_file.GetFieldDeclaringClassDescriptor(field_id),
+               dex_file.GetFieldName(field_id), dex_file.GetFieldTypeDescriptor(field_id));
+  MemberResolution resolution = GetFieldResolution(field);
+  MutexLock mu(Thread::Current(), deps->lock_);
+  deps->fields_.insert(std::make_pair(key, resolution));
+}
+
+void VerifierDeps::MaybeRecordMethodResolution(const DexFile& dex_file, uint32_t method_idx,
+                                               MethodResolutionKind kind,
+                                               mirror::ArtMethod* method) {
+  VerifierDeps* deps = GetRecorder();
+  if (deps == nullptr ||
+      (method != nullptr && !deps->NeedsRecording(method->GetDeclaringClass()))) {
+    return;
+  }
+  const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  MethodKey key(kind, dex_file.GetMethodDeclaringClassDescriptor(method_id),
+                dex_file.GetMethodName(method_id),
+                dex_file.GetMethodSignature(method_id).ToString());
+  MemberResolution resolution = GetMethodResolution(method);
+  MutexLock mu(Thread::Current(), deps->lock_);
+  deps->methods_.insert(std::make_pair(key, resolution));
+}
+
+void VerifierDeps::MergeFrom(const VerifierDeps& other) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, lock_);
+  MutexLock other_mu(self, other.lock_);
+  classes_.insert(other.classes_.begin(), other.classes_.end());
+  assignability_.insert(other.assignability_.begin(), other.assignability_.end());
+  fields_.insert(other.fields_.begin(), other.fields_.end());
+  methods_.insert(other.methods_.begin(), other.methods_.end());
+}
+
+size_t VerifierDeps::NumDependencies() const {
+  MutexLock mu(Thread::Current(), lock_);
+  return classes_.size() + assignability_.size() + fields_.size() + methods_.size();
+}
+
+// Looks the class up like the verifier, returns null if it doesn't resolve.
+static mirror::Class* FindClass(Thread* self, const std::string& descriptor,
+                                Handle<mirror::ClassLoader> class_loader)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  mirror::Class* klass =
+      Runtime::Current()->GetClassLinker()->FindClass(self, descriptor.c_str(), class_loader);
+  if (klass == nullptr) {
+    DCHECK(self->IsExceptionPending());
+    self->ClearException();
+  }
+  return klass;
+}
+
+bool VerifierDeps::Validate(Handle<mirror::ClassLoader> class_loader, Thread* self) const {
+  // Copy the dependencies, finding the classes may run code which must not hold the lock.
+  std::map<std::string, uint32_t> classes;
+  std::map<std::pair<std::string, std::string>, bool> assignability;
+  std::map<FieldKey, MemberResolution> fields;
+  std::map<MethodKey, MemberResolution> methods;
+  {
+    MutexLock mu(self, lock_);
+    classes = classes_;
+    assignability = assignability_;
+    fields = fields_;
+    methods = methods_;
+  }
+  for (const auto& entry : classes) {
+    mirror::Class* klass = FindClass(self, entry.first, class_loader);
+    uint32_t access_flags = (klass != nullptr) ? GetAccessFlags(klass) : kUnresolvedMarker;
+    if (access_flags != entry.second) {
+      VLOG(verifier) << "Verifier dependency changed: class " << entry.first;
+      return false;
+    }
+  }
+  for (const auto& entry : assignability) {
+    StackHandleScope<2> hs(self);
+    Handle<mirror::Class> destination(
+        hs.NewHandle(FindClass(self, entry.first.first, class_loader)));
+    Handle<mirror::Class> source(hs.NewHandle(FindClass(self, entry.first.second, class_loader)));
+    if (destination.Get() == nullptr || source.Get() == nullptr ||
+        destination->IsAssignableFrom(source.Get()) != entry.second) {
+      VLOG(verifier) << "Verifier dependency changed: assignability of " << entry.first.second
+                     << " to " << entry.first.first;
+      return false;
+    }
+  }
+  for (const auto& entry : fields) {
+    StackHandleScope<1> hs(self);
+    Handle<mirror::Class> klass(
+        hs.NewHandle(FindClass(self, std::get<0>(entry.first), class_loader)));
+    mirror::ArtField* field = nullptr;
+    if (klass.Get() != nullptr) {
+      field = mirror::Class::FindField(self, klass, std::get<1>(entry.first),
+                                       std::get<2>(entry.first));
+    }
+    if (GetFieldResolution(field) != entry.second) {
+      VLOG(verifier) << "Verifier dependency changed: field " << std::get<1>(entry.first)
+                     << " of " << std::get<0>(entry.first);
+      return false;
+    }
+  }
+  for (const auto& entry : methods) {
+    mirror::Class* klass = FindClass(self, std::get<1>(entry.first), class_loader);
+    mirror::ArtMethod* method = nullptr;
+    if (klass != nullptr) {
+      const std::string& name = std::get<2>(entry.first);
+      const std::string& signature = std::get<3>(entry.first);
+      // The lookups of MethodVerifier::ResolveMethodAndCheckAccess.
+      switch (std::get<0>(entry.first)) {
+        case kDirectMethodResolution:
+          method = klass->FindDirectMethod(name, signature);
+          break;
+        case kInterfaceMethodResolution:
+          method = klass->FindInterfaceMethod(name, signature);
+          break;
+        case kVirtualMethodResolution:
+          method = klass->FindVirtualMethod(name, signature);
+          break;
+        default:
+          LOG(FATAL) << "Unexpected method resolution kind " << std::get<0>(entry.first);
+      }
+      if (method == nullptr && std::get<0>(entry.first) != kDirectMethodResolution) {
+        method = klass->FindDirectMethod(name, signature);
+      }
+    }
+    if (GetMethodResolution(method) != entry.second) {
+      VLOG(verifier) << "Verifier dependency changed: method " << std::get<2>(entry.first)
+                     << std::get<3>(entry.first) << " of " << std::get<1>(entry.first);
+      return false;
+    }
+  }
+  return true;
+}
+
+static const uint8_t kMagic[] = { 'v', 'd', 'p', '\n' };
+static constexpr uint32_t kVersion = 1;
+
+void VerifierDeps::Encode(std::vector<uint8_t>* data) const {
+  MutexLock mu(Thread::Current(), lock_);
+  std::map<std::string, uint32_t> string_indexes;
+  std::vector<const std::string*> strings;
+  auto string_index = [&string_indexes, &strings](const std::string& s) {
+    auto it = string_indexes.insert(std::make_pair(s, static_cast<uint32_t>(strings.size())));
+    if (it.second) {
+      strings.push_back(&it.first->first);
+    }
+    return it.first->second;
+  };
+  Leb128EncodingVector deps;
+  deps.PushBackUnsigned(classes_.size());
+  for (const auto& entry : classes_) {
+    deps.PushBackUnsigned(string_index(entry.first));
+    deps.PushBackUnsigned(entry.second);
+  }
+  deps.PushBackUnsigned(assignability_.size());
+  for (const auto& entry : assignability_) {
+    deps.PushBackUnsigned(string_index(entry.first.first));
+    deps.PushBackUnsigned(string_index(entry.first.second));
+    deps.PushBackUnsigned(entry.second ? 1u : 0u);
+  }
+  deps.PushBackUnsigned(fields_.size());
+  for (const auto& entry : fields_) {
+    deps.PushBackUnsigned(string_index(std::get<0>(entry.first)));
+    deps.PushBackUnsigned(string_index(std::get<1>(entry.first)));
+    deps.PushBackUnsigned(string_index(std::get<2>(entry.first)));
+    deps.PushBackUnsigned(string_index(entry.second.first));
+    deps.PushBackUnsigned(entry.second.second);
+  }
+  deps.PushBackUnsigned(methods_.size());
+  for (const auto& entry : methods_) {
+    deps.PushBackUnsigned(std::get<0>(entry.first));
+    deps.PushBackUnsigned(string_index(std::get<1>(entry.first)));
+    deps.PushBackUnsigned(string_index(std::get<2>(entry.first)));
+    deps.PushBackUnsigned(string_index(std::get<3>(entry.first)));
+    deps.PushBackUnsigned(string_index(entry.second.first));
+    deps.PushBackUnsigned(entry.second.second);
+  }
+  Leb128EncodingVector header;
+  header.PushBackUnsigned(kVersion);
+  header.PushBackUnsigned(strings.size());
+  data->assign(kMagic, kMagic + sizeof(kMagic));
+  data->insert(data->end(), header.GetData().begin(), header.GetData().end());
+  for (const std::string* s : strings) {
+    Leb128EncodingVector length;
+    length.PushBackUnsigned(s->size());
+    data->insert(data->end(), length.GetData().begin(), length.GetData().end());
+    data->insert(data->end(), s->begin(), s->end());
+  }
+  data->insert(data->end(), deps.GetData().begin(), deps.GetData().end());
+}
+
+// Decodes the index of a string of the table.
+static bool DecodeString(const uint8_t** data, const uint8_t* end,
+                         const std::vector<std::string>& strings, std::string* value) {
+  uint32_t index;
+  if (!DecodeUnsignedLeb128Checked(data, end, &index) || index >= strings.size()) {
+    return false;
+  }
+  *value = strings[index];
+  return true;
+}
+
+bool VerifierDeps::Decode(const uint8_t* data, size_t size) {
+  MutexLock mu(Thread::Current(), lock_);
+  Clear();
+  const uint8_t* end = data + size;
+  if (size < sizeof(kMagic) || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+  data += sizeof(kMagic);
+  uint32_t version;
+  uint32_t num_strings;
+  if (!DecodeUnsignedLeb128Checked(&data, end, &version) || version != kVersion ||
+      !DecodeUnsignedLeb128Checked(&data, end, &num_strings)) {
+    return false;
+  }
+  std::vector<std::string> strings;
+  for (uint32_t i = 0; i < num_strings; ++i) {
+    uint32_t length;
+    if (!DecodeUnsignedLeb128Checked(&data, end, &length) ||
+        length > static_cast<size_t>(end - data)) {
+      return false;
+    }
+    strings.push_back(std::string(reinterpret_cast<const char*>(data), length));
+    data += length;
+  }
+  uint32_t count;
+  if (!DecodeUnsignedLeb128Checked(&data, end, &count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string descriptor;
+    uint32_t access_flags;
+    if (!DecodeString(&data, end, strings, &descriptor) ||
+        !DecodeUnsignedLeb128Checked(&data, end, &access_flags)) {
+      Clear();
+      return false;
+    }
+    classes_.insert(std::make_pair(descriptor, access_flags));
+  }
+  if (!DecodeUnsignedLeb128Checked(&data, end, &count)) {
+    Clear();
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    std::pair<std::string, std::string> key;
+    uint32_t is_assignable;
+    if (!DecodeString(&data, end, strings, &key.first) ||
+        !DecodeString(&data, end, strings, &key.second) ||
+        !DecodeUnsignedLeb128Checked(&data, end, &is_assignable) || is_assignable > 1u) {
+      Clear();
+      return false;
+    }
+    assignability_.insert(std::make_pair(key, is_assignable != 0u));
+  }
+  if (!DecodeUnsignedLeb128Checked(&data, end, &count)) {
+    Clear();
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    FieldKey key;
+    MemberResolution resolution;
+    if (!DecodeString(&data, end, strings, &std::get<0>(key)) ||
+        !DecodeString(&data, end, strings, &std::get<1>(key)) ||
+        !DecodeString(&data, end, strings, &std::get<2>(key)) ||
+        !DecodeString(&data, end, strings, &resolution.first) ||
+        !DecodeUnsignedLeb128Checked(&data, end, &resolution.second)) {
+      Clear();
+      return false;
+    }
+    fields_.insert(std::make_pair(key, resolution));
+  }
+  if (!DecodeUnsignedLeb128Checked(&data, end, &count)) {
+    Clear();
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    MethodKey key;
+    MemberResolution resolution;
+    if (!DecodeUnsignedLeb128Checked(&data, end, &std::get<0>(key)) ||
+        std::get<0>(key) > kInterfaceMethodResolution ||
+        !DecodeString(&data, end, strings, &std::get<1>(key)) ||
+        !DecodeString(&data, end, strings, &std::get<2>(key)) ||
+        !DecodeString(&data, end, strings, &std::get<3>(key)) ||
+        !DecodeString(&data, end, strings, &resolution.first) ||
+        !DecodeUnsignedLeb128Checked(&data, end, &resolution.second)) {
+      Clear();
+      return false;
+    }
+    methods_.insert(std::make_pair(key, resolution));
+  }
+  if (data != end) {
+    Clear();
+    return false;
+  }
+  return true;
+}
+
+void VerifierDeps::Clear() {
+  classes_.clear();
+  assignability_.clear();
+  fields_.clear();
+  methods_.clear();
+}
+
+}  // namespace verifier
+}  // namespace art
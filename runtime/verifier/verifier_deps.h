@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ART_RUNTIME_VERIFIER_VERIFIER_DEPS_H_
+#define ART_RUNTIME_VERIFIER_VERIFIER_DEPS_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "handle.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtField;
+  class ArtMethod;
+  class Class;
+  class ClassLoader;
+}  // namespace mirror
+
+class DexFile;
+class Thread;
+
+namespace verifier {
+
+// The assumptions the verification of the dex files being compiled made about the classes
+// outside of them, typically on the boot class path: which types resolve and to classes with
+// which access flags, which assignments between them are allowed, and which fields and methods
+// the verifier found. As long as they hold, verifying the same dex files again gives the same
+// results, so that a later compilation can check them instead of running the verifier.
+//
+// The verifier records them, while compiling, through the compiler callbacks. Classes are named
+// by their descriptors, which stay meaningful across compilations.
+class VerifierDeps {
+ public:
+  // How the verifier looks methods up, see MethodVerifier::ResolveMethodAndCheckAccess.
+  enum MethodResolutionKind {
+    kDirectMethodResolution,
+    kVirtualMethodResolution,
+    kInterfaceMethodResolution,
+  };
+
+  explicit VerifierDeps(const std::vector<const DexFile*>& dex_files);
+
+  // Record the outcome of resolving the type named descriptor, klass is null if it didn't
+  // resolve. The recording functions do nothing unless the dependencies are recorded.
+  static void MaybeRecordClassResolution(const char* descriptor, mirror::Class* klass)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static void MaybeRecordAssignability(mirror::Class* destination, mirror::Class* source,
+                                       bool is_assignable)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Record the field or method the verifier found for the field or method id of dex_file, which
+  // is null if it found none.
+  static void MaybeRecordFieldResolution(const DexFile& dex_file, uint32_t field_idx,
+                                         mirror::ArtField* field)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static void MaybeRecordMethodResolution(const DexFile& dex_file, uint32_t method_idx,
+                                          MethodResolutionKind kind, mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Adds the dependencies of other, which were recorded for the same dex files.
+  void MergeFrom(const VerifierDeps& other) LOCKS_EXCLUDED(lock_);
+
+  // Returns true if all the dependencies hold for the classes found through class_loader,
+  // otherwise the verification of the dex files may give different results.
+  bool Validate(Handle<mirror::ClassLoader> class_loader, Thread* self) const
+      LOCKS_EXCLUDED(lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  void Encode(std::vector<uint8_t>* data) const LOCKS_EXCLUDED(lock_);
+  // Returns false, and leaves the dependencies empty, if the data is malformed.
+  bool Decode(const uint8_t* data, size_t size) LOCKS_EXCLUDED(lock_);
+
+  size_t NumDependencies() const LOCKS_EXCLUDED(lock_);
+
+ private:
+  // The access flags recorded for a type or member that didn't resolve.
+  static constexpr uint32_t kUnresolvedMarker = static_cast<uint32_t>(-1);
+
+  // A field by the descriptor of the class it was looked up in, its name and its type, or a
+  // method by its lookup kind, the descriptor of the class, its name and its signature.
+  typedef std::tuple<std::string, std::string, std::string> FieldKey;
+  typedef std::tuple<uint32_t, std::string, std::string, std::string> MethodKey;
+  // The descriptor of the declaring class of the member found and its access flags.
+  typedef std::pair<std::string, uint32_t> MemberResolution;
+
+  // The dependencies recorded while compiling, null if they are not recorded.
+  static VerifierDeps* GetRecorder() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Whether the verification depends on the class: it is neither defined by the dex files being
+  // compiled, which are unchanged as long as the dependencies are used, nor primitive.
+  bool NeedsRecording(mirror::Class* klass) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static uint32_t GetAccessFlags(mirror::Class* klass)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static MemberResolution GetFieldResolution(mirror::ArtField* field)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static MemberResolution GetMethodResolution(mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  void Clear() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  const std::set<const DexFile*> dex_files_;
+
+  mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // The access flags of the classes by descriptor.
+  std::map<std::string, uint32_t> classes_ GUARDED_BY(lock_);
+  // Whether the class of the second descriptor is assignable to the class of the first.
+  std::map<std::pair<std::string, std::string>, bool> assignability_ GUARDED_BY(lock_);
+  std::map<FieldKey, MemberResolution> fields_ GUARDED_BY(lock_);
+  std::map<MethodKey, MemberResolution> methods_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(VerifierDeps);
+};
+
+}  // namespace verifier
+}  // namespace art
+
+#endif  // ART_RUNTIME_VERIFIER_VERIFIER_DEPS_H_
@@ -39,11 +39,19 @@ class ZipEntry {
   bool ExtractToFile(File& file, std::string* error_msg);
   MemMap* ExtractToMemMap(const char* zip_filename, const char* entry_filename,
                           std::string* error_msg);
+  // Map an uncompressed entry read only from the zip file itself, which avoids copying it to
+  // anonymous memory. Returns NULL on error, in particular if the entry is compressed.
+  MemMap* MapDirectlyFromFile(const char* zip_filename, std::string* error_msg);
   virtual ~ZipEntry();
 
   uint32_t GetUncompressedLength();
   uint32_t GetCrc32();
 
+  // Is the entry stored without compression?
+  bool IsUncompressed();
+  // Is the data of the entry at an offset of the zip file that is a multiple of alignment?
+  bool IsAlignedTo(size_t alignment);
+
  private:
   ZipEntry(ZipArchiveHandle handle,
            ::ZipEntry* zip_entry) : handle_(handle), zip_entry_(zip_entry) {}
@@ -62,4 +62,28 @@ TEST_F(ZipArchiveTest, FindAndExtract) {
   EXPECT_EQ(zip_entry->GetCrc32(), computed_crc);
 }
 
+TEST_F(ZipArchiveTest, MapDirectlyFromFile) {
+  std::string error_msg;
+  std::unique_ptr<ZipArchive> zip_archive(ZipArchive::Open(GetLibCoreDexFileName().c_str(),
+                                                           &error_msg));
+  ASSERT_TRUE(zip_archive.get() != nullptr) << error_msg;
+  std::unique_ptr<ZipEntry> zip_entry(zip_archive->Find("classes.dex", &error_msg));
+  ASSERT_TRUE(zip_entry.get() != nullptr) << error_msg;
+
+  std::unique_ptr<MemMap> mapped(zip_entry->MapDirectlyFromFile("core.jar", &error_msg));
+  if (!zip_entry->IsUncompressed()) {
+    // Compressed entries can only be extracted.
+    EXPECT_TRUE(mapped.get() == nullptr);
+    EXPECT_FALSE(error_msg.empty());
+    return;
+  }
+  ASSERT_TRUE(mapped.get() != nullptr) << error_msg;
+  EXPECT_EQ(PROT_READ, mapped->GetProtect());
+  std::unique_ptr<MemMap> extracted(zip_entry->ExtractToMemMap("core.jar", "classes.dex",
+                                                               &error_msg));
+  ASSERT_TRUE(extracted.get() != nullptr) << error_msg;
+  ASSERT_EQ(extracted->Size(), mapped->Size());
+  EXPECT_EQ(0, memcmp(extracted->Begin(), mapped->Begin(), mapped->Size()));
+}
+
 }  // namespace art
@@ -35,6 +35,14 @@ public class Main {
     test_String_indexOf();
     test_String_isEmpty();
     test_String_length();
+    test_String_equals();
+    test_String_hashCode();
+    test_Integer_numberOfLeadingZeros();
+    test_Long_numberOfLeadingZeros();
+    test_Integer_numberOfTrailingZeros();
+    test_Long_numberOfTrailingZeros();
+    test_Integer_rotateLeft();
+    test_Integer_rotateRight();
   }
 
   public static void test_String_length() {
@@ -156,6 +164,158 @@ public class Main {
     }
   }
 
+  public static void test_String_equals() {
+    String str0 = "";
+    String str1 = "x";
+    String str40 = "0123456789012345678901234567890123456789";
+    String offset = new String("xx0123456789012345678901234567890123456789yy");
+    String sub = offset.substring(2, 42);
+    String high = "\u0000\u7fff\u8000\uffff";
+    String highCopy = new String(high.toCharArray());
+    Object str40Object = str40;
+
+    Assert.assertFalse(str0.equals(null));
+    Assert.assertTrue(str0.equals(new String()));
+    Assert.assertFalse(str0.equals(str1));
+    Assert.assertFalse(str1.equals(str0));
+    Assert.assertTrue(str40.equals(sub));
+    Assert.assertTrue(sub.equals(str40));
+    Assert.assertTrue(str40Object.equals(sub));
+    // The first and the last chars differ.
+    Assert.assertFalse(str40.equals("x123456789012345678901234567890123456789"));
+    Assert.assertFalse(str40.equals("012345678901234567890123456789012345678x"));
+    // Lengths differ by one.
+    Assert.assertFalse(str40.equals(str40.substring(0, 39)));
+    Assert.assertFalse(str40.substring(0, 39).equals(str40));
+    // Chars are compared unsigned.
+    Assert.assertTrue(high.equals(highCopy));
+    Assert.assertFalse(high.equals("\u0000\u7fff\u8000\ufffe"));
+    Assert.assertFalse(high.equals("\u0000\u7fff\u7fff\uffff"));
+
+    String strNull = null;
+    try {
+      strNull.equals(str0);
+      Assert.fail();
+    } catch (NullPointerException expected) {
+    }
+  }
+
+  public static void test_String_hashCode() {
+    // Fresh strings, the first call computes the hash code and the second one reads it back.
+    String abc = new String(new char[] { 'a', 'b', 'c' });
+    Assert.assertEquals(abc.hashCode(), 96354);
+    Assert.assertEquals(abc.hashCode(), 96354);
+    String min = new String("polygenelubricants".toCharArray());
+    Assert.assertEquals(min.hashCode(), Integer.MIN_VALUE);
+    Assert.assertEquals(min.hashCode(), Integer.MIN_VALUE);
+    // A hash code of 0 is never cached, it is computed every time.
+    String empty = new String();
+    Assert.assertEquals(empty.hashCode(), 0);
+    Assert.assertEquals(empty.hashCode(), 0);
+    Assert.assertEquals("\u0000".hashCode(), 0);
+    // Substrings hash their own chars only.
+    String offset = new String("xxabcyy");
+    Assert.assertEquals(offset.substring(2, 5).hashCode(), 96354);
+
+    String strNull = null;
+    try {
+      strNull.hashCode();
+      Assert.fail();
+    } catch (NullPointerException expected) {
+    }
+  }
+
+  public static void test_Integer_numberOfLeadingZeros() {
+    Assert.assertEquals(Integer.numberOfLeadingZeros(0), Integer.SIZE);
+    Assert.assertEquals(Integer.numberOfLeadingZeros(-1), 0);
+    Assert.assertEquals(Integer.numberOfLeadingZeros(Integer.MIN_VALUE), 0);
+    Assert.assertEquals(Integer.numberOfLeadingZeros(Integer.MAX_VALUE), 1);
+    for (int i = 0; i < Integer.SIZE; i++) {
+      Assert.assertEquals(Integer.numberOfLeadingZeros(1 << i), Integer.SIZE - 1 - i);
+      Assert.assertEquals(Integer.numberOfLeadingZeros((1 << i) | 1), Integer.SIZE - 1 - i);
+      Assert.assertEquals(Integer.numberOfLeadingZeros(0xFFFFFFFF >>> i), i);
+    }
+  }
+
+  public static void test_Long_numberOfLeadingZeros() {
+    Assert.assertEquals(Long.numberOfLeadingZeros(0L), Long.SIZE);
+    Assert.assertEquals(Long.numberOfLeadingZeros(-1L), 0);
+    Assert.assertEquals(Long.numberOfLeadingZeros(Long.MIN_VALUE), 0);
+    Assert.assertEquals(Long.numberOfLeadingZeros(Long.MAX_VALUE), 1);
+    // Either word alone.
+    Assert.assertEquals(Long.numberOfLeadingZeros(0xFFFFFFFFL), 32);
+    Assert.assertEquals(Long.numberOfLeadingZeros(0x100000000L), 31);
+    for (int i = 0; i < Long.SIZE; i++) {
+      Assert.assertEquals(Long.numberOfLeadingZeros(1L << i), Long.SIZE - 1 - i);
+      Assert.assertEquals(Long.numberOfLeadingZeros((1L << i) | 1L), Long.SIZE - 1 - i);
+      Assert.assertEquals(Long.numberOfLeadingZeros(-1L >>> i), i);
+    }
+  }
+
+  public static void test_Integer_numberOfTrailingZeros() {
+    Assert.assertEquals(Integer.numberOfTrailingZeros(0), Integer.SIZE);
+    Assert.assertEquals(Integer.numberOfTrailingZeros(-1), 0);
+    Assert.assertEquals(Integer.numberOfTrailingZeros(Integer.MIN_VALUE), Integer.SIZE - 1);
+    Assert.assertEquals(Integer.numberOfTrailingZeros(Integer.MAX_VALUE), 0);
+    for (int i = 0; i < Integer.SIZE; i++) {
+      Assert.assertEquals(Integer.numberOfTrailingZeros(1 << i), i);
+      Assert.assertEquals(Integer.numberOfTrailingZeros((1 << i) | Integer.MIN_VALUE), i);
+      Assert.assertEquals(Integer.numberOfTrailingZeros(0xFFFFFFFF << i), i);
+    }
+  }
+
+  public static void test_Long_numberOfTrailingZeros() {
+    Assert.assertEquals(Long.numberOfTrailingZeros(0L), Long.SIZE);
+    Assert.assertEquals(Long.numberOfTrailingZeros(-1L), 0);
+    Assert.assertEquals(Long.numberOfTrailingZeros(Long.MIN_VALUE), Long.SIZE - 1);
+    Assert.assertEquals(Long.numberOfTrailingZeros(Long.MAX_VALUE), 0);
+    // Either word alone.
+    Assert.assertEquals(Long.numberOfTrailingZeros(0xFFFFFFFFL), 0);
+    Assert.assertEquals(Long.numberOfTrailingZeros(0x100000000L), 32);
+    for (int i = 0; i < Long.SIZE; i++) {
+      Assert.assertEquals(Long.numberOfTrailingZeros(1L << i), i);
+      Assert.assertEquals(Long.numberOfTrailingZeros((1L << i) | Long.MIN_VALUE), i);
+      Assert.assertEquals(Long.numberOfTrailingZeros(-1L << i), i);
+    }
+  }
+
+  public static void test_Integer_rotateLeft() {
+    // Constant distances, only their low 5 bits count.
+    Assert.assertEquals(Integer.rotateLeft(0x12345678, 0), 0x12345678);
+    Assert.assertEquals(Integer.rotateLeft(0x12345678, 4), 0x23456781);
+    Assert.assertEquals(Integer.rotateLeft(0x12345678, 31), 0x091A2B3C);
+    Assert.assertEquals(Integer.rotateLeft(0x12345678, 32), 0x12345678);
+    Assert.assertEquals(Integer.rotateLeft(0x12345678, -1), 0x091A2B3C);
+    Assert.assertEquals(Integer.rotateLeft(Integer.MIN_VALUE, 1), 1);
+    Assert.assertEquals(Integer.rotateLeft(-1, 17), -1);
+    Assert.assertEquals(Integer.rotateLeft(0, 17), 0);
+    // Variable distances.
+    for (int distance = -2 * Integer.SIZE; distance <= 2 * Integer.SIZE; distance++) {
+      Assert.assertEquals(Integer.rotateLeft(0x12345678, distance),
+                          (0x12345678 << distance) | (0x12345678 >>> -distance));
+      Assert.assertEquals(Integer.rotateLeft(Integer.MIN_VALUE, distance),
+                          1 << ((distance - 1) & 31));
+    }
+  }
+
+  public static void test_Integer_rotateRight() {
+    // Constant distances, only their low 5 bits count.
+    Assert.assertEquals(Integer.rotateRight(0x12345678, 0), 0x12345678);
+    Assert.assertEquals(Integer.rotateRight(0x12345678, 4), 0x81234567);
+    Assert.assertEquals(Integer.rotateRight(0x12345678, 31), 0x2468ACF0);
+    Assert.assertEquals(Integer.rotateRight(0x12345678, 32), 0x12345678);
+    Assert.assertEquals(Integer.rotateRight(0x12345678, -1), 0x2468ACF0);
+    Assert.assertEquals(Integer.rotateRight(1, 1), Integer.MIN_VALUE);
+    Assert.assertEquals(Integer.rotateRight(-1, 17), -1);
+    Assert.assertEquals(Integer.rotateRight(0, 17), 0);
+    // Variable distances.
+    for (int distance = -2 * Integer.SIZE; distance <= 2 * Integer.SIZE; distance++) {
+      Assert.assertEquals(Integer.rotateRight(0x12345678, distance),
+                          (0x12345678 >>> distance) | (0x12345678 << -distance));
+      Assert.assertEquals(Integer.rotateRight(1, distance), 1 << (-distance & 31));
+    }
+  }
+
   public static void test_String_compareTo() {
     String test = "0123456789";
     String test1 = new String("0123456789");    // different object
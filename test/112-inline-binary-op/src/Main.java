@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Calls to methods returning an arithmetic op on their arguments are replaced with the op,
+ * check that the inlined ops keep their operands and the semantics of the dex op.
+ */
+public class Main {
+    public static void main(String[] args) {
+        testIntOps();
+        testShifts();
+        testLiterals();
+        testDivisionByLiteral();
+        testFloatOps();
+        testArguments();
+        testReceiver();
+        System.out.println("passed");
+    }
+
+    static int add(int a, int b) { return a + b; }
+    static int sub(int a, int b) { return a - b; }
+    static int subSwapped(int a, int b) { return b - a; }
+    static int mul(int a, int b) { return a * b; }
+    static int and(int a, int b) { return a & b; }
+    static int or(int a, int b) { return a | b; }
+    static int xor(int a, int b) { return a ^ b; }
+    static int shl(int a, int b) { return a << b; }
+    static int shr(int a, int b) { return a >> b; }
+    static int ushr(int a, int b) { return a >>> b; }
+
+    static int addLit8(int a) { return a + 127; }
+    static int subLit8(int a) { return a - 128; }
+    static int addLit16(int a) { return a + 32767; }
+    static int subLit16(int a) { return a - 32768; }
+    static int rsubLit8(int a) { return 5 - a; }
+    static int rsubLit16(int a) { return 1000 - a; }
+    static int mulLit8(int a) { return a * -1; }
+    static int mulLit16(int a) { return a * 1000; }
+    static int andLit8(int a) { return a & -2; }
+    static int andLit16(int a) { return a & 0x7fff; }
+    static int orLit8(int a) { return a | 1; }
+    static int xorLit16(int a) { return a ^ 0x1234; }
+    static int shlLit33(int a) { return a << 33; }
+    static int shrLit31(int a) { return a >> 31; }
+    static int shrLitMinus1(int a) { return a >> -1; }
+    static int ushrLit31(int a) { return a >>> 31; }
+
+    static int divLitMinus1(int a) { return a / -1; }
+    static int remLitMinus1(int a) { return a % -1; }
+    static int divLit7(int a) { return a / 7; }
+    static int remLit7(int a) { return a % 7; }
+    static int divLit1024(int a) { return a / 1024; }
+    static int remLit1024(int a) { return a % 1024; }
+    static int divLit1000(int a) { return a / 1000; }
+    static int remLit1000(int a) { return a % 1000; }
+
+    static float addFloat(float a, float b) { return a + b; }
+    static float subFloat(float a, float b) { return a - b; }
+    static float mulFloat(float a, float b) { return a * b; }
+    static float divFloat(float a, float b) { return a / b; }
+    static float remFloat(float a, float b) { return a % b; }
+
+    static int subAfterLong(long unused, int a, int b) { return a - b; }
+    static int subAfterUnused(int unused, int a, int b) { return b - a; }
+    static float subFloatAfterInt(int unused, float a, float b) { return a - b; }
+
+    static void testIntOps() {
+        expectEquals(3, add(1, 2));
+        expectEquals(Integer.MIN_VALUE, add(Integer.MAX_VALUE, 1));
+        expectEquals(-1, sub(1, 2));
+        expectEquals(Integer.MAX_VALUE, sub(Integer.MIN_VALUE, 1));
+        expectEquals(1, subSwapped(1, 2));
+        expectEquals(Integer.MIN_VALUE, subSwapped(-1, Integer.MAX_VALUE));
+        expectEquals(0, mul(0x10000, 0x10000));
+        expectEquals(-2, mul(Integer.MAX_VALUE, 2));
+        expectEquals(Integer.MIN_VALUE, mul(Integer.MIN_VALUE, -1));
+        expectEquals(0x0f000f00, and(0x0f0f0f0f, 0xff00ff00));
+        expectEquals(0xff0fff0f, or(0x0f0f0f0f, 0xff00ff00));
+        expectEquals(0xf00ff00f, xor(0x0f0f0f0f, 0xff00ff00));
+        expectEquals(0, xor(-1, -1));
+    }
+
+    static void testShifts() {
+        // Only the low five bits of the distance are used.
+        expectEquals(Integer.MIN_VALUE, shl(1, 31));
+        expectEquals(1, shl(1, 32));
+        expectEquals(2, shl(1, 33));
+        expectEquals(Integer.MIN_VALUE, shl(1, -1));
+        expectEquals(-1, shr(Integer.MIN_VALUE, 31));
+        expectEquals(Integer.MIN_VALUE, shr(Integer.MIN_VALUE, 32));
+        expectEquals(-4, shr(-8, 33));
+        expectEquals(-1, shr(Integer.MIN_VALUE, -1));
+        expectEquals(1, ushr(Integer.MIN_VALUE, 31));
+        expectEquals(-1, ushr(-1, 32));
+        expectEquals(0x40000000, ushr(Integer.MIN_VALUE, 33));
+        expectEquals(1, ushr(-1, -1));
+        expectEquals(2, shlLit33(1));
+        expectEquals(0, shlLit33(Integer.MIN_VALUE));
+        expectEquals(-1, shrLit31(Integer.MIN_VALUE));
+        expectEquals(0, shrLit31(Integer.MAX_VALUE));
+        expectEquals(-1, shrLitMinus1(Integer.MIN_VALUE));
+        expectEquals(1, ushrLit31(Integer.MIN_VALUE));
+        expectEquals(1, ushrLit31(-1));
+    }
+
+    static void testLiterals() {
+        expectEquals(127, addLit8(0));
+        expectEquals(-2147483522, addLit8(Integer.MAX_VALUE));
+        expectEquals(-128, subLit8(0));
+        expectEquals(2147483520, subLit8(Integer.MIN_VALUE));
+        expectEquals(32768, addLit16(1));
+        expectEquals(-32768, subLit16(0));
+        expectEquals(2147450880, subLit16(Integer.MIN_VALUE));
+        expectEquals(4, rsubLit8(1));
+        expectEquals(-2147483643, rsubLit8(Integer.MIN_VALUE));
+        expectEquals(1001, rsubLit16(-1));
+        expectEquals(-7, mulLit8(7));
+        expectEquals(Integer.MIN_VALUE, mulLit8(Integer.MIN_VALUE));
+        expectEquals(1000000, mulLit16(1000));
+        expectEquals(-2, andLit8(-1));
+        expectEquals(32767, andLit16(-1));
+        expectEquals(-1, orLit8(-2));
+        expectEquals(0, xorLit16(0x1234));
+        expectEquals(-1, xorLit16(~0x1234));
+    }
+
+    static void testDivisionByLiteral() {
+        expectEquals(-7, divLitMinus1(7));
+        expectEquals(Integer.MIN_VALUE, divLitMinus1(Integer.MIN_VALUE));
+        expectEquals(0, remLitMinus1(7));
+        expectEquals(0, remLitMinus1(Integer.MIN_VALUE));
+        // Division truncates towards zero, the remainder has the sign of the dividend.
+        expectEquals(-2, divLit7(-15));
+        expectEquals(-1, remLit7(-15));
+        expectEquals(-306783378, divLit7(Integer.MIN_VALUE));
+        expectEquals(-2, remLit7(Integer.MIN_VALUE));
+        expectEquals(306783378, divLit7(Integer.MAX_VALUE));
+        expectEquals(1, remLit7(Integer.MAX_VALUE));
+        expectEquals(0, divLit1024(-1));
+        expectEquals(-1, remLit1024(-1));
+        expectEquals(-1, divLit1024(-1025));
+        expectEquals(-1, remLit1024(-1025));
+        expectEquals(-2097152, divLit1024(Integer.MIN_VALUE));
+        expectEquals(0, remLit1024(Integer.MIN_VALUE));
+        expectEquals(-1, divLit1000(-1999));
+        expectEquals(-999, remLit1000(-1999));
+        // An unused result is dropped, the op cannot throw.
+        divLit7(Integer.MIN_VALUE);
+        remLitMinus1(Integer.MIN_VALUE);
+    }
+
+    static void testFloatOps() {
+        expectEquals(0.75f, addFloat(0.5f, 0.25f));
+        expectEquals(0.0f, addFloat(-0.0f, 0.0f));
+        expectEquals(-0.0f, addFloat(-0.0f, -0.0f));
+        expectEquals(-2.0f, subFloat(1.0f, 3.0f));
+        expectEquals(0.0f, subFloat(0.0f, 0.0f));
+        expectEquals(-0.0f, mulFloat(-1.0f, 0.0f));
+        expectEquals(Float.POSITIVE_INFINITY, mulFloat(Float.MAX_VALUE, 2.0f));
+        expectEquals(1.0f / 3.0f, divFloat(1.0f, 3.0f));
+        expectEquals(Float.POSITIVE_INFINITY, divFloat(1.0f, 0.0f));
+        expectEquals(Float.NEGATIVE_INFINITY, divFloat(-1.0f, 0.0f));
+        expectEquals(Float.NaN, divFloat(0.0f, 0.0f));
+        expectEquals(1.5f, remFloat(7.5f, 2.0f));
+        expectEquals(-1.5f, remFloat(-7.5f, 2.0f));
+        expectEquals(Float.NaN, remFloat(1.0f, 0.0f));
+        expectEquals(Float.NaN, remFloat(Float.POSITIVE_INFINITY, 1.0f));
+    }
+
+    static void testArguments() {
+        // The operands are picked from the arguments of the invoke, wide ones take two registers.
+        expectEquals(7, subAfterLong(1L << 40, 10, 3));
+        expectEquals(-7, subAfterUnused(Integer.MAX_VALUE, 10, 3));
+        expectEquals(7.0f, subFloatAfterInt(-1, 10.0f, 3.0f));
+    }
+
+    static void testReceiver() {
+        Ops ops = new Ops();
+        expectEquals(-1, ops.sub(1, 2));
+        expectEquals(11, ops.callRsub(-1));
+        // The inlined calls keep the null check of the receiver.
+        Ops nullOps = null;
+        try {
+            expectEquals(-1, nullOps.sub(1, 2));
+            throw new Error("Expected NullPointerException");
+        } catch (NullPointerException expected) {
+        }
+        try {
+            nullOps.sub(1, 2);
+            throw new Error("Expected NullPointerException");
+        } catch (NullPointerException expected) {
+        }
+    }
+
+    static void expectEquals(int expected, int result) {
+        if (expected != result) {
+            throw new Error("Expected: " + expected + ", found: " + result);
+        }
+    }
+
+    static void expectEquals(float expected, float result) {
+        if (Float.floatToIntBits(expected) != Float.floatToIntBits(result)) {
+            throw new Error("Expected: " + expected + ", found: " + result);
+        }
+    }
+}
+
+class Ops {
+    final int sub(int a, int b) { return a - b; }
+
+    private int rsub(int a) { return 10 - a; }
+
+    int callRsub(int a) { return rsub(a); }
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Loaded after the code calling Base was compiled, the inlined calls must dispatch here.
+ */
+public class OverridingBase extends Base {
+    public int getValue() {
+        return -value;
+    }
+
+    public void setValue(int value) {
+        this.value = value * 2;
+    }
+
+    public int getKind() {
+        return 2;
+    }
+
+    public int add(int a, int b) {
+        return a - b;
+    }
+}
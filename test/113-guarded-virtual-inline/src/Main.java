@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+import java.lang.reflect.Constructor;
+
+/**
+ * Virtual calls to methods without overrides in the compiled dex files have the callee's body
+ * inlined behind a check of the dispatched method. Load a class overriding them at run time
+ * and check that the calls reach the overrides.
+ */
+public class Main {
+    private static final String CLASS_PATH =
+        System.getenv("DEX_LOCATION") + "/113-guarded-virtual-inline-ex.jar";
+
+    public static void main(String[] args) throws Exception {
+        Base base = new Base();
+        Base derived = new Derived();
+        testBase(base);
+        testBase(derived);
+        testNull();
+
+        Base override = (Base) getDexClassLoader().loadClass("OverridingBase").newInstance();
+        testOverride(override);
+        // The call sites keep inlining for the classes which don't override the methods.
+        testBase(base);
+        testBase(derived);
+        System.out.println("passed");
+    }
+
+    static int getValue(Base b) {
+        return b.getValue();
+    }
+
+    static void setValue(Base b, int value) {
+        b.setValue(value);
+    }
+
+    static int getKind(Base b) {
+        return b.getKind();
+    }
+
+    static int add(Base b, int x, int y) {
+        return b.add(x, y);
+    }
+
+    static void testBase(Base b) {
+        setValue(b, 42);
+        expectEquals(42, getValue(b));
+        setValue(b, Integer.MIN_VALUE);
+        expectEquals(Integer.MIN_VALUE, getValue(b));
+        expectEquals(1, getKind(b));
+        expectEquals(5, add(b, 2, 3));
+        // Unused results.
+        b.getValue();
+        b.getKind();
+    }
+
+    static void testOverride(Base b) {
+        setValue(b, 42);
+        expectEquals(-84, getValue(b));
+        expectEquals(2, getKind(b));
+        expectEquals(-1, add(b, 2, 3));
+    }
+
+    static void testNull() {
+        try {
+            getValue(null);
+            throw new Error("Expected NullPointerException");
+        } catch (NullPointerException expected) {
+        }
+        try {
+            setValue(null, 1);
+            throw new Error("Expected NullPointerException");
+        } catch (NullPointerException expected) {
+        }
+        try {
+            getKind(null);
+            throw new Error("Expected NullPointerException");
+        } catch (NullPointerException expected) {
+        }
+        try {
+            add(null, 1, 2);
+            throw new Error("Expected NullPointerException");
+        } catch (NullPointerException expected) {
+        }
+    }
+
+    /*
+     * Create an instance of DexClassLoader.  The test harness doesn't
+     * have visibility into dalvik.system.*, so we do this through
+     * reflection.
+     */
+    private static ClassLoader getDexClassLoader() throws Exception {
+        ClassLoader classLoader = Main.class.getClassLoader();
+        Class DexClassLoader = classLoader.loadClass("dalvik.system.DexClassLoader");
+        Constructor DexClassLoader_init = DexClassLoader.getConstructor(String.class,
+                                                                        String.class,
+                                                                        String.class,
+                                                                        ClassLoader.class);
+        return (ClassLoader) DexClassLoader_init.newInstance(CLASS_PATH,
+                                                             System.getenv("DEX_LOCATION"),
+                                                             null,
+                                                             classLoader);
+    }
+
+    static void expectEquals(int expected, int result) {
+        if (expected != result) {
+            throw new Error("Expected: " + expected + ", found: " + result);
+        }
+    }
+}
+
+class Derived extends Base {
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+import java.util.Arrays;
+
+/**
+ * System.arraycopy is inlined for distinct arrays of the same class, every other case goes to
+ * the native method. Check the copies of each component size, the bounds and the exceptions.
+ */
+public class Main {
+    public static void main(String[] args) {
+        testPrimitiveArrays();
+        testObjectArrays();
+        testBounds();
+        testExceptions();
+        testOverlapping();
+        testCardMark();
+        System.out.println("passed");
+    }
+
+    static void testPrimitiveArrays() {
+        byte[] bytes = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+        byte[] byteCopy = new byte[9];
+        System.arraycopy(bytes, 1, byteCopy, 2, 7);
+        expectEquals("[0, 0, 2, 3, 4, 5, 6, 7, 8]", Arrays.toString(byteCopy));
+
+        boolean[] booleans = { true, false, true, true };
+        boolean[] booleanCopy = new boolean[4];
+        System.arraycopy(booleans, 0, booleanCopy, 1, 3);
+        expectEquals("[false, true, false, true]", Arrays.toString(booleanCopy));
+
+        char[] chars = { 'a', 'b', 'c', '\uffff' };
+        char[] charCopy = new char[5];
+        System.arraycopy(chars, 1, charCopy, 1, 3);
+        expectEquals("\0bc\uffff\0", new String(charCopy));
+
+        short[] shorts = { Short.MIN_VALUE, -1, 0, Short.MAX_VALUE };
+        short[] shortCopy = new short[4];
+        System.arraycopy(shorts, 0, shortCopy, 0, 4);
+        expectEquals("[-32768, -1, 0, 32767]", Arrays.toString(shortCopy));
+
+        int[] ints = { Integer.MIN_VALUE, -1, 0, 1, Integer.MAX_VALUE };
+        int[] intCopy = new int[5];
+        System.arraycopy(ints, 3, intCopy, 0, 2);
+        expectEquals("[1, 2147483647, 0, 0, 0]", Arrays.toString(intCopy));
+
+        float[] floats = { 0.5f, -0.0f, Float.NaN, Float.POSITIVE_INFINITY };
+        float[] floatCopy = new float[4];
+        System.arraycopy(floats, 0, floatCopy, 0, 4);
+        expectEquals("[0.5, -0.0, NaN, Infinity]", Arrays.toString(floatCopy));
+
+        // The data of wide arrays starts at a different offset.
+        long[] longs = { Long.MIN_VALUE, -1L, 0x123456789abcdefL, Long.MAX_VALUE };
+        long[] longCopy = new long[5];
+        System.arraycopy(longs, 1, longCopy, 2, 3);
+        expectEquals("[0, 0, -1, 81985529216486895, 9223372036854775807]",
+                     Arrays.toString(longCopy));
+
+        double[] doubles = { 0.25, -0.0, Double.NaN, Double.NEGATIVE_INFINITY };
+        double[] doubleCopy = new double[4];
+        System.arraycopy(doubles, 2, doubleCopy, 0, 2);
+        expectEquals("[NaN, -Infinity, 0.0, 0.0]", Arrays.toString(doubleCopy));
+
+        // A single element and a large copy.
+        int[] large = new int[10000];
+        for (int i = 0; i < large.length; ++i) {
+            large[i] = i;
+        }
+        int[] largeCopy = new int[10001];
+        System.arraycopy(large, 0, largeCopy, 1, large.length);
+        for (int i = 0; i < large.length; ++i) {
+            expectEquals(i, largeCopy[i + 1]);
+        }
+        System.arraycopy(large, 9999, largeCopy, 0, 1);
+        expectEquals(9999, largeCopy[0]);
+    }
+
+    static void testObjectArrays() {
+        String[] strings = { "a", null, "c" };
+        String[] stringCopy = new String[4];
+        System.arraycopy(strings, 0, stringCopy, 1, 3);
+        expectEquals("[null, a, null, c]", Arrays.toString(stringCopy));
+
+        int[][] arrays = { { 1 }, { 2, 3 } };
+        int[][] arrayCopy = new int[2][];
+        System.arraycopy(arrays, 0, arrayCopy, 0, 2);
+        expectEquals("[[1], [2, 3]]", Arrays.deepToString(arrayCopy));
+
+        // Different classes of arrays go to the native method, with a store check if needed.
+        Object[] objects = { "x", "y" };
+        String[] stringsFromObjects = new String[2];
+        System.arraycopy(objects, 0, stringsFromObjects, 0, 2);
+        expectEquals("[x, y]", Arrays.toString(stringsFromObjects));
+        Object[] objectsFromStrings = new Object[3];
+        System.arraycopy(strings, 0, objectsFromStrings, 0, 3);
+        expectEquals("[a, null, c]", Arrays.toString(objectsFromStrings));
+    }
+
+    static void testBounds() {
+        int[] src = { 1, 2, 3, 4 };
+        int[] dst = new int[4];
+        // Empty copies at the ends are allowed.
+        System.arraycopy(src, 4, dst, 4, 0);
+        System.arraycopy(src, 0, dst, 0, 0);
+        expectEquals("[0, 0, 0, 0]", Arrays.toString(dst));
+        System.arraycopy(src, 0, dst, 0, 4);
+        expectEquals("[1, 2, 3, 4]", Arrays.toString(dst));
+        dst = new int[4];
+        System.arraycopy(src, 3, dst, 3, 1);
+        expectEquals("[0, 0, 0, 4]", Arrays.toString(dst));
+
+        expectOutOfBounds(src, 5, dst, 0, 0);
+        expectOutOfBounds(src, 0, dst, 5, 0);
+        expectOutOfBounds(src, 1, dst, 0, 4);
+        expectOutOfBounds(src, 0, dst, 1, 4);
+        expectOutOfBounds(src, -1, dst, 0, 1);
+        expectOutOfBounds(src, 0, dst, -1, 1);
+        expectOutOfBounds(src, 0, dst, 0, -1);
+        expectOutOfBounds(src, Integer.MIN_VALUE, dst, 0, 1);
+        // The sums of positions and length overflow.
+        expectOutOfBounds(src, 1, dst, 0, Integer.MAX_VALUE);
+        expectOutOfBounds(src, Integer.MAX_VALUE, dst, 0, 1);
+        expectOutOfBounds(src, 0, dst, Integer.MAX_VALUE, 1);
+        // Nothing is copied when a check fails.
+        expectEquals("[0, 0, 0, 4]", Arrays.toString(dst));
+    }
+
+    static void testExceptions() {
+        int[] ints = new int[4];
+        try {
+            System.arraycopy(null, 0, ints, 0, 1);
+            throw new Error("Expected NullPointerException");
+        } catch (NullPointerException expected) {
+        }
+        try {
+            System.arraycopy(ints, 0, null, 0, 1);
+            throw new Error("Expected NullPointerException");
+        } catch (NullPointerException expected) {
+        }
+        expectArrayStore(ints, new long[4]);
+        expectArrayStore(new byte[4], new boolean[4]);
+        expectArrayStore(ints, new Object[4]);
+        expectArrayStore(new Object[4], ints);
+        expectArrayStore(ints, "not an array");
+        expectArrayStore(new Object(), ints);
+
+        // The elements before the first one failing the store check are copied.
+        Object[] objects = { "a", "b", Integer.valueOf(1), "d" };
+        String[] strings = new String[4];
+        expectArrayStore(objects, strings);
+        expectEquals("[a, b, null, null]", Arrays.toString(strings));
+    }
+
+    static void testOverlapping() {
+        int[] forward = { 0, 1, 2, 3, 4, 5, 6, 7 };
+        System.arraycopy(forward, 0, forward, 1, 7);
+        expectEquals("[0, 0, 1, 2, 3, 4, 5, 6]", Arrays.toString(forward));
+        int[] backward = { 0, 1, 2, 3, 4, 5, 6, 7 };
+        System.arraycopy(backward, 1, backward, 0, 7);
+        expectEquals("[1, 2, 3, 4, 5, 6, 7, 7]", Arrays.toString(backward));
+        long[] longs = { 0L, 1L, 2L, 3L };
+        System.arraycopy(longs, 0, longs, 2, 2);
+        expectEquals("[0, 1, 0, 1]", Arrays.toString(longs));
+        String[] strings = { "a", "b", "c" };
+        System.arraycopy(strings, 1, strings, 0, 2);
+        expectEquals("[b, c, c]", Arrays.toString(strings));
+        // A copy onto itself leaves the array unchanged.
+        char[] chars = { 'x', 'y', 'z' };
+        System.arraycopy(chars, 0, chars, 0, 3);
+        expectEquals("xyz", new String(chars));
+    }
+
+    static String[] old = new String[64];
+
+    static void testCardMark() {
+        // Let the destination get old, then store young objects in it with the copy only.
+        Runtime.getRuntime().gc();
+        Runtime.getRuntime().gc();
+        String[] young = new String[old.length];
+        for (int i = 0; i < young.length; ++i) {
+            young[i] = Integer.toString(i);
+        }
+        System.arraycopy(young, 0, old, 0, young.length);
+        young = null;
+        Runtime.getRuntime().gc();
+        for (int i = 0; i < old.length; ++i) {
+            expectEquals(Integer.toString(i), old[i]);
+        }
+    }
+
+    static void expectOutOfBounds(int[] src, int srcPos, int[] dst, int dstPos, int length) {
+        try {
+            System.arraycopy(src, srcPos, dst, dstPos, length);
+            throw new Error("Expected ArrayIndexOutOfBoundsException");
+        } catch (ArrayIndexOutOfBoundsException expected) {
+        }
+    }
+
+    static void expectArrayStore(Object src, Object dst) {
+        try {
+            System.arraycopy(src, 0, dst, 0, 4);
+            throw new Error("Expected ArrayStoreException");
+        } catch (ArrayStoreException expected) {
+        }
+    }
+
+    static void expectEquals(int expected, int result) {
+        if (expected != result) {
+            throw new Error("Expected: " + expected + ", found: " + result);
+        }
+    }
+
+    static void expectEquals(String expected, String result) {
+        if (!expected.equals(result)) {
+            throw new Error("Expected: " + expected + ", found: " + result);
+        }
+    }
+}
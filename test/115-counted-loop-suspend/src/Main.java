@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * The suspend checks of counted loops running at most about 4096 dex instructions are left
+ * out. Check the results of loops on both sides of that limit and of loops whose induction
+ * variable could overflow, then check that a thread running short loops still gets suspended.
+ */
+public class Main {
+    public static void main(String[] args) {
+        testUpwards();
+        testDownwards();
+        testStrides();
+        testNearOverflow();
+        testSuspend();
+        System.out.println("passed");
+    }
+
+    static int sumBelow800() {
+        int sum = 0;
+        for (int i = 0; i < 800; i++) {
+            sum += i;
+        }
+        return sum;
+    }
+
+    static int sumBelow1000() {
+        int sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            sum += i;
+        }
+        return sum;
+    }
+
+    static int sumUpTo4095() {
+        int sum = 0;
+        for (int i = 0; i <= 4095; i++) {
+            sum += i;
+        }
+        return sum;
+    }
+
+    static int sumBelow100000() {
+        int sum = 0;
+        for (int i = 0; i < 100000; i++) {
+            sum += i;
+        }
+        return sum;
+    }
+
+    static int sumBelow800Swapped() {
+        int sum = 0;
+        for (int i = 0; 800 > i; i++) {
+            sum += i;
+        }
+        return sum;
+    }
+
+    static int sumBelow500DoWhile() {
+        int sum = 0;
+        int i = 0;
+        do {
+            sum += i;
+            i++;
+        } while (i < 500);
+        return sum;
+    }
+
+    static int sumDownFrom1000() {
+        int sum = 0;
+        for (int i = 1000; i > 0; i--) {
+            sum += i;
+        }
+        return sum;
+    }
+
+    static int sumDownFrom999ToZero() {
+        int sum = 0;
+        for (int i = 999; i >= 0; i--) {
+            sum += i;
+        }
+        return sum;
+    }
+
+    static int countStride3() {
+        int count = 0;
+        for (int i = 0; i < 1000; i += 3) {
+            count++;
+        }
+        return count;
+    }
+
+    static int countStrideMinus7() {
+        int count = 0;
+        for (int i = 100; i >= -100; i -= 7) {
+            count++;
+        }
+        return count;
+    }
+
+    static int countStride1000() {
+        int count = 0;
+        for (int i = -32000; i < 32000; i += 1000) {
+            count++;
+        }
+        return count;
+    }
+
+    static int countBelowMax() {
+        int count = 0;
+        for (int i = Integer.MAX_VALUE - 100; i < Integer.MAX_VALUE; i++) {
+            count++;
+        }
+        return count;
+    }
+
+    static int countAboveMin() {
+        int count = 0;
+        for (int i = Integer.MIN_VALUE + 100; i > Integer.MIN_VALUE; i--) {
+            count++;
+        }
+        return count;
+    }
+
+    static int countStride2AtMax() {
+        int count = 0;
+        for (int i = Integer.MAX_VALUE - 2; i <= Integer.MAX_VALUE - 1; i += 2) {
+            count++;
+        }
+        return count;
+    }
+
+    static int countUntilOverflowUp() {
+        int count = 0;
+        int i = Integer.MAX_VALUE - 5;
+        do {
+            count++;
+            i += 2;
+        } while (i > 0);
+        return count;
+    }
+
+    static int countUntilOverflowDown() {
+        int count = 0;
+        for (int i = Integer.MIN_VALUE + 5; i < 0; i -= 2) {
+            count++;
+        }
+        return count;
+    }
+
+    static void testUpwards() {
+        expectEquals(800 * 799 / 2, sumBelow800());
+        expectEquals(1000 * 999 / 2, sumBelow1000());
+        expectEquals(4096 * 4095 / 2, sumUpTo4095());
+        expectEquals((int) (100000L * 99999L / 2), sumBelow100000());
+        expectEquals(800 * 799 / 2, sumBelow800Swapped());
+        expectEquals(500 * 499 / 2, sumBelow500DoWhile());
+    }
+
+    static void testDownwards() {
+        expectEquals(1000 * 1001 / 2, sumDownFrom1000());
+        expectEquals(1000 * 999 / 2, sumDownFrom999ToZero());
+    }
+
+    static void testStrides() {
+        expectEquals(334, countStride3());
+        expectEquals(29, countStrideMinus7());
+        expectEquals(64, countStride1000());
+    }
+
+    static void testNearOverflow() {
+        expectEquals(100, countBelowMax());
+        expectEquals(100, countAboveMin());
+        // These induction variables reach the end of the range or wrap around.
+        expectEquals(1, countStride2AtMax());
+        expectEquals(3, countUntilOverflowUp());
+        expectEquals(3, countUntilOverflowDown());
+    }
+
+    static void testSuspend() {
+        ShortLoops loops = new ShortLoops();
+        loops.start();
+        // Each collection suspends the thread, at a check outside its short loops.
+        for (int i = 0; i < 10; i++) {
+            Runtime.getRuntime().gc();
+            sleep(100);
+        }
+        loops.stopNow();
+        try {
+            loops.join();
+        } catch (InterruptedException ie) {
+            System.err.println("join was interrupted");
+        }
+        expectEquals(1000 * 999 / 2, loops.sum);
+    }
+
+    public static void sleep(int ms) {
+        try {
+            Thread.sleep(ms);
+        } catch (InterruptedException ie) {
+            System.err.println("sleep was interrupted");
+        }
+    }
+
+    static void expectEquals(int expected, int result) {
+        if (expected != result) {
+            throw new Error("Expected: " + expected + ", found: " + result);
+        }
+    }
+}
+
+class ShortLoops extends Thread {
+    volatile private boolean keepGoing = true;
+    int sum;
+
+    public void run() {
+        do {
+            int s = 0;
+            for (int i = 0; i < 1000; i++) {
+                s += i;
+            }
+            sum = s;
+        } while (keepGoing);
+    }
+
+    public void stopNow() {
+        keepGoing = false;
+    }
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+import java.util.ArrayList;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * Compiled code allocates new-instance objects from the TLAB of the thread inline, classes
+ * which aren't initialized or are finalizable go to the entrypoints.
+ */
+public class Main {
+    private static final int NUM_OBJECTS = 100000;
+    private static final int NUM_THREADS = 4;
+
+    static int initializations;
+
+    public static void main(String[] args) throws Exception {
+        testZeroedFields();
+        testUninitializedClass();
+        testFinalizable();
+        testThreads();
+        testMemory();
+        System.out.println("passed");
+    }
+
+    static void testZeroedFields() {
+        // Enough objects to fill many TLABs, with the discarded ones written before.
+        Fields[] kept = new Fields[NUM_OBJECTS / 16];
+        for (int i = 0; i < NUM_OBJECTS; i++) {
+            Fields f = new Fields();
+            f.check();
+            f.fill(i);
+            if (i % 16 == 0) {
+                kept[i / 16] = f;
+            }
+            Small s = new Small();
+            expectEquals(0, s.value);
+            s.value = -1;
+        }
+        Runtime.getRuntime().gc();
+        for (int i = 0; i < kept.length; i++) {
+            kept[i].checkFilled(i * 16);
+        }
+    }
+
+    static void testUninitializedClass() {
+        expectEquals(0, initializations);
+        Initialized first = new Initialized();
+        Initialized second = new Initialized();
+        expectEquals(1, initializations);
+        expectEquals(42, first.value);
+        expectEquals(42, second.value);
+    }
+
+    static void allocateFinalizable() {
+        for (int i = 0; i < 1000; i++) {
+            Finalizable f = new Finalizable();
+            expectEquals(0, f.value);
+        }
+    }
+
+    static void testFinalizable() {
+        allocateFinalizable();
+        Runtime.getRuntime().gc();
+        System.runFinalization();
+        if (Finalizable.finalized.get() == 0) {
+            throw new Error("No object was finalized");
+        }
+    }
+
+    static void testThreads() throws Exception {
+        Thread[] threads = new Thread[NUM_THREADS];
+        for (int i = 0; i < NUM_THREADS; i++) {
+            final int seed = i * NUM_OBJECTS;
+            threads[i] = new Thread() {
+                public void run() {
+                    ArrayList<Fields> kept = new ArrayList<Fields>();
+                    for (int j = 0; j < NUM_OBJECTS; j++) {
+                        Fields f = new Fields();
+                        f.check();
+                        f.fill(seed + j);
+                        if (j % 100 == 0) {
+                            kept.add(f);
+                        }
+                    }
+                    for (int j = 0; j < kept.size(); j++) {
+                        kept.get(j).checkFilled(seed + j * 100);
+                    }
+                }
+            };
+            threads[i].start();
+        }
+        for (Thread thread : threads) {
+            thread.join();
+        }
+    }
+
+    static Small[] keepSmall(int count) {
+        Small[] smalls = new Small[count];
+        for (int i = 0; i < count; i++) {
+            smalls[i] = new Small();
+        }
+        return smalls;
+    }
+
+    static void testMemory() {
+        Runtime runtime = Runtime.getRuntime();
+        runtime.gc();
+        long usedBefore = checkedUsedMemory(runtime);
+        Small[] smalls = keepSmall(NUM_OBJECTS);
+        long usedAfterAllocation = checkedUsedMemory(runtime);
+        if (usedAfterAllocation <= usedBefore) {
+            throw new Error("Allocations not counted: " + usedBefore + " " + usedAfterAllocation);
+        }
+        expectEquals(0, smalls[NUM_OBJECTS - 1].value);
+        smalls = null;
+        // The unused parts of the TLABs are given back as well.
+        runtime.gc();
+        long usedAfterGc = checkedUsedMemory(runtime);
+        if (usedAfterGc >= usedAfterAllocation) {
+            throw new Error("Memory not freed: " + usedAfterAllocation + " " + usedAfterGc);
+        }
+    }
+
+    static long checkedUsedMemory(Runtime runtime) {
+        long free = runtime.freeMemory();
+        long total = runtime.totalMemory();
+        long max = runtime.maxMemory();
+        if (free < 0 || free > total || total > max) {
+            throw new Error("Bad memory counts: " + free + " " + total + " " + max);
+        }
+        return total - free;
+    }
+
+    static void expectEquals(int expected, int result) {
+        if (expected != result) {
+            throw new Error("Expected: " + expected + ", found: " + result);
+        }
+    }
+
+    static void expectEquals(long expected, long result) {
+        if (expected != result) {
+            throw new Error("Expected: " + expected + ", found: " + result);
+        }
+    }
+}
+
+class Small {
+    int value;
+}
+
+class Fields {
+    boolean z;
+    byte b;
+    char c;
+    short s;
+    int i;
+    long j;
+    float f;
+    double d;
+    Object l;
+
+    void check() {
+        if (z || b != 0 || c != 0 || s != 0 || i != 0 || j != 0L || f != 0.0f || d != 0.0 ||
+            l != null) {
+            throw new Error("Fields of a new object not zeroed");
+        }
+    }
+
+    void fill(int seed) {
+        z = true;
+        b = (byte) seed;
+        c = (char) seed;
+        s = (short) seed;
+        i = seed;
+        j = ((long) seed << 32) | seed;
+        f = seed;
+        d = seed;
+        l = this;
+    }
+
+    void checkFilled(int seed) {
+        Main.expectEquals(seed, i);
+        Main.expectEquals(((long) seed << 32) | seed, j);
+        Main.expectEquals((byte) seed, b);
+        Main.expectEquals((short) seed, s);
+        Main.expectEquals((char) seed, c);
+        if (!z || f != (float) seed || d != (double) seed || l != this) {
+            throw new Error("Fields of an old object changed");
+        }
+    }
+}
+
+class Initialized {
+    int value = 42;
+
+    static {
+        Main.initializations++;
+    }
+}
+
+class Finalizable {
+    static AtomicInteger finalized = new AtomicInteger();
+    int value;
+
+    protected void finalize() {
+        finalized.incrementAndGet();
+    }
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * instance-of and check-cast against a class which is neither an interface nor an array walk
+ * the superclass chain inline, the other targets still call the helpers.
+ */
+public class Main {
+    public static void main(String[] args) {
+        testInstanceOf();
+        testCheckCast();
+        testFinalTarget();
+        testInterfaceTarget();
+        testArrayTarget();
+        testUnloadedTarget();
+        System.out.println("passed");
+    }
+
+    static boolean isA(Object o) { return o instanceof A; }
+    static boolean isB(Object o) { return o instanceof B; }
+    static boolean isF(Object o) { return o instanceof F; }
+    static boolean isObject(Object o) { return o instanceof Object; }
+    static boolean isFinalB(Object o) { return o instanceof FinalB; }
+    static boolean isI(Object o) { return o instanceof I; }
+    static boolean isArrayOfA(Object o) { return o instanceof A[]; }
+    static boolean isLonely(Object o) { return o instanceof Lonely; }
+
+    static B castB(Object o) { return (B) o; }
+    static F castF(Object o) { return (F) o; }
+    static FinalB castFinalB(Object o) { return (FinalB) o; }
+    static I castI(Object o) { return (I) o; }
+    static A[] castArrayOfA(Object o) { return (A[]) o; }
+
+    static void testInstanceOf() {
+        expectEquals(false, isB(null));
+        expectEquals(true, isB(new B()));
+        expectEquals(false, isB(new A()));
+        expectEquals(true, isB(new C()));
+        // The deepest class, its chain has seven classes with Object.
+        expectEquals(true, isB(new F()));
+        expectEquals(true, isA(new F()));
+        expectEquals(true, isF(new F()));
+        expectEquals(false, isF(new E()));
+        // A sibling shares the superclass only.
+        expectEquals(false, isB(new SiblingB()));
+        expectEquals(true, isA(new SiblingB()));
+        expectEquals(false, isB("B"));
+        expectEquals(false, isB(new B[1]));
+        expectEquals(false, isA(new Object()));
+        expectEquals(false, isObject(null));
+        expectEquals(true, isObject(new Object()));
+        expectEquals(true, isObject(new F()));
+        expectEquals(true, isObject(new int[1]));
+    }
+
+    static void testCheckCast() {
+        expectEquals(true, castB(null) == null);
+        B b = new B();
+        expectEquals(true, castB(b) == b);
+        F f = new F();
+        expectEquals(true, castB(f) == f);
+        expectEquals(true, castF(f) == f);
+        expectClassCast(new A());
+        expectClassCast(new SiblingB());
+        expectClassCast("B");
+        expectClassCast(new Object());
+        expectClassCast(new B[1]);
+        try {
+            castF(new E());
+            throw new Error("Expected ClassCastException");
+        } catch (ClassCastException expected) {
+        }
+    }
+
+    static void testFinalTarget() {
+        expectEquals(true, isFinalB(new FinalB()));
+        expectEquals(false, isFinalB(new B()));
+        expectEquals(false, isFinalB(null));
+        FinalB finalB = new FinalB();
+        expectEquals(true, castFinalB(finalB) == finalB);
+        try {
+            castFinalB(new B());
+            throw new Error("Expected ClassCastException");
+        } catch (ClassCastException expected) {
+        }
+    }
+
+    static void testInterfaceTarget() {
+        expectEquals(true, isI(new C()));
+        expectEquals(true, isI(new F()));
+        expectEquals(false, isI(new B()));
+        expectEquals(false, isI(null));
+        F f = new F();
+        expectEquals(true, castI(f) == f);
+        try {
+            castI(new B());
+            throw new Error("Expected ClassCastException");
+        } catch (ClassCastException expected) {
+        }
+    }
+
+    static void testArrayTarget() {
+        expectEquals(true, isArrayOfA(new A[1]));
+        expectEquals(true, isArrayOfA(new F[1]));
+        expectEquals(true, isArrayOfA(new SiblingB[0]));
+        expectEquals(false, isArrayOfA(new Object[1]));
+        expectEquals(false, isArrayOfA(new A()));
+        expectEquals(false, isArrayOfA(new A[1][1]));
+        A[] array = new F[1];
+        expectEquals(true, castArrayOfA(array) == array);
+        try {
+            castArrayOfA(new Object[1]);
+            throw new Error("Expected ClassCastException");
+        } catch (ClassCastException expected) {
+        }
+    }
+
+    static void testUnloadedTarget() {
+        // The target class is resolved when the check first runs.
+        expectEquals(false, isLonely(new Object()));
+        expectEquals(false, isLonely(null));
+        expectEquals(true, isLonely(new LonelySub()));
+    }
+
+    static void expectClassCast(Object o) {
+        try {
+            castB(o);
+            throw new Error("Expected ClassCastException");
+        } catch (ClassCastException expected) {
+        }
+    }
+
+    static void expectEquals(boolean expected, boolean result) {
+        if (expected != result) {
+            throw new Error("Expected: " + expected + ", found: " + result);
+        }
+    }
+}
+
+interface I {}
+class A {}
+class B extends A {}
+class C extends B implements I {}
+class D extends C {}
+class E extends D {}
+class F extends E {}
+class SiblingB extends A {}
+final class FinalB extends B {}
+class Lonely {}
+class LonelySub extends Lonely {}
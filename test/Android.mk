@@ -44,6 +44,7 @@ TEST_DEX_DIRECTORIES := \
 TEST_OAT_DIRECTORIES := \
 	Main \
 	HelloWorld \
+	Benchmarks \
 	InterfaceTest \
 	JniTest \
 	SignalTest \
@@ -0,0 +1,613 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import dalvik.system.PathClassLoader;
+
+import java.lang.reflect.Field;
+import java.lang.reflect.Method;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Locale;
+
+/**
+ * Microbenchmarks of the hot paths of the runtime.
+ *
+ * Without arguments, like the other oat tests, every benchmark runs a few iterations and checks
+ * its result. With --timing the benchmarks are timed and each measurement is printed as a
+ * "name value unit" line, which art/test/run-benchmarks compares between builds. The other
+ * arguments select the benchmarks whose name starts with one of them.
+ */
+class Benchmarks {
+    // Format of the results, bumped when the measurements change meaning.
+    static final int RESULTS_VERSION = 1;
+
+    // A timed run is at least this long, the median of the runs is reported.
+    static final long MIN_RUN_NS = 100 * 1000 * 1000;
+    static final int RUNS = 5;
+    static final int CHECK_REPS = 16;
+
+    // The stalls of the ticker thread longer than this are counted as GC pauses.
+    static final long STALL_NS = 100 * 1000;
+    static final long GC_PAUSE_TIMING_NS = 2000L * 1000 * 1000;
+    static final long GC_PAUSE_CHECK_NS = 50L * 1000 * 1000;
+
+    static boolean timing;
+    static List<String> filters = new ArrayList<String>();
+
+    /**
+     * A benchmark timed per operation. run(reps) does reps operations and returns reps, which
+     * the checks verify and which keeps the work from being optimized away.
+     */
+    static abstract class Benchmark {
+        final String name;
+
+        Benchmark(String name) {
+            this.name = name;
+        }
+
+        abstract int run(int reps) throws Exception;
+    }
+
+    public static void main(String[] args) throws Exception {
+        System.loadLibrary("artbenchmark");
+        for (String arg : args) {
+            if (arg.equals("--timing")) {
+                timing = true;
+            } else {
+                filters.add(arg);
+            }
+        }
+        if (timing) {
+            System.out.println("# art-benchmarks " + RESULTS_VERSION);
+            System.out.println("# " + System.getProperty("java.vm.version") + " " +
+                               System.getProperty("os.arch"));
+        }
+        for (Benchmark benchmark : benchmarks()) {
+            if (selected(benchmark.name)) {
+                measure(benchmark);
+            }
+        }
+        if (selected("gc.pause")) {
+            measureGcPauses();
+        }
+    }
+
+    static boolean selected(String name) {
+        if (filters.isEmpty()) {
+            return true;
+        }
+        for (String filter : filters) {
+            if (name.startsWith(filter)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void report(String name, double value, String unit) {
+        System.out.println(String.format(Locale.US, "%s\t%.3f\t%s", name, value, unit));
+    }
+
+    static void measure(Benchmark benchmark) throws Exception {
+        if (!timing) {
+            int result = benchmark.run(CHECK_REPS);
+            if (result != CHECK_REPS) {
+                throw new AssertionError(benchmark.name + " returned " + result);
+            }
+            return;
+        }
+        // Warms up while finding the repetitions of a long enough run.
+        int reps = 1;
+        while (time(benchmark, reps) < MIN_RUN_NS && reps < Integer.MAX_VALUE / 2) {
+            reps *= 2;
+        }
+        double[] ns_per_op = new double[RUNS];
+        for (int i = 0; i < RUNS; ++i) {
+            ns_per_op[i] = (double) time(benchmark, reps) / reps;
+        }
+        Arrays.sort(ns_per_op);
+        double median = ns_per_op[RUNS / 2];
+        report(benchmark.name, median, "ns/op");
+        if (benchmark instanceof AllocArray) {
+            // The payload allocated per second.
+            report(benchmark.name + ".rate",
+                   AllocArray.SIZE * 1e9 / median / (1024 * 1024), "MB/s");
+        }
+    }
+
+    static long time(Benchmark benchmark, int reps) throws Exception {
+        long start = System.nanoTime();
+        int result = benchmark.run(reps);
+        long elapsed = System.nanoTime() - start;
+        if (result != reps) {
+            throw new AssertionError(benchmark.name + " returned " + result);
+        }
+        return elapsed;
+    }
+
+    static Benchmark[] benchmarks() throws Exception {
+        return new Benchmark[] {
+            new AllocObject(),
+            new AllocArray(),
+            new MonitorUncontended(),
+            new MonitorRecursive(),
+            new MonitorContended(),
+            new InvokeInterfaceMonomorphic(),
+            new InvokeInterfaceMegamorphic(),
+            new JniStaticNop(),
+            new JniArgs(),
+            new ReflectInvoke(),
+            new ReflectField(),
+            new ReflectLookup(),
+            new ExceptionLocal(),
+            new ExceptionDeep(),
+            new InternExisting(),
+            new InternNew(),
+            new ClassLoad(),
+        };
+    }
+
+    // Allocation.
+
+    static class AllocObject extends Benchmark {
+        AllocObject() {
+            super("alloc.object");
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                Object o = new Object();
+                if (o != null) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+    }
+
+    static class AllocArray extends Benchmark {
+        static final int SIZE = 1024;
+
+        AllocArray() {
+            super("alloc.array1k");
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                byte[] array = new byte[SIZE];
+                count += array.length / SIZE;
+            }
+            return count;
+        }
+    }
+
+    // Monitors.
+
+    static class MonitorUncontended extends Benchmark {
+        final Object lock = new Object();
+
+        MonitorUncontended() {
+            super("monitor.uncontended");
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                synchronized (lock) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+    }
+
+    static class MonitorRecursive extends Benchmark {
+        final Object lock = new Object();
+
+        MonitorRecursive() {
+            super("monitor.recursive");
+        }
+
+        int run(int reps) {
+            int count = 0;
+            synchronized (lock) {
+                for (int i = 0; i < reps; ++i) {
+                    synchronized (lock) {
+                        ++count;
+                    }
+                }
+            }
+            return count;
+        }
+    }
+
+    // Two threads taking turns on the same lock, the time is per enter of either thread.
+    static class MonitorContended extends Benchmark {
+        final Object lock = new Object();
+        int count;
+
+        MonitorContended() {
+            super("monitor.contended");
+        }
+
+        void increment(int reps) {
+            for (int i = 0; i < reps; ++i) {
+                synchronized (lock) {
+                    ++count;
+                }
+            }
+        }
+
+        int run(final int reps) throws Exception {
+            count = 0;
+            Thread other = new Thread() {
+                public void run() {
+                    increment(reps / 2);
+                }
+            };
+            other.start();
+            increment(reps - reps / 2);
+            other.join();
+            synchronized (lock) {
+                return count;
+            }
+        }
+    }
+
+    // Interface dispatch.
+
+    interface Shape {
+        int one();
+    }
+
+    static class Square implements Shape {
+        public int one() {
+            return 1;
+        }
+    }
+
+    static class Circle implements Shape {
+        public int one() {
+            return 1;
+        }
+    }
+
+    static class Triangle implements Shape {
+        public int one() {
+            return 1;
+        }
+    }
+
+    static class Hexagon implements Shape {
+        public int one() {
+            return 1;
+        }
+    }
+
+    static class InvokeInterfaceMonomorphic extends Benchmark {
+        final Shape shape = new Square();
+
+        InvokeInterfaceMonomorphic() {
+            super("invoke.interface.monomorphic");
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                count += shape.one();
+            }
+            return count;
+        }
+    }
+
+    static class InvokeInterfaceMegamorphic extends Benchmark {
+        final Shape[] shapes = { new Square(), new Circle(), new Triangle(), new Hexagon() };
+
+        InvokeInterfaceMegamorphic() {
+            super("invoke.interface.megamorphic");
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                count += shapes[i & 3].one();
+            }
+            return count;
+        }
+    }
+
+    // JNI, the natives are in benchmarks_jni.cc.
+
+    static native void nativeNop();
+
+    native int nativeArgs(int i, long l, Object o);
+
+    static class JniStaticNop extends Benchmark {
+        JniStaticNop() {
+            super("jni.static.nop");
+        }
+
+        int run(int reps) {
+            for (int i = 0; i < reps; ++i) {
+                nativeNop();
+            }
+            return reps;
+        }
+    }
+
+    static class JniArgs extends Benchmark {
+        final Benchmarks receiver = new Benchmarks();
+
+        JniArgs() {
+            super("jni.instance.args");
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                count += receiver.nativeArgs(1, 0L, this);
+            }
+            return count;
+        }
+    }
+
+    // Reflection.
+
+    static int one = 1;
+
+    static int identity(int i) {
+        return i;
+    }
+
+    static class ReflectInvoke extends Benchmark {
+        final Method method;
+
+        ReflectInvoke() throws Exception {
+            super("reflect.invoke");
+            method = Benchmarks.class.getDeclaredMethod("identity", int.class);
+        }
+
+        int run(int reps) throws Exception {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                count += (Integer) method.invoke(null, 1);
+            }
+            return count;
+        }
+    }
+
+    static class ReflectField extends Benchmark {
+        final Field field;
+
+        ReflectField() throws Exception {
+            super("reflect.field.get");
+            field = Benchmarks.class.getDeclaredField("one");
+        }
+
+        int run(int reps) throws Exception {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                count += field.getInt(null);
+            }
+            return count;
+        }
+    }
+
+    static class ReflectLookup extends Benchmark {
+        ReflectLookup() {
+            super("reflect.lookup");
+        }
+
+        int run(int reps) throws Exception {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                if (Benchmarks.class.getDeclaredMethod("identity", int.class) != null) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+    }
+
+    // Exceptions.
+
+    static class BenchmarkException extends Exception {
+    }
+
+    static final BenchmarkException PREALLOCATED_EXCEPTION = new BenchmarkException();
+
+    // New exceptions, which fill in their stack trace, thrown and caught in the same method.
+    static class ExceptionLocal extends Benchmark {
+        ExceptionLocal() {
+            super("exception.local");
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                try {
+                    throw new BenchmarkException();
+                } catch (BenchmarkException e) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+    }
+
+    // A preallocated exception unwinding through several frames.
+    static class ExceptionDeep extends Benchmark {
+        static final int DEPTH = 8;
+
+        ExceptionDeep() {
+            super("exception.deep");
+        }
+
+        static int thrower(int depth) throws BenchmarkException {
+            if (depth == 0) {
+                throw PREALLOCATED_EXCEPTION;
+            }
+            return thrower(depth - 1) + 1;
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                try {
+                    count += thrower(DEPTH);
+                } catch (BenchmarkException e) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+    }
+
+    // String interning.
+
+    static class InternExisting extends Benchmark {
+        static final int COUNT = 256;
+        final String[] interned = new String[COUNT];
+        final String[] copies = new String[COUNT];
+
+        InternExisting() {
+            super("intern.existing");
+            for (int i = 0; i < COUNT; ++i) {
+                interned[i] = ("benchmark string " + i).intern();
+                copies[i] = new String(interned[i].toCharArray());
+            }
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                if (copies[i % COUNT].intern() == interned[i % COUNT]) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+    }
+
+    // Strings which were never interned, including their allocation.
+    static class InternNew extends Benchmark {
+        int next;
+
+        InternNew() {
+            super("intern.new");
+        }
+
+        int run(int reps) {
+            int count = 0;
+            for (int i = 0; i < reps; ++i) {
+                if (String.valueOf(next++).intern() != null) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+    }
+
+    // Class loading.
+
+    // Loads and initializes the classes of Loadees.java from new class loaders, the time is per
+    // class and includes opening the dex file for each class loader.
+    static class ClassLoad extends Benchmark {
+        static final String[] CLASSES = {
+            "Loadee0", "Loadee1", "Loadee2", "Loadee3", "Loadee4", "Loadee5", "Loadee6", "Loadee7",
+        };
+        final String classPath = System.getProperty("java.class.path");
+        final ClassLoader parent = ClassLoader.getSystemClassLoader().getParent();
+
+        ClassLoad() {
+            super("classload");
+        }
+
+        int run(int reps) throws Exception {
+            int count = 0;
+            ClassLoader loader = null;
+            for (int i = 0; i < reps; ++i) {
+                if (i % CLASSES.length == 0) {
+                    loader = new PathClassLoader(classPath, parent);
+                }
+                Class<?> klass = Class.forName(CLASSES[i % CLASSES.length], true, loader);
+                if (klass.getClassLoader() == loader) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+    }
+
+    // GC pauses, as seen by a thread which does nothing but read the clock.
+
+    static class Ticker extends Thread {
+        final long[] stalls = new long[4096];
+        int stallCount;
+        volatile boolean done;
+
+        public void run() {
+            long last = System.nanoTime();
+            while (!done) {
+                long now = System.nanoTime();
+                if (now - last > STALL_NS && stallCount < stalls.length) {
+                    stalls[stallCount++] = now - last;
+                }
+                last = now;
+            }
+        }
+    }
+
+    static void measureGcPauses() throws Exception {
+        Ticker ticker = new Ticker();
+        ticker.start();
+        // Churn through the heap while keeping a few megabytes live, so that both the sticky and
+        // the full collections run.
+        byte[][] live = new byte[4096][];
+        long end = System.nanoTime() + (timing ? GC_PAUSE_TIMING_NS : GC_PAUSE_CHECK_NS);
+        long allocated = 0;
+        for (int i = 0; System.nanoTime() < end; ++i) {
+            live[i % live.length] = new byte[1024];
+            allocated += 1024;
+        }
+        ticker.done = true;
+        ticker.join();
+        if (allocated == 0) {
+            throw new AssertionError("gc.pause allocated nothing");
+        }
+        if (!timing) {
+            return;
+        }
+        long[] stalls = Arrays.copyOf(ticker.stalls, ticker.stallCount);
+        Arrays.sort(stalls);
+        report("gc.pause.count", stalls.length, "count");
+        report("gc.pause.p50", percentile(stalls, 50) / 1000.0, "us");
+        report("gc.pause.p90", percentile(stalls, 90) / 1000.0, "us");
+        report("gc.pause.p99", percentile(stalls, 99) / 1000.0, "us");
+        report("gc.pause.max", percentile(stalls, 100) / 1000.0, "us");
+    }
+
+    static long percentile(long[] sorted, int percent) {
+        if (sorted.length == 0) {
+            return 0;
+        }
+        int index = (int) Math.ceil(sorted.length * percent / 100.0) - 1;
+        return sorted[Math.max(0, Math.min(sorted.length - 1, index))];
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Classes loaded by the classload benchmark, each from new class loaders.
+
+class Loadee0 {
+    static int value = 0;
+    int field;
+
+    int get() {
+        return field + value;
+    }
+}
+
+class Loadee1 {
+    static int value = 1;
+    int field;
+
+    int get() {
+        return field + value;
+    }
+}
+
+class Loadee2 {
+    static int value = 2;
+    int field;
+
+    int get() {
+        return field + value;
+    }
+}
+
+class Loadee3 {
+    static int value = 3;
+    int field;
+
+    int get() {
+        return field + value;
+    }
+}
+
+class Loadee4 {
+    static int value = 4;
+    int field;
+
+    int get() {
+        return field + value;
+    }
+}
+
+class Loadee5 {
+    static int value = 5;
+    int field;
+
+    int get() {
+        return field + value;
+    }
+}
+
+class Loadee6 {
+    static int value = 6;
+    int field;
+
+    int get() {
+        return field + value;
+    }
+}
+
+class Loadee7 {
+    static int value = 7;
+    int field;
+
+    int get() {
+        return field + value;
+    }
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni.h"
+
+// The natives of the JNI benchmarks, which only measure the transitions. Unlike libarttest, the
+// library doesn't link against the runtime so that the benchmarks can run with libart.so.
+
+extern "C" JNIEXPORT void JNICALL Java_Benchmarks_nativeNop(JNIEnv*, jclass) {
+}
+
+extern "C" JNIEXPORT jint JNICALL Java_Benchmarks_nativeArgs(JNIEnv*, jobject, jint i, jlong l,
+                                                             jobject o) {
+  return o != nullptr ? i + static_cast<jint>(l) : 0;
+}
@@ -28,6 +28,8 @@ class MyClassNatives {
     native Object fooIOO(int x, Object y, Object z);
     static native Object fooSIOO(int x, Object y, Object z);
     static native int fooSII(int x, int y);
+    @dalvik.annotation.optimization.FastNative
+    static native int fooSIIFast(int x, int y);
     static native double fooSDD(double x, double y);
     static synchronized native Object fooSSIOO(int x, Object y, Object z);
     static native void arraycopy(Object src, int src_pos, Object dst, int dst_pos, int length);
@@ -0,0 +1,244 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2014 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Measures the compile time and memory of dex2oat on a fixed corpus.
+
+  dex2oat-benchmark.py run [options] [dex files]
+      Compiles every dex file --runs times with --dump-stats-json and writes the
+      median of the runs. Without dex files, the corpus is the oat test dex files
+      of the host build, or the files listed in --corpus.
+
+  dex2oat-benchmark.py compare [--threshold PERCENT] old.json new.json
+      Prints the change of every measurement between two runs, for instance of
+      two toolchains, and exits with 1 if one of the totals regressed.
+"""
+
+from __future__ import print_function
+
+import argparse
+import glob
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+
+# Times are in microseconds and memory in bytes or KB, lower is better for all of
+# them but the thread utilization.
+_HIGHER_IS_BETTER = set(['thread_utilization'])
+
+# The measurements which fail the comparison when they regress, the phases and
+# passes are only reported since they shift between each other.
+_TOTALS = set(['wall_us', 'cpu_us', 'peak_rss_kb', 'arena.peak_bytes_in_arenas'])
+
+# Changes smaller than this are noise, whatever their percentage.
+_MIN_DELTA_US = 1000
+_MIN_DELTA_BYTES = 64 * 1024
+
+
+def _median(values):
+  values = sorted(values)
+  middle = len(values) // 2
+  if len(values) % 2 == 1:
+    return values[middle]
+  return (values[middle - 1] + values[middle]) / 2.0
+
+
+def _flatten(stats):
+  """Returns the measurements of one --dump-stats-json file by name."""
+  result = {}
+  for key in ('wall_us', 'cpu_us', 'thread_utilization', 'peak_rss_kb'):
+    result[key] = stats[key]
+  for phase in stats['phases']:
+    # A phase may run more than once, as nested splits of another one.
+    name = 'phase.' + phase['name']
+    result[name] = result.get(name, 0) + phase['us']
+  for compiler_pass in stats['passes']:
+    result['pass.' + compiler_pass['name']] = compiler_pass['total_us']
+  arena = stats['arena']
+  result['arena.peak_bytes_in_arenas'] = arena['peak_bytes_in_arenas']
+  result['arena.peak_bytes_per_allocator'] = arena['peak_bytes_per_allocator']
+  for kind, usage in arena['kinds'].items():
+    result['arena.total_bytes.' + kind] = usage['total_bytes']
+  return result
+
+
+def _default_corpus(host_out):
+  return sorted(glob.glob(os.path.join(host_out, 'framework', 'oat-test-dex-*.jar')))
+
+
+def _read_corpus(corpus_file):
+  with open(corpus_file) as f:
+    lines = [line.strip() for line in f]
+  return [line for line in lines if line and not line.startswith('#')]
+
+
+def _compile(args, dex_file, tmp_dir):
+  oat_file = os.path.join(tmp_dir, 'out.oat')
+  stats_file = os.path.join(tmp_dir, 'stats.json')
+  command = [args.dex2oat,
+             '--runtime-arg', '-Xms64m', '--runtime-arg', '-Xmx64m',
+             '--boot-image=' + args.boot_image,
+             '--dex-file=' + dex_file,
+             '--oat-file=' + oat_file,
+             '--instruction-set=' + args.instruction_set,
+             '--dump-stats-json=' + stats_file]
+  if args.host:
+    command += ['--host', '--android-root=' + args.android_root]
+  if args.threads:
+    command.append('-j%d' % args.threads)
+  command += args.dex2oat_arg
+  env = dict(os.environ)
+  env['ANDROID_DATA'] = tmp_dir
+  env['ANDROID_ROOT'] = args.android_root
+  with open(os.devnull, 'w') as devnull:
+    if subprocess.call(command, env=env, stdout=devnull, stderr=devnull) != 0:
+      raise RuntimeError('dex2oat failed: ' + ' '.join(command))
+  with open(stats_file) as f:
+    stats = json.load(f)
+  os.remove(oat_file)
+  os.remove(stats_file)
+  return stats
+
+
+def _run(args):
+  host_out = os.environ.get('ANDROID_HOST_OUT', '')
+  if not args.android_root:
+    args.android_root = host_out
+  if not args.dex2oat:
+    args.dex2oat = os.path.join(host_out, 'bin', 'dex2oat')
+  if not args.boot_image:
+    args.boot_image = os.path.join(host_out, 'framework', 'core.art')
+  corpus = args.dex_files
+  if not corpus:
+    corpus = _read_corpus(args.corpus) if args.corpus else _default_corpus(host_out)
+  if not corpus:
+    print('empty corpus, set ANDROID_HOST_OUT or give the dex files', file=sys.stderr)
+    return 1
+
+  results = {}
+  tmp_dir = tempfile.mkdtemp(prefix='dex2oat-benchmark-')
+  try:
+    for dex_file in corpus:
+      runs = [_flatten(_compile(args, dex_file, tmp_dir)) for _ in range(args.runs)]
+      names = set()
+      for run in runs:
+        names.update(run.keys())
+      # Passes which did not run in every compilation count as 0 in the others.
+      results[os.path.basename(dex_file)] = dict(
+          (name, _median([run.get(name, 0) for run in runs])) for name in names)
+      print('%s: %d us' % (dex_file, results[os.path.basename(dex_file)]['wall_us']),
+            file=sys.stderr)
+  finally:
+    shutil.rmtree(tmp_dir)
+
+  report = {'version': 1,
+            'dex2oat': args.dex2oat,
+            'instruction_set': args.instruction_set,
+            'runs': args.runs,
+            'files': results}
+  output = open(args.output, 'w') if args.output else sys.stdout
+  json.dump(report, output, indent=2, sort_keys=True)
+  output.write('\n')
+  if args.output:
+    output.close()
+  return 0
+
+
+def _is_noise(name, old, new):
+  delta = abs(new - old)
+  if name.endswith('_us') or name.startswith('phase.') or name.startswith('pass.'):
+    return delta < _MIN_DELTA_US
+  if name.endswith('_kb'):
+    return delta * 1024 < _MIN_DELTA_BYTES
+  if 'bytes' in name:
+    return delta < _MIN_DELTA_BYTES
+  return False
+
+
+def _compare(args):
+  with open(args.old) as f:
+    old_files = json.load(f)['files']
+  with open(args.new) as f:
+    new_files = json.load(f)['files']
+  regressions = 0
+  for dex_file in sorted(set(old_files) | set(new_files)):
+    if dex_file not in new_files or dex_file not in old_files:
+      print('%s: only in %s' % (dex_file, args.old if dex_file in old_files else args.new))
+      continue
+    print(dex_file)
+    old = old_files[dex_file]
+    new = new_files[dex_file]
+    for name in sorted(set(old) | set(new)):
+      if name not in old or name not in new:
+        print('  %-48s %s' % (name, 'new' if name in new else 'missing'))
+        continue
+      if old[name] == 0:
+        continue
+      change = (new[name] - old[name]) * 100.0 / old[name]
+      worse = -change if name in _HIGHER_IS_BETTER else change
+      mark = ''
+      if abs(worse) > args.threshold and not _is_noise(name, old[name], new[name]):
+        if worse < 0:
+          mark = '  improved'
+        elif name in _TOTALS:
+          mark = '  REGRESSION'
+          regressions += 1
+        else:
+          mark = '  worse'
+      print('  %-48s %14.6g %14.6g %+7.1f%%%s' % (name, old[name], new[name], change, mark))
+  if regressions:
+    print('%d total(s) regressed by more than %g%%' % (regressions, args.threshold))
+    return 1
+  return 0
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                                   formatter_class=argparse.RawDescriptionHelpFormatter)
+  subparsers = parser.add_subparsers(dest='command')
+
+  run = subparsers.add_parser('run', help='compile the corpus and write the measurements')
+  run.add_argument('--dex2oat', help='dex2oat to run (default: $ANDROID_HOST_OUT/bin/dex2oat)')
+  run.add_argument('--boot-image', help='default: $ANDROID_HOST_OUT/framework/core.art')
+  run.add_argument('--android-root', help='default: $ANDROID_HOST_OUT')
+  run.add_argument('--instruction-set', default='x86')
+  run.add_argument('--no-host', dest='host', action='store_false',
+                   help='compile for the target instead of the host')
+  run.add_argument('--threads', type=int, help='compiler threads (default: dex2oat\'s)')
+  run.add_argument('--runs', type=int, default=3, help='compilations of every file (default: 3)')
+  run.add_argument('--corpus', help='file listing the dex files, one per line')
+  run.add_argument('--dex2oat-arg', action='append', default=[],
+                   help='extra dex2oat argument, may be repeated')
+  run.add_argument('--output', help='write the measurements to this file')
+  run.add_argument('dex_files', nargs='*')
+
+  compare = subparsers.add_parser('compare', help='compare the measurements of two runs')
+  compare.add_argument('--threshold', type=float, default=5.0,
+                       help='change reported in percent (default: 5)')
+  compare.add_argument('old')
+  compare.add_argument('new')
+
+  args = parser.parse_args()
+  if args.command == 'run':
+    return _run(args)
+  return _compare(args)
+
+
+if __name__ == '__main__':
+  sys.exit(main())